@@ -30,6 +30,7 @@
 #include <linux/list_lru.h>
 #include <linux/uaccess.h>
 #include <linux/highmem.h>
+#include <linux/log2.h>
 #include "binder_alloc.h"
 #include "binder_trace.h"
 
@@ -47,6 +48,18 @@ static uint32_t binder_alloc_debug_mask;
 module_param_named(debug_mask, binder_alloc_debug_mask,
 		   uint, 0644);
 
+/* parked buffers per size class, 0 turns the size classes off */
+static uint32_t binder_alloc_class_depth = 8;
+
+module_param_named(size_class_depth, binder_alloc_class_depth,
+		   uint, 0644);
+
+/* pages at the start of the buffer mapped with the first transaction */
+static uint32_t binder_alloc_hot_pages = 4;
+
+module_param_named(hot_pages, binder_alloc_hot_pages,
+		   uint, 0644);
+
 #define binder_alloc_debug(mask, x...) \
 	do { \
 		if (binder_alloc_debug_mask & mask) \
@@ -71,6 +84,25 @@ static size_t binder_alloc_buffer_size(struct binder_alloc *alloc,
 	return binder_buffer_next(buffer)->user_data - buffer->user_data;
 }
 
+static int binder_alloc_size_class(size_t size)
+{
+	if (size <= BINDER_ALLOC_CLASS_SIZE(0))
+		return 0;
+	if (size > BINDER_ALLOC_CLASS_SIZE(BINDER_ALLOC_SIZE_CLASSES - 1))
+		return -1;
+	return order_base_2(size) - BINDER_ALLOC_CLASS_MIN_SHIFT;
+}
+
+static size_t binder_alloc_class_round(struct binder_alloc *alloc,
+				       size_t size)
+{
+	int c = binder_alloc_size_class(size);
+
+	if (c < 0 || alloc->size_class_off || !binder_alloc_class_depth)
+		return size;
+	return BINDER_ALLOC_CLASS_SIZE(c);
+}
+
 static void binder_insert_free_buffer(struct binder_alloc *alloc,
 				      struct binder_buffer *new_buffer)
 {
@@ -184,6 +216,53 @@ struct binder_buffer *binder_alloc_prepare_to_free(struct binder_alloc *alloc,
 	return buffer;
 }
 
+/*
+ * Small transactions land at the start of the buffer, best fit hands
+ * out the low addresses first. Map those pages in one go while the
+ * first transaction holds mmap_sem anyway. They go on the lru like the
+ * pages of any free buffer, so the shrinker takes back what is unused.
+ */
+static void binder_alloc_map_hot(struct binder_alloc *alloc,
+				 struct vm_area_struct *vma)
+{
+	struct binder_lru_page *page;
+	size_t index, nr;
+	bool ret;
+
+	alloc->hot_mapped = true;
+	nr = min_t(size_t, binder_alloc_hot_pages,
+		   alloc->buffer_size / PAGE_SIZE);
+
+	for (index = 0; index < nr; index++) {
+		page = &alloc->pages[index];
+		if (page->page_ptr)
+			continue;
+
+		trace_binder_alloc_page_start(alloc, index);
+		page->page_ptr = alloc_page(GFP_KERNEL |
+					    __GFP_HIGHMEM |
+					    __GFP_ZERO);
+		if (!page->page_ptr)
+			break;
+		page->alloc = alloc;
+		INIT_LIST_HEAD(&page->lru);
+
+		if (vm_insert_page(vma, (uintptr_t)alloc->buffer +
+				   index * PAGE_SIZE, page->page_ptr)) {
+			__free_page(page->page_ptr);
+			page->page_ptr = NULL;
+			break;
+		}
+
+		ret = list_lru_add(&binder_alloc_lru, &page->lru);
+		WARN_ON(!ret);
+
+		if (index + 1 > alloc->pages_high)
+			alloc->pages_high = index + 1;
+		trace_binder_alloc_page_end(alloc, index);
+	}
+}
+
 static int binder_update_page_range(struct binder_alloc *alloc, int allocate,
 				    void __user *start, void __user *end)
 {
@@ -280,6 +359,8 @@ static int binder_update_page_range(struct binder_alloc *alloc, int allocate,
 		trace_binder_alloc_page_end(alloc, index);
 		/* vm_insert_page does not seem to increment the refcount */
 	}
+	if (mm && !alloc->hot_mapped)
+		binder_alloc_map_hot(alloc, vma);
 	if (mm) {
 		up_read(&mm->mmap_sem);
 		mmput(mm);
@@ -346,6 +427,55 @@ static inline struct vm_area_struct *binder_alloc_get_vma(
 	return vma;
 }
 
+static struct binder_buffer *binder_alloc_class_get(struct binder_alloc *alloc,
+						   size_t size)
+{
+	struct binder_buffer *buffer;
+	int c = binder_alloc_size_class(size);
+
+	if (c < 0 || size != BINDER_ALLOC_CLASS_SIZE(c) ||
+	    list_empty(&alloc->size_class[c]))
+		return NULL;
+
+	buffer = list_first_entry(&alloc->size_class[c],
+				  struct binder_buffer, class_entry);
+	list_del(&buffer->class_entry);
+	alloc->size_class_cnt[c]--;
+
+	binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
+		     "%d: binder_alloc_buf size %zd reuse parked %pK\n",
+		      alloc->pid, size, buffer);
+	return buffer;
+}
+
+static struct rb_node *binder_alloc_best_fit(struct binder_alloc *alloc,
+					     size_t size)
+{
+	struct rb_node *n = alloc->free_buffers.rb_node;
+	struct rb_node *best_fit = NULL;
+	struct binder_buffer *buffer;
+	size_t buffer_size;
+
+	while (n) {
+		buffer = rb_entry(n, struct binder_buffer, rb_node);
+		BUG_ON(!buffer->free);
+		buffer_size = binder_alloc_buffer_size(alloc, buffer);
+
+		if (size < buffer_size) {
+			best_fit = n;
+			n = n->rb_left;
+		} else if (size > buffer_size)
+			n = n->rb_right;
+		else {
+			best_fit = n;
+			break;
+		}
+	}
+	return best_fit;
+}
+
+static int binder_alloc_class_drain(struct binder_alloc *alloc);
+
 static struct binder_buffer *binder_alloc_new_buf_locked(
 				struct binder_alloc *alloc,
 				size_t data_size,
@@ -353,7 +483,7 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 				size_t extra_buffers_size,
 				int is_async)
 {
-	struct rb_node *n = alloc->free_buffers.rb_node;
+	struct rb_node *n;
 	struct binder_buffer *buffer;
 	size_t buffer_size;
 	struct rb_node *best_fit = NULL;
@@ -384,6 +514,11 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 				alloc->pid, extra_buffers_size);
 		return ERR_PTR(-EINVAL);
 	}
+
+	/* Pad 0-size buffers so they get assigned unique addresses */
+	size = max(size, sizeof(void *));
+	size = binder_alloc_class_round(alloc, size);
+
 	if (is_async &&
 	    alloc->free_async_space < size + sizeof(struct binder_buffer)) {
 		binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
@@ -392,24 +527,14 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 		return ERR_PTR(-ENOSPC);
 	}
 
-	/* Pad 0-size buffers so they get assigned unique addresses */
-	size = max(size, sizeof(void *));
+	/* a parked buffer still has its pages, nothing to split or map */
+	buffer = binder_alloc_class_get(alloc, size);
+	if (buffer)
+		goto got_buffer;
 
-	while (n) {
-		buffer = rb_entry(n, struct binder_buffer, rb_node);
-		BUG_ON(!buffer->free);
-		buffer_size = binder_alloc_buffer_size(alloc, buffer);
-
-		if (size < buffer_size) {
-			best_fit = n;
-			n = n->rb_left;
-		} else if (size > buffer_size)
-			n = n->rb_right;
-		else {
-			best_fit = n;
-			break;
-		}
-	}
+	best_fit = binder_alloc_best_fit(alloc, size);
+	if (best_fit == NULL && binder_alloc_class_drain(alloc))
+		best_fit = binder_alloc_best_fit(alloc, size);
 	if (best_fit == NULL) {
 		size_t allocated_buffers = 0;
 		size_t largest_alloc_size = 0;
@@ -443,10 +568,8 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 		       total_free_size, free_buffers, largest_free_size);
 		return ERR_PTR(-ENOSPC);
 	}
-	if (n == NULL) {
-		buffer = rb_entry(best_fit, struct binder_buffer, rb_node);
-		buffer_size = binder_alloc_buffer_size(alloc, buffer);
-	}
+	buffer = rb_entry(best_fit, struct binder_buffer, rb_node);
+	buffer_size = binder_alloc_buffer_size(alloc, buffer);
 
 	binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
 		     "%d: binder_alloc_buf size %zd got buffer %pK size %zd\n",
@@ -454,7 +577,6 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 
 	has_page_addr = (void __user *)
 		(((uintptr_t)buffer->user_data + buffer_size) & PAGE_MASK);
-	WARN_ON(n && buffer_size != size);
 	end_page_addr =
 		(void __user *)PAGE_ALIGN((uintptr_t)buffer->user_data + size);
 	if (end_page_addr > has_page_addr)
@@ -481,6 +603,7 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 
 	rb_erase(best_fit, &alloc->free_buffers);
 	buffer->free = 0;
+got_buffer:
 	buffer->allow_user_free = 0;
 	binder_insert_allocated_buffer_locked(alloc, buffer);
 	binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
@@ -594,41 +717,41 @@ static void binder_delete_free_buffer(struct binder_alloc *alloc,
 	kfree(buffer);
 }
 
-static void binder_free_buf_locked(struct binder_alloc *alloc,
-				   struct binder_buffer *buffer)
+/*
+ * Park a freed buffer of a size class, it keeps its pages and stays out
+ * of free_buffers so the next transaction of its class gets it back
+ * cheaply. Once the vma is gone nothing is parked any more.
+ */
+static bool binder_alloc_class_put(struct binder_alloc *alloc,
+				   struct binder_buffer *buffer,
+				   size_t buffer_size)
 {
-	size_t size, buffer_size;
+	int c = binder_alloc_size_class(buffer_size);
 
-	buffer_size = binder_alloc_buffer_size(alloc, buffer);
+	if (c < 0 || buffer_size != BINDER_ALLOC_CLASS_SIZE(c) ||
+	    alloc->size_class_off || !binder_alloc_get_vma(alloc) ||
+	    alloc->size_class_cnt[c] >= binder_alloc_class_depth)
+		return false;
 
-	size = ALIGN(buffer->data_size, sizeof(void *)) +
-		ALIGN(buffer->offsets_size, sizeof(void *)) +
-		ALIGN(buffer->extra_buffers_size, sizeof(void *));
+	rb_erase(&buffer->rb_node, &alloc->allocated_buffers);
+	list_add(&buffer->class_entry, &alloc->size_class[c]);
+	alloc->size_class_cnt[c]++;
 
 	binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
-		     "%d: binder_free_buf %pK size %zd buffer_size %zd\n",
-		      alloc->pid, buffer, size, buffer_size);
-
-	BUG_ON(buffer->free);
-	BUG_ON(size > buffer_size);
-	BUG_ON(buffer->transaction != NULL);
-	BUG_ON(buffer->user_data < alloc->buffer);
-	BUG_ON(buffer->user_data > alloc->buffer + alloc->buffer_size);
-
-	if (buffer->async_transaction) {
-		alloc->free_async_space += size + sizeof(struct binder_buffer);
-
-		binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC_ASYNC,
-			     "%d: binder_free_buf size %zd async free %zd\n",
-			      alloc->pid, size, alloc->free_async_space);
-	}
+		     "%d: binder_free_buf %pK parked in class %d\n",
+		      alloc->pid, buffer, c);
+	return true;
+}
 
+static void binder_free_buf_release(struct binder_alloc *alloc,
+				    struct binder_buffer *buffer,
+				    size_t buffer_size)
+{
 	binder_update_page_range(alloc, 0,
 		(void __user *)PAGE_ALIGN((uintptr_t)buffer->user_data),
 		(void __user *)(((uintptr_t)
 			  buffer->user_data + buffer_size) & PAGE_MASK));
 
-	rb_erase(&buffer->rb_node, &alloc->allocated_buffers);
 	buffer->free = 1;
 	if (!list_is_last(&buffer->entry, &alloc->buffers)) {
 		struct binder_buffer *next = binder_buffer_next(buffer);
@@ -650,6 +773,70 @@ static void binder_free_buf_locked(struct binder_alloc *alloc,
 	binder_insert_free_buffer(alloc, buffer);
 }
 
+/*
+ * Give the parked buffers back to free_buffers, where they can merge
+ * again. Done when an allocation finds no space and on release.
+ *
+ * Return: number of buffers released
+ */
+static int binder_alloc_class_drain(struct binder_alloc *alloc)
+{
+	struct binder_buffer *buffer;
+	int c, count = 0;
+
+	for (c = 0; c < BINDER_ALLOC_SIZE_CLASSES; c++) {
+		while (!list_empty(&alloc->size_class[c])) {
+			buffer = list_first_entry(&alloc->size_class[c],
+						  struct binder_buffer,
+						  class_entry);
+			list_del(&buffer->class_entry);
+			binder_free_buf_release(alloc, buffer,
+				binder_alloc_buffer_size(alloc, buffer));
+			count++;
+		}
+		alloc->size_class_cnt[c] = 0;
+	}
+	return count;
+}
+
+static void binder_free_buf_locked(struct binder_alloc *alloc,
+				   struct binder_buffer *buffer)
+{
+	size_t size, buffer_size;
+
+	buffer_size = binder_alloc_buffer_size(alloc, buffer);
+
+	size = ALIGN(buffer->data_size, sizeof(void *)) +
+		ALIGN(buffer->offsets_size, sizeof(void *)) +
+		ALIGN(buffer->extra_buffers_size, sizeof(void *));
+
+	binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
+		     "%d: binder_free_buf %pK size %zd buffer_size %zd\n",
+		      alloc->pid, buffer, size, buffer_size);
+
+	BUG_ON(buffer->free);
+	BUG_ON(size > buffer_size);
+	BUG_ON(buffer->transaction != NULL);
+	BUG_ON(buffer->user_data < alloc->buffer);
+	BUG_ON(buffer->user_data > alloc->buffer + alloc->buffer_size);
+
+	if (buffer->async_transaction) {
+		/* what binder_alloc_new_buf_locked() took, padded and rounded */
+		alloc->free_async_space += buffer_size +
+			sizeof(struct binder_buffer);
+
+		binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC_ASYNC,
+			     "%d: binder_free_buf size %zd async free %zd\n",
+			      alloc->pid, size, alloc->free_async_space);
+	}
+
+	if (binder_alloc_class_put(alloc, buffer, buffer_size))
+		return;
+
+	rb_erase(&buffer->rb_node, &alloc->allocated_buffers);
+	binder_free_buf_release(alloc, buffer, buffer_size);
+}
+
 /**
  * binder_alloc_free_buf() - free a binder buffer
  * @alloc:	binder_alloc for this proc
@@ -746,6 +933,8 @@ void binder_alloc_deferred_release(struct binder_alloc *alloc)
 	mutex_lock(&alloc->mutex);
 	BUG_ON(alloc->vma);
 
+	binder_alloc_class_drain(alloc);
+
 	while ((n = rb_first(&alloc->allocated_buffers))) {
 		buffer = rb_entry(n, struct binder_buffer, rb_node);
 
@@ -841,6 +1030,7 @@ void binder_alloc_print_pages(struct seq_file *m,
 	int active = 0;
 	int lru = 0;
 	int free = 0;
+	int parked = 0;
 
 	mutex_lock(&alloc->mutex);
 	for (i = 0; i < alloc->buffer_size / PAGE_SIZE; i++) {
@@ -852,9 +1042,12 @@ void binder_alloc_print_pages(struct seq_file *m,
 		else
 			lru++;
 	}
+	for (i = 0; i < BINDER_ALLOC_SIZE_CLASSES; i++)
+		parked += alloc->size_class_cnt[i];
 	mutex_unlock(&alloc->mutex);
 	seq_printf(m, "  pages: %d:%d:%d\n", active, lru, free);
 	seq_printf(m, "  pages high watermark: %zu\n", alloc->pages_high);
+	seq_printf(m, "  parked buffers: %d\n", parked);
 }
 
 /**
@@ -994,9 +1187,13 @@ static struct shrinker binder_shrinker = {
  */
 void binder_alloc_init(struct binder_alloc *alloc)
 {
+	int i;
+
 	alloc->pid = current->group_leader->pid;
 	mutex_init(&alloc->mutex);
 	INIT_LIST_HEAD(&alloc->buffers);
+	for (i = 0; i < BINDER_ALLOC_SIZE_CLASSES; i++)
+		INIT_LIST_HEAD(&alloc->size_class[i]);
 }
 
 int binder_alloc_shrinker_init(void)
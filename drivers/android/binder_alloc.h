@@ -31,6 +31,7 @@ struct binder_transaction;
  * struct binder_buffer - buffer used for binder transactions
  * @entry:              entry alloc->buffers
  * @rb_node:            node for allocated_buffers/free_buffers rb trees
+ * @class_entry:        entry in alloc->size_class, while parked there
  * @free:               %true if buffer is free
  * @allow_user_free:    %true if user is allowed to free buffer
  * @async_transaction:  %true if buffer is in use for an async txn
@@ -46,8 +47,11 @@ struct binder_transaction;
  */
 struct binder_buffer {
 	struct list_head entry; /* free and allocated entries by address */
-	struct rb_node rb_node; /* free entry by size or allocated entry */
-				/* by address */
+	union {
+		struct rb_node rb_node; /* free entry by size or allocated */
+					/* entry by address */
+		struct list_head class_entry;
+	};
 	unsigned free:1;
 	unsigned allow_user_free:1;
 	unsigned async_transaction:1;
@@ -74,6 +78,17 @@ struct binder_lru_page {
 	struct binder_alloc *alloc;
 };
 
+/*
+ * Freed buffers of a size class, 128 bytes to 4K, are parked on
+ * per-class lists with their pages still mapped instead of going back
+ * to free_buffers. Small buffers are rounded up to their class so a
+ * parked buffer fits any later request of that class.
+ */
+#define BINDER_ALLOC_CLASS_MIN_SHIFT	7
+#define BINDER_ALLOC_SIZE_CLASSES	6
+#define BINDER_ALLOC_CLASS_SIZE(c)	\
+	((size_t)1 << ((c) + BINDER_ALLOC_CLASS_MIN_SHIFT))
+
 /**
  * struct binder_alloc - per-binder proc state for binder allocator
  * @vma:                vm_area_struct passed to mmap_handler
@@ -92,6 +107,10 @@ struct binder_lru_page {
  * @buffer_size:        size of address space specified via mmap
  * @pid:                pid for associated binder_proc (invariant after init)
  * @pages_high:         high watermark of offset in @pages
+ * @size_class:         parked free buffers, per size class
+ * @size_class_cnt:     number of buffers on each @size_class list
+ * @size_class_off:     do not round or park buffers (selftest)
+ * @hot_mapped:         the first hot_pages of the buffer were mapped
  *
  * Bookkeeping structure for per-proc address space management for binder
  * buffers. It is normally initialized during binder_init() and binder_mmap()
@@ -112,6 +131,10 @@ struct binder_alloc {
 	uint32_t buffer_free;
 	int pid;
 	size_t pages_high;
+	struct list_head size_class[BINDER_ALLOC_SIZE_CLASSES];
+	unsigned int size_class_cnt[BINDER_ALLOC_SIZE_CLASSES];
+	bool size_class_off;
+	bool hot_mapped;
 };
 
 #ifdef CONFIG_ANDROID_BINDER_IPC_SELFTEST
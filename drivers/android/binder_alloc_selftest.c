@@ -299,7 +299,15 @@ void binder_selftest_alloc(struct binder_alloc *alloc)
 	if (!binder_selftest_run || !alloc->vma)
 		goto done;
 	pr_info("STARTED\n");
+	/* the offsets below need exact sizes and pages mapped on demand */
+	mutex_lock(&alloc->mutex);
+	alloc->size_class_off = true;
+	alloc->hot_mapped = true;
+	mutex_unlock(&alloc->mutex);
 	binder_selftest_alloc_offset(alloc, end_offset, 0);
+	mutex_lock(&alloc->mutex);
+	alloc->size_class_off = false;
+	mutex_unlock(&alloc->mutex);
 	binder_selftest_run = false;
 	if (binder_selftest_failures > 0)
 		pr_info("%d tests FAILED\n", binder_selftest_failures);
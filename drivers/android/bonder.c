@@ -652,6 +652,9 @@ struct binder_transaction {
 	struct binder_priority	priority;
 	struct binder_priority	saved_priority;
 	bool    set_priority_called;
+	/* schedtune boost group of a sync client and the one it replaced */
+	int	stune_group;
+	int	saved_stune_group;
 	kuid_t	sender_euid;
 	binder_uintptr_t security_ctx;
 	/**
@@ -1251,6 +1254,7 @@ static void binder_transaction_priority(struct task_struct *task,
 	t->set_priority_called = true;
 	t->saved_priority.sched_policy = task->policy;
 	t->saved_priority.prio = task->normal_prio;
+	t->saved_stune_group = schedtune_lend_group(task, t->stune_group);
 
 	if (!inherit_rt && is_rt_policy(desired_prio.sched_policy)) {
 		desired_prio.prio = NICE_TO_PRIO(0);
@@ -3214,6 +3218,13 @@ static void binder_transaction(struct binder_proc *proc,
 		/* Otherwise, fall back to the default priority */
 		t->priority = target_proc->default_priority;
 	}
+	/*
+	 * The serving thread runs in the boost group of a client that waits
+	 * for the reply, so a top-app call is not served on a little or
+	 * isolated cpu.
+	 */
+	if (!(t->flags & TF_ONE_WAY))
+		t->stune_group = schedtune_task_group(current);
 
 	if (target_node && target_node->txn_security_ctx) {
 		u32 secid;
@@ -3525,6 +3536,7 @@ static void binder_transaction(struct binder_proc *proc,
 		binder_inner_proc_unlock(target_proc);
 		wake_up_interruptible_sync(&target_thread->wait);
 		binder_restore_priority(current, in_reply_to->saved_priority);
+		schedtune_return_group(current, in_reply_to->saved_stune_group);
 		binder_free_transaction(in_reply_to);
 	} else if (!(t->flags & TF_ONE_WAY)) {
 		BUG_ON(t->buffer->async_transaction != 0);
@@ -3634,6 +3646,7 @@ err_invalid_target_handle:
 	BUG_ON(thread->return_error.cmd != BR_OK);
 	if (in_reply_to) {
 		binder_restore_priority(current, in_reply_to->saved_priority);
+		schedtune_return_group(current, in_reply_to->saved_stune_group);
 		thread->return_error.cmd = BR_TRANSACTION_COMPLETE;
 		binder_enqueue_thread_work(thread, &thread->return_error.work);
 		binder_send_failed_reply(in_reply_to, return_error);
@@ -4221,6 +4234,7 @@ retry:
 						 binder_stop_on_user_error < 2);
 		}
 		binder_restore_priority(current, proc->default_priority);
+		schedtune_return_group(current, 0);
 	}
 
 	if (non_block) {
@@ -0,0 +1,148 @@
+/*
+ * Content deduplication for zram
+ *
+ * This code is released using a dual license strategy: BSD/GPL
+ * You can choose the licence that better fits your requirements.
+ *
+ * Released under the terms of 3-clause BSD License
+ * Released under the terms of GNU General Public License Version 2.0
+ *
+ */
+
+#include <linux/jhash.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+
+#include "zram_drv.h"
+
+/*
+ * The index is keyed by a hash of the *compressed* data. The compressors
+ * are deterministic, so two pages are identical exactly when their
+ * compressed forms are, and a candidate is confirmed by comparing the
+ * zsmalloc object against the stream buffer. Nothing has to be
+ * decompressed, and no second copy of the page is needed.
+ */
+u32 zram_dedup_checksum(const void *mem, unsigned int len)
+{
+	return jhash(mem, len, 0);
+}
+
+static bool zram_dedup_match(struct zram *zram, struct zram_entry *entry,
+			     const void *mem)
+{
+	void *obj;
+	bool match;
+
+	obj = zs_map_object(zram->mem_pool, entry->handle, ZS_MM_RO);
+	match = !memcmp(obj, mem, entry->len);
+	zs_unmap_object(zram->mem_pool, entry->handle);
+
+	return match;
+}
+
+/*
+ * Look up an object with the same contents as @mem and take a reference
+ * to it. Called with the compression stream held, so it must not sleep.
+ */
+struct zram_entry *zram_dedup_find(struct zram *zram, const void *mem,
+				   unsigned int len, u32 checksum)
+{
+	struct rb_node *node, *first = NULL;
+	struct zram_entry *entry;
+
+	spin_lock(&zram->dedup_lock);
+	/* find the leftmost entry with this checksum... */
+	node = zram->dedup_root.rb_node;
+	while (node) {
+		entry = rb_entry(node, struct zram_entry, rb_node);
+		if (checksum <= entry->checksum) {
+			if (checksum == entry->checksum)
+				first = node;
+			node = node->rb_left;
+		} else {
+			node = node->rb_right;
+		}
+	}
+
+	/* ...and walk all collisions from there */
+	for (node = first; node; node = rb_next(node)) {
+		entry = rb_entry(node, struct zram_entry, rb_node);
+		if (entry->checksum != checksum)
+			break;
+		if (entry->len == len && zram_dedup_match(zram, entry, mem)) {
+			entry->refcount++;
+			spin_unlock(&zram->dedup_lock);
+			return entry;
+		}
+	}
+	spin_unlock(&zram->dedup_lock);
+
+	return NULL;
+}
+
+/*
+ * Make a freshly stored object findable. On failure the caller keeps the
+ * plain handle, the page is then just not shared.
+ */
+struct zram_entry *zram_dedup_insert(struct zram *zram, unsigned long handle,
+				     unsigned int len, u32 checksum)
+{
+	struct rb_node **link, *parent = NULL;
+	struct zram_entry *entry, *cur;
+
+	entry = kmalloc(sizeof(*entry), GFP_NOIO | __GFP_NOWARN |
+			__GFP_NORETRY);
+	if (!entry)
+		return NULL;
+
+	entry->checksum = checksum;
+	entry->len = len;
+	entry->refcount = 1;
+	entry->handle = handle;
+
+	spin_lock(&zram->dedup_lock);
+	link = &zram->dedup_root.rb_node;
+	while (*link) {
+		parent = *link;
+		cur = rb_entry(parent, struct zram_entry, rb_node);
+		if (checksum < cur->checksum)
+			link = &parent->rb_left;
+		else
+			link = &parent->rb_right;
+	}
+	rb_link_node(&entry->rb_node, parent, link);
+	rb_insert_color(&entry->rb_node, &zram->dedup_root);
+	spin_unlock(&zram->dedup_lock);
+
+	atomic64_add(sizeof(*entry), &zram->stats.meta_data_size);
+
+	return entry;
+}
+
+/*
+ * Drop one reference. Returns true if it was the last one, the object
+ * is then freed.
+ */
+bool zram_dedup_put(struct zram *zram, struct zram_entry *entry)
+{
+	spin_lock(&zram->dedup_lock);
+	if (--entry->refcount) {
+		spin_unlock(&zram->dedup_lock);
+		return false;
+	}
+	rb_erase(&entry->rb_node, &zram->dedup_root);
+	spin_unlock(&zram->dedup_lock);
+
+	zs_free(zram->mem_pool, entry->handle);
+	kfree(entry);
+	atomic64_sub(sizeof(*entry), &zram->stats.meta_data_size);
+
+	return true;
+}
+
+void zram_dedup_init(struct zram *zram)
+{
+	spin_lock_init(&zram->dedup_lock);
+	zram->dedup_root = RB_ROOT;
+}
@@ -0,0 +1,62 @@
+/*
+ * Content deduplication for zram
+ *
+ * This code is released using a dual license strategy: BSD/GPL
+ * You can choose the licence that better fits your requirements.
+ *
+ * Released under the terms of 3-clause BSD License
+ * Released under the terms of GNU General Public License Version 2.0
+ *
+ */
+
+#ifndef _ZRAM_DEDUP_H_
+#define _ZRAM_DEDUP_H_
+
+#include <linux/rbtree.h>
+
+struct zram;
+
+/*
+ * A compressed object shared by every slot that stores the same data. A
+ * slot with ZRAM_DEDUP set keeps a pointer to its entry in the handle
+ * field of its table entry.
+ */
+struct zram_entry {
+	struct rb_node rb_node;
+	u32 checksum;
+	unsigned int len;
+	unsigned int refcount;
+	unsigned long handle;
+};
+
+#ifdef CONFIG_ZRAM_DEDUP
+u32 zram_dedup_checksum(const void *mem, unsigned int len);
+struct zram_entry *zram_dedup_find(struct zram *zram, const void *mem,
+				   unsigned int len, u32 checksum);
+struct zram_entry *zram_dedup_insert(struct zram *zram, unsigned long handle,
+				     unsigned int len, u32 checksum);
+bool zram_dedup_put(struct zram *zram, struct zram_entry *entry);
+void zram_dedup_init(struct zram *zram);
+#else
+static inline u32 zram_dedup_checksum(const void *mem, unsigned int len)
+{
+	return 0;
+}
+static inline struct zram_entry *zram_dedup_find(struct zram *zram,
+		const void *mem, unsigned int len, u32 checksum)
+{
+	return NULL;
+}
+static inline struct zram_entry *zram_dedup_insert(struct zram *zram,
+		unsigned long handle, unsigned int len, u32 checksum)
+{
+	return NULL;
+}
+static inline bool zram_dedup_put(struct zram *zram, struct zram_entry *entry)
+{
+	return false;
+}
+static inline void zram_dedup_init(struct zram *zram) {}
+#endif
+
+#endif /* _ZRAM_DEDUP_H_ */
@@ -33,6 +33,8 @@
 #include <linux/sysfs.h>
 #include <linux/debugfs.h>
 #include <linux/cpuhotplug.h>
+#include <linux/completion.h>
+#include <linux/workqueue.h>
 
 #include "zram_drv.h"
 
@@ -91,6 +93,12 @@ static void zram_set_handle(struct zram *zram, u32 index, unsigned long handle)
 	zram->table[index].handle = handle;
 }
 
+static void zram_set_entry(struct zram *zram, u32 index,
+			struct zram_entry *entry)
+{
+	zram->table[index].handle = (unsigned long)entry;
+}
+
 /* flag operations require table entry bit_spin_lock() being held */
 static bool zram_test_flag(struct zram *zram, u32 index,
 			enum zram_pageflags flag)
@@ -121,6 +129,16 @@ static unsigned long zram_get_element(struct zram *zram, u32 index)
 	return zram->table[index].element;
 }
 
+/* zsmalloc handle of the slot's object, shared or not */
+static unsigned long zram_get_obj_handle(struct zram *zram, u32 index)
+{
+	unsigned long handle = zram_get_handle(zram, index);
+
+	if (handle && zram_test_flag(zram, index, ZRAM_DEDUP))
+		handle = ((struct zram_entry *)handle)->handle;
+	return handle;
+}
+
 static size_t zram_get_obj_size(struct zram *zram, u32 index)
 {
 	return zram->table[index].flags & (BIT(ZRAM_FLAG_SHIFT) - 1);
@@ -284,6 +302,21 @@ static ssize_t mem_used_max_store(struct device *dev,
 	return len;
 }
 
+/* whether the slot was last accessed before @cutoff, 0 matches any slot */
+static bool zram_idle_since(struct zram *zram, u32 index, ktime_t cutoff)
+{
+#ifdef CONFIG_ZRAM_MEMORY_TRACKING
+	return !cutoff || ktime_before(zram->table[index].ac_time, cutoff);
+#else
+	return true;
+#endif
+}
+
+/*
+ * "all" marks every slot idle. With CONFIG_ZRAM_MEMORY_TRACKING a number
+ * of seconds marks only the slots not accessed for that long, so the cold
+ * end can be written back while recently used pages stay in memory.
+ */
 static ssize_t idle_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t len)
 {
@@ -292,6 +325,7 @@ static ssize_t idle_store(struct device *dev,
 	int index;
 	char mode_buf[8];
 	ssize_t sz;
+	ktime_t cutoff = 0;
 
 	sz = strscpy(mode_buf, buf, sizeof(mode_buf));
 	if (sz <= 0)
@@ -301,8 +335,18 @@ static ssize_t idle_store(struct device *dev,
 	if (mode_buf[sz - 1] == '\n')
 		mode_buf[sz - 1] = 0x00;
 
-	if (strcmp(mode_buf, "all"))
+	if (strcmp(mode_buf, "all")) {
+#ifdef CONFIG_ZRAM_MEMORY_TRACKING
+		u64 age_sec;
+
+		if (kstrtoull(mode_buf, 10, &age_sec) || !age_sec)
+			return -EINVAL;
+		cutoff = ktime_sub(ktime_get_boottime(),
+				   ns_to_ktime(age_sec * NSEC_PER_SEC));
+#else
 		return -EINVAL;
+#endif
+	}
 
 	down_read(&zram->init_lock);
 	if (!init_done(zram)) {
@@ -317,7 +361,8 @@ static ssize_t idle_store(struct device *dev,
 		 */
 		zram_slot_lock(zram, index);
 		if (zram_allocated(zram, index) &&
-				!zram_test_flag(zram, index, ZRAM_UNDER_WB))
+				!zram_test_flag(zram, index, ZRAM_UNDER_WB) &&
+				zram_idle_since(zram, index, cutoff))
 			zram_set_flag(zram, index, ZRAM_IDLE);
 		zram_slot_unlock(zram, index);
 	}
@@ -613,18 +658,133 @@ static int read_from_bdev_async(struct zram *zram, struct bio_vec *bvec,
 #define HUGE_WRITEBACK 1
 #define IDLE_WRITEBACK 2
 
+/*
+ * Pages are written back in batches. Blocks handed out one after another
+ * are mostly adjacent, so a batch goes out as a few large bios under one
+ * plug instead of a synchronous bio per page, which is what eMMC and UFS
+ * need to get anywhere near their sequential write speed.
+ */
+#define ZRAM_WB_BATCH	32
+
+struct zram_wb_ctl {
+	struct page *page[ZRAM_WB_BATCH];
+	u32 index[ZRAM_WB_BATCH];
+	unsigned long blk_idx[ZRAM_WB_BATCH];
+	bool failed[ZRAM_WB_BATCH];
+	int nr;
+	atomic_t pending;
+	struct completion done;
+};
+
+static void zram_wb_end_io(struct bio *bio)
+{
+	struct zram_wb_ctl *wb = bio->bi_private;
+	struct bio_vec *bvec;
+	int i;
+
+	if (bio->bi_status)
+		bio_for_each_segment_all(bvec, bio, i)
+			wb->failed[page_private(bvec->bv_page)] = true;
+
+	if (atomic_dec_and_test(&wb->pending))
+		complete(&wb->done);
+	bio_put(bio);
+}
+
+static void zram_wb_submit(struct zram *zram, struct zram_wb_ctl *wb)
+{
+	struct blk_plug plug;
+	struct bio *bio = NULL;
+	int i;
+
+	atomic_set(&wb->pending, 1);
+	init_completion(&wb->done);
+
+	blk_start_plug(&plug);
+	for (i = 0; i < wb->nr; i++) {
+		wb->failed[i] = false;
+		if (bio && wb->blk_idx[i] == wb->blk_idx[i - 1] + 1 &&
+		    bio_add_page(bio, wb->page[i], PAGE_SIZE, 0))
+			continue;
+
+		if (bio) {
+			atomic_inc(&wb->pending);
+			submit_bio(bio);
+		}
+
+		bio = bio_alloc(GFP_KERNEL, wb->nr - i);
+		bio_set_dev(bio, zram->bdev);
+		bio->bi_iter.bi_sector = wb->blk_idx[i] * (PAGE_SIZE >> 9);
+		bio->bi_opf = REQ_OP_WRITE | REQ_SYNC;
+		bio->bi_end_io = zram_wb_end_io;
+		bio->bi_private = wb;
+		bio_add_page(bio, wb->page[i], PAGE_SIZE, 0);
+	}
+	if (bio) {
+		atomic_inc(&wb->pending);
+		submit_bio(bio);
+	}
+	blk_finish_plug(&plug);
+
+	if (!atomic_dec_and_test(&wb->pending))
+		wait_for_completion(&wb->done);
+}
+
+static void zram_wb_finish(struct zram *zram, struct zram_wb_ctl *wb)
+{
+	int i;
+
+	for (i = 0; i < wb->nr; i++) {
+		u32 index = wb->index[i];
+
+		zram_slot_lock(zram, index);
+		if (wb->failed[i])
+			goto fail;
+
+		atomic64_inc(&zram->stats.bd_writes);
+		/*
+		 * We released zram_slot_lock so need to check if the slot was
+		 * changed. If there is freeing for the slot, we can catch it
+		 * easily by zram_allocated.
+		 * A subtle case is the slot is freed/reallocated/marked as
+		 * ZRAM_IDLE again. To close the race, idle_store doesn't
+		 * mark ZRAM_IDLE once it found the slot was ZRAM_UNDER_WB.
+		 * Thus, we could close the race by checking ZRAM_IDLE bit.
+		 */
+		if (!zram_allocated(zram, index) ||
+			  !zram_test_flag(zram, index, ZRAM_IDLE))
+			goto fail;
+
+		zram_free_page(zram, index);
+		zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+		zram_set_flag(zram, index, ZRAM_WB);
+		zram_set_element(zram, index, wb->blk_idx[i]);
+		atomic64_inc(&zram->stats.pages_stored);
+		spin_lock(&zram->wb_limit_lock);
+		if (zram->wb_limit_enable && zram->bd_wb_limit > 0)
+			zram->bd_wb_limit -=  1UL << (PAGE_SHIFT - 12);
+		spin_unlock(&zram->wb_limit_lock);
+		zram_slot_unlock(zram, index);
+		continue;
+fail:
+		zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+		zram_clear_flag(zram, index, ZRAM_IDLE);
+		zram_slot_unlock(zram, index);
+		free_block_bdev(zram, wb->blk_idx[i]);
+	}
+	wb->nr = 0;
+}
+
 static ssize_t writeback_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t len)
 {
 	struct zram *zram = dev_to_zram(dev);
 	unsigned long nr_pages = zram->disksize >> PAGE_SHIFT;
 	unsigned long index;
-	struct bio bio;
-	struct bio_vec bio_vec;
-	struct page *page;
+	struct zram_wb_ctl *wb;
 	ssize_t ret, sz;
 	char mode_buf[8];
-	int mode = -1;
+	int i, mode = -1;
 	unsigned long blk_idx = 0;
 
 	sz = strscpy(mode_buf, buf, sizeof(mode_buf));
@@ -654,21 +814,33 @@ static ssize_t writeback_store(struct device *dev,
 		goto release_init_lock;
 	}
 
-	page = alloc_page(GFP_KERNEL);
-	if (!page) {
+	wb = kzalloc(sizeof(*wb), GFP_KERNEL);
+	if (!wb) {
 		ret = -ENOMEM;
 		goto release_init_lock;
 	}
 
+	for (i = 0; i < ZRAM_WB_BATCH; i++) {
+		wb->page[i] = alloc_page(GFP_KERNEL);
+		if (!wb->page[i]) {
+			ret = -ENOMEM;
+			goto free_wb;
+		}
+		/* lets zram_wb_end_io() find the batch slot of a page */
+		set_page_private(wb->page[i], i);
+	}
+
 	for (index = 0; index < nr_pages; index++) {
 		struct bio_vec bvec;
 
-		bvec.bv_page = page;
+		bvec.bv_page = wb->page[wb->nr];
 		bvec.bv_len = PAGE_SIZE;
 		bvec.bv_offset = 0;
 
+		/* the pages of the batch are not accounted yet */
 		spin_lock(&zram->wb_limit_lock);
-		if (zram->wb_limit_enable && !zram->bd_wb_limit) {
+		if (zram->wb_limit_enable && zram->bd_wb_limit <
+		    ((u64)(wb->nr + 1) << (PAGE_SHIFT - 12))) {
 			spin_unlock(&zram->wb_limit_lock);
 			ret = -EIO;
 			break;
@@ -714,62 +886,32 @@ static ssize_t writeback_store(struct device *dev,
 			continue;
 		}
 
-		bio_init(&bio, &bio_vec, 1);
-		bio_set_dev(&bio, zram->bdev);
-		bio.bi_iter.bi_sector = blk_idx * (PAGE_SIZE >> 9);
-		bio.bi_opf = REQ_OP_WRITE | REQ_SYNC;
-
-		bio_add_page(&bio, bvec.bv_page, bvec.bv_len,
-				bvec.bv_offset);
-		/*
-		 * XXX: A single page IO would be inefficient for write
-		 * but it would be not bad as starter.
-		 */
-		ret = submit_bio_wait(&bio);
-		if (ret) {
-			zram_slot_lock(zram, index);
-			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
-			zram_clear_flag(zram, index, ZRAM_IDLE);
-			zram_slot_unlock(zram, index);
-			continue;
-		}
-
-		atomic64_inc(&zram->stats.bd_writes);
-		/*
-		 * We released zram_slot_lock so need to check if the slot was
-		 * changed. If there is freeing for the slot, we can catch it
-		 * easily by zram_allocated.
-		 * A subtle case is the slot is freed/reallocated/marked as
-		 * ZRAM_IDLE again. To close the race, idle_store doesn't
-		 * mark ZRAM_IDLE once it found the slot was ZRAM_UNDER_WB.
-		 * Thus, we could close the race by checking ZRAM_IDLE bit.
-		 */
-		zram_slot_lock(zram, index);
-		if (!zram_allocated(zram, index) ||
-			  !zram_test_flag(zram, index, ZRAM_IDLE)) {
-			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
-			zram_clear_flag(zram, index, ZRAM_IDLE);
-			goto next;
-		}
-
-		zram_free_page(zram, index);
-		zram_clear_flag(zram, index, ZRAM_UNDER_WB);
-		zram_set_flag(zram, index, ZRAM_WB);
-		zram_set_element(zram, index, blk_idx);
+		wb->index[wb->nr] = index;
+		wb->blk_idx[wb->nr] = blk_idx;
 		blk_idx = 0;
-		atomic64_inc(&zram->stats.pages_stored);
-		spin_lock(&zram->wb_limit_lock);
-		if (zram->wb_limit_enable && zram->bd_wb_limit > 0)
-			zram->bd_wb_limit -=  1UL << (PAGE_SHIFT - 12);
-		spin_unlock(&zram->wb_limit_lock);
+		if (++wb->nr == ZRAM_WB_BATCH) {
+			zram_wb_submit(zram, wb);
+			zram_wb_finish(zram, wb);
+		}
+		continue;
 next:
 		zram_slot_unlock(zram, index);
 	}
 
+	if (wb->nr) {
+		zram_wb_submit(zram, wb);
+		zram_wb_finish(zram, wb);
+	}
+
 	if (blk_idx)
 		free_block_bdev(zram, blk_idx);
 	ret = len;
-	__free_page(page);
+free_wb:
+	for (i = 0; i < ZRAM_WB_BATCH && wb->page[i]; i++) {
+		set_page_private(wb->page[i], 0);
+		__free_page(wb->page[i]);
+	}
+	kfree(wb);
 release_init_lock:
 	up_read(&zram->init_lock);
 
@@ -975,6 +1117,63 @@ static ssize_t max_comp_streams_store(struct device *dev,
 	return len;
 }
 
+static ssize_t async_write_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n", READ_ONCE(zram->async_write));
+}
+
+static ssize_t async_write_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	bool val;
+
+	if (kstrtobool(buf, &val))
+		return -EINVAL;
+
+	WRITE_ONCE(zram->async_write, val);
+	return len;
+}
+
+#ifdef CONFIG_ZRAM_DEDUP
+static ssize_t use_dedup_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	bool val;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	val = zram->use_dedup;
+	up_read(&zram->init_lock);
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n", val);
+}
+
+static ssize_t use_dedup_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	bool val;
+	struct zram *zram = dev_to_zram(dev);
+
+	if (kstrtobool(buf, &val))
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change dedup usage for initialized device\n");
+		return -EBUSY;
+	}
+	zram->use_dedup = val;
+	up_write(&zram->init_lock);
+
+	return len;
+}
+#endif
+
 static ssize_t comp_algorithm_show(struct device *dev,
 		struct device_attribute *attr, char *buf)
 {
@@ -1106,6 +1305,24 @@ static ssize_t bd_stat_show(struct device *dev,
 }
 #endif
 
+#ifdef CONFIG_ZRAM_DEDUP
+static ssize_t dedup_stat_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	ssize_t ret;
+
+	down_read(&zram->init_lock);
+	ret = scnprintf(buf, PAGE_SIZE,
+		"%8llu %8llu\n",
+			(u64)atomic64_read(&zram->stats.dup_data_size),
+			(u64)atomic64_read(&zram->stats.meta_data_size));
+	up_read(&zram->init_lock);
+
+	return ret;
+}
+#endif
+
 static ssize_t debug_stat_show(struct device *dev,
 		struct device_attribute *attr, char *buf)
 {
@@ -1129,6 +1346,9 @@ static DEVICE_ATTR_RO(mm_stat);
 #ifdef CONFIG_ZRAM_WRITEBACK
 static DEVICE_ATTR_RO(bd_stat);
 #endif
+#ifdef CONFIG_ZRAM_DEDUP
+static DEVICE_ATTR_RO(dedup_stat);
+#endif
 static DEVICE_ATTR_RO(debug_stat);
 
 static void zram_meta_free(struct zram *zram, u64 disksize)
@@ -1204,7 +1424,18 @@ static void zram_free_page(struct zram *zram, size_t index)
 	if (!handle)
 		return;
 
-	zs_free(zram->mem_pool, handle);
+	if (zram_test_flag(zram, index, ZRAM_DEDUP)) {
+		zram_clear_flag(zram, index, ZRAM_DEDUP);
+		if (!zram_dedup_put(zram, (struct zram_entry *)handle)) {
+#ifdef CONFIG_ZRAM_DEDUP
+			atomic64_sub(zram_get_obj_size(zram, index),
+				     &zram->stats.dup_data_size);
+#endif
+			goto out;
+		}
+	} else {
+		zs_free(zram->mem_pool, handle);
+	}
 
 	atomic64_sub(zram_get_obj_size(zram, index),
 			&zram->stats.compr_data_size);
@@ -1238,7 +1469,7 @@ static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
 				bio, partial_io);
 	}
 
-	handle = zram_get_handle(zram, index);
+	handle = zram_get_obj_handle(zram, index);
 	if (!handle || zram_test_flag(zram, index, ZRAM_SAME)) {
 		unsigned long value;
 		void *mem;
@@ -1322,6 +1553,8 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 	struct page *page = bvec->bv_page;
 	unsigned long element = 0;
 	enum zram_pageflags flags = 0;
+	struct zram_entry *entry = NULL;
+	u32 checksum = 0;
 
 	mem = kmap_atomic(page);
 	if (page_same_filled(mem, &element)) {
@@ -1348,6 +1581,27 @@ compress_again:
 
 	if (comp_len >= huge_class_size)
 		comp_len = PAGE_SIZE;
+
+	if (zram_dedup_enabled(zram)) {
+		src = zstrm->buffer;
+		if (comp_len == PAGE_SIZE)
+			src = kmap_atomic(page);
+		checksum = zram_dedup_checksum(src, comp_len);
+		entry = zram_dedup_find(zram, src, comp_len, checksum);
+		if (comp_len == PAGE_SIZE)
+			kunmap_atomic(src);
+		if (entry) {
+			zcomp_stream_put(zram->comp);
+			/* allocated by the slow path, not needed any more */
+			if (handle)
+				zs_free(zram->mem_pool, handle);
+#ifdef CONFIG_ZRAM_DEDUP
+			atomic64_add(comp_len, &zram->stats.dup_data_size);
+#endif
+			goto out;
+		}
+	}
+
 	/*
 	 * handle allocation has 2 paths:
 	 * a) fast path is executed with preemption disabled (for
@@ -1399,6 +1653,9 @@ compress_again:
 	zcomp_stream_put(zram->comp);
 	zs_unmap_object(zram->mem_pool, handle);
 	atomic64_add(comp_len, &zram->stats.compr_data_size);
+
+	if (zram_dedup_enabled(zram))
+		entry = zram_dedup_insert(zram, handle, comp_len, checksum);
 out:
 	/*
 	 * Free memory associated with this sector
@@ -1415,6 +1672,10 @@ out:
 	if (flags) {
 		zram_set_flag(zram, index, flags);
 		zram_set_element(zram, index, element);
+	} else if (entry) {
+		zram_set_flag(zram, index, ZRAM_DEDUP);
+		zram_set_entry(zram, index, entry);
+		zram_set_obj_size(zram, index, comp_len);
 	}  else {
 		zram_set_handle(zram, index, handle);
 		zram_set_obj_size(zram, index, comp_len);
@@ -1595,6 +1856,51 @@ out:
 /*
  * Handler function for all zram I/O requests.
  */
+/*
+ * With async_write set, swap-out falls back from rw_page to bios, and their
+ * compression is handed to an unbound workqueue. The reclaiming task gets
+ * back to work at once, and the pages are compressed on the cpus in
+ * /sys/devices/virtual/workqueue/zram_write/cpumask, which userspace can
+ * point at the little cluster. Each bio is its own work item so the writes
+ * spread over all the allowed cpus, every one with its own zcomp stream.
+ */
+static struct workqueue_struct *zram_write_wq;
+
+struct zram_write_work {
+	struct work_struct work;
+	struct zram *zram;
+	struct bio *bio;
+};
+
+static void zram_write_workfn(struct work_struct *work)
+{
+	struct zram_write_work *zw = container_of(work, struct zram_write_work,
+						  work);
+
+	__zram_make_request(zw->zram, zw->bio);
+	kfree(zw);
+}
+
+static bool zram_queue_write(struct zram *zram, struct bio *bio)
+{
+	struct zram_write_work *zw;
+
+	if (!READ_ONCE(zram->async_write) || bio_op(bio) != REQ_OP_WRITE)
+		return false;
+
+	/* no memory to spare, compress in place rather than wait for it */
+	zw = kmalloc(sizeof(*zw), GFP_NOWAIT | __GFP_NOWARN);
+	if (!zw)
+		return false;
+
+	INIT_WORK(&zw->work, zram_write_workfn);
+	zw->zram = zram;
+	zw->bio = bio;
+	queue_work(zram_write_wq, &zw->work);
+
+	return true;
+}
+
 static blk_qc_t zram_make_request(struct request_queue *queue, struct bio *bio)
 {
 	struct zram *zram = queue->queuedata;
@@ -1605,7 +1911,8 @@ static blk_qc_t zram_make_request(struct request_queue *queue, struct bio *bio)
 		goto error;
 	}
 
-	__zram_make_request(zram, bio);
+	if (!zram_queue_write(zram, bio))
+		__zram_make_request(zram, bio);
 	return BLK_QC_T_NONE;
 
 error:
@@ -1642,6 +1949,10 @@ static int zram_rw_page(struct block_device *bdev, sector_t sector,
 		return -ENOTSUPP;
 	zram = bdev->bd_disk->private_data;
 
+	/* let the caller resubmit it as a bio, see zram_queue_write() */
+	if (is_write && READ_ONCE(zram->async_write))
+		return -EOPNOTSUPP;
+
 	if (!valid_io_request(zram, sector, PAGE_SIZE)) {
 		atomic64_inc(&zram->stats.invalid_io);
 		ret = -EINVAL;
@@ -1703,6 +2014,7 @@ static void zram_reset_device(struct zram *zram)
 	part_stat_set_all(&zram->disk->part0, 0);
 
 	up_write(&zram->init_lock);
+	flush_workqueue(zram_write_wq);
 	/* I/O operation under all of CPU are done so let's free */
 	zram_meta_free(zram, disksize);
 	memset(&zram->stats, 0, sizeof(zram->stats));
@@ -1834,7 +2146,11 @@ static DEVICE_ATTR_WO(mem_limit);
 static DEVICE_ATTR_WO(mem_used_max);
 static DEVICE_ATTR_WO(idle);
 static DEVICE_ATTR_RW(max_comp_streams);
+static DEVICE_ATTR_RW(async_write);
 static DEVICE_ATTR_RW(comp_algorithm);
+#ifdef CONFIG_ZRAM_DEDUP
+static DEVICE_ATTR_RW(use_dedup);
+#endif
 #ifdef CONFIG_ZRAM_WRITEBACK
 static DEVICE_ATTR_RW(backing_dev);
 static DEVICE_ATTR_WO(writeback);
@@ -1851,7 +2167,11 @@ static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_mem_used_max.attr,
 	&dev_attr_idle.attr,
 	&dev_attr_max_comp_streams.attr,
+	&dev_attr_async_write.attr,
 	&dev_attr_comp_algorithm.attr,
+#ifdef CONFIG_ZRAM_DEDUP
+	&dev_attr_use_dedup.attr,
+#endif
 #ifdef CONFIG_ZRAM_WRITEBACK
 	&dev_attr_backing_dev.attr,
 	&dev_attr_writeback.attr,
@@ -1862,6 +2182,9 @@ static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_mm_stat.attr,
 #ifdef CONFIG_ZRAM_WRITEBACK
 	&dev_attr_bd_stat.attr,
+#endif
+#ifdef CONFIG_ZRAM_DEDUP
+	&dev_attr_dedup_stat.attr,
 #endif
 	&dev_attr_debug_stat.attr,
 	NULL,
@@ -1951,6 +2274,7 @@ static int zram_add(void)
 #ifdef CONFIG_ZRAM_WRITEBACK
 	spin_lock_init(&zram->wb_limit_lock);
 #endif
+	zram_dedup_init(zram);
 	queue = blk_alloc_queue(GFP_KERNEL);
 	if (!queue) {
 		pr_err("Error allocating disk queue for device %d\n",
@@ -2145,6 +2469,7 @@ static void destroy_devices(void)
 	idr_destroy(&zram_index_idr);
 	unregister_blkdev(zram_major, "zram");
 	cpuhp_remove_multi_state(CPUHP_ZCOMP_PREPARE);
+	destroy_workqueue(zram_write_wq);
 }
 
 static int __init zram_init(void)
@@ -2156,9 +2481,17 @@ static int __init zram_init(void)
 	if (ret < 0)
 		return ret;
 
+	zram_write_wq = alloc_workqueue("zram_write", WQ_UNBOUND |
+					WQ_MEM_RECLAIM | WQ_SYSFS, 0);
+	if (!zram_write_wq) {
+		cpuhp_remove_multi_state(CPUHP_ZCOMP_PREPARE);
+		return -ENOMEM;
+	}
+
 	ret = class_register(&zram_control_class);
 	if (ret) {
 		pr_err("Unable to register zram-control class\n");
+		destroy_workqueue(zram_write_wq);
 		cpuhp_remove_multi_state(CPUHP_ZCOMP_PREPARE);
 		return ret;
 	}
@@ -2168,6 +2501,7 @@ static int __init zram_init(void)
 	if (zram_major <= 0) {
 		pr_err("Unable to get major number\n");
 		class_unregister(&zram_control_class);
+		destroy_workqueue(zram_write_wq);
 		cpuhp_remove_multi_state(CPUHP_ZCOMP_PREPARE);
 		return -EBUSY;
 	}
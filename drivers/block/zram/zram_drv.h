@@ -20,6 +20,7 @@
 #include <linux/crypto.h>
 
 #include "zcomp.h"
+#include "zram_dedup.h"
 
 #define SECTOR_SHIFT		9
 #define SECTORS_PER_PAGE_SHIFT	(PAGE_SHIFT - SECTOR_SHIFT)
@@ -51,6 +52,7 @@ enum zram_pageflags {
 	ZRAM_UNDER_WB,	/* page is under writeback */
 	ZRAM_HUGE,	/* Incompressible page */
 	ZRAM_IDLE,	/* not accessed page since last idle marking */
+	ZRAM_DEDUP,	/* handle points to a shared struct zram_entry */
 
 	__NR_ZRAM_PAGEFLAGS,
 };
@@ -88,6 +90,10 @@ struct zram_stats {
 	atomic64_t bd_reads;		/* no. of reads from backing device */
 	atomic64_t bd_writes;		/* no. of writes from backing device */
 #endif
+#ifdef CONFIG_ZRAM_DEDUP
+	atomic64_t dup_data_size;	/* compressed bytes saved by sharing */
+	atomic64_t meta_data_size;	/* bytes of struct zram_entry */
+#endif
 };
 
 struct zram {
@@ -113,6 +119,8 @@ struct zram {
 	 * zram is claimed so open request will be failed
 	 */
 	bool claim; /* Protected by bdev->bd_mutex */
+	/* compress bio writes on zram_write_wq instead of the caller's cpu */
+	bool async_write;
 	struct file *backing_dev;
 #ifdef CONFIG_ZRAM_WRITEBACK
 	spinlock_t wb_limit_lock;
@@ -126,5 +134,19 @@ struct zram {
 #ifdef CONFIG_ZRAM_MEMORY_TRACKING
 	struct dentry *debugfs_dir;
 #endif
+#ifdef CONFIG_ZRAM_DEDUP
+	bool use_dedup;
+	spinlock_t dedup_lock;
+	struct rb_root dedup_root;
+#endif
 };
+
+static inline bool zram_dedup_enabled(struct zram *zram)
+{
+#ifdef CONFIG_ZRAM_DEDUP
+	return zram->use_dedup;
+#else
+	return false;
+#endif
+}
 #endif
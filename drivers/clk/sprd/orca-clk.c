@@ -291,7 +291,7 @@ static const struct sprd_clk_desc orca_apahb_gate_desc = {
 
 /* ap clocks */
 #define ORCA_MUX_FLAG	\
-	(CLK_GET_RATE_NOCACHE | CLK_SET_RATE_NO_REPARENT)
+	CLK_SET_RATE_NO_REPARENT
 
 static const char * const ap_axi_parents[] = { "ext-26m", "v3pll-64m",
 					       "v3pll-96m", "v3pll-128m",
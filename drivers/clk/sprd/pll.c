@@ -7,13 +7,22 @@
 
 #include <linux/delay.h>
 #include <linux/err.h>
+#include <linux/ktime.h>
 #include <linux/regmap.h>
+#include <linux/sched.h>
 #include <linux/slab.h>
 
 #include "pll.h"
 
 #define CLK_PLL_1M	1000000
 
+/*
+ * While a clock scene is applied, the plls it relocks skip their lock
+ * delay and only push out sprd_pll_lock_end, the scene waits once.
+ */
+static struct task_struct *sprd_pll_defer_owner;
+static ktime_t sprd_pll_lock_end;
+
 #define pindex(pll, member)		\
 	(pll->factors[member].shift / (8 * sizeof(pll->regs_num)))
 
@@ -144,7 +153,8 @@ static unsigned long _sprd_pll_recalc_rate(const struct sprd_pll *pll,
 
 static int _sprd_pll_set_rate(const struct sprd_pll *pll,
 			      unsigned long rate,
-			      unsigned long parent_rate)
+			      unsigned long parent_rate,
+			      bool wait)
 {
 	struct reg_cfg *cfg;
 	int ret = 0;
@@ -238,7 +248,7 @@ static int _sprd_pll_set_rate(const struct sprd_pll *pll,
 		}
 	}
 
-	if (!ret)
+	if (!ret && wait)
 		udelay(pll->udelay);
 
 	kfree(cfg);
@@ -258,8 +268,18 @@ static int sprd_pll_set_rate(struct clk_hw *hw,
 			     unsigned long parent_rate)
 {
 	struct sprd_pll *pll = hw_to_sprd_pll(hw);
+	bool defer = READ_ONCE(sprd_pll_defer_owner) == current;
+	ktime_t end;
+	int ret;
+
+	ret = _sprd_pll_set_rate(pll, rate, parent_rate, !defer);
+	if (!ret && defer) {
+		end = ktime_add_us(ktime_get(), pll->udelay);
+		if (ktime_after(end, sprd_pll_lock_end))
+			sprd_pll_lock_end = end;
+	}
 
-	return _sprd_pll_set_rate(pll, rate, parent_rate);
+	return ret;
 }
 
 static int sprd_pll_clk_prepare(struct clk_hw *hw)
@@ -284,3 +304,29 @@ const struct clk_ops sprd_pll_ops = {
 	.set_rate = sprd_pll_set_rate,
 };
 EXPORT_SYMBOL_GPL(sprd_pll_ops);
+
+/* wait until every pll the current scene has set is locked */
+void sprd_pll_wait_lock(void)
+{
+	s64 us;
+
+	if (sprd_pll_defer_owner != current)
+		return;
+
+	us = ktime_us_delta(sprd_pll_lock_end, ktime_get());
+	if (us > 0)
+		udelay(us);
+	sprd_pll_lock_end = 0;
+}
+
+/* callers serialize, only one task can defer at a time */
+void sprd_pll_defer_lock(bool defer)
+{
+	if (defer) {
+		sprd_pll_lock_end = 0;
+		WRITE_ONCE(sprd_pll_defer_owner, current);
+	} else {
+		sprd_pll_wait_lock();
+		WRITE_ONCE(sprd_pll_defer_owner, NULL);
+	}
+}
@@ -112,4 +112,7 @@ static inline struct sprd_pll *hw_to_sprd_pll(struct clk_hw *hw)
 
 extern const struct clk_ops sprd_pll_ops;
 
+void sprd_pll_defer_lock(bool defer);
+void sprd_pll_wait_lock(void);
+
 #endif /* _SPRD_PLL_H_ */
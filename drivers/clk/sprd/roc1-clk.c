@@ -460,7 +460,7 @@ static struct sprd_clk_desc roc1_g17_pll_desc = {
 
 /* ap clocks */
 #define ROC1_MUX_FLAG	\
-	(CLK_GET_RATE_NOCACHE | CLK_SET_RATE_NO_REPARENT)
+	CLK_SET_RATE_NO_REPARENT
 
 static const char * const ap_apb_parents[] = { "ext-26m", "twpll-64m",
 					       "twpll-96m", "twpll-128m" };
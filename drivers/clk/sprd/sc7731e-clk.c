@@ -23,7 +23,7 @@
 #include "pll.h"
 
 #define SC7731E_MUX_FLAG	\
-	(CLK_GET_RATE_NOCACHE | CLK_SET_RATE_NO_REPARENT)
+	CLK_SET_RATE_NO_REPARENT
 
 /* 0x402b0000 pmu apb, pll gates */
 static CLK_FIXED_FACTOR(fac_13m, "fac-13m", "ext-26m", 2, 1, 0);
@@ -314,7 +314,7 @@ static const struct sprd_clk_desc sc9832e_rpll_desc = {
 };
 
 #define SC9832E_MUX_FLAG	\
-	(CLK_GET_RATE_NOCACHE | CLK_SET_RATE_NO_REPARENT)
+	CLK_SET_RATE_NO_REPARENT
 
 /* 0x21500000 ap clocks */
 static const char * const ap_apb_parents[] = { "ext-26m", "twpll-64m",
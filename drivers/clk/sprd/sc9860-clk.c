@@ -383,7 +383,7 @@ static const struct sprd_clk_desc sc9860_pll_desc = {
 };
 
 #define SC9860_MUX_FLAG	\
-	(CLK_GET_RATE_NOCACHE | CLK_SET_RATE_NO_REPARENT)
+	CLK_SET_RATE_NO_REPARENT
 
 static const char * const ap_apb_parents[] = { "ext-26m", "twpll-64m",
 					       "twpll-96m", "twpll-128m" };
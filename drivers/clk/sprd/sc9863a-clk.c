@@ -330,7 +330,7 @@ static const struct sprd_clk_desc sc9863a_dpll_desc = {
 };
 
 #define SC9863A_MUX_FLAG	\
-	(CLK_GET_RATE_NOCACHE | CLK_SET_RATE_NO_REPARENT)
+	CLK_SET_RATE_NO_REPARENT
 
 /* ap clocks */
 static const char * const ap_apb_parents[] = { "ext-26m", "twpll-64m",
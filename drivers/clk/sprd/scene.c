@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: GPL-2.0
+//
+// Spreadtrum clock scenes
+//
+// Copyright (C) 2017 Spreadtrum, Inc.
+
+#include <linux/clk.h>
+#include <linux/clk/sprd.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+
+#include "pll.h"
+
+static DEFINE_MUTEX(sprd_clk_scene_lock);
+
+/**
+ * sprd_clk_scene_apply - apply a set of clock changes at once
+ * @ents:	changes in the order they are made
+ * @num:	number of entries
+ *
+ * Meant for dvfs transitions and subsystem power up, where a row of
+ * clk_set_parent()/clk_set_rate() calls used to pay the lock delay of
+ * every pll it touched. Plls set here don't wait for their lock, all
+ * of them are waited for once, before the next reparent and before
+ * returning, so no mux is switched onto a pll that is still relocking.
+ * Stops at the first failing change and returns its error.
+ */
+int sprd_clk_scene_apply(const struct sprd_clk_scene_ent *ents, int num)
+{
+	int i, ret = 0;
+
+	mutex_lock(&sprd_clk_scene_lock);
+	sprd_pll_defer_lock(true);
+
+	for (i = 0; i < num && !ret; i++) {
+		if (ents[i].parent) {
+			sprd_pll_wait_lock();
+			ret = clk_set_parent(ents[i].clk, ents[i].parent);
+		}
+		if (!ret && ents[i].rate)
+			ret = clk_set_rate(ents[i].clk, ents[i].rate);
+	}
+
+	sprd_pll_defer_lock(false);
+	mutex_unlock(&sprd_clk_scene_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(sprd_clk_scene_apply);
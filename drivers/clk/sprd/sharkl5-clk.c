@@ -588,7 +588,7 @@ static const struct sprd_clk_desc sharkl5_audcpahb_gate_desc = {
 };
 
 #define SHARKL5_MUX_FLAG	\
-	(CLK_GET_RATE_NOCACHE | CLK_SET_RATE_NO_REPARENT)
+	CLK_SET_RATE_NO_REPARENT
 
 static const char * const ap_apb_parents[] = { "ext-26m", "twpll-64m",
 					       "twpll-96m", "twpll-128m" };
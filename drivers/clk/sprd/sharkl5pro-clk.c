@@ -23,7 +23,7 @@
 #include "pll.h"
 
 #define SHARKL5PRO_MUX_FLAG	\
-	(CLK_GET_RATE_NOCACHE | CLK_SET_RATE_NO_REPARENT)
+	CLK_SET_RATE_NO_REPARENT
 
 /* pll gate clock */
 static SPRD_PLL_SC_GATE_CLK(isppll_gate, "isppll-gate", "ext-26m", 0x8c,
@@ -25,11 +25,34 @@
 #include <linux/slab.h>
 #include <linux/types.h>
 #include <linux/of_platform.h>
+#include <linux/sprd-cpufreq.h>
+#include <linux/workqueue.h>
 #include "sprd-cpufreqhw.h"
 
+/*
+ * Time bounded boost of one cluster. Requests come from atomic context,
+ * the dvfs ops sleep, so the bump is done from a high priority work and
+ * the governor request is put back by a delayed work once it expires.
+ * While active, every target request of the cluster is raised to the
+ * policy max.
+ */
+struct sprd_cpufreq_cluster_boost {
+	bool inited;
+	bool boosting;
+	unsigned int cpu;
+	unsigned int gov_freq;
+	unsigned long expires;
+	spinlock_t lock;
+	struct mutex work_lock;
+	struct work_struct work;
+	struct delayed_work decay;
+};
+
 static struct cpufreq_driver sprd_hardware_cpufreq_driver;
 static unsigned long boot_done_timestamp;
 static int boost_mode_flag = 1;
+static struct sprd_cpufreq_cluster_boost
+	cluster_boost[SPRD_CPUFREQ_MAX_CLUSTER];
 struct sprd_cpudvfs_device *plat_dev;
 /*
  * sprd_hardware_dvfs_device_register - register hw dvfs module
@@ -102,6 +125,115 @@ int sprd_hardware_cpufreq_set_boost(int state)
 	return 0;
 }
 
+static bool sprd_cpufreq_cluster_boosted(struct sprd_cpufreq_cluster_boost *b)
+{
+	unsigned long flags;
+	bool boosted;
+
+	spin_lock_irqsave(&b->lock, flags);
+	boosted = time_before(jiffies, b->expires);
+	spin_unlock_irqrestore(&b->lock, flags);
+
+	return boosted;
+}
+
+static void sprd_cpufreq_cluster_boost_work(struct work_struct *work)
+{
+	struct sprd_cpufreq_cluster_boost *b =
+		container_of(work, struct sprd_cpufreq_cluster_boost, work);
+	struct cpufreq_policy *policy;
+	unsigned long flags, expires;
+
+	policy = cpufreq_cpu_get(b->cpu);
+	if (!policy)
+		return;
+
+	mutex_lock(&b->work_lock);
+	b->boosting = true;
+	__cpufreq_driver_target(policy, policy->max, CPUFREQ_RELATION_H);
+	b->boosting = false;
+	mutex_unlock(&b->work_lock);
+
+	cpufreq_cpu_put(policy);
+
+	spin_lock_irqsave(&b->lock, flags);
+	expires = b->expires;
+	spin_unlock_irqrestore(&b->lock, flags);
+
+	mod_delayed_work(system_wq, &b->decay,
+			 time_after(expires, jiffies) ? expires - jiffies : 0);
+}
+
+static void sprd_cpufreq_cluster_decay_work(struct work_struct *work)
+{
+	struct sprd_cpufreq_cluster_boost *b =
+		container_of(to_delayed_work(work),
+			     struct sprd_cpufreq_cluster_boost, decay);
+	struct cpufreq_policy *policy;
+	unsigned long flags, expires;
+
+	/* extended in the meantime */
+	spin_lock_irqsave(&b->lock, flags);
+	expires = b->expires;
+	spin_unlock_irqrestore(&b->lock, flags);
+	if (time_before(jiffies, expires)) {
+		mod_delayed_work(system_wq, &b->decay, expires - jiffies);
+		return;
+	}
+
+	policy = cpufreq_cpu_get(b->cpu);
+	if (!policy)
+		return;
+
+	/* hand the cluster back to the last governor request */
+	mutex_lock(&b->work_lock);
+	if (b->gov_freq)
+		__cpufreq_driver_target(policy, b->gov_freq,
+					CPUFREQ_RELATION_L);
+	mutex_unlock(&b->work_lock);
+
+	cpufreq_cpu_put(policy);
+}
+
+/**
+ * sprd_hardware_cpufreq_boost_cluster - boost a cluster to its policy max
+ * @cluster: physical package id of the cluster
+ * @ms: how long the boost lasts, an active boost is only ever extended
+ *
+ * Callable from atomic context, e.g. input events or ipc arrivals. The
+ * frequency is raised right away, without waiting for the governor.
+ *
+ * Return: zero on success, -EINVAL for a cluster without a policy.
+ */
+int sprd_hardware_cpufreq_boost_cluster(unsigned int cluster, unsigned int ms)
+{
+	struct sprd_cpufreq_cluster_boost *b;
+	unsigned long flags, expires;
+	bool boosted;
+
+	if (cluster >= SPRD_CPUFREQ_MAX_CLUSTER)
+		return -EINVAL;
+
+	b = &cluster_boost[cluster];
+	if (!READ_ONCE(b->inited))
+		return -EINVAL;
+
+	expires = jiffies + msecs_to_jiffies(ms);
+
+	spin_lock_irqsave(&b->lock, flags);
+	boosted = time_before(jiffies, b->expires);
+	if (!boosted || time_after(expires, b->expires))
+		b->expires = expires;
+	spin_unlock_irqrestore(&b->lock, flags);
+
+	/* already at the max, the decay work picks up the new expiry */
+	if (!boosted)
+		queue_work(system_highpri_wq, &b->work);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(sprd_hardware_cpufreq_boost_cluster);
+
 static int cpufreq_boost_judge(struct cpufreq_policy *policy)
 {
 	/* Never dvfs until boot_done_timestamp */
@@ -140,6 +272,7 @@ int sprd_hardware_cpufreq_set_target_index(struct cpufreq_policy *policy,
 	struct sprd_cpudvfs_device *pdev;
 	struct sprd_cpudvfs_ops *driver;
 	struct sprd_cpufreq_driver_data *data = policy->driver_data;
+	struct sprd_cpufreq_cluster_boost *b;
 	unsigned long freq;
 	u32 cpu_cluster;
 	int ret;
@@ -161,6 +294,17 @@ int sprd_hardware_cpufreq_set_target_index(struct cpufreq_policy *policy,
 
 	cpu_cluster = topology_physical_package_id(policy->cpu);
 
+	if (cpu_cluster < SPRD_CPUFREQ_MAX_CLUSTER) {
+		b = &cluster_boost[cpu_cluster];
+		if (!b->boosting)
+			b->gov_freq = freq;
+		if (sprd_cpufreq_cluster_boosted(b)) {
+			idx = cpufreq_frequency_table_target(policy,
+					policy->max, CPUFREQ_RELATION_H);
+			freq = policy->freq_table[idx].frequency;
+		}
+	}
+
 	if (!driver->probed || !driver->probed(pdev->archdata, cpu_cluster)) {
 		pr_err("Platform cpu dvfs has not been probed.\n");
 		return -EINVAL;
@@ -424,6 +568,9 @@ static int sprd_hardware_cpufreq_init(struct cpufreq_policy *policy)
 
 	policy->dvfs_possible_from_any_cpu = true;
 
+	cluster_boost[curr_cluster].cpu = cpu;
+	WRITE_ONCE(cluster_boost[curr_cluster].inited, true);
+
 	mutex_unlock(data->volt_lock);
 
 	goto free_np;
@@ -562,11 +709,20 @@ static int sprd_hardware_cpufreq_probe(struct platform_device *pdev)
 	struct device_node *np = NULL;
 	struct device_node *cpu_np;
 	struct nvmem_cell *cell;
-	int ret;
+	int ret, i;
 	int cpu = 0; /* just core0 do probe */
 
 	boot_done_timestamp = jiffies + SPRD_CPUFREQ_DRV_BOOST_DURATOIN;
 
+	for (i = 0; i < SPRD_CPUFREQ_MAX_CLUSTER; i++) {
+		spin_lock_init(&cluster_boost[i].lock);
+		mutex_init(&cluster_boost[i].work_lock);
+		INIT_WORK(&cluster_boost[i].work,
+			  sprd_cpufreq_cluster_boost_work);
+		INIT_DELAYED_WORK(&cluster_boost[i].decay,
+				  sprd_cpufreq_cluster_decay_work);
+	}
+
 	cpu_dev = get_cpu_device(cpu);
 	if (!cpu_dev) {
 		dev_err(&pdev->dev, "Failed to get cpu%d device\n", cpu);
@@ -610,6 +766,14 @@ exit:
 
 static int sprd_hardware_cpufreq_remove(struct platform_device *pdev)
 {
+	int i;
+
+	for (i = 0; i < SPRD_CPUFREQ_MAX_CLUSTER; i++) {
+		WRITE_ONCE(cluster_boost[i].inited, false);
+		cancel_work_sync(&cluster_boost[i].work);
+		cancel_delayed_work_sync(&cluster_boost[i].decay);
+	}
+
 	return cpufreq_unregister_driver(&sprd_hardware_cpufreq_driver);
 }
 
@@ -62,6 +62,8 @@
 #define DEF_BOOSTPULSE_DURATION		(500)
 /* default dynamic hotplug time, units: ms */
 #define DEF_CHECK_LOAD_DURATION		(40)
+/* ms a load isolated cpu waits before it is really unplugged */
+#define DEF_HOTPLUG_IDLE_DURATION	(3000)
 
 #define mod(n, div) ((n) % (div))
 
@@ -130,6 +132,10 @@ struct sd_dbs_tuners {
 	unsigned int down_window_size;
 	unsigned long boostpulse_duration;
 	unsigned long check_load_duration;
+	unsigned int isolate_first;
+	unsigned long hotplug_idle_duration;
+	struct cpumask isolated_mask;	/* isolated by us, still online */
+	unsigned long isolated_since[CONFIG_NR_CPUS];
 	struct timer_list dynamic_load_timer;
 	struct pm_qos_request max_cpu_request[CLUSTER_ALL][CORE_MAX_ALL];
 	struct pm_qos_request min_cpu_request[CLUSTER_ALL][CORE_MIN_ALL];
@@ -161,6 +167,7 @@ static u64 g_prev_cpu_idle[CONFIG_NR_CPUS] = {0};
 static int hotplug_ops(int cpu, enum core_request up)
 {
 	struct device *cpu_dev;
+	int ret;
 
 	cpu_dev = get_cpu_device(cpu);
 	if (!cpu_dev) {
@@ -171,8 +178,13 @@ static int hotplug_ops(int cpu, enum core_request up)
 
 	if (up)
 		return device_online(cpu_dev);
-	else
-		return device_offline(cpu_dev);
+
+	ret = device_offline(cpu_dev);
+	/* the isolation vote outlives the cpu, drop it once it is down */
+	if (ret >= 0 && g_sd_tuners &&
+	    cpumask_test_and_clear_cpu(cpu, &g_sd_tuners->isolated_mask))
+		sched_unisolate_cpu(cpu);
+	return ret;
 }
 
 /*
@@ -241,6 +253,106 @@ static int up_proper_cpu(enum cluster_type cluster)
 			cluster ? sd_tuners->cluster_cpu_ids[cluster - 1] : 0);
 }
 
+/*
+ * Load driven changes isolate and unisolate cpus first, which costs a
+ * stop_cpus() instead of a whole cpuhp transition. A cpu is unplugged
+ * only once it stayed isolated for hotplug_idle_duration ms, so a burst
+ * after a short idle finds its cores still there.
+ */
+static bool isolate_first(struct sd_dbs_tuners *sd_tuners)
+{
+	return IS_ENABLED(CONFIG_SPRD_CORE_CTL) && sd_tuners->isolate_first;
+}
+
+static unsigned int sd_active_cpus(struct sd_dbs_tuners *sd_tuners)
+{
+	return num_online_cpus() - cpumask_weight(&sd_tuners->isolated_mask);
+}
+
+/*
+ * get online and not isolated cpus for each cluster
+ */
+static int clu_active_cpus(enum cluster_type cluster)
+{
+	struct sd_dbs_tuners *sd_tuners = g_sd_tuners;
+	struct cpumask tmp_mask;
+
+	cpumask_and(&tmp_mask, &sd_tuners->cluster_mask[cluster],
+		cpu_online_mask);
+	cpumask_andnot(&tmp_mask, &tmp_mask, &sd_tuners->isolated_mask);
+	return cpumask_weight(&tmp_mask);
+}
+
+static int isolate_proper_cpu(struct sd_dbs_tuners *sd_tuners,
+			enum cluster_type cluster)
+{
+	struct cpumask tmp_mask;
+	int cpu, ret;
+
+	cpumask_and(&tmp_mask, &sd_tuners->cluster_mask[cluster],
+		cpu_online_mask);
+	cpumask_andnot(&tmp_mask, &tmp_mask, &sd_tuners->isolated_mask);
+	cpu = find_last_bit(cpumask_bits(&tmp_mask), nr_cpu_ids);
+	if (cpu < CLU0_CPU_NUM_MIN || cpu >= nr_cpu_ids)
+		return -EINVAL;
+
+	pr_info("!! %s:we gonna isolate cpu%d !!\n",
+		cluster ? "big" : "lit", cpu);
+	ret = sched_isolate_cpu(cpu);
+	if (ret)
+		return ret;
+
+	cpumask_set_cpu(cpu, &sd_tuners->isolated_mask);
+	sd_tuners->isolated_since[cpu] = jiffies;
+	return 0;
+}
+
+static int unisolate_proper_cpu(struct sd_dbs_tuners *sd_tuners,
+			enum cluster_type cluster)
+{
+	struct cpumask tmp_mask;
+	int cpu;
+
+	cpumask_and(&tmp_mask, &sd_tuners->cluster_mask[cluster],
+		&sd_tuners->isolated_mask);
+	cpu = cpumask_first(&tmp_mask);
+	if (cpu >= nr_cpu_ids)
+		return -ENODEV;
+
+	pr_info("!! %s:we gonna unisolate cpu%d !!\n",
+		cluster ? "big" : "lit", cpu);
+	cpumask_clear_cpu(cpu, &sd_tuners->isolated_mask);
+	return sched_unisolate_cpu(cpu);
+}
+
+static bool isolated_expired(struct sd_dbs_tuners *sd_tuners, int cpu)
+{
+	return time_after_eq(jiffies, sd_tuners->isolated_since[cpu] +
+			msecs_to_jiffies(sd_tuners->hotplug_idle_duration));
+}
+
+/*
+ * Unplug the cpus that stayed isolated long enough, and give back all
+ * of them if isolate_first was turned off meanwhile.
+ */
+static void unplug_idle_cpus(struct sd_dbs_tuners *sd_tuners,
+			enum cluster_type cluster)
+{
+	int cpu;
+
+	for_each_cpu_and(cpu, &sd_tuners->isolated_mask,
+			 &sd_tuners->cluster_mask[cluster]) {
+		if (!isolate_first(sd_tuners)) {
+			cpumask_clear_cpu(cpu, &sd_tuners->isolated_mask);
+			sched_unisolate_cpu(cpu);
+		} else if (isolated_expired(sd_tuners, cpu)) {
+			pr_info("!! %s:idle gonna unplug cpu%d !!\n",
+				cluster ? "big" : "lit", cpu);
+			hotplug_ops(cpu, REQ_DOWN);
+		}
+	}
+}
+
 static int get_cluster_cpu_ids(struct sd_dbs_tuners *tuners)
 {
 	int i = 0, j = 0, tmp_id = 0, core_nums = 0;
@@ -345,8 +457,12 @@ reops:
 	 * To plugin cpu if online cpus number is
 	 * less than cpu_num_min_limit. notice: if
 	 * hotplug is disabled, it will hold
-	 * cpu_num_max_limit.
+	 * cpu_num_max_limit. Isolated cpus are taken back first.
 	 */
+	while (clu_active_cpus(cluster) < min_num &&
+	       !unisolate_proper_cpu(sd_tuners, cluster))
+		;
+
 	if (clu_online_cpus(cluster) < min_num) {
 		for (i = 0; i < sd_tuners->cluster_cpu_ids[cluster]; i++) {
 			cpu = up_proper_cpu(cluster);
@@ -397,9 +513,11 @@ reops:
 	 * or plug-out one core.
 	 */
 	if (atomic_read(&sd_tuners->request[REQ_UP])
-		&& clu_online_cpus(cluster) < max_num) {
+		&& clu_active_cpus(cluster) < max_num) {
 		cpu = cpumask_next_zero(0, cpu_online_mask);
-		if (cpu < sd_tuners->cpu_num_max_limit[cluster]) {
+		if (!unisolate_proper_cpu(sd_tuners, cluster)) {
+			clear_bit(cluster, &corechange_flag);
+		} else if (cpu < sd_tuners->cpu_num_max_limit[cluster]) {
 			pr_info("!! %s:we gonna plugin cpu%d !!\n",
 				cluster ? "big" : "lit", cpu);
 			ret = hotplug_ops(cpu, REQ_UP);
@@ -409,9 +527,12 @@ reops:
 	atomic_set(&sd_tuners->request[REQ_UP], 0);
 
 	if (atomic_read(&sd_tuners->request[REQ_DOWN])
-		&& clu_online_cpus(cluster) > min_num) {
+		&& clu_active_cpus(cluster) > min_num) {
 		cpu = down_proper_cpu(cluster);
-		if (cpu < sd_tuners->cluster_cpu_ids[cluster]
+		if (isolate_first(sd_tuners)) {
+			ret = isolate_proper_cpu(sd_tuners, cluster);
+			clear_bit(cluster, &corechange_flag);
+		} else if (cpu < sd_tuners->cluster_cpu_ids[cluster]
 			&& cpu > CLU0_CPU_NUM_MIN - 1) {
 			pr_info("!! %s:we gonna unplug cpu%d !!\n",
 				cluster ? "big" : "lit", cpu);
@@ -421,6 +542,8 @@ reops:
 	}
 	atomic_set(&sd_tuners->request[REQ_DOWN], 0);
 
+	unplug_idle_cpus(sd_tuners, cluster);
+
 ops_end:
 	if (ret == -EBUSY) {
 		pr_warn("hotplug ops EBUSY: %d\n", ret);
@@ -548,21 +671,23 @@ static void sd_check_cpu_sprd(unsigned int load)
 	unsigned int itself_avg_load = 0;
 	struct sd_dbs_tuners *sd_tuners = g_sd_tuners;
 	unsigned long flags;
+	int cpu;
 
 	if (time_before(jiffies, boot_done))
 		return;
 
-	pr_debug("efficient load %d, ---- online CPUs %d ----\n",
-			load, num_online_cpus());
+	pr_debug("efficient load %d, ---- active CPUs %d ----\n",
+			load, sd_active_cpus(sd_tuners));
 
 	/* cpu plugin check */
 	itself_avg_load = sd_avg_load(0, sd_tuners, load, true);
 	pr_debug("up itself_avg_load %d\n", itself_avg_load);
 
-	if (num_online_cpus() < sd_tuners->cpu_num_max_limit[CLUSTER0]) {
+	if (sd_active_cpus(sd_tuners)
+	    < sd_tuners->cpu_num_max_limit[CLUSTER0]) {
 		int cpu_up_threshold;
 
-		if (num_online_cpus() == 1)
+		if (sd_active_cpus(sd_tuners) == 1)
 			cpu_up_threshold = sd_tuners->cpu_up_mid_threshold;
 		else
 			cpu_up_threshold = sd_tuners->cpu_up_high_threshold;
@@ -578,13 +703,13 @@ static void sd_check_cpu_sprd(unsigned int load)
 	}
 
 	/* cpu unplug check */
-	if (num_online_cpus() > sd_tuners->cpu_num_min_limit[CLUSTER0]) {
+	if (sd_active_cpus(sd_tuners) > sd_tuners->cpu_num_min_limit[CLUSTER0]) {
 		int cpu_down_threshold;
 
 		itself_avg_load = sd_avg_load(0, sd_tuners, load, false);
 		pr_debug("down itself_avg_load %d\n", itself_avg_load);
 
-		if (num_online_cpus()
+		if (sd_active_cpus(sd_tuners)
 		    > (sd_tuners->cpu_num_min_limit[CLUSTER0] + 1))
 			cpu_down_threshold = sd_tuners->cpu_down_high_threshold;
 		else
@@ -596,6 +721,18 @@ static void sd_check_cpu_sprd(unsigned int load)
 			set_bit(CLUSTER0, &corechange_flag);
 			spin_unlock_irqrestore(&corechange_lock, flags);
 			wake_up_process(corechange_task);
+			return;
+		}
+	}
+
+	/* let the core change task unplug cpus isolated for long enough */
+	for_each_cpu(cpu, &sd_tuners->isolated_mask) {
+		if (isolated_expired(sd_tuners, cpu)) {
+			spin_lock_irqsave(&corechange_lock, flags);
+			set_bit(CLUSTER0, &corechange_flag);
+			spin_unlock_irqrestore(&corechange_lock, flags);
+			wake_up_process(corechange_task);
+			break;
 		}
 	}
 }
@@ -1322,6 +1459,60 @@ static ssize_t store_check_load_duration(struct kobject *kobj,
 	return count;
 }
 
+static ssize_t store_isolate_first(struct kobject *kobj,
+		struct kobj_attribute *attr, const char *buf, size_t count)
+{
+	struct sd_dbs_tuners *sd_tuners = g_sd_tuners;
+	unsigned long flags;
+	unsigned int input;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &input);
+	if (ret < 0)
+		return ret;
+
+	if (input && !IS_ENABLED(CONFIG_SPRD_CORE_CTL))
+		return -EINVAL;
+
+	sd_tuners->isolate_first = !!input;
+
+	/* give the isolated cpus back */
+	if (!input && !cpumask_empty(&sd_tuners->isolated_mask)) {
+		spin_lock_irqsave(&corechange_lock, flags);
+		bitmap_fill(&corechange_flag, sd_tuners->cluster_num);
+		spin_unlock_irqrestore(&corechange_lock, flags);
+		wake_up_process(corechange_task);
+	}
+	return count;
+}
+
+static ssize_t show_isolate_first(struct kobject *kobj,
+		struct kobj_attribute *attr, char *buf)
+{
+	return snprintf(buf, 10, "%u\n", g_sd_tuners->isolate_first);
+}
+
+static ssize_t store_hotplug_idle_duration(struct kobject *kobj,
+		struct kobj_attribute *attr, const char *buf, size_t count)
+{
+	struct sd_dbs_tuners *sd_tuners = g_sd_tuners;
+	int ret;
+	unsigned long val;
+
+	ret = kstrtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+
+	sd_tuners->hotplug_idle_duration = val;
+	return count;
+}
+
+static ssize_t show_hotplug_idle_duration(struct kobject *kobj,
+		struct kobj_attribute *attr, char *buf)
+{
+	return snprintf(buf, 10, "%lu\n", g_sd_tuners->hotplug_idle_duration);
+}
+
 define_sprd_global(io_is_busy, 0660);
 define_sprd_global(passion_mode, 0660);
 define_sprd_global(sampling_down_factor, 0660);
@@ -1336,6 +1527,8 @@ define_sprd_global(down_window_size, 0660);
 define_sprd_global(boostpulse_duration, 0660);
 define_sprd_global_wo(boostpulse, 0220);
 define_sprd_global(check_load_duration, 0660);
+define_sprd_global(isolate_first, 0660);
+define_sprd_global(hotplug_idle_duration, 0660);
 
 static const struct attribute *dynamic_hotplug[] = {
 	&io_is_busy.attr,
@@ -1352,6 +1545,8 @@ static const struct attribute *dynamic_hotplug[] = {
 	&boostpulse_duration.attr,
 	&boostpulse.attr,
 	&check_load_duration.attr,
+	&isolate_first.attr,
+	&hotplug_idle_duration.attr,
 	NULL,
 };
 
@@ -1594,6 +1789,9 @@ static int sd_tuners_init(struct sd_dbs_tuners *tuners)
 	tuners->down_window_size = DOWN_LOAD_WINDOW_SIZE;
 	tuners->boostpulse_duration = DEF_BOOSTPULSE_DURATION;
 	tuners->check_load_duration = DEF_CHECK_LOAD_DURATION;
+	tuners->isolate_first = IS_ENABLED(CONFIG_SPRD_CORE_CTL);
+	tuners->hotplug_idle_duration = DEF_HOTPLUG_IDLE_DURATION;
+	cpumask_clear(&tuners->isolated_mask);
 	tuners->cpu_num_min_limit[CLUSTER0] = CLU0_CPU_NUM_MIN;
 
 	ret = sprd_hotplug_parse_dt(g_sd_tuners);
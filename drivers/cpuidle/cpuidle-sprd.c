@@ -9,11 +9,16 @@
  * published by the Free Software Foundation.
  */
 
+#include <linux/atomic.h>
 #include <linux/cpuidle.h>
 #include <linux/cpu_pm.h>
+#include <linux/debugfs.h>
 #include <linux/kernel.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/of.h>
+#include <linux/percpu.h>
+#include <linux/seq_file.h>
 #include <asm/proc-fns.h>
 #include <asm/suspend.h>
 #include "dt_idle_states.h"
@@ -31,7 +36,21 @@ enum {
 	CORE_PD,      /* Core power down & Lightsleep */
 };
 
+/*
+ * Per state outcome of an idle period: a hit stayed at least the target
+ * residency, a miss woke up earlier, a demotion is a state the governor
+ * picked but a wakeup hint ruled out.
+ */
+struct sprd_cpuidle_stats {
+	u64 hit[CPUIDLE_STATE_MAX];
+	u64 miss[CPUIDLE_STATE_MAX];
+	u64 demoted[CPUIDLE_STATE_MAX];
+};
+
 static struct sprd_cpuidle_operations *sprd_cpuidle_ops;
+static DEFINE_PER_CPU(struct sprd_cpuidle_stats, sprd_cpuidle_stats);
+/* next known wakeup of each source, in ktime ns, 0 for none */
+static atomic64_t sprd_cpuidle_hints[NR_SPRD_IDLE_HINT];
 
 int sprd_cpuidle_ops_init(struct sprd_cpuidle_operations *cpuidle_ops)
 {
@@ -39,6 +58,41 @@ int sprd_cpuidle_ops_init(struct sprd_cpuidle_operations *cpuidle_ops)
 	return 0;
 }
 
+/**
+ * sprd_cpuidle_wakeup_hint - tell the idle driver of a coming wakeup
+ * @src: the source, one slot each
+ * @next: when it wakes up next, 0 to clear the hint
+ *
+ * Meant for periodic wakeups the menu governor gets wrong, e.g. sipc
+ * timers, audio dma periods or the display vsync, the source refreshes
+ * its hint every period. A hint in the past is ignored, so a source
+ * that stops does not hold the cpus in shallow states.
+ */
+void sprd_cpuidle_wakeup_hint(enum sprd_idle_hint src, ktime_t next)
+{
+	if (src < NR_SPRD_IDLE_HINT)
+		atomic64_set(&sprd_cpuidle_hints[src], ktime_to_ns(next));
+}
+EXPORT_SYMBOL_GPL(sprd_cpuidle_wakeup_hint);
+
+/* Microseconds to the first hinted wakeup, S64_MAX without one */
+static s64 sprd_cpuidle_hint_us(ktime_t now)
+{
+	s64 first = S64_MAX, next;
+	int i;
+
+	for (i = 0; i < NR_SPRD_IDLE_HINT; i++) {
+		next = atomic64_read(&sprd_cpuidle_hints[i]);
+		if (next > ktime_to_ns(now) && next < first)
+			first = next;
+	}
+
+	if (first == S64_MAX)
+		return S64_MAX;
+
+	return div_s64(first - ktime_to_ns(now), NSEC_PER_USEC);
+}
+
 static void sprd_cpuidle_core_pd_en(void)
 {
 }
@@ -51,18 +105,8 @@ static int sprd_cpuidle_real_suspend_fn(unsigned long cpu)
 	cpu_do_idle();
 	return 0;
 }
-/*
- * sprd_enter_idle_state - Programs CPU to enter the specified state
- *
- * @dev: cpuidle device
- * @drv: cpuidle driver
- * @idx: state index
- *
- * Called from the CPUidle framework to program the device to the
- * specified target state selected by the governor.
- */
-static int sprd_enter_idle_state(struct cpuidle_device *dev,
-				struct cpuidle_driver *drv, int idx)
+
+static void sprd_do_idle_state(int idx)
 {
 	switch (idx) {
 	case STANDBY:
@@ -94,10 +138,80 @@ static int sprd_enter_idle_state(struct cpuidle_device *dev,
 		cpu_do_idle();
 		WARN(1, "[CPUIDLE]: NO THIS IDLE LEVEL!!!");
 	}
+}
+
+/*
+ * sprd_enter_idle_state - Programs CPU to enter the specified state
+ *
+ * @dev: cpuidle device
+ * @drv: cpuidle driver
+ * @idx: state index
+ *
+ * Called from the CPUidle framework to program the device to the
+ * specified target state selected by the governor. A state whose target
+ * residency goes past a hinted wakeup is swapped for the deepest one
+ * that fits, the index really entered is returned.
+ */
+static int sprd_enter_idle_state(struct cpuidle_device *dev,
+				struct cpuidle_driver *drv, int idx)
+{
+	struct sprd_cpuidle_stats *st = this_cpu_ptr(&sprd_cpuidle_stats);
+	ktime_t start = ktime_get();
+	s64 budget_us = sprd_cpuidle_hint_us(start);
+	s64 residency_us;
+
+	while (idx > 0 && drv->states[idx].target_residency > budget_us) {
+		st->demoted[idx]++;
+		idx--;
+	}
+
+	sprd_do_idle_state(idx);
+
+	residency_us = ktime_us_delta(ktime_get(), start);
+	if (residency_us >= drv->states[idx].target_residency)
+		st->hit[idx]++;
+	else
+		st->miss[idx]++;
 
 	return idx;
 }
 
+static int sprd_cpuidle_stats_show(struct seq_file *m, void *unused)
+{
+	struct cpuidle_driver *drv = m->private;
+	u64 hit, miss, demoted;
+	int i, cpu;
+
+	seq_puts(m, "state        hit       miss    demoted\n");
+	for (i = 0; i < drv->state_count; i++) {
+		hit = miss = demoted = 0;
+		for_each_possible_cpu(cpu) {
+			struct sprd_cpuidle_stats *st =
+				per_cpu_ptr(&sprd_cpuidle_stats, cpu);
+
+			hit += st->hit[i];
+			miss += st->miss[i];
+			demoted += st->demoted[i];
+		}
+		seq_printf(m, "%-8s %10llu %10llu %10llu\n",
+			   drv->states[i].name, hit, miss, demoted);
+	}
+
+	return 0;
+}
+
+static int sprd_cpuidle_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sprd_cpuidle_stats_show, inode->i_private);
+}
+
+static const struct file_operations sprd_cpuidle_stats_fops = {
+	.open = sprd_cpuidle_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static struct cpuidle_driver sprd_cpuidle_driver = {
 	.name = "arm-idle-sprd",
 	.owner = THIS_MODULE,
@@ -155,6 +269,9 @@ static int __init sprd_cpuidle_init(void)
 		return ret;
 	}
 
+	debugfs_create_file("sprd_cpuidle_stats", 0444, NULL, drv,
+			    &sprd_cpuidle_stats_fops);
+
 	return 0;
 }
 
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2018 Spreadtrum Communications Inc.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * DDR frequency from the traffic the PTM bandwidth monitors measured in
+ * the last polling window. The sum over all channels is turned into the
+ * frequency that moves it at upthreshold percent of the peak bandwidth,
+ * channels of latency sensitive masters raise that to their floor while
+ * they have any traffic at all.
+ */
+
+#include <linux/devfreq.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/sprd_dfs_drv.h>
+#include <linux/sprd_ptm.h>
+#include "../governor.h"
+
+#define DFS_BW_DEF_BYTES_PER_CYCLE	8
+#define DFS_BW_DEF_UPTHRESHOLD		70
+
+static unsigned long dfs_bw_round_up(struct dfs_bw_data *data,
+				     unsigned long freq)
+{
+	int i;
+
+	if (!data->freq_table || !data->freq_num)
+		return freq;
+
+	for (i = 0; i < data->freq_num; i++)
+		if (data->freq_table[i] >= freq)
+			return data->freq_table[i];
+
+	return data->freq_table[data->freq_num - 1];
+}
+
+static int devfreq_sprd_bw_func(struct devfreq *df, unsigned long *freq)
+{
+	struct dfs_bw_data *data = df->data;
+	u32 rd[DFS_BW_CHN_MAX], wr[DFS_BW_CHN_MAX];
+	unsigned int bytes_per_cycle, upthreshold;
+	unsigned long target = 0;
+	u64 bytes = 0, win_us;
+	ktime_t now = ktime_get();
+	int i, nr;
+
+	if (!data)
+		return -EINVAL;
+
+	nr = sprd_ptm_bw_sample(rd, wr, DFS_BW_CHN_MAX);
+	win_us = ktime_us_delta(now, data->last);
+	data->last = now;
+
+	/* nothing measured, keep the ddr at full speed */
+	if (nr < 0) {
+		*freq = df->max_freq;
+		return 0;
+	}
+
+	/* first window, or a stale one after a suspend */
+	if (!nr || !win_us) {
+		*freq = df->previous_freq;
+		return 0;
+	}
+
+	bytes_per_cycle = data->bytes_per_cycle ?: DFS_BW_DEF_BYTES_PER_CYCLE;
+	upthreshold = data->upthreshold ?: DFS_BW_DEF_UPTHRESHOLD;
+
+	for (i = 0; i < nr; i++) {
+		bytes += (u64)rd[i] + wr[i];
+		if ((rd[i] || wr[i]) && data->floor[i] > target)
+			target = data->floor[i];
+	}
+
+	/* bytes per us is MB/s, the dfs frequencies are in MHz */
+	bytes = div64_u64(bytes * 100, win_us * upthreshold * bytes_per_cycle);
+	target = max_t(unsigned long, target, bytes);
+	target = dfs_bw_round_up(data, target);
+
+	if (df->min_freq && target < df->min_freq)
+		target = df->min_freq;
+	if (df->max_freq && target > df->max_freq)
+		target = df->max_freq;
+
+	*freq = target;
+	return 0;
+}
+
+static int devfreq_sprd_bw_handler(struct devfreq *devfreq,
+				   unsigned int event, void *data)
+{
+	switch (event) {
+	case DEVFREQ_GOV_START:
+		devfreq_monitor_start(devfreq);
+		break;
+
+	case DEVFREQ_GOV_STOP:
+		devfreq_monitor_stop(devfreq);
+		break;
+
+	case DEVFREQ_GOV_INTERVAL:
+		devfreq_interval_update(devfreq, (unsigned int *)data);
+		break;
+
+	case DEVFREQ_GOV_SUSPEND:
+		devfreq_monitor_suspend(devfreq);
+		break;
+
+	case DEVFREQ_GOV_RESUME:
+		devfreq_monitor_resume(devfreq);
+		break;
+
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+static struct devfreq_governor devfreq_sprd_bw = {
+	.name = "sprd_bw",
+	.get_target_freq = devfreq_sprd_bw_func,
+	.event_handler = devfreq_sprd_bw_handler,
+};
+
+static int __init devfreq_sprd_bw_init(void)
+{
+	return devfreq_add_governor(&devfreq_sprd_bw);
+}
+subsys_initcall(devfreq_sprd_bw_init);
+
+static void __exit devfreq_sprd_bw_exit(void)
+{
+	int ret;
+
+	ret = devfreq_remove_governor(&devfreq_sprd_bw);
+	if (ret)
+		pr_err("%s: failed remove governor %d\n", __func__, ret);
+}
+module_exit(devfreq_sprd_bw_exit);
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("sprd ddr devfreq governor driven by ptm bandwidth");
@@ -26,6 +26,7 @@
 #include <linux/suspend.h>
 #include <linux/sipc.h>
 #include <linux/list.h>
+#include <linux/workqueue.h>
 #include <linux/sprd_dfs_drv.h>
 
 #define CREATE_TRACE_POINTS
@@ -110,6 +111,7 @@ struct dfs_data {
 	struct devfreq *devfreq;
 	struct devfreq_dev_profile *profile;
 	struct task_struct *dfs_smsg_ch_open;
+	struct work_struct scene_work;
 	spinlock_t lock;
 	struct mutex sync_mutex;
 	unsigned int freq_num;
@@ -121,6 +123,7 @@ struct dfs_data {
 	unsigned int force_freq;
 	unsigned int backdoor_freq;
 	unsigned int init_done;
+	struct dfs_bw_data bw_data;
 };
 
 static struct dfs_data *g_dfs_data;
@@ -358,10 +361,37 @@ static int send_scene_request(unsigned int magic)
 	return err;
 }
 
+/*
+ * Scene votes are sent from here rather than by the callers. A burst of
+ * scene changes, e.g. camera or video start up, queues the work once,
+ * and each vote magic costs a single round trip to the DFS firmware for
+ * the aggregated frequency, or none when it did not change.
+ */
+static void dfs_scene_work(struct work_struct *work)
+{
+	struct dfs_data *data = container_of(work, struct dfs_data,
+					     scene_work);
+	struct scene_freq *scene = data->scenes;
+	int i, j, err;
+
+	for (i = 0; i < data->scene_num; i++) {
+		/* one request per magic */
+		for (j = 0; j < i; j++)
+			if (scene[j].vote_magic == scene[i].vote_magic)
+				break;
+		if (j < i)
+			continue;
+
+		err = send_scene_request(scene[i].vote_magic);
+		if (err < 0)
+			pr_err("%s, vote for magic 0x%x failed: %d\n",
+			       __func__, scene[i].vote_magic, err);
+	}
+}
+
 int scene_dfs_request(char *scenario)
 {
 	struct scene_freq *scene;
-	int err;
 
 	if (g_dfs_data == NULL)
 		return -ENOENT;
@@ -374,15 +404,14 @@ int scene_dfs_request(char *scenario)
 	}
 	add_scene(scene);
 	trace_sprd_scene(scene, 1);
-	err = send_scene_request(scene->vote_magic);
-	return err;
+	queue_work(system_highpri_wq, &g_dfs_data->scene_work);
+	return 0;
 }
 EXPORT_SYMBOL(scene_dfs_request);
 
 int scene_exit(char *scenario)
 {
 	struct scene_freq *scene;
-	int err;
 
 	if (g_dfs_data == NULL)
 		return -ENOENT;
@@ -395,15 +424,14 @@ int scene_exit(char *scenario)
 	}
 	del_scene(scene);
 	trace_sprd_scene(scene, 0);
-	err = send_scene_request(scene->vote_magic);
-	return err;
+	queue_work(system_highpri_wq, &g_dfs_data->scene_work);
+	return 0;
 }
 EXPORT_SYMBOL(scene_exit);
 
 int change_scene_freq(char *scenario, unsigned int freq)
 {
 	struct scene_freq *scene;
-	int err;
 
 	if (g_dfs_data == NULL)
 		return -ENOENT;
@@ -417,8 +445,8 @@ int change_scene_freq(char *scenario, unsigned int freq)
 	spin_lock(&g_dfs_data->lock);
 		scene->scene_freq = freq;
 	spin_unlock(&g_dfs_data->lock);
-	err = send_scene_request(scene->vote_magic);
-	return err;
+	queue_work(system_highpri_wq, &g_dfs_data->scene_work);
+	return 0;
 }
 EXPORT_SYMBOL(change_scene_freq);
 
@@ -744,6 +772,7 @@ static int dfs_auto_freq_probe(struct platform_device *pdev)
 	struct dfs_data *data;
 	struct device *dev = &pdev->dev;
 	unsigned int freq_num;
+	const char *gov;
 	int scene_num;
 	void *p;
 	int err, i;
@@ -787,6 +816,7 @@ static int dfs_auto_freq_probe(struct platform_device *pdev)
 	data->scene_num = scene_num;
 	spin_lock_init(&data->lock);
 	mutex_init(&data->sync_mutex);
+	INIT_WORK(&data->scene_work, dfs_scene_work);
 
 	err = of_property_read_u32(dev->of_node, "backdoor",
 					&data->backdoor_freq);
@@ -825,8 +855,25 @@ static int dfs_auto_freq_probe(struct platform_device *pdev)
 	data->profile->get_dev_status = dfs_get_dev_status;
 	data->profile->exit = dfs_exit;
 
+	/* measured demand instead of scene votes */
+	gov = "sprd_governor";
+	if (of_property_read_bool(dev->of_node, "sprd,bw-governor")) {
+		gov = "sprd_bw";
+		of_property_read_u32(dev->of_node, "sprd,bw-bytes-per-cycle",
+				     &data->bw_data.bytes_per_cycle);
+		of_property_read_u32(dev->of_node, "sprd,bw-upthreshold",
+				     &data->bw_data.upthreshold);
+		for (i = 0; i < DFS_BW_CHN_MAX; i++)
+			if (of_property_read_u32_index(dev->of_node,
+					"sprd,bw-floor", i,
+					&data->bw_data.floor[i]))
+				break;
+		data->bw_data.freq_table = data->freq_table;
+		data->bw_data.freq_num = freq_num;
+	}
+
 	data->devfreq = devfreq_add_device(data->dev, data->profile,
-						"sprd_governor", NULL);
+					   gov, &data->bw_data);
 	if (IS_ERR(data->devfreq)) {
 		err = PTR_ERR(data->devfreq);
 		goto err_data;
@@ -853,6 +900,7 @@ static int dfs_auto_freq_remove(struct platform_device *pdev)
 {
 	struct dfs_data *data = platform_get_drvdata(pdev);
 
+	cancel_work_sync(&data->scene_work);
 	devfreq_remove_device(data->devfreq);
 	kfree(data);
 	return 0;
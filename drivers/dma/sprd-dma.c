@@ -134,6 +134,9 @@
 /* SPRD_DMA_CHN_TRSC_LEN register definition */
 #define SPRD_DMA_TRSC_LEN_MASK		GENMASK(27, 0)
 
+/* longest memcpy one channel configuration can move */
+#define SPRD_DMA_MEMCPY_MAX_LEN		ALIGN_DOWN(SPRD_DMA_TRSC_LEN_MASK, 8)
+
 /* SPRD_DMA_CHN_TRSF_STEP register definition */
 #define SPRD_DMA_DEST_TRSF_STEP_OFFSET	16
 #define SPRD_DMA_SRC_TRSF_STEP_OFFSET	0
@@ -185,10 +188,16 @@ struct sprd_dma_chn_hw {
 	u32 des_blk_step;
 };
 
-/* dma request description */
+/*
+ * dma request description, a memcpy can be made of several configurations
+ * run one after another: chn_hw is the first one, segs[] the others.
+ */
 struct sprd_dma_desc {
 	struct virt_dma_desc	vd;
 	struct sprd_dma_chn_hw	chn_hw;
+	struct sprd_dma_chn_hw	*segs;
+	u32			nr_segs;
+	u32			cur_seg;
 };
 
 /* dma channel description */
@@ -203,6 +212,19 @@ struct sprd_dma_chn {
 	enum sprd_dma_trg_mode	trg_mode;
 	enum sprd_dma_int_type	int_type;
 	struct sprd_dma_desc	*cur_desc;
+	struct sprd_dma_desc	*spare_desc;
+
+	/*
+	 * Configuration words of the last slave prep. They only depend on the
+	 * slave config and the prep flags, so repeated preps (cyclic audio,
+	 * uart and spi transfers) just fill in the addresses.
+	 */
+	struct sprd_dma_chn_hw	tmpl_hw;
+	unsigned long		tmpl_flags;
+	enum dma_transfer_direction	tmpl_dir;
+	enum sprd_dma_chn_mode	tmpl_chn_mode;
+	bool			tmpl_wrap;
+	bool			tmpl_valid;
 };
 
 /* SPRD dma device */
@@ -502,9 +524,8 @@ static void sprd_dma_set_pending(struct sprd_dma_chn *schan, bool enable)
 }
 
 static void sprd_dma_set_chn_config(struct sprd_dma_chn *schan,
-				    struct sprd_dma_desc *sdesc)
+				    struct sprd_dma_chn_hw *cfg)
 {
-	struct sprd_dma_chn_hw *cfg = &sdesc->chn_hw;
 
 	writel(cfg->pause, schan->chn_base + SPRD_DMA_CHN_PAUSE);
 	writel(cfg->cfg, schan->chn_base + SPRD_DMA_CHN_CFG);
@@ -540,7 +561,7 @@ static void sprd_dma_start(struct sprd_dma_chn *schan)
 	 * Copy the DMA configuration from DMA descriptor to this hardware
 	 * channel.
 	 */
-	sprd_dma_set_chn_config(schan, schan->cur_desc);
+	sprd_dma_set_chn_config(schan, &schan->cur_desc->chn_hw);
 	sprd_dma_set_uid(schan);
 	sprd_dma_set_pending(schan, true);
 	sprd_dma_enable_chn(schan);
@@ -551,6 +572,19 @@ static void sprd_dma_start(struct sprd_dma_chn *schan)
 		sprd_dma_soft_request(schan);
 }
 
+/* Move on to the next configuration of a memcpy, false if it was the last */
+static bool sprd_dma_start_next_seg(struct sprd_dma_chn *schan,
+				    struct sprd_dma_desc *sdesc)
+{
+	if (sdesc->cur_seg >= sdesc->nr_segs)
+		return false;
+
+	sprd_dma_set_chn_config(schan, &sdesc->segs[sdesc->cur_seg++]);
+	sprd_dma_enable_chn(schan);
+	sprd_dma_soft_request(schan);
+	return true;
+}
+
 static void sprd_dma_stop(struct sprd_dma_chn *schan)
 {
 	sprd_dma_stop_and_disable(schan);
@@ -612,7 +646,8 @@ static irqreturn_t dma_irq_handle(int irq, void *dev_id)
 		/* Check if the dma request descriptor is done. */
 		trans_done = sprd_dma_check_trans_done(sdesc, int_type,
 						       req_type);
-		if (trans_done == true) {
+		if (trans_done == true &&
+		    !sprd_dma_start_next_seg(schan, sdesc)) {
 			vchan_cookie_complete(&sdesc->vd);
 			schan->cur_desc = NULL;
 			sprd_dma_start(schan);
@@ -633,6 +668,7 @@ static int sprd_dma_alloc_chan_resources(struct dma_chan *chan)
 		return ret;
 
 	schan->dev_id = SPRD_DMA_SOFTWARE_UID;
+	schan->tmpl_valid = false;
 	return 0;
 }
 
@@ -654,6 +690,7 @@ static void sprd_dma_free_chan_resources(struct dma_chan *chan)
 		sprd_dma_free_desc(cur_vd);
 
 	vchan_free_chan_resources(&schan->vc);
+	kfree(xchg(&schan->spare_desc, NULL));
 	pm_runtime_put_sync(chan->device->dev);
 }
 
@@ -802,10 +839,20 @@ static int sprd_dma_get_data_format(u32 format)
 	}
 }
 
-static int sprd_dma_fill_desc(struct dma_chan *chan,
+static struct sprd_dma_desc *sprd_dma_alloc_desc(struct sprd_dma_chn *schan)
+{
+	struct sprd_dma_desc *sdesc = xchg(&schan->spare_desc, NULL);
+
+	if (sdesc) {
+		memset(sdesc, 0, sizeof(*sdesc));
+		return sdesc;
+	}
+
+	return kzalloc(sizeof(*sdesc), GFP_NOWAIT);
+}
+
+static int sprd_dma_fill_tmpl(struct dma_chan *chan,
 			      struct sprd_dma_chn_hw *hw,
-			      unsigned int sglen, int sg_index,
-			      dma_addr_t src, dma_addr_t dst, u32 len,
 			      enum dma_transfer_direction dir,
 			      unsigned long flags,
 			      struct dma_slave_config *slave_cfg)
@@ -816,7 +863,6 @@ static int sprd_dma_fill_desc(struct dma_chan *chan,
 	u32 req_mode = (flags >> SPRD_DMA_REQ_SHIFT) & SPRD_DMA_REQ_MODE_MASK;
 	int int_mode, src_datawidth, dst_datawidth, src_step, dst_step, data_format;
 	u32 temp, fix_mode = 0, fix_en = 0;
-	phys_addr_t llist_ptr;
 
 	if (dir == DMA_MEM_TO_DEV) {
 		src_step = slave_cfg->step ? slave_cfg->step :
@@ -862,15 +908,6 @@ static int sprd_dma_fill_desc(struct dma_chan *chan,
 
 	hw->cfg = SPRD_DMA_DONOT_WAIT_BDONE << SPRD_DMA_WAIT_BDONE_OFFSET;
 
-	/*
-	 * wrap_ptr and wrap_to will save the high 4 bits source address and
-	 * destination address.
-	 */
-	hw->wrap_ptr = (src >> SPRD_DMA_HIGH_ADDR_OFFSET) & SPRD_DMA_HIGH_ADDR_MASK;
-	hw->wrap_to = (dst >> SPRD_DMA_HIGH_ADDR_OFFSET) & SPRD_DMA_HIGH_ADDR_MASK;
-	hw->src_addr = src & SPRD_DMA_LOW_ADDR_MASK;
-	hw->des_addr = dst & SPRD_DMA_LOW_ADDR_MASK;
-
 	/*
 	 * If the src step and dst step both are 0 or both are not 0, that means
 	 * we can not enable the fix mode. If one is 0 and another one is not,
@@ -911,12 +948,60 @@ static int sprd_dma_fill_desc(struct dma_chan *chan,
 	hw->frg_len = temp;
 
 	hw->blk_len = slave_cfg->src_maxburst & SPRD_DMA_BLK_LEN_MASK;
-	hw->trsc_len = len & SPRD_DMA_TRSC_LEN_MASK;
 
 	temp = (dst_step & SPRD_DMA_TRSF_STEP_MASK) << SPRD_DMA_DEST_TRSF_STEP_OFFSET;
 	temp |= (src_step & SPRD_DMA_TRSF_STEP_MASK) << SPRD_DMA_SRC_TRSF_STEP_OFFSET;
 	hw->trsf_step = temp;
 
+	return 0;
+}
+
+static int sprd_dma_fill_desc(struct dma_chan *chan,
+			      struct sprd_dma_chn_hw *hw,
+			      unsigned int sglen, int sg_index,
+			      dma_addr_t src, dma_addr_t dst, u32 len,
+			      enum dma_transfer_direction dir,
+			      unsigned long flags,
+			      struct dma_slave_config *slave_cfg)
+{
+	struct sprd_dma_chn *schan = to_sprd_dma_chan(chan);
+	struct sprd_dma_chn_hw *tmpl = &schan->tmpl_hw;
+	bool wrap = !!schan->linklist.wrap_ptr;
+	phys_addr_t llist_ptr;
+	u32 temp;
+	int ret;
+
+	if (!schan->tmpl_valid || schan->tmpl_flags != flags ||
+	    schan->tmpl_dir != dir || schan->tmpl_chn_mode != schan->chn_mode ||
+	    schan->tmpl_wrap != wrap) {
+		schan->tmpl_valid = false;
+		ret = sprd_dma_fill_tmpl(chan, tmpl, dir, flags, slave_cfg);
+		if (ret)
+			return ret;
+
+		schan->tmpl_flags = flags;
+		schan->tmpl_dir = dir;
+		schan->tmpl_chn_mode = schan->chn_mode;
+		schan->tmpl_wrap = wrap;
+		schan->tmpl_valid = true;
+	}
+
+	hw->cfg = tmpl->cfg;
+	hw->intc = tmpl->intc;
+	hw->frg_len = tmpl->frg_len;
+	hw->blk_len = tmpl->blk_len;
+	hw->trsf_step = tmpl->trsf_step;
+
+	/*
+	 * wrap_ptr and wrap_to will save the high 4 bits source address and
+	 * destination address.
+	 */
+	hw->wrap_ptr = (src >> SPRD_DMA_HIGH_ADDR_OFFSET) & SPRD_DMA_HIGH_ADDR_MASK;
+	hw->wrap_to = (dst >> SPRD_DMA_HIGH_ADDR_OFFSET) & SPRD_DMA_HIGH_ADDR_MASK;
+	hw->src_addr = src & SPRD_DMA_LOW_ADDR_MASK;
+	hw->des_addr = dst & SPRD_DMA_LOW_ADDR_MASK;
+	hw->trsc_len = len & SPRD_DMA_TRSC_LEN_MASK;
+
 	/* link-list configuration */
 	if (schan->linklist.phy_addr) {
 		hw->cfg |= SPRD_DMA_LINKLIST_EN;
@@ -973,23 +1058,14 @@ static int sprd_dma_fill_linklist_desc(struct dma_chan *chan,
 				  dir, flags, slave_cfg);
 }
 
-static struct dma_async_tx_descriptor *
-sprd_dma_prep_dma_memcpy(struct dma_chan *chan, dma_addr_t dest, dma_addr_t src,
-			 size_t len, unsigned long flags)
+static void sprd_dma_fill_memcpy(struct sprd_dma_chn_hw *hw, dma_addr_t dest,
+				 dma_addr_t src, size_t len)
 {
-	struct sprd_dma_chn *schan = to_sprd_dma_chan(chan);
-	struct sprd_dma_desc *sdesc;
-	struct sprd_dma_chn_hw *hw;
 	enum sprd_dma_datawidth datawidth;
+	dma_addr_t align = src | dest | len;
 	u32 step, temp;
 	size_t frag_len, frag_max, blk_max;
 
-	sdesc = kzalloc(sizeof(*sdesc), GFP_NOWAIT);
-	if (!sdesc)
-		return NULL;
-
-	hw = &sdesc->chn_hw;
-
 	hw->cfg = SPRD_DMA_DONOT_WAIT_BDONE << SPRD_DMA_WAIT_BDONE_OFFSET;
 	hw->intc = SPRD_DMA_TRANS_INT | SPRD_DMA_CFG_ERR_INT_EN;
 	hw->src_addr = src & SPRD_DMA_LOW_ADDR_MASK;
@@ -999,17 +1075,18 @@ sprd_dma_prep_dma_memcpy(struct dma_chan *chan, dma_addr_t dest, dma_addr_t src,
 	hw->wrap_to = (dest >> SPRD_DMA_HIGH_ADDR_OFFSET) &
 		SPRD_DMA_HIGH_ADDR_MASK;
 
-	if (IS_ALIGNED(len, 8)) {
+	/* the data width has to suit both addresses, not only the length */
+	if (IS_ALIGNED(align, 8)) {
 		datawidth = SPRD_DMA_DATAWIDTH_8_BYTES;
 		step = SPRD_DMA_DWORD_STEP;
 		frag_max = ALIGN_DOWN(SPRD_DMA_FRG_LEN_MASK, 8);
 		blk_max = ALIGN_DOWN(SPRD_DMA_BLK_LEN_MASK, 8);
-	} else if (IS_ALIGNED(len, 4)) {
+	} else if (IS_ALIGNED(align, 4)) {
 		datawidth = SPRD_DMA_DATAWIDTH_4_BYTES;
 		step = SPRD_DMA_WORD_STEP;
 		frag_max = ALIGN_DOWN(SPRD_DMA_FRG_LEN_MASK, 4);
 		blk_max = ALIGN_DOWN(SPRD_DMA_BLK_LEN_MASK, 4);
-	} else if (IS_ALIGNED(len, 2)) {
+	} else if (IS_ALIGNED(align, 2)) {
 		datawidth = SPRD_DMA_DATAWIDTH_2_BYTES;
 		step = SPRD_DMA_SHORT_STEP;
 		frag_max = ALIGN_DOWN(SPRD_DMA_FRG_LEN_MASK, 2);
@@ -1037,10 +1114,139 @@ sprd_dma_prep_dma_memcpy(struct dma_chan *chan, dma_addr_t dest, dma_addr_t src,
 	temp = (step & SPRD_DMA_TRSF_STEP_MASK) << SPRD_DMA_DEST_TRSF_STEP_OFFSET;
 	temp |= (step & SPRD_DMA_TRSF_STEP_MASK) << SPRD_DMA_SRC_TRSF_STEP_OFFSET;
 	hw->trsf_step = temp;
+}
+
+static struct sprd_dma_desc *
+sprd_dma_alloc_memcpy_desc(struct sprd_dma_chn *schan, u32 nr_segs)
+{
+	struct sprd_dma_desc *sdesc;
+
+	sdesc = sprd_dma_alloc_desc(schan);
+	if (!sdesc || nr_segs < 2)
+		return sdesc;
+
+	sdesc->segs = kcalloc(nr_segs - 1, sizeof(*sdesc->segs), GFP_NOWAIT);
+	if (!sdesc->segs) {
+		kfree(sdesc);
+		return NULL;
+	}
+
+	return sdesc;
+}
+
+/* The configuration number seg of a memcpy, 0 is the one in the descriptor */
+static struct sprd_dma_chn_hw *sprd_dma_memcpy_seg(struct sprd_dma_desc *sdesc,
+						   u32 seg)
+{
+	return seg ? &sdesc->segs[seg - 1] : &sdesc->chn_hw;
+}
+
+static struct dma_async_tx_descriptor *
+sprd_dma_prep_dma_memcpy(struct dma_chan *chan, dma_addr_t dest, dma_addr_t src,
+			 size_t len, unsigned long flags)
+{
+	struct sprd_dma_chn *schan = to_sprd_dma_chan(chan);
+	struct sprd_dma_desc *sdesc;
+	u32 i, nr_segs = DIV_ROUND_UP(len, SPRD_DMA_MEMCPY_MAX_LEN);
+	size_t seg_len;
+
+	if (!len)
+		return NULL;
+
+	sdesc = sprd_dma_alloc_memcpy_desc(schan, nr_segs);
+	if (!sdesc)
+		return NULL;
+
+	for (i = 0; i < nr_segs; i++) {
+		seg_len = min_t(size_t, len, SPRD_DMA_MEMCPY_MAX_LEN);
+		sprd_dma_fill_memcpy(sprd_dma_memcpy_seg(sdesc, i), dest, src,
+				     seg_len);
+		dest += seg_len;
+		src += seg_len;
+		len -= seg_len;
+	}
+	sdesc->nr_segs = nr_segs - 1;
 
 	return vchan_tx_prep(&schan->vc, &sdesc->vd, flags);
 }
 
+/*
+ * Scatter-gather to scatter-gather memcpy. The channel runs one
+ * configuration per contiguous piece and only interrupts the cpu between
+ * them, the callback comes once when the whole list has been copied.
+ */
+struct dma_async_tx_descriptor *
+sprd_dma_prep_memcpy_sg(struct dma_chan *chan,
+			struct scatterlist *dst_sg, unsigned int dst_nents,
+			struct scatterlist *src_sg, unsigned int src_nents,
+			unsigned long flags)
+{
+	struct sprd_dma_chn *schan = to_sprd_dma_chan(chan);
+	struct scatterlist *sg;
+	struct sprd_dma_desc *sdesc;
+	size_t dst_len, src_len, len;
+	dma_addr_t dst, src;
+	u32 i, nr_segs;
+
+	if (chan->device->device_prep_dma_memcpy != sprd_dma_prep_dma_memcpy ||
+	    !dst_nents || !src_nents)
+		return NULL;
+
+	/* every sg boundary of either list starts a new configuration */
+	nr_segs = 0;
+	for_each_sg(dst_sg, sg, dst_nents, i)
+		nr_segs += DIV_ROUND_UP(sg_dma_len(sg), SPRD_DMA_MEMCPY_MAX_LEN);
+	for_each_sg(src_sg, sg, src_nents, i)
+		nr_segs += DIV_ROUND_UP(sg_dma_len(sg), SPRD_DMA_MEMCPY_MAX_LEN);
+
+	sdesc = sprd_dma_alloc_memcpy_desc(schan, nr_segs);
+	if (!sdesc)
+		return NULL;
+
+	dst = sg_dma_address(dst_sg);
+	dst_len = sg_dma_len(dst_sg);
+	src = sg_dma_address(src_sg);
+	src_len = sg_dma_len(src_sg);
+
+	i = 0;
+	while (true) {
+		len = min3(dst_len, src_len, (size_t)SPRD_DMA_MEMCPY_MAX_LEN);
+		if (len) {
+			sprd_dma_fill_memcpy(sprd_dma_memcpy_seg(sdesc, i++),
+					     dst, src, len);
+			dst += len;
+			dst_len -= len;
+			src += len;
+			src_len -= len;
+		}
+
+		if (!dst_len) {
+			if (!--dst_nents)
+				break;
+			dst_sg = sg_next(dst_sg);
+			dst = sg_dma_address(dst_sg);
+			dst_len = sg_dma_len(dst_sg);
+		}
+
+		if (!src_len) {
+			if (!--src_nents)
+				break;
+			src_sg = sg_next(src_sg);
+			src = sg_dma_address(src_sg);
+			src_len = sg_dma_len(src_sg);
+		}
+	}
+
+	if (!i) {
+		sprd_dma_free_desc(&sdesc->vd);
+		return NULL;
+	}
+	sdesc->nr_segs = i - 1;
+
+	return vchan_tx_prep(&schan->vc, &sdesc->vd, flags);
+}
+EXPORT_SYMBOL_GPL(sprd_dma_prep_memcpy_sg);
+
 static struct dma_async_tx_descriptor *
 sprd_dma_prep_slave_sg(struct dma_chan *chan, struct scatterlist *sgl,
 		       unsigned int sglen, enum dma_transfer_direction dir,
@@ -1080,7 +1286,7 @@ sprd_dma_prep_slave_sg(struct dma_chan *chan, struct scatterlist *sgl,
 		schan->int_type = flags & SPRD_DMA_INT_TYPE_MASK;
 	}
 
-	sdesc = kzalloc(sizeof(*sdesc), GFP_NOWAIT);
+	sdesc = sprd_dma_alloc_desc(schan);
 	if (!sdesc)
 		return NULL;
 
@@ -1136,6 +1342,7 @@ static int sprd_dma_slave_config(struct dma_chan *chan,
 		return -EINVAL;
 
 	memcpy(slave_cfg, config, sizeof(*config));
+	schan->tmpl_valid = false;
 	return 0;
 }
 
@@ -1189,8 +1396,14 @@ static int sprd_dma_terminate_all(struct dma_chan *chan)
 
 static void sprd_dma_free_desc(struct virt_dma_desc *vd)
 {
+	struct sprd_dma_chn *schan = to_sprd_dma_chan(vd->tx.chan);
 	struct sprd_dma_desc *sdesc = to_sprd_dma_desc(vd);
 
+	kfree(sdesc->segs);
+	sdesc->segs = NULL;
+
+	/* keep one descriptor around for the next prep on this channel */
+	sdesc = xchg(&schan->spare_desc, sdesc);
 	kfree(sdesc);
 }
 
@@ -1218,6 +1431,9 @@ static int sprd_dma_probe(struct platform_device *pdev)
 	u32 chn_count;
 	int ret, i;
 
+	BUILD_BUG_ON(sizeof(struct sprd_dma_chn_hw) !=
+		     SPRD_DMA_LINKLIST_NODE_SIZE);
+
 	ret = device_property_read_u32(&pdev->dev, "#dma-channels", &chn_count);
 	if (ret) {
 		dev_err(&pdev->dev, "get dma channels count failed\n");
@@ -96,6 +96,8 @@ struct sprd_eic {
 	enum sprd_eic_type type;
 	spinlock_t lock;
 	int irq;
+	/* edge lines of the debounce and latch EICs, emulated by toggling */
+	u8 toggle[SPRD_EIC_MAX_BANK];
 };
 
 struct sprd_eic_variant_data {
@@ -136,6 +138,8 @@ static const char *sprd_eic_label_name[SPRD_EIC_MAX] = {
 	"eic-sync",
 };
 
+/* the sub-modules sharing the parent interrupt, looked up by the handler */
+static struct sprd_eic *sprd_eic_types[SPRD_EIC_MAX];
 
 static inline void __iomem *sprd_eic_offset_base(struct sprd_eic *sprd_eic,
 						 unsigned int bank)
@@ -296,23 +300,47 @@ static void sprd_eic_irq_ack(struct irq_data *data)
 	struct gpio_chip *chip = irq_data_get_irq_chip_data(data);
 	struct sprd_eic *sprd_eic = gpiochip_get_data(chip);
 	u32 offset = irqd_to_hwirq(data);
+	void __iomem *base =
+		sprd_eic_offset_base(sprd_eic, offset / SPRD_EIC_PER_BANK_NR);
+	u16 reg;
 
 	switch (sprd_eic->type) {
 	case SPRD_EIC_DEBOUNCE:
-		sprd_eic_update(chip, offset, SPRD_EIC_DBNC_IC, 1);
+		reg = SPRD_EIC_DBNC_IC;
 		break;
 	case SPRD_EIC_LATCH:
-		sprd_eic_update(chip, offset, SPRD_EIC_LATCH_INTCLR, 1);
+		reg = SPRD_EIC_LATCH_INTCLR;
 		break;
 	case SPRD_EIC_ASYNC:
-		sprd_eic_update(chip, offset, SPRD_EIC_ASYNC_INTCLR, 1);
+		reg = SPRD_EIC_ASYNC_INTCLR;
 		break;
 	case SPRD_EIC_SYNC:
-		sprd_eic_update(chip, offset, SPRD_EIC_SYNC_INTCLR, 1);
+		reg = SPRD_EIC_SYNC_INTCLR;
 		break;
 	default:
 		dev_err(chip->parent, "Unsupported EIC type.\n");
+		return;
 	}
+
+	/*
+	 * The clear registers are write 1 to clear, a plain write of the one
+	 * bit needs no lock and leaves the other lines pending.
+	 */
+	writel_relaxed(BIT(SPRD_EIC_BIT(offset)), base + reg);
+}
+
+static void sprd_eic_set_toggle(struct sprd_eic *sprd_eic, unsigned int offset,
+				bool toggle)
+{
+	unsigned int bank = offset / SPRD_EIC_PER_BANK_NR;
+	unsigned long flags;
+
+	spin_lock_irqsave(&sprd_eic->lock, flags);
+	if (toggle)
+		sprd_eic->toggle[bank] |= BIT(SPRD_EIC_BIT(offset));
+	else
+		sprd_eic->toggle[bank] &= ~BIT(SPRD_EIC_BIT(offset));
+	spin_unlock_irqrestore(&sprd_eic->lock, flags);
 }
 
 static int sprd_eic_irq_set_type(struct irq_data *data, unsigned int flow_type)
@@ -346,6 +374,8 @@ static int sprd_eic_irq_set_type(struct irq_data *data, unsigned int flow_type)
 			return -ENOTSUPP;
 		}
 
+		sprd_eic_set_toggle(sprd_eic, offset,
+				    flow_type & IRQ_TYPE_EDGE_BOTH);
 		irq_set_handler_locked(data, handle_level_irq);
 		break;
 	case SPRD_EIC_LATCH:
@@ -371,6 +401,8 @@ static int sprd_eic_irq_set_type(struct irq_data *data, unsigned int flow_type)
 			return -ENOTSUPP;
 		}
 
+		sprd_eic_set_toggle(sprd_eic, offset,
+				    flow_type & IRQ_TYPE_EDGE_BOTH);
 		irq_set_handler_locked(data, handle_level_irq);
 		break;
 	case SPRD_EIC_ASYNC:
@@ -451,71 +483,63 @@ static int sprd_eic_irq_set_type(struct irq_data *data, unsigned int flow_type)
 	return 0;
 }
 
-static void sprd_eic_toggle_trigger(struct gpio_chip *chip, unsigned int irq,
-				    unsigned int offset)
+/*
+ * The debounce EIC and latch EIC can only support level trigger, so we
+ * toggle the level of the edge lines that fired to emulate the edge
+ * trigger, all of a bank with one read-modify-write.
+ */
+static void sprd_eic_toggle_bank(struct sprd_eic *sprd_eic, unsigned int bank,
+				 u32 toggle)
 {
-	struct sprd_eic *sprd_eic = gpiochip_get_data(chip);
-	struct irq_data *data = irq_get_irq_data(irq);
-	u32 trigger = irqd_get_trigger_type(data);
-	int state, post_state;
-
-	/*
-	 * The debounce EIC and latch EIC can only support level trigger, so we
-	 * can toggle the level trigger to emulate the edge trigger.
-	 */
-	if ((sprd_eic->type != SPRD_EIC_DEBOUNCE &&
-	     sprd_eic->type != SPRD_EIC_LATCH) ||
-	    !(trigger & IRQ_TYPE_EDGE_BOTH))
-		return;
+	void __iomem *base = sprd_eic->base[bank];
+	u32 state, post_state, val;
 
-	sprd_eic_irq_mask(data);
-	state = sprd_eic_get(chip, offset);
+	spin_lock(&sprd_eic->lock);
 
-retry:
-	switch (sprd_eic->type) {
-	case SPRD_EIC_DEBOUNCE:
-		if (state)
-			sprd_eic_update(chip, offset, SPRD_EIC_DBNC_IEV, 0);
-		else
-			sprd_eic_update(chip, offset, SPRD_EIC_DBNC_IEV, 1);
-		break;
-	case SPRD_EIC_LATCH:
-		if (state)
-			sprd_eic_update(chip, offset, SPRD_EIC_LATCH_INTPOL, 0);
-		else
-			sprd_eic_update(chip, offset, SPRD_EIC_LATCH_INTPOL, 1);
-		break;
-	default:
-		sprd_eic_irq_unmask(data);
-		return;
+	if (sprd_eic->type == SPRD_EIC_LATCH) {
+		/*
+		 * The latch EIC has no data register, but the line fired at
+		 * its current polarity, so it is enough to flip it.
+		 */
+		val = readl_relaxed(base + SPRD_EIC_LATCH_INTPOL);
+		writel_relaxed(val ^ toggle, base + SPRD_EIC_LATCH_INTPOL);
+		goto out;
 	}
 
-	post_state = sprd_eic_get(chip, offset);
-	if (state != post_state) {
-		dev_warn(chip->parent, "EIC level was changed.\n");
-		state = post_state;
-		goto retry;
-	}
+	state = readl_relaxed(base + SPRD_EIC_DBNC_DATA);
+	for (;;) {
+		val = readl_relaxed(base + SPRD_EIC_DBNC_IEV) & ~toggle;
+		writel_relaxed(val | (~state & toggle),
+			       base + SPRD_EIC_DBNC_IEV);
 
-	sprd_eic_irq_unmask(data);
-}
+		post_state = readl_relaxed(base + SPRD_EIC_DBNC_DATA);
+		if (!((state ^ post_state) & toggle))
+			break;
 
-static int sprd_eic_match_chip_by_type(struct gpio_chip *chip, void *data)
-{
-	enum sprd_eic_type type = *(enum sprd_eic_type *)data;
+		dev_warn_ratelimited(sprd_eic->chip.parent,
+				     "EIC level was changed.\n");
+		state = post_state;
+	}
 
-	return !strcmp(chip->label, sprd_eic_label_name[type]);
+	/* re-arm the single trigger of the lines left unmasked */
+	val = readl_relaxed(base + SPRD_EIC_DBNC_IE) & toggle;
+	if (val)
+		writel_relaxed(readl_relaxed(base + SPRD_EIC_DBNC_TRIG) | val,
+			       base + SPRD_EIC_DBNC_TRIG);
+out:
+	spin_unlock(&sprd_eic->lock);
 }
 
-static void sprd_eic_handle_one_type(struct gpio_chip *chip)
+static void sprd_eic_handle_one_type(struct sprd_eic *sprd_eic)
 {
-	struct sprd_eic *sprd_eic = gpiochip_get_data(chip);
-	u32 bank, n, girq;
+	struct gpio_chip *chip = &sprd_eic->chip;
+	u32 bank, n, girq, toggle;
 
 	for (bank = 0; bank * SPRD_EIC_PER_BANK_NR < chip->ngpio; bank++) {
 		void __iomem *base = sprd_eic_offset_base(sprd_eic, bank);
 		unsigned long reg;
 
+		/* the masked status only needs reading, no lock on this path */
 		switch (sprd_eic->type) {
 		case SPRD_EIC_DEBOUNCE:
 			reg = readl_relaxed(base + SPRD_EIC_DBNC_MIS) &
@@ -538,21 +562,27 @@ static void sprd_eic_handle_one_type(struct gpio_chip *chip)
 			return;
 		}
 
+		if (!reg)
+			continue;
+
 		for_each_set_bit(n, &reg, SPRD_EIC_PER_BANK_NR) {
 			u32 offset = bank * SPRD_EIC_PER_BANK_NR + n;
 
 			girq = irq_find_mapping(chip->irq.domain, offset);
 
 			generic_handle_irq(girq);
-			sprd_eic_toggle_trigger(chip, girq, offset);
 		}
+
+		toggle = reg & READ_ONCE(sprd_eic->toggle[bank]);
+		if (toggle)
+			sprd_eic_toggle_bank(sprd_eic, bank, toggle);
 	}
 }
 
 static void sprd_eic_irq_handler(struct irq_desc *desc)
 {
 	struct irq_chip *ic = irq_desc_get_chip(desc);
-	struct gpio_chip *chip;
+	struct sprd_eic *sprd_eic;
 	enum sprd_eic_type type;
 
 	chained_irq_enter(ic, desc);
@@ -563,16 +593,23 @@ static void sprd_eic_irq_handler(struct irq_desc *desc)
 	 * EIC module to check if there are EIC interrupts were triggered.
 	 */
 	for (type = SPRD_EIC_DEBOUNCE; type < SPRD_EIC_MAX; type++) {
-		chip = gpiochip_find(&type, sprd_eic_match_chip_by_type);
-		if (!chip)
+		sprd_eic = READ_ONCE(sprd_eic_types[type]);
+		if (!sprd_eic)
 			continue;
 
-		sprd_eic_handle_one_type(chip);
+		sprd_eic_handle_one_type(sprd_eic);
 	}
 
 	chained_irq_exit(ic, desc);
 }
 
+static void sprd_eic_unpublish(void *data)
+{
+	struct sprd_eic *sprd_eic = data;
+
+	WRITE_ONCE(sprd_eic_types[sprd_eic->type], NULL);
+}
+
 static int sprd_eic_probe(struct platform_device *pdev)
 {
 	const struct sprd_eic_variant_data *pdata;
@@ -662,6 +699,12 @@ static int sprd_eic_probe(struct platform_device *pdev)
 		return ret;
 	}
 
+	WRITE_ONCE(sprd_eic_types[sprd_eic->type], sprd_eic);
+	ret = devm_add_action_or_reset(&pdev->dev, sprd_eic_unpublish,
+				       sprd_eic);
+	if (ret)
+		return ret;
+
 	platform_set_drvdata(pdev, sprd_eic);
 	return 0;
 }
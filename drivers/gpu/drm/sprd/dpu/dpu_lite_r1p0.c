@@ -163,17 +163,20 @@ static int dpu_parse_dt(struct dpu_context *ctx,
 
 static void dpu_corner_init(struct dpu_context *ctx)
 {
-	static bool corner_is_inited;
-
-	if (!corner_is_inited && sprd_corner_support) {
-		sprd_corner_hwlayer_init(ctx->vm.vactive, ctx->vm.hactive,
-				sprd_corner_radius);
+	if (!sprd_corner_support)
+		return;
 
-		/* change id value based on different cpu chip */
-		corner_layer_top.index = 4;
-		corner_layer_bottom.index = 5;
-		corner_is_inited = 1;
+	/* cheap once the masks are drawn, only redraws for a new width */
+	if (sprd_corner_hwlayer_init(ctx->vm.vactive, ctx->vm.hactive,
+				     sprd_corner_radius)) {
+		pr_err("round corner mask alloc failed\n");
+		sprd_corner_support = false;
+		return;
 	}
+
+	/* change id value based on different cpu chip */
+	corner_layer_top.index = 4;
+	corner_layer_bottom.index = 5;
 }
 
 static void dpu_dump(struct dpu_context *ctx)
@@ -1683,6 +1683,21 @@ static void dpu_enhance_reload(struct dpu_context *ctx)
 	reg->dpu_enhance_cfg = enhance_en;
 }
 
+static void dpu_vfp_update(struct dpu_context *ctx)
+{
+	struct dpu_reg *reg = (struct dpu_reg *)ctx->base;
+
+	reg->dpi_v_timing = (ctx->vm.vsync_len << 0) |
+			    (ctx->vm.vback_porch << 8) |
+			    (ctx->vm.vfront_porch << 20);
+
+	/* the new porch is latched at the next frame boundary */
+	if (!ctx->is_stopped) {
+		reg->dpu_ctrl |= BIT(2);
+		dpu_wait_update_done(ctx);
+	}
+}
+
 static int dpu_modeset(struct dpu_context *ctx,
 		struct drm_mode_modeinfo *mode)
 {
@@ -1741,6 +1756,7 @@ static struct dpu_core_ops dpu_lite_r2p0_ops = {
 	.enhance_set = dpu_enhance_set,
 	.enhance_get = dpu_enhance_get,
 	.modeset = dpu_modeset,
+	.vfp_update = dpu_vfp_update,
 	.write_back = dpu_write_back,
 	.check_raw_int = dpu_check_raw_int,
 };
@@ -314,18 +314,20 @@ static int dpu_parse_dt(struct dpu_context *ctx,
 
 static void dpu_corner_init(struct dpu_context *ctx)
 {
-	static bool corner_is_inited;
-
-	if (!corner_is_inited && sprd_corner_support) {
-		sprd_corner_hwlayer_init(ctx->vm.vactive, ctx->vm.hactive,
-				sprd_corner_radius);
+	if (!sprd_corner_support)
+		return;
 
-		/* change id value based on different cpu chip */
-		corner_layer_top.index = 5;
-		corner_layer_bottom.index = 6;
-		corner_is_inited = 1;
+	/* cheap once the masks are drawn, only redraws for a new width */
+	if (sprd_corner_hwlayer_init(ctx->vm.vactive, ctx->vm.hactive,
+				     sprd_corner_radius)) {
+		pr_err("round corner mask alloc failed\n");
+		sprd_corner_support = false;
+		return;
 	}
 
+	/* change id value based on different cpu chip */
+	corner_layer_top.index = 5;
+	corner_layer_bottom.index = 6;
 }
 
 static u32 check_mmu_isr(struct dpu_context *ctx, u32 reg_val)
@@ -1622,6 +1624,21 @@ static void dpu_sr_config(struct dpu_context *ctx)
 }
 
 
+static void dpu_vfp_update(struct dpu_context *ctx)
+{
+	struct dpu_reg *reg = (struct dpu_reg *)ctx->base;
+
+	reg->dpi_v_timing = (ctx->vm.vsync_len << 0) |
+			    (ctx->vm.vback_porch << 8) |
+			    (ctx->vm.vfront_porch << 20);
+
+	/* the new porch is latched at the next frame boundary */
+	if (!ctx->is_stopped) {
+		reg->dpu_ctrl |= BIT(2);
+		dpu_wait_update_done(ctx);
+	}
+}
+
 static int dpu_modeset(struct dpu_context *ctx,
 		struct drm_mode_modeinfo *mode)
 {
@@ -1681,6 +1698,7 @@ static struct dpu_core_ops dpu_r2p0_ops = {
 	.enhance_set = dpu_enhance_set,
 	.enhance_get = dpu_enhance_get,
 	.modeset = dpu_modeset,
+	.vfp_update = dpu_vfp_update,
 	.check_raw_int = dpu_check_raw_int,
 };
 
@@ -309,6 +309,9 @@ static bool cabc_bl_set;
 static int cabc_disable = CABC_DISABLED;
 static int cabc_bl_set_delay;
 static struct cabc_para cabc_para;
+/* the cm coefficients the last cabc run left in the registers */
+static struct cm_cfg cabc_cm_applied;
+static bool cabc_cm_valid;
 static struct backlight_device *backlight;
 static int wb_en;
 static int wb_xfbc_en = 1;
@@ -329,7 +332,7 @@ static void dpu_enhance_reload(struct dpu_context *ctx);
 static void dpu_clean_all(struct dpu_context *ctx);
 static void dpu_layer(struct dpu_context *ctx,
 		    struct sprd_dpu_layer *hwlayer);
-static int dpu_cabc_trigger(struct dpu_context *ctx);
+static bool dpu_cabc_trigger(struct dpu_context *ctx);
 
 static u32 dpu_get_version(struct dpu_context *ctx)
 {
@@ -393,17 +396,20 @@ static int dpu_parse_dt(struct dpu_context *ctx,
 
 static void dpu_corner_init(struct dpu_context *ctx)
 {
-	static bool corner_is_inited;
-
-	if (!corner_is_inited && sprd_corner_support) {
-		sprd_corner_hwlayer_init(ctx->vm.vactive, ctx->vm.hactive,
-				sprd_corner_radius);
+	if (!sprd_corner_support)
+		return;
 
-		/* change id value based on different dpu chip */
-		corner_layer_top.index = 5;
-		corner_layer_bottom.index = 6;
-		corner_is_inited = 1;
+	/* cheap once the masks are drawn, only redraws for a new width */
+	if (sprd_corner_hwlayer_init(ctx->vm.vactive, ctx->vm.hactive,
+				     sprd_corner_radius)) {
+		pr_err("round corner mask alloc failed\n");
+		sprd_corner_support = false;
+		return;
 	}
+
+	/* change id value based on different dpu chip */
+	corner_layer_top.index = 5;
+	corner_layer_bottom.index = 6;
 }
 
 static void dpu_dump(struct dpu_context *ctx)
@@ -632,11 +638,15 @@ static void dpu_cabc_work_func(struct work_struct *data)
 		container_of(data, struct dpu_context, cabc_work);
 	struct dpu_reg *reg = (struct dpu_reg *)ctx->base;
 
+	/*
+	 * The register update waits for the next frame with the refresh
+	 * lock held, so a run that changes nothing must not stall the flips.
+	 */
 	down(&ctx->refresh_lock);
-	dpu_cabc_trigger(ctx);
-
-	reg->dpu_ctrl |= BIT(2);
-	dpu_wait_update_done(ctx);
+	if (dpu_cabc_trigger(ctx)) {
+		reg->dpu_ctrl |= BIT(2);
+		dpu_wait_update_done(ctx);
+	}
 
 	up(&ctx->refresh_lock);
 }
@@ -1605,6 +1615,7 @@ static void dpu_enhance_set(struct dpu_context *ctx, u32 id, void *param)
 	case ENHANCE_CFG_ID_CM:
 		memcpy(&cm_copy, param, sizeof(cm_copy));
 		memcpy(&cm, &cm_copy, sizeof(struct cm_cfg));
+		cabc_cm_valid = false;
 		if (cabc_para.gain) {
 			cm.coef00 = (cm.coef00 * cabc_para.gain) / 0x400;
 			cm.coef11 = (cm.coef11 * cabc_para.gain) / 0x400;
@@ -1974,7 +1985,8 @@ static void dpu_sr_config(struct dpu_context *ctx)
 	}
 }
 
-static int dpu_cabc_trigger(struct dpu_context *ctx)
+/* returns true if the registers need an update */
+static bool dpu_cabc_trigger(struct dpu_context *ctx)
 {
 	struct dpu_reg *reg = (struct dpu_reg *)ctx->base;
 	struct cm_cfg cm;
@@ -1983,6 +1995,7 @@ static int dpu_cabc_trigger(struct dpu_context *ctx)
 
 	if (cabc_disable) {
 		if ((cabc_disable == CABC_STOPPING) && backlight) {
+			cabc_cm_valid = false;
 			memset(&cabc_para, 0, sizeof(cabc_para));
 			memcpy(&cm, &cm_copy, sizeof(struct cm_cfg));
 			reg->cm_coef01_00 = (cm.coef01 << 16) | cm.coef00;
@@ -1995,11 +2008,14 @@ static int dpu_cabc_trigger(struct dpu_context *ctx)
 			cabc_bl_set = true;
 
 			cabc_disable = CABC_DISABLED;
+			return true;
 		}
-		return 0;
+		return false;
 	}
 
 	if (frame_no == 0) {
+		/* the reload after resume wrote cm_copy without the gain */
+		cabc_cm_valid = false;
 		if (!backlight) {
 			backlight_node = of_parse_phandle(g_np,
 						 "sprd,backlight", 0);
@@ -2059,19 +2075,41 @@ static int dpu_cabc_trigger(struct dpu_context *ctx)
 			cm.coef11 = (cm.coef11 * cabc_para.gain) / 0x400;
 			cm.coef22 = (cm.coef22 * cabc_para.gain) / 0x400;
 		}
+		if (backlight)
+			cabc_bl_set = true;
+
+		if (frame_no == 1)
+			frame_no++;
+
+		/* the backlight goes on the vsync work, only cm needs a frame */
+		if (cabc_cm_valid && !memcmp(&cm, &cabc_cm_applied, sizeof(cm)))
+			return false;
+
 		reg->cm_coef01_00 = (cm.coef01 << 16) | cm.coef00;
 		reg->cm_coef03_02 = (cm.coef03 << 16) | cm.coef02;
 		reg->cm_coef11_10 = (cm.coef11 << 16) | cm.coef10;
 		reg->cm_coef13_12 = (cm.coef13 << 16) | cm.coef12;
 		reg->cm_coef21_20 = (cm.coef21 << 16) | cm.coef20;
 		reg->cm_coef23_22 = (cm.coef23 << 16) | cm.coef22;
-		if (backlight)
-			cabc_bl_set = true;
+		cabc_cm_applied = cm;
+		cabc_cm_valid = true;
+	}
+	return true;
+}
 
-		if (frame_no == 1)
-			frame_no++;
+static void dpu_vfp_update(struct dpu_context *ctx)
+{
+	struct dpu_reg *reg = (struct dpu_reg *)ctx->base;
+
+	reg->dpi_v_timing = (ctx->vm.vsync_len << 0) |
+			    (ctx->vm.vback_porch << 8) |
+			    (ctx->vm.vfront_porch << 20);
+
+	/* the new porch is latched at the next frame boundary */
+	if (!ctx->is_stopped) {
+		reg->dpu_ctrl |= BIT(2);
+		dpu_wait_update_done(ctx);
 	}
-	return 0;
 }
 
 static int dpu_modeset(struct dpu_context *ctx,
@@ -2132,6 +2170,7 @@ static struct dpu_core_ops dpu_r3p0_ops = {
 	.enhance_set = dpu_enhance_set,
 	.enhance_get = dpu_enhance_get,
 	.modeset = dpu_modeset,
+	.vfp_update = dpu_vfp_update,
 	.write_back = dpu_write_back,
 };
 
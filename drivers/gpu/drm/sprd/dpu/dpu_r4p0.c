@@ -12,6 +12,7 @@
  */
 
 #include <linux/delay.h>
+#include <linux/of_address.h>
 #include <linux/wait.h>
 #include <linux/workqueue.h>
 #include "sprd_dpu.h"
@@ -34,7 +35,6 @@
 #define XFBC565_BUFFER_SIZE(w, h) (XFBC565_HEADER_SIZE(w, h) \
 				+ XFBC565_PAYLOAD_SIZE(w, h))
 
-#define update_work	wb_work
 
 struct layer_reg {
 	u32 addr[4];
@@ -320,6 +320,15 @@ static struct hsv_lut hsv_copy;
 static struct epf_cfg epf_copy;
 static u32 enhance_en;
 
+/*
+ * Last value written to each layer register, a flip only writes the
+ * ones that changed. Most flips just move a buffer address. layer_next
+ * is where dpu_layer() stages the next frame.
+ */
+static struct layer_reg layer_shadow[8];
+static struct layer_reg layer_next[8];
+static bool layer_shadow_valid;
+
 static DECLARE_WAIT_QUEUE_HEAD(wait_queue);
 static bool panel_ready = true;
 static bool need_scale;
@@ -327,22 +336,21 @@ static bool need_scale;
 static bool evt_update;
 static bool evt_stop;
 static int wb_en;
+static int wb_xfbc_en = 1;
 static int max_vsync_count;
 static int vsync_count;
-//static struct sprd_adf_hwlayer wb_layer;
-//static struct wb_region region[3];
-//static int wb_xfbc_en = 1;
+static struct sprd_dpu_layer wb_layer;
+static struct wb_region region[3];
 //static bool sprd_corner_support;
 //static int sprd_corner_radius;
-//module_param(wb_xfbc_en, int, 0644);
-//module_param(max_vsync_count, int, 0644);
+module_param(wb_xfbc_en, int, 0644);
+module_param(max_vsync_count, int, 0644);
 
 static void dpu_enhance_reload(struct dpu_context *ctx);
 static void dpu_clean_all(struct dpu_context *ctx);
 static void dpu_layer(struct dpu_context *ctx,
 		    struct sprd_dpu_layer *hwlayer);
-//static void dpu_write_back(struct dpu_context *ctx,
-//		struct wb_region region[], u8 count);
+static void dpu_layer_commit(struct dpu_context *ctx);
 
 static u32 dpu_get_version(struct dpu_context *ctx)
 {
@@ -383,6 +391,12 @@ static void check_mmu_isr(struct dpu_context *ctx, u32 reg_val)
 {
 }
 
+static inline void work_now(struct work_struct *work)
+{
+	if (work->func)
+		schedule_work(work);
+}
+
 static u32 dpu_isr(struct dpu_context *ctx)
 {
 	struct dpu_reg *reg = (struct dpu_reg *)ctx->base;
@@ -404,10 +418,8 @@ static u32 dpu_isr(struct dpu_context *ctx)
 	/* dpu vsync isr */
 	if (reg_val & DISPC_INT_DPI_VSYNC_MASK) {
 		/* write back feature */
-		if (vsync_count == max_vsync_count && wb_en) {
-			//dpu_write_back(ctx, region, 1);
-			schedule_work(&ctx->update_work);
-		}
+		if ((vsync_count == max_vsync_count) && wb_en)
+			work_now(&ctx->wb_work);
 		vsync_count++;
 	}
 
@@ -419,28 +431,28 @@ static u32 dpu_isr(struct dpu_context *ctx)
 
 	/* dpu write back done isr */
 	if (reg_val & DISPC_INT_WB_DONE_MASK) {
-		wb_en = false;
 		/*
 		 * The write back is a time-consuming operation. If there is a
 		 * flip occurs before write back done, the write back buffer is
-		 * no need to display. Or the new frame will be covered by the
-		 * write back buffer, which is not we wanted.
+		 * no need to display. Otherwise the new frame will be covered
+		 * by the write back buffer, which is not what we wanted.
 		 */
-		if (vsync_count > max_vsync_count) {
-			dpu_clean_all(ctx);
-			//dpu_layer(ctx, &wb_layer);
-			schedule_work(&ctx->update_work);
-			/*reg_val |= DISPC_INT_FENCE_SIGNAL_REQUEST;*/
+		if ((vsync_count > max_vsync_count) && wb_en) {
+			wb_en = false;
+			schedule_work(&ctx->wb_work);
 		}
+
 		pr_debug("wb done\n");
 	}
 
 	/* dpu write back error isr */
 	if (reg_val & DISPC_INT_WB_FAIL_MASK) {
 		pr_err("dpu write back fail\n");
-		/*give a new chance to write back*/
-		wb_en = true;
-		vsync_count = 0;
+		/* give a new chance for write back */
+		if (max_vsync_count > 0) {
+			wb_en = true;
+			vsync_count = 0;
+		}
 	}
 
 	/* dpu ifbc payload error isr */
@@ -536,63 +548,157 @@ static void dpu_run(struct dpu_context *ctx)
 	}
 }
 
-#if 0
 static void dpu_write_back(struct dpu_context *ctx,
-		struct wb_region region[], u8 count)
+		u8 count, bool debug)
 {
+	int i, index;
 	struct dpu_reg *reg = (struct dpu_reg *)ctx->base;
-	u16 w, h;
-
-	if (count == 0)
-		return;
-
-	w = reg->blend_size & 0xFFFF;
-	h = reg->blend_size >> 16;
-
-	wb_layer.dst_w = w;
-	wb_layer.dst_h = h;
-	wb_layer.compression = wb_xfbc_en;
-	wb_layer.header_size_r = XFBC8888_HEADER_SIZE(w, h);
-	wb_layer.pitch[0] = w * 4;
-
-	reg->region[0].pos = 0;
-	reg->region[0].size = (w >> 3) | ((h >> 3) << 16);
-	reg->wb_ctrl = BIT(0);
-	reg->wb_pitch = w;
+	int mode_width  = reg->blend_size & 0xFFFF;
+	int mode_height = reg->blend_size >> 16;
+
+	region[0].index = 0;
+	region[0].pos_x = 0;
+	region[0].pos_y = 0;
+	region[0].size_w = ALIGN(mode_width, 8);
+	region[0].size_h = ALIGN(mode_height, 8);
+
+	wb_layer.dst_w = mode_width;
+	wb_layer.dst_h = mode_height;
+	wb_layer.pitch[0] = ALIGN(mode_width, 8) * 4;
+	wb_layer.xfbc = wb_xfbc_en;
+	wb_layer.header_size_r = XFBC8888_HEADER_SIZE(ALIGN(mode_width, 8),
+						      ALIGN(mode_height, 8));
+
+	for (i = 0; i < count; i++) {
+		index = region[i].index;
+		reg->region[index].pos = (region[i].pos_x >> 3) |
+					((region[i].pos_y >> 3) << 16);
+		reg->region[index].size = (region[i].size_w >> 3) |
+					((region[i].size_h >> 3) << 16);
+	}
 
-	if (wb_xfbc_en) {
+	reg->wb_pitch = mode_width;
+	if (wb_xfbc_en && !debug) {
 		reg->wb_cfg = (2 << 1) | BIT(0);
-		reg->wb_base_addr = wb_layer.iova_plane[0] +
+		reg->wb_base_addr = wb_layer.addr[0] +
 				wb_layer.header_size_r;
 	} else {
 		reg->wb_cfg = 0;
-		reg->wb_base_addr = wb_layer.iova_plane[0];
+		reg->wb_base_addr = wb_layer.addr[0];
+	}
+
+	/* update trigger */
+	reg->dpu_ctrl |= BIT(2);
+
+	if (debug)
+		/* writeback debug trigger */
+		reg->wb_ctrl = BIT(3);
+	else {
+		/* writeback trigger */
+		for (i = 0; i < count; i++) {
+			index = region[i].index;
+			reg->wb_ctrl |= 1 << index;
+		}
 	}
+
+	dpu_wait_update_done(ctx);
+
+	pr_debug("write back trigger\n");
 }
 
-static void writeback_update_handler(struct work_struct *data)
+/*
+ * Scan out the composed frame from the write back buffer on layer 0
+ * alone, the other layers stop fetching until the next flip brings
+ * them back through the layer shadow.
+ */
+static void dpu_wb_flip(struct dpu_context *ctx)
 {
-	int ret;
-	struct dpu_context *ctx =
-		container_of(data, struct dpu_context, update_work);
 	struct dpu_reg *reg = (struct dpu_reg *)ctx->base;
+	int i;
 
-	ret = down_trylock(&ctx->refresh_lock);
-	if (ret != 1) {
-		reg->dpu_ctrl |= BIT(2);
-		dpu_wait_update_done(ctx);
+	memcpy(layer_next, layer_shadow, sizeof(layer_next));
+	for (i = 0; i < 8; i++)
+		layer_next[i].ctrl = 0;
+
+	dpu_layer(ctx, &wb_layer);
+	dpu_layer_commit(ctx);
+
+	reg->dpu_ctrl |= BIT(2);
+	dpu_wait_update_done(ctx);
+
+	pr_debug("write back flip\n");
+}
+
+static void dpu_wb_work_func(struct work_struct *data)
+{
+	struct dpu_context *ctx =
+		container_of(data, struct dpu_context, wb_work);
+
+	down(&ctx->refresh_lock);
+
+	if (!ctx->is_inited) {
 		up(&ctx->refresh_lock);
-	} else
-		pr_debug("cannot acquire lock for wb_lock\n");
+		pr_err("dpu is not initialized\n");
+		return;
+	}
+
+	if (ctx->disable_flip) {
+		up(&ctx->refresh_lock);
+		pr_warn("dpu flip is disabled\n");
+		return;
+	}
+
+	/* a flip since the work was queued makes the copy stale */
+	if (vsync_count > max_vsync_count) {
+		if (wb_en)
+			dpu_write_back(ctx, 1, false);
+		else
+			dpu_wb_flip(ctx);
+	}
+
+	up(&ctx->refresh_lock);
+}
+
+static int dpu_wb_buf_alloc(struct sprd_dpu *dpu, size_t size,
+			 u32 *paddr)
+{
+	struct device_node *node;
+	u64 size64;
+	struct resource r;
+	int ret = 0;
+
+	node = of_parse_phandle(dpu->dev.of_node,
+					"sprd,wb-memory", 0);
+	if (!node) {
+		pr_info("no sprd,wb-memory specified\n");
+		return -EINVAL;
+	}
+
+	if (of_address_to_resource(node, 0, &r)) {
+		pr_err("invalid wb reserved memory node!\n");
+		ret = -EINVAL;
+		goto OF_EXIT;
+	}
+
+	*paddr = r.start;
+	size64 = resource_size(&r);
+
+	if (size64 < size) {
+		pr_err("unable to obtain enough wb memory\n");
+		ret = -ENOMEM;
+		goto OF_EXIT;
+	}
+
+OF_EXIT:
+	of_node_put(node);
+	return ret;
 }
 
 static int dpu_write_back_config(struct dpu_context *ctx)
 {
 	int ret;
+	size_t buf_size;
 	static int need_config = 1;
-	struct panel_info *panel = ctx->panel;
-	u32 wb_addr_v;
-	size_t wb_buf_size;
 	struct sprd_dpu *dpu =
 		(struct sprd_dpu *)container_of(ctx, struct sprd_dpu, ctx);
 
@@ -601,27 +707,28 @@ static int dpu_write_back_config(struct dpu_context *ctx)
 		return 0;
 	}
 
-	wb_buf_size = XFBC8888_BUFFER_SIZE(panel->width, panel->height);
-	ret = sprd_dpu_wb_buf_alloc(dpu, ION_HEAP_ID_MASK_FB,
-					&wb_buf_size, &(wb_addr_v));
-	if (ret)
+	buf_size = XFBC8888_BUFFER_SIZE(ALIGN(ctx->vm.hactive, 8),
+					ALIGN(ctx->vm.vactive, 8));
+	pr_info("Need to alloc new buffer for writeback: 0x%zx\n", buf_size);
+
+	ret = dpu_wb_buf_alloc(dpu, buf_size, &ctx->wb_addr_p);
+	if (ret) {
+		max_vsync_count = 0;
 		return -1;
+	}
 
-	wb_layer.hwlayer_id = 7;
-	wb_layer.n_planes = 1;
+	wb_layer.index = 0;
+	wb_layer.planes = 1;
 	wb_layer.alpha = 0xff;
-	wb_layer.format = DRM_FORMAT_ABGR8888;
-	wb_layer.iova_plane[0] = wb_addr_v;
 
-	max_vsync_count = 0;
+	wb_layer.addr[0] = ctx->wb_addr_p;
+	wb_layer.format = DRM_FORMAT_ABGR8888;
+	max_vsync_count = 4;
 	need_config = 0;
-
-	pr_info("wb_xfbc_en = %d\n", wb_xfbc_en);
-	INIT_WORK(&ctx->update_work, writeback_update_handler);
+	INIT_WORK(&ctx->wb_work, dpu_wb_work_func);
 
 	return 0;
 }
-#endif
 
 static int dpu_init(struct dpu_context *ctx)
 {
@@ -640,6 +747,9 @@ static int dpu_init(struct dpu_context *ctx)
 	reg->dpu_cfg1 = 0x004466da;
 	reg->dpu_cfg2 = 0;
 
+	/* the layer registers may have lost their content */
+	layer_shadow_valid = false;
+
 	if (ctx->is_stopped)
 		dpu_clean_all(ctx);
 
@@ -647,7 +757,7 @@ static int dpu_init(struct dpu_context *ctx)
 
 	dpu_enhance_reload(ctx);
 
-	//dpu_write_back_config(ctx);
+	dpu_write_back_config(ctx);
 
 	return 0;
 }
@@ -799,8 +909,32 @@ static void dpu_clean_all(struct dpu_context *ctx)
 	int i;
 	struct dpu_reg *reg = (struct dpu_reg *)ctx->base;
 
-	for (i = 0; i < 8; i++)
+	for (i = 0; i < 8; i++) {
 		reg->layers[i].ctrl = 0;
+		layer_shadow[i].ctrl = 0;
+	}
+}
+
+static void dpu_layer_commit(struct dpu_context *ctx)
+{
+	struct dpu_reg *reg = (struct dpu_reg *)ctx->base;
+	u32 *hw, *shadow, *next;
+	int i, j;
+
+	for (i = 0; i < 8; i++) {
+		hw = (u32 *)&reg->layers[i];
+		shadow = (u32 *)&layer_shadow[i];
+		next = (u32 *)&layer_next[i];
+
+		for (j = 0; j < sizeof(struct layer_reg) / sizeof(u32); j++) {
+			if (layer_shadow_valid && shadow[j] == next[j])
+				continue;
+			hw[j] = next[j];
+			shadow[j] = next[j];
+		}
+	}
+
+	layer_shadow_valid = true;
 }
 
 static void dpu_bgcolor(struct dpu_context *ctx, u32 color)
@@ -826,12 +960,11 @@ static void dpu_bgcolor(struct dpu_context *ctx, u32 color)
 static void dpu_layer(struct dpu_context *ctx,
 		    struct sprd_dpu_layer *hwlayer)
 {
-	struct dpu_reg *reg = (struct dpu_reg *)ctx->base;
 	struct layer_reg *layer;
-	u32 size, offset, wd;
+	u32 addr, size, offset, wd;
 	int i;
 
-	layer = &reg->layers[hwlayer->index];
+	layer = &layer_next[hwlayer->index];
 	offset = (hwlayer->dst_x & 0xffff) | ((hwlayer->dst_y) << 16);
 
 	if (hwlayer->pallete_en) {
@@ -856,10 +989,16 @@ static void dpu_layer(struct dpu_context *ctx,
 		size = (hwlayer->dst_w & 0xffff) | ((hwlayer->dst_h) << 16);
 
 	for (i = 0; i < hwlayer->planes; i++) {
-		if (hwlayer->addr[i] % 16)
+		addr = hwlayer->addr[i];
+
+		/* xfbc is rgb only, the payload follows the header */
+		if (hwlayer->xfbc)
+			addr += hwlayer->header_size_r;
+
+		if (addr % 16)
 			pr_err("layer addr[%d] is not 16 bytes align, it's 0x%08x\n",
-				i, hwlayer->addr[i]);
-		layer->addr[i] = hwlayer->addr[i];
+				i, addr);
+		layer->addr[i] = addr;
 	}
 
 	layer->pos = offset;
@@ -892,6 +1031,19 @@ static void dpu_flip(struct dpu_context *ctx,
 	struct dpu_reg *reg = (struct dpu_reg *)ctx->base;
 	int i;
 
+	/*
+	 * A new frame drops the write back copy. With more than one layer
+	 * the frame is composed into the write back buffer once it stayed
+	 * for max_vsync_count vsyncs, and scanned out from there until the
+	 * next flip. Only DPI counts vsyncs.
+	 */
+	vsync_count = 0;
+	if (max_vsync_count > 0 && count > 1 &&
+	    ctx->if_type == SPRD_DISPC_IF_DPI)
+		wb_en = true;
+	else
+		wb_en = false;
+
 	/*
 	 * Make sure the dpu is in stop status. DPU_R4P0 has no shadow
 	 * registers in EDPI mode. So the config registers can only be
@@ -903,13 +1055,18 @@ static void dpu_flip(struct dpu_context *ctx,
 	/* reset the bgcolor to black */
 	reg->bg_color = 0;
 
-	/* disable all the layers */
-	dpu_clean_all(ctx);
+	/* stage all the layers disabled, fields kept from last frame */
+	memcpy(layer_next, layer_shadow, sizeof(layer_next));
+	for (i = 0; i < 8; i++)
+		layer_next[i].ctrl = 0;
 
 	/* start configure dpu layers */
 	for (i = 0; i < count; i++)
 		dpu_layer(ctx, &layers[i]);
 
+	/* write the registers that changed */
+	dpu_layer_commit(ctx);
+
 	/* update trigger and wait */
 	if (ctx->if_type == SPRD_DISPC_IF_DPI) {
 		if (!ctx->is_stopped) {
@@ -1373,6 +1530,21 @@ static void dpu_enhance_reload(struct dpu_context *ctx)
 	reg->dpu_enhance_cfg = enhance_en;
 }
 
+static void dpu_vfp_update(struct dpu_context *ctx)
+{
+	struct dpu_reg *reg = (struct dpu_reg *)ctx->base;
+
+	reg->dpi_v_timing = (ctx->vm.vsync_len << 0) |
+			    (ctx->vm.vback_porch << 8) |
+			    (ctx->vm.vfront_porch << 20);
+
+	/* the new porch is latched at the next frame boundary */
+	if (!ctx->is_stopped) {
+		reg->dpu_ctrl |= BIT(2);
+		dpu_wait_update_done(ctx);
+	}
+}
+
 static int dpu_modeset(struct dpu_context *ctx,
 		struct drm_mode_modeinfo *mode)
 {
@@ -1401,6 +1573,15 @@ static const u32 primary_fmts[] = {
 	DRM_FORMAT_YUV420,
 };
 
+/* the formats dpu_img_ctrl() maps onto XFBC-ARGB8888 and XFBC-RGB565 */
+static const u32 fbc_fmts[] = {
+	DRM_FORMAT_XRGB8888, DRM_FORMAT_XBGR8888,
+	DRM_FORMAT_ARGB8888, DRM_FORMAT_ABGR8888,
+	DRM_FORMAT_RGBA8888, DRM_FORMAT_BGRA8888,
+	DRM_FORMAT_RGBX8888,
+	DRM_FORMAT_RGB565, DRM_FORMAT_BGR565,
+};
+
 static int dpu_capability(struct dpu_context *ctx,
 			struct dpu_capability *cap)
 {
@@ -1410,6 +1591,8 @@ static int dpu_capability(struct dpu_context *ctx,
 	cap->max_layers = 6;
 	cap->fmts_ptr = primary_fmts;
 	cap->fmts_cnt = ARRAY_SIZE(primary_fmts);
+	cap->fbc_fmts_ptr = fbc_fmts;
+	cap->fbc_fmts_cnt = ARRAY_SIZE(fbc_fmts);
 
 	return 0;
 }
@@ -1431,6 +1614,8 @@ static struct dpu_core_ops dpu_r4p0_ops = {
 	.enhance_set = dpu_enhance_set,
 	.enhance_get = dpu_enhance_get,
 	.modeset = dpu_modeset,
+	.vfp_update = dpu_vfp_update,
+	.write_back = dpu_write_back,
 };
 
 static struct ops_entry entry = {
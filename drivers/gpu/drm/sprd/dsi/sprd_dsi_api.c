@@ -374,6 +374,20 @@ int sprd_dsi_edpi_video(struct sprd_dsi *dsi)
 	return 0;
 }
 
+/**
+ * Wait for all the queued packets to leave the fifos
+ * @param dsi pointer to structure holding the DSI Host core information
+ * @return error code
+ */
+int sprd_dsi_wr_flush(struct sprd_dsi *dsi)
+{
+	if (!dsi_hal_wait_tx_cmd_fifo_empty(dsi) ||
+	    !dsi_hal_wait_tx_payload_fifo_empty(dsi))
+		return -ETIMEDOUT;
+
+	return 0;
+}
+
 /**
  * Send a packet on the generic interface
  * @param dsi pointer to structure holding the DSI Host core information
@@ -382,9 +396,9 @@ int sprd_dsi_edpi_video(struct sprd_dsi *dsi)
  * @param params byte array of command parameters
  * @param param_length length of the above array
  * @return error code
- * @note this function has an active delay to wait for the buffer to clear.
- * The delay is limited to:
- * (param_length / 4) x DSIH_FIFO_ACTIVE_WAIT x register access time
+ * @note the packet is only queued, back to back packets share the fifos
+ * and go out in one burst. Use sprd_dsi_wr_flush() to wait for them.
+ * This function has an active delay to wait for room in the fifos.
  * @note the controller restricts the sending of .
  * This function will not be able to send Null and Blanking packets due to
  *  controller restriction
@@ -400,16 +414,19 @@ int sprd_dsi_wr_pkt(struct sprd_dsi *dsi, u8 vc, u8 type,
 	if (vc > 3)
 		return -EINVAL;
 
-	/* 1st: for long packet, must config payload first */
-	if (!dsi_hal_wait_tx_payload_fifo_empty(dsi))
-		return -1;
-
+	/*
+	 * 1st: for long packet, must config payload first. The controller
+	 * takes the payload of each header in order, so it may follow the
+	 * payload of the packets still queued.
+	 */
 	if (len > 2) {
 		for (i = 0; i < len; i += j) {
 			payload = 0;
 			for (j = 0; (j < 4) && ((j + i) < (len)); j++)
 				payload |= param[i + j] << (j * 8);
 
+			if (!dsi_hal_wait_tx_payload_fifo_room(dsi))
+				return -ETIMEDOUT;
 			dsi_hal_set_packet_payload(dsi, payload);
 		}
 		wc_lsbyte = len & 0xff;
@@ -420,7 +437,7 @@ int sprd_dsi_wr_pkt(struct sprd_dsi *dsi, u8 vc, u8 type,
 	}
 
 	/* 2nd: then set packet header */
-	if (!dsi_hal_wait_tx_cmd_fifo_empty(dsi))
+	if (!dsi_hal_wait_tx_cmd_fifo_room(dsi))
 		return -EINVAL;
 
 	dsi_hal_set_packet_header(dsi, vc, type, wc_lsbyte, wc_msbyte);
@@ -456,8 +473,8 @@ int sprd_dsi_rd_pkt(struct sprd_dsi *dsi, u8 vc, u8 type,
 	if (vc > 3)
 		return -EINVAL;
 
-	/* 1st: send read command to peripheral */
-	if (!dsi_hal_wait_tx_cmd_fifo_empty(dsi))
+	/* 1st: send read command to peripheral after the queued writes */
+	if (sprd_dsi_wr_flush(dsi))
 		return -EINVAL;
 
 	dsi_hal_set_packet_header(dsi, vc, type, lsb_byte, msb_byte);
@@ -493,12 +510,20 @@ int sprd_dsi_rd_pkt(struct sprd_dsi *dsi, u8 vc, u8 type,
 
 void sprd_dsi_set_work_mode(struct sprd_dsi *dsi, u8 mode)
 {
+	/* the queued commands go out in the mode they were queued for */
+	sprd_dsi_wr_flush(dsi);
+
 	if (mode == DSI_MODE_CMD)
 		dsi_hal_cmd_mode(dsi);
 	else
 		dsi_hal_video_mode(dsi);
 }
 
+void sprd_dsi_set_vfp(struct sprd_dsi *dsi, u16 lines)
+{
+	dsi_hal_dpi_vfp(dsi, lines);
+}
+
 int sprd_dsi_get_work_mode(struct sprd_dsi *dsi)
 {
 	if (dsi_hal_is_cmd_mode(dsi))
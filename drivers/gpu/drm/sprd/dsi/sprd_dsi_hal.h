@@ -763,6 +763,34 @@ static inline bool dsi_hal_wait_tx_cmd_fifo_empty(struct sprd_dsi *dsi)
 	return false;
 }
 
+static inline bool dsi_hal_wait_tx_payload_fifo_room(struct sprd_dsi *dsi)
+{
+	int timeout;
+
+	for (timeout = 0; timeout < 5000; timeout++) {
+		if (!dsi_hal_is_tx_payload_fifo_full(dsi))
+			return true;
+		udelay(1);
+	}
+
+	pr_err("tx payload fifo is full\n");
+	return false;
+}
+
+static inline bool dsi_hal_wait_tx_cmd_fifo_room(struct sprd_dsi *dsi)
+{
+	int timeout;
+
+	for (timeout = 0; timeout < 5000; timeout++) {
+		if (!dsi_hal_is_tx_cmd_fifo_full(dsi))
+			return true;
+		udelay(1);
+	}
+
+	pr_err("tx cmd fifo is full\n");
+	return false;
+}
+
 static inline bool dsi_hal_wait_rd_resp_completed(struct sprd_dsi *dsi)
 {
 	int timeout;
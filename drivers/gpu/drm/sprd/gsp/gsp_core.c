@@ -26,6 +26,7 @@
 #include "gsp_interface.h"
 #include "gsp_kcfg.h"
 #include "gsp_sysfs.h"
+#include "gsp_trace.h"
 #include "gsp_workqueue.h"
 #include <uapi/linux/sched/types.h>
 
@@ -302,6 +303,39 @@ void gsp_core_work(struct gsp_core *core)
 		GSP_WARN("queue trigger work failed\n");
 }
 
+static void gsp_core_fence_kick(struct kthread_work *work)
+{
+	struct gsp_core *core = container_of(work, struct gsp_core,
+					     fence_kick);
+
+	gsp_core_work(core);
+}
+
+static void gsp_core_fence_timeout(struct kthread_work *work)
+{
+	struct gsp_core *core = container_of(work, struct gsp_core,
+					     fence_timeout.work);
+
+	gsp_core_work(core);
+}
+
+/* called by the core irq handlers before they queue the release */
+void gsp_core_irq_stamp(struct gsp_core *core)
+{
+	if (core->current_kcfg)
+		core->current_kcfg->stamp[GSP_KCFG_STAMP_IRQ] = ktime_get();
+	trace_core_irq(core);
+}
+
+/* may be called from irq context by the fence signaler */
+void gsp_core_fence_ready(struct gsp_core *core)
+{
+	if (gsp_core_verify(core))
+		return;
+
+	kthread_queue_work(&core->kworker, &core->fence_kick);
+}
+
 void gsp_core_start_timer(struct gsp_core *core)
 {
 	if (gsp_core_verify(core)) {
@@ -335,6 +369,20 @@ void gsp_core_dump(struct gsp_core *core)
 	core->ops->dump(core);
 }
 
+/* drop the clock and interface kept on for chained kcfgs */
+static void gsp_core_power_off(struct gsp_core *core,
+			       struct gsp_interface *interface)
+{
+	if (!core->powered)
+		return;
+
+	/* disable core must be invoked after iommu map */
+	gsp_core_disable(core);
+	/*sprd_iommu_suspend(core->dev);*/
+	gsp_interface_unprepare(interface);
+	core->powered = false;
+}
+
 void gsp_core_trigger(struct kthread_work *work)
 {
 	int ret = 0;
@@ -354,6 +402,7 @@ void gsp_core_trigger(struct kthread_work *work)
 
 	if (gsp_core_is_suspend(core)) {
 		GSP_WARN("can't trigger when core is suspended\n");
+		gsp_core_power_off(core, interface);
 		goto done;
 	}
 
@@ -368,29 +417,46 @@ void gsp_core_trigger(struct kthread_work *work)
 	GSP_DEBUG("gsp core[%d] start trigger\n", gsp_core_to_id(core));
 	if (gsp_core_is_trigger(core)) {
 		gsp_core_state_set(core, CORE_STATE_BUSY);
-		kcfg = gsp_workqueue_pull(core->wq);
+		kcfg = gsp_workqueue_pull_ready(core->wq);
 		if (IS_ERR_OR_NULL(kcfg)) {
 			gsp_core_state_set(core, CORE_STATE_IDLE);
-			GSP_ERR("pull null kcfg\n");
+			gsp_core_power_off(core, interface);
+			if (gsp_workqueue_is_filled(core->wq)) {
+				/* fence_kick restarts us, or the timeout */
+				GSP_DEBUG("no kcfg ready, wait acquire fence\n");
+				kthread_mod_delayed_work(&core->kworker,
+					&core->fence_timeout,
+					msecs_to_jiffies(GSP_WAIT_FENCE_TIMEOUT));
+			} else {
+				GSP_ERR("pull null kcfg\n");
+			}
 			goto done;
 		} else {
 			core->current_kcfg = kcfg;
 			gsp_kcfg_set_pulled(kcfg);
+			kcfg->stamp[GSP_KCFG_STAMP_PULL] = ktime_get();
 		}
 	} else {
 		GSP_WARN("core can't trigger because error state\n");
+		gsp_core_power_off(core, interface);
 		goto done;
 	}
 
-	/* enable core must be invoked before iommu map */
-	GSP_DEBUG("gsp core enable\n");
-	ret = gsp_interface_prepare(interface);
-	/*ret |= sprd_iommu_resume(core->dev);*/
-	ret |= gsp_core_enable(core);
-	if (ret) {
-		gsp_core_state_set(core, CORE_STATE_ENABLE_ERR);
-		GSP_ERR("core enable failed\n");
-		goto done;
+	/*
+	 * enable core must be invoked before iommu map, a kcfg chained
+	 * by gsp_core_release() finds the core still enabled
+	 */
+	if (!core->powered) {
+		GSP_DEBUG("gsp core enable\n");
+		ret = gsp_interface_prepare(interface);
+		/*ret |= sprd_iommu_resume(core->dev);*/
+		ret |= gsp_core_enable(core);
+		if (ret) {
+			gsp_core_state_set(core, CORE_STATE_ENABLE_ERR);
+			GSP_ERR("core enable failed\n");
+			goto done;
+		}
+		core->powered = true;
 	}
 
 	GSP_DEBUG("kcfg[%d] iommu map start\n", gsp_kcfg_to_tag(kcfg));
@@ -422,6 +488,8 @@ void gsp_core_trigger(struct kthread_work *work)
 		break;
 	case GSP_NO_ERR:
 	default:
+		kcfg->stamp[GSP_KCFG_STAMP_TRIGGER] = ktime_get();
+		trace_kcfg_trigger(kcfg);
 		gsp_core_start_timer(core);
 		break;
 	}
@@ -431,9 +499,70 @@ done:
 		kthread_queue_work(&core->kworker, &core->recover);
 }
 
+static void gsp_core_cost_account(struct gsp_core *core,
+				  struct gsp_kcfg *kcfg)
+{
+	struct gsp_core_cost_stat *st = &core->cost_stat;
+	ktime_t done = kcfg->stamp[GSP_KCFG_STAMP_IRQ];
+	u64 ns;
+
+	if (!kcfg->stamp[GSP_KCFG_STAMP_TRIGGER])
+		return;
+
+	if (!done)
+		done = ktime_get();
+	ns = ktime_to_ns(ktime_sub(done, kcfg->stamp[GSP_KCFG_STAMP_TRIGGER]));
+	trace_kcfg_cost(kcfg, ns);
+
+	/* only the core kthread writes, sysfs may read a torn sample */
+	st->jobs++;
+	st->cost_sum += kcfg->cost;
+	st->ns_sum += ns;
+	st->last_cost = kcfg->cost;
+	st->last_ns = ns;
+}
+
+static void gsp_core_latency_account(struct gsp_core *core,
+				     struct gsp_kcfg *kcfg)
+{
+	struct gsp_core_latency *lat = &core->latency;
+	ktime_t *stamp = kcfg->stamp;
+	ktime_t now = ktime_get();
+	u64 ns[GSP_STAGE_NUM];
+	u64 win;
+	int i, bucket;
+
+	if (!stamp[GSP_KCFG_STAMP_TRIGGER] || !stamp[GSP_KCFG_STAMP_IRQ])
+		return;
+
+	/* stage n runs from stamp n to stamp n + 1, the last one to now */
+	BUILD_BUG_ON(GSP_STAGE_NUM != GSP_KCFG_STAMP_NUM);
+	for (i = 0; i < GSP_STAGE_NUM; i++)
+		ns[i] = ktime_to_ns(ktime_sub(i + 1 < GSP_KCFG_STAMP_NUM ?
+					      stamp[i + 1] : now, stamp[i]));
+	trace_kcfg_latency(kcfg, ns);
+
+	/* only the core kthread writes, sysfs may read a torn sample */
+	for (i = 0; i < GSP_STAGE_NUM; i++) {
+		bucket = min_t(int, fls64(div_u64(ns[i], NSEC_PER_USEC)),
+			       GSP_LATENCY_BUCKETS - 1);
+		lat->hist[i][bucket]++;
+	}
+
+	lat->win_busy += ns[GSP_STAGE_HW];
+	win = ktime_to_ns(ktime_sub(now, lat->win_start));
+	if (win >= NSEC_PER_SEC) {
+		lat->util = min_t(u64, div64_u64(lat->win_busy * 1000, win),
+				  1000);
+		lat->win_start = now;
+		lat->win_busy = 0;
+	}
+}
+
 void gsp_core_release(struct kthread_work *work)
 {
 	int ret = -1;
+	bool chain = false;
 	bool success = false;
 	struct gsp_core *core = NULL;
 	struct gsp_kcfg *kcfg = NULL;
@@ -468,6 +597,7 @@ void gsp_core_release(struct kthread_work *work)
 	}
 
 	gsp_core_stop_timer(core);
+	gsp_core_cost_account(core, kcfg);
 
 	gsp_kcfg_iommu_unmap(kcfg);
 
@@ -478,10 +608,16 @@ void gsp_core_release(struct kthread_work *work)
 	else
 		gsp_kcfg_complete(kcfg);
 
-	/* disable core must be invoked after iommu map */
-	gsp_core_disable(core);
-	/*sprd_iommu_suspend(core->dev);*/
-	gsp_interface_unprepare(interface);
+	/*
+	 * with the next kcfg already waiting keep the core enabled and
+	 * chain it right away, that saves a clock and interface off/on
+	 * cycle plus a trip through the kthread worker per kcfg
+	 */
+	chain = gsp_workqueue_is_filled(core->wq)
+		&& !gsp_core_is_suspend(core)
+		&& gsp_core_suspend_state_get(core) == CORE_STATE_SUSPEND_EXIT;
+	if (!chain)
+		gsp_core_power_off(core, interface);
 
 	if (core->ops->release)
 		ret = core->ops->release(core);
@@ -495,16 +631,19 @@ void gsp_core_release(struct kthread_work *work)
 	if (gsp_workqueue_is_exhausted(core->wq))
 		complete(&core->release_done);
 
+	gsp_core_latency_account(core, kcfg);
 	gsp_kcfg_put(kcfg);
 	core->current_kcfg = NULL;
 	GSP_DEBUG("core release resource success\n");
 
 	if (gsp_core_is_suspend(core)) {
+		gsp_core_power_off(core, interface);
 		complete(&core->suspend_done);
 		return;
 	}
 
 	if (!gsp_workqueue_is_filled(core->wq)) {
+		gsp_core_power_off(core, interface);
 		gsp_core_state_set(core, CORE_STATE_IDLE);
 		if (!gsp_workqueue_is_filled(core->wq)) {
 			pm_runtime_mark_last_busy(core->parent->dev);
@@ -518,6 +657,12 @@ void gsp_core_release(struct kthread_work *work)
 	}
 
 	gsp_core_state_set(core, CORE_STATE_TRIGGER);
+	if (core->powered) {
+		/* already on the core kthread, no need to queue */
+		gsp_core_trigger(&core->trigger);
+		return;
+	}
+
 	success = kthread_queue_work(&core->kworker, &core->trigger);
 	if (success == false)
 		GSP_WARN("queue trigger work failed\n");
@@ -627,6 +772,7 @@ void gsp_core_recover(struct kthread_work *work)
 
 	/*sprd_iommu_suspend(core->dev);*/
 	gsp_interface_unprepare(interface);
+	core->powered = false;
 
 	core->current_kcfg = NULL;
 
@@ -764,8 +910,14 @@ int gsp_core_alloc(struct gsp_core **core,
 	return ret;
 }
 
+/*
+ * Pick the core with the least outstanding work. The cost of a kcfg is
+ * only known once it is filled, after the core was selected, so kcfgs
+ * still being filled are counted by weight and break the tie.
+ */
 struct gsp_core *gsp_core_select(struct gsp_dev *gsp)
 {
+	long cost = 0;
 	int weight = 0;
 	struct gsp_core *core = NULL;
 	struct gsp_core *result = NULL;
@@ -781,10 +933,15 @@ struct gsp_core *gsp_core_select(struct gsp_dev *gsp)
 		return NULL;
 	}
 
-	weight = result->weight;
+	cost = atomic_long_read(&result->pending_cost);
+	weight = atomic_read(&result->weight);
 	for_each_gsp_core(core, gsp) {
-		if (weight > core->weight) {
-			weight = core->weight;
+		long c = atomic_long_read(&core->pending_cost);
+		int w = atomic_read(&core->weight);
+
+		if (cost > c || (cost == c && weight > w)) {
+			cost = c;
+			weight = w;
 			result = core;
 		}
 	}
@@ -799,10 +956,32 @@ struct gsp_core *gsp_core_select(struct gsp_dev *gsp)
 		gsp_core_release_wait(result);
 	}
 
-	result->weight++;
+	atomic_inc(&result->weight);
 	return result;
 }
 
+/* give back what gsp_core_select() and gsp_core_cost_push() charged */
+void gsp_core_unselect(struct gsp_core *core, struct gsp_kcfg *kcfg)
+{
+	if (gsp_core_verify(core))
+		return;
+
+	if (kcfg) {
+		atomic_long_sub(kcfg->cost, &core->pending_cost);
+		kcfg->cost = 0;
+	}
+	atomic_dec(&core->weight);
+}
+
+void gsp_core_cost_push(struct gsp_core *core, struct gsp_kcfg *kcfg)
+{
+	if (gsp_core_verify(core))
+		return;
+
+	kcfg->cost = core->ops->cost ? core->ops->cost(kcfg) : 1;
+	atomic_long_add(kcfg->cost, &core->pending_cost);
+}
+
 void gsp_core_hang_handler(unsigned long data)
 {
 	struct gsp_core *core = NULL;
@@ -906,6 +1085,9 @@ int gsp_core_init(struct gsp_core *core)
 	kthread_init_work(&core->trigger, gsp_core_trigger);
 	kthread_init_work(&core->release, gsp_core_release);
 	kthread_init_work(&core->recover, gsp_core_recover);
+	kthread_init_work(&core->fence_kick, gsp_core_fence_kick);
+	kthread_init_delayed_work(&core->fence_timeout,
+				  gsp_core_fence_timeout);
 
 	task = kthread_run(kthread_worker_fn, &core->kworker,
 			   "gsp-core[%d]", core->id);
@@ -915,7 +1097,12 @@ int gsp_core_init(struct gsp_core *core)
 		return ret;
 
 	/* when device probe, there is no task. so initialize weight to zero */
-	core->weight = 0;
+	atomic_set(&core->weight, 0);
+	atomic_long_set(&core->pending_cost, 0);
+	memset(&core->cost_stat, 0, sizeof(core->cost_stat));
+	memset(&core->latency, 0, sizeof(core->latency));
+	core->latency.win_start = ktime_get();
+	core->powered = false;
 
 	/*
 	 * core dts will indicate if this core should run the core kthread
@@ -948,8 +1135,10 @@ void gsp_core_deinit(struct gsp_core *core)
 		return;
 	}
 
-	if (core->work_thread)
+	if (core->work_thread) {
+		kthread_cancel_delayed_work_sync(&core->fence_timeout);
 		kthread_stop(core->work_thread);
+	}
 
 	gsp_core_sysfs_destroy(core);
 
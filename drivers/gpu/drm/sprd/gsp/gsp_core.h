@@ -13,11 +13,14 @@
 #ifndef _GSP_CORE_H
 #define _GSP_CORE_H
 
+#include <linux/atomic.h>
 #include <linux/clk.h>
 /* #include <linux/clk-private.h> */
 #include <linux/completion.h>
 #include <linux/kthread.h>
+#include <linux/ktime.h>
 #include <linux/list.h>
+#include <linux/types.h>
 #include <drm/gsp_cfg.h>
 
 #define GSP_CORE_SUSPEND_WAIT 3000 /* 3000 ms */
@@ -79,6 +82,47 @@ enum gsp_core_suspend_state {
 	CORE_STATE_SUSPEND_DONE,
 };
 
+/**
+ * struct gsp_core_cost_stat - predicted against measured kcfg cost
+ * @jobs:	kcfgs released after a successful trigger
+ * @cost_sum:	sum of their estimated cost
+ * @ns_sum:	sum of their trigger to irq time
+ * @last_cost:	estimated cost of the last one
+ * @last_ns:	hardware time of the last one
+ */
+struct gsp_core_cost_stat {
+	u64 jobs;
+	u64 cost_sum;
+	u64 ns_sum;
+	unsigned long last_cost;
+	u64 last_ns;
+};
+
+/* stages of a kcfg, between the stamps of enum gsp_kcfg_stamp */
+enum gsp_core_stage {
+	GSP_STAGE_QUEUE,	/* push to pull */
+	GSP_STAGE_FENCE,	/* pull to trigger, iommu map and fence wait */
+	GSP_STAGE_HW,		/* trigger to irq */
+	GSP_STAGE_RELEASE,	/* irq to put back */
+	GSP_STAGE_NUM
+};
+
+#define GSP_LATENCY_BUCKETS 16
+
+/**
+ * struct gsp_core_latency - per stage latency histogram and utilization
+ * @hist:	bucket n counts the stages shorter than 1 << n us, the
+ *		last one all longer ones
+ * @win_start:	start of the current utilization window
+ * @win_busy:	hardware time within the current window
+ * @util:	permille of the last full window the hardware was busy
+ */
+struct gsp_core_latency {
+	u32 hist[GSP_STAGE_NUM][GSP_LATENCY_BUCKETS];
+	ktime_t win_start;
+	u64 win_busy;
+	unsigned int util;
+};
 
 /**
  * struct gsp_core - gsp core
@@ -113,6 +157,9 @@ struct gsp_core {
 	struct kthread_work trigger;
 	struct kthread_work release;
 	struct kthread_work recover;
+	/* restart an idle core once acquire fences of a queued kcfg signal */
+	struct kthread_work fence_kick;
+	struct kthread_delayed_work fence_timeout;
 
 	struct task_struct *work_thread;
 
@@ -122,8 +169,15 @@ struct gsp_core {
 	struct gsp_kcfg *current_kcfg;
 	struct gsp_core_ops *ops;
 
-	/* to compare which core weight is lighter */
-	int weight;
+	/*
+	 * to compare which core is lighter: weight counts the kcfgs
+	 * handed out and not put back yet, pending_cost sums up the
+	 * estimated cost of the pushed ones among them
+	 */
+	atomic_t weight;
+	atomic_long_t pending_cost;
+	struct gsp_core_cost_stat cost_stat;
+	struct gsp_core_latency latency;
 
 	atomic_t state;
 	atomic_t suspend_state;
@@ -136,6 +190,8 @@ struct gsp_core {
 	size_t cfg_size;
 	/* to indicate whether core kthread priority is real-time */
 	bool rt;
+	/* clock and interface are left on while kcfgs are chained */
+	bool powered;
 
 	/* used to debug and recover */
 	struct list_head kcfgs;
@@ -166,6 +222,8 @@ struct gsp_core_ops {
 	int (*init)(struct gsp_core *core);
 
 	int (*copy)(struct gsp_kcfg *kcfg, void *arg, int index);
+	/* optional, estimated cost of a filled kcfg, 1 if absent */
+	unsigned long (*cost)(struct gsp_kcfg *kcfg);
 
 	int (*trigger)(struct gsp_core *core);
 	int (*release)(struct gsp_core *core);
@@ -211,6 +269,10 @@ void gsp_core_state_set(struct gsp_core *core,
 enum gsp_core_state gsp_core_state_get(struct gsp_core *core);
 
 struct gsp_core *gsp_core_select(struct gsp_dev *gsp);
+void gsp_core_unselect(struct gsp_core *core, struct gsp_kcfg *kcfg);
+void gsp_core_cost_push(struct gsp_core *core, struct gsp_kcfg *kcfg);
+void gsp_core_fence_ready(struct gsp_core *core);
+void gsp_core_irq_stamp(struct gsp_core *core);
 
 void gsp_core_suspend(struct gsp_core *core);
 void gsp_core_resume(struct gsp_core *core);
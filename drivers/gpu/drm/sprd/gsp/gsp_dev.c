@@ -26,6 +26,7 @@
 #include "gsp_debug.h"
 #include "gsp_interface.h"
 #include "gsp_kcfg.h"
+#include "gsp_replay.h"
 #include "gsp_sync.h"
 #include "gsp_sysfs.h"
 #include "gsp_workqueue.h"
@@ -47,6 +48,7 @@ static struct gsp_core_ops gsp_r6p0_core_ops = {
 	.alloc = gsp_r6p0_core_alloc,
 	.init = gsp_r6p0_core_init,
 	.copy = gsp_r6p0_core_copy_cfg,
+	.cost = gsp_r6p0_core_cost,
 	.trigger = gsp_r6p0_core_trigger,
 	.release = gsp_r6p0_core_release,
 	.enable = gsp_r6p0_core_enable,
@@ -89,6 +91,7 @@ static struct gsp_core_ops gsp_r7p0_core_ops = {
 	.alloc = gsp_r7p0_core_alloc,
 	.init = gsp_r7p0_core_init,
 	.copy = gsp_r7p0_core_copy_cfg,
+	.cost = gsp_r7p0_core_cost,
 	.trigger = gsp_r7p0_core_trigger,
 	.release = gsp_r7p0_core_release,
 	.enable = gsp_r7p0_core_enable,
@@ -103,6 +106,7 @@ static struct gsp_core_ops gsp_r8p0_core_ops = {
 	.alloc = gsp_r8p0_core_alloc,
 	.init = gsp_r8p0_core_init,
 	.copy = gsp_r8p0_core_copy_cfg,
+	.cost = gsp_r8p0_core_cost,
 	.trigger = gsp_r8p0_core_trigger,
 	.release = gsp_r8p0_core_release,
 	.enable = gsp_r8p0_core_enable,
@@ -378,6 +382,8 @@ int gsp_dev_init(struct gsp_dev *gsp)
 		goto exit;
 	}
 
+	gsp_replay_init(gsp);
+
 exit:
 	return ret;
 }
@@ -538,6 +544,31 @@ int gsp_dev_resume_wait(struct gsp_dev *gsp)
 	return resume_status;
 }
 
+/* resume the cores if needed and start the pushed kcfgs */
+int gsp_dev_kick(struct gsp_dev *gsp)
+{
+	if (gsp_dev_is_suspending(gsp) ||
+		gsp_dev_is_suspend(gsp)) {
+		pm_runtime_mark_last_busy(gsp->dev);
+		pm_runtime_get_sync(gsp->dev);
+
+		if (gsp_dev_resume_wait(gsp))
+			return -1;
+		else
+			pm_runtime_mark_last_busy(gsp->dev);
+	} else {
+		pm_runtime_mark_last_busy(gsp->dev);
+	}
+
+	if (gsp_dev_is_suspend(gsp))
+		GSP_DEV_INFO(gsp->dev,
+			     "no need to process kcfg at suspend state\n");
+
+	gsp_dev_start_work(gsp);
+
+	return 0;
+}
+
 int sprd_gsp_get_capability_ioctl(struct drm_device *drm_dev, void *data,
 			 struct drm_file *file)
 {
@@ -686,23 +717,8 @@ int sprd_gsp_trigger_ioctl(struct drm_device *drm_dev, void *data,
 		goto kcfg_list_release;
 	}
 
-	if (gsp_dev_is_suspending(gsp) ||
-		gsp_dev_is_suspend(gsp)) {
-		pm_runtime_mark_last_busy(gsp->dev);
-		pm_runtime_get_sync(gsp->dev);
-
-		if (gsp_dev_resume_wait(gsp))
-			goto kcfg_list_release;
-		else
-			pm_runtime_mark_last_busy(gsp->dev);
-	} else {
-		pm_runtime_mark_last_busy(gsp->dev);
-	}
-
-	if (gsp_dev_is_suspend(gsp))
-		GSP_DEV_INFO(dev, "no need to process kcfg at suspend state\n");
-
-	gsp_dev_start_work(gsp);
+	if (gsp_dev_kick(gsp))
+		goto kcfg_list_release;
 
 	if (!async) {
 		ret = gsp_kcfg_list_wait(&kcfg_list);
@@ -774,6 +790,8 @@ static void gsp_dev_deinit(struct gsp_dev *gsp)
 			gsp_core_deinit(core);
 	}
 
+	gsp_replay_deinit(gsp);
+
 	gsp_interface_detach(gsp->interface);
 
 	gsp_dev_sysfs_destroy(gsp);
@@ -52,6 +52,7 @@ struct device *gsp_dev_to_device(struct gsp_dev *gsp);
 struct gsp_interface *gsp_dev_to_interface(struct gsp_dev *gsp);
 
 int gsp_dev_is_idle(struct gsp_dev *gsp);
+int gsp_dev_kick(struct gsp_dev *gsp);
 
 struct gsp_core *gsp_dev_to_core(struct gsp_dev *gsp, int index);
 #endif
@@ -13,6 +13,7 @@
 
 #include <linux/dma-buf.h>
 #include <linux/list.h>
+#include <linux/sched.h>
 #include <linux/slab.h>
 #include <linux/sprd_iommu.h>
 #include <linux/uaccess.h>
@@ -22,6 +23,7 @@
 #include "gsp_debug.h"
 #include "gsp_kcfg.h"
 #include "gsp_layer.h"
+#include "gsp_replay.h"
 #include "gsp_workqueue.h"
 
 #define for_each_gsp_layer(layer, kcfg) \
@@ -53,6 +55,15 @@ int gsp_kcfg_is_pulled(struct gsp_kcfg *kcfg)
 	return kcfg->pulled;
 }
 
+/* all acquire fences signaled, triggering it will not block */
+bool gsp_kcfg_is_ready(struct gsp_kcfg *kcfg)
+{
+	if (!gsp_kcfg_is_async(kcfg))
+		return true;
+
+	return gsp_sync_fence_is_ready(&kcfg->data);
+}
+
 void gsp_kcfg_set_pulled(struct gsp_kcfg *kcfg)
 {
 	kcfg->pulled = true;
@@ -164,6 +175,8 @@ void gsp_kcfg_reinit(struct gsp_kcfg *kcfg)
 
 	kcfg->async = false;
 	kcfg->pulled = false;
+	kcfg->cost = 0;
+	memset(kcfg->stamp, 0, sizeof(kcfg->stamp));
 
 	INIT_LIST_HEAD(&kcfg->list);
 	INIT_LIST_HEAD(&kcfg->link);
@@ -229,12 +242,16 @@ repeat:
 	GSP_DEBUG("core[%d] is selected\n", gsp_core_to_id(core));
 
 	wq = gsp_core_to_workqueue(core);
-	if (IS_ERR_OR_NULL(wq))
+	if (IS_ERR_OR_NULL(wq)) {
+		gsp_core_unselect(core, NULL);
 		return -1;
+	}
 
 	kcfg = gsp_kcfg_acquire(wq);
-	if (gsp_kcfg_verify(kcfg))
+	if (gsp_kcfg_verify(kcfg)) {
+		gsp_core_unselect(core, NULL);
 		return -1;
+	}
 
 	GSP_DEBUG("acquire kcfg[%d]: %p\n", gsp_kcfg_to_tag(kcfg), kcfg);
 	gsp_kcfg_list_add(kcfg, kl);
@@ -278,7 +295,8 @@ fence_free:
 }
 
 static int gsp_kcfg_fill(struct gsp_kcfg *kcfg, void *arg, int index,
-			 bool async, bool last, int __user *ufd)
+			 bool async, bool last, int __user *ufd,
+			 struct gsp_replay_job *job)
 {
 	int ret = -1;
 	struct gsp_core *core = NULL;
@@ -302,6 +320,7 @@ static int gsp_kcfg_fill(struct gsp_kcfg *kcfg, void *arg, int index,
 
 	kcfg->async = async;
 	kcfg->last = last;
+	kcfg->client = current->tgid;
 	core = gsp_kcfg_to_core(kcfg);
 
 	if (core->ops)
@@ -311,6 +330,15 @@ static int gsp_kcfg_fill(struct gsp_kcfg *kcfg, void *arg, int index,
 		goto exit;
 	}
 
+	/* a replayed cfg carries the fds of the recording process */
+	if (job) {
+		ret = gsp_replay_remap(job, kcfg);
+		if (ret) {
+			GSP_ERR("remap replay fds failed\n");
+			goto exit;
+		}
+	}
+
 	ret = gsp_kcfg_get_dmabuf(kcfg);
 	if (ret) {
 		GSP_ERR("get dmabuf failed\n");
@@ -350,15 +378,47 @@ gsp_kcfg_ufd_intercept(struct gsp_kcfg *kcfg, void __user *arg, int index)
 	return ufd;
 }
 
-int gsp_kcfg_list_fill(struct gsp_kcfg_list *kl, void __user *arg)
+/*
+ * fill the kcfgs of kl from cfg_arg, already in kernel memory. arg is the
+ * user copy of it, the release fence fd goes back there at async. job is
+ * only set by the replay. The caller releases kl on error.
+ */
+int gsp_kcfg_list_fill_cfg(struct gsp_kcfg_list *kl, void *cfg_arg,
+			   void __user *arg, struct gsp_replay_job *job)
 {
 	int ret = -1;
 	int index = 0;
 	bool last = false;
 	struct gsp_kcfg *kcfg = NULL;
-	void *cfg_arg = NULL;
 	int __user *ufd = NULL;
 
+	for_each_kcfg_from_kl(kcfg, kl) {
+		if (index == kl->num - 1)
+			last = true;
+		if (last == true && kl->async) {
+			ufd = gsp_kcfg_ufd_intercept(kcfg, arg, index);
+			if (ufd == NULL) {
+				ret = -1;
+				break;
+			}
+		}
+		ret = gsp_kcfg_fill(kcfg, cfg_arg, index, kl->async, last, ufd,
+				    job);
+		if (ret)
+			break;
+		GSP_DEBUG("fill kcfg[%d] success\n",
+			  gsp_kcfg_to_tag(kcfg));
+		index++;
+	}
+
+	return ret;
+}
+
+int gsp_kcfg_list_fill(struct gsp_kcfg_list *kl, void __user *arg)
+{
+	int ret = -1;
+	void *cfg_arg = NULL;
+
 	if (IS_ERR_OR_NULL(kl)
 	    || IS_ERR_OR_NULL(arg)) {
 		GSP_ERR("kcfg list fill params error\n");
@@ -377,23 +437,9 @@ int gsp_kcfg_list_fill(struct gsp_kcfg_list *kl, void __user *arg)
 		goto exit;
 	}
 
-	for_each_kcfg_from_kl(kcfg, kl) {
-		if (index == kl->num - 1)
-			last = true;
-		if (last == true) {
-			ufd = gsp_kcfg_ufd_intercept(kcfg, arg, index);
-			if (ufd == NULL) {
-				ret = -1;
-				break;
-			}
-		}
-		ret = gsp_kcfg_fill(kcfg, cfg_arg, index, kl->async, last, ufd);
-		if (ret)
-			break;
-		GSP_DEBUG("fill kcfg[%d] success\n",
-			  gsp_kcfg_to_tag(kcfg));
-		index++;
-	}
+	ret = gsp_kcfg_list_fill_cfg(kl, cfg_arg, arg, NULL);
+	if (!ret)
+		gsp_replay_record(kl, cfg_arg);
 
 exit:
 	if (ret)
@@ -425,6 +471,14 @@ gsp_kcfg_to_bind_core(struct gsp_kcfg *kcfg)
 	return kcfg->bind_core;
 }
 
+/* called from the signaling context of the last acquire fence */
+static void gsp_kcfg_fence_ready(struct gsp_fence_data *data)
+{
+	struct gsp_kcfg *kcfg = container_of(data, struct gsp_kcfg, data);
+
+	gsp_core_fence_ready(kcfg->bind_core);
+}
+
 static int gsp_kcfg_push(struct gsp_kcfg *kcfg)
 {
 	int ret = -1;
@@ -438,8 +492,14 @@ static int gsp_kcfg_push(struct gsp_kcfg *kcfg)
 	GSP_DEBUG("kcfg[%d] push to workqueue\n", gsp_kcfg_to_tag(kcfg));
 	wq = gsp_kcfg_to_workqueue(kcfg);
 
-	if (!IS_ERR_OR_NULL(wq))
+	if (!IS_ERR_OR_NULL(wq)) {
+		gsp_core_cost_push(kcfg->bind_core, kcfg);
+		kcfg->push_time = jiffies;
+		kcfg->stamp[GSP_KCFG_STAMP_PUSH] = ktime_get();
+		if (gsp_kcfg_is_async(kcfg))
+			gsp_sync_fence_arm(&kcfg->data, gsp_kcfg_fence_ready);
 		ret = gsp_workqueue_push(kcfg, wq);
+	}
 
 	return ret;
 }
@@ -15,15 +15,26 @@
 
 
 #include <linux/completion.h>
+#include <linux/ktime.h>
 #include <linux/time.h>
 #include <drm/gsp_cfg.h>
 #include "gsp_sync.h"
 
 struct gsp_core;
+struct gsp_replay_job;
 struct gsp_workqueue;
 
 #define GSP_WAIT_COMPLETION_TIMEOUT msecs_to_jiffies(3000)
 
+/* points in the life of a kcfg, stamped to break down its latency */
+enum gsp_kcfg_stamp {
+	GSP_KCFG_STAMP_PUSH,
+	GSP_KCFG_STAMP_PULL,
+	GSP_KCFG_STAMP_TRIGGER,
+	GSP_KCFG_STAMP_IRQ,
+	GSP_KCFG_STAMP_NUM
+};
+
 
 
 struct gsp_kcfg {
@@ -53,6 +64,16 @@ struct gsp_kcfg {
 
 	/* start from trigger, used to timeout judgment */
 	struct timespec start_time;
+
+	/* estimated at push, accounted to bind_core until put back */
+	unsigned long cost;
+	/* trigger stamp is only set on successful trigger */
+	ktime_t stamp[GSP_KCFG_STAMP_NUM];
+
+	/* kcfgs of one client are triggered in push order */
+	pid_t client;
+	/* jiffies at push, bounds how long others may overtake it */
+	unsigned long push_time;
 	struct completion complete;
 };
 
@@ -72,6 +93,7 @@ int gsp_kcfg_verify(struct gsp_kcfg *kcfg);
 /* rerutn value: 0->async 1->not async */
 int gsp_kcfg_is_async(struct gsp_kcfg *kcfg);
 int gsp_kcfg_is_pulled(struct gsp_kcfg *kcfg);
+bool gsp_kcfg_is_ready(struct gsp_kcfg *kcfg);
 
 void gsp_kcfg_set_pulled(struct gsp_kcfg *kcfg);
 
@@ -85,10 +107,13 @@ int gsp_kcfg_list_acquire(struct gsp_dev *gsp,
 			  struct gsp_kcfg_list *kl, int num);
 
 int gsp_kcfg_list_fill(struct gsp_kcfg_list *kl, void __user *arg);
+int gsp_kcfg_list_fill_cfg(struct gsp_kcfg_list *kl, void *cfg_arg,
+			   void __user *arg, struct gsp_replay_job *job);
 int gsp_kcfg_list_push(struct gsp_kcfg_list *kl);
 void gsp_kcfg_list_release(struct gsp_kcfg_list *kl);
 void gsp_kcfg_list_put(struct gsp_kcfg_list *kl);
 int gsp_kcfg_list_wait(struct gsp_kcfg_list *kl);
+int gsp_kcfg_wait_for_completion(struct gsp_kcfg *kcfg);
 int gsp_kcfg_list_is_empty(struct gsp_kcfg_list *kl);
 
 int gsp_kcfg_fence_wait(struct gsp_kcfg *kcfg);
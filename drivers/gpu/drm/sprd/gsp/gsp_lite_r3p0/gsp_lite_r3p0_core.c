@@ -672,6 +672,7 @@ static irqreturn_t gsp_lite_r3p0_core_irq_handler(int irq, void *data)
 	gsp_lite_r3p0_int_clear_and_disable(core);
 
 	gsp_core_state_set(core, CORE_STATE_IRQ_HANDLED);
+	gsp_core_irq_stamp(core);
 	kthread_queue_work(&core->kworker, &core->release);
 
 	return IRQ_HANDLED;
@@ -681,6 +681,7 @@ static irqreturn_t gsp_r6p0_core_irq_handler(int irq, void *data)
 
 	gsp_r6p0_int_clear_and_disable(core);
 	gsp_core_state_set(core, core_state);
+	gsp_core_irq_stamp(core);
 	kthread_queue_work(&core->kworker, &core->release);
 
 	return IRQ_HANDLED;
@@ -1515,6 +1516,56 @@ int gsp_r6p0_core_release(struct gsp_core *c)
 	return 0;
 }
 
+/*
+ * Rough cost of a filled kcfg in kilo pixels: every enabled layer reads
+ * its clip rect, a scaled image layer also runs the scaler over its
+ * des rect and the work area is written once. 90/270 degree rotation
+ * walks the buffer across lines and costs a quarter more.
+ */
+unsigned long gsp_r6p0_core_cost(struct gsp_kcfg *kcfg)
+{
+	struct gsp_r6p0_img_layer_params *img = NULL;
+	struct gsp_rect *rect = NULL;
+	struct gsp_r6p0_cfg *cfg = NULL;
+	unsigned long pixels = 0;
+	unsigned long cost = 0;
+	int icnt = 0;
+
+	cfg = (struct gsp_r6p0_cfg *)kcfg->cfg;
+
+	for (icnt = 0; icnt < R6P0_IMGL_NUM; icnt++) {
+		if (!cfg->limg[icnt].common.enable)
+			continue;
+
+		img = &cfg->limg[icnt].params;
+		pixels = (unsigned long)img->clip_rect.rect_w *
+			img->clip_rect.rect_h;
+		if (img->scaling_en)
+			pixels += (unsigned long)img->des_rect.rect_w *
+				img->des_rect.rect_h;
+		/* odd angles are 90 and 270, mirrored or not */
+		if (img->rot_angle & 0x1)
+			pixels += pixels >> 2;
+		cost += pixels;
+	}
+
+	for (icnt = 0; icnt < R6P0_OSDL_NUM; icnt++) {
+		if (!cfg->losd[icnt].common.enable)
+			continue;
+
+		rect = &cfg->losd[icnt].params.clip_rect;
+		cost += (unsigned long)rect->rect_w * rect->rect_h;
+	}
+
+	rect = &cfg->misc.workarea_src_rect;
+	pixels = (unsigned long)rect->rect_w * rect->rect_h;
+	if (cfg->ld1.params.rot_angle & 0x1)
+		pixels += pixels >> 2;
+	cost += pixels;
+
+	return max_t(unsigned long, cost >> 10, 1);
+}
+
 int gsp_r6p0_core_copy_cfg(struct gsp_kcfg *kcfg,
 			void *arg, int index)
 {
@@ -46,6 +46,8 @@ int gsp_r7p0_core_parse_dt(struct gsp_core *core);
 
 int gsp_r7p0_core_copy_cfg(struct gsp_kcfg *kcfg, void *arg, int index);
 
+unsigned long gsp_r7p0_core_cost(struct gsp_kcfg *kcfg);
+
 int gsp_r7p0_core_init(struct gsp_core *core);
 
 int gsp_r7p0_core_alloc(struct gsp_core **core, struct device_node *node);
@@ -471,6 +471,9 @@ static int gsp_r8p0_core_capa_init(struct gsp_core *core)
 	capa->max_gspmmu_size = 80 * 1024 * 1024;
 	capa->max_gsp_bandwidth = 1920 * 1080 * 4 * 5 / 2;
 
+	capa->fbc_des_fmts = BIT(GSP_R8P0_DST_FMT_ARGB888) |
+			     BIT(GSP_R8P0_DST_FMT_RGB565);
+
 	return 0;
 }
 
@@ -706,6 +709,7 @@ static irqreturn_t gsp_r8p0_core_irq_handler(int irq, void *data)
 	gsp_r8p0_int_clear_and_disable(core);
 
 	gsp_core_state_set(core, core_state);
+	gsp_core_irq_stamp(core);
 	kthread_queue_work(&core->kworker, &core->release);
 
 	return IRQ_HANDLED;
@@ -1553,6 +1557,56 @@ int gsp_r8p0_core_release(struct gsp_core *c)
 	return 0;
 }
 
+/*
+ * Rough cost of a filled kcfg in kilo pixels: every enabled layer reads
+ * its clip rect, a scaled image layer also runs the scaler over its
+ * des rect and the work area is written once. 90/270 degree rotation
+ * walks the buffer across lines and costs a quarter more.
+ */
+unsigned long gsp_r8p0_core_cost(struct gsp_kcfg *kcfg)
+{
+	struct gsp_r8p0_img_layer_params *img = NULL;
+	struct gsp_rect *rect = NULL;
+	struct gsp_r8p0_cfg *cfg = NULL;
+	unsigned long pixels = 0;
+	unsigned long cost = 0;
+	int icnt = 0;
+
+	cfg = (struct gsp_r8p0_cfg *)kcfg->cfg;
+
+	for (icnt = 0; icnt < R8P0_IMGL_NUM; icnt++) {
+		if (!cfg->limg[icnt].common.enable)
+			continue;
+
+		img = &cfg->limg[icnt].params;
+		pixels = (unsigned long)img->clip_rect.rect_w *
+			img->clip_rect.rect_h;
+		if (img->scaling_en)
+			pixels += (unsigned long)img->des_rect.rect_w *
+				img->des_rect.rect_h;
+		/* odd angles are 90 and 270, mirrored or not */
+		if (img->rot_angle & 0x1)
+			pixels += pixels >> 2;
+		cost += pixels;
+	}
+
+	for (icnt = 0; icnt < R8P0_OSDL_NUM; icnt++) {
+		if (!cfg->losd[icnt].common.enable)
+			continue;
+
+		rect = &cfg->losd[icnt].params.clip_rect;
+		cost += (unsigned long)rect->rect_w * rect->rect_h;
+	}
+
+	rect = &cfg->misc.workarea_src_rect;
+	pixels = (unsigned long)rect->rect_w * rect->rect_h;
+	if (cfg->ld1.params.rot_angle & 0x1)
+		pixels += pixels >> 2;
+	cost += pixels;
+
+	return max_t(unsigned long, cost >> 10, 1);
+}
+
 int gsp_r8p0_core_copy_cfg(struct gsp_kcfg *kcfg,
 			void *arg, int index)
 {
@@ -1608,6 +1662,15 @@ int gsp_r8p0_core_copy_cfg(struct gsp_kcfg *kcfg,
 		   sizeof(struct gsp_r8p0_des_layer_params));
 	gsp_layer_set_filled(&cfg->ld1.common);
 
+	/* let userspace fall back to a linear des buffer */
+	if (cfg->ld1.params.fbc_mod &&
+	    cfg->ld1.params.img_format != GSP_R8P0_DST_FMT_ARGB888 &&
+	    cfg->ld1.params.img_format != GSP_R8P0_DST_FMT_RGB565) {
+		GSP_ERR("des format %d can't be compressed\n",
+			cfg->ld1.params.img_format);
+		return -1;
+	}
+
 	memcpy(&cfg->misc, &cfg_user->misc,
 		   sizeof(struct gsp_r8p0_misc_cfg));
 
@@ -0,0 +1,761 @@
+/*
+ * Copyright (C) 2015 Spreadtrum Communications Inc.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/dma-buf.h>
+#include <linux/fdtable.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/mutex.h>
+#include <linux/of.h>
+#include <linux/sched/signal.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <drm/gsp_cfg.h>
+#include "gsp_core.h"
+#include "gsp_debug.h"
+#include "gsp_dev.h"
+#include "gsp_kcfg.h"
+#include "gsp_layer.h"
+#include "gsp_replay.h"
+#include "ion.h"
+
+/* room for some thousand jobs of the larger cfgs */
+#define GSP_REPLAY_BLOB_SIZE	(4 << 20)
+/* distinct buffers a blob may reference, all allocated for the replay */
+#define GSP_REPLAY_MAX_BUF	32
+#define GSP_REPLAY_MAX_LOOPS	1000
+
+/**
+ * struct gsp_replay_stat - replay results of one core
+ * @jobs:	kcfgs the core ran
+ * @lat_sum:	push to completion of them
+ * @hw_sum:	trigger to irq of them
+ * @hist:	bucket n counts the latencies below 1 << n us
+ */
+struct gsp_replay_stat {
+	u64 jobs;
+	u64 lat_sum;
+	u64 lat_max;
+	u64 hw_sum;
+	u32 hist[GSP_LATENCY_BUCKETS];
+};
+
+/* a buffer of the blob, allocated again in the replaying process */
+struct gsp_replay_map {
+	struct gsp_replay_buf buf;
+	int fd;
+};
+
+struct gsp_replay_job {
+	struct gsp_replay_rec *rec;
+	struct gsp_replay_map *map;
+	int nr_map;
+};
+
+/**
+ * struct gsp_replay - recorder and replayer of one gsp dev
+ * @lock:	serializes the recorder, the blob and the replay
+ * @recording:	trigger ioctls are appended to the blob
+ * @blob:	header and records, len bytes used
+ * @t0:		start of the recording
+ * @scratch:	buffers of the record being appended
+ * @stat:	per core results of the last replay, in core list order
+ * @wall_ns:	length of the last replay
+ */
+struct gsp_replay {
+	struct gsp_dev *gsp;
+	struct dentry *dir;
+	struct mutex lock;
+	bool recording;
+	void *blob;
+	size_t len;
+	ktime_t t0;
+	struct gsp_replay_buf scratch[GSP_REPLAY_MAX_BUF];
+
+	struct gsp_replay_stat *stat;
+	u64 wall_ns;
+	u32 loops;
+	u32 pace;
+	u32 recs;
+	u32 errors;
+};
+
+static struct gsp_replay gsp_replay;
+
+static struct gsp_replay_header *gsp_replay_hdr(struct gsp_replay *rp)
+{
+	return rp->blob;
+}
+
+static struct gsp_replay_buf *gsp_replay_rec_buf(struct gsp_replay_rec *rec)
+{
+	return (struct gsp_replay_buf *)(rec + 1);
+}
+
+static void *gsp_replay_rec_cfg(struct gsp_replay_rec *rec)
+{
+	return gsp_replay_rec_buf(rec) + rec->nr_buf;
+}
+
+static int gsp_replay_blob_alloc(struct gsp_replay *rp)
+{
+	if (!rp->blob)
+		rp->blob = vzalloc(GSP_REPLAY_BLOB_SIZE);
+
+	return rp->blob ? 0 : -ENOMEM;
+}
+
+static void gsp_replay_blob_reset(struct gsp_replay *rp)
+{
+	struct gsp_replay_header *hdr = gsp_replay_hdr(rp);
+	const char *compat = NULL;
+
+	memset(hdr, 0, sizeof(*hdr));
+	hdr->magic = GSP_REPLAY_MAGIC;
+	hdr->version = GSP_REPLAY_VERSION;
+	/* the cfgs are in the layout of the core ops this compatible picks */
+	of_property_read_string(rp->gsp->dev->of_node, "compatible", &compat);
+	if (compat)
+		strlcpy(hdr->compatible, compat, sizeof(hdr->compatible));
+	rp->len = sizeof(*hdr);
+}
+
+static bool gsp_replay_buf_find(struct gsp_replay_buf *buf, int nr, int fd)
+{
+	int i;
+
+	for (i = 0; i < nr; i++) {
+		if (buf[i].fd == fd)
+			return true;
+	}
+
+	return false;
+}
+
+/* fills buf with the distinct buffers of kl, returns how many */
+static int gsp_replay_rec_bufs(struct gsp_kcfg_list *kl,
+			       struct gsp_replay_buf *buf, int max)
+{
+	struct gsp_kcfg *kcfg = NULL;
+	struct gsp_layer *layer = NULL;
+	struct ion_buffer *ionbuf = NULL;
+	int nr = 0;
+	int fd;
+
+	list_for_each_entry(kcfg, &kl->head, link) {
+		list_for_each_entry(layer, &kcfg->cfg->layers, list) {
+			if (!gsp_layer_has_share_fd(layer) ||
+			    !layer->mem_data.buf.dmabuf)
+				continue;
+
+			fd = gsp_layer_to_share_fd(layer);
+			if (gsp_replay_buf_find(buf, nr, fd))
+				continue;
+			if (nr == max)
+				return -1;
+
+			ionbuf = layer->mem_data.buf.dmabuf->priv;
+			buf[nr].fd = fd;
+			buf[nr].heap_id = ionbuf->heap->id;
+			buf[nr].flags = ionbuf->flags;
+			buf[nr].reserved = 0;
+			buf[nr].size = ionbuf->size;
+			nr++;
+		}
+	}
+
+	return nr;
+}
+
+/* called by the trigger ioctl once kl is filled */
+void gsp_replay_record(struct gsp_kcfg_list *kl, void *cfg_arg)
+{
+	struct gsp_replay *rp = &gsp_replay;
+	struct gsp_replay_buf *buf = rp->scratch;
+	struct gsp_replay_header *hdr;
+	struct gsp_replay_rec *rec;
+	size_t len;
+	int nr;
+
+	if (!READ_ONCE(rp->recording))
+		return;
+
+	mutex_lock(&rp->lock);
+	if (!rp->recording)
+		goto out;
+
+	hdr = gsp_replay_hdr(rp);
+	nr = gsp_replay_rec_bufs(kl, buf, ARRAY_SIZE(rp->scratch));
+	if (nr < 0) {
+		hdr->dropped++;
+		goto out;
+	}
+
+	len = ALIGN(sizeof(*rec) + nr * sizeof(*buf) + kl->size, 8);
+	if (rp->len + len > GSP_REPLAY_BLOB_SIZE) {
+		hdr->dropped++;
+		goto out;
+	}
+
+	rec = rp->blob + rp->len;
+	memset(rec, 0, len);
+	rec->len = len;
+	rec->num = kl->num;
+	rec->cfg_size = kl->size / kl->num;
+	rec->nr_buf = nr;
+	rec->async = kl->async;
+	rec->split = kl->split;
+	rec->t_ns = ktime_to_ns(ktime_sub(ktime_get(), rp->t0));
+	memcpy(gsp_replay_rec_buf(rec), buf, nr * sizeof(*buf));
+	memcpy(gsp_replay_rec_cfg(rec), cfg_arg, kl->size);
+
+	rp->len += len;
+	hdr->nr_rec++;
+out:
+	mutex_unlock(&rp->lock);
+}
+
+/* point the layers of a replayed kcfg at the buffers allocated for it */
+int gsp_replay_remap(struct gsp_replay_job *job, struct gsp_kcfg *kcfg)
+{
+	struct gsp_replay_buf *buf = gsp_replay_rec_buf(job->rec);
+	struct gsp_layer *layer = NULL;
+	int i, j, fd;
+
+	list_for_each_entry(layer, &kcfg->cfg->layers, list) {
+		if (!gsp_layer_has_share_fd(layer))
+			continue;
+
+		fd = gsp_layer_to_share_fd(layer);
+		for (i = 0; i < job->rec->nr_buf; i++) {
+			if (buf[i].fd == fd)
+				break;
+		}
+		if (i == job->rec->nr_buf)
+			return -1;
+
+		for (j = 0; j < job->nr_map; j++) {
+			if (!memcmp(&job->map[j].buf, &buf[i], sizeof(*buf)))
+				break;
+		}
+		if (j == job->nr_map)
+			return -1;
+
+		layer->mem_data.share_fd = job->map[j].fd;
+	}
+
+	return 0;
+}
+
+/* iterate the records of a verified blob */
+#define for_each_replay_rec(rec, hdr, i) \
+	for ((i) = 0, (rec) = (struct gsp_replay_rec *)((hdr) + 1); \
+	     (i) < (hdr)->nr_rec; \
+	     (i)++, (rec) = (void *)(rec) + (rec)->len)
+
+static int gsp_replay_verify(struct gsp_replay *rp)
+{
+	struct gsp_replay_header *hdr = gsp_replay_hdr(rp);
+	struct gsp_replay_rec *rec = NULL;
+	const char *compat = NULL;
+	size_t pos = sizeof(*hdr);
+	size_t len;
+	u32 i;
+
+	if (rp->len < sizeof(*hdr) || hdr->magic != GSP_REPLAY_MAGIC ||
+	    hdr->version != GSP_REPLAY_VERSION) {
+		GSP_ERR("no replay blob\n");
+		return -EINVAL;
+	}
+
+	of_property_read_string(rp->gsp->dev->of_node, "compatible", &compat);
+	if (!compat || strncmp(hdr->compatible, compat,
+			       sizeof(hdr->compatible))) {
+		GSP_ERR("blob recorded on %.64s\n", hdr->compatible);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < hdr->nr_rec; i++) {
+		if (pos + sizeof(*rec) > rp->len)
+			return -EINVAL;
+		rec = rp->blob + pos;
+		if (rec->num < 1 || rec->num > GSP_MAX_IO_CNT(rp->gsp) ||
+		    rec->cfg_size < sizeof(struct gsp_cfg) ||
+		    rec->cfg_size > GSP_REPLAY_BLOB_SIZE ||
+		    rec->nr_buf > GSP_REPLAY_MAX_BUF)
+			return -EINVAL;
+		len = sizeof(*rec) + rec->nr_buf * sizeof(struct gsp_replay_buf)
+			+ (size_t)rec->num * rec->cfg_size;
+		if (rec->len < len || rec->len % 8 || pos + rec->len > rp->len)
+			return -EINVAL;
+		pos += rec->len;
+	}
+
+	return 0;
+}
+
+static void gsp_replay_unmap(struct gsp_replay_job *job)
+{
+	int i;
+
+	for (i = 0; i < job->nr_map; i++)
+		__close_fd(current->files, job->map[i].fd);
+	kfree(job->map);
+	job->map = NULL;
+	job->nr_map = 0;
+}
+
+/*
+ * The recorded fds mean nothing here, every distinct buffer of the blob
+ * gets a new one of the same heap, flags and size as an fd of the
+ * replaying process. Only the timing is reproduced, not the pixels.
+ */
+static int gsp_replay_map(struct gsp_replay *rp, struct gsp_replay_job *job)
+{
+	struct gsp_replay_header *hdr = gsp_replay_hdr(rp);
+	struct gsp_replay_rec *rec = NULL;
+	struct gsp_replay_buf *buf = NULL;
+	struct gsp_replay_map *map = NULL;
+	int i, j, k, fd;
+
+	job->map = kcalloc(GSP_REPLAY_MAX_BUF, sizeof(*job->map), GFP_KERNEL);
+	if (!job->map)
+		return -ENOMEM;
+	job->nr_map = 0;
+
+	for_each_replay_rec(rec, hdr, i) {
+		buf = gsp_replay_rec_buf(rec);
+		for (j = 0; j < rec->nr_buf; j++) {
+			for (k = 0; k < job->nr_map; k++) {
+				if (!memcmp(&job->map[k].buf, &buf[j],
+					    sizeof(*buf)))
+					break;
+			}
+			if (k < job->nr_map)
+				continue;
+			if (job->nr_map == GSP_REPLAY_MAX_BUF) {
+				GSP_ERR("blob uses over %d buffers\n",
+					GSP_REPLAY_MAX_BUF);
+				goto err;
+			}
+
+			fd = ion_alloc(buf[j].size, 1 << buf[j].heap_id,
+				       buf[j].flags);
+			if (fd < 0) {
+				GSP_ERR("alloc %llu bytes of heap %u failed\n",
+					buf[j].size, buf[j].heap_id);
+				goto err;
+			}
+			map = &job->map[job->nr_map++];
+			map->buf = buf[j];
+			map->fd = fd;
+		}
+	}
+
+	return 0;
+
+err:
+	gsp_replay_unmap(job);
+	return -ENOMEM;
+}
+
+static int gsp_replay_core_index(struct gsp_replay *rp, struct gsp_core *core)
+{
+	struct gsp_core *c = NULL;
+	int i = 0;
+
+	for_each_gsp_core(c, rp->gsp) {
+		if (c == core)
+			return i;
+		i++;
+	}
+
+	return -1;
+}
+
+/* the stamps are read right after the completion, before reuse */
+static void gsp_replay_account(struct gsp_replay *rp, struct gsp_kcfg *kcfg,
+			       ktime_t start)
+{
+	struct gsp_replay_stat *st = NULL;
+	ktime_t *stamp = kcfg->stamp;
+	u64 ns;
+	int i;
+
+	i = gsp_replay_core_index(rp, kcfg->bind_core);
+	if (i < 0)
+		return;
+	st = &rp->stat[i];
+
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	st->jobs++;
+	st->lat_sum += ns;
+	st->lat_max = max(st->lat_max, ns);
+	st->hist[min_t(int, fls64(div_u64(ns, NSEC_PER_USEC)),
+		       GSP_LATENCY_BUCKETS - 1)]++;
+	if (stamp[GSP_KCFG_STAMP_TRIGGER] && stamp[GSP_KCFG_STAMP_IRQ])
+		st->hw_sum += ktime_to_ns(ktime_sub(stamp[GSP_KCFG_STAMP_IRQ],
+					  stamp[GSP_KCFG_STAMP_TRIGGER]));
+}
+
+/* one recorded trigger ioctl, always sync, the fences are not recorded */
+static int gsp_replay_rec_run(struct gsp_replay *rp,
+			      struct gsp_replay_job *job)
+{
+	struct gsp_replay_rec *rec = job->rec;
+	struct gsp_kcfg_list kl;
+	struct gsp_kcfg *kcfg = NULL;
+	ktime_t start;
+	int ret;
+
+	gsp_kcfg_list_init(&kl, false, rec->split, rec->cfg_size, rec->num);
+
+	start = ktime_get();
+	ret = gsp_kcfg_list_acquire(rp->gsp, &kl, rec->num);
+	if (ret) {
+		if (gsp_kcfg_list_is_empty(&kl))
+			return ret;
+		goto kcfg_list_put;
+	}
+
+	ret = gsp_kcfg_list_fill_cfg(&kl, gsp_replay_rec_cfg(rec), NULL, job);
+	if (ret)
+		goto kcfg_list_release;
+
+	ret = gsp_kcfg_list_push(&kl);
+	if (ret)
+		goto kcfg_list_release;
+
+	ret = gsp_dev_kick(rp->gsp);
+	if (ret)
+		goto kcfg_list_release;
+
+	list_for_each_entry(kcfg, &kl.head, link) {
+		ret = gsp_kcfg_wait_for_completion(kcfg);
+		if (ret)
+			goto kcfg_list_release;
+		gsp_replay_account(rp, kcfg, start);
+	}
+
+	return 0;
+
+kcfg_list_release:
+	gsp_kcfg_list_release(&kl);
+kcfg_list_put:
+	gsp_kcfg_list_put(&kl);
+	return ret;
+}
+
+static void gsp_replay_pace(ktime_t due)
+{
+	if (ktime_before(ktime_get(), due)) {
+		set_current_state(TASK_KILLABLE);
+		schedule_hrtimeout(&due, HRTIMER_MODE_ABS);
+	}
+}
+
+/*
+ * Replay the blob loops times in the writing process. Back to back by
+ * default, with pace each record waits for its recorded offset from the
+ * start of the loop.
+ */
+static int gsp_replay_run(struct gsp_replay *rp, u32 loops, u32 pace)
+{
+	struct gsp_replay_header *hdr = gsp_replay_hdr(rp);
+	struct gsp_replay_job job = { };
+	struct gsp_replay_rec *rec = NULL;
+	ktime_t start, base;
+	u32 loop, i;
+	int ret;
+
+	ret = gsp_replay_verify(rp);
+	if (ret)
+		return ret;
+
+	ret = gsp_replay_map(rp, &job);
+	if (ret)
+		return ret;
+
+	memset(rp->stat, 0, sizeof(*rp->stat) * rp->gsp->core_cnt);
+	rp->loops = loops;
+	rp->pace = pace;
+	rp->recs = 0;
+	rp->errors = 0;
+
+	start = ktime_get();
+	for (loop = 0; loop < loops; loop++) {
+		base = ktime_get();
+		for_each_replay_rec(rec, hdr, i) {
+			if (fatal_signal_pending(current)) {
+				ret = -EINTR;
+				goto out;
+			}
+			if (pace)
+				gsp_replay_pace(ktime_add_ns(base, rec->t_ns));
+
+			job.rec = rec;
+			if (gsp_replay_rec_run(rp, &job))
+				rp->errors++;
+			rp->recs++;
+		}
+	}
+
+out:
+	rp->wall_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	gsp_replay_unmap(&job);
+	return ret;
+}
+
+/* upper bound in us of the latency below which pct of the jobs fall */
+static unsigned int gsp_replay_pct(struct gsp_replay_stat *st, int pct)
+{
+	u64 want, sum = 0;
+	int i;
+
+	want = div_u64(st->jobs * pct + 99, 100);
+	for (i = 0; i < GSP_LATENCY_BUCKETS - 1; i++) {
+		sum += st->hist[i];
+		if (sum >= want)
+			break;
+	}
+
+	return 1U << i;
+}
+
+static int gsp_replay_result_show(struct seq_file *m, void *v)
+{
+	struct gsp_replay *rp = m->private;
+	struct gsp_replay_stat *st = NULL;
+	struct gsp_core *core = NULL;
+	u64 wall_us, rate, busy;
+	u32 rate_frac, busy_frac;
+	int i = 0;
+
+	mutex_lock(&rp->lock);
+	wall_us = max_t(u64, div_u64(rp->wall_ns, NSEC_PER_USEC), 1);
+	seq_printf(m, "loops: %u pace: %u records: %u errors: %u wall: %llu us\n",
+		   rp->loops, rp->pace, rp->recs, rp->errors, wall_us);
+
+	for_each_gsp_core(core, rp->gsp) {
+		st = &rp->stat[i++];
+		/* jobs per second in thousandths, busy in permille */
+		rate = div64_u64(st->jobs * USEC_PER_SEC * 1000, wall_us);
+		busy = min_t(u64, div64_u64(st->hw_sum, wall_us), 1000);
+		rate_frac = do_div(rate, 1000);
+		busy_frac = do_div(busy, 10);
+		seq_printf(m, "core[%d]: jobs: %llu rate: %llu.%03u/s busy: %llu.%u%%\n",
+			   gsp_core_to_id(core), st->jobs, rate, rate_frac,
+			   busy, busy_frac);
+		if (!st->jobs)
+			continue;
+		seq_printf(m, "\tlatency avg: %llu p50: <%u p99: <%u max: %llu us, hw avg: %llu us\n",
+			   div64_u64(st->lat_sum, st->jobs * NSEC_PER_USEC),
+			   gsp_replay_pct(st, 50), gsp_replay_pct(st, 99),
+			   div_u64(st->lat_max, NSEC_PER_USEC),
+			   div64_u64(st->hw_sum, st->jobs * NSEC_PER_USEC));
+	}
+	mutex_unlock(&rp->lock);
+
+	return 0;
+}
+
+static int gsp_replay_result_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, gsp_replay_result_show, inode->i_private);
+}
+
+static const struct file_operations gsp_replay_result_fops = {
+	.open = gsp_replay_result_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+/* "loops [pace]" */
+static ssize_t gsp_replay_run_write(struct file *file, const char __user *ubuf,
+				    size_t len, loff_t *ppos)
+{
+	struct gsp_replay *rp = file->private_data;
+	u32 loops = 1, pace = 0;
+	char buf[32];
+	int ret;
+
+	if (len >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, ubuf, len))
+		return -EFAULT;
+	buf[len] = '\0';
+
+	if (sscanf(buf, "%u %u", &loops, &pace) < 1 || !loops ||
+	    loops > GSP_REPLAY_MAX_LOOPS)
+		return -EINVAL;
+
+	mutex_lock(&rp->lock);
+	if (rp->recording)
+		ret = -EBUSY;
+	else
+		ret = gsp_replay_run(rp, loops, pace);
+	mutex_unlock(&rp->lock);
+
+	return ret ? ret : len;
+}
+
+static const struct file_operations gsp_replay_run_fops = {
+	.open = simple_open,
+	.write = gsp_replay_run_write,
+	.llseek = no_llseek,
+};
+
+static ssize_t gsp_replay_record_read(struct file *file, char __user *ubuf,
+				      size_t len, loff_t *ppos)
+{
+	struct gsp_replay *rp = file->private_data;
+	char buf[4];
+	int n;
+
+	n = scnprintf(buf, sizeof(buf), "%d\n", READ_ONCE(rp->recording));
+
+	return simple_read_from_buffer(ubuf, len, ppos, buf, n);
+}
+
+/* 1 starts a new recording into an empty blob, 0 stops it */
+static ssize_t gsp_replay_record_write(struct file *file,
+				       const char __user *ubuf,
+				       size_t len, loff_t *ppos)
+{
+	struct gsp_replay *rp = file->private_data;
+	bool on;
+	int ret;
+
+	ret = kstrtobool_from_user(ubuf, len, &on);
+	if (ret)
+		return ret;
+
+	mutex_lock(&rp->lock);
+	if (on && !rp->recording) {
+		ret = gsp_replay_blob_alloc(rp);
+		if (!ret) {
+			gsp_replay_blob_reset(rp);
+			rp->t0 = ktime_get();
+		}
+	}
+	if (!ret)
+		WRITE_ONCE(rp->recording, on);
+	mutex_unlock(&rp->lock);
+
+	return ret ? ret : len;
+}
+
+static const struct file_operations gsp_replay_record_fops = {
+	.open = simple_open,
+	.read = gsp_replay_record_read,
+	.write = gsp_replay_record_write,
+	.llseek = default_llseek,
+};
+
+static ssize_t gsp_replay_blob_read(struct file *file, char __user *ubuf,
+				    size_t len, loff_t *ppos)
+{
+	struct gsp_replay *rp = file->private_data;
+	ssize_t ret = 0;
+
+	mutex_lock(&rp->lock);
+	if (rp->blob)
+		ret = simple_read_from_buffer(ubuf, len, ppos, rp->blob,
+					      rp->len);
+	mutex_unlock(&rp->lock);
+
+	return ret;
+}
+
+/* loads a blob saved earlier, a write at offset 0 starts a new one */
+static ssize_t gsp_replay_blob_write(struct file *file, const char __user *ubuf,
+				     size_t len, loff_t *ppos)
+{
+	struct gsp_replay *rp = file->private_data;
+	ssize_t ret;
+
+	mutex_lock(&rp->lock);
+	if (rp->recording) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	ret = gsp_replay_blob_alloc(rp);
+	if (ret)
+		goto out;
+
+	if (*ppos == 0)
+		rp->len = 0;
+	ret = simple_write_to_buffer(rp->blob, GSP_REPLAY_BLOB_SIZE, ppos,
+				     ubuf, len);
+	if (ret > 0)
+		rp->len = max_t(size_t, rp->len, *ppos);
+out:
+	mutex_unlock(&rp->lock);
+
+	return ret;
+}
+
+static const struct file_operations gsp_replay_blob_fops = {
+	.open = simple_open,
+	.read = gsp_replay_blob_read,
+	.write = gsp_replay_blob_write,
+	.llseek = default_llseek,
+};
+
+void gsp_replay_init(struct gsp_dev *gsp)
+{
+	struct gsp_replay *rp = &gsp_replay;
+
+	rp->stat = kcalloc(gsp->core_cnt, sizeof(*rp->stat), GFP_KERNEL);
+	if (!rp->stat)
+		return;
+
+	rp->gsp = gsp;
+	mutex_init(&rp->lock);
+
+	rp->dir = debugfs_create_dir("gsp", NULL);
+	if (IS_ERR_OR_NULL(rp->dir)) {
+		GSP_ERR("create gsp debugfs failed\n");
+		kfree(rp->stat);
+		rp->stat = NULL;
+		return;
+	}
+
+	debugfs_create_file("record", 0600, rp->dir, rp,
+			    &gsp_replay_record_fops);
+	debugfs_create_file("blob", 0600, rp->dir, rp, &gsp_replay_blob_fops);
+	debugfs_create_file("replay", 0200, rp->dir, rp,
+			    &gsp_replay_run_fops);
+	debugfs_create_file("result", 0400, rp->dir, rp,
+			    &gsp_replay_result_fops);
+}
+
+void gsp_replay_deinit(struct gsp_dev *gsp)
+{
+	struct gsp_replay *rp = &gsp_replay;
+
+	if (rp->gsp != gsp)
+		return;
+
+	debugfs_remove_recursive(rp->dir);
+	WRITE_ONCE(rp->recording, false);
+	vfree(rp->blob);
+	kfree(rp->stat);
+	memset(rp, 0, sizeof(*rp));
+}
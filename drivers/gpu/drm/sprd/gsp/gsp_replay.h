@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2015 Spreadtrum Communications Inc.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#ifndef _GSP_REPLAY_H
+#define _GSP_REPLAY_H
+
+#include <linux/types.h>
+
+struct gsp_dev;
+struct gsp_kcfg;
+struct gsp_kcfg_list;
+struct gsp_replay_job;
+
+/*
+ * Recorded job stream, read from and written to debugfs gsp/blob:
+ * one gsp_replay_header, then nr_rec records. A record is one trigger
+ * ioctl: gsp_replay_rec, nr_buf gsp_replay_buf and num cfgs of cfg_size
+ * bytes, in the core specific user layout of the compatible, padded
+ * to 8 bytes.
+ */
+#define GSP_REPLAY_MAGIC	0x50525347	/* "GSRP" */
+#define GSP_REPLAY_VERSION	1
+
+struct gsp_replay_header {
+	u32 magic;
+	u32 version;
+	char compatible[64];
+	u32 nr_rec;
+	u32 dropped;		/* records the blob had no room for */
+};
+
+struct gsp_replay_rec {
+	u32 len;		/* whole record, with bufs and cfgs */
+	u32 num;
+	u32 cfg_size;
+	u32 nr_buf;
+	u32 async;
+	u32 split;
+	u64 t_ns;		/* since the recording started */
+};
+
+/* a dma buffer the cfgs reference by the fd of the recording process */
+struct gsp_replay_buf {
+	s32 fd;
+	u32 heap_id;
+	u32 flags;
+	u32 reserved;
+	u64 size;
+};
+
+#ifdef CONFIG_DRM_SPRD_GSP_REPLAY
+void gsp_replay_init(struct gsp_dev *gsp);
+void gsp_replay_deinit(struct gsp_dev *gsp);
+void gsp_replay_record(struct gsp_kcfg_list *kl, void *cfg_arg);
+int gsp_replay_remap(struct gsp_replay_job *job, struct gsp_kcfg *kcfg);
+#else
+static inline void gsp_replay_init(struct gsp_dev *gsp)
+{
+}
+
+static inline void gsp_replay_deinit(struct gsp_dev *gsp)
+{
+}
+
+static inline void gsp_replay_record(struct gsp_kcfg_list *kl,
+				     void *cfg_arg)
+{
+}
+
+static inline int gsp_replay_remap(struct gsp_replay_job *job,
+				   struct gsp_kcfg *kcfg)
+{
+	return 0;
+}
+#endif
+
+#endif
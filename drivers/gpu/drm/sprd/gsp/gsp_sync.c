@@ -78,8 +78,6 @@ struct gsp_sync_timeline *gsp_sync_timeline_create(const char *name)
 		return NULL;
 	}
 
-
-	obj->fence_context = dma_fence_context_alloc(1);
 	spin_lock_init(&obj->fence_lock);
 	snprintf(obj->driver_name, sizeof(obj->timeline_name),
 			 "%s", name);
@@ -108,8 +106,13 @@ static int gsp_sync_sig_fence_create(struct gsp_sync_timeline *obj,
 		return -ENOMEM;
 	}
 
+	/*
+	 * kcfgs of one core may complete out of order once their acquire
+	 * fences decide the order, so every release fence gets a context
+	 * of its own instead of sharing the timeline one
+	 */
 	dma_fence_init(fence, &gsp_sync_fence_ops, &obj->fence_lock,
-				   obj->fence_context, ++obj->fence_seqno);
+				   dma_fence_context_alloc(1), ++obj->fence_seqno);
 
 	/*store the new fence with the sig_fen pointer */
 	*sig_fen = fence;
@@ -265,8 +268,7 @@ void gsp_sync_fence_free(struct gsp_fence_data *data)
 			continue;
 		}
 
-		dma_fence_put(data->wait_fen_arr[i]);
-		data->wait_fen_arr[i] = NULL;
+		gsp_sync_wait_fence_put(data, i);
 	}
 	data->wait_cnt = 0;
 
@@ -275,6 +277,62 @@ void gsp_sync_fence_free(struct gsp_fence_data *data)
 		gsp_sync_fence_signal(data);
 }
 
+static void gsp_sync_wait_fence_cb(struct dma_fence *fence,
+				   struct dma_fence_cb *cb)
+{
+	struct gsp_fence_cb *fcb = container_of(cb, struct gsp_fence_cb, cb);
+	struct gsp_fence_data *data = fcb->data;
+
+	if (atomic_dec_and_test(&data->wait_pending) && data->ready)
+		data->ready(data);
+}
+
+/*
+ * Hook the acquire fences so the kcfg can be picked as soon as the last
+ * one signals, instead of blocking the core kthread on them in turn.
+ * ready is not called for fences signaled already, the caller kicks the
+ * core after the push anyway.
+ */
+void gsp_sync_fence_arm(struct gsp_fence_data *data,
+			void (*ready)(struct gsp_fence_data *data))
+{
+	struct gsp_fence_cb *fcb = NULL;
+	int i = 0;
+
+	/* one extra count keeps ready from running while arming */
+	atomic_set(&data->wait_pending, 1);
+	data->ready = ready;
+
+	for (i = 0; i < data->wait_cnt; i++) {
+		if (!data->wait_fen_arr[i])
+			continue;
+
+		fcb = &data->wait_cb[i];
+		fcb->data = data;
+		atomic_inc(&data->wait_pending);
+		if (dma_fence_add_callback(data->wait_fen_arr[i], &fcb->cb,
+					   gsp_sync_wait_fence_cb))
+			atomic_dec(&data->wait_pending);
+	}
+
+	atomic_dec(&data->wait_pending);
+}
+
+bool gsp_sync_fence_is_ready(struct gsp_fence_data *data)
+{
+	return !atomic_read(&data->wait_pending);
+}
+
+static void gsp_sync_wait_fence_put(struct gsp_fence_data *data, int i)
+{
+	/* callback is either done or removed when this returns */
+	if (data->ready)
+		dma_fence_remove_callback(data->wait_fen_arr[i],
+					  &data->wait_cb[i].cb);
+	dma_fence_put(data->wait_fen_arr[i]);
+	data->wait_fen_arr[i] = NULL;
+}
+
 int gsp_sync_fence_wait(struct gsp_fence_data *data)
 {
 	signed long ret = 0;
@@ -299,8 +357,7 @@ int gsp_sync_fence_wait(struct gsp_fence_data *data)
 				i + 1, data->wait_cnt, ret);
 			return -1;
 		}
-		dma_fence_put(data->wait_fen_arr[i]);
-		data->wait_fen_arr[i] = NULL;
+		gsp_sync_wait_fence_put(data, i);
 	}
 	data->wait_cnt = 0;
 
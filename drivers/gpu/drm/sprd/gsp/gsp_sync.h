@@ -14,6 +14,7 @@
 #ifndef _GSP_SYNC_H
 #define _GSP_SYNC_H
 
+#include <linux/atomic.h>
 #include <linux/types.h>
 #include <linux/kconfig.h>
 #include <drm/gsp_cfg.h>
@@ -23,13 +24,19 @@
 #define GSP_WAIT_FENCE_MAX 8
 
 struct gsp_sync_timeline {
-	unsigned int fence_context;
 	spinlock_t fence_lock;
 	unsigned long fence_seqno;
 	char timeline_name[32];
 	char driver_name[32];
 };
 
+struct gsp_fence_data;
+
+struct gsp_fence_cb {
+	struct dma_fence_cb cb;
+	struct gsp_fence_data *data;
+};
+
 struct gsp_fence_data {
 
 	/* manage wait&sig sync fence */
@@ -37,6 +44,14 @@ struct gsp_fence_data {
 	struct dma_fence *wait_fen_arr[GSP_WAIT_FENCE_MAX];
 	int wait_cnt;
 
+	/*
+	 * set by gsp_sync_fence_arm(), ready is called from the
+	 * signaling context once wait_pending drops to zero
+	 */
+	struct gsp_fence_cb wait_cb[GSP_WAIT_FENCE_MAX];
+	atomic_t wait_pending;
+	void (*ready)(struct gsp_fence_data *data);
+
 	/* judge handling fence or not */
 	int32_t __user *ufd;
 	struct gsp_sync_timeline *tl;
@@ -55,6 +70,10 @@ void gsp_sync_fence_free(struct gsp_fence_data *data);
 
 int gsp_sync_fence_wait(struct gsp_fence_data *data);
 
+void gsp_sync_fence_arm(struct gsp_fence_data *data,
+			void (*ready)(struct gsp_fence_data *data));
+bool gsp_sync_fence_is_ready(struct gsp_fence_data *data);
+
 struct gsp_sync_timeline *gsp_sync_timeline_create(const char *name);
 void gsp_sync_timeline_destroy(struct gsp_sync_timeline *obj);
 #endif
@@ -185,6 +185,77 @@ static ssize_t fill_kcfg_num_show(struct device *dev,
 	return scnprintf(buf, PAGE_SIZE, "%d\n", num);
 }
 
+static ssize_t cost_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct gsp_core *core = NULL;
+	struct gsp_core_cost_stat st;
+
+	core = gsp_core_match(dev);
+	if (gsp_core_verify(core)) {
+		GSP_ERR("invalidate gsp device show core cost\n");
+		return -ENXIO;
+	}
+
+	st = core->cost_stat;
+
+	return scnprintf(buf, PAGE_SIZE,
+			 "pending: %ld\njobs: %llu\ncost: %llu\nns: %llu\n"
+			 "last cost: %lu\nlast ns: %llu\n",
+			 atomic_long_read(&core->pending_cost), st.jobs,
+			 st.cost_sum, st.ns_sum, st.last_cost, st.last_ns);
+}
+
+static const char * const gsp_stage_name[GSP_STAGE_NUM] = {
+	[GSP_STAGE_QUEUE] = "queue",
+	[GSP_STAGE_FENCE] = "fence",
+	[GSP_STAGE_HW] = "hw",
+	[GSP_STAGE_RELEASE] = "release",
+};
+
+/* one line per stage, bucket n counts the stages below 1 << n us */
+static ssize_t latency_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct gsp_core *core = NULL;
+	ssize_t len = 0;
+	int i, j;
+
+	core = gsp_core_match(dev);
+	if (gsp_core_verify(core)) {
+		GSP_ERR("invalidate gsp device show core latency\n");
+		return -ENXIO;
+	}
+
+	for (i = 0; i < GSP_STAGE_NUM; i++) {
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%s:",
+				 gsp_stage_name[i]);
+		for (j = 0; j < GSP_LATENCY_BUCKETS; j++)
+			len += scnprintf(buf + len, PAGE_SIZE - len, " %u",
+					 core->latency.hist[i][j]);
+		len += scnprintf(buf + len, PAGE_SIZE - len, "\n");
+	}
+
+	return len;
+}
+
+static ssize_t utilization_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	unsigned int util = 0;
+	struct gsp_core *core = NULL;
+
+	core = gsp_core_match(dev);
+	if (gsp_core_verify(core)) {
+		GSP_ERR("invalidate gsp device show core utilization\n");
+		return -ENXIO;
+	}
+
+	util = core->latency.util;
+
+	return scnprintf(buf, PAGE_SIZE, "%u.%u%%\n", util / 10, util % 10);
+}
+
 static struct device_attribute gsp_dev_attrs[] = {
 	__ATTR_RO(core_cnt),
 	__ATTR_RO(dev_state),
@@ -195,6 +266,9 @@ static struct device_attribute gsp_core_attrs[] = {
 	__ATTR_RO(total_kcfg_num),
 	__ATTR_RO(empty_kcfg_num),
 	__ATTR_RO(fill_kcfg_num),
+	__ATTR_RO(cost),
+	__ATTR_RO(latency),
+	__ATTR_RO(utilization),
 };
 
 int gsp_dev_sysfs_init(struct gsp_dev *gsp)
@@ -82,6 +82,92 @@ TRACE_EVENT(kcfg_put,
 						__entry->fill_cnt)
 );
 
+TRACE_EVENT(kcfg_trigger,
+	TP_PROTO(struct gsp_kcfg *kcfg),
+	TP_ARGS(kcfg),
+
+	TP_STRUCT__entry(
+		__field(int, id)
+		__field(int, ktag)
+	),
+	TP_fast_assign(
+		__entry->id = kcfg->bind_core->id;
+		__entry->ktag = kcfg->tag;
+	),
+	TP_printk("kcfg[%d] triggered on gsp-core[%d]",
+						__entry->ktag,
+						__entry->id)
+);
+
+TRACE_EVENT(core_irq,
+	TP_PROTO(struct gsp_core *core),
+	TP_ARGS(core),
+
+	TP_STRUCT__entry(
+		__field(int, id)
+		__field(int, state)
+	),
+	TP_fast_assign(
+		__entry->id = core->id;
+		__entry->state = atomic_read(&core->state);
+	),
+	TP_printk("gsp-core[%d] irq, state: %d",
+						__entry->id,
+						__entry->state)
+);
+
+TRACE_EVENT(kcfg_latency,
+	TP_PROTO(struct gsp_kcfg *kcfg, const u64 *ns),
+	TP_ARGS(kcfg, ns),
+
+	TP_STRUCT__entry(
+		__field(int, id)
+		__field(int, ktag)
+		__field(u64, queue)
+		__field(u64, fence)
+		__field(u64, hw)
+		__field(u64, release)
+	),
+	TP_fast_assign(
+		__entry->id = kcfg->bind_core->id;
+		__entry->ktag = kcfg->tag;
+		__entry->queue = ns[GSP_STAGE_QUEUE];
+		__entry->fence = ns[GSP_STAGE_FENCE];
+		__entry->hw = ns[GSP_STAGE_HW];
+		__entry->release = ns[GSP_STAGE_RELEASE];
+	),
+	TP_printk("kcfg[%d] on gsp-core[%d] , queue: %llu, fence: %llu, hw: %llu, release: %llu ns",
+						__entry->ktag,
+						__entry->id,
+						__entry->queue,
+						__entry->fence,
+						__entry->hw,
+						__entry->release)
+);
+
+TRACE_EVENT(kcfg_cost,
+	TP_PROTO(struct gsp_kcfg *kcfg, u64 ns),
+	TP_ARGS(kcfg, ns),
+
+	TP_STRUCT__entry(
+		__field(int, id)
+		__field(int, ktag)
+		__field(unsigned long, cost)
+		__field(u64, ns)
+	),
+	TP_fast_assign(
+		__entry->id = kcfg->bind_core->id;
+		__entry->ktag = kcfg->tag;
+		__entry->cost = kcfg->cost;
+		__entry->ns = ns;
+	),
+	TP_printk("kcfg[%d] on gsp-core[%d] , cost: %lu, ns: %llu",
+						__entry->ktag,
+						__entry->id,
+						__entry->cost,
+						__entry->ns)
+);
+
 #endif /* _GSP_TRACE_H */
 
 #undef TRACE_INCLUDE_PATH
@@ -208,6 +208,9 @@ void gsp_workqueue_put(struct gsp_kcfg *kcfg,
 		return;
 	}
 
+	/* drop its load before anyone can acquire it again */
+	gsp_core_unselect(gsp_workqueue_to_core(wq), kcfg);
+
 	mutex_lock(&wq->empty_lock);
 		list_add_tail(&kcfg->list, &wq->empty_head);
 		wq->empty_cnt++;
@@ -281,6 +284,70 @@ struct gsp_kcfg *gsp_workqueue_pull(struct gsp_workqueue *wq)
 	return kcfg;
 }
 
+/* an earlier kcfg of the same client is still waiting for its fences */
+static bool gsp_workqueue_client_blocked(struct gsp_workqueue *wq,
+					 struct gsp_kcfg *kcfg)
+{
+	struct gsp_kcfg *pos = NULL;
+
+	list_for_each_entry(pos, &wq->fill_head, list) {
+		if (pos == kcfg)
+			break;
+		if (pos->client == kcfg->client)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Pull the first kcfg whose acquire fences have all signaled, so one
+ * late producer does not stall the other clients queued behind it.
+ * kcfgs of one client keep their push order, and the head is pulled
+ * regardless once it waited GSP_WAIT_FENCE_TIMEOUT, to fail or finish
+ * in the fence wait as before. NULL if nothing is ready yet.
+ */
+struct gsp_kcfg *gsp_workqueue_pull_ready(struct gsp_workqueue *wq)
+{
+	int cnt = 0;
+	struct gsp_kcfg *pos = NULL;
+	struct gsp_kcfg *kcfg = NULL;
+
+	if (IS_ERR_OR_NULL(wq)) {
+		GSP_ERR("work queue pull params error\n");
+		return kcfg;
+	}
+
+	mutex_lock(&wq->fill_lock);
+	pos = list_first_entry_or_null(&wq->fill_head, struct gsp_kcfg, list);
+	if (pos && time_after_eq(jiffies, pos->push_time +
+				 msecs_to_jiffies(GSP_WAIT_FENCE_TIMEOUT))) {
+		kcfg = pos;
+	} else {
+		list_for_each_entry(pos, &wq->fill_head, list) {
+			if (gsp_kcfg_is_ready(pos)
+			    && !gsp_workqueue_client_blocked(wq, pos)) {
+				kcfg = pos;
+				break;
+			}
+		}
+	}
+
+	if (kcfg) {
+		GSP_DEBUG("workqueue pull ready kcfg[%d]\n",
+			  gsp_kcfg_to_tag(kcfg));
+		list_del_init(&kcfg->list);
+		wq->fill_cnt--;
+	}
+	cnt = wq->fill_cnt;
+	mutex_unlock(&wq->fill_lock);
+
+	if (kcfg)
+		trace_kcfg_pull(kcfg);
+	GSP_DEBUG("fill cnt: %d after workqueue pull\n", cnt);
+	return kcfg;
+}
+
 int gsp_workqueue_get_empty_kcfg_num(struct gsp_workqueue *wq)
 {
 	int num = 0;
@@ -52,6 +52,7 @@ int gsp_workqueue_init(struct gsp_workqueue *wq,
 		       struct gsp_core *core);
 
 struct gsp_kcfg *gsp_workqueue_pull(struct gsp_workqueue *wq);
+struct gsp_kcfg *gsp_workqueue_pull_ready(struct gsp_workqueue *wq);
 
 int gsp_workqueue_push(struct gsp_kcfg *kcfg,
 		       struct gsp_workqueue *const wq);
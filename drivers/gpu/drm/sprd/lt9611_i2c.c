@@ -12,6 +12,7 @@
  */
 
 #include "lt9611_i2c.h"
+#include <linux/bitmap.h>
 #include <linux/interrupt.h>
 #include <linux/of_gpio.h>
 #include <linux/of_irq.h>
@@ -87,33 +88,94 @@ static int lt9611_i2c_read(u8 reg, u8 *data, u16 length)
 	return length;
 }
 
-static int lt9611_i2c_write(u8 reg, u8 *data, u16 length)
+#define LT9611_BATCH_MAX	16
+
+static void lt9611_shadow_reset(void)
+{
+	lt9611_i2c.page = -1;
+	bitmap_zero(lt9611_i2c.shadow_valid, LT9611_PAGE_NR * 256);
+}
+
+/*
+ * Send a register table in as few i2c transfers as possible, one message
+ * per register so the chip sees the same single byte writes as before
+ * but the bus is only set up once per LT9611_BATCH_MAX of them. Writes
+ * of the already selected page are dropped, and with @update so are the
+ * registers already holding the value, which must only be used for plain
+ * settings, never for reset or trigger pulses.
+ */
+static int lt9611_write_regs(const struct lt9611_reg *regs, int n, bool update)
 {
-	int err;
-	u8 buf[length + 1];
 	struct i2c_client *i2c = lt9611_i2c.client;
-	struct i2c_msg msg;
+	struct i2c_msg msgs[LT9611_BATCH_MAX];
+	u8 bufs[LT9611_BATCH_MAX][2];
+	int page = lt9611_i2c.page;
+	int i, cnt = 0, idx, err;
+
+	for (i = 0; i < n; i++) {
+		u8 reg = regs[i].reg, val = regs[i].val;
+
+		if (reg == LT9611_PAGE_REG) {
+			if (page == val)
+				continue;
+			page = val;
+		} else if (page >= LT9611_PAGE_FIRST &&
+			   page < LT9611_PAGE_FIRST + LT9611_PAGE_NR) {
+			idx = page - LT9611_PAGE_FIRST;
+			if (update && test_bit(idx * 256 + reg,
+					       lt9611_i2c.shadow_valid) &&
+			    lt9611_i2c.shadow[idx][reg] == val)
+				continue;
+			lt9611_i2c.shadow[idx][reg] = val;
+			set_bit(idx * 256 + reg, lt9611_i2c.shadow_valid);
+		}
 
-	buf[0] = reg;
-	memcpy(&buf[1], data, length * sizeof(u8));
-	msg.flags = 0;
-	msg.buf = buf;
-	msg.addr = i2c->addr;
-	msg.len = length + 1;
+		bufs[cnt][0] = reg;
+		bufs[cnt][1] = val;
+		msgs[cnt].addr = i2c->addr;
+		msgs[cnt].flags = 0;
+		msgs[cnt].len = 2;
+		msgs[cnt].buf = bufs[cnt];
+		if (++cnt < LT9611_BATCH_MAX && i < n - 1)
+			continue;
+
+		err = i2c_transfer(i2c->adapter, msgs, cnt);
+		if (err < 0) {
+			LT_ERR("lt9611 i2c write error:%d\n", err);
+			lt9611_shadow_reset();
+			return err;
+		}
+		cnt = 0;
+	}
 
-	err = i2c_transfer(i2c->adapter, &msg, 1);
-	if (err < 0) {
-		LT_ERR("lt9611 i2c write error:%d\n", err);
-		LT_ERR("msg:%d-%d:%d\n", msg.addr, msg.len, msg.buf[0]);
-		return err;
+	if (cnt) {
+		err = i2c_transfer(i2c->adapter, msgs, cnt);
+		if (err < 0) {
+			LT_ERR("lt9611 i2c write error:%d\n", err);
+			lt9611_shadow_reset();
+			return err;
+		}
 	}
+	lt9611_i2c.page = page;
 
-	return length;
+	return 0;
+}
+
+static int lt9611_write_table(const struct lt9611_reg *regs, int n)
+{
+	return lt9611_write_regs(regs, n, false);
+}
+
+static int lt9611_update_table(const struct lt9611_reg *regs, int n)
+{
+	return lt9611_write_regs(regs, n, true);
 }
 
 static void hdmi_writei2c_byte(u8 reg, u8 value)
 {
-	lt9611_i2c_write(reg, &value, 1);
+	struct lt9611_reg r = { reg, value };
+
+	lt9611_write_table(&r, 1);
 }
 
 static u8 hdmi_readi2c_byte(u8 reg)
@@ -151,50 +213,58 @@ void lt9611_rst_pd_init(void)
 	hdmi_writei2c_byte(0x01, 0x00); /* i2s stop work */
 }
 
-void lt9611_system_init(void)
-{
-	//hdmi_writei2c_byte(0xFF, 0x81);
-	//hdmi_writei2c_byte(0x01, 0x18); //sel xtal clock
+static const struct lt9611_reg lt9611_system_regs[] = {
+	//{ 0xFF, 0x81 },
+	//{ 0x01, 0x18 }, //sel xtal clock
 	//GPIO init
-	//hdmi_writei2c_byte(0x46, 0x8b); //select IRQ from multifunction
+	//{ 0x46, 0x8b }, //select IRQ from multifunction
 
-	hdmi_writei2c_byte(0xFF, 0x82);
-	hdmi_writei2c_byte(0x51, 0x11);
+	{ 0xFF, 0x82 },
+	{ 0x51, 0x11 },
 	//Timer for Frequency meter
-	hdmi_writei2c_byte(0xFF, 0x82);
-	hdmi_writei2c_byte(0x1b, 0x69); //Timer 2
-	hdmi_writei2c_byte(0x1c, 0x78);
-	hdmi_writei2c_byte(0xcb, 0x69); //Timer 1
-	hdmi_writei2c_byte(0xcc, 0x78);
+	{ 0x1b, 0x69 }, //Timer 2
+	{ 0x1c, 0x78 },
+	{ 0xcb, 0x69 }, //Timer 1
+	{ 0xcc, 0x78 },
 
 	/*power consumption for work*/
-	hdmi_writei2c_byte(0xff, 0x80);
-	hdmi_writei2c_byte(0x04, 0xf0);
-	hdmi_writei2c_byte(0x06, 0xf0);
-	hdmi_writei2c_byte(0x0a, 0x80);
-	hdmi_writei2c_byte(0x0b, 0x46); //csc clk
-	hdmi_writei2c_byte(0x0d, 0xef);
-	hdmi_writei2c_byte(0x11, 0xfa);
+	{ 0xff, 0x80 },
+	{ 0x04, 0xf0 },
+	{ 0x06, 0xf0 },
+	{ 0x0a, 0x80 },
+	{ 0x0b, 0x46 }, //csc clk
+	{ 0x0d, 0xef },
+	{ 0x11, 0xfa },
+};
 
+void lt9611_system_init(void)
+{
+	lt9611_write_table(lt9611_system_regs,
+			   ARRAY_SIZE(lt9611_system_regs));
 }
 
+static const struct lt9611_reg lt9611_mipi_analog_regs[] = {
+	//mipi mode
+	{ 0xff, 0x81 },
+	{ 0x06, 0x20 }, //port A rx current
+	{ 0x07, 0x3f }, //eq
+	{ 0x08, 0x3f }, //eq
+	{ 0x0a, 0xfe }, //port A ldo voltage set
+	{ 0x0b, 0xbf }, //enable port A lprx
+	{ 0x11, 0x20 }, //port B rx current
+	{ 0x12, 0x3f }, //eq
+	{ 0x13, 0x3f }, //eq
+	{ 0x15, 0xfe }, //port B ldo voltage set
+	{ 0x16, 0xbf }, //enable port B lprx
+
+	{ 0x1c, 0x03 }, //PortA clk lane no-LP mode.
+	{ 0x20, 0x03 }, //PortB clk lane no-LP mode.
+};
+
 void lt9611_mipi_input_analog(void)
 {
-	//mipi mode
-	hdmi_writei2c_byte(0xff, 0x81);
-	hdmi_writei2c_byte(0x06, 0x20); //port A rx current
-	hdmi_writei2c_byte(0x07, 0x3f); //eq
-	hdmi_writei2c_byte(0x08, 0x3f); //eq
-	hdmi_writei2c_byte(0x0a, 0xfe); //port A ldo voltage set
-	hdmi_writei2c_byte(0x0b, 0xbf); //enable port A lprx
-	hdmi_writei2c_byte(0x11, 0x20); //port B rx current
-	hdmi_writei2c_byte(0x12, 0x3f); //eq
-	hdmi_writei2c_byte(0x13, 0x3f); //eq
-	hdmi_writei2c_byte(0x15, 0xfe); //port B ldo voltage set
-	hdmi_writei2c_byte(0x16, 0xbf); //enable port B lprx
-
-	hdmi_writei2c_byte(0x1c, 0x03); //PortA clk lane no-LP mode.
-	hdmi_writei2c_byte(0x20, 0x03); //PortB clk lane no-LP mode.
+	lt9611_write_table(lt9611_mipi_analog_regs,
+			   ARRAY_SIZE(lt9611_mipi_analog_regs));
 }
 
 void lt9611_mipi_input_digtal(void)
@@ -318,26 +388,30 @@ void show_timing(struct video_timing *video_timing)
 
 void lt9611_mipi_video_timing(struct video_timing *video_timing)
 {
+	struct lt9611_reg regs[] = {
+		{ 0xff, 0x83 },
+		{ 0x0d, (u8)(video_timing->vtotal / 256) },
+		{ 0x0e, (u8)(video_timing->vtotal % 256) }, //vtotal
+		{ 0x0f, (u8)(video_timing->vact / 256) },
+		{ 0x10, (u8)(video_timing->vact % 256) },  //vactive
+		{ 0x11, (u8)(video_timing->htotal / 256) },
+		{ 0x12, (u8)(video_timing->htotal % 256) }, //htotal
+		{ 0x13, (u8)(video_timing->hact / 256) },
+		{ 0x14, (u8)(video_timing->hact % 256) }, //hactive
+		{ 0x15, (u8)(video_timing->vs % 256) },   //vsa
+		{ 0x16, (u8)(video_timing->hs % 256) },   //hsa
+		{ 0x17, (u8)(video_timing->vfp % 256) },  //vfp
+		{ 0x18, (u8)((video_timing->vs +
+			      video_timing->vbp) % 256) },  //vss
+		{ 0x19, (u8)(video_timing->hfp % 256) },  //hfp
+		{ 0x1a, (u8)(((video_timing->hfp / 256) << 4) +
+			     (video_timing->hs + video_timing->hbp) / 256) },
+		{ 0x1b, (u8)((video_timing->hs +
+			      video_timing->hbp) % 256) },  //hss
+	};
+
 	show_timing(video_timing);
-	hdmi_writei2c_byte(0xff, 0x83);
-	hdmi_writei2c_byte(0x0d, (u8)(video_timing->vtotal / 256));
-	hdmi_writei2c_byte(0x0e, (u8)(video_timing->vtotal % 256));//vtotal
-	hdmi_writei2c_byte(0x0f, (u8)(video_timing->vact / 256));
-	hdmi_writei2c_byte(0x10, (u8)(video_timing->vact % 256));  //vactive
-	hdmi_writei2c_byte(0x11, (u8)(video_timing->htotal / 256));
-	hdmi_writei2c_byte(0x12, (u8)(video_timing->htotal % 256));//htotal
-	hdmi_writei2c_byte(0x13, (u8)(video_timing->hact / 256));
-	hdmi_writei2c_byte(0x14, (u8)(video_timing->hact % 256)); //hactive
-	hdmi_writei2c_byte(0x15, (u8)(video_timing->vs % 256));   //vsa
-	hdmi_writei2c_byte(0x16, (u8)(video_timing->hs % 256));   //hsa
-	hdmi_writei2c_byte(0x17, (u8)(video_timing->vfp % 256));  //vfp
-	hdmi_writei2c_byte(0x18, (u8)((video_timing->vs +
-				video_timing->vbp) % 256));  //vss
-	hdmi_writei2c_byte(0x19, (u8)(video_timing->hfp % 256));  //hfp
-	hdmi_writei2c_byte(0x1a, (u8)(((video_timing->hfp / 256) << 4) +
-			(video_timing->hs + video_timing->hbp) / 256));
-	hdmi_writei2c_byte(0x1b, (u8)((video_timing->hs +
-				video_timing->hbp) % 256));  //hss
+	lt9611_update_table(regs, ARRAY_SIZE(regs));
 }
 
 void lt9611_mipi_pcr(struct video_timing *video_timing)
@@ -434,6 +508,20 @@ void lt9611_mipi_pcr(struct video_timing *video_timing)
 	hdmi_writei2c_byte(0x11, 0xfa);
 }
 
+static const struct lt9611_reg lt9611_pll_regs[] = {
+	{ 0xff, 0x81 },
+	{ 0x23, 0x40 },
+	{ 0x24, 0x62 }, //0x62, LG25UM58 issue, 20180824
+	{ 0x25, 0x80 }, //pre-divider
+	{ 0x26, 0x55 },
+	{ 0x2c, 0x37 },
+	//{ 0x2d, 0x99 }, //txpll_divx_set&da_txpll_freq_set
+	//{ 0x2e, 0x01 },
+	{ 0x2f, 0x01 },
+	{ 0x27, 0x66 },
+	{ 0x28, 0x88 },
+};
+
 int lt9611_pll(struct video_timing *video_timing)
 {
 	u32 pclk;
@@ -449,18 +537,7 @@ int lt9611_pll(struct video_timing *video_timing)
 	pclk = video_timing->pclk_khz;
 	LT_INFO("set rx pll = %d\n", pclk); //Dec
 
-	hdmi_writei2c_byte(0xff, 0x81);
-	hdmi_writei2c_byte(0x23, 0x40);
-	hdmi_writei2c_byte(0x24, 0x62); //0x62, LG25UM58 issue, 20180824
-	hdmi_writei2c_byte(0x25, 0x80); //pre-divider
-	hdmi_writei2c_byte(0x26, 0x55);
-	hdmi_writei2c_byte(0x2c, 0x37);
-	//hdmi_writei2c_byte(0x2d, 0x99); //txpll_divx_set&da_txpll_freq_set
-	//hdmi_writei2c_byte(0x2e, 0x01);
-	hdmi_writei2c_byte(0x2f, 0x01);
-	hdmi_writei2c_byte(0x26, 0x55);
-	hdmi_writei2c_byte(0x27, 0x66);
-	hdmi_writei2c_byte(0x28, 0x88);
+	lt9611_update_table(lt9611_pll_regs, ARRAY_SIZE(lt9611_pll_regs));
 
 	if (pclk > 150000) {
 		hdmi_writei2c_byte(0x2d, 0x88);
@@ -527,81 +604,91 @@ int lt9611_pll(struct video_timing *video_timing)
 
 void lt9611_hdmi_tx_phy(void)
 {
-	hdmi_writei2c_byte(0xff, 0x81);
-	hdmi_writei2c_byte(0x30, 0x6a);
-	if (lt9611.hdmi_coupling_mode == AC_MODE) {
-		hdmi_writei2c_byte(0x31, 0x73); //DC: 0x44, AC:0x73
-	} else { //lt9611.hdmi_coupling_mode == dc_mode
-		hdmi_writei2c_byte(0x31, 0x44);
-	}
-	hdmi_writei2c_byte(0x32, 0x4a);
-	hdmi_writei2c_byte(0x33, 0x0b);
-	hdmi_writei2c_byte(0x34, 0x00);
-	hdmi_writei2c_byte(0x35, 0x00);
-	hdmi_writei2c_byte(0x36, 0x00);
-	hdmi_writei2c_byte(0x37, 0x44);
-	hdmi_writei2c_byte(0x3f, 0x0f);
-	hdmi_writei2c_byte(0x40, 0xa0);
-	hdmi_writei2c_byte(0x41, 0xa0);
-	hdmi_writei2c_byte(0x42, 0xa0);
-	hdmi_writei2c_byte(0x43, 0xa0);
-	hdmi_writei2c_byte(0x44, 0x0a);
+	struct lt9611_reg regs[] = {
+		{ 0xff, 0x81 },
+		{ 0x30, 0x6a },
+		//DC: 0x44, AC:0x73
+		{ 0x31, lt9611.hdmi_coupling_mode == AC_MODE ? 0x73 : 0x44 },
+		{ 0x32, 0x4a },
+		{ 0x33, 0x0b },
+		{ 0x34, 0x00 },
+		{ 0x35, 0x00 },
+		{ 0x36, 0x00 },
+		{ 0x37, 0x44 },
+		{ 0x3f, 0x0f },
+		{ 0x40, 0xa0 },
+		{ 0x41, 0xa0 },
+		{ 0x42, 0xa0 },
+		{ 0x43, 0xa0 },
+		{ 0x44, 0x0a },
+	};
+
+	lt9611_write_table(regs, ARRAY_SIZE(regs));
 }
 
-void lt9611_hdmi_out_enable(void)
-{
-	hdmi_writei2c_byte(0xff, 0x81);
-	hdmi_writei2c_byte(0x23, 0x40);
+static const struct lt9611_reg lt9611_out_enable_regs[] = {
+	{ 0xff, 0x81 },
+	{ 0x23, 0x40 },
 
-	hdmi_writei2c_byte(0xff, 0x82);
-	hdmi_writei2c_byte(0xde, 0x20);
-	hdmi_writei2c_byte(0xde, 0xe0);
+	{ 0xff, 0x82 },
+	{ 0xde, 0x20 },
+	{ 0xde, 0xe0 },
 
-	hdmi_writei2c_byte(0xff, 0x80);
-	hdmi_writei2c_byte(0x18, 0xdc); /* txpll sw rst */
-	hdmi_writei2c_byte(0x18, 0xfc);
-	hdmi_writei2c_byte(0x16, 0xf1); /* txpll calibration rest */
-	hdmi_writei2c_byte(0x16, 0xf3);
+	{ 0xff, 0x80 },
+	{ 0x18, 0xdc }, /* txpll sw rst */
+	{ 0x18, 0xfc },
+	{ 0x16, 0xf1 }, /* txpll calibration rest */
+	{ 0x16, 0xf3 },
 
-	hdmi_writei2c_byte(0x11, 0x5a); //Pcr reset
-	hdmi_writei2c_byte(0x11, 0xfa);
+	{ 0x11, 0x5a }, //Pcr reset
+	{ 0x11, 0xfa },
 
-	hdmi_writei2c_byte(0xff, 0x81);
-	hdmi_writei2c_byte(0x30, 0xea);
+	{ 0xff, 0x81 },
+	{ 0x30, 0xea },
+};
+
+void lt9611_hdmi_out_enable(void)
+{
+	lt9611_write_table(lt9611_out_enable_regs,
+			   ARRAY_SIZE(lt9611_out_enable_regs));
 }
 
+static const struct lt9611_reg lt9611_out_disable_regs[] = {
+	{ 0xff, 0x81 },
+	{ 0x30, 0x00 }, /* Txphy PD */
+	{ 0x23, 0x80 }, /* Txpll PD */
+};
+
 void lt9611_hdmi_out_disable(void)
 {
-	hdmi_writei2c_byte(0xff, 0x81);
-	hdmi_writei2c_byte(0x30, 0x00); /* Txphy PD */
-	hdmi_writei2c_byte(0x23, 0x80); /* Txpll PD */
+	lt9611_write_table(lt9611_out_disable_regs,
+			   ARRAY_SIZE(lt9611_out_disable_regs));
 }
 
 void lt9611_hdmi_tx_digital(struct video_timing *video_timing)
 {
 	u8 HDMI_VIC = video_timing->vic;
 	u8 AR = video_timing->aspact_ratio;
-	u8 pb0, pb2, pb4;
-
-	pb2 =  (AR << 4) + 0x08;
-	pb4 =  HDMI_VIC;
+	u8 pb2 = (AR << 4) + 0x08;
+	u8 pb4 = HDMI_VIC;
+	struct lt9611_reg regs[] = {
+		//AVI
+		{ 0xff, 0x84 },
+		{ 0x43, 0 },     //AVI_PB0
+		//{ 0x44, 0x10 },  //AVI_PB1
+		{ 0x45, pb2 },   //AVI_PB2
+		{ 0x47, pb4 },   //AVI_PB4
+
+		{ 0x10, 0x02 }, //data iland
+		{ 0x12, 0x40 }, //act_h_blank
+	};
 
 	if ((pb2 + pb4) < 0x5f)
-		pb0 = 0x5f - pb2 - pb4;
+		regs[1].val = 0x5f - pb2 - pb4;
 	else
-		pb0 = 0x15f - pb2 - pb4;
-
-	//AVI
-	hdmi_writei2c_byte(0xff, 0x84);
-	hdmi_writei2c_byte(0x43, pb0);   //AVI_PB0
-
-	//hdmi_writei2c_byte(0x44, 0x10);                    //AVI_PB1
-	hdmi_writei2c_byte(0x45, pb2);            //AVI_PB2
-	hdmi_writei2c_byte(0x47, pb4);                //AVI_PB4
+		regs[1].val = 0x15f - pb2 - pb4;
 
-	hdmi_writei2c_byte(0xff, 0x84);
-	hdmi_writei2c_byte(0x10, 0x02); //data iland
-	hdmi_writei2c_byte(0x12, 0x40); //act_h_blank
+	lt9611_update_table(regs, ARRAY_SIZE(regs));
 }
 
 void lt9611_csc(void)
@@ -673,10 +760,40 @@ void lt9611_irq_init(void)
 	//flag3 = (hdmi_readi2c_byte(0x0f);
 }
 
+#ifdef _enable_read_edid_
+/* read the 32 bytes of the edid at @i * 32 */
+static int lt9611_read_edid_chunk(u8 i, u8 *buf)
+{
+	u8 j;
+
+	hdmi_writei2c_byte(0x05, i * 32);
+	hdmi_writei2c_byte(0x07, 0x36);
+	msleep(5);
+	hdmi_writei2c_byte(0x07, 0x31);
+	hdmi_writei2c_byte(0x07, 0x37);
+	msleep(20);
+	if (!(hdmi_readi2c_byte(0x40) & 0x02)) {
+		LT_INFO("read edid failed: accs not done\n");
+		return -ETIMEDOUT;
+	}
+	if (hdmi_readi2c_byte(0x40) & 0x50) {
+		LT_INFO("read edid failed: no ack\n");
+		return -EIO;
+	}
+
+	for (j = 0; j < 32; j++)
+		buf[j] = hdmi_readi2c_byte(0x83);
+
+	return 0;
+}
+#endif
+
 void lt9611_read_edid(void)
 {
 #ifdef _enable_read_edid_
-	u8 i, j;
+	u8 *edid = lt9611_i2c.edid;
+	u8 buf[256];
+	u8 i;
 
 	hdmi_writei2c_byte(0xff, 0x85);
 	//hdmi_writei2c_byte(0x02, 0x0a);
@@ -685,32 +802,33 @@ void lt9611_read_edid(void)
 	hdmi_writei2c_byte(0x05, 0x00);
 	hdmi_writei2c_byte(0x06, 0x20);
 	hdmi_writei2c_byte(0x14, 0x7f);
+
+	/*
+	 * The last chunk of each block ends with its checksum, when both
+	 * match the cached edid it is the same sink plugged back, so skip
+	 * the six other chunks at 25ms each.
+	 */
+	if (lt9611_i2c.edid_valid &&
+	    !lt9611_read_edid_chunk(3, &buf[96]) &&
+	    !lt9611_read_edid_chunk(7, &buf[224]) &&
+	    !memcmp(&buf[96], &edid[96], 32) &&
+	    !memcmp(&buf[224], &edid[224], 32)) {
+		LT_INFO("edid unchanged, checksum = %x\n", edid[255]);
+		goto end;
+	}
+
+	lt9611_i2c.edid_valid = false;
 	for (i = 0; i < 8; i++) {
-		hdmi_writei2c_byte(0x05, i * 32);
-		hdmi_writei2c_byte(0x07, 0x36);
-		msleep(5);
-		hdmi_writei2c_byte(0x07, 0x31);
-		hdmi_writei2c_byte(0x07, 0x37);
-		msleep(20);
-		if (hdmi_readi2c_byte(0x40) & 0x02) {
-			if (hdmi_readi2c_byte(0x40) & 0x50) {
-				LT_INFO("read edid failed: no ack\n");
-				goto end;
-			} else {
-				for (j = 0; j < 32; j++) {
-					Sink_EDID[i * 32 + j] = hdmi_readi2c_byte(0x83);
-				}
-			}
-		} else {
-			LT_INFO("read edid failed: accs not done\n");
+		if (lt9611_read_edid_chunk(i, &buf[i * 32]))
 			goto end;
-		}
 	}
-	LT_INFO("read edid succeeded, checksum = %ld\n", Sink_EDID[255]);
+	memcpy(edid, buf, sizeof(buf));
+	lt9611_i2c.edid_valid = true;
+	LT_INFO("read edid succeeded, checksum = %x\n", edid[255]);
 
 end:
-hdmi_writei2c_byte(0x03, 0xc2);
-hdmi_writei2c_byte(0x07, 0x1f);
+	hdmi_writei2c_byte(0x03, 0xc2);
+	hdmi_writei2c_byte(0x07, 0x1f);
 #endif
 }
 
@@ -906,6 +1024,7 @@ static int lt9211_suspend(void)
 static int sprd_hdmi_notifier_call(struct notifier_block *nb,
 				   unsigned long code, void *_param)
 {
+	mutex_lock(&lt9611_i2c.lock);
 	switch (code) {
 	case SPRD_HDMI_RESUME:
 		lt9211_resume();
@@ -918,6 +1037,7 @@ static int sprd_hdmi_notifier_call(struct notifier_block *nb,
 	default:
 		break;
 	}
+	mutex_unlock(&lt9611_i2c.lock);
 
 	return 0;
 }
@@ -998,6 +1118,7 @@ int hdmi_notifier_call_chain(unsigned long val, void *v)
 
 static void lt9611_hpd_work_func(struct work_struct *work)
 {
+	mutex_lock(&lt9611_i2c.lock);
 	lt9611_hpd_status();
 	if (tx_hpd) {
 		LT_INFO("Detect hpd High\n");
@@ -1009,12 +1130,14 @@ static void lt9611_hpd_work_func(struct work_struct *work)
 		lt9611_hdcp_disable();
 		lt9611_hdmi_out_disable();
 	}
+	mutex_unlock(&lt9611_i2c.lock);
 }
 
 static irqreturn_t lt9611_irq_thread_handler(int irq, void *dev_id)
 {
 	u8 irq_flag3 = 0;
 
+	mutex_lock(&lt9611_i2c.lock);
 	hdmi_writei2c_byte(0xff, 0x82);
 	irq_flag3 = hdmi_readi2c_byte(0x0f);
 
@@ -1032,6 +1155,7 @@ static irqreturn_t lt9611_irq_thread_handler(int irq, void *dev_id)
 		hdmi_writei2c_byte(0x07, 0x7f);
 		hdmi_writei2c_byte(0x07, 0x3f);
 	}
+	mutex_unlock(&lt9611_i2c.lock);
 
 	if (irq_flag3 & 0xc0)
 		schedule_work(&lt9611_i2c.hpd_work);
@@ -1055,6 +1179,8 @@ static int lt9611_i2c_probe(struct i2c_client *client,
 	LT_INFO("lt_slave_addr:0x%X,client->addr:%X\n",
 		lt_slave_addr, client->addr);
 	lt9611_i2c.client = client;
+	mutex_init(&lt9611_i2c.lock);
+	lt9611_shadow_reset();
 	lt9611_chip_id();
 
 	ret = lt9611_init();
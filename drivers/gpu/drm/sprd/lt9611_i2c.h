@@ -128,12 +128,30 @@ enum videoformat {
 	VIDEO_NONE
 };
 
+/* registers 0x00-0xfe of the page selected by writing 0xff */
+#define LT9611_PAGE_REG		0xff
+#define LT9611_PAGE_FIRST	0x80
+#define LT9611_PAGE_NR		7
+
+struct lt9611_reg {
+	u8 reg;
+	u8 val;
+};
+
 struct lt9611_i2c {
 	struct i2c_client *client;
 	struct platform_device *mp_dev;
 	u32 chipid;
 	int irq;
 	struct work_struct hpd_work;
+	/* the irq thread, hpd work and suspend/resume share the page */
+	struct mutex lock;
+	int page;	/* selected page, -1 when unknown */
+	/* last value written to each register, for lt9611_update_table() */
+	u8 shadow[LT9611_PAGE_NR][256];
+	DECLARE_BITMAP(shadow_valid, LT9611_PAGE_NR * 256);
+	u8 edid[256];
+	bool edid_valid;
 };
 
 
@@ -24,6 +24,9 @@
 #define U_MAX_LEVEL	255
 #define U_MIN_LEVEL	0
 
+/* one ramp step per frame at 60 fps */
+#define RAMP_PERIOD_MS	16
+
 void sprd_backlight_normalize_map(struct backlight_device *bd, u16 *level)
 {
 	struct sprd_backlight *bl = bl_get_data(bd);
@@ -36,12 +39,77 @@ void sprd_backlight_normalize_map(struct backlight_device *bd, u16 *level)
 		*level = bl->levels[bd->props.brightness];
 }
 
-int sprd_cabc_backlight_update(struct backlight_device *bd)
+static void sprd_backlight_apply(struct sprd_backlight *bl, u32 level)
 {
-	struct sprd_backlight *bl = bl_get_data(bd);
 	struct pwm_state state;
 	u64 duty_cycle;
 
+	pwm_get_state(bl->pwm, &state);
+	if (level > 0) {
+		duty_cycle = (u64)level * state.period;
+		do_div(duty_cycle, bl->scale);
+		state.duty_cycle = duty_cycle;
+		state.enabled = true;
+	} else {
+		state.duty_cycle = 0;
+		state.enabled = false;
+	}
+	pwm_apply_state(bl->pwm, &state);
+
+	bl->cur_level = level;
+}
+
+/*
+ * Walks the pwm to the target level, so one brightness write from user
+ * space gives a smooth transition instead of a series of writes.
+ */
+static void sprd_backlight_ramp_work(struct work_struct *work)
+{
+	struct sprd_backlight *bl = container_of(to_delayed_work(work),
+					struct sprd_backlight, ramp_work);
+	u32 level;
+
+	mutex_lock(&bl->bd->update_lock);
+
+	if (bl->cur_level < bl->target_level)
+		level = min(bl->cur_level + bl->ramp_step, bl->target_level);
+	else
+		level = max_t(int, bl->cur_level - bl->ramp_step,
+			      bl->target_level);
+
+	if (level != bl->cur_level)
+		sprd_backlight_apply(bl, level);
+
+	if (bl->cur_level != bl->target_level)
+		schedule_delayed_work(&bl->ramp_work,
+				      msecs_to_jiffies(RAMP_PERIOD_MS));
+
+	mutex_unlock(&bl->bd->update_lock);
+}
+
+static void sprd_backlight_set_level(struct sprd_backlight *bl, u32 level)
+{
+	u32 steps = bl->ramp_ms / RAMP_PERIOD_MS;
+
+	bl->target_level = level;
+
+	/* off and on are not delayed, nor is anything without a ramp */
+	if (steps < 2 || !level || !bl->cur_level) {
+		cancel_delayed_work(&bl->ramp_work);
+		sprd_backlight_apply(bl, level);
+		return;
+	}
+
+	bl->ramp_step = DIV_ROUND_UP(abs((int)level - (int)bl->cur_level),
+				     steps);
+	if (!delayed_work_pending(&bl->ramp_work))
+		schedule_delayed_work(&bl->ramp_work, 0);
+}
+
+int sprd_cabc_backlight_update(struct backlight_device *bd)
+{
+	struct sprd_backlight *bl = bl_get_data(bd);
+
 	mutex_lock(&bd->update_lock);
 
 	if (bd->props.power != FB_BLANK_UNBLANK ||
@@ -53,11 +121,10 @@ int sprd_cabc_backlight_update(struct backlight_device *bd)
 
 	pr_debug("cabc brightness level: %u\n", bl->cabc_level);
 
-	pwm_get_state(bl->pwm, &state);
-	duty_cycle = bl->cabc_level * state.period;
-	do_div(duty_cycle, bl->scale);
-	state.duty_cycle = duty_cycle;
-	pwm_apply_state(bl->pwm, &state);
+	/* cabc follows the frames itself, a running ramp is dropped */
+	cancel_delayed_work(&bl->ramp_work);
+	bl->target_level = bl->cabc_level;
+	sprd_backlight_apply(bl, bl->cabc_level);
 
 	mutex_unlock(&bd->update_lock);
 
@@ -67,7 +134,6 @@ int sprd_cabc_backlight_update(struct backlight_device *bd)
 static int sprd_pwm_backlight_update(struct backlight_device *bd)
 {
 	struct sprd_backlight *bl = bl_get_data(bd);
-	struct pwm_state state;
 	u64 duty_cycle;
 	u16 level;
 
@@ -78,27 +144,19 @@ static int sprd_pwm_backlight_update(struct backlight_device *bd)
 	    bd->props.state & BL_CORE_FBBLANK)
 		level = 0;
 
-	pwm_get_state(bl->pwm, &state);
 	if (level > 0) {
 		if (bl->cabc_en)
 			duty_cycle = DIV_ROUND_CLOSEST_ULL(bl->cabc_level *
 				level, bl->cabc_refer_level);
 		else
 			duty_cycle = level;
-
-		pr_debug("pwm brightness level: %llu\n", duty_cycle);
-
-		duty_cycle *= state.period;
-		do_div(duty_cycle, bl->scale);
-		state.duty_cycle = duty_cycle;
-		state.enabled = true;
 	} else {
-		pr_debug("pwm brightness level: %u\n", level);
-
-		state.duty_cycle = 0;
-		state.enabled = false;
+		duty_cycle = 0;
 	}
-	pwm_apply_state(bl->pwm, &state);
+
+	pr_debug("pwm brightness level: %llu\n", duty_cycle);
+
+	sprd_backlight_set_level(bl, duty_cycle);
 
 	return 0;
 }
@@ -165,6 +223,11 @@ static int sprd_backlight_parse_dt(struct device *dev,
 	else
 		bl->scale = bl->max_level;
 
+	/* 0 applies every brightness change at once */
+	ret = of_property_read_u32(node, "sprd,brightness-ramp-ms", &value);
+	if (!ret)
+		bl->ramp_ms = value;
+
 	return 0;
 }
 
@@ -195,6 +258,7 @@ static int sprd_backlight_probe(struct platform_device *pdev)
 	}
 
 	pwm_init_state(bl->pwm, &state);
+	INIT_DELAYED_WORK(&bl->ramp_work, sprd_backlight_ramp_work);
 
 	ret = pwm_apply_state(bl->pwm, &state);
 	if (ret) {
@@ -210,6 +274,7 @@ static int sprd_backlight_probe(struct platform_device *pdev)
 		dev_err(&pdev->dev, "failed to register sprd backlight ops\n");
 		return PTR_ERR(bd);
 	}
+	bl->bd = bd;
 
 	bd->props.max_brightness = 255;
 	bd->props.state &= ~BL_CORE_FBBLANK;
@@ -230,6 +295,16 @@ static int sprd_backlight_probe(struct platform_device *pdev)
 	return 0;
 }
 
+static int sprd_backlight_remove(struct platform_device *pdev)
+{
+	struct backlight_device *bd = platform_get_drvdata(pdev);
+	struct sprd_backlight *bl = bl_get_data(bd);
+
+	cancel_delayed_work_sync(&bl->ramp_work);
+
+	return 0;
+}
+
 static const struct of_device_id sprd_backlight_of_match[] = {
 	{ .compatible = "sprd,sharkl5pro-backlight" },
 	{ .compatible = "sprd,roc1-backlight" },
@@ -244,6 +319,7 @@ static struct platform_driver sprd_backlight_driver = {
 		.of_match_table	= sprd_backlight_of_match,
 	},
 	.probe		= sprd_backlight_probe,
+	.remove		= sprd_backlight_remove,
 };
 
 module_platform_driver(sprd_backlight_driver);
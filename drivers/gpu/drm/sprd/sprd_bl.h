@@ -14,6 +14,9 @@
 #ifndef _SPRD_BL_H_
 #define _SPRD_BL_H_
 
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
+
 struct sprd_backlight {
 	/* pwm backlight parameters */
 	struct pwm_device *pwm;
@@ -28,6 +31,14 @@ struct sprd_backlight {
 	bool cabc_en;
 	u32 cabc_level;
 	u32 cabc_refer_level;
+
+	/* brightness ramp, levels in units of scale */
+	struct backlight_device *bd;
+	struct delayed_work ramp_work;
+	u32 ramp_ms;
+	u32 ramp_step;
+	u32 cur_level;
+	u32 target_level;
 };
 
 int sprd_cabc_backlight_update(struct backlight_device *bd);
@@ -16,8 +16,14 @@
 
 #define USE_EXTERNAL_SOURCE 0
 
+/*
+ * The masks only depend on the panel width and the radius, they are
+ * drawn once and kept across dpu init, resume and height changes.
+ */
 static unsigned int *layer_top;
 static unsigned int *layer_bottom;
+static int layer_width;
+static int layer_radius;
 
 #if (USE_EXTERNAL_SOURCE)
 static unsigned char layer_top_header[] = {
@@ -53,16 +59,32 @@ static int sprd_corner_create(int width, int radius)
 		GFP_DMA | __GFP_ZERO, get_order(buf_size));
 	layer_bottom = (u32 *)__get_free_pages(GFP_KERNEL |
 		GFP_DMA | __GFP_ZERO, get_order(buf_size));
-	if (NULL == layer_top || NULL == layer_bottom)
+	if (NULL == layer_top || NULL == layer_bottom) {
+		layer_width = width;
+		layer_radius = radius;
+		sprd_corner_destroy();
 		return CORNER_ERR;
+	}
+
+	layer_width = width;
+	layer_radius = radius;
 
 	return CORNER_DONE;
 }
 
 void sprd_corner_destroy(void)
 {
-	kfree(layer_top);
-	kfree(layer_bottom);
+	int order = get_order(layer_width * layer_radius * 4);
+
+	if (layer_top)
+		free_pages((unsigned long)layer_top, order);
+	if (layer_bottom)
+		free_pages((unsigned long)layer_bottom, order);
+
+	layer_top = NULL;
+	layer_bottom = NULL;
+	layer_width = 0;
+	layer_radius = 0;
 }
 
 static unsigned int gdi_sqrt(unsigned int x)
@@ -170,6 +192,12 @@ int sprd_corner_hwlayer_init(int panel_height, int panel_width, int corner_radiu
 {
 	int ret;
 
+	if (layer_top && layer_width == panel_width &&
+	    layer_radius == corner_radius)
+		goto place;
+
+	sprd_corner_destroy();
+
 	ret = sprd_corner_create(panel_width, corner_radius);
 	if (ret < 0)
 		return CORNER_ERR;
@@ -182,6 +210,7 @@ int sprd_corner_hwlayer_init(int panel_height, int panel_width, int corner_radiu
 	sprd_corner_x_mirrored(layer_top, layer_bottom, panel_width, corner_radius);
 #endif
 
+place:
 	corner_layer_top.dst_x = 0;
 	corner_layer_top.dst_y = 0;
 	corner_layer_top.dst_w = panel_width;
@@ -21,11 +21,13 @@
 #include <linux/of_address.h>
 #include <linux/of_irq.h>
 #include <linux/pm_runtime.h>
+#include <linux/sprd_dfs_drv.h>
 #include <linux/sprd_iommu.h>
 
 #include "sprd_drm.h"
 #include "sprd_dpu.h"
 #include "sprd_gem.h"
+#include "sprd_dvfs_dpu.h"
 #include "sysfs/sysfs_display.h"
 
 struct sprd_plane {
@@ -38,6 +40,8 @@ struct sprd_plane {
 	struct drm_property *y2r_coef_property;
 	struct drm_property *pallete_en_property;
 	struct drm_property *pallete_color_property;
+	const u32 *fbc_fmts;
+	u32 fbc_fmts_cnt;
 	u32 index;
 };
 
@@ -53,6 +57,11 @@ struct sprd_plane_state {
 	u32 pallete_color;
 };
 
+struct sprd_crtc_state {
+	struct drm_crtc_state base;
+	struct sprd_dpu_load load;
+};
+
 LIST_HEAD(dpu_core_head);
 LIST_HEAD(dpu_clk_head);
 LIST_HEAD(dpu_glb_head);
@@ -61,6 +70,16 @@ bool calibration_mode;
 static unsigned long frame_count;
 module_param(frame_count, ulong, 0444);
 
+/* how long lighter frames have to stay before the votes come down */
+static unsigned int load_relax_ms = 200;
+module_param(load_relax_ms, uint, 0644);
+
+/* DDR bandwidth the dpu can use per MHz of DDR clock */
+static unsigned int ddr_mbps_per_mhz = 4;
+module_param(ddr_mbps_per_mhz, uint, 0644);
+
+#define DPU_DDR_SCENE	"dpu"
+
 static int sprd_dpu_init(struct sprd_dpu *dpu);
 static int sprd_dpu_uninit(struct sprd_dpu *dpu);
 
@@ -85,6 +104,12 @@ sprd_plane_state *to_sprd_plane_state(const struct drm_plane_state *state)
 	return container_of(state, struct sprd_plane_state, state);
 }
 
+static inline struct
+sprd_crtc_state *to_sprd_crtc_state(const struct drm_crtc_state *state)
+{
+	return container_of(state, struct sprd_crtc_state, base);
+}
+
 static int sprd_dpu_iommu_map(struct device *dev,
 				struct sprd_gem_obj *sprd_gem)
 {
@@ -216,11 +241,61 @@ static void sprd_plane_cleanup_fb(struct drm_plane *plane,
 	}
 }
 
+static bool sprd_plane_format_mod_supported(struct drm_plane *plane,
+					    u32 format, u64 modifier)
+{
+	struct sprd_plane *p = to_sprd_plane(plane);
+	int i;
+
+	if (modifier == DRM_FORMAT_MOD_LINEAR)
+		return true;
+
+	if (modifier != DRM_FORMAT_MOD_SPRD_XFBC)
+		return false;
+
+	for (i = 0; i < p->fbc_fmts_cnt; i++)
+		if (p->fbc_fmts[i] == format)
+			return true;
+
+	return false;
+}
+
 static int sprd_plane_atomic_check(struct drm_plane *plane,
 				  struct drm_plane_state *state)
 {
+	struct drm_framebuffer *fb = state->fb;
+	struct sprd_plane *p = to_sprd_plane(plane);
+	struct sprd_plane_state *s = to_sprd_plane_state(state);
+	struct drm_gem_object *obj;
+	u64 size;
+
 	DRM_DEBUG("%s()\n", __func__);
 
+	/*
+	 * Cores without XFBC formats keep taking any modifier as a
+	 * compression flag, like they always did.
+	 */
+	if (!fb || !p->fbc_fmts_cnt || fb->modifier == DRM_FORMAT_MOD_LINEAR)
+		return 0;
+
+	if (!sprd_plane_format_mod_supported(plane, fb->format->format,
+					     fb->modifier)) {
+		DRM_DEBUG_KMS("plane %u can't scan out %4.4s with modifier 0x%llx\n",
+			      p->index, (char *)&fb->format->format,
+			      fb->modifier);
+		return -EINVAL;
+	}
+
+	/* the header sits in front of the payload, both in plane 0 */
+	obj = drm_gem_fb_get_obj(fb, 0);
+	size = (u64)fb->offsets[0] + s->fbc_hsize_r +
+	       (u64)fb->pitches[0] * fb->height;
+	if (!obj || obj->size < size) {
+		DRM_DEBUG_KMS("plane %u xfbc buffer %zu bytes, need %llu\n",
+			      p->index, obj ? obj->size : 0, size);
+		return -EINVAL;
+	}
+
 	return 0;
 }
 
@@ -272,7 +347,7 @@ static void sprd_plane_atomic_update(struct drm_plane *plane,
 	layer->format = fb->format->format;
 	layer->alpha = s->alpha;
 	layer->blending = s->blend_mode;
-	layer->xfbc = fb->modifier;
+	layer->xfbc = fb->modifier != DRM_FORMAT_MOD_LINEAR;
 	layer->header_size_r = s->fbc_hsize_r;
 	layer->header_size_y = s->fbc_hsize_y;
 	layer->header_size_uv = s->fbc_hsize_uv;
@@ -548,6 +623,13 @@ static const struct drm_plane_funcs sprd_plane_funcs = {
 	.atomic_destroy_state = sprd_plane_atomic_destroy_state,
 	.atomic_set_property = sprd_plane_atomic_set_property,
 	.atomic_get_property = sprd_plane_atomic_get_property,
+	.format_mod_supported = sprd_plane_format_mod_supported,
+};
+
+static const u64 sprd_plane_modifiers[] = {
+	DRM_FORMAT_MOD_LINEAR,
+	DRM_FORMAT_MOD_SPRD_XFBC,
+	DRM_FORMAT_MOD_INVALID,
 };
 
 static struct drm_plane *sprd_plane_init(struct drm_device *drm,
@@ -574,7 +656,9 @@ static struct drm_plane *sprd_plane_init(struct drm_device *drm,
 
 		err = drm_universal_plane_init(drm, &p->plane, 1,
 					       &sprd_plane_funcs, cap.fmts_ptr,
-					       cap.fmts_cnt, NULL,
+					       cap.fmts_cnt,
+					       cap.fbc_fmts_cnt ?
+					       sprd_plane_modifiers : NULL,
 					       DRM_PLANE_TYPE_PRIMARY, NULL);
 		if (err) {
 			DRM_ERROR("fail to init primary plane\n");
@@ -585,6 +669,8 @@ static struct drm_plane *sprd_plane_init(struct drm_device *drm,
 
 		sprd_plane_create_properties(p, i);
 
+		p->fbc_fmts = cap.fbc_fmts_ptr;
+		p->fbc_fmts_cnt = cap.fbc_fmts_cnt;
 		p->index = i;
 		if (i == 0)
 			primary = &p->plane;
@@ -619,6 +705,27 @@ static void sprd_crtc_mode_set_nofb(struct drm_crtc *crtc)
 	else
 		dpu->ctx.if_type = SPRD_DISPC_IF_DPI;
 
+	/*
+	 * A seamless refresh rate switch keeps the crtc running, only the
+	 * front porch is reloaded and the resolution stays the same.
+	 */
+	if (crtc->state->mode_changed && !crtc->state->active_changed &&
+	    dpu->ctx.if_type == SPRD_DISPC_IF_DPI &&
+	    dpu->core && dpu->core->vfp_update) {
+		struct videomode vm;
+
+		drm_display_mode_to_videomode(mode, &vm);
+		if (sprd_vm_vfp_only(&dpu->ctx.vm, &vm)) {
+			DRM_INFO("vfp %u -> %u\n", dpu->ctx.vm.vfront_porch,
+				 vm.vfront_porch);
+			down(&dpu->ctx.refresh_lock);
+			dpu->ctx.vm = vm;
+			dpu->core->vfp_update(&dpu->ctx);
+			up(&dpu->ctx.refresh_lock);
+			return;
+		}
+	}
+
 	if (dpu->core && dpu->core->modeset) {
 		if (crtc->state->mode_changed) {
 			struct drm_mode_modeinfo umode;
@@ -723,6 +830,11 @@ static void sprd_crtc_atomic_disable(struct drm_crtc *crtc,
 
 	pm_runtime_put(dpu->dev.parent);
 
+	mutex_lock(&dpu->load_lock);
+	memset(&dpu->load_frame, 0, sizeof(dpu->load_frame));
+	mutex_unlock(&dpu->load_lock);
+	mod_delayed_work(system_wq, &dpu->relax_work, 0);
+
 	spin_lock_irq(&drm->event_lock);
 	if (crtc->state->event) {
 		drm_crtc_send_vblank_event(crtc, crtc->state->event);
@@ -731,11 +843,125 @@ static void sprd_crtc_atomic_disable(struct drm_crtc *crtc,
 	spin_unlock_irq(&drm->event_lock);
 }
 
+static void sprd_crtc_load(struct drm_crtc_state *state,
+			   struct sprd_dpu_load *load)
+{
+	const struct drm_plane_state *pstate;
+	struct drm_plane *plane;
+	u64 bytes = 0, pixels = 0;
+	int fps = drm_mode_vrefresh(&state->adjusted_mode);
+
+	memset(load, 0, sizeof(*load));
+
+	if (!state->active || fps <= 0)
+		return;
+
+	drm_atomic_crtc_state_for_each_plane_state(plane, pstate, state) {
+		const struct drm_framebuffer *fb = pstate->fb;
+		u32 w = pstate->src_w >> 16;
+		u32 h = pstate->src_h >> 16;
+		int i;
+
+		/* pallete layers fetch nothing */
+		if (!fb || to_sprd_plane_state(pstate)->pallete_en)
+			continue;
+
+		pixels += (u64)w * h;
+		bytes += (u64)w * h * fb->format->cpp[0];
+		for (i = 1; i < fb->format->num_planes; i++)
+			bytes += (u64)(w / fb->format->hsub) *
+				 (h / fb->format->vsub) * fb->format->cpp[i];
+	}
+
+	load->mbps = div_u64(bytes * fps, 1000000);
+	load->mpps = div_u64(pixels * fps, 1000000);
+}
+
+static bool sprd_dpu_load_above(const struct sprd_dpu_load *a,
+				const struct sprd_dpu_load *b)
+{
+	return a->mbps > b->mbps || a->mpps > b->mpps;
+}
+
+static void sprd_dpu_load_vote(struct sprd_dpu *dpu,
+			       const struct sprd_dpu_load *load)
+{
+#ifdef CONFIG_SPRD_APSYS_DVFS_DEVFREQ
+	static const u32 freqs[] = {
+		DPU_CLK153M6, DPU_CLK192M, DPU_CLK256M,
+		DPU_CLK307M2, DPU_CLK384M, DPU_CLK468M,
+	};
+	u32 freq;
+	int i;
+
+	/* the dpu composes about one pixel per clock */
+	if (load->mpps != dpu->load_vote.mpps) {
+		for (i = 0; i < ARRAY_SIZE(freqs) - 1; i++)
+			if (freqs[i] >= (u64)load->mpps * 1000000)
+				break;
+		freq = freqs[i];
+		dpu_dvfs_notifier_call_chain(&freq);
+	}
+#endif
+
+#ifdef CONFIG_DEVFREQ_SPRD_AUTO_DFS
+	/* ddr_scene: 0 not requested yet, < 0 no such scene in the dt */
+	if (load->mbps != dpu->load_vote.mbps && dpu->ddr_scene >= 0) {
+		if (!dpu->ddr_scene) {
+			int ret = scene_dfs_request(DPU_DDR_SCENE);
+
+			if (!ret)
+				dpu->ddr_scene = 1;
+			else if (ret == -EINVAL)
+				dpu->ddr_scene = -1;
+		}
+
+		if (dpu->ddr_scene > 0)
+			change_scene_freq(DPU_DDR_SCENE,
+				DIV_ROUND_UP(load->mbps, ddr_mbps_per_mhz));
+	}
+#endif
+
+	DRM_DEBUG("%s() %u MB/s, %u Mpixel/s\n", __func__,
+		  load->mbps, load->mpps);
+
+	dpu->load_vote = *load;
+}
+
+static void sprd_dpu_boost_work(struct work_struct *work)
+{
+	struct sprd_dpu *dpu = container_of(work, struct sprd_dpu, boost_work);
+	struct sprd_dpu_load load;
+
+	mutex_lock(&dpu->load_lock);
+	load.mbps = max(dpu->load_vote.mbps, dpu->load_boost.mbps);
+	load.mpps = max(dpu->load_vote.mpps, dpu->load_boost.mpps);
+	memset(&dpu->load_boost, 0, sizeof(dpu->load_boost));
+	sprd_dpu_load_vote(dpu, &load);
+	mutex_unlock(&dpu->load_lock);
+}
+
+static void sprd_dpu_relax_work(struct work_struct *work)
+{
+	struct sprd_dpu *dpu = container_of(to_delayed_work(work),
+					    struct sprd_dpu, relax_work);
+	struct sprd_dpu_load load;
+
+	/* a commit on its way keeps what it asked for */
+	mutex_lock(&dpu->load_lock);
+	load.mbps = max(dpu->load_frame.mbps, dpu->load_boost.mbps);
+	load.mpps = max(dpu->load_frame.mpps, dpu->load_boost.mpps);
+	sprd_dpu_load_vote(dpu, &load);
+	mutex_unlock(&dpu->load_lock);
+}
+
 static int sprd_crtc_atomic_check(struct drm_crtc *crtc,
 				 struct drm_crtc_state *state)
 {
 	DRM_DEBUG("%s()\n", __func__);
 
+	sprd_crtc_load(state, &to_sprd_crtc_state(state)->load);
+
 	return 0;
 }
 
@@ -746,6 +972,9 @@ static void sprd_crtc_atomic_begin(struct drm_crtc *crtc,
 
 	DRM_DEBUG("%s()\n", __func__);
 
+	/* the frequencies have to be up before the frame is flipped */
+	flush_work(&dpu->boost_work);
+
 	down(&dpu->ctx.refresh_lock);
 
 	memset(dpu->layers, 0, sizeof(*dpu->layers) * dpu->pending_planes);
@@ -770,6 +999,13 @@ static void sprd_crtc_atomic_flush(struct drm_crtc *crtc,
 
 	up(&dpu->ctx.refresh_lock);
 
+	mutex_lock(&dpu->load_lock);
+	dpu->load_frame = to_sprd_crtc_state(crtc->state)->load;
+	if (sprd_dpu_load_above(&dpu->load_vote, &dpu->load_frame))
+		queue_delayed_work(system_wq, &dpu->relax_work,
+				   msecs_to_jiffies(load_relax_ms));
+	mutex_unlock(&dpu->load_lock);
+
 	spin_lock_irq(&drm->event_lock);
 	if (crtc->state->event) {
 		drm_crtc_send_vblank_event(crtc, crtc->state->event);
@@ -850,17 +1086,92 @@ static const struct drm_crtc_helper_funcs sprd_crtc_helper_funcs = {
 	.atomic_disable	= sprd_crtc_atomic_disable,
 };
 
+static void sprd_crtc_reset(struct drm_crtc *crtc)
+{
+	struct sprd_crtc_state *s;
+
+	if (crtc->state) {
+		__drm_atomic_helper_crtc_destroy_state(crtc->state);
+		kfree(to_sprd_crtc_state(crtc->state));
+		crtc->state = NULL;
+	}
+
+	s = kzalloc(sizeof(*s), GFP_KERNEL);
+	if (!s)
+		return;
+
+	crtc->state = &s->base;
+	crtc->state->crtc = crtc;
+}
+
+static struct drm_crtc_state *
+sprd_crtc_atomic_duplicate_state(struct drm_crtc *crtc)
+{
+	struct sprd_crtc_state *s;
+
+	if (WARN_ON(!crtc->state))
+		return NULL;
+
+	s = kzalloc(sizeof(*s), GFP_KERNEL);
+	if (!s)
+		return NULL;
+
+	__drm_atomic_helper_crtc_duplicate_state(crtc, &s->base);
+
+	s->load = to_sprd_crtc_state(crtc->state)->load;
+
+	return &s->base;
+}
+
+static void sprd_crtc_atomic_destroy_state(struct drm_crtc *crtc,
+					   struct drm_crtc_state *state)
+{
+	__drm_atomic_helper_crtc_destroy_state(state);
+	kfree(to_sprd_crtc_state(state));
+}
+
 static const struct drm_crtc_funcs sprd_crtc_funcs = {
 	.destroy	= drm_crtc_cleanup,
 	.set_config	= drm_atomic_helper_set_config,
 	.page_flip	= drm_atomic_helper_page_flip,
-	.reset		= drm_atomic_helper_crtc_reset,
-	.atomic_duplicate_state	= drm_atomic_helper_crtc_duplicate_state,
-	.atomic_destroy_state	= drm_atomic_helper_crtc_destroy_state,
+	.reset		= sprd_crtc_reset,
+	.atomic_duplicate_state	= sprd_crtc_atomic_duplicate_state,
+	.atomic_destroy_state	= sprd_crtc_atomic_destroy_state,
 	.enable_vblank	= sprd_crtc_enable_vblank,
 	.disable_vblank	= sprd_crtc_disable_vblank,
 };
 
+/*
+ * Called by the commit before it waits for the fences of its
+ * framebuffers, so the votes go up while the frame is still rendered.
+ */
+void sprd_dpu_load_prepare(struct drm_atomic_state *state)
+{
+	struct drm_crtc_state *crtc_state;
+	struct drm_crtc *crtc;
+	struct sprd_dpu *dpu;
+	const struct sprd_dpu_load *load;
+	int i;
+
+	for_each_new_crtc_in_state(state, crtc, crtc_state, i) {
+		if (crtc->funcs != &sprd_crtc_funcs)
+			continue;
+
+		dpu = crtc_to_dpu(crtc);
+		load = &to_sprd_crtc_state(crtc_state)->load;
+
+		mutex_lock(&dpu->load_lock);
+		if (sprd_dpu_load_above(load, &dpu->load_vote)) {
+			dpu->load_boost.mbps = max(dpu->load_boost.mbps,
+						   load->mbps);
+			dpu->load_boost.mpps = max(dpu->load_boost.mpps,
+						   load->mpps);
+			queue_work(system_highpri_wq, &dpu->boost_work);
+		}
+		mutex_unlock(&dpu->load_lock);
+	}
+}
+
 static int sprd_crtc_init(struct drm_device *drm, struct drm_crtc *crtc,
 			 struct drm_plane *primary)
 {
@@ -1100,6 +1411,9 @@ static void sprd_dpu_unbind(struct device *dev, struct device *master,
 
 	DRM_INFO("%s()\n", __func__);
 
+	cancel_work_sync(&dpu->boost_work);
+	cancel_delayed_work_sync(&dpu->relax_work);
+
 	drm_crtc_cleanup(&dpu->crtc);
 }
 
@@ -1163,6 +1477,10 @@ static int sprd_dpu_context_init(struct sprd_dpu *dpu,
 
 	sema_init(&ctx->refresh_lock, 1);
 
+	mutex_init(&dpu->load_lock);
+	INIT_WORK(&dpu->boost_work, sprd_dpu_boost_work);
+	INIT_DELAYED_WORK(&dpu->relax_work, sprd_dpu_relax_work);
+
 	return 0;
 }
 
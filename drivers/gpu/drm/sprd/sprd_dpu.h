@@ -121,10 +121,21 @@ struct sprd_dpu_layer {
 	u32 pallete_color;
 };
 
+/*
+ * Modifier of an XFBC compressed framebuffer: a header of fbc_hsize_r
+ * bytes followed by the payload. It keeps the value the display HAL has
+ * always put into the modifier, any other non linear modifier is
+ * rejected on the cores that advertise XFBC formats.
+ */
+#define DRM_FORMAT_MOD_SPRD_XFBC	fourcc_mod_code(NONE, 1)
+
 struct dpu_capability {
 	u32 max_layers;
 	const u32 *fmts_ptr;
 	u32 fmts_cnt;
+	/* formats the layers can scan out compressed, optional */
+	const u32 *fbc_fmts_ptr;
+	u32 fbc_fmts_cnt;
 };
 
 struct dpu_context;
@@ -152,6 +163,7 @@ struct dpu_core_ops {
 	int (*modeset)(struct dpu_context *ctx,
 			struct drm_mode_modeinfo *mode);
 	bool (*check_raw_int)(struct dpu_context *ctx, u32 mask);
+	void (*vfp_update)(struct dpu_context *ctx);
 };
 
 struct dpu_clk_ops {
@@ -200,6 +212,12 @@ struct dpu_context {
 	struct work_struct cabc_bl_update;
 };
 
+/* memory and pixel throughput a frame needs to be scanned out in time */
+struct sprd_dpu_load {
+	u32 mbps;
+	u32 mpps;
+};
+
 struct sprd_dpu {
 	struct device dev;
 	struct drm_crtc crtc;
@@ -210,6 +228,19 @@ struct sprd_dpu {
 	struct drm_display_mode *mode;
 	struct sprd_dpu_layer *layers;
 	u8 pending_planes;
+
+	/*
+	 * DPU and DDR frequency votes. A commit raises them before its
+	 * frame is flipped, they come down once lighter frames have been
+	 * on screen for a while.
+	 */
+	struct mutex load_lock;
+	struct work_struct boost_work;
+	struct delayed_work relax_work;
+	struct sprd_dpu_load load_boost;
+	struct sprd_dpu_load load_frame;
+	struct sprd_dpu_load load_vote;
+	int ddr_scene;
 };
 
 extern struct list_head dpu_core_head;
@@ -222,6 +253,24 @@ static inline struct sprd_dpu *crtc_to_dpu(struct drm_crtc *crtc)
 	return crtc ? container_of(crtc, struct sprd_dpu, crtc) : NULL;
 }
 
+/*
+ * The refresh rate can be switched on the fly when the new timing only
+ * stretches or shrinks the vertical front porch of the current one.
+ */
+static inline bool sprd_vm_vfp_only(const struct videomode *cur,
+				    const struct videomode *vm)
+{
+	return vm->pixelclock == cur->pixelclock &&
+	       vm->hactive == cur->hactive &&
+	       vm->hfront_porch == cur->hfront_porch &&
+	       vm->hback_porch == cur->hback_porch &&
+	       vm->hsync_len == cur->hsync_len &&
+	       vm->vactive == cur->vactive &&
+	       vm->vback_porch == cur->vback_porch &&
+	       vm->vsync_len == cur->vsync_len &&
+	       vm->vfront_porch != cur->vfront_porch;
+}
+
 #define dpu_core_ops_register(entry) \
 	disp_ops_register(entry, &dpu_core_head)
 #define dpu_clk_ops_register(entry) \
@@ -238,5 +287,6 @@ static inline struct sprd_dpu *crtc_to_dpu(struct drm_crtc *crtc)
 
 int sprd_dpu_run(struct sprd_dpu *dpu);
 int sprd_dpu_stop(struct sprd_dpu *dpu);
+void sprd_dpu_load_prepare(struct drm_atomic_state *state);
 
 #endif
@@ -24,6 +24,7 @@
 #include <linux/of_graph.h>
 #include <linux/of_platform.h>
 
+#include "sprd_dpu.h"
 #include "sprd_drm.h"
 #include "sprd_drm_gsp.h"
 #include "sprd_gem.h"
@@ -296,6 +297,8 @@ int sprd_atomic_commit(struct drm_device *dev,
 	if (ret)
 		return ret;
 
+	sprd_dpu_load_prepare(state);
+
 	if (!nonblock) {
 		ret = sprd_atomic_wait_for_fences(dev, state, true);
 		if (ret)
@@ -194,8 +194,18 @@ static void sprd_dsi_encoder_mode_set(struct drm_encoder *encoder,
 				 struct drm_display_mode *adj_mode)
 {
 	struct sprd_dsi *dsi = encoder_to_dsi(encoder);
+	struct videomode vm;
 
 	DRM_INFO("%s() set mode: %s\n", __func__, dsi->mode->name);
+
+	/* the dpu goes along with the same front porch, see the crtc */
+	mutex_lock(&dsi_lock);
+	drm_display_mode_to_videomode(adj_mode, &vm);
+	if (dsi->ctx.is_inited && sprd_vm_vfp_only(&dsi->ctx.vm, &vm)) {
+		dsi->ctx.vm.vfront_porch = vm.vfront_porch;
+		sprd_dsi_set_vfp(dsi, vm.vfront_porch);
+	}
+	mutex_unlock(&dsi_lock);
 }
 
 static int sprd_dsi_encoder_atomic_check(struct drm_encoder *encoder,
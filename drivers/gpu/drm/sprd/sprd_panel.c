@@ -14,6 +14,8 @@
 #include <drm/drm_atomic_helper.h>
 #include <linux/component.h>
 #include <linux/backlight.h>
+#include <linux/interrupt.h>
+#include <linux/irq.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/of_gpio.h>
@@ -147,17 +149,24 @@ static int fpga_sysfs_init(void)
     }
     return sysfs_create_group(fpga_ctrl_kobj, &fpga_attr_group);
 }
+/*
+ * The DSI host only queues the commands, the ones between two waits go
+ * out back to back. The host fifos are drained before every wait so the
+ * wait still counts from the command that was sent.
+ */
 static int sprd_panel_send_cmds(struct mipi_dsi_device *dsi,
 				const void *data, int size)
 {
 	struct sprd_panel *panel;
 	const struct dsi_cmd_desc *cmds = data;
+	struct sprd_dsi *host;
 	u16 len;
 
 	if ((cmds == NULL) || (dsi == NULL))
 		return -EINVAL;
 
 	panel = mipi_dsi_get_drvdata(dsi);
+	host = container_of(dsi->host, struct sprd_dsi, host);
 
 	while (size > 0) {
 		len = (cmds->wc_h << 8) | cmds->wc_l;
@@ -167,13 +176,15 @@ static int sprd_panel_send_cmds(struct mipi_dsi_device *dsi,
 		else
 			mipi_dsi_generic_write(dsi, cmds->payload, len);
 
-		if (cmds->wait)
+		if (cmds->wait) {
+			sprd_dsi_wr_flush(host);
 			msleep(cmds->wait);
+		}
 		cmds = (const struct dsi_cmd_desc *)(cmds->payload + len);
 		size -= (len + 4);
 	}
 
-	return 0;
+	return sprd_dsi_wr_flush(host);
 }
 
 static int sprd_panel_unprepare(struct drm_panel *p)
@@ -185,6 +196,19 @@ static int sprd_panel_unprepare(struct drm_panel *p)
     DRM_INFO("%s()\n", __func__);
 
     panel_notifier_event(1,0);
+
+	/*
+	 * The panel was sent sleep-in by disable already, a panel that
+	 * keeps its registers there stays powered and skips both the
+	 * power sequence here and the one of prepare.
+	 */
+	if (panel->info.fast_resume && !panel->need_reset) {
+		panel->is_retained = true;
+		return 0;
+	}
+	panel->is_retained = false;
+	panel->need_reset = false;
+
 #ifdef CONFIG_GOWIN_FPGA
     gpiod_direction_output(panel->info.reset_gpio, 0);
     mdelay(2);
@@ -262,6 +286,9 @@ static int sprd_panel_prepare(struct drm_panel *p)
 	DRM_INFO("%s()\n", __func__);
 
     panel_notifier_event(2,0);
+	if (panel->is_retained)
+		return 0;
+
     ret = regulator_enable(panel->supply);
     if (ret < 0)
         DRM_ERROR("enable lcd regulator failed\n");
@@ -328,6 +355,45 @@ static int sprd_panel_prepare(struct drm_panel *p)
 	return 0;
 }
 
+/*
+ * In gpio mode the esd irq stands in for the periodic work. The handler
+ * masks it until the work has looked at the gpio, which unmasks it again
+ * unless it recovers the panel, enable() unmasks it then.
+ */
+static void sprd_panel_esd_start(struct sprd_panel *panel, u32 delay_ms)
+{
+	if (panel->info.esd_check_mode == ESD_MODE_GPIO_CHECK) {
+		if (panel->esd_irq <= 0)
+			return;
+		enable_irq(panel->esd_irq);
+		/* an edge before the unmask is lost, look at the level */
+		if (gpiod_get_value_cansleep(panel->info.esd_gpio)) {
+			disable_irq(panel->esd_irq);
+			schedule_delayed_work(&panel->esd_work, 0);
+		}
+	} else {
+		schedule_delayed_work(&panel->esd_work,
+				      msecs_to_jiffies(delay_ms));
+	}
+	panel->esd_work_pending = true;
+}
+
+static void sprd_panel_esd_stop(struct sprd_panel *panel)
+{
+	if (!panel->esd_work_pending)
+		return;
+
+	if (panel->info.esd_check_mode == ESD_MODE_GPIO_CHECK) {
+		disable_irq(panel->esd_irq);
+		/* the handler masked it for the work we cancel */
+		if (cancel_delayed_work_sync(&panel->esd_work))
+			enable_irq(panel->esd_irq);
+	} else {
+		cancel_delayed_work_sync(&panel->esd_work);
+	}
+	panel->esd_work_pending = false;
+}
+
 static int sprd_panel_disable(struct drm_panel *p)
 {
 	struct sprd_panel *panel = to_sprd_panel(p);
@@ -351,10 +417,7 @@ static int sprd_panel_disable(struct drm_panel *p)
 	 * CMD mode yet. Since there is no VBLANK timing for
 	 * LP cmd transmission.
 	 */
-	if (panel->esd_work_pending) {
-		cancel_delayed_work_sync(&panel->esd_work);
-		panel->esd_work_pending = false;
-	}
+	sprd_panel_esd_stop(panel);
 
 	if (panel->backlight) {
 		panel->backlight->props.power = FB_BLANK_POWERDOWN;
@@ -398,6 +461,13 @@ static int sprd_panel_enable(struct drm_panel *p)
        panel->info.cmds[CMD_CODE_INIT],
        panel->info.cmds_len[CMD_CODE_INIT]);
     */
+	if (panel->is_retained) {
+		sprd_panel_send_cmds(panel->slave,
+				     panel->info.cmds[CMD_CODE_SLEEP_OUT],
+				     panel->info.cmds_len[CMD_CODE_SLEEP_OUT]);
+		panel->is_retained = false;
+	}
+
     for(i = 0; i < 5; i++)
     {
         if (panel->backlight) {
@@ -407,11 +477,8 @@ static int sprd_panel_enable(struct drm_panel *p)
         }
     }
 
-	if (panel->info.esd_check_en) {
-		schedule_delayed_work(&panel->esd_work,
-				      msecs_to_jiffies(1000));
-		panel->esd_work_pending = true;
-	}
+	if (panel->info.esd_check_en)
+		sprd_panel_esd_start(panel, 1000);
     flag = 1;
 	panel->is_enabled = true;
 	mutex_unlock(&panel_lock);
@@ -488,6 +555,19 @@ static int sprd_panel_esd_check(struct sprd_panel *panel)
 	struct panel_info *info = &panel->info;
 	u8 read_val = 0;
 
+	/*
+	 * The vblank irq comes at the start of the blanking, a one byte
+	 * read issued right then is done before the next frame goes out
+	 * instead of delaying it.
+	 */
+	if (info->esd_check_vblank && panel->base.connector &&
+	    panel->base.connector->encoder) {
+		struct drm_crtc *crtc = panel->base.connector->encoder->crtc;
+
+		if (crtc && crtc->state && crtc->state->active)
+			drm_crtc_wait_one_vblank(crtc);
+	}
+
 	/* FIXME: we should enable HS cmd tx here */
 	mipi_dsi_set_maximum_return_packet_size(panel->slave, 1);
 	mipi_dsi_dcs_read(panel->slave, info->esd_check_reg,
@@ -563,6 +643,26 @@ static int sprd_panel_te_check(struct sprd_panel *panel)
 	return ret < 0 ? ret : 0;
 }
 
+static int sprd_panel_gpio_check(struct sprd_panel *panel)
+{
+	if (gpiod_get_value_cansleep(panel->info.esd_gpio)) {
+		DRM_ERROR("esd gpio reports a panel error\n");
+		return -EIO;
+	}
+
+	return 0;
+}
+
+static irqreturn_t sprd_panel_esd_irq(int irq, void *data)
+{
+	struct sprd_panel *panel = data;
+
+	disable_irq_nosync(irq);
+	schedule_delayed_work(&panel->esd_work, 0);
+
+	return IRQ_HANDLED;
+}
+
 static void sprd_panel_esd_work_func(struct work_struct *work)
 {
 	struct sprd_panel *panel = container_of(work, struct sprd_panel,
@@ -574,6 +674,8 @@ static void sprd_panel_esd_work_func(struct work_struct *work)
 		ret = sprd_panel_esd_check(panel);
 	else if (info->esd_check_mode == ESD_MODE_TE_CHECK)
 		ret = sprd_panel_te_check(panel);
+	else if (info->esd_check_mode == ESD_MODE_GPIO_CHECK)
+		ret = sprd_panel_gpio_check(panel);
 	else {
 		DRM_ERROR("unknown esd check mode:%d\n", info->esd_check_mode);
 		return;
@@ -594,10 +696,14 @@ static void sprd_panel_esd_work_func(struct work_struct *work)
 		}
 
 		DRM_INFO("====== esd recovery start ========\n");
+		/* the panel state is lost, power it off for real */
+		panel->need_reset = true;
 		funcs->disable(encoder);
 		funcs->enable(encoder);
 		DRM_INFO("======= esd recovery end =========\n");
-	} else
+	} else if (info->esd_check_mode == ESD_MODE_GPIO_CHECK)
+		enable_irq(panel->esd_irq);
+	else
 		schedule_delayed_work(&panel->esd_work,
 			msecs_to_jiffies(info->esd_check_period));
 }
@@ -646,6 +752,30 @@ static int sprd_panel_gpio_request(struct device *dev,
 				 PTR_ERR(panel->info.fpgarst_gpio));
 #endif
 
+	if (panel->info.esd_check_en &&
+	    panel->info.esd_check_mode == ESD_MODE_GPIO_CHECK) {
+		unsigned long flags = IRQF_ONESHOT;
+		int ret;
+
+		panel->info.esd_gpio = devm_gpiod_get(dev, "esd", GPIOD_IN);
+		if (IS_ERR(panel->info.esd_gpio))
+			return PTR_ERR(panel->info.esd_gpio);
+
+		panel->esd_irq = gpiod_to_irq(panel->info.esd_gpio);
+		if (panel->esd_irq < 0)
+			return panel->esd_irq;
+
+		flags |= gpiod_is_active_low(panel->info.esd_gpio) ?
+			 IRQF_TRIGGER_FALLING : IRQF_TRIGGER_RISING;
+		/* unmasked by enable(), not before the panel is up */
+		irq_set_status_flags(panel->esd_irq, IRQ_NOAUTOEN);
+		ret = devm_request_threaded_irq(dev, panel->esd_irq, NULL,
+						sprd_panel_esd_irq, flags,
+						"panel-esd", panel);
+		if (ret)
+			return ret;
+	}
+
 #if 0
 	panel->info.lcdtp3v3_gpio = devm_gpiod_get_optional(dev,
 					"lcdtp3v3", GPIOD_ASIS);
@@ -740,7 +870,8 @@ static int of_parse_buildin_modes(struct panel_info *info,
 
 		info->buildin_modes[i].width_mm = info->mode.width_mm;
 		info->buildin_modes[i].height_mm = info->mode.height_mm;
-		info->buildin_modes[i].vrefresh = info->mode.vrefresh;
+		info->buildin_modes[i].vrefresh =
+			drm_mode_vrefresh(&info->buildin_modes[i]);
 	}
 	info->num_buildin_modes = num_timings;
 	DRM_INFO("info->num_buildin_modes = %d\n", num_timings);
@@ -1103,6 +1234,9 @@ int sprd_panel_parse_lcddtb(struct device_node *lcd_node,
 	else
 		info->esd_check_val = 0x9C;
 
+	info->esd_check_vblank = of_property_read_bool(lcd_node,
+						"sprd,esd-check-vblank");
+
 	if (of_property_read_bool(lcd_node, "sprd,use-dcs-write"))
 		info->use_dcs = true;
 	else
@@ -1140,6 +1274,13 @@ int sprd_panel_parse_lcddtb(struct device_node *lcd_node,
 	} else
 		DRM_ERROR("can't find sprd,sleep-out-command property\n");
 
+	/* the fast resume wakes the panel up by sleep-out only */
+	if (of_property_read_bool(lcd_node, "sprd,fast-resume") &&
+	    info->cmds[CMD_CODE_SLEEP_OUT])
+		info->fast_resume = true;
+	else
+		info->fast_resume = false;
+
 	rc = of_get_drm_display_mode(lcd_node, &info->mode, 0,
 				     OF_USE_NATIVE_MODE);
 	if (rc) {
@@ -1333,11 +1474,8 @@ static int sprd_panel_probe(struct mipi_dsi_device *slave)
 	 * callback function. But the dsi encoder will not call
 	 * drm_panel_enable() the first time in encoder_enable().
 	 */
-	if (panel->info.esd_check_en) {
-		schedule_delayed_work(&panel->esd_work,
-				      msecs_to_jiffies(2000));
-		panel->esd_work_pending = true;
-	}
+	if (panel->info.esd_check_en)
+		sprd_panel_esd_start(panel, 2000);
 
 	panel->is_enabled = true;
 
@@ -49,6 +49,8 @@ enum {
 enum {
 	ESD_MODE_REG_CHECK,
 	ESD_MODE_TE_CHECK,
+	/* the panel raises an error gpio, nothing is polled */
+	ESD_MODE_GPIO_CHECK,
 };
 
 struct dsi_cmd_desc {
@@ -96,6 +98,12 @@ struct panel_info {
 	u16 esd_check_period;
 	u32 esd_check_reg;
 	u32 esd_check_val;
+	/* do the register read right after a vblank, off the frame */
+	bool esd_check_vblank;
+	struct gpio_desc *esd_gpio;
+
+	/* keep the panel powered in sleep-in while the display is off */
+	bool fast_resume;
 
 	/* MIPI DSI specific parameters */
 	u32 format;
@@ -113,7 +121,12 @@ struct sprd_panel {
 	struct regulator *supply;
 	struct delayed_work esd_work;
 	bool esd_work_pending;
+	int esd_irq;
 	bool is_enabled;
+	/* powered and in sleep-in, enable only sends sleep-out */
+	bool is_retained;
+	/* the next power off must be a real one, e.g. for esd recovery */
+	bool need_reset;
 };
 
 struct sprd_oled {
@@ -94,6 +94,9 @@
 /* Absolutely safe for wait pending update at 3.4MHz */
 #define I2C_3M4_WRITE_WAIT	200	/* us */
 
+/* A 3 byte write takes about 30 bus clocks, 300us at 100kHz */
+#define I2C_WRITE_POLL		20	/* us */
+
 /* i2c default source clock */
 #define I2C_SOURCE_CLK_26M	26000000
 
@@ -183,11 +186,13 @@ static int sprd_i2c_hw_writebyte(struct sprd_i2c_hw *i2c_dev, u8 *buf, u32 len)
 		return 0;
 	}
 
-	/* waitting for write finish */
-	usleep_range(i2c_dev->write_wait_time, i2c_dev->write_wait_time + 50);
-
-	tmp = readl(i2c_dev->base + ARM_DEBUG1);
-	if (!(tmp & CHNL_PENDING))
+	/*
+	 * The pending bit drops as soon as the slave acked the data, the
+	 * write wait time only bounds a write that does not finish.
+	 */
+	if (!readl_poll_timeout(i2c_dev->base + ARM_DEBUG1, tmp,
+				!(tmp & CHNL_PENDING), I2C_WRITE_POLL,
+				i2c_dev->write_wait_time))
 		return 0;
 
 	status = readl(i2c_dev->base + I2C_STATUS);
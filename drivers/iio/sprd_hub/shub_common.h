@@ -29,6 +29,8 @@
 
 #define READ_BUFF_SIZE				128
 #define SERIAL_READ_BUFFER_MAX	128
+/* one sbuf read takes what the hub has batched, up to this many bytes */
+#define SHUB_RX_BATCH_MAX	2048
 #define SERIAL_WRITE_BUFFER_MAX	1024
 
 /* MUST equal to the iio total channel bytes size */
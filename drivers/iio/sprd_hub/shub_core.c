@@ -247,7 +247,7 @@ static int shub_sipc_channel_read(struct shub_data *sensor)
 		nread =
 			sbuf_read(SIPC_ID_PM_SYS, SMSG_CH_PIPE, SIPC_PM_BUFID0,
 				  (void *)sensor->readbuff,
-				  SERIAL_READ_BUFFER_MAX - 1, -1);
+				  sizeof(sensor->readbuff), -1);
 		if (nread < 0) {
 			retry++;
 			msleep(500);
@@ -269,9 +269,9 @@ static int shub_sipc_channel_read(struct shub_data *sensor)
 			memset(sipc_rx_data, 0, sizeof(sipc_rx_data));
 		}
 #endif
+		/* the parser only looks at the nread bytes, no need to clear */
 		shub_parse_one_packet(&shub_stream_processor,
 				      sensor->readbuff, nread);
-		memset(sensor->readbuff, 0, sizeof(sensor->readbuff));
 	} else {
 		dev_info(&sensor->sensor_pdev->dev, "can not get data\n");
 	}
@@ -287,7 +287,7 @@ static int shub_sipc_channel_rdnwu(struct shub_data *sensor)
 		nread =
 			sbuf_read(SIPC_ID_PM_SYS, SMSG_CH_PIPE, SIPC_PM_BUFID1,
 				  (void *)sensor->readbuff_nwu,
-				  SERIAL_READ_BUFFER_MAX - 1, -1);
+				  sizeof(sensor->readbuff_nwu), -1);
 		if (nread < 0) {
 			retry++;
 			msleep(500);
@@ -301,7 +301,6 @@ static int shub_sipc_channel_rdnwu(struct shub_data *sensor)
 	if (nread > 0) {
 		shub_parse_one_packet(&shub_stream_processor_nwu,
 				      sensor->readbuff_nwu, nread);
-		memset(sensor->readbuff_nwu, 0, sizeof(sensor->readbuff));
 	} else {
 		dev_info(&sensor->sensor_pdev->dev, "can not get data\n");
 	}
@@ -746,9 +745,10 @@ static int shub_send_event_to_iio(struct shub_data *sensor,
 	u8 event[MAX_CM4_MSG_SIZE];
 	u8 i = 0;
 
+	len = min_t(u16, len, MAX_CM4_MSG_SIZE);
 	mutex_lock(&sensor->mutex_send);
-	memset(event, 0x00, MAX_CM4_MSG_SIZE);
 	memcpy(event, data, len);
+	memset(event + len, 0x00, MAX_CM4_MSG_SIZE - len);
 
 	if (sensor->log_control.udata[5] == 1) {
 		for (i = 0; i < len; i++)
@@ -2520,6 +2520,7 @@ static struct platform_driver shub_driver = {
 		   .name = SHUB_NAME,
 		   .owner = THIS_MODULE,
 		   .of_match_table = shub_match_table,
+		   .probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 };
 
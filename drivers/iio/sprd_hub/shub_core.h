@@ -192,8 +192,8 @@ struct shub_data {
 	u8 *regs_value_buf;
 	u8 regs_num;
 	struct file *filep;/* R/W interface */
-	unsigned char readbuff[SERIAL_READ_BUFFER_MAX];
-	unsigned char readbuff_nwu[SERIAL_READ_BUFFER_MAX];
+	unsigned char readbuff[SHUB_RX_BATCH_MAX];
+	unsigned char readbuff_nwu[SHUB_RX_BATCH_MAX];
 	unsigned char writebuff[SERIAL_WRITE_BUFFER_MAX];
 	void (*save_mag_offset)(struct shub_data *sensor, u8 *buff, u32 len);
 	void (*data_callback)(struct shub_data *sensor, u8 *buff, u32 len);
@@ -53,6 +53,8 @@
 #define SPRD_KPD_RTC_HZ			32768
 #define SPRD_DEF_LONG_KEY_MS		1000
 #define SPRD_DEF_DIV_CNT		1
+#define SPRD_DEF_SLEEP_DIV_CNT		7
+#define SPRD_KPD_WAKEUP_KEYS_MAX	(SPRD_KPD_ROWS_MAX * SPRD_KPD_COLS_MAX)
 #define SPRD_KPD_INT_CNT		4
 #define SPRD_KPD_ROWS_MAX		8
 #define SPRD_KPD_COLS_MAX		8
@@ -66,6 +68,9 @@
 struct sprd_keypad_data {
 	u32 rows_en; /* enabled rows bits */
 	u32 cols_en; /* enabled cols bits */
+	u32 wake_rows_en; /* rows scanned while suspended */
+	u32 wake_cols_en; /* cols scanned while suspended */
+	u32 sleep_div; /* clock divider while suspended */
 	u32 num_rows;
 	u32 num_cols;
 	u32 capabilities;
@@ -142,7 +147,8 @@ static irqreturn_t sprd_keypad_handler(int irq, void *id)
 	return IRQ_HANDLED;
 }
 
-static u32 sprd_keypad_time_to_counter(u32 array_size, u32 time_ms)
+static u32 sprd_keypad_time_to_counter(u32 array_size, u32 div,
+				       u32 time_ms)
 {
 	u32 value;
 
@@ -155,14 +161,28 @@ static u32 sprd_keypad_time_to_counter(u32 array_size, u32 time_ms)
 	 * clk_div_num is devider to keypad source clock
 	 **/
 	value = SPRD_KPD_RTC_HZ * time_ms;
-	value = value / (1000 * array_size *
-			(SPRD_DEF_DIV_CNT + 1));
+	value = value / (1000 * array_size * (div + 1));
 	if (value >= 1)
 		value -= 1;
 
 	return value;
 }
 
+static u32 sprd_keypad_ctrl_value(struct sprd_keypad_data *data,
+				  u32 rows_en, u32 cols_en)
+{
+	u32 value;
+
+	value = (((rows_en << SPRD_KPD_ROWS_SHIFT)
+		| (cols_en << SPRD_KPD_COLS_SHIFT))
+		& (SPRD_KPD_ROWS_MSK | SPRD_KPD_COLS_MSK))
+		| SPRD_KPD_EN | SPRD_KPD_SLEEP_EN;
+	if (data->capabilities & SPRD_CAP_LONG_KEY)
+		value |= SPRD_KPD_LONG_KEY_EN;
+
+	return value;
+}
+
 static int sprd_keypad_hw_init(struct sprd_keypad_data *data)
 {
 	u32 value;
@@ -173,11 +193,13 @@ static int sprd_keypad_hw_init(struct sprd_keypad_data *data)
 	writel_relaxed(SPRD_DEF_DIV_CNT, data->base + SPRD_KPD_CLK_DIV_CNT);
 
 	value = sprd_keypad_time_to_counter(data->num_rows * data->num_cols,
-						SPRD_DEF_LONG_KEY_MS);
+					    SPRD_DEF_DIV_CNT,
+					    SPRD_DEF_LONG_KEY_MS);
 	writel_relaxed(value, data->base + SPRD_KPD_LONG_KEY_CNT);
 
 	value = sprd_keypad_time_to_counter(data->num_rows * data->num_cols,
-						data->debounce_ms);
+					    SPRD_DEF_DIV_CNT,
+					    data->debounce_ms);
 	writel_relaxed(value, data->base + SPRD_KPD_DEBOUNCE_CNT);
 
 	value = SPRD_KPD_INT_DOWNUP;
@@ -189,23 +211,55 @@ static int sprd_keypad_hw_init(struct sprd_keypad_data *data)
 	writel_relaxed(value, data->base + SPRD_KPD_SLEEP_CNT);
 
 	/* set enabled rows and columns */
-	value = (((data->rows_en << SPRD_KPD_ROWS_SHIFT)
-		| (data->cols_en << SPRD_KPD_COLS_SHIFT))
-		& (SPRD_KPD_ROWS_MSK | SPRD_KPD_COLS_MSK))
-		| SPRD_KPD_EN | SPRD_KPD_SLEEP_EN;
-	if (data->capabilities & SPRD_CAP_LONG_KEY)
-		value |= SPRD_KPD_LONG_KEY_EN;
+	value = sprd_keypad_ctrl_value(data, data->rows_en, data->cols_en);
 	writel_relaxed(value, data->base + SPRD_KPD_CTRL);
 
 	return 0;
 }
 
+/*
+ * While suspended only the lines of the wakeup keys are scanned, with
+ * the clock divided further, and long key is off. The rest of the setup
+ * is kept, so resume only has to put these back.
+ */
+static void sprd_keypad_lp_scan(struct sprd_keypad_data *data, bool enter)
+{
+	u32 size = data->num_rows * data->num_cols;
+	u32 div = enter ? data->sleep_div : SPRD_DEF_DIV_CNT;
+	u32 value;
+
+	writel_relaxed(0, data->base + SPRD_KPD_INT_EN);
+
+	writel_relaxed(div, data->base + SPRD_KPD_CLK_DIV_CNT);
+	value = sprd_keypad_time_to_counter(size, div, data->debounce_ms);
+	writel_relaxed(value, data->base + SPRD_KPD_DEBOUNCE_CNT);
+	value = sprd_keypad_time_to_counter(size, div, SPRD_DEF_LONG_KEY_MS);
+	writel_relaxed(value, data->base + SPRD_KPD_LONG_KEY_CNT);
+
+	if (enter)
+		value = sprd_keypad_ctrl_value(data, data->wake_rows_en,
+					       data->wake_cols_en) &
+			~SPRD_KPD_LONG_KEY_EN;
+	else
+		value = sprd_keypad_ctrl_value(data, data->rows_en,
+					       data->cols_en);
+	writel_relaxed(value, data->base + SPRD_KPD_CTRL);
+
+	writel_relaxed(SPRD_KPD_INT_ALL, data->base + SPRD_KPD_INT_CLR);
+	value = SPRD_KPD_INT_DOWNUP;
+	if (!enter && (data->capabilities & SPRD_CAP_LONG_KEY))
+		value |= SPRD_KPD_INT_LONG;
+	writel_relaxed(value, data->base + SPRD_KPD_INT_EN);
+}
+
 static int __maybe_unused sprd_keypad_suspend(struct device *dev)
 {
 	struct sprd_keypad_data *data = dev_get_drvdata(dev);
 
 	if (!device_may_wakeup(dev))
 		sprd_keypad_disable(data);
+	else
+		sprd_keypad_lp_scan(data, true);
 
 	return 0;
 }
@@ -219,7 +273,12 @@ static int __maybe_unused sprd_keypad_resume(struct device *dev)
 		ret = sprd_keypad_enable(data);
 		if (ret)
 			return ret;
-		ret = sprd_keypad_hw_init(data);
+		/* the setup survives the clock gating unless power got cut */
+		if (readl_relaxed(data->base + SPRD_KPD_CTRL) !=
+		    sprd_keypad_ctrl_value(data, data->rows_en, data->cols_en))
+			ret = sprd_keypad_hw_init(data);
+	} else {
+		sprd_keypad_lp_scan(data, false);
 	}
 
 	return ret;
@@ -258,6 +317,10 @@ static int sprd_keypad_parse_dt(struct device *dev)
 	if (of_get_property(np, "wakeup-source", NULL))
 		data->capabilities |= SPRD_CAP_WAKEUP;
 
+	ret = of_property_read_u32(np, "sprd,sleep-clk-div", &data->sleep_div);
+	if (ret)
+		data->sleep_div = SPRD_DEF_SLEEP_DIV_CNT;
+
 	data->enable = devm_clk_get(dev, "enable");
 	if (IS_ERR(data->enable)) {
 		if (PTR_ERR(data->enable) != -EPROBE_DEFER)
@@ -275,6 +338,57 @@ static int sprd_keypad_parse_dt(struct device *dev)
 	return 0;
 }
 
+/*
+ * "sprd,wakeup-keys" lists the key codes that have to wake the system,
+ * the lines of all the keys are scanned while suspended by default.
+ */
+static int sprd_keypad_parse_wakeup_keys(struct device *dev,
+					 struct sprd_keypad_data *data)
+{
+	u32 codes[SPRD_KPD_WAKEUP_KEYS_MAX];
+	unsigned short *keycodes = data->input_dev->keycode;
+	u32 row_shift = get_count_order(data->num_cols);
+	unsigned long rows = 0, cols = 0;
+	int cnt, i, j, k;
+	unsigned short key;
+
+	cnt = of_property_count_u32_elems(dev->of_node, "sprd,wakeup-keys");
+	if (cnt <= 0) {
+		data->wake_rows_en = data->rows_en;
+		data->wake_cols_en = data->cols_en;
+		return 0;
+	}
+	if (cnt > SPRD_KPD_WAKEUP_KEYS_MAX) {
+		dev_err(dev, "too many wakeup keys\n");
+		return -EINVAL;
+	}
+
+	of_property_read_u32_array(dev->of_node, "sprd,wakeup-keys",
+				   codes, cnt);
+	for (i = 0; i < data->num_rows; i++) {
+		for (j = 0; j < data->num_cols; j++) {
+			key = keycodes[MATRIX_SCAN_CODE(i, j, row_shift)];
+			for (k = 0; key && k < cnt; k++) {
+				if (codes[k] == key) {
+					set_bit(i, &rows);
+					set_bit(j, &cols);
+					break;
+				}
+			}
+		}
+	}
+
+	if (!rows) {
+		dev_err(dev, "no wakeup key in the keymap\n");
+		return -EINVAL;
+	}
+
+	data->wake_rows_en = rows;
+	data->wake_cols_en = cols;
+
+	return 0;
+}
+
 static int sprd_keypad_probe(struct platform_device *pdev)
 {
 	struct sprd_keypad_data *data;
@@ -327,6 +441,10 @@ static int sprd_keypad_probe(struct platform_device *pdev)
 	data->rows_en = rows;
 	data->cols_en = cols;
 
+	ret = sprd_keypad_parse_wakeup_keys(&pdev->dev, data);
+	if (ret)
+		return ret;
+
 	if (data->capabilities & SPRD_CAP_REPEAT)
 		set_bit(EV_REP, data->input_dev->evbit);
 
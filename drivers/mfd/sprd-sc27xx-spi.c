@@ -15,6 +15,7 @@
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/mfd/core.h>
+#include <linux/mfd/sc27xx-pmic.h>
 #include <linux/of_device.h>
 #include <linux/regmap.h>
 #include <linux/spi/spi.h>
@@ -32,6 +33,8 @@
 #define SPRD_SC2720_IRQ_BASE		0xc0
 #define SPRD_SC2720_IRQ_NUMS		9
 
+#define SPRD_PMIC_CACHE_RANGES		4
+
 struct sprd_pmic {
 	struct regmap *regmap;
 	struct device *dev;
@@ -39,6 +42,10 @@ struct sprd_pmic {
 	struct regmap_irq_chip irq_chip;
 	struct regmap_irq_chip_data *irq_data;
 	int irq;
+	/* the only registers regmap caches, see sprd_pmic_cache_range() */
+	struct regmap_range cache_range[SPRD_PMIC_CACHE_RANGES];
+	int cache_cnt;
+	spinlock_t cache_lock;
 };
 
 struct sprd_pmic_data {
@@ -161,11 +168,18 @@ static int sprd_pmic_spi_read(void *context,
 	u32 rx_buf[2] = { 0 };
 	int ret;
 
-	/* Now we only support one PMIC register to read every time. */
-	if (reg_size != sizeof(u32) || val_size != sizeof(u32))
+	if (reg_size != sizeof(u32) || !val_size || val_size % sizeof(u32))
 		return -EINVAL;
 
-	/* Copy address to read from into first element of SPI buffer. */
+	/*
+	 * Copy address to read from into first element of SPI buffer, the
+	 * ADI reads as many registers in a row as the buffer holds.
+	 */
+	if (val_size > sizeof(u32)) {
+		memcpy(val, reg, sizeof(u32));
+		return spi_read(spi, val, val_size);
+	}
+
 	memcpy(rx_buf, reg, sizeof(u32));
 	ret = spi_read(spi, rx_buf, 1);
 	if (ret < 0)
@@ -175,6 +189,60 @@ static int sprd_pmic_spi_read(void *context,
 	return 0;
 }
 
+/*
+ * Most PMIC registers are changed by the hardware or by other cores as
+ * well, so everything is volatile unless a sub device says otherwise.
+ */
+static bool sprd_pmic_volatile_reg(struct device *dev, unsigned int reg)
+{
+	struct sprd_pmic *ddata = dev_get_drvdata(dev);
+	int i, cnt;
+
+	if (!ddata)
+		return true;
+
+	cnt = smp_load_acquire(&ddata->cache_cnt);
+	for (i = 0; i < cnt; i++)
+		if (regmap_reg_in_range(reg, &ddata->cache_range[i]))
+			return false;
+
+	return true;
+}
+
+/**
+ * sprd_pmic_cache_range - let regmap cache a range of PMIC registers
+ * @dev: the PMIC device, the parent of the sub devices
+ * @min: first register of the range
+ * @max: last register of the range
+ *
+ * Only for registers the AP alone changes, reads of them are then served
+ * from memory and updates to the value they already have are skipped.
+ * The caller drops the range with regcache_drop_region() whenever the
+ * block loses its state, e.g. on a reset.
+ */
+int sprd_pmic_cache_range(struct device *dev, unsigned int min,
+			  unsigned int max)
+{
+	struct sprd_pmic *ddata = dev_get_drvdata(dev);
+	int ret = 0;
+
+	if (!ddata || min > max)
+		return -EINVAL;
+
+	spin_lock(&ddata->cache_lock);
+	if (ddata->cache_cnt == SPRD_PMIC_CACHE_RANGES) {
+		ret = -ENOSPC;
+	} else {
+		ddata->cache_range[ddata->cache_cnt] =
+			(struct regmap_range)regmap_reg_range(min, max);
+		smp_store_release(&ddata->cache_cnt, ddata->cache_cnt + 1);
+	}
+	spin_unlock(&ddata->cache_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(sprd_pmic_cache_range);
+
 static struct regmap_bus sprd_pmic_regmap = {
 	.write = sprd_pmic_spi_write,
 	.read = sprd_pmic_spi_read,
@@ -187,6 +255,10 @@ static const struct regmap_config sprd_pmic_config = {
 	.val_bits = 32,
 	.reg_stride = 4,
 	.max_register = 0xffff,
+	/* regmap_multi_reg_write() goes out as one ADI transfer */
+	.can_multi_write = true,
+	.volatile_reg = sprd_pmic_volatile_reg,
+	.cache_type = REGCACHE_RBTREE,
 };
 
 static int sprd_pmic_probe(struct spi_device *spi)
@@ -205,6 +277,8 @@ static int sprd_pmic_probe(struct spi_device *spi)
 	if (!ddata)
 		return -ENOMEM;
 
+	spin_lock_init(&ddata->cache_lock);
+	spi_set_drvdata(spi, ddata);
 	ddata->regmap = devm_regmap_init(&spi->dev, &sprd_pmic_regmap,
 					 &spi->dev, &sprd_pmic_config);
 	if (IS_ERR(ddata->regmap)) {
@@ -213,7 +287,6 @@ static int sprd_pmic_probe(struct spi_device *spi)
 		return ret;
 	}
 
-	spi_set_drvdata(spi, ddata);
 	ddata->dev = &spi->dev;
 	ddata->irq = spi->irq;
 
@@ -27,6 +27,9 @@
 #include <linux/sipc.h>
 #include <linux/slab.h>
 #include <linux/sprd_mailbox.h>
+#include <linux/workqueue.h>
+
+#include "agdsp_access.h"
 
 enum  adcp_state {
 	DEEP_SLEEP_STATE,
@@ -65,6 +68,15 @@ enum adsp_state {
 #define AGDSP_ACCESS_DEBUG 0
 #define TRY_CNT_MAX 1000000
 
+/*
+ * After the last agdsp_access_disable() the access is kept this long
+ * before agcp may sleep again, so a burst of register updates from an
+ * audio path change wakes the agdsp once. 0 drops it right away.
+ */
+static unsigned int linger_ms = 100;
+module_param(linger_ms, uint, 0644);
+MODULE_PARM_DESC(linger_ms, "keep agcp access this long after the last user");
+
 #if AGDSP_ACCESS_DEBUG
 #define pr_dbg(fmt, ...) pr_err(fmt, ##__VA_ARGS__)
 #else
@@ -100,6 +112,20 @@ struct agdsp_access {
 	u32 ap_access_ena_reg;
 	u32 ap_access_ena_mask;
 	spinlock_t spin_lock;
+	/* ap_enable_cnt holds one reference for the linger timer */
+	bool lingering;
+	struct delayed_work linger_work;
+	/* agdsp_access_update_bits_async() writes waiting for the wakeup */
+	struct list_head wr_list;
+	struct work_struct wr_work;
+};
+
+struct agdsp_access_wr {
+	struct list_head node;
+	struct regmap *map;
+	unsigned int reg;
+	unsigned int mask;
+	unsigned int val;
 };
 
 static struct agdsp_access  *g_agdsp_access;
@@ -167,6 +193,9 @@ static int agdsp_access_init_thread(void *data)
 	return rval;
 }
 
+static void agdsp_access_linger_work(struct work_struct *work);
+static void agdsp_access_wr_work(struct work_struct *work);
+
 static int agdsp_access_initialize(struct platform_device *pdev,
 	struct device_node *node, struct regmap *agcp_ahb,
 	struct regmap *pmu_apb, u32 auto_agcp_access,
@@ -264,6 +293,9 @@ static int agdsp_access_initialize(struct platform_device *pdev,
 	dsp_ac->state->cp_enable_cnt = 0;
 
 	spin_lock_init(&g_agdsp_access->spin_lock);
+	INIT_DELAYED_WORK(&dsp_ac->linger_work, agdsp_access_linger_work);
+	INIT_LIST_HEAD(&dsp_ac->wr_list);
+	INIT_WORK(&dsp_ac->wr_work, agdsp_access_wr_work);
 
 	if (g_agdsp_access->auto_agcp_access == 0) {
 		pr_dbg("agdsp access init, ready.\n");
@@ -409,6 +441,13 @@ int agdsp_access_enable(void)
 
 	spin_lock(&dsp_ac->spin_lock);
 
+	/* still awake from the last user, take over the linger reference */
+	if (dsp_ac->lingering) {
+		dsp_ac->lingering = false;
+		spin_unlock(&dsp_ac->spin_lock);
+		return 0;
+	}
+
 	if (!dsp_ac->auto_agcp_access) {
 		ret = regmap_update_bits(dsp_ac->agcp_ahb,
 			dsp_ac->ap_access_ena_reg,
@@ -494,19 +533,9 @@ exit:
 EXPORT_SYMBOL(agdsp_access_enable);
 
 
-int agdsp_access_disable(void)
+static void agdsp_access_put_locked(struct agdsp_access *dsp_ac)
 {
-	int ret = 0;
-	struct agdsp_access *dsp_ac = g_agdsp_access;
-
-	pr_dbg("%s entry\n", __func__);
-	if (!dsp_ac)
-		return -EINVAL;
-
-	if (!dsp_ac->ready || !dsp_ac->state)
-		return -EINVAL;
-
-	spin_lock(&dsp_ac->spin_lock);
+	int ret;
 
 	if (AGCP_READL(&dsp_ac->state->ap_enable_cnt) > 0) {
 		AGCP_WRITEL(AGCP_READL(&dsp_ac->state->ap_enable_cnt) - 1,
@@ -521,6 +550,43 @@ int agdsp_access_disable(void)
 				__func__, ret);
 		}
 	}
+}
+
+static void agdsp_access_linger_work(struct work_struct *work)
+{
+	struct agdsp_access *dsp_ac = container_of(to_delayed_work(work),
+		struct agdsp_access, linger_work);
+
+	spin_lock(&dsp_ac->spin_lock);
+	if (dsp_ac->lingering) {
+		dsp_ac->lingering = false;
+		agdsp_access_put_locked(dsp_ac);
+	}
+	spin_unlock(&dsp_ac->spin_lock);
+}
+
+int agdsp_access_disable(void)
+{
+	struct agdsp_access *dsp_ac = g_agdsp_access;
+
+	pr_dbg("%s entry\n", __func__);
+	if (!dsp_ac)
+		return -EINVAL;
+
+	if (!dsp_ac->ready || !dsp_ac->state)
+		return -EINVAL;
+
+	spin_lock(&dsp_ac->spin_lock);
+
+	if (linger_ms && !dsp_ac->lingering &&
+	    AGCP_READL(&dsp_ac->state->ap_enable_cnt) == 1) {
+		/* the last reference goes to the linger timer */
+		dsp_ac->lingering = true;
+		mod_delayed_work(system_wq, &dsp_ac->linger_work,
+				 msecs_to_jiffies(linger_ms));
+	} else {
+		agdsp_access_put_locked(dsp_ac);
+	}
 
 	spin_unlock(&dsp_ac->spin_lock);
 
@@ -532,6 +598,78 @@ int agdsp_access_disable(void)
 }
 EXPORT_SYMBOL(agdsp_access_disable);
 
+static void agdsp_access_wr_work(struct work_struct *work)
+{
+	struct agdsp_access *dsp_ac = container_of(work,
+		struct agdsp_access, wr_work);
+	struct agdsp_access_wr *wr, *tmp;
+	int ret;
+
+	ret = agdsp_access_enable();
+	if (ret)
+		pr_err("%s, agdsp_access_enable failed %d, drop writes\n",
+			__func__, ret);
+
+	/* under the lock, so no write issued meanwhile can overtake these */
+	spin_lock(&dsp_ac->spin_lock);
+	list_for_each_entry_safe(wr, tmp, &dsp_ac->wr_list, node) {
+		if (!ret)
+			regmap_update_bits(wr->map, wr->reg, wr->mask, wr->val);
+		list_del(&wr->node);
+		kfree(wr);
+	}
+	spin_unlock(&dsp_ac->spin_lock);
+
+	if (!ret)
+		agdsp_access_disable();
+}
+
+/*
+ * Update bits of an agcp register without waiting for the agdsp to wake
+ * up. If the access is held (or lingering) and nothing is queued the
+ * write happens now, otherwise it is queued and a worker applies the
+ * queue, in order, once the access is up. Does not sleep. Writes issued
+ * through agdsp_access_enable() meanwhile are not ordered against it.
+ */
+int agdsp_access_update_bits_async(struct regmap *map, unsigned int reg,
+				   unsigned int mask, unsigned int val)
+{
+	struct agdsp_access *dsp_ac = g_agdsp_access;
+	struct agdsp_access_wr *wr;
+	int ret;
+
+	if (!dsp_ac)
+		return -EINVAL;
+
+	if (!dsp_ac->ready || !dsp_ac->state)
+		return -EPROBE_DEFER;
+
+	spin_lock(&dsp_ac->spin_lock);
+	if (list_empty(&dsp_ac->wr_list) &&
+	    AGCP_READL(&dsp_ac->state->ap_enable_cnt) > 0) {
+		ret = regmap_update_bits(map, reg, mask, val);
+		spin_unlock(&dsp_ac->spin_lock);
+		return ret;
+	}
+
+	wr = kmalloc(sizeof(*wr), GFP_ATOMIC);
+	if (!wr) {
+		spin_unlock(&dsp_ac->spin_lock);
+		return -ENOMEM;
+	}
+	wr->map = map;
+	wr->reg = reg;
+	wr->mask = mask;
+	wr->val = val;
+	list_add_tail(&wr->node, &dsp_ac->wr_list);
+	spin_unlock(&dsp_ac->spin_lock);
+
+	queue_work(system_wq, &dsp_ac->wr_work);
+
+	return 0;
+}
+EXPORT_SYMBOL(agdsp_access_update_bits_async);
+
 static int restore_auto_access(void)
 {
 	return 0;
@@ -648,6 +786,13 @@ int disable_access_force(void)
 
 	spin_lock(&dsp_ac->spin_lock);
 
+	/* no point in restoring access for the linger timer */
+	if (dsp_ac->lingering) {
+		dsp_ac->lingering = false;
+		AGCP_WRITEL(AGCP_READL(&dsp_ac->state->ap_enable_cnt) - 1,
+			&dsp_ac->state->ap_enable_cnt);
+	}
+
 	ret = regmap_update_bits(dsp_ac->agcp_ahb,
 		dsp_ac->ap_access_ena_reg,
 		dsp_ac->ap_access_ena_mask, 0);
@@ -706,6 +851,8 @@ static int agdsp_access_debug_info_show(struct seq_file *m, void *private)
 		g_agdsp_access->smem_phy_addr, g_agdsp_access->smem_size);
 	seq_printf(m, "thread:0x%p\n", g_agdsp_access->thread);
 	seq_printf(m, "ready:%d\n", g_agdsp_access->ready);
+	seq_printf(m, "lingering:%d  linger_ms=%u\n",
+		g_agdsp_access->lingering, linger_ms);
 	seq_printf(m, "dst:%d  channel=%d\n",
 		g_agdsp_access->dst, g_agdsp_access->channel);
 	seq_printf(m, "agcp_ahb:0x%p  pmu_apb=0x%p\n",
@@ -15,8 +15,12 @@
 #define __SPRD_AGDSP_ACCESS_H__
 #include <linux/types.h>
 
+struct regmap;
+
 int agdsp_access_enable(void);
 int agdsp_access_disable(void);
+int agdsp_access_update_bits_async(struct regmap *map, unsigned int reg,
+				   unsigned int mask, unsigned int val);
 int agdsp_can_access(void);
 int force_on_xtl(bool on_off);
 int disable_access_force(void);
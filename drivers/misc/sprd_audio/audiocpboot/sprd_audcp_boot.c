@@ -339,6 +339,7 @@ static const struct of_device_id sprd_audcp_boot_match_table[] = {
 	{.compatible = "sprd,sharkl5-audcp-boot",},
 	{.compatible = "sprd,roc1-audcp-boot",},
 	{.compatible = "sprd,orca-audcp-boot",},
+	{},
 };
 
 #define AGDSP_BOOT_OFFSET 0x80
@@ -483,6 +484,7 @@ static struct platform_driver sprd_audcp_boot_driver = {
 	.driver   = {
 		.name = "sprd_audcp_boot",
 		.of_match_table = sprd_audcp_boot_match_table,
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 };
 
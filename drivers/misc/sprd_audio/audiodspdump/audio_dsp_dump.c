@@ -18,6 +18,9 @@
 #include <linux/interrupt.h>
 #include <linux/kernel.h>
 #include <linux/kthread.h>
+#include <linux/log2.h>
+#include <linux/lz4.h>
+#include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/of_device.h>
 #include <linux/poll.h>
@@ -25,6 +28,9 @@
 #include <linux/sched.h>
 #include <linux/slab.h>
 #include <linux/string.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
 
 #include "agdsp_access.h"
 #include "audio_dsp_ioctl.h"
@@ -90,6 +96,21 @@ struct dsp_log_init_data {
 	u32 timeout_dump;
 };
 
+struct dsp_log_stream {
+	struct file *owner;
+	void *mem;
+	struct dsplog_stream_ctl *ctl;
+	u8 *ring;
+	u32 size;
+	u32 flags;
+	u32 seq;
+	void *raw_buf;
+	void *lz4_buf;
+	void *lz4_wrk;
+	u32 raw_len;
+	u32 lz4_len;
+};
+
 struct dsp_log_device {
 	struct dsp_log_init_data *init;
 	int major;
@@ -98,6 +119,11 @@ struct dsp_log_device {
 	wait_queue_head_t mem_ready_wait;
 	struct mutex mutex;
 	int dsp_assert;
+	/* streaming mode, under mutex */
+	struct dsp_log_stream *stream;
+	bool stream_notify;
+	struct work_struct stream_work;
+	wait_queue_head_t stream_wait;
 };
 
 struct dsp_log_sbuf {
@@ -185,6 +211,270 @@ static int audio_dsp_mem_poll(struct file *filp, poll_table *wait)
 	return mask;
 }
 
+static unsigned int audio_dsp_stream_poll(struct file *filp,
+					  poll_table *wait)
+{
+	struct dsp_log_sbuf *audio_buf = filp->private_data;
+	struct dsp_log_device *dsp_log = audio_buf->dev_res;
+	struct dsp_log_stream *st;
+	unsigned int mask = 0;
+
+	poll_wait(filp, &dsp_log->stream_wait, wait);
+	mutex_lock(&dsp_log->mutex);
+	st = dsp_log->stream;
+	if (!st)
+		mask |= POLLHUP;
+	else if (st->ctl->head != READ_ONCE(st->ctl->tail))
+		mask |= POLLIN | POLLRDNORM;
+	mutex_unlock(&dsp_log->mutex);
+
+	return mask;
+}
+
+/*
+ * Copy one block into the ring, or count it as dropped when the reader
+ * is too far behind. The sblock memory is uncached, so it is copied out
+ * with unalign_memcpy before lz4 gets to see it.
+ */
+static void audio_dsp_stream_put(struct dsp_log_stream *st,
+				 struct sblock *blk)
+{
+	struct dsplog_stream_ctl *ctl = st->ctl;
+	struct dsplog_chunk *chunk;
+	u32 head = ctl->head;
+	u32 tail, off, room, need, pad = 0;
+	u32 flags = 0, len = blk->length;
+	void *src = NULL;
+
+	if (IS_REACHABLE(CONFIG_LZ4_COMPRESS) && st->lz4_wrk &&
+	    len <= st->raw_len) {
+		int n;
+
+		unalign_memcpy(st->raw_buf, blk->addr, len);
+		n = LZ4_compress_default(st->raw_buf, st->lz4_buf, len,
+					 st->lz4_len, st->lz4_wrk);
+		if (n > 0 && (u32)n < len) {
+			src = st->lz4_buf;
+			len = n;
+			flags = DSPLOG_CHUNK_LZ4;
+		} else {
+			src = st->raw_buf;
+		}
+	}
+
+	need = ALIGN(sizeof(*chunk) + len, DSPLOG_CHUNK_ALIGN);
+	off = head & (st->size - 1);
+	room = st->size - off;
+	if (room < need)
+		pad = room;
+
+	tail = READ_ONCE(ctl->tail);
+	/* no ring writes before the reader is seen to be done with them */
+	smp_mb();
+	if (head + pad + need - tail > st->size) {
+		ctl->dropped++;
+		st->seq++;
+		return;
+	}
+
+	if (pad) {
+		chunk = (struct dsplog_chunk *)(st->ring + off);
+		chunk->flags = DSPLOG_CHUNK_PAD;
+		chunk->len = pad - sizeof(*chunk);
+		chunk->raw_len = chunk->len;
+		chunk->seq = st->seq;
+		head += pad;
+		off = 0;
+	}
+
+	chunk = (struct dsplog_chunk *)(st->ring + off);
+	chunk->flags = flags;
+	chunk->len = len;
+	chunk->raw_len = blk->length;
+	chunk->seq = st->seq++;
+	if (src)
+		memcpy(chunk + 1, src, len);
+	else
+		unalign_memcpy(chunk + 1, blk->addr, len);
+
+	/* the chunk is complete before the reader can see it */
+	smp_wmb();
+	WRITE_ONCE(ctl->head, head + need);
+}
+
+/*
+ * The sblock buffers are given back right away, so a reader lagging
+ * behind costs ring space on the AP and never holds up the DSP.
+ */
+static void audio_dsp_stream_work(struct work_struct *work)
+{
+	struct dsp_log_device *dsp_log = container_of(work,
+		struct dsp_log_device, stream_work);
+	struct dsp_log_init_data *init = dsp_log->init;
+	struct dsp_log_stream *st;
+	struct sblock blk;
+	int n;
+
+	mutex_lock(&dsp_log->mutex);
+	st = dsp_log->stream;
+	if (!st)
+		goto out;
+
+	n = audio_sblock_get_arrived_count(init->dst, init->channel);
+	while (n-- > 0) {
+		if (audio_sblock_receive(init->dst, init->channel, &blk, 0))
+			break;
+		audio_dsp_stream_put(st, &blk);
+		if (audio_sblock_release(init->dst, init->channel, &blk) < 0)
+			pr_err("%s: failed to release block!\n", __func__);
+	}
+	wake_up_interruptible_all(&dsp_log->stream_wait);
+out:
+	mutex_unlock(&dsp_log->mutex);
+}
+
+static void audio_dsp_stream_notify(int event, void *data)
+{
+	struct dsp_log_device *dsp_log = data;
+
+	if (event == SBLOCK_NOTIFY_RECV && READ_ONCE(dsp_log->stream))
+		schedule_work(&dsp_log->stream_work);
+}
+
+static void audio_dsp_stream_free(struct dsp_log_stream *st)
+{
+	vfree(st->lz4_wrk);
+	vfree(st->lz4_buf);
+	vfree(st->raw_buf);
+	vfree(st->mem);
+	kfree(st);
+}
+
+static int audio_dsp_stream_start(struct dsp_log_sbuf *audio_buf,
+				  struct file *filp,
+				  struct dsplog_stream_cfg *cfg)
+{
+	struct dsp_log_device *dsp_log = audio_buf->dev_res;
+	u32 blksz = dsp_log->init->rxblocksize;
+	struct dsp_log_stream *st;
+	int ret = 0;
+
+	if (audio_buf->dump_type != DSP_LOG && audio_buf->dump_type != DSP_PCM)
+		return -EINVAL;
+	if (!dsp_log->stream_notify)
+		return -ENODEV;
+	if (cfg->flags & ~DSPLOG_STREAM_LZ4)
+		return -EINVAL;
+	if ((cfg->flags & DSPLOG_STREAM_LZ4) &&
+	    !IS_REACHABLE(CONFIG_LZ4_COMPRESS))
+		return -EOPNOTSUPP;
+	if (!is_power_of_2(cfg->ring_bytes) ||
+	    cfg->ring_bytes < DSPLOG_STREAM_MIN_BYTES ||
+	    cfg->ring_bytes > DSPLOG_STREAM_MAX_BYTES ||
+	    cfg->ring_bytes < 2 * (blksz + sizeof(struct dsplog_chunk)))
+		return -EINVAL;
+
+	st = kzalloc(sizeof(*st), GFP_KERNEL);
+	if (!st)
+		return -ENOMEM;
+	st->mem = vmalloc_user(PAGE_SIZE + cfg->ring_bytes);
+	if (!st->mem) {
+		ret = -ENOMEM;
+		goto fail;
+	}
+	st->owner = filp;
+	st->ctl = st->mem;
+	st->ring = (u8 *)st->mem + PAGE_SIZE;
+	st->size = cfg->ring_bytes;
+	st->flags = cfg->flags;
+	st->ctl->ring_bytes = st->size;
+
+	if (st->flags & DSPLOG_STREAM_LZ4) {
+		st->raw_len = blksz;
+		st->lz4_len = LZ4_compressBound(blksz);
+		st->raw_buf = vmalloc(st->raw_len);
+		st->lz4_buf = vmalloc(st->lz4_len);
+		st->lz4_wrk = vmalloc(LZ4_MEM_COMPRESS);
+		if (!st->raw_buf || !st->lz4_buf || !st->lz4_wrk) {
+			ret = -ENOMEM;
+			goto fail;
+		}
+	}
+
+	mutex_lock(&dsp_log->mutex);
+	if (dsp_log->stream) {
+		mutex_unlock(&dsp_log->mutex);
+		ret = -EBUSY;
+		goto fail;
+	}
+	dsp_log->stream = st;
+	mutex_unlock(&dsp_log->mutex);
+
+	/* whatever the dsp sent before streaming started */
+	schedule_work(&dsp_log->stream_work);
+	pr_info("%s: ring %u bytes, flags %#x\n", __func__,
+		st->size, st->flags);
+
+	return 0;
+
+fail:
+	audio_dsp_stream_free(st);
+
+	return ret;
+}
+
+static int audio_dsp_stream_stop(struct dsp_log_device *dsp_log,
+				 struct file *filp)
+{
+	struct dsp_log_stream *st;
+
+	mutex_lock(&dsp_log->mutex);
+	st = dsp_log->stream;
+	if (!st || st->owner != filp) {
+		mutex_unlock(&dsp_log->mutex);
+		return -EINVAL;
+	}
+	dsp_log->stream = NULL;
+	mutex_unlock(&dsp_log->mutex);
+
+	cancel_work_sync(&dsp_log->stream_work);
+	wake_up_interruptible_all(&dsp_log->stream_wait);
+	pr_info("%s: %u blocks dropped\n", __func__, st->ctl->dropped);
+	/* pages still mapped stay around until they are unmapped */
+	audio_dsp_stream_free(st);
+
+	return 0;
+}
+
+static bool audio_dsp_streaming(struct dsp_log_device *dsp_log)
+{
+	bool on;
+
+	mutex_lock(&dsp_log->mutex);
+	on = dsp_log->stream != NULL;
+	mutex_unlock(&dsp_log->mutex);
+
+	return on;
+}
+
+static int audio_dsp_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct dsp_log_sbuf *audio_buf = filp->private_data;
+	struct dsp_log_device *dsp_log = audio_buf->dev_res;
+	struct dsp_log_stream *st;
+	int ret;
+
+	mutex_lock(&dsp_log->mutex);
+	st = dsp_log->stream;
+	if (!st || st->owner != filp)
+		ret = -EINVAL;
+	else
+		ret = remap_vmalloc_range(vma, st->mem, vma->vm_pgoff);
+	mutex_unlock(&dsp_log->mutex);
+
+	return ret;
+}
+
 static int audio_dsp_open(struct inode *inode, struct file *filp)
 {
 	int minor = iminor(filp->f_path.dentry->d_inode);
@@ -215,6 +505,7 @@ static int audio_dsp_release(struct inode *inode, struct file *filp)
 {
 	struct dsp_log_sbuf *audio_buf = filp->private_data;
 
+	audio_dsp_stream_stop(audio_buf->dev_res, filp);
 	kfree(audio_buf);
 	pr_info("%s\n", __func__);
 
@@ -227,6 +518,8 @@ static unsigned int audio_dsp_poll(struct file *filp, poll_table *wait)
 
 	if ((audio_buf->dump_type == DSP_LOG) ||
 	    (audio_buf->dump_type == DSP_PCM)) {
+		if (audio_dsp_streaming(audio_buf->dev_res))
+			return audio_dsp_stream_poll(filp, wait);
 		return audio_sblock_poll_wait(audio_buf->dst,
 					      audio_buf->channel, filp, wait);
 	} else if (audio_buf->dump_type == DSP_MEM) {
@@ -341,6 +634,10 @@ static ssize_t audio_dsp_read(struct file *filp,
 		}
 	} else {
 		if (audio_buf->blk.length == 0) {
+			if (audio_dsp_streaming(audio_buf->dev_res)) {
+				ret = -EBUSY;
+				goto fail;
+			}
 			ret = audio_sblock_receive(audio_buf->dst,
 						   audio_buf->channel,
 						   &audio_buf->blk, timeout);
@@ -447,6 +744,7 @@ static long audio_dsp_ioctl(struct file *filp,
 	unsigned int cmd, unsigned long arg)
 {
 	struct dsp_log_sbuf *audio_buf = filp->private_data;
+	struct dsplog_stream_cfg cfg;
 	int ret = 0;
 
 	pr_info("%s enter into\n", __func__);
@@ -497,6 +795,14 @@ static long audio_dsp_ioctl(struct file *filp,
 	case DSPLOG_CMD_TIMEOUTDUMP_ENABLE:
 		audio_buf->dev_res->init->timeout_dump = (u32)arg;
 		break;
+	case DSPLOG_CMD_STREAM_SET:
+		if (copy_from_user(&cfg, (void __user *)arg, sizeof(cfg)))
+			return -EFAULT;
+		if (cfg.ring_bytes)
+			ret = audio_dsp_stream_start(audio_buf, filp, &cfg);
+		else
+			ret = audio_dsp_stream_stop(audio_buf->dev_res, filp);
+		break;
 	default:
 		return -EINVAL;
 	}
@@ -519,6 +825,7 @@ static const struct file_operations dsp_log_tp_fops = {
 	.read			= audio_dsp_read,
 	.write		= audio_dsp_write,
 	.poll			= audio_dsp_poll,
+	.mmap			= audio_dsp_mmap,
 	.unlocked_ioctl	= audio_dsp_ioctl,
 	.compat_ioctl = audio_dsp_ioctl,
 	.owner		= THIS_MODULE,
@@ -785,6 +1092,16 @@ static int audio_dsp_probe(struct platform_device *pdev)
 	dsp_log->init = init;
 	mutex_init(&dsp_log->mutex);
 	init_waitqueue_head(&dsp_log->mem_ready_wait);
+	INIT_WORK(&dsp_log->stream_work, audio_dsp_stream_work);
+	init_waitqueue_head(&dsp_log->stream_wait);
+	if (init->dump_type != DSP_MEM && init->rxblocknum) {
+		if (audio_sblock_register_notifier(init->dst, init->channel,
+			audio_dsp_stream_notify, dsp_log))
+			pr_warn("%s: no streaming on %s\n", __func__,
+				init->name);
+		else
+			dsp_log->stream_notify = true;
+	}
 	platform_set_drvdata(pdev, dsp_log);
 	pr_info("dsp_log_tp_probe success  %s\n", init->name);
 
@@ -796,6 +1113,10 @@ static int  audio_dsp_remove(struct platform_device *pdev)
 
 	struct dsp_log_device *dsp_log = platform_get_drvdata(pdev);
 
+	if (dsp_log->stream_notify)
+		audio_sblock_register_notifier(dsp_log->init->dst,
+			dsp_log->init->channel, NULL, NULL);
+	cancel_work_sync(&dsp_log->stream_work);
 	cdev_del(&(dsp_log->cdev));
 	unregister_chrdev_region(
 		MKDEV(dsp_log->major, dsp_log->minor), 1);
@@ -28,6 +28,50 @@
 #define DSPLOG_CMD_DSPASSERT		_IOW(DSPLOG_CMD_MARGIC, 6, int)
 #define DSPLOG_CMD_DSPDUMP_ENABLE	_IOW(DSPLOG_CMD_MARGIC, 7, int)
 #define DSPLOG_CMD_TIMEOUTDUMP_ENABLE	_IOW(DSPLOG_CMD_MARGIC, 8, int)
+#define DSPLOG_CMD_STREAM_SET		_IOW(DSPLOG_CMD_MARGIC, 9, \
+					     struct dsplog_stream_cfg)
+
+/*
+ * Streaming mode of the log and pcm devices: blocks are drained from
+ * sblock as soon as they arrive into a ring the caller mmaps, read()
+ * fails with -EBUSY meanwhile. ring_bytes 0 stops it, so does closing
+ * the file that started it.
+ */
+#define DSPLOG_STREAM_LZ4		0x1	/* lz4 compress each chunk */
+
+#define DSPLOG_STREAM_MIN_BYTES		(16 * 1024)
+#define DSPLOG_STREAM_MAX_BYTES		(4 * 1024 * 1024)
+
+struct dsplog_stream_cfg {
+	__u32 ring_bytes;	/* power of two */
+	__u32 flags;
+};
+
+/*
+ * mmap layout: one page holding dsplog_stream_ctl, then ring_bytes of
+ * chunks. head and tail are free running byte counts, the kernel moves
+ * head and the reader moves tail once it consumed a chunk. A chunk is a
+ * dsplog_chunk and len bytes, padded to DSPLOG_CHUNK_ALIGN, and never
+ * wraps: a DSPLOG_CHUNK_PAD chunk skips the rest of the ring instead.
+ */
+#define DSPLOG_CHUNK_ALIGN		16
+
+#define DSPLOG_CHUNK_LZ4		0x1
+#define DSPLOG_CHUNK_PAD		0x2
+
+struct dsplog_stream_ctl {
+	__u32 ring_bytes;
+	__u32 head;
+	__u32 tail;
+	__u32 dropped;		/* blocks the ring had no room for */
+};
+
+struct dsplog_chunk {
+	__u32 flags;
+	__u32 len;		/* bytes after this header */
+	__u32 raw_len;		/* len once decompressed */
+	__u32 seq;		/* per block, dropped ones included */
+};
 
 
 #endif
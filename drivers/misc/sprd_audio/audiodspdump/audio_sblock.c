@@ -56,8 +56,6 @@
 #define SBLOCK_BLK_STATE_DONE		0
 #define SBLOCK_BLK_STATE_PENDING	1
 
-#define	SBLOCK_NOTIFY_GET	0x01
-#define	SBLOCK_NOTIFY_RECV	0x02
 #define	SBLOCK_NOTIFY_STATUS	0x04
 #define	SBLOCK_NOTIFY_OPEN	0x08
 #define	SBLOCK_NOTIFY_CLOSE	0x10
@@ -654,7 +652,7 @@ int audio_sblock_register_notifier(uint8_t dst, uint8_t channel,
 		return -ENODEV;
 	}
 #ifndef CONFIG_SIPC_WCN
-	if (sblock->handler) {
+	if (sblock->handler && handler) {
 		pr_err("sblock handler already registered\n");
 		return -EBUSY;
 	}
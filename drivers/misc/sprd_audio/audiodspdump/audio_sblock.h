@@ -17,6 +17,9 @@
 #include <linux/poll.h>
 #include <linux/types.h>
 
+#define	SBLOCK_NOTIFY_GET	0x01
+#define	SBLOCK_NOTIFY_RECV	0x02
+
 struct sblock {
 	void		*addr;
 	u32	length;
@@ -36,6 +39,10 @@ int audio_sblock_send(uint8_t dst, uint8_t channel, struct sblock *blk);
 int audio_sblock_receive(uint8_t dst, uint8_t channel, struct sblock *blk,
 			 int timeout);
 int audio_sblock_release(uint8_t dst, uint8_t channel, struct sblock *blk);
+int audio_sblock_get_arrived_count(uint8_t dst, uint8_t channel);
+/* handler runs in the smsg thread, a NULL handler unregisters */
+int audio_sblock_register_notifier(uint8_t dst, uint8_t channel,
+		void (*handler)(int event, void *data), void *data);
 int audio_sblock_init(uint8_t dst, uint8_t channel,
 		u32 txblocknum, u32 txblocksize,
 		u32 rxblocknum, u32 rxblocksize, int mem_type);
@@ -14,11 +14,14 @@
 
 #include <linux/delay.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/of_device.h>
 #include <linux/platform_device.h>
 #include <linux/sipc.h>
+#include <linux/workqueue.h>
 
 #include "audio-sipc.h"
+#include "sprd-audcp-dvfs.h"
 #include "sprd_audcp_dvfs.h"
 
 #define TO_STRING(e) #e
@@ -95,6 +98,147 @@ static int disable_audcp_ipc(struct device *dev)
 	return 0;
 }
 
+static struct audcpdvfs_data *audcp_dvfs;
+
+static int usecase_get_table(struct audcpdvfs_data *data)
+{
+	struct audcp_dvfs_table table = {};
+	u32 i;
+	int ret;
+
+	if (data->table_valid)
+		return 0;
+	ret = aud_send_cmd_result(data->channel, 0, 0, AUDDVFS_GET_TABLE,
+				  &table, sizeof(struct audcp_dvfs_table),
+				  &data->table, -1);
+	if (ret != 0)
+		return ret;
+	if (!data->table.total_index_cnt ||
+	    data->table.total_index_cnt >= AUDCP_DVFS_TABLE_MAX)
+		return -EINVAL;
+	for (i = 0; i < data->table.total_index_cnt; i++)
+		if (data->table.table[i].clock >= AUDCP_CLK_DSP_CORE_MAX)
+			return -EINVAL;
+	data->table_valid = true;
+
+	return 0;
+}
+
+/* lowest level covering need, or the fastest one if none does */
+static struct audcp_dvfs_index_map *usecase_pick(struct audcpdvfs_data *data,
+						 u32 need)
+{
+	struct audcp_dvfs_index_map *map, *best = NULL, *top = NULL;
+	u32 i, mhz;
+
+	for (i = 0; i < data->table.total_index_cnt; i++) {
+		map = &data->table.table[i];
+		mhz = dvfs_clock[map->clock][0];
+		if (!top || mhz > dvfs_clock[top->clock][0])
+			top = map;
+		if (mhz >= need &&
+		    (!best || mhz < dvfs_clock[best->clock][0]))
+			best = map;
+	}
+
+	return best ? best : top;
+}
+
+static int usecase_set_index(struct audcpdvfs_data *data,
+			     struct audcp_dvfs_index_map *map)
+{
+	struct audcp_dvfs_index index = {};
+	struct audcp_dvfs_index index_out = {};
+	int ret;
+
+	index.index = map->index;
+	ret = aud_send_cmd_result(data->channel, 0, 0, AUDDVFS_SET_INDEX,
+				  &index, sizeof(struct audcp_dvfs_index),
+				  &index_out, -1);
+	if (ret != 0) {
+		dev_err(data->dev_sys, "set index %u failed %d\n",
+			map->index, ret);
+		return ret;
+	}
+	data->usecase_cur_mhz = dvfs_clock[map->clock][0];
+	dev_dbg(data->dev_sys, "use case index %u, %u MHz\n",
+		map->index, data->usecase_cur_mhz);
+
+	return 0;
+}
+
+/* called with usecase_lock held, lower says whether slowing down is ok */
+static int usecase_update(struct audcpdvfs_data *data, bool lower)
+{
+	struct audcp_dvfs_index_map *map;
+	u32 i, sum = 0, need, mhz;
+	int ret;
+
+	if (!data->usecase_enable)
+		return 0;
+	for (i = 0; i < AUDCP_DVFS_USECASE_MAX; i++)
+		sum += data->usecase_mhz[i];
+	need = sum + sum * data->usecase_headroom / 100;
+
+	ret = enable_audcp_ipc(data->dev_sys);
+	if (ret < 0)
+		return ret;
+	ret = usecase_get_table(data);
+	if (ret) {
+		dev_err(data->dev_sys, "no dvfs table %d\n", ret);
+		return ret;
+	}
+
+	map = usecase_pick(data, need);
+	mhz = dvfs_clock[map->clock][0];
+	if (mhz == data->usecase_cur_mhz)
+		return 0;
+	if (mhz > data->usecase_cur_mhz || !data->usecase_cur_mhz) {
+		cancel_delayed_work(&data->usecase_lower_work);
+		return usecase_set_index(data, map);
+	}
+	if (!lower) {
+		mod_delayed_work(system_wq, &data->usecase_lower_work,
+				 msecs_to_jiffies(data->usecase_lower_ms));
+		return 0;
+	}
+
+	return usecase_set_index(data, map);
+}
+
+static void usecase_lower_work(struct work_struct *work)
+{
+	struct audcpdvfs_data *data = container_of(to_delayed_work(work),
+		struct audcpdvfs_data, usecase_lower_work);
+
+	mutex_lock(&data->usecase_lock);
+	usecase_update(data, true);
+	mutex_unlock(&data->usecase_lock);
+}
+
+int audcp_dvfs_usecase_set(u32 id, u32 mhz)
+{
+	struct audcpdvfs_data *data = READ_ONCE(audcp_dvfs);
+	int ret;
+
+	if (!data)
+		return -ENODEV;
+	if (id >= AUDCP_DVFS_USECASE_MAX)
+		return -EINVAL;
+
+	mutex_lock(&data->usecase_lock);
+	if (data->usecase_mhz[id] == mhz) {
+		mutex_unlock(&data->usecase_lock);
+		return 0;
+	}
+	data->usecase_mhz[id] = mhz;
+	ret = usecase_update(data, false);
+	mutex_unlock(&data->usecase_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL(audcp_dvfs_usecase_set);
+
 /* attributes functions begin */
 static ssize_t status_show(struct device *dev,
 			   struct device_attribute *attr, char *buf)
@@ -1362,6 +1506,57 @@ static ssize_t idle_index_store(struct device *dev,
 
 static DEVICE_ATTR_RW(idle_index);
 
+static ssize_t usecase_show(struct device *dev,
+			    struct device_attribute *attr, char *buf)
+{
+	struct audcpdvfs_data *data = dev_get_drvdata(dev);
+	int i, len = 0;
+
+	mutex_lock(&data->usecase_lock);
+	len += sprintf(buf + len, "enable %u headroom %u%% lower %ums\n",
+		data->usecase_enable, data->usecase_headroom,
+		data->usecase_lower_ms);
+	len += sprintf(buf + len, "current %u MHz\n", data->usecase_cur_mhz);
+	for (i = 0; i < AUDCP_DVFS_USECASE_MAX; i++)
+		if (data->usecase_mhz[i])
+			len += sprintf(buf + len, "%d: %u MHz\n", i,
+				data->usecase_mhz[i]);
+	mutex_unlock(&data->usecase_lock);
+
+	return len;
+}
+
+/* "<enable> [headroom percent] [lower delay ms]" */
+static ssize_t usecase_store(struct device *dev,
+			     struct device_attribute *attr,
+			     const char *buf, size_t count)
+{
+	struct audcpdvfs_data *data = dev_get_drvdata(dev);
+	u32 enable, headroom, lower_ms;
+	int n, ret;
+
+	mutex_lock(&data->usecase_lock);
+	headroom = data->usecase_headroom;
+	lower_ms = data->usecase_lower_ms;
+	n = sscanf(buf, "%u %u %u", &enable, &headroom, &lower_ms);
+	if (n < 1 || headroom > 100) {
+		mutex_unlock(&data->usecase_lock);
+		dev_err(dev, "failed get val\n");
+		return -EINVAL;
+	}
+	data->usecase_enable = enable;
+	data->usecase_headroom = headroom;
+	data->usecase_lower_ms = lower_ms;
+	/* an explicit index may have been set meanwhile */
+	data->usecase_cur_mhz = 0;
+	ret = usecase_update(data, true);
+	mutex_unlock(&data->usecase_lock);
+
+	return ret < 0 ? ret : count;
+}
+
+static DEVICE_ATTR_RW(usecase);
+
 static struct attribute *audcp_governor_attrs[] = {
 	&dev_attr_audcp_running_mode_table.attr,
 	&dev_attr_audcp_running_mode.attr,
@@ -1388,6 +1583,7 @@ static struct attribute *audcp_governor_attrs[] = {
 	&dev_attr_sw_dvfs.attr,
 	&dev_attr_running_record.attr,
 	&dev_attr_dvfs_register.attr,
+	&dev_attr_usecase.attr,
 	NULL,
 };
 
@@ -1439,6 +1635,13 @@ static int audcp_dvfs_probe(struct platform_device *pdev)
 		dev_err(dev, "failed parse dts\n");
 		return err;
 	}
+	mutex_init(&data->usecase_lock);
+	INIT_DELAYED_WORK(&data->usecase_lower_work, usecase_lower_work);
+	data->usecase_enable = 1;
+	data->usecase_headroom = 20;
+	data->usecase_lower_ms = 500;
+	of_property_read_u32(dev->of_node, "sprd,usecase-headroom",
+			     &data->usecase_headroom);
 	platform_set_drvdata(pdev, data);
 	err =
 		sysfs_create_groups(&dev->kobj, audcp_groups);
@@ -1447,6 +1650,7 @@ static int audcp_dvfs_probe(struct platform_device *pdev)
 		return err;
 	}
 	data->dev_sys = dev;
+	WRITE_ONCE(audcp_dvfs, data);
 
 	return err;
 }
@@ -1454,7 +1658,13 @@ static int audcp_dvfs_probe(struct platform_device *pdev)
 static int audcp_dvfs_remove(struct platform_device *pdev)
 {
 	struct device *dev = &pdev->dev;
+	struct audcpdvfs_data *data = platform_get_drvdata(pdev);
 
+	WRITE_ONCE(audcp_dvfs, NULL);
+	mutex_lock(&data->usecase_lock);
+	data->usecase_enable = 0;
+	mutex_unlock(&data->usecase_lock);
+	cancel_delayed_work_sync(&data->usecase_lower_work);
 	sysfs_remove_groups(&dev->kobj, audcp_groups);
 
 	return 0;
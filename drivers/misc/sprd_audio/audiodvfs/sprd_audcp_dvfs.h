@@ -241,5 +241,16 @@ struct audcpdvfs_data {
 	u32 channel;
 	u32 sipc_enabled;
 	u32 func_enable;
+	/* use-case governor, see sprd-audcp-dvfs.h */
+	struct mutex usecase_lock;
+	u32 usecase_mhz[AUDCP_DVFS_USECASE_MAX];
+	u32 usecase_enable;
+	u32 usecase_headroom;
+	u32 usecase_lower_ms;
+	/* clock in MHz of the level last set, 0 before the first one */
+	u32 usecase_cur_mhz;
+	struct delayed_work usecase_lower_work;
+	struct audcp_dvfs_table table;
+	bool table_valid;
 };
 #endif
@@ -27,6 +27,15 @@ enum {
 	PLATFORM_ORCA = 3,
 };
 
+/*
+ * Freed ddr32 blocks of up to 4K << (SMEM_CLASS_NUM - 1) are parked per
+ * power of two size class, and unmapped ranges keep their mapping, so a
+ * stream reopen finds the block it just freed together with its vmap.
+ */
+#define SMEM_CLASS_NUM		5
+#define SMEM_PARK_DEPTH		4
+#define SMEM_MAP_PARK_MAX	8
+
 struct smem_pool {
 	struct list_head smem_head;
 	/* for pool record momory list */
@@ -35,6 +44,9 @@ struct smem_pool {
 	u32 size;
 	atomic_t used;
 	struct gen_pool *gen;
+	/* free blocks kept out of gen, one record each */
+	struct list_head park[SMEM_CLASS_NUM];
+	u32 park_cnt[SMEM_CLASS_NUM];
 };
 
 struct smem_record {
@@ -50,6 +62,8 @@ struct smem_map {
 	const void *mem;
 	void *mem_real;
 	unsigned int count;
+	phys_addr_t page_start;
+	int writecombine;
 };
 
 struct smem_map_list {
@@ -57,6 +71,9 @@ struct smem_map_list {
 	/* for memory map list operation */
 	spinlock_t lock;
 	u32 inited;
+	/* unmapped by their users, still mapped */
+	struct list_head park_head;
+	u32 park_cnt;
 };
 
 static struct smem_pool audio_mem_pool;
@@ -67,12 +84,17 @@ static int audio_smem_init(u32 addr, u32 size)
 {
 	struct smem_pool *spool = &audio_mem_pool;
 	struct smem_map_list *smem = &mem_mp;
+	int i;
 
 	spool->addr = addr;
 	spool->size = PAGE_ALIGN(size);
 	atomic_set(&spool->used, 0);
 	spin_lock_init(&spool->lock);
 	INIT_LIST_HEAD(&spool->smem_head);
+	for (i = 0; i < SMEM_CLASS_NUM; i++) {
+		INIT_LIST_HEAD(&spool->park[i]);
+		spool->park_cnt[i] = 0;
+	}
 
 	/* allocator block size is times of pages */
 	spool->gen = gen_pool_create(PAGE_SHIFT, -1);
@@ -89,25 +111,58 @@ static int audio_smem_init(u32 addr, u32 size)
 
 	spin_lock_init(&smem->lock);
 	INIT_LIST_HEAD(&smem->map_head);
+	INIT_LIST_HEAD(&smem->park_head);
+	smem->park_cnt = 0;
 	smem->inited = 1;
 
 	return 0;
 }
 
+/* blocks of a class are allocated at the class size, so any can be reused */
+static int audio_smem_class(u32 *size)
+{
+	int order;
+
+	*size = PAGE_ALIGN(*size);
+	order = get_order(*size);
+	if (order >= SMEM_CLASS_NUM)
+		return -1;
+
+	*size = PAGE_SIZE << order;
+	return order;
+}
+
 static u32 audio_smem_alloc(u32 size)
 {
 	struct smem_pool *spool = &audio_mem_pool;
 	struct smem_record *recd;
 	unsigned long flags;
+	int class;
 	u32 addr;
 
+	class = audio_smem_class(&size);
+	if (class >= 0) {
+		spin_lock_irqsave(&spool->lock, flags);
+		recd = list_first_entry_or_null(&spool->park[class],
+						struct smem_record, smem_list);
+		if (recd) {
+			list_move_tail(&recd->smem_list, &spool->smem_head);
+			spool->park_cnt[class]--;
+			recd->task = current;
+		}
+		spin_unlock_irqrestore(&spool->lock, flags);
+		if (recd) {
+			atomic_add(size, &spool->used);
+			return recd->addr;
+		}
+	}
+
 	recd = kzalloc(sizeof(*recd), GFP_KERNEL);
 	if (!recd) {
 		addr = 0;
 		goto error;
 	}
 
-	size = PAGE_ALIGN(size);
 	addr = gen_pool_alloc(spool->gen, size);
 	if (!addr) {
 		pr_err("failed to alloc smem from gen pool\n");
@@ -133,20 +188,29 @@ static void audio_smem_free(u32 addr, u32 size)
 	struct smem_pool *spool = &audio_mem_pool;
 	struct smem_record *recd, *next;
 	unsigned long flags;
+	int class;
 
-	size = PAGE_ALIGN(size);
+	class = audio_smem_class(&size);
 	atomic_sub(size, &spool->used);
-	gen_pool_free(spool->gen, addr, size);
-	/* delete record node from list */
+	/* delete record node from list, or park it */
 	spin_lock_irqsave(&spool->lock, flags);
 	list_for_each_entry_safe(recd, next, &spool->smem_head, smem_list) {
 		if (recd->addr == addr) {
+			if (class >= 0 &&
+			    spool->park_cnt[class] < SMEM_PARK_DEPTH) {
+				list_move(&recd->smem_list,
+					  &spool->park[class]);
+				spool->park_cnt[class]++;
+				spin_unlock_irqrestore(&spool->lock, flags);
+				return;
+			}
 			list_del(&recd->smem_list);
 			kfree(recd);
 			break;
 		}
 	}
 	spin_unlock_irqrestore(&spool->lock, flags);
+	gen_pool_free(spool->gen, addr, size);
 }
 
 struct AUDIO_MEM {
@@ -391,15 +455,54 @@ void *audio_mem_vmap(phys_addr_t start, size_t size, int writecombine)
 	void *vaddr;
 	phys_addr_t addr;
 	unsigned long flags;
-	struct smem_map *map;
+	struct smem_map *map, *next;
 	struct smem_map_list *smem = &mem_mp;
+	LIST_HEAD(evict);
+
+	page_start = start - offset_in_page(start);
+	page_count = DIV_ROUND_UP(size + offset_in_page(start), PAGE_SIZE);
+
+	if (smem->inited) {
+		void *found = NULL;
+
+		spin_lock_irqsave(&smem->lock, flags);
+		list_for_each_entry_safe(map, next, &smem->park_head,
+					 map_list) {
+			if (!found && map->page_start == page_start &&
+			    map->count == page_count &&
+			    map->writecombine == !!writecombine) {
+				list_move_tail(&map->map_list, &smem->map_head);
+				smem->park_cnt--;
+				map->task = current;
+				map->mem_real = (void *)((size_t)map->mem +
+						offset_in_page(start));
+				found = map->mem_real;
+				continue;
+			}
+			/* never keep a second mapping of the same pages */
+			if (map->page_start < page_start +
+				(phys_addr_t)page_count * PAGE_SIZE &&
+			    page_start < map->page_start +
+				(phys_addr_t)map->count * PAGE_SIZE) {
+				list_move(&map->map_list, &evict);
+				smem->park_cnt--;
+			}
+		}
+		spin_unlock_irqrestore(&smem->lock, flags);
+
+		list_for_each_entry_safe(map, next, &evict, map_list) {
+			list_del(&map->map_list);
+			vm_unmap_ram(map->mem, map->count);
+			kfree(map);
+		}
+		if (found)
+			return found;
+	}
 
 	map = kzalloc(sizeof(*map), GFP_KERNEL);
 	if (!map)
 		return NULL;
 
-	page_start = start - offset_in_page(start);
-	page_count = DIV_ROUND_UP(size + offset_in_page(start), PAGE_SIZE);
 	if (!writecombine)
 		prot = pgprot_noncached(PAGE_KERNEL);
 	else
@@ -423,6 +526,8 @@ void *audio_mem_vmap(phys_addr_t start, size_t size, int writecombine)
 	kfree(pages);
 
 	map->count = page_count;
+	map->page_start = page_start;
+	map->writecombine = !!writecombine;
 	map->mem = vaddr;
 	map->mem_real = (void *)((size_t)vaddr + offset_in_page(start));
 	map->task = current;
@@ -447,6 +552,14 @@ void audio_mem_unmap(const void *mem)
 		spin_lock_irqsave(&smem->lock, flags);
 		list_for_each_entry_safe(map, next, &smem->map_head, map_list) {
 			if (map->mem_real == mem) {
+				if (smem->park_cnt < SMEM_MAP_PARK_MAX) {
+					list_move(&map->map_list,
+						  &smem->park_head);
+					smem->park_cnt++;
+					spin_unlock_irqrestore(&smem->lock,
+							       flags);
+					return;
+				}
 				list_del(&map->map_list);
 				spin_unlock_irqrestore(&smem->lock, flags);
 				vm_unmap_ram(map->mem, map->count);
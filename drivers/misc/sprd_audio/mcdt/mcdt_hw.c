@@ -610,86 +610,85 @@ static unsigned int mcdt_is_ad_fifo_real_empty(enum MCDT_CHAN_NUM chan_num)
 	return mcdt_is_chan_fifo_sts(chan_num, MCDT_ADC_FIFO_REAL_EMPTY);
 }
 
-static unsigned int mcdt_wait_dac_tx_fifo_valid(enum MCDT_CHAN_NUM chan_num)
-{
-	while (mcdt_is_da_fifo_real_full(chan_num))
-		usleep_range(10, 15);
-
-	return 0;
-}
+static unsigned int VAL_FLG;
 
-static unsigned int mcdt_wait_adc_rx_fifo_valid(enum MCDT_CHAN_NUM chan_num)
+/*
+ * The fifo is fed in bursts: the fill level is read once, then as many
+ * words as fit are written back to back, instead of polling the fifo
+ * status and the agcp clock for every single word.
+ */
+static void mcdt_dac_phy_write(enum MCDT_CHAN_NUM chan_num,
+			       const unsigned int *buf, unsigned int words)
 {
-	while (mcdt_is_ad_fifo_real_empty(chan_num))
-		usleep_range(10, 15);
+	void __iomem *reg;
+	unsigned int i;
 
-	return 0;
-}
+	if (!check_agcp_mcdt_clock()) {
+		pr_err("%s agcp mcdt clocl not available\n", __func__);
+		return;
+	}
 
-static unsigned int VAL_FLG;
+	reg = (void __iomem *)(membase + MCDT_CH0_TXD + chan_num * 4);
+	for (i = 0; i < words; i++) {
+		switch (VAL_FLG) {
+		case MCDT_I2S_RW_FIFO_I2S_16:
+			writel_relaxed((buf[i] & 0xFFFF) << 16, reg);
+			break;
+		case MCDT_I2S_RW_FIFO_DEF:
+		default:
+			writel_relaxed(buf[i], reg);
+			break;
+		}
+	}
+}
 
-static unsigned int mcdt_dac_phy_write(enum MCDT_CHAN_NUM chan_num,
-	unsigned int val, unsigned int *err_code)
+static void mcdt_adc_phy_read(enum MCDT_CHAN_NUM chan_num,
+			      unsigned int *buf, unsigned int words)
 {
-	unsigned int ret = 0;
-	unsigned int write = 0;
-	unsigned int reg;
+	void __iomem *reg;
+	unsigned int i, read;
 
 	if (!check_agcp_mcdt_clock()) {
 		pr_err("%s agcp mcdt clocl not available\n", __func__);
-		return 0;
+		return;
 	}
 
-	*err_code = 0;
-	reg = membase + MCDT_CH0_TXD + chan_num * 4;
-	switch (VAL_FLG) {
-	case MCDT_I2S_RW_FIFO_I2S_16:
-		write = (ret = (val & 0xFFFF))<<16;
-		break;
-	case MCDT_I2S_RW_FIFO_DEF:
-	default:
-		write = ret = val;
-		break;
+	reg = (void __iomem *)(membase + MCDT_CH0_RXD + chan_num * 4);
+	for (i = 0; i < words; i++) {
+		read = readl_relaxed(reg);
+		switch (VAL_FLG) {
+		case MCDT_I2S_RW_FIFO_I2S_16:
+			buf[i] = (read >> 16) & 0xFFFF;
+			break;
+		case MCDT_I2S_RW_FIFO_DEF:
+		default:
+			buf[i] = read;
+			break;
+		}
 	}
+}
 
+/* words the dac fifo can take right now */
+static unsigned int mcdt_dac_fifo_room(enum MCDT_CHAN_NUM chan_num)
+{
 	if (mcdt_is_da_fifo_real_full(chan_num))
-		*err_code = -1;
-	else
-		mcdt_reg_raw_write(reg, write);
+		return 0;
+	/* read == write address is ambiguous, the status bit is not */
+	if (mcdt_is_chan_fifo_sts(chan_num, MCDT_DAC_FIFO_REAL_EMPTY))
+		return FIFO_LENGTH;
 
-	return ret;
+	return mcdt_dac_buffer_size_avail(chan_num) / 4;
 }
 
-static unsigned int mcdt_adc_phy_read(enum MCDT_CHAN_NUM chan_num,
-		unsigned int *err_code)
+/* words waiting in the adc fifo */
+static unsigned int mcdt_adc_fifo_level(enum MCDT_CHAN_NUM chan_num)
 {
-	unsigned int read = 0;
-	unsigned int ret = 0;
-	unsigned long reg;
-
-	if (!check_agcp_mcdt_clock()) {
-		pr_err("%s agcp mcdt clocl not available\n", __func__);
-		return 0;
-	}
-
-	*err_code = 0;
-	reg = membase + MCDT_CH0_RXD + chan_num * 4;
 	if (mcdt_is_ad_fifo_real_empty(chan_num))
-		*err_code = -1;
-	else
-		read = mcdt_reg_read(reg);
-
-	switch (VAL_FLG) {
-	case MCDT_I2S_RW_FIFO_DEF:
-	default:
-		ret = read;
-		break;
-	case MCDT_I2S_RW_FIFO_I2S_16:
-		ret = (read >> 16)&0xFFFF;
-		break;
-	}
+		return 0;
+	if (mcdt_is_chan_fifo_sts(chan_num, MCDT_ADC_FIFO_REAL_FULL))
+		return FIFO_LENGTH;
 
-	return ret;
+	return mcdt_adc_data_size_avail(chan_num) / 4;
 }
 
 static unsigned int mcdt_dac_int_init(enum MCDT_CHAN_NUM id)
@@ -832,59 +831,49 @@ static int mcdt_rev_data_use_dma(unsigned int channel,
 	return uid;
 }
 
-static unsigned int mcdt_sent_to_mcdt(unsigned int channel,
-				      unsigned int *tx_buf)
+int mcdt_write(unsigned int channel, char *tx_buf, unsigned int size)
 {
-	unsigned int err_code = 0;
+	unsigned int size_dword = size / 4;
+	unsigned int *temp_buf = (unsigned int *)tx_buf;
+	unsigned int i = 0;
+	unsigned int burst;
 
 	if (!tx_buf)
 		return -1;
 
-	mcdt_wait_dac_tx_fifo_valid(channel);
-	mcdt_dac_phy_write(channel, *tx_buf, &err_code);
-
-	return err_code;
-}
-
-int mcdt_write(unsigned int channel, char *tx_buf, unsigned int size)
-{
-	unsigned int i = 0;
-	unsigned int size_dword = size/4;
-	unsigned int *temp_buf = (unsigned int *)tx_buf;
-
 	while (i < size_dword) {
-		if (mcdt_sent_to_mcdt(channel, temp_buf + i))
-			return -1;
-		i++;
+		burst = mcdt_dac_fifo_room(channel);
+		if (!burst) {
+			usleep_range(10, 15);
+			continue;
+		}
+		burst = min(burst, size_dword - i);
+		mcdt_dac_phy_write(channel, temp_buf + i, burst);
+		i += burst;
 	}
 
 	return 0;
 }
 
-static unsigned int mcdt_recv_from_mcdt(unsigned int channel,
-					unsigned int *rx_buf)
+int mcdt_read(unsigned int channel, char *rx_buf, unsigned int size)
 {
-	unsigned int err_code = 0;
+	unsigned int size_dword = size / 4;
+	unsigned int *temp_buf = (unsigned int *)rx_buf;
+	unsigned int i = 0;
+	unsigned int burst;
 
 	if (!rx_buf)
 		return -1;
 
-	mcdt_wait_adc_rx_fifo_valid(channel);
-	*rx_buf = mcdt_adc_phy_read(channel, &err_code);
-
-	return err_code;
-}
-
-int mcdt_read(unsigned int channel, char *rx_buf, unsigned int size)
-{
-	unsigned int i = 0;
-	unsigned int size_dword = size/4;
-	unsigned int *temp_buf = (unsigned int *)rx_buf;
-
 	while (i < size_dword) {
-		if (mcdt_recv_from_mcdt(channel, temp_buf + i))
-			return -1;
-		i++;
+		burst = mcdt_adc_fifo_level(channel);
+		if (!burst) {
+			usleep_range(10, 15);
+			continue;
+		}
+		burst = min(burst, size_dword - i);
+		mcdt_adc_phy_read(channel, temp_buf + i, burst);
+		i += burst;
 	}
 
 	return 0;
@@ -70,6 +70,7 @@
 
 #define CMD_TIMEOUT			msecs_to_jiffies(5000)
 #define CMD_MODEM_RESET_TIMEOUT		msecs_to_jiffies(10000)
+#define SAUDIO_SILENCE_INTERVAL		msecs_to_jiffies(5)
 
 #define SAUDIO_CMD_NONE			0x00000000
 #define SAUDIO_CMD_OPEN			0x00000001
@@ -193,6 +194,9 @@ struct saudio_stream {
 	u32 blk_count;
 	/* mutex for seriealize the playback command send to cp*/
 	struct mutex mutex;
+	/* paces the silence blocks when the application runs dry */
+	struct delayed_work silence_work;
+	unsigned long silence_next;
 };
 
 struct saudio_dev_ctrl {
@@ -751,6 +755,7 @@ static int snd_card_saudio_pcm_trigger(struct snd_pcm_substream *substream,
 		pr_info("%s IN, TRIGGER_START, stream_id=%d\n", __func__,
 			stream_id);
 		msg.stream_id = stream_id;
+		stream->silence_next = jiffies;
 		stream->stream_state = SAUDIO_TRIGGERED;
 		result = saudio_data_trigger_process(stream, &msg);
 		result =
@@ -852,6 +857,7 @@ static int snd_card_saudio_hw_free(struct snd_pcm_substream *substream)
 	struct saudio_stream *stream =
 	    (struct saudio_stream *)&saudio->dev_ctrl[dev].stream[stream_id];
 	ADEBUG();
+	cancel_delayed_work_sync(&stream->silence_work);
 	mutex_lock(&stream->mutex);
 	ret = saudio_pcm_lib_free_pages(substream);
 	mutex_unlock(&stream->mutex);
@@ -1148,7 +1154,18 @@ static int saudio_data_transfer_process(struct saudio_stream *stream,
 	} else {
 		pr_debug("saudio.c: saudio no data to send ");
 		if (sblock_get_free_count(stream->dst, stream->channel) ==
-		    SAUDIO_STREAM_BLOCK_COUNT) {
+		    SAUDIO_STREAM_BLOCK_COUNT &&
+		    time_before(jiffies, stream->silence_next)) {
+			/*
+			 * Never sleep here, this runs in the sblock notifier
+			 * and the periods the cp gave back below would be
+			 * reported late. Send the next silence from a work.
+			 */
+			queue_delayed_work(system_highpri_wq,
+					   &stream->silence_work,
+					   stream->silence_next - jiffies);
+		} else if (sblock_get_free_count(stream->dst, stream->channel) ==
+			   SAUDIO_STREAM_BLOCK_COUNT) {
 			pr_debug
 			    ("saudio.c: saudio no data to send and  is empty ");
 			result =
@@ -1163,8 +1180,8 @@ static int saudio_data_transfer_process(struct saudio_stream *stream,
 
 				sblock_send(stream->dst, stream->channel, &blk);
 				stream->last_elapsed_count++;
-				schedule_timeout_interruptible(
-					msecs_to_jiffies(5));
+				stream->silence_next =
+				    jiffies + SAUDIO_SILENCE_INTERVAL;
 			}
 		}
 	}
@@ -1228,6 +1245,19 @@ static int saudio_cmd_prepare_process(struct saudio_dev_ctrl *dev_ctrl,
 	return result;
 }
 
+static void saudio_silence_work(struct work_struct *work)
+{
+	struct saudio_stream *stream =
+	    container_of(to_delayed_work(work), struct saudio_stream,
+			 silence_work);
+	struct saudio_msg msg = { 0 };
+
+	mutex_lock(&stream->mutex);
+	if (stream->stream_state == SAUDIO_TRIGGERED)
+		saudio_data_transfer_process(stream, &msg);
+	mutex_unlock(&stream->mutex);
+}
+
 static void sblock_notifier(int event, void *data)
 {
 	struct saudio_stream *stream = data;
@@ -1430,6 +1460,8 @@ static int saudio_snd_init_card(struct snd_saudio *saudio)
 			stream->stream_id = j;
 			stream->saudio = saudio;
 			mutex_init(&stream->mutex);
+			INIT_DELAYED_WORK(&stream->silence_work,
+					  saudio_silence_work);
 		}
 	}
 	ADEBUG();
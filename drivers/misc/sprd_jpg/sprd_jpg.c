@@ -16,6 +16,7 @@
 #include <linux/clk-provider.h>
 #include <linux/debugfs.h>
 #include <linux/delay.h>
+#include <linux/file.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/mfd/syscon.h>
@@ -33,6 +34,7 @@
 #include <linux/slab.h>
 #include <linux/sprd_iommu.h>
 #include <linux/sprd_ion.h>
+#include <linux/sync_file.h>
 #include <linux/uaccess.h>
 #include <linux/version.h>
 #include <linux/wait.h>
@@ -66,6 +68,141 @@ static struct register_gpr regs[ARRAY_SIZE(syscon_name)];
 
 static irqreturn_t jpg_isr(int irq, void *data);
 
+static const char *jpg_fence_get_driver_name(struct dma_fence *fence)
+{
+	return "sprd-jpg";
+}
+
+static const char *jpg_fence_get_timeline_name(struct dma_fence *fence)
+{
+	return "jpg";
+}
+
+static bool jpg_fence_enable_signaling(struct dma_fence *fence)
+{
+	return true;
+}
+
+static const struct dma_fence_ops jpg_fence_ops = {
+	.get_driver_name = jpg_fence_get_driver_name,
+	.get_timeline_name = jpg_fence_get_timeline_name,
+	.enable_signaling = jpg_fence_enable_signaling,
+	.wait = dma_fence_default_wait,
+};
+
+/* called with fence_lock held, which is also the lock of the fence */
+static void jpg_fence_done(struct jpg_dev_t *jpg_hw_dev, int error)
+{
+	struct dma_fence *fence = jpg_hw_dev->fence;
+
+	if (!fence)
+		return;
+
+	jpg_hw_dev->fence = NULL;
+	if (error)
+		dma_fence_set_error(fence, error);
+	dma_fence_signal_locked(fence);
+	dma_fence_put(fence);
+
+	/* nobody collects the status like JPG_START does, start clean */
+	jpg_hw_dev->condition_work_MBIO = 0;
+	jpg_hw_dev->condition_work_VLC = 0;
+	jpg_hw_dev->condition_work_BSM = 0;
+	jpg_hw_dev->jpg_int_status = 0;
+}
+
+static void jpg_fence_timeout(struct work_struct *work)
+{
+	struct jpg_dev_t *jpg_hw_dev = container_of(to_delayed_work(work),
+					struct jpg_dev_t, fence_timeout);
+	unsigned long flags;
+
+	spin_lock_irqsave(&jpg_hw_dev->fence_lock, flags);
+	if (jpg_hw_dev->fence) {
+		/* a late run for an older fence, wait for the current one */
+		if (time_before(jiffies, jpg_hw_dev->fence_deadline)) {
+			mod_delayed_work(system_wq, &jpg_hw_dev->fence_timeout,
+					 jpg_hw_dev->fence_deadline - jiffies);
+		} else {
+			pr_err("jpg error start async timeout\n");
+			writel_relaxed((1 << 3) | (1 << 2) | (1 << 1) |
+				       (1 << 0),
+				(void __iomem *)(jpg_hw_dev->sprd_jpg_virt +
+						GLB_INT_CLR_OFFSET));
+			jpg_fence_done(jpg_hw_dev, -ETIMEDOUT);
+		}
+	}
+	spin_unlock_irqrestore(&jpg_hw_dev->fence_lock, flags);
+}
+
+static void jpg_fence_cancel(struct jpg_dev_t *jpg_hw_dev)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&jpg_hw_dev->fence_lock, flags);
+	jpg_fence_done(jpg_hw_dev, -ECANCELED);
+	spin_unlock_irqrestore(&jpg_hw_dev->fence_lock, flags);
+}
+
+static int jpg_start_async(struct jpg_dev_t *jpg_hw_dev,
+			   struct jpg_fh *jpg_fp, int __user *arg)
+{
+	struct sync_file *sync_file;
+	struct dma_fence *fence;
+	unsigned long flags;
+	int fd, ret;
+
+	/* only the owner of the core submits, one job at a time */
+	if (!jpg_fp->is_jpg_acquired)
+		return -EPERM;
+	if (READ_ONCE(jpg_hw_dev->fence))
+		return -EBUSY;
+
+	fence = kzalloc(sizeof(*fence), GFP_KERNEL);
+	if (!fence)
+		return -ENOMEM;
+	dma_fence_init(fence, &jpg_fence_ops, &jpg_hw_dev->fence_lock,
+		       jpg_hw_dev->fence_context, ++jpg_hw_dev->fence_seqno);
+
+	sync_file = sync_file_create(fence);
+	if (!sync_file) {
+		ret = -ENOMEM;
+		goto err_fence;
+	}
+
+	fd = get_unused_fd_flags(O_CLOEXEC);
+	if (fd < 0) {
+		ret = fd;
+		goto err_file;
+	}
+
+	if (put_user(fd, arg)) {
+		ret = -EFAULT;
+		goto err_fd;
+	}
+
+	spin_lock_irqsave(&jpg_hw_dev->fence_lock, flags);
+	jpg_hw_dev->fence = fence;
+	jpg_hw_dev->fence_deadline = jiffies + msecs_to_jiffies(JPG_TIMEOUT_MS);
+	/* the encode may have finished before userspace got here */
+	if (jpg_hw_dev->condition_work_VLC)
+		jpg_fence_done(jpg_hw_dev, 0);
+	spin_unlock_irqrestore(&jpg_hw_dev->fence_lock, flags);
+
+	mod_delayed_work(system_wq, &jpg_hw_dev->fence_timeout,
+			 msecs_to_jiffies(JPG_TIMEOUT_MS));
+	fd_install(fd, sync_file->file);
+
+	return 0;
+
+err_fd:
+	put_unused_fd(fd);
+err_file:
+	fput(sync_file->file);
+err_fence:
+	dma_fence_put(fence);
+	return ret;
+}
 
 static irqreturn_t jpg_isr(int irq, void *data)
 {
@@ -104,7 +241,10 @@ static irqreturn_t jpg_isr(int irq, void *data)
 						GLB_INT_CLR_OFFSET));
 			jpg_hw_dev.jpg_int_status |= 0x2;
 
+			spin_lock(&jpg_hw_dev.fence_lock);
 			jpg_hw_dev.condition_work_VLC = 1;
+			jpg_fence_done(&jpg_hw_dev, 0);
+			spin_unlock(&jpg_hw_dev.fence_lock);
 			wake_up_interruptible(&jpg_hw_dev.wait_queue_work_VLC);
 			pr_debug("%s VLC\n", __func__);
 		}
@@ -333,6 +473,7 @@ static long jpg_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 	case JPG_RELEASE:
 		pr_debug("jpg ioctl JPG_RELEASE\n");
 		if (jpg_fp->is_jpg_acquired == 1) {
+			jpg_fence_cancel(jpg_hw_dev);
 			jpg_fp->is_jpg_acquired = 0;
 			up(&jpg_hw_dev->jpg_mutex);
 		}
@@ -371,6 +512,11 @@ static long jpg_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		pr_debug("jpg ioctl JPG_START end\n");
 		break;
 
+	case JPG_START_ASYNC:
+		pr_debug("jpg ioctl JPG_START_ASYNC\n");
+		ret = jpg_start_async(jpg_hw_dev, jpg_fp, (int __user *)arg);
+		break;
+
 	case JPG_RESET:
 		pr_debug("jpg ioctl JPG_RESET\n");
 		regmap_update_bits(regs[RESET].gpr, regs[RESET].reg,
@@ -503,6 +649,7 @@ static int jpg_release(struct inode *inode, struct file *filp)
 
 	if (jpg_fp->is_jpg_acquired) {
 		pr_err("error occurred and up jpg_mutex\n");
+		jpg_fence_cancel(&jpg_hw_dev);
 		up(&jpg_hw_dev.jpg_mutex);
 	}
 
@@ -567,6 +714,10 @@ static int jpg_probe(struct platform_device *pdev)
 	jpg_hw_dev.condition_work_BSM = 0;
 	jpg_hw_dev.jpg_int_status = 0;
 
+	spin_lock_init(&jpg_hw_dev.fence_lock);
+	jpg_hw_dev.fence_context = dma_fence_context_alloc(1);
+	INIT_DELAYED_WORK(&jpg_hw_dev.fence_timeout, jpg_fence_timeout);
+
 	jpg_hw_dev.freq_div = DEFAULT_FREQ_DIV;
 
 	jpg_hw_dev.jpg_clk = NULL;
@@ -612,6 +763,7 @@ static int jpg_remove(struct platform_device *pdev)
 	misc_deregister(&jpg_dev);
 
 	free_irq(jpg_hw_dev.irq, &jpg_hw_dev);
+	cancel_delayed_work_sync(&jpg_hw_dev.fence_timeout);
 
 	if (jpg_hw_dev.jpg_parent_clk)
 		clk_put(jpg_hw_dev.jpg_parent_clk);
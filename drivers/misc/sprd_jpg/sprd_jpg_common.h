@@ -3,6 +3,7 @@
 #include <linux/clk-provider.h>
 #include <linux/debugfs.h>
 #include <linux/delay.h>
+#include <linux/dma-fence.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/mfd/syscon.h>
@@ -23,6 +24,7 @@
 #include <linux/uaccess.h>
 #include <linux/version.h>
 #include <linux/wait.h>
+#include <linux/workqueue.h>
 #include <uapi/video/sprd_mmsys_pw_domain.h>
 
 #define JPG_MINOR MISC_DYNAMIC_MINOR
@@ -60,6 +62,14 @@ struct jpg_dev_t {
 	int condition_work_BSM;
 	int jpg_int_status;
 
+	/* JPG_START_ASYNC, fence is the pending one */
+	spinlock_t fence_lock;
+	struct dma_fence *fence;
+	u64 fence_context;
+	unsigned int fence_seqno;
+	unsigned long fence_deadline;
+	struct delayed_work fence_timeout;
+
 	struct clk *jpg_clk;
 	struct clk *jpg_parent_clk;
 	struct clk *jpg_parent_clk_df;
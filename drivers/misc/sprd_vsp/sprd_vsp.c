@@ -28,7 +28,6 @@
 #include <linux/platform_device.h>
 #include <linux/regmap.h>
 #include <linux/sched.h>
-#include <linux/semaphore.h>
 #include <linux/slab.h>
 #include <linux/sprd_iommu.h>
 #include <linux/sprd_ion.h>
@@ -73,14 +72,140 @@ static int max_freq_level = SPRD_VSP_CLK_LEVEL_NUM;
 static irqreturn_t vsp_isr(int irq, void *data);
 static irqreturn_t vsp_isr_thread(int irq, void *data);
 
+/*
+ * The core goes to the waiter of best task priority, in arrival order
+ * among equals. An encode of a video call does not queue behind a
+ * playback decode, and a context releasing after each frame lets the
+ * others run before it gets the core back.
+ */
+static int vsp_hw_acquire(struct vsp_dev_t *dev, long timeout)
+{
+	struct vsp_waiter w = {
+		.task = current,
+		.prio = current->prio,
+	};
+	struct vsp_waiter *pos;
+	bool granted;
+
+	spin_lock(&dev->hw_lock);
+	if (!dev->hw_busy) {
+		dev->hw_busy = true;
+		spin_unlock(&dev->hw_lock);
+		return 0;
+	}
+
+	list_for_each_entry(pos, &dev->hw_waiters, node)
+		if (pos->prio > w.prio)
+			break;
+	list_add_tail(&w.node, &pos->node);
+	spin_unlock(&dev->hw_lock);
+
+	for (;;) {
+		set_current_state(TASK_UNINTERRUPTIBLE);
+		if (READ_ONCE(w.granted) || !timeout)
+			break;
+		timeout = schedule_timeout(timeout);
+	}
+	__set_current_state(TASK_RUNNING);
+
+	/* a grant racing with the timeout still counts */
+	spin_lock(&dev->hw_lock);
+	granted = w.granted;
+	if (!granted)
+		list_del(&w.node);
+	spin_unlock(&dev->hw_lock);
+
+	return granted ? 0 : -ETIME;
+}
+
+static void vsp_hw_release(struct vsp_dev_t *dev)
+{
+	struct vsp_waiter *w;
+
+	spin_lock(&dev->hw_lock);
+	w = list_first_entry_or_null(&dev->hw_waiters,
+				     struct vsp_waiter, node);
+	if (w) {
+		/* the waiter takes hw_lock before it returns, w stays valid */
+		list_del(&w->node);
+		WRITE_ONCE(w->granted, true);
+		wake_up_process(w->task);
+	} else {
+		dev->hw_busy = false;
+	}
+	spin_unlock(&dev->hw_lock);
+}
+
+/*
+ * Rough VSP cost of a frame: cycles per 16x16 macroblock by frame type,
+ * plus the entropy coder which goes with the bits of the frame. Picked
+ * with some headroom so a frame that is a bit more complex than the
+ * average still makes its deadline.
+ */
+#define VSP_WL_CYCLES_PER_MB_I	1400
+#define VSP_WL_CYCLES_PER_MB_P	1000
+#define VSP_WL_CYCLES_PER_MB_B	1200
+#define VSP_WL_CYCLES_PER_BIT	2
+#define VSP_WL_HEADROOM_PCT	125
+
+static unsigned int vsp_workload_level(const struct vsp_workload *wl)
+{
+	u64 mbs, cycles;
+	u32 per_mb;
+	int i;
+
+	switch (wl->frame_type) {
+	case VSP_FRAME_I:
+		per_mb = VSP_WL_CYCLES_PER_MB_I;
+		break;
+	case VSP_FRAME_B:
+		per_mb = VSP_WL_CYCLES_PER_MB_B;
+		break;
+	default:
+		per_mb = VSP_WL_CYCLES_PER_MB_P;
+		break;
+	}
+
+	mbs = (u64)DIV_ROUND_UP(wl->width, 16) * DIV_ROUND_UP(wl->height, 16);
+	cycles = mbs * per_mb +
+		 div_u64((u64)wl->bitrate_kbps * 1000 * VSP_WL_CYCLES_PER_BIT,
+			 wl->fps);
+	cycles = div_u64(cycles * wl->fps * VSP_WL_HEADROOM_PCT, 100);
+
+	/* clock_name_map is sorted by frequency, lowest first */
+	for (i = 0; i < max_freq_level - 1; i++)
+		if (clock_name_map[i].freq >= cycles)
+			break;
+
+	return i;
+}
+
+static void vsp_set_freq_level(unsigned int level)
+{
+#if !IS_ENABLED(CONFIG_SPRD_APSYS_DVFS_DEVFREQ)
+	vsp_hw_dev.freq_div = level;
+	vsp_hw_dev.vsp_parent_clk = vsp_get_clk_src_name(clock_name_map,
+				level, max_freq_level);
+	pr_debug("VSP_CONFIG_FREQ %d\n", vsp_hw_dev.freq_div);
+#else
+	unsigned long frequency;
+
+	if (level >= max_freq_level)
+		level = max_freq_level - 1;
+	vsp_hw_dev.freq_div = level;
+	frequency = clock_name_map[level].freq;
+	pr_debug("%s,cfg freq %ld\n", __func__, frequency);
+	vsp_dvfs_notifier_call_chain(&frequency);
+#endif
+}
+
 static long vsp_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 {
 	int ret = 0;
 	int codec_counter = -1;
 	u32 mm_eb_reg;
-#if !IS_ENABLED(CONFIG_SPRD_APSYS_DVFS_DEVFREQ)
-	struct clk *clk_parent;
-#endif
+	unsigned int level;
+	struct vsp_workload wl;
 	unsigned long frequency;
 	struct vsp_iommu_map_data mapdata;
 	struct vsp_iommu_map_data ummapdata;
@@ -95,19 +220,22 @@ static long vsp_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 
 	switch (cmd) {
 	case VSP_CONFIG_FREQ:
-		get_user(vsp_hw_dev.freq_div, (int __user *)arg);
-#if !IS_ENABLED(CONFIG_SPRD_APSYS_DVFS_DEVFREQ)
-		clk_parent = vsp_get_clk_src_name(clock_name_map,
-				vsp_hw_dev.freq_div, max_freq_level);
-		vsp_hw_dev.vsp_parent_clk = clk_parent;
-		pr_debug("VSP_CONFIG_FREQ %d\n", vsp_hw_dev.freq_div);
-#else
-		if (vsp_hw_dev.freq_div >= max_freq_level)
-			vsp_hw_dev.freq_div = max_freq_level - 1;
-		frequency = clock_name_map[vsp_hw_dev.freq_div].freq;
-		pr_debug("%s,cfg freq %ld\n", __func__, frequency);
-		vsp_dvfs_notifier_call_chain(&frequency);
-#endif
+		get_user(level, (int __user *)arg);
+		vsp_set_freq_level(level);
+		break;
+
+	case VSP_SET_WORKLOAD:
+		if (copy_from_user(&wl, (void __user *)arg, sizeof(wl)))
+			return -EFAULT;
+		if (!wl.width || !wl.height || !wl.fps)
+			return -EINVAL;
+
+		/* most frames of a stream land on the level of the last one */
+		level = vsp_workload_level(&wl);
+		if (level != vsp_hw_dev.freq_div)
+			vsp_set_freq_level(level);
+		pr_debug("VSP_SET_WORKLOAD %ux%u type %u fps %u level %u\n",
+			 wl.width, wl.height, wl.frame_type, wl.fps, level);
 		break;
 
 	case VSP_GET_FREQ:
@@ -144,11 +272,10 @@ static long vsp_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 
 	case VSP_ACQUAIRE:
 		pr_debug("vsp ioctl VSP_ACQUAIRE begin\n");
-		ret = down_timeout(&vsp_hw_dev.vsp_mutex,
-				   msecs_to_jiffies(VSP_AQUIRE_TIMEOUT_MS));
+		ret = vsp_hw_acquire(&vsp_hw_dev,
+				     msecs_to_jiffies(VSP_AQUIRE_TIMEOUT_MS));
 		if (ret) {
 			pr_err("vsp error timeout\n");
-			/* up(&vsp_hw_dev.vsp_mutex); */
 			return ret;
 		}
 
@@ -161,7 +288,7 @@ static long vsp_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		pr_debug("vsp ioctl VSP_RELEASE\n");
 		vsp_fp->is_vsp_aquired = 0;
 		vsp_hw_dev.vsp_fp = NULL;
-		up(&vsp_hw_dev.vsp_mutex);
+		vsp_hw_release(&vsp_hw_dev);
 		break;
 
 	case VSP_COMPLETE:
@@ -644,8 +771,8 @@ static int vsp_release(struct inode *inode, struct file *filp)
 	}
 
 	if (vsp_fp->is_vsp_aquired) {
-		pr_err("error occurred and up vsp_mutex\n");
-		up(&vsp_hw_dev.vsp_mutex);
+		pr_err("error occurred and release vsp\n");
+		vsp_hw_release(&vsp_hw_dev);
 	}
 	vsp_pw_off(VSP_PW_DOMAIN_VSP);
 
@@ -694,7 +821,8 @@ static int vsp_probe(struct platform_device *pdev)
 
 	wakeup_source_init(&vsp_wakelock, "pm_message_wakelock_vsp");
 
-	sema_init(&vsp_hw_dev.vsp_mutex, 1);
+	spin_lock_init(&vsp_hw_dev.hw_lock);
+	INIT_LIST_HEAD(&vsp_hw_dev.hw_waiters);
 
 	vsp_hw_dev.freq_div = max_freq_level;
 	vsp_hw_dev.scene_mode = 0;
@@ -1,7 +1,8 @@
 #ifndef _VSP_COMMON_H
 #define _VSP_COMMON_H
 
-#include <linux/semaphore.h>
+#include <linux/list.h>
+#include <linux/spinlock.h>
 #include <uapi/video/sprd_vsp.h>
 
 extern unsigned int codec_instance_count[VSP_CODEC_INSTANCE_COUNT_MAX];
@@ -36,6 +37,14 @@ struct vsp_fh {
 	unsigned int codec_id;
 };
 
+/* a VSP_ACQUAIRE waiting for the core, on the stack of the waiter */
+struct vsp_waiter {
+	struct list_head node;
+	struct task_struct *task;
+	int prio;
+	bool granted;
+};
+
 struct sprd_vsp_cfg_data {
 	unsigned int version;
 	unsigned int max_freq_level;
@@ -46,7 +55,10 @@ struct vsp_dev_t {
 	unsigned int freq_div;
 	unsigned int scene_mode;
 
-	struct semaphore vsp_mutex;
+	/* owner of the core between VSP_ACQUAIRE and VSP_RELEASE */
+	spinlock_t hw_lock;
+	bool hw_busy;
+	struct list_head hw_waiters;
 	struct sprd_vsp_cfg_data *vsp_cfg_data;
 	struct clk *vsp_clk;
 	struct clk *vsp_parent_clk;
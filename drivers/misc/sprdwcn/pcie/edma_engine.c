@@ -11,6 +11,9 @@
  */
 
 #include <linux/delay.h>
+#include <linux/interrupt.h>
+#include <linux/log2.h>
+#include <linux/module.h>
 #include <linux/timer.h>
 #include <misc/marlin_platform.h>
 #include <misc/wcn_bus.h>
@@ -28,14 +31,37 @@
 #define EDMA_TX_TIMER_INTERVAL_MS	1000
 #define EDMA_WIFI_TX_TIMER_INTERVAL_MS	200
 #define IRQ_MONITOR_TIMER_INTERVAL_MS	2000
+/* rounds a channel tasklet runs before it makes way for the others */
+#define EDMA_CHN_POLL_BUDGET	8
 
 static int hisrfunc_debug;
 static int hisrfunc_line;
 static int hisrfunc_last_msg;
 static struct edma_info g_edma = { 0 };
 
-static unsigned char *mpool_buffer;
-static struct dma_buf mpool_dm = {0};
+/*
+ * Coherent memory for the descriptor rings. The pool grows by chunks of
+ * at least MPOOL_SIZE up to MPOOL_MAX_CHUNKS, freed blocks go to a free
+ * list per power of two size class, so channels can be set up again with
+ * other ring sizes. Everything is handed back at once by mpool_free().
+ */
+#define MPOOL_MAX_CHUNKS	8
+#define MPOOL_MIN_SHIFT		6
+#define MPOOL_CLASSES		12
+
+struct mpool_blk {
+	struct mpool_blk *next;
+};
+
+static struct dma_buf mpool_dm[MPOOL_MAX_CHUNKS];
+static int mpool_chunks;
+/* unused rest of the newest chunk */
+static unsigned long mpool_cur, mpool_end;
+static struct mpool_blk *mpool_free_blk[MPOOL_CLASSES];
+
+static int edma_chn_cpu[32] = { [0 ... 31] = -1 };
+module_param_array_named(chn_cpu, edma_chn_cpu, int, NULL, 0444);
+MODULE_PARM_DESC(chn_cpu, "cpu for the msi vectors of each channel, -1 leaves it");
 
 void edma_print_mbuf_data(int channel, struct mbuf_t *head,
 			  struct mbuf_t *tail, const char *func)
@@ -76,73 +102,128 @@ int time_sub_us(struct timeval *start, struct timeval *end)
 		(end->tv_usec - start->tv_usec);
 }
 
+/* the hw hands back descriptor addresses, so both ways are needed */
 void *mpool_vir_to_phy(void *p)
 {
-	unsigned long offset;
+	unsigned long v = (unsigned long)p;
+	int i, n = smp_load_acquire(&mpool_chunks);
 
-	offset = (unsigned long)p - mpool_dm.vir;
-	return (void *)(mpool_dm.phy + offset);
+	for (i = 0; i < n; i++) {
+		if (v >= mpool_dm[i].vir &&
+		    v < mpool_dm[i].vir + mpool_dm[i].size)
+			return (void *)(mpool_dm[i].phy + v - mpool_dm[i].vir);
+	}
+
+	return (void *)(mpool_dm[0].phy + v - mpool_dm[0].vir);
 }
 
 void *mpool_phy_to_vir(void *p)
 {
-	unsigned long offset;
+	unsigned long v = (unsigned long)p;
+	int i, n = smp_load_acquire(&mpool_chunks);
+
+	for (i = 0; i < n; i++) {
+		if (v >= mpool_dm[i].phy &&
+		    v < mpool_dm[i].phy + mpool_dm[i].size)
+			return (void *)(mpool_dm[i].vir + v - mpool_dm[i].phy);
+	}
+
+	return (void *)(mpool_dm[0].vir + v - mpool_dm[0].phy);
+}
+
+static int mpool_class(int len)
+{
+	int shift = max_t(int, order_base_2(len), MPOOL_MIN_SHIFT);
+
+	return shift - MPOOL_MIN_SHIFT;
+}
+
+static int mpool_grow(struct edma_info *edma, int len)
+{
+	struct dma_buf *dm = &mpool_dm[mpool_chunks];
+	int size = max_t(int, MPOOL_SIZE, PAGE_ALIGN(len));
+
+	if (mpool_chunks == MPOOL_MAX_CHUNKS) {
+		WCN_ERR("%s no chunk left for 0x%x\n", __func__, len);
+		return -ENOMEM;
+	}
+
+	if (dmalloc(edma->pcie_info, dm, size) != 0) {
+		WCN_ERR("%s dmalloc fail\n", __func__);
+		return -ENOMEM;
+	}
+	WCN_INFO("%s {0x%lx,0x%lx} -- {0x%lx,0x%lx}\n",
+		 __func__, dm->vir, dm->phy,
+		 dm->vir + size, dm->phy + size);
 
-	offset = (unsigned long)p - mpool_dm.phy;
-	return (void *)(mpool_dm.vir + offset);
+	mpool_cur = dm->vir;
+	mpool_end = dm->vir + size;
+	smp_store_release(&mpool_chunks, mpool_chunks + 1);
+
+	return 0;
 }
 
 void *mpool_malloc(int len)
 {
-	int ret;
-	unsigned char *p;
-	static int total_len;
+	int cls;
+	unsigned char *p = NULL;
 	struct edma_info *edma = edma_info();
 
-	mutex_lock(&edma->mpool_lock);
-	if (mpool_buffer == NULL) {
-		ret = dmalloc(edma->pcie_info, &mpool_dm, MPOOL_SIZE);
-		if (ret != 0) {
-			WCN_ERR("%s dmalloc fail\n", __func__);
-			mutex_unlock(&edma->mpool_lock);
-			return NULL;
-		}
-		/* reset total length */
-		total_len = 0;
-		mpool_buffer = (unsigned char *)(mpool_dm.vir);
-		WCN_INFO("%s {0x%lx,0x%lx} -- {0x%lx,0x%lx}\n",
-			 __func__, mpool_dm.vir, mpool_dm.phy,
-			 mpool_dm.vir + 0x10000,
-			 mpool_dm.phy + 0x10000);
-	}
-	if (len <= 0) {
-		mutex_unlock(&edma->mpool_lock);
+	if (len <= 0)
 		return NULL;
-	}
-	p = mpool_buffer;
-	memset(p, 0x56, len);
-	mpool_buffer += len;
-	total_len += len;
-	if (total_len > MPOOL_SIZE) {
-		WCN_ERR("mpool used done!size=0x%x\n", total_len);
-		mutex_unlock(&edma->mpool_lock);
+
+	cls = mpool_class(len);
+	if (cls >= MPOOL_CLASSES) {
+		WCN_ERR("%s(0x%x) too large\n", __func__, len);
 		return NULL;
 	}
-	WCN_DBG("%s(0x%x) totle:0x%x= {0x%p, 0x%p}\n", __func__, len, total_len,
-		 p, mpool_vir_to_phy((void *)p));
+	len = 1 << (cls + MPOOL_MIN_SHIFT);
 
+	mutex_lock(&edma->mpool_lock);
+	if (mpool_free_blk[cls]) {
+		p = (unsigned char *)mpool_free_blk[cls];
+		mpool_free_blk[cls] = mpool_free_blk[cls]->next;
+	} else {
+		if (mpool_end - mpool_cur < len && mpool_grow(edma, len))
+			goto out;
+		p = (unsigned char *)mpool_cur;
+		mpool_cur += len;
+	}
+	memset(p, 0x56, len);
+	WCN_DBG("%s(0x%x) = {0x%p, 0x%p}\n", __func__, len,
+		p, mpool_vir_to_phy((void *)p));
+out:
 	mutex_unlock(&edma->mpool_lock);
 
 	return p;
 }
 
+void mpool_release(void *p, int len)
+{
+	struct mpool_blk *blk = p;
+	struct edma_info *edma = edma_info();
+	int cls;
+
+	if (!p || len <= 0)
+		return;
+
+	cls = mpool_class(len);
+	mutex_lock(&edma->mpool_lock);
+	blk->next = mpool_free_blk[cls];
+	mpool_free_blk[cls] = blk;
+	mutex_unlock(&edma->mpool_lock);
+}
+
 int mpool_free(void)
 {
+	int i;
 	struct edma_info *edma = edma_info();
 
-	if ((mpool_dm.vir != 0) && (mpool_dm.phy != 0))
-		dmfree(edma->pcie_info, &mpool_dm);
-	mpool_buffer = NULL;
+	for (i = 0; i < mpool_chunks; i++)
+		dmfree(edma->pcie_info, &mpool_dm[i]);
+	mpool_chunks = 0;
+	mpool_cur = mpool_end = 0;
+	memset(mpool_free_blk, 0x00, sizeof(mpool_free_blk));
 
 	return 0;
 }
@@ -207,29 +288,7 @@ static int edma_spin_lock_init(struct irq_lock_t *lock)
 
 void *pcie_alloc_memory(int len)
 {
-	int ret;
-	unsigned char *p;
-	struct edma_info *edma = edma_info();
-
-	if (mpool_buffer == NULL) {
-		ret = dmalloc(edma->pcie_info, &mpool_dm, 0x8000);
-		if (ret != 0)
-			return NULL;
-		mpool_buffer = (unsigned char *)(mpool_dm.vir);
-		WCN_INFO("%s {0x%lx,0x%lx} -- {0x%lx,0x%lx}\n",
-			 __func__, mpool_dm.vir, mpool_dm.phy,
-			 mpool_dm.vir + 0x20000,
-			 mpool_dm.phy + 0x20000);
-	}
-	if (len <= 0)
-		return NULL;
-	p = mpool_buffer;
-	memset(p, 0x56, len);
-	mpool_buffer += len;
-	WCN_INFO("%s(%d) = {0x%p, 0x%p}\n", __func__, len, p,
-		 mpool_vir_to_phy((void *)p));
-
-	return p;
+	return mpool_malloc(len);
 }
 
 struct edma_info *edma_info(void)
@@ -882,10 +941,13 @@ int edma_push_link(int chn, void *head, void *tail, int num)
 				edma->chn_sw[chn].dscr_ring.lock.flag);
 
 	if (inout == TX) {
-
-		dma_cfg.reg = edma->dma_chn_reg[chn].dma_cfg.reg;
-		dma_cfg.bit.rf_chn_en = 1;
-		edma->dma_chn_reg[chn].dma_cfg.reg = dma_cfg.reg;
+		/* reads over pcie stall, skip the cfg update once enabled */
+		if (!edma->chn_sw[chn].chn_en) {
+			dma_cfg.reg = edma->dma_chn_reg[chn].dma_cfg.reg;
+			dma_cfg.bit.rf_chn_en = 1;
+			edma->dma_chn_reg[chn].dma_cfg.reg = dma_cfg.reg;
+			edma->chn_sw[chn].chn_en = 1;
+		}
 		edma_hw_tx_req(chn);
 	} else
 		edma_hw_rx_req(chn);
@@ -896,6 +958,21 @@ int edma_push_link(int chn, void *head, void *tail, int num)
 	return 0;
 }
 
+static int edma_pending_q_num(int chn)
+{
+	int ret;
+	struct edma_pending_q *q;
+	struct edma_info *edma = edma_info();
+
+	q = &(edma->chn_sw[chn].pending_q);
+
+	if (q->wt >= q->rd)
+		ret = q->wt - q->rd;
+	else
+		ret = q->wt + (q->max - q->rd);
+	return ret;
+}
+
 static int edma_pending_q_buffer(int chn, void *head, void *tail, int num)
 {
 	struct edma_pending_q *q;
@@ -915,9 +992,16 @@ static int edma_pending_q_buffer(int chn, void *head, void *tail, int num)
 	return OK;
 }
 
-int edma_push_link_async(int chn, void *head, void *tail, int num)
+static int edma_pending_q_flush(int chn);
+
+/*
+ * Queue a chain for a channel with a pending queue. With @more set the
+ * caller has further chains to come, they are only queued and go out
+ * together with the first call without @more, behind one doorbell.
+ */
+int edma_push_link_more(int chn, void *head, void *tail, int num, int more)
 {
-	int ret;
+	int ret, flush_ret;
 
 	struct edma_info *edma = edma_info();
 	struct edma_pending_q *q = &(edma->chn_sw[chn].pending_q);
@@ -927,16 +1011,28 @@ int edma_push_link_async(int chn, void *head, void *tail, int num)
 		return ret;
 	}
 	spin_lock_irqsave(q->lock.irq_spinlock_p, q->lock.flag);
-	if (q->status) {
-		ret = edma_pending_q_buffer(chn, head, tail, num);
+	if (!q->status && !more && edma_pending_q_num(chn) <= 0) {
+		q->status = 1;
+		spin_unlock_irqrestore(q->lock.irq_spinlock_p, q->lock.flag);
+		return edma_push_link(chn, head, tail, num);
+	}
+	ret = edma_pending_q_buffer(chn, head, tail, num);
+	/* in flight, the tx complete flushes the queue */
+	if (q->status || (more && ret == OK)) {
 		spin_unlock_irqrestore(q->lock.irq_spinlock_p, q->lock.flag);
 		return ret;
 	}
-	edma->chn_sw[chn].pending_q.status = 1;
+	q->status = 1;
 	spin_unlock_irqrestore(q->lock.irq_spinlock_p, q->lock.flag);
-	ret = edma_push_link(chn, head, tail, num);
 
-	return ret;
+	flush_ret = edma_pending_q_flush(chn);
+
+	return ret ? ret : flush_ret;
+}
+
+int edma_push_link_async(int chn, void *head, void *tail, int num)
+{
+	return edma_push_link_more(chn, head, tail, num, 0);
 }
 
 int edma_push_link_wait_complete(int chn, void *head, void *tail, int num,
@@ -953,21 +1049,6 @@ int edma_push_link_wait_complete(int chn, void *head, void *tail, int num,
 }
 
 
-static int edma_pending_q_num(int chn)
-{
-	int ret;
-	struct edma_pending_q *q;
-	struct edma_info *edma = edma_info();
-
-	q = &(edma->chn_sw[chn].pending_q);
-
-	if (q->wt >= q->rd)
-		ret = q->wt - q->rd;
-	else
-		ret = q->wt + (q->max - q->rd);
-	return ret;
-}
-
 static int edma_pending_q_flush(int chn)
 {
 	int num, ret;
@@ -987,6 +1068,14 @@ static int edma_pending_q_flush(int chn)
 	tail = q->ring[q->rd].tail;
 	num  = q->ring[q->rd].num;
 	q->rd = INCR_RING_BUFF_INDX(q->rd, q->max);
+	/* take the chains behind along while they fit, one doorbell for all */
+	while (edma_pending_q_num(chn) > 0 &&
+	       num + q->ring[q->rd].num <= edma->chn_sw[chn].dscr_ring.free) {
+		((struct mbuf_t *)tail)->next = q->ring[q->rd].head;
+		tail = q->ring[q->rd].tail;
+		num += q->ring[q->rd].num;
+		q->rd = INCR_RING_BUFF_INDX(q->rd, q->max);
+	}
 	spin_unlock_irqrestore(q->lock.irq_spinlock_p, q->lock.flag);
 
 	ret = edma_push_link(chn, head, tail, num);
@@ -1184,6 +1273,61 @@ int q_info(int debug)
 	return 0;
 }
 
+/*
+ * Every channel completes in its own tasklet, so wifi rx does not queue up
+ * behind bt or tx complete work. Events raised while the tasklet is
+ * pending are merged, the handlers always work up to the hw pointer.
+ */
+static void edma_chn_tasklet(unsigned long data)
+{
+	int chn = (int)data, budget = EDMA_CHN_POLL_BUDGET, evt;
+	struct isr_msg_queue msg = { 0 };
+	struct edma_info *edma = edma_info();
+	unsigned long pending;
+
+	msg.chn = chn;
+	while (budget--) {
+		pending = xchg(&edma->chn_sw[chn].evt_pending, 0);
+		if (!pending)
+			return;
+
+		for_each_set_bit(evt, &pending, ISR_MSG_INTx) {
+			msg.evt = evt;
+			hisrfunc(&msg);
+		}
+	}
+
+	/* still busy, let the other channels run first */
+	tasklet_schedule(&edma->chn_sw[chn].tasklet);
+}
+
+static void edma_isr_defer(struct isr_msg_queue *msg)
+{
+	struct edma_info *edma = edma_info();
+#if CONFIG_TASKLET_SUPPORT
+	unsigned long *pending = &edma->chn_sw[msg->chn].evt_pending;
+	union dma_chn_int_reg dma_int = msg->dma_int;
+
+	if (msg->evt != ISR_MSG_INTx) {
+		set_bit(msg->evt, pending);
+	} else if (edma->chn_sw[msg->chn].inout) {
+		if (dma_int.bit.rf_chn_tx_pop_int_mask_status)
+			set_bit(ISR_MSG_TX_POP, pending);
+		if (dma_int.bit.rf_chn_tx_complete_int_mask_status)
+			set_bit(ISR_MSG_TX_COMPLETE, pending);
+	} else {
+		if (dma_int.bit.rf_chn_rx_pop_int_mask_status)
+			set_bit(ISR_MSG_RX_POP, pending);
+		if (dma_int.bit.rf_chn_rx_push_int_mask_status)
+			set_bit(ISR_MSG_RX_PUSH, pending);
+	}
+	tasklet_schedule(&edma->chn_sw[msg->chn].tasklet);
+#else
+	enqueue(&(edma->isr_func.q), (unsigned char *)msg);
+	set_wcnevent(&(edma->isr_func.q.event));
+#endif
+}
+
 int legacy_irq_handle(int data)
 {
 	unsigned long irq_flags;
@@ -1205,6 +1349,8 @@ int legacy_irq_handle(int data)
 				chn, dma_int.reg);
 			dma_int.bit.rf_chn_cfg_err_int_clr = 1;
 			edma->dma_chn_reg[chn].dma_int.reg = dma_int.reg;
+			/* check the cfg again on the next push */
+			edma->chn_sw[chn].chn_en = 0;
 			continue;
 		}
 		discard = 1;
@@ -1239,10 +1385,7 @@ int legacy_irq_handle(int data)
 			edma->dma_chn_reg[chn].dma_int.reg = dma_int.reg;
 			if (!discard) {
 				if (mchn_hw_cb_in_irq(chn) == 0) {
-					enqueue(&(edma->isr_func.q),
-						(unsigned char *)(&msg));
-					set_wcnevent(&(edma->isr_func
-								.q.event));
+					edma_isr_defer(&msg);
 				} else if (mchn_hw_cb_in_irq(chn) == -1) {
 					ret = -1;
 					break;
@@ -1361,8 +1504,7 @@ int msi_irq_handle(int irq)
 	}
 
 	if (mchn_hw_cb_in_irq(chn) == 0) {
-		enqueue(&(edma->isr_func.q), (unsigned char *)(&msg));
-		set_wcnevent(&(edma->isr_func.q.event));
+		edma_isr_defer(&msg);
 		WCNDBG("cb not irq=%ld, chn=%d\n", irq_flags, chn);
 		goto out;
 	} else if (mchn_hw_cb_in_irq(chn) == -1) {
@@ -1428,8 +1570,7 @@ static void dscr_ring_deinit(int chn)
 
 	dscr_ring = &(edma->chn_sw[chn].dscr_ring);
 	dscr_ring->free = dscr_ring->size;
-	dscr_ring->head = dscr_ring->tail = dscr =
-					(struct desc *) dscr_ring->mem;
+	dscr = (struct desc *) dscr_ring->mem;
 	/*resolve mem lead*/
 	if (dscr_ring->lock.irq_spinlock_p)
 		kfree(dscr_ring->lock.irq_spinlock_p);
@@ -1437,6 +1578,11 @@ static void dscr_ring_deinit(int chn)
 	if (!dscr)
 		return;
 	dscr_zero(dscr);
+	/* back to the pool, the next init may ask for another size */
+	mpool_release(dscr_ring->mem,
+		      sizeof(struct desc) * (dscr_ring->size + 1));
+	dscr_ring->mem = NULL;
+	dscr_ring->head = dscr_ring->tail = NULL;
 }
 
 static int dscr_ring_init(int chn, struct dscr_ring *dscr_ring,
@@ -1449,9 +1595,12 @@ static int dscr_ring_init(int chn, struct dscr_ring *dscr_ring,
 	WCN_DBG("[+]%s(0x%p, 0x%p)\n", __func__, dscr_ring,
 			 dscr_ring->mem);
 
-	/* mpool not free, so dscr_ring->mem not change and
-	   don't need re-init.
-	*/
+	/* set up again without deinit, keep the ring if the size is the same */
+	if (dscr_ring->mem && dscr_ring->size != size) {
+		mpool_release(dscr_ring->mem,
+			      sizeof(struct desc) * (dscr_ring->size + 1));
+		dscr_ring->mem = NULL;
+	}
 	if (dscr_ring->mem == NULL) {
 		dscr_ring->mem =
 		    (unsigned char *)mpool_malloc(sizeof(struct desc) *
@@ -1529,6 +1678,28 @@ static int edma_pending_q_init(int chn, int max)
 	return OK;
 }
 
+/* each channel owns two vectors, pop and push/complete */
+static void edma_chn_irq_affinity(int chn)
+{
+	struct wcn_pcie_info *priv = edma_info()->pcie_info;
+	int cpu = edma_chn_cpu[chn], i, vector, ret;
+
+	if (cpu < 0 || !priv || (!priv->msi_en && !priv->msix_en))
+		return;
+
+	if (cpu >= nr_cpu_ids || !cpu_online(cpu)) {
+		WCN_ERR("%s chn %d cpu %d offline\n", __func__, chn, cpu);
+		return;
+	}
+
+	for (i = chn * 2; i < chn * 2 + 2 && i < priv->irq_num; i++) {
+		vector = priv->msix_en ? priv->msix[i].vector : priv->irq + i;
+		ret = irq_set_affinity_hint(vector, cpumask_of(cpu));
+		WCN_INFO("%s chn %d irq %d cpu %d ret %d\n", __func__,
+			 chn, vector, cpu, ret);
+	}
+}
+
 int edma_chn_init(int chn, int mode, int inout, int max_trans)
 {
 	int ret, dir = 0;
@@ -1643,9 +1814,11 @@ int edma_chn_init(int chn, int mode, int inout, int max_trans)
 	edma->chn_sw[chn].dir = dir;
 	edma->chn_sw[chn].inout = inout;
 	edma->chn_sw[chn].mode = mode;
+	edma_chn_irq_affinity(chn);
 	edma->dma_chn_reg[chn].dma_int.reg = dma_int.reg;
 	edma->dma_chn_reg[chn].dma_cfg.reg = dma_cfg.reg;
 	dma_cfg.reg = edma->dma_chn_reg[chn].dma_cfg.reg;
+	edma->chn_sw[chn].chn_en = dma_cfg.bit.rf_chn_en;
 	WCN_INFO("[-]%s\n", __func__);
 
 	return 0;
@@ -1806,6 +1979,8 @@ int edma_init(struct wcn_pcie_info *pcie_info)
 	edma->isr_func.q.event.tasklet = kmalloc(sizeof(struct tasklet_struct),
 						 GFP_KERNEL);
 	tasklet_init(edma->isr_func.q.event.tasklet, edma_tasklet, 0);
+	for (i = 0; i < 32; i++)
+		tasklet_init(&edma->chn_sw[i].tasklet, edma_chn_tasklet, i);
 #else
 	edma->isr_func.entity = kthread_create(edma_task, edma, "edma_task");
 	if (edma->isr_func.entity == NULL) {
@@ -1876,12 +2051,16 @@ int edma_tasklet_deinit(void)
 	struct edma_info *edma = edma_info();
 
 #if CONFIG_TASKLET_SUPPORT
+	int i;
+
 	WCN_INFO("tasklet exit start status=0x%lx, count=%d\n",
 		 edma->isr_func.q.event.tasklet->state,
 		 atomic_read(&edma->isr_func.q.event.tasklet->count));
 	tasklet_kill(edma->isr_func.q.event.tasklet);
 	kfree(edma->isr_func.q.event.tasklet);
 	edma->isr_func.q.event.tasklet = NULL;
+	for (i = 0; i < 32; i++)
+		tasklet_kill(&edma->chn_sw[i].tasklet);
 	WCN_INFO("tasklet exit end\n");
 #endif
 
@@ -13,6 +13,8 @@
 #ifndef __EDMA_ENGIN_H__
 #define __EDMA_ENGIN_H__
 
+#include <linux/interrupt.h>
+
 #include "pcie_dbg.h"
 #include "pcie.h"
 
@@ -372,7 +374,12 @@ struct edma_info {
 		unsigned char dir;
 		unsigned char inout;
 		unsigned char state;
+		/* rf_chn_en is known to be set */
+		unsigned char chn_en;
 		struct edma_pending_q pending_q;
+		/* deferred interrupt events, BIT(ISR_MSG_xxx) */
+		unsigned long evt_pending;
+		struct tasklet_struct tasklet;
 	} chn_sw[32];
 	struct {
 		int state;
@@ -494,6 +501,7 @@ int msi_irq_handle(int irq);
 int legacy_irq_handle(int data);
 int edma_push_link(int chn, void *head, void *tail, int num);
 int edma_push_link_async(int chn, void *head, void *tail, int num);
+int edma_push_link_more(int chn, void *head, void *tail, int num, int more);
 int edma_push_link_wait_complete(int chn, void *head, void *tail,
 				 int num, int timeout);
 int mchn_hw_pop_link(int chn, void *head, void *tail, int num);
@@ -501,6 +509,7 @@ int mchn_hw_cb_in_irq(int chn);
 int mchn_hw_max_pending(int chn);
 int edma_tp_count(int chn, void *head, void *tail, int num);
 void *mpool_malloc(int len);
+void mpool_release(void *p, int len);
 int mpool_free(void);
 void *pcie_alloc_memory(int len);
 int delete_queue(struct msg_q *q);
@@ -10,6 +10,10 @@
  * GNU General Public License for more details.
  */
 
+#include <linux/ktime.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
+#include <linux/slab.h>
 #include <misc/mchn.h>
 #include "edma_engine.h"
 #include "mchn.h"
@@ -17,6 +21,9 @@
 
 #define TX_CHN (0)
 #define RX_CHN (1)
+#define LO_MAX_PAIR (8)
+/* batch latency buckets, bucket n counts [2^(n-1), 2^n) us */
+#define LO_LAT_NR (20)
 
 struct cfg_e {
 	int pool_size;
@@ -32,13 +39,34 @@ struct test_link {
 	int      chn;
 };
 
+/*
+ * per pair counters, a batch is the pool_size mbufs pushed on the tx chn
+ * and is done when all of them came back on the rx chn
+ */
+struct lo_stat {
+	u64 start_ns;
+	u64 end_ns;
+	u64 push_ns;
+	u64 bytes;
+	u64 batches;
+	u64 tx_irq;
+	u64 rx_irq;
+	u64 lat_sum;
+	u64 lat_max;
+	u32 lat[LO_LAT_NR];
+	int inflight;
+};
+
 struct loopback {
 	struct cfg_e  cfg;
 	int    seq;
 	int    loop;
+	int    cb_in_irq;
+	int    inited;
 	struct mchn_ops_t ops[16];
 	struct test_link link[8][2];
-
+	struct dma_buf *dm[16];
+	struct lo_stat stat[LO_MAX_PAIR];
 };
 struct loopback g_lo;
 
@@ -72,20 +100,26 @@ static int lo_index(int chn)
 static int lo_buf_alloc(int chn, int size, int num)
 {
 	int ret, i;
-	struct dma_buf dm = {0};
+	struct dma_buf *dm;
 	struct mbuf_t *mbuf, *head, *tail;
 	struct edma_info *edma = edma_info();
+	struct loopback *lo = &g_lo;
 
+	/* kept to give the buffers back in lo_deinit */
+	lo->dm[chn] = kcalloc(num, sizeof(struct dma_buf), GFP_KERNEL);
+	if (!lo->dm[chn])
+		return -1;
 	ret = mbuf_link_alloc(chn, &head, &tail, &num);
 	if (ret != 0)
 		return -1;
 	for (i = 0, mbuf = head; i < num; i++) {
-		ret = dmalloc(edma->pcie_info, &dm, size);
+		dm = &lo->dm[chn][i];
+		ret = dmalloc(edma->pcie_info, dm, size);
 		if (ret != 0)
 			return -1;
-		mbuf->buf = (unsigned char *)(dm.vir);
-		mbuf->phy = (unsigned long)(dm.phy);
-		mbuf->len = dm.size;
+		mbuf->buf = (unsigned char *)(dm->vir);
+		mbuf->phy = (unsigned long)(dm->phy);
+		mbuf->len = dm->size;
 		memset(mbuf->buf, (unsigned char)(i+1), mbuf->len);
 		mbuf = mbuf->next;
 	}
@@ -98,8 +132,10 @@ static int lo_tx_pop(int chn, struct mbuf_t *head, struct mbuf_t *tail,
 		     int num)
 {
 	struct loopback *lo = &g_lo;
-	struct test_link *tx_link = &(lo->link[lo_index(chn)][TX_CHN]);
+	int index = lo_index(chn);
+	struct test_link *tx_link = &(lo->link[index][TX_CHN]);
 
+	lo->stat[index].tx_irq++;
 	if (tx_link->num == 0) {
 		tx_link->head = head;
 		tx_link->tail = tail;
@@ -119,9 +155,12 @@ static int lo_push(int chn)
 	struct mchn_ops_t *ops = lo_ops(chn);
 	struct mbuf_t *head, *tail, *mbuf;
 	struct loopback *lo = &g_lo;
+	struct lo_stat *stat = &lo->stat[lo_index(chn)];
 
 	num = ops->pool_size;
 	ret = mbuf_link_alloc(chn, &head, &tail, &num);
+	if (ret != 0)
+		return ret;
 	for (i = 0, mbuf = head; i < num; i++) {
 		for (j = 0; j < mbuf->len/4; j++)
 			*(int *)(mbuf->buf + j * 4) = lo->seq;
@@ -129,7 +168,11 @@ static int lo_push(int chn)
 		lo->seq++;
 		mbuf = mbuf->next;
 	}
+	stat->inflight = 1;
+	stat->push_ns = ktime_get_ns();
 	ret = mchn_push_link(chn, head, tail, num);
+	if (ret != 0)
+		stat->inflight = 0;
 
 	return ret;
 }
@@ -142,6 +185,28 @@ static int lo_rx_push(int chn, struct mbuf_t **head, struct mbuf_t **tail,
 	return ret;
 }
 
+static void lo_stat_batch(struct lo_stat *stat, struct test_link *tx_link)
+{
+	struct mbuf_t *mbuf;
+	u64 now = ktime_get_ns();
+	u64 lat = now - stat->push_ns;
+	u64 us = div_u64(lat, NSEC_PER_USEC);
+	int i, n;
+
+	for (i = 0, mbuf = tx_link->head; i < tx_link->num; i++) {
+		stat->bytes += mbuf->len;
+		mbuf = mbuf->next;
+	}
+	n = us ? min_t(int, ilog2(us) + 1, LO_LAT_NR - 1) : 0;
+	stat->lat[n]++;
+	stat->lat_sum += lat;
+	if (lat > stat->lat_max)
+		stat->lat_max = lat;
+	stat->batches++;
+	stat->end_ns = now;
+	stat->inflight = 0;
+}
+
 static int lo_rx_pop(int chn, struct mbuf_t *head, struct mbuf_t *tail,
 		     int num)
 {
@@ -151,9 +216,11 @@ static int lo_rx_pop(int chn, struct mbuf_t *head, struct mbuf_t *tail,
 	struct mbuf_t *tx_mbuf, *rx_mbuf;
 	struct loopback *lo = &g_lo;
 	struct mchn_ops_t *ops = lo_ops(chn);
-	struct test_link *tx_link = &(lo->link[lo_index(chn)][TX_CHN]);
-	struct test_link *rx_link = &(lo->link[lo_index(chn)][RX_CHN]);
+	int index = lo_index(chn);
+	struct test_link *tx_link = &(lo->link[index][TX_CHN]);
+	struct test_link *rx_link = &(lo->link[index][RX_CHN]);
 
+	lo->stat[index].rx_irq++;
 	if (rx_link->num == 0) {
 		rx_link->head = head;
 		rx_link->tail = tail;
@@ -173,22 +240,26 @@ static int lo_rx_pop(int chn, struct mbuf_t *head, struct mbuf_t *tail,
 
 			return -1;
 		}
-		pos = sprintf(string+pos, "lo(%d,%d){",
-			      tx_link->chn, rx_link->chn);
+		lo_stat_batch(&lo->stat[index], tx_link);
+		pos = scnprintf(string, sizeof(string), "lo(%d,%d){",
+				tx_link->chn, rx_link->chn);
 		for (i = 0, tx_mbuf = tx_link->head, rx_mbuf = rx_link->head;
 		    i < tx_link->num; i++) {
-			if (memcmp(tx_mbuf->buf, rx_mbuf->buf, 1024) != 0) {
+			if (memcmp(tx_mbuf->buf, rx_mbuf->buf,
+				   tx_mbuf->len) != 0) {
 				WCN_ERR("%s line:%d err\n", __func__,
 					__LINE__);
 				while (1)
 					;
 			}
-			pos += sprintf(string+pos, "%d ",
-				       *(int *)(tx_mbuf->buf));
+			pos += scnprintf(string + pos, sizeof(string) - pos,
+					 "%d ", *(int *)(tx_mbuf->buf));
 			tx_mbuf = tx_mbuf->next;
 			rx_mbuf = rx_mbuf->next;
 		}
-		WCN_INFO("%s}\n", string);
+		/* one line per batch would flood the log when looping */
+		if (!lo->loop)
+			WCN_INFO("%s}\n", string);
 		mbuf_link_free(rx_link->chn, rx_link->head, rx_link->tail,
 			       rx_link->num);
 		mbuf_link_free(tx_link->chn, tx_link->head, tx_link->tail,
@@ -212,7 +283,31 @@ static int lo_tx_complete(int chn, int timeout)
 	return 0;
 }
 
-int lo_init(void)
+static void lo_deinit(void)
+{
+	int i, j, k, chn;
+	struct loopback *lo = &g_lo;
+	struct edma_info *edma = edma_info();
+
+	for (i = 0; i < lo->cfg.num; i++) {
+		for (j = TX_CHN; j <= RX_CHN; j++) {
+			chn = lo->link[i][j].chn;
+			mchn_deinit(lo_ops(chn));
+			if (!lo->dm[chn])
+				continue;
+			for (k = 0; k < lo->cfg.pool_size; k++) {
+				if (lo->dm[chn][k].vir)
+					dmfree(edma->pcie_info,
+					       &lo->dm[chn][k]);
+			}
+			kfree(lo->dm[chn]);
+			lo->dm[chn] = NULL;
+		}
+	}
+	lo->inited = 0;
+}
+
+int lo_init(int pairs, int descs, int buf_size, int cb_in_irq)
 {
 	int i, tx_chn, rx_chn;
 	struct mchn_ops_t *ops;
@@ -226,6 +321,15 @@ int lo_init(void)
 	}
 	memcpy((unsigned char *)(&lo->cfg), (unsigned char *)(&cfg),
 		sizeof(cfg));
+	/* pair n loops chn 2n back to chn 2n + 1 like the default cfg */
+	lo->cfg.num = pairs;
+	lo->cfg.pool_size = descs;
+	lo->cfg.buf_size = buf_size;
+	for (i = 0; i < pairs; i++) {
+		lo->cfg.chn[i][TX_CHN] = 2 * i;
+		lo->cfg.chn[i][RX_CHN] = 2 * i + 1;
+	}
+	lo->cb_in_irq = cb_in_irq;
 	for (i = 0; i < lo->cfg.num; i++) {
 		tx_chn = lo->cfg.chn[i][TX_CHN];
 		rx_chn = lo->cfg.chn[i][RX_CHN];
@@ -236,7 +340,7 @@ int lo_init(void)
 		ops->hif_type = HW_TYPE_PCIE;
 		ops->buf_size = lo->cfg.buf_size;
 		ops->pool_size = lo->cfg.pool_size;
-		ops->cb_in_irq = 0;
+		ops->cb_in_irq = cb_in_irq;
 		ops->pop_link = lo_tx_pop;
 		ops->tx_complete = lo_tx_complete;
 		mchn_init(ops);
@@ -248,7 +352,7 @@ int lo_init(void)
 		ops->hif_type = HW_TYPE_PCIE;
 		ops->buf_size = lo->cfg.buf_size;
 		ops->pool_size = lo->cfg.pool_size;
-		ops->cb_in_irq = 0;
+		ops->cb_in_irq = cb_in_irq;
 		ops->pop_link = lo_rx_pop;
 		ops->push_link = lo_rx_push;
 		mchn_init(ops);
@@ -257,24 +361,71 @@ int lo_init(void)
 		lo->link[i][TX_CHN].chn = tx_chn;
 		lo->link[i][RX_CHN].chn = rx_chn;
 	}
+	lo->inited = 1;
 	WCN_INFO("[-]%s\n", __func__);
 
 	return 0;
 }
 
-int lo_start(int mode)
+static int lo_busy(void)
 {
-	static int lo_init_state;
-	int i, tx_chn;
+	int i;
 	struct loopback *lo = &g_lo;
 
-	WCN_INFO("[+]%s\n", __func__);
-	if (lo_init_state == 0) {
-		lo_init();
-		lo_init_state = 1;
+	for (i = 0; i < lo->cfg.num; i++) {
+		if (lo->stat[i].inflight)
+			return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * mode 1 keeps every pair pushing a new batch as soon as the last one came
+ * back, 0 sends one batch per pair. pairs, descs and buf_size of 0 take
+ * the default cfg. The channels are set up again when the pairs, descs,
+ * buf_size or cb_in_irq differ from the last start, which needs the last
+ * batches back, lo_stop first.
+ */
+int lo_start(int mode, int pairs, int descs, int buf_size, int cb_in_irq)
+{
+	int i, tx_chn;
+	u64 now;
+	struct loopback *lo = &g_lo;
+	struct cfg_e *def = (struct cfg_e *)cfg;
+
+	if (!pairs)
+		pairs = def->num;
+	if (!descs)
+		descs = def->pool_size;
+	if (!buf_size)
+		buf_size = def->buf_size;
+
+	WCN_INFO("[+]%s(%d,%d,%d,%d,%d)\n", __func__, mode, pairs, descs,
+		 buf_size, cb_in_irq);
+	if (pairs < 1 || pairs > LO_MAX_PAIR || descs < 1 ||
+	    buf_size < 4 || buf_size > 0xffff || buf_size % 4) {
+		WCN_ERR("%s bad cfg\n", __func__);
+		return -EINVAL;
+	}
+	if (lo->inited && lo_busy()) {
+		WCN_ERR("%s busy\n", __func__);
+		return -EBUSY;
 	}
+	if (lo->inited && (lo->cfg.num != pairs ||
+	    lo->cfg.pool_size != descs || lo->cfg.buf_size != buf_size ||
+	    lo->cb_in_irq != cb_in_irq))
+		lo_deinit();
+	if (!lo->inited)
+		lo_init(pairs, descs, buf_size, cb_in_irq);
 	lo->loop = mode;
 	lo->seq = 0;
+	memset(lo->stat, 0x00, sizeof(lo->stat));
+	now = ktime_get_ns();
+	for (i = 0; i < lo->cfg.num; i++) {
+		lo->stat[i].start_ns = now;
+		lo->stat[i].end_ns = now;
+	}
 	for (i = 0; i < lo->cfg.num; i++) {
 		tx_chn = lo->link[i][TX_CHN].chn;
 		lo_push(tx_chn);
@@ -292,3 +443,63 @@ int lo_stop(void)
 
 	return 0;
 }
+
+/* upper bound in us of the batch latency below which pct of them fall */
+static unsigned int lo_lat_pct(struct lo_stat *stat, int pct)
+{
+	u64 want, sum = 0;
+	int i;
+
+	want = div_u64(stat->batches * pct + 99, 100);
+	for (i = 0; i < LO_LAT_NR; i++) {
+		sum += stat->lat[i];
+		if (sum >= want)
+			break;
+	}
+
+	return 1U << min(i, LO_LAT_NR - 1);
+}
+
+/*
+ * One line per pair: payload MB/s in each direction, pop callbacks per
+ * second on the tx and the rx chn and the latency of a batch from its
+ * push to the last rx pop, the percentiles are bucket upper bounds.
+ */
+int lo_stat(char *buf, int size)
+{
+	int i, pos = 0;
+	u32 tenth;
+	u64 ns, us, mbps;
+	struct lo_stat *stat;
+	struct loopback *lo = &g_lo;
+
+	if (!lo->inited)
+		return scnprintf(buf, size, "lo not started\n");
+
+	pos += scnprintf(buf + pos, size - pos,
+			 "lo pairs=%d descs=%d buf_size=%d irq=%d loop=%d\n",
+			 lo->cfg.num, lo->cfg.pool_size, lo->cfg.buf_size,
+			 lo->cb_in_irq, lo->loop);
+	for (i = 0; i < lo->cfg.num; i++) {
+		stat = &lo->stat[i];
+		ns = stat->end_ns - stat->start_ns;
+		us = max_t(u64, div_u64(ns, NSEC_PER_USEC), 1);
+		ns = max_t(u64, ns, 1);
+		/* bytes per us is MB/s, in tenths */
+		mbps = div64_u64(stat->bytes * 10, us);
+		tenth = do_div(mbps, 10);
+		pos += scnprintf(buf + pos, size - pos,
+				 "lo(%d,%d) %llu.%uMB/s batches=%llu irq/s tx=%llu rx=%llu lat avg=%lluus p50<%uus p99<%uus max=%lluus\n",
+				 lo->link[i][TX_CHN].chn,
+				 lo->link[i][RX_CHN].chn,
+				 mbps, tenth, stat->batches,
+				 div64_u64(stat->tx_irq * NSEC_PER_SEC, ns),
+				 div64_u64(stat->rx_irq * NSEC_PER_SEC, ns),
+				 stat->batches ? div64_u64(stat->lat_sum,
+				 stat->batches * NSEC_PER_USEC) : 0,
+				 lo_lat_pct(stat, 50), lo_lat_pct(stat, 99),
+				 div_u64(stat->lat_max, NSEC_PER_USEC));
+	}
+
+	return pos;
+}
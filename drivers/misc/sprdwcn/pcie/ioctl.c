@@ -25,6 +25,10 @@ enum PCIE_ARG_INDEX {
 	PCIE_ARG_REGION,
 	PCIE_ARG_TWO_LINK,
 	PCIE_ARG_MODE,
+	PCIE_ARG_PAIRS,
+	PCIE_ARG_DESCS,
+	PCIE_ARG_BUF_SIZE,
+	PCIE_ARG_IRQ,
 	PCIE_ARG_MAX,
 };
 
@@ -39,6 +43,10 @@ static struct arg_t pcie_args[PCIE_ARG_MAX] = {
 	{PCIE_ARG_REGION, "region", 0},
 	{PCIE_ARG_TWO_LINK, "link", 0},
 	{PCIE_ARG_MODE, "mode", 0},
+	{PCIE_ARG_PAIRS, "pairs", 0},
+	{PCIE_ARG_DESCS, "descs", 0},
+	{PCIE_ARG_BUF_SIZE, "buf_size", 0},
+	{PCIE_ARG_IRQ, "irq", 0},
 };
 
 struct arg_t *pcie_arg_index(unsigned int index)
@@ -390,10 +398,19 @@ static int pcie_cmd_proc(struct char_drv_info *dev, unsigned char *input,
 		kfree(buf);
 	} else if (!strcmp("lo_start", cmd)) {
 		mode = args_value(PCIE_ARG_MODE);
-		lo_start(mode);
+		lo_start(mode, args_value(PCIE_ARG_PAIRS),
+			 args_value(PCIE_ARG_DESCS),
+			 args_value(PCIE_ARG_BUF_SIZE),
+			 args_value(PCIE_ARG_IRQ));
 	} else if (!strcmp("lo_stop", cmd))
 		lo_stop();
-	else
+	else if (!strcmp("lo_stat", cmd)) {
+		/* up to 8 pairs do not fit string, use the 4k reply */
+		replay->t = 0;
+		replay->l = lo_stat((char *)replay->v,
+				      4096 - sizeof(struct tlv));
+		WCN_INFO("%.*s", replay->l, replay->v);
+	} else
 		WCN_INFO("unknown cmd %s\n", cmd);
 
 	return 0;
@@ -75,7 +75,8 @@ struct char_drv_info {
 
 int ioctlcmd_deinit(struct wcn_pcie_info *bus);
 int hexdump(char *name, char *buf, int len);
-int lo_start(int mode);
+int lo_start(int mode, int pairs, int descs, int buf_size, int cb_in_irq);
+int lo_stat(char *buf, int size);
 int lo_stop(void);
 int dbg_attach_bus(struct wcn_pcie_info *bus);
 #endif
@@ -35,46 +35,16 @@ struct mchn_ops_t *mchn_ops(int channel)
 int mbuf_link_alloc(int chn, struct mbuf_t **head, struct mbuf_t **tail,
 		    int *num)
 {
-	int i;
-	struct mbuf_t *cur, *head__, *tail__ = NULL;
 	struct mchn_info_t *mchn = mchn_info();
-	struct buffer_pool *pool = &(mchn->chn_public[chn].pool);
-
-	WCN_DBG("pool=%p, chn=%d, free=%d\n", pool, chn, pool->free);
-	spin_lock_irqsave(&(pool->lock), pool->irq_flags);
-	if ((*num <= 0) || (pool->free <= 0)) {
-		WCN_ERR("[+]%s err, num %d, free %d)\n",
-			__func__, *num, pool->free);
-		*num = 0;
-		*head = *tail = NULL;
-		spin_unlock_irqrestore(&(pool->lock), pool->irq_flags);
-		return -1;
-	}
-	if (*num > pool->free)
-		*num = pool->free;
-
-	for (i = 0, cur = head__ = pool->head; i < *num; i++) {
-
-		if (i == (*num - 1))
-			tail__ = cur;
 
-		cur = cur->next;
-	}
-	*head = head__;
-	tail__->next = NULL;
-	*tail = tail__;
-	pool->free -= *num;
-	pool->head = cur;
-	spin_unlock_irqrestore(&(pool->lock), pool->irq_flags);
-
-	return 0;
+	return wcn_mbuf_pool_alloc(&(mchn->chn_public[chn].pool),
+				   head, tail, num);
 }
 EXPORT_SYMBOL(mbuf_link_alloc);
 
 int mbuf_link_free(int chn, struct mbuf_t *head, struct mbuf_t *tail, int num)
 {
 	struct mchn_info_t *mchn = mchn_info();
-	struct buffer_pool *pool = &(mchn->chn_public[chn].pool);
 
 	if ((head == NULL) || (tail == NULL) || (num == 0) ||
 	    (tail->next != 0)) {
@@ -83,65 +53,12 @@ int mbuf_link_free(int chn, struct mbuf_t *head, struct mbuf_t *tail, int num)
 
 		return -1;
 	}
-	spin_lock_irqsave(&(pool->lock), pool->irq_flags);
-	tail->next = pool->head;
-	pool->head = head;
-	pool->free += num;
-	spin_unlock_irqrestore(&(pool->lock), pool->irq_flags);
 
-	return 0;
+	return wcn_mbuf_pool_free(&(mchn->chn_public[chn].pool),
+				  head, tail, num);
 }
 EXPORT_SYMBOL(mbuf_link_free);
 
-int mbuf_pool_init(struct buffer_pool *pool, int size, int payload)
-{
-	int i;
-	struct mbuf_t *mbuf, *next;
-
-	pool->size = size;
-	pool->payload = payload;
-	spin_lock_init(&(pool->lock));
-	pool->mem = kmalloc((sizeof(struct mbuf_t) + payload) * size,
-			     GFP_KERNEL);
-	WCN_DBG("mbuf_pool->mem:0x%lx\n",
-		 (unsigned long)virt_to_phys(pool->mem));
-	memset(pool->mem, 0x00, (sizeof(struct mbuf_t) + payload) * size);
-	pool->head = (struct mbuf_t *) (pool->mem);
-	for (i = 0, mbuf = (struct mbuf_t *) (pool->head);
-	     i < (size - 1); i++) {
-		mbuf->seq = i;
-		WCN_DBG("%s mbuf[%d]:{0x%lx, 0x%lx}\n", __func__, i,
-			(unsigned long)mbuf,
-			(unsigned long)virt_to_phys(mbuf));
-		next = (struct mbuf_t *) ((char *)mbuf +
-			sizeof(struct mbuf_t) + payload);
-		mbuf->buf = (char *)mbuf + sizeof(struct mbuf_t);
-		mbuf->len = payload;
-		mbuf->next = next;
-		mbuf = next;
-	}
-	WCN_DBG("%s mbuf[%d]:{0x%lx, 0x%lx}\n", __func__, i,
-		 (unsigned long)mbuf,
-		 (unsigned long)virt_to_phys(mbuf));
-	mbuf->seq = i;
-	mbuf->buf = (char *)mbuf + sizeof(struct mbuf_t);
-	mbuf->len = payload;
-	mbuf->next = NULL;
-	pool->free = size;
-	WCN_DBG("%s(0x%p, %d)\n", __func__, pool, pool->free);
-
-	return 0;
-}
-
-int mbuf_pool_deinit(struct buffer_pool *pool)
-{
-	memset(pool->mem, 0x00, (sizeof(struct mbuf_t) +
-	       pool->payload) * pool->size);
-	kfree(pool->mem);
-
-	return 0;
-}
-
 int mchn_hw_pop_link(int chn, void *head, void *tail, int num)
 {
 	struct mchn_info_t *mchn = mchn_info();
@@ -212,7 +129,12 @@ int mchn_hw_max_pending(int chn)
 	return g_mchn.ops[chn]->max_pending;
 }
 
-int mchn_push_link(int chn, struct mbuf_t *head, struct mbuf_t *tail, int num)
+/*
+ * @more: the caller pushes further chains right after this one, channels
+ * with a pending queue then ring the doorbell once for all of them.
+ */
+int mchn_push_link_more(int chn, struct mbuf_t *head, struct mbuf_t *tail,
+			int num, int more)
 {
 	int ret = -1;
 	struct mchn_info_t *mchn = mchn_info();
@@ -241,8 +163,8 @@ int mchn_push_link(int chn, struct mbuf_t *head, struct mbuf_t *tail, int num)
 	switch (mchn->ops[chn]->hif_type) {
 	case HW_TYPE_PCIE:
 		if (mchn_hw_max_pending(chn) > 0)
-			ret = edma_push_link_async(chn, (void *)head,
-						   (void *)tail, num);
+			ret = edma_push_link_more(chn, (void *)head,
+						  (void *)tail, num, more);
 		else
 			ret = edma_push_link(chn, (void *)head,
 					     (void *)tail, num);
@@ -253,6 +175,12 @@ int mchn_push_link(int chn, struct mbuf_t *head, struct mbuf_t *tail, int num)
 
 	return ret;
 }
+EXPORT_SYMBOL(mchn_push_link_more);
+
+int mchn_push_link(int chn, struct mbuf_t *head, struct mbuf_t *tail, int num)
+{
+	return mchn_push_link_more(chn, head, tail, num, 0);
+}
 EXPORT_SYMBOL(mchn_push_link);
 
 int mchn_push_link_wait_complete(int chn, struct mbuf_t *head,
@@ -320,8 +248,8 @@ int mchn_init(struct mchn_ops_t *ops)
 	}
 
 	if ((ret == 0) && (ops->pool_size > 0))
-		ret = mbuf_pool_init(&(mchn->chn_public[ops->channel].pool),
-				     ops->pool_size, 0);
+		ret = wcn_mbuf_pool_init(&mchn->chn_public[ops->channel].pool,
+					 ops->pool_size, 0);
 	WCN_DBG("[-]%s(%d)\n", __func__, ops->channel);
 
 	return ret;
@@ -348,7 +276,7 @@ int mchn_deinit(struct mchn_ops_t *ops)
 		break;
 	}
 	if (ops->pool_size > 0)
-		ret = mbuf_pool_deinit(&(mchn->chn_public[ops->channel].pool));
+		wcn_mbuf_pool_deinit(&mchn->chn_public[ops->channel].pool);
 	mchn->ops[ops->channel] = NULL;
 	WCN_INFO("[-]%s(%d)\n", __func__, ops->channel);
 
@@ -17,25 +17,16 @@
 #include <linux/slab.h>
 #include <linux/spinlock.h>
 #include <linux/interrupt.h>
+#include <misc/wcn_bus.h>
 
 #define HW_TYPE_SDIO 0
 #define HW_TYPE_PCIE 1
 #define MCHN_MAX_NUM 32
 
-struct buffer_pool {
-	int size;
-	int free;
-	int payload;
-	void *head;
-	char *mem;
-	spinlock_t lock;
-	unsigned long irq_flags;
-};
-
 struct mchn_info_t {
 	struct mchn_ops_t *ops[MCHN_MAX_NUM];
 	struct {
-		struct buffer_pool pool;
+		struct wcn_mbuf_pool pool;
 	} chn_public[MCHN_MAX_NUM];
 };
 
@@ -46,6 +37,9 @@ int mchn_deinit(struct mchn_ops_t *ops);
 /* push link list */
 int mchn_push_link(int channel, struct mbuf_t *head,
 		   struct mbuf_t *tail, int num);
+/* push link list, @more: another push follows, defer the doorbell */
+int mchn_push_link_more(int channel, struct mbuf_t *head,
+			struct mbuf_t *tail, int num, int more);
 /* push link list, Using a blocking mode, Timeout wait for tx_complete */
 int mchn_push_link_wait_complete(int chn, struct mbuf_t *head,
 				 struct mbuf_t *tail, int num, int timeout);
@@ -766,6 +766,8 @@ static int disable_pcie_irq(void)
 
 	if (priv->msi_en == 1) {
 		for (i = 0; i < priv->irq_num; i++) {
+			/* set by edma_chn_init for the chn_cpu param */
+			irq_set_affinity_hint(priv->irq + i, NULL);
 			if (!free_irq(priv->irq + i, (void *)priv))
 				return -1;
 		}
@@ -1054,8 +1056,10 @@ static void sprd_pcie_remove(struct pci_dev *pdev)
 
 	if (priv->msix_en == 1) {
 		WCN_INFO("disable MSI-X");
-		for (i = 0; i < priv->irq_num; i++)
+		for (i = 0; i < priv->irq_num; i++) {
+			irq_set_affinity_hint(priv->msix[i].vector, NULL);
 			free_irq(priv->msix[i].vector, (void *)priv);
+		}
 
 		pci_disable_msix(pdev);
 	}
@@ -42,6 +42,15 @@ static int pcie_list_push(int chn, struct mbuf_t *head,
 	return mchn_push_link(chn, head, tail, num);
 }
 
+static int pcie_list_push_more(int chn, struct mbuf_t *head,
+			       struct mbuf_t *tail, int num, int more)
+{
+	if (sprd_pcie_get_carddump_status())
+		return -1;
+
+	return mchn_push_link_more(chn, head, tail, num, more);
+}
+
 static int pcie_chn_init(struct mchn_ops_t *ops)
 {
 	return mchn_init(ops);
@@ -141,6 +150,7 @@ static struct sprdwcn_bus_ops pcie_bus_ops = {
 	.list_alloc = pcie_buf_list_alloc,
 	.list_free = pcie_buf_list_free,
 	.push_list = pcie_list_push,
+	.push_list_more = pcie_list_push_more,
 	.direct_read = pcie_direct_read,
 	.direct_write = pcie_direct_write,
 	.readbyte = pcie_readbyte,
@@ -10,7 +10,9 @@
  * GNU General Public License for more details.
  */
 
+#include <linux/mm.h>
 #include <linux/uaccess.h>
+#include <linux/vmalloc.h>
 
 #include "bufring.h"
 #include "mdbg_type.h"
@@ -25,11 +27,26 @@
 			((size) - (u_long)(wp) + (u_long)(rp)) :\
 			((u_long)(rp) - (u_long)(wp)))
 
+/*
+ * The ring is single reader, lock free between the reader and the writers:
+ * wr is only stored by a writer after its data, rd only by the reader after
+ * it is done with the data. rd may come from a mapping, a bogus one is
+ * taken as an empty ring.
+ */
+static inline u32 mdbg_ring_rd(struct mdbg_ring_t *ring)
+{
+	u32 rd = smp_load_acquire(&ring->ctrl->rd);
+
+	if (unlikely(rd >= ring->size))
+		return READ_ONCE(ring->ctrl->wr);
+	return rd;
+}
+
 /* valid buf for write */
 long int mdbg_ring_free_space(struct mdbg_ring_t *ring)
 {
-	return (long int)_MDBG_RING_REMAIN(ring->rp,
-				ring->wp, ring->size);
+	return (long int)_MDBG_RING_REMAIN(mdbg_ring_rd(ring),
+				READ_ONCE(ring->ctrl->wr), ring->size);
 }
 
 static inline char *mdbg_ring_start(struct mdbg_ring_t *ring)
@@ -44,53 +61,53 @@ static inline char *mdbg_ring_end(struct mdbg_ring_t *ring)
 
 bool mdbg_ring_over_loop(struct mdbg_ring_t *ring, u_long len, int rw)
 {
-	if (rw == MDBG_RING_R) {
-		if ((u_long)ring->rp + len > (u_long)mdbg_ring_end(ring)) {
-			ring->p_order_flag = 0;
-			return true;
-		}
-		return false;
-	}
+	u_long pos;
 
-	if ((u_long)ring->wp + len > (u_long)mdbg_ring_end(ring)) {
-		ring->p_order_flag = 1;
-		return true;
-	}
+	if (rw == MDBG_RING_R)
+		pos = mdbg_ring_rd(ring);
+	else
+		pos = READ_ONCE(ring->ctrl->wr);
 
-	return false;
+	return pos + len > ring->size;
 }
 
 struct mdbg_ring_t *mdbg_ring_alloc(long int size)
 {
 	struct mdbg_ring_t *ring = NULL;
+	struct mdbg_ring_ctrl *ctrl;
 
 	do {
 		if (size < MDBG_RING_MIN_SIZE) {
 			WCN_ERR("size error:%ld\n", size);
 			break;
 		}
-		ring = kmalloc(sizeof(struct mdbg_ring_t), GFP_KERNEL);
+		ring = kzalloc(sizeof(struct mdbg_ring_t), GFP_KERNEL);
 		if (ring == NULL) {
 			WCN_ERR("Ring malloc Failed.\n");
 			break;
 		}
-		ring->pbuff = kmalloc(size, GFP_KERNEL);
-		if (ring->pbuff == NULL) {
+		/* control page and data, zeroed and ready for mmap */
+		ctrl = vmalloc_user(PAGE_SIZE + PAGE_ALIGN(size));
+		if (ctrl == NULL) {
 			WCN_ERR("Ring buff malloc Failed.\n");
 			break;
 		}
+		ring->ctrl = ctrl;
 		ring->plock = kmalloc(MDBG_RING_LOCK_SIZE, GFP_KERNEL);
 		if (ring->plock == NULL) {
 			WCN_ERR("Ring lock malloc Failed.\n");
 			break;
 		}
 		MDBG_RING_LOCK_INIT(ring);
-		memset(ring->pbuff, 0, size);
+		spin_lock_init(&ring->wlock);
 		ring->size = size;
-		ring->rp = ring->pbuff;
-		ring->wp = ring->pbuff;
+		ring->pbuff = (char *)ctrl + PAGE_SIZE;
 		ring->end = (char *)(((u_long)ring->pbuff) + (ring->size - 1));
-		ring->p_order_flag = 0;
+
+		ctrl->magic = MDBG_RING_MAGIC;
+		ctrl->version = MDBG_RING_VERSION;
+		ctrl->size = size;
+		ctrl->data_offset = PAGE_SIZE;
 
 		return ring;
 	} while (0);
@@ -106,22 +123,21 @@ void mdbg_ring_destroy(struct mdbg_ring_t *ring)
 
 	WCN_LOG("ring = %p", ring);
 	WCN_LOG("ring->pbuff = %p", ring->pbuff);
-	if (ring != NULL) {
-		if (ring->pbuff != NULL) {
-			WCN_LOG("to free ring->pbuff.");
-			kfree(ring->pbuff);
-			ring->pbuff = NULL;
-		}
-		if (ring->plock != NULL) {
-			WCN_LOG("to free ring->plock.");
-			MDBG_RING_LOCK_UNINIT(ring);
-			kfree(ring->plock);
-			ring->plock = NULL;
-		}
-		WCN_LOG("to free ring.");
-		kfree(ring);
-		ring = NULL;
+	if (ring->ctrl != NULL) {
+		WCN_LOG("to free ring->pbuff.");
+		/* pages still mapped by a reader go with its mapping */
+		vfree(ring->ctrl);
+		ring->ctrl = NULL;
+		ring->pbuff = NULL;
+	}
+	if (ring->plock != NULL) {
+		WCN_LOG("to free ring->plock.");
+		MDBG_RING_LOCK_UNINIT(ring);
+		kfree(ring->plock);
+		ring->plock = NULL;
 	}
+	WCN_LOG("to free ring.");
+	kfree(ring);
 }
 
 int mdbg_ring_read(struct mdbg_ring_t *ring, void *buf, int len)
@@ -130,7 +146,8 @@ int mdbg_ring_read(struct mdbg_ring_t *ring, void *buf, int len)
 	int cont_len = 0;
 	int read_len = 0;
 	char *pstart = NULL;
-	char *pend = NULL;
+	char *rp;
+	u32 rd, wr;
 	static unsigned int total_len;
 
 	if ((buf == NULL) || (ring == NULL) || (len == 0)) {
@@ -139,65 +156,48 @@ int mdbg_ring_read(struct mdbg_ring_t *ring, void *buf, int len)
 		return -MDBG_ERR_BAD_PARAM;
 	}
 	MDBG_RING_LOCK(ring);
-	cont_len = mdbg_ring_readable_len(ring);
+	/* the data up to wr is complete once wr is seen */
+	wr = smp_load_acquire(&ring->ctrl->wr);
+	rd = mdbg_ring_rd(ring);
+	cont_len = wr >= rd ? wr - rd : ring->size - rd + wr;
 	read_len = cont_len >= len ? len : cont_len;
 	pstart = mdbg_ring_start(ring);
-	pend = mdbg_ring_end(ring);
+	rp = pstart + rd;
 	WCN_LOG("read_len=%d", read_len);
 	WCN_LOG("buf=%p", buf);
-	WCN_LOG("pstart=%p", pstart);
-	WCN_LOG("pend=%p", pend);
-	WCN_LOG("ring->wp = %p", ring->wp);
-	WCN_LOG("ring->rp=%p\n", ring->rp);
+	WCN_LOG("wr = %u, rd = %u\n", wr, rd);
 
-	if ((read_len == 0) || (cont_len == 0)) {
+	if (read_len == 0) {
 		WCN_LOG("read_len = 0 OR Ring Empty.");
 		MDBG_RING_UNLOCK(ring);
 		return 0;	/*ring empty*/
 	}
 
-	if (mdbg_ring_over_loop(ring, read_len, MDBG_RING_R)) {
-		WCN_LOG("Ring loopover.");
-		len1 = pend - ring->rp + 1;
-		len2 = read_len - len1;
-
-		/* if ((uintptr_t)buf > TASK_SIZE) */
-		if (!access_ok(VERIFY_READ, buf, len)) {
-			memcpy(buf, ring->rp, len1);
-			memcpy((buf + len1), pstart, len2);
-		} else if (copy_to_user((__force void __user *)buf,
-					(void *)ring->rp, len1) ||
-			   copy_to_user((__force void __user *)(buf + len1),
-					(void *)pstart, len2)) {
-			WCN_ERR("copy to user error!\n");
-			MDBG_RING_UNLOCK(ring);
-			return -EFAULT;
-		}
-		ring->rp = (char *)((u_long)pstart + len2);
-	} else{
-		/* RP < WP */
-		if (ring->p_order_flag == 0) {
-			if (((ring->rp + read_len) > ring->wp)
-				&& (mdbg_dev->open_count != 0))
-				WCN_ERR("read overlay\n");
-		}
+	len1 = min_t(int, read_len, ring->size - rd);
+	len2 = read_len - len1;
+	/* if ((uintptr_t)buf > TASK_SIZE) */
+	if (!access_ok(VERIFY_READ, buf, len)) {
+		memcpy(buf, rp, len1);
+		memcpy((buf + len1), pstart, len2);
+	} else if (copy_to_user((__force void __user *)buf,
+				(void *)rp, len1) ||
+		   copy_to_user((__force void __user *)(buf + len1),
+				(void *)pstart, len2)) {
+		WCN_ERR("copy to user error!\n");
+		MDBG_RING_UNLOCK(ring);
+		return -EFAULT;
+	}
 
-		if (!access_ok(VERIFY_READ, buf, len))
-			memcpy(buf, ring->rp, read_len);
-		else if (copy_to_user((__force void __user *)buf,
-				      (void *)ring->rp, read_len)) {
-			WCN_ERR("copy to user error!\n");
-			MDBG_RING_UNLOCK(ring);
+	rd += read_len;
+	if (rd >= ring->size)
+		rd -= ring->size;
+	/* the writers may reuse the space once rd is seen */
+	smp_store_release(&ring->ctrl->rd, rd);
 
-			return -EFAULT;
-		}
-		ring->rp += read_len;
-	}
 	total_len += read_len;
 	wcn_pr_daterate(12, 1, total_len,
-			": %s totallen:%u read:%d wp:%p rp:%p",
-			__func__, total_len, read_len,
-			ring->wp, ring->rp);
+			": %s totallen:%u read:%d wr:%u rd:%u",
+			__func__, total_len, read_len, wr, rd);
 	WCN_LOG("<-----[read end] read len =%d.\n", read_len);
 	MDBG_RING_UNLOCK(ring);
 
@@ -207,12 +207,16 @@ int mdbg_ring_read(struct mdbg_ring_t *ring, void *buf, int len)
 /*
  * read:	Rp = Wp:	empty
  * write:	Wp+1=Rp:	full
+ *
+ * The writers are the bus callbacks and the dump code, all of them with
+ * kernel buffers, and the pcie one runs in irq context.
  */
 int mdbg_ring_write(struct mdbg_ring_t *ring, void *buf, unsigned int len)
 {
-	int len1, len2 = 0;
+	unsigned long flags;
 	char *pstart = NULL;
-	char *pend = NULL;
+	u32 wr, rd;
+	int len1;
 	static unsigned int total_len;
 
 	WCN_LOG("-->Ring Write len = %d\n", len);
@@ -224,59 +228,48 @@ int mdbg_ring_write(struct mdbg_ring_t *ring, void *buf, unsigned int len)
 		return -MDBG_ERR_BAD_PARAM;
 	}
 	pstart = mdbg_ring_start(ring);
-	pend = mdbg_ring_end(ring);
-	WCN_LOG("pstart = %p", pstart);
-	WCN_LOG("pend = %p", pend);
-	WCN_LOG("buf = %p", buf);
-	WCN_LOG("len = %d", len);
-	WCN_LOG("ring->wp = %p", ring->wp);
-	WCN_LOG("ring->rp=%p", ring->rp);
-
-	/*
-	 * ring buf valid space < len,need to write (buf_space-1)
-	 * and then write len-(buf_space-1)
-	 */
-	if (((mdbg_ring_free_space(ring) - 1) < len)
-		&& (mdbg_dev->open_count != 0)) {
-		WCN_ERR("log buf is full, Discard the package=%d\n", len);
-		wake_up_log_wait();
-		return len;
-	}
 
-	/* ring buf valid space > len, you can write freely */
-	if (mdbg_ring_over_loop(ring, len, MDBG_RING_W)) {
-		WCN_LOG("Ring overloop.");
-		len1 = pend - ring->wp + 1;
-		len2 = (len - len1) % ring->size;
-		if (!access_ok(VERIFY_READ, buf, len)) {
-			memcpy(ring->wp, buf, len1);
-			memcpy(pstart, (buf + len1), len2);
-		} else if (copy_from_user((void *)ring->wp,
-					  (__force void __user *)buf, len1) ||
-			    copy_from_user((void *)pstart,
-				(__force void __user *)(buf + len1), len2)) {
-			WCN_ERR("%s copy from user error!\n", __func__);
-
-			return -EFAULT;
+	spin_lock_irqsave(&ring->wlock, flags);
+	wr = ring->ctrl->wr;
+	WCN_LOG("wr = %u, len = %d", wr, len);
+
+	if ((mdbg_ring_free_space(ring) - 1) < len) {
+		/* somebody reads the log, keep what it has not read yet */
+		if (mdbg_dev->open_count != 0) {
+			ring->ctrl->dropped += len;
+			spin_unlock_irqrestore(&ring->wlock, flags);
+			WCN_ERR("log buf is full, Discard the package=%d\n",
+				len);
+			wake_up_log_wait();
+			return len;
 		}
 
-		ring->wp = (char *)((u_long)pstart + len2);
-
-	} else{
-		/* RP > WP */
-		if (!access_ok(VERIFY_READ, buf, len))
-			memcpy(ring->wp, buf, len);
-		else if (copy_from_user((void *)ring->wp,
-			    (__force void __user *)buf, len)) {
-			WCN_ERR("%s copy from user error!\n", __func__);
-			return -EFAULT;
+		/* nobody does, the oldest log goes */
+		if (len > ring->size - 1) {
+			buf += len - (ring->size - 1);
+			len = ring->size - 1;
 		}
-		ring->wp += len;
+		rd = wr + len + 1;
+		if (rd >= ring->size)
+			rd -= ring->size;
+		smp_store_release(&ring->ctrl->rd, rd);
 	}
+
+	len1 = min_t(int, len, ring->size - wr);
+	memcpy(pstart + wr, buf, len1);
+	memcpy(pstart, buf + len1, len - len1);
+
+	wr += len;
+	if (wr >= ring->size)
+		wr -= ring->size;
+	/* the data must be in the ring before the reader sees wr */
+	smp_store_release(&ring->ctrl->wr, wr);
+	spin_unlock_irqrestore(&ring->wlock, flags);
+
 	total_len += len;
 	wcn_pr_daterate(12, 1, total_len,
-			": %s totallen:%u write:%u wp:%p rp:%p",
-			__func__, total_len, len, ring->wp, ring->rp);
+			": %s totallen:%u write:%u wr:%u",
+			__func__, total_len, len, wr);
 	WCN_LOG("<------end len = %d\n", len);
 
 	return len;
@@ -300,28 +293,27 @@ int mdbg_ring_write_timeout(struct mdbg_ring_t *ring, void *buf,
 
 char *mdbg_ring_write_ext(struct mdbg_ring_t *ring, long int len)
 {
+	unsigned long flags;
 	char *wp = NULL;
-
-	WCN_LOG("ring=%p,ring->wp=%p,len=%ld.", ring, ring->wp, len);
+	u32 wr;
 
 	if ((ring == NULL) || (len == 0)) {
 		WCN_ERR("Ring Write Ext Failed,Param Error!\n");
 		return NULL;
 	}
 
-	if (mdbg_ring_over_loop(ring, len, MDBG_RING_R)
+	spin_lock_irqsave(&ring->wlock, flags);
+	wr = ring->ctrl->wr;
+	WCN_LOG("ring=%p,wr=%u,len=%ld.", ring, wr, len);
+	if (mdbg_ring_over_loop(ring, len, MDBG_RING_W)
 			|| mdbg_ring_will_full(ring, len)) {
-		WCN_LOG(
-		"Ring Write Ext Failed,Ring State Error!,overloop=%d,full=%d.",
-		mdbg_ring_over_loop(ring, len, MDBG_RING_R),
-		mdbg_ring_will_full(ring, len));
-		return NULL;
+		WCN_LOG("Ring Write Ext Failed,Ring State Error!");
+	} else {
+		wp = ring->pbuff + wr;
+		smp_store_release(&ring->ctrl->wr,
+				  (wr + len) % ring->size);
 	}
-	MDBG_RING_LOCK(ring);
-	wp = ring->wp;
-	ring->wp += len;
-	WCN_LOG("return wp=%p,ring->wp=%p.", wp, ring->wp);
-	MDBG_RING_UNLOCK(ring);
+	spin_unlock_irqrestore(&ring->wlock, flags);
 
 	return wp;
 }
@@ -337,19 +329,47 @@ inline long int mdbg_ring_readable_len(struct mdbg_ring_t *ring)
 	return ring->size - mdbg_ring_free_space(ring);
 }
 
+/* on the reader side, drops what is not read yet */
 inline void mdbg_ring_clear(struct mdbg_ring_t *ring)
 {
-	ring->rp = ring->wp;
+	smp_store_release(&ring->ctrl->rd, READ_ONCE(ring->ctrl->wr));
 }
 
 inline void mdbg_ring_reset(struct mdbg_ring_t *ring)
 {
-	ring->wp = ring->pbuff;
-	ring->rp = ring->wp;
+	unsigned long flags;
+
+	spin_lock_irqsave(&ring->wlock, flags);
+	WRITE_ONCE(ring->ctrl->rd, 0);
+	smp_store_release(&ring->ctrl->wr, 0);
+	spin_unlock_irqrestore(&ring->wlock, flags);
 }
 
 inline void mdbg_ring_print(struct mdbg_ring_t *ring)
 {
-	WCN_DEBUG("ring buf status:ring->rp=%p,ring->wp=%p.\n",
-				ring->rp, ring->wp);
+	WCN_DEBUG("ring buf status:rd=%u,wr=%u.\n",
+		  READ_ONCE(ring->ctrl->rd), READ_ONCE(ring->ctrl->wr));
+}
+
+/* control page and data read only the way struct mdbg_ring_ctrl says */
+int mdbg_ring_mmap(struct mdbg_ring_t *ring, struct vm_area_struct *vma)
+{
+	unsigned long size = vma->vm_end - vma->vm_start;
+
+	if (vma->vm_pgoff || size > PAGE_SIZE + PAGE_ALIGN(ring->size))
+		return -EINVAL;
+
+	return remap_vmalloc_range(vma, ring->ctrl, 0);
+}
+
+/* for poll(), the reader sets how much it wants to be woken up for */
+bool mdbg_ring_above_watermark(struct mdbg_ring_t *ring)
+{
+	long int len = mdbg_ring_readable_len(ring);
+	u32 mark = READ_ONCE(ring->ctrl->watermark);
+
+	if (!len)
+		return false;
+
+	return len >= min_t(long int, mark, ring->size - 1);
 }
@@ -15,6 +15,10 @@
 
 #include <linux/mutex.h>
 #include <linux/sched.h>
+#include <linux/spinlock.h>
+#include <linux/types.h>
+
+struct vm_area_struct;
 
 #define MDBG_RING_R		0
 #define MDBG_RING_W		1
@@ -23,14 +27,37 @@
 
 #define MDBG_RING_LOCK_SIZE (sizeof(struct mutex))
 
+/*
+ * Control page of a ring, slog_wcn0 maps it followed by the data area:
+ *   offset 0           : struct mdbg_ring_ctrl
+ *   offset data_offset : size bytes of ring data
+ * wr and rd are offsets into the data, wr == rd is empty, the writer
+ * always keeps one byte free. The kernel only moves wr and a reader only
+ * moves rd: read wr with acquire, copy the data, then store rd with
+ * release. poll() on slog_wcn0 only reports POLLIN once watermark bytes
+ * are there, 0 means any.
+ */
+#define MDBG_RING_MAGIC		0x474e524d	/* "MRNG" */
+#define MDBG_RING_VERSION	1
+
+struct mdbg_ring_ctrl {
+	u32 magic;
+	u32 version;
+	u32 size;
+	u32 data_offset;
+	u32 wr;
+	u32 rd;
+	u32 watermark;
+	u32 dropped;		/* bytes thrown away on a full ring */
+};
+
 struct mdbg_ring_t {
 	long int size;
 	char *pbuff;
-	char *rp;
-	char *wp;
 	char *end;
-	/* 0: WP > RP; 1: RP >WP */
-	bool p_order_flag;
+	struct mdbg_ring_ctrl *ctrl;	/* page before pbuff */
+	/* between the writers, the reader never takes it */
+	spinlock_t wlock;
 	struct mutex *plock;
 };
 
@@ -48,5 +75,6 @@ void mdbg_ring_clear(struct mdbg_ring_t *ring);
 void mdbg_ring_reset(struct mdbg_ring_t *ring);
 bool mdbg_ring_over_loop(struct mdbg_ring_t *ring, u_long len, int rw);
 void mdbg_ring_print(struct mdbg_ring_t *ring);
+int mdbg_ring_mmap(struct mdbg_ring_t *ring, struct vm_area_struct *vma);
+bool mdbg_ring_above_watermark(struct mdbg_ring_t *ring);
 #endif
-
@@ -17,6 +17,7 @@
 #include <linux/proc_fs.h>
 #include <linux/sched.h>
 #include <linux/slab.h>
+#include <linux/timer.h>
 #include <linux/types.h>
 #include <linux/wait.h>
 
@@ -57,11 +58,24 @@ struct gnss_ring_t {
 
 struct gnss_device {
 	wait_queue_head_t rxwait;
+	struct timer_list batch_timer;
+	bool batch_flush;
 };
 
 static struct gnss_ring_t *gnss_rx_ring;
 static struct gnss_device *gnss_dev;
 
+/*
+ * slog_gnss readers are woken once batch_bytes are queued, or when the
+ * oldest queued data waited batch_ms, so a tracking session in the
+ * background does not wake the log daemon for every write.
+ * batch_bytes=0 wakes them on every write.
+ */
+static unsigned int gnss_batch_bytes;
+module_param_named(batch_bytes, gnss_batch_bytes, uint, 0644);
+static unsigned int gnss_batch_ms = 1000;
+module_param_named(batch_ms, gnss_batch_ms, uint, 0644);
+
 static unsigned long int gnss_ring_remain(struct gnss_ring_t *pring)
 {
 	return (unsigned long int)GNSS_RING_REMAIN(pring->rp,
@@ -260,6 +274,26 @@ static int gnss_memcpy_wr(char *dest, char *src, size_t count)
 	return copy_from_user(dest, src, count);
 }
 
+static bool gnss_batch_ready(void)
+{
+	unsigned long int len = gnss_ring_content_len(gnss_rx_ring);
+
+	return len && (len >= gnss_batch_bytes || gnss_dev->batch_flush);
+}
+
+static void gnss_batch_arm(void)
+{
+	if (!timer_pending(&gnss_dev->batch_timer))
+		mod_timer(&gnss_dev->batch_timer,
+			  jiffies + msecs_to_jiffies(gnss_batch_ms));
+}
+
+static void gnss_batch_timeout(unsigned long data)
+{
+	gnss_dev->batch_flush = true;
+	wake_up_interruptible(&gnss_dev->rxwait);
+}
+
 static int gnss_device_init(void)
 {
 	gnss_dev = kzalloc(sizeof(*gnss_dev), GFP_KERNEL);
@@ -268,12 +302,14 @@ static int gnss_device_init(void)
 		return -ENOMEM;
 	}
 	init_waitqueue_head(&gnss_dev->rxwait);
+	setup_timer(&gnss_dev->batch_timer, gnss_batch_timeout, 0);
 
 	return 0;
 }
 
 static int gnss_device_destroy(void)
 {
+	del_timer_sync(&gnss_dev->batch_timer);
 	kfree(gnss_dev);
 	gnss_dev = NULL;
 
@@ -308,8 +344,12 @@ static ssize_t gnss_dbg_write(struct file *filp, const char __user *buf,
 	ssize_t len = 0;
 
 	len = gnss_ring_write(gnss_rx_ring, (char *)buf, count);
-	if (len > 0)
-		wake_up_interruptible(&gnss_dev->rxwait);
+	if (len > 0) {
+		if (gnss_batch_ready())
+			wake_up_interruptible(&gnss_dev->rxwait);
+		else
+			gnss_batch_arm();
+	}
 
 	return len;
 }
@@ -335,6 +375,12 @@ static ssize_t gnss_slog_read(struct file *filp, char __user *buf,
 
 	len = gnss_ring_read(gnss_rx_ring, (char *)buf, count);
 
+	/* what is left starts a new batch */
+	if (!gnss_ring_content_len(gnss_rx_ring))
+		gnss_dev->batch_flush = false;
+	else if (!gnss_batch_ready())
+		gnss_batch_arm();
+
 	return len;
 }
 
@@ -363,7 +409,7 @@ static unsigned int gnss_slog_poll(struct file *filp, poll_table *wait)
 	unsigned int mask = 0;
 
 	poll_wait(filp, &gnss_dev->rxwait, wait);
-	if (gnss_ring_content_len(gnss_rx_ring) > 0)
+	if (gnss_batch_ready())
 		mask |= POLLIN | POLLRDNORM;
 
 	return mask;
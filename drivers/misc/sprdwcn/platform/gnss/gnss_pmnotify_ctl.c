@@ -36,6 +36,8 @@
 #include <misc/marlin_platform.h>
 #include "gnss_common.h"
 #define GNSS_DATA_MAX_LEN	16
+/* how long suspend waits for the hal to see gnss_flag_sleep */
+#define GNSS_PM_ACK_TIMEOUT_MS	20
 
 struct sprd_gnss {
 	u32 chip_en;
@@ -43,6 +45,7 @@ struct sprd_gnss {
 	bool gnss_flag_resume;
 	char gnss_status[16];
 	wait_queue_head_t gnss_sleep_wait;
+	wait_queue_head_t gnss_ack_wait;
 };
 
 static struct sprd_gnss gnss_dev;
@@ -61,16 +64,15 @@ static int gnss_pmnotify_ctl_release(struct inode *inode, struct file *filp)
 static int gnss_pm_notify(struct notifier_block *nb,
 			  unsigned long event, void *dummy)
 {
-	int i = 10;
-
 	if (event == PM_SUSPEND_PREPARE) {
+		gnss_delay_cancel = 0;
 		gnss_dev.gnss_flag_sleep = true;
 		wake_up_interruptible(&gnss_dev.gnss_sleep_wait);
-		gnss_delay_cancel = 0;
-		while (gnss_delay_ctl() && (i--) &&
-				(gnss_delay_cancel != 1)) {
-			mdelay(2);
-		}
+		/* sleep instead of spinning until the hal has read the flag */
+		if (gnss_delay_ctl())
+			wait_event_timeout(gnss_dev.gnss_ack_wait,
+				gnss_delay_cancel == 1,
+				msecs_to_jiffies(GNSS_PM_ACK_TIMEOUT_MS));
 	} else
 		gnss_dev.gnss_flag_sleep = false;
 	pr_info("%s event:%ld\n", __func__, event);
@@ -97,6 +99,7 @@ static ssize_t gnss_pmnotify_ctl_read(struct file *filp,
 			  char __user *buf, size_t count, loff_t *pos)
 {
 	gnss_delay_cancel = 1;
+	wake_up(&gnss_dev.gnss_ack_wait);
 
 	return (gnss_dev.gnss_flag_sleep == true) ? 1:0;
 }
@@ -124,8 +127,9 @@ static int __init gnss_pmnotify_ctl_init(void)
 	if (err)
 		pr_err("gnss_pmnotify_ctl_device add failed!!!\n");
 
-	register_pm_notifier(&gnss_pm_notifier);
 	init_waitqueue_head(&gnss_dev.gnss_sleep_wait);
+	init_waitqueue_head(&gnss_dev.gnss_ack_wait);
+	register_pm_notifier(&gnss_pm_notifier);
 
 	return err;
 }
@@ -12,11 +12,13 @@
  */
 
 #include <linux/clk.h>
+#include <linux/crc32.h>
 #include <linux/delay.h>
 #include <linux/fs.h>
 #include <linux/firmware.h>
 #include <linux/file.h>
 #include <linux/kernel.h>
+#include <linux/lz4.h>
 #include <linux/module.h>
 #include <misc/marlin_platform.h>
 #include <linux/mfd/syscon.h>
@@ -413,6 +415,124 @@ static char *load_firmware_data_path(const char *path, loff_t offset,
 	return data;
 }
 
+#ifdef CONFIG_WCN_FW_LZ4
+/*
+ * A region of the image may be stored as a "WCNZ" frame: wcn_fwz_head
+ * followed by block_num blocks, each a wcn_fwz_blk and LZ4 data that
+ * expands to at most block_size (<= PACKET_SIZE) bytes. The crc is the
+ * zlib crc32 of the expanded block. Blocks are expanded straight into
+ * the two bus buffers and checked while the previous block is written.
+ */
+#define WCN_FWZ_MAGIC "WCNZ"
+
+struct wcn_fwz_head {
+	char magic[4];
+	__le32 raw_size;
+	__le32 block_size;
+	__le32 block_num;
+} __packed;
+
+struct wcn_fwz_blk {
+	__le32 comp_len;
+	__le32 crc;
+} __packed;
+
+struct wcn_fwz_write {
+	struct work_struct work;
+	unsigned int addr;
+	void *buf;
+	size_t len;
+	int ret;
+};
+
+static void wcn_fwz_write_work(struct work_struct *work)
+{
+	struct wcn_fwz_write *w = container_of(work, struct wcn_fwz_write,
+					       work);
+
+	w->ret = sprdwcn_bus_direct_write(w->addr, w->buf, w->len);
+}
+
+static int sprdwcn_bus_direct_write_lz4(unsigned int addr, const void *buf,
+		size_t buf_size)
+{
+	const struct wcn_fwz_head *head = buf;
+	u32 raw_size = le32_to_cpu(head->raw_size);
+	u32 block_size = le32_to_cpu(head->block_size);
+	u32 block_num = le32_to_cpu(head->block_num);
+	struct wcn_fwz_write w = { .ret = 0 };
+	size_t pos = sizeof(*head), offset = 0;
+	void *kbuf[2];
+	u32 i, comp_len;
+	int n, ret = 0;
+
+	if (!block_size || block_size > PACKET_SIZE) {
+		WCN_ERR("%s bad block size %u\n", __func__, block_size);
+		return -EINVAL;
+	}
+
+	if (!marlin_dev->zwrite_buffer) {
+		marlin_dev->zwrite_buffer = devm_kzalloc(marlin_dev->dev,
+							 PACKET_SIZE,
+							 GFP_KERNEL);
+		if (!marlin_dev->zwrite_buffer)
+			return -ENOMEM;
+	}
+	kbuf[0] = marlin_dev->write_buffer;
+	kbuf[1] = marlin_dev->zwrite_buffer;
+
+	INIT_WORK_ONSTACK(&w.work, wcn_fwz_write_work);
+	for (i = 0; i < block_num; i++) {
+		const struct wcn_fwz_blk *blk = buf + pos;
+		void *dst = kbuf[i & 1];
+
+		if (pos + sizeof(*blk) > buf_size) {
+			ret = -EBADMSG;
+			break;
+		}
+		pos += sizeof(*blk);
+		comp_len = le32_to_cpu(blk->comp_len);
+		if (comp_len > buf_size - pos) {
+			ret = -EBADMSG;
+			break;
+		}
+
+		/* dst was last written two blocks ago, that write is done */
+		n = LZ4_decompress_safe(buf + pos, dst, comp_len, block_size);
+		if (n <= 0 || offset + n > raw_size ||
+		    (crc32_le(~0, dst, n) ^ ~0) != le32_to_cpu(blk->crc)) {
+			WCN_ERR("%s block %u of %u corrupted\n",
+				__func__, i, block_num);
+			ret = -EBADMSG;
+			break;
+		}
+		pos += comp_len;
+
+		flush_work(&w.work);
+		if (w.ret < 0) {
+			ret = w.ret;
+			break;
+		}
+		w.addr = addr + offset;
+		w.buf = dst;
+		w.len = n;
+		queue_work(system_unbound_wq, &w.work);
+		offset += n;
+	}
+	flush_work(&w.work);
+	destroy_work_on_stack(&w.work);
+
+	if (!ret && w.ret < 0)
+		ret = w.ret;
+	if (!ret && offset != raw_size)
+		ret = -EBADMSG;
+	if (ret < 0)
+		WCN_ERR(" %s: addr 0x%x write error:%d\n", __func__, addr, ret);
+
+	return ret;
+}
+#endif
+
 static int sprdwcn_bus_direct_write_dispack(unsigned int addr, const void *buf,
 		size_t buf_size, size_t packet_max_size)
 {
@@ -420,6 +540,12 @@ static int sprdwcn_bus_direct_write_dispack(unsigned int addr, const void *buf,
 	size_t offset = 0;
 	void *kbuf = marlin_dev->write_buffer;
 
+#ifdef CONFIG_WCN_FW_LZ4
+	if (buf_size > sizeof(struct wcn_fwz_head) &&
+	    bin_magic_is(buf, WCN_FWZ_MAGIC))
+		return sprdwcn_bus_direct_write_lz4(addr, buf, buf_size);
+#endif
+
 	while (offset < buf_size) {
 		size_t temp_size = min(packet_max_size, buf_size - offset);
 
@@ -89,6 +89,8 @@ struct marlin_device {
 	struct completion gnss_download_done;
 	unsigned long power_state;
 	char *write_buffer;
+	/* second bus buffer, only for compressed images */
+	char *zwrite_buffer;
 	struct delayed_work power_wq;
 	struct work_struct download_wq;
 	struct work_struct gnss_dl_wq;
@@ -28,6 +28,108 @@
 #include "mdbg_type.h"
 #include "../include/wcn_dbg.h"
 
+/*
+ * The dump is snapshotted from the chip into kernel memory and handed to
+ * the log ring by a worker, so mdbg_dump_mem() returns as soon as the
+ * chip has been read and a reset no longer waits for userspace to drain
+ * the ring. Chunks are queued in order, the ring sees the same stream as
+ * before.
+ */
+struct wcn_dump_chunk {
+	struct list_head list;
+	unsigned int len;
+	/* last chunk of a dump, wake up the dumpmem waiter after it */
+	bool finish;
+	unsigned char data[0];
+};
+
+static LIST_HEAD(wcn_dump_queue);
+static DEFINE_SPINLOCK(wcn_dump_lock);
+
+/* write into the log ring, waits for the reader while it is full */
+static void wcn_dump_ring_write(unsigned char *buf, int len)
+{
+	int temp_len;
+
+	temp_len = mdbg_ring_free_space(mdbg_dev->ring_dev->ring) - 1;
+	if (temp_len < len) {
+		wake_up_log_wait();
+
+		if (temp_len > 0)
+			mdbg_ring_write(mdbg_dev->ring_dev->ring,
+					buf, temp_len);
+		if (temp_len < 0) {
+			WCN_ERR("ringbuf data error\n");
+			return;
+		}
+		buf += temp_len;
+		len -= temp_len;
+		wake_up_log_wait();
+	}
+	while ((mdbg_ring_free_space(mdbg_dev->ring_dev->ring) - 1 == 0)
+		&& (mdbg_dev->open_count != 0)) {
+		WCN_ERR("no space buf to write mem, sleep...\n");
+		wake_up_log_wait();
+		msleep(20);
+	}
+
+	mdbg_ring_write(mdbg_dev->ring_dev->ring, buf, len);
+	wake_up_log_wait();
+}
+
+static void wcn_dump_drain(struct work_struct *work)
+{
+	struct wcn_dump_chunk *chunk;
+
+	for (;;) {
+		spin_lock(&wcn_dump_lock);
+		chunk = list_first_entry_or_null(&wcn_dump_queue,
+						 struct wcn_dump_chunk, list);
+		if (chunk)
+			list_del(&chunk->list);
+		spin_unlock(&wcn_dump_lock);
+		if (!chunk)
+			break;
+
+		if (chunk->finish) {
+			/* only string "marlin_memdump_finish" to slog once */
+			msleep(40);
+			wcn_dump_ring_write(chunk->data, chunk->len);
+			WCN_INFO("mdbg dump memory finish\n");
+			if ((functionmask[7] & CP2_FLAG_YLOG) == 1)
+				complete(&dumpmem_complete);
+		} else {
+			wcn_dump_ring_write(chunk->data, chunk->len);
+		}
+		kfree(chunk);
+	}
+}
+
+static DECLARE_WORK(wcn_dump_work, wcn_dump_drain);
+
+static void wcn_dump_put(void *buf, int len, bool finish)
+{
+	struct wcn_dump_chunk *chunk;
+
+	chunk = kmalloc(sizeof(*chunk) + len, GFP_KERNEL);
+	if (!chunk) {
+		/* keep the order, write it out behind the queued chunks */
+		flush_work(&wcn_dump_work);
+		wcn_dump_ring_write(buf, len);
+		if (finish && (functionmask[7] & CP2_FLAG_YLOG) == 1)
+			complete(&dumpmem_complete);
+		return;
+	}
+
+	memcpy(chunk->data, buf, len);
+	chunk->len = len;
+	chunk->finish = finish;
+	spin_lock(&wcn_dump_lock);
+	list_add_tail(&chunk->list, &wcn_dump_queue);
+	spin_unlock(&wcn_dump_lock);
+	queue_work(system_unbound_wq, &wcn_dump_work);
+}
+
 static int smp_calc_chsum(unsigned short *buf, unsigned int size)
 {
 	unsigned long int cksum = 0;
@@ -83,7 +185,7 @@ static int mdbg_write_smp_head(unsigned int len)
 	((struct sme_head_tag *)tmp)->type = SMP_DSP_TYPE;
 	((struct sme_head_tag *)tmp)->subtype = SMP_DSP_DUMP_TYPE;
 
-	mdbg_ring_write(mdbg_dev->ring_dev->ring, smp_buf, smp_len);
+	wcn_dump_put(smp_buf, smp_len, false);
 
 	kfree(smp_buf);
 
@@ -164,33 +266,8 @@ static int mdbg_dump_data(unsigned int start_addr,
 		if (mdbg_dev->ring_dev->flag_smp == 1)
 			mdbg_write_smp_head(trans_size);
 
-		temp_len
-			= mdbg_ring_free_space(mdbg_dev->ring_dev->ring) - 1;
-		if (temp_len < trans_size) {
-			wake_up_log_wait();
-
-			if (temp_len > 0)
-				mdbg_ring_write(mdbg_dev->ring_dev->ring,
-						temp_buf, temp_len);
-			if (temp_len < 0) {
-				WCN_ERR("ringbuf data error\n");
-				return 0;
-			}
-			temp_buf += temp_len;
-			trans_size -= temp_len;
-			count += temp_len;
-			wake_up_log_wait();
-		}
-		while ((mdbg_ring_free_space(mdbg_dev->ring_dev->ring) - 1 == 0)
-			&& (mdbg_dev->open_count != 0)) {
-			WCN_ERR("no space buf to write mem, sleep...\n");
-			wake_up_log_wait();
-			msleep(20);
-		}
-
-		mdbg_ring_write(mdbg_dev->ring_dev->ring, temp_buf, trans_size);
+		wcn_dump_put(temp_buf, trans_size, false);
 		count += trans_size;
-		wake_up_log_wait();
 	}
 
 out:
@@ -201,11 +278,10 @@ out:
 
 static void mdbg_clear_log(void)
 {
-	if (mdbg_dev->ring_dev->ring->rp
-		!= mdbg_dev->ring_dev->ring->wp) {
-		WCN_INFO("log:%ld left in ringbuf not read\n",
-			 (long)(mdbg_dev->ring_dev->ring->wp
-		- mdbg_dev->ring_dev->ring->rp));
+	long len = mdbg_ring_readable_len(mdbg_dev->ring_dev->ring);
+
+	if (len) {
+		WCN_INFO("log:%ld left in ringbuf not read\n", len);
 		mdbg_ring_clear(mdbg_dev->ring_dev->ring);
 	}
 }
@@ -344,23 +420,12 @@ static int wcn_fill_dump_head_info(struct wcn_dump_mem_reg *mem_cfg, int cnt)
 	}
 	head->file_size = cpu_to_le32(len + strlen(WCN_DUMP_END_STRING));
 
-	mdbg_ring_write(mdbg_dev->ring_dev->ring, head, head_len);
-	wake_up_log_wait();
+	wcn_dump_put(head, head_len, false);
 	kfree(head);
 
 	return 0;
 }
 
-static void mdbg_dump_str(char *str, int str_len)
-{
-	if (!str)
-		return;
-
-	mdbg_ring_write(mdbg_dev->ring_dev->ring, str, str_len);
-	wake_up_log_wait();
-	WCN_INFO("dump str finish!");
-}
-
 /*
  * dump cp wifi phy reg
  * wifi phy start[11,17]
@@ -1160,6 +1225,8 @@ pcie_next:
 	swd_dump_arm_reg();
 #endif
 
+	/* the previous dump must be out before the ring is cleared */
+	flush_work(&wcn_dump_work);
 	mdbg_clear_log();
 	/* mdbg_atcmd_clean(); */
 	cp_dcache_clean_invalid_all();
@@ -1427,13 +1494,8 @@ next:
 	}
 
 end:
-	/* Make sure only string "marlin_memdump_finish" to slog one time */
-	msleep(40);
-
-	mdbg_dump_str(WCN_DUMP_END_STRING, strlen(WCN_DUMP_END_STRING));
-	WCN_INFO("mdbg dump memory finish\n");
-	if ((functionmask[7] & CP2_FLAG_YLOG) == 1)
-		complete(&dumpmem_complete);
+	wcn_dump_put(WCN_DUMP_END_STRING, strlen(WCN_DUMP_END_STRING), true);
+	WCN_INFO("mdbg dump memory snapshot done\n");
 
 	return 0;
 }
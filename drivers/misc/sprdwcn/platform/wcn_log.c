@@ -39,11 +39,10 @@ int wake_up_log_wait(void)
 
 void wcnlog_clear_log(void)
 {
-	if (mdbg_dev->ring_dev->ring->rp
-		!= mdbg_dev->ring_dev->ring->wp) {
-		WCN_INFO("log:%ld left in ringbuf not read\n",
-			(long int)(mdbg_dev->ring_dev->ring->wp -
-			mdbg_dev->ring_dev->ring->rp));
+	long int len = mdbg_ring_readable_len(mdbg_dev->ring_dev->ring);
+
+	if (len) {
+		WCN_INFO("log:%ld left in ringbuf not read\n", len);
 		mdbg_ring_clear(mdbg_dev->ring_dev->ring);
 	}
 }
@@ -201,12 +200,31 @@ static unsigned int wcnlog_poll(struct file *filp, poll_table *wait)
 		return mask;
 	}
 	poll_wait(filp, &mdbg_dev->rxwait, wait);
-	if (mdbg_content_len() > 0)
+	if (mdbg_content_ready())
 		mask |= POLLIN | POLLRDNORM;
 
 	return mask;
 }
 
+/*
+ * slog_wcn0 only: the ring control page and the log, see bufring.h. The
+ * reader consumes by moving rd in the control page.
+ */
+static int wcnlog_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct wcnlog_dev *dev = filp->private_data;
+
+	if (mdbg_dev->exit_flag) {
+		WCN_ERR("%s exit!\n", __func__);
+		return -EIO;
+	}
+
+	if (MINOR(dev->cdev.dev) != 0)
+		return -EPERM;
+
+	return mdbg_content_mmap(vma);
+}
+
 static long wcnlog_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 {
 	if (mdbg_dev->exit_flag) {
@@ -223,6 +241,7 @@ static const struct file_operations wcnlog_fops = {
 	.read		= wcnlog_read,
 	.write		= wcnlog_write,
 	.poll		= wcnlog_poll,
+	.mmap		= wcnlog_mmap,
 	.unlocked_ioctl	= wcnlog_ioctl,
 	.owner		= THIS_MODULE,
 	.llseek		= default_llseek,
@@ -102,6 +102,23 @@ long mdbg_content_len(void)
 	return mdbg_ring_readable_len(ring_dev->ring);
 }
 
+/* enough log for poll(), as much as the reader asked for */
+bool mdbg_content_ready(void)
+{
+	if (unlikely(!ring_dev))
+		return false;
+
+	return mdbg_ring_above_watermark(ring_dev->ring);
+}
+
+int mdbg_content_mmap(struct vm_area_struct *vma)
+{
+	if (unlikely(!ring_dev))
+		return -ENODEV;
+
+	return mdbg_ring_mmap(ring_dev->ring, vma);
+}
+
 static long int mdbg_comm_write(char *buf,
 				long int len, unsigned int subtype)
 {
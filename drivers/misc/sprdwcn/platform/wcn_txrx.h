@@ -120,6 +120,8 @@ enum {
 
 extern struct mchn_ops_t mdbg_proc_ops[MDBG_ASSERT_RX_OPS + 1];
 
+struct vm_area_struct;
+
 void mdbg_pt_ring_reg(void);
 void mdbg_pt_ring_unreg(void);
 int mdbg_ring_init(void);
@@ -129,6 +131,8 @@ long int mdbg_receive(void *buf, long int len);
 int mdbg_tx_cb(int channel, struct mbuf_t *head,
 	       struct mbuf_t *tail, int num);
 long mdbg_content_len(void);
+bool mdbg_content_ready(void);
+int mdbg_content_mmap(struct vm_area_struct *vma);
 int mdbg_read_release(unsigned int fifo_id);
 bool mdbg_rx_count_change(void);
 
@@ -5,6 +5,7 @@
 #include <linux/device.h>
 #include <linux/scatterlist.h>
 #include <linux/slab.h>
+#include <linux/wait.h>
 #include <misc/wcn_bus.h>
 #include <uapi/linux/sched/types.h>
 
@@ -208,6 +209,11 @@ struct sdiohal_data_t {
 	spinlock_t rx_spinlock;
 	atomic_t flag_resume;
 	atomic_t tx_mbuf_num;
+	/* bytes packed by the queued tx nodes, under tx_spinlock */
+	unsigned int tx_pend_len;
+	/* a low latency channel has queued data */
+	atomic_t tx_urgent;
+	wait_queue_head_t tx_aggr_wq;
 	atomic_t xmit_cnt;
 	bool exit_flag;
 	/* adma enable:1, disable:0 */
@@ -274,6 +280,7 @@ void sdiohal_tx_down(void);
 void sdiohal_tx_up(void);
 void sdiohal_rx_down(void);
 void sdiohal_rx_up(void);
+bool sdiohal_tx_aggr_ready(void);
 int sdiohal_tx_thread(void *data);
 int sdiohal_rx_thread(void *data);
 
@@ -330,7 +337,7 @@ struct sdiohal_list_t *sdiohal_get_rx_mbuf_list(int num);
 struct sdiohal_list_t *sdiohal_get_rx_mbuf_node(int num);
 int sdiohal_rx_list_dispatch(void);
 struct sdiohal_list_t *sdiohal_get_rx_channel_list(int channel);
-void *sdiohal_get_rx_free_buf(void);
+void *sdiohal_get_rx_free_buf(unsigned int len);
 void sdiohal_tx_init_retrybuf(void);
 int sdiohal_misc_init(void);
 void sdiohal_misc_deinit(void);
@@ -163,6 +163,7 @@ static void sdiohal_completion_init(void)
 	init_completion(&p_data->tx_completed);
 	init_completion(&p_data->rx_completed);
 	init_completion(&p_data->scan_done);
+	init_waitqueue_head(&p_data->tx_aggr_wq);
 }
 
 void sdiohal_lock_tx_ws(void)
@@ -487,7 +488,8 @@ int sdiohal_tx_set_eof(struct sdiohal_sendbuf_t *send_buf,
 }
 
 static int sdiohal_tx_fill_puh(int channel, struct mbuf_t *head,
-			       struct mbuf_t *tail, int num)
+			       struct mbuf_t *tail, int num,
+			       unsigned int *len)
 {
 	struct sdio_puh_t *puh = NULL;
 	struct mbuf_t *mbuf_node;
@@ -511,6 +513,8 @@ static int sdiohal_tx_fill_puh(int channel, struct mbuf_t *head,
 		puh->len = mbuf_node->len;
 		puh->eof = 0;
 		puh->pad = 0;
+		*len += sizeof(struct sdio_puh_t) +
+			SDIOHAL_ALIGN_4BYTE(mbuf_node->len);
 	}
 
 	return 0;
@@ -520,8 +524,10 @@ void sdiohal_tx_list_enq(int channel, struct mbuf_t *head,
 			 struct mbuf_t *tail, int num)
 {
 	struct sdiohal_data_t *p_data = sdiohal_get_data();
+	struct mchn_ops_t *ops = chn_ops(channel);
+	unsigned int len = 0;
 
-	sdiohal_tx_fill_puh(channel, head, tail, num);
+	sdiohal_tx_fill_puh(channel, head, tail, num, &len);
 
 	spin_lock_bh(&p_data->tx_spinlock);
 	if (atomic_read(&p_data->tx_mbuf_num) == 0)
@@ -531,14 +537,21 @@ void sdiohal_tx_list_enq(int channel, struct mbuf_t *head,
 	p_data->tx_list_head.mbuf_tail = tail;
 	p_data->tx_list_head.mbuf_tail->next = NULL;
 	p_data->tx_list_head.node_num += num;
+	p_data->tx_pend_len += len;
 	sdiohal_atomic_add(num, &p_data->tx_mbuf_num);
 	spin_unlock_bh(&p_data->tx_spinlock);
+
+	if (ops && ops->low_latency)
+		atomic_set(&p_data->tx_urgent, 1);
+	if (sdiohal_tx_aggr_ready())
+		wake_up(&p_data->tx_aggr_wq);
 }
 
 void sdiohal_tx_find_data_list(struct sdiohal_list_t *data_list)
 {
 	struct sdiohal_data_t *p_data = sdiohal_get_data();
 	struct mbuf_t *mbuf_node;
+	unsigned int len = 0;
 	int num, i;
 
 	spin_lock_bh(&p_data->tx_spinlock);
@@ -547,8 +560,12 @@ void sdiohal_tx_find_data_list(struct sdiohal_list_t *data_list)
 		num = MAX_CHAIN_NODE_NUM;
 
 	mbuf_node = p_data->tx_list_head.mbuf_head;
-	for (i = 1; i < num; i++)
-		mbuf_node = mbuf_node->next;
+	for (i = 0; i < num; i++) {
+		len += sizeof(struct sdio_puh_t) +
+			SDIOHAL_ALIGN_4BYTE(mbuf_node->len);
+		if (i < num - 1)
+			mbuf_node = mbuf_node->next;
+	}
 
 	data_list->mbuf_head = p_data->tx_list_head.mbuf_head;
 	data_list->mbuf_tail = mbuf_node;
@@ -559,8 +576,11 @@ void sdiohal_tx_find_data_list(struct sdiohal_list_t *data_list)
 	if (atomic_read(&p_data->tx_mbuf_num) == 0) {
 		p_data->tx_list_head.mbuf_head = NULL;
 		p_data->tx_list_head.mbuf_tail = NULL;
-	} else
+		p_data->tx_pend_len = 0;
+	} else {
+		p_data->tx_pend_len -= min(len, p_data->tx_pend_len);
 		p_data->tx_list_head.mbuf_head = mbuf_node->next;
+	}
 	data_list->mbuf_tail->next = NULL;
 	spin_unlock_bh(&p_data->tx_spinlock);
 	sdiohal_list_check(data_list, __func__, SDIOHAL_WRITE);
@@ -964,13 +984,15 @@ err:
 	return NULL;
 }
 
-/* for normal dma idle buf */
-void *sdiohal_get_rx_free_buf(void)
+/*
+ * for normal dma idle buf, only the length about to be read is carved
+ * out of the frag page so that many reads share one high order page
+ */
+void *sdiohal_get_rx_free_buf(unsigned int len)
 {
 	void *p;
 
-	p = sdiohal_alloc_frag(SDIOHAL_RX_RECVBUF_LEN,
-			GFP_ATOMIC | __GFP_COLD);
+	p = sdiohal_alloc_frag(ALIGN(len, 64), GFP_ATOMIC | __GFP_COLD);
 
 	WARN_ON(((unsigned long int)p) % 64);
 
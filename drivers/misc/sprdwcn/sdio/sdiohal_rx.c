@@ -1,6 +1,19 @@
+#include <linux/average.h>
+#include <linux/moduleparam.h>
+
 #include "sdiohal.h"
 #include "sdiohal_dbg.h"
 
+/*
+ * The first read after an rx irq has no dtbs from the cp yet. Size it
+ * from the average length of the recent rx bursts, so bulk traffic is
+ * picked up in one transfer instead of MAX_PAC_SIZE plus a second read.
+ */
+DECLARE_EWMA(sdiohal_rx_len, 4, 8)
+static struct ewma_sdiohal_rx_len sdiohal_rx_len_avg;
+static bool sdiohal_rx_predict = true;
+module_param_named(rx_predict, sdiohal_rx_predict, bool, 0644);
+
 static unsigned int sdiohal_rx_adapt_get(void)
 {
 	struct sdiohal_data_t *p_data = sdiohal_get_data();
@@ -14,8 +27,12 @@ static void sdiohal_rx_adapt_set_dtbs(unsigned int len)
 	unsigned int off;
 
 	if (len == 0) {
-		p_data->dtbs = MAX_PAC_SIZE;
-		return;
+		if (sdiohal_rx_predict)
+			len = ewma_sdiohal_rx_len_read(&sdiohal_rx_len_avg);
+		if (len <= MAX_PAC_SIZE) {
+			p_data->dtbs = MAX_PAC_SIZE;
+			return;
+		}
 	}
 
 	off = (len >> 10) + 1;
@@ -24,6 +41,21 @@ static void sdiohal_rx_adapt_set_dtbs(unsigned int len)
 			SDIOHAL_RX_RECVBUF_LEN : len;
 }
 
+/* account one read, a burst ends when the cp has nothing more queued */
+static void sdiohal_rx_adapt_burst(unsigned int *burst_len,
+				   unsigned int valid_len,
+				   unsigned int rx_dtbs)
+{
+	*burst_len += min_t(unsigned int, valid_len, SDIOHAL_RX_RECVBUF_LEN);
+	if (rx_dtbs)
+		return;
+
+	ewma_sdiohal_rx_len_add(&sdiohal_rx_len_avg,
+				min_t(unsigned int, *burst_len,
+				      SDIOHAL_RX_RECVBUF_LEN));
+	*burst_len = 0;
+}
+
 static unsigned int sdiohal_rx_adapt_get_pac_num(void)
 {
 	struct sdiohal_data_t *p_data = sdiohal_get_data();
@@ -193,6 +225,7 @@ int sdiohal_rx_thread(void *data)
 	int ret = 0;
 	unsigned int rx_dtbs = 0;
 	unsigned int valid_len = 0;
+	unsigned int burst_len = 0;
 	static char *rx_buf;
 	struct sdiohal_list_t *data_list = NULL;
 	struct timespec tm_begin, tm_end;
@@ -201,6 +234,7 @@ int sdiohal_rx_thread(void *data)
 
 	param.sched_priority = SDIO_RX_TASK_PRIO;
 	sched_setscheduler(current, SCHED_FIFO, &param);
+	ewma_sdiohal_rx_len_init(&sdiohal_rx_len_avg);
 	sdiohal_rx_adapt_set_dtbs(0);
 	sdiohal_rx_adapt_set_pac_num(1);
 
@@ -270,7 +304,7 @@ read_again:
 				__func__, read_len,
 				p_data->adma_rx_enable);
 
-			rx_buf = sdiohal_get_rx_free_buf();
+			rx_buf = sdiohal_get_rx_free_buf(read_len);
 			if (!rx_buf) {
 				WCN_ERR("sdiohal_get_rx_free_buf fail\n");
 				goto submit_list;
@@ -280,6 +314,7 @@ read_again:
 			if (ret != 0) {
 				WCN_ERR("sdio pt read fail ret:%d\n", ret);
 				rx_dtbs = 0;
+				burst_len = 0;
 				goto submit_list;
 			}
 			rx_dtbs = *((unsigned int *)(rx_buf + (read_len - 4)));
@@ -288,6 +323,7 @@ read_again:
 			sdiohal_debug("%s rx_dtbs:%d,valid len:%d\n",
 				__func__, rx_dtbs, valid_len);
 			sdiohal_rx_buf_parser(rx_buf, valid_len);
+			sdiohal_rx_adapt_burst(&burst_len, valid_len, rx_dtbs);
 		}
 
 submit_list:
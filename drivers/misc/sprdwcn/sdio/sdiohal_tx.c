@@ -1,9 +1,49 @@
+#include <linux/moduleparam.h>
+
 #include "sdiohal.h"
 #include "sdiohal_dbg.h"
 
 #define SDIOHAL_TX_RETRY_MAX 3
 #define SDIOHAL_TX_NO_RETRY
 
+/*
+ * Bulk tx is held back for up to tx_aggr_us so that a burst of at least
+ * tx_aggr_blks sdio blocks goes out in one transfer. Data queued on a
+ * low_latency channel skips the wait, tx_aggr_us=0 turns it off.
+ */
+static unsigned int sdiohal_tx_aggr_us = 100;
+module_param_named(tx_aggr_us, sdiohal_tx_aggr_us, uint, 0644);
+static unsigned int sdiohal_tx_aggr_blks = 8;
+module_param_named(tx_aggr_blks, sdiohal_tx_aggr_blks, uint, 0644);
+
+bool sdiohal_tx_aggr_ready(void)
+{
+	struct sdiohal_data_t *p_data = sdiohal_get_data();
+	unsigned int len;
+
+	if (!sdiohal_tx_aggr_us || p_data->exit_flag ||
+	    atomic_read(&p_data->tx_urgent) ||
+	    atomic_read(&p_data->tx_mbuf_num) >= MAX_CHAIN_NODE_NUM)
+		return true;
+
+	len = min_t(unsigned int, sdiohal_tx_aggr_blks * SDIOHAL_BLK_SIZE,
+		    SDIOHAL_TX_SENDBUF_LEN - sizeof(struct sdio_puh_t));
+
+	return READ_ONCE(p_data->tx_pend_len) >= len;
+}
+
+static void sdiohal_tx_aggr_wait(void)
+{
+	struct sdiohal_data_t *p_data = sdiohal_get_data();
+
+	if (sdiohal_is_tx_list_empty() || sdiohal_tx_aggr_ready())
+		return;
+
+	wait_event_hrtimeout(p_data->tx_aggr_wq, sdiohal_tx_aggr_ready(),
+			     ns_to_ktime((u64)sdiohal_tx_aggr_us *
+					 NSEC_PER_USEC));
+}
+
 static void sdiohal_tx_retrybuf_left(unsigned int suc_pac_cnt)
 {
 	struct sdiohal_data_t *p_data = sdiohal_get_data();
@@ -148,6 +188,8 @@ int sdiohal_tx_thread(void *data)
 		if (p_data->exit_flag)
 			break;
 
+		sdiohal_tx_aggr_wait();
+
 		getnstimeofday(&p_data->tm_end_sch);
 		sdiohal_pr_perf("tx sch time:%ld\n",
 			(long)(timespec_to_ns(&p_data->tm_end_sch) -
@@ -162,6 +204,7 @@ int sdiohal_tx_thread(void *data)
 		while (!sdiohal_is_tx_list_empty()) {
 			getnstimeofday(&tm_begin);
 
+			atomic_set(&p_data->tx_urgent, 0);
 			sdiohal_tx_find_data_list(&data_list);
 			if (p_data->adma_tx_enable) {
 				sdiohal_adma_pt_write(&data_list);
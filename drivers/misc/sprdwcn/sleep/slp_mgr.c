@@ -16,6 +16,7 @@
  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
  * GNU General Public License for more details.
  */
+#include <linux/debugfs.h>
 #include <linux/init.h>
 #include <linux/interrupt.h>
 #include <linux/irq.h>
@@ -26,6 +27,7 @@
 #include <linux/of_gpio.h>
 #include <linux/of_device.h>
 #include <linux/platform_device.h>
+#include <linux/seq_file.h>
 #include <linux/spinlock.h>
 
 #include <misc/wcn_bus.h>
@@ -42,6 +44,51 @@ struct slp_mgr_t *slp_get_info(void)
 	return &slp_mgr;
 }
 
+/* called with drv_slp_lock held */
+void slp_mgr_enter_sleep(void)
+{
+	ktime_t now;
+	bool awake;
+
+	awake = atomic_read(&(slp_mgr.cp2_state)) == STAY_AWAKING;
+	slp_allow_sleep();
+	atomic_set(&(slp_mgr.cp2_state), STAY_SLPING);
+	if (!awake)
+		return;
+
+	now = ktime_get();
+	slp_mgr.slp_time = now;
+	slp_mgr.stats.sleep_cnt++;
+	slp_mgr.stats.awake_us += ktime_us_delta(now, slp_mgr.wake_time);
+}
+
+static void slp_mgr_slp_work(struct work_struct *work)
+{
+	mutex_lock(&(slp_mgr.drv_slp_lock));
+	if (slp_mgr.active_module == 0 &&
+	    atomic_read(&(slp_mgr.cp2_state)) == STAY_AWAKING)
+		slp_mgr_enter_sleep();
+	mutex_unlock(&(slp_mgr.drv_slp_lock));
+}
+
+/* cp2 woke up from sleep, see how long it got to stay there */
+static void slp_mgr_update_holdoff(ktime_t now)
+{
+	s64 slept_ms = ktime_ms_delta(now, slp_mgr.slp_time);
+	unsigned int holdoff = slp_mgr.holdoff;
+
+	if (!slp_mgr.holdoff_ms)
+		return;
+
+	if (slept_ms < slp_mgr.holdoff_max_ms)
+		holdoff = holdoff * 2;
+	else
+		holdoff = holdoff / 2;
+	slp_mgr.holdoff = clamp_t(unsigned int, holdoff, slp_mgr.holdoff_ms,
+				  max(slp_mgr.holdoff_ms,
+				      slp_mgr.holdoff_max_ms));
+}
+
 void slp_mgr_drv_sleep(enum slp_subsys subsys, bool enable)
 {
 	mutex_lock(&(slp_mgr.drv_slp_lock));
@@ -49,10 +96,18 @@ void slp_mgr_drv_sleep(enum slp_subsys subsys, bool enable)
 		slp_mgr.active_module &= ~(BIT(subsys));
 	else
 		slp_mgr.active_module |= (BIT(subsys));
+
+	/* a new user within the hold-off skips the wake handshake */
+	if (!enable && cancel_delayed_work(&slp_mgr.slp_work))
+		slp_mgr.stats.holdoff_hit++;
+
 	if ((slp_mgr.active_module == 0) &&
 		(subsys > PACKER_DT_RX)) {
-		slp_allow_sleep();
-		atomic_set(&(slp_mgr.cp2_state), STAY_SLPING);
+		if (slp_mgr.holdoff_ms)
+			mod_delayed_work(system_wq, &slp_mgr.slp_work,
+					 msecs_to_jiffies(slp_mgr.holdoff));
+		else
+			slp_mgr_enter_sleep();
 	}
 	mutex_unlock(&(slp_mgr.drv_slp_lock));
 }
@@ -62,12 +117,14 @@ int slp_mgr_wakeup(enum slp_subsys subsys)
 	unsigned char slp_sts;
 	int ret;
 	int do_dump = 0;
-	ktime_t time_end;
+	ktime_t time_start, time_end;
+	u32 wake_us;
 
 	mutex_lock(&(slp_mgr.wakeup_lock));
 	if (STAY_SLPING == (atomic_read(&(slp_mgr.cp2_state)))) {
 		ap_wakeup_cp();
-		time_end = ktime_add_ms(ktime_get(), 5);
+		time_start = ktime_get();
+		time_end = ktime_add_ms(time_start, 5);
 		while (1) {
 			ret = sprdwcn_bus_aon_readb(REG_BTWF_SLP_STS, &slp_sts);
 			if (ret < 0) {
@@ -89,6 +146,8 @@ try_timeout:
 				atomic_set(&(slp_mgr.cp2_state), STAY_AWAKING);
 				WCN_INFO("wakeup fail, slp_sts-0x%x\n",
 					 slp_sts);
+				slp_mgr.stats.wake_fail++;
+				slp_mgr.wake_time = ktime_get();
 				sdiohal_dump_aon_reg();
 				mutex_unlock(&(slp_mgr.wakeup_lock));
 				return -1;
@@ -98,6 +157,13 @@ try_timeout:
 		}
 
 		atomic_set(&(slp_mgr.cp2_state), STAY_AWAKING);
+		slp_mgr.wake_time = ktime_get();
+		wake_us = ktime_us_delta(slp_mgr.wake_time, time_start);
+		slp_mgr.stats.wake_cnt++;
+		slp_mgr.stats.wake_us += wake_us;
+		slp_mgr.stats.wake_max_us = max(slp_mgr.stats.wake_max_us,
+						wake_us);
+		slp_mgr_update_holdoff(time_start);
 	}
 
 	mutex_unlock(&(slp_mgr.wakeup_lock));
@@ -108,10 +174,47 @@ try_timeout:
 /* called after chip power on, and reset sleep status */
 void slp_mgr_reset(void)
 {
+	cancel_delayed_work_sync(&slp_mgr.slp_work);
 	atomic_set(&(slp_mgr.cp2_state), STAY_AWAKING);
+	slp_mgr.wake_time = ktime_get();
+	slp_mgr.holdoff = slp_mgr.holdoff_ms;
 	reinit_completion(&(slp_mgr.wakeup_ack_completion));
 }
 
+static int slp_mgr_stats_show(struct seq_file *m, void *v)
+{
+	struct slp_mgr_stats *s = &slp_mgr.stats;
+
+	seq_printf(m, "cp2_state: %s\n",
+		   atomic_read(&(slp_mgr.cp2_state)) == STAY_SLPING ?
+		   "sleep" : "awake");
+	seq_printf(m, "active_module: 0x%x\n", slp_mgr.active_module);
+	seq_printf(m, "holdoff: %u ms\n", slp_mgr.holdoff);
+	seq_printf(m, "wake_cnt: %llu\n", s->wake_cnt);
+	seq_printf(m, "wake_fail: %llu\n", s->wake_fail);
+	seq_printf(m, "wake_avg_us: %llu\n",
+		   s->wake_cnt ? div64_u64(s->wake_us, s->wake_cnt) : 0);
+	seq_printf(m, "wake_max_us: %u\n", s->wake_max_us);
+	seq_printf(m, "holdoff_hit: %llu\n", s->holdoff_hit);
+	seq_printf(m, "sleep_cnt: %llu\n", s->sleep_cnt);
+	seq_printf(m, "awake_ms: %llu\n", div_u64(s->awake_us, 1000));
+
+	return 0;
+}
+
+static int slp_mgr_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, slp_mgr_stats_show, NULL);
+}
+
+static const struct file_operations slp_mgr_stats_fops = {
+	.owner = THIS_MODULE,
+	.open = slp_mgr_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 int slp_mgr_init(void)
 {
 	WCN_INFO("%s enter\n", __func__);
@@ -120,6 +223,22 @@ int slp_mgr_init(void)
 	mutex_init(&(slp_mgr.drv_slp_lock));
 	mutex_init(&(slp_mgr.wakeup_lock));
 	init_completion(&(slp_mgr.wakeup_ack_completion));
+	INIT_DELAYED_WORK(&slp_mgr.slp_work, slp_mgr_slp_work);
+	slp_mgr.holdoff_ms = SLP_MGR_HOLDOFF_MS;
+	slp_mgr.holdoff_max_ms = SLP_MGR_HOLDOFF_MAX_MS;
+	slp_mgr.holdoff = slp_mgr.holdoff_ms;
+	slp_mgr.wake_time = ktime_get();
+	memset(&slp_mgr.stats, 0, sizeof(slp_mgr.stats));
+
+	slp_mgr.debug_root = debugfs_create_dir("wcn_slp", NULL);
+	if (!IS_ERR_OR_NULL(slp_mgr.debug_root)) {
+		debugfs_create_file("stats", 0444, slp_mgr.debug_root, NULL,
+				    &slp_mgr_stats_fops);
+		debugfs_create_u32("holdoff_ms", 0644, slp_mgr.debug_root,
+				   &slp_mgr.holdoff_ms);
+		debugfs_create_u32("holdoff_max_ms", 0644, slp_mgr.debug_root,
+				   &slp_mgr.holdoff_max_ms);
+	}
 	slp_pub_int_regcb();
 #ifdef SLP_MGR_TEST
 	slp_test_init();
@@ -134,6 +253,9 @@ EXPORT_SYMBOL(slp_mgr_init);
 int slp_mgr_deinit(void)
 {
 	WCN_INFO("%s enter\n", __func__);
+	debugfs_remove_recursive(slp_mgr.debug_root);
+	slp_mgr.debug_root = NULL;
+	cancel_delayed_work_sync(&slp_mgr.slp_work);
 	atomic_set(&(slp_mgr.cp2_state), STAY_SLPING);
 	slp_mgr.active_module = 0;
 	mutex_destroy(&(slp_mgr.drv_slp_lock));
@@ -17,6 +17,8 @@
 #define __SLP_MGR_H__
 
 #include <linux/completion.h>
+#include <linux/ktime.h>
+#include <linux/workqueue.h>
 #include <misc/marlin_platform.h>
 
 #define SLP_MGR_HEADER "[slp_mgr]"
@@ -31,12 +33,40 @@
 #define	STAY_SLPING		0
 #define	STAY_AWAKING	1
 
+/*
+ * After the last user is gone cp2 is kept awake for holdoff ms, so
+ * back to back small transfers share one wake handshake. holdoff moves
+ * between holdoff_ms and holdoff_max_ms: it doubles when cp2 had to be
+ * woken again shortly after it went to sleep and halves when it slept
+ * long enough. holdoff_ms 0 lets cp2 sleep at once.
+ */
+#define SLP_MGR_HOLDOFF_MS	2
+#define SLP_MGR_HOLDOFF_MAX_MS	20
+
+struct slp_mgr_stats {
+	u64 wake_cnt;		/* real wake handshakes */
+	u64 wake_fail;
+	u64 wake_us;		/* time spent in handshakes */
+	u32 wake_max_us;
+	u64 holdoff_hit;	/* requests that found cp2 kept awake */
+	u64 sleep_cnt;
+	u64 awake_us;
+};
+
 struct slp_mgr_t {
 	struct mutex    drv_slp_lock;
 	struct mutex    wakeup_lock;
 	struct completion wakeup_ack_completion;
 	unsigned int active_module;
 	atomic_t  cp2_state;
+	struct delayed_work slp_work;
+	u32 holdoff_ms;
+	u32 holdoff_max_ms;
+	unsigned int holdoff;
+	ktime_t wake_time;
+	ktime_t slp_time;
+	struct slp_mgr_stats stats;
+	struct dentry *debug_root;
 };
 
 enum slp_subsys {
@@ -61,5 +91,6 @@ int slp_mgr_deinit(void);
 void slp_mgr_drv_sleep(enum slp_subsys subsys, bool enable);
 int slp_mgr_wakeup(enum slp_subsys subsys);
 void slp_mgr_reset(void);
+void slp_mgr_enter_sleep(void);
 
 #endif
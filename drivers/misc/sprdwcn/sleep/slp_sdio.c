@@ -38,9 +38,8 @@ static void req_slp_isr(void)
 	/* allow sleep */
 	if (slp_mgr->active_module == 0) {
 		WCN_INFO("allow sleep\n");
-		slp_allow_sleep();
-
-		atomic_set(&(slp_mgr->cp2_state), STAY_SLPING);
+		cancel_delayed_work(&slp_mgr->slp_work);
+		slp_mgr_enter_sleep();
 	} else {
 		WCN_INFO("forbid slp module-0x%x\n",
 			 slp_mgr->active_module);
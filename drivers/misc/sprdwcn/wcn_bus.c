@@ -15,6 +15,7 @@
 
 #include <linux/kernel.h>
 #include <linux/mutex.h>
+#include <linux/percpu.h>
 #include <linux/slab.h>
 #include <linux/spinlock.h>
 
@@ -22,19 +23,14 @@
 
 #include "include/wcn_dbg.h"
 
-struct buffer_pool_t {
-	int size;
-	int free;
-	int payload;
-	void *head;
-	char *mem;
-	spinlock_t lock;
-};
+/* mbufs moved between a cpu cache and the shared list at a time */
+#define WCN_MBUF_CACHE_BATCH	16
+#define WCN_MBUF_CACHE_MAX	(WCN_MBUF_CACHE_BATCH * 2)
 
 struct chn_info_t {
 	struct mchn_ops_t *ops[CHN_MAX_NUM];
 	struct mutex callback_lock[CHN_MAX_NUM];
-	struct buffer_pool_t pool[CHN_MAX_NUM];
+	struct wcn_mbuf_pool pool[CHN_MAX_NUM];
 };
 
 static struct sprdwcn_bus_ops *wcn_bus_ops;
@@ -45,7 +41,7 @@ static struct chn_info_t *chn_info(void)
 	return &g_chn_info;
 }
 
-static int buf_list_check(struct buffer_pool_t *pool,
+static int buf_list_check(struct wcn_mbuf_pool *pool,
 			  struct mbuf_t *head, struct mbuf_t *tail, int num)
 {
 	int i;
@@ -77,29 +73,8 @@ static int buf_list_check(struct buffer_pool_t *pool,
 	return 0;
 }
 
-static int buf_pool_check(struct buffer_pool_t *pool)
-{
-	int i;
-	struct mbuf_t *mbuf;
-
-	for (i = 0, mbuf = pool->head;
-	     i < pool->free; i++, mbuf = mbuf->next) {
-		WARN_ON(!mbuf);
-		WARN_ON((char *)mbuf < pool->mem ||
-			(char *)mbuf > pool->mem + ((sizeof(struct mbuf_t)
-			+ pool->payload) * pool->size));
-	}
-
-	if (mbuf != NULL) {
-		WCN_ERR("%s(0x%p) err\n", __func__, pool);
-		WARN_ON(1);
-	}
-
-	return 0;
-}
-
 /* mbuf init and list, current payload is zero */
-static int buf_pool_init(struct buffer_pool_t *pool, int size, int payload)
+int wcn_mbuf_pool_init(struct wcn_mbuf_pool *pool, int size, int payload)
 {
 	int i;
 	struct mbuf_t *mbuf, *next;
@@ -118,9 +93,6 @@ static int buf_pool_init(struct buffer_pool_t *pool, int size, int payload)
 	for (i = 0, mbuf = (struct mbuf_t *)(pool->head);
 	     i < (size - 1); i++) {
 		mbuf->seq = i;
-		WCN_INFO("%s mbuf[%d]:{0x%lx, 0x%lx}\n", __func__, i,
-			 (unsigned long)mbuf,
-			 (unsigned long)virt_to_phys(mbuf));
 		next = (struct mbuf_t *)((char *)mbuf +
 			sizeof(struct mbuf_t) + payload);
 		mbuf->buf = (char *)mbuf + sizeof(struct mbuf_t);
@@ -128,90 +100,180 @@ static int buf_pool_init(struct buffer_pool_t *pool, int size, int payload)
 		mbuf->next = next;
 		mbuf = next;
 	}
-	WCN_INFO("%s mbuf[%d]:{0x%lx, 0x%lx}\n", __func__, i,
-		 (unsigned long)mbuf,
-		 (unsigned long)virt_to_phys(mbuf));
 	mbuf->seq = i;
 	mbuf->buf = (char *)mbuf + sizeof(struct mbuf_t);
 	mbuf->len = payload;
 	mbuf->next = NULL;
 	pool->free = size;
 
+	/* at most half of the pool may sit in the cpu caches */
+	pool->cache = NULL;
+	if (size >= num_possible_cpus() * WCN_MBUF_CACHE_MAX * 2)
+		pool->cache = alloc_percpu(struct wcn_mbuf_cache);
+
 	return 0;
 }
+EXPORT_SYMBOL(wcn_mbuf_pool_init);
 
-static int buf_pool_deinit(struct buffer_pool_t *pool)
+void wcn_mbuf_pool_deinit(struct wcn_mbuf_pool *pool)
 {
+	free_percpu(pool->cache);
+	pool->cache = NULL;
 	memset(pool->mem, 0x00,
 	       (sizeof(struct mbuf_t) + pool->payload) * pool->size);
 	kfree(pool->mem);
 	pool->mem = NULL;
-
-	return 0;
 }
+EXPORT_SYMBOL(wcn_mbuf_pool_deinit);
 
-/* take mbuf from pool list */
-int buf_list_alloc(int chn, struct mbuf_t **head,
-		   struct mbuf_t **tail, int *num)
+/* unlink up to @num mbufs from @src, caller holds what protects @src */
+static int wcn_mbuf_take(struct mbuf_t **src, int *src_num, int num,
+			 struct mbuf_t **head, struct mbuf_t **tail)
 {
-	int i;
-	struct buffer_pool_t *pool;
 	struct mbuf_t *temp_tail;
-	struct chn_info_t *chn_inf = chn_info();
-
-	pool = &(chn_inf->pool[chn]);
-
-	if ((*num <= 0) || (pool->free <= 0)) {
-		WCN_ERR("[+]%s err, num %d, free %d)\n",
-			__func__, *num, pool->free);
-		*num = 0;
-		*head = *tail = NULL;
-		return -1;
-	}
+	int i;
 
-	spin_lock_bh(&(pool->lock));
-	buf_pool_check(pool);
-	if (*num > pool->free)
-		*num = pool->free;
+	if (num > *src_num)
+		num = *src_num;
+	if (num <= 0)
+		return 0;
 
-	for (i = 1, temp_tail = pool->head; i < *num; i++)
+	for (i = 1, temp_tail = *src; i < num; i++)
 		temp_tail = temp_tail->next;
 
-	*head = pool->head;
+	*head = *src;
 	*tail = temp_tail;
-	pool->head = temp_tail->next;
+	*src = temp_tail->next;
 	temp_tail->next = NULL;
-	pool->free -= *num;
+	*src_num -= num;
+
+	return num;
+}
+
+static void wcn_mbuf_cache_refill(struct wcn_mbuf_pool *pool,
+				  struct wcn_mbuf_cache *c)
+{
+	struct mbuf_t *head, *tail;
+	int num;
+
+	spin_lock(&pool->lock);
+	num = wcn_mbuf_take(&pool->head, &pool->free, WCN_MBUF_CACHE_BATCH,
+			    &head, &tail);
+	spin_unlock(&pool->lock);
+	if (!num)
+		return;
+
+	tail->next = c->head;
+	c->head = head;
+	c->num += num;
+}
+
+static void wcn_mbuf_cache_spill(struct wcn_mbuf_pool *pool,
+				 struct wcn_mbuf_cache *c)
+{
+	struct mbuf_t *head, *tail;
+	int num;
+
+	num = wcn_mbuf_take(&c->head, &c->num, WCN_MBUF_CACHE_BATCH,
+			    &head, &tail);
+	spin_lock(&pool->lock);
+	tail->next = pool->head;
+	pool->head = head;
+	pool->free += num;
+	spin_unlock(&pool->lock);
+}
+
+/*
+ * take mbuf from pool list, *num is trimmed to what is available.
+ * May be called from any context, the pcie pop callbacks run in irq.
+ */
+int wcn_mbuf_pool_alloc(struct wcn_mbuf_pool *pool, struct mbuf_t **head,
+			struct mbuf_t **tail, int *num)
+{
+	struct wcn_mbuf_cache *c;
+	unsigned long flags;
+	int ret = 0;
+
+	if (*num <= 0)
+		goto err;
+
+	local_irq_save(flags);
+	if (pool->cache && *num <= WCN_MBUF_CACHE_BATCH) {
+		c = this_cpu_ptr(pool->cache);
+		if (c->num < *num)
+			wcn_mbuf_cache_refill(pool, c);
+		ret = wcn_mbuf_take(&c->head, &c->num, *num, head, tail);
+	} else {
+		spin_lock(&pool->lock);
+		ret = wcn_mbuf_take(&pool->head, &pool->free, *num,
+				    head, tail);
+		spin_unlock(&pool->lock);
+	}
+	local_irq_restore(flags);
+	if (!ret)
+		goto err;
+
+	*num = ret;
 	buf_list_check(pool, *head, *tail, *num);
-	spin_unlock_bh(&(pool->lock));
 
 	return 0;
+
+err:
+	WCN_ERR("[+]%s err, num %d, free %d)\n",
+		__func__, *num, pool->free);
+	*num = 0;
+	*head = *tail = NULL;
+
+	return -1;
 }
-EXPORT_SYMBOL(buf_list_alloc);
+EXPORT_SYMBOL(wcn_mbuf_pool_alloc);
 
-int buf_list_free(int chn, struct mbuf_t *head, struct mbuf_t *tail, int num)
+int wcn_mbuf_pool_free(struct wcn_mbuf_pool *pool, struct mbuf_t *head,
+		       struct mbuf_t *tail, int num)
 {
-	struct buffer_pool_t *pool;
-	struct chn_info_t *chn_inf = chn_info();
+	struct wcn_mbuf_cache *c;
+	unsigned long flags;
 
 	if ((head == NULL) || (tail == NULL) || (num == 0)) {
-		WCN_ERR("%s(%d, 0x%lx, 0x%lx, %d)\n", __func__, chn,
+		WCN_ERR("%s(0x%lx, 0x%lx, %d)\n", __func__,
 			(unsigned long)virt_to_phys(head),
 			(unsigned long)virt_to_phys(tail), num);
 		return -1;
 	}
 
-	pool = &(chn_inf->pool[chn]);
-	spin_lock_bh(&(pool->lock));
 	buf_list_check(pool, head, tail, num);
-	tail->next = pool->head;
-	pool->head = head;
-	pool->free += num;
-	buf_pool_check(pool);
-	spin_unlock_bh(&(pool->lock));
+	local_irq_save(flags);
+	if (pool->cache && num <= WCN_MBUF_CACHE_BATCH) {
+		c = this_cpu_ptr(pool->cache);
+		tail->next = c->head;
+		c->head = head;
+		c->num += num;
+		if (c->num > WCN_MBUF_CACHE_MAX)
+			wcn_mbuf_cache_spill(pool, c);
+	} else {
+		spin_lock(&pool->lock);
+		tail->next = pool->head;
+		pool->head = head;
+		pool->free += num;
+		spin_unlock(&pool->lock);
+	}
+	local_irq_restore(flags);
 
 	return 0;
 }
+EXPORT_SYMBOL(wcn_mbuf_pool_free);
+
+int buf_list_alloc(int chn, struct mbuf_t **head,
+		   struct mbuf_t **tail, int *num)
+{
+	return wcn_mbuf_pool_alloc(&chn_info()->pool[chn], head, tail, num);
+}
+EXPORT_SYMBOL(buf_list_alloc);
+
+int buf_list_free(int chn, struct mbuf_t *head, struct mbuf_t *tail, int num)
+{
+	return wcn_mbuf_pool_free(&chn_info()->pool[chn], head, tail, num);
+}
 EXPORT_SYMBOL(buf_list_free);
 
 int bus_chn_init(struct mchn_ops_t *ops, int hif_type)
@@ -231,8 +293,8 @@ int bus_chn_init(struct mchn_ops_t *ops, int hif_type)
 	ops->hif_type = hif_type;
 	chn_inf->ops[ops->channel] = ops;
 	if (ops->pool_size > 0)
-		ret = buf_pool_init(&(chn_inf->pool[ops->channel]),
-				    ops->pool_size, 0);
+		ret = wcn_mbuf_pool_init(&(chn_inf->pool[ops->channel]),
+					 ops->pool_size, 0);
 	mutex_unlock(&chn_inf->callback_lock[ops->channel]);
 
 	WCN_INFO("[-]%s(%d)\n", __func__, ops->channel);
@@ -254,7 +316,7 @@ int bus_chn_deinit(struct mchn_ops_t *ops)
 
 	mutex_lock(&chn_inf->callback_lock[ops->channel]);
 	if (ops->pool_size > 0)
-		ret = buf_pool_deinit(&(chn_inf->pool[ops->channel]));
+		wcn_mbuf_pool_deinit(&(chn_inf->pool[ops->channel]));
 	chn_inf->ops[ops->channel] = NULL;
 	mutex_unlock(&chn_inf->callback_lock[ops->channel]);
 	mutex_destroy(&chn_inf->callback_lock[ops->channel]);
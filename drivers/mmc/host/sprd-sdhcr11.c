@@ -52,7 +52,8 @@ static inline int sprd_sdhc_runtime_pm_put(struct sprd_sdhc_host *host)
 
 static void dump_adma_info(struct sprd_sdhc_host *host)
 {
-	void *desc_header = host->adma_desc;
+	void *desc_header = host->adma_desc +
+		host->adma_slot * host->adma_table_sz;
 	u64 desc_ptr;
 	unsigned long start = jiffies;
 	struct device *dev = &host->pdev->dev;
@@ -400,10 +401,17 @@ static void sprd_adma_mark_end(struct sprd_sdhc_host *host, void *desc)
 	}
 }
 
+/*
+ * There are two ADMA tables and bounce buffers, pre_req builds the table
+ * of the next request in one slot while the current one runs from the
+ * other.
+ */
 static int sprd_sdhc_adma_table_pre(struct sprd_sdhc_host *host,
-	struct mmc_data *data)
+	struct mmc_data *data, int slot)
 {
 	int direction;
+	int sg_count;
+	u8 *desc_base;
 
 	u8 *desc;
 	u8 *align;
@@ -426,16 +434,17 @@ static int sprd_sdhc_adma_table_pre(struct sprd_sdhc_host *host,
 	else
 		direction = DMA_TO_DEVICE;
 
-	host->sg_count = sdhci_pre_dma_transfer(host, data);
+	sg_count = sdhci_pre_dma_transfer(host, data);
 
-	if (host->sg_count <= 0)
+	if (sg_count <= 0)
 		return -EINVAL;
 
-	desc = host->adma_desc;
-	align = host->align_buffer;
-	align_addr = host->align_addr;
+	desc_base = host->adma_desc + slot * host->adma_table_sz;
+	desc = desc_base;
+	align = host->align_buffer + slot * SPRD_ALIGN_BUFFER_SZ;
+	align_addr = host->align_addr + slot * SPRD_ALIGN_BUFFER_SZ;
 
-	for_each_sg(data->sg, sg, host->sg_count, i) {
+	for_each_sg(data->sg, sg, sg_count, i) {
 		addr = sg_dma_address(sg);
 		len = sg_dma_len(sg);
 		offset = (SPRD_ADMA2_64_ALIGN -
@@ -479,16 +488,16 @@ static int sprd_sdhc_adma_table_pre(struct sprd_sdhc_host *host,
 		 * If this triggers then we have a calculation bug
 		 * somewhere.
 		 */
-		WARN_ON((desc - host->adma_desc) >= host->adma_table_sz);
+		WARN_ON((desc - desc_base) >= host->adma_table_sz);
 	}
 
 		/* Mark the last descriptor as the terminating descriptor */
-		if (desc != host->adma_desc) {
+		if (desc != desc_base) {
 			desc -= host->adma_desc_sz;
 			sprd_adma_mark_end(host, desc);
 		}
 
-	return 0;
+	return sg_count;
 }
 
 static void sprd_sdhc_adma_table_post(struct sprd_sdhc_host *host,
@@ -520,7 +529,8 @@ static void sprd_sdhc_adma_table_post(struct sprd_sdhc_host *host,
 		dma_sync_sg_for_cpu(mmc_dev(host->mmc),
 			data->sg, data->sg_len, direction);
 
-		align = host->align_buffer;
+		align = host->align_buffer +
+			host->adma_slot * SPRD_ALIGN_BUFFER_SZ;
 
 		for_each_sg(data->sg, sg, host->sg_count, i) {
 			if (sg_dma_address(sg) & (SPRD_ADMA2_64_ALIGN - 1)) {
@@ -564,19 +574,34 @@ static void sprd_sdhc_dma_unmap(struct sprd_sdhc_host *host)
 
 static void sprd_admd_mode(struct sprd_sdhc_host *host, struct mmc_data *data)
 {
+	dma_addr_t adma_addr;
+	int slot;
 
 	if (host->flags & SPRD_USE_64_BIT_DMA)
 		sprd_sdhc_set_64bit_addr(host, 1);
 
 	sprd_sdhc_set_adma2_len(host);
 	sprd_sdhc_set_dma(host, SPRD_SDHC_BIT_32ADMA_MOD);
-	sprd_sdhc_adma_table_pre(host, data);
+	if (data == host->adma_prep_data) {
+		slot = host->adma_prep_slot;
+		host->adma_prep_data = NULL;
+		data->host_cookie = COOKIE_GIVEN;
+		host->sg_count = data->sg_count;
+	} else {
+		/* keep off the table pre_req has built for the next request */
+		slot = host->adma_prep_data ? !host->adma_prep_slot :
+			host->adma_slot;
+		host->sg_count = sprd_sdhc_adma_table_pre(host, data, slot);
+	}
+	host->adma_slot = slot;
+
+	adma_addr = host->adma_addr + slot * host->adma_table_sz;
 	sprd_sdhc_writel(host,
-		(u32)host->adma_addr,
+		(u32)adma_addr,
 		SPRD_SDHC_REG_32_ADMA2_ADDR_L);
 	if (host->flags & SPRD_USE_64_BIT_DMA)
 		sprd_sdhc_writel(host,
-			(u32)((u64)host->adma_addr >> 32),
+			(u32)((u64)adma_addr >> 32),
 			SPRD_SDHC_REG_32_ADMA2_ADDR_H);
 }
 
@@ -1737,7 +1762,56 @@ static void sprd_sdhc_hs400_enhanced_strobe(struct mmc_host *mmc,
 	sprd_sdhc_runtime_pm_put(host);
 }
 
+/*
+ * Map the next request, and build its ADMA table in the slot the current
+ * request does not use, while the current one is on the bus. The data
+ * path then finds COOKIE_MAPPED, hands it out as COOKIE_GIVEN and leaves
+ * the unmap to sprd_sdhc_post_req().
+ */
+static void sprd_sdhc_pre_req(struct mmc_host *mmc, struct mmc_request *mrq)
+{
+	struct sprd_sdhc_host *host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+	int slot = !host->adma_slot;
+
+	if (!data)
+		return;
+
+	data->host_cookie = COOKIE_UNMAPPED;
+	if (!(host->flags & SPRD_USE_ADMA)) {
+		sdhci_pre_dma_transfer(host, data);
+		return;
+	}
+
+	if (sprd_sdhc_adma_table_pre(host, data, slot) > 0) {
+		host->adma_prep_slot = slot;
+		host->adma_prep_data = data;
+	}
+}
+
+static void sprd_sdhc_post_req(struct mmc_host *mmc, struct mmc_request *mrq,
+			       int err)
+{
+	struct sprd_sdhc_host *host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+
+	if (!data)
+		return;
+
+	/* a prepared request that never got issued */
+	if (host->adma_prep_data == data)
+		host->adma_prep_data = NULL;
+
+	if (data->host_cookie != COOKIE_UNMAPPED)
+		dma_unmap_sg(mmc_dev(mmc), data->sg, data->sg_len,
+			     (data->flags & MMC_DATA_READ) ?
+			     DMA_FROM_DEVICE : DMA_TO_DEVICE);
+	data->host_cookie = COOKIE_UNMAPPED;
+}
+
 static const struct mmc_host_ops sprd_sdhc_ops = {
+	.pre_req = sprd_sdhc_pre_req,
+	.post_req = sprd_sdhc_post_req,
 	.request = sprd_sdhc_request,
 	.set_ios = sprd_sdhc_set_ios,
 	.get_cd = sprd_sdhc_get_cd,
@@ -2004,22 +2078,24 @@ static void sprd_set_mmc_struct(struct sprd_sdhc_host *host,
 			host->adma_desc_sz = SPRD_ADMA2_32_DESC_SZ;
 		}
 		host->adma_desc = dma_alloc_coherent(mmc_dev(mmc),
-							host->adma_table_sz,
-							&host->adma_addr,
-							GFP_KERNEL);
+						SPRD_ADMA_SLOTS *
+						host->adma_table_sz,
+						&host->adma_addr,
+						GFP_KERNEL);
 		host->align_buffer = dma_alloc_coherent(mmc_dev(mmc),
-						      SPRD_ALIGN_BUFFER_SZ,
-						      &host->align_addr,
-						      GFP_KERNEL);
+						SPRD_ADMA_SLOTS *
+						SPRD_ALIGN_BUFFER_SZ,
+						&host->align_addr,
+						GFP_KERNEL);
 
 		if (!host->adma_desc || !host->align_buffer) {
 			if (host->adma_desc)
 				dma_free_coherent(mmc_dev(mmc),
-					host->adma_table_sz, host->adma_desc,
-					host->adma_addr);
+					SPRD_ADMA_SLOTS * host->adma_table_sz,
+					host->adma_desc, host->adma_addr);
 			if (host->align_buffer)
 				dma_free_coherent(mmc_dev(mmc),
-				SPRD_ALIGN_BUFFER_SZ,
+				SPRD_ADMA_SLOTS * SPRD_ALIGN_BUFFER_SZ,
 				host->align_buffer, host->align_addr);
 
 			host->flags &= ~SPRD_USE_ADMA;
@@ -2266,10 +2342,11 @@ static int sprd_sdhc_remove(struct platform_device *pdev)
 	clk_disable_unprepare(host->sdio_ahb);
 	if (host->adma_desc)
 		dma_free_coherent(mmc_dev(mmc),
-			host->adma_table_sz, host->adma_desc,
-			host->adma_addr);
+			SPRD_ADMA_SLOTS * host->adma_table_sz,
+			host->adma_desc, host->adma_addr);
 	if (host->align_buffer)
-		dma_free_coherent(mmc_dev(mmc), SPRD_ALIGN_BUFFER_SZ,
+		dma_free_coherent(mmc_dev(mmc),
+			SPRD_ADMA_SLOTS * SPRD_ALIGN_BUFFER_SZ,
 			host->align_buffer, host->align_addr);
 	host->adma_desc = NULL;
 	host->align_buffer = NULL;
@@ -105,6 +105,9 @@ struct sprd_sdhc_host {
 	dma_addr_t align_addr;	/* Mapped bounce buffer */
 	size_t adma_table_sz;	/* ADMA descriptor table total size */
 	size_t adma_desc_sz;	/* Each ADMA descriptor size */
+	int adma_slot;		/* ADMA table slot of the current request */
+	int adma_prep_slot;	/* ADMA table slot built by pre_req */
+	struct mmc_data *adma_prep_data;	/* request of adma_prep_slot */
 
 	struct pinctrl *pinctrl;
 	struct pinctrl_state *pins_uhs;
@@ -180,6 +183,8 @@ struct sdhci_adma2_32_desc {
 #define SPRD_MAX_SEGS		128
 
 #define SPRD_ALIGN_BUFFER_SZ (SPRD_MAX_SEGS * SPRD_ADMA2_64_ALIGN)
+/* ADMA tables, one for the current request and one prepared by pre_req */
+#define SPRD_ADMA_SLOTS		2
 
 #define  ADMA_SIZE	((SPRD_MAX_SEGS * 2 + 1) * SPRD_ADMA2_64_DESC_SZ)
 
@@ -12,6 +12,7 @@
  */
 #include <linux/bitops.h>
 #include <linux/clk.h>
+#include <linux/completion.h>
 #include <linux/debugfs.h>
 #include <linux/dma-mapping.h>
 #include <linux/highmem.h>
@@ -148,9 +149,19 @@ struct sprd_nand_host {
 	struct nand_inst inst_write_main_raw;
 	struct nand_inst inst_write_spare_raw;
 	struct nand_inst inst_erase;
+	struct nand_inst inst_cache_read_start;
+	struct nand_inst inst_cache_read;
+	struct nand_inst inst_cache_read_end;
 
 	bool randomizer;
 	bool multi_cs;
+	bool cache_read;
+
+	/* command completion by interrupt, polled while use_irq is false */
+	bool use_irq;
+	bool int_armed;
+	u32 int_sts;
+	struct completion cmd_done;
 };
 
 #define GETCS(page)                                                            \
@@ -353,8 +364,11 @@ static void sprd_nand_cmd_exec(struct sprd_nand_host *host,
 
 	sprd_nand_writel(host, 0, NFC_INT_REG);
 	sprd_nand_writel(host, GENMASK(11, 8), NFC_INT_REG);
-	if (if_use_int)
+	host->int_armed = if_use_int;
+	if (if_use_int) {
+		reinit_completion(&host->cmd_done);
 		sprd_nand_writel(host, (program->int_bits & 0xF), NFC_INT_REG);
+	}
 
 	sprd_nand_writel(host, host->nfc_start | CTRL_NFC_CMD_START,
 			 NFC_START_REG);
@@ -371,13 +385,28 @@ static int sprd_nand_cmd_wait(struct sprd_nand_host *host,
 	else
 		nfc_timeout_val = NFC_TIMEOUT_VAL;
 
-	ret = readl_relaxed_poll_timeout(host->ioaddr + NFC_INT_REG, regval,
-					 (SPRD_NAND_GET_INT_VAL(regval) &
-					  ((INT_TO | INT_STSMCH | INT_WP) &
-					   program->int_bits)) ||
-					 (SPRD_NAND_GET_INT_VAL(regval) &
-					  (INT_DONE & program->int_bits)),
-					 0, nfc_timeout_val);
+	if (host->int_armed) {
+		host->int_armed = false;
+		if (wait_for_completion_timeout(&host->cmd_done,
+				usecs_to_jiffies(nfc_timeout_val))) {
+			regval = host->int_sts;
+			ret = 0;
+		} else {
+			sprd_nand_writel(host, 0, NFC_INT_REG);
+			ret = -ETIMEDOUT;
+		}
+	} else {
+		ret = readl_relaxed_poll_timeout(host->ioaddr + NFC_INT_REG,
+						 regval,
+						 (SPRD_NAND_GET_INT_VAL(regval) &
+						  ((INT_TO | INT_STSMCH |
+						    INT_WP) &
+						   program->int_bits)) ||
+						 (SPRD_NAND_GET_INT_VAL(regval) &
+						  (INT_DONE &
+						   program->int_bits)),
+						 0, nfc_timeout_val);
+	}
 	if (ret) {
 		dev_err(host->dev, "command %s wait timeout.\n",
 			program->program_name);
@@ -394,6 +423,23 @@ static int sprd_nand_cmd_wait(struct sprd_nand_host *host,
 	return ret;
 }
 
+static irqreturn_t sprd_nand_irq_handler(int irq, void *data)
+{
+	struct sprd_nand_host *host = data;
+	u32 regval = sprd_nand_readl(host, NFC_INT_REG);
+
+	if (!(SPRD_NAND_GET_INT_VAL(regval) &
+	      (INT_TO | INT_STSMCH | INT_WP | INT_DONE)))
+		return IRQ_NONE;
+
+	/* mask it, sprd_nand_cmd_wait() checks the saved status */
+	sprd_nand_writel(host, 0, NFC_INT_REG);
+	host->int_sts = regval;
+	complete(&host->cmd_done);
+
+	return IRQ_HANDLED;
+}
+
 /* host state0 is used for nand id and reset cmd */
 static void sprd_nand_init_reg_state0(struct sprd_nand_host *host)
 {
@@ -746,6 +792,46 @@ static void sprd_nand_param_init_inst(struct sprd_nand_host *host)
 	sprd_nand_cmd_add(&host->inst_read_main_spare, INST_MRDT());
 
 	sprd_nand_cmd_add(&host->inst_read_main_spare, INST_DONE());
+	/*
+	 * cache read main+spare: 00-30 loads the first page, then every 31
+	 * hands out one page while the array loads the next, 3F the last.
+	 */
+	host->inst_cache_read_start.program_name = "_inst_cache_read_start";
+	sprd_nand_cmd_init(&host->inst_cache_read_start, INT_TO | INT_DONE);
+	sprd_nand_cmd_add(&host->inst_cache_read_start, INST_CMD(0x00));
+	sprd_nand_cmd_add(&host->inst_cache_read_start, INST_ADDR(0, 0));
+	sprd_nand_cmd_add(&host->inst_cache_read_start, INST_ADDR(0, 0));
+	sprd_nand_cmd_tag(&host->inst_cache_read_start);
+	sprd_nand_cmd_add(&host->inst_cache_read_start, INST_ADDR(0, 1));
+	sprd_nand_cmd_add(&host->inst_cache_read_start, INST_ADDR(0, 0));
+	if (host->param.ncycle == 5)
+		sprd_nand_cmd_add(&host->inst_cache_read_start,
+				  INST_ADDR(0, 0));
+	sprd_nand_cmd_add(&host->inst_cache_read_start, INST_CMD(0x30));
+	sprd_nand_cmd_add(&host->inst_cache_read_start, INST_WRB0());
+	sprd_nand_cmd_add(&host->inst_cache_read_start, INST_DONE());
+
+	host->inst_cache_read.program_name = "_inst_cache_read";
+	sprd_nand_cmd_init(&host->inst_cache_read, INT_TO | INT_DONE);
+	sprd_nand_cmd_add(&host->inst_cache_read, INST_CMD(0x31));
+	sprd_nand_cmd_add(&host->inst_cache_read, INST_WRB0());
+	sprd_nand_cmd_add(&host->inst_cache_read, INST_CMD(0x05));
+	sprd_nand_cmd_add(&host->inst_cache_read,
+			  INST_ADDR((0xFF & (u8)column), 0));
+	sprd_nand_cmd_add(&host->inst_cache_read,
+			  INST_ADDR((0xFF & (u8)(column >> 8)), 0));
+	sprd_nand_cmd_add(&host->inst_cache_read, INST_CMD(0xE0));
+	sprd_nand_cmd_add(&host->inst_cache_read, INST_SRDT());
+	sprd_nand_cmd_add(&host->inst_cache_read, INST_CMD(0x05));
+	sprd_nand_cmd_add(&host->inst_cache_read, INST_ADDR(0, 0));
+	sprd_nand_cmd_add(&host->inst_cache_read, INST_ADDR(0, 0));
+	sprd_nand_cmd_add(&host->inst_cache_read, INST_CMD(0xE0));
+	sprd_nand_cmd_add(&host->inst_cache_read, INST_MRDT());
+	sprd_nand_cmd_add(&host->inst_cache_read, INST_DONE());
+
+	host->inst_cache_read_end = host->inst_cache_read;
+	host->inst_cache_read_end.program_name = "_inst_cache_read_end";
+	host->inst_cache_read_end.inst[0] = INST_CMD(0x3F);
 	/* read main raw */
 	host->inst_read_main_raw.program_name = "_inst_read_main_raw";
 	sprd_nand_cmd_init(&host->inst_read_main_raw, INT_TO | INT_DONE);
@@ -1193,6 +1279,72 @@ err:
 	return ret;
 }
 
+static bool sprd_nand_use_cache_read(struct sprd_nand_host *host,
+				     struct nand_inst *inst, u32 num)
+{
+	/* the seeds of a randomized read follow the repeat of one program */
+	return host->cache_read && !host->randomizer && num > 1 &&
+		!strcmp(inst->program_name, "_inst_read_main_spare");
+}
+
+static void sprd_nand_set_ram_addr(struct sprd_nand_host *host, u32 page,
+				   u32 mode)
+{
+	u32 sects = page * host->param.nsect_per_page;
+	u32 obb_size;
+
+	if (mode == MTD_OPS_AUTO_OOB)
+		obb_size = host->param.info_size;
+	else
+		obb_size = host->param.nspare_size;
+
+	sprd_nand_writel(host, RAM_MAIN_ADDR(host->mbuf_p +
+					     (sects << host->sectshift)),
+			 NFC_MAIN_ADDRL_REG);
+	sprd_nand_writel(host, RAM_SPAR_ADDR(host->sbuf_p + sects * obb_size),
+			 NFC_SPAR_ADDRL_REG);
+	sprd_nand_writel(host, RAM_STAT_ADDR(host->stsbuf_p +
+					     page * sizeof(struct nand_ecc_stats)),
+			 NFC_STAT_ADDRL_REG);
+}
+
+/*
+ * Sequential cache read of num pages. The repeat of the 31 program fills
+ * the buffers of all pages but the last one, the 3F program is pointed at
+ * the slot of the last page, so the buffers end up as after one repeated
+ * page read.
+ */
+static int sprd_nand_cache_read(struct sprd_nand_host *host, u32 page,
+				u32 num, u32 mode)
+{
+	struct nand_inst inst_start = host->inst_cache_read_start;
+	u32 cfg0_val = host->nfc_cfg0_val;
+	int ret;
+
+	sprd_nand_cmd_change(host, &inst_start, page);
+	sprd_nand_cmd_exec(host, &inst_start, 1, host->use_irq);
+	ret = sprd_nand_cmd_wait(host, &inst_start);
+	if (ret)
+		return ret;
+
+	host->nfc_cfg0_val = cfg0_val & ~CFG0_SET_REPEAT_NUM_MSK;
+	sprd_nand_cmd_exec(host, &host->inst_cache_read, num - 1,
+			   host->use_irq);
+	ret = sprd_nand_cmd_wait(host, &host->inst_cache_read);
+	if (ret)
+		goto out;
+
+	sprd_nand_set_ram_addr(host, num - 1, mode);
+	host->nfc_cfg0_val = cfg0_val & ~CFG0_SET_REPEAT_NUM_MSK;
+	sprd_nand_cmd_exec(host, &host->inst_cache_read_end, 1, host->use_irq);
+	ret = sprd_nand_cmd_wait(host, &host->inst_cache_read_end);
+
+out:
+	sprd_nand_set_ram_addr(host, 0, mode);
+	host->nfc_cfg0_val = cfg0_val;
+	return ret;
+}
+
 /*
  * if(0!=mBuf) then read main area
  * if(0!=sBuf) then read spare area or read spare info
@@ -1277,9 +1429,13 @@ static int sprd_nand_read_page_in_block(struct sprd_nfc_base *nfc_base,
 		break;
 	}
 
-	sprd_nand_cmd_change(host, inst, page);
-	sprd_nand_cmd_exec(host, inst, num, 0);
-	ret = sprd_nand_cmd_wait(host, inst);
+	if (sprd_nand_use_cache_read(host, inst, num)) {
+		ret = sprd_nand_cache_read(host, page, num, mode);
+	} else {
+		sprd_nand_cmd_change(host, inst, page);
+		sprd_nand_cmd_exec(host, inst, num, host->use_irq);
+		ret = sprd_nand_cmd_wait(host, inst);
+	}
 	if (if_change_buf) {
 		/* 1 change to main buf */
 		sprd_nand_writel(host, 0x0, NFC_MAIN_ADDRH_REG);
@@ -1438,7 +1594,7 @@ static int sprd_nand_write_page_in_blk(struct sprd_nfc_base *nfc_base,
 	}
 
 	sprd_nand_cmd_change(host, inst, page);
-	sprd_nand_cmd_exec(host, inst, num, 0);
+	sprd_nand_cmd_exec(host, inst, num, host->use_irq);
 	ret = sprd_nand_cmd_wait(host, inst);
 	if (if_change_buf) {
 		/* 1 change to main buf */
@@ -1485,7 +1641,7 @@ static int sprd_nand_eraseblk(struct sprd_nfc_base *nfc_base, u32 page)
 	host->nfc_cfg0_val = (host->nfc_cfg0 | CFG0_SET_NFC_MODE(2));
 
 	sprd_nand_cmd_change(host, inst, page);
-	sprd_nand_cmd_exec(host, inst, 1, 0);
+	sprd_nand_cmd_exec(host, inst, 1, host->use_irq);
 	ret = sprd_nand_cmd_wait(host, inst);
 
 	sprd_nand_enable_wp(host);
@@ -1838,6 +1994,8 @@ static int sprd_nand_drv_probe(struct platform_device *pdev)
 						 "sprd,random-mode");
 	host->multi_cs = of_property_read_bool(pdev->dev.of_node,
 					       "sprd,multi-cs");
+	host->cache_read = of_property_read_bool(pdev->dev.of_node,
+						 "sprd,cache-read");
 
 	sprd_nand_set_mode(host, 0, 0);
 	sprd_nand_init_reg_state0(host);
@@ -1895,6 +2053,16 @@ static int sprd_nand_drv_probe(struct platform_device *pdev)
 		goto err_clk_disable;
 
 	sprd_nand_init_reg_state1(host);
+
+	/* reset and readid above poll, the page commands sleep on the irq */
+	init_completion(&host->cmd_done);
+	ret = devm_request_irq(&pdev->dev, host->irq, sprd_nand_irq_handler, 0,
+			       dev_name(&pdev->dev), host);
+	if (ret)
+		dev_warn(&pdev->dev, "request irq fail %d, poll commands\n",
+			 ret);
+	host->use_irq = !ret;
+
 	sprd_nfc_base_init(nfc_base, host);
 	sprd_nand_test_scan_badblk(nfc_base, host);
 	dev_dbg(&pdev->dev,
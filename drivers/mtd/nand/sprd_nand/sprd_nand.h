@@ -73,6 +73,7 @@
 #define CFG0_DEF1_SECT_NUM(num) (((num - 1) & 0x1F) << 24)
 #define CFG0_SET_SECT_NUM_MSK (0x1F << 24)
 #define CFG0_SET_REPEAT_NUM(num) (((num - 1) & 0xFF) << 16)
+#define CFG0_SET_REPEAT_NUM_MSK (0xFF << 16)
 #define CFG0_SET_WPN BIT(15)
 #define CFG0_DEF1_BUS_WIDTH(width) (((!!(width != BW_08)) & 0x1) << 14)
 #define CFG0_SET_SPARE_ONLY_INFO_PROD_EN BIT(13)
@@ -32,6 +32,12 @@ struct sprd_efuse {
 	phys_addr_t base;
 	u32 size;
 	const struct sprd_efuse_variant_data *var_data;
+	/*
+	 * The efuse can not change under us, so the whole block range is
+	 * copied once on the first read and every read is served from here.
+	 */
+	u32 *snapshot;
+	bool snapshot_valid;
 };
 
 static const struct sprd_efuse_variant_data sharkl5_data = {
@@ -111,11 +117,26 @@ static int sprd_efuse_read_from_phy_addr(struct sprd_efuse *efuse,
 	return 0;
 }
 
-static int sprd_efuse_raw_read(struct sprd_efuse *efuse, int index, u32 *val)
+static int sprd_efuse_snapshot(struct sprd_efuse *efuse)
 {
-	phys_addr_t phy_addr = efuse->base + 0x4 + index * SPRD_EFUSE_BLOCK_WIDTH;
+	phys_addr_t phy_addr = efuse->base + 0x4;
+	int ret = 0;
 
-	return sprd_efuse_read_from_phy_addr(efuse, phy_addr, val, sizeof(u32));
+	/* pairs with the store below, the blocks are ready once it is seen */
+	if (smp_load_acquire(&efuse->snapshot_valid))
+		return 0;
+
+	mutex_lock(&efuse->mutex);
+	if (!efuse->snapshot_valid) {
+		ret = sprd_efuse_read_from_phy_addr(efuse, phy_addr,
+				efuse->snapshot,
+				efuse->var_data->blk_num * SPRD_EFUSE_BLOCK_WIDTH);
+		if (!ret)
+			smp_store_release(&efuse->snapshot_valid, true);
+	}
+	mutex_unlock(&efuse->mutex);
+
+	return ret;
 }
 
 static int sprd_efuse_read(void *context, u32 offset, void *val, size_t bytes)
@@ -128,12 +149,9 @@ static int sprd_efuse_read(void *context, u32 offset, void *val, size_t bytes)
 	if (index < efuse->var_data->blk_start || index > efuse->var_data->blk_max)
 		return -EINVAL;
 
-	mutex_lock(&efuse->mutex);
-	ret = sprd_efuse_raw_read(efuse, index, &data);
-	mutex_unlock(&efuse->mutex);
-
+	ret = sprd_efuse_snapshot(efuse);
 	if (!ret) {
-		data >>= blk_offset;
+		data = efuse->snapshot[index] >> blk_offset;
 		memcpy(val, &data, bytes);
 	}
 
@@ -168,6 +186,11 @@ static int sprd_efuse_probe(struct platform_device *pdev)
 	efuse->base = res.start;
 	efuse->size = resource_size(&res);
 
+	efuse->snapshot = devm_kcalloc(&pdev->dev, pdata->blk_num,
+				       SPRD_EFUSE_BLOCK_WIDTH, GFP_KERNEL);
+	if (!efuse->snapshot)
+		return -ENOMEM;
+
 	mutex_init(&efuse->mutex);
 	efuse->dev = &pdev->dev;
 	efuse->var_data = pdata;
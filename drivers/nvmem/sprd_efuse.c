@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-2.0
 // Copyright (C) 2018 Spreadtrum Communications Inc.
 
+#include <linux/bitmap.h>
 #include <linux/clk.h>
 #include <linux/io.h>
 #include <linux/hwspinlock.h>
@@ -93,6 +94,13 @@ struct sprd_efuse {
 	struct mutex mutex;
 	void __iomem *base;
 	const struct sprd_efuse_variant_data *var_data;
+	/*
+	 * Every public block is read from the hardware once, later reads
+	 * are served from cache[]. The bits are set and cleared with the
+	 * efuse locked, a programmed block is read back from the hardware.
+	 */
+	u32 *cache;
+	unsigned long *cached;
 };
 
 static const struct sprd_efuse_variant_data sharkl5_data = {
@@ -319,6 +327,12 @@ static int sprd_efuse_raw_read(struct sprd_efuse *efuse, int blk, u32 *val,
 	if (ret) {
 		dev_err(efuse->dev, "error status %d of block %d\n", ret, blk);
 		ret = -EINVAL;
+	} else {
+		blk -= efuse->var_data->blk_start;
+		efuse->cache[blk] = *val;
+		/* pairs with the smp_rmb() in sprd_efuse_read() */
+		smp_wmb();
+		set_bit(blk, efuse->cached);
 	}
 	writel(SPRD_ERR_CLR_MASK, efuse->base + SPRD_EFUSE_NS_FLAG_CLR);
 
@@ -341,6 +355,8 @@ static int sprd_efuse_prog(struct sprd_efuse *efuse, int blk, bool doub,
 	if (ret)
 		goto unlock_hwlock;
 
+	/* even a failed programming may have changed some bits */
+	clear_bit(blk - efuse->var_data->blk_start, efuse->cached);
 	ret = sprd_efuse_raw_prog(efuse, blk, doub, lock, val);
 
 	clk_disable(efuse->clk);
@@ -357,6 +373,13 @@ static int sprd_efuse_read(void *context, u32 offset, void *val, size_t bytes)
 	u32 blk_offset = (offset % SPRD_EFUSE_BLOCK_WIDTH) * BITS_PER_BYTE;
 	int ret;
 
+	if (test_bit(index, efuse->cached)) {
+		smp_rmb();
+		data = efuse->cache[index] >> blk_offset;
+		memcpy(val, &data, bytes);
+		return 0;
+	}
+
 	/* efuse has two parts secure efuse block and public efuse block.
 	 * public eFuse starts at SPRD_EFUSE_BLOCK_STAR block.
 	 */
@@ -455,6 +478,15 @@ static int sprd_efuse_probe(struct platform_device *pdev)
 	efuse->var_data = pdata;
 	blk_num = efuse->var_data->blk_max - efuse->var_data->blk_start + 1;
 
+	efuse->cache = devm_kcalloc(&pdev->dev, blk_num, sizeof(u32),
+				    GFP_KERNEL);
+	efuse->cached = devm_kcalloc(&pdev->dev, BITS_TO_LONGS(blk_num),
+				     sizeof(unsigned long), GFP_KERNEL);
+	if (!efuse->cache || !efuse->cached) {
+		ret = -ENOMEM;
+		goto unprepare_clk;
+	}
+
 	econfig.stride = 1;
 	econfig.word_size = 1;
 	econfig.read_only = false;
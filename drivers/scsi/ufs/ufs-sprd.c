@@ -15,6 +15,7 @@
 #include <linux/mfd/syscon.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
+#include <linux/pm_runtime.h>
 #include <linux/regmap.h>
 #include <linux/time.h>
 
@@ -195,6 +196,7 @@ static int ufs_sprd_init(struct ufs_hba *hba)
 		return -ENOMEM;
 
 	host->hba = hba;
+	host->wb_enabled = true;
 	ufshcd_set_variant(hba, host);
 
 	/* map ufsutp_reg */
@@ -320,6 +322,24 @@ static u32 ufs_sprd_get_ufs_hci_version(struct ufs_hba *hba)
 	return UFSHCI_VERSION_21;
 }
 
+/*
+ * The block layer of this tree has only the headers of the keyslot
+ * manager, with no implementation behind them, so an inline crypto engine
+ * cannot be handed to fscrypt yet. Report what the controller has.
+ */
+static void ufs_sprd_crypto_report(struct ufs_hba *hba)
+{
+	u32 ccap;
+
+	if (!(hba->capabilities & MASK_CRYPTO_SUPPORT))
+		return;
+
+	ccap = ufshcd_readl(hba, REG_UFS_CCAP);
+	dev_info_once(hba->dev,
+		      "inline crypto: %u algorithms, %u key slots, unused\n",
+		      ccap & 0xff, ((ccap >> 8) & 0xff) + 1);
+}
+
 static int ufs_sprd_hce_enable_notify(struct ufs_hba *hba,
 				      enum ufs_notify_change_status status)
 {
@@ -331,6 +351,7 @@ static int ufs_sprd_hce_enable_notify(struct ufs_hba *hba,
 		ufs_sprd_hw_init(hba);
 		break;
 	case POST_CHANGE:
+		ufs_sprd_crypto_report(hba);
 		break;
 	default:
 		dev_err(hba->dev, "%s: invalid status %d\n", __func__, status);
@@ -465,6 +486,142 @@ static int ufs_sprd_resume(struct ufs_hba *hba, enum ufs_pm_op pm_op)
 	return 0;
 }
 
+static int ufs_sprd_wb_set_flag(struct ufs_hba *hba, enum flag_idn idn,
+				bool set)
+{
+	int err;
+
+	err = ufshcd_query_flag(hba, set ? UPIU_QUERY_OPCODE_SET_FLAG :
+				UPIU_QUERY_OPCODE_CLEAR_FLAG, idn, NULL);
+	if (err)
+		dev_err(hba->dev, "%s: %s flag %d failed %d\n", __func__,
+			set ? "set" : "clear", idn, err);
+
+	return err;
+}
+
+/*
+ * WriteBooster puts writes into an SLC buffer first, the buffer is then
+ * flushed to the normal TLC space when the device has time for it. The
+ * flags are lost on every device reset, so they are applied again from
+ * here, which runs after the device is initialized on probe and on each
+ * host reset. Flushing in hibern8 keeps the buffer usable for the next
+ * burst without waking the link, an explicit flush (wb_flush) is left to
+ * the userspace policy, e.g. while charging.
+ */
+static void ufs_sprd_wb_config(struct ufs_hba *hba)
+{
+	struct ufs_sprd_host *host = ufshcd_get_variant(hba);
+	__be32 ext_feat;
+	int err;
+
+	if (!host->wb_supported) {
+		if (hba->desc_size.dev_desc < DEVICE_DESC_PARAM_EXT_UFS_FEAT_SUP +
+		    sizeof(ext_feat))
+			return;
+
+		err = ufshcd_read_desc_param(hba, QUERY_DESC_IDN_DEVICE, 0,
+					     DEVICE_DESC_PARAM_EXT_UFS_FEAT_SUP,
+					     (u8 *)&ext_feat, sizeof(ext_feat));
+		if (err ||
+		    !(be32_to_cpu(ext_feat) & UFS_DEV_WRITE_BOOSTER_SUP))
+			return;
+
+		host->wb_supported = true;
+		dev_info(hba->dev, "WriteBooster supported\n");
+	}
+
+	ufs_sprd_wb_set_flag(hba, QUERY_FLAG_IDN_WB_EN, host->wb_enabled);
+	ufs_sprd_wb_set_flag(hba, QUERY_FLAG_IDN_WB_BUFF_FLUSH_DURING_HIBERN8,
+			     true);
+	ufs_sprd_wb_set_flag(hba, QUERY_FLAG_IDN_WB_BUFF_FLUSH_EN,
+			     host->wb_flush);
+}
+
+static int ufs_sprd_apply_dev_quirks(struct ufs_hba *hba)
+{
+	ufs_sprd_wb_config(hba);
+
+	return 0;
+}
+
+static ssize_t ufs_sprd_wb_store(struct device *dev, const char *buf,
+				 size_t count, enum flag_idn idn, bool *state)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	struct ufs_sprd_host *host = ufshcd_get_variant(hba);
+	bool val;
+	int err;
+
+	if (!host->wb_supported)
+		return -EOPNOTSUPP;
+
+	if (kstrtobool(buf, &val))
+		return -EINVAL;
+
+	pm_runtime_get_sync(hba->dev);
+	err = ufs_sprd_wb_set_flag(hba, idn, val);
+	pm_runtime_put_sync(hba->dev);
+	if (err)
+		return err;
+
+	*state = val;
+	return count;
+}
+
+static ssize_t wb_enable_show(struct device *dev,
+			      struct device_attribute *attr, char *buf)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	struct ufs_sprd_host *host = ufshcd_get_variant(hba);
+
+	return sprintf(buf, "%d\n", host->wb_enabled);
+}
+
+static ssize_t wb_enable_store(struct device *dev,
+			       struct device_attribute *attr,
+			       const char *buf, size_t count)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	struct ufs_sprd_host *host = ufshcd_get_variant(hba);
+
+	return ufs_sprd_wb_store(dev, buf, count, QUERY_FLAG_IDN_WB_EN,
+				 &host->wb_enabled);
+}
+static DEVICE_ATTR_RW(wb_enable);
+
+static ssize_t wb_flush_show(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	struct ufs_sprd_host *host = ufshcd_get_variant(hba);
+
+	return sprintf(buf, "%d\n", host->wb_flush);
+}
+
+static ssize_t wb_flush_store(struct device *dev,
+			      struct device_attribute *attr,
+			      const char *buf, size_t count)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	struct ufs_sprd_host *host = ufshcd_get_variant(hba);
+
+	return ufs_sprd_wb_store(dev, buf, count,
+				 QUERY_FLAG_IDN_WB_BUFF_FLUSH_EN,
+				 &host->wb_flush);
+}
+static DEVICE_ATTR_RW(wb_flush);
+
+static struct attribute *ufs_sprd_wb_attrs[] = {
+	&dev_attr_wb_enable.attr,
+	&dev_attr_wb_flush.attr,
+	NULL,
+};
+
+static const struct attribute_group ufs_sprd_wb_group = {
+	.attrs = ufs_sprd_wb_attrs,
+};
+
 /**
  * struct ufs_hba_sprd_vops - UFS sprd specific variant operations
  *
@@ -482,6 +639,7 @@ static struct ufs_hba_variant_ops ufs_hba_sprd_vops = {
 	.hibern8_notify = ufs_sprd_hibern8_notify,
 	.suspend = ufs_sprd_suspend,
 	.resume = ufs_sprd_resume,
+	.apply_dev_quirks = ufs_sprd_apply_dev_quirks,
 };
 
 /**
@@ -499,6 +657,8 @@ static int ufs_sprd_probe(struct platform_device *pdev)
 	err = ufshcd_pltfrm_init(pdev, &ufs_hba_sprd_vops);
 	if (err)
 		dev_err(dev, "ufshcd_pltfrm_init() failed %d\n", err);
+	else if (sysfs_create_group(&dev->kobj, &ufs_sprd_wb_group))
+		dev_warn(dev, "failed to create WriteBooster attributes\n");
 	device_enable_async_suspend(dev);
 
 	return err;
@@ -514,6 +674,7 @@ static int ufs_sprd_remove(struct platform_device *pdev)
 {
 	struct ufs_hba *hba =  platform_get_drvdata(pdev);
 
+	sysfs_remove_group(&pdev->dev.kobj, &ufs_sprd_wb_group);
 	pm_runtime_get_sync(&(pdev)->dev);
 	ufshcd_remove(hba);
 	return 0;
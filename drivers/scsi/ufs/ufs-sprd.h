@@ -32,6 +32,9 @@ struct ufs_sprd_host {
 	struct syscon_ufs ap_apb_ufs_rst;
 	struct syscon_ufs anlg_mphy_ufs_rst;
 	struct syscon_ufs aon_apb_ufs_rst;
+	bool wb_supported;
+	bool wb_enabled;
+	bool wb_flush;
 };
 
 /* UFS host controller vendor specific registers */
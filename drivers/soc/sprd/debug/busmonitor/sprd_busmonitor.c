@@ -11,11 +11,13 @@
  */
 
 #include <linux/interrupt.h>
+#include <linux/mutex.h>
 #include <linux/of.h>
 #include <linux/of_device.h>
 #include <linux/of_irq.h>
 #include <linux/soc/sprd/busmonitor.h>
 #include <linux/soc/sprd/djtag.h>
+#include <linux/workqueue.h>
 
 #define INT_MSK_STATUS		BIT(31)
 #define INT_CLR			BIT(29)
@@ -42,6 +44,9 @@
 #define DBREAD(base)		master->ops->read(master, (base), 0x20)
 #define SPRD_BM_W_MODE		0x1
 #define SPRD_BM_R_MODE		0x2
+#define BM_PERF_BUCKETS		16
+#define BM_PERF_PERIOD_MS	100
+#define BM_PERF_DIRS		2	/* read, write */
 
 struct bm_match {
 	u32 id;
@@ -73,6 +78,21 @@ struct bm_configs {
 	u32 end;
 };
 
+/*
+ * Window counters of one monitor in perf mode, summed over all sampled
+ * windows. hist[dir][n] counts the transactions of the windows whose
+ * average latency had its highest bit at n - 1, in bus clock cycles.
+ */
+struct bm_perf {
+	u32 win_len;
+	u64 windows;
+	u64 trans[BM_PERF_DIRS];
+	u64 bw[BM_PERF_DIRS];
+	u64 latency[BM_PERF_DIRS];
+	u32 peak_bw;
+	u64 hist[BM_PERF_DIRS][BM_PERF_BUCKETS];
+};
+
 struct sprd_busmonitor {
 	struct device *dev;
 	struct djtag_device *ddev;
@@ -85,6 +105,10 @@ struct sprd_busmonitor {
 	int count;
 	bool retention;
 	bool panic;
+	struct bm_perf *perf;
+	struct delayed_work perf_work;
+	struct mutex perf_lock;
+	u32 perf_period;
 };
 
 static void sprd_busmon_enable(struct sprd_busmonitor *bm, bool eb, u32 n)
@@ -330,6 +354,81 @@ static irqreturn_t sprd_busmon_irq(int irq_num, void *dev)
 	return IRQ_HANDLED;
 }
 
+static void sprd_busmon_perf_start(struct sprd_busmonitor *bm, u32 n)
+{
+	struct djtag_master *master = bm->ddev->master;
+
+	master->ops->mux_sel(master, bm->ddev->sys, bm->desc[n].dap);
+	/* without a match config count the whole address space */
+	if (!bm->cf[n].enable) {
+		DBWRITE(0, AHB_ADDR_MIN);
+		DBWRITE(BM_MAX_ADDR, AHB_ADDR_MAX);
+		DBWRITE(0, AHB_ADDR_MIN_H32);
+		DBWRITE(BM_MAX_ADDR, AHB_ADDR_MAX_H32);
+	}
+	DBWRITE(bm->perf[n].win_len, AHB_CNT_WIN_LEN);
+	DBWRITE(bm->perf[n].win_len, AHB_PEAK_WIN_LEN);
+	sprd_busmon_enable(bm, true, n);
+}
+
+static void sprd_busmon_perf_account(struct bm_perf *perf, int dir,
+				     u32 trans, u32 bw, u32 latency)
+{
+	u32 avg;
+
+	if (!trans)
+		return;
+
+	perf->trans[dir] += trans;
+	perf->bw[dir] += bw;
+	perf->latency[dir] += latency;
+	avg = latency / trans;
+	perf->hist[dir][min_t(int, fls(avg), BM_PERF_BUCKETS - 1)] += trans;
+}
+
+static void sprd_busmon_perf_work(struct work_struct *work)
+{
+	struct sprd_busmonitor *bm = container_of(to_delayed_work(work),
+						  struct sprd_busmonitor,
+						  perf_work);
+	struct djtag_master *master = bm->ddev->master;
+	bool active = false;
+	u32 i, val[7];
+
+	mutex_lock(&bm->perf_lock);
+	if (master->ops->lock(master))
+		goto out;
+
+	for (i = 0; i < bm->num; i++) {
+		struct bm_perf *perf = &bm->perf[i];
+
+		if (!perf->win_len)
+			continue;
+
+		active = true;
+		master->ops->mux_sel(master, bm->ddev->sys, bm->desc[i].dap);
+		val[0] = DBREAD(AHB_RTRANS_IN_WIN);
+		val[1] = DBREAD(AHB_RBW_IN_WIN);
+		val[2] = DBREAD(AHB_RLATENCE_IN_WIN);
+		val[3] = DBREAD(AHB_WTRANS_IN_WIN);
+		val[4] = DBREAD(AHB_WBW_IN_WIN);
+		val[5] = DBREAD(AHB_WLATENCE_IN_WIN);
+		val[6] = DBREAD(AHB_PEAKBW_IN_WIN);
+
+		perf->windows++;
+		sprd_busmon_perf_account(perf, 0, val[0], val[1], val[2]);
+		sprd_busmon_perf_account(perf, 1, val[3], val[4], val[5]);
+		perf->peak_bw = max(perf->peak_bw, val[6]);
+	}
+	master->ops->unlock(master);
+
+out:
+	if (active)
+		schedule_delayed_work(&bm->perf_work,
+				      msecs_to_jiffies(bm->perf_period));
+	mutex_unlock(&bm->perf_lock);
+}
+
 static int sprd_busmon_init(struct sprd_busmonitor *bm)
 {
 	int i, ret;
@@ -523,12 +622,122 @@ static ssize_t sprd_busmon_cfg_show(struct device *dev,
 	return cnt;
 }
 
+static ssize_t sprd_busmon_perf_store(struct device *dev,
+				      struct device_attribute *attr,
+				      const char *buf, size_t count)
+{
+	struct sprd_busmonitor *bm = dev_get_drvdata(dev);
+	struct djtag_master *master = bm->ddev->master;
+	u32 num, win_len;
+	int ret;
+
+	ret = sscanf(buf, "%u %x", &num, &win_len);
+	if (ret != 2) {
+		dev_err(dev->parent,
+			"enter wrong parameter number\n");
+		return -EINVAL;
+	}
+
+	if (num >= bm->num) {
+		dev_err(dev->parent,
+			"enter num wrong parameter\n");
+		return -EINVAL;
+	}
+
+	/* only the ahb monitors have window counters */
+	if (bm->desc[num].type) {
+		dev_err(dev->parent, "%s has no perf counters\n",
+			bm->desc[num].name);
+		return -EOPNOTSUPP;
+	}
+
+	mutex_lock(&bm->perf_lock);
+	memset(&bm->perf[num], 0, sizeof(bm->perf[num]));
+	bm->perf[num].win_len = win_len;
+	if (win_len) {
+		ret = master->ops->lock(master);
+		if (ret) {
+			bm->perf[num].win_len = 0;
+			mutex_unlock(&bm->perf_lock);
+			return -ENODEV;
+		}
+		sprd_busmon_perf_start(bm, num);
+		master->ops->unlock(master);
+		schedule_delayed_work(&bm->perf_work,
+				      msecs_to_jiffies(bm->perf_period));
+	}
+	mutex_unlock(&bm->perf_lock);
+
+	return strnlen(buf, count);
+}
+
+static ssize_t sprd_busmon_perf_show(struct device *dev,
+			struct device_attribute *attr,  char *buf)
+{
+	static const char * const dir_name[BM_PERF_DIRS] = { "R", "W" };
+	struct sprd_busmonitor *bm = dev_get_drvdata(dev);
+	struct bm_perf *perf;
+	int i, dir, n, cnt = 0;
+
+	mutex_lock(&bm->perf_lock);
+	for (i = 0; i < bm->num; i++) {
+		perf = &bm->perf[i];
+		if (!perf->win_len)
+			continue;
+
+		cnt += scnprintf(buf + cnt, PAGE_SIZE - cnt,
+				 "%s: win 0x%x windows %llu peak_bw %u\n",
+				 bm->desc[i].name, perf->win_len,
+				 perf->windows, perf->peak_bw);
+		for (dir = 0; dir < BM_PERF_DIRS; dir++) {
+			cnt += scnprintf(buf + cnt, PAGE_SIZE - cnt,
+					 " %s trans %llu bw %llu latency %llu hist",
+					 dir_name[dir], perf->trans[dir],
+					 perf->bw[dir], perf->latency[dir]);
+			for (n = 0; n < BM_PERF_BUCKETS; n++)
+				cnt += scnprintf(buf + cnt, PAGE_SIZE - cnt,
+						 " %llu", perf->hist[dir][n]);
+			cnt += scnprintf(buf + cnt, PAGE_SIZE - cnt, "\n");
+		}
+	}
+	mutex_unlock(&bm->perf_lock);
+
+	return cnt;
+}
+
+static ssize_t sprd_busmon_perf_period_store(struct device *dev,
+				      struct device_attribute *attr,
+				      const char *buf, size_t count)
+{
+	struct sprd_busmonitor *bm = dev_get_drvdata(dev);
+	u32 period;
+
+	if (kstrtou32(buf, 0, &period) || !period)
+		return -EINVAL;
+
+	bm->perf_period = period;
+
+	return strnlen(buf, count);
+}
+
+static ssize_t sprd_busmon_perf_period_show(struct device *dev,
+			struct device_attribute *attr,  char *buf)
+{
+	struct sprd_busmonitor *bm = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%u\n", bm->perf_period);
+}
+
 static DEVICE_ATTR(busmonitor, 0440, sprd_busmon_show, NULL);
 static DEVICE_ATTR(dump_scene, 0440, sprd_busmon_dump_show, NULL);
 static DEVICE_ATTR(panic, 0440, sprd_busmon_panic_show, NULL);
 static DEVICE_ATTR(active, 0644, NULL, sprd_busmon_active_store);
 static DEVICE_ATTR(config, 0644, sprd_busmon_cfg_show,
 		   sprd_busmon_cfg_store);
+static DEVICE_ATTR(perf, 0644, sprd_busmon_perf_show,
+		   sprd_busmon_perf_store);
+static DEVICE_ATTR(perf_period, 0644, sprd_busmon_perf_period_show,
+		   sprd_busmon_perf_period_store);
 
 static struct attribute *busmon_attrs[] = {
 	&dev_attr_busmonitor.attr,
@@ -536,6 +745,8 @@ static struct attribute *busmon_attrs[] = {
 	&dev_attr_panic.attr,
 	&dev_attr_active.attr,
 	&dev_attr_config.attr,
+	&dev_attr_perf.attr,
+	&dev_attr_perf_period.attr,
 	NULL,
 };
 static struct attribute_group busmon_group = {
@@ -571,6 +782,14 @@ static int sprd_busmon_probe(struct djtag_device *ddev)
 	if (!bm->cf)
 		return -ENOMEM;
 
+	bm->perf = devm_kzalloc(&ddev->dev, sizeof(*bm->perf) * bm->num,
+				GFP_KERNEL);
+	if (!bm->perf)
+		return -ENOMEM;
+	mutex_init(&bm->perf_lock);
+	INIT_DELAYED_WORK(&bm->perf_work, sprd_busmon_perf_work);
+	bm->perf_period = BM_PERF_PERIOD_MS;
+
 	ret = sprd_busmon_init(bm);
 	if (ret)
 		return ret;
@@ -611,6 +830,7 @@ static int sprd_busmon_remove(struct djtag_device *ddev)
 	struct sprd_busmonitor *bm = dev_get_drvdata(&ddev->dev);
 
 	sysfs_remove_group(&bm->dev->kobj, &busmon_group);
+	cancel_delayed_work_sync(&bm->perf_work);
 	return 0;
 }
 
@@ -622,6 +842,17 @@ static int sprd_busmon_resume(struct device *dev)
 		return 0;
 	sprd_busmon_config_all(bm);
 
+	mutex_lock(&bm->perf_lock);
+	if (!bm->ddev->master->ops->lock(bm->ddev->master)) {
+		u32 i;
+
+		for (i = 0; i < bm->num; i++)
+			if (bm->perf[i].win_len)
+				sprd_busmon_perf_start(bm, i);
+		bm->ddev->master->ops->unlock(bm->ddev->master);
+	}
+	mutex_unlock(&bm->perf_lock);
+
 	return 0;
 }
 
@@ -0,0 +1,308 @@
+/*
+ * SPRD CPU PROFILER:
+ *    1. samples every online cpu cpu_prof_hz times per second
+ *    2. splits the samples into user, system, softirq, hardirq and idle
+ *    3. counts the user and system samples per task
+ *    4. exports the counts of each window in binary, see sprd_cpu_prof.h
+ */
+#include <linux/cpu.h>
+#include <linux/cpuhotplug.h>
+#include <linux/debugfs.h>
+#include <linux/hardirq.h>
+#include <linux/hash.h>
+#include <linux/hrtimer.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/kernel_stat.h>
+#include <linux/log2.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/sched.h>
+#include <linux/sched/clock.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <asm/irq_regs.h>
+#include "../sprd_debugfs.h"
+#include "sprd_cpu_prof.h"
+
+/*
+ * Macros Definitions:
+ * ----------------------------------------------
+ * CPU_PROF_MAX_HZ : highest sample rate per cpu
+ * CPU_PROF_PROBE  : buckets tried per task before it goes to "other"
+ */
+#define CPU_PROF_MAX_HZ	1000
+#define CPU_PROF_PROBE	4
+
+/*
+ * Per Cpu State:
+ * ----------------------------------------------
+ *   lock        : between the sample timer and the reader
+ *   timer       : pinned sample timer
+ *   data        : counts of the current window
+ *   irq_base    : CPUTIME_IRQ at the window start
+ *   softirq_base: CPUTIME_SOFTIRQ at the window start
+ */
+struct cpu_prof_state {
+	raw_spinlock_t lock;
+	struct hrtimer timer;
+	struct cpu_prof_cpu data;
+	u64 irq_base;
+	u64 softirq_base;
+};
+
+static DEFINE_PER_CPU(struct cpu_prof_state, cpu_prof_state);
+static DEFINE_MUTEX(cpu_prof_mutex);
+static unsigned int cpu_prof_hz;
+static u64 cpu_prof_ns_start;
+
+static enum cpu_prof_class cpu_prof_classify(struct pt_regs *regs)
+{
+	if (regs && user_mode(regs))
+		return CPU_PROF_USER;
+	/* the sample timer itself holds one hardirq count */
+	if (hardirq_count() > HARDIRQ_OFFSET)
+		return CPU_PROF_HARDIRQ;
+	if (in_serving_softirq())
+		return CPU_PROF_SOFTIRQ;
+	if (is_idle_task(current))
+		return CPU_PROF_IDLE;
+	return CPU_PROF_SYSTEM;
+}
+
+static void cpu_prof_task_hit(struct cpu_prof_cpu *data,
+			      struct task_struct *tsk)
+{
+	u32 h = hash_32(tsk->pid, ilog2(CPU_PROF_TASKS));
+	struct cpu_prof_task *t;
+	int i;
+
+	for (i = 0; i < CPU_PROF_PROBE; i++) {
+		t = &data->task[(h + i) & (CPU_PROF_TASKS - 1)];
+		if (t->pid == tsk->pid) {
+			t->samples++;
+			return;
+		}
+		if (!t->pid) {
+			t->pid = tsk->pid;
+			memcpy(t->comm, tsk->comm, CPU_PROF_COMM_LEN);
+			t->comm[CPU_PROF_COMM_LEN - 1] = '\0';
+			t->samples = 1;
+			return;
+		}
+	}
+
+	data->other.samples++;
+}
+
+static enum hrtimer_restart cpu_prof_sample(struct hrtimer *timer)
+{
+	struct cpu_prof_state *st = this_cpu_ptr(&cpu_prof_state);
+	unsigned int hz = READ_ONCE(cpu_prof_hz);
+	enum cpu_prof_class cls;
+
+	if (!hz)
+		return HRTIMER_NORESTART;
+
+	cls = cpu_prof_classify(get_irq_regs());
+
+	raw_spin_lock(&st->lock);
+	st->data.samples++;
+	st->data.cls[cls]++;
+	if (cls == CPU_PROF_USER || cls == CPU_PROF_SYSTEM)
+		cpu_prof_task_hit(&st->data, current);
+	raw_spin_unlock(&st->lock);
+
+	hrtimer_forward_now(timer, ns_to_ktime(NSEC_PER_SEC / hz));
+	return HRTIMER_RESTART;
+}
+
+/* runs on the cpu to sample, the timer is pinned to it */
+static void cpu_prof_start(void *unused)
+{
+	struct cpu_prof_state *st = this_cpu_ptr(&cpu_prof_state);
+	unsigned int hz = READ_ONCE(cpu_prof_hz);
+
+	if (hz && !hrtimer_active(&st->timer))
+		hrtimer_start(&st->timer, ns_to_ktime(NSEC_PER_SEC / hz),
+			      HRTIMER_MODE_REL_PINNED);
+}
+
+static int cpu_prof_online(unsigned int cpu)
+{
+	cpu_prof_start(NULL);
+	return 0;
+}
+
+static int cpu_prof_offline(unsigned int cpu)
+{
+	hrtimer_cancel(&per_cpu(cpu_prof_state, cpu).timer);
+	return 0;
+}
+
+/* copy out the window of each cpu and start a new one */
+static void cpu_prof_snapshot(struct cpu_prof_header *hdr)
+{
+	struct cpu_prof_cpu *out = (struct cpu_prof_cpu *)(hdr + 1);
+	unsigned long flags;
+	int cpu;
+
+	hdr->magic = CPU_PROF_MAGIC;
+	hdr->version = CPU_PROF_VERSION;
+	hdr->nr_cpus = nr_cpu_ids;
+	hdr->nr_tasks = CPU_PROF_TASKS;
+	hdr->sample_hz = cpu_prof_hz;
+	hdr->cpu_size = sizeof(*out);
+	hdr->ns_start = cpu_prof_ns_start;
+	hdr->ns_end = cpu_clock(0);
+	cpu_prof_ns_start = hdr->ns_end;
+
+	for (cpu = 0; cpu < nr_cpu_ids; cpu++, out++) {
+		struct cpu_prof_state *st = &per_cpu(cpu_prof_state, cpu);
+		u64 irq, softirq;
+
+		if (!cpu_possible(cpu)) {
+			memset(out, 0, sizeof(*out));
+			out->cpu = cpu;
+			continue;
+		}
+
+		raw_spin_lock_irqsave(&st->lock, flags);
+		memcpy(out, &st->data, sizeof(*out));
+		memset(&st->data, 0, sizeof(st->data));
+		raw_spin_unlock_irqrestore(&st->lock, flags);
+
+		irq = kcpustat_cpu(cpu).cpustat[CPUTIME_IRQ];
+		softirq = kcpustat_cpu(cpu).cpustat[CPUTIME_SOFTIRQ];
+		out->cpu = cpu;
+		out->online = cpu_online(cpu);
+		out->other.pid = -1;
+		out->irq_ns = irq - st->irq_base;
+		out->softirq_ns = softirq - st->softirq_base;
+		st->irq_base = irq;
+		st->softirq_base = softirq;
+	}
+}
+
+static size_t cpu_prof_size(void)
+{
+	return sizeof(struct cpu_prof_header) +
+		nr_cpu_ids * sizeof(struct cpu_prof_cpu);
+}
+
+static int cpu_prof_open(struct inode *inode, struct file *file)
+{
+	file->private_data = vzalloc(cpu_prof_size());
+	if (!file->private_data)
+		return -ENOMEM;
+	return 0;
+}
+
+static int cpu_prof_release(struct inode *inode, struct file *file)
+{
+	vfree(file->private_data);
+	return 0;
+}
+
+static ssize_t cpu_prof_read(struct file *file, char __user *buf,
+			     size_t len, loff_t *ppos)
+{
+	/* a read from the start takes the snapshot, the rest reads it */
+	if (*ppos == 0) {
+		mutex_lock(&cpu_prof_mutex);
+		cpu_prof_snapshot(file->private_data);
+		mutex_unlock(&cpu_prof_mutex);
+	}
+
+	return simple_read_from_buffer(buf, len, ppos, file->private_data,
+				       cpu_prof_size());
+}
+
+const struct file_operations cpu_prof_fops = {
+	.open = cpu_prof_open,
+	.read = cpu_prof_read,
+	.llseek = default_llseek,
+	.release = cpu_prof_release,
+};
+
+static int cpu_prof_hz_show(struct seq_file *p, void *v)
+{
+	seq_printf(p, "%u\n", cpu_prof_hz);
+	return 0;
+}
+
+static int cpu_prof_hz_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, cpu_prof_hz_show, NULL);
+}
+
+static ssize_t cpu_prof_hz_write(struct file *file, const char __user *buf,
+				 size_t len, loff_t *ppos)
+{
+	unsigned int hz;
+	int ret;
+
+	ret = kstrtouint_from_user(buf, len, 0, &hz);
+	if (ret < 0)
+		return ret;
+
+	if (hz > CPU_PROF_MAX_HZ)
+		return -EINVAL;
+
+	/*
+	 * A running timer picks up the new rate on its next sample and
+	 * stops itself at 0, only stopped timers need a kick.
+	 */
+	mutex_lock(&cpu_prof_mutex);
+	WRITE_ONCE(cpu_prof_hz, hz);
+	if (hz) {
+		get_online_cpus();
+		on_each_cpu(cpu_prof_start, NULL, 1);
+		put_online_cpus();
+	}
+	mutex_unlock(&cpu_prof_mutex);
+
+	return len;
+}
+
+const struct file_operations cpu_prof_hz_fops = {
+	.open = cpu_prof_hz_open,
+	.read = seq_read,
+	.write = cpu_prof_hz_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init sprd_cpu_prof_init(void)
+{
+	int cpu, ret;
+
+	for_each_possible_cpu(cpu) {
+		struct cpu_prof_state *st = &per_cpu(cpu_prof_state, cpu);
+
+		raw_spin_lock_init(&st->lock);
+		hrtimer_init(&st->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+		st->timer.function = cpu_prof_sample;
+		st->irq_base = kcpustat_cpu(cpu).cpustat[CPUTIME_IRQ];
+		st->softirq_base = kcpustat_cpu(cpu).cpustat[CPUTIME_SOFTIRQ];
+	}
+	cpu_prof_ns_start = cpu_clock(0);
+
+	ret = cpuhp_setup_state(CPUHP_AP_ONLINE_DYN, "sprd/cpu_prof:online",
+				cpu_prof_online, cpu_prof_offline);
+	if (ret < 0)
+		return ret;
+
+	/* create debugfs */
+	debugfs_create_file("cpu_prof", 0444, sprd_debugfs_entry(CPU),
+			    NULL, &cpu_prof_fops);
+	debugfs_create_file("cpu_prof_hz", 0644, sprd_debugfs_entry(CPU),
+			    NULL, &cpu_prof_hz_fops);
+
+	return 0;
+}
+
+subsys_initcall(sprd_cpu_prof_init);
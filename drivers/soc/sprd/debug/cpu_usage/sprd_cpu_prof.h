@@ -0,0 +1,68 @@
+/*
+ * SPRD CPU PROFILER binary format:
+ *    read of debugfs sprd_debug/cpu/cpu_prof returns one cpu_prof_header
+ *    followed by nr_cpus cpu_prof_cpu, one per possible cpu in cpu order.
+ *    Every read starts a new window, the counts are for the window that
+ *    ended with the read.
+ */
+#ifndef __SPRD_CPU_PROF_H
+#define __SPRD_CPU_PROF_H
+
+#include <linux/types.h>
+
+#define CPU_PROF_MAGIC		0x46525043	/* "CPRF" */
+#define CPU_PROF_VERSION	1
+#define CPU_PROF_TASKS		32	/* task buckets per cpu, a power of 2 */
+#define CPU_PROF_COMM_LEN	16
+
+/*
+ * Where a sample hit:
+ *   USER    : task in user mode
+ *   SYSTEM  : task in kernel mode
+ *   SOFTIRQ : softirq, in irq exit or in ksoftirqd
+ *   HARDIRQ : another irq handler the sample timer interrupted
+ *   IDLE    : idle task
+ */
+enum cpu_prof_class {
+	CPU_PROF_USER,
+	CPU_PROF_SYSTEM,
+	CPU_PROF_SOFTIRQ,
+	CPU_PROF_HARDIRQ,
+	CPU_PROF_IDLE,
+	CPU_PROF_NR_CLASS,
+};
+
+struct cpu_prof_header {
+	u32 magic;
+	u32 version;
+	u32 nr_cpus;
+	u32 nr_tasks;		/* CPU_PROF_TASKS */
+	u32 sample_hz;		/* 0: sampling off */
+	u32 cpu_size;		/* sizeof(struct cpu_prof_cpu) */
+	u64 ns_start;		/* cpu_clock() window start */
+	u64 ns_end;
+};
+
+/*
+ * USER and SYSTEM samples go to the bucket of their task. pid -1 collects
+ * the tasks which found their buckets taken.
+ */
+struct cpu_prof_task {
+	s32 pid;		/* 0: empty bucket */
+	u32 reserved;
+	u64 samples;
+	char comm[CPU_PROF_COMM_LEN];
+};
+
+struct cpu_prof_cpu {
+	u32 cpu;
+	u32 online;
+	u64 samples;
+	u64 cls[CPU_PROF_NR_CLASS];
+	u64 irq_ns;		/* hard irq time from kernel_cpustat */
+	u64 softirq_ns;		/* soft irq time from kernel_cpustat */
+	struct cpu_prof_task other;
+	struct cpu_prof_task task[CPU_PROF_TASKS];
+};
+
+#endif
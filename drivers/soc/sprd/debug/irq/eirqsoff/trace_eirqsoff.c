@@ -8,6 +8,7 @@
 #include <linux/sched/clock.h>
 #include <linux/uaccess.h>
 #include "../../sprd_debugfs.h"
+#include "../irq_event.h"
 
 #define DEFAULT_WARNING_INTERVAL (30*NSEC_PER_MSEC)
 
@@ -20,6 +21,8 @@ static DEFINE_PER_CPU(unsigned long, eirqsoff_ip);
 static DEFINE_PER_CPU(unsigned long, eirqsoff_parent_ip);
 
 static unsigned long long __read_mostly warning_interval;
+/* events always go to the irq_event ring, the log only on request */
+static bool __read_mostly warning_print = IS_ENABLED(CONFIG_SPRD_DEBUG);
 
 #ifdef CONFIG_PREEMPT_TRACER
 static DEFINE_PER_CPU(unsigned int, epreempt_is_tracing);
@@ -86,6 +89,12 @@ void notrace stop_eirqsoff_timing(unsigned long ip, unsigned long parent_ip)
 		interval = stop_timestamp - start_timestamp;
 
 		if (interval > warning_interval) {
+			irq_event_record(IRQ_EVENT_IRQSOFF, start_timestamp,
+					 interval,
+					 __this_cpu_read(eirqsoff_ip),
+					 __this_cpu_read(eirqsoff_parent_ip), 0);
+			if (!warning_print)
+				goto out;
 
 			start_timestamp_ms = do_div(start_timestamp, NSEC_PER_SEC);
 			interval_us = do_div(interval, NSEC_PER_MSEC);
@@ -104,6 +113,7 @@ void notrace stop_eirqsoff_timing(unsigned long ip, unsigned long parent_ip)
 			dump_stack();
 		}
 	}
+out:
 	__this_cpu_write(eirqsoff_start_timestamp, 0);
 }
 
@@ -167,6 +177,12 @@ void notrace stop_epreempt_timing(unsigned long ip, unsigned long parent_ip)
 		interval = stop_timestamp - start_timestamp;
 
 		if (interval > epreempt_interval) {
+			irq_event_record(IRQ_EVENT_PREEMPTOFF, start_timestamp,
+					 interval,
+					 __this_cpu_read(epreempt_ip),
+					 __this_cpu_read(epreempt_parent_ip), 0);
+			if (!warning_print)
+				goto out;
 
 			start_timestamp_ms = do_div(start_timestamp, NSEC_PER_SEC);
 			interval_us = do_div(interval, NSEC_PER_MSEC);
@@ -185,6 +201,7 @@ void notrace stop_epreempt_timing(unsigned long ip, unsigned long parent_ip)
 			dump_stack();
 		}
 	}
+out:
 	__this_cpu_write(epreempt_start_timestamp, 0);
 
 }
@@ -259,6 +276,10 @@ static int __init trace_eirqsoff_init(void)
 			    sprd_debugfs_entry(IRQ),
 			    NULL,
 			    &eirqsoff_interval_fops);
+	debugfs_create_bool("warning_print",
+			    0644,
+			    sprd_debugfs_entry(IRQ),
+			    &warning_print);
 	return 0;
 }
 
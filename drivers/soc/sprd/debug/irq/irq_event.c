@@ -0,0 +1,282 @@
+#include <linux/debugfs.h>
+#include <linux/gfp.h>
+#include <linux/kernel.h>
+#include <linux/log2.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/percpu.h>
+#include <linux/sched.h>
+#include <linux/sched/signal.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include "../sprd_debugfs.h"
+#include "irq_event.h"
+
+#define IRQ_EVENT_LINE_SIZE	256
+#define IRQ_EVENT_POLL_MS	100
+
+static DEFINE_PER_CPU(struct irq_event_ring *, irq_event_ring);
+
+static const char * const irq_event_name[] = {
+	[IRQ_EVENT_IRQSOFF]	= "irqsoff",
+	[IRQ_EVENT_PREEMPTOFF]	= "preemptoff",
+	[IRQ_EVENT_STORM]	= "storm",
+};
+
+/*
+ * Only the owning cpu writes its ring and only with irqs off, so there is
+ * no lock, readers find torn slots by their seq. Called from the irqsoff
+ * hooks, hence the raw irq flags, the traced ones would recurse.
+ */
+void notrace irq_event_record(enum irq_event_type type, u64 ts, u64 value,
+			      unsigned long ip, unsigned long parent_ip,
+			      unsigned int irq)
+{
+	struct irq_event_ring *ring;
+	struct irq_event *ev;
+	unsigned long flags;
+	u64 head;
+
+	raw_local_irq_save(flags);
+	ring = __this_cpu_read(irq_event_ring);
+	if (unlikely(!ring))
+		goto out;
+
+	head = ring->head;
+	ev = &ring->ev[head & (ring->nr - 1)];
+
+	WRITE_ONCE(ev->seq, (u32)head * 2 + 1);
+	smp_wmb();
+	ev->ts = ts;
+	ev->value = value;
+	ev->ip = ip;
+	ev->parent_ip = parent_ip;
+	ev->type = type;
+	ev->cpu = raw_smp_processor_id();
+	ev->pid = current->pid;
+	ev->irq = irq;
+	smp_wmb();
+	WRITE_ONCE(ev->seq, (u32)head * 2 + 2);
+	smp_store_release(&ring->head, head + 1);
+out:
+	raw_local_irq_restore(flags);
+}
+
+/* copy event n of ring, false if it is written or already overwritten */
+static bool irq_event_read(struct irq_event_ring *ring, u64 n,
+			   struct irq_event *ev)
+{
+	struct irq_event *slot = &ring->ev[n & (ring->nr - 1)];
+	u32 seq = (u32)n * 2 + 2;
+
+	if (READ_ONCE(slot->seq) != seq)
+		return false;
+	smp_rmb();
+	*ev = *slot;
+	smp_rmb();
+	return READ_ONCE(slot->seq) == seq;
+}
+
+struct irq_event_reader {
+	u64 *pos;
+	char line[IRQ_EVENT_LINE_SIZE];
+};
+
+static int irq_event_open(struct inode *inode, struct file *file)
+{
+	struct irq_event_reader *r;
+	int cpu;
+
+	r = kzalloc(sizeof(*r), GFP_KERNEL);
+	if (!r)
+		return -ENOMEM;
+
+	r->pos = kcalloc(nr_cpu_ids, sizeof(*r->pos), GFP_KERNEL);
+	if (!r->pos) {
+		kfree(r);
+		return -ENOMEM;
+	}
+
+	/* like trace_pipe, only what happens from now on */
+	for_each_possible_cpu(cpu) {
+		struct irq_event_ring *ring = per_cpu(irq_event_ring, cpu);
+
+		if (ring)
+			r->pos[cpu] = smp_load_acquire(&ring->head);
+	}
+
+	file->private_data = r;
+	return nonseekable_open(inode, file);
+}
+
+static int irq_event_release(struct inode *inode, struct file *file)
+{
+	struct irq_event_reader *r = file->private_data;
+
+	kfree(r->pos);
+	kfree(r);
+	return 0;
+}
+
+static int irq_event_format(struct irq_event_reader *r, int cpu,
+			    struct irq_event *ev)
+{
+	u64 ts = ev->ts;
+	u32 ns = do_div(ts, NSEC_PER_SEC);
+
+	return scnprintf(r->line, sizeof(r->line),
+			 "[%03d] %llu.%09u %s pid=%d irq=%u value=%llu ip=%pS parent=%pS\n",
+			 cpu, ts, ns,
+			 ev->type < ARRAY_SIZE(irq_event_name) ?
+			 irq_event_name[ev->type] : "unknown",
+			 ev->pid, ev->irq, ev->value,
+			 (void *)(unsigned long)ev->ip,
+			 (void *)(unsigned long)ev->parent_ip);
+}
+
+static ssize_t irq_event_fill(struct irq_event_reader *r,
+			      char __user *ubuf, size_t cnt)
+{
+	struct irq_event ev;
+	size_t done = 0;
+	int cpu, len;
+
+	for_each_possible_cpu(cpu) {
+		struct irq_event_ring *ring = per_cpu(irq_event_ring, cpu);
+		u64 head;
+
+		if (!ring)
+			continue;
+
+		head = smp_load_acquire(&ring->head);
+		if (head - r->pos[cpu] > ring->nr) {
+			len = scnprintf(r->line, sizeof(r->line),
+					"[%03d] lost %llu events\n", cpu,
+					head - ring->nr - r->pos[cpu]);
+			if (done + len > cnt)
+				return done;
+			if (copy_to_user(ubuf + done, r->line, len))
+				return -EFAULT;
+			done += len;
+			r->pos[cpu] = head - ring->nr;
+		}
+
+		for (; r->pos[cpu] != head; r->pos[cpu]++) {
+			if (!irq_event_read(ring, r->pos[cpu], &ev))
+				continue;
+
+			len = irq_event_format(r, cpu, &ev);
+			if (done + len > cnt)
+				return done;
+			if (copy_to_user(ubuf + done, r->line, len))
+				return -EFAULT;
+			done += len;
+		}
+	}
+
+	return done;
+}
+
+static ssize_t irq_event_pipe_read(struct file *file, char __user *ubuf,
+				   size_t cnt, loff_t *ppos)
+{
+	struct irq_event_reader *r = file->private_data;
+	ssize_t ret;
+
+	if (cnt < IRQ_EVENT_LINE_SIZE)
+		return -EINVAL;
+
+	/*
+	 * The writers run with irqs off and must not wake anybody up,
+	 * so an empty pipe is polled.
+	 */
+	for (;;) {
+		ret = irq_event_fill(r, ubuf, cnt);
+		if (ret)
+			return ret;
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		if (schedule_timeout_interruptible(
+				msecs_to_jiffies(IRQ_EVENT_POLL_MS)) ||
+		    signal_pending(current))
+			return -ERESTARTSYS;
+	}
+}
+
+static const struct file_operations irq_event_pipe_fops = {
+	.open    = irq_event_open,
+	.read    = irq_event_pipe_read,
+	.release = irq_event_release,
+	.llseek  = no_llseek,
+};
+
+static int irq_event_raw_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	unsigned long size = vma->vm_end - vma->vm_start;
+	unsigned long addr = vma->vm_start;
+	int cpu;
+
+	if (vma->vm_pgoff || size > nr_cpu_ids * IRQ_EVENT_RING_SIZE)
+		return -EINVAL;
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	for (cpu = 0; cpu < nr_cpu_ids && addr < vma->vm_end; cpu++) {
+		struct irq_event_ring *ring = per_cpu(irq_event_ring, cpu);
+		unsigned long len = min(IRQ_EVENT_RING_SIZE, vma->vm_end - addr);
+
+		if (!cpu_possible(cpu) || !ring)
+			return -EINVAL;
+
+		if (remap_pfn_range(vma, addr, virt_to_phys(ring) >> PAGE_SHIFT,
+				    len, vma->vm_page_prot))
+			return -EAGAIN;
+		addr += len;
+	}
+
+	return 0;
+}
+
+static const struct file_operations irq_event_raw_fops = {
+	.open    = simple_open,
+	.mmap    = irq_event_raw_mmap,
+	.llseek  = no_llseek,
+};
+
+static int __init irq_event_init(void)
+{
+	struct dentry *dir;
+	struct page *page;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct irq_event_ring *ring;
+
+		page = alloc_pages_node(cpu_to_node(cpu),
+					GFP_KERNEL | __GFP_ZERO,
+					IRQ_EVENT_RING_ORDER);
+		if (!page) {
+			pr_err("irq_event: no ring for cpu%d\n", cpu);
+			continue;
+		}
+
+		ring = page_address(page);
+		ring->nr = rounddown_pow_of_two((IRQ_EVENT_RING_SIZE -
+				sizeof(*ring)) / sizeof(struct irq_event));
+		ring->entry_size = sizeof(struct irq_event);
+		per_cpu(irq_event_ring, cpu) = ring;
+	}
+
+	dir = debugfs_create_dir("irq_event", sprd_debugfs_entry(IRQ));
+	if (dir) {
+		debugfs_create_file("trace_pipe", 0400, dir, NULL,
+				    &irq_event_pipe_fops);
+		debugfs_create_file("raw", 0400, dir, NULL,
+				    &irq_event_raw_fops);
+	}
+
+	return 0;
+}
+
+fs_initcall(irq_event_init);
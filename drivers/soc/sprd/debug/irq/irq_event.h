@@ -0,0 +1,57 @@
+#ifndef __SPRD_IRQ_EVENT_H
+#define __SPRD_IRQ_EVENT_H
+
+#include <linux/types.h>
+
+/*
+ * Events of the irqsoff and irq storm monitors, kept in a ring per cpu.
+ *
+ * debugfs sprd_debug/irq/irq_event/raw maps the rings read only, one
+ * after the other in cpu order, each IRQ_EVENT_RING_SIZE bytes long. A
+ * ring is a struct irq_event_ring followed by nr slots. Event n is in
+ * slot n % nr and its seq is 2 * n + 2 once it is complete, 2 * n + 1
+ * while it is written. A reader copies the slot and checks seq before and
+ * after the copy. sprd_debug/irq/irq_event/trace_pipe has the same events
+ * as text, each open consumes the events it has read.
+ */
+#define IRQ_EVENT_RING_ORDER	2
+#define IRQ_EVENT_RING_SIZE	(PAGE_SIZE << IRQ_EVENT_RING_ORDER)
+
+enum irq_event_type {
+	IRQ_EVENT_IRQSOFF,	/* value: ns the irqs were disabled */
+	IRQ_EVENT_PREEMPTOFF,	/* value: ns the preemption was disabled */
+	IRQ_EVENT_STORM,	/* value: irqs in one sample interval */
+};
+
+struct irq_event {
+	u64 ts;			/* sched_clock() at the start of the section */
+	u64 value;
+	u64 ip;
+	u64 parent_ip;
+	u32 seq;
+	u16 type;		/* enum irq_event_type */
+	u16 cpu;
+	s32 pid;
+	u32 irq;		/* IRQ_EVENT_STORM only */
+};
+
+struct irq_event_ring {
+	u64 head;		/* events written so far */
+	u32 nr;			/* slots, a power of two */
+	u32 entry_size;		/* sizeof(struct irq_event) */
+	struct irq_event ev[0];
+};
+
+#if defined(CONFIG_SPRD_EIRQSOFF) || defined(CONFIG_SPRD_IRQS_MONITOR)
+extern void notrace irq_event_record(enum irq_event_type type, u64 ts,
+				     u64 value, unsigned long ip,
+				     unsigned long parent_ip, unsigned int irq);
+#else
+static inline void irq_event_record(enum irq_event_type type, u64 ts,
+				    u64 value, unsigned long ip,
+				    unsigned long parent_ip, unsigned int irq)
+{
+}
+#endif
+
+#endif
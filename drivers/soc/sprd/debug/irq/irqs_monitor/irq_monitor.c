@@ -9,10 +9,12 @@
 #include <linux/kthread.h>
 #include <linux/module.h>
 #include <linux/sched.h>
+#include <linux/sched/clock.h>
 #include <linux/slab.h>
 #include <linux/uaccess.h>
 #include <uapi/linux/sched/types.h>
 #include "../../sprd_debugfs.h"
+#include "../irq_event.h"
 
 #define DEFAULT_SAMPLE_TIMEVALE 1000
 #define DEFAULT_THRESHOLD_IRQ   3000
@@ -39,6 +41,7 @@ static struct irq_monitor_s *irq_monitor;
 static int save_nr_irqs;
 static struct task_struct *irqs_change_task;
 static bool Processing;
+static bool print_warning = IS_ENABLED(CONFIG_SPRD_DEBUG);
 
 static enum hrtimer_restart scan_burst_irq(struct hrtimer *hr)
 {
@@ -76,11 +79,17 @@ static enum hrtimer_restart scan_burst_irq(struct hrtimer *hr)
 			irq_occur_value =
 			(int)(tmp_kstat_irq-irq_monitor[i].prev_kstat_irq);
 			if (irq_occur_value != 0) {
-				if (irq_occur_value > threshold_irq)
-					pr_warning("Irq_monitor:Irq %45s[%d]occur %11d times per %d ms\n",
-					action->name, i,
-					irq_occur_value,
-					time_interval);
+				if (irq_occur_value > threshold_irq) {
+					irq_event_record(IRQ_EVENT_STORM,
+						sched_clock(), irq_occur_value,
+						(unsigned long)action->handler,
+						(unsigned long)action->thread_fn, i);
+					if (print_warning)
+						pr_warning("Irq_monitor:Irq %45s[%d]occur %11d times per %d ms\n",
+						action->name, i,
+						irq_occur_value,
+						time_interval);
+				}
 
 				if (irq_monitor[i].mark == true &&
 				(irq_occur_value > irq_monitor[i].brust_value)) {
@@ -511,6 +520,8 @@ static int __init irq_monitor_init(void)
 				    irq_burst_monitor, NULL, &monitor_enable_fops);
 		debugfs_create_file("threshold_irq", (S_IRUGO | S_IWUSR | S_IWGRP),
 				    irq_burst_monitor, NULL, &threshold_irq_fops);
+		debugfs_create_bool("print_warning", (S_IRUGO | S_IWUSR | S_IWGRP),
+				    irq_burst_monitor, &print_warning);
 	}
 
 	hrtimer_init(&irq_monitor_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
@@ -22,9 +22,12 @@
 #include <linux/sched/types.h>
 #include <linux/sched/task_stack.h>
 #include <linux/sched/mm.h>
+#include <linux/sched/clock.h>
 #include <linux/kthread.h>
 #include <linux/ptrace.h>
+#include <linux/stacktrace.h>
 #include <asm/stacktrace.h>
+#include <../../../kernel/sched/sched.h>
 
 #include "native_hang_monitor.h"
 
@@ -34,6 +37,10 @@ static atomic_t hang_detect_counter;
 char hang_info[HANG_INFO_MAX];
 static int hang_info_index;
 struct task_struct *hd_thread;
+static struct hang_sample hang_samples[HANG_SAMPLE_NR];
+static unsigned int hang_sample_head;
+static bool hang_sampling;
+static pid_t hang_sample_pid[HANG_SAMPLE_TASKS];
 
 struct core_task_info core_task[CORE_TASK_NUM_MAX] = {
 	{1, "init"},
@@ -555,6 +562,136 @@ static int find_core_task(void)
 }
 
 
+/* main threads of the core tasks, init and zombies left out */
+static void hang_sample_find_tasks(void)
+{
+	struct task_struct *task;
+	int i, n = 0;
+
+	memset(hang_sample_pid, 0, sizeof(hang_sample_pid));
+	read_lock(&tasklist_lock);
+	for_each_process(task) {
+		if (task->exit_state || task->pid == 1)
+			continue;
+		for (i = 0; i < CORE_TASK_NUM_MAX && n < HANG_SAMPLE_TASKS; i++) {
+			if (!strlen(core_task[i].name))
+				break;
+			if (!strcmp(task->comm, core_task[i].name)) {
+				hang_sample_pid[n++] = task->pid;
+				break;
+			}
+		}
+	}
+	read_unlock(&tasklist_lock);
+}
+
+static void hang_sample_task(pid_t nr)
+{
+	struct hang_sample *hs = &hang_samples[hang_sample_head % HANG_SAMPLE_NR];
+	struct stack_trace trace;
+	struct task_struct *p, *curr;
+	int cpu;
+
+	rcu_read_lock();
+	p = find_task_by_pid_ns(nr, &init_pid_ns);
+	if (p)
+		get_task_struct(p);
+	rcu_read_unlock();
+	if (!p)
+		return;
+	if (!try_get_task_stack(p)) {
+		put_task_struct(p);
+		return;
+	}
+
+	memset(hs, 0, sizeof(*hs));
+	hs->ts = local_clock();
+	hs->pid = p->pid;
+	memcpy(hs->comm, p->comm, TASK_COMM_LEN);
+	hs->state = p->state;
+	hs->sum_exec = p->se.sum_exec_runtime;
+	cpu = task_cpu(p);
+	hs->cpu = cpu;
+	hs->nr_running = cpu_rq(cpu)->nr_running;
+
+	rcu_read_lock();
+	curr = READ_ONCE(cpu_curr(cpu));
+	if (curr) {
+		hs->curr_pid = curr->pid;
+		memcpy(hs->curr_comm, curr->comm, TASK_COMM_LEN);
+	}
+	rcu_read_unlock();
+
+	/* a task running on another cpu gives no reliable trace */
+	if (curr != p) {
+		trace.nr_entries = 0;
+		trace.max_entries = HANG_SAMPLE_FRAMES;
+		trace.entries = hs->entries;
+		trace.skip = 0;
+		save_stack_trace_tsk(p, &trace);
+		hs->nr_entries = trace.nr_entries;
+	}
+
+	put_task_stack(p);
+	put_task_struct(p);
+	hang_sample_head++;
+}
+
+/*
+ * Once hang_detect_counter is down by 1 / HANG_SAMPLE_DIV of the timeout,
+ * take a sample of each core task every second until the heartbeat comes
+ * back or the hang is declared. Runs in hang_detect_thread only, so the
+ * ring needs no lock.
+ */
+static void hang_sample(void)
+{
+	int left = atomic_read(&hang_detect_counter);
+	int i;
+
+	if (left > hang_detect_timeout - hang_detect_timeout / HANG_SAMPLE_DIV) {
+		hang_sampling = false;
+		return;
+	}
+
+	if (!hang_sampling) {
+		hang_sampling = true;
+		hang_sample_head = 0;
+		hang_sample_find_tasks();
+	}
+
+	for (i = 0; i < HANG_SAMPLE_TASKS; i++)
+		if (hang_sample_pid[i])
+			hang_sample_task(hang_sample_pid[i]);
+}
+
+static void dump_hang_samples(void)
+{
+	char stat_nam[] = TASK_STATE_TO_CHAR_STR;
+	unsigned int i, j, start = 0;
+	unsigned int state;
+
+	if (hang_sample_head > HANG_SAMPLE_NR)
+		start = hang_sample_head - HANG_SAMPLE_NR;
+
+	log_to_hang_info("[Native Hang detect]: %u samples before the hang\n",
+			 hang_sample_head - start);
+	for (i = start; i < hang_sample_head; i++) {
+		struct hang_sample *hs = &hang_samples[i % HANG_SAMPLE_NR];
+		u64 ts = hs->ts;
+		unsigned long ns = do_div(ts, NSEC_PER_SEC);
+
+		state = hs->state ? __ffs(hs->state) + 1 : 0;
+		log_to_hang_info("[%5llu.%06lu] %s(%d) %c exec %llu cpu%d nr_running %u curr %s(%d)\n",
+				 ts, ns / 1000, hs->comm, hs->pid,
+				 state < sizeof(stat_nam) - 1 ? stat_nam[state] : '?',
+				 hs->sum_exec, hs->cpu, hs->nr_running,
+				 hs->curr_comm, hs->curr_pid);
+		for (j = 0; j < hs->nr_entries; j++)
+			log_to_hang_info("  [<%lx>] %pS\n", hs->entries[j],
+					 (void *)hs->entries[j]);
+	}
+}
+
 void reset_hang_info(void)
 {
 	memset(hang_info, 0, HANG_INFO_MAX);
@@ -612,6 +749,7 @@ static int hang_detect_thread(void *arg)
 				}
 				trigger_flag = 1;
 #endif
+				dump_hang_samples();
 				log_to_hang_info("[Native Hang detect]Dump process bt.\n");
 #ifndef CONFIG_SPRD_DEBUG
 				save_native_hang_monitor_data();
@@ -626,6 +764,7 @@ static int hang_detect_thread(void *arg)
 #endif
 			}
 			atomic_dec(&hang_detect_counter);
+			hang_sample();
 			pr_debug("[Native Hang Detect] hang_detect thread counts down %d:%d.\n",
 				atomic_read(&hang_detect_counter), hang_detect_timeout);
 
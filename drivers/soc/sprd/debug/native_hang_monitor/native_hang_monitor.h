@@ -28,6 +28,10 @@
 #define CORE_TASK_NAME_SIZE 20
 #define CORE_TASK_NUM_MAX 20
 #define TASK_STATE_TO_CHAR_STR "RSDTtZXxKWP"
+#define HANG_SAMPLE_DIV 2		/* sample once 1 / DIV of the timeout is missed */
+#define HANG_SAMPLE_NR 64		/* samples kept, oldest dropped first */
+#define HANG_SAMPLE_FRAMES 16
+#define HANG_SAMPLE_TASKS 4		/* core tasks sampled each second */
 
 struct thread_backtrace_info {
 	__u32 pid;
@@ -43,6 +47,21 @@ struct backtrace_frame {
 	char lr_symbol[SYMBOL_SIZE_L];
 };
 
+/* one look at a core task and the cpu it is on, before the hang is declared */
+struct hang_sample {
+	u64 ts;
+	pid_t pid;
+	char comm[TASK_COMM_LEN];
+	long state;
+	int cpu;
+	u64 sum_exec;			/* ns, stuck if it does not move */
+	unsigned int nr_running;	/* of that cpu */
+	pid_t curr_pid;			/* running on that cpu */
+	char curr_comm[TASK_COMM_LEN];
+	unsigned int nr_entries;
+	unsigned long entries[HANG_SAMPLE_FRAMES];
+};
+
 struct core_task_info {
 	int pid;
 	char name[CORE_TASK_NAME_SIZE];
@@ -29,6 +29,7 @@
 #include <asm/fixmap.h>
 #include <asm/pgalloc.h>
 #include <linux/slab.h>
+#include <linux/uaccess.h>
 
 #define ADI_15BIT_OFFSET		0x20000
 #define ADI_OFFSET			0x8000
@@ -70,6 +71,55 @@ struct lookat {
 
 static struct lookat lookat_desc;
 
+/*
+ * The "batch" file takes a whole list of accesses at once. write() an
+ * array of struct lookat_entry, every page it touches is mapped once
+ * then, and each read() from offset 0 runs the list again and returns
+ * the array with value and status filled in. Sampling a few hundred
+ * registers is then one pread() per sample instead of two syscalls and
+ * an ioremap per register.
+ *
+ * op uses the bits of addr_rwpv, __V__ for a virtual address and
+ * __WRITE__ to store (reg & ~mask) | (value & mask). Reads return
+ * reg & mask. status is 0 or a negative errno for that entry.
+ */
+struct lookat_entry {
+	__u64 addr;
+	__u32 op;
+	__u32 mask;
+	__u32 value;
+	__s32 status;
+};
+
+#define LOOKAT_BATCH_MAX	1024
+
+enum {
+	LOOKAT_MAP_VA,
+	LOOKAT_MAP_RAM,
+	LOOKAT_MAP_IO,
+	LOOKAT_MAP_ADI,
+};
+
+struct lookat_op {
+	void __iomem *va;
+	unsigned int reg;
+	unsigned int kind;
+};
+
+struct lookat_map {
+	phys_addr_t page;
+	void __iomem *base;
+};
+
+struct lookat_batch {
+	struct mutex lock;
+	struct lookat_entry *entries;
+	struct lookat_op *ops;
+	struct lookat_map *maps;
+	unsigned int count;
+	unsigned int nr_maps;
+};
+
 static int sprd_is_adi_vaddr(unsigned long vaddr)
 {
 	return 0;
@@ -315,6 +365,221 @@ static int debug_get(void *data, u64 *val)
 
 DEFINE_SIMPLE_ATTRIBUTE(lookat_fops, debug_get, debug_set, "0x%08llx");
 
+static void lookat_batch_clear(struct lookat_batch *b)
+{
+	unsigned int i;
+
+	for (i = 0; i < b->nr_maps; i++)
+		iounmap(b->maps[i].base);
+	kfree(b->maps);
+	kfree(b->ops);
+	kfree(b->entries);
+	b->maps = NULL;
+	b->ops = NULL;
+	b->entries = NULL;
+	b->count = 0;
+	b->nr_maps = 0;
+}
+
+static void __iomem *lookat_batch_map(struct lookat_batch *b, phys_addr_t pa)
+{
+	phys_addr_t page = pa & PAGE_MASK;
+	void __iomem *base;
+	unsigned int i;
+
+	for (i = 0; i < b->nr_maps; i++)
+		if (b->maps[i].page == page)
+			return b->maps[i].base + (pa - page);
+
+	base = ioremap_nocache(page, PAGE_SIZE);
+	if (!base)
+		return NULL;
+
+	b->maps[b->nr_maps].page = page;
+	b->maps[b->nr_maps++].base = base;
+
+	return base + (pa - page);
+}
+
+/* work out once how each entry is reached, as sprd_read_pa() does */
+static int lookat_batch_resolve(struct lookat_batch *b)
+{
+	unsigned int i;
+
+	for (i = 0; i < b->count; i++) {
+		struct lookat_entry *e = &b->entries[i];
+		struct lookat_op *op = &b->ops[i];
+		unsigned long vaddr;
+		void *addr;
+
+		if (e->addr & 0x3)
+			return -EINVAL;
+
+		if (e->op & __V__) {
+			op->kind = LOOKAT_MAP_VA;
+			op->va = (void __iomem *)(unsigned long)e->addr;
+			continue;
+		}
+
+		addr = __va(e->addr);
+		if (virt_addr_valid(addr)) {
+			op->kind = LOOKAT_MAP_RAM;
+			op->va = (void __iomem *)addr;
+		} else if (lookat_desc.regmap &&
+			   !sprd_adi_p2v(e->addr, &vaddr)) {
+			op->kind = LOOKAT_MAP_ADI;
+			op->reg = vaddr;
+		} else {
+			op->kind = LOOKAT_MAP_IO;
+			op->va = lookat_batch_map(b, e->addr);
+			if (!op->va) {
+				pr_warn("unable to map i/o region\n");
+				return -ENOMEM;
+			}
+		}
+	}
+
+	return 0;
+}
+
+static void lookat_batch_run(struct lookat_batch *b)
+{
+	unsigned int i, val;
+
+	for (i = 0; i < b->count; i++) {
+		struct lookat_entry *e = &b->entries[i];
+		struct lookat_op *op = &b->ops[i];
+
+		e->status = 0;
+		if (op->kind == LOOKAT_MAP_ADI) {
+			if (e->op & __WRITE__) {
+				e->status = regmap_update_bits(lookat_desc.regmap,
+							       op->reg, e->mask,
+							       e->value);
+				continue;
+			}
+			e->status = regmap_read(lookat_desc.regmap, op->reg,
+						&val);
+			if (!e->status)
+				e->value = val & e->mask;
+			continue;
+		}
+
+		val = readl_relaxed(op->va);
+		if (e->op & __WRITE__)
+			writel_relaxed((val & ~e->mask) | (e->value & e->mask),
+				       op->va);
+		else
+			e->value = val & e->mask;
+	}
+}
+
+static ssize_t lookat_batch_write(struct file *file, const char __user *buf,
+				  size_t count, loff_t *ppos)
+{
+	struct lookat_batch *b = file->private_data;
+	struct lookat_batch new = { };
+	int ret;
+
+	if (*ppos || !count || count % sizeof(*new.entries) ||
+	    count > LOOKAT_BATCH_MAX * sizeof(*new.entries))
+		return -EINVAL;
+
+	new.count = count / sizeof(*new.entries);
+	new.entries = memdup_user(buf, count);
+	if (IS_ERR(new.entries))
+		return PTR_ERR(new.entries);
+
+	new.ops = kcalloc(new.count, sizeof(*new.ops), GFP_KERNEL);
+	new.maps = kcalloc(new.count, sizeof(*new.maps), GFP_KERNEL);
+	if (!new.ops || !new.maps) {
+		ret = -ENOMEM;
+		goto err;
+	}
+
+	ret = lookat_batch_resolve(&new);
+	if (ret)
+		goto err;
+
+	mutex_lock(&b->lock);
+	lookat_batch_clear(b);
+	b->entries = new.entries;
+	b->ops = new.ops;
+	b->maps = new.maps;
+	b->count = new.count;
+	b->nr_maps = new.nr_maps;
+	mutex_unlock(&b->lock);
+
+	return count;
+
+err:
+	lookat_batch_clear(&new);
+	return ret;
+}
+
+static ssize_t lookat_batch_read(struct file *file, char __user *buf,
+				 size_t count, loff_t *ppos)
+{
+	struct lookat_batch *b = file->private_data;
+	size_t len;
+	ssize_t ret;
+
+	if (*ppos)
+		return 0;
+
+	mutex_lock(&b->lock);
+	len = b->count * sizeof(*b->entries);
+	if (!len || count < len) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	lookat_batch_run(b);
+	if (copy_to_user(buf, b->entries, len)) {
+		ret = -EFAULT;
+		goto out;
+	}
+	*ppos = len;
+	ret = len;
+
+out:
+	mutex_unlock(&b->lock);
+	return ret;
+}
+
+static int lookat_batch_open(struct inode *inode, struct file *file)
+{
+	struct lookat_batch *b;
+
+	b = kzalloc(sizeof(*b), GFP_KERNEL);
+	if (!b)
+		return -ENOMEM;
+
+	mutex_init(&b->lock);
+	file->private_data = b;
+
+	return 0;
+}
+
+static int lookat_batch_release(struct inode *inode, struct file *file)
+{
+	struct lookat_batch *b = file->private_data;
+
+	lookat_batch_clear(b);
+	kfree(b);
+
+	return 0;
+}
+
+static const struct file_operations lookat_batch_fops = {
+	.owner = THIS_MODULE,
+	.open = lookat_batch_open,
+	.release = lookat_batch_release,
+	.read = lookat_batch_read,
+	.write = lookat_batch_write,
+	.llseek = default_llseek,
+};
+
 static int __init debug_add(struct sprd_lookat *lookat, struct dentry *parent)
 {
 	if (!debugfs_create_file(lookat->name, 0644, parent,
@@ -344,6 +609,12 @@ static int __init lookat_debug_init(void)
 		}
 	}
 
+	if (!debugfs_create_file("batch", 0600, lookat_base, NULL,
+				 &lookat_batch_fops)) {
+		debugfs_remove_recursive(lookat_base);
+		return -ENOENT;
+	}
+
 	mutex_init(&lookat_desc.list_lock);
 	INIT_LIST_HEAD(&lookat_desc.request_list);
 
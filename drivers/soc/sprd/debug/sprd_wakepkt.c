@@ -0,0 +1,376 @@
+/*
+ * Copyright (C) 2020 Spreadtrum Communications Inc.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Records the first downlink packet after each system suspend, with
+ * the flow and the uid of the local socket, to find the apps that keep
+ * waking the AP up.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/in6.h>
+#include <linux/ip.h>
+#include <linux/ipv6.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/netdevice.h>
+#include <linux/seq_file.h>
+#include <linux/skbuff.h>
+#include <linux/slab.h>
+#include <linux/soc/sprd/sprd_wakepkt.h>
+#include <linux/spinlock.h>
+#include <linux/suspend.h>
+#include <linux/uidgid.h>
+#include <net/inet_hashtables.h>
+#include <net/inet6_hashtables.h>
+#include <net/sock.h>
+#include <net/tcp.h>
+#include <net/udp.h>
+#include "sprd_debugfs.h"
+
+#define WAKEPKT_RING		32
+#define WAKEPKT_UIDS		32
+#define WAKEPKT_WINDOW_MS	1000
+
+struct wakepkt_rec {
+	u64 t_ns;
+	/* after the resume finished, or -1 if it came in before */
+	s64 resume_delay_ms;
+	char tag[IFNAMSIZ];
+	int netid;
+	int uid;
+	u8 family;
+	u8 proto;
+	__be16 sport;
+	__be16 dport;
+	union {
+		__be32 v4;
+		struct in6_addr v6;
+	} saddr, daddr;
+};
+
+struct wakepkt_uid {
+	int uid;
+	u32 wakes;
+	u64 last_ns;
+};
+
+atomic_t sprd_wakepkt_armed = ATOMIC_INIT(0);
+EXPORT_SYMBOL(sprd_wakepkt_armed);
+
+static DEFINE_SPINLOCK(wakepkt_lock);
+static struct wakepkt_rec wakepkt_ring[WAKEPKT_RING];
+static struct wakepkt_uid wakepkt_uids[WAKEPKT_UIDS];
+static u32 wakepkt_head;
+static u32 wakepkt_total;
+static u64 wakepkt_resume_ns;
+/* later packets are traffic of the woken system, not the wake source */
+static u32 wakepkt_window_ms = WAKEPKT_WINDOW_MS;
+
+static int wakepkt_parse(const struct sk_buff *skb, unsigned int nhoff,
+			 struct wakepkt_rec *rec)
+{
+	unsigned int len = skb_headlen(skb);
+	const u8 *p, *l4;
+	unsigned int l4len;
+
+	if (nhoff >= len)
+		return -EINVAL;
+
+	p = skb->data + nhoff;
+	len -= nhoff;
+
+	switch (p[0] >> 4) {
+	case 4: {
+		const struct iphdr *iph = (const struct iphdr *)p;
+		unsigned int ihl = iph->ihl * 4;
+
+		if (len < sizeof(*iph) || ihl < sizeof(*iph) || ihl > len)
+			return -EINVAL;
+		rec->family = AF_INET;
+		rec->proto = iph->protocol;
+		rec->saddr.v4 = iph->saddr;
+		rec->daddr.v4 = iph->daddr;
+		/* only the first fragment has the ports */
+		if (iph->frag_off & htons(IP_OFFSET))
+			return 0;
+		l4 = p + ihl;
+		l4len = len - ihl;
+		break;
+	}
+	case 6: {
+		const struct ipv6hdr *ip6h = (const struct ipv6hdr *)p;
+
+		if (len < sizeof(*ip6h))
+			return -EINVAL;
+		rec->family = AF_INET6;
+		rec->proto = ip6h->nexthdr;
+		rec->saddr.v6 = ip6h->saddr;
+		rec->daddr.v6 = ip6h->daddr;
+		l4 = p + sizeof(*ip6h);
+		l4len = len - sizeof(*ip6h);
+		break;
+	}
+	default:
+		return -EPROTONOSUPPORT;
+	}
+
+	if ((rec->proto == IPPROTO_TCP || rec->proto == IPPROTO_UDP) &&
+	    l4len >= 4) {
+		rec->sport = *(const __be16 *)l4;
+		rec->dport = *(const __be16 *)(l4 + 2);
+	}
+
+	return 0;
+}
+
+/* the packet goes from the remote saddr:sport to the local daddr:dport */
+static struct sock *wakepkt_lookup(struct net *net, int dif,
+				   const struct wakepkt_rec *rec)
+{
+	if (rec->proto == IPPROTO_TCP) {
+		if (rec->family == AF_INET)
+			return __inet_lookup_established(net, &tcp_hashinfo,
+							 rec->saddr.v4,
+							 rec->sport,
+							 rec->daddr.v4,
+							 ntohs(rec->dport),
+							 dif, 0);
+#if IS_ENABLED(CONFIG_IPV6)
+		return __inet6_lookup_established(net, &tcp_hashinfo,
+						  &rec->saddr.v6, rec->sport,
+						  &rec->daddr.v6,
+						  ntohs(rec->dport), dif, 0);
+#endif
+	} else if (rec->proto == IPPROTO_UDP) {
+		/* the udp lookups are only exported for the socket match */
+#if IS_ENABLED(CONFIG_NF_SOCKET_IPV4)
+		if (rec->family == AF_INET)
+			return udp4_lib_lookup(net, rec->saddr.v4, rec->sport,
+					       rec->daddr.v4, rec->dport, dif);
+#endif
+#if IS_BUILTIN(CONFIG_IPV6) && IS_ENABLED(CONFIG_NF_SOCKET_IPV6)
+		if (rec->family == AF_INET6)
+			return udp6_lib_lookup(net, &rec->saddr.v6, rec->sport,
+					       &rec->daddr.v6, rec->dport, dif);
+#endif
+	}
+
+	return NULL;
+}
+
+static int wakepkt_uid(const struct sk_buff *skb,
+		       const struct wakepkt_rec *rec)
+{
+	struct net *net = skb->dev ? dev_net(skb->dev) : &init_net;
+	int dif = skb->dev ? skb->dev->ifindex : 0;
+	struct sock *sk;
+	int uid = -1;
+
+	if (!rec->dport)
+		return -1;
+
+	rcu_read_lock();
+	sk = wakepkt_lookup(net, dif, rec);
+	if (sk) {
+		/* time wait and request socks have no owner */
+		if (sk_fullsock(sk))
+			uid = from_kuid_munged(&init_user_ns, sk->sk_uid);
+		sock_gen_put(sk);
+	}
+	rcu_read_unlock();
+
+	return uid;
+}
+
+static void wakepkt_count_uid(int uid, u64 now)
+{
+	struct wakepkt_uid *u, *victim = &wakepkt_uids[0];
+	int i;
+
+	for (i = 0; i < WAKEPKT_UIDS; i++) {
+		u = &wakepkt_uids[i];
+		if (u->wakes && u->uid == uid)
+			goto found;
+		if (u->wakes < victim->wakes)
+			victim = u;
+	}
+
+	/* a full table loses its quietest uid */
+	u = victim;
+	u->uid = uid;
+	u->wakes = 0;
+found:
+	u->wakes++;
+	u->last_ns = now;
+}
+
+void __sprd_wakepkt_rx(const char *tag, int netid,
+		       const struct sk_buff *skb, unsigned int nhoff)
+{
+	struct wakepkt_rec rec = {};
+	unsigned long flags;
+	u64 now, resumed;
+
+	/* let only the first packet through */
+	if (!atomic_xchg(&sprd_wakepkt_armed, 0))
+		return;
+
+	now = ktime_get_boot_ns();
+	resumed = READ_ONCE(wakepkt_resume_ns);
+	if (resumed && now - resumed > (u64)wakepkt_window_ms * NSEC_PER_MSEC)
+		return;
+
+	if (wakepkt_parse(skb, nhoff, &rec))
+		return;
+
+	rec.t_ns = now;
+	rec.resume_delay_ms = resumed ? div_u64(now - resumed,
+						NSEC_PER_MSEC) : -1;
+	strlcpy(rec.tag, tag, sizeof(rec.tag));
+	rec.netid = netid;
+	rec.uid = wakepkt_uid(skb, &rec);
+
+	spin_lock_irqsave(&wakepkt_lock, flags);
+	wakepkt_ring[wakepkt_head] = rec;
+	wakepkt_head = (wakepkt_head + 1) % WAKEPKT_RING;
+	wakepkt_total++;
+	wakepkt_count_uid(rec.uid, now);
+	spin_unlock_irqrestore(&wakepkt_lock, flags);
+}
+EXPORT_SYMBOL(__sprd_wakepkt_rx);
+
+static int wakepkt_pm_notify(struct notifier_block *nb,
+			     unsigned long event, void *data)
+{
+	switch (event) {
+	case PM_SUSPEND_PREPARE:
+		WRITE_ONCE(wakepkt_resume_ns, 0);
+		atomic_set(&sprd_wakepkt_armed, 1);
+		break;
+	case PM_POST_SUSPEND:
+		WRITE_ONCE(wakepkt_resume_ns, ktime_get_boot_ns());
+		break;
+	}
+
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block wakepkt_pm_nb = {
+	.notifier_call = wakepkt_pm_notify,
+};
+
+static void wakepkt_show_rec(struct seq_file *m, const struct wakepkt_rec *r)
+{
+	u64 t = r->t_ns;
+	u32 rem = do_div(t, NSEC_PER_SEC);
+
+	seq_printf(m, "[%5llu.%06u] %s netid %d ", t, rem / NSEC_PER_USEC,
+		   r->tag, r->netid);
+	if (r->resume_delay_ms < 0)
+		seq_puts(m, "before resume ");
+	else
+		seq_printf(m, "+%lldms ", r->resume_delay_ms);
+	seq_printf(m, "proto %u ", r->proto);
+	if (r->family == AF_INET)
+		seq_printf(m, "%pI4:%u > %pI4:%u", &r->saddr.v4,
+			   ntohs(r->sport), &r->daddr.v4, ntohs(r->dport));
+	else
+		seq_printf(m, "[%pI6c]:%u > [%pI6c]:%u", &r->saddr.v6,
+			   ntohs(r->sport), &r->daddr.v6, ntohs(r->dport));
+	seq_printf(m, " uid %d\n", r->uid);
+}
+
+static int wakepkt_log_show(struct seq_file *m, void *v)
+{
+	struct wakepkt_rec *ring;
+	u32 head, total, i, n;
+
+	ring = kmalloc(sizeof(wakepkt_ring), GFP_KERNEL);
+	if (!ring)
+		return -ENOMEM;
+
+	spin_lock_irq(&wakepkt_lock);
+	memcpy(ring, wakepkt_ring, sizeof(wakepkt_ring));
+	head = wakepkt_head;
+	total = wakepkt_total;
+	spin_unlock_irq(&wakepkt_lock);
+
+	n = min_t(u32, total, WAKEPKT_RING);
+	seq_printf(m, "wake packets: %u\n", total);
+	for (i = 0; i < n; i++)
+		wakepkt_show_rec(m, &ring[(head + WAKEPKT_RING - n + i) %
+				 WAKEPKT_RING]);
+	kfree(ring);
+
+	return 0;
+}
+
+static int wakepkt_log_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wakepkt_log_show, NULL);
+}
+
+static const struct file_operations wakepkt_log_fops = {
+	.open = wakepkt_log_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int wakepkt_uid_show(struct seq_file *m, void *v)
+{
+	struct wakepkt_uid uids[WAKEPKT_UIDS];
+	int i;
+
+	spin_lock_irq(&wakepkt_lock);
+	memcpy(uids, wakepkt_uids, sizeof(uids));
+	spin_unlock_irq(&wakepkt_lock);
+
+	seq_puts(m, "uid wakes last_ns\n");
+	for (i = 0; i < WAKEPKT_UIDS; i++)
+		if (uids[i].wakes)
+			seq_printf(m, "%d %u %llu\n", uids[i].uid,
+				   uids[i].wakes, uids[i].last_ns);
+
+	return 0;
+}
+
+static int wakepkt_uid_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wakepkt_uid_show, NULL);
+}
+
+static const struct file_operations wakepkt_uid_fops = {
+	.open = wakepkt_uid_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init wakepkt_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("wake_pkt", sprd_debugfs_entry(MISC));
+	if (dir) {
+		debugfs_create_file("log", 0444, dir, NULL,
+				    &wakepkt_log_fops);
+		debugfs_create_file("uid", 0444, dir, NULL,
+				    &wakepkt_uid_fops);
+		debugfs_create_u32("window_ms", 0644, dir,
+				   &wakepkt_window_ms);
+	}
+
+	return register_pm_notifier(&wakepkt_pm_nb);
+}
+
+fs_initcall(wakepkt_init);
@@ -43,7 +43,9 @@
 #endif
 #include "sysdump.h"
 #include "sysdumpdb.h"
+#include "ylog_krec.h"
 #include <linux/kallsyms.h>
+#include <linux/lz4.h>
 #include <asm/stacktrace.h>
 #include <asm-generic/kdebug.h>
 #include <linux/kdebug.h>
@@ -89,6 +91,9 @@ int  die_notify_flag;
 struct pt_regs minidump_regs_g;
 static int prepare_minidump_info(struct pt_regs *regs);
 struct info_desc minidump_info_desc_g;
+#ifdef CONFIG_SPRD_MINI_SYSDUMP_LZ4
+static void minidump_compress_sections(void);
+#endif
 unsigned int pt_data_len;
 
 struct minidump_info  minidump_info_g =	{
@@ -125,6 +130,9 @@ struct minidump_info  minidump_info_g =	{
 			{"per_cpu", (unsigned long)__per_cpu_start, (unsigned long)__per_cpu_end, 0, 0, 0},
 			{"log_buf", 0, 0, 0, 0, 0},
 			{"ylog_buf", 0, 0, 0, 0, 0},
+#ifdef CONFIG_SPRD_YLOG_KREC
+			{"ylog_krec", 0, 0, 0, 0, 0},
+#endif
 			{"kernel_pt", 0, 0, 0, 0, 0},
 #ifdef CONFIG_SPRD_NATIVE_HANG_MONITOR
 			{"nhang", 0, 0, 0, 0, 0},
@@ -560,6 +568,10 @@ void sysdump_enter(int enter_id, const char *reason, struct pt_regs *regs)
 	pr_emerg("*****************************************************\n");
 	pr_emerg("\n");
 
+#ifdef CONFIG_SPRD_MINI_SYSDUMP_LZ4
+	/* last, so log_buf has everything printed above */
+	minidump_compress_sections();
+#endif
 	flush_cache_all();
 	mdelay(1000);
 
@@ -1069,6 +1081,24 @@ void section_info_ylog_buf(int section_index)
 	minidump_info_g.section_info_total.section_info[i].section_size = YLOG_BUF_SIZE;
 }
 
+#ifdef CONFIG_SPRD_YLOG_KREC
+void section_info_ylog_krec(int section_index)
+{
+	int i = section_index;
+	unsigned long vaddr;
+	size_t len;
+
+	ylog_krec_region(&vaddr, &len);
+	if (!len)
+		return;
+	minidump_info_g.section_info_total.section_info[i].section_start_vaddr = vaddr;
+	minidump_info_g.section_info_total.section_info[i].section_end_vaddr = vaddr + len;
+	minidump_info_g.section_info_total.section_info[i].section_start_paddr = __pa(vaddr);
+	minidump_info_g.section_info_total.section_info[i].section_end_paddr = __pa(vaddr) + len;
+	minidump_info_g.section_info_total.section_info[i].section_size = len;
+}
+#endif
+
 #ifdef CONFIG_SPRD_NATIVE_HANG_MONITOR
 void section_native_hang(int section_index)
 {
@@ -1192,6 +1222,10 @@ void minidump_info_init(void)
 			section_info_log_buf(i);
 		} else if (!memcmp(minidump_info_g.section_info_total.section_info[i].section_name, "ylog_buf", strlen("ylog_buf"))) {
 			section_info_ylog_buf(i);
+#ifdef CONFIG_SPRD_YLOG_KREC
+		} else if (!memcmp(minidump_info_g.section_info_total.section_info[i].section_name, "ylog_krec", strlen("ylog_krec"))) {
+			section_info_ylog_krec(i);
+#endif
 		} else if (!memcmp(minidump_info_g.section_info_total.section_info[i].section_name, "kernel_pt", strlen("kernel_pt"))) {
 			section_info_pt(i);
 		} else if (!memcmp(minidump_info_g.section_info_total.section_info[i].section_name, "per_cpu", strlen("per_cpu"))) {
@@ -1216,6 +1250,101 @@ void minidump_info_init(void)
 
 	return;
 }
+#ifdef CONFIG_SPRD_MINI_SYSDUMP_LZ4
+#define MINIDUMP_COMP_BUF_SIZE	(4 * 1024 * 1024)
+
+static void *minidump_comp_buf;
+static void *minidump_comp_wrkmem;
+
+/*
+ * Runs on the panic cpu with the others stopped, so everything it needs is
+ * allocated at init. Sections go into the buffer one after the other until
+ * it is full, whatever is left, or does not shrink, stays raw.
+ */
+static void minidump_compress_sections(void)
+{
+	struct minidump_comp_header *hdr = minidump_comp_buf;
+	struct section_info_total *total = &minidump_info_g.section_info_total;
+	unsigned int off = sizeof(*hdr);
+	int i, len;
+
+	if (!hdr)
+		return;
+
+	memset(hdr, 0, sizeof(*hdr));
+	hdr->version = MINIDUMP_COMP_VERSION;
+
+	for (i = 0; i < total->total_num && i < SECTION_NUM_MAX; i++) {
+		struct section_info *sec = &total->section_info[i];
+		struct minidump_comp_index *idx = &hdr->index[hdr->num];
+
+		/* io memory sections like scproc have no kernel mapping */
+		if (!sec->section_start_vaddr || sec->section_size <= 0)
+			continue;
+
+		len = LZ4_compress_default((const char *)sec->section_start_vaddr,
+					   minidump_comp_buf + off,
+					   sec->section_size,
+					   MINIDUMP_COMP_BUF_SIZE - off,
+					   minidump_comp_wrkmem);
+		if (len <= 0 || len >= sec->section_size)
+			continue;
+
+		memcpy(idx->section_name, sec->section_name, SECTION_NAME_MAX);
+		idx->paddr = sec->section_start_paddr;
+		idx->offset = off;
+		idx->raw_len = sec->section_size;
+		idx->comp_len = len;
+		idx->type = MINIDUMP_COMP_LZ4;
+		sec->section_size_comp = len;
+		hdr->num++;
+
+		off = ALIGN(off + len, sizeof(u64));
+		if (off >= MINIDUMP_COMP_BUF_SIZE)
+			break;
+	}
+
+	hdr->size = min_t(unsigned int, off, MINIDUMP_COMP_BUF_SIZE);
+	/* the index is complete, tell u-boot to use it */
+	wmb();
+	memcpy(hdr->magic, MINIDUMP_COMP_MAGIC, sizeof(hdr->magic));
+	pr_emerg("minidump: %u sections compressed into %u bytes\n",
+		 hdr->num, hdr->size);
+}
+
+static int minidump_comp_init(void)
+{
+	minidump_comp_wrkmem = kmalloc(LZ4_MEM_COMPRESS, GFP_KERNEL);
+	if (!minidump_comp_wrkmem)
+		return -ENOMEM;
+
+	minidump_comp_buf = alloc_pages_exact(MINIDUMP_COMP_BUF_SIZE,
+					      GFP_KERNEL | __GFP_NOWARN);
+	if (!minidump_comp_buf) {
+		kfree(minidump_comp_wrkmem);
+		minidump_comp_wrkmem = NULL;
+		return -ENOMEM;
+	}
+
+	/* no magic until a panic fills it in */
+	memset(minidump_comp_buf, 0, sizeof(struct minidump_comp_header));
+	minidump_info_g.comp_info_desc.paddr = __pa(minidump_comp_buf);
+	minidump_info_g.comp_info_desc.size = MINIDUMP_COMP_BUF_SIZE;
+	return 0;
+}
+
+static void minidump_comp_exit(void)
+{
+	minidump_info_g.comp_info_desc.paddr = 0;
+	minidump_info_g.comp_info_desc.size = 0;
+	if (minidump_comp_buf)
+		free_pages_exact(minidump_comp_buf, MINIDUMP_COMP_BUF_SIZE);
+	kfree(minidump_comp_wrkmem);
+	minidump_comp_buf = NULL;
+	minidump_comp_wrkmem = NULL;
+}
+#endif
+
 static int ylog_buffer_open(struct inode *inode, struct file *file)
 {
 	pr_info("open ylog_buffer ok !\n");
@@ -1226,6 +1355,10 @@ static int ylog_buffer_map(struct file *filp, struct vm_area_struct *vma)
 {
 	unsigned long ylog_buffer_paddr;
 
+	/* the kernel record rings sit past the daemon's own buffer */
+	if (vma->vm_pgoff)
+		return ylog_krec_mmap(vma);
+
 	if (vma->vm_end - vma->vm_start > YLOG_BUF_SIZE)
 		return -EINVAL;
 
@@ -1264,6 +1397,7 @@ static int ylog_buffer_init(void)
 	sprintf(ylog_buffer, "%s", "This is ylog buffer. Now , it is nothing . ");
 	/*here, we can add something to head to check if data is ok */
 	SetPageReserved(virt_to_page(ylog_buffer));
+	ylog_krec_init();
 	ret = misc_register(&misc_dev_ylog);
 	return ret;
 }
@@ -1293,6 +1427,10 @@ int minidump_init(void)
 	minidump_info_desc_g.paddr = __pa(&minidump_info_g);
 	minidump_info_desc_g.size = sizeof(minidump_info_g);
 	minidump_info_init();
+#ifdef CONFIG_SPRD_MINI_SYSDUMP_LZ4
+	if (minidump_comp_init())
+		pr_err("no minidump compress buffer, sections stay raw\n");
+#endif
 	pr_info("%s out.\n", __func__);
 	return 0;
 }
@@ -1536,6 +1674,9 @@ void sysdump_sysctl_exit(void)
 	}
 #ifdef CONFIG_SPRD_MINI_SYSDUMP
 	ylog_buffer_exit();
+#ifdef CONFIG_SPRD_MINI_SYSDUMP_LZ4
+	minidump_comp_exit();
+#endif
 #endif
 }
 
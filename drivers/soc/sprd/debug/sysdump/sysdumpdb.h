@@ -164,6 +164,39 @@ struct section_info_total{
 	int total_size;
 	int total_num;
 };
+
+/*
+ * Compressed sections, filled in by the kernel after a panic. The buffer
+ * at minidump_info.comp_info_desc starts with a minidump_comp_header, the
+ * payload of index[i] is a raw LZ4 block at buffer + index[i].offset that
+ * inflates to raw_len bytes of memory from paddr. A section without an
+ * index entry, or the whole buffer when magic is not MINIDUMP_COMP_MAGIC,
+ * has to be dumped raw as before.
+ */
+#define MINIDUMP_COMP_MAGIC "MDZ1"
+#define MINIDUMP_COMP_VERSION 1
+
+enum minidump_comp_type {
+	MINIDUMP_COMP_NONE,
+	MINIDUMP_COMP_LZ4,
+};
+
+struct minidump_comp_index{
+	char section_name[SECTION_NAME_MAX];
+	unsigned long long paddr;	/* section_start_paddr of the section */
+	unsigned int offset;		/* payload offset from the buffer start */
+	unsigned int raw_len;		/* section_size */
+	unsigned int comp_len;		/* payload size */
+	unsigned int type;		/* enum minidump_comp_type */
+};
+
+struct minidump_comp_header{
+	char magic[4];			/* MINIDUMP_COMP_MAGIC, written last */
+	unsigned int version;		/* MINIDUMP_COMP_VERSION */
+	unsigned int num;		/* valid entries in index[] */
+	unsigned int size;		/* bytes used in the buffer, header included */
+	struct minidump_comp_index index[SECTION_NUM_MAX];
+};
 /* the struct to save minidump all infomation  */
 struct minidump_info{
 	char kernel_magic[6];  				  /* make sure minidump data valid */
@@ -176,6 +209,7 @@ struct minidump_info{
 	int minidump_data_size;				  /* minidump data total size: regs_all_size + reg_memory_all_size + section_all_size  */
 	int compressed;					  /* indicate if minidump data compressed */
 	struct exception_info_item exception_info;	  /* exception info */
+	struct info_desc comp_info_desc;		  /* compressed sections, struct minidump_comp_header */
 };
 
 #endif /* __SYSDUMPDB_H__ */
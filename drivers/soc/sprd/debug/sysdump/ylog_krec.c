@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2020 Unisoc Communications Inc.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * Per cpu rings of binary records for drivers that log too much for
+ * printk, each cpu only ever writes its own ring with interrupts off, so
+ * producers never serialise on a lock. The ylog daemon maps the rings
+ * read only through the ylog_buffer device and merges them by ts_ns.
+ */
+
+#define pr_fmt(fmt)  "sprd-ylog-krec: " fmt
+
+#include <linux/export.h>
+#include <linux/gfp.h>
+#include <linux/irqflags.h>
+#include <linux/kernel.h>
+#include <linux/log2.h>
+#include <linux/mm.h>
+#include <linux/moduleparam.h>
+#include <linux/smp.h>
+#include <linux/soc/sprd/sprd_ylog.h>
+#include <linux/string.h>
+#include <linux/timekeeping.h>
+#include "ylog_krec.h"
+
+#define YLOG_KREC_MAX_RINGS	((PAGE_SIZE - sizeof(struct ylog_krec_head)) / \
+				 sizeof(struct ylog_krec_ring))
+
+/* size of each cpu's ring, rounded up to a power of two */
+static unsigned int ring_kb = 64;
+module_param(ring_kb, uint, 0444);
+
+static struct ylog_krec_head *krec_head;
+static void *krec_data;
+static size_t krec_size;
+static u32 krec_ring_size;
+static u32 krec_max_record;
+
+int ylog_krec_write(u16 src, u32 type, const void *data, size_t len)
+{
+	struct ylog_krec_head *h = smp_load_acquire(&krec_head);
+	struct ylog_krec_ring *ring;
+	struct ylog_krec *rec;
+	unsigned long flags;
+	u32 head, off, size;
+	void *base;
+	int cpu;
+
+	if (unlikely(!h))
+		return -ENODEV;
+
+	size = ALIGN(sizeof(*rec) + len, 8);
+
+	local_irq_save(flags);
+	cpu = smp_processor_id();
+	if (unlikely(cpu >= h->nr_rings)) {
+		local_irq_restore(flags);
+		return -ENODEV;
+	}
+
+	ring = &h->ring[cpu];
+	if (unlikely(size > krec_max_record)) {
+		ring->dropped++;
+		local_irq_restore(flags);
+		return -EMSGSIZE;
+	}
+
+	base = krec_data + cpu * krec_ring_size;
+	head = ring->head;
+	off = head & (krec_ring_size - 1);
+	if (off + size > krec_ring_size) {
+		rec = base + off;
+		rec->len = krec_ring_size - off;
+		rec->src = YLOG_SRC_PAD;
+		rec->type = 0;
+		head += krec_ring_size - off;
+		off = 0;
+	}
+
+	rec = base + off;
+	rec->len = sizeof(*rec) + len;
+	rec->src = src;
+	rec->type = type;
+	rec->ts_ns = ktime_get_boot_fast_ns();
+	memcpy(rec->data, data, len);
+
+	/* the record before head, as the daemon reads them lockless */
+	smp_wmb();
+	WRITE_ONCE(ring->head, head + size);
+	local_irq_restore(flags);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(ylog_krec_write);
+
+int ylog_krec_mmap(struct vm_area_struct *vma)
+{
+	unsigned long len = vma->vm_end - vma->vm_start;
+
+	if (!krec_head || vma->vm_pgoff != YLOG_KREC_MMAP_OFFSET >> PAGE_SHIFT)
+		return -EINVAL;
+	if (len > krec_size)
+		return -EINVAL;
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	return remap_pfn_range(vma, vma->vm_start,
+			       virt_to_phys(krec_head) >> PAGE_SHIFT,
+			       len, vma->vm_page_prot);
+}
+
+void ylog_krec_region(unsigned long *vaddr, size_t *size)
+{
+	*vaddr = (unsigned long)krec_head;
+	*size = krec_head ? krec_size : 0;
+}
+
+int ylog_krec_init(void)
+{
+	struct ylog_krec_head *h;
+	u32 nr = min_t(u32, nr_cpu_ids, YLOG_KREC_MAX_RINGS);
+	u32 ring_size;
+
+	BUILD_BUG_ON(sizeof(struct ylog_krec_head) != 64);
+	BUILD_BUG_ON(sizeof(struct ylog_krec_ring) != 64);
+
+	ring_size = roundup_pow_of_two(max_t(u32, ring_kb, 4) * 1024);
+	krec_size = PAGE_SIZE + (size_t)nr * ring_size;
+	h = alloc_pages_exact(krec_size, GFP_KERNEL | __GFP_ZERO);
+	if (!h) {
+		pr_err("no memory for %u rings of %u bytes\n", nr, ring_size);
+		return -ENOMEM;
+	}
+
+	h->magic = YLOG_KREC_MAGIC;
+	h->version = YLOG_KREC_VERSION;
+	h->nr_rings = nr;
+	h->ring_size = ring_size;
+	h->data_offset = PAGE_SIZE;
+	/* keep a slow reader a chance on small rings, len is only 16 bits */
+	h->max_record = min_t(u32, ring_size / 4, U16_MAX & ~7);
+
+	krec_data = (void *)h + PAGE_SIZE;
+	krec_ring_size = ring_size;
+	krec_max_record = h->max_record;
+	/* publish the geometry before writers can see the head */
+	smp_store_release(&krec_head, h);
+
+	pr_info("%u rings of %u bytes\n", nr, ring_size);
+
+	return 0;
+}
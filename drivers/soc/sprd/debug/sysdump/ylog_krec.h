@@ -0,0 +1,28 @@
+#ifndef __YLOG_KREC_H__
+#define __YLOG_KREC_H__
+
+#include <linux/mm_types.h>
+
+#ifdef CONFIG_SPRD_YLOG_KREC
+int ylog_krec_init(void);
+int ylog_krec_mmap(struct vm_area_struct *vma);
+void ylog_krec_region(unsigned long *vaddr, size_t *size);
+#else
+static inline int ylog_krec_init(void)
+{
+	return 0;
+}
+
+static inline int ylog_krec_mmap(struct vm_area_struct *vma)
+{
+	return -EINVAL;
+}
+
+static inline void ylog_krec_region(unsigned long *vaddr, size_t *size)
+{
+	*vaddr = 0;
+	*size = 0;
+}
+#endif
+
+#endif
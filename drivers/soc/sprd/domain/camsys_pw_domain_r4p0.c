@@ -28,6 +28,7 @@
 #include <dt-bindings/soc/sprd,pike2-mask.h>
 #include <dt-bindings/soc/sprd,pike2-regs.h>
 #include <video/sprd_mmsys_pw_domain.h>
+#include "sprd_pw_domain.h"
 
 struct cam_pw_domain_info {
 	atomic_t users_pw;
@@ -51,8 +52,11 @@ struct cam_pw_domain_info {
 #define PD_MM_STAT_BIT_SHIFT 28
 #define BIT_PMU_APB_PD_MM_SYS_STATE(x)	(((x) & 0xf) << PD_MM_STAT_BIT_SHIFT)
 #define PD_MM_DOWN_FLAG (0x7 << PD_MM_STAT_BIT_SHIFT)
+/* what the old 10 polls of 300us allowed */
+#define PW_STATE_TIMEOUT_US 3500
 
 static struct cam_pw_domain_info *cam_pw;
+static struct sprd_pw_lat cam_pw_lat;
 
 static int sprd_cam_pw_domain_init(struct platform_device *pdev)
 {
@@ -140,6 +144,7 @@ static int sprd_cam_pw_domain_init(struct platform_device *pdev)
 	pr_info("chip_id0 %x, chip_id1 %x\n", chip_id0, chip_id1);
 
 	mutex_init(&cam_pw->client_lock);
+	sprd_pw_lat_register(&cam_pw_lat, "cam");
 
 	return 0;
 }
@@ -155,15 +160,13 @@ static int sprd_cam_pw_domain_deinit(struct platform_device *pdev)
 int sprd_cam_pw_off(void)
 {
 	int ret = 0;
-	unsigned int power_state1 = 0;
-	unsigned int power_state2 = 0;
-	unsigned int power_state3 = 0;
-	unsigned int read_count = 0;
-	unsigned int val = 0;
+	unsigned int power_state = 0;
+	ktime_t start = 0;
 
 	mutex_lock(&cam_pw->client_lock);
 
 	if (atomic_dec_return(&cam_pw->users_pw) == 0) {
+		start = ktime_get();
 		clk_disable_unprepare(cam_pw->cam_mm_eb);
 		usleep_range(300, 350);
 		regmap_update_bits(cam_pw->pmu_apb_gpr,
@@ -176,52 +179,33 @@ int sprd_cam_pw_off(void)
 				   MASK_PMU_APB_PD_MM_TOP_FORCE_SHUTDOWN,
 				   MASK_PMU_APB_PD_MM_TOP_FORCE_SHUTDOWN);
 
-		do {
-			cpu_relax();
-			usleep_range(300, 350);
-			read_count++;
-
-			ret = regmap_read(cam_pw->pmu_apb_gpr,
-					  REG_PMU_APB_PWR_STATUS0_DBG, &val);
-			if (ret)
-				goto err_pw_off;
-			power_state1 = val & BIT_PMU_APB_PD_MM_SYS_STATE(0xf);
-
-			ret = regmap_read(cam_pw->pmu_apb_gpr,
-					  REG_PMU_APB_PWR_STATUS0_DBG, &val);
-			if (ret)
-				goto err_pw_off;
-			power_state2 = val & BIT_PMU_APB_PD_MM_SYS_STATE(0xf);
-
-			ret = regmap_read(cam_pw->pmu_apb_gpr,
-					  REG_PMU_APB_PWR_STATUS0_DBG, &val);
-			if (ret)
-				goto err_pw_off;
-			power_state3 = val & BIT_PMU_APB_PD_MM_SYS_STATE(0xf);
-		} while (((power_state1 != PD_MM_DOWN_FLAG) &&
-			read_count < 10) ||
-			(power_state1 != power_state2) ||
-			(power_state2 != power_state3));
-
-		if (power_state1 != PD_MM_DOWN_FLAG) {
-			pr_err("cam domain pw off failed 0x%x\n", power_state1);
+		ret = sprd_pw_poll_state(cam_pw->pmu_apb_gpr,
+					 REG_PMU_APB_PWR_STATUS0_DBG,
+					 BIT_PMU_APB_PD_MM_SYS_STATE(0xf),
+					 PD_MM_DOWN_FLAG, PW_STATE_TIMEOUT_US,
+					 &power_state);
+		if (ret == -ETIMEDOUT) {
+			pr_err("cam domain pw off failed 0x%x\n", power_state);
+			cam_pw_lat.timeouts++;
 			ret = -1;
-			goto err_pw_off;
 		}
+		if (ret)
+			goto err_pw_off;
+		sprd_pw_lat_record(&cam_pw_lat, false, start);
 	} else if (atomic_read(&cam_pw->users_pw) < 0)
 		atomic_set(&cam_pw->users_pw, 0);
 
 	mutex_unlock(&cam_pw->client_lock);
 
-	pr_info("%s, count:%d, cb: %pS, read_count %d\n", __func__,
+	pr_info("%s, count:%d, cb: %pS, %lld us\n", __func__,
 		atomic_read(&cam_pw->users_pw),
-		__builtin_return_address(0), read_count);
+		__builtin_return_address(0),
+		start ? ktime_us_delta(ktime_get(), start) : 0);
 
 	return 0;
 
 err_pw_off:
-	pr_err("cam domain pw off failed, ret: %d, count: %d!\n",
-	       ret, read_count);
+	pr_err("cam domain pw off failed, ret: %d!\n", ret);
 	mutex_unlock(&cam_pw->client_lock);
 	return 0;
 }
@@ -300,13 +284,13 @@ err_exit:
 int sprd_cam_pw_on(void)
 {
 	int ret = 0;
-	unsigned int power_state1, power_state2, power_state3;
-	unsigned int read_count = 0;
-	unsigned int val = 0;
+	unsigned int power_state = 0;
+	ktime_t start = 0;
 
 	mutex_lock(&cam_pw->client_lock);
 
 	if (atomic_inc_return(&cam_pw->users_pw) == 1) {
+		start = ktime_get();
 		/* cam domain power on */
 		regmap_update_bits(cam_pw->pmu_apb_gpr,
 				   REG_PMU_APB_PD_MM_TOP_CFG,
@@ -319,50 +303,32 @@ int sprd_cam_pw_on(void)
 				   ~(unsigned int)
 				   MASK_PMU_APB_PD_MM_TOP_FORCE_SHUTDOWN);
 
-		do {
-			cpu_relax();
-			usleep_range(300, 350);
-			read_count++;
-
-			ret = regmap_read(cam_pw->pmu_apb_gpr,
-					  REG_PMU_APB_PWR_STATUS0_DBG, &val);
-			if (ret)
-				goto err_pw_on;
-			power_state1 = val & BIT_PMU_APB_PD_MM_SYS_STATE(0xf);
-
-			ret = regmap_read(cam_pw->pmu_apb_gpr,
-					  REG_PMU_APB_PWR_STATUS0_DBG, &val);
-			if (ret)
-				goto err_pw_on;
-			power_state2 = val & BIT_PMU_APB_PD_MM_SYS_STATE(0xf);
-
-			ret = regmap_read(cam_pw->pmu_apb_gpr,
-					  REG_PMU_APB_PWR_STATUS0_DBG, &val);
-			if (ret)
-				goto err_pw_on;
-			power_state3 = val & BIT_PMU_APB_PD_MM_SYS_STATE(0xf);
-
-		} while ((power_state1 && read_count < 10) ||
-			(power_state1 != power_state2) ||
-			(power_state2 != power_state3));
-
-		if (power_state1) {
-			pr_err("cam domain pw on failed 0x%x\n", power_state1);
+		ret = sprd_pw_poll_state(cam_pw->pmu_apb_gpr,
+					 REG_PMU_APB_PWR_STATUS0_DBG,
+					 BIT_PMU_APB_PD_MM_SYS_STATE(0xf),
+					 0, PW_STATE_TIMEOUT_US,
+					 &power_state);
+		if (ret == -ETIMEDOUT) {
+			pr_err("cam domain pw on failed 0x%x\n", power_state);
+			cam_pw_lat.timeouts++;
 			ret = -1;
-			goto err_pw_on;
 		}
+		if (ret)
+			goto err_pw_on;
 
 		/* mm bus enable */
 		clk_prepare_enable(cam_pw->cam_mm_eb);
 		udelay(50);
 		sprd_mm_lpc_ctrl();
+		sprd_pw_lat_record(&cam_pw_lat, true, start);
 		pr_info("cam_pw_domain:cam_pw_on set OK.\n");
 	}
 	mutex_unlock(&cam_pw->client_lock);
 
-	pr_info("%s, count:%d, cb: %pS, read_count %d\n", __func__,
+	pr_info("%s, count:%d, cb: %pS, %lld us\n", __func__,
 		atomic_read(&cam_pw->users_pw),
-		__builtin_return_address(0), read_count);
+		__builtin_return_address(0),
+		start ? ktime_us_delta(ktime_get(), start) : 0);
 
 	return 0;
 err_pw_on:
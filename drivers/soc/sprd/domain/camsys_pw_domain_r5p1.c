@@ -23,6 +23,7 @@
 #include <linux/platform_device.h>
 #include <linux/regmap.h>
 #include <video/sprd_mmsys_pw_domain.h>
+#include "sprd_pw_domain.h"
 
 
 #ifdef pr_fmt
@@ -31,6 +32,9 @@
 #define pr_fmt(fmt) "cam_sys_pw: %d %d %s : "\
 	fmt, current->pid, __LINE__, __func__
 
+/* what the old 10 polls of 300us allowed */
+#define PW_STATE_TIMEOUT_US 3500
+
 static const char * const syscon_name[] = {
 	"shutdown_en",
 	"force_shutdown",
@@ -71,6 +75,7 @@ struct camsys_power_info {
 };
 
 static struct camsys_power_info *pw_info;
+static struct sprd_pw_lat cam_pw_lat;
 
 static int sprd_campw_check_drv_init(void)
 {
@@ -148,6 +153,7 @@ static int sprd_campw_init(struct platform_device *pdev)
 	}
 
 	mutex_init(&pw_info->mlock);
+	sprd_pw_lat_register(&cam_pw_lat, "cam");
 	atomic_set(&pw_info->inited, 1);
 
 	return 0;
@@ -156,11 +162,8 @@ static int sprd_campw_init(struct platform_device *pdev)
 int sprd_cam_pw_off(void)
 {
 	int ret = 0;
-	unsigned int power_state1 = 0;
-	unsigned int power_state2 = 0;
-	unsigned int power_state3 = 0;
-	unsigned int read_count = 0;
-	unsigned int val = 0;
+	unsigned int power_state = 0;
+	ktime_t start = 0;
 	unsigned int pd_off_state = 0;
 	struct register_gpr *preg_gpr;
 
@@ -176,6 +179,7 @@ int sprd_cam_pw_off(void)
 
 	mutex_lock(&pw_info->mlock);
 	if (atomic_dec_return(&pw_info->users_pw) == 0) {
+		start = ktime_get();
 
 		usleep_range(300, 350);
 
@@ -190,49 +194,32 @@ int sprd_cam_pw_off(void)
 				preg_gpr->mask,
 				preg_gpr->mask);
 
-		do {
-			cpu_relax();
-			usleep_range(300, 350);
-			read_count++;
-			preg_gpr = &pw_info->syscon_regs[CAMSYS_PD_MM_STATE];
-
-			ret = regmap_read(preg_gpr->gpr, preg_gpr->reg, &val);
-			if (ret)
-				goto err_pw_off;
-			power_state1 = val & preg_gpr->mask;
-
-			ret = regmap_read(preg_gpr->gpr, preg_gpr->reg, &val);
-			if (ret)
-				goto err_pw_off;
-			power_state2 = val & preg_gpr->mask;
-
-			ret = regmap_read(preg_gpr->gpr, preg_gpr->reg, &val);
-			if (ret)
-				goto err_pw_off;
-			power_state3 = val & preg_gpr->mask;
-		} while (((power_state1 != pd_off_state) && read_count < 10) ||
-			(power_state1 != power_state2) ||
-			(power_state2 != power_state3));
-
-		if (power_state1 != pd_off_state) {
-			pr_err("fail to get power state 0x%x\n", power_state1);
+		preg_gpr = &pw_info->syscon_regs[CAMSYS_PD_MM_STATE];
+		ret = sprd_pw_poll_state(preg_gpr->gpr, preg_gpr->reg,
+				preg_gpr->mask, pd_off_state,
+				PW_STATE_TIMEOUT_US, &power_state);
+		if (ret == -ETIMEDOUT) {
+			pr_err("fail to get power state 0x%x\n", power_state);
+			cam_pw_lat.timeouts++;
 			ret = -1;
-			goto err_pw_off;
 		}
+		if (ret)
+			goto err_pw_off;
+		sprd_pw_lat_record(&cam_pw_lat, false, start);
 	} else if (atomic_read(&pw_info->users_pw) < 0)
 		atomic_set(&pw_info->users_pw, 0);
 
 	mutex_unlock(&pw_info->mlock);
 
-	pr_info("users_pw %d, cb %p, read_count %d\n",
+	pr_info("users_pw %d, cb %p, %lld us\n",
 		atomic_read(&pw_info->users_pw),
-		__builtin_return_address(0), read_count);
+		__builtin_return_address(0),
+		start ? ktime_us_delta(ktime_get(), start) : 0);
 
 	return 0;
 
 err_pw_off:
-	pr_err("fail to power off cam sys, ret %d, read count %d\n",
-		ret, read_count);
+	pr_err("fail to power off cam sys, ret %d\n", ret);
 	mutex_unlock(&pw_info->mlock);
 
 	return ret;
@@ -242,11 +229,8 @@ EXPORT_SYMBOL(sprd_cam_pw_off);
 int sprd_cam_pw_on(void)
 {
 	int ret = 0;
-	unsigned int power_state1 = 0;
-	unsigned int power_state2 = 0;
-	unsigned int power_state3 = 0;
-	unsigned int read_count = 0;
-	unsigned int val = 0;
+	unsigned int power_state = 0;
+	ktime_t start = 0;
 	struct register_gpr *preg_gpr;
 
 	ret = sprd_campw_check_drv_init();
@@ -259,6 +243,7 @@ int sprd_cam_pw_on(void)
 
 	mutex_lock(&pw_info->mlock);
 	if (atomic_inc_return(&pw_info->users_pw) == 1) {
+		start = ktime_get();
 		/* cam domain power on */
 		preg_gpr = &pw_info->syscon_regs[CAMSYS_SHUTDOWN_EN];
 		regmap_update_bits(preg_gpr->gpr,
@@ -271,42 +256,25 @@ int sprd_cam_pw_on(void)
 				preg_gpr->mask,
 				~preg_gpr->mask);
 
-		do {
-			cpu_relax();
-			usleep_range(300, 350);
-			read_count++;
-			preg_gpr = &pw_info->syscon_regs[CAMSYS_PD_MM_STATE];
-
-			ret = regmap_read(preg_gpr->gpr, preg_gpr->reg, &val);
-			if (ret)
-				goto err_pw_on;
-			power_state1 = val & preg_gpr->mask;
-
-			ret = regmap_read(preg_gpr->gpr, preg_gpr->reg, &val);
-			if (ret)
-				goto err_pw_on;
-			power_state2 = val & preg_gpr->mask;
-
-			ret = regmap_read(preg_gpr->gpr, preg_gpr->reg, &val);
-			if (ret)
-				goto err_pw_on;
-			power_state3 = val & preg_gpr->mask;
-
-		} while ((power_state1 && read_count < 10) ||
-			(power_state1 != power_state2) ||
-			(power_state2 != power_state3));
-
-		if (power_state1) {
-			pr_err("fail to get power state 0x%x\n", power_state1);
+		preg_gpr = &pw_info->syscon_regs[CAMSYS_PD_MM_STATE];
+		ret = sprd_pw_poll_state(preg_gpr->gpr, preg_gpr->reg,
+				preg_gpr->mask, 0,
+				PW_STATE_TIMEOUT_US, &power_state);
+		if (ret == -ETIMEDOUT) {
+			pr_err("fail to get power state 0x%x\n", power_state);
+			cam_pw_lat.timeouts++;
 			ret = -1;
-			goto err_pw_on;
 		}
+		if (ret)
+			goto err_pw_on;
+		sprd_pw_lat_record(&cam_pw_lat, true, start);
 	}
 	mutex_unlock(&pw_info->mlock);
 
-	pr_info("users_pw %d, cb %p, read_count %d\n",
+	pr_info("users_pw %d, cb %p, %lld us\n",
 		atomic_read(&pw_info->users_pw),
-		__builtin_return_address(0), read_count);
+		__builtin_return_address(0),
+		start ? ktime_us_delta(ktime_get(), start) : 0);
 
 	return 0;
 
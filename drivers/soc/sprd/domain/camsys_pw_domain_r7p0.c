@@ -24,6 +24,7 @@
 #include <linux/regmap.h>
 #include <video/sprd_mmsys_pw_domain.h>
 #include <asm/cacheflush.h>
+#include "sprd_pw_domain.h"
 
 #ifdef pr_fmt
 #undef pr_fmt
@@ -43,6 +44,8 @@ static const char * const syscon_name[] = {
 #define ARQOS_THRESHOLD    0x0D
 #define AWQOS_THRESHOLD    0x0D
 #define SHIFT_MASK(a)      (ffs(a) ? ffs(a) - 1 : 0)
+/* what the old 30 polls of 300us allowed */
+#define PW_STATE_TIMEOUT_US 10000
 
 enum  {
 	FORCE_SHUTDOWN = 0,
@@ -83,6 +86,7 @@ struct camsys_power_info {
 };
 
 static struct camsys_power_info *pw_info;
+static struct sprd_pw_lat cam_pw_lat;
 static BLOCKING_NOTIFIER_HEAD(mmsys_chain);
 /* register */
 int sprd_mm_pw_notify_register(struct notifier_block *nb)
@@ -111,17 +115,14 @@ static void regmap_update_bits_mmsys(struct register_gpr *p, uint32_t val)
 	regmap_update_bits(p->gpr, p->reg, p->mask, val);
 }
 
-static int regmap_read_mmsys(struct register_gpr *p, uint32_t *val)
+static int poll_state_mmsys(struct register_gpr *p, uint32_t want,
+			    uint32_t *state)
 {
-	int ret = 0;
-
-	if ((!p) || (!(p->gpr)) || (!val))
+	if ((!p) || (!(p->gpr)))
 		return -1;
-	ret = regmap_read(p->gpr, p->reg, val);
-	if (!ret)
-		*val &= (uint32_t)p->mask;
 
-	return ret;
+	return sprd_pw_poll_state(p->gpr, p->reg, p->mask, want,
+				  PW_STATE_TIMEOUT_US, state);
 }
 
 static int check_drv_init(void)
@@ -244,6 +245,7 @@ static int sprd_campw_init(struct platform_device *pdev)
 	}
 
 	mutex_init(&pw_info->mlock);
+	sprd_pw_lat_register(&cam_pw_lat, "cam");
 	atomic_set(&pw_info->inited, 1);
 
 	pr_info("cam power init end\n");
@@ -254,10 +256,8 @@ static int sprd_campw_init(struct platform_device *pdev)
 int sprd_cam_pw_off(void)
 {
 	int ret = 0;
-	unsigned int power_state1;
-	unsigned int power_state2;
-	unsigned int power_state3;
-	unsigned int read_count = 0;
+	unsigned int power_state = 0;
+	ktime_t start = 0;
 	int shift = 0;
 
 	ret = check_drv_init();
@@ -270,6 +270,7 @@ int sprd_cam_pw_off(void)
 
 	mutex_lock(&pw_info->mlock);
 	if (atomic_dec_return(&pw_info->users_pw) == 0) {
+		start = ktime_get();
 		/* 1:auto shutdown en, shutdown with ap; 0: control by b25 */
 		regmap_update_bits_mmsys(&pw_info->regs[SHUTDOWN_EN],
 			0);
@@ -279,46 +280,31 @@ int sprd_cam_pw_off(void)
 		/* shift for power off status bits */
 		if (pw_info->regs[PWR_STATUS0].gpr != NULL)
 			shift = SHIFT_MASK(pw_info->regs[PWR_STATUS0].mask);
-		do {
-			cpu_relax();
-			usleep_range(300, 350);
-			read_count++;
-
-			ret = regmap_read_mmsys(&pw_info->regs[PWR_STATUS0],
-					&power_state1);
-			if (ret)
-				goto err_pw_off;
-			ret = regmap_read_mmsys(&pw_info->regs[PWR_STATUS0],
-					&power_state2);
-			if (ret)
-				goto err_pw_off;
-			ret = regmap_read_mmsys(&pw_info->regs[PWR_STATUS0],
-					&power_state3);
-			if (ret)
-				goto err_pw_off;
-		} while (((power_state1 != (PD_MM_DOWN_FLAG << shift)) &&
-			(read_count < 30)) ||
-				(power_state1 != power_state2) ||
-				(power_state2 != power_state3));
-		if (power_state1 != (PD_MM_DOWN_FLAG << shift)) {
-			pr_err("failed, power_state1=0x%x\n", power_state1);
+		ret = poll_state_mmsys(&pw_info->regs[PWR_STATUS0],
+				       PD_MM_DOWN_FLAG << shift, &power_state);
+		if (ret == -ETIMEDOUT) {
+			pr_err("failed, power_state=0x%x\n", power_state);
+			cam_pw_lat.timeouts++;
 			ret = -1;
-			goto err_pw_off;
 		}
+		if (ret)
+			goto err_pw_off;
+		sprd_pw_lat_record(&cam_pw_lat, false, start);
 	} else if (atomic_read(&pw_info->users_pw) < 0)
 		atomic_set(&pw_info->users_pw, 0);
 
 	mutex_unlock(&pw_info->mlock);
 	/* if count != 0, other using */
-	pr_info("Done, uses: %d, read count %d, cb: %p\n",
-		atomic_read(&pw_info->users_pw), read_count,
+	pr_info("Done, uses: %d, %lld us, cb: %p\n",
+		atomic_read(&pw_info->users_pw),
+		start ? ktime_us_delta(ktime_get(), start) : 0,
 		__builtin_return_address(0));
 
 	return 0;
 
 err_pw_off:
 	mutex_unlock(&pw_info->mlock);
-	pr_err("failed, ret: %d, count: %d, cb: %p\n", ret, read_count,
+	pr_err("failed, ret: %d, cb: %p\n", ret,
 		__builtin_return_address(0));
 
 	return ret;
@@ -339,10 +325,8 @@ EXPORT_SYMBOL(sprd_cache_flush);
 int sprd_cam_pw_on(void)
 {
 	int ret = 0;
-	unsigned int power_state1;
-	unsigned int power_state2;
-	unsigned int power_state3;
-	unsigned int read_count = 0;
+	unsigned int power_state = 0;
+	ktime_t start = 0;
 
 	pr_info("sprd cam pw on\n");
 
@@ -356,42 +340,28 @@ int sprd_cam_pw_on(void)
 
 	mutex_lock(&pw_info->mlock);
 	if (atomic_inc_return(&pw_info->users_pw) == 1) {
+		start = ktime_get();
 		/* clear force shutdown */
 		regmap_update_bits_mmsys(&pw_info->regs[FORCE_SHUTDOWN], 0);
 		/* power on */
 		regmap_update_bits_mmsys(&pw_info->regs[SHUTDOWN_EN], 0);
 
-		do {
-			cpu_relax();
-			usleep_range(300, 350);
-			read_count++;
-
-			ret = regmap_read_mmsys(&pw_info->regs[PWR_STATUS0],
-					&power_state1);
-			if (ret)
-				goto err_pw_on;
-			ret = regmap_read_mmsys(&pw_info->regs[PWR_STATUS0],
-					&power_state2);
-			if (ret)
-				goto err_pw_on;
-			ret = regmap_read_mmsys(&pw_info->regs[PWR_STATUS0],
-					&power_state3);
-			if (ret)
-				goto err_pw_on;
-		} while ((power_state1 && read_count < 30) ||
-				(power_state1 != power_state2) ||
-				(power_state2 != power_state3));
-
-		if (power_state1) {
-			pr_err("cam domain pw on failed 0x%x\n", power_state1);
+		ret = poll_state_mmsys(&pw_info->regs[PWR_STATUS0], 0,
+				       &power_state);
+		if (ret == -ETIMEDOUT) {
+			pr_err("cam domain pw on failed 0x%x\n", power_state);
+			cam_pw_lat.timeouts++;
 			ret = -1;
-			goto err_pw_on;
 		}
+		if (ret)
+			goto err_pw_on;
+		sprd_pw_lat_record(&cam_pw_lat, true, start);
 	}
 	mutex_unlock(&pw_info->mlock);
 	/* if count != 0, other using */
-	pr_info("Done, uses: %d, read count %d, cb: %p\n",
-		atomic_read(&pw_info->users_pw), read_count,
+	pr_info("Done, uses: %d, %lld us, cb: %p\n",
+		atomic_read(&pw_info->users_pw),
+		start ? ktime_us_delta(ktime_get(), start) : 0,
 		__builtin_return_address(0));
 
 	return 0;
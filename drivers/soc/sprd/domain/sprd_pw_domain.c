@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2020 Unisoc Communications Inc.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/delay.h>
+#include <linux/kernel.h>
+#include <linux/log2.h>
+#include <linux/seq_file.h>
+#include "sprd_pw_domain.h"
+
+#define SPRD_PW_POLL_US		20
+
+static struct dentry *sprd_pw_debugfs_root;
+
+int sprd_pw_poll_state(struct regmap *map, u32 reg, u32 mask, u32 want,
+		       u32 timeout_us, u32 *state)
+{
+	ktime_t timeout = ktime_add_us(ktime_get(), timeout_us);
+	u32 val[3];
+	int i, ret;
+
+	for (;;) {
+		for (i = 0; i < ARRAY_SIZE(val); i++) {
+			ret = regmap_read(map, reg, &val[i]);
+			if (ret)
+				return ret;
+			val[i] &= mask;
+		}
+
+		if (val[0] == val[1] && val[1] == val[2]) {
+			*state = val[0];
+			if (val[0] == want)
+				return 0;
+			if (ktime_after(ktime_get(), timeout))
+				return -ETIMEDOUT;
+		}
+
+		usleep_range(SPRD_PW_POLL_US, SPRD_PW_POLL_US * 2);
+	}
+}
+
+void sprd_pw_lat_record(struct sprd_pw_lat *lat, bool on, ktime_t start)
+{
+	struct sprd_pw_lat_hist *h = on ? &lat->on : &lat->off;
+	u32 us = ktime_us_delta(ktime_get(), start);
+	int i = 0;
+
+	if (us >= 32)
+		i = min_t(int, ilog2(us >> 5) + 1, SPRD_PW_LAT_BUCKETS);
+
+	h->bucket[i]++;
+	h->cnt++;
+	h->sum_us += us;
+	h->max_us = max(h->max_us, us);
+}
+
+static void sprd_pw_lat_show_hist(struct seq_file *m, const char *what,
+				  struct sprd_pw_lat_hist *h)
+{
+	int i;
+
+	seq_printf(m, "%s: cnt %u avg %llu max %u us\n", what, h->cnt,
+		   h->cnt ? div_u64(h->sum_us, h->cnt) : 0, h->max_us);
+	for (i = 0; i < SPRD_PW_LAT_BUCKETS; i++)
+		seq_printf(m, "  <%6u us: %u\n", 32 << i, h->bucket[i]);
+	seq_printf(m, "  >=%5u us: %u\n", 32 << (SPRD_PW_LAT_BUCKETS - 1),
+		   h->bucket[SPRD_PW_LAT_BUCKETS]);
+}
+
+static int sprd_pw_lat_show(struct seq_file *m, void *v)
+{
+	struct sprd_pw_lat *lat = m->private;
+
+	sprd_pw_lat_show_hist(m, "on", &lat->on);
+	sprd_pw_lat_show_hist(m, "off", &lat->off);
+	seq_printf(m, "timeouts: %u\n", lat->timeouts);
+
+	return 0;
+}
+
+static int sprd_pw_lat_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sprd_pw_lat_show, inode->i_private);
+}
+
+static const struct file_operations sprd_pw_lat_fops = {
+	.open = sprd_pw_lat_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+void sprd_pw_lat_register(struct sprd_pw_lat *lat, const char *name)
+{
+	lat->name = name;
+
+	if (!sprd_pw_debugfs_root)
+		sprd_pw_debugfs_root = debugfs_create_dir("sprd_pw_domain",
+							  NULL);
+	if (!sprd_pw_debugfs_root)
+		return;
+
+	debugfs_create_file(name, 0444, sprd_pw_debugfs_root, lat,
+			    &sprd_pw_lat_fops);
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2020 Unisoc Communications Inc.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _SPRD_PW_DOMAIN_H_
+#define _SPRD_PW_DOMAIN_H_
+
+#include <linux/ktime.h>
+#include <linux/regmap.h>
+
+/* bucket i counts the transitions shorter than 32us << i */
+#define SPRD_PW_LAT_BUCKETS	10
+
+struct sprd_pw_lat_hist {
+	u32 cnt;
+	u32 max_us;
+	u64 sum_us;
+	u32 bucket[SPRD_PW_LAT_BUCKETS + 1];
+};
+
+/* updated under the lock of the domain driver that owns it */
+struct sprd_pw_lat {
+	const char *name;
+	struct sprd_pw_lat_hist on;
+	struct sprd_pw_lat_hist off;
+	u32 timeouts;
+};
+
+void sprd_pw_lat_register(struct sprd_pw_lat *lat, const char *name);
+void sprd_pw_lat_record(struct sprd_pw_lat *lat, bool on, ktime_t start);
+
+/*
+ * Poll (reg & mask) until three reads in a row agree and equal want, the
+ * same glitch filter as the open coded loops, re-reading every 20us. When
+ * timeout_us passes it still waits for three equal reads, stores the last
+ * one in *state and returns -ETIMEDOUT.
+ */
+int sprd_pw_poll_state(struct regmap *map, u32 reg, u32 mask, u32 want,
+		       u32 timeout_us, u32 *state);
+
+#endif /* _SPRD_PW_DOMAIN_H_ */
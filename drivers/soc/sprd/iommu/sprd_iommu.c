@@ -34,6 +34,7 @@
 #include <linux/dma-buf.h>
 #include <linux/pm_runtime.h>
 #include <linux/pm.h>
+#include <linux/sort.h>
 
 #include "sprd_iommu_sysfs.h"
 #include "drv/com/sprd_com.h"
@@ -404,24 +405,56 @@ static struct sprd_iommu_dev *sprd_iommu_get_subnode_with_idx(
 	return args.np->data;
 }
 
+static struct sprd_iommu_sg_rec *sprd_iommu_find_iova(
+						struct sprd_iommu_dev *iommu_dev,
+						unsigned long iova_addr)
+{
+	struct rb_node *node = iommu_dev->sg_pool.iova_root.rb_node;
+	struct sprd_iommu_sg_rec *rec;
+
+	while (node) {
+		rec = rb_entry(node, struct sprd_iommu_sg_rec, iova_node);
+		if (iova_addr < rec->iova_addr)
+			node = node->rb_left;
+		else if (iova_addr > rec->iova_addr)
+			node = node->rb_right;
+		else
+			return rec;
+	}
+
+	return NULL;
+}
+
+static void sprd_iommu_free_rec(struct sprd_iommu_dev *iommu_dev,
+				struct sprd_iommu_sg_rec *rec)
+{
+	list_del(&rec->park_node);
+	hash_del(&rec->buf_node);
+	rb_erase(&rec->iova_node, &iommu_dev->sg_pool.iova_root);
+	iommu_dev->sg_pool.pool_cnt--;
+	kfree(rec);
+}
+
 static bool sprd_iommu_target_buf(struct sprd_iommu_dev *iommu_dev,
 						void *buf_addr,
 						unsigned long *iova_addr)
 {
-	int index = 0;
-
-	for (index = 0; index < SPRD_MAX_SG_CACHED_CNT; index++) {
-		if (iommu_dev->sg_pool.slot[index].status == SG_SLOT_USED &&
-		   iommu_dev->sg_pool.slot[index].buf_addr == buf_addr) {
-			*iova_addr = iommu_dev->sg_pool.slot[index].iova_addr;
-			iommu_dev->sg_pool.slot[index].map_usrs++;
-			break;
+	struct sprd_iommu_sg_rec *rec;
+
+	hash_for_each_possible(iommu_dev->sg_pool.buf_hash, rec, buf_node,
+			       (unsigned long)buf_addr) {
+		if (rec->buf_addr == buf_addr) {
+			*iova_addr = rec->iova_addr;
+			/* the parked mapping hands its buffer count over */
+			if (rec->map_usrs++ == 0) {
+				list_del_init(&rec->park_node);
+				sprd_ion_put_dma(buf_addr, iommu_dev->id);
+			}
+			return true;
 		}
 	}
-	if (index < SPRD_MAX_SG_CACHED_CNT)
-		return true;
-	else
-		return false;
+
+	return false;
 }
 
 static bool sprd_iommu_target_iova_find_buf(struct sprd_iommu_dev *iommu_dev,
@@ -429,20 +462,15 @@ static bool sprd_iommu_target_iova_find_buf(struct sprd_iommu_dev *iommu_dev,
 						size_t iova_size,
 						void **buf)
 {
-	int index = 0;
-
-	for (index = 0; index < SPRD_MAX_SG_CACHED_CNT; index++) {
-		if (iommu_dev->sg_pool.slot[index].status == SG_SLOT_USED &&
-		   iommu_dev->sg_pool.slot[index].iova_addr == iova_addr &&
-		   iommu_dev->sg_pool.slot[index].iova_size == iova_size) {
-			*buf = iommu_dev->sg_pool.slot[index].buf_addr;
-			break;
-		}
-	}
-	if (index < SPRD_MAX_SG_CACHED_CNT)
+	struct sprd_iommu_sg_rec *rec;
+
+	rec = sprd_iommu_find_iova(iommu_dev, iova_addr);
+	if (rec && rec->map_usrs && rec->iova_size == iova_size) {
+		*buf = rec->buf_addr;
 		return true;
-	else
-		return false;
+	}
+
+	return false;
 }
 
 static bool sprd_iommu_target_buf_find_iova(struct sprd_iommu_dev *iommu_dev,
@@ -450,20 +478,18 @@ static bool sprd_iommu_target_buf_find_iova(struct sprd_iommu_dev *iommu_dev,
 						size_t iova_size,
 						unsigned long *iova_addr)
 {
-	int index;
-
-	for (index = 0; index < SPRD_MAX_SG_CACHED_CNT; index++) {
-		if (iommu_dev->sg_pool.slot[index].status == SG_SLOT_USED &&
-		   iommu_dev->sg_pool.slot[index].buf_addr == buf_addr &&
-		   iommu_dev->sg_pool.slot[index].iova_size == iova_size) {
-			*iova_addr = iommu_dev->sg_pool.slot[index].iova_addr;
-			break;
+	struct sprd_iommu_sg_rec *rec;
+
+	hash_for_each_possible(iommu_dev->sg_pool.buf_hash, rec, buf_node,
+			       (unsigned long)buf_addr) {
+		if (rec->buf_addr == buf_addr && rec->map_usrs &&
+		    rec->iova_size == iova_size) {
+			*iova_addr = rec->iova_addr;
+			return true;
 		}
 	}
-	if (index < SPRD_MAX_SG_CACHED_CNT)
-		return true;
-	else
-		return false;
+
+	return false;
 }
 
 static bool sprd_iommu_insert_slot(struct sprd_iommu_dev *iommu_dev,
@@ -472,93 +498,261 @@ static bool sprd_iommu_insert_slot(struct sprd_iommu_dev *iommu_dev,
 						unsigned long iova_addr,
 						unsigned long iova_size)
 {
-	int index = 0;
-	struct sprd_iommu_sg_rec *rec;
+	struct rb_node **link = &iommu_dev->sg_pool.iova_root.rb_node;
+	struct rb_node *parent = NULL;
+	struct sprd_iommu_sg_rec *rec, *cur;
 
-	for (index = 0; index < SPRD_MAX_SG_CACHED_CNT; index++) {
-		rec = &(iommu_dev->sg_pool.slot[index]);
-		if (rec->status == SG_SLOT_FREE) {
-			rec->sg_table_addr = sg_table_addr;
-			rec->buf_addr = buf_addr;
-			rec->iova_addr = iova_addr;
-			rec->iova_size = iova_size;
-			rec->status = SG_SLOT_USED;
-			rec->map_usrs++;
-			iommu_dev->sg_pool.pool_cnt++;
-			break;
-		}
+	/* called under pgt_lock */
+	rec = kzalloc(sizeof(*rec), GFP_ATOMIC);
+	if (!rec)
+		return false;
+
+	rec->sg_table_addr = sg_table_addr;
+	rec->buf_addr = buf_addr;
+	rec->iova_addr = iova_addr;
+	rec->iova_size = iova_size;
+	rec->map_usrs = 1;
+	INIT_LIST_HEAD(&rec->park_node);
+
+	while (*link) {
+		parent = *link;
+		cur = rb_entry(parent, struct sprd_iommu_sg_rec, iova_node);
+		if (iova_addr < cur->iova_addr)
+			link = &parent->rb_left;
+		else
+			link = &parent->rb_right;
 	}
+	rb_link_node(&rec->iova_node, parent, link);
+	rb_insert_color(&rec->iova_node, &iommu_dev->sg_pool.iova_root);
 
-	if (index < SPRD_MAX_SG_CACHED_CNT)
-		return true;
-	else
-		return false;
+	hash_add(iommu_dev->sg_pool.buf_hash, &rec->buf_node,
+		 (unsigned long)buf_addr);
+	iommu_dev->sg_pool.pool_cnt++;
+
+	return true;
 }
 
 /**
 * remove timeout sg table addr from sg pool
 */
 static bool sprd_iommu_remove_sg_iova(struct sprd_iommu_dev *iommu_dev,
-							unsigned long iova_addr,
-							bool *be_free)
+					struct sprd_iommu_unmap_data *data,
+					unsigned long iova_addr,
+					bool *be_free)
 {
-	int index = 0;
-
-	for (index = 0; index < SPRD_MAX_SG_CACHED_CNT; index++) {
-		if (SG_SLOT_USED == iommu_dev->sg_pool.slot[index].status) {
-			if (iommu_dev->sg_pool.slot[index].iova_addr == iova_addr) {
-				iommu_dev->sg_pool.slot[index].map_usrs--;
-
-				if (0 == iommu_dev->sg_pool.slot[index].map_usrs) {
-					iommu_dev->sg_pool.slot[index].sg_table_addr = 0;
-					iommu_dev->sg_pool.slot[index].iova_addr = 0;
-					iommu_dev->sg_pool.slot[index].iova_size = 0;
-					iommu_dev->sg_pool.slot[index].status = SG_SLOT_FREE;
-					iommu_dev->sg_pool.pool_cnt--;
-					*be_free = true;
-				} else
-					*be_free = false;
-				break;
-			}
-		}
-	}
+	struct sprd_iommu_sg_rec *rec;
 
-	if (index < SPRD_MAX_SG_CACHED_CNT)
-		return true;
-	else
+	rec = sprd_iommu_find_iova(iommu_dev, iova_addr);
+	if (!rec)
 		return false;
+
+	rec->map_usrs--;
+	if (rec->map_usrs == 0 && iommu_dev->iova_cache &&
+	    (data->ch_type == SPRD_IOMMU_FM_CH_RW ||
+	     data->ch_type == SPRD_IOMMU_CH_TYPE_INVALID)) {
+		/* keep a buffer count so freeing the buffer drops the iova */
+		sprd_ion_set_dma(rec->buf_addr, iommu_dev->id);
+		rec->ch_type = data->ch_type;
+		rec->channel_id = data->channel_id;
+		list_add_tail(&rec->park_node, &iommu_dev->sg_pool.parked);
+		*be_free = false;
+	} else if (rec->map_usrs == 0) {
+		sprd_iommu_free_rec(iommu_dev, rec);
+		*be_free = true;
+	} else
+		*be_free = false;
+
+	return true;
 }
 
 static bool sprd_iommu_clear_sg_iova(struct sprd_iommu_dev *iommu_dev,
 			void *buf_addr,
-			unsigned long sg_addr, unsigned long size,
-			unsigned long *iova)
+			unsigned long sg_addr, unsigned long *size,
+			unsigned long *iova, bool *parked)
 {
-	int index;
 	struct sprd_iommu_sg_rec *rec;
-	bool ret = false;
-
-	for (index = 0; index < SPRD_MAX_SG_CACHED_CNT; index++) {
-		rec = &(iommu_dev->sg_pool.slot[index]);
-		if (rec->status == SG_SLOT_USED &&
-		    rec->buf_addr == buf_addr &&
-		    rec->sg_table_addr == sg_addr &&
-		    rec->iova_size == size) {
-			rec->map_usrs = 0;
-			rec->status = SG_SLOT_FREE;
-			iommu_dev->sg_pool.pool_cnt--;
+
+	hash_for_each_possible(iommu_dev->sg_pool.buf_hash, rec, buf_node,
+			       (unsigned long)buf_addr) {
+		/* a parked record must go whatever size it was mapped with */
+		if (rec->buf_addr == buf_addr &&
+		    (rec->map_usrs == 0 ||
+		     (rec->sg_table_addr == sg_addr &&
+		      rec->iova_size == *size))) {
 			*iova = rec->iova_addr;
-			ret = true;
-			break;
+			*size = rec->iova_size;
+			*parked = rec->map_usrs == 0;
+			sprd_iommu_free_rec(iommu_dev, rec);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Prefetch and isp channels release per channel state on unmap, only the
+ * full mode ranges go through the flush queue.
+ */
+static bool sprd_iommu_lazy_unmap(struct sprd_iommu_dev *iommu_dev,
+				  enum sprd_iommu_chtype ch_type)
+{
+	return iommu_dev->lazy_unmap &&
+	       (ch_type == SPRD_IOMMU_FM_CH_RW ||
+		ch_type == SPRD_IOMMU_CH_TYPE_INVALID);
+}
+
+static int sprd_iommu_flush_cmp(const void *a, const void *b)
+{
+	const struct sprd_iommu_flush_entry *ea = a, *eb = b;
+
+	if (ea->iova_addr < eb->iova_addr)
+		return -1;
+	return ea->iova_addr > eb->iova_addr;
+}
+
+/**
+* clear the queued ranges, adjacent ones of the same channel with a single
+* unmap so they share one tlb flush; called under pgt_lock
+*/
+static void sprd_iommu_flush_queue_drain(struct sprd_iommu_dev *iommu_dev)
+{
+	struct sprd_iommu_flush_queue *fq = &iommu_dev->flush_queue;
+	struct sprd_iommu_flush_entry *run, *e;
+	size_t size;
+	int i, j;
+
+	if (!fq->cnt)
+		return;
+
+	sort(fq->entry, fq->cnt, sizeof(fq->entry[0]),
+	     sprd_iommu_flush_cmp, NULL);
+
+	for (i = 0; i < fq->cnt; i = j) {
+		run = &fq->entry[i];
+		size = run->iova_size;
+		for (j = i + 1; j < fq->cnt; j++) {
+			e = &fq->entry[j];
+			if (e->iova_addr != run->iova_addr + size ||
+			    e->ch_type != run->ch_type ||
+			    e->channel_id != run->channel_id)
+				break;
+			size += e->iova_size;
+		}
+
+		iommu_dev->ch_type = run->ch_type;
+		iommu_dev->channel_id = run->channel_id;
+		if (iommu_dev->ops->iova_unmap(iommu_dev,
+					       run->iova_addr, size))
+			IOMMU_ERR("%s error iova 0x%lx 0x%zx\n",
+				  iommu_dev->init_data->name,
+				  run->iova_addr, size);
+
+		/* the ranges may sit in different pool chunks */
+		for (; i < j; i++) {
+			e = &fq->entry[i];
+			iommu_dev->ops->iova_free(iommu_dev,
+						  e->iova_addr, e->iova_size);
+			iommu_dev->map_count--;
 		}
 	}
 
+	iommu_dev->ch_type = SPRD_IOMMU_CH_TYPE_INVALID;
+	fq->cnt = 0;
+}
+
+/**
+* tear down an iova nobody maps any more, right away or through the flush
+* queue; called under pgt_lock
+*/
+static int sprd_iommu_unmap_iova(struct sprd_iommu_dev *iommu_dev,
+				 struct sprd_iommu_unmap_data *data,
+				 unsigned long iova, void *buf)
+{
+	struct sprd_iommu_flush_queue *fq = &iommu_dev->flush_queue;
+	struct sprd_iommu_flush_entry *e;
+	int ret;
+
+	if (sprd_iommu_lazy_unmap(iommu_dev, data->ch_type)) {
+		if (fq->cnt == SPRD_IOMMU_FLUSH_QUEUE_SIZE)
+			sprd_iommu_flush_queue_drain(iommu_dev);
+
+		e = &fq->entry[fq->cnt++];
+		e->iova_addr = iova;
+		e->iova_size = data->iova_size;
+		e->ch_type = data->ch_type;
+		e->channel_id = data->channel_id;
+		IOMMU_DEBUG("%s queued iova 0x%lx size 0x%zx buf %p\n",
+			  iommu_dev->init_data->name,
+			  iova, data->iova_size, buf);
+		return 0;
+	}
+
+	iommu_dev->ch_type = data->ch_type;
+	iommu_dev->channel_id = data->channel_id;
+	ret = iommu_dev->ops->iova_unmap(iommu_dev,
+			iova, data->iova_size);
+	if (ret)
+		IOMMU_ERR("%s error iova 0x%lx 0x%zx buf %p\n",
+			iommu_dev->init_data->name,
+			iova, data->iova_size, buf);
+	iommu_dev->map_count--;
+	iommu_dev->ops->iova_free(iommu_dev,
+		iova, data->iova_size);
+	iommu_dev->ch_type = SPRD_IOMMU_CH_TYPE_INVALID;
+	IOMMU_DEBUG("%s iova 0x%lx size 0x%zx buf %p\n",
+		  iommu_dev->init_data->name,
+		  iova, data->iova_size, buf);
+
 	return ret;
 }
 
+/**
+* unmap all parked records; called under pgt_lock
+*/
+static void sprd_iommu_evict_parked(struct sprd_iommu_dev *iommu_dev)
+{
+	struct sprd_iommu_sg_rec *rec, *tmp;
+	struct sprd_iommu_unmap_data data;
+	unsigned long iova;
+	void *buf;
+
+	list_for_each_entry_safe(rec, tmp, &iommu_dev->sg_pool.parked,
+				 park_node) {
+		memset(&data, 0, sizeof(data));
+		data.iova_size = rec->iova_size;
+		data.ch_type = rec->ch_type;
+		data.channel_id = rec->channel_id;
+		iova = rec->iova_addr;
+		buf = rec->buf_addr;
+
+		sprd_ion_put_dma(buf, iommu_dev->id);
+		sprd_iommu_free_rec(iommu_dev, rec);
+		sprd_iommu_unmap_iova(iommu_dev, &data, iova, buf);
+	}
+}
+
+/* parked and queued ranges still hold their iova, give them back first */
+static unsigned long sprd_iommu_iova_alloc(struct sprd_iommu_dev *iommu_dev,
+					   struct sprd_iommu_map_data *data)
+{
+	unsigned long iova;
+
+	iova = iommu_dev->ops->iova_alloc(iommu_dev, data->iova_size, data);
+	if (iova == 0 && (!list_empty(&iommu_dev->sg_pool.parked) ||
+			  iommu_dev->flush_queue.cnt)) {
+		sprd_iommu_evict_parked(iommu_dev);
+		sprd_iommu_flush_queue_drain(iommu_dev);
+		iova = iommu_dev->ops->iova_alloc(iommu_dev,
+						  data->iova_size, data);
+	}
+
+	return iova;
+}
+
 static void sprd_iommu_pool_show(struct sprd_iommu_dev *iommu_dev)
 {
-	int index;
+	int bkt;
 	struct sprd_iommu_sg_rec *rec;
 
 	if (iommu_dev->id == SPRD_IOMMU_VSP ||
@@ -570,15 +764,12 @@ static void sprd_iommu_pool_show(struct sprd_iommu_dev *iommu_dev)
 		iommu_dev->map_count);
 
 	if (iommu_dev->map_count > 0)
-		for (index = 0; index < SPRD_MAX_SG_CACHED_CNT; index++) {
-			rec = &(iommu_dev->sg_pool.slot[index]);
-			if (rec->status == SG_SLOT_USED) {
+		hash_for_each(iommu_dev->sg_pool.buf_hash, bkt, rec, buf_node)
+			if (rec->map_usrs)
 				IOMMU_ERR("Warning! buffer iova 0x%lx size 0x%lx sg 0x%lx buf %p map_usrs %d should be unmapped!\n",
 					rec->iova_addr, rec->iova_size,
 					rec->sg_table_addr, rec->buf_addr,
 					rec->map_usrs);
-			}
-		}
 }
 
 int sprd_iommu_attach_device(struct device *dev)
@@ -619,14 +810,25 @@ EXPORT_SYMBOL(sprd_iommu_attach_device);
 
 int sprd_iommu_dettach_device(struct device *dev)
 {
-	struct device_node *np = NULL;
+	struct sprd_iommu_dev *iommu_dev = NULL;
+	unsigned long flag = 0;
 
 	if (NULL == dev) {
 		IOMMU_ERR("null parameter err!\n");
 		return -EINVAL;
 	}
 
-	np = dev->of_node;
+	if (!sprd_iommu_is_dev_valid_master(dev))
+		return 0;
+
+	/* the cached iovas are only good while the master stays attached */
+	iommu_dev = sprd_iommu_get_subnode(dev);
+	if (iommu_dev) {
+		spin_lock_irqsave(&iommu_dev->pgt_lock, flag);
+		sprd_iommu_evict_parked(iommu_dev);
+		sprd_iommu_flush_queue_drain(iommu_dev);
+		spin_unlock_irqrestore(&iommu_dev->pgt_lock, flag);
+	}
 
 	return 0;
 }
@@ -693,8 +895,7 @@ int sprd_iommu_map(struct device *dev, struct sprd_iommu_map_data *data)
 	}
 
 	/*new sg, alloc for it*/
-	iova = iommu_dev->ops->iova_alloc(iommu_dev,
-			data->iova_size, data);
+	iova = sprd_iommu_iova_alloc(iommu_dev, data);
 	if (iova == 0) {
 		IOMMU_ERR("%s alloc error iova 0x%lx size 0x%zx buf %p\n",
 			  iommu_dev->init_data->name, iova,
@@ -723,12 +924,14 @@ int sprd_iommu_map(struct device *dev, struct sprd_iommu_map_data *data)
 				data->iova_addr,
 				data->iova_size);
 	if (!buf_insert) {
-		IOMMU_ERR("%s error pool full iova 0x%lx size 0x%zx buf %p\n",
+		IOMMU_ERR("%s error pool no memory iova 0x%lx size 0x%zx buf %p\n",
 				iommu_dev->init_data->name, iova,
 				data->iova_size, data->buf);
 		iommu_dev->ops->iova_unmap(iommu_dev,
 				iova, data->iova_size);
 		iommu_dev->ops->iova_free(iommu_dev, iova, data->iova_size);
+		iommu_dev->map_count--;
+		data->iova_addr = 0;
 		ret = -ENOMEM;
 		goto out1;
 	}
@@ -808,8 +1011,7 @@ int sprd_iommu_map_with_idx(
 	}
 
 	/*new sg, alloc for it*/
-	iova = iommu_dev->ops->iova_alloc(iommu_dev,
-			data->iova_size, data);
+	iova = sprd_iommu_iova_alloc(iommu_dev, data);
 	if (iova == 0) {
 		IOMMU_ERR("%s alloc error iova 0x%lx size 0x%zx buf %p\n",
 			  iommu_dev->init_data->name, iova,
@@ -838,12 +1040,14 @@ int sprd_iommu_map_with_idx(
 				data->iova_addr,
 				data->iova_size);
 	if (!buf_insert) {
-		IOMMU_ERR("%s error pool full iova 0x%lx size 0x%zx buf %p\n",
+		IOMMU_ERR("%s error pool no memory iova 0x%lx size 0x%zx buf %p\n",
 				iommu_dev->init_data->name, iova,
 				data->iova_size, data->buf);
 		iommu_dev->ops->iova_unmap(iommu_dev,
 				iova, data->iova_size);
 		iommu_dev->ops->iova_free(iommu_dev, iova, data->iova_size);
+		iommu_dev->map_count--;
+		data->iova_addr = 0;
 		ret = -ENOMEM;
 		goto out1;
 	}
@@ -926,8 +1130,7 @@ int sprd_iommu_map_single_page(struct device *dev, struct sprd_iommu_map_data *d
 	}
 
 	/*new sg, alloc for it*/
-	iova = iommu_dev->ops->iova_alloc(iommu_dev,
-			data->iova_size, data);
+	iova = sprd_iommu_iova_alloc(iommu_dev, data);
 	if (iova == 0) {
 		IOMMU_ERR("%s alloc error iova 0x%lx size 0x%zx buf %p\n",
 			  iommu_dev->init_data->name, iova,
@@ -956,12 +1159,14 @@ int sprd_iommu_map_single_page(struct device *dev, struct sprd_iommu_map_data *d
 				data->iova_addr,
 				data->iova_size);
 	if (!buf_insert) {
-		IOMMU_ERR("%s error pool full iova 0x%lx size 0x%zx buf %p\n",
+		IOMMU_ERR("%s error pool no memory iova 0x%lx size 0x%zx buf %p\n",
 				iommu_dev->init_data->name, iova,
 				data->iova_size, data->buf);
 		iommu_dev->ops->iova_unmap(iommu_dev,
 				iova, data->iova_size);
 		iommu_dev->ops->iova_free(iommu_dev, iova, data->iova_size);
+		iommu_dev->map_count--;
+		data->iova_addr = 0;
 		ret = -ENOMEM;
 		goto out1;
 	}
@@ -1034,23 +1239,9 @@ int sprd_iommu_unmap(struct device *dev, struct sprd_iommu_unmap_data *data)
 
 	sprd_ion_put_dma(buf, iommu_dev->id);
 
-	sprd_iommu_remove_sg_iova(iommu_dev, iova, &be_free);
+	sprd_iommu_remove_sg_iova(iommu_dev, data, iova, &be_free);
 	if (be_free) {
-		iommu_dev->ch_type = data->ch_type;
-		iommu_dev->channel_id = data->channel_id;
-		ret = iommu_dev->ops->iova_unmap(iommu_dev,
-				iova, data->iova_size);
-		if (ret)
-			IOMMU_ERR("%s error iova 0x%lx 0x%zx buf %p\n",
-				iommu_dev->init_data->name,
-				iova, data->iova_size, buf);
-		iommu_dev->map_count--;
-		iommu_dev->ops->iova_free(iommu_dev,
-			iova, data->iova_size);
-		iommu_dev->ch_type = SPRD_IOMMU_CH_TYPE_INVALID;
-		IOMMU_DEBUG("%s iova 0x%lx size 0x%zx buf %p\n",
-			  iommu_dev->init_data->name,
-			  iova, data->iova_size, buf);
+		ret = sprd_iommu_unmap_iova(iommu_dev, data, iova, buf);
 	} else {
 		IOMMU_DEBUG("%s cached iova 0x%lx size 0x%zx buf %p\n",
 			  iommu_dev->init_data->name,
@@ -1114,23 +1305,9 @@ int sprd_iommu_unmap_with_idx(
 
 	sprd_ion_put_dma(buf, iommu_dev->id);
 
-	sprd_iommu_remove_sg_iova(iommu_dev, iova, &be_free);
+	sprd_iommu_remove_sg_iova(iommu_dev, data, iova, &be_free);
 	if (be_free) {
-		iommu_dev->ch_type = data->ch_type;
-		iommu_dev->channel_id = data->channel_id;
-		ret = iommu_dev->ops->iova_unmap(iommu_dev,
-				iova, data->iova_size);
-		if (ret)
-			IOMMU_ERR("%s error iova 0x%lx 0x%zx buf %p\n",
-				iommu_dev->init_data->name,
-				iova, data->iova_size, buf);
-		iommu_dev->map_count--;
-		iommu_dev->ops->iova_free(iommu_dev,
-			iova, data->iova_size);
-		iommu_dev->ch_type = SPRD_IOMMU_CH_TYPE_INVALID;
-		IOMMU_DEBUG("%s iova 0x%lx size 0x%zx buf %p\n",
-			  iommu_dev->init_data->name,
-			  iova, data->iova_size, buf);
+		ret = sprd_iommu_unmap_iova(iommu_dev, data, iova, buf);
 	} else {
 		IOMMU_DEBUG("%s cached iova 0x%lx size 0x%zx buf %p\n",
 			  iommu_dev->init_data->name,
@@ -1150,7 +1327,9 @@ int sprd_iommu_unmap_orphaned(struct sprd_iommu_unmap_data *data)
 	int ret;
 	struct sprd_iommu_dev *iommu_dev;
 	unsigned long iova;
+	unsigned long size;
 	unsigned long flag = 0;
+	bool parked = false;
 
 	if (data == NULL) {
 		IOMMU_ERR("null parameter error! data %p\n", data);
@@ -1166,17 +1345,23 @@ int sprd_iommu_unmap_orphaned(struct sprd_iommu_unmap_data *data)
 
 	spin_lock_irqsave(&iommu_dev->pgt_lock, flag);
 
+	size = data->iova_size;
 	ret = sprd_iommu_clear_sg_iova(iommu_dev, data->buf,
 					(unsigned long)(data->table),
-					data->iova_size, &iova);
+					&size, &iova, &parked);
 	if (ret) {
 		ret = iommu_dev->ops->iova_unmap_orphaned(iommu_dev,
-						 iova, data->iova_size);
+						 iova, size);
 		iommu_dev->map_count--;
-		iommu_dev->ops->iova_free(iommu_dev, iova, data->iova_size);
-		IOMMU_ERR("%s iova leak error, buf %p id %d iova 0x%lx size 0x%zx\n",
-			iommu_dev->init_data->name, data->buf, data->dev_id,
-			iova, data->iova_size);
+		iommu_dev->ops->iova_free(iommu_dev, iova, size);
+		if (parked)
+			IOMMU_DEBUG("%s parked iova 0x%lx size 0x%lx buf %p\n",
+				iommu_dev->init_data->name, iova, size,
+				data->buf);
+		else
+			IOMMU_ERR("%s iova leak error, buf %p id %d iova 0x%lx size 0x%lx\n",
+				iommu_dev->init_data->name, data->buf,
+				data->dev_id, iova, size);
 	} else
 		IOMMU_ERR("%s illegal error buf %p id %d size 0x%zx\n",
 			iommu_dev->init_data->name, data->buf, data->dev_id,
@@ -1190,6 +1375,7 @@ int sprd_iommu_unmap_orphaned(struct sprd_iommu_unmap_data *data)
 int sprd_iommu_suspend(struct device *dev)
 {
 	struct sprd_iommu_dev *iommu_dev = NULL;
+	unsigned long flag = 0;
 	int ret = 0;
 
 	if (NULL == dev) {
@@ -1210,6 +1396,9 @@ int sprd_iommu_suspend(struct device *dev)
 
 	mutex_lock(&iommu_dev->status_mutex);
 	if (iommu_dev->status_count) {
+		spin_lock_irqsave(&iommu_dev->pgt_lock, flag);
+		sprd_iommu_flush_queue_drain(iommu_dev);
+		spin_unlock_irqrestore(&iommu_dev->pgt_lock, flag);
 		iommu_dev->ops->suspend(iommu_dev);
 		iommu_dev->status_count--;
 	} else
@@ -1652,6 +1841,9 @@ static int sprd_iommu_probe(struct platform_device *pdev)
 	iommu_dev->status_count = 0;
 	iommu_dev->ch_type = SPRD_IOMMU_CH_TYPE_INVALID;
 	iommu_dev->channel_id = 0;
+	iommu_dev->lazy_unmap = of_property_read_bool(np, "sprd,lazy-unmap");
+	iommu_dev->iova_cache = of_property_read_bool(np, "sprd,iova-cache");
+	iommu_dev->flush_queue.cnt = 0;
 	iommu_dev->init_data->name = (char *)(
 		(of_match_node(sprd_iommu_ids, np))->compatible
 		);
@@ -1664,7 +1856,10 @@ static int sprd_iommu_probe(struct platform_device *pdev)
 	atomic_set(&iommu_dev->iommu_dev_cnt, 0);
 	spin_lock_init(&iommu_dev->pgt_lock);
 	mutex_init(&iommu_dev->status_mutex);
-	memset(&iommu_dev->sg_pool, 0, sizeof(struct sprd_iommu_sg_pool));
+	iommu_dev->sg_pool.pool_cnt = 0;
+	hash_init(iommu_dev->sg_pool.buf_hash);
+	iommu_dev->sg_pool.iova_root = RB_ROOT;
+	INIT_LIST_HEAD(&iommu_dev->sg_pool.parked);
 	sprd_iommu_sysfs_create(iommu_dev, iommu_dev->init_data->name);
 	platform_set_drvdata(pdev, iommu_dev);
 
@@ -1683,6 +1878,12 @@ errout:
 static int sprd_iommu_remove(struct platform_device *pdev)
 {
 	struct sprd_iommu_dev *iommu_dev = platform_get_drvdata(pdev);
+	struct sprd_iommu_sg_rec *rec;
+	struct hlist_node *tmp;
+	int bkt;
+
+	hash_for_each_safe(iommu_dev->sg_pool.buf_hash, bkt, tmp, rec, buf_node)
+		sprd_iommu_free_rec(iommu_dev, rec);
 
 	sprd_iommu_sysfs_destroy(iommu_dev, iommu_dev->init_data->name);
 	iommu_dev->ops->exit(iommu_dev);
@@ -25,8 +25,11 @@
 #include <linux/poll.h>
 #include <linux/proc_fs.h>
 #include <linux/sched.h>
+#include <linux/set_memory.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
 #include <linux/uaccess.h>
+#include <linux/vmalloc.h>
 #include <linux/wait.h>
 
 #include <linux/mfd/syscon.h>
@@ -60,6 +63,8 @@ static void sprd_cproc_init_debugfs(void);
 /*used for ioremap to limit vmalloc size, shi yunlong*/
 #define CPROC_VMALLOC_SIZE_LIMIT 4096
 #define MAX_CPROC_ENTRY_NUM		0x20
+/* cp memory is mapped this much at a time for the image cache */
+#define CPROC_CACHE_MAP_SIZE		SZ_1M
 
 enum {
 	CP_NORMAL_STATUS = 0,
@@ -81,6 +86,7 @@ enum {
 	BE_CTRL_ON  = BIT(13),
 	BE_CTRL_OFF	= BIT(14),
 	BE_IOCTL    = BIT(15),
+	BE_RELOAD   = BIT(16),
 };
 
 enum {
@@ -132,6 +138,23 @@ struct cproc_device {
 	int status;
 	int	type;
 	struct cproc_proc_fs procfs;
+	bool cache_loaded;	/* cp memory holds the cached images */
+	u32 *ld_size;		/* bytes written per segment since start */
+	struct cproc_img_cache *cache;
+	struct mutex cache_lock;
+};
+
+/*
+ * With "sprd,image-cache" the segments loaded since the last start are
+ * copied aside, read only, after they passed verification and before
+ * cp leaves reset. Writing "reload" copies them back into cp memory,
+ * and the next start then skips the signature check: cp memory holds
+ * exactly the images that were verified. Any segment write from user
+ * space drops that state again.
+ */
+struct cproc_img_cache {
+	void *data;
+	u32 size;
 };
 
 struct cproc_dump_info {
@@ -605,6 +628,122 @@ static ssize_t cproc_proc_copy_from_user(void *to,
 	return ret;
 }
 
+static int cproc_cache_copy(phys_addr_t base, void *buf, u32 size,
+			    bool to_cp)
+{
+	u32 off, len;
+	void *vmem;
+
+	for (off = 0; off < size; off += len) {
+		len = min_t(u32, size - off, CPROC_CACHE_MAP_SIZE);
+		vmem = modem_ram_vmap_nocache(SOC_MODEM, base + off, len);
+		if (!vmem)
+			return -ENOMEM;
+
+		if (to_cp)
+			unalign_memcpy(vmem, buf + off, len);
+		else
+			unalign_memcpy(buf + off, vmem, len);
+		modem_ram_unmap(SOC_MODEM, vmem);
+	}
+
+	return 0;
+}
+
+static void cproc_cache_free(struct cproc_device *cproc)
+{
+	struct cproc_img_cache *c;
+	u32 i;
+
+	if (!cproc->cache)
+		return;
+
+	for (i = 0; i < cproc->initdata->segnr; i++) {
+		c = &cproc->cache[i];
+		if (!c->data)
+			continue;
+
+		set_memory_rw((unsigned long)c->data,
+			      PAGE_ALIGN(c->size) >> PAGE_SHIFT);
+		vfree(c->data);
+		c->data = NULL;
+		c->size = 0;
+	}
+}
+
+/* called with cache_lock held, right before cp leaves reset */
+static void cproc_cache_save(struct cproc_device *cproc)
+{
+	struct cproc_init_data *pdata = cproc->initdata;
+	struct cproc_img_cache *c;
+	u32 i;
+
+	if (!cproc->cache || cproc->cache_loaded)
+		return;
+
+	/* nothing new was loaded, keep what we have */
+	for (i = 0; i < pdata->segnr; i++)
+		if (cproc->ld_size[i])
+			break;
+	if (i == pdata->segnr)
+		return;
+
+	cproc_cache_free(cproc);
+	for (i = 0; i < pdata->segnr; i++) {
+		c = &cproc->cache[i];
+		if (!cproc->ld_size[i])
+			continue;
+
+		c->data = vmalloc(cproc->ld_size[i]);
+		if (!c->data)
+			goto err;
+		c->size = cproc->ld_size[i];
+
+		if (cproc_cache_copy(pdata->segs[i].base, c->data,
+				     c->size, false))
+			goto err;
+		set_memory_ro((unsigned long)c->data,
+			      PAGE_ALIGN(c->size) >> PAGE_SHIFT);
+		pr_info("cproc: %s cache %s 0x%x\n",
+			pdata->devname, pdata->segs[i].name, c->size);
+	}
+	return;
+
+err:
+	pr_err("cproc: %s image cache failed\n", pdata->devname);
+	cproc_cache_free(cproc);
+}
+
+static int cproc_cache_reload(struct cproc_device *cproc)
+{
+	struct cproc_init_data *pdata = cproc->initdata;
+	struct cproc_img_cache *c;
+	int ret = -ENOENT;
+	u32 i;
+
+	if (!cproc->cache)
+		return -EOPNOTSUPP;
+
+	mutex_lock(&cproc->cache_lock);
+	for (i = 0; i < pdata->segnr; i++) {
+		c = &cproc->cache[i];
+		if (!c->data)
+			continue;
+
+		ret = cproc_cache_copy(pdata->segs[i].base, c->data,
+				       c->size, true);
+		if (ret)
+			break;
+	}
+
+	cproc->cache_loaded = !ret;
+	memset(cproc->ld_size, 0, pdata->segnr * sizeof(*cproc->ld_size));
+	mutex_unlock(&cproc->cache_lock);
+
+	pr_info("cproc: %s reload from cache %d\n", pdata->devname, ret);
+	return ret;
+}
+
 static ssize_t cproc_proc_write(struct file *filp,
 				const char __user *buf,
 				size_t count,
@@ -636,6 +775,10 @@ static ssize_t cproc_proc_write(struct file *filp,
 		cproc->initdata->stop(cproc);
 		cproc->status = CP_STOP_STATUS;
 		return count;
+	} else if ((flag & BE_RELOAD) != 0) {
+		int ret = cproc_cache_reload(cproc);
+
+		return ret ? ret : count;
 	} else if ((flag & BE_LD) != 0) {
 		i = ~((~0) << 4) & flag;
 		base = cproc->initdata->segs[i].base;
@@ -709,6 +852,15 @@ static ssize_t cproc_proc_write(struct file *filp,
 		i++;
 	} while (r > 0);
 
+	if (cproc->cache) {
+		i = ~((~0) << 4) & flag;
+		mutex_lock(&cproc->cache_lock);
+		cproc->cache_loaded = false;
+		cproc->ld_size[i] = max_t(u32, cproc->ld_size[i],
+					  offset + count);
+		mutex_unlock(&cproc->cache_lock);
+	}
+
 	*ppos += count;
 	return count;
 }
@@ -888,6 +1040,16 @@ static inline void sprd_cproc_fs_init(struct cproc_device *cproc)
 			ucnt++;
 			break;
 
+		case 7:
+			if (!cproc->cache) {
+				ucnt++;
+				continue;
+			}
+			cproc->procfs.entrys[i].name = "reload";
+			flag |= (BE_WRONLY | BE_RELOAD);
+			ucnt++;
+			break;
+
 		default:
 			if (cproc->initdata->segnr + ucnt
 				>= MAX_CPROC_ENTRY_NUM) {
@@ -931,8 +1093,9 @@ static inline void sprd_cproc_fs_exit(struct cproc_device *cproc)
 	u8 i = 0;
 
 	for (i = 0; i < MAX_CPROC_ENTRY_NUM; i++) {
+		/* optional entries leave holes */
 		if (!cproc->procfs.entrys[i].name)
-			break;
+			continue;
 
 		if (cproc->procfs.entrys[i].flag != 0) {
 			remove_proc_entry(cproc->procfs.entrys[i].name,
@@ -1014,14 +1177,26 @@ static int sprd_cproc_native_arm_start(void *arg)
 	if (!pdata)
 		return -ENODEV;
 
+	if (cproc->cache)
+		mutex_lock(&cproc->cache_lock);
 #ifdef CONFIG_SPRD_SECBOOT
-	/* only cp need verify. */
-	if (strstr(pdata->devname, "cp") &&
+	/* only cp need verify, a reload from the cache was verified */
+	if (!cproc->cache_loaded && strstr(pdata->devname, "cp") &&
 	    sprd_image_verify(&pdata->load_table)) {
 		pr_err("cproc: %s verify err!\n", pdata->devname);
+		if (cproc->cache)
+			mutex_unlock(&cproc->cache_lock);
 		return -EACCES;
 	}
 #endif
+	if (cproc->cache) {
+		cproc_cache_save(cproc);
+		/* cp is about to run and write its memory */
+		cproc->cache_loaded = false;
+		memset(cproc->ld_size, 0,
+		       pdata->segnr * sizeof(*cproc->ld_size));
+		mutex_unlock(&cproc->cache_lock);
+	}
 
 	ctrl = pdata->ctrl;
 
@@ -1774,6 +1949,22 @@ static int sprd_cproc_probe(struct platform_device *pdev)
 				 pdata->maxsz);
 
 			cproc->initdata = pdata;
+			mutex_init(&cproc->cache_lock);
+			if (of_property_read_bool(chd, "sprd,image-cache") &&
+			    pdata->segnr) {
+				cproc->cache = kcalloc(pdata->segnr,
+						       sizeof(*cproc->cache),
+						       GFP_KERNEL);
+				cproc->ld_size = kcalloc(pdata->segnr,
+						sizeof(*cproc->ld_size),
+						GFP_KERNEL);
+				if (!cproc->cache || !cproc->ld_size) {
+					kfree(cproc->cache);
+					kfree(cproc->ld_size);
+					cproc->cache = NULL;
+					cproc->ld_size = NULL;
+				}
+			}
 
 			cproc->miscdev.minor = MISC_DYNAMIC_MINOR;
 			cproc->miscdev.name = cproc->initdata->devname;
@@ -1838,6 +2029,9 @@ static int sprd_cproc_remove(struct platform_device *pdev)
 	sprd_cproc_fs_exit(cproc);
 	misc_deregister(&cproc->miscdev);
 	pr_debug("%s: %s!\n", __func__, cproc->initdata->devname);
+	cproc_cache_free(cproc);
+	kfree(cproc->cache);
+	kfree(cproc->ld_size);
 	sprd_cproc_destroy_pdata(&cproc->initdata);
 
 	kfree(cproc);
@@ -1852,6 +2046,7 @@ static struct platform_driver sprd_cproc_driver = {
 		.owner = THIS_MODULE,
 		.name = "sprd_cproc",
 		.of_match_table = sprd_cproc_match_table,
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 };
 
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2020, Spreadtrum Communications.
+ *
+ * The above copyright notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * Queued ahash digests, for users that hash many buffers and want them
+ * in flight at once instead of one sha256_csum_wd after the other.
+ *
+ */
+
+#ifndef SPRD_AHASH_H
+#define SPRD_AHASH_H
+
+/*
+ * Called once per accepted request, the digest has already been written
+ * unless err is set. May run in softirq context, must not sleep and must
+ * not submit.
+ */
+typedef void (*sprd_ahash_done_t)(void *data, int err);
+
+struct sprd_ahash_queue;
+
+/*
+ * depth requests may be in flight, 1 to BITS_PER_LONG. algo is an ahash
+ * name like "sha256", async drivers are accepted.
+ */
+struct sprd_ahash_queue *sprd_ahash_queue_create(const char *algo,
+		unsigned int depth);
+void sprd_ahash_queue_destroy(struct sprd_ahash_queue *q);
+
+unsigned int sprd_ahash_digestsize(struct sprd_ahash_queue *q);
+
+/*
+ * Digest len bytes of buf into digest. Sleeps while depth requests are in
+ * flight. buf must be lowmem or vmalloc memory and stay untouched until
+ * done runs. Returns 0 when the request was accepted, done then reports
+ * its result, the request may even be done before the return.
+ */
+int sprd_ahash_submit(struct sprd_ahash_queue *q, const void *buf,
+		unsigned int len, unsigned char *digest,
+		sprd_ahash_done_t done, void *data);
+
+/* wait until every accepted request has run its done */
+void sprd_ahash_queue_flush(struct sprd_ahash_queue *q);
+
+#endif /* SPRD_AHASH_H */
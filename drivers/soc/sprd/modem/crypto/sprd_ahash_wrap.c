@@ -12,7 +12,8 @@
  * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  *
- * To implement sha256_csum_wd function by calling ahash API in kernel crypto.
+ * To implement sha256_csum_wd function by calling ahash API in kernel crypto,
+ * and the queued ahash digests of sprd_ahash.h.
  *
  */
 
@@ -25,6 +26,12 @@
 #include <linux/string.h>
 #include <linux/moduleparam.h>
 #include <linux/interrupt.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/vmalloc.h>
+#include <linux/wait.h>
+#include "sprd_ahash.h"
 
 /*
  * Need slab memory for testing (size in number of pages).
@@ -187,6 +194,235 @@ void sha256_csum_wd(const unsigned char *input, unsigned int ilen,
 			output,  &digest_size);
 }
 
+struct sprd_ahash_slot {
+	struct sprd_ahash_queue *q;
+	struct ahash_request *req;
+	struct sg_table sgt;
+	unsigned char result[MAX_DIGEST_SIZE];
+	unsigned char *digest;
+	sprd_ahash_done_t done;
+	void *data;
+};
+
+struct sprd_ahash_queue {
+	struct crypto_ahash *tfm;
+	unsigned int depth;
+	/* bit n set: slot n is idle */
+	unsigned long idle;
+	spinlock_t lock;
+	wait_queue_head_t wait;
+	struct sprd_ahash_slot slot[0];
+};
+
+static unsigned long sprd_ahash_all_idle(struct sprd_ahash_queue *q)
+{
+	return q->depth == BITS_PER_LONG ? ~0UL : (1UL << q->depth) - 1;
+}
+
+static int sprd_ahash_slot_get(struct sprd_ahash_queue *q)
+{
+	unsigned long flags;
+	int i = -1;
+
+	spin_lock_irqsave(&q->lock, flags);
+	if (q->idle) {
+		i = __ffs(q->idle);
+		__clear_bit(i, &q->idle);
+	}
+	spin_unlock_irqrestore(&q->lock, flags);
+
+	return i;
+}
+
+static void sprd_ahash_slot_put(struct sprd_ahash_slot *s)
+{
+	struct sprd_ahash_queue *q = s->q;
+	unsigned long flags;
+
+	spin_lock_irqsave(&q->lock, flags);
+	__set_bit(s - q->slot, &q->idle);
+	spin_unlock_irqrestore(&q->lock, flags);
+	wake_up(&q->wait);
+}
+
+static bool sprd_ahash_is_idle(struct sprd_ahash_queue *q)
+{
+	unsigned long flags;
+	bool idle;
+
+	spin_lock_irqsave(&q->lock, flags);
+	idle = q->idle == sprd_ahash_all_idle(q);
+	spin_unlock_irqrestore(&q->lock, flags);
+
+	return idle;
+}
+
+/* map buf without a copy, unlike crypto_hash_sg_init() */
+static int sprd_ahash_sg_map(struct sg_table *sgt, const void *buf,
+		unsigned int len)
+{
+	struct scatterlist *sg;
+	unsigned int chunk, off;
+	int ret, i, nents;
+
+	if (!is_vmalloc_addr(buf)) {
+		if (!virt_addr_valid(buf) || !virt_addr_valid(buf + len - 1))
+			return -EINVAL;
+
+		ret = sg_alloc_table(sgt, 1, GFP_KERNEL);
+		if (ret)
+			return ret;
+		sg_set_buf(sgt->sgl, buf, len);
+		return 0;
+	}
+
+	nents = DIV_ROUND_UP(offset_in_page(buf) + len, PAGE_SIZE);
+	ret = sg_alloc_table(sgt, nents, GFP_KERNEL);
+	if (ret)
+		return ret;
+
+	for_each_sg(sgt->sgl, sg, nents, i) {
+		off = offset_in_page(buf);
+		chunk = min_t(unsigned int, len, PAGE_SIZE - off);
+		sg_set_page(sg, vmalloc_to_page(buf), chunk, off);
+		buf += chunk;
+		len -= chunk;
+	}
+
+	return 0;
+}
+
+static void sprd_ahash_finish(struct sprd_ahash_slot *s, int err)
+{
+	struct sprd_ahash_queue *q = s->q;
+
+	if (!err && s->digest)
+		memcpy(s->digest, s->result, crypto_ahash_digestsize(q->tfm));
+	sg_free_table(&s->sgt);
+
+	if (s->done)
+		s->done(s->data, err);
+	sprd_ahash_slot_put(s);
+}
+
+static void sprd_ahash_complete(struct crypto_async_request *req, int err)
+{
+	/* a backlogged request started, the result follows */
+	if (err == -EINPROGRESS)
+		return;
+
+	sprd_ahash_finish(req->data, err);
+}
+
+unsigned int sprd_ahash_digestsize(struct sprd_ahash_queue *q)
+{
+	return crypto_ahash_digestsize(q->tfm);
+}
+
+int sprd_ahash_submit(struct sprd_ahash_queue *q, const void *buf,
+		unsigned int len, unsigned char *digest,
+		sprd_ahash_done_t done, void *data)
+{
+	struct sprd_ahash_slot *s;
+	int i, ret;
+
+	if (!q || !buf || !len)
+		return -EINVAL;
+
+	wait_event(q->wait, (i = sprd_ahash_slot_get(q)) >= 0);
+	s = &q->slot[i];
+
+	ret = sprd_ahash_sg_map(&s->sgt, buf, len);
+	if (ret) {
+		sprd_ahash_slot_put(s);
+		return ret;
+	}
+
+	s->digest = digest;
+	s->done = done;
+	s->data = data;
+	ahash_request_set_callback(s->req, CRYPTO_TFM_REQ_MAY_BACKLOG,
+				   sprd_ahash_complete, s);
+	ahash_request_set_crypt(s->req, s->sgt.sgl, s->result, len);
+
+	ret = crypto_ahash_digest(s->req);
+	if (ret != -EINPROGRESS && ret != -EBUSY)
+		sprd_ahash_finish(s, ret);
+
+	return 0;
+}
+
+void sprd_ahash_queue_flush(struct sprd_ahash_queue *q)
+{
+	wait_event(q->wait, sprd_ahash_is_idle(q));
+}
+
+struct sprd_ahash_queue *sprd_ahash_queue_create(const char *algo,
+		unsigned int depth)
+{
+	struct sprd_ahash_queue *q;
+	struct crypto_ahash *tfm;
+	unsigned int i;
+	int err = -ENOMEM;
+
+	if (!algo || !depth || depth > BITS_PER_LONG)
+		return ERR_PTR(-EINVAL);
+
+	q = kzalloc(sizeof(*q) + depth * sizeof(q->slot[0]), GFP_KERNEL);
+	if (!q)
+		return ERR_PTR(-ENOMEM);
+
+	/* unlike sprd_crypt_hash() the async drivers are welcome here */
+	tfm = crypto_alloc_ahash(algo, 0, 0);
+	if (IS_ERR(tfm)) {
+		pr_err("failed to load transform for %s: %ld\n",
+		       algo, PTR_ERR(tfm));
+		kfree(q);
+		return ERR_CAST(tfm);
+	}
+	q->tfm = tfm;
+
+	if (crypto_ahash_digestsize(tfm) > MAX_DIGEST_SIZE) {
+		err = -EINVAL;
+		goto err_free;
+	}
+
+	for (i = 0; i < depth; i++) {
+		q->slot[i].q = q;
+		q->slot[i].req = ahash_request_alloc(tfm, GFP_KERNEL);
+		if (!q->slot[i].req)
+			goto err_free;
+	}
+
+	q->depth = depth;
+	q->idle = sprd_ahash_all_idle(q);
+	spin_lock_init(&q->lock);
+	init_waitqueue_head(&q->wait);
+
+	return q;
+
+err_free:
+	for (i = 0; i < depth; i++)
+		ahash_request_free(q->slot[i].req);
+	crypto_free_ahash(tfm);
+	kfree(q);
+	return ERR_PTR(err);
+}
+
+void sprd_ahash_queue_destroy(struct sprd_ahash_queue *q)
+{
+	unsigned int i;
+
+	if (IS_ERR_OR_NULL(q))
+		return;
+
+	sprd_ahash_queue_flush(q);
+	for (i = 0; i < q->depth; i++)
+		ahash_request_free(q->slot[i].req);
+	crypto_free_ahash(q->tfm);
+	kfree(q);
+}
+
 static int __init crypt_hash_mod_init(void)
 {
 	int err = 0;
@@ -24,6 +24,13 @@
 #include <linux/ktime.h>
 #include <linux/timekeeping.h>
 #include <linux/slab.h>
+#include <linux/err.h>
+#include <linux/math64.h>
+#include <linux/sizes.h>
+#include <linux/vmalloc.h>
+#include <linux/atomic.h>
+#include <crypto/hash.h>
+#include "sprd_ahash.h"
 
 sprd_crypto_err_t sprd_sha256_test(void)
 {
@@ -1468,6 +1475,212 @@ sprd_crypto_err_t sprd_rsa_enc_speed_test(void)
 	return SPRD_CRYPTO_SUCCESS;
 }
 
+/*
+ * Throughput over the buffer sizes secureboot and dm-verity hash, each
+ * case is repeated for at least BENCH_NS so small sizes are not just
+ * ktime_get() noise.
+ */
+#define BENCH_NS		(100 * NSEC_PER_MSEC)
+#define BENCH_MAX_LEN		SZ_1M
+
+static const unsigned int bench_len[] = {
+	64, 512, SZ_4K, SZ_64K, SZ_1M,
+};
+
+/* the generic C code, the arm64 NEON asm and the ARMv8 CE instructions */
+static const char * const bench_shash[] = {
+	"sha256-generic", "sha256-arm64", "sha256-ce",
+};
+
+static void bench_report(const char *name, unsigned int len, u64 loops,
+		u64 ns)
+{
+	u64 kbps = div64_u64((u64)len * loops * (NSEC_PER_SEC >> 10),
+			     max_t(u64, ns, 1));
+
+	pr_err("bench %-16s %8u B: %llu.%02llu MB/s, %llu ns/op\n",
+	       name, len, kbps >> 10, ((kbps & 1023) * 100) >> 10,
+	       div64_u64(ns, max_t(u64, loops, 1)));
+}
+
+static void sprd_sha256_bench_shash(const char *name, const u8 *buf)
+{
+	struct crypto_shash *tfm;
+	u8 out[SHA256_DIGEST_SIZE];
+	u64 t0, ns, loops;
+	int i, err = 0;
+
+	tfm = crypto_alloc_shash(name, 0, 0);
+	if (IS_ERR(tfm)) {
+		pr_err("bench %s not available: %ld\n", name, PTR_ERR(tfm));
+		return;
+	}
+
+	{
+		SHASH_DESC_ON_STACK(desc, tfm);
+
+		desc->tfm = tfm;
+		desc->flags = 0;
+		for (i = 0; i < ARRAY_SIZE(bench_len) && !err; i++) {
+			loops = 0;
+			t0 = ktime_get_ns();
+			do {
+				err = crypto_shash_digest(desc, buf,
+							  bench_len[i], out);
+				loops++;
+				ns = ktime_get_ns() - t0;
+			} while (!err && ns < BENCH_NS);
+			if (!err)
+				bench_report(name, bench_len[i], loops, ns);
+			cond_resched();
+		}
+	}
+
+	if (err)
+		pr_err("bench %s failed: %d\n", name, err);
+	crypto_free_shash(tfm);
+}
+
+/* what sprd_crypto verifies the modem image with, ahash or the sw code */
+static void sprd_sha256_bench_csum(const u8 *buf)
+{
+	u8 out[SHA256_DIGEST_SIZE];
+	u64 t0, ns, loops;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(bench_len); i++) {
+		loops = 0;
+		t0 = ktime_get_ns();
+		do {
+			sha256_csum_wd(buf, bench_len[i], out, 0);
+			loops++;
+			ns = ktime_get_ns() - t0;
+		} while (ns < BENCH_NS);
+		bench_report("sha256_csum_wd", bench_len[i], loops, ns);
+		cond_resched();
+	}
+}
+
+#if IS_ENABLED(CONFIG_SPRD_CRYPTO_HASH_AHASH)
+struct bench_async {
+	atomic_t err;
+};
+
+static void bench_async_done(void *data, int err)
+{
+	struct bench_async *ba = data;
+
+	if (err)
+		atomic_cmpxchg(&ba->err, 0, err);
+}
+
+/*
+ * The data is split into len sized pieces that are all queued, the way
+ * dm-verity hashes its blocks. depth 1 is the sha256_csum_wd behaviour.
+ */
+static void sprd_sha256_bench_async(const u8 *buf, unsigned int depth)
+{
+	static u8 out[BITS_PER_LONG][SHA256_DIGEST_SIZE];
+	struct sprd_ahash_queue *q;
+	struct bench_async ba;
+	unsigned int off, n;
+	u64 t0, ns, loops;
+	char name[16];
+	int i, err = 0;
+
+	q = sprd_ahash_queue_create("sha256", depth);
+	if (IS_ERR(q)) {
+		pr_err("bench ahash queue failed: %ld\n", PTR_ERR(q));
+		return;
+	}
+
+	snprintf(name, sizeof(name), "ahash-q%u", depth);
+	for (i = 0; i < ARRAY_SIZE(bench_len) && !err; i++) {
+		atomic_set(&ba.err, 0);
+		loops = 0;
+		n = 0;
+		t0 = ktime_get_ns();
+		do {
+			for (off = 0; off < BENCH_MAX_LEN && !err;
+			     off += bench_len[i], n++) {
+				err = sprd_ahash_submit(q, buf + off,
+						bench_len[i],
+						out[n % depth],
+						bench_async_done, &ba);
+				loops++;
+			}
+			sprd_ahash_queue_flush(q);
+			ns = ktime_get_ns() - t0;
+		} while (!err && ns < BENCH_NS);
+		if (!err)
+			err = atomic_read(&ba.err);
+		if (!err)
+			bench_report(name, bench_len[i], loops, ns);
+		cond_resched();
+	}
+
+	if (err)
+		pr_err("bench %s failed: %d\n", name, err);
+	sprd_ahash_queue_destroy(q);
+}
+#endif
+
+/* secureboot verifies with the public key, so that is the one to time */
+static void sprd_rsa_bench_verify(void)
+{
+	unsigned char in[512];
+	u64 t0, ns, loops;
+	int i, res;
+
+	for (i = 0; i < ARRAY_SIZE(tests); i++) {
+		loops = 0;
+		t0 = ktime_get_ns();
+		do {
+			res = rsa_dec_public_key_without_padding(tests[i].key_e,
+					tests[i].key_n, tests[i].data_len << 3,
+					tests[i].dout, in);
+			loops++;
+			ns = ktime_get_ns() - t0;
+		} while (ns < BENCH_NS);
+		cond_resched();
+
+		if (memcmp(in, tests[i].din, tests[i].data_len) != 0) {
+			pr_err("bench rsa-%u verify mismatch\n",
+			       tests[i].data_len << 3);
+			continue;
+		}
+		pr_err("bench rsa-%u verify: %llu ops/s, %llu us/op\n",
+		       tests[i].data_len << 3,
+		       div64_u64(loops * NSEC_PER_SEC, max_t(u64, ns, 1)),
+		       div64_u64(ns, loops * NSEC_PER_USEC));
+	}
+}
+
+static void sprd_crypto_bench(void)
+{
+	u8 *buf;
+	int i;
+
+	buf = vmalloc(BENCH_MAX_LEN);
+	if (!buf) {
+		pr_err("bench no memory\n");
+		return;
+	}
+	for (i = 0; i < BENCH_MAX_LEN; i++)
+		buf[i] = i * 7 + (i >> 8);
+
+	for (i = 0; i < ARRAY_SIZE(bench_shash); i++)
+		sprd_sha256_bench_shash(bench_shash[i], buf);
+	sprd_sha256_bench_csum(buf);
+#if IS_ENABLED(CONFIG_SPRD_CRYPTO_HASH_AHASH)
+	sprd_sha256_bench_async(buf, 1);
+	sprd_sha256_bench_async(buf, 8);
+#endif
+	vfree(buf);
+
+	sprd_rsa_bench_verify();
+}
+
 int sprd_crypto_speed_test(void)
 {
 	sprd_crypto_err_t err = 0;
@@ -1500,6 +1713,8 @@ int sprd_crypto_speed_test(void)
 	}
 	pr_err("SPRD RSA enc is OK\n");
 
+	sprd_crypto_bench();
+
 	return err;
 
 failed:
@@ -19,9 +19,19 @@
 #include <linux/platform_device.h>
 #include <linux/sipc.h>
 #include <linux/slab.h>
+#include <linux/sprd_cp_dvfs.h>
+#include <linux/workqueue.h>
 #include "sprd_cp_dvfs.h"
 
 static bool sbuf_created;
+
+static unsigned int boost_kbps = 20000;
+module_param(boost_kbps, uint, 0644);
+MODULE_PARM_DESC(boost_kbps, "AP traffic which raises the CP idle index");
+
+static atomic_long_t cp_dvfs_hint_bytes = ATOMIC_LONG_INIT(0);
+static struct cpdvfs_data *cp_dvfs_hint_devs[DVFS_CORE_MAX];
+
 static int cp_dvfs_send_data(struct cpdvfs_data *cpdvfs, u8 *buf, u32 len)
 {
 	int nwrite, dbg_i;
@@ -240,6 +250,83 @@ static void cp_dvfs_recv_recorder(struct cpdvfs_data *cpdvfs)
 }
 
 /* attributes functions begin */
+void sprd_cp_dvfs_load_hint(unsigned int bytes)
+{
+	struct cpdvfs_data *cpdvfs;
+	int i;
+
+	atomic_long_add(bytes, &cp_dvfs_hint_bytes);
+
+	/* a boosted core samples by itself, only an idle one needs a kick */
+	for (i = 0; i < DVFS_CORE_MAX; i++) {
+		cpdvfs = READ_ONCE(cp_dvfs_hint_devs[i]);
+		if (cpdvfs && !READ_ONCE(cpdvfs->boosted) &&
+		    !delayed_work_pending(&cpdvfs->hint_work))
+			schedule_delayed_work(&cpdvfs->hint_work,
+					      msecs_to_jiffies(CP_DVFS_HINT_MS));
+	}
+}
+EXPORT_SYMBOL(sprd_cp_dvfs_load_hint);
+
+/* called with cpdvfs->lock held */
+static void cp_dvfs_hint_boost(struct cpdvfs_data *cpdvfs)
+{
+	int idle_index;
+
+	if (cp_dvfs_send_cmd_nopara(cpdvfs, DVFS_GET_IDLE_INDEX))
+		return;
+	idle_index = cp_dvfs_recv_cmd_onepara(cpdvfs, DVFS_GET_IDLE_INDEX);
+	if (idle_index < 0 || idle_index >= cpdvfs->boost_index)
+		return;
+
+	if (cp_dvfs_send_cmd_onepara(cpdvfs, DVFS_SET_IDLE_INDEX,
+				     cpdvfs->boost_index))
+		return;
+
+	cpdvfs->base_idle_index = idle_index;
+	cpdvfs->calm_periods = 0;
+	WRITE_ONCE(cpdvfs->boosted, true);
+	dev_dbg(cpdvfs->dev, "boost idle index %d -> %d\n",
+		idle_index, cpdvfs->boost_index);
+}
+
+static void cp_dvfs_hint_work(struct work_struct *work)
+{
+	struct cpdvfs_data *cpdvfs = container_of(to_delayed_work(work),
+					struct cpdvfs_data, hint_work);
+	unsigned long bytes = atomic_long_read(&cp_dvfs_hint_bytes);
+	unsigned long now = jiffies;
+	unsigned int ms;
+	u64 kbps;
+
+	ms = jiffies_to_msecs(now - cpdvfs->hint_jiffies);
+	/* bits per ms are kbit per s */
+	kbps = div_u64((u64)(bytes - cpdvfs->hint_bytes) * 8, ms ? ms : 1);
+	cpdvfs->hint_bytes = bytes;
+	cpdvfs->hint_jiffies = now;
+
+	mutex_lock(&cpdvfs->lock);
+	if (kbps >= boost_kbps) {
+		if (!cpdvfs->boosted)
+			cp_dvfs_hint_boost(cpdvfs);
+		cpdvfs->calm_periods = 0;
+	} else if (cpdvfs->boosted &&
+		   ++cpdvfs->calm_periods >= CP_DVFS_HINT_HOLD) {
+		if (cp_dvfs_send_cmd_onepara(cpdvfs, DVFS_SET_IDLE_INDEX,
+					     cpdvfs->base_idle_index))
+			dev_err(cpdvfs->dev, "send command fail\n");
+		WRITE_ONCE(cpdvfs->boosted, false);
+		dev_dbg(cpdvfs->dev, "relax idle index to %d\n",
+			cpdvfs->base_idle_index);
+	}
+	mutex_unlock(&cpdvfs->lock);
+
+	/* keep watching a boosted core, the hints stop when it goes idle */
+	if (cpdvfs->boosted)
+		schedule_delayed_work(&cpdvfs->hint_work,
+				      msecs_to_jiffies(CP_DVFS_HINT_MS));
+}
+
 static ssize_t name_show(struct device *dev,
 						struct device_attribute *attr, char *buf)
 {
@@ -347,6 +434,12 @@ static ssize_t idle_index_store(struct device *dev,
 		return -EINVAL;
 	}
 	mutex_lock(&cpdvfs->lock);
+	/* a boosted core takes it when the traffic is over */
+	if (cpdvfs->boosted) {
+		cpdvfs->base_idle_index = idle_index;
+		mutex_unlock(&cpdvfs->lock);
+		return count;
+	}
 	ret = cp_dvfs_send_cmd_onepara(cpdvfs, DVFS_SET_IDLE_INDEX, idle_index);
 
 	if (ret != 0)
@@ -508,6 +601,7 @@ static int
 cp_dvfs_get_of_pdata(struct device *dev, struct cpdvfs_data *pdata)
 {
 	struct device_node *np = dev->of_node;
+	u32 boost_index;
 	int err;
 
 	err = of_property_read_u32(np, "sprd,core_id", &pdata->core_id);
@@ -531,6 +625,13 @@ cp_dvfs_get_of_pdata(struct device *dev, struct cpdvfs_data *pdata)
 	if (pdata->record_num > RECORDS_MAX_NUM)
 		return -EINVAL;
 
+	/* optional, the idle index the core gets under AP traffic */
+	if (of_property_read_u32(np, "sprd,boost-idle-index", &boost_index) ||
+	    boost_index >= DVFS_INDEX_MAX || pdata->core_id >= DVFS_CORE_MAX)
+		pdata->boost_index = -1;
+	else
+		pdata->boost_index = boost_index;
+
 	return 0;
 }
 
@@ -589,12 +690,26 @@ static int cp_dvfs_probe(struct platform_device *pdev)
 		return err;
 	}
 
+	INIT_DELAYED_WORK(&data->hint_work, cp_dvfs_hint_work);
+	data->hint_bytes = atomic_long_read(&cp_dvfs_hint_bytes);
+	data->hint_jiffies = jiffies;
+	if (data->boost_index >= 0)
+		WRITE_ONCE(cp_dvfs_hint_devs[data->core_id], data);
+
 	return 0;
 }
 
 static int cp_dvfs_remove(struct platform_device *pdev)
 {
 	struct device *dev = &pdev->dev;
+	struct cpdvfs_data *cpdvfs = platform_get_drvdata(pdev);
+
+	if (cpdvfs->boost_index >= 0) {
+		WRITE_ONCE(cp_dvfs_hint_devs[cpdvfs->core_id], NULL);
+		/* the hints come from softirq, wait for the running ones */
+		synchronize_sched();
+		cancel_delayed_work_sync(&cpdvfs->hint_work);
+	}
 
 	sbuf_created = false;
 	sysfs_remove_groups(&dev->kobj, cpdvfs_groups);
@@ -13,6 +13,10 @@
 #define CMD_PARA_MAX_LEN  64
 #define RECORDS_MAX_NUM  20
 
+/* AP load hints: sample period, calm periods before the boost ends */
+#define CP_DVFS_HINT_MS  50
+#define CP_DVFS_HINT_HOLD  20
+
 enum dvfs_index {
 	DVFS_INDEX_MODE_LEAVE = -1,
 	DVFS_INDEX_0 = 0,
@@ -92,5 +96,14 @@ struct cpdvfs_data {
 	struct userspace_data *user_data;
 	struct cmd_pkt *sent_cmd;
 	u32 cmd_len;
+
+	/* AP load hints, boost_index < 0 when the core takes none */
+	struct delayed_work hint_work;
+	int boost_index;
+	u8 base_idle_index;
+	bool boosted;
+	u32 calm_periods;
+	unsigned long hint_bytes;
+	unsigned long hint_jiffies;
 };
 #endif
@@ -58,6 +58,15 @@
 
 #define IQ_TRANSFER_SIZE (500*1024)
 
+/*
+ * CP does not interrupt AP when a buffer is written, the flags are polled.
+ * While a capture runs the next buffer is due soon, poll fast then and
+ * only fall back to the slow poll after IQ_BUSY_POLLS empty rounds.
+ */
+#define IQ_POLL_BUSY_US		2000
+#define IQ_POLL_IDLE_MS		1500
+#define IQ_BUSY_POLLS		500
+
 #define SPRD_IQ_CLASS_NAME		"sprd_iq"
 #define IQ_TAG					"sprd_iq "
 
@@ -149,7 +158,7 @@ static ssize_t sprd_iq_write(u32 paddr, u32 length)
 	u32 send_num = 0;
 	ssize_t ret;
 
-	pr_info(IQ_TAG "sprd_iq_write 0x%x, 0x%x \n", paddr, length);
+	pr_debug(IQ_TAG "sprd_iq_write 0x%x, 0x%x \n", paddr, length);
 	while (length - send_num > 0) {
 		vaddr = NULL;
 
@@ -180,6 +189,7 @@ static int sprd_iq_thread(void *data)
 	struct sprd_iq_mgr *t_iq = (struct sprd_iq_mgr *)data;
 	struct iq_header_info *p_iq = t_iq->header_info;
 	struct sched_param param = {.sched_priority = 80};
+	uint busy = 0;
 
 	if (NULL == p_iq->head_1 || NULL == p_iq->head_2)
 		return -EPERM;
@@ -200,6 +210,7 @@ static int sprd_iq_thread(void *data)
 		}
 
 		if (p_iq->head_1->WR_RD_FLAG == IQ_BUF_WRITE_FINISHED) {
+			busy = IQ_BUSY_POLLS;
 			p_iq->head_1->WR_RD_FLAG = IQ_BUF_READING;
 			if (IQ_USB_MODE == iq.ch)
 				sprd_iq_write(p_iq->head_1->data_addr -
@@ -210,6 +221,7 @@ static int sprd_iq_thread(void *data)
 				wake_up_interruptible(&t_iq->wait);
 
 		} else if (p_iq->head_2->WR_RD_FLAG == IQ_BUF_WRITE_FINISHED) {
+			busy = IQ_BUSY_POLLS;
 			p_iq->head_2->WR_RD_FLAG = IQ_BUF_READING;
 			if (IQ_USB_MODE == iq.ch)
 				sprd_iq_write(p_iq->head_2->data_addr -
@@ -219,12 +231,19 @@ static int sprd_iq_thread(void *data)
 			else if (IQ_SLOG_MODE == iq.ch)
 				wake_up_interruptible(&t_iq->wait);
 
+		} else if (busy ||
+			   p_iq->head_1->WR_RD_FLAG == IQ_BUF_READING ||
+			   p_iq->head_2->WR_RD_FLAG == IQ_BUF_READING) {
+			/* CP fills the other buffer while one is sent */
+			if (busy)
+				busy--;
+			usleep_range(IQ_POLL_BUSY_US, IQ_POLL_BUSY_US * 2);
 		} else {
 			pr_info(IQ_TAG "ch: %d, hand1: 0x%x, flag2: 0x%x\n",
 				iq.ch,
 				p_iq->head_1->WR_RD_FLAG,
 				p_iq->head_2->WR_RD_FLAG);
-			msleep(1500);
+			msleep(IQ_POLL_IDLE_MS);
 		}
 	}
 	return 0;
@@ -238,7 +257,7 @@ static void sprd_iq_complete(char *buf,  int length)
 	if (IQ_USB_MODE != iq.ch)
 		return;
 	vaddr = buf;
-	pr_info(IQ_TAG "sprd_iq_complete 0x%p, 0x%x \n", vaddr, length);
+	pr_debug(IQ_TAG "sprd_iq_complete 0x%p, 0x%x \n", vaddr, length);
 	if (vaddr + length == (char *)__va(iq.header_info->head_1->data_addr -
 					   iq.mapping_offs +
 			iq.header_info->head_1->data_len))
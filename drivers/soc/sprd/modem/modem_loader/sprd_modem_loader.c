@@ -17,6 +17,7 @@
 #include <linux/dma-mapping.h>
 #include <linux/dma/sprd-dma.h>
 #include <linux/kernel.h>
+#include <linux/lz4.h>
 #include <linux/mdm_ctrl.h>
 #include <linux/mm.h>
 #include <linux/module.h>
@@ -33,6 +34,8 @@
 #include <linux/regmap.h>
 #include <linux/debugfs.h>
 #include <linux/gpio/consumer.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
 
 #ifdef CONFIG_SPRD_PCIE_EP_DEVICE
 #include <linux/soc/sprd/sprd_pcie_ep_device.h>
@@ -70,6 +73,7 @@
 #define MODEM_POWERON_EXT_MODEM_CMD _IO(MODEM_MAGIC, 0x10)
 #define MODEM_POWEROFF_EXT_MODEM_CMD _IO(MODEM_MAGIC, 0x11)
 #define MODEM_ENTER_SLEEP_CMD _IO(MODEM_MAGIC, 0x12)
+#define MODEM_SET_WRITE_COMP_CMD _IOW(MODEM_MAGIC, 0x13, int)
 
 #define	MODEM_READ_ALL_MEM 0xff
 #define	MODEM_READ_MODEM_MEM 0xfe
@@ -77,6 +81,7 @@
 
 #define SRPD_DMA_MAX_SIZE	(0x400000)
 #define SRPD_DMA_FAST_SIZE	(0x100000)
+#define MODEM_COMP_MAX_WRITE	(0x800000)
 
 enum {
 	SPRD_5G_MODEM_DP = 0,
@@ -390,54 +395,72 @@ static size_t modem_dma_alloc(struct dma_copy_data *dma_ptr, size_t dma_size)
 	return 0;
 }
 
-static size_t modem_dma_copy(struct dma_copy_data *dma_ptr,
-			  size_t dma_size,
-			  dma_addr_t src_buf,
-			  dma_addr_t dst_buf)
+static dma_cookie_t modem_dma_submit(struct dma_copy_data *dma_ptr,
+				     size_t dma_size,
+				     dma_addr_t src_buf,
+				     dma_addr_t dst_buf)
 {
-	enum dma_status dma_s = DMA_ERROR;
-	struct dma_tx_state dma_tx_s;
 	struct dma_async_tx_descriptor *tx;
 	dma_cookie_t cookie;
-	dma_cap_mask_t mask;
 
 	dev_dbg(dma_ptr->p_dev, "%s dma copy! src_buf = 0x%lx, dst_buf = 0x%lx!\n",
 		dma_ptr->dma_name,
 		(unsigned long)src_buf,
 		(unsigned long)dst_buf);
 
-	dma_cap_zero(mask);
-	dma_cap_set(DMA_MEMCPY, mask);
-
 	tx = dmaengine_prep_dma_memcpy(dma_ptr->dma_chn, dst_buf,
 				       src_buf, dma_size, 0);
 	if (!tx) {
 		dev_err(dma_ptr->p_dev, "%s dma get descriptor failed!\n",
 			dma_ptr->dma_name);
-		return 0;
+		return -ENOMEM;
 	}
 
 	dev_dbg(dma_ptr->p_dev, "%s dma copy submit!\n", dma_ptr->dma_name);
 
+	reinit_completion(&dma_ptr->dma_comp);
 	tx->callback = modem_dma_copy_complete;
 	tx->callback_param = dma_ptr;
 	cookie = dmaengine_submit(tx);
 	if (dma_submit_error(cookie)) {
 		dev_err(dma_ptr->p_dev, "%s submit failed!\n",
 			dma_ptr->dma_name);
-		return 0;
+		return cookie;
 	}
 
 	dma_async_issue_pending(dma_ptr->dma_chn);
+	return cookie;
+}
+
+static bool modem_dma_wait(struct dma_copy_data *dma_ptr, dma_cookie_t cookie)
+{
+	enum dma_status dma_s;
+	struct dma_tx_state dma_tx_s;
+
 	wait_for_completion_timeout(&dma_ptr->dma_comp, msecs_to_jiffies(3000));
 	dma_s = dmaengine_tx_status(dma_ptr->dma_chn, cookie, &dma_tx_s);
 	if (dma_s != DMA_COMPLETE) {
 		dev_info(dma_ptr->p_dev, "%s dma transfer timeout dma_s = %d\n",
 			 dma_ptr->dma_name,
 			 dma_s);
-		return 0;
+		dmaengine_terminate_sync(dma_ptr->dma_chn);
+		return false;
 	}
 
+	return true;
+}
+
+static size_t modem_dma_copy(struct dma_copy_data *dma_ptr,
+			  size_t dma_size,
+			  dma_addr_t src_buf,
+			  dma_addr_t dst_buf)
+{
+	dma_cookie_t cookie;
+
+	cookie = modem_dma_submit(dma_ptr, dma_size, src_buf, dst_buf);
+	if (cookie < 0 || !modem_dma_wait(dma_ptr, cookie))
+		return 0;
+
 	dev_dbg(dma_ptr->p_dev, "%s dma copy done! size = 0x%lx!\n",
 		dma_ptr->dma_name,
 		(unsigned long)dma_size);
@@ -568,6 +591,242 @@ static ssize_t modem_read(struct file *filp,
 	return count - r;
 }
 
+/* copy a bounce buffer with the cpu, when its dma transfer failed */
+static int modem_cpu_copy(struct modem_device *modem, phys_addr_t addr,
+			  const void *src, size_t len)
+{
+	size_t map_size, copy_size;
+	void *vmem;
+
+	while (len > 0) {
+		vmem = modem_map_memory(modem, addr, len, &map_size);
+		if (!vmem)
+			return -ENOMEM;
+
+		copy_size = min_t(size_t, len, map_size);
+		unalign_memcpy(vmem, src, copy_size);
+		modem_ram_unmap(modem->modem_type, vmem);
+		addr += copy_size;
+		src += copy_size;
+		len -= copy_size;
+	}
+
+	return 0;
+}
+
+/*
+ * Write a soc modem region through two dma bounce buffers, so that the
+ * copy of the next chunk from user space overlaps the dma transfer of the
+ * previous one into CP memory. The modem memory is only mapped if a
+ * transfer has to be redone by the cpu. Returns -ENOMEM if the bounce
+ * buffers cannot be allocated, the caller then takes the one buffer path.
+ */
+static ssize_t modem_write_pipelined(struct modem_device *modem,
+				     const char __user *buf,
+				     phys_addr_t addr, size_t count)
+{
+	struct dma_copy_data *dma_ptr = modem->write_dma;
+	size_t chunk, len, done = 0, prev_len = 0;
+	dma_addr_t buf_p[2];
+	void *buf_v[2];
+	dma_cookie_t cookie = -EINVAL;
+	int i = 0, ret;
+	ssize_t err = 0;
+
+	chunk = min_t(size_t, PAGE_ALIGN(count), SRPD_DMA_FAST_SIZE);
+	buf_v[0] = dma_alloc_coherent(dma_ptr->p_dev, chunk, &buf_p[0],
+				      GFP_KERNEL);
+	buf_v[1] = dma_alloc_coherent(dma_ptr->p_dev, chunk, &buf_p[1],
+				      GFP_KERNEL);
+	if (!buf_v[0] || !buf_v[1]) {
+		err = -ENOMEM;
+		goto free_buf;
+	}
+
+	ret = modem_request_pms(modem, modem->wt_pms);
+	if (ret) {
+		err = ret;
+		goto free_buf;
+	}
+
+	while (done < count) {
+		len = min_t(size_t, chunk, count - done);
+		if (unalign_copy_from_user(buf_v[i], buf + done, len)) {
+			dev_err(modem->p_dev,
+				"write, copy data from user err!\n");
+			err = -EFAULT;
+			break;
+		}
+
+		/* the other buffer is still intact if the cpu has to redo it */
+		if (prev_len && (cookie < 0 || !modem_dma_wait(dma_ptr, cookie))) {
+			dev_err(modem->p_dev,
+				"write, dma copy failed, copy with cpu!\n");
+			ret = modem_cpu_copy(modem, addr + done - prev_len,
+					     buf_v[!i], prev_len);
+			if (ret) {
+				err = ret;
+				prev_len = 0;
+				break;
+			}
+		}
+
+		cookie = modem_dma_submit(dma_ptr, len, buf_p[i], addr + done);
+		prev_len = len;
+		done += len;
+		i = !i;
+	}
+
+	if (prev_len && (cookie < 0 || !modem_dma_wait(dma_ptr, cookie))) {
+		dev_err(modem->p_dev, "write, dma copy failed, copy with cpu!\n");
+		ret = modem_cpu_copy(modem, addr + done - prev_len,
+				     buf_v[!i], prev_len);
+		if (ret && !err)
+			err = ret;
+	}
+
+	sprd_pms_release_resource(modem->wt_pms);
+free_buf:
+	if (buf_v[1])
+		dma_free_coherent(dma_ptr->p_dev, chunk, buf_v[1], buf_p[1]);
+	if (buf_v[0])
+		dma_free_coherent(dma_ptr->p_dev, chunk, buf_v[0], buf_p[0]);
+
+	return err ? err : count;
+}
+
+#ifdef CONFIG_SPRD_MODEM_LOADER_LZ4
+struct modem_comp_work {
+	struct work_struct	work;
+	struct modem_device	*modem;
+	const char	*src;
+	u32	comp_len;
+	u32	raw_len;
+	phys_addr_t	dst;
+	int	ret;
+};
+
+static void modem_comp_work_fn(struct work_struct *work)
+{
+	struct modem_comp_work *cw = container_of(work, struct modem_comp_work,
+						  work);
+	char *out;
+	int len;
+
+	/* modem memory is mapped as device memory, lz4 can't write there */
+	out = vmalloc(cw->raw_len);
+	if (!out) {
+		cw->ret = -ENOMEM;
+		return;
+	}
+
+	len = LZ4_decompress_safe(cw->src, out, cw->comp_len, cw->raw_len);
+	if (len != cw->raw_len) {
+		dev_err(cw->modem->p_dev,
+			"write, bad lz4 block at 0x%llx, ret = %d!\n",
+			(u64)cw->dst, len);
+		cw->ret = -EINVAL;
+	} else {
+		cw->ret = modem_cpu_copy(cw->modem, cw->dst, out, cw->raw_len);
+	}
+	vfree(out);
+}
+
+/*
+ * The blocks are independent, so a batch of them is decompressed at once,
+ * one per online cpu, each straight to its place in the region.
+ */
+static ssize_t modem_write_compressed(struct modem_device *modem,
+				      const char __user *buf, size_t count,
+				      phys_addr_t base, size_t size,
+				      loff_t *ppos)
+{
+	struct modem_comp_block_hdr hdr;
+	struct modem_comp_work *cw;
+	size_t pos = 0, raw = 0;
+	int i, n = 0, first, batch;
+	ssize_t ret;
+	char *kbuf;
+
+	/* whatever is left over is taken by the next write */
+	count = min_t(size_t, count, MODEM_COMP_MAX_WRITE);
+	kbuf = vmalloc(count);
+	if (!kbuf)
+		return -ENOMEM;
+
+	if (copy_from_user(kbuf, buf, count)) {
+		ret = -EFAULT;
+		goto free_kbuf;
+	}
+
+	/* the largest possible number of blocks in this write */
+	cw = kcalloc(count / (sizeof(hdr) + 1) + 1, sizeof(*cw), GFP_KERNEL);
+	if (!cw) {
+		ret = -ENOMEM;
+		goto free_kbuf;
+	}
+
+	while (pos + sizeof(hdr) <= count) {
+		memcpy(&hdr, kbuf + pos, sizeof(hdr));
+		if (pos + sizeof(hdr) + le32_to_cpu(hdr.comp_len) > count)
+			break;
+
+		if (!hdr.comp_len || !hdr.raw_len ||
+		    le32_to_cpu(hdr.raw_len) > MODEM_COMP_MAX_BLOCK ||
+		    *ppos + raw + le32_to_cpu(hdr.raw_len) > size) {
+			dev_err(modem->p_dev, "write, bad block header!\n");
+			ret = -EINVAL;
+			goto free_cw;
+		}
+
+		INIT_WORK(&cw[n].work, modem_comp_work_fn);
+		cw[n].modem = modem;
+		cw[n].src = kbuf + pos + sizeof(hdr);
+		cw[n].comp_len = le32_to_cpu(hdr.comp_len);
+		cw[n].raw_len = le32_to_cpu(hdr.raw_len);
+		cw[n].dst = base + *ppos + raw;
+		raw += cw[n].raw_len;
+		pos += sizeof(hdr) + cw[n].comp_len;
+		n++;
+	}
+
+	if (!n) {
+		dev_err(modem->p_dev, "write, no complete block!\n");
+		ret = -EINVAL;
+		goto free_cw;
+	}
+
+	ret = modem_request_pms(modem, modem->wt_pms);
+	if (ret)
+		goto free_cw;
+
+	batch = num_online_cpus();
+	for (first = 0; first < n; first += batch) {
+		for (i = first; i < n && i < first + batch; i++)
+			queue_work(system_unbound_wq, &cw[i].work);
+		for (i = first; i < n && i < first + batch; i++)
+			flush_work(&cw[i].work);
+	}
+	sprd_pms_release_resource(modem->wt_pms);
+
+	for (i = 0; i < n; i++) {
+		if (cw[i].ret) {
+			ret = cw[i].ret;
+			goto free_cw;
+		}
+	}
+
+	*ppos += raw;
+	ret = pos;
+free_cw:
+	kfree(cw);
+free_kbuf:
+	vfree(kbuf);
+
+	return ret;
+}
+#endif
+
 static ssize_t modem_write(struct file *filp,
 			   const char __user *buf,
 			   size_t count, loff_t *ppos)
@@ -596,6 +855,12 @@ static ssize_t modem_write(struct file *filp,
 	if (size <= offset)
 		return -EINVAL;
 
+#ifdef CONFIG_SPRD_MODEM_LOADER_LZ4
+	if (modem->write_comp == MODEM_COMP_LZ4)
+		return modem_write_compressed(modem, buf, count,
+					      base, size, ppos);
+#endif
+
 	if (dma_ptr) {
 		dma_ptr->dma_chn = dma_request_slave_channel(dma_ptr->p_dev,
 							     dma_ptr->dma_name);
@@ -606,6 +871,22 @@ static ssize_t modem_write(struct file *filp,
 
 	count = min_t(size_t, size - offset, count);
 	r = count;
+
+	if (dma_ptr && !IS_ERR_OR_NULL(dma_ptr->dma_chn) &&
+	    modem->modem_type == SOC_MODEM) {
+		ssize_t written;
+
+		written = modem_write_pipelined(modem, buf, base + offset,
+						count);
+		if (written != -ENOMEM) {
+			dma_release_channel(dma_ptr->dma_chn);
+			dma_ptr->dma_chn = NULL;
+			if (written > 0)
+				*ppos += written;
+			return written;
+		}
+	}
+
 	do {
 		addr = base + offset + (count - r);
 		ret = modem_request_pms(modem, modem->wt_pms);
@@ -654,7 +935,7 @@ static ssize_t modem_write(struct file *filp,
 			if (dma_size != copy_size) {
 				dev_err(modem->p_dev,
 					"write, dma copy failed, copy with cpu!\n");
-				memcpy(dma_ptr->buf_v, vmem, copy_size);
+				unalign_memcpy(vmem, dma_ptr->buf_v, copy_size);
 			}
 		}
 		modem_dma_free_mem(dma_ptr);
@@ -749,6 +1030,10 @@ static int modem_cmd_unlock(struct modem_device *modem, int b_rx)
 	/* release resource */
 	sprd_pms_release_resource(pms);
 
+	/* the next writer starts with plain regions */
+	if (!b_rx)
+		modem->write_comp = MODEM_COMP_NONE;
+
 	/* unlock, set name[0] to 0 */
 	name[0] = 0;
 	mutex_unlock(mut);
@@ -964,6 +1249,23 @@ static long modem_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		modem->write_region = (u8)param;
 		break;
 
+	case MODEM_SET_WRITE_COMP_CMD:
+		ret = modem_set_something(modem,
+					  &param,
+					  cmd, arg);
+		if (ret)
+			break;
+#ifdef CONFIG_SPRD_MODEM_LOADER_LZ4
+		if (param == MODEM_COMP_NONE || param == MODEM_COMP_LZ4) {
+#else
+		if (param == MODEM_COMP_NONE) {
+#endif
+			modem->write_comp = (u8)param;
+			break;
+		}
+		ret = -EOPNOTSUPP;
+		break;
+
 #ifdef CONFIG_SPRD_EXT_MODEM
 	case MODEM_GET_REMOTE_FLAG_CMD:
 		modem_get_remote_flag(modem);
@@ -1396,6 +1698,7 @@ static struct platform_driver modem_driver = {
 	.driver = {
 		.name = "modem",
 		.of_match_table = modem_match_table,
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 	.probe = modem_probe,
 	.remove = modem_remove,
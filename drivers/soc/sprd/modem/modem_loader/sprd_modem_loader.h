@@ -57,6 +57,24 @@ struct modem_load_info {
 	struct modem_region_info	regions[MAX_REGION_CNT];
 };
 
+/*
+ * Compressed region format, see MODEM_SET_WRITE_COMP_CMD. A region is a
+ * sequence of blocks, each a header followed by comp_len bytes which
+ * decompress to raw_len bytes on their own. A write must carry whole
+ * blocks, the file position then counts the decompressed bytes.
+ */
+enum {
+	MODEM_COMP_NONE = 0,
+	MODEM_COMP_LZ4,
+};
+
+#define MODEM_COMP_MAX_BLOCK	0x100000
+
+struct modem_comp_block_hdr {
+	__le32	comp_len;
+	__le32	raw_len;
+};
+
 struct modem_ctrl {
 	u32	ctrl_reg[MODEM_CTRL_NR];	/* offset value*/
 	u32	ctrl_mask[MODEM_CTRL_NR];	/* mask bit */
@@ -95,6 +113,7 @@ struct modem_device {
 
 	u8	read_region;
 	u8	write_region;
+	u8	write_comp;
 	u8	run_state;
 	u8	modem_type;	/* pcie, soc */
 
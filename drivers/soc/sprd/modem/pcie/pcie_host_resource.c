@@ -13,6 +13,7 @@
 #include <linux/delay.h>
 #include <linux/interrupt.h>
 #include <linux/kernel.h>
+#include <linux/module.h>
 #include <linux/pci.h>
 #include <linux/pcie-rc-sprd.h>
 #include <linux/sched.h>
@@ -22,6 +23,7 @@
 #include <linux/soc/sprd/sprd_mpm.h>
 #include <linux/types.h>
 #include <linux/wait.h>
+#include <linux/workqueue.h>
 #include <linux/mdm_ctrl.h>
 
 #ifdef CONFIG_SPRD_SIPA
@@ -35,6 +37,15 @@
 #define MAX_PMS_WAIT_TIME	5000
 #define MAX_PMS_DEFECTIVE_CHIP_FIRST_WAIT_TIME	(55 * 1000)
 
+/*
+ * A remove and the rescan after it take far longer than the first packet
+ * may wait, so the link is only removed after it was not requested for
+ * remove_delay_ms. The link sits in its ASPM low power state meanwhile.
+ * 0 removes it on release.
+ */
+static uint remove_delay_ms;
+module_param(remove_delay_ms, uint, 0644);
+
 enum rc_state {
 	SPRD_PCIE_WAIT_FIRST_READY = 0,
 	SPRD_PCIE_WAIT_SCANNED,
@@ -103,6 +114,7 @@ struct sprd_pcie_res {
 	void *sipa_res;
 #endif
 	void *actions_queue;
+	struct delayed_work	release_work;
 
 	struct wakeup_source	ws;
 	struct platform_device		*pcie_dev;
@@ -591,9 +603,22 @@ int sprd_pcie_request_resource(u32 dst)
 	/* get a wakelock */
 	__pm_stay_awake(&res->ws);
 
+	/* a late release still sees requested and keeps the link */
+	cancel_delayed_work(&res->release_work);
+
 	return sprd_add_action(res->actions_queue, REQUEST_RES_ACTION);
 }
 
+static void sprd_pcie_resource_release_work(struct work_struct *work)
+{
+	struct sprd_pcie_res *res = container_of(to_delayed_work(work),
+						 struct sprd_pcie_res,
+						 release_work);
+
+	if (!res->requested)
+		sprd_add_action(res->actions_queue, RELEASE_RES_ACTION);
+}
+
 int sprd_pcie_release_resource(u32 dst)
 {
 	struct sprd_pcie_res *res;
@@ -609,7 +634,13 @@ int sprd_pcie_release_resource(u32 dst)
 	  */
 	smp_mb();
 
-	ret = sprd_add_action(res->actions_queue, RELEASE_RES_ACTION);
+	if (READ_ONCE(remove_delay_ms)) {
+		mod_delayed_work(system_wq, &res->release_work,
+				 msecs_to_jiffies(READ_ONCE(remove_delay_ms)));
+		ret = 0;
+	} else {
+		ret = sprd_add_action(res->actions_queue, RELEASE_RES_ACTION);
+	}
 
 	/* relax a wakelock */
 	__pm_relax(&res->ws);
@@ -992,6 +1023,7 @@ int sprd_pcie_resource_host_init(u32 dst, u32 ep_dev,
 	init_waitqueue_head(&res->wait_remove_ep);
 
 	wakeup_source_init(&res->ws, "pcie_res");
+	INIT_DELAYED_WORK(&res->release_work, sprd_pcie_resource_release_work);
 
 	res->dst = dst;
 	res->state = SPRD_PCIE_WAIT_FIRST_READY;
@@ -1060,6 +1092,7 @@ int sprd_pcie_resource_trash(u32 dst)
 					      PCIE_MSI_RELEASE_RES);
 	sprd_ep_dev_unregister_notify(res->ep_dev);
 	modem_ctrl_unregister_notifier(&mcd_notify);
+	cancel_delayed_work_sync(&res->release_work);
 	sprd_pms_destroy(res->pms);
 	sprd_destroy_action_queue(res->actions_queue);
 
@@ -50,8 +50,20 @@ int sprd_add_action_ex(void *actions_queue, u32 action, int param)
 	u32 pos;
 
 	spin_lock_irqsave(&aq->action_lock, flags);
-	if (aq->rdpos == aq->wtpos ||
-		(aq->wtpos & (ACTIONS_QUEUE_SIZE - 1)) != aq->rdpos) {
+	/*
+	 * The actions act on state, running one twice in a row does no more
+	 * than running it once, so a copy of the last pending one is dropped.
+	 * The one at rdpos may already run and has to be queued behind.
+	 */
+	if (aq->wtpos - aq->rdpos > 1) {
+		pos = (aq->wtpos - 1) & (ACTIONS_QUEUE_SIZE - 1);
+		if (aq->actions[pos] == action && aq->params[pos] == param) {
+			spin_unlock_irqrestore(&aq->action_lock, flags);
+			return 0;
+		}
+	}
+
+	if (aq->wtpos - aq->rdpos < ACTIONS_QUEUE_SIZE) {
 		ret = 0;
 		pos = aq->wtpos & (ACTIONS_QUEUE_SIZE - 1);
 		aq->actions[pos] = action;
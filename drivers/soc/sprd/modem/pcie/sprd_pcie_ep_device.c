@@ -451,8 +451,13 @@ int sprd_ep_dev_raise_irq(int ep, int irq)
 	spin_lock(&ep_dev->set_irq_lock);
 	base = ep_dev->cfg_base + DOOR_BELL_BASE;
 	value = readl_relaxed(base + DOOR_BELL_STATUS);
-	writel_relaxed(value | DOOR_BELL_IRQ_VALUE(irq),
-		       base + DOOR_BELL_STATUS);
+	/*
+	 * The doorbell irq is level, status & enable. A bit the ep has not
+	 * cleared yet still stands for this event, don't write it again.
+	 */
+	if (!(value & DOOR_BELL_IRQ_VALUE(irq)))
+		writel_relaxed(value | DOOR_BELL_IRQ_VALUE(irq),
+			       base + DOOR_BELL_STATUS);
 	spin_unlock(&ep_dev->set_irq_lock);
 
 	return 0;
@@ -15,7 +15,9 @@
 #include <linux/kernel.h>
 #include <linux/io.h>
 #include <linux/mm.h>
+#include <linux/slab.h>
 #include <linux/string.h>
+#include <linux/workqueue.h>
 
 u8 mode_flag;
 u8 rotpk_hash[HASH_BYTE_LEN + CRC_16];
@@ -56,12 +58,72 @@ static u8 hexchar_to_int(u8 c)
 		return (c - '0');
 }
 
+/*
+ * The images of one load table are independent, so they are hashed in
+ * parallel on the unbound workqueue, one cpu each. SHA-256 itself stays
+ * serial over every image, the digests still match the signed certs.
+ * The certs are checked one after the other afterwards, as the anti
+ * rollback check goes through mode_flag and the efuse.
+ */
+struct sprd_img_verify {
+	struct work_struct work;
+	const char *name;
+	void *vaddr;
+	u8 *data;
+	u32 data_len;
+	u8 *cert;
+	u8 block;
+	u8 hash[HASH_BYTE_LEN];
+};
+
+static void sprd_img_hash_work(struct work_struct *work)
+{
+	struct sprd_img_verify *v = container_of(work, struct sprd_img_verify,
+						 work);
+
+	cal_sha256(v->data, v->data_len, v->hash);
+}
+
+static int sprd_img_verify_prepare(struct sprd_img_verify *v,
+				   struct kbc_image_s *image)
+{
+	if (strcmp(image->img_name, "modem") == 0)
+		v->block = MODEM_BLOCK;
+	else if (strcmp(image->img_name, "v3phy") == 0)
+		v->block = V3PHY_BLOCK;
+	else if (strcmp(image->img_name, "nrphy") == 0)
+		v->block = NRPHY_BLOCK;
+	else if (strcmp(image->img_name, "nrdsp1") == 0)
+		v->block = NRDSP1_BLOCK;
+	else
+		return 0;
+
+	v->vaddr = memremap(image->img_addr, image->img_len, MEMREMAP_WB);
+	if (!v->vaddr)
+		return -ENOMEM;
+
+	v->name = image->img_name;
+	if (v->block == MODEM_BLOCK) {
+		v->data_len = sprd_get_modem_size(v->vaddr);
+		v->data = (u8 *)v->vaddr + sizeof(struct sys_img_header);
+		v->cert = v->data + v->data_len +
+			sizeof(struct signed_img_header);
+	} else {
+		v->data_len = sprd_get_img_size(v->vaddr);
+		v->data = (u8 *)v->vaddr + SECBOOT_HEAD_SIZE;
+		v->cert = sprd_get_cert_addr_kbc(v->data, v->data_len);
+	}
+	memset(v->hash, 0xff, HASH_BYTE_LEN);
+	INIT_WORK(&v->work, sprd_img_hash_work);
+
+	return 1;
+}
+
 int sprd_image_verify(struct kbc_load_table_s  *p_table)
 {
 	u8 i, high_4bit, low_4bit;
-	void *vaddr;
-	u32 data_len;
-	int ret = 0;
+	struct sprd_img_verify *v;
+	int n = 0, ret = 0;
 
 	if (!p_table->image_cnt)
 		return -ENOENT;
@@ -80,49 +142,38 @@ int sprd_image_verify(struct kbc_load_table_s  *p_table)
 		rotpk_hash[i] = high_4bit | low_4bit;
 	}
 
+	v = kcalloc(MAX_MODEM_NUM, sizeof(*v), GFP_KERNEL);
+	if (!v)
+		return -ENOMEM;
+
 	for (i = 0; i < MAX_MODEM_NUM; i++) {
 		if (!p_table->image[i].img_name)
 			continue;
-		if (strcmp(p_table->image[i].img_name, "modem") == 0)
-			mode_flag = MODEM_BLOCK;
-		else if (strcmp(p_table->image[i].img_name, "v3phy") == 0)
-			mode_flag = V3PHY_BLOCK;
-		else if (strcmp(p_table->image[i].img_name, "nrphy") == 0)
-			mode_flag = NRPHY_BLOCK;
-		else if (strcmp(p_table->image[i].img_name, "nrdsp1") == 0)
-			mode_flag = NRDSP1_BLOCK;
-
-		if ((strcmp(p_table->image[i].img_name, "v3phy") == 0) ||
-		     (strcmp(p_table->image[i].img_name, "nrphy") == 0) ||
-		     (strcmp(p_table->image[i].img_name, "nrdsp1") == 0)) {
-			vaddr = memremap(p_table->image[i].img_addr,
-				p_table->image[i].img_len, MEMREMAP_WB);
-			if (!vaddr)
-				return -ENOMEM;
-			data_len = sprd_get_img_size(vaddr);
-			ret = sprd_verify_img_kbc(hash_key,
-				(u8 *)vaddr + SECBOOT_HEAD_SIZE, data_len);
-			memunmap(vaddr);
-			if (ret)
-				return ret;
-		}
 
-		if (strcmp(p_table->image[i].img_name, "modem") == 0) {
-			vaddr = memremap(p_table->image[i].img_addr,
-				p_table->image[i].img_len, MEMREMAP_WB);
-			if (!vaddr)
-				return -ENOMEM;
-			data_len = sprd_get_modem_size(vaddr);
-			ret = sprd_verify_modem(hash_key,
-				(u8 *)vaddr, data_len);
-			memunmap(vaddr);
-			if (ret) {
-				pr_err("verify modem failed\r\n");
-				return ret;
-			}
-		}
+		ret = sprd_img_verify_prepare(&v[n], &p_table->image[i]);
+		if (ret < 0)
+			break;
+		if (ret)
+			queue_work(system_unbound_wq, &v[n++].work);
+		ret = 0;
+	}
+
+	for (i = 0; i < n; i++)
+		flush_work(&v[i].work);
+
+	for (i = 0; i < n && !ret; i++) {
+		mode_flag = v[i].block;
+		ret = sprd_verify_cert(hash_key, v[i].hash, v[i].cert);
+		if (ret)
+			pr_err("verify %s failed\r\n", v[i].name);
 	}
-	pr_info("secboot verify success\n");
+
+	for (i = 0; i < n; i++)
+		memunmap(v[i].vaddr);
+	kfree(v);
+
+	if (!ret)
+		pr_info("secboot verify success\n");
 	return ret;
 }
 
@@ -35,6 +35,7 @@ void cal_sha256(u8 *input, u32 bytes_num, u8 *output);
 int sprd_verify_cert(u8 *hash_key_precert, u8 *hash_data, u8 *certptr);
 u32 sprd_get_img_size(u8 *buf);
 u32 sprd_get_modem_size(u8 *buf);
+u8 *sprd_get_cert_addr_kbc(u8 *buf, u32 imgSize);
 int sprd_verify_modem(u8 *hash_key_precert, u8 *imgbuf, u32 imgsize);
 int sprd_verify_img_kbc(u8 *hash_key_precert, u8 *imgbuf, u32 imgsize);
 #endif
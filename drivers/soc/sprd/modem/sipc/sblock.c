@@ -28,6 +28,9 @@
 #include <linux/wait.h>
 #include <linux/sipc.h>
 #include <uapi/linux/sched/types.h>
+#ifdef CONFIG_SPRD_SIPC_SBLOCK_RX_CACHED
+#include <asm/cacheflush.h>
+#endif
 
 #include "sipc_priv.h"
 #include "sblock.h"
@@ -403,6 +406,15 @@ int sblock_create_ex(u8 dst, u8 channel,
 		(poolhd->txblk_blks - sblock->mapped_smem_addr);
 	sblock->ring->p_rxblks = sblock->smem_virt +
 		(poolhd->rxblk_blks - sblock->mapped_smem_addr);
+#ifdef CONFIG_SPRD_SIPC_SBLOCK_RX_CACHED
+	/* the ap only reads rx blocks, a cached alias never gets dirty */
+	sblock->ring->rxblk_cached_virt = shmem_ram_vmap_cache(
+		sblock->smem_addr +
+		(ringhd->rxblk_addr - sblock->mapped_smem_addr),
+		rxblocknum * rxblocksize);
+	if (!sblock->ring->rxblk_cached_virt)
+		pr_warn("sblock-%d-%d: no cached rx mapping\n", dst, channel);
+#endif
 
 	for (i = 0; i < txblocknum; i++) {
 		sblock->ring->p_txblks[i].addr = poolhd->txblk_addr +
@@ -431,6 +443,8 @@ int sblock_create_ex(u8 dst, u8 channel,
 	if (IS_ERR(sblock->thread)) {
 		pr_err("Failed to create kthread: sblock-%d-%d\n",
 			dst, channel);
+		if (sblock->ring->rxblk_cached_virt)
+			shmem_ram_unmap(sblock->ring->rxblk_cached_virt);
 		shmem_ram_unmap(sblock->smem_virt);
 		smem_free(sblock->smem_addr, sblock->smem_size);
 		kfree(sblock->ring->txrecord);
@@ -491,6 +505,8 @@ void sblock_destroy(u8 dst, u8 channel)
 	if (sblock->ring) {
 		wake_up_interruptible_all(&sblock->ring->recvwait);
 		wake_up_interruptible_all(&sblock->ring->getwait);
+		if (sblock->ring->rxblk_cached_virt)
+			shmem_ram_unmap(sblock->ring->rxblk_cached_virt);
 		/* kfree(NULL) is safe */
 		/* if (sblock->ring->txrecord) */
 			kfree(sblock->ring->txrecord);
@@ -841,6 +857,57 @@ int sblock_receive(u8 dst, u8 channel,
 }
 EXPORT_SYMBOL_GPL(sblock_receive);
 
+int sblock_receive_bulk(u8 dst, u8 channel, struct sblock *blks, int n)
+{
+	struct sblock_mgr *sblock;
+	struct sblock_ring *ring;
+	volatile struct sblock_ring_header *ringhd;
+	int rxpos, index, cnt = 0;
+	unsigned long flags;
+	u8 ch_index;
+
+	ch_index = sipc_channel2index(channel);
+	if (ch_index == INVALID_CHANEL_INDEX) {
+		pr_err("%s:channel %d invalid!\n", __func__, channel);
+		return -EINVAL;
+	}
+
+	sblock = sblocks[dst][ch_index];
+	if (!sblock || sblock->state != SBLOCK_STATE_READY) {
+		pr_err("%s:sblock-%d-%d not ready!\n", __func__, dst, channel);
+		return sblock ? -EIO : -ENODEV;
+	}
+
+	ring = sblock->ring;
+	ringhd = (volatile struct sblock_ring_header *)(&ring->header->ring);
+
+	spin_lock_irqsave(&ring->r_rxlock, flags);
+	while (cnt < n && ringhd->rxblk_wrptr != ringhd->rxblk_rdptr &&
+	       sblock->state == SBLOCK_STATE_READY) {
+		rxpos = sblock_get_ringpos(ringhd->rxblk_rdptr,
+					   ringhd->rxblk_count);
+		blks[cnt].addr = ring->r_rxblks[rxpos].addr -
+				 sblock->mapped_smem_addr +
+				 sblock->smem_virt;
+		blks[cnt].length = ring->r_rxblks[rxpos].length;
+		ringhd->rxblk_rdptr = ringhd->rxblk_rdptr + 1;
+		index = sblock_get_index((blks[cnt].addr - ring->rxblk_virt),
+					 sblock->rxblksz);
+		ring->rxrecord[index] = SBLOCK_BLK_STATE_PENDING;
+		cnt++;
+	}
+	spin_unlock_irqrestore(&ring->r_rxlock, flags);
+
+	pr_debug("sblock_receive_bulk: channel=%d, got %d of %d\n",
+		 channel, cnt, n);
+
+	if (!cnt && sblock->state != SBLOCK_STATE_READY)
+		return -EIO;
+
+	return cnt;
+}
+EXPORT_SYMBOL_GPL(sblock_receive_bulk);
+
 int sblock_get_arrived_count(u8 dst, u8 channel)
 {
 	struct sblock_mgr *sblock;
@@ -966,6 +1033,102 @@ int sblock_release(u8 dst, u8 channel, struct sblock *blk)
 }
 EXPORT_SYMBOL_GPL(sblock_release);
 
+int sblock_release_bulk(u8 dst, u8 channel, struct sblock *blks, int n)
+{
+	struct sblock_mgr *sblock;
+	struct sblock_ring *ring;
+	volatile struct sblock_ring_header *poolhd;
+	struct smsg mevt;
+	unsigned long flags;
+	bool was_empty;
+	int rxpos;
+	int index;
+	int i;
+	u8 ch_index;
+
+	if (n <= 0)
+		return 0;
+
+	ch_index = sipc_channel2index(channel);
+	if (ch_index == INVALID_CHANEL_INDEX) {
+		pr_err("%s:channel %d invalid!\n", __func__, channel);
+		return -EINVAL;
+	}
+
+	sblock = sblocks[dst][ch_index];
+	if (!sblock || sblock->state != SBLOCK_STATE_READY) {
+		pr_err("%s:sblock-%d-%d not ready!\n", __func__, dst, channel);
+		return -ENODEV;
+	}
+
+	ring = sblock->ring;
+	poolhd = (volatile struct sblock_ring_header *)(&ring->header->pool);
+
+	spin_lock_irqsave(&ring->p_rxlock, flags);
+	was_empty = poolhd->rxblk_wrptr == poolhd->rxblk_rdptr;
+	for (i = 0; i < n; i++) {
+		rxpos = sblock_get_ringpos(poolhd->rxblk_wrptr,
+					   poolhd->rxblk_count);
+		ring->p_rxblks[rxpos].addr = blks[i].addr -
+					     sblock->smem_virt +
+					     sblock->mapped_smem_addr;
+		ring->p_rxblks[rxpos].length = poolhd->rxblk_size;
+		poolhd->rxblk_wrptr = poolhd->rxblk_wrptr + 1;
+
+		index = sblock_get_index((blks[i].addr - ring->rxblk_virt),
+					 sblock->rxblksz);
+		ring->rxrecord[index] = SBLOCK_BLK_STATE_DONE;
+	}
+
+	/*
+	 * Like sblock_release, only the empty -> non empty transition of
+	 * the pool is signalled, once for the whole batch.
+	 */
+	if (was_empty && sblock->state == SBLOCK_STATE_READY) {
+		smsg_set(&mevt, channel,
+			 SMSG_TYPE_EVENT,
+			 SMSG_EVENT_SBLOCK_RELEASE,
+			 0);
+		smsg_send(dst, &mevt, -1);
+	}
+
+	spin_unlock_irqrestore(&ring->p_rxlock, flags);
+
+	pr_debug("sblock_release_bulk: channel=%d, released %d\n",
+		 channel, n);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(sblock_release_bulk);
+
+void *sblock_rx_data(u8 dst, u8 channel, struct sblock *blk)
+{
+#ifdef CONFIG_SPRD_SIPC_SBLOCK_RX_CACHED
+	struct sblock_mgr *sblock;
+	struct sblock_ring *ring;
+	void *addr;
+	u8 ch_index;
+
+	ch_index = sipc_channel2index(channel);
+	if (ch_index == INVALID_CHANEL_INDEX)
+		return blk->addr;
+
+	sblock = sblocks[dst][ch_index];
+	if (!sblock || !sblock->ring->rxblk_cached_virt)
+		return blk->addr;
+
+	ring = sblock->ring;
+	addr = ring->rxblk_cached_virt + (blk->addr - ring->rxblk_virt);
+	/* drop what the cache kept from the previous use of this block */
+	__inval_dcache_area(addr, blk->length);
+
+	return addr;
+#else
+	return blk->addr;
+#endif
+}
+EXPORT_SYMBOL_GPL(sblock_rx_data);
+
 unsigned int sblock_poll_wait(u8 dst, u8 channel, struct file *filp, poll_table *wait)
 {
 	struct sblock_mgr *sblock;
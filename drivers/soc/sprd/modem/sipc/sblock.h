@@ -61,6 +61,8 @@ struct sblock_ring {
 	struct sblock_header	*header;
 	void			*txblk_virt; /* virt of header->txblk_addr */
 	void			*rxblk_virt; /* virt of header->rxblk_addr */
+	/* cached alias of rxblk_virt, NULL if it is not mapped */
+	void			*rxblk_cached_virt;
 
 	/* virt of header->ring->txblk_blks */
 	struct sblock_blks	*r_txblks;
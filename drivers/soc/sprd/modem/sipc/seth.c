@@ -23,6 +23,7 @@
 #include <linux/netdevice.h>
 #include <linux/etherdevice.h>
 #include <linux/skbuff.h>
+#include <linux/highmem.h>
 #include <linux/workqueue.h>
 #include <linux/ipv6.h>
 #include <linux/ip.h>
@@ -38,7 +39,12 @@
 #include <linux/debugfs.h>
 #include <linux/seq_file.h>
 #include <linux/of_device.h>
+#include <linux/ethtool.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
 #include <linux/sipc.h>
+#include <linux/soc/sprd/sprd_wakepkt.h>
+#include <linux/sprd_cp_dvfs.h>
 #if defined(CONFIG_SPRD_SFP_SUPPORT) && !defined(CONFIG_SPRD_IPA_SUPPORT)
 #include <net/sfp.h>
 #endif
@@ -59,6 +65,20 @@
 
 #define SETH_NAPI_WEIGHT 64
 #define SETH_TX_WEIGHT 16
+/* segments of one super packet, bounded by half of the sblock pool */
+#define SETH_GSO_MAX_SEGS 32
+
+/*
+ * rx re-poll coalescing defaults: with the adaptive mode the delay moves
+ * from the low to the high value while the rate goes from low to high.
+ */
+#define SETH_RX_COAL_USECS		50
+#define SETH_RX_COAL_USECS_LOW		20
+#define SETH_RX_COAL_USECS_HIGH		200
+#define SETH_RX_COAL_RATE_LOW		1000
+#define SETH_RX_COAL_RATE_HIGH		50000
+#define SETH_RX_COAL_USECS_MAX		20000
+#define SETH_RX_COAL_SAMPLE_MS		100
 
 #ifndef ARPHRD_RAWIP
 #define ARPHRD_RAWIP 530
@@ -73,6 +93,8 @@ struct seth_dtrans_stats {
 	u32 rx_sum;
 	u32 rx_cnt;
 	u32 rx_alloc_fails;
+	u32 sfp_fwd_cnt;
+	u32 sfp_fwd_drops;
 
 	u32 tx_pkt_max;
 	u32 tx_pkt_min;
@@ -99,7 +121,8 @@ struct seth_init_data {
  * @txstate: device txstate
  * @is_rawip : whether is rawip solution
  * @rx_busy: whether seth rx is busy
- * @rx_timer: timer for seth rx
+ * @rx_timer: re-poll timer for sblocks arrived without an event
+ * @rx_coal: rx re-poll coalescing settings and rate sampling state
  * @txpending: seth tx resend count
  * @tx_timer: timer for seth tx
  * @napi: napi instance
@@ -114,7 +137,19 @@ struct seth {
 	int is_rawip;
 
 	atomic_t rx_busy;
-	struct timer_list rx_timer;
+	struct hrtimer rx_timer;
+	struct {
+		bool adaptive;
+		u32 usecs;
+		u32 usecs_low;
+		u32 usecs_high;
+		u32 rate_low;
+		u32 rate_high;
+		/* sampling state of the adaptive mode */
+		u32 cur_usecs;
+		u32 pkts;
+		ktime_t stamp;
+	} rx_coal;
 
 	atomic_t txpending;
 	struct timer_list tx_timer;
@@ -127,7 +162,7 @@ static u32 gro_enable;
 
 static struct dentry *root;
 static int seth_debugfs_mknod(void *root, void *data);
-static void seth_rx_timer_handler(unsigned long data);
+static enum hrtimer_restart seth_rx_timer_handler(struct hrtimer *timer);
 
 static inline void seth_dt_stats_init(struct seth_dtrans_stats *stats)
 {
@@ -169,8 +204,12 @@ static inline void pkt_info_print(struct sk_buff *skb)
 static void
 seth_rx_prepare_skb(struct seth *seth, struct sk_buff *skb, struct sblock *blk)
 {
+	struct seth_init_data *pdata = seth->pdata;
 	struct ethhdr *peth;
 	struct iphdr *iph;
+	void *data;
+
+	data = SBLOCK_RX_DATA(pdata->dst, pdata->channel, blk);
 
 	if (seth->is_rawip) {
 		skb_reserve(skb, NET_IP_ALIGN);
@@ -178,7 +217,7 @@ seth_rx_prepare_skb(struct seth *seth, struct sk_buff *skb, struct sblock *blk)
 		peth = (struct ethhdr *)skb->data;
 		skb_reserve(skb, ETH_HLEN);
 		skb_reset_network_header(skb);
-		unalign_memcpy(skb->data, blk->addr, blk->length);
+		unalign_memcpy(skb->data, data, blk->length);
 		skb->dev = seth->netdev;
 		iph = ip_hdr(skb);
 		if (iph->version == 4)
@@ -195,7 +234,7 @@ seth_rx_prepare_skb(struct seth *seth, struct sk_buff *skb, struct sblock *blk)
 		skb_put(skb, blk->length);
 	} else {
 		skb_reserve(skb, NET_IP_ALIGN);
-		unalign_memcpy(skb->data, blk->addr, blk->length);
+		unalign_memcpy(skb->data, data, blk->length);
 		skb_put(skb, blk->length);
 		skb->protocol = eth_type_trans(skb, seth->netdev);
 		skb_reset_network_header(skb);
@@ -205,24 +244,151 @@ seth_rx_prepare_skb(struct seth *seth, struct sk_buff *skb, struct sblock *blk)
 }
 
 #if defined(CONFIG_SPRD_SFP_SUPPORT) && !defined(CONFIG_SPRD_IPA_SUPPORT)
-static int seth_sfp_start_xmit(struct sk_buff *skb, struct net_device *dev)
+/*
+ * Fast path packets of one napi poll are chained per egress tx queue and
+ * handed over together, so the egress driver sees xmit_more and rings
+ * its doorbell once per batch instead of once per packet.
+ */
+#define SETH_SFP_BATCH	16
+
+struct seth_sfp_batch {
+	struct netdev_queue *txq;
+	struct sk_buff *head;
+	struct sk_buff **tail;
+	int cnt;
+};
+
+static void seth_sfp_batch_init(struct seth_sfp_batch *batch)
+{
+	batch->txq = NULL;
+	batch->head = NULL;
+	batch->tail = &batch->head;
+	batch->cnt = 0;
+}
+
+static void seth_sfp_flush(struct seth *seth, struct seth_sfp_batch *batch)
 {
-	const struct net_device_ops *ops = dev->netdev_ops;
+	struct netdev_queue *txq = batch->txq;
+	struct net_device *dev;
+	struct sk_buff *skb, *next;
+	int ret = NETDEV_TX_OK;
+
+	if (!batch->cnt)
+		return;
+
+	dev = txq->dev;
+	skb = validate_xmit_skb_list(batch->head, dev);
+	if (skb) {
+		HARD_TX_LOCK(dev, txq, smp_processor_id());
+		if (!netif_xmit_frozen_or_stopped(txq))
+			skb = dev_hard_start_xmit(skb, dev, txq, &ret);
+		HARD_TX_UNLOCK(dev, txq);
+	}
 
-	return ops->ndo_start_xmit(skb, dev);
+	seth->dt_stats.sfp_fwd_cnt += batch->cnt;
+	/* what the egress queue did not take is dropped, like a full qdisc */
+	while (skb) {
+		next = skb->next;
+		skb->next = NULL;
+		dev_kfree_skb_any(skb);
+		seth->dt_stats.sfp_fwd_drops++;
+		skb = next;
+	}
+
+	seth_sfp_batch_init(batch);
+}
+
+/* The fast path left the egress device in skb->dev */
+static void seth_sfp_queue(struct seth *seth, struct seth_sfp_batch *batch,
+			   struct sk_buff *skb)
+{
+	struct netdev_queue *txq;
+
+	txq = netdev_pick_tx(skb->dev, skb, NULL);
+	if (batch->txq != txq || batch->cnt >= SETH_SFP_BATCH) {
+		seth_sfp_flush(seth, batch);
+		batch->txq = txq;
+	}
+
+	skb->next = NULL;
+	*batch->tail = skb;
+	batch->tail = &skb->next;
+	batch->cnt++;
 }
 #endif
 
+static void seth_rx_coal_init(struct seth *seth)
+{
+	seth->rx_coal.adaptive = true;
+	seth->rx_coal.usecs = SETH_RX_COAL_USECS;
+	seth->rx_coal.usecs_low = SETH_RX_COAL_USECS_LOW;
+	seth->rx_coal.usecs_high = SETH_RX_COAL_USECS_HIGH;
+	seth->rx_coal.rate_low = SETH_RX_COAL_RATE_LOW;
+	seth->rx_coal.rate_high = SETH_RX_COAL_RATE_HIGH;
+	seth->rx_coal.cur_usecs = SETH_RX_COAL_USECS_LOW;
+	seth->rx_coal.pkts = 0;
+	seth->rx_coal.stamp = ktime_get();
+}
+
+/*
+ * A short re-poll delay keeps the latency low while packets are rare,
+ * under load a longer one saves polls that would find the ring empty.
+ * In the adaptive mode the delay follows the packet rate of the last
+ * sample window, linearly between the low and high settings.
+ */
+static void seth_rx_coal_update(struct seth *seth, int cnt)
+{
+	u32 rate, usecs;
+	s64 elapsed;
+	ktime_t now;
+
+	if (!seth->rx_coal.adaptive) {
+		seth->rx_coal.cur_usecs = seth->rx_coal.usecs;
+		return;
+	}
+
+	seth->rx_coal.pkts += cnt;
+	now = ktime_get();
+	elapsed = ktime_ms_delta(now, seth->rx_coal.stamp);
+	if (elapsed < SETH_RX_COAL_SAMPLE_MS)
+		return;
+
+	rate = div64_s64((s64)seth->rx_coal.pkts * MSEC_PER_SEC, elapsed);
+	if (rate <= seth->rx_coal.rate_low)
+		usecs = seth->rx_coal.usecs_low;
+	else if (rate >= seth->rx_coal.rate_high)
+		usecs = seth->rx_coal.usecs_high;
+	else
+		usecs = seth->rx_coal.usecs_low +
+			(u32)div_u64((u64)(rate - seth->rx_coal.rate_low) *
+				     (seth->rx_coal.usecs_high -
+				      seth->rx_coal.usecs_low),
+				     seth->rx_coal.rate_high -
+				     seth->rx_coal.rate_low);
+
+	seth->rx_coal.cur_usecs = usecs;
+	seth->rx_coal.pkts = 0;
+	seth->rx_coal.stamp = now;
+}
+
+/*
+ * sblocks taken from the rx ring at once, they are copied out and handed
+ * back to CP together before the packets go up the stack.
+ */
+#define SETH_RX_BULK	16
+
 static int seth_rx_poll_handler(struct napi_struct *napi, int budget)
 {
 	struct seth *seth = container_of(napi, struct seth, napi);
+	struct sk_buff *skbs[SETH_RX_BULK];
+	struct sblock blks[SETH_RX_BULK];
 	struct sk_buff *skb;
 	struct seth_init_data *pdata;
-	struct sblock blk = {};
 	struct seth_dtrans_stats *dt_stats;
-	int skb_cnt, blk_ret, ret;
+	int skb_cnt, blk_cnt, want, i, n, ret;
+	unsigned long rx_bytes;
 #if defined(CONFIG_SPRD_SFP_SUPPORT) && !defined(CONFIG_SPRD_IPA_SUPPORT)
-	struct net_device *net;
+	struct seth_sfp_batch sfp_batch;
 	int out_index;
 #endif
 
@@ -233,73 +399,92 @@ static int seth_rx_poll_handler(struct napi_struct *napi, int budget)
 
 	pdata = seth->pdata;
 	dt_stats = &seth->dt_stats;
-	blk_ret = 0;
 	skb_cnt = 0;
+	rx_bytes = seth->stats.rx_bytes;
+#if defined(CONFIG_SPRD_SFP_SUPPORT) && !defined(CONFIG_SPRD_IPA_SUPPORT)
+	seth_sfp_batch_init(&sfp_batch);
+#endif
 	/* Keep polling, until the sblock rx ring is empty */
-	while ((budget - skb_cnt) && !blk_ret) {
-		blk_ret = SBLOCK_RECEIVE(pdata->dst, pdata->channel, &blk, 0);
-		if (blk_ret) {
-			dev_dbg(
-				&seth->netdev->dev,
-				"receive sblock error %d\n",
-				blk_ret);
-			continue;
-		}
-		if (seth->is_rawip)
-			skb = dev_alloc_skb(blk.length
-					+ ETH_HLEN + NET_IP_ALIGN);
-		else
-			skb = dev_alloc_skb(blk.length + NET_IP_ALIGN);
-		if (!skb) {
-			seth->stats.rx_dropped++;
-			dev_err(&seth->netdev->dev, "failed to alloc skb!\n");
-			ret = SBLOCK_RELEASE(pdata->dst, pdata->channel, &blk);
-			if (ret)
-				dev_err(
+	while (budget > skb_cnt) {
+		want = min(budget - skb_cnt, SETH_RX_BULK);
+		blk_cnt = SBLOCK_RECEIVE_BULK(pdata->dst, pdata->channel,
+					      blks, want);
+		if (blk_cnt <= 0) {
+			if (blk_cnt)
+				dev_dbg(
 					&seth->netdev->dev,
-					"release sblock failed %d\n",
-					ret);
-			dt_stats->rx_alloc_fails++;
-			continue;
+					"receive sblock error %d\n",
+					blk_cnt);
+			break;
+		}
+
+		for (i = 0, n = 0; i < blk_cnt; i++) {
+			if (seth->is_rawip)
+				skb = dev_alloc_skb(blks[i].length
+						+ ETH_HLEN + NET_IP_ALIGN);
+			else
+				skb = dev_alloc_skb(blks[i].length
+						+ NET_IP_ALIGN);
+			if (!skb) {
+				seth->stats.rx_dropped++;
+				dev_err(&seth->netdev->dev,
+					"failed to alloc skb!\n");
+				dt_stats->rx_alloc_fails++;
+				continue;
+			}
+			/* Prepare skb for IP layer */
+			seth_rx_prepare_skb(seth, skb, &blks[i]);
+			sprd_wakepkt_rx(seth->netdev->name, -1, skb, 0);
+			/* Print debug info: ipid for v4*/
+			pkt_info_print(skb);
+			skbs[n++] = skb;
 		}
-		/* Prepare skb for IP layer */
-		seth_rx_prepare_skb(seth, skb, &blk);
-		/* Print debug info: ipid for v4*/
-		pkt_info_print(skb);
-		/* Release sblock */
-		ret = SBLOCK_RELEASE(pdata->dst, pdata->channel, &blk);
+
+		/* Release the sblocks, one event to CP for the batch */
+		ret = SBLOCK_RELEASE_BULK(pdata->dst, pdata->channel,
+					  blks, blk_cnt);
 		if (ret)
 			dev_err(
 				&seth->netdev->dev,
 				"release sblock error %d\n",
 				ret);
-		/* Update fifo rd_ptr */
-		seth->stats.rx_bytes += skb->len;
-		seth->stats.rx_packets++;
-#if defined(CONFIG_SPRD_SFP_SUPPORT) && !defined(CONFIG_SPRD_IPA_SUPPORT)
-		ret = soft_fastpath_process(SFP_INTERFACE_LTE,
-					(void *)skb, NULL, NULL, &out_index);
-		if (!ret) {
-			net = netdev_get_by_index(out_index);
+
+		for (i = 0; i < n; i++) {
+			skb = skbs[i];
+			seth->stats.rx_bytes += skb->len;
+			seth->stats.rx_packets++;
+			/* Update skb counter */
 			skb_cnt++;
-			if (!net || seth_sfp_start_xmit(skb, net)) {
-				dev_kfree_skb_any(skb);
-				pr_err("fast xmit fail, netif recv!\n");
+#if defined(CONFIG_SPRD_SFP_SUPPORT) && !defined(CONFIG_SPRD_IPA_SUPPORT)
+			ret = soft_fastpath_process(SFP_INTERFACE_LTE,
+						    (void *)skb, NULL, NULL,
+						    &out_index);
+			if (!ret) {
+				seth_sfp_queue(seth, &sfp_batch, skb);
+				continue;
 			}
-			continue;
-		}
 #endif
-		/* Send to IP layer */
-		if (gro_enable)
-			napi_gro_receive(napi, skb);
-		else
-			netif_receive_skb(skb);
-		/* Update skb counter */
-		skb_cnt++;
+			/* Send to IP layer */
+			if (gro_enable)
+				napi_gro_receive(napi, skb);
+			else
+				netif_receive_skb(skb);
+		}
+
+		/* a short batch means the ring ran dry */
+		if (blk_cnt < want)
+			break;
 	}
 
+#if defined(CONFIG_SPRD_SFP_SUPPORT) && !defined(CONFIG_SPRD_IPA_SUPPORT)
+	seth_sfp_flush(seth, &sfp_batch);
+#endif
+
 	/* Update rx statistics */
 	seth_rx_stats_update(dt_stats, skb_cnt);
+	seth_rx_coal_update(seth, skb_cnt);
+	if (skb_cnt)
+		sprd_cp_dvfs_load_hint(seth->stats.rx_bytes - rx_bytes);
 
 	if (skb_cnt >= 0 && budget > skb_cnt) {
 		napi_complete(napi);
@@ -309,15 +494,14 @@ static int seth_rx_poll_handler(struct napi_struct *napi, int budget)
 		 * be processed even if there are no events issued by CP
 		 */
 		if (SBLOCK_GET_ARRIVED_COUNT(pdata->dst, pdata->channel) > 0) {
-			/* Start a timer with 2 jiffies expries (20 ms) */
-			seth->rx_timer.function = seth_rx_timer_handler;
-			seth->rx_timer.expires = jiffies + HZ / 50;
-			seth->rx_timer.data = (unsigned long)seth;
-			mod_timer(&seth->rx_timer, seth->rx_timer.expires);
+			hrtimer_start(&seth->rx_timer,
+				      ns_to_ktime((u64)seth->rx_coal.cur_usecs *
+						  NSEC_PER_USEC),
+				      HRTIMER_MODE_REL);
 			dev_dbg(
 				&seth->netdev->dev,
-				"start rx_timer, jiffies %lu.\n",
-				jiffies);
+				"start rx_timer, %u us.\n",
+				seth->rx_coal.cur_usecs);
 		}
 	}
 	return skb_cnt;
@@ -384,9 +568,13 @@ static void seth_rx_handler(void *data)
 	}
 }
 
-static void seth_rx_timer_handler(unsigned long data)
+static enum hrtimer_restart seth_rx_timer_handler(struct hrtimer *timer)
 {
-	seth_rx_handler((void *)data);
+	struct seth *seth = container_of(timer, struct seth, rx_timer);
+
+	seth_rx_handler(seth);
+
+	return HRTIMER_NORESTART;
 }
 
 /* Tx_close handler. */
@@ -412,7 +600,7 @@ static void seth_handler(int event, void *data)
 		seth_tx_pre_handler(seth);
 		break;
 	case SBLOCK_NOTIFY_RECV:
-		del_timer(&seth->rx_timer);
+		hrtimer_try_to_cancel(&seth->rx_timer);
 		seth_rx_handler(seth);
 		break;
 	case SBLOCK_NOTIFY_STATUS:
@@ -431,6 +619,30 @@ static void seth_handler(int event, void *data)
 	}
 }
 
+/*
+ * Copy a packet into an sblock. The mapping of the shared memory may not
+ * take unaligned accesses, so every piece goes through unalign_memcpy()
+ * and paged skbs are copied straight from their fragments.
+ */
+static void seth_tx_copy(void *to, const struct sk_buff *skb)
+{
+	const skb_frag_t *frag;
+	void *vaddr;
+	int i;
+
+	unalign_memcpy(to, skb->data, skb_headlen(skb));
+	to += skb_headlen(skb);
+
+	for (i = 0; i < skb_shinfo(skb)->nr_frags; i++) {
+		frag = &skb_shinfo(skb)->frags[i];
+		vaddr = kmap_atomic(skb_frag_page(frag));
+		unalign_memcpy(to, vaddr + frag->page_offset,
+			       skb_frag_size(frag));
+		kunmap_atomic(vaddr);
+		to += skb_frag_size(frag);
+	}
+}
+
 static int seth_tx_pkt(void *data, struct sk_buff *skb, int is_ack)
 {
 	struct sblock blk = {};
@@ -459,7 +671,7 @@ static int seth_tx_pkt(void *data, struct sk_buff *skb, int is_ack)
 	if (seth->is_rawip)
 		skb_pull_inline(skb, ETH_HLEN);
 	blk.length = skb->len;
-	unalign_memcpy(blk.addr, skb->data, skb->len);
+	seth_tx_copy(blk.addr, skb);
 	/* Copy the content into smem and trigger a smsg to the peer side */
 	if (seth->is_rawip)
 		ret = SBLOCK_SEND_PREPARE(pdata->dst, pdata->channel, &blk);
@@ -574,6 +786,60 @@ static bool pkt_use_ackpool(struct sk_buff *skb)
 	return false;
 }
 
+/*
+ * Cut a gso skb into sblocks. The segments are linear and get their
+ * checksums computed while they are cut, each is then copied into an
+ * sblock and the whole super packet is sent with one notification.
+ */
+static int seth_tx_gso(struct net_device *dev, struct sk_buff *skb)
+{
+	struct seth *seth = netdev_priv(dev);
+	struct seth_init_data *pdata = seth->pdata;
+	struct sk_buff *segs, *seg, *next;
+	int ret = SETH_TX_SUCCESS;
+
+	/* don't start a super packet the free sblocks can't hold */
+	if (SBLOCK_GET_FREE_COUNT(pdata->dst, pdata->channel) <
+	    skb_shinfo(skb)->gso_segs) {
+		seth->txstate = DEV_OFF;
+		netif_stop_queue(dev);
+		seth_tx_flush((unsigned long)dev);
+		return NETDEV_TX_BUSY;
+	}
+
+	segs = skb_gso_segment(skb, 0);
+	if (IS_ERR_OR_NULL(segs)) {
+		dev_err(&dev->dev, "gso segment failed(%ld)\n", PTR_ERR(segs));
+		seth->stats.tx_dropped++;
+		dev_kfree_skb_any(skb);
+		return NETDEV_TX_OK;
+	}
+	dev_consume_skb_any(skb);
+
+	for (seg = segs; seg; seg = next) {
+		next = seg->next;
+		seg->next = NULL;
+		if (ret != SETH_TX_NO_BLK)
+			ret = seth_tx_pkt(dev, seg, 0);
+		if (ret != SETH_TX_SUCCESS) {
+			seth->stats.tx_dropped++;
+			dev_kfree_skb_any(seg);
+		}
+	}
+
+	if (ret == SETH_TX_NO_BLK ||
+	    !SBLOCK_GET_FREE_COUNT(pdata->dst, pdata->channel)) {
+		dev_dbg(&dev->dev, "start flow control\n");
+		seth->txstate = DEV_OFF;
+		netif_stop_queue(dev);
+	}
+
+	del_timer(&seth->tx_timer);
+	seth_tx_flush((unsigned long)dev);
+
+	return NETDEV_TX_OK;
+}
+
 /* Transmit interface */
 static int seth_start_xmit(struct sk_buff *skb, struct net_device *dev)
 {
@@ -590,6 +856,25 @@ static int seth_start_xmit(struct sk_buff *skb, struct net_device *dev)
 		return NETDEV_TX_OK;
 	}
 
+	if (skb_is_gso(skb))
+		return seth_tx_gso(dev, skb);
+
+	/*
+	 * The fragments are copied one by one into the sblock, only a frag
+	 * list or a checksum field outside the head need a linear skb. The
+	 * checksum offload advertised for tso is done here.
+	 */
+	if (((skb_has_frag_list(skb) ||
+	      (skb->ip_summed == CHECKSUM_PARTIAL &&
+	       skb_checksum_start_offset(skb) + skb->csum_offset +
+	       sizeof(__sum16) > skb_headlen(skb))) &&
+	     skb_linearize(skb)) ||
+	    (skb->ip_summed == CHECKSUM_PARTIAL && skb_checksum_help(skb))) {
+		seth->stats.tx_dropped++;
+		dev_kfree_skb_any(skb);
+		return NETDEV_TX_OK;
+	}
+
 	/* Update tx statistics */
 	dt_stats = &seth->dt_stats;
 	nodelay = pkt_need_nodelay(skb);
@@ -720,6 +1005,50 @@ static const struct net_device_ops seth_ops = {
 	.ndo_tx_timeout = seth_tx_timeout,
 };
 
+static int seth_get_coalesce(struct net_device *dev,
+			     struct ethtool_coalesce *ec)
+{
+	struct seth *seth = netdev_priv(dev);
+
+	ec->use_adaptive_rx_coalesce = seth->rx_coal.adaptive;
+	ec->rx_coalesce_usecs = seth->rx_coal.usecs;
+	ec->rx_coalesce_usecs_low = seth->rx_coal.usecs_low;
+	ec->rx_coalesce_usecs_high = seth->rx_coal.usecs_high;
+	ec->pkt_rate_low = seth->rx_coal.rate_low;
+	ec->pkt_rate_high = seth->rx_coal.rate_high;
+
+	return 0;
+}
+
+static int seth_set_coalesce(struct net_device *dev,
+			     struct ethtool_coalesce *ec)
+{
+	struct seth *seth = netdev_priv(dev);
+
+	if (ec->rx_coalesce_usecs > SETH_RX_COAL_USECS_MAX ||
+	    ec->rx_coalesce_usecs_low > ec->rx_coalesce_usecs_high ||
+	    ec->rx_coalesce_usecs_high > SETH_RX_COAL_USECS_MAX ||
+	    ec->pkt_rate_low >= ec->pkt_rate_high)
+		return -EINVAL;
+
+	seth->rx_coal.adaptive = !!ec->use_adaptive_rx_coalesce;
+	seth->rx_coal.usecs = ec->rx_coalesce_usecs;
+	seth->rx_coal.usecs_low = ec->rx_coalesce_usecs_low;
+	seth->rx_coal.usecs_high = ec->rx_coalesce_usecs_high;
+	seth->rx_coal.rate_low = ec->pkt_rate_low;
+	seth->rx_coal.rate_high = ec->pkt_rate_high;
+	seth->rx_coal.cur_usecs = seth->rx_coal.adaptive ?
+		seth->rx_coal.usecs_low : seth->rx_coal.usecs;
+
+	return 0;
+}
+
+static const struct ethtool_ops seth_ethtool_ops = {
+	.get_link = ethtool_op_get_link,
+	.get_coalesce = seth_get_coalesce,
+	.set_coalesce = seth_set_coalesce,
+};
+
 static int seth_parse_dt(struct seth_init_data **init, struct device *dev)
 {
 	struct seth_init_data *pdata = NULL;
@@ -848,13 +1177,25 @@ static int seth_probe(struct platform_device *pdev)
 	atomic_set(&seth->rx_busy, 0);
 	atomic_set(&seth->txpending, 0);
 
-	init_timer(&seth->rx_timer);
+	hrtimer_init(&seth->rx_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	seth->rx_timer.function = seth_rx_timer_handler;
+	seth_rx_coal_init(seth);
 	init_timer(&seth->tx_timer);
 	seth_dt_stats_init(&seth->dt_stats);
 	netdev->netdev_ops = &seth_ops;
+	netdev->ethtool_ops = &seth_ethtool_ops;
 	netdev->watchdog_timeo = 1 * HZ;
 	netdev->irq = 0;
 	netdev->dma = 0;
+	/*
+	 * Every packet is copied into an sblock anyway, so take the super
+	 * packets and cut them there, see seth_tx_gso().
+	 */
+	netdev->hw_features = NETIF_F_SG | NETIF_F_IP_CSUM |
+		NETIF_F_IPV6_CSUM | NETIF_F_TSO | NETIF_F_TSO6;
+	netdev->features = netdev->hw_features;
+	netdev->gso_max_segs = min_t(u32, SETH_GSO_MAX_SEGS,
+				     max_t(u32, pdata->blocknum / 2, 1));
 
 	random_ether_addr(netdev->dev_addr);
 
@@ -915,7 +1256,7 @@ static int seth_remove(struct platform_device *pdev)
 	struct seth_init_data *pdata = seth->pdata;
 
 	netif_napi_del(&seth->napi);
-	del_timer_sync(&seth->rx_timer);
+	hrtimer_cancel(&seth->rx_timer);
 	del_timer_sync(&seth->tx_timer);
 	SBLOCK_DESTROY(pdata->dst, pdata->channel);
 	unregister_netdev(seth->netdev);
@@ -970,6 +1311,14 @@ static int seth_debug_show(struct seq_file *m, void *v)
 		m, "rx_alloc_fails=%u, rx_busy=%d\n",
 		stats->rx_alloc_fails,
 		atomic_read(&seth->rx_busy));
+	seq_printf(
+		m, "sfp_fwd_cnt=%u, sfp_fwd_drops=%u\n",
+		stats->sfp_fwd_cnt,
+		stats->sfp_fwd_drops);
+	seq_printf(
+		m, "rx_coal adaptive=%d, repoll_usecs=%u\n",
+		seth->rx_coal.adaptive,
+		seth->rx_coal.cur_usecs);
 
 	seq_puts(m, "\nTX statistics:\n");
 	seq_printf(
@@ -0,0 +1,477 @@
+/*
+ * Copyright (C) 2019 Spreadtrum Communications Inc.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * SIPC round trip benchmark. Every test sends one message, waits for the
+ * modem to echo it back and measures the time in between:
+ *   smsg  : SMSG_CH_BENCH_SMSG, an SMSG_TYPE_EVENT with value = seq,
+ *           the modem sends the same smsg back.
+ *   sbuf  : SMSG_CH_BENCH_SBUF, buffer 0, size bytes starting with a
+ *           struct sipc_bench_hdr, the modem writes them back unchanged.
+ *   sblock: SMSG_CH_BENCH_SBLOCK, one block of size bytes starting with a
+ *           struct sipc_bench_hdr, the modem sends it back in one block.
+ *
+ * debugfs sipc/bench/: dst, size, count and timeout_ms set up the next
+ * run, writing smsg, sbuf or sblock to run runs that test, result shows
+ * the round trip times and the throughput of the last run of each test.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/delay.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/mutex.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/sipc.h>
+
+#include "sipc_debugfs.h"
+
+#define SIPC_BENCH_MAGIC	0x53424348	/* "SBCH" */
+#define SIPC_BENCH_SBUF_SIZE	0x8000
+#define SIPC_BENCH_BLK_NUM	16
+#define SIPC_BENCH_BLK_SIZE	2048
+#define SIPC_BENCH_LAT_US	8192	/* histogram range, the rest is overflow */
+#define SIPC_BENCH_POLL_MS	100
+
+enum {
+	SIPC_BENCH_SMSG,
+	SIPC_BENCH_SBUF,
+	SIPC_BENCH_SBLOCK,
+	SIPC_BENCH_NR
+};
+
+struct sipc_bench_hdr {
+	u32 magic;
+	u32 seq;
+	u32 len;
+	u32 reserved;
+};
+
+struct sipc_bench_stat {
+	u32 size;
+	u32 done;
+	u32 errors;	/* timeouts and wrong echoes */
+	u32 over;	/* beyond the histogram */
+	u64 total_ns;	/* wall time of the run */
+	u64 sum_ns;
+	u64 min_ns;
+	u64 max_ns;
+	u32 p50_us;
+	u32 p90_us;
+	u32 p99_us;
+};
+
+struct sipc_bench_test {
+	const char *name;
+	u8 channel;
+	u32 max_size;
+	int (*open)(u8 dst, int timeout);
+	int (*ping)(u8 dst, u32 seq, u32 size, int timeout);
+};
+
+struct sipc_bench {
+	struct mutex lock;	/* one run at a time, result against the run */
+	u32 dst;
+	u32 size;
+	u32 count;
+	u32 timeout_ms;
+	u16 opened[SIPC_BENCH_NR];	/* bit per dst */
+	u8 *buf;
+	u32 *lat;
+	struct sipc_bench_stat stat[SIPC_BENCH_NR];
+};
+
+static struct sipc_bench s_bench = {
+	.lock = __MUTEX_INITIALIZER(s_bench.lock),
+	.dst = SIPC_ID_LTE,
+	.size = 64,
+	.count = 1000,
+	.timeout_ms = 1000,
+};
+
+static int sipc_bench_smsg_open(u8 dst, int timeout)
+{
+	return smsg_ch_open(dst, SMSG_CH_BENCH_SMSG, timeout);
+}
+
+static int sipc_bench_smsg_ping(u8 dst, u32 seq, u32 size, int timeout)
+{
+	struct smsg msg;
+	int ret;
+
+	smsg_set(&msg, SMSG_CH_BENCH_SMSG, SMSG_TYPE_EVENT, 0, seq);
+	ret = smsg_send(dst, &msg, timeout);
+	if (ret)
+		return ret;
+
+	/* skip the echoes of earlier runs which timed out */
+	do {
+		smsg_set(&msg, SMSG_CH_BENCH_SMSG, 0, 0, 0);
+		ret = smsg_recv(dst, &msg, timeout);
+		if (ret)
+			return ret;
+	} while (msg.type != SMSG_TYPE_EVENT || msg.value != seq);
+
+	return 0;
+}
+
+static int sipc_bench_sbuf_open(u8 dst, int timeout)
+{
+	int ret, waited = 0;
+
+	ret = sbuf_create(dst, SMSG_CH_BENCH_SBUF, 1,
+			  SIPC_BENCH_SBUF_SIZE, SIPC_BENCH_SBUF_SIZE);
+	if (ret)
+		return ret;
+
+	/* the sbuf thread opens the channel */
+	while (sbuf_status(dst, SMSG_CH_BENCH_SBUF)) {
+		if (timeout >= 0 && waited >= timeout) {
+			sbuf_destroy(dst, SMSG_CH_BENCH_SBUF);
+			return -ETIMEDOUT;
+		}
+		msleep(SIPC_BENCH_POLL_MS);
+		waited += SIPC_BENCH_POLL_MS;
+	}
+
+	return 0;
+}
+
+static int sipc_bench_sbuf_ping(u8 dst, u32 seq, u32 size, int timeout)
+{
+	struct sipc_bench_hdr *hdr = (struct sipc_bench_hdr *)s_bench.buf;
+	u32 done;
+	int ret;
+
+	hdr->magic = SIPC_BENCH_MAGIC;
+	hdr->seq = seq;
+	hdr->len = size;
+	for (done = 0; done < size; done += ret) {
+		ret = sbuf_write(dst, SMSG_CH_BENCH_SBUF, 0,
+				 s_bench.buf + done, size - done, timeout);
+		if (ret <= 0)
+			return ret ? ret : -ETIMEDOUT;
+	}
+
+	memset(hdr, 0, sizeof(*hdr));
+	for (done = 0; done < size; done += ret) {
+		ret = sbuf_read(dst, SMSG_CH_BENCH_SBUF, 0,
+				s_bench.buf + done, size - done, timeout);
+		if (ret <= 0)
+			return ret ? ret : -ETIMEDOUT;
+	}
+
+	if (hdr->magic != SIPC_BENCH_MAGIC || hdr->seq != seq ||
+	    hdr->len != size)
+		return -EBADMSG;
+
+	return 0;
+}
+
+static int sipc_bench_sblock_open(u8 dst, int timeout)
+{
+	int ret, waited = 0;
+
+	ret = sblock_create(dst, SMSG_CH_BENCH_SBLOCK,
+			    SIPC_BENCH_BLK_NUM, SIPC_BENCH_BLK_SIZE,
+			    SIPC_BENCH_BLK_NUM, SIPC_BENCH_BLK_SIZE);
+	if (ret)
+		return ret;
+
+	while (sblock_query(dst, SMSG_CH_BENCH_SBLOCK)) {
+		if (timeout >= 0 && waited >= timeout) {
+			sblock_destroy(dst, SMSG_CH_BENCH_SBLOCK);
+			return -ETIMEDOUT;
+		}
+		msleep(SIPC_BENCH_POLL_MS);
+		waited += SIPC_BENCH_POLL_MS;
+	}
+
+	return 0;
+}
+
+static int sipc_bench_sblock_ping(u8 dst, u32 seq, u32 size, int timeout)
+{
+	struct sipc_bench_hdr *hdr = (struct sipc_bench_hdr *)s_bench.buf;
+	struct sblock blk;
+	int ret;
+
+	ret = sblock_get(dst, SMSG_CH_BENCH_SBLOCK, &blk, timeout);
+	if (ret)
+		return ret;
+
+	hdr->magic = SIPC_BENCH_MAGIC;
+	hdr->seq = seq;
+	hdr->len = size;
+	unalign_memcpy(blk.addr, s_bench.buf, size);
+	blk.length = size;
+	ret = sblock_send(dst, SMSG_CH_BENCH_SBLOCK, &blk);
+	if (ret)
+		return ret;
+
+	ret = sblock_receive(dst, SMSG_CH_BENCH_SBLOCK, &blk, timeout);
+	if (ret)
+		return ret;
+
+	unalign_memcpy(hdr, blk.addr, sizeof(*hdr));
+	if (blk.length != size || hdr->magic != SIPC_BENCH_MAGIC ||
+	    hdr->seq != seq)
+		ret = -EBADMSG;
+	sblock_release(dst, SMSG_CH_BENCH_SBLOCK, &blk);
+
+	return ret;
+}
+
+static const struct sipc_bench_test sipc_bench_tests[SIPC_BENCH_NR] = {
+	[SIPC_BENCH_SMSG] = {
+		.name = "smsg",
+		.channel = SMSG_CH_BENCH_SMSG,
+		.max_size = sizeof(struct smsg),
+		.open = sipc_bench_smsg_open,
+		.ping = sipc_bench_smsg_ping,
+	},
+	[SIPC_BENCH_SBUF] = {
+		.name = "sbuf",
+		.channel = SMSG_CH_BENCH_SBUF,
+		.max_size = SIPC_BENCH_SBUF_SIZE / 2,
+		.open = sipc_bench_sbuf_open,
+		.ping = sipc_bench_sbuf_ping,
+	},
+	[SIPC_BENCH_SBLOCK] = {
+		.name = "sblock",
+		.channel = SMSG_CH_BENCH_SBLOCK,
+		.max_size = SIPC_BENCH_BLK_SIZE,
+		.open = sipc_bench_sblock_open,
+		.ping = sipc_bench_sblock_ping,
+	},
+};
+
+/* smallest latency in us that @permille of the round trips did not exceed */
+static u32 sipc_bench_percentile(struct sipc_bench *b, u32 done, u32 permille)
+{
+	u64 want = div_u64((u64)done * permille + 999, 1000), sum = 0;
+	u32 i;
+
+	for (i = 0; i < SIPC_BENCH_LAT_US; i++) {
+		sum += b->lat[i];
+		if (sum >= want)
+			return i;
+	}
+
+	return SIPC_BENCH_LAT_US;
+}
+
+static int sipc_bench_run(struct sipc_bench *b, int id)
+{
+	const struct sipc_bench_test *t = &sipc_bench_tests[id];
+	struct sipc_bench_stat *st = &b->stat[id];
+	u32 size = id == SIPC_BENCH_SMSG ? t->max_size : b->size;
+	int timeout = b->timeout_ms;
+	u64 start, t0, ns, us;
+	u32 seq;
+	int ret;
+
+	if (b->dst >= SIPC_ID_NR || !b->count || size > t->max_size ||
+	    (id != SIPC_BENCH_SMSG && size < sizeof(struct sipc_bench_hdr)))
+		return -EINVAL;
+
+	if (!b->lat) {
+		b->lat = vmalloc(SIPC_BENCH_LAT_US * sizeof(*b->lat));
+		b->buf = kmalloc(SIPC_BENCH_SBUF_SIZE, GFP_KERNEL);
+		if (!b->lat || !b->buf) {
+			vfree(b->lat);
+			kfree(b->buf);
+			b->lat = NULL;
+			b->buf = NULL;
+			return -ENOMEM;
+		}
+	}
+
+	/* the channels stay open, the modem side can't be told otherwise */
+	if (!(b->opened[id] & BIT(b->dst))) {
+		ret = t->open(b->dst, timeout);
+		if (ret) {
+			pr_err("sipc_bench: %s open dst %u failed %d\n",
+			       t->name, b->dst, ret);
+			return ret;
+		}
+		b->opened[id] |= BIT(b->dst);
+	}
+
+	memset(b->lat, 0, SIPC_BENCH_LAT_US * sizeof(*b->lat));
+	memset(b->buf, 0x5a, SIPC_BENCH_SBUF_SIZE);
+	memset(st, 0, sizeof(*st));
+	st->size = size;
+	st->min_ns = U64_MAX;
+
+	start = ktime_get_ns();
+	for (seq = 0; seq < b->count; seq++) {
+		t0 = ktime_get_ns();
+		ret = t->ping(b->dst, seq, size, timeout);
+		ns = ktime_get_ns() - t0;
+		if (ret) {
+			st->errors++;
+			if (ret != -EBADMSG && ret != -ETIME &&
+			    ret != -ETIMEDOUT)
+				break;
+			continue;
+		}
+
+		st->done++;
+		st->sum_ns += ns;
+		st->min_ns = min(st->min_ns, ns);
+		st->max_ns = max(st->max_ns, ns);
+		us = div_u64(ns, NSEC_PER_USEC);
+		if (us < SIPC_BENCH_LAT_US)
+			b->lat[us]++;
+		else
+			st->over++;
+	}
+	st->total_ns = ktime_get_ns() - start;
+
+	if (st->done) {
+		st->p50_us = sipc_bench_percentile(b, st->done, 500);
+		st->p90_us = sipc_bench_percentile(b, st->done, 900);
+		st->p99_us = sipc_bench_percentile(b, st->done, 990);
+	} else {
+		st->min_ns = 0;
+	}
+
+	return 0;
+}
+
+static int sipc_bench_run_show(struct seq_file *m, void *unused)
+{
+	int i;
+
+	for (i = 0; i < SIPC_BENCH_NR; i++)
+		seq_printf(m, "%s ", sipc_bench_tests[i].name);
+	seq_putc(m, '\n');
+	return 0;
+}
+
+static int sipc_bench_run_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sipc_bench_run_show, inode->i_private);
+}
+
+static ssize_t sipc_bench_run_write(struct file *file,
+				    const char __user *ubuf,
+				    size_t len, loff_t *ppos)
+{
+	struct sipc_bench *b = &s_bench;
+	char name[16];
+	int i, ret;
+
+	if (len >= sizeof(name))
+		return -EINVAL;
+	if (copy_from_user(name, ubuf, len))
+		return -EFAULT;
+	name[len] = '\0';
+
+	for (i = 0; i < SIPC_BENCH_NR; i++)
+		if (sysfs_streq(name, sipc_bench_tests[i].name))
+			break;
+	if (i == SIPC_BENCH_NR)
+		return -EINVAL;
+
+	mutex_lock(&b->lock);
+	ret = sipc_bench_run(b, i);
+	mutex_unlock(&b->lock);
+
+	return ret ? ret : len;
+}
+
+static const struct file_operations sipc_bench_run_fops = {
+	.open = sipc_bench_run_open,
+	.read = seq_read,
+	.write = sipc_bench_run_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int sipc_bench_result_show(struct seq_file *m, void *unused)
+{
+	struct sipc_bench *b = &s_bench;
+	struct sipc_bench_stat *st;
+	u64 kbps;
+	int i;
+
+	mutex_lock(&b->lock);
+	seq_printf(m, "%-7s %6s %8s %6s %8s %8s %8s %6s %6s %6s %8s %10s\n",
+		   "test", "size", "done", "errors", "min_us", "avg_us",
+		   "max_us", "p50", "p90", "p99", "rtt/s", "echo_KB/s");
+	for (i = 0; i < SIPC_BENCH_NR; i++) {
+		st = &b->stat[i];
+		if (!st->total_ns)
+			continue;
+
+		/* bytes which went both ways per second */
+		kbps = div64_u64((u64)st->done * st->size * 2 * NSEC_PER_SEC,
+				 st->total_ns * 1024);
+		seq_printf(m, "%-7s %6u %8u %6u %8llu %8llu %8llu %6u %6u %6u %8llu %10llu\n",
+			   sipc_bench_tests[i].name, st->size, st->done,
+			   st->errors, div_u64(st->min_ns, NSEC_PER_USEC),
+			   st->done ? div_u64(div_u64(st->sum_ns, st->done),
+					      NSEC_PER_USEC) : 0,
+			   div_u64(st->max_ns, NSEC_PER_USEC),
+			   st->p50_us, st->p90_us, st->p99_us,
+			   div64_u64((u64)st->done * NSEC_PER_SEC,
+				     st->total_ns), kbps);
+		if (st->over)
+			seq_printf(m, "%-7s %u round trips over %u us\n",
+				   sipc_bench_tests[i].name, st->over,
+				   SIPC_BENCH_LAT_US);
+	}
+	mutex_unlock(&b->lock);
+
+	return 0;
+}
+
+static int sipc_bench_result_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sipc_bench_result_show, inode->i_private);
+}
+
+static const struct file_operations sipc_bench_result_fops = {
+	.open = sipc_bench_result_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+int sipc_bench_init_debugfs(void *root)
+{
+	struct dentry *dir;
+
+	if (!root)
+		return -ENXIO;
+
+	dir = debugfs_create_dir("bench", (struct dentry *)root);
+	if (!dir)
+		return -ENOMEM;
+
+	debugfs_create_u32("dst", 0644, dir, &s_bench.dst);
+	debugfs_create_u32("size", 0644, dir, &s_bench.size);
+	debugfs_create_u32("count", 0644, dir, &s_bench.count);
+	debugfs_create_u32("timeout_ms", 0644, dir, &s_bench.timeout_ms);
+	debugfs_create_file("run", 0644, dir, NULL, &sipc_bench_run_fops);
+	debugfs_create_file("result", 0444, dir, NULL,
+			    &sipc_bench_result_fops);
+
+	return 0;
+}
@@ -42,6 +42,9 @@ static int __init sipc_init_debugfs(void)
 	swcnblk_init_debugfs(root);
 #endif
 	smem_init_debugfs(root);
+#ifdef CONFIG_SPRD_SIPC_BENCH
+	sipc_bench_init_debugfs(root);
+#endif
 #ifdef CONFIG_SPRD_MAILBOX
 	mbox_init_debugfs(root);
 #endif
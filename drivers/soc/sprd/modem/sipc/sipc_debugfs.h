@@ -28,6 +28,10 @@ int swcnblk_init_debugfs(void *root);
 int smsgc_init_debugfs(void *root);
 #endif
 
+#ifdef CONFIG_SPRD_SIPC_BENCH
+int sipc_bench_init_debugfs(void *root);
+#endif
+
 #ifdef CONFIG_SPRD_MAILBOX
 int mbox_init_debugfs(void *root);
 #endif
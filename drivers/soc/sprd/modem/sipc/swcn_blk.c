@@ -818,6 +818,74 @@ int swcnblk_receive(u8 dst, u8 channel,
 }
 EXPORT_SYMBOL(swcnblk_receive);
 
+/*
+ * Take up to num arrived blocks without waiting, under one lock hold.
+ * Blocks which follow each other in the shared memory are invalidated
+ * as one range. Returns the number of blocks taken, -ENODATA if none.
+ */
+int swcnblk_receive_batch(u8 dst, u8 channel,
+			  struct swcnblk_blk *blks, int num)
+{
+	struct swcnblk_mgr *swcnblk;
+	struct swcnblk_ring *ring;
+	VOLA_SWCNBLK_RING *ringhd;
+	int rxpos, index, i, n;
+	unsigned long flags;
+#ifdef SPRD_SWCN_MEM_CACHE_EN
+	void *start, *end;
+#endif
+
+	SWCNBLK_GET_BLK_MGR(dst, channel, swcnblk);
+	if (!swcnblk || swcnblk->state != SWCNBLK_STATE_READY) {
+		pr_err("%s:swcnblk-%d-%d not ready!\n",
+		       __func__, dst, channel);
+		return swcnblk ? -EIO : -ENODEV;
+	}
+
+	ring = swcnblk->ring;
+	ringhd = (VOLA_SWCNBLK_RING *)(&ring->header->ring);
+
+	spin_lock_irqsave(&ring->r_rxlock, flags);
+	n = min_t(int, num, (int)(ringhd->rxblk_wrptr - ringhd->rxblk_rdptr));
+	for (i = 0; i < n; i++) {
+		rxpos = swcnblk_get_ringpos(ringhd->rxblk_rdptr,
+					    ringhd->rxblk_count);
+		blks[i].addr = ring->r_rxblks[rxpos].addr -
+			       swcnblk->mapped_smem_addr +
+			       swcnblk->smem_blk_virt;
+		blks[i].length = ring->r_rxblks[rxpos].length;
+		ringhd->rxblk_rdptr = ringhd->rxblk_rdptr + 1;
+		index = swcnblk_get_index((blks[i].addr - ring->rxblk_virt),
+					  swcnblk->rxblksz);
+		ring->rxrecord[index] = SWCNBLK_BLK_STATE_PENDING;
+	}
+	spin_unlock_irqrestore(&ring->r_rxlock, flags);
+
+	pr_debug("swcnblk receive batch: channel=%d, num=%d, got=%d\n",
+		 channel, num, n);
+
+	if (!n)
+		return -ENODATA;
+
+#ifdef SPRD_SWCN_MEM_CACHE_EN
+	start = blks[0].addr;
+	end = start + blks[0].length;
+	for (i = 1; i < n; i++) {
+		if (blks[i].addr == end) {
+			end = blks[i].addr + blks[i].length;
+			continue;
+		}
+		SWCN_DATA_TO_SKB_CACHE_INV(start, end);
+		start = blks[i].addr;
+		end = start + blks[i].length;
+	}
+	SWCN_DATA_TO_SKB_CACHE_INV(start, end);
+#endif
+
+	return n;
+}
+EXPORT_SYMBOL(swcnblk_receive_batch);
+
 int swcnblk_get_arrived_count(u8 dst, u8 channel)
 {
 	struct swcnblk_mgr *swcnblk;
@@ -924,6 +992,67 @@ int swcnblk_release(u8 dst, u8 channel, struct swcnblk_blk *blk)
 }
 EXPORT_SYMBOL(swcnblk_release);
 
+/* release num blocks under one lock hold, with at most one notify */
+int swcnblk_release_batch(u8 dst, u8 channel,
+			  struct swcnblk_blk *blks, int num)
+{
+	struct swcnblk_mgr *swcnblk;
+	struct swcnblk_ring *ring = NULL;
+	VOLA_SWCNBLK_RING *poolhd = NULL;
+	struct smsg mevt;
+	unsigned long flags;
+	bool was_empty;
+	int rxpos;
+	int index;
+	int i;
+
+	SWCNBLK_GET_BLK_MGR(dst, channel, swcnblk);
+	if (!swcnblk || swcnblk->state != SWCNBLK_STATE_READY) {
+		pr_err("%s:swcnblk-%d-%d not ready!\n",
+		       __func__, dst, channel);
+		return swcnblk ? -EIO : -ENODEV;
+	}
+
+	pr_debug("swcnblk release batch: dst=%d, channel=%d, num=%d\n",
+		 dst, channel, num);
+
+	if (num <= 0)
+		return 0;
+
+	ring = swcnblk->ring;
+	poolhd = (VOLA_SWCNBLK_RING *)(&ring->header->pool);
+
+	spin_lock_irqsave(&ring->p_rxlock, flags);
+	was_empty = poolhd->rxblk_wrptr == poolhd->rxblk_rdptr;
+	for (i = 0; i < num; i++) {
+		rxpos = swcnblk_get_ringpos(poolhd->rxblk_wrptr,
+					    poolhd->rxblk_count);
+		ring->p_rxblks[rxpos].addr = blks[i].addr -
+					     swcnblk->smem_blk_virt +
+					     swcnblk->mapped_smem_addr;
+		ring->p_rxblks[rxpos].length = poolhd->rxblk_size;
+		poolhd->rxblk_wrptr = poolhd->rxblk_wrptr + 1;
+
+		index = swcnblk_get_index((blks[i].addr - ring->rxblk_virt),
+					  swcnblk->rxblksz);
+		ring->rxrecord[index] = SWCNBLK_BLK_STATE_DONE;
+	}
+
+	/* the peer only waits for the pool to become non-empty */
+	if (was_empty && swcnblk->state == SWCNBLK_STATE_READY) {
+		smsg_set(&mevt, channel,
+			 SMSG_TYPE_EVENT,
+			 SMSG_EVENT_SWCNBLK_RELEASE,
+			 0);
+		smsg_send(dst, &mevt, -1);
+	}
+
+	spin_unlock_irqrestore(&ring->p_rxlock, flags);
+
+	return 0;
+}
+EXPORT_SYMBOL(swcnblk_release_batch);
+
 int swcnblk_poll_wait(u8 dst, u8 channel, struct file *filp, poll_table *wait)
 {
 	struct swcnblk_mgr *swcnblk = NULL;
@@ -29,6 +29,7 @@
 #include <linux/wait.h>
 #include <linux/sipc.h>
 #include <uapi/linux/sched/types.h>
+#include <asm/cacheflush.h>
 
 #include "sipc_priv.h"
 #include "sblock.h"
@@ -120,6 +121,41 @@ static bool sblock_has_data(struct sblock_mgr *sblock, bool tx)
 	return has_data;
 }
 
+/*
+ * Map the rx blocks a second time as cached memory, smem_phys is the
+ * physical address of smem_virt. Only the peer writes the rx blocks, so
+ * the alias is never dirty and a reader only has to invalidate it. Not
+ * having the alias is fine, sblock_rx_data() then falls back to the
+ * uncached mapping.
+ */
+static void sblock_rx_cached_map(struct sblock_mgr *sblock,
+				 phys_addr_t smem_phys)
+{
+#ifdef CONFIG_SPRD_SIPC_SBLOCK_RX_CACHED
+	struct sblock_ring *ring = sblock->ring;
+
+	if (smsg_ipcs[sblock->dst]->smem_type != SMEM_LOCAL)
+		return;
+
+	ring->rxblk_cached_virt = shmem_ram_vmap_cache(sblock->dst,
+		smem_phys + (ring->rxblk_virt - sblock->smem_virt),
+		sblock->rxblknum * sblock->rxblksz);
+	if (!ring->rxblk_cached_virt)
+		pr_warn("%s: channel %d-%d, no cached rx mapping\n",
+			__func__, sblock->dst, sblock->channel);
+#endif
+}
+
+static void sblock_rx_cached_unmap(struct sblock_mgr *sblock)
+{
+#ifdef CONFIG_SPRD_SIPC_SBLOCK_RX_CACHED
+	if (sblock->ring->rxblk_cached_virt) {
+		shmem_ram_unmap(sblock->dst, sblock->ring->rxblk_cached_virt);
+		sblock->ring->rxblk_cached_virt = NULL;
+	}
+#endif
+}
+
 /* clean rings and recover pools */
 static int sblock_recover(u8 dst, u8 channel)
 {
@@ -407,6 +443,8 @@ static int sblock_host_init(struct smsg_ipc *sipc, struct sblock_mgr *sblock,
 	/* release resource */
 	sipc_smem_release_resource(sipc->sipc_pms, sipc->dst);
 
+	sblock_rx_cached_map(sblock, sblock->smem_addr + offset);
+
 	return 0;
 
 sblock_host_rx_free:
@@ -591,6 +629,8 @@ static int sblock_client_init(struct smsg_ipc *sipc, struct sblock_mgr *sblock)
 	/* release resource */
 	sipc_smem_release_resource(sipc->sipc_pms, sipc->dst);
 
+	sblock_rx_cached_map(sblock, sblock->smem_addr + offset);
+
 	return 0;
 
 sblock_client_tx_free:
@@ -603,17 +643,137 @@ sblock_client_smem_free:
 	return rval;
 }
 
-static int sblock_thread(void *data)
+static void sblock_handle_msg(struct sblock_mgr *sblock, struct smsg *mrecv)
 {
-	struct sblock_mgr *sblock = data;
-	struct smsg mcmd, mrecv;
+	struct smsg mcmd;
 	unsigned long flags;
+	int rval = 0;
+	struct sblock_ring *ring;
+
+	pr_debug("sblock recv msg: dst=%d, channel=%d, type=%d, flag=0x%04x, value=0x%08x\n",
+		 sblock->dst, sblock->channel,
+		 mrecv->type, mrecv->flag, mrecv->value);
+
+	switch (mrecv->type) {
+	case SMSG_TYPE_OPEN:
+		pr_info("%s: channel %d-%d,revc open!\n",
+			__func__,
+			sblock->dst,
+			sblock->channel);
+		/* handle channel recovery */
+		if (sblock->recovery) {
+			if (sblock->handler)
+				sblock->handler(SBLOCK_NOTIFY_CLOSE,
+						sblock->data);
+			sblock_recover(sblock->dst, sblock->channel);
+		}
+		smsg_open_ack(sblock->dst, sblock->channel);
+		if (sblock->pre_cfg)
+			sblock->state = SBLOCK_STATE_READY;
+		break;
+	case SMSG_TYPE_CLOSE:
+		/* handle channel recovery */
+		smsg_close_ack(sblock->dst, sblock->channel);
+		if (sblock->handler)
+			sblock->handler(SBLOCK_NOTIFY_CLOSE,
+					sblock->data);
+		sblock->state = SBLOCK_STATE_IDLE;
+		break;
+	case SMSG_TYPE_CMD:
+		if (!sblock->pre_cfg) {
+			/* respond cmd done for sblock init */
+			WARN_ON(mrecv->flag != SMSG_CMD_SBLOCK_INIT);
+			smsg_set(&mcmd,
+				 sblock->channel,
+				 SMSG_TYPE_DONE,
+				 SMSG_DONE_SBLOCK_INIT,
+				 sblock->dst_smem_addr);
+			smsg_send(sblock->dst, &mcmd, -1);
+			sblock->state = SBLOCK_STATE_READY;
+			sblock->recovery = 1;
+			pr_info("%s: channel %d-%d, SMSG_CMD_SBLOCK_INIT, dst address = 0x%x!\n",
+				__func__,
+				sblock->dst,
+				sblock->channel,
+				sblock->dst_smem_addr);
+
+			if (sblock->handler)
+				sblock->handler(SBLOCK_NOTIFY_OPEN,
+						sblock->data);
+		}
+		break;
+	case SMSG_TYPE_EVENT:
+		/* handle sblock send/release events */
+		switch (mrecv->flag) {
+		case SMSG_EVENT_SBLOCK_SEND:
+			ring = sblock->ring;
+			/* set read mask. */
+			spin_lock_irqsave(&ring->poll_lock, flags);
+			ring->poll_mask |= POLLIN | POLLRDNORM;
+			spin_unlock_irqrestore(&ring->poll_lock, flags);
+			wake_up_interruptible_all(&sblock->ring->recvwait);
+			if (sblock->handler)
+				sblock->handler(SBLOCK_NOTIFY_RECV,
+						sblock->data);
+			break;
+		case SMSG_EVENT_SBLOCK_RELEASE:
+			ring = sblock->ring;
+			/* set write mask. */
+			spin_lock_irqsave(&ring->poll_lock, flags);
+			ring->poll_mask |= POLLOUT | POLLWRNORM;
+			spin_unlock_irqrestore(&ring->poll_lock, flags);
+			wake_up_interruptible_all(&sblock->ring->getwait);
+			if (sblock->handler)
+				sblock->handler(SBLOCK_NOTIFY_GET,
+						sblock->data);
+			break;
+		default:
+			rval = 1;
+			break;
+		}
+		break;
+	default:
+		rval = 1;
+		break;
+	}
+
+	if (rval)
+		pr_info("non-handled sblock msg: %d-%d, %d, %d, %d\n",
+			sblock->dst, sblock->channel,
+			mrecv->type, mrecv->flag, mrecv->value);
+}
+
+/*
+ * Runs on the shared worker of the channel priority class whenever msgs
+ * got cached, takes at most SMSG_WORK_BATCH of them per round.
+ */
+static void sblock_work(struct kthread_work *work)
+{
+	struct sblock_mgr *sblock = container_of(work, struct sblock_mgr,
+						 work);
+	struct smsg mrecv;
+	int i;
+
+	for (i = 0; i < SMSG_WORK_BATCH; i++) {
+		smsg_set(&mrecv, sblock->channel, 0, 0, 0);
+		if (smsg_recv(sblock->dst, &mrecv, 0))
+			return;
+
+		sblock_handle_msg(sblock, &mrecv);
+	}
+
+	smsg_ch_kick_work(sblock->dst, sblock->channel);
+}
+
+static void sblock_open_work(struct work_struct *work)
+{
+	struct sblock_mgr *sblock = container_of(work, struct sblock_mgr,
+						 open_work);
+	struct smsg mcmd, mrecv;
 	int rval;
-	int recovery = 0;
 	struct smsg_ipc *sipc;
-	struct sblock_ring *ring;
 
-	/* since the channel open may hang, we call it in the sblock thread */
+	/* since the channel open may hang, we call it in a work */
 	rval = smsg_ch_open(sblock->dst, sblock->channel, -1);
 	if (rval != 0) {
 		pr_err("Failed to open channel %d\n",
@@ -624,12 +784,12 @@ static int sblock_thread(void *data)
 					sblock->data);
 		}
 
-		return rval;
+		return;
 	}
 
 	if (sblock->pre_cfg) {
 		sblock->state = SBLOCK_STATE_READY;
-		recovery = 1;
+		sblock->recovery = 1;
 		if (sblock->handler)
 			sblock->handler(SBLOCK_NOTIFY_OPEN, sblock->data);
 	}
@@ -643,10 +803,8 @@ static int sblock_thread(void *data)
 		do {
 			smsg_set(&mrecv, sblock->channel, 0, 0, 0);
 			rval = smsg_recv(sblock->dst, &mrecv, -1);
-			if (rval != 0) {
-				sblock->thread = NULL;
-				return rval;
-			}
+			if (rval != 0)
+				return;
 		} while (mrecv.type != SMSG_TYPE_DONE ||
 			 mrecv.flag != SMSG_DONE_SBLOCK_INIT);
 		sblock->smem_addr = mrecv.value;
@@ -655,125 +813,27 @@ static int sblock_thread(void *data)
 			sblock->dst,
 			sblock->channel,
 			sblock->smem_addr);
-		if (sblock_client_init(sipc, sblock)) {
-			sblock->thread = NULL;
-			return 0;
-		}
+		if (sblock_client_init(sipc, sblock))
+			return;
 		sblock->state = SBLOCK_STATE_READY;
 		if (sblock->handler)
 			sblock->handler(SBLOCK_NOTIFY_OPEN,
 					sblock->data);
 	}
 
-	/* handle the sblock events */
-	while (!kthread_should_stop()) {
-		/* monitor sblock recv smsg */
-		smsg_set(&mrecv, sblock->channel, 0, 0, 0);
-		rval = smsg_recv(sblock->dst, &mrecv, -1);
-		if (rval == -EIO || rval == -ENODEV) {
-			/* channel state is FREE */
-			msleep(20);
-			continue;
-		}
-
-		pr_debug("sblock thread recv msg: dst=%d, channel=%d, type=%d, flag=0x%04x, value=0x%08x\n",
-			 sblock->dst, sblock->channel,
-			 mrecv.type, mrecv.flag, mrecv.value);
-
-		switch (mrecv.type) {
-		case SMSG_TYPE_OPEN:
-			pr_info("%s: channel %d-%d,revc open!\n",
-				__func__,
-				sblock->dst,
-				sblock->channel);
-			/* handle channel recovery */
-			if (recovery) {
-				if (sblock->handler)
-					sblock->handler(SBLOCK_NOTIFY_CLOSE,
-							sblock->data);
-				sblock_recover(sblock->dst, sblock->channel);
-			}
-			smsg_open_ack(sblock->dst, sblock->channel);
-			if (sblock->pre_cfg)
-				sblock->state = SBLOCK_STATE_READY;
-			break;
-		case SMSG_TYPE_CLOSE:
-			/* handle channel recovery */
-			smsg_close_ack(sblock->dst, sblock->channel);
-			if (sblock->handler)
-				sblock->handler(SBLOCK_NOTIFY_CLOSE,
-						sblock->data);
-			sblock->state = SBLOCK_STATE_IDLE;
-			break;
-		case SMSG_TYPE_CMD:
-			if (!sblock->pre_cfg) {
-				/* respond cmd done for sblock init */
-				WARN_ON(mrecv.flag != SMSG_CMD_SBLOCK_INIT);
-				smsg_set(&mcmd,
-					 sblock->channel,
-					 SMSG_TYPE_DONE,
-					 SMSG_DONE_SBLOCK_INIT,
-					 sblock->dst_smem_addr);
-				smsg_send(sblock->dst, &mcmd, -1);
-				sblock->state = SBLOCK_STATE_READY;
-				recovery = 1;
-				pr_info("%s: channel %d-%d, SMSG_CMD_SBLOCK_INIT, dst address = 0x%x!\n",
-					__func__,
-					sblock->dst,
-					sblock->channel,
-					sblock->dst_smem_addr);
-
-				if (sblock->handler)
-					sblock->handler(SBLOCK_NOTIFY_OPEN,
-							sblock->data);
-			}
-			break;
-		case SMSG_TYPE_EVENT:
-			/* handle sblock send/release events */
-			switch (mrecv.flag) {
-			case SMSG_EVENT_SBLOCK_SEND:
-				ring = sblock->ring;
-				/* set read mask. */
-				spin_lock_irqsave(&ring->poll_lock, flags);
-				ring->poll_mask |= POLLIN | POLLRDNORM;
-				spin_unlock_irqrestore(&ring->poll_lock, flags);
-				wake_up_interruptible_all(&sblock->ring->recvwait);
-				if (sblock->handler)
-					sblock->handler(SBLOCK_NOTIFY_RECV,
-							sblock->data);
-				break;
-			case SMSG_EVENT_SBLOCK_RELEASE:
-				ring = sblock->ring;
-				/* set write mask. */
-				spin_lock_irqsave(&ring->poll_lock, flags);
-				ring->poll_mask |= POLLOUT | POLLWRNORM;
-				spin_unlock_irqrestore(&ring->poll_lock, flags);
-				wake_up_interruptible_all(&sblock->ring->getwait);
-				if (sblock->handler)
-					sblock->handler(SBLOCK_NOTIFY_GET,
-							sblock->data);
-				break;
-			default:
-				rval = 1;
-				break;
-			}
-			break;
-		default:
-			rval = 1;
-			break;
-		};
-
-		if (rval) {
-			pr_info("non-handled sblock msg: %d-%d, %d, %d, %d\n",
-				sblock->dst, sblock->channel,
-				mrecv.type, mrecv.flag, mrecv.value);
-			rval = 0;
-		}
-	}
+	/* the sblock events go to the shared worker */
+	rval = smsg_ch_set_work(sblock->dst, sblock->channel, &sblock->work);
+	if (rval)
+		pr_err("%s: channel %d-%d, set work failed %d\n",
+		       __func__, sblock->dst, sblock->channel, rval);
+}
 
-	pr_info("sblock %d-%d thread stop",
-		sblock->dst, sblock->channel);
-	return rval;
+static void sblock_start(struct sblock_mgr *sblock)
+{
+	sblock->started = true;
+	INIT_WORK(&sblock->open_work, sblock_open_work);
+	kthread_init_work(&sblock->work, sblock_work);
+	queue_work(system_unbound_wq, &sblock->open_work);
 }
 
 static void sblock_pms_init(uint8_t dst, uint8_t ch, struct sblock_ring *ring)
@@ -861,8 +921,6 @@ int sblock_create_ex(u8 dst, u8 channel,
 	struct sblock_mgr *sblock = NULL;
 	int result;
 	u8 ch_index;
-	struct smsg_ipc *sipc;
-	struct sched_param param = {.sched_priority = 88};
 
 	ch_index = sipc_channel2index(channel);
 	if (ch_index == INVALID_CHANEL_INDEX) {
@@ -882,29 +940,6 @@ int sblock_create_ex(u8 dst, u8 channel,
 				   rxblocknum, rxblocksize,
 				   &sblock);
 	if (!result) {
-		sblock->thread = kthread_create(sblock_thread, sblock,
-						"sblock-%d-%d", dst, channel);
-		if (IS_ERR(sblock->thread)) {
-			pr_err("Failed to create kthread: sblock-%d-%d\n",
-				dst, channel);
-			sipc = smsg_ipcs[sblock->dst];
-			if (!sipc->client) {
-				shmem_ram_unmap(dst, sblock->smem_virt);
-				smem_free(dst,
-					  sblock->smem_addr,
-					  sblock->smem_size);
-				kfree(sblock->ring->txrecord);
-				kfree(sblock->ring->rxrecord);
-			}
-			kfree(sblock->ring);
-			result = PTR_ERR(sblock->thread);
-			kfree(sblock);
-			return result;
-		}
-
-		/* Prevent the thread task_struct from being destroyed. */
-		get_task_struct(sblock->thread);
-
 		sblocks[dst][ch_index] = sblock;
 		if ((handler != NULL) && (data != NULL)) {
 			result = sblock_register_notifier(dst, channel,
@@ -914,9 +949,7 @@ int sblock_create_ex(u8 dst, u8 channel,
 				return result;
 			}
 		}
-		/*set the thread as a real time thread, and its priority is 11*/
-		sched_setscheduler(sblock->thread, SCHED_RR, &param);
-		wake_up_process(sblock->thread);
+		sblock_start(sblock);
 	}
 
 	pr_debug("%s: sblock-%d-%d create over, result = %d\n",
@@ -962,40 +995,8 @@ int sblock_pcfg_create(u8 dst, u8 channel,
 				   rx_blk_num, rx_blk_sz,
 				   &sblock);
 	if (!result) {
-		struct sched_param param = {.sched_priority = 88};
-
-		sblock->thread = kthread_create(sblock_thread, sblock,
-						"sblock-%d-%d", dst, channel);
-		if (IS_ERR(sblock->thread)) {
-			struct smsg_ipc *sipc;
-
-			pr_err("Failed to create kthread: sblock-%d-%d\n",
-				dst, channel);
-			sipc = smsg_ipcs[sblock->dst];
-			if (!sipc->client) {
-				shmem_ram_unmap(dst, sblock->smem_virt);
-				smem_free(dst,
-					  sblock->smem_addr,
-					  sblock->smem_size);
-				kfree(sblock->ring->txrecord);
-				kfree(sblock->ring->rxrecord);
-			}
-			kfree(sblock->ring);
-			result = PTR_ERR(sblock->thread);
-			kfree(sblock);
-			return result;
-		}
-
-		/* Prevent the thread task_struct from being destroyed. */
-		get_task_struct(sblock->thread);
-
 		sblocks[dst][ch_index] = sblock;
-		/*
-		 * Set the thread as a real time thread, and its priority
-		 * is 11.
-		 */
-		sched_setscheduler(sblock->thread, SCHED_RR, &param);
-		wake_up_process(sblock->thread);
+		sblock_start(sblock);
 	}
 
 	return result;
@@ -1021,15 +1022,16 @@ void sblock_destroy(u8 dst, u8 channel)
 	sblock->state = SBLOCK_STATE_IDLE;
 	smsg_ch_close(dst, channel, -1);
 
-	/* stop sblock thread if it's created successfully and still alive */
-	if (!IS_ERR_OR_NULL(sblock->thread)) {
-		kthread_stop(sblock->thread);
-		put_task_struct(sblock->thread);
-		sblock->thread = NULL;
+	/* the close above fails a still pending open, then stop the rx work */
+	if (sblock->started) {
+		cancel_work_sync(&sblock->open_work);
+		smsg_ch_clear_work(dst, channel);
+		sblock->started = false;
 	}
 
 	if (sblock->ring) {
 		sblock_pms_destroy(sblock->ring);
+		sblock_rx_cached_unmap(sblock);
 		wake_up_interruptible_all(&sblock->ring->recvwait);
 		wake_up_interruptible_all(&sblock->ring->getwait);
 		/* kfree(NULL) is safe */
@@ -1059,8 +1061,6 @@ int sblock_pcfg_open(uint8_t dest, uint8_t channel,
 {
 	struct sblock_mgr *sblock;
 	uint8_t idx;
-	int ret;
-	struct sched_param param = {.sched_priority = 88};
 
 	pr_debug("%s: dst=%d channel=%d\n", __func__, dest, channel);
 
@@ -1080,7 +1080,7 @@ int sblock_pcfg_open(uint8_t dest, uint8_t channel,
 	if (!sblock->pre_cfg)
 		return -EINVAL;
 
-	if (sblock->thread) {
+	if (sblock->started) {
 		pr_err("%s: SBLOCK %u/%u already open",
 		       __func__,
 		       (unsigned int)sblock->dst,
@@ -1088,25 +1088,11 @@ int sblock_pcfg_open(uint8_t dest, uint8_t channel,
 		return -EPROTO;
 	}
 
-	ret = 0;
-	sblock->thread = kthread_create(sblock_thread, sblock,
-					"sblock-%d-%d", dest, channel);
-	if (IS_ERR(sblock->thread)) {
-		pr_err("%s: create thread error\n", __func__);
-		sblock->thread = NULL;
-		ret = -EBUSY;
-	} else {
-		/* Prevent the thread task_struct from being destroyed. */
-		get_task_struct(sblock->thread);
+	sblock->handler = notifier;
+	sblock->data = client;
+	sblock_start(sblock);
 
-		sblock->handler = notifier;
-		sblock->data = client;
-		/*set the thread as a real time thread, and its priority is 11*/
-		sched_setscheduler(sblock->thread, SCHED_RR, &param);
-		wake_up_process(sblock->thread);
-	}
-
-	return ret;
+	return 0;
 }
 EXPORT_SYMBOL_GPL(sblock_pcfg_open);
 
@@ -1569,6 +1555,92 @@ int sblock_receive(u8 dst, u8 channel,
 }
 EXPORT_SYMBOL_GPL(sblock_receive);
 
+int sblock_receive_bulk(u8 dst, u8 channel, struct sblock *blks, int n)
+{
+	struct sblock_mgr *sblock;
+	struct sblock_ring *ring;
+	struct sblock_ring_header_op *ringhd_op;
+	int rxpos, index, rval, cnt = 0;
+	unsigned long flags;
+	u8 ch_index;
+	u32 diff;
+
+	ch_index = sipc_channel2index(channel);
+	if (ch_index == INVALID_CHANEL_INDEX) {
+		pr_err("%s:channel %d invalid!\n", __func__, channel);
+		return -EINVAL;
+	}
+
+	sblock = sblocks[dst][ch_index];
+	if (!sblock || sblock->state != SBLOCK_STATE_READY) {
+		pr_err("%s:sblock-%d-%d not ready!\n", __func__, dst, channel);
+		return sblock ? -EIO : -ENODEV;
+	}
+
+	if (n <= 0)
+		return 0;
+
+	ring = sblock->ring;
+	ringhd_op = &(ring->header_op.ringhd_op);
+
+	/* must request resource before read or write share memory */
+	rval = sipc_smem_request_resource(ring->rx_pms, dst, 0);
+	if (rval < 0)
+		return rval;
+
+	spin_lock_irqsave(&ring->r_rxlock, flags);
+	while (cnt < n && *(ringhd_op->rx_wt_p) != *(ringhd_op->rx_rd_p) &&
+	       sblock->state == SBLOCK_STATE_READY) {
+		rxpos = sblock_get_ringpos(*(ringhd_op->rx_rd_p),
+					   ringhd_op->rx_count);
+		diff = ring->r_rxblks[rxpos].addr -
+			sblock->stored_smem_addr;
+		if (diff >= sblock->smem_size) {
+			pr_err("%s, %d- %d, 0x%x, 0x%x", __func__,
+				dst, channel, rxpos,
+				ring->r_rxblks[rxpos].addr);
+			panic("sblock receive dst= %d- %d error!",
+				dst, channel);
+		}
+
+		blks[cnt].addr = diff + sblock->smem_virt;
+		blks[cnt].length = ring->r_rxblks[rxpos].length;
+		*(ringhd_op->rx_rd_p) = *(ringhd_op->rx_rd_p) + 1;
+		index = sblock_get_index((blks[cnt].addr - ring->rxblk_virt),
+					 sblock->rxblksz);
+		ring->rxrecord[index] = SBLOCK_BLK_STATE_PENDING;
+		cnt++;
+	}
+	spin_unlock_irqrestore(&ring->r_rxlock, flags);
+
+	spin_lock_irqsave(&ring->poll_lock, flags);
+	/* update read mask */
+	if (*(ringhd_op->rx_wt_p) == *(ringhd_op->rx_rd_p))
+		ring->poll_mask &= ~(POLLIN | POLLRDNORM);
+	else
+		ring->poll_mask |= POLLIN | POLLRDNORM;
+	spin_unlock_irqrestore(&ring->poll_lock, flags);
+
+	pr_debug("%s: channel=%d, got %d of %d\n",
+		 __func__, channel, cnt, n);
+
+	/*
+	 * Every received block holds one resource reference, which
+	 * sblock_release or sblock_release_bulk drops again. The one taken
+	 * above goes to the first block, the pms is known to be up now so
+	 * the others are only a reference count.
+	 */
+	if (!cnt) {
+		sipc_smem_release_resource(ring->rx_pms, dst);
+		return sblock->state == SBLOCK_STATE_READY ? 0 : -EIO;
+	}
+	for (index = 1; index < cnt; index++)
+		sipc_smem_request_resource(ring->rx_pms, dst, 0);
+
+	return cnt;
+}
+EXPORT_SYMBOL_GPL(sblock_receive_bulk);
+
 int sblock_get_arrived_count(u8 dst, u8 channel)
 {
 	struct sblock_mgr *sblock;
@@ -1719,6 +1791,106 @@ int sblock_release(u8 dst, u8 channel, struct sblock *blk)
 }
 EXPORT_SYMBOL_GPL(sblock_release);
 
+int sblock_release_bulk(u8 dst, u8 channel, struct sblock *blks, int n)
+{
+	struct sblock_mgr *sblock;
+	struct sblock_ring *ring;
+	struct sblock_ring_header_op *poolhd_op;
+	struct smsg mevt;
+	unsigned long flags;
+	int rxpos;
+	int index;
+	int i;
+	u8 ch_index;
+	bool send_event = false;
+
+	if (n <= 0)
+		return 0;
+
+	ch_index = sipc_channel2index(channel);
+	if (ch_index == INVALID_CHANEL_INDEX) {
+		pr_err("%s:channel %d invalid!\n", __func__, channel);
+		return -EINVAL;
+	}
+
+	sblock = sblocks[dst][ch_index];
+	if (!sblock || sblock->state != SBLOCK_STATE_READY) {
+		pr_err("%s:sblock-%d-%d not ready!\n", __func__, dst, channel);
+		return -ENODEV;
+	}
+
+	ring = sblock->ring;
+	poolhd_op = &(ring->header_op.poolhd_op);
+
+	spin_lock_irqsave(&ring->p_rxlock, flags);
+	/* only the empty -> non empty transition is signalled, once */
+	if (*(poolhd_op->rx_wt_p) == *(poolhd_op->rx_rd_p) &&
+	    sblock->state == SBLOCK_STATE_READY)
+		send_event = true;
+
+	for (i = 0; i < n; i++) {
+		rxpos = sblock_get_ringpos(*(poolhd_op->rx_wt_p),
+					   poolhd_op->rx_count);
+		ring->p_rxblks[rxpos].addr = blks[i].addr -
+					     sblock->smem_virt +
+					     sblock->stored_smem_addr;
+		ring->p_rxblks[rxpos].length = poolhd_op->rx_size;
+		*(poolhd_op->rx_wt_p) = *(poolhd_op->rx_wt_p) + 1;
+
+		index = sblock_get_index((blks[i].addr - ring->rxblk_virt),
+					 sblock->rxblksz);
+		ring->rxrecord[index] = SBLOCK_BLK_STATE_DONE;
+	}
+	spin_unlock_irqrestore(&ring->p_rxlock, flags);
+
+	/* request in sblock_receive(_bulk), one per block, release here */
+	for (i = 0; i < n; i++)
+		sipc_smem_release_resource(ring->rx_pms, dst);
+
+	/*
+	 * smsg_send may caused schedule,
+	 * can't be called in spinlock protected context.
+	 */
+	if (send_event) {
+		smsg_set(&mevt, channel,
+			 SMSG_TYPE_EVENT,
+			 SMSG_EVENT_SBLOCK_RELEASE,
+			 0);
+		smsg_send(dst, &mevt, -1);
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(sblock_release_bulk);
+
+void *sblock_rx_data(u8 dst, u8 channel, struct sblock *blk)
+{
+#ifdef CONFIG_SPRD_SIPC_SBLOCK_RX_CACHED
+	struct sblock_mgr *sblock;
+	struct sblock_ring *ring;
+	void *addr;
+	u8 ch_index;
+
+	ch_index = sipc_channel2index(channel);
+	if (ch_index == INVALID_CHANEL_INDEX)
+		return blk->addr;
+
+	sblock = sblocks[dst][ch_index];
+	if (!sblock || !sblock->ring->rxblk_cached_virt)
+		return blk->addr;
+
+	ring = sblock->ring;
+	addr = ring->rxblk_cached_virt + (blk->addr - ring->rxblk_virt);
+	/* drop what the cache kept from the previous use of this block */
+	__inval_dcache_area(addr, blk->length);
+
+	return addr;
+#else
+	return blk->addr;
+#endif
+}
+EXPORT_SYMBOL_GPL(sblock_rx_data);
+
 unsigned int sblock_poll_wait(u8 dst, u8 channel,
 			      struct file *filp, poll_table *wait)
 {
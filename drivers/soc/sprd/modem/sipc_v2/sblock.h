@@ -97,6 +97,9 @@ struct sblock_ring {
 
 	void	*txblk_virt; /* virt of header->txblk_addr */
 	void	*rxblk_virt; /* virt of header->rxblk_addr */
+#ifdef CONFIG_SPRD_SIPC_SBLOCK_RX_CACHED
+	void	*rxblk_cached_virt; /* cached alias of rxblk_virt */
+#endif
 
 	/* virt of header->ring->txblk_blks */
 	struct sblock_blks	*r_txblks;
@@ -149,7 +152,14 @@ struct sblock_mgr {
 	u32	rxblknum;
 
 	struct sblock_ring	*ring;
-	struct task_struct	*thread;
+	/* channel open and init handshake, may block for long */
+	struct work_struct	open_work;
+	/* rx msg handling on the shared worker of the channel */
+	struct kthread_work	work;
+	/* open_work has been queued */
+	bool	started;
+	/* the channel has been ready once, a new open means peer reset */
+	int	recovery;
 
 	void	(*handler)(int event, void *data);
 	void	*data;
@@ -13,6 +13,7 @@
 
 #include <linux/debugfs.h>
 #include <linux/delay.h>
+#include <linux/eventfd.h>
 #include <linux/kernel.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
@@ -26,6 +27,7 @@
 #include <linux/wait.h>
 #include <linux/poll.h>
 #include <linux/sipc.h>
+#include <asm/cacheflush.h>
 #include <asm/pgtable.h>
 #include <uapi/linux/sched/types.h>
 
@@ -289,8 +291,72 @@ static void sbuf_comm_init(struct sbuf_mgr *sbuf)
 	}
 }
 
+/*
+ * Map the smem a second time as cached memory, smem_phys is the physical
+ * address of smem_virt, and read the rx buffers through it. Only the peer
+ * writes them, so the alias is never dirty and sbuf_read only has to
+ * invalidate what it is going to copy. The headers and the tx buffers
+ * stay on the uncached mapping. Without the alias the rx buffers are
+ * read uncached as before.
+ */
+static void sbuf_rx_cached_map(struct sbuf_mgr *sbuf, phys_addr_t smem_phys)
+{
+#ifdef CONFIG_SPRD_SIPC_SBUF_RX_CACHED
+	int i;
+
+	if (smsg_ipcs[sbuf->dst]->smem_type != SMEM_LOCAL)
+		return;
+
+	sbuf->smem_cached_virt = shmem_ram_vmap_cache(sbuf->dst, smem_phys,
+						      sbuf->smem_size);
+	if (!sbuf->smem_cached_virt) {
+		pr_warn("%s: channel %d-%d, no cached rx mapping\n",
+			__func__, sbuf->dst, sbuf->channel);
+		return;
+	}
+
+	for (i = 0; i < sbuf->ringnr; i++)
+		sbuf->rings[i].rxbuf_cached = sbuf->smem_cached_virt +
+			(sbuf->rings[i].rxbuf_virt - sbuf->smem_virt);
+#endif
+}
+
+static void sbuf_rx_cached_unmap(struct sbuf_mgr *sbuf)
+{
+#ifdef CONFIG_SPRD_SIPC_SBUF_RX_CACHED
+	if (sbuf->smem_cached_virt) {
+		shmem_ram_unmap(sbuf->dst, sbuf->smem_cached_virt);
+		sbuf->smem_cached_virt = NULL;
+	}
+#endif
+}
+
+/* where sbuf_read copies the rx buffer of ring from */
+static inline void *sbuf_rx_base(struct sbuf_ring *ring)
+{
+#ifdef CONFIG_SPRD_SIPC_SBUF_RX_CACHED
+	if (ring->rxbuf_cached)
+		return ring->rxbuf_cached;
+#endif
+	return ring->rxbuf_virt;
+}
+
+/* drop what the cache kept from the previous lap of the rx buffer */
+static inline void sbuf_rx_inval(struct sbuf_ring *ring, void *addr, int len)
+{
+#ifdef CONFIG_SPRD_SIPC_SBUF_RX_CACHED
+	if (ring->rxbuf_cached && len > 0)
+		__inval_dcache_area(addr, len);
+#endif
+}
+
+static void sbuf_host_smem_free(struct sbuf_mgr *sbuf)
+{
+	smem_free(sbuf->dst, sbuf->smem_alloc_addr, sbuf->smem_alloc_size);
+}
+
 static int sbuf_host_init(struct smsg_ipc *sipc, struct sbuf_mgr *sbuf,
-	u32 bufnum, u32 txbufsize, u32 rxbufsize)
+	u32 bufnum, u32 txbufsize, u32 rxbufsize, bool page_align)
 {
 	VOLA_SBUF_SMEM *smem;
 	VOLA_SBUF_RING *ringhd;
@@ -306,12 +372,24 @@ static int sbuf_host_init(struct smsg_ipc *sipc, struct sbuf_mgr *sbuf,
 	hsize = sizeof(struct sbuf_smem_header) +
 		sizeof(struct sbuf_ring_header) * bufnum;
 	sbuf->smem_size = hsize + (txbufsize + rxbufsize) * bufnum;
-	sbuf->smem_addr = smem_alloc(dst, sbuf->smem_size);
-	if (!sbuf->smem_addr) {
+	sbuf->smem_alloc_size = sbuf->smem_size;
+	if (page_align)
+		sbuf->smem_alloc_size += PAGE_SIZE;
+	sbuf->smem_alloc_addr = smem_alloc(dst, sbuf->smem_alloc_size);
+	if (!sbuf->smem_alloc_addr) {
 		pr_err("%s: channel %d-%d, Failed to allocate smem for sbuf\n",
 			__func__, sbuf->dst, sbuf->channel);
 		return -ENOMEM;
 	}
+
+	/*
+	 * The peer finds the rings right behind the headers, so for page
+	 * aligned rings the headers move up to end on a page boundary.
+	 */
+	sbuf->smem_addr = sbuf->smem_alloc_addr;
+	if (page_align)
+		sbuf->smem_addr = PAGE_ALIGN(sbuf->smem_alloc_addr + hsize) -
+				  hsize;
 	sbuf->dst_smem_addr = sbuf->smem_addr - sipc->smem_base +
 		sipc->dst_smem_base;
 
@@ -336,14 +414,14 @@ static int sbuf_host_init(struct smsg_ipc *sipc, struct sbuf_mgr *sbuf,
 	if (!sbuf->smem_virt) {
 		pr_err("%s: channel %d-%d, Failed to map smem for sbuf\n",
 			__func__, sbuf->dst, sbuf->channel);
-		smem_free(dst, sbuf->smem_addr, sbuf->smem_size);
+		sbuf_host_smem_free(sbuf);
 		return -EFAULT;
 	}
 
 	/* allocate rings description */
 	sbuf->rings = kcalloc(bufnum, sizeof(struct sbuf_ring), GFP_KERNEL);
 	if (!sbuf->rings) {
-		smem_free(dst, sbuf->smem_addr, sbuf->smem_size);
+		sbuf_host_smem_free(sbuf);
 		shmem_ram_unmap(dst, sbuf->smem_virt);
 		return -ENOMEM;
 	}
@@ -351,7 +429,7 @@ static int sbuf_host_init(struct smsg_ipc *sipc, struct sbuf_mgr *sbuf,
 	/* must request resource before read or write share memory */
 	rval = sipc_smem_request_resource(sipc->sipc_pms, sipc->dst, -1);
 	if (rval < 0) {
-		smem_free(dst, sbuf->smem_addr, sbuf->smem_size);
+		sbuf_host_smem_free(sbuf);
 		shmem_ram_unmap(dst, sbuf->smem_virt);
 		kfree(sbuf->rings);
 		return rval;
@@ -391,6 +469,7 @@ static int sbuf_host_init(struct smsg_ipc *sipc, struct sbuf_mgr *sbuf,
 	sipc_smem_release_resource(sipc->sipc_pms, sipc->dst);
 
 	sbuf_comm_init(sbuf);
+	sbuf_rx_cached_map(sbuf, sbuf->smem_addr + offset);
 
 	return 0;
 }
@@ -503,26 +582,192 @@ static int sbuf_client_init(struct smsg_ipc *sipc, struct sbuf_mgr *sbuf)
 	sipc_smem_release_resource(sipc->sipc_pms, sipc->dst);
 
 	sbuf_comm_init(sbuf);
+	sbuf_rx_cached_map(sbuf, sbuf->smem_addr + offset);
 
 	return 0;
 }
 
-static int sbuf_thread(void *data)
+static void sbuf_handle_msg(struct sbuf_mgr *sbuf, struct smsg *mrecv)
 {
-	struct sbuf_mgr *sbuf = data;
+	struct smsg_ipc *sipc = smsg_ipcs[sbuf->dst];
+	struct sbuf_ring *ring;
+	struct smsg mcmd;
+	int rval = 0, bufid;
+	unsigned long flags;
+
+	pr_debug("sbuf recv msg: dst=%d, channel=%d, type=%d, flag=0x%04x, value=0x%08x\n",
+		 sbuf->dst,
+		 sbuf->channel,
+		 mrecv->type,
+		 mrecv->flag,
+		 mrecv->value);
+
+	switch (mrecv->type) {
+	case SMSG_TYPE_OPEN:
+		pr_info("%s: channel %d-%d, state=%d, recv open msg!\n",
+			__func__, sbuf->dst,
+			sbuf->channel, sbuf->state);
+		if (sipc->client)
+			break;
+
+		/* if channel state is already reay, reopen it
+		 * (such as modem reset), we must skip the old
+		 * buf data , than give open ack and reset state
+		 * to idle
+		 */
+		if (sbuf->state == SBUF_STATE_READY) {
+			sbuf_skip_old_data(sbuf);
+			sbuf->state = SBUF_STATE_IDLE;
+		}
+		/* handle channel open */
+		smsg_open_ack(sbuf->dst, sbuf->channel);
+		break;
+	case SMSG_TYPE_CLOSE:
+		/* handle channel close */
+		sbuf_skip_old_data(sbuf);
+		smsg_close_ack(sbuf->dst, sbuf->channel);
+		sbuf->state = SBUF_STATE_IDLE;
+		break;
+	case SMSG_TYPE_CMD:
+		pr_info("%s: channel %d-%d state = %d, recv cmd msg, flag = %d!\n",
+			__func__, sbuf->dst, sbuf->channel,
+			sbuf->state, mrecv->flag);
+		if (sipc->client)
+			break;
+
+		/* respond cmd done for sbuf init only state is idle */
+		if (sbuf->state == SBUF_STATE_IDLE &&
+		    mrecv->flag == SMSG_CMD_SBUF_INIT) {
+			smsg_set(&mcmd,
+				 sbuf->channel,
+				 SMSG_TYPE_DONE,
+				 SMSG_DONE_SBUF_INIT,
+				 sbuf->dst_smem_addr);
+			smsg_send(sbuf->dst, &mcmd, -1);
+			sbuf->state = SBUF_STATE_READY;
+
+			for (bufid = 0; bufid < sbuf->ringnr; bufid++) {
+				/*
+				 * if has sbuf handle give
+				 * sbuf ready notify only.
+				 */
+				if (sbuf->handler &&
+				    (sbuf->ch_mark & BIT(bufid))) {
+					sbuf->handler(SBUF_NOTIFY_READY,
+						      bufid,
+						      sbuf->data);
+					continue;
+				}
+
+				ring = &sbuf->rings[bufid];
+				if (ring->handler)
+					ring->handler(SBUF_NOTIFY_READY,
+						      ring->data);
+			}
+		}
+		break;
+	case SMSG_TYPE_EVENT:
+		bufid = mrecv->value;
+		WARN_ON(bufid >= sbuf->ringnr);
+		ring = &sbuf->rings[bufid];
+		switch (mrecv->flag) {
+		case SMSG_EVENT_SBUF_RDPTR:
+			if (ring->need_wake_lock)
+				sprd_pms_request_wakelock_period(ring->tx_pms,
+								 500);
+			/* set write mask. */
+			spin_lock_irqsave(&ring->poll_lock, flags);
+			ring->poll_mask |= POLLOUT | POLLWRNORM;
+			spin_unlock_irqrestore(&ring->poll_lock, flags);
+			wake_up_interruptible_all(&ring->txwait);
+
+			if (sbuf->handler &&
+			    (sbuf->ch_mark & BIT(bufid)))
+				sbuf->handler(SBUF_NOTIFY_WRITE,
+					      bufid, sbuf->data);
+			else if (ring->handler)
+				ring->handler(SBUF_NOTIFY_WRITE,
+					      ring->data);
+			break;
+		case SMSG_EVENT_SBUF_WRPTR:
+			/* set read mask. */
+			spin_lock_irqsave(&ring->poll_lock, flags);
+			ring->poll_mask |= POLLIN | POLLRDNORM;
+			spin_unlock_irqrestore(&ring->poll_lock, flags);
+
+			if (ring->need_wake_lock)
+				sprd_pms_request_wakelock_period(ring->rx_pms,
+								 500);
+			wake_up_interruptible_all(&ring->rxwait);
+
+			spin_lock_irqsave(&ring->poll_lock, flags);
+			if (ring->rx_eventfd)
+				eventfd_signal(ring->rx_eventfd, 1);
+			spin_unlock_irqrestore(&ring->poll_lock, flags);
+
+			if (sbuf->handler &&
+			    (sbuf->ch_mark & BIT(bufid)))
+				sbuf->handler(SBUF_NOTIFY_READ,
+					      bufid, sbuf->data);
+			else if (ring->handler)
+				ring->handler(SBUF_NOTIFY_READ,
+					      ring->data);
+			break;
+		default:
+			rval = 1;
+			break;
+		}
+		break;
+	default:
+		rval = 1;
+		break;
+	}
+
+	if (rval)
+		pr_info("non-handled sbuf msg: %d-%d, %d, %d, %d\n",
+			sbuf->dst,
+			sbuf->channel,
+			mrecv->type,
+			mrecv->flag,
+			mrecv->value);
+}
+
+/*
+ * Runs on the shared worker of the channel priority class whenever msgs
+ * got cached, takes at most SMSG_WORK_BATCH of them per round.
+ */
+static void sbuf_work(struct kthread_work *work)
+{
+	struct sbuf_mgr *sbuf = container_of(work, struct sbuf_mgr, work);
+	struct smsg mrecv;
+	int i;
+
+	for (i = 0; i < SMSG_WORK_BATCH; i++) {
+		smsg_set(&mrecv, sbuf->channel, 0, 0, 0);
+		if (smsg_recv(sbuf->dst, &mrecv, 0))
+			return;
+
+		sbuf_handle_msg(sbuf, &mrecv);
+		/* unlock sipc channel wake lock */
+		smsg_ch_wake_unlock(sbuf->dst, sbuf->channel);
+	}
+
+	smsg_ch_kick_work(sbuf->dst, sbuf->channel);
+}
+
+static void sbuf_open_work(struct work_struct *work)
+{
+	struct sbuf_mgr *sbuf = container_of(work, struct sbuf_mgr, open_work);
 	struct sbuf_ring *ring;
 	struct smsg mcmd, mrecv;
 	int rval, bufid;
 	struct smsg_ipc *sipc;
-	unsigned long flags;
 
-	/* since the channel open may hang, we call it in the sbuf thread */
+	/* since the channel open may hang, we call it in a work */
 	rval = smsg_ch_open(sbuf->dst, sbuf->channel, -1);
 	if (rval != 0) {
 		pr_err("Failed to open channel %d\n", sbuf->channel);
-		/* assign NULL to thread poniter as failed to open channel */
-		sbuf->thread = NULL;
-		return rval;
+		return;
 	}
 
 	/* if client, send SMSG_CMD_SBUF_INIT, wait sbuf SMSG_DONE_SBUF_INIT */
@@ -534,19 +779,15 @@ static int sbuf_thread(void *data)
 		do {
 			smsg_set(&mrecv, sbuf->channel, 0, 0, 0);
 			rval = smsg_recv(sbuf->dst, &mrecv, -1);
-			if (rval != 0) {
-				sbuf->thread = NULL;
-				return rval;
-			}
+			if (rval != 0)
+				return;
 		} while (mrecv.type != SMSG_TYPE_DONE ||
 			mrecv.flag != SMSG_DONE_SBUF_INIT);
 		sbuf->smem_addr = mrecv.value;
 		pr_info("%s: channel %d-%d, done_sbuf_init, address = 0x%x!\n",
 			__func__, sbuf->dst, sbuf->channel, sbuf->smem_addr);
-		if (sbuf_client_init(sipc, sbuf)) {
-			sbuf->thread = NULL;
-			return 0;
-		}
+		if (sbuf_client_init(sipc, sbuf))
+			return;
 		sbuf->state = SBUF_STATE_READY;
 		for (bufid = 0; bufid < sbuf->ringnr; bufid++) {
 			/* if has sbuf handle give sbuf ready notify only. */
@@ -562,163 +803,20 @@ static int sbuf_thread(void *data)
 		}
 	}
 
-	/* sbuf init done, handle the ring rx events */
-	while (!kthread_should_stop()) {
-		/* monitor sbuf rdptr/wrptr update smsg */
-		smsg_set(&mrecv, sbuf->channel, 0, 0, 0);
-		rval = smsg_recv(sbuf->dst, &mrecv, -1);
-		if (rval == -EIO) {
-			/* channel state is free */
-			msleep(20);
-			continue;
-		}
-
-		pr_debug("sbuf thread recv msg: dst=%d, channel=%d, type=%d, flag=0x%04x, value=0x%08x\n",
-			 sbuf->dst,
-			 sbuf->channel,
-			 mrecv.type,
-			 mrecv.flag,
-			 mrecv.value);
-
-		switch (mrecv.type) {
-		case SMSG_TYPE_OPEN:
-			pr_info("%s: channel %d-%d, state=%d, recv open msg!\n",
-				__func__, sbuf->dst,
-				sbuf->channel, sbuf->state);
-			if (sipc->client)
-				break;
-
-			/* if channel state is already reay, reopen it
-			 * (such as modem reset), we must skip the old
-			 * buf data , than give open ack and reset state
-			 * to idle
-			 */
-			if (sbuf->state == SBUF_STATE_READY) {
-				sbuf_skip_old_data(sbuf);
-				sbuf->state = SBUF_STATE_IDLE;
-			}
-			/* handle channel open */
-			smsg_open_ack(sbuf->dst, sbuf->channel);
-			break;
-		case SMSG_TYPE_CLOSE:
-			/* handle channel close */
-			sbuf_skip_old_data(sbuf);
-			smsg_close_ack(sbuf->dst, sbuf->channel);
-			sbuf->state = SBUF_STATE_IDLE;
-			break;
-		case SMSG_TYPE_CMD:
-			pr_info("%s: channel %d-%d state = %d, recv cmd msg, flag = %d!\n",
-				__func__, sbuf->dst, sbuf->channel,
-				sbuf->state, mrecv.flag);
-			if (sipc->client)
-				break;
-
-			/* respond cmd done for sbuf init only state is idle */
-			if (sbuf->state == SBUF_STATE_IDLE &&
-			    mrecv.flag == SMSG_CMD_SBUF_INIT) {
-				smsg_set(&mcmd,
-					 sbuf->channel,
-					 SMSG_TYPE_DONE,
-					 SMSG_DONE_SBUF_INIT,
-					 sbuf->dst_smem_addr);
-				smsg_send(sbuf->dst, &mcmd, -1);
-				sbuf->state = SBUF_STATE_READY;
-
-				for (bufid = 0; bufid < sbuf->ringnr; bufid++) {
-					/*
-					 * if has sbuf handle give
-					 * sbuf ready notify only.
-					 */
-					if (sbuf->handler &&
-					    (sbuf->ch_mark & BIT(bufid))) {
-						sbuf->handler(SBUF_NOTIFY_READY,
-							      bufid,
-							      sbuf->data);
-						continue;
-					}
-
-					ring = &sbuf->rings[bufid];
-					if (ring->handler)
-						ring->handler(SBUF_NOTIFY_READY,
-							      ring->data);
-				}
-			}
-			break;
-		case SMSG_TYPE_EVENT:
-			bufid = mrecv.value;
-			WARN_ON(bufid >= sbuf->ringnr);
-			ring = &sbuf->rings[bufid];
-			switch (mrecv.flag) {
-			case SMSG_EVENT_SBUF_RDPTR:
-				if (ring->need_wake_lock)
-					sprd_pms_request_wakelock_period(ring->tx_pms,
-									 500);
-				/* set write mask. */
-				spin_lock_irqsave(&ring->poll_lock, flags);
-				ring->poll_mask |= POLLOUT | POLLWRNORM;
-				spin_unlock_irqrestore(&ring->poll_lock, flags);
-				wake_up_interruptible_all(&ring->txwait);
-
-				if (sbuf->handler &&
-				    (sbuf->ch_mark & BIT(bufid)))
-					sbuf->handler(SBUF_NOTIFY_WRITE,
-						      bufid, sbuf->data);
-				else if (ring->handler)
-					ring->handler(SBUF_NOTIFY_WRITE,
-						      ring->data);
-				break;
-			case SMSG_EVENT_SBUF_WRPTR:
-				/* set read mask. */
-				spin_lock_irqsave(&ring->poll_lock, flags);
-				ring->poll_mask |= POLLIN | POLLRDNORM;
-				spin_unlock_irqrestore(&ring->poll_lock, flags);
-
-				if (ring->need_wake_lock)
-					sprd_pms_request_wakelock_period(ring->rx_pms,
-									 500);
-				wake_up_interruptible_all(&ring->rxwait);
-
-				if (sbuf->handler &&
-				    (sbuf->ch_mark & BIT(bufid)))
-					sbuf->handler(SBUF_NOTIFY_READ,
-						      bufid, sbuf->data);
-				else if (ring->handler)
-					ring->handler(SBUF_NOTIFY_READ,
-						      ring->data);
-				break;
-			default:
-				rval = 1;
-				break;
-			}
-			break;
-		default:
-			rval = 1;
-			break;
-		};
-
-		if (rval) {
-			pr_info("non-handled sbuf msg: %d-%d, %d, %d, %d\n",
-				sbuf->dst,
-				sbuf->channel,
-				mrecv.type,
-				mrecv.flag,
-				mrecv.value);
-			rval = 0;
-		}
-		/* unlock sipc channel wake lock */
-		smsg_ch_wake_unlock(sbuf->dst, sbuf->channel);
-	}
-
-	return 0;
+	/* sbuf init done, the ring rx events go to the shared worker */
+	rval = smsg_ch_set_work(sbuf->dst, sbuf->channel, &sbuf->work);
+	if (rval)
+		pr_err("%s: channel %d-%d, set work failed %d\n",
+		       __func__, sbuf->dst, sbuf->channel, rval);
 }
 
-int sbuf_create(u8 dst, u8 channel, u32 bufnum, u32 txbufsize, u32 rxbufsize)
+static int sbuf_create_common(u8 dst, u8 channel, u32 bufnum,
+			      u32 txbufsize, u32 rxbufsize, bool page_align)
 {
 	struct sbuf_mgr *sbuf;
 	u8 ch_index;
 	int ret;
 	struct smsg_ipc *sipc = NULL;
-	struct sched_param param = {.sched_priority = 89};
 
 	sipc = smsg_ipcs[dst];
 	ch_index = sipc_channel2index(channel);
@@ -753,37 +851,44 @@ int sbuf_create(u8 dst, u8 channel, u32 bufnum, u32 txbufsize, u32 rxbufsize)
 		sbuf->force_send = true;
 
 	if (!sipc->client) {
-		ret = sbuf_host_init(sipc, sbuf, bufnum, txbufsize, rxbufsize);
+		ret = sbuf_host_init(sipc, sbuf, bufnum, txbufsize, rxbufsize,
+				     page_align);
 		if (ret) {
 			kfree(sbuf);
 			return ret;
 		}
 	}
 
-	sbuf->thread = kthread_create(sbuf_thread, sbuf,
-			"sbuf-%d-%d", dst, channel);
-	if (IS_ERR(sbuf->thread)) {
-		pr_err("Failed to create kthread: sbuf-%d-%d\n", dst, channel);
-		if (!sipc->client) {
-			kfree(sbuf->rings);
-			shmem_ram_unmap(dst, sbuf->smem_virt);
-			smem_free(dst, sbuf->smem_addr, sbuf->smem_size);
-		}
-		ret = PTR_ERR(sbuf->thread);
-		kfree(sbuf);
-		return ret;
-	}
+	INIT_WORK(&sbuf->open_work, sbuf_open_work);
+	kthread_init_work(&sbuf->work, sbuf_work);
 
 	sbufs[dst][ch_index] = sbuf;
-
-	/*set the thread as a real time thread, and its priority is 10*/
-	sched_setscheduler(sbuf->thread, SCHED_FIFO, &param);
-	wake_up_process(sbuf->thread);
+	queue_work(system_unbound_wq, &sbuf->open_work);
 
 	return 0;
 }
+
+int sbuf_create(u8 dst, u8 channel, u32 bufnum, u32 txbufsize, u32 rxbufsize)
+{
+	return sbuf_create_common(dst, channel, bufnum,
+				  txbufsize, rxbufsize, false);
+}
 EXPORT_SYMBOL_GPL(sbuf_create);
 
+int sbuf_create_mmap(u8 dst, u8 channel, u32 bufnum,
+		     u32 txbufsize, u32 rxbufsize)
+{
+	if (!PAGE_ALIGNED(txbufsize) || !PAGE_ALIGNED(rxbufsize)) {
+		pr_err("%s: %d-%d, buffer sizes 0x%x/0x%x not page aligned\n",
+		       __func__, dst, channel, txbufsize, rxbufsize);
+		return -EINVAL;
+	}
+
+	return sbuf_create_common(dst, channel, bufnum,
+				  txbufsize, rxbufsize, true);
+}
+EXPORT_SYMBOL_GPL(sbuf_create_mmap);
+
 void sbuf_set_no_need_wake_lock(u8 dst, u8 channel, u32 bufnum)
 {
 	u8 ch_index;
@@ -825,9 +930,9 @@ void sbuf_destroy(u8 dst, u8 channel)
 	sbuf->state = SBUF_STATE_IDLE;
 	smsg_ch_close(dst, channel, -1);
 
-	/* stop sbuf thread if it's created successfully and still alive */
-	if (!IS_ERR_OR_NULL(sbuf->thread))
-		kthread_stop(sbuf->thread);
+	/* the close above fails a still pending open, then stop the rx work */
+	cancel_work_sync(&sbuf->open_work);
+	smsg_ch_clear_work(dst, channel);
 
 	if (sbuf->rings) {
 		for (i = 0; i < sbuf->ringnr; i++) {
@@ -838,10 +943,13 @@ void sbuf_destroy(u8 dst, u8 channel)
 #endif
 			sprd_pms_destroy(sbuf->rings[i].tx_pms);
 			sprd_pms_destroy(sbuf->rings[i].rx_pms);
+			if (sbuf->rings[i].rx_eventfd)
+				eventfd_ctx_put(sbuf->rings[i].rx_eventfd);
 		}
 		kfree(sbuf->rings);
 	}
 
+	sbuf_rx_cached_unmap(sbuf);
 	if (sbuf->smem_virt)
 		shmem_ram_unmap(dst, sbuf->smem_virt);
 
@@ -849,7 +957,7 @@ void sbuf_destroy(u8 dst, u8 channel)
 	if (sipc->client)
 		smem_free(dst, sbuf->smem_addr_debug, sbuf->smem_size);
 	else
-		smem_free(dst, sbuf->smem_addr, sbuf->smem_size);
+		sbuf_host_smem_free(sbuf);
 
 	kfree(sbuf);
 
@@ -866,6 +974,7 @@ int sbuf_write(u8 dst, u8 channel, u32 bufid,
 	struct smsg mevt;
 	void *txpos;
 	int rval, left, tail, txsize;
+	u32 wr, rd;
 	u8 ch_index;
 	union sbuf_buf u_buf;
 	bool no_data;
@@ -991,13 +1100,20 @@ int sbuf_write(u8 dst, u8 channel, u32 bufid,
 		return rval;
 	}
 
-	while (left && (int)(*(hd_op->tx_wt_p) - *(hd_op->tx_rd_p)) <
-	       hd_op->tx_size && sbuf->state == SBUF_STATE_READY) {
+	/*
+	 * Only we move wrptr, txlock keeps other writers on this side
+	 * away, so it is read from smem once and kept here. rdptr belongs
+	 * to the peer and is read once per round.
+	 */
+	wr = *(hd_op->tx_wt_p);
+	while (left && sbuf->state == SBUF_STATE_READY) {
+		rd = *(hd_op->tx_rd_p);
+		if ((int)(wr - rd) >= hd_op->tx_size)
+			break;
+
 		/* calc txpos & txsize */
-		txpos = ring->txbuf_virt +
-			*(hd_op->tx_wt_p) % hd_op->tx_size;
-		txsize = hd_op->tx_size -
-			(int)(*(hd_op->tx_wt_p) - *(hd_op->tx_rd_p));
+		txpos = ring->txbuf_virt + wr % hd_op->tx_size;
+		txsize = hd_op->tx_size - (int)(wr - rd);
 		txsize = min(txsize, left);
 
 		tail = txpos + txsize - (ring->txbuf_virt + hd_op->tx_size);
@@ -1042,14 +1158,19 @@ int sbuf_write(u8 dst, u8 channel, u32 bufid,
 		pr_debug("%s: channel=%d, txpos=%p, txsize=%d\n",
 			 __func__, channel, txpos, txsize);
 
+		/* the data must be in smem before the peer sees wrptr */
+		wmb();
 		/* update tx wrptr */
-		*(hd_op->tx_wt_p) = *(hd_op->tx_wt_p) + txsize;
+		wr += txsize;
+		*(hd_op->tx_wt_p) = wr;
+		/* and wrptr out before rdptr is read again below */
+		mb();
 		/*
 		 * force send be true or tx ringbuf is empty,
 		 * need to notify peer side
 		 */
 		if (sbuf->force_send ||
-		    *(hd_op->tx_wt_p) - *(hd_op->tx_rd_p) == txsize) {
+		    wr - *(hd_op->tx_rd_p) == txsize) {
 			smsg_set(&mevt, channel,
 				 SMSG_TYPE_EVENT,
 				 SMSG_EVENT_SBUF_WRPTR,
@@ -1063,8 +1184,7 @@ int sbuf_write(u8 dst, u8 channel, u32 bufid,
 
 	/* update write mask */
 	spin_lock_irqsave(&ring->poll_lock, flags);
-	if ((int)(*(hd_op->tx_wt_p) - *(hd_op->tx_rd_p)) >=
-	    hd_op->tx_size)
+	if ((int)(wr - *(hd_op->tx_rd_p)) >= hd_op->tx_size)
 		ring->poll_mask &= ~(POLLOUT | POLLWRNORM);
 	else
 		ring->poll_mask |= POLLOUT | POLLWRNORM;
@@ -1094,8 +1214,9 @@ int sbuf_read(u8 dst, u8 channel, u32 bufid,
 	struct sbuf_ring *ring = NULL;
 	struct sbuf_ring_header_op *hd_op;
 	struct smsg mevt;
-	void *rxpos;
+	void *rxbase, *rxpos;
 	int rval, left, tail, rxsize;
+	u32 wr, rd;
 	u8 ch_index;
 	union sbuf_buf u_buf;
 	bool no_data;
@@ -1213,13 +1334,19 @@ int sbuf_read(u8 dst, u8 channel, u32 bufid,
 		return rval;
 	}
 
-	while (left &&
-	       (*(hd_op->rx_wt_p) != *(hd_op->rx_rd_p)) &&
-	       sbuf->state == SBUF_STATE_READY) {
+	/* the same as in sbuf_write, with the roles of the pointers swapped */
+	rxbase = sbuf_rx_base(ring);
+	rd = *(hd_op->rx_rd_p);
+	while (left && sbuf->state == SBUF_STATE_READY) {
+		wr = *(hd_op->rx_wt_p);
+		if (wr == rd)
+			break;
+		/* the data is only valid once wrptr is seen */
+		rmb();
+
 		/* calc rxpos & rxsize */
-		rxpos = ring->rxbuf_virt +
-			*(hd_op->rx_rd_p) % hd_op->rx_size;
-		rxsize = (int)(*(hd_op->rx_wt_p) - *(hd_op->rx_rd_p));
+		rxpos = rxbase + rd % hd_op->rx_size;
+		rxsize = (int)(wr - rd);
 		/* check overrun */
 		if (rxsize > hd_op->rx_size)
 			pr_err("%s: bufid = %d, channel= %d rxsize=0x%x, rdptr=%d, wrptr=%d",
@@ -1227,22 +1354,28 @@ int sbuf_read(u8 dst, u8 channel, u32 bufid,
 			       bufid,
 			       channel,
 			       rxsize,
-			       *(hd_op->rx_wt_p),
-			       *(hd_op->rx_rd_p));
+			       wr,
+			       rd);
 
 		rxsize = min(rxsize, left);
 
 		pr_debug("%s: channel=%d, buf=%p, rxpos=%p, rxsize=%d\n",
 			 __func__, channel, u_buf.buf, rxpos, rxsize);
 
-		tail = rxpos + rxsize - (ring->rxbuf_virt + hd_op->rx_size);
+		tail = rxpos + rxsize - (rxbase + hd_op->rx_size);
+		if (tail > 0) {
+			sbuf_rx_inval(ring, rxpos, rxsize - tail);
+			sbuf_rx_inval(ring, rxbase, tail);
+		} else {
+			sbuf_rx_inval(ring, rxpos, rxsize);
+		}
 
 		if (tail > 0) {
 			/* ring buffer is rounded */
 			if ((uintptr_t)u_buf.buf > TASK_SIZE) {
 				unalign_memcpy(u_buf.buf, rxpos, rxsize - tail);
 				unalign_memcpy(u_buf.buf + rxsize - tail,
-					       ring->rxbuf_virt, tail);
+					       rxbase, tail);
 			} else {
 				/* handle the user space address */
 				if (unalign_copy_to_user(u_buf.ubuf,
@@ -1250,7 +1383,7 @@ int sbuf_read(u8 dst, u8 channel, u32 bufid,
 							 rxsize - tail) ||
 				    unalign_copy_to_user(u_buf.ubuf
 							 + rxsize - tail,
-							 ring->rxbuf_virt,
+							 rxbase,
 							 tail)) {
 					pr_err("%s: failed to copy to user!\n",
 						__func__);
@@ -1273,11 +1406,15 @@ int sbuf_read(u8 dst, u8 channel, u32 bufid,
 			}
 		}
 
+		/* the data must be read out before the peer may reuse it */
+		mb();
 		/* update rx rdptr */
-		*(hd_op->rx_rd_p) = *(hd_op->rx_rd_p) + rxsize;
+		rd += rxsize;
+		*(hd_op->rx_rd_p) = rd;
+		/* and rdptr out before wrptr is read again below */
+		mb();
 		/* rx ringbuf is full ,so need to notify peer side */
-		if (*(hd_op->rx_wt_p) - *(hd_op->rx_rd_p) ==
-		    hd_op->rx_size - rxsize) {
+		if (*(hd_op->rx_wt_p) - rd == hd_op->rx_size - rxsize) {
 			smsg_set(&mevt, channel,
 				 SMSG_TYPE_EVENT,
 				 SMSG_EVENT_SBUF_RDPTR,
@@ -1291,7 +1428,7 @@ int sbuf_read(u8 dst, u8 channel, u32 bufid,
 
 	/* update read mask */
 	spin_lock_irqsave(&ring->poll_lock, flags);
-	if (*(hd_op->rx_wt_p) == *(hd_op->rx_rd_p))
+	if (*(hd_op->rx_wt_p) == rd)
 		ring->poll_mask &= ~(POLLIN | POLLRDNORM);
 	else
 		ring->poll_mask |= POLLIN | POLLRDNORM;
@@ -1313,6 +1450,195 @@ int sbuf_read(u8 dst, u8 channel, u32 bufid,
 }
 EXPORT_SYMBOL_GPL(sbuf_read);
 
+static struct sbuf_mgr *sbuf_get_ready(u8 dst, u8 channel, u32 bufid)
+{
+	struct sbuf_mgr *sbuf;
+	u8 ch_index;
+
+	ch_index = sipc_channel2index(channel);
+	if (ch_index == INVALID_CHANEL_INDEX) {
+		pr_err("%s:channel %d invalid!\n", __func__, channel);
+		return NULL;
+	}
+
+	sbuf = sbufs[dst][ch_index];
+	if (!sbuf || sbuf->state != SBUF_STATE_READY ||
+	    bufid >= sbuf->ringnr)
+		return NULL;
+
+	return sbuf;
+}
+
+int sbuf_rx_mmap(u8 dst, u8 channel, u32 bufid, struct vm_area_struct *vma)
+{
+	struct smsg_ipc *sipc = smsg_ipcs[dst];
+	unsigned long size = vma->vm_end - vma->vm_start;
+	struct sbuf_mgr *sbuf;
+	struct sbuf_ring *ring;
+	phys_addr_t phys;
+
+	sbuf = sbuf_get_ready(dst, channel, bufid);
+	if (!sbuf)
+		return -ENODEV;
+
+	/* the pcie window is no plain memory */
+	if (sipc->smem_type != SMEM_LOCAL)
+		return -ENODEV;
+
+	ring = &sbuf->rings[bufid];
+	phys = sbuf->smem_addr;
+#ifdef CONFIG_PHYS_ADDR_T_64BIT
+	phys += (phys_addr_t)sipc->high_offset << 32;
+#endif
+	phys += ring->rxbuf_virt - sbuf->smem_virt;
+
+	/* nothing but the rx buffer may be visible */
+	if (!PAGE_ALIGNED(phys) || !PAGE_ALIGNED(ring->header_op.rx_size) ||
+	    vma->vm_pgoff || size > ring->header_op.rx_size)
+		return -EINVAL;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	vma->vm_flags &= ~VM_MAYWRITE;
+	vma->vm_flags |= VM_IO | VM_DONTEXPAND | VM_DONTDUMP;
+	/* same attributes as the kernel mapping of smem */
+	vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+
+	return remap_pfn_range(vma, vma->vm_start, phys >> PAGE_SHIFT,
+			       size, vma->vm_page_prot);
+}
+EXPORT_SYMBOL_GPL(sbuf_rx_mmap);
+
+int sbuf_rx_peek(u8 dst, u8 channel, u32 bufid, u32 *offset, u32 *len)
+{
+	struct sbuf_ring_header_op *hd_op;
+	struct sbuf_mgr *sbuf;
+	struct sbuf_ring *ring;
+	u32 rd;
+	int rval;
+
+	sbuf = sbuf_get_ready(dst, channel, bufid);
+	if (!sbuf)
+		return -ENODEV;
+
+	ring = &sbuf->rings[bufid];
+	hd_op = &ring->header_op;
+
+	/* must request resource before read or write share memory */
+	rval = sipc_smem_request_resource(ring->rx_pms, dst, -1);
+	if (rval < 0)
+		return rval;
+
+	rd = *(hd_op->rx_rd_p);
+	*len = *(hd_op->rx_wt_p) - rd;
+	*offset = rd % hd_op->rx_size;
+	/* the data is only valid once wrptr is seen */
+	rmb();
+
+	/* release resource */
+	sipc_smem_release_resource(ring->rx_pms, dst);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(sbuf_rx_peek);
+
+int sbuf_rx_consume(u8 dst, u8 channel, u32 bufid, u32 len)
+{
+	struct sbuf_ring_header_op *hd_op;
+	struct sbuf_mgr *sbuf;
+	struct sbuf_ring *ring;
+	struct smsg mevt;
+	unsigned long flags;
+	u32 wr, rd;
+	int rval;
+
+	sbuf = sbuf_get_ready(dst, channel, bufid);
+	if (!sbuf)
+		return -ENODEV;
+
+	ring = &sbuf->rings[bufid];
+	hd_op = &ring->header_op;
+
+	mutex_lock(&ring->rxlock);
+
+	/* must request resource before read or write share memory */
+	rval = sipc_smem_request_resource(ring->rx_pms, dst, -1);
+	if (rval < 0) {
+		mutex_unlock(&ring->rxlock);
+		return rval;
+	}
+
+	rd = *(hd_op->rx_rd_p);
+	wr = *(hd_op->rx_wt_p);
+	if (len > wr - rd) {
+		rval = -EINVAL;
+		goto out;
+	}
+
+	/* the reader is done with the data before the peer may reuse it */
+	mb();
+	rd += len;
+	*(hd_op->rx_rd_p) = rd;
+	/* and rdptr out before wrptr is read again below */
+	mb();
+	/* rx ringbuf was full, so need to notify peer side */
+	if (len && *(hd_op->rx_wt_p) - rd == hd_op->rx_size - len) {
+		smsg_set(&mevt, channel,
+			 SMSG_TYPE_EVENT,
+			 SMSG_EVENT_SBUF_RDPTR,
+			 bufid);
+		smsg_send(dst, &mevt, -1);
+	}
+
+	/* update read mask */
+	spin_lock_irqsave(&ring->poll_lock, flags);
+	if (*(hd_op->rx_wt_p) == rd)
+		ring->poll_mask &= ~(POLLIN | POLLRDNORM);
+	else
+		ring->poll_mask |= POLLIN | POLLRDNORM;
+	spin_unlock_irqrestore(&ring->poll_lock, flags);
+
+out:
+	/* release resource */
+	sipc_smem_release_resource(ring->rx_pms, dst);
+	if (ring->need_wake_lock)
+		sprd_pms_release_wakelock_later(ring->rx_pms, 20);
+
+	mutex_unlock(&ring->rxlock);
+
+	return rval;
+}
+EXPORT_SYMBOL_GPL(sbuf_rx_consume);
+
+int sbuf_rx_swap_eventfd(u8 dst, u8 channel, u32 bufid,
+			 struct eventfd_ctx *old, struct eventfd_ctx *ctx)
+{
+	struct sbuf_mgr *sbuf;
+	struct sbuf_ring *ring;
+	unsigned long flags;
+	int rval = 0;
+
+	sbuf = sbuf_get_ready(dst, channel, bufid);
+	if (!sbuf)
+		return -ENODEV;
+
+	ring = &sbuf->rings[bufid];
+
+	/* one reader per ring, the others keep to poll */
+	spin_lock_irqsave(&ring->poll_lock, flags);
+	if (ring->rx_eventfd == old)
+		ring->rx_eventfd = ctx;
+	else
+		rval = -EBUSY;
+	spin_unlock_irqrestore(&ring->poll_lock, flags);
+
+	if (!rval && old)
+		eventfd_ctx_put(old);
+
+	return rval;
+}
+EXPORT_SYMBOL_GPL(sbuf_rx_swap_eventfd);
+
 int sbuf_poll_wait(u8 dst, u8 channel, u32 bufid,
 		   struct file *filp, poll_table *wait)
 {
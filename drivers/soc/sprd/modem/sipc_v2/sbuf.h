@@ -74,6 +74,9 @@ struct sbuf_ring {
 
 	void	*txbuf_virt;
 	void	*rxbuf_virt;
+#ifdef CONFIG_SPRD_SIPC_SBUF_RX_CACHED
+	void	*rxbuf_cached; /* cached alias of rxbuf_virt, may be NULL */
+#endif
 
 	/* send/recv wait queue */
 	wait_queue_head_t	txwait;
@@ -98,6 +101,8 @@ struct sbuf_ring {
 	unsigned int	poll_mask;
 	/* protect poll_mask member */
 	spinlock_t	poll_lock;
+	/* signalled with the rx waiters, set by sbuf_rx_swap_eventfd */
+	struct eventfd_ctx	*rx_eventfd;
 
 	void	(*handler)(int event, void *data);
 	void	*data;
@@ -113,8 +118,17 @@ struct sbuf_mgr {
 	u32	state;
 
 	void	*smem_virt;
+#ifdef CONFIG_SPRD_SIPC_SBUF_RX_CACHED
+	void	*smem_cached_virt; /* cached alias of smem_virt */
+#endif
 	u32	smem_addr;
 	u32	smem_size;
+	/*
+	 * what smem_alloc really handed out in host mode, sbuf_create_mmap
+	 * allocates a page more to start the rings on a page boundary
+	 */
+	u32	smem_alloc_addr;
+	u32	smem_alloc_size;
 
 	u32	smem_addr_debug;
 	u32	dst_smem_addr;
@@ -124,7 +138,10 @@ struct sbuf_mgr {
 	void	(*handler)(int event, u32 bufid, void *data);
 	void	*data;
 	struct sbuf_ring	*rings;
-	struct task_struct	*thread;
+	/* channel open and init handshake, may block for long */
+	struct work_struct	open_work;
+	/* rx msg handling on the shared worker of the channel */
+	struct kthread_work	work;
 };
 
 struct sbuf_mgr *sbuf_register_notifier_ex(u8 dst, u8 channel, u32 mark,
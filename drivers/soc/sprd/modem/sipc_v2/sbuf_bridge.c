@@ -47,8 +47,6 @@ struct sb_action {
 	struct sbuf_bridge	*sb;
 
 	void	*actions;
-	char	*buf;
-	u32	buf_size;
 	char	name[20];
 };
 
@@ -206,15 +204,20 @@ static int sb_sring_can_write(struct sbuf_ring *r_rx,
 	return min(rd, wt);
 }
 
-/* read from sbuf_rx and write to sbuf_tx. */
+/*
+ * Write the unread data of sbuf_rx straight from its rx ring into sbuf_tx
+ * and give it back to the peer of sbuf_rx in one go. There is no bounce
+ * buffer, so each byte is copied once, and a pass moves all it can with at
+ * most one read event to the peer of sbuf_rx.
+ */
 static void sb_data_move(struct sb_action *sba, u32 bufid)
 {
-	u32 has_data;
-	int rd, wt, size;
-	struct sbuf_ring *r_rx, *r_tx;
 	struct sbuf_mgr *sbuf_rx = sba->sbuf_rx;
 	struct sbuf_mgr *sbuf_tx = sba->sbuf_tx;
 	struct sbuf_bridge *sb = sba->sb;
+	struct sbuf_ring *r_rx, *r_tx;
+	u32 offset, len, rx_size, seg;
+	int size, wt, done;
 
 	if (!sb->ready) {
 		dev_err(sb->dev, "%s is not ready.", sba->name);
@@ -223,42 +226,39 @@ static void sb_data_move(struct sb_action *sba, u32 bufid)
 
 	r_rx = sbuf_rx->rings + bufid;
 	r_tx = sbuf_tx->rings + bufid;
+	rx_size = r_rx->header_op.rx_size;
 
-	/* only alloc once, will free it in remove function. */
-	if (!sba->buf) {
-		sba->buf_size = r_rx->header_op.rx_size;
-		sba->buf = devm_kzalloc(sb->dev, sba->buf_size, GFP_KERNEL);
-		if (!sba->buf)
-			return;
-		dev_info(sb->dev, "%s rx_size is 0x%x",
-			 sba->name, sba->buf_size);
-	}
-
-	do {
-		/* init has data to 0. */
-		has_data = 0;
-		rd = sb_sring_can_write(r_rx, r_tx, sbuf_rx->dst, sbuf_tx->dst);
+	for (;;) {
+		size = sb_sring_can_write(r_rx, r_tx, sbuf_rx->dst,
+					  sbuf_tx->dst);
 		dev_dbg(sb->dev, "%s: ring[%d] can write =0x%x",
-			sba->name, bufid, rd);
-		if (rd <= 0)
-			continue;
-
-		size = (int)sba->buf_size;
-		rd = min(rd, size);
+			sba->name, bufid, size);
+		if (size <= 0)
+			break;
 
-		rd = sbuf_read(sbuf_rx->dst, sbuf_rx->channel,
-			       bufid, sba->buf, rd, 0);
-		if (rd <= 0)
+		if (sbuf_rx_peek(sbuf_rx->dst, sbuf_rx->channel, bufid,
+				 &offset, &len))
 			break;
 
-		has_data = 1;
-		wt = sbuf_write(sbuf_tx->dst, sbuf_tx->channel,
-				bufid, sba->buf, rd, 0);
+		/* the data may wrap around the end of the rx ring */
+		size = min_t(u32, size, len);
+		for (done = 0; done < size; done += wt) {
+			seg = min_t(u32, size - done, rx_size - offset);
+			wt = sbuf_write(sbuf_tx->dst, sbuf_tx->channel, bufid,
+					r_rx->rxbuf_virt + offset, seg, 0);
+			if (wt <= 0)
+				break;
+			offset = (offset + wt) % rx_size;
+		}
 
-		if (rd != wt)
+		if (done != size)
 			dev_warn(sb->dev, "%s, bufid=%d, rd=%d, wr=%d\n",
-				 sba->name, bufid, rd, wt);
-	} while (has_data);
+				 sba->name, bufid, size, done);
+		if (done <= 0 ||
+		    sbuf_rx_consume(sbuf_rx->dst, sbuf_rx->channel, bufid,
+				    done))
+			break;
+	}
 }
 
 static void sb_bridge_do_actions(u32 action, int param, void *data)
@@ -372,15 +372,11 @@ static int  sbuf_bridge_remove(struct platform_device *pdev)
 	if (sb) {
 		cancel_work_sync(&sb->register_work);
 
-		if (sb->a_to_b_action.actions) {
-			devm_kfree(&pdev->dev, sb->a_to_b_action.buf);
+		if (sb->a_to_b_action.actions)
 			sprd_destroy_action_queue(sb->a_to_b_action.actions);
-		}
 
-		if (sb->b_to_a_action.actions) {
-			devm_kfree(&pdev->dev, sb->b_to_a_action.buf);
+		if (sb->b_to_a_action.actions)
 			sprd_destroy_action_queue(sb->b_to_a_action.actions);
-		}
 
 		devm_kfree(&pdev->dev, sb);
 		platform_set_drvdata(pdev, NULL);
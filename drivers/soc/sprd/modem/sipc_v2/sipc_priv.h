@@ -16,6 +16,7 @@
 #include <linux/ktime.h>
 #include <linux/device.h>
 #include <linux/interrupt.h>
+#include <linux/kthread.h>
 #include <linux/soc/sprd/sprd_mpm.h>
 
 #ifdef CONFIG_SPRD_MAILBOX
@@ -119,12 +120,21 @@ struct smsg_ipc {
 #endif
 	/* lock for send-buffer */
 	spinlock_t		txpinlock;
+	/* events dropped because an equal one was still pending */
+	u32			evt_coalesced;
 	/* all fixed channels receivers */
 	struct smsg_channel	*channels[SMSG_VALID_CH_NR];
 	/* record the runtime status of smsg channel */
 	atomic_t		busy[SMSG_VALID_CH_NR];
 	/* all channel states: 0 unused, 1 be opened by other core, 2 opend */
 	u8			states[SMSG_VALID_CH_NR];
+
+	/* one worker per sipc_config priority, created on first use */
+	struct kthread_worker	*workers[SIPC_PRIO_NR];
+	/* per channel rx work, queued whenever a msg is cached */
+	struct kthread_work	*ch_works[SMSG_VALID_CH_NR];
+	/* lock for ch_works */
+	spinlock_t		work_lock;
 };
 
 #define CHAN_STATE_UNUSED		0
@@ -137,6 +147,16 @@ void smsg_init_channel2index(void);
 void smsg_ipc_create(struct smsg_ipc *ipc);
 void smsg_ipc_destroy(struct smsg_ipc *ipc);
 
+/*
+ * msgs a channel work handles before it requeues itself, so that one busy
+ * channel cannot hold off the other channels sharing its worker
+ */
+#define SMSG_WORK_BATCH		16
+
+int smsg_ch_set_work(u8 dst, u8 channel, struct kthread_work *work);
+void smsg_ch_clear_work(u8 dst, u8 channel);
+void smsg_ch_kick_work(u8 dst, u8 channel);
+
 /*smem alloc size align*/
 #define SMEM_ALIGN_POOLSZ 0x40000	/*256KB*/
 
@@ -37,6 +37,7 @@
 #include <linux/if_ether.h>
 #include <linux/sipc.h>
 #include <linux/of_device.h>
+#include <linux/percpu.h>
 
 /* debug{ */
 #include <linux/delay.h>
@@ -87,38 +88,117 @@ static inline void SIPX_PARSE_DESC(u16 desc, u32 *length, u16 *offset)
 	*offset = (desc >> 11) & 0x1F;
 }
 
-static int sipx_get_item_from_pool(struct sipx_pool *pool, struct sblock *blk)
+/*
+ * Take up to n free blocks off the fifo of pool with a single rdptr update,
+ * returns how many it got.
+ */
+static int sipx_get_items_from_pool(struct sipx_pool *pool, u16 *index,
+				    int n)
 {
 	unsigned long flags;
-	int pos;
-	int ret = 0;
+	u32 rd, avail;
+	int i, pos;
 
 	/* multi-gotter may cause got failure */
 	spin_lock_irqsave(&pool->lock, flags);
-	if (pool->fifo_info->fifo_rdptr != pool->fifo_info->fifo_wrptr) {
-		pos = sblock_get_ringpos(pool->fifo_info->fifo_rdptr,
-					 pool->fifo_size);
-		blk->index = pool->fifo_buf[pos].index;
-		blk->addr = pool->blks_buf +  blk->index * pool->blk_size;
-		blk->length = pool->blk_size;
-		pool->fifo_info->fifo_rdptr++;
-	} else {
-		ret = -EAGAIN;
+	rd = pool->fifo_info->fifo_rdptr;
+	avail = pool->fifo_info->fifo_wrptr - rd;
+	n = min_t(u32, n, avail);
+	/* the items are only valid once wrptr is seen */
+	rmb();
+	for (i = 0; i < n; i++) {
+		pos = sblock_get_ringpos(rd + i, pool->fifo_size);
+		index[i] = pool->fifo_buf[pos].index;
+	}
+	pool->fifo_info->fifo_rdptr = rd + n;
+	spin_unlock_irqrestore(&pool->lock, flags);
+
+	return n;
+}
+
+/*
+ * Every sender gets its blocks from the same pool, so each cpu keeps a few
+ * free blocks of its own and refills them cache_batch at a time. A cpu may
+ * hold up to cache_max blocks, sized for all cpus together to keep no more
+ * than a quarter of the pool off the fifo.
+ */
+static void sipx_pool_enable_cache(struct sipx_pool *pool)
+{
+	pool->cache_max = min_t(u32, SIPX_POOL_CACHE,
+				pool->fifo_size / (4 * num_possible_cpus()));
+	if (pool->cache_max < 2)
+		return;
+
+	pool->cache_batch = pool->cache_max / 2;
+	/* it is only faster with the cache, not wrong without */
+	pool->cache = alloc_percpu(struct sipx_pool_cache);
+}
+
+static void sipx_destroy_pool(struct sipx_pool *pool)
+{
+	if (!pool)
+		return;
+
+	free_percpu(pool->cache);
+	kfree(pool);
+}
+
+static int sipx_get_item_from_pool(struct sipx_pool *pool, struct sblock *blk)
+{
+	struct sipx_pool_cache *cache;
+	unsigned long flags;
+	u16 index;
+	int ret = 0;
+
+	if (!pool->cache) {
+		if (!sipx_get_items_from_pool(pool, &index, 1))
+			return -EAGAIN;
+		goto got;
 	}
 
-	spin_unlock_irqrestore(&pool->lock, flags);
+	/* senders run in any context, irqs off as the pool lock did */
+	local_irq_save(flags);
+	cache = this_cpu_ptr(pool->cache);
+	if (!cache->cnt)
+		cache->cnt = sipx_get_items_from_pool(pool, cache->index,
+						      pool->cache_batch);
+	if (cache->cnt)
+		index = cache->index[--cache->cnt];
+	else
+		ret = -EAGAIN;
+	local_irq_restore(flags);
 
-	return ret;
+	if (ret)
+		return ret;
+got:
+	blk->index = index;
+	blk->addr = pool->blks_buf + index * pool->blk_size;
+	blk->length = pool->blk_size;
+
+	return 0;
 }
 
 static int sipx_put_item_back_to_pool(struct sipx_pool *pool,
 				      struct sblock *blk)
 {
+	struct sipx_pool_cache *cache;
 	unsigned long flags;
 	int pos;
-	int ret = 0;
+	int ret = -1;
 	u32 last_rdptr;
 
+	if (pool->cache) {
+		local_irq_save(flags);
+		cache = this_cpu_ptr(pool->cache);
+		if (cache->cnt < pool->cache_max) {
+			cache->index[cache->cnt++] = blk->index;
+			ret = 0;
+		}
+		local_irq_restore(flags);
+		if (!ret)
+			return 0;
+	}
+
 	spin_lock_irqsave(&pool->lock, flags);
 	if ((pool->fifo_info->fifo_wrptr - pool->fifo_info->fifo_rdptr)
 			< pool->fifo_size) {
@@ -126,8 +206,7 @@ static int sipx_put_item_back_to_pool(struct sipx_pool *pool,
 		pos = sblock_get_ringpos(last_rdptr, pool->fifo_size);
 		pool->fifo_buf[pos].index = blk->index;
 		pool->fifo_info->fifo_rdptr = last_rdptr;
-	} else {
-		ret = -1;
+		ret = 0;
 	}
 
 	spin_unlock_irqrestore(&pool->lock, flags);
@@ -166,15 +245,62 @@ static int sipx_put_item_into_pool(struct sipx_pool *pool, struct sblock *blk)
 	return ret;
 }
 
+/*
+ * Put the blocks of blks which belong to pool, the ack ones or the others,
+ * into its fifo and publish them with a single wrptr update.
+ */
+static int sipx_put_items_into_pool(struct sipx_pool *pool,
+				    struct sblock *blks, int n, bool ack)
+{
+	struct sipx_mgr *sipx = pool->sipx;
+	unsigned long flags;
+	int i, pos;
+	int ret = 0;
+	u32 wr, rd;
+
+	spin_lock_irqsave(&pool->lock, flags);
+
+	wr = pool->fifo_info->fifo_wrptr;
+	rd = pool->fifo_info->fifo_rdptr;
+	for (i = 0; i < n; i++) {
+		if (!!IS_DL_BLK_ACK(sipx, &blks[i]) != ack)
+			continue;
+
+		if ((wr - rd) >= pool->fifo_size) {
+			SIPX_ERR("%s fail: wr:0x%x, rd:0x%x, size:%d\n",
+				 __func__, wr, rd, pool->fifo_size);
+			ret = -1;
+			break;
+		}
+
+		pos = sblock_get_ringpos(wr, pool->fifo_size);
+		(*(u32 *)(&pool->fifo_buf[pos])) = blks[i].index;
+		wr++;
+	}
+	/* the items must be out before the peer sees wrptr */
+	wmb();
+	pool->fifo_info->fifo_wrptr = wr;
+
+	spin_unlock_irqrestore(&pool->lock, flags);
+
+	return ret;
+}
+
 static int sipx_get_pool_free_count(struct sipx_pool *pool)
 {
 	unsigned long flags;
 	int ret = 0;
+	int cpu;
 
 	spin_lock_irqsave(&pool->lock, flags);
 	ret = pool->fifo_info->fifo_wrptr - pool->fifo_info->fifo_rdptr;
 	spin_unlock_irqrestore(&pool->lock, flags);
 
+	/* the blocks the cpus keep are free as well */
+	if (pool->cache)
+		for_each_possible_cpu(cpu)
+			ret += READ_ONCE(per_cpu_ptr(pool->cache, cpu)->cnt);
+
 	return ret;
 }
 
@@ -248,6 +374,51 @@ static int sipx_get_item_from_ring(struct sipx_ring *ring, struct sblock *blk)
 	return ret;
 }
 
+/*
+ * Take up to n blocks off ring with a single rdptr update, returns how many
+ * it got.
+ */
+static int sipx_get_items_from_ring(struct sipx_ring *ring,
+				    struct sblock *blks, int n)
+{
+	struct sipx_blk_item item;
+	struct sblock *blk;
+	unsigned long flags;
+	u32 rd, avail;
+	int i, pos;
+
+	spin_lock_irqsave(&ring->lock, flags);
+
+	rd = ring->fifo_info->fifo_rdptr;
+	avail = ring->fifo_info->fifo_wrptr - rd;
+	n = min_t(u32, n, avail);
+	/* the items are only valid once wrptr is seen */
+	rmb();
+	for (i = 0; i < n; i++) {
+		blk = &blks[i];
+		pos = sblock_get_ringpos(rd + i, ring->fifo_size);
+		/* force compiler do one 4-bytes operation */
+		(*(u32 *)&item) = (*(u32 *)(&ring->fifo_buf[pos]));
+
+		SIPX_PARSE_DESC(item.desc, &blk->length, &blk->offset);
+		blk->index = item.index;
+		blk->addr = ring->blks_buf + (blk->index * ring->blk_size) +
+			blk->offset;
+	}
+	ring->fifo_info->fifo_rdptr = rd + n;
+
+	spin_unlock_irqrestore(&ring->lock, flags);
+
+#ifdef CONFIG_SPRD_SIPC_MEM_CACHE_EN
+	/* the blocks are ours now, no need to hold the ring for this */
+	for (i = 0; i < n; i++)
+		SIPC_DATA_TO_SKB_CACHE_INV(blks[i].addr,
+					   blks[i].addr + blks[i].length);
+#endif
+
+	return n;
+}
+
 static int sipx_get_ring_item_cnt(struct sipx_ring *ring)
 {
 	unsigned long flags;
@@ -568,10 +739,10 @@ static int create_sipx_pool_ctrl(struct sipx_pool **out,
 
 static int destroy_spix_mgr(struct sipx_mgr *sipx)
 {
-	kfree(sipx->dl_pool);
-	kfree(sipx->dl_ack_pool);
-	kfree(sipx->ul_pool);
-	kfree(sipx->ul_ack_pool);
+	sipx_destroy_pool(sipx->dl_pool);
+	sipx_destroy_pool(sipx->dl_ack_pool);
+	sipx_destroy_pool(sipx->ul_pool);
+	sipx_destroy_pool(sipx->ul_ack_pool);
 
 	if (sipx->smem_virt)
 		shmem_ram_unmap(sipx->dst, sipx->smem_virt);
@@ -831,6 +1002,10 @@ static int create_sipx_mgr(struct sipx_mgr **out, struct sipx_init_data *pdata)
 	if (ret)
 		goto fail;
 
+	/* AP only gets blocks from the ul pools */
+	sipx_pool_enable_cache(sipx->ul_pool);
+	sipx_pool_enable_cache(sipx->ul_ack_pool);
+
 	/* channel count */
 	chan_cnt = (volatile u32 *)((sipx->smem_virt) +
 			offset_chan_cnt);
@@ -1296,6 +1471,97 @@ int sipx_release(u8 dst, u8 channel, struct sblock *blk)
 }
 EXPORT_SYMBOL_GPL(sipx_release);
 
+int sipx_receive_bulk(u8 dst, u8 channel, struct sblock *blks, int n)
+{
+	struct sipx_mgr *sipx = (struct sipx_mgr *)sipxs[dst];
+	struct sipx_channel *sipx_chan;
+	int cnt;
+	u8 ch_index;
+
+	ch_index = sipc_channel2index(channel);
+	if (ch_index == INVALID_CHANEL_INDEX) {
+		SIPX_ERR("%s:channel %d invalid!\n", __func__, channel);
+		return -EINVAL;
+	}
+
+	if (!sipx) {
+		SIPX_ERR("sipx-%d-%d %s sipx not exist!\n",
+			 dst, channel, __func__);
+		return -ENODEV;
+	}
+
+	sipx_chan = sipx->channels[ch_index];
+
+	if (!sipx_chan) {
+		SIPX_ERR("sipx-%d-%d %s not exist\n",
+			 dst, channel, __func__);
+		return -ENODEV;
+	}
+
+	if (sipx_chan->state != SBLOCK_STATE_READY) {
+		SIPX_ERR("sipx-%d-%d %s not ready!\n",
+			 dst, channel, __func__);
+		return -EIO;
+	}
+
+	/* check ack ring first, then normal ring */
+	cnt = sipx_get_items_from_ring(sipx_chan->dl_ack_ring, blks, n);
+	cnt += sipx_get_items_from_ring(sipx_chan->dl_ring, blks + cnt,
+					n - cnt);
+
+	/* save record, as sipx_receive one by one would have */
+	if (cnt) {
+		sipx_chan->dl_record_flag = 1;
+		sipx_chan->dl_record_blk = blks[cnt - 1];
+	}
+
+	return cnt;
+}
+EXPORT_SYMBOL_GPL(sipx_receive_bulk);
+
+int sipx_release_bulk(u8 dst, u8 channel, struct sblock *blks, int n)
+{
+	struct sipx_mgr *sipx = (struct sipx_mgr *)sipxs[dst];
+	struct sipx_channel *sipx_chan;
+	int ret;
+	u8 ch_index;
+
+	ch_index = sipc_channel2index(channel);
+	if (ch_index == INVALID_CHANEL_INDEX) {
+		SIPX_ERR("%s:channel %d invalid!\n", __func__, channel);
+		return -EINVAL;
+	}
+
+	if (!sipx) {
+		SIPX_ERR("sipx-%d-%d %s sipx not exist!\n",
+			 dst, channel, __func__);
+		return -ENODEV;
+	}
+
+	sipx_chan = sipx->channels[ch_index];
+
+	if (!sipx_chan) {
+		SIPX_ERR("sipx-%d-%d %s not exist\n",
+			 dst, channel, __func__);
+		return -ENODEV;
+	}
+
+	if (sipx_chan->state != SBLOCK_STATE_READY) {
+		SIPX_ERR("sipx-%d-%d %s not ready!\n",
+			 dst, channel, __func__);
+		return -EIO;
+	}
+
+	ret = sipx_put_items_into_pool(sipx->dl_ack_pool, blks, n, true);
+	if (sipx_put_items_into_pool(sipx->dl_pool, blks, n, false))
+		ret = -1;
+
+	/* pop record */
+	sipx_chan->dl_record_flag = 0;
+	return ret;
+}
+EXPORT_SYMBOL_GPL(sipx_release_bulk);
+
 int sipx_get_arrived_count(u8 dst, u8 channel)
 {
 	struct sipx_mgr *sipx = (struct sipx_mgr *)sipxs[dst];
@@ -91,6 +91,14 @@ struct sipx_fifo_info {
 	u32	fifo_addr;
 };
 
+/* max free blocks a cpu keeps off a pool, see sipx_pool_enable_cache */
+#define SIPX_POOL_CACHE		16
+
+struct sipx_pool_cache {
+	u16	cnt;
+	u16	index[SIPX_POOL_CACHE];
+};
+
 struct sipx_pool {
 	volatile struct sipx_fifo_info *fifo_info;
 	struct sipx_blk_item *fifo_buf;/* virt of info->fifo_addr */
@@ -101,6 +109,11 @@ struct sipx_pool {
 	/* lock for sipx-pool */
 	spinlock_t lock;
 
+	/* per cpu free blocks of the pools AP gets from, NULL for the others */
+	struct sipx_pool_cache __percpu *cache;
+	u32 cache_max;
+	u32 cache_batch;
+
 	struct sipx_mgr *sipx;
 };
 
@@ -55,6 +55,7 @@ struct smem_pool {
 	u32	mem_type;
 
 	atomic_t	used;
+	atomic_t	fails;
 	struct gen_pool	*gen;
 };
 
@@ -298,6 +299,13 @@ int smem_init(u32 addr, u32 size, u32 dst, u32 mem_type)
 		return -1;
 	}
 
+	/*
+	 * Channels come and go with every modem restart, first fit would
+	 * leave their small blocks spread over the pool until the large
+	 * sbuf rings no longer fit anywhere.
+	 */
+	gen_pool_set_algo(spool->gen, gen_pool_best_fit, NULL);
+
 	if (gen_pool_add(spool->gen, spool->addr, spool->size, -1) != 0) {
 		pr_err("Failed to add smem gen pool!\n");
 		return -1;
@@ -326,6 +334,36 @@ int smem_init(u32 addr, u32 size, u32 dst, u32 mem_type)
 	return 0;
 }
 
+struct smem_frag {
+	size_t largest;
+	u32 holes;
+};
+
+static void smem_frag_chunk(struct gen_pool *gen,
+			    struct gen_pool_chunk *chunk, void *data)
+{
+	struct smem_frag *frag = data;
+	int order = gen->min_alloc_order;
+	unsigned long nbits, start, end;
+
+	nbits = (chunk->end_addr - chunk->start_addr + 1) >> order;
+	for (start = find_first_zero_bit(chunk->bits, nbits); start < nbits;
+	     start = find_next_zero_bit(chunk->bits, nbits, end)) {
+		end = find_next_bit(chunk->bits, nbits, start);
+		frag->largest = max_t(size_t, frag->largest,
+				      (end - start) << order);
+		frag->holes++;
+	}
+}
+
+/* the largest block smem_alloc() could still give and the free holes */
+static void smem_pool_frag(struct smem_pool *spool, struct smem_frag *frag)
+{
+	frag->largest = 0;
+	frag->holes = 0;
+	gen_pool_for_each_chunk(spool->gen, smem_frag_chunk, frag);
+}
+
 /* ****************************************************************** */
 u32 smem_alloc(u8 dst, u32 size)
 {
@@ -351,8 +389,14 @@ u32 smem_alloc(u8 dst, u32 size)
 
 	addr = gen_pool_alloc(spool->gen, size);
 	if (!addr) {
+		struct smem_frag frag;
+
+		atomic_inc(&spool->fails);
+		smem_pool_frag(spool, &frag);
 		pr_err("%s:pool dst=%d, size=0x%x failed to alloc smem!\n",
 		       __func__, dst, size);
+		pr_err("%s: free=0x%zx, largest=0x%zx, holes=%u\n", __func__,
+		       gen_pool_avail(spool->gen), frag.largest, frag.holes);
 		kfree(recd);
 		return 0;
 	}
@@ -382,23 +426,30 @@ void smem_free(u8 dst, u32 addr, u32 size)
 		return;
 	}
 
-	if (size >= SMEM_ALIGN_POOLSZ)
+	/*
+	 * Free what was allocated. The size of the caller aligned by itself
+	 * may be short of it on a page aligned pool, and every channel
+	 * destroyed would leak a tail of its block.
+	 */
+	if (spool->size >= SMEM_ALIGN_POOLSZ)
 		size = PAGE_ALIGN(size);
 	else
 		size = ALIGN(size, SMEM_ALIGN_BYTES);
 
-	atomic_sub(size, &spool->used);
-	gen_pool_free(spool->gen, addr, size);
 	/* delete record node from list */
 	spin_lock_irqsave(&spool->lock, flags);
 	list_for_each_entry_safe(recd, next, &spool->smem_head, smem_list) {
 		if (recd->addr == addr) {
+			size = recd->size;
 			list_del(&recd->smem_list);
 			kfree(recd);
 			break;
 		}
 	}
 	spin_unlock_irqrestore(&spool->lock, flags);
+
+	atomic_sub(size, &spool->used);
+	gen_pool_free(spool->gen, addr, size);
 }
 EXPORT_SYMBOL_GPL(smem_free);
 
@@ -467,6 +518,7 @@ static int smem_debug_show(struct seq_file *m, void *private)
 	struct smem_phead *phead = &sipc_smem_phead;
 	struct smem_pool *spool, *pos;
 	struct smem_record *recd;
+	struct smem_frag frag;
 	u32 fsize;
 	unsigned long flags;
 	u32 cnt = 1;
@@ -482,6 +534,9 @@ static int smem_debug_show(struct seq_file *m, void *private)
 			   (smsg_ipcs[spool->dst])->name);
 		seq_printf(m, "phys_addr=0x%x, total=0x%x, used=0x%x, free=0x%x\n",
 			spool->addr, spool->size, spool->used.counter, fsize);
+		smem_pool_frag(spool, &frag);
+		seq_printf(m, "largest free=0x%zx, free holes=%u, alloc fails=%d\n",
+			   frag.largest, frag.holes, atomic_read(&spool->fails));
 		seq_puts(m, "smem record list:\n");
 
 		list_for_each_entry(recd, &spool->smem_head, smem_list) {
@@ -16,6 +16,7 @@
 #include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/kernel.h>
+#include <linux/kthread.h>
 #include <linux/module.h>
 #include <linux/sched.h>
 #include <linux/seq_file.h>
@@ -67,6 +68,16 @@ static ushort debug_enable;
 module_param_named(debug_enable, debug_enable, ushort, 0644);
 static u8 channel2index[SMSG_CH_NR + 1];
 
+/*
+ * Event messages only tell the peer to look at a channel again. One that
+ * the peer has not reached yet in the tx ring covers an equal new one,
+ * so the new one is neither written nor rung. The last coal_window
+ * pending messages are compared, 0 turns coalescing off.
+ */
+static uint smsg_coal_window = 8;
+
+module_param_named(coal_window, smsg_coal_window, uint, 0644);
+
 static int smsg_ipc_smem_init(struct smsg_ipc *ipc);
 
 void smsg_init_channel2index(void)
@@ -155,6 +166,18 @@ static void smsg_die_process(struct smsg_ipc *ipc, struct smsg *msg)
 	}
 }
 
+static void smsg_ch_queue_work(struct smsg_ipc *ipc, u8 ch_index)
+{
+	struct kthread_work *work;
+	unsigned long flags;
+
+	spin_lock_irqsave(&ipc->work_lock, flags);
+	work = ipc->ch_works[ch_index];
+	if (work)
+		kthread_queue_work(ipc->workers[sipc_cfg[ch_index].prio], work);
+	spin_unlock_irqrestore(&ipc->work_lock, flags);
+}
+
 static void smsg_msg_process(struct smsg_ipc *ipc,
 			     struct smsg *msg, bool wake_lock)
 {
@@ -210,6 +233,7 @@ static void smsg_msg_process(struct smsg_ipc *ipc,
 	}
 
 	wake_up_interruptible_all(&ch->rxwait);
+	smsg_ch_queue_work(ipc, ch_index);
 
 	if (wake_lock)
 		sprd_pms_request_wakelock_period(ch->rx_pms, 500);
@@ -491,6 +515,7 @@ void smsg_ipc_create(struct smsg_ipc *ipc)
 {
 	pr_info("%s: %s\n", __func__, ipc->name);
 
+	spin_lock_init(&ipc->work_lock);
 	smsg_ipcs[ipc->dst] = ipc;
 
 	smsg_ipc_mpm_init(ipc);
@@ -515,6 +540,8 @@ void smsg_ipc_create(struct smsg_ipc *ipc)
 
 void smsg_ipc_destroy(struct smsg_ipc *ipc)
 {
+	int i;
+
 	shmem_ram_unmap(ipc->dst, ipc->smem_vbase);
 	smem_free(ipc->dst, ipc->ring_base, SZ_4K);
 
@@ -543,6 +570,13 @@ void smsg_ipc_destroy(struct smsg_ipc *ipc)
 		free_irq(ipc->irq, ipc);
 	}
 
+	for (i = 0; i < SIPC_PRIO_NR; i++) {
+		if (ipc->workers[i]) {
+			kthread_destroy_worker(ipc->workers[i]);
+			ipc->workers[i] = NULL;
+		}
+	}
+
 	smsg_ipcs[ipc->dst] = NULL;
 }
 
@@ -588,6 +622,113 @@ int smsg_ch_wake_unlock(u8 dst, u8 channel)
 }
 EXPORT_SYMBOL_GPL(smsg_ch_wake_unlock);
 
+static DEFINE_MUTEX(smsg_worker_lock);
+
+static struct kthread_worker *smsg_get_worker(struct smsg_ipc *ipc, u8 prio)
+{
+	static const char * const names[SIPC_PRIO_NR] = {
+		[SIPC_PRIO_NORMAL] = "normal",
+		[SIPC_PRIO_RT] = "rt",
+		[SIPC_PRIO_BULK] = "bulk",
+	};
+	struct sched_param param = {};
+	struct kthread_worker *worker;
+
+	mutex_lock(&smsg_worker_lock);
+	worker = ipc->workers[prio];
+	if (worker)
+		goto out;
+
+	worker = kthread_create_worker(0, "sipc-%d-%s", ipc->dst, names[prio]);
+	if (IS_ERR(worker)) {
+		pr_err("%s: dst=%d create %s worker failed!\n",
+		       __func__, ipc->dst, names[prio]);
+		goto out;
+	}
+
+	/* the same policies the per channel threads used to run with */
+	if (prio == SIPC_PRIO_RT) {
+		param.sched_priority = 89;
+		sched_setscheduler(worker->task, SCHED_FIFO, &param);
+	} else if (prio == SIPC_PRIO_NORMAL) {
+		param.sched_priority = 88;
+		sched_setscheduler(worker->task, SCHED_RR, &param);
+	}
+
+	ipc->workers[prio] = worker;
+out:
+	mutex_unlock(&smsg_worker_lock);
+	return worker;
+}
+
+/*
+ * Hand the rx side of a channel to the shared worker of its priority
+ * class, @work runs whenever a msg is cached for the channel and should
+ * drain the cache with smsg_recv(timeout 0). It is queued once right away
+ * for the msgs that came in before.
+ */
+int smsg_ch_set_work(u8 dst, u8 channel, struct kthread_work *work)
+{
+	struct smsg_ipc *ipc = smsg_ipcs[dst];
+	struct kthread_worker *worker;
+	unsigned long flags;
+	u8 ch_index;
+
+	ch_index = channel2index[channel];
+	if (ch_index == INVALID_CHANEL_INDEX) {
+		pr_err("%s:channel %d invalid!\n", __func__, channel);
+		return -EINVAL;
+	}
+
+	if (!ipc)
+		return -ENODEV;
+
+	worker = smsg_get_worker(ipc, sipc_cfg[ch_index].prio);
+	if (IS_ERR(worker))
+		return PTR_ERR(worker);
+
+	spin_lock_irqsave(&ipc->work_lock, flags);
+	ipc->ch_works[ch_index] = work;
+	kthread_queue_work(worker, work);
+	spin_unlock_irqrestore(&ipc->work_lock, flags);
+
+	return 0;
+}
+
+/* stop queuing the channel work and wait for a running one to finish */
+void smsg_ch_clear_work(u8 dst, u8 channel)
+{
+	struct smsg_ipc *ipc = smsg_ipcs[dst];
+	struct kthread_work *work;
+	unsigned long flags;
+	u8 ch_index;
+
+	ch_index = channel2index[channel];
+	if (ch_index == INVALID_CHANEL_INDEX || !ipc)
+		return;
+
+	spin_lock_irqsave(&ipc->work_lock, flags);
+	work = ipc->ch_works[ch_index];
+	ipc->ch_works[ch_index] = NULL;
+	spin_unlock_irqrestore(&ipc->work_lock, flags);
+
+	if (work)
+		kthread_cancel_work_sync(work);
+}
+
+/* requeue the channel work, for a work leaving msgs behind */
+void smsg_ch_kick_work(u8 dst, u8 channel)
+{
+	struct smsg_ipc *ipc = smsg_ipcs[dst];
+	u8 ch_index;
+
+	ch_index = channel2index[channel];
+	if (ch_index == INVALID_CHANEL_INDEX || !ipc)
+		return;
+
+	smsg_ch_queue_work(ipc, ch_index);
+}
+
 int smsg_ch_open(u8 dst, u8 channel, int timeout)
 {
 	struct smsg_ipc *ipc = smsg_ipcs[dst];
@@ -779,6 +920,39 @@ int smsg_senddie(u8 dst)
 }
 EXPORT_SYMBOL_GPL(smsg_senddie);
 
+/* called with txpinlock held */
+static bool smsg_event_pending(struct smsg_ipc *ipc, struct smsg *msg)
+{
+	u32 window = READ_ONCE(smsg_coal_window);
+	u32 wr, rd, n;
+	uintptr_t txpos;
+
+	if (msg->type != SMSG_TYPE_EVENT || !window)
+		return false;
+
+	wr = SIPC_READL(ipc->txbuf_wrptr);
+	rd = SIPC_READL(ipc->txbuf_rdptr);
+
+	/*
+	 * The message at rdptr may already be handled by the peer, which
+	 * moves rdptr only afterwards, so it does not count as pending.
+	 */
+	n = wr - rd;
+	if (n <= 1)
+		return false;
+	n = min(n - 1, window);
+
+	while (n--) {
+		wr--;
+		txpos = (wr & (ipc->txbuf_size - 1)) *
+			sizeof(struct smsg) + ipc->txbuf_addr;
+		if (!memcmp((void *)txpos, msg, sizeof(struct smsg)))
+			return true;
+	}
+
+	return false;
+}
+
 int smsg_send(u8 dst, struct smsg *msg, int timeout)
 {
 	struct smsg_ipc *ipc = smsg_ipcs[dst];
@@ -786,6 +960,7 @@ int smsg_send(u8 dst, struct smsg *msg, int timeout)
 	uintptr_t txpos;
 	int rval = 0;
 	unsigned long flags;
+	bool coalesced = false;
 	u8 ch_index;
 
 	ch_index = channel2index[msg->channel];
@@ -833,6 +1008,11 @@ int smsg_send(u8 dst, struct smsg *msg, int timeout)
 				 SIPC_READL(ipc->txbuf_wrptr),
 				 SIPC_READL(ipc->txbuf_rdptr));
 			rval = -EBUSY;
+		} else if (ipc->type != SIPC_BASE_MBOX &&
+			   smsg_event_pending(ipc, msg)) {
+			/* the pending one already rang the doorbell */
+			ipc->evt_coalesced++;
+			coalesced = true;
 		} else {
 			/* calc txpos and write smsg */
 			txpos = (SIPC_READL(ipc->txbuf_wrptr) &
@@ -851,7 +1031,8 @@ int smsg_send(u8 dst, struct smsg *msg, int timeout)
 		return -EINVAL;
 	}
 
-	ipc->txirq_trigger(ipc->dst, *(u64 *)msg);
+	if (!coalesced)
+		ipc->txirq_trigger(ipc->dst, *(u64 *)msg);
 	sprd_pms_release_resource(ch->tx_pms);
 
 	return rval;
@@ -899,7 +1080,7 @@ int smsg_recv(u8 dst, struct smsg *msg, int timeout)
 
 		/* no wait */
 		if (SIPC_READL(ch->wrptr) == SIPC_READL(ch->rdptr)) {
-			pr_info("dst=%d, channel=%d smsg rx cache is empty!\n",
+			pr_debug("dst=%d, channel=%d smsg rx cache is empty!\n",
 				dst, msg->channel);
 
 			rval = -ENODATA;
@@ -1030,6 +1211,8 @@ static int smsg_debug_show(struct seq_file *m, void *private)
 				   SIPC_READL(ipc->rxbuf_rdptr),
 				   (void *)ipc->rxbuf_wrptr,
 				   SIPC_READL(ipc->rxbuf_wrptr));
+			seq_printf(m, "coalesced events: %u, window: %u\n",
+				   ipc->evt_coalesced, smsg_coal_window);
 
 			/* release resource */
 			sipc_smem_release_resource(ipc->sipc_pms, ipc->dst);
@@ -12,6 +12,7 @@
  */
 
 #include <linux/cdev.h>
+#include <linux/eventfd.h>
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/of_device.h>
@@ -19,6 +20,8 @@
 #include <linux/platform_device.h>
 #include <linux/slab.h>
 #include <linux/sipc.h>
+#include <linux/uaccess.h>
+#include <uapi/linux/sprd_spipe.h>
 
 #include "sipc_priv.h"
 #include "spipe.h"
@@ -34,6 +37,7 @@ struct spipe_sbuf {
 	u8			dst;
 	u8			channel;
 	u32		bufid;
+	struct eventfd_ctx	*rx_eventfd;	/* installed in the ring */
 };
 
 static struct class		*spipe_class;
@@ -52,7 +56,7 @@ static int spipe_open(struct inode *inode, struct file *filp)
 		return -ENODEV;
 	}
 
-	sbuf = kmalloc(sizeof(struct spipe_sbuf), GFP_KERNEL);
+	sbuf = kzalloc(sizeof(struct spipe_sbuf), GFP_KERNEL);
 	if (!sbuf)
 		return -ENOMEM;
 	filp->private_data = sbuf;
@@ -68,6 +72,9 @@ static int spipe_release(struct inode *inode, struct file *filp)
 {
 	struct spipe_sbuf *sbuf = filp->private_data;
 
+	if (sbuf->rx_eventfd)
+		sbuf_rx_swap_eventfd(sbuf->dst, sbuf->channel, sbuf->bufid,
+				     sbuf->rx_eventfd, NULL);
 	kfree(sbuf);
 
 	return 0;
@@ -107,17 +114,89 @@ static unsigned int spipe_poll(struct file *filp, poll_table *wait)
 			filp, wait);
 }
 
-static long spipe_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
+static int spipe_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct spipe_sbuf *sbuf = filp->private_data;
+
+	return sbuf_rx_mmap(sbuf->dst, sbuf->channel, sbuf->bufid, vma);
+}
+
+static int spipe_set_rx_eventfd(struct spipe_sbuf *sbuf, int fd)
 {
+	struct eventfd_ctx *ctx = NULL;
+	int ret;
+
+	if (fd >= 0) {
+		ctx = eventfd_ctx_fdget(fd);
+		if (IS_ERR(ctx))
+			return PTR_ERR(ctx);
+	}
+
+	ret = sbuf_rx_swap_eventfd(sbuf->dst, sbuf->channel, sbuf->bufid,
+				   sbuf->rx_eventfd, ctx);
+	if (ret) {
+		if (ctx)
+			eventfd_ctx_put(ctx);
+		return ret;
+	}
+	sbuf->rx_eventfd = ctx;
+
 	return 0;
 }
 
+static long spipe_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
+{
+	struct spipe_sbuf *sbuf = filp->private_data;
+	struct spipe_rx_window win;
+	int ret;
+
+	switch (cmd) {
+	case SPIPE_IOC_RX_PEEK:
+		ret = sbuf_rx_peek(sbuf->dst, sbuf->channel, sbuf->bufid,
+				   &win.offset, &win.len);
+		if (ret)
+			return ret;
+		if (copy_to_user((void __user *)arg, &win, sizeof(win)))
+			return -EFAULT;
+		return 0;
+
+	case SPIPE_IOC_RX_CONSUME:
+		return sbuf_rx_consume(sbuf->dst, sbuf->channel, sbuf->bufid,
+				       (u32)arg);
+
+	case SPIPE_IOC_RX_ADVANCE:
+		/* consume win.len bytes and return the window after them */
+		if (copy_from_user(&win, (void __user *)arg, sizeof(win)))
+			return -EFAULT;
+		if (win.len) {
+			ret = sbuf_rx_consume(sbuf->dst, sbuf->channel,
+					      sbuf->bufid, win.len);
+			if (ret)
+				return ret;
+		}
+		ret = sbuf_rx_peek(sbuf->dst, sbuf->channel, sbuf->bufid,
+				   &win.offset, &win.len);
+		if (ret)
+			return ret;
+		if (copy_to_user((void __user *)arg, &win, sizeof(win)))
+			return -EFAULT;
+		return 0;
+
+	case SPIPE_IOC_RX_EVENTFD:
+		return spipe_set_rx_eventfd(sbuf, (int)arg);
+
+	default:
+		return 0;
+	}
+}
+
 static const struct file_operations spipe_fops = {
 	.open		= spipe_open,
 	.release	= spipe_release,
 	.read		= spipe_read,
 	.write		= spipe_write,
 	.poll		= spipe_poll,
+	.mmap		= spipe_mmap,
 	.unlocked_ioctl	= spipe_ioctl,
 	.owner		= THIS_MODULE,
 	.llseek		= default_llseek,
@@ -168,6 +247,8 @@ static int spipe_parse_dt(struct spipe_init_data **init,
 	if (ret)
 		goto error;
 
+	pdata->rx_mmap = of_property_read_bool(np, "sprd,rx-mmap");
+
 	*init = pdata;
 	return ret;
 error:
@@ -213,8 +294,14 @@ static int spipe_probe(struct platform_device *pdev)
 			init->rxbuf_size,
 			init->txbuf_size);
 
-		rval = sbuf_create(init->dst, init->channel, init->ringnr,
-				   init->txbuf_size, init->rxbuf_size);
+		if (init->rx_mmap)
+			rval = sbuf_create_mmap(init->dst, init->channel,
+						init->ringnr, init->txbuf_size,
+						init->rxbuf_size);
+		else
+			rval = sbuf_create(init->dst, init->channel,
+					   init->ringnr, init->txbuf_size,
+					   init->rxbuf_size);
 		if (rval != 0) {
 			pr_err("Failed to create sbuf: %d\n", rval);
 			spipe_destroy_pdata(&init, &pdev->dev);
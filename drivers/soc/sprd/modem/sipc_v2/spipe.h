@@ -22,5 +22,7 @@ struct spipe_init_data {
 	u32	ringnr;
 	u32	txbuf_size;
 	u32	rxbuf_size;
+	/* rx rings can be mmap()ed, see uapi/linux/sprd_spipe.h */
+	bool	rx_mmap;
 };
 #endif
@@ -21,6 +21,7 @@
 #include <linux/kthread.h>
 #include <linux/miscdevice.h>
 #include <linux/module.h>
+#include <linux/perf_event.h>
 #include <linux/platform_device.h>
 #include <linux/slab.h>
 #include <linux/sysfs.h>
@@ -30,6 +31,7 @@
 #include <linux/of_address.h>
 #include <linux/of_irq.h>
 #include <linux/regmap.h>
+#include <linux/sprd_ptm.h>
 #include "sprd_ptm.h"
 
 #define CREATE_TRACE_POINTS
@@ -46,6 +48,7 @@ static const struct of_device_id sprd_ptm_of_match[] = {
 };
 static struct attribute_group ptm_legacy_group;
 static struct attribute_group ptm_trace_group;
+static struct sprd_ptm_dev *ptm_bw_dev;
 
 static inline u32 ptm_get_wbm_base(struct sprd_ptm_dev *sdev)
 {
@@ -502,6 +505,306 @@ static void sprd_ptm_legacy_stop(struct sprd_ptm_dev *sdev)
 	writel_relaxed(0, sdev->base + PTM_EN);
 }
 
+/**
+ * sprd_ptm_bw_sample - read the ddr traffic since the previous sample
+ * @rd: bytes read per ddr channel
+ * @wr: bytes written per ddr channel
+ * @nr: room in @rd and @wr
+ *
+ * For in kernel consumers like a ddr devfreq governor, the sample window
+ * is the time between two calls. The first call starts the counters and
+ * returns no channels.
+ *
+ * Return: number of channels filled, -ENODEV without a ptm or -EBUSY
+ * while the legacy or trace debug mode owns the counters.
+ */
+/*
+ * Fold the hardware counters into sdev->total and restart them, the in
+ * kernel users of the initial mode (bandwidth sampling and the perf pmu)
+ * share the totals instead of clearing the counters under each other.
+ * Called with sdev->slock held, returns false while a debug mode owns
+ * the counters.
+ */
+static bool sprd_ptm_accumulate(struct sprd_ptm_dev *sdev)
+{
+	u32 wbm_base = ptm_get_wbm_base(sdev);
+	u32 rbm_base = ptm_get_rbm_base(sdev);
+	u32 wly_base = ptm_get_wly_base(sdev);
+	u32 rly_base = ptm_get_rly_base(sdev);
+	u32 wtran_base = ptm_get_wtran_base(sdev);
+	u32 rtran_base = ptm_get_rtran_base(sdev);
+	int chn;
+
+	if (sdev->mode != INIT_MODE) {
+		sdev->bw_sampling = false;
+		return false;
+	}
+
+	if (!sdev->bw_sampling) {
+		sprd_ptm_set_winlen(sdev, PTM_REG_MAX);
+		sdev->bw_sampling = true;
+	} else {
+		/* it should clear ptm eb before read ptm data */
+		sprd_ptm_set_enable(sdev, false);
+		for (chn = 0; chn < sdev->pub_chn; chn++) {
+			sdev->total[chn][0] +=
+				readl_relaxed(sdev->base + rtran_base + 4 * chn);
+			sdev->total[chn][1] +=
+				readl_relaxed(sdev->base + rbm_base + 4 * chn);
+			sdev->total[chn][2] +=
+				readl_relaxed(sdev->base + rly_base + 4 * chn);
+			sdev->total[chn][3] +=
+				readl_relaxed(sdev->base + wtran_base + 4 * chn);
+			sdev->total[chn][4] +=
+				readl_relaxed(sdev->base + wbm_base + 4 * chn);
+			sdev->total[chn][5] +=
+				readl_relaxed(sdev->base + wly_base + 4 * chn);
+		}
+	}
+	writel_relaxed(1, sdev->base + CNT_CLR);
+	writel_relaxed(0, sdev->base + CNT_CLR);
+	writel_relaxed(readl_relaxed(sdev->base + PTM_EN) | PTM_ENABLE |
+		       PTM_BW_LTCY_CNT_EN, sdev->base + PTM_EN);
+
+	return true;
+}
+
+int sprd_ptm_bw_sample(u32 *rd, u32 *wr, int nr)
+{
+	struct sprd_ptm_dev *sdev = ptm_bw_dev;
+	unsigned long flags;
+	bool started;
+	int chn;
+
+	if (!sdev)
+		return -ENODEV;
+
+	nr = min(nr, sdev->pub_chn);
+
+	spin_lock_irqsave(&sdev->slock, flags);
+	started = sdev->bw_sampling;
+	if (!sprd_ptm_accumulate(sdev)) {
+		spin_unlock_irqrestore(&sdev->slock, flags);
+		return -EBUSY;
+	}
+
+	for (chn = 0; chn < nr; chn++) {
+		rd[chn] = sdev->total[chn][1] - sdev->bw_last[chn][0];
+		wr[chn] = sdev->total[chn][4] - sdev->bw_last[chn][1];
+		sdev->bw_last[chn][0] = sdev->total[chn][1];
+		sdev->bw_last[chn][1] = sdev->total[chn][4];
+	}
+	spin_unlock_irqrestore(&sdev->slock, flags);
+
+	return started ? nr : 0;
+}
+EXPORT_SYMBOL_GPL(sprd_ptm_bw_sample);
+
+/*
+ * Uncore style perf pmu over the initial mode counters. config bits 0-7
+ * select the ddr channel, bits 8-11 the counter in perf_data order, so
+ * e.g. perf stat -a -e sprd_ptm/rd_bytes,chn=2/ counts the bytes read on
+ * channel 2. Counting only, there is no overflow interrupt to sample on.
+ */
+#define PTM_PMU_CHN(config)		((config) & 0xff)
+#define PTM_PMU_TYPE(config)		(((config) >> 8) & 0xf)
+
+static u64 sprd_ptm_pmu_total(struct sprd_ptm_dev *sdev,
+			      struct perf_event *event)
+{
+	return sdev->total[PTM_PMU_CHN(event->attr.config)]
+			  [PTM_PMU_TYPE(event->attr.config)];
+}
+
+static void sprd_ptm_pmu_update(struct perf_event *event)
+{
+	struct sprd_ptm_dev *sdev = container_of(event->pmu,
+						 struct sprd_ptm_dev, pmu);
+	unsigned long flags;
+	u64 now;
+
+	spin_lock_irqsave(&sdev->slock, flags);
+	sprd_ptm_accumulate(sdev);
+	now = sprd_ptm_pmu_total(sdev, event);
+	local64_add(now - local64_read(&event->hw.prev_count), &event->count);
+	local64_set(&event->hw.prev_count, now);
+	spin_unlock_irqrestore(&sdev->slock, flags);
+}
+
+static enum hrtimer_restart sprd_ptm_pmu_timer(struct hrtimer *timer)
+{
+	struct sprd_ptm_dev *sdev = container_of(timer, struct sprd_ptm_dev,
+						 pmu_timer);
+
+	spin_lock(&sdev->slock);
+	sprd_ptm_accumulate(sdev);
+	spin_unlock(&sdev->slock);
+
+	hrtimer_forward_now(timer, ms_to_ktime(PTM_ACCUM_PERIOD_MS));
+	return HRTIMER_RESTART;
+}
+
+static int sprd_ptm_pmu_event_init(struct perf_event *event)
+{
+	struct sprd_ptm_dev *sdev = container_of(event->pmu,
+						 struct sprd_ptm_dev, pmu);
+	u64 config = event->attr.config;
+
+	if (event->attr.type != event->pmu->type)
+		return -ENOENT;
+
+	if (is_sampling_event(event) ||
+	    event->attach_state & PERF_ATTACH_TASK)
+		return -EOPNOTSUPP;
+
+	if (event->attr.exclude_user || event->attr.exclude_kernel ||
+	    event->attr.exclude_hv || event->attr.exclude_idle)
+		return -EINVAL;
+
+	if (event->cpu < 0 || PTM_PMU_CHN(config) >= sdev->pub_chn ||
+	    PTM_PMU_TYPE(config) >= BM_CHN_PARA || config >> 12)
+		return -EINVAL;
+
+	/* one set of counters for the whole system */
+	event->cpu = sdev->pmu_cpu;
+
+	return 0;
+}
+
+static void sprd_ptm_pmu_start(struct perf_event *event, int flags)
+{
+	struct sprd_ptm_dev *sdev = container_of(event->pmu,
+						 struct sprd_ptm_dev, pmu);
+	unsigned long irq_flags;
+
+	spin_lock_irqsave(&sdev->slock, irq_flags);
+	sprd_ptm_accumulate(sdev);
+	local64_set(&event->hw.prev_count, sprd_ptm_pmu_total(sdev, event));
+	spin_unlock_irqrestore(&sdev->slock, irq_flags);
+
+	event->hw.state = 0;
+}
+
+static void sprd_ptm_pmu_stop(struct perf_event *event, int flags)
+{
+	if (event->hw.state & PERF_HES_STOPPED)
+		return;
+
+	sprd_ptm_pmu_update(event);
+	event->hw.state |= PERF_HES_STOPPED | PERF_HES_UPTODATE;
+}
+
+static int sprd_ptm_pmu_add(struct perf_event *event, int flags)
+{
+	struct sprd_ptm_dev *sdev = container_of(event->pmu,
+						 struct sprd_ptm_dev, pmu);
+
+	event->hw.state = PERF_HES_STOPPED | PERF_HES_UPTODATE;
+	if (!sdev->pmu_events++)
+		hrtimer_start(&sdev->pmu_timer,
+			      ms_to_ktime(PTM_ACCUM_PERIOD_MS),
+			      HRTIMER_MODE_REL_PINNED);
+
+	if (flags & PERF_EF_START)
+		sprd_ptm_pmu_start(event, flags);
+
+	return 0;
+}
+
+static void sprd_ptm_pmu_del(struct perf_event *event, int flags)
+{
+	struct sprd_ptm_dev *sdev = container_of(event->pmu,
+						 struct sprd_ptm_dev, pmu);
+
+	sprd_ptm_pmu_stop(event, PERF_EF_UPDATE);
+	if (!--sdev->pmu_events)
+		hrtimer_cancel(&sdev->pmu_timer);
+}
+
+static ssize_t sprd_ptm_pmu_cpumask_show(struct device *dev,
+					 struct device_attribute *attr,
+					 char *buf)
+{
+	struct sprd_ptm_dev *sdev = ptm_bw_dev;
+
+	return cpumap_print_to_pagebuf(true, buf,
+				       cpumask_of(sdev ? sdev->pmu_cpu : 0));
+}
+
+static struct device_attribute ptm_pmu_cpumask_attr =
+	__ATTR(cpumask, 0444, sprd_ptm_pmu_cpumask_show, NULL);
+
+static struct attribute *ptm_pmu_cpumask_attrs[] = {
+	&ptm_pmu_cpumask_attr.attr,
+	NULL,
+};
+
+static struct attribute_group ptm_pmu_cpumask_group = {
+	.attrs = ptm_pmu_cpumask_attrs,
+};
+
+PMU_FORMAT_ATTR(chn, "config:0-7");
+PMU_FORMAT_ATTR(type, "config:8-11");
+
+static struct attribute *ptm_pmu_format_attrs[] = {
+	&format_attr_chn.attr,
+	&format_attr_type.attr,
+	NULL,
+};
+
+static struct attribute_group ptm_pmu_format_group = {
+	.name = "format",
+	.attrs = ptm_pmu_format_attrs,
+};
+
+PMU_EVENT_ATTR_STRING(rd_trans, ptm_pmu_rd_trans, "type=0");
+PMU_EVENT_ATTR_STRING(rd_bytes, ptm_pmu_rd_bytes, "type=1");
+PMU_EVENT_ATTR_STRING(rd_latency, ptm_pmu_rd_latency, "type=2");
+PMU_EVENT_ATTR_STRING(wr_trans, ptm_pmu_wr_trans, "type=3");
+PMU_EVENT_ATTR_STRING(wr_bytes, ptm_pmu_wr_bytes, "type=4");
+PMU_EVENT_ATTR_STRING(wr_latency, ptm_pmu_wr_latency, "type=5");
+
+static struct attribute *ptm_pmu_event_attrs[] = {
+	&ptm_pmu_rd_trans.attr.attr,
+	&ptm_pmu_rd_bytes.attr.attr,
+	&ptm_pmu_rd_latency.attr.attr,
+	&ptm_pmu_wr_trans.attr.attr,
+	&ptm_pmu_wr_bytes.attr.attr,
+	&ptm_pmu_wr_latency.attr.attr,
+	NULL,
+};
+
+static struct attribute_group ptm_pmu_event_group = {
+	.name = "events",
+	.attrs = ptm_pmu_event_attrs,
+};
+
+static const struct attribute_group *ptm_pmu_attr_groups[] = {
+	&ptm_pmu_cpumask_group,
+	&ptm_pmu_format_group,
+	&ptm_pmu_event_group,
+	NULL,
+};
+
+static int sprd_ptm_pmu_register(struct sprd_ptm_dev *sdev)
+{
+	hrtimer_init(&sdev->pmu_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	sdev->pmu_timer.function = sprd_ptm_pmu_timer;
+	sdev->pmu_cpu = 0;
+	sdev->pmu = (struct pmu) {
+		.task_ctx_nr	= perf_invalid_context,
+		.attr_groups	= ptm_pmu_attr_groups,
+		.event_init	= sprd_ptm_pmu_event_init,
+		.add		= sprd_ptm_pmu_add,
+		.del		= sprd_ptm_pmu_del,
+		.start		= sprd_ptm_pmu_start,
+		.stop		= sprd_ptm_pmu_stop,
+		.read		= sprd_ptm_pmu_update,
+	};
+
+	return perf_pmu_register(&sdev->pmu, PTM_NAME, -1);
+}
+
 static void sprd_ptm_init(struct device *dev)
 {
 	struct sprd_ptm_dev *sdev = dev_get_drvdata(dev);
@@ -598,6 +901,7 @@ static ssize_t mode_store(struct device *dev,
 
 	if (!strncmp(buf, "initial", 7)) {
 		sprd_ptm_init(dev);
+		sdev->bw_sampling = false;
 		sdev->mode = INIT_MODE;
 	} else if (!strncmp(buf, "legacy", 6)) {
 		sprd_ptm_legacy_init(dev);
@@ -1139,6 +1443,13 @@ static int sprd_ptm_probe(struct platform_device *pdev)
 	init_completion(&sdev->comp);
 	platform_set_drvdata(pdev, sdev);
 	sprd_ptm_init(&pdev->dev);
+	ptm_bw_dev = sdev;
+
+	/* bandwidth is still there through sysfs without perf */
+	if (sprd_ptm_pmu_register(sdev))
+		dev_warn(&pdev->dev, "Unable to register ptm pmu\n");
+	else
+		sdev->pmu_registered = true;
 
 	return 0;
 }
@@ -1147,6 +1458,9 @@ static int sprd_ptm_remove(struct platform_device *pdev)
 {
 	struct sprd_ptm_dev *sdev = dev_get_drvdata(&pdev->dev);
 
+	ptm_bw_dev = NULL;
+	if (sdev->pmu_registered)
+		perf_pmu_unregister(&sdev->pmu);
 	sprd_ptm_deinit(&pdev->dev);
 	sprd_ptm_trace_deinit(&pdev->dev);
 	sprd_ptm_legacy_deinit(&pdev->dev);
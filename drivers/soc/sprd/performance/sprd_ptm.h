@@ -91,6 +91,8 @@ struct bm_per_info {
 #define BM_LOG_FILE_SECONDS		(60  * 30)
 #define BM_LOG_FILE_MAX_RECORDS		(BM_LOG_FILE_SECONDS * 100)
 #define BM_TRACE_DEF_WINLEN		26000
+/* the 32 bit counters wrap within a second at full ddr bandwidth */
+#define PTM_ACCUM_PERIOD_MS		100
 
 enum ptm_trace_mode {
 	CYCLE_CNT_MOD,
@@ -157,6 +159,15 @@ struct sprd_ptm_dev {
 	struct sprd_ptm_chn_info	chn_info;
 	const struct ptm_pvt_para	*pvt_data;
 	const char			**sprd_ptm_list;
+	bool				bw_sampling;
+	/* initial mode counters, summed up by sprd_ptm_accumulate() */
+	u64				total[BM_CHN_MAX][BM_CHN_PARA];
+	u64				bw_last[BM_CHN_MAX][2];
+	struct pmu			pmu;
+	struct hrtimer			pmu_timer;
+	int				pmu_events;
+	int				pmu_cpu;
+	bool				pmu_registered;
 };
 
 struct ptm_pvt_para {
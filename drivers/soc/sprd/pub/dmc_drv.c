@@ -26,6 +26,11 @@
 #include <linux/platform_device.h>
 #include <linux/of_device.h>
 #include <linux/math64.h>
+#include <linux/hrtimer.h>
+#include <linux/perf_event.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
 
 #define PUB_MONITOR_CLK		128	/* 128MHz */
 #define PUB_DFS_MONITOR_CLK	65	/* 6.5MHz */
@@ -322,6 +327,497 @@ static int sprd_pub_monitor_enable(int enable)
 	return 0;
 }
 
+/*
+ * The monitor counters are 32 bits wide, or narrower for the event
+ * counts, and the 128MHz ones wrap in about 33s. They are folded into 64
+ * bit totals at least once a second while anybody (the enable file, the
+ * perf pmu or the sampler) keeps the monitor running. The hardware clears
+ * them whenever the monitor is restarted, so last[] is zeroed then.
+ */
+#define DMC_MON_ACCUM_PERIOD_MS	1000
+#define DMC_MON_SAMPLES		64
+
+enum {
+	DMC_MON_IDLE,
+	DMC_MON_WRITE,
+	DMC_MON_READ,
+	DMC_MON_SREF,
+	DMC_MON_LIGHT,
+	DMC_MON_LIGHT_CNT,
+	DMC_MON_SREF_CNT,
+	DMC_MON_F0,
+	DMC_MON_DFS_CNT = DMC_MON_F0 + 8,
+	DMC_MON_NR,
+};
+
+struct dmc_mon_counter {
+	u32 idx;	/* u32 index in struct pub_monitor_dbg */
+	u32 shift;
+	u32 mask;
+};
+
+static const struct dmc_mon_counter dmc_mon_counters[DMC_MON_NR] = {
+	[DMC_MON_IDLE]		= { 1, 0, 0xffffffff },
+	[DMC_MON_WRITE]		= { 2, 0, 0xffffffff },
+	[DMC_MON_READ]		= { 3, 0, 0xffffffff },
+	[DMC_MON_SREF]		= { 4, 0, 0xffffffff },
+	[DMC_MON_LIGHT]		= { 5, 0, 0xffffffff },
+	[DMC_MON_LIGHT_CNT]	= { 6, 0, 0xffff },
+	[DMC_MON_SREF_CNT]	= { 6, 16, 0xffff },
+	[DMC_MON_F0]		= { 7, 0, 0xffffffff },
+	[DMC_MON_F0 + 1]	= { 8, 0, 0xffffffff },
+	[DMC_MON_F0 + 2]	= { 9, 0, 0xffffffff },
+	[DMC_MON_F0 + 3]	= { 10, 0, 0xffffffff },
+	[DMC_MON_F0 + 4]	= { 11, 0, 0xffffffff },
+	[DMC_MON_F0 + 5]	= { 12, 0, 0xffffffff },
+	[DMC_MON_F0 + 6]	= { 13, 0, 0xffffffff },
+	[DMC_MON_F0 + 7]	= { 14, 0, 0xffffffff },
+	[DMC_MON_DFS_CNT]	= { 15, 0, 0x3ff },
+};
+
+struct dmc_mon_sample {
+	u64 ts_ms;
+	u64 delta[DMC_MON_NR];
+};
+
+struct dmc_mon {
+	spinlock_t lock;
+	int users;
+	u32 last[DMC_MON_NR];
+	u64 total[DMC_MON_NR];
+	struct hrtimer timer;
+
+	struct pmu pmu;
+	int pmu_events;
+	bool pmu_registered;
+
+	struct delayed_work sample_work;
+	u32 sample_ms;
+	u64 sample_last[DMC_MON_NR];
+	struct dmc_mon_sample samples[DMC_MON_SAMPLES];
+	u32 sample_head;
+	u32 sample_cnt;
+};
+
+static struct dmc_mon dmc_mon = {
+	.lock = __SPIN_LOCK_UNLOCKED(dmc_mon.lock),
+};
+
+static void dmc_mon_accumulate(void)
+{
+	u32 raw[DMC_MON_NR], val;
+	int i;
+
+	if (!dmc_mon.users)
+		return;
+
+	for (i = 0; i < DMC_MON_NR; i++) {
+		const struct dmc_mon_counter *c = &dmc_mon_counters[i];
+
+		raw[i] = readl_relaxed(drv_data.mon_base +
+				       PUB_STATUS_MON_CTRL_OFFSET + c->idx * 4);
+		raw[i] = (raw[i] >> c->shift) & c->mask;
+	}
+
+	for (i = 0; i < DMC_MON_NR; i++) {
+		val = (raw[i] - dmc_mon.last[i]) & dmc_mon_counters[i].mask;
+		dmc_mon.total[i] += val;
+		dmc_mon.last[i] = raw[i];
+	}
+}
+
+/* the hardware clears every counter when the enable bit goes 0 to 1 */
+static void dmc_mon_restart(void)
+{
+	dmc_mon_accumulate();
+	sprd_pub_monitor_enable(0);
+	sprd_pub_monitor_enable(1);
+	memset(dmc_mon.last, 0, sizeof(dmc_mon.last));
+}
+
+static enum hrtimer_restart dmc_mon_timer(struct hrtimer *timer)
+{
+	spin_lock(&dmc_mon.lock);
+	if (!dmc_mon.users) {
+		spin_unlock(&dmc_mon.lock);
+		return HRTIMER_NORESTART;
+	}
+	dmc_mon_accumulate();
+	spin_unlock(&dmc_mon.lock);
+
+	hrtimer_forward_now(timer, ms_to_ktime(DMC_MON_ACCUM_PERIOD_MS));
+	return HRTIMER_RESTART;
+}
+
+/* called with dmc_mon.lock held */
+static void dmc_mon_get(void)
+{
+	u32 reg;
+
+	if (dmc_mon.users++)
+		return;
+
+	reg = readl_relaxed(drv_data.mon_base + DMC_DDR_CLK_CTRL_OFFSET);
+	if (!(reg & 1 << PUB_CLK_DMC_REF_EB))
+		drv_data.reg_clk_ctrl |= 1 << PUB_CLK_DMC_REF_EB;
+	if (!(reg & 1 << PUB_CLK_DFS_EB))
+		drv_data.reg_clk_ctrl |= 1 << PUB_CLK_DFS_EB;
+	if (drv_data.reg_clk_ctrl)
+		writel_relaxed(reg | drv_data.reg_clk_ctrl,
+			       drv_data.mon_base + DMC_DDR_CLK_CTRL_OFFSET);
+
+	dmc_mon_restart();
+	hrtimer_start(&dmc_mon.timer, ms_to_ktime(DMC_MON_ACCUM_PERIOD_MS),
+		      HRTIMER_MODE_REL);
+}
+
+/* called with dmc_mon.lock held */
+static void dmc_mon_put(void)
+{
+	u32 reg;
+
+	if (--dmc_mon.users)
+		return;
+
+	hrtimer_try_to_cancel(&dmc_mon.timer);
+	sprd_pub_monitor_enable(0);
+	if (drv_data.reg_clk_ctrl) {
+		reg = readl_relaxed(drv_data.mon_base + DMC_DDR_CLK_CTRL_OFFSET);
+		writel_relaxed(reg & ~drv_data.reg_clk_ctrl,
+			       drv_data.mon_base + DMC_DDR_CLK_CTRL_OFFSET);
+		drv_data.reg_clk_ctrl = 0;
+	}
+}
+
+/*
+ * Uncore style perf pmu over the monitor counters, config bits 0-4 pick
+ * the counter, e.g. perf stat -a -e sprd_dmc/read_time/,sprd_dmc/sref_cnt/.
+ * The time counters count monitor clock ticks and carry a scale to ns.
+ * Counting only, there is no overflow interrupt to sample on.
+ */
+#define DMC_PMU_CNT(config)	((config) & 0x1f)
+
+static void dmc_pmu_update(struct perf_event *event)
+{
+	unsigned long flags;
+	u64 now;
+
+	spin_lock_irqsave(&dmc_mon.lock, flags);
+	dmc_mon_accumulate();
+	now = dmc_mon.total[DMC_PMU_CNT(event->attr.config)];
+	local64_add(now - local64_read(&event->hw.prev_count), &event->count);
+	local64_set(&event->hw.prev_count, now);
+	spin_unlock_irqrestore(&dmc_mon.lock, flags);
+}
+
+static int dmc_pmu_event_init(struct perf_event *event)
+{
+	u64 config = event->attr.config;
+
+	if (event->attr.type != event->pmu->type)
+		return -ENOENT;
+
+	if (is_sampling_event(event) ||
+	    event->attach_state & PERF_ATTACH_TASK)
+		return -EOPNOTSUPP;
+
+	if (event->attr.exclude_user || event->attr.exclude_kernel ||
+	    event->attr.exclude_hv || event->attr.exclude_idle)
+		return -EINVAL;
+
+	if (event->cpu < 0 || DMC_PMU_CNT(config) >= DMC_MON_NR ||
+	    config >> 5)
+		return -EINVAL;
+
+	/* one set of counters for the whole system */
+	event->cpu = 0;
+
+	return 0;
+}
+
+static void dmc_pmu_start(struct perf_event *event, int flags)
+{
+	unsigned long irq_flags;
+
+	spin_lock_irqsave(&dmc_mon.lock, irq_flags);
+	dmc_mon_accumulate();
+	local64_set(&event->hw.prev_count,
+		    dmc_mon.total[DMC_PMU_CNT(event->attr.config)]);
+	spin_unlock_irqrestore(&dmc_mon.lock, irq_flags);
+
+	event->hw.state = 0;
+}
+
+static void dmc_pmu_stop(struct perf_event *event, int flags)
+{
+	if (event->hw.state & PERF_HES_STOPPED)
+		return;
+
+	dmc_pmu_update(event);
+	event->hw.state |= PERF_HES_STOPPED | PERF_HES_UPTODATE;
+}
+
+static int dmc_pmu_add(struct perf_event *event, int flags)
+{
+	unsigned long irq_flags;
+
+	event->hw.state = PERF_HES_STOPPED | PERF_HES_UPTODATE;
+	spin_lock_irqsave(&dmc_mon.lock, irq_flags);
+	if (!dmc_mon.pmu_events++)
+		dmc_mon_get();
+	spin_unlock_irqrestore(&dmc_mon.lock, irq_flags);
+
+	if (flags & PERF_EF_START)
+		dmc_pmu_start(event, flags);
+
+	return 0;
+}
+
+static void dmc_pmu_del(struct perf_event *event, int flags)
+{
+	unsigned long irq_flags;
+
+	dmc_pmu_stop(event, PERF_EF_UPDATE);
+	spin_lock_irqsave(&dmc_mon.lock, irq_flags);
+	if (!--dmc_mon.pmu_events)
+		dmc_mon_put();
+	spin_unlock_irqrestore(&dmc_mon.lock, irq_flags);
+}
+
+static ssize_t dmc_pmu_cpumask_show(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	return cpumap_print_to_pagebuf(true, buf, cpumask_of(0));
+}
+
+static struct device_attribute dmc_pmu_cpumask_attr =
+	__ATTR(cpumask, 0444, dmc_pmu_cpumask_show, NULL);
+
+static struct attribute *dmc_pmu_cpumask_attrs[] = {
+	&dmc_pmu_cpumask_attr.attr,
+	NULL,
+};
+
+static struct attribute_group dmc_pmu_cpumask_group = {
+	.attrs = dmc_pmu_cpumask_attrs,
+};
+
+PMU_FORMAT_ATTR(cnt, "config:0-4");
+
+static struct attribute *dmc_pmu_format_attrs[] = {
+	&format_attr_cnt.attr,
+	NULL,
+};
+
+static struct attribute_group dmc_pmu_format_group = {
+	.name = "format",
+	.attrs = dmc_pmu_format_attrs,
+};
+
+#define DMC_PMU_EVENT(_name, _str)					\
+	PMU_EVENT_ATTR_STRING(_name, dmc_pmu_##_name, _str)
+/* 1000 / PUB_MONITOR_CLK and 10000 / PUB_DFS_MONITOR_CLK ns per tick */
+#define DMC_PMU_TIME(_name, _str, _scale)				\
+	DMC_PMU_EVENT(_name, _str);					\
+	PMU_EVENT_ATTR_STRING(_name.scale, dmc_pmu_##_name##_scale, _scale); \
+	PMU_EVENT_ATTR_STRING(_name.unit, dmc_pmu_##_name##_unit, "ns")
+#define DMC_PMU_ATTRS(_name)						\
+	&dmc_pmu_##_name.attr.attr,					\
+	&dmc_pmu_##_name##_scale.attr.attr,				\
+	&dmc_pmu_##_name##_unit.attr.attr
+
+DMC_PMU_TIME(idle_time, "cnt=0", "7.8125");
+DMC_PMU_TIME(write_time, "cnt=1", "7.8125");
+DMC_PMU_TIME(read_time, "cnt=2", "7.8125");
+DMC_PMU_TIME(sref_time, "cnt=3", "7.8125");
+DMC_PMU_TIME(light_time, "cnt=4", "153.846153846");
+DMC_PMU_EVENT(light_cnt, "cnt=5");
+DMC_PMU_EVENT(sref_cnt, "cnt=6");
+DMC_PMU_TIME(f0_time, "cnt=7", "153.846153846");
+DMC_PMU_TIME(f1_time, "cnt=8", "153.846153846");
+DMC_PMU_TIME(f2_time, "cnt=9", "153.846153846");
+DMC_PMU_TIME(f3_time, "cnt=10", "153.846153846");
+DMC_PMU_TIME(f4_time, "cnt=11", "153.846153846");
+DMC_PMU_TIME(f5_time, "cnt=12", "153.846153846");
+DMC_PMU_TIME(f6_time, "cnt=13", "153.846153846");
+DMC_PMU_TIME(f7_time, "cnt=14", "153.846153846");
+DMC_PMU_EVENT(dfs_cnt, "cnt=15");
+
+static struct attribute *dmc_pmu_event_attrs[] = {
+	DMC_PMU_ATTRS(idle_time),
+	DMC_PMU_ATTRS(write_time),
+	DMC_PMU_ATTRS(read_time),
+	DMC_PMU_ATTRS(sref_time),
+	DMC_PMU_ATTRS(light_time),
+	&dmc_pmu_light_cnt.attr.attr,
+	&dmc_pmu_sref_cnt.attr.attr,
+	DMC_PMU_ATTRS(f0_time),
+	DMC_PMU_ATTRS(f1_time),
+	DMC_PMU_ATTRS(f2_time),
+	DMC_PMU_ATTRS(f3_time),
+	DMC_PMU_ATTRS(f4_time),
+	DMC_PMU_ATTRS(f5_time),
+	DMC_PMU_ATTRS(f6_time),
+	DMC_PMU_ATTRS(f7_time),
+	&dmc_pmu_dfs_cnt.attr.attr,
+	NULL,
+};
+
+static struct attribute_group dmc_pmu_event_group = {
+	.name = "events",
+	.attrs = dmc_pmu_event_attrs,
+};
+
+static const struct attribute_group *dmc_pmu_attr_groups[] = {
+	&dmc_pmu_cpumask_group,
+	&dmc_pmu_format_group,
+	&dmc_pmu_event_group,
+	NULL,
+};
+
+static int dmc_pmu_register(void)
+{
+	dmc_mon.pmu = (struct pmu) {
+		.task_ctx_nr	= perf_invalid_context,
+		.attr_groups	= dmc_pmu_attr_groups,
+		.event_init	= dmc_pmu_event_init,
+		.add		= dmc_pmu_add,
+		.del		= dmc_pmu_del,
+		.start		= dmc_pmu_start,
+		.stop		= dmc_pmu_stop,
+		.read		= dmc_pmu_update,
+	};
+
+	return perf_pmu_register(&dmc_mon.pmu, DMC_PROC_NAME, -1);
+}
+
+static u64 dmc_mon_ticks_to_ns(int cnt, u64 ticks)
+{
+	if (cnt <= DMC_MON_SREF)
+		return div64_u64(ticks * 1000ULL, PUB_MONITOR_CLK);
+
+	return div64_u64(ticks * 10000ULL, PUB_DFS_MONITOR_CLK);
+}
+
+static void dmc_mon_sample_work(struct work_struct *work)
+{
+	struct dmc_mon_sample *s;
+	u32 period;
+	int i;
+
+	spin_lock_irq(&dmc_mon.lock);
+	period = dmc_mon.sample_ms;
+	if (!period) {
+		spin_unlock_irq(&dmc_mon.lock);
+		return;
+	}
+
+	dmc_mon_accumulate();
+	s = &dmc_mon.samples[dmc_mon.sample_head];
+	s->ts_ms = ktime_to_ms(ktime_get_boottime());
+	for (i = 0; i < DMC_MON_NR; i++) {
+		s->delta[i] = dmc_mon.total[i] - dmc_mon.sample_last[i];
+		dmc_mon.sample_last[i] = dmc_mon.total[i];
+	}
+	dmc_mon.sample_head = (dmc_mon.sample_head + 1) % DMC_MON_SAMPLES;
+	if (dmc_mon.sample_cnt < DMC_MON_SAMPLES)
+		dmc_mon.sample_cnt++;
+	spin_unlock_irq(&dmc_mon.lock);
+
+	schedule_delayed_work(&dmc_mon.sample_work, msecs_to_jiffies(period));
+}
+
+static int dmc_mon_sample_ms_get(void *data, u64 *val)
+{
+	*val = dmc_mon.sample_ms;
+	return 0;
+}
+
+/* 0 stops the sampler, anything else (re)starts it with that period */
+static int dmc_mon_sample_ms_set(void *data, u64 val)
+{
+	if (val > 60000)
+		return -EINVAL;
+
+	cancel_delayed_work_sync(&dmc_mon.sample_work);
+
+	spin_lock_irq(&dmc_mon.lock);
+	if (val && !dmc_mon.sample_ms)
+		dmc_mon_get();
+	else if (!val && dmc_mon.sample_ms)
+		dmc_mon_put();
+	dmc_mon.sample_ms = val;
+	dmc_mon.sample_head = 0;
+	dmc_mon.sample_cnt = 0;
+	dmc_mon_accumulate();
+	memcpy(dmc_mon.sample_last, dmc_mon.total, sizeof(dmc_mon.total));
+	spin_unlock_irq(&dmc_mon.lock);
+
+	if (val)
+		schedule_delayed_work(&dmc_mon.sample_work,
+				      msecs_to_jiffies(val));
+
+	return 0;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(dmc_mon_sample_ms_fops, dmc_mon_sample_ms_get,
+			dmc_mon_sample_ms_set, "%llu\n");
+
+/*
+ * One line per period: the ns spent idle, writing, reading, in self
+ * refresh and in light sleep, the share of busy time in permille, the
+ * sleep entries and frequency switches.
+ */
+static int dmc_mon_samples_show(struct seq_file *m, void *v)
+{
+	struct dmc_mon_sample *buf, *s;
+	u64 ns[DMC_MON_LIGHT + 1], sum;
+	u32 head, cnt, i;
+	int j;
+
+	buf = kmalloc(sizeof(dmc_mon.samples), GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	spin_lock_irq(&dmc_mon.lock);
+	memcpy(buf, dmc_mon.samples, sizeof(dmc_mon.samples));
+	head = dmc_mon.sample_head;
+	cnt = dmc_mon.sample_cnt;
+	spin_unlock_irq(&dmc_mon.lock);
+
+	seq_puts(m, "ts_ms idle_ns write_ns read_ns sref_ns light_ns busy_pm light_cnt sref_cnt dfs_cnt\n");
+	for (i = 0; i < cnt; i++) {
+		s = &buf[(head + DMC_MON_SAMPLES - cnt + i) % DMC_MON_SAMPLES];
+		for (j = 0, sum = 0; j <= DMC_MON_LIGHT; j++) {
+			ns[j] = dmc_mon_ticks_to_ns(j, s->delta[j]);
+			sum += ns[j];
+		}
+		seq_printf(m, "%llu %llu %llu %llu %llu %llu %llu %llu %llu %llu\n",
+			   s->ts_ms, ns[DMC_MON_IDLE], ns[DMC_MON_WRITE],
+			   ns[DMC_MON_READ], ns[DMC_MON_SREF], ns[DMC_MON_LIGHT],
+			   sum ? div64_u64((ns[DMC_MON_WRITE] +
+					    ns[DMC_MON_READ]) * 1000, sum) : 0,
+			   s->delta[DMC_MON_LIGHT_CNT],
+			   s->delta[DMC_MON_SREF_CNT],
+			   s->delta[DMC_MON_DFS_CNT]);
+	}
+
+	kfree(buf);
+	return 0;
+}
+
+static int dmc_mon_samples_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dmc_mon_samples_show, NULL);
+}
+
+static const struct file_operations dmc_mon_samples_fops = {
+	.open = dmc_mon_samples_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static int sprd_pub_monitor_status_show(struct seq_file *m, void *v)
 {
 	int i;
@@ -335,9 +831,15 @@ static int sprd_pub_monitor_status_show(struct seq_file *m, void *v)
 	if (!drv_data.pub_mon_enabled)
 		return -ENODATA;
 
+	/* reading restarts the counters, keep the totals of the others */
+	spin_lock_irq(&dmc_mon.lock);
+	dmc_mon_accumulate();
 	sprd_pub_monitor_enable(0);
-	if (sprd_pub_monitor_reg_get())
-		return -ENODATA;
+	sprd_pub_monitor_reg_get();
+	sprd_pub_monitor_enable(1);
+	memset(dmc_mon.last, 0, sizeof(dmc_mon.last));
+	spin_unlock_irq(&dmc_mon.lock);
+
 	idle_time = div64_u64((u64)drv_data.reg_val.idle_time * 1000ULL,
 			      PUB_MONITOR_CLK);
 	write_time = div64_u64((u64)drv_data.reg_val.write_time * 1000ULL,
@@ -370,7 +872,6 @@ static int sprd_pub_monitor_status_show(struct seq_file *m, void *v)
 		seq_printf(m, "F%d time: %llu ns\n", i, fx_time[i]);
 	seq_printf(m, "dfs_cnt: %d\n", (drv_data.reg_val.dfs_cnt & 0x3ff));
 	seq_printf(m, "total_time:%lldns, sts_time:%lldns\n", total_tm, sts_tm);
-	sprd_pub_monitor_enable(1);
 	return 0;
 }
 
@@ -405,50 +906,31 @@ static ssize_t sprd_pub_monitor_enable_write(struct file *filep,
 					     size_t len, loff_t *ppos)
 {
 	char buf_tmp[8];
-	u32 reg = 0;
-	int ret;
 
 	if (len < 1)
 		return -EINVAL;
+	if (!drv_data.mon_base)
+		return -ENOMEM;
 	if (copy_from_user(buf_tmp, buf, 1))
 		return -EFAULT;
 
+	spin_lock_irq(&dmc_mon.lock);
 	if (buf_tmp[0] == '1' || buf_tmp[0] == 1) {
-		reg = readl_relaxed(drv_data.mon_base
-			+ DMC_DDR_CLK_CTRL_OFFSET);
-		if (!(reg & 1<<PUB_CLK_DMC_REF_EB)
-		    || !(reg & 1<<PUB_CLK_DFS_EB)) {
-			if (!(reg & 1<<PUB_CLK_DMC_REF_EB))
-				drv_data.reg_clk_ctrl |= 1<<PUB_CLK_DMC_REF_EB;
-			if (!(reg & 1<<PUB_CLK_DFS_EB))
-				drv_data.reg_clk_ctrl |= 1<<PUB_CLK_DFS_EB;
-			reg = reg | drv_data.reg_clk_ctrl;
-			writel_relaxed(reg, drv_data.mon_base
-				+ DMC_DDR_CLK_CTRL_OFFSET);
-		}
+		/* enabling again still restarts the counters */
+		if (drv_data.pub_mon_enabled)
+			dmc_mon_restart();
+		else
+			dmc_mon_get();
 		drv_data.pub_mon_enabled = 1;
-		ret = sprd_pub_monitor_enable(0);
-		if (ret)
-			return ret;
-		ret = sprd_pub_monitor_enable(1);
-		if (ret)
-			return ret;
 	} else if (buf_tmp[0] == '0' || buf_tmp[0] == 0) {
-		if (drv_data.reg_clk_ctrl) {
-			reg = readl_relaxed(drv_data.mon_base
-					+ DMC_DDR_CLK_CTRL_OFFSET);
-			reg = reg & ~(drv_data.reg_clk_ctrl);
-			writel_relaxed(reg, drv_data.mon_base
-					+ DMC_DDR_CLK_CTRL_OFFSET);
-			drv_data.reg_clk_ctrl = 0;
-		}
+		if (drv_data.pub_mon_enabled)
+			dmc_mon_put();
 		drv_data.pub_mon_enabled = 0;
-		ret = sprd_pub_monitor_enable(0);
-		if (ret)
-			return ret;
 	} else {
+		spin_unlock_irq(&dmc_mon.lock);
 		return -EINVAL;
 	}
+	spin_unlock_irq(&dmc_mon.lock);
 	return len;
 }
 
@@ -462,6 +944,15 @@ static const struct file_operations pub_monitor_enable_fops = {
 
 static int sprd_pub_monitor_init(void)
 {
+	hrtimer_init(&dmc_mon.timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	dmc_mon.timer.function = dmc_mon_timer;
+	INIT_DELAYED_WORK(&dmc_mon.sample_work, dmc_mon_sample_work);
+
+	if (dmc_pmu_register())
+		pr_warn("Unable to register dmc pmu\n");
+	else
+		dmc_mon.pmu_registered = true;
+
 	drv_data.monitor_dir = debugfs_create_dir("sprd_pub_monitor", NULL);
 	if (!drv_data.monitor_dir) {
 		pr_err("pub_monitor creat dir error\n");
@@ -471,6 +962,10 @@ static int sprd_pub_monitor_init(void)
 			    &pub_monitor_enable_fops);
 	debugfs_create_file("status", 0444, drv_data.monitor_dir, NULL,
 			    &pub_monitor_status_fops);
+	debugfs_create_file("sample_ms", 0664, drv_data.monitor_dir, NULL,
+			    &dmc_mon_sample_ms_fops);
+	debugfs_create_file("samples", 0444, drv_data.monitor_dir, NULL,
+			    &dmc_mon_samples_fops);
 
 	return 0;
 }
@@ -522,7 +1017,13 @@ static int sprd_dmc_probe(struct platform_device *pdev)
 
 static int sprd_dmc_remove(struct platform_device *pdev)
 {
+	if (dmc_mon.pmu_registered)
+		perf_pmu_unregister(&dmc_mon.pmu);
 	debugfs_remove_recursive(drv_data.monitor_dir);
+	if (drv_data.mon_base) {
+		dmc_mon_sample_ms_set(NULL, 0);
+		hrtimer_cancel(&dmc_mon.timer);
+	}
 	if (drv_data.property != NULL)
 		remove_proc_entry(DDR_PROPERTY_NAME, drv_data.proc_dir);
 	if (drv_data.info != NULL)
@@ -10,7 +10,11 @@
 #include <linux/vmalloc.h>
 #include <linux/genhd.h>
 #include <linux/blkdev.h>
+#include <linux/dax.h>
 #include <linux/hdreg.h>
+#include <linux/highmem.h>
+#include <linux/pfn_t.h>
+#include <linux/uio.h>
 
 MODULE_LICENSE("Dual BSD/GPL");
 
@@ -30,6 +34,7 @@ struct memdisk_partition_info {
 	unsigned long start;
 	unsigned long size;	/* Device size in sectors */
 	u8 *data;		/* The data array */
+	phys_addr_t phys;	/* Where data lives, for dax */
 	const char *partition_name;
 };
 /*
@@ -37,69 +42,199 @@ struct memdisk_partition_info {
  */
 struct memdisk_dev {
 	unsigned long size;	/* Device size in sectors */
-	spinlock_t lock;	/* For mutual exclusion */
 	struct request_queue *queue;	/* The device request queue */
 	struct gendisk *gd;	/* The gendisk structure */
+	struct dax_device *dax_dev;
 	struct memdisk_partition_info *memdiskp[];
 };
 static int memdisks_count = 0;
 static struct memdisk_dev *memdisks = NULL;
 
 /*
- * Handle an I/O request.
+ * Find the partition holding byte pos of the disk, and how far into it
+ * pos is.
  */
-static void memdisk_transfer(struct memdisk_dev *dev, sector_t sector,
-			     unsigned long nsect, char *buffer, int write)
+static struct memdisk_partition_info *memdisk_find(struct memdisk_dev *dev,
+						   u64 pos, u64 *offset)
 {
+	struct memdisk_partition_info *memdiskp;
+	u64 start;
 	int i;
-	struct memdisk_partition_info *memdiskp = NULL;
-	unsigned long offset = sector * hardsect_size;
-	unsigned long nbytes = nsect * hardsect_size;
 
-	if ((offset + nbytes) > (dev->size * hardsect_size)) {
-		pr_notice("memdisk: Beyond-end write (%ld %ld)\n",
-			  offset, nbytes);
-		return;
+	for (i = 0; i < memdisks_count; i++) {
+		memdiskp = dev->memdiskp[i];
+		start = (u64)memdiskp->start * hardsect_size;
+		if (pos >= start &&
+		    pos < start + (u64)memdiskp->size * hardsect_size) {
+			*offset = pos - start;
+			return memdiskp;
+		}
 	}
 
-	for (i = 0; i < memdisks_count; i++)
-		if (sector >= memdisks->memdiskp[i]->start &&
-			sector < memdisks->memdiskp[i]->start + memdisks->memdiskp[i]->size) {
-			offset = (sector - memdisks->memdiskp[i]->start) * hardsect_size;
-			nbytes = nsect * hardsect_size;
-			memdiskp = dev->memdiskp[i];
-			break;
+	return NULL;
+}
+
+/*
+ * Copy len bytes at sector, which may cross from one partition into the
+ * next one.
+ */
+static int memdisk_transfer(struct memdisk_dev *dev, sector_t sector,
+			    unsigned int len, char *buffer, bool write)
+{
+	struct memdisk_partition_info *memdiskp;
+	u64 pos = (u64)sector << 9;
+	u64 offset, n;
+
+	while (len) {
+		memdiskp = memdisk_find(dev, pos, &offset);
+		if (!memdiskp) {
+			pr_notice("memdisk: Beyond-end access (%llu %u)\n",
+				  pos, len);
+			return -EIO;
 		}
 
-	if (i == memdisks_count)
-		return;
+		n = min_t(u64, len,
+			  (u64)memdiskp->size * hardsect_size - offset);
+		if (write)
+			memcpy(memdiskp->data + offset, buffer, n);
+		else
+			memcpy(buffer, memdiskp->data + offset, n);
 
-	if (write)
-		memcpy(memdiskp->data + offset, buffer, nbytes);
-	else
-		memcpy(buffer, memdiskp->data + offset, nbytes);
+		pos += n;
+		buffer += n;
+		len -= n;
+	}
+
+	return 0;
 }
 
-static void memdisk_request(struct request_queue *q)
+static int memdisk_do_bvec(struct memdisk_dev *dev, struct page *page,
+			   unsigned int len, unsigned int off, bool write,
+			   sector_t sector)
+{
+	void *mem = kmap_atomic(page);
+	int ret;
+
+	ret = memdisk_transfer(dev, sector, len, mem + off, write);
+	if (!write)
+		flush_dcache_page(page);
+	kunmap_atomic(mem);
+
+	return ret;
+}
+
+/*
+ * Bios are served straight from the submitting context, there is no
+ * queue or lock in between, so every cpu submits on its own.
+ */
+static blk_qc_t memdisk_make_request(struct request_queue *q, struct bio *bio)
 {
-	struct request *req;
 	struct memdisk_dev *dev = q->queuedata;
+	bool write = op_is_write(bio_op(bio));
+	struct bio_vec bvec;
+	struct bvec_iter iter;
 
-	req = blk_fetch_request(q);
-	while (req != NULL) {
-		if (blk_rq_is_passthrough(req)) {
-			pr_notice("Skip non-CMD request/n");
-			__blk_end_request_all(req, -EIO);
-			continue;
-		}
-		memdisk_transfer(dev, blk_rq_pos(req), blk_rq_cur_sectors(req),
-				 bio_data(req->bio), rq_data_dir(req));
-		if (!__blk_end_request_cur(req, 0)) {
-			req = blk_fetch_request(q);
-		}
+	if (bio_end_sector(bio) > get_capacity(bio->bi_disk))
+		goto io_error;
+
+	bio_for_each_segment(bvec, bio, iter) {
+		if (memdisk_do_bvec(dev, bvec.bv_page, bvec.bv_len,
+				    bvec.bv_offset, write, iter.bi_sector))
+			goto io_error;
 	}
+
+	bio_endio(bio);
+	return BLK_QC_T_NONE;
+
+io_error:
+	bio_io_error(bio);
+	return BLK_QC_T_NONE;
+}
+
+static int memdisk_rw_page(struct block_device *bdev, sector_t sector,
+			   struct page *page, bool is_write)
+{
+	struct memdisk_dev *dev = bdev->bd_disk->private_data;
+	int ret;
+
+	if (PageTransHuge(page))
+		return -ENOTSUPP;
+
+	ret = memdisk_do_bvec(dev, page, PAGE_SIZE, 0, is_write, sector);
+	/* the core retries on error, so complete the page only on success */
+	if (!ret)
+		page_endio(page, is_write, 0);
+
+	return ret;
 }
 
+#ifdef CONFIG_SPRD_MEMDISK_DAX
+/*
+ * The partitions are separate memory regions, so a dax access can only
+ * run to the end of the partition holding pgoff.
+ */
+static long memdisk_dax_direct_access(struct dax_device *dax_dev,
+				      pgoff_t pgoff, long nr_pages,
+				      void **kaddr, pfn_t *pfn)
+{
+	struct memdisk_dev *dev = dax_get_private(dax_dev);
+	struct memdisk_partition_info *memdiskp;
+	u64 offset, start;
+
+	memdiskp = memdisk_find(dev, PFN_PHYS(pgoff), &offset);
+	if (!memdiskp)
+		return -ERANGE;
+
+	start = (u64)memdiskp->start * hardsect_size;
+	if (!PAGE_ALIGNED(start) || !PAGE_ALIGNED(memdiskp->phys))
+		return -EOPNOTSUPP;
+
+	*kaddr = memdiskp->data + offset;
+	*pfn = phys_to_pfn_t(memdiskp->phys + offset, PFN_DEV);
+
+	return PHYS_PFN((u64)memdiskp->size * hardsect_size - offset);
+}
+
+static size_t memdisk_dax_copy_from_iter(struct dax_device *dax_dev,
+					 pgoff_t pgoff, void *addr,
+					 size_t bytes, struct iov_iter *i)
+{
+	return copy_from_iter(addr, bytes, i);
+}
+
+static const struct dax_operations memdisk_dax_ops = {
+	.direct_access = memdisk_dax_direct_access,
+	.copy_from_iter = memdisk_dax_copy_from_iter,
+};
+
+static int memdisk_setup_dax(struct memdisk_dev *dev)
+{
+	dev->dax_dev = alloc_dax(dev, dev->gd->disk_name, &memdisk_dax_ops);
+	if (!dev->dax_dev)
+		return -ENOMEM;
+
+	queue_flag_set_unlocked(QUEUE_FLAG_DAX, dev->queue);
+
+	return 0;
+}
+
+static void memdisk_release_dax(struct memdisk_dev *dev)
+{
+	if (!dev->dax_dev)
+		return;
+
+	kill_dax(dev->dax_dev);
+	put_dax(dev->dax_dev);
+}
+#else
+static inline int memdisk_setup_dax(struct memdisk_dev *dev)
+{
+	return 0;
+}
+
+static inline void memdisk_release_dax(struct memdisk_dev *dev) { }
+#endif
+
 /*
  * The HDIO_GETGEO ioctl is handled in blkdev_ioctl(), i
  * calls this. We need to implement getgeo, since we can't
@@ -125,6 +260,7 @@ int memdisk_getgeo(struct block_device *bd, struct hd_geometry *geo)
  */
 static struct block_device_operations memdisk_ops = {
 	.owner = THIS_MODULE,
+	.rw_page = memdisk_rw_page,
 	.getgeo = memdisk_getgeo
 };
 
@@ -139,16 +275,18 @@ static void memdisk_setup_device(void)
 	struct hd_struct *part;
 	sector_t start = 0;
 
-
-	spin_lock_init(&memdisks->lock);
-
-	memdisks->queue = blk_init_queue(memdisk_request, &memdisks->lock);
+	memdisks->queue = blk_alloc_queue(GFP_KERNEL);
 	if (memdisks->queue == NULL) {
-		pr_notice("memdisk_setup_device blk_init_queue failure. \n");
+		pr_notice("memdisk_setup_device blk_alloc_queue failure. \n");
 		return;
 	}
 
+	blk_queue_make_request(memdisks->queue, memdisk_make_request);
 	blk_queue_logical_block_size(memdisks->queue, hardsect_size);
+	blk_queue_physical_block_size(memdisks->queue, PAGE_SIZE);
+	blk_queue_max_hw_sectors(memdisks->queue, UINT_MAX);
+	queue_flag_set_unlocked(QUEUE_FLAG_NONROT, memdisks->queue);
+	queue_flag_clear_unlocked(QUEUE_FLAG_ADD_RANDOM, memdisks->queue);
 	memdisks->queue->queuedata = memdisks;
 	/*
 	 * And the gendisk structure.
@@ -170,6 +308,8 @@ static void memdisk_setup_device(void)
 
 	set_capacity(memdisks->gd,
 		     (sector_t)(memdisks->size * (hardsect_size / KERNEL_SECTOR_SIZE)));
+	if (memdisk_setup_dax(memdisks))
+		pr_notice("memdisk_setup_device no dax. \n");
 	add_disk(memdisks->gd);
 
 	for (i = 0; i < memdisks_count; i++) {
@@ -189,6 +329,10 @@ static void memdisk_setup_device(void)
 	return;
 }
 
+/*
+ * memtype 2 maps the memory cacheable, so that the kernel alias agrees
+ * with the mappings dax hands out to userland.
+ */
 static void *memdisk_ram_vmap(phys_addr_t start, size_t size,
 				 unsigned int memtype)
 {
@@ -202,7 +346,9 @@ static void *memdisk_ram_vmap(phys_addr_t start, size_t size,
 	page_start = start - offset_in_page(start);
 	page_count = DIV_ROUND_UP(size + offset_in_page(start), PAGE_SIZE);
 
-	if (memtype)
+	if (memtype == 2)
+		prot = PAGE_KERNEL;
+	else if (memtype)
 		prot = pgprot_noncached(PAGE_KERNEL);
 	else
 		prot = pgprot_writecombine(PAGE_KERNEL);
@@ -292,13 +438,15 @@ static int memdisk_init(void)
 			  res.start, res.end);
 #endif
 		memdiskp->data =
-		    memdisk_ram_vmap(res.start, resource_size(&res), 0);
+		    memdisk_ram_vmap(res.start, resource_size(&res),
+				     IS_ENABLED(CONFIG_SPRD_MEMDISK_DAX) ? 2 : 0);
 		if (!memdiskp->data) {
 			pr_notice("sprd memdisk%d map error!\n", i);
 			ret = -ENOMEM;
 			goto err_2;
 		}
 
+		memdiskp->phys = res.start;
 		memdiskp->partition_name = name;
 		memdiskp->size = resource_size(&res) / hardsect_size;
 		memdiskp->start = (i == 0 ? 0 : memdisks->memdiskp[i-1]->start + memdisks->memdiskp[i-1]->size);
@@ -343,6 +491,7 @@ static void memdisk_exit(void)
 			vm_unmap_ram(memdisks->memdiskp[i]->data,
 				memdisks->memdiskp[i]->size * hardsect_size);
 
+	memdisk_release_dax(memdisks);
 	if (memdisks->gd) {
 		del_gendisk(memdisks->gd);
 		put_disk(memdisks->gd);
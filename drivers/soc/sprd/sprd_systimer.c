@@ -3,6 +3,9 @@
 #include <linux/init.h>
 #include <linux/io.h>
 #include <linux/kernel.h>
+#include <linux/math64.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
 #include <linux/of.h>
 #include <linux/of_address.h>
 #include <linux/seqlock.h>
@@ -20,7 +23,24 @@
 #define SYSFRT_CNT_EXT		0x8
 #define SYSFRT_CNT_SHDW_EXT	0xc
 
-#define DEFAULT_TIMEVALE_MS (1000 * 60 * 10) //10min
+#define DEFAULT_TIMEVALE_MS (1000 * 60) //1min
+
+/*
+ * The counters run from their own crystals, not from the clock the
+ * boottime runs on. The rate between them is fitted over the last
+ * CNT_FIT_POINTS anchors, a few tens of ppm otherwise add up to
+ * milliseconds between two anchors.
+ */
+#define CNT_FIT_POINTS		16
+#define CNT_FIT_MAX_PPM		1000
+
+struct cnter_fit {
+	u64 cnt[CNT_FIT_POINTS];	/* counter, unwrapped */
+	u64 ns[CNT_FIT_POINTS];		/* boottime */
+	u32 nr;
+	u32 idx;
+	u32 mult_nominal;
+};
 
 static struct cnter_to_boottime {
 	u64 last_boottime;
@@ -30,6 +50,9 @@ static struct cnter_to_boottime {
 	u32 systimer_shift;
 	u32 sysfrt_mult;
 	u32 sysfrt_shift;
+	u64 systimer_unwrapped;
+	struct cnter_fit systimer_fit;
+	struct cnter_fit sysfrt_fit;
 } cnter_to_boottime;
 
 static void __iomem *sprd_systimer_addr_base;
@@ -39,6 +62,11 @@ static struct hrtimer cnt_to_boot_timer;
 
 static seqcount_t systimer_seq;
 
+/* the anchor as userland sees it, and the counter pages it may map */
+static struct sprd_systimer_data *systimer_data;
+static phys_addr_t systimer_phys;
+static phys_addr_t sysfrt_phys;
+
 u64 sprd_systimer_to_boottime(u64 counter, int src)
 {
 	unsigned long seq;
@@ -97,16 +125,174 @@ u64 sprd_sysfrt_read(void)
 }
 EXPORT_SYMBOL(sprd_sysfrt_read);
 
+/*
+ * Least squares fit of boottime against the counter. The nominal rate is
+ * taken out first, so the sums only carry the ppm sized residuals and stay
+ * well inside 64 bits for the window the anchors span.
+ */
+static u32 cnter_fit_mult(struct cnter_fit *fit, u64 cnt, u64 ns, u32 shift)
+{
+	s64 dx[CNT_FIT_POINTS], dr[CNT_FIT_POINTS];
+	s64 mx = 0, mr = 0, sxx = 0, sxr = 0, adj, max;
+	u32 i, ref;
+
+	fit->cnt[fit->idx] = cnt;
+	fit->ns[fit->idx] = ns;
+	fit->idx = (fit->idx + 1) % CNT_FIT_POINTS;
+	if (fit->nr < CNT_FIT_POINTS)
+		fit->nr++;
+	if (fit->nr < 2)
+		return fit->mult_nominal;
+
+	/* relative to the oldest anchor, so dx never goes negative */
+	ref = fit->nr < CNT_FIT_POINTS ? 0 : fit->idx;
+	for (i = 0; i < fit->nr; i++) {
+		dx[i] = fit->cnt[i] - fit->cnt[ref];
+		dr[i] = (fit->ns[i] - fit->ns[ref]) -
+			(((u64)dx[i] * fit->mult_nominal) >> shift);
+		mx += dx[i];
+		mr += dr[i];
+	}
+	mx = div_s64(mx, fit->nr);
+	mr = div_s64(mr, fit->nr);
+
+	for (i = 0; i < fit->nr; i++) {
+		sxx += (dx[i] - mx) * (dx[i] - mx);
+		sxr += (dx[i] - mx) * (dr[i] - mr);
+	}
+	if (!(sxx >> shift))
+		return fit->mult_nominal;
+
+	/* a fit this far off is a broken anchor, not a crystal */
+	adj = div64_s64(sxr, sxx >> shift);
+	max = (s64)fit->mult_nominal * CNT_FIT_MAX_PPM / 1000000;
+	if (adj > max || adj < -max)
+		return fit->mult_nominal;
+
+	return fit->mult_nominal + adj;
+}
+
+/* called from the sync hrtimer only, so there is a single writer */
+static void sprd_systimer_publish(void)
+{
+	struct sprd_systimer_data *d = systimer_data;
+	struct cnter_to_boottime *c = &cnter_to_boottime;
+
+	if (!d)
+		return;
+
+	WRITE_ONCE(d->seq, d->seq + 1);
+	smp_wmb();
+	d->boottime = c->last_boottime;
+	d->systimer = c->last_systimer_counter;
+	d->sysfrt = c->last_sysfrt_counter;
+	d->systimer_mult = c->systimer_mult;
+	d->systimer_shift = c->systimer_shift;
+	d->sysfrt_mult = c->sysfrt_mult;
+	d->sysfrt_shift = c->sysfrt_shift;
+	smp_wmb();
+	WRITE_ONCE(d->seq, d->seq + 1);
+}
+
+static int sprd_systimer_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	unsigned long len = vma->vm_end - vma->vm_start;
+	phys_addr_t phys;
+
+	if (len != PAGE_SIZE || (vma->vm_flags & VM_WRITE))
+		return -EINVAL;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	switch (vma->vm_pgoff) {
+	case SPRD_SYSTIMER_MMAP_DATA:
+		return remap_pfn_range(vma, vma->vm_start,
+				       virt_to_phys(systimer_data) >> PAGE_SHIFT,
+				       len, vma->vm_page_prot);
+	case SPRD_SYSTIMER_MMAP_SYSTIMER:
+		phys = systimer_phys;
+		break;
+	case SPRD_SYSTIMER_MMAP_SYSFRT:
+		phys = sysfrt_phys;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	if (!phys)
+		return -ENODEV;
+
+	vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+	return io_remap_pfn_range(vma, vma->vm_start, phys >> PAGE_SHIFT,
+				  len, vma->vm_page_prot);
+}
+
+static const struct file_operations sprd_systimer_fops = {
+	.owner = THIS_MODULE,
+	.mmap = sprd_systimer_mmap,
+};
+
+static struct miscdevice sprd_systimer_misc = {
+	.minor = MISC_DYNAMIC_MINOR,
+	.name = "sprd_systimer",
+	.fops = &sprd_systimer_fops,
+};
+
+static void sprd_systimer_user_init(struct device_node *st,
+				    struct device_node *frt)
+{
+	struct resource res;
+
+	systimer_data = (void *)get_zeroed_page(GFP_KERNEL);
+	if (!systimer_data)
+		return;
+
+	systimer_data->version = SPRD_SYSTIMER_DATA_VERSION;
+	systimer_data->systimer_reg = U32_MAX;
+	systimer_data->sysfrt_reg = U32_MAX;
+	if (sprd_systimer_addr_base && !of_address_to_resource(st, 0, &res)) {
+		systimer_phys = res.start & PAGE_MASK;
+		systimer_data->systimer_reg = offset_in_page(res.start) +
+					      SYSTIMER_CNT_SHDW;
+	}
+	if (sprd_sysfrt_addr_base && !of_address_to_resource(frt, 0, &res)) {
+		sysfrt_phys = res.start & PAGE_MASK;
+		systimer_data->sysfrt_reg = offset_in_page(res.start) +
+					    SYSFRT_CNT_SHDW;
+	}
+	sprd_systimer_publish();
+
+	if (misc_register(&sprd_systimer_misc))
+		pr_err("sprd_systimer: Can't register the user interface!\n");
+}
+
 static enum hrtimer_restart sync_cnter_boottime(struct hrtimer *hr)
 {
+	struct cnter_to_boottime *c = &cnter_to_boottime;
+	u64 systimer = sprd_systimer_read();
+
 	write_seqcount_begin(&systimer_seq);
 
-	cnter_to_boottime.last_boottime = ktime_get_boot_fast_ns();
-	cnter_to_boottime.last_systimer_counter = sprd_systimer_read();
-	cnter_to_boottime.last_sysfrt_counter = sprd_sysfrt_read();
+	c->systimer_unwrapped += (systimer - c->last_systimer_counter) &
+				 U32_MAX;
+	c->last_boottime = ktime_get_boot_fast_ns();
+	c->last_systimer_counter = systimer;
+	c->last_sysfrt_counter = sprd_sysfrt_read();
+
+	if (sprd_systimer_addr_base)
+		c->systimer_mult = cnter_fit_mult(&c->systimer_fit,
+						  c->systimer_unwrapped,
+						  c->last_boottime,
+						  c->systimer_shift);
+	if (sprd_sysfrt_addr_base)
+		c->sysfrt_mult = cnter_fit_mult(&c->sysfrt_fit,
+						c->last_sysfrt_counter,
+						c->last_boottime,
+						c->sysfrt_shift);
 
 	write_seqcount_end(&systimer_seq);
 
+	sprd_systimer_publish();
+
 	hrtimer_forward_now(&cnt_to_boot_timer, ms_to_ktime(DEFAULT_TIMEVALE_MS));
 
 	return HRTIMER_RESTART;
@@ -114,9 +300,9 @@ static enum hrtimer_restart sync_cnter_boottime(struct hrtimer *hr)
 
 static int __init sprd_systimer_init(void)
 {
-	struct device_node *np;
+	struct device_node *np, *st;
 
-	np = of_find_compatible_node(NULL, NULL, "sprd,syst-timer");
+	st = np = of_find_compatible_node(NULL, NULL, "sprd,syst-timer");
 	if (np) {
 		sprd_systimer_addr_base = of_iomap(np, 0);
 		if (sprd_systimer_addr_base) {
@@ -145,6 +331,21 @@ static int __init sprd_systimer_init(void)
 	cnter_to_boottime.last_boottime = ktime_get_boot_fast_ns();
 	cnter_to_boottime.last_systimer_counter = sprd_systimer_read();
 	cnter_to_boottime.last_sysfrt_counter = sprd_sysfrt_read();
+	cnter_to_boottime.systimer_fit.mult_nominal =
+		cnter_to_boottime.systimer_mult;
+	cnter_to_boottime.sysfrt_fit.mult_nominal =
+		cnter_to_boottime.sysfrt_mult;
+	cnter_fit_mult(&cnter_to_boottime.systimer_fit, 0,
+		       cnter_to_boottime.last_boottime,
+		       cnter_to_boottime.systimer_shift);
+	cnter_fit_mult(&cnter_to_boottime.sysfrt_fit,
+		       cnter_to_boottime.last_sysfrt_counter,
+		       cnter_to_boottime.last_boottime,
+		       cnter_to_boottime.sysfrt_shift);
+
+	sprd_systimer_user_init(st, np);
+	of_node_put(st);
+	of_node_put(np);
 
 	hrtimer_init(&cnt_to_boot_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
 	cnt_to_boot_timer.function = sync_cnter_boottime;
@@ -219,22 +219,32 @@ static int sprd_adi_fifo_is_full(struct sprd_adi *sadi)
 	return readl_relaxed(sadi->base + REG_ADI_ARM_FIFO_STS) & BIT_FIFO_FULL;
 }
 
-static int sprd_adi_read(struct sprd_adi *sadi, u32 reg_paddr, u32 *read_val)
+static int sprd_adi_lock(struct sprd_adi *sadi, unsigned long *flags)
+{
+	int ret;
+
+	if (!sadi->hwlock)
+		return 0;
+
+	ret = hwspin_lock_timeout_irqsave(sadi->hwlock, ADI_HWSPINLOCK_TIMEOUT,
+					  flags);
+	if (ret)
+		dev_err(sadi->dev, "get the hw lock failed\n");
+
+	return ret;
+}
+
+static void sprd_adi_unlock(struct sprd_adi *sadi, unsigned long *flags)
+{
+	if (sadi->hwlock)
+		hwspin_unlock_irqrestore(sadi->hwlock, flags);
+}
+
+/* called with the hw lock held */
+static int __sprd_adi_read(struct sprd_adi *sadi, u32 reg_paddr, u32 *read_val)
 {
 	int read_timeout = ADI_READ_TIMEOUT;
-	unsigned long flags;
 	u32 val, rd_addr;
-	int ret = 0;
-
-	if (sadi->hwlock) {
-		ret = hwspin_lock_timeout_irqsave(sadi->hwlock,
-						  ADI_HWSPINLOCK_TIMEOUT,
-						  &flags);
-		if (ret) {
-			dev_err(sadi->dev, "get the hw lock failed\n");
-			return ret;
-		}
-	}
 
 	/*
 	 * Set the physical register address need to read into RD_CMD register,
@@ -258,8 +268,7 @@ static int sprd_adi_read(struct sprd_adi *sadi, u32 reg_paddr, u32 *read_val)
 
 	if (read_timeout == 0) {
 		dev_err(sadi->dev, "ADI read timeout\n");
-		ret = -EBUSY;
-		goto out;
+		return -EBUSY;
 	}
 
 	/*
@@ -273,98 +282,137 @@ static int sprd_adi_read(struct sprd_adi *sadi, u32 reg_paddr, u32 *read_val)
 	if (rd_addr != (reg_paddr & REG_ADDR_LOW_MASK) >> RDBACK_ADDR_OFFSET) {
 		dev_err(sadi->dev, "read error, reg addr = 0x%x, val = 0x%x\n",
 			reg_paddr, val);
-		ret = -EIO;
-		goto out;
+		return -EIO;
 	}
 
 	*read_val = val & RD_VALUE_MASK;
 
-out:
-	if (sadi->hwlock)
-		hwspin_unlock_irqrestore(sadi->hwlock, &flags);
-	return ret;
+	return 0;
 }
 
-static int sprd_adi_write(struct sprd_adi *sadi, u32 reg_paddr, u32 val)
+/*
+ * Read @cnt registers from @reg_paddr on, 4 bytes apart, under one hw lock.
+ * Writes still in the fifo go out first, the read must see them.
+ */
+static int sprd_adi_read_regs(struct sprd_adi *sadi, u32 reg_paddr,
+			      u32 *read_val, int cnt)
 {
-	unsigned long reg = sprd_adi_to_vaddr(sadi, reg_paddr);
-	u32 timeout = ADI_FIFO_DRAIN_TIMEOUT;
 	unsigned long flags;
-	int ret;
+	int i, ret;
 
-	if (sadi->hwlock) {
-		ret = hwspin_lock_timeout_irqsave(sadi->hwlock,
-						  ADI_HWSPINLOCK_TIMEOUT,
-						  &flags);
-		if (ret) {
-			dev_err(sadi->dev, "get the hw lock failed\n");
-			return ret;
-		}
-	}
+	ret = sprd_adi_lock(sadi, &flags);
+	if (ret)
+		return ret;
 
 	ret = sprd_adi_drain_fifo(sadi);
-	if (ret < 0)
-		goto out;
+	for (i = 0; !ret && i < cnt; i++)
+		ret = __sprd_adi_read(sadi, reg_paddr + i * 4, &read_val[i]);
 
-	/*
-	 * we should wait for write fifo is empty before writing data to PMIC
-	 * registers.
-	 */
+	sprd_adi_unlock(sadi, &flags);
+	return ret;
+}
+
+static int sprd_adi_read(struct sprd_adi *sadi, u32 reg_paddr, u32 *read_val)
+{
+	return sprd_adi_read_regs(sadi, reg_paddr, read_val, 1);
+}
+
+/* called with the hw lock held and the fifo drained before the first one */
+static int __sprd_adi_write(struct sprd_adi *sadi, u32 reg_paddr, u32 val)
+{
+	unsigned long reg = sprd_adi_to_vaddr(sadi, reg_paddr);
+	u32 timeout = ADI_FIFO_DRAIN_TIMEOUT;
+
+	/* only wait for a slot, the fifo sends them out in order */
 	do {
 		if (!sprd_adi_fifo_is_full(sadi)) {
 			writel_relaxed(val, (void __iomem *)reg);
-			break;
+			return 0;
 		}
 
 		cpu_relax();
 	} while (--timeout);
 
-	if (timeout == 0) {
-		dev_err(sadi->dev, "write fifo is full\n");
-		ret = -EBUSY;
-	}
+	dev_err(sadi->dev, "write fifo is full\n");
+	return -EBUSY;
+}
 
-out:
-	if (sadi->hwlock)
-		hwspin_unlock_irqrestore(sadi->hwlock, &flags);
+/*
+ * Write @cnt (address, value) pairs under one hw lock, filling the write
+ * fifo instead of draining it between the writes. The addresses are
+ * @base relative.
+ */
+static int sprd_adi_write_regs(struct sprd_adi *sadi, const u32 *pairs,
+			       int cnt, u32 base)
+{
+	unsigned long flags;
+	int i, ret;
+
+	ret = sprd_adi_lock(sadi, &flags);
+	if (ret)
+		return ret;
+
+	/*
+	 * we should wait for write fifo is empty before writing data to PMIC
+	 * registers.
+	 */
+	ret = sprd_adi_drain_fifo(sadi);
+	for (i = 0; !ret && i < cnt; i++)
+		ret = __sprd_adi_write(sadi, base + pairs[2 * i],
+				       pairs[2 * i + 1]);
+
+	sprd_adi_unlock(sadi, &flags);
 	return ret;
 }
 
+static int sprd_adi_write(struct sprd_adi *sadi, u32 reg_paddr, u32 val)
+{
+	u32 pair[2] = { reg_paddr, val };
+
+	return sprd_adi_write_regs(sadi, pair, 1, 0);
+}
+
 static int sprd_adi_transfer_one(struct spi_controller *ctlr,
 				 struct spi_device *spi_dev,
 				 struct spi_transfer *t)
 {
 	struct sprd_adi *sadi = spi_controller_get_devdata(ctlr);
-	u32 phy_reg, val;
-	int ret;
+	u32 phy_reg;
+	int i, cnt, ret;
 
 	if (t->rx_buf) {
+		/*
+		 * The first word is the register to start from, a transfer of
+		 * n words reads n registers in a row, shorter ones read one.
+		 */
+		cnt = max_t(int, t->len / sizeof(u32), 1);
 		phy_reg = *(u32 *)t->rx_buf + sadi->slave_pbase;
 
-		ret = sprd_adi_check_paddr(sadi, phy_reg);
+		ret = sprd_adi_check_paddr(sadi, phy_reg) ?:
+		      sprd_adi_check_paddr(sadi, phy_reg + (cnt - 1) * 4);
 		if (ret)
 			return ret;
 
-		ret = sprd_adi_read(sadi, phy_reg, &val);
+		ret = sprd_adi_read_regs(sadi, phy_reg, t->rx_buf, cnt);
 		if (ret)
 			return ret;
-
-		*(u32 *)t->rx_buf = val;
 	} else if (t->tx_buf) {
-		u32 *p = (u32 *)t->tx_buf;
+		const u32 *p = t->tx_buf;
 
 		/*
-		 * Get the physical register address need to write and convert
-		 * the physical address to virtual address. Since we need
-		 * virtual register address to write.
+		 * (address, value) pairs, as many as the transfer holds. The
+		 * physical register addresses are converted to virtual ones
+		 * for the write.
 		 */
-		phy_reg = *p++ + sadi->slave_pbase;
-		ret = sprd_adi_check_paddr(sadi, phy_reg);
-		if (ret)
-			return ret;
+		cnt = max_t(int, t->len / (2 * sizeof(u32)), 1);
+		for (i = 0; i < cnt; i++) {
+			ret = sprd_adi_check_paddr(sadi,
+					p[2 * i] + sadi->slave_pbase);
+			if (ret)
+				return ret;
+		}
 
-		val = *p;
-		ret = sprd_adi_write(sadi, phy_reg, val);
+		ret = sprd_adi_write_regs(sadi, p, cnt, sadi->slave_pbase);
 		if (ret)
 			return ret;
 	} else {
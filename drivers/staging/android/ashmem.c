@@ -31,6 +31,9 @@
 #include <linux/personality.h>
 #include <linux/bitops.h>
 #include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+#include <linux/interval_tree_generic.h>
 #include <linux/shmem_fs.h>
 #include "ashmem.h"
 
@@ -41,61 +44,77 @@
 /**
  * struct ashmem_area - The anonymous shared memory area
  * @name:		The optional name in /proc/pid/maps
- * @unpinned_list:	The list of all ashmem areas
+ * @unpinned:		Interval tree of the unpinned ranges of this area
  * @file:		The shmem-based backing file
  * @size:		The size of the mapping, in bytes
  * @prot_mask:		The allowed protection bits, as vm_flags
+ * @lock:		Protects all of the above
  *
  * The lifecycle of this structure is from our parent file's open() until
- * its release(). It is also protected by 'ashmem_mutex'
+ * its release(). Each area has its own lock so that pinning in one area
+ * never waits for another one or for the shrinker purging another one.
+ *
+ * Lock Ordering: lock -> ashmem_lru_lock, lock -> i_mutex -> i_alloc_sem
  *
  * Warning: Mappings do NOT pin this structure; It dies on close()
  */
 struct ashmem_area {
 	char name[ASHMEM_FULL_NAME_LEN];
-	struct list_head unpinned_list;
+	struct rb_root_cached unpinned;
 	struct file *file;
 	size_t size;
 	unsigned long prot_mask;
+	struct mutex lock;
 };
 
 /**
  * struct ashmem_range - A range of unpinned/evictable pages
  * @lru:	         The entry in the LRU list
- * @unpinned:	         The entry in its area's unpinned list
+ * @node:	         The node in its area's unpinned tree
+ * @subtree_last:        The last page of the subtree below @node
  * @asma:	         The associated anonymous shared memory area.
  * @pgstart:	         The starting page (inclusive)
  * @pgend:	         The ending page (inclusive)
  * @purged:	         The purge status (ASHMEM_NOT or ASHMEM_WAS_PURGED)
  *
  * The lifecycle of this structure is from unpin to pin.
- * It is protected by 'ashmem_mutex'
+ * It is protected by its area's lock, @lru also by ashmem_lru_lock.
  */
 struct ashmem_range {
 	struct list_head lru;
-	struct list_head unpinned;
+	struct rb_node node;
+	size_t subtree_last;
 	struct ashmem_area *asma;
 	size_t pgstart;
 	size_t pgend;
 	unsigned int purged;
 };
 
-/* LRU list of unpinned pages, protected by ashmem_mutex */
+#define range_tree_start(range)	((range)->pgstart)
+#define range_tree_last(range)	((range)->pgend)
+
+INTERVAL_TREE_DEFINE(struct ashmem_range, node, size_t, subtree_last,
+		     range_tree_start, range_tree_last, static inline, range_tree)
+
+/* LRU list of unpinned pages, protected by ashmem_lru_lock */
 static LIST_HEAD(ashmem_lru_list);
 
 /*
  * long lru_count - The count of pages on our LRU list.
  *
- * This is protected by ashmem_mutex.
+ * This is protected by ashmem_lru_lock.
  */
 static unsigned long lru_count;
 
+static DEFINE_SPINLOCK(ashmem_lru_lock);
+
 /*
- * ashmem_mutex - protects the list of and each individual ashmem_area
- *
- * Lock Ordering: ashmex_mutex -> i_mutex -> i_alloc_sem
+ * Ranges the shrinker is purging with their area lock held. release()
+ * waits for this to drop before it frees the area, the shrinker may still
+ * be inside mutex_unlock() on it.
  */
-static DEFINE_MUTEX(ashmem_mutex);
+static atomic_t ashmem_shrink_inflight = ATOMIC_INIT(0);
+static DECLARE_WAIT_QUEUE_HEAD(ashmem_shrink_wait);
 
 static struct kmem_cache *ashmem_area_cachep __read_mostly;
 static struct kmem_cache *ashmem_range_cachep __read_mostly;
@@ -122,23 +141,6 @@ static inline bool page_range_subsumed_by_range(struct ashmem_range *range,
 	return (range->pgstart <= start) && (range->pgend >= end);
 }
 
-static inline bool page_in_range(struct ashmem_range *range, size_t page)
-{
-	return (range->pgstart <= page) && (range->pgend >= page);
-}
-
-static inline bool page_range_in_range(struct ashmem_range *range,
-				       size_t start, size_t end)
-{
-	return page_in_range(range, start) || page_in_range(range, end) ||
-		page_range_subsumes_range(range, start, end);
-}
-
-static inline bool range_before_page(struct ashmem_range *range, size_t page)
-{
-	return range->pgend < page;
-}
-
 #define PROT_MASK		(PROT_EXEC | PROT_READ | PROT_WRITE)
 
 /**
@@ -147,6 +149,8 @@ static inline bool range_before_page(struct ashmem_range *range, size_t page)
  *
  * The range is first added to the end (tail) of the LRU list.
  * After this, the size of the range is added to @lru_count
+ *
+ * Caller must hold ashmem_lru_lock.
  */
 static inline void lru_add(struct ashmem_range *range)
 {
@@ -160,6 +164,8 @@ static inline void lru_add(struct ashmem_range *range)
  *
  * The range is first deleted from the LRU list.
  * After this, the size of the range is removed from @lru_count
+ *
+ * Caller must hold ashmem_lru_lock.
  */
 static inline void lru_del(struct ashmem_range *range)
 {
@@ -170,17 +176,15 @@ static inline void lru_del(struct ashmem_range *range)
 /**
  * range_alloc() - Allocates and initializes a new ashmem_range structure
  * @asma:	   The associated ashmem_area
- * @prev_range:	   The previous ashmem_range in the sorted asma->unpinned list
  * @purged:	   Initial purge status (ASMEM_NOT_PURGED or ASHMEM_WAS_PURGED)
  * @start:	   The starting page (inclusive)
  * @end:	   The ending page (inclusive)
  *
- * This function is protected by ashmem_mutex.
+ * Caller must hold asma->lock.
  *
  * Return: 0 if successful, or -ENOMEM if there is an error
  */
-static int range_alloc(struct ashmem_area *asma,
-		       struct ashmem_range *prev_range, unsigned int purged,
+static int range_alloc(struct ashmem_area *asma, unsigned int purged,
 		       size_t start, size_t end)
 {
 	struct ashmem_range *range;
@@ -194,10 +198,13 @@ static int range_alloc(struct ashmem_area *asma,
 	range->pgend = end;
 	range->purged = purged;
 
-	list_add_tail(&range->unpinned, &prev_range->unpinned);
+	range_tree_insert(range, &asma->unpinned);
 
-	if (range_on_lru(range))
+	if (range_on_lru(range)) {
+		spin_lock(&ashmem_lru_lock);
 		lru_add(range);
+		spin_unlock(&ashmem_lru_lock);
+	}
 
 	return 0;
 }
@@ -208,9 +215,12 @@ static int range_alloc(struct ashmem_area *asma,
  */
 static void range_del(struct ashmem_range *range)
 {
-	list_del(&range->unpinned);
-	if (range_on_lru(range))
+	range_tree_remove(range, &range->asma->unpinned);
+	if (range_on_lru(range)) {
+		spin_lock(&ashmem_lru_lock);
 		lru_del(range);
+		spin_unlock(&ashmem_lru_lock);
+	}
 	kmem_cache_free(ashmem_range_cachep, range);
 }
 
@@ -229,13 +239,19 @@ static void range_del(struct ashmem_range *range)
 static inline void range_shrink(struct ashmem_range *range,
 				size_t start, size_t end)
 {
+	struct rb_root_cached *root = &range->asma->unpinned;
 	size_t pre = range_size(range);
 
+	range_tree_remove(range, root);
 	range->pgstart = start;
 	range->pgend = end;
+	range_tree_insert(range, root);
 
-	if (range_on_lru(range))
+	if (range_on_lru(range)) {
+		spin_lock(&ashmem_lru_lock);
 		lru_count -= pre - range_size(range);
+		spin_unlock(&ashmem_lru_lock);
+	}
 }
 
 /**
@@ -261,7 +277,8 @@ static int ashmem_open(struct inode *inode, struct file *file)
 	if (unlikely(!asma))
 		return -ENOMEM;
 
-	INIT_LIST_HEAD(&asma->unpinned_list);
+	asma->unpinned = RB_ROOT_CACHED;
+	mutex_init(&asma->lock);
 	memcpy(asma->name, ASHMEM_NAME_PREFIX, ASHMEM_NAME_PREFIX_LEN);
 	asma->prot_mask = PROT_MASK;
 	file->private_data = asma;
@@ -280,12 +297,14 @@ static int ashmem_open(struct inode *inode, struct file *file)
 static int ashmem_release(struct inode *ignored, struct file *file)
 {
 	struct ashmem_area *asma = file->private_data;
-	struct ashmem_range *range, *next;
+	struct ashmem_range *range;
 
-	mutex_lock(&ashmem_mutex);
-	list_for_each_entry_safe(range, next, &asma->unpinned_list, unpinned)
+	mutex_lock(&asma->lock);
+	while ((range = range_tree_iter_first(&asma->unpinned, 0, SIZE_MAX)))
 		range_del(range);
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->lock);
+
+	wait_event(ashmem_shrink_wait, !atomic_read(&ashmem_shrink_inflight));
 
 	if (asma->file)
 		fput(asma->file);
@@ -299,7 +318,7 @@ static ssize_t ashmem_read_iter(struct kiocb *iocb, struct iov_iter *iter)
 	struct ashmem_area *asma = iocb->ki_filp->private_data;
 	int ret = 0;
 
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->lock);
 
 	/* If size is not set, or set to 0, always return EOF. */
 	if (asma->size == 0)
@@ -316,13 +335,13 @@ static ssize_t ashmem_read_iter(struct kiocb *iocb, struct iov_iter *iter)
 	 * be destroyed until all references to the file are dropped and
 	 * ashmem_release is called.
 	 */
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->lock);
 	ret = vfs_iter_read(asma->file, iter, &iocb->ki_pos, 0);
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->lock);
 	if (ret > 0)
 		asma->file->f_pos = iocb->ki_pos;
 out_unlock:
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->lock);
 	return ret;
 }
 
@@ -331,19 +350,19 @@ static loff_t ashmem_llseek(struct file *file, loff_t offset, int origin)
 	struct ashmem_area *asma = file->private_data;
 	int ret;
 
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->lock);
 
 	if (asma->size == 0) {
-		mutex_unlock(&ashmem_mutex);
+		mutex_unlock(&asma->lock);
 		return -EINVAL;
 	}
 
 	if (!asma->file) {
-		mutex_unlock(&ashmem_mutex);
+		mutex_unlock(&asma->lock);
 		return -EBADF;
 	}
 
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->lock);
 
 	ret = vfs_llseek(asma->file, offset, origin);
 	if (ret < 0)
@@ -381,7 +400,7 @@ static int ashmem_mmap(struct file *file, struct vm_area_struct *vma)
 	struct ashmem_area *asma = file->private_data;
 	int ret = 0;
 
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->lock);
 
 	/* user needs to SET_SIZE before mapping */
 	if (unlikely(!asma->size)) {
@@ -443,7 +462,7 @@ static int ashmem_mmap(struct file *file, struct vm_area_struct *vma)
 	}
 
 out:
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->lock);
 	return ret;
 }
 
@@ -454,41 +473,63 @@ out:
  *
  * 'gfp_mask' is the mask of the allocation that got us into this mess.
  *
- * Return value is the number of objects freed or -1 if we cannot
+ * Return value is the number of objects freed or SHRINK_STOP if we cannot
  * proceed without risk of deadlock (due to gfp_mask).
  *
  * We approximate LRU via least-recently-unpinned, jettisoning unpinned partial
  * chunks of ashmem regions LRU-wise one-at-a-time until we hit 'nr_to_scan'
  * pages freed.
+ *
+ * Only the area being purged is locked, and only with a trylock: a range
+ * whose area is busy is rotated to the tail instead of waited for, so the
+ * shrinker never stalls a pin and is never stalled by one.
  */
 static unsigned long
 ashmem_shrink_scan(struct shrinker *shrink, struct shrink_control *sc)
 {
-	struct ashmem_range *range, *next;
+	struct ashmem_range *range;
+	struct ashmem_area *asma;
 	unsigned long freed = 0;
 
 	/* We might recurse into filesystem code, so bail out if necessary */
 	if (!(sc->gfp_mask & __GFP_FS))
 		return SHRINK_STOP;
 
-	if (!mutex_trylock(&ashmem_mutex))
-		return -1;
+	spin_lock(&ashmem_lru_lock);
+	while (!list_empty(&ashmem_lru_list)) {
+		loff_t start, end;
+
+		range = list_first_entry(&ashmem_lru_list, struct ashmem_range,
+					 lru);
+		asma = range->asma;
+		if (!mutex_trylock(&asma->lock)) {
+			list_move_tail(&range->lru, &ashmem_lru_list);
+			if (--sc->nr_to_scan <= 0)
+				break;
+			continue;
+		}
 
-	list_for_each_entry_safe(range, next, &ashmem_lru_list, lru) {
-		loff_t start = range->pgstart * PAGE_SIZE;
-		loff_t end = (range->pgend + 1) * PAGE_SIZE;
+		start = range->pgstart * PAGE_SIZE;
+		end = (range->pgend + 1) * PAGE_SIZE;
+		range->purged = ASHMEM_WAS_PURGED;
+		lru_del(range);
+		freed += range_size(range);
+		atomic_inc(&ashmem_shrink_inflight);
+		spin_unlock(&ashmem_lru_lock);
 
-		range->asma->file->f_op->fallocate(range->asma->file,
+		asma->file->f_op->fallocate(asma->file,
 				FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
 				start, end - start);
-		range->purged = ASHMEM_WAS_PURGED;
-		lru_del(range);
+		mutex_unlock(&asma->lock);
+
+		if (atomic_dec_and_test(&ashmem_shrink_inflight))
+			wake_up_all(&ashmem_shrink_wait);
 
-		freed += range_size(range);
 		if (--sc->nr_to_scan <= 0)
-			break;
+			return freed;
+		spin_lock(&ashmem_lru_lock);
 	}
-	mutex_unlock(&ashmem_mutex);
+	spin_unlock(&ashmem_lru_lock);
 	return freed;
 }
 
@@ -517,7 +558,7 @@ static int set_prot_mask(struct ashmem_area *asma, unsigned long prot)
 {
 	int ret = 0;
 
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->lock);
 
 	/* the user can only remove, not add, protection bits */
 	if (unlikely((asma->prot_mask & prot) != prot)) {
@@ -532,7 +573,7 @@ static int set_prot_mask(struct ashmem_area *asma, unsigned long prot)
 	asma->prot_mask = prot;
 
 out:
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->lock);
 	return ret;
 }
 
@@ -543,10 +584,10 @@ static int set_name(struct ashmem_area *asma, void __user *name)
 	char local_name[ASHMEM_NAME_LEN];
 
 	/*
-	 * Holding the ashmem_mutex while doing a copy_from_user might cause
+	 * Holding the asma->lock while doing a copy_from_user might cause
 	 * an data abort which would try to access mmap_sem. If another
 	 * thread has invoked ashmem_mmap then it will be holding the
-	 * semaphore and will be waiting for ashmem_mutex, there by leading to
+	 * semaphore and will be waiting for asma->lock, there by leading to
 	 * deadlock. We'll release the mutex  and take the name to a local
 	 * variable that does not need protection and later copy the local
 	 * variable to the structure member with lock held.
@@ -556,14 +597,14 @@ static int set_name(struct ashmem_area *asma, void __user *name)
 		return len;
 	if (len == ASHMEM_NAME_LEN)
 		local_name[ASHMEM_NAME_LEN - 1] = '\0';
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->lock);
 	/* cannot change an existing mapping's name */
 	if (unlikely(asma->file))
 		ret = -EINVAL;
 	else
 		strcpy(asma->name + ASHMEM_NAME_PREFIX_LEN, local_name);
 
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->lock);
 	return ret;
 }
 
@@ -579,7 +620,7 @@ static int get_name(struct ashmem_area *asma, void __user *name)
 	 */
 	char local_name[ASHMEM_NAME_LEN];
 
-	mutex_lock(&ashmem_mutex);
+	mutex_lock(&asma->lock);
 	if (asma->name[ASHMEM_NAME_PREFIX_LEN] != '\0') {
 		/*
 		 * Copying only `len', instead of ASHMEM_NAME_LEN, bytes
@@ -591,7 +632,7 @@ static int get_name(struct ashmem_area *asma, void __user *name)
 		len = sizeof(ASHMEM_NAME_DEF);
 		memcpy(local_name, ASHMEM_NAME_DEF, len);
 	}
-	mutex_unlock(&ashmem_mutex);
+	mutex_unlock(&asma->lock);
 
 	/*
 	 * Now we are just copying from the stack variable to userland
@@ -606,18 +647,16 @@ static int get_name(struct ashmem_area *asma, void __user *name)
  * ashmem_pin - pin the given ashmem region, returning whether it was
  * previously purged (ASHMEM_WAS_PURGED) or not (ASHMEM_NOT_PURGED).
  *
- * Caller must hold ashmem_mutex.
+ * Caller must hold asma->lock.
  */
 static int ashmem_pin(struct ashmem_area *asma, size_t pgstart, size_t pgend)
 {
-	struct ashmem_range *range, *next;
+	struct ashmem_range *range;
 	int ret = ASHMEM_NOT_PURGED;
 
-	list_for_each_entry_safe(range, next, &asma->unpinned_list, unpinned) {
-		/* moved past last applicable page; we can short circuit */
-		if (range_before_page(range, pgstart))
-			break;
-
+	/* each case below moves the range out of [pgstart, pgend] */
+	while ((range = range_tree_iter_first(&asma->unpinned,
+					      pgstart, pgend))) {
 		/*
 		 * The user can ask us to pin pages that span multiple ranges,
 		 * or to pin pages that aren't even unpinned, so this is messy.
@@ -633,38 +672,34 @@ static int ashmem_pin(struct ashmem_area *asma, size_t pgstart, size_t pgend)
 		 *    so we have to update one side of the range and then
 		 *    create a new range for the other side.
 		 */
-		if (page_range_in_range(range, pgstart, pgend)) {
-			ret |= range->purged;
-
-			/* Case #1: Easy. Just nuke the whole thing. */
-			if (page_range_subsumes_range(range, pgstart, pgend)) {
-				range_del(range);
-				continue;
-			}
-
-			/* Case #2: We overlap from the start, so adjust it */
-			if (range->pgstart >= pgstart) {
-				range_shrink(range, pgend + 1, range->pgend);
-				continue;
-			}
-
-			/* Case #3: We overlap from the rear, so adjust it */
-			if (range->pgend <= pgend) {
-				range_shrink(range, range->pgstart,
-					     pgstart - 1);
-				continue;
-			}
-
-			/*
-			 * Case #4: We eat a chunk out of the middle. A bit
-			 * more complicated, we allocate a new range for the
-			 * second half and adjust the first chunk's endpoint.
-			 */
-			range_alloc(asma, range, range->purged,
-				    pgend + 1, range->pgend);
+		ret |= range->purged;
+
+		/* Case #1: Easy. Just nuke the whole thing. */
+		if (page_range_subsumes_range(range, pgstart, pgend)) {
+			range_del(range);
+			continue;
+		}
+
+		/* Case #2: We overlap from the start, so adjust it */
+		if (range->pgstart >= pgstart) {
+			range_shrink(range, pgend + 1, range->pgend);
+			continue;
+		}
+
+		/* Case #3: We overlap from the rear, so adjust it */
+		if (range->pgend <= pgend) {
 			range_shrink(range, range->pgstart, pgstart - 1);
-			break;
+			continue;
 		}
+
+		/*
+		 * Case #4: We eat a chunk out of the middle. A bit
+		 * more complicated, we allocate a new range for the
+		 * second half and adjust the first chunk's endpoint.
+		 */
+		range_alloc(asma, range->purged, pgend + 1, range->pgend);
+		range_shrink(range, range->pgstart, pgstart - 1);
+		break;
 	}
 
 	return ret;
@@ -673,110 +708,154 @@ static int ashmem_pin(struct ashmem_area *asma, size_t pgstart, size_t pgend)
 /*
  * ashmem_unpin - unpin the given range of pages. Returns zero on success.
  *
- * Caller must hold ashmem_mutex.
+ * Caller must hold asma->lock.
  */
 static int ashmem_unpin(struct ashmem_area *asma, size_t pgstart, size_t pgend)
 {
-	struct ashmem_range *range, *next;
+	struct ashmem_range *range;
 	unsigned int purged = ASHMEM_NOT_PURGED;
 
-restart:
-	list_for_each_entry_safe(range, next, &asma->unpinned_list, unpinned) {
-		/* short circuit: this is our insertion point */
-		if (range_before_page(range, pgstart))
-			break;
-
-		/*
-		 * The user can ask us to unpin pages that are already entirely
-		 * or partially pinned. We handle those two cases here.
-		 */
+	/*
+	 * The user can ask us to unpin pages that are already entirely
+	 * or partially unpinned. We handle those two cases here.
+	 */
+	while ((range = range_tree_iter_first(&asma->unpinned,
+					      pgstart, pgend))) {
 		if (page_range_subsumed_by_range(range, pgstart, pgend))
 			return 0;
-		if (page_range_in_range(range, pgstart, pgend)) {
-			pgstart = min(range->pgstart, pgstart);
-			pgend = max(range->pgend, pgend);
-			purged |= range->purged;
-			range_del(range);
-			goto restart;
-		}
+		pgstart = min(range->pgstart, pgstart);
+		pgend = max(range->pgend, pgend);
+		purged |= range->purged;
+		range_del(range);
 	}
 
-	return range_alloc(asma, range, purged, pgstart, pgend);
+	return range_alloc(asma, purged, pgstart, pgend);
 }
 
 /*
  * ashmem_get_pin_status - Returns ASHMEM_IS_UNPINNED if _any_ pages in the
  * given interval are unpinned and ASHMEM_IS_PINNED otherwise.
  *
- * Caller must hold ashmem_mutex.
+ * Caller must hold asma->lock.
  */
 static int ashmem_get_pin_status(struct ashmem_area *asma, size_t pgstart,
 				 size_t pgend)
 {
-	struct ashmem_range *range;
-	int ret = ASHMEM_IS_PINNED;
-
-	list_for_each_entry(range, &asma->unpinned_list, unpinned) {
-		if (range_before_page(range, pgstart))
-			break;
-		if (page_range_in_range(range, pgstart, pgend)) {
-			ret = ASHMEM_IS_UNPINNED;
-			break;
-		}
-	}
+	if (range_tree_iter_first(&asma->unpinned, pgstart, pgend))
+		return ASHMEM_IS_UNPINNED;
 
-	return ret;
+	return ASHMEM_IS_PINNED;
 }
 
-static int ashmem_pin_unpin(struct ashmem_area *asma, unsigned long cmd,
-			    void __user *p)
+/*
+ * __ashmem_pin_unpin - check @pin against the area and apply @cmd to it.
+ *
+ * Caller must hold asma->lock.
+ */
+static int __ashmem_pin_unpin(struct ashmem_area *asma, unsigned int cmd,
+			      struct ashmem_pin *pin)
 {
-	struct ashmem_pin pin;
 	size_t pgstart, pgend;
-	int ret = -EINVAL;
-
-	if (unlikely(copy_from_user(&pin, p, sizeof(pin))))
-		return -EFAULT;
-
-	mutex_lock(&ashmem_mutex);
 
 	if (unlikely(!asma->file))
-		goto out_unlock;
+		return -EINVAL;
 
 	/* per custom, you can pass zero for len to mean "everything onward" */
-	if (!pin.len)
-		pin.len = PAGE_ALIGN(asma->size) - pin.offset;
+	if (!pin->len)
+		pin->len = PAGE_ALIGN(asma->size) - pin->offset;
 
-	if (unlikely((pin.offset | pin.len) & ~PAGE_MASK))
-		goto out_unlock;
+	if (unlikely((pin->offset | pin->len) & ~PAGE_MASK))
+		return -EINVAL;
 
-	if (unlikely(((__u32)-1) - pin.offset < pin.len))
-		goto out_unlock;
+	if (unlikely(((__u32)-1) - pin->offset < pin->len))
+		return -EINVAL;
 
-	if (unlikely(PAGE_ALIGN(asma->size) < pin.offset + pin.len))
-		goto out_unlock;
+	if (unlikely(PAGE_ALIGN(asma->size) < pin->offset + pin->len))
+		return -EINVAL;
 
-	pgstart = pin.offset / PAGE_SIZE;
-	pgend = pgstart + (pin.len / PAGE_SIZE) - 1;
+	pgstart = pin->offset / PAGE_SIZE;
+	pgend = pgstart + (pin->len / PAGE_SIZE) - 1;
 
 	switch (cmd) {
 	case ASHMEM_PIN:
-		ret = ashmem_pin(asma, pgstart, pgend);
-		break;
+		return ashmem_pin(asma, pgstart, pgend);
 	case ASHMEM_UNPIN:
-		ret = ashmem_unpin(asma, pgstart, pgend);
-		break;
+		return ashmem_unpin(asma, pgstart, pgend);
 	case ASHMEM_GET_PIN_STATUS:
-		ret = ashmem_get_pin_status(asma, pgstart, pgend);
-		break;
+		return ashmem_get_pin_status(asma, pgstart, pgend);
 	}
 
-out_unlock:
-	mutex_unlock(&ashmem_mutex);
+	return -EINVAL;
+}
+
+static int ashmem_pin_unpin(struct ashmem_area *asma, unsigned int cmd,
+			    void __user *p)
+{
+	struct ashmem_pin pin;
+	int ret;
+
+	if (unlikely(copy_from_user(&pin, p, sizeof(pin))))
+		return -EFAULT;
+
+	mutex_lock(&asma->lock);
+	ret = __ashmem_pin_unpin(asma, cmd, &pin);
+	mutex_unlock(&asma->lock);
 
 	return ret;
 }
 
+/* ranges copied in per lock hold, bounded to keep them on the stack */
+#define ASHMEM_BATCH_CHUNK	32
+
+/*
+ * ashmem_pin_unpin_batch - pin or unpin an array of ranges. The ranges are
+ * copied from userland in chunks and each chunk is applied under a single
+ * hold of asma->lock, as for set_name() nothing is copied with it held.
+ *
+ * Ranges are applied in order and stop at the first error, which is
+ * returned with the earlier ones left in place. Otherwise ASHMEM_PIN_BATCH
+ * returns ASHMEM_WAS_PURGED if any of the ranges was purged.
+ */
+static int ashmem_pin_unpin_batch(struct ashmem_area *asma, unsigned int cmd,
+				  void __user *p)
+{
+	struct ashmem_pin pins[ASHMEM_BATCH_CHUNK];
+	struct ashmem_pin_batch batch;
+	struct ashmem_pin __user *upins;
+	unsigned int done, n, i;
+	int ret = 0, purged = ASHMEM_NOT_PURGED;
+
+	if (unlikely(copy_from_user(&batch, p, sizeof(batch))))
+		return -EFAULT;
+
+	if (unlikely(batch.reserved))
+		return -EINVAL;
+
+	cmd = cmd == ASHMEM_PIN_BATCH ? ASHMEM_PIN : ASHMEM_UNPIN;
+	upins = u64_to_user_ptr(batch.pins);
+
+	for (done = 0; done < batch.count; done += n) {
+		n = min_t(unsigned int, batch.count - done, ASHMEM_BATCH_CHUNK);
+		if (unlikely(copy_from_user(pins, upins + done,
+					    n * sizeof(pins[0]))))
+			return -EFAULT;
+
+		mutex_lock(&asma->lock);
+		for (i = 0; i < n; i++) {
+			ret = __ashmem_pin_unpin(asma, cmd, &pins[i]);
+			if (ret < 0)
+				break;
+			purged |= ret;
+		}
+		mutex_unlock(&asma->lock);
+
+		if (ret < 0)
+			return ret;
+	}
+
+	return cmd == ASHMEM_PIN ? purged : 0;
+}
+
 static long ashmem_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
 	struct ashmem_area *asma = file->private_data;
@@ -791,12 +870,12 @@ static long ashmem_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		break;
 	case ASHMEM_SET_SIZE:
 		ret = -EINVAL;
-		mutex_lock(&ashmem_mutex);
+		mutex_lock(&asma->lock);
 		if (!asma->file) {
 			ret = 0;
 			asma->size = (size_t)arg;
 		}
-		mutex_unlock(&ashmem_mutex);
+		mutex_unlock(&asma->lock);
 		break;
 	case ASHMEM_GET_SIZE:
 		ret = asma->size;
@@ -812,6 +891,10 @@ static long ashmem_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 	case ASHMEM_GET_PIN_STATUS:
 		ret = ashmem_pin_unpin(asma, cmd, (void __user *)arg);
 		break;
+	case ASHMEM_PIN_BATCH:
+	case ASHMEM_UNPIN_BATCH:
+		ret = ashmem_pin_unpin_batch(asma, cmd, (void __user *)arg);
+		break;
 	case ASHMEM_PURGE_ALL_CACHES:
 		ret = -EPERM;
 		if (capable(CAP_SYS_ADMIN)) {
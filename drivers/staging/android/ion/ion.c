@@ -144,6 +144,9 @@ err2:
 
 void ion_buffer_destroy(struct ion_buffer *buffer)
 {
+	/* done here so deferred free heaps tear iommu mappings down late too */
+	sprd_ion_unmap_dma((void *)buffer);
+
 	if (buffer->kmap_cnt > 0) {
 		pr_warn_once("%s: buffer still mapped in the kernel\n",
 			     __func__);
@@ -162,8 +165,6 @@ static void _ion_buffer_destroy(struct ion_buffer *buffer)
 	rb_erase(&buffer->node, &dev->buffers);
 	mutex_unlock(&dev->buffer_lock);
 
-	sprd_ion_unmap_dma((void *)buffer);
-
 	if (heap->flags & ION_HEAP_FLAG_DEFER_FREE)
 		ion_heap_freelist_add(heap, buffer);
 	else
@@ -25,6 +25,7 @@
 #include <linux/rbtree.h>
 #include <linux/sched.h>
 #include <linux/shrinker.h>
+#include <linux/spinlock.h>
 #include <linux/sprd_iommu.h>
 #include <linux/types.h>
 #include <linux/miscdevice.h>
@@ -341,12 +342,26 @@ size_t ion_heap_freelist_size(struct ion_heap *heap);
  * @order:		order of pages in the pool
  * @list:		plist node for list of pools
  * @cached:		it's cached pool or not
+ * @pcp:		per cpu front caches, freed pages land there first
+ * @pcp_high:		capacity of each front cache, 0 disables them
+ * @pcp_count:		pages held by all front caches
+ * @high_mark:		pool size in items beyond which freed pages go back
+ *			to the system, halved by the shrinker
+ * @max_mark:		ceiling high_mark grows back to on pool misses
  *
  * Allows you to keep a pool of pre allocated pages to use from your heap.
  * Keeping a pool of pages that is ready for dma, ie any cached mapping have
  * been invalidated from the cache, provides a significant performance benefit
  * on many systems
  */
+#define ION_PAGE_POOL_PCP_MAX	64
+
+struct ion_page_pool_pcp {
+	spinlock_t lock;
+	int count;
+	struct page *pages[ION_PAGE_POOL_PCP_MAX];
+};
+
 struct ion_page_pool {
 	int high_count;
 	int low_count;
@@ -357,6 +372,11 @@ struct ion_page_pool {
 	gfp_t gfp_mask;
 	unsigned int order;
 	struct plist_node list;
+	struct ion_page_pool_pcp __percpu *pcp;
+	int pcp_high;
+	atomic_t pcp_count;
+	int high_mark;
+	int max_mark;
 };
 
 struct ion_page_pool *ion_page_pool_create(gfp_t gfp_mask, unsigned int order,
@@ -20,6 +20,8 @@
 #include <linux/fs.h>
 #include <linux/list.h>
 #include <linux/init.h>
+#include <linux/percpu.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
 #include <linux/swap.h>
 
@@ -40,9 +42,12 @@ static void ion_page_pool_free_pages(struct ion_page_pool *pool,
 	__free_pages(page, pool->order);
 }
 
-static int ion_page_pool_add(struct ion_page_pool *pool, struct page *page)
+static int ion_page_pool_add_locked(struct ion_page_pool *pool,
+				    struct page *page)
 {
-	mutex_lock(&pool->mutex);
+	if (pool->high_count + pool->low_count >= pool->high_mark)
+		return -ENOSPC;
+
 	if (PageHighMem(page)) {
 		list_add_tail(&page->lru, &pool->high_items);
 		pool->high_count++;
@@ -50,10 +55,87 @@ static int ion_page_pool_add(struct ion_page_pool *pool, struct page *page)
 		list_add_tail(&page->lru, &pool->low_items);
 		pool->low_count++;
 	}
-	mutex_unlock(&pool->mutex);
 	return 0;
 }
 
+static void ion_page_pool_add(struct ion_page_pool *pool,
+			      struct page **pages, int n)
+{
+	int i;
+
+	mutex_lock(&pool->mutex);
+	for (i = 0; i < n; i++)
+		if (ion_page_pool_add_locked(pool, pages[i]))
+			ion_page_pool_free_pages(pool, pages[i]);
+	mutex_unlock(&pool->mutex);
+}
+
+/*
+ * The front caches take the pool mutex out of the common free and alloc,
+ * pages only move to and from the pool in batches of half a cache.
+ */
+static struct page *ion_page_pool_pcp_get(struct ion_page_pool *pool,
+					  struct ion_page_pool_pcp *pcp)
+{
+	struct page *page = NULL;
+
+	spin_lock(&pcp->lock);
+	if (pcp->count) {
+		page = pcp->pages[--pcp->count];
+		atomic_dec(&pool->pcp_count);
+	}
+	spin_unlock(&pcp->lock);
+
+	return page;
+}
+
+static void ion_page_pool_pcp_put(struct ion_page_pool *pool,
+				  struct page *page)
+{
+	struct page *batch[ION_PAGE_POOL_PCP_MAX / 2 + 1];
+	struct ion_page_pool_pcp *pcp = raw_cpu_ptr(pool->pcp);
+	int n = pool->pcp_high / 2;
+
+	spin_lock(&pcp->lock);
+	if (pcp->count < pool->pcp_high) {
+		pcp->pages[pcp->count++] = page;
+		atomic_inc(&pool->pcp_count);
+		spin_unlock(&pcp->lock);
+		return;
+	}
+	pcp->count -= n;
+	memcpy(batch, &pcp->pages[pcp->count], n * sizeof(*batch));
+	atomic_sub(n, &pool->pcp_count);
+	spin_unlock(&pcp->lock);
+
+	batch[n++] = page;
+	ion_page_pool_add(pool, batch, n);
+}
+
+static void ion_page_pool_pcp_drain(struct ion_page_pool *pool)
+{
+	struct page *batch[ION_PAGE_POOL_PCP_MAX];
+	struct ion_page_pool_pcp *pcp;
+	int cpu, n;
+
+	if (!pool->pcp_high || !atomic_read(&pool->pcp_count))
+		return;
+
+	for_each_possible_cpu(cpu) {
+		pcp = per_cpu_ptr(pool->pcp, cpu);
+
+		spin_lock(&pcp->lock);
+		n = pcp->count;
+		memcpy(batch, pcp->pages, n * sizeof(*batch));
+		pcp->count = 0;
+		atomic_sub(n, &pool->pcp_count);
+		spin_unlock(&pcp->lock);
+
+		if (n)
+			ion_page_pool_add(pool, batch, n);
+	}
+}
+
 static struct page *ion_page_pool_remove(struct ion_page_pool *pool, bool high)
 {
 	struct page *page;
@@ -78,13 +160,34 @@ struct page *ion_page_pool_alloc(struct ion_page_pool *pool, bool *from_pool)
 
 	BUG_ON(!pool);
 
+	if (pool->pcp_high)
+		page = ion_page_pool_pcp_get(pool, raw_cpu_ptr(pool->pcp));
+	if (page) {
+		*from_pool = true;
+		return page;
+	}
+
 	mutex_lock(&pool->mutex);
 	if (pool->high_count)
 		page = ion_page_pool_remove(pool, true);
 	else if (pool->low_count)
 		page = ion_page_pool_remove(pool, false);
+	else if (pool->high_mark < pool->max_mark)
+		pool->high_mark++;
 	mutex_unlock(&pool->mutex);
 
+	/* the deferred free thread fills the cache of whatever cpu it ran on */
+	if (!page && pool->pcp_high && atomic_read(&pool->pcp_count)) {
+		int cpu;
+
+		for_each_possible_cpu(cpu) {
+			page = ion_page_pool_pcp_get(pool,
+						     per_cpu_ptr(pool->pcp, cpu));
+			if (page)
+				break;
+		}
+	}
+
 	if (!page) {
 		page = ion_page_pool_alloc_pages(pool);
 		*from_pool = false;
@@ -97,18 +200,17 @@ struct page *ion_page_pool_alloc(struct ion_page_pool *pool, bool *from_pool)
 
 void ion_page_pool_free(struct ion_page_pool *pool, struct page *page)
 {
-	int ret;
-
 	BUG_ON(pool->order != compound_order(page));
 
-	ret = ion_page_pool_add(pool, page);
-	if (ret)
-		ion_page_pool_free_pages(pool, page);
+	if (pool->pcp_high)
+		ion_page_pool_pcp_put(pool, page);
+	else
+		ion_page_pool_add(pool, &page, 1);
 }
 
 static int ion_page_pool_total(struct ion_page_pool *pool, bool high)
 {
-	int count = pool->low_count;
+	int count = pool->low_count + atomic_read(&pool->pcp_count);
 
 	if (high)
 		count += pool->high_count;
@@ -130,6 +232,13 @@ int ion_page_pool_shrink(struct ion_page_pool *pool, gfp_t gfp_mask,
 	if (nr_to_scan == 0)
 		return ion_page_pool_total(pool, high);
 
+	ion_page_pool_pcp_drain(pool);
+
+	/* memory is short, keep less around until misses ask for more */
+	mutex_lock(&pool->mutex);
+	pool->high_mark = max(pool->high_mark / 2, 1);
+	mutex_unlock(&pool->mutex);
+
 	while (freed < nr_to_scan) {
 		struct page *page;
 
@@ -154,9 +263,29 @@ struct ion_page_pool *ion_page_pool_create(gfp_t gfp_mask, unsigned int order,
 					   bool cached)
 {
 	struct ion_page_pool *pool = kmalloc(sizeof(*pool), GFP_KERNEL);
+	int cpu;
 
 	if (!pool)
 		return NULL;
+
+	pool->pcp = alloc_percpu(struct ion_page_pool_pcp);
+	if (!pool->pcp) {
+		kfree(pool);
+		return NULL;
+	}
+	for_each_possible_cpu(cpu) {
+		struct ion_page_pool_pcp *pcp = per_cpu_ptr(pool->pcp, cpu);
+
+		spin_lock_init(&pcp->lock);
+		pcp->count = 0;
+	}
+	atomic_set(&pool->pcp_count, 0);
+	/* no front cache for the 1M pages */
+	pool->pcp_high = min_t(int, ION_PAGE_POOL_PCP_MAX,
+			       SZ_256K >> (PAGE_SHIFT + order));
+	pool->max_mark = max_t(int, (totalram_pages >> 4) >> order, 1);
+	pool->high_mark = pool->max_mark;
+
 	pool->high_count = 0;
 	pool->low_count = 0;
 	INIT_LIST_HEAD(&pool->low_items);
@@ -165,14 +294,15 @@ struct ion_page_pool *ion_page_pool_create(gfp_t gfp_mask, unsigned int order,
 	pool->order = order;
 	mutex_init(&pool->mutex);
 	plist_node_init(&pool->list, order);
-	if (cached)
-		pool->cached = true;
+	pool->cached = cached;
 
 	return pool;
 }
 
 void ion_page_pool_destroy(struct ion_page_pool *pool)
 {
+	ion_page_pool_pcp_drain(pool);
+	free_percpu(pool->pcp);
 	kfree(pool);
 }
 
@@ -196,6 +196,10 @@ void sprd_ion_put_dma(void *buf, int id)
 	buffer->iomap_cnt[id]--;
 }
 
+/*
+ * Called as the buffer is destroyed. Besides leaked mappings this drops
+ * the iovas the iommu kept parked for reuse, each holds one iomap_cnt.
+ */
 void sprd_ion_unmap_dma(void *buffer)
 {
 	int i;
@@ -49,6 +49,7 @@
 #include <linux/vmpressure.h>
 #include <linux/mutex.h>
 #include <linux/delay.h>
+#include <linux/ktime.h>
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/almk.h>
@@ -103,6 +104,12 @@ static char *lowmem_proc_name;
 #endif
 
 static unsigned long lowmem_deathpending_timeout;
+
+/* kills and how long the scans which ended in one took, in us */
+static unsigned int lowmem_kill_count;
+static unsigned int lowmem_kill_scan_us_last;
+static unsigned int lowmem_kill_scan_us_max;
+static u64 lowmem_kill_scan_us_total;
 #ifdef CONFIG_OOM_NOTIFIER
 static unsigned long oom_deathpending_timeout;
 #endif
@@ -574,6 +581,8 @@ static unsigned long lowmem_scan(struct shrinker *s, struct shrink_control *sc)
 	int other_file;
 	struct sysinfo si;
 	int other_file_orig;
+	ktime_t scan_start;
+	unsigned int scan_us;
 
 	/* work around for antutu */
 	struct task_struct *selected_antutu = NULL;
@@ -595,6 +604,8 @@ static unsigned long lowmem_scan(struct shrinker *s, struct shrink_control *sc)
 	if (!mutex_trylock(&scan_mutex))
 		return 0;
 
+	scan_start = ktime_get();
+
 #ifdef CONFIG_LOWMEM_NOTIFY_KOBJ
 	lowmem_notif_sc.gfp_mask = sc->gfp_mask;
 	if (get_free_ram(&other_free, &other_file_orig, &other_file, sc)) {
@@ -666,6 +677,18 @@ static unsigned long lowmem_scan(struct shrinker *s, struct shrink_control *sc)
 		if (pressure > 0 && strstr(tsk->comm, "decTestProcess"))
 			continue;
 
+		/* workaround for antutu */
+		if (strstr("com.antutu.benchmark.full", tsk->comm))
+			has_antutu_3D = true;
+
+		/*
+		 * Most tasks are below the kill level; the signal struct is
+		 * shared by the whole group and stays valid under rcu, so
+		 * they are skipped before any task lock is taken.
+		 */
+		if (READ_ONCE(tsk->signal->oom_score_adj) < min_score_adj)
+			continue;
+
 		p = find_lock_task_mm(tsk);
 		if (!p)
 			continue;
@@ -677,10 +700,6 @@ static unsigned long lowmem_scan(struct shrinker *s, struct shrink_control *sc)
 			continue;
 		}
 
-		/* workaround for antutu */
-		if (strstr("com.antutu.benchmark.full", p->comm))
-			has_antutu_3D = true;
-
 		oom_score_adj = p->signal->oom_score_adj;
 		if (oom_score_adj < min_score_adj) {
 			task_unlock(p);
@@ -756,13 +775,20 @@ static unsigned long lowmem_scan(struct shrinker *s, struct shrink_control *sc)
 		if (selected->mm)
 			mark_oom_victim(selected);
 		task_unlock(selected);
+
+		scan_us = ktime_us_delta(ktime_get(), scan_start);
+		lowmem_kill_count++;
+		lowmem_kill_scan_us_last = scan_us;
+		lowmem_kill_scan_us_max = max(lowmem_kill_scan_us_max, scan_us);
+		lowmem_kill_scan_us_total += scan_us;
+
 		trace_lowmemory_kill(selected, cache_size, cache_limit, free);
 		lowmem_print(1, "Killing '%s' (%d:%d), adj %hd,\n"
 			"   to free %ldkB on behalf of '%s' (%d) because\n"
 			"   cache is %ldkB , limit is %ldkB for oom_score_adj %hd\n"
 			"   Free memory is %ldkB above reserved\n"
 			"   swaptotal is %ldkB, swapfree is %ldkB, pressure is %d\n"
-			"   cache_orig is %ldkB\n",
+			"   cache_orig is %ldkB, selected in %uus\n",
 			     selected->comm, selected->pid, selected->tgid,
 			     selected_oom_score_adj,
 			     selected_tasksize * (long)(PAGE_SIZE / 1024),
@@ -771,7 +797,7 @@ static unsigned long lowmem_scan(struct shrinker *s, struct shrink_control *sc)
 			     min_score_adj, free,
 			     si.totalswap * (long)(PAGE_SIZE / 1024),
 			     si.freeswap * (long)(PAGE_SIZE / 1024),
-			     pressure, cache_size_orig);
+			     pressure, cache_size_orig, scan_us);
 		lowmem_deathpending_timeout = jiffies + HZ;
 		rem += selected_tasksize;
 		trace_almk_shrink(selected_tasksize, ret,
@@ -1317,6 +1343,12 @@ module_param_array_named(adj, lowmem_adj, short, &lowmem_adj_size,
 module_param_array_named(minfree, lowmem_minfree, uint, &lowmem_minfree_size,
 			 S_IRUGO | S_IWUSR);
 module_param_named(debug_level, lowmem_debug_level, uint, S_IRUGO | S_IWUSR);
+module_param_named(kill_count, lowmem_kill_count, uint, S_IRUGO);
+module_param_named(kill_scan_us_last, lowmem_kill_scan_us_last, uint, S_IRUGO);
+module_param_named(kill_scan_us_max, lowmem_kill_scan_us_max, uint,
+		   S_IRUGO | S_IWUSR);
+module_param_named(kill_scan_us_total, lowmem_kill_scan_us_total, ullong,
+		   S_IRUGO);
 module_param_named(lmk_fast_run, lmk_fast_run, int, S_IRUGO | S_IWUSR);
 #ifdef CONFIG_E_SHOW_MEM
 module_param_named(proc_name, lowmem_proc_name, charp, S_IRUGO | S_IWUSR);
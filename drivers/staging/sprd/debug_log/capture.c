@@ -0,0 +1,393 @@
+/*
+ * Copyright (C) 2019 Spreadtrum Communications Inc.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * AP side capture of the debug log stream: the selected channel is
+ * drained by a cyclic link-list dma from the serdes capture fifo into a
+ * ring, one timestamp per period, and the ring is mmapped read only by
+ * /dev/dbg_log_capture.
+ */
+
+#include <linux/dma-mapping.h>
+#include <linux/dmaengine.h>
+#include <linux/dma/sprd-dma.h>
+#include <linux/fs.h>
+#include <linux/miscdevice.h>
+#include <linux/module.h>
+#include <linux/of.h>
+#include <linux/poll.h>
+#include <linux/scatterlist.h>
+#include <linux/slab.h>
+#include <linux/timekeeping.h>
+
+#include "core.h"
+#include "capture.h"
+
+#define DBG_CAP_MAX_PERIODS						\
+	((PAGE_SIZE - sizeof(struct dbg_log_capture_page)) /		\
+	 sizeof(struct dbg_log_capture_period))
+#define DBG_CAP_DEF_BURST	64
+
+/* ring and period size in KB, taken when the ring is first allocated */
+static unsigned int capture_kb = 4096;
+module_param(capture_kb, uint, 0644);
+static unsigned int period_kb = 64;
+module_param(period_kb, uint, 0644);
+
+struct dbg_log_capture {
+	struct dbg_log_device *dbg;
+	struct device *dev;	/* owns the dma memory */
+	struct miscdevice misc;
+	struct mutex lock;
+	wait_queue_head_t wait;
+	struct dma_chan *chan;
+	phys_addr_t fifo;
+	u32 req_id;
+	u32 burst;
+	bool running;
+
+	void *buf;
+	dma_addr_t buf_dma;
+	size_t buf_size;
+	struct dbg_log_capture_page *page;
+	void *ll_virt;
+	dma_addr_t ll_dma;
+	struct scatterlist *sg;
+	u32 nr_periods;
+	u32 period_size;
+};
+
+static void dbg_cap_period_done(void *data)
+{
+	struct dbg_log_capture *cap = data;
+	struct dbg_log_capture_page *page = cap->page;
+	u64 seq = page->head;
+	struct dbg_log_capture_period *p = &page->period[seq % cap->nr_periods];
+
+	p->ts_ns = ktime_get_ns();
+	/* the dma is already filling the next slot, retire what it held */
+	WRITE_ONCE(page->period[(seq + 1) % cap->nr_periods].seq, U64_MAX);
+	smp_wmb();
+	WRITE_ONCE(p->seq, seq);
+	smp_wmb();
+	WRITE_ONCE(page->head, seq + 1);
+
+	wake_up_interruptible(&cap->wait);
+}
+
+static int dbg_cap_alloc(struct dbg_log_capture *cap)
+{
+	u32 period = PAGE_ALIGN(period_kb * 1024);
+	u32 nr = capture_kb * 1024 / (period ? period : 1);
+	struct scatterlist *sg;
+	int i;
+
+	if (cap->buf)
+		return 0;
+
+	nr = min_t(u32, nr, DBG_CAP_MAX_PERIODS);
+	/* the link-list mode needs at least two configurations */
+	if (!period || nr < 2)
+		return -EINVAL;
+
+	cap->buf_size = PAGE_SIZE + (size_t)nr * period;
+	cap->buf = dmam_alloc_coherent(cap->dev, cap->buf_size, &cap->buf_dma,
+				       GFP_KERNEL);
+	if (!cap->buf)
+		return -ENOMEM;
+
+	cap->ll_virt = dmam_alloc_coherent(cap->dev,
+					   nr * SPRD_DMA_LINKLIST_NODE_SIZE,
+					   &cap->ll_dma, GFP_KERNEL);
+	cap->sg = devm_kcalloc(cap->dev, nr, sizeof(*sg), GFP_KERNEL);
+	if (!cap->ll_virt || !cap->sg) {
+		dmam_free_coherent(cap->dev, cap->buf_size, cap->buf,
+				   cap->buf_dma);
+		cap->buf = NULL;
+		return -ENOMEM;
+	}
+
+	sg_init_table(cap->sg, nr);
+	for_each_sg(cap->sg, sg, nr, i) {
+		sg_dma_address(sg) = cap->buf_dma + PAGE_SIZE +
+				     (dma_addr_t)i * period;
+		sg_dma_len(sg) = period;
+	}
+
+	cap->page = cap->buf;
+	cap->nr_periods = nr;
+	cap->period_size = period;
+
+	return 0;
+}
+
+static int dbg_cap_start(struct dbg_log_capture *cap)
+{
+	struct dbg_log_capture_page *page;
+	struct dma_async_tx_descriptor *desc;
+	struct dma_slave_config cfg = { };
+	struct sprd_dma_linklist ll = { };
+	unsigned long flags;
+	int i, ret;
+
+	if (cap->running)
+		return 0;
+
+	/* the serdes only feeds the fifo while a channel is selected */
+	if (cap->dbg->channel == CH_DISABLE)
+		return -EINVAL;
+
+	ret = dbg_cap_alloc(cap);
+	if (ret)
+		return ret;
+
+	page = cap->page;
+	page->magic = DBG_CAP_MAGIC;
+	page->version = DBG_CAP_VERSION;
+	page->data_offset = PAGE_SIZE;
+	page->period_size = cap->period_size;
+	page->nr_periods = cap->nr_periods;
+	page->channel = cap->dbg->channel;
+	page->head = 0;
+	for (i = 0; i < cap->nr_periods; i++)
+		page->period[i].seq = U64_MAX;
+
+	cfg.direction = DMA_DEV_TO_MEM;
+	cfg.src_addr = cap->fifo;
+	cfg.src_addr_width = DMA_SLAVE_BUSWIDTH_4_BYTES;
+	cfg.dst_addr_width = DMA_SLAVE_BUSWIDTH_4_BYTES;
+	cfg.src_maxburst = cap->burst;
+	cfg.slave_id = cap->req_id;
+	ret = dmaengine_slave_config(cap->chan, &cfg);
+	if (ret)
+		return ret;
+
+	ll.virt_addr = (unsigned long)cap->ll_virt;
+	ll.phy_addr = cap->ll_dma;
+	flags = SPRD_DMA_FLAGS(SPRD_DMA_CHN_MODE_NONE, SPRD_DMA_NO_TRG,
+			       SPRD_DMA_FRAG_REQ, SPRD_DMA_TRANS_INT);
+	desc = cap->chan->device->device_prep_slave_sg(cap->chan, cap->sg,
+						       cap->nr_periods,
+						       DMA_DEV_TO_MEM, flags,
+						       &ll);
+	if (!desc)
+		return -EINVAL;
+
+	desc->callback = dbg_cap_period_done;
+	desc->callback_param = cap;
+	dmaengine_submit(desc);
+	dma_async_issue_pending(cap->chan);
+	cap->running = true;
+
+	DEBUG_LOG_PRINT("capture %u x %u bytes from channel %u\n",
+			cap->nr_periods, cap->period_size, page->channel);
+	return 0;
+}
+
+static void dbg_cap_stop_locked(struct dbg_log_capture *cap)
+{
+	if (!cap->running)
+		return;
+
+	dmaengine_terminate_sync(cap->chan);
+	cap->running = false;
+	wake_up_interruptible(&cap->wait);
+}
+
+void dbg_log_capture_stop(struct dbg_log_device *dbg)
+{
+	struct dbg_log_capture *cap = dbg->capture;
+
+	if (!cap)
+		return;
+
+	mutex_lock(&cap->lock);
+	dbg_cap_stop_locked(cap);
+	mutex_unlock(&cap->lock);
+}
+
+static ssize_t capture_show(struct device *dev,
+			    struct device_attribute *attr, char *buf)
+{
+	struct dbg_log_device *dbg = dev_get_drvdata(dev);
+	struct dbg_log_capture *cap = dbg->capture;
+
+	return snprintf(buf, PAGE_SIZE, "%d periods %u x %u head %llu\n",
+			cap->running, cap->nr_periods, cap->period_size,
+			cap->page ? READ_ONCE(cap->page->head) : 0);
+}
+
+static ssize_t capture_store(struct device *dev,
+			     struct device_attribute *attr,
+			     const char *buf, size_t count)
+{
+	struct dbg_log_device *dbg = dev_get_drvdata(dev);
+	struct dbg_log_capture *cap = dbg->capture;
+	bool enable;
+	int ret;
+
+	if (strtobool(buf, &enable))
+		return -EINVAL;
+
+	mutex_lock(&cap->lock);
+	if (enable) {
+		ret = dbg_cap_start(cap);
+	} else {
+		dbg_cap_stop_locked(cap);
+		ret = 0;
+	}
+	mutex_unlock(&cap->lock);
+
+	return ret ? ret : count;
+}
+
+static DEVICE_ATTR_RW(capture);
+
+struct dbg_cap_file {
+	struct dbg_log_capture *cap;
+	u64 seen;	/* head at the last poll */
+};
+
+static int dbg_cap_open(struct inode *inode, struct file *file)
+{
+	/* misc_open() left our miscdevice here */
+	struct miscdevice *misc = file->private_data;
+	struct dbg_cap_file *cf;
+
+	cf = kzalloc(sizeof(*cf), GFP_KERNEL);
+	if (!cf)
+		return -ENOMEM;
+
+	cf->cap = container_of(misc, struct dbg_log_capture, misc);
+	file->private_data = cf;
+	return nonseekable_open(inode, file);
+}
+
+static int dbg_cap_release(struct inode *inode, struct file *file)
+{
+	kfree(file->private_data);
+	return 0;
+}
+
+static int dbg_cap_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct dbg_cap_file *cf = file->private_data;
+	struct dbg_log_capture *cap = cf->cap;
+	size_t len = vma->vm_end - vma->vm_start;
+	int ret;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	mutex_lock(&cap->lock);
+	if (!cap->buf)
+		ret = -ENODATA;
+	else if (vma->vm_pgoff || len > PAGE_ALIGN(cap->buf_size))
+		ret = -EINVAL;
+	else
+		ret = dma_mmap_coherent(cap->dev, vma, cap->buf, cap->buf_dma,
+					cap->buf_size);
+	mutex_unlock(&cap->lock);
+
+	return ret;
+}
+
+/* readable whenever a period was completed since the last poll */
+static unsigned int dbg_cap_poll(struct file *file, poll_table *wait)
+{
+	struct dbg_cap_file *cf = file->private_data;
+	struct dbg_log_capture *cap = cf->cap;
+	u64 head;
+
+	poll_wait(file, &cap->wait, wait);
+
+	if (!cap->page)
+		return 0;
+
+	head = READ_ONCE(cap->page->head);
+	if (head != cf->seen) {
+		cf->seen = head;
+		return POLLIN | POLLRDNORM;
+	}
+
+	return cap->running ? 0 : POLLHUP;
+}
+
+static const struct file_operations dbg_cap_fops = {
+	.owner = THIS_MODULE,
+	.open = dbg_cap_open,
+	.release = dbg_cap_release,
+	.mmap = dbg_cap_mmap,
+	.poll = dbg_cap_poll,
+	.llseek = no_llseek,
+};
+
+/*
+ * Optional, the parent node describes the capture path with
+ * dma-names = "capture", sprd,capture-fifo = <fifo physical address>,
+ * sprd,capture-req = <dma request id> and optionally
+ * sprd,capture-burst = <bytes per dma request>.
+ */
+int dbg_log_capture_init(struct dbg_log_device *dbg)
+{
+	struct device *parent = dbg->dev.parent;
+	struct device_node *np = parent->of_node;
+	struct dbg_log_capture *cap;
+	u32 fifo;
+	int ret;
+
+	if (!np || of_property_read_u32(np, "sprd,capture-fifo", &fifo))
+		return 0;
+
+	cap = devm_kzalloc(parent, sizeof(*cap), GFP_KERNEL);
+	if (!cap)
+		return -ENOMEM;
+
+	cap->chan = dma_request_chan(parent, "capture");
+	if (IS_ERR(cap->chan)) {
+		ret = PTR_ERR(cap->chan);
+		if (ret != -EPROBE_DEFER)
+			pr_err("no capture dma channel, ret=%d\n", ret);
+		return ret;
+	}
+
+	cap->dbg = dbg;
+	cap->dev = parent;
+	cap->fifo = fifo;
+	of_property_read_u32(np, "sprd,capture-req", &cap->req_id);
+	cap->burst = DBG_CAP_DEF_BURST;
+	of_property_read_u32(np, "sprd,capture-burst", &cap->burst);
+	mutex_init(&cap->lock);
+	init_waitqueue_head(&cap->wait);
+
+	cap->misc.minor = MISC_DYNAMIC_MINOR;
+	cap->misc.name = "dbg_log_capture";
+	cap->misc.fops = &dbg_cap_fops;
+	cap->misc.parent = &dbg->dev;
+	ret = misc_register(&cap->misc);
+	if (ret)
+		goto err_chan;
+
+	dbg->capture = cap;
+	ret = device_create_file(&dbg->dev, &dev_attr_capture);
+	if (ret)
+		goto err_misc;
+
+	return 0;
+
+err_misc:
+	dbg->capture = NULL;
+	misc_deregister(&cap->misc);
+err_chan:
+	dma_release_channel(cap->chan);
+	return ret;
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2019 Spreadtrum Communications Inc.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#ifndef __DBG_LOG_CAPTURE_H__
+#define __DBG_LOG_CAPTURE_H__
+
+#include <linux/types.h>
+
+#define DBG_CAP_MAGIC		0x44424743	/* "DBGC" */
+#define DBG_CAP_VERSION		1
+
+struct dbg_log_capture_period {
+	u64 seq;
+	u64 ts_ns;	/* CLOCK_MONOTONIC when the period was completed */
+};
+
+/*
+ * First page of the capture mmap, the ring of periods follows at
+ * data_offset. Period seq lives at data_offset + (seq % nr_periods) *
+ * period_size and is valid while period[seq % nr_periods].seq == seq,
+ * read head, then the data, then check the seq again. The dma never
+ * stops for a slow reader, it overwrites the oldest period, and the one
+ * after head is retired only once head moves, so stay clear of the
+ * oldest two.
+ */
+struct dbg_log_capture_page {
+	u32 magic;
+	u32 version;
+	u32 data_offset;
+	u32 period_size;
+	u32 nr_periods;
+	u32 channel;	/* the debug log channel being captured */
+	u64 head;	/* number of periods completed since start */
+	struct dbg_log_capture_period period[0];
+};
+
+struct dbg_log_device;
+
+#ifdef CONFIG_SPRD_DEBUG_LOG_CAPTURE
+int dbg_log_capture_init(struct dbg_log_device *dbg);
+void dbg_log_capture_stop(struct dbg_log_device *dbg);
+#else
+static inline int dbg_log_capture_init(struct dbg_log_device *dbg)
+{
+	return 0;
+}
+
+static inline void dbg_log_capture_stop(struct dbg_log_device *dbg) { }
+#endif
+
+#endif
@@ -56,6 +56,7 @@ void dbg_log_channel_sel(struct dbg_log_device *dbg)
 		dbg_log_init(dbg);
 		dbg->ops->select(dbg);
 	} else {
+		dbg_log_capture_stop(dbg);
 		dbg->ops->select(dbg);
 		dbg_log_exit(dbg);
 	}
@@ -132,6 +133,10 @@ struct dbg_log_device *dbg_log_device_register(struct device *parent,
 		goto phy_free;
 	}
 
+	/* the log still goes out through the phy without a capture path */
+	if (dbg_log_capture_init(dbg))
+		dev_warn(&dbg->dev, "AP side capture not available\n");
+
 	return dbg;
 
 phy_free:
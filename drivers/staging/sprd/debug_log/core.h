@@ -22,6 +22,7 @@
 #include <linux/regmap.h>
 #include <linux/slab.h>
 
+#include "capture.h"
 #include "serdes.h"
 
 #ifdef pr_fmt
@@ -49,6 +50,7 @@ enum channel_en {
 extern const char *ch_str[];
 
 struct dbg_log_device;
+struct dbg_log_capture;
 struct serdes_drv_data;
 
 struct dbg_log_ops {
@@ -81,6 +83,7 @@ struct dbg_log_device {
 	int serdes_id;
 	struct regmap *aon_apb;
 	struct serdes_drv_data serdes;
+	struct dbg_log_capture *capture;
 	struct clk *clk_serdes_eb;
 	struct clk *clk_mm_eb;
 	struct clk *clk_ana_eb;
@@ -70,12 +70,35 @@ static void mbox_put1msg(u8 dst, u64 msg)
 	g_inptr[dst] = wt + 1;
 }
 
+/*
+ * Send what is queued for dst while its inbox takes it, mbox_lock held.
+ * Returns true if nothing is left in the queue.
+ */
+static bool mbox_flush_fifo(u8 dst)
+{
+	u16 rd, pos;
+	u64 msg;
+
+	rd = g_outptr[dst];
+	while (g_inptr[dst] != rd) {
+		pos = rd % SEND_FIFO_LEN;
+		msg = g_send_fifo[dst][pos];
+
+		if (mbox_ops->fops->phy_send(dst, msg) != 0)
+			/* one send failed, than next */
+			return false;
+
+		rd += 1;
+		g_outptr[dst] = rd;
+	}
+
+	return true;
+}
+
 static int mbox_send_thread(void *pdata)
 {
 	unsigned long flag;
 	u8 dst;
-	u16 rd, pos;
-	u64 msg;
 
 	pr_debug("mbox:%s!\n", __func__);
 
@@ -91,18 +114,7 @@ static int mbox_send_thread(void *pdata)
 			if (!(g_inbox_send & (1 << dst)))
 				continue;
 
-			rd = g_outptr[dst];
-			while (g_inptr[dst] != rd) {
-				pos = rd % SEND_FIFO_LEN;
-				msg = g_send_fifo[dst][pos];
-
-				if (mbox_ops->fops->phy_send(dst, msg) != 0)
-					/* one send failed, than next */
-					break;
-
-				rd += 1;
-				g_outptr[dst] = rd;
-			}
+			mbox_flush_fifo(dst);
 		}
 
 		g_inbox_send = 0;
@@ -219,10 +231,10 @@ int mbox_raw_sent(u8 core_id, u64 msg)
 
 	spin_lock_irqsave(&mbox_lock, flag);
 
-	/* if fifo is not empty, put it into the fifo,
+	/* if the queued msgs can't all be sent now, queue this one too,
 	 * else if send failed , also put it into the fifo
 	 */
-	if (g_inptr[core_id] != g_outptr[core_id])
+	if (!mbox_flush_fifo(core_id))
 		mbox_put1msg(core_id, msg);
 	else if (mbox_ops->fops->phy_send(core_id, msg) != 0)
 		mbox_put1msg(core_id, msg);
@@ -233,6 +245,56 @@ int mbox_raw_sent(u8 core_id, u64 msg)
 }
 EXPORT_SYMBOL_GPL(mbox_raw_sent);
 
+/**
+ * mbox_raw_sent_batch() - send several msgs to one core
+ * @core_id: destination core
+ * @msg: the msgs, in the order they are to arrive
+ * @cnt: number of msgs
+ *
+ * Same as cnt calls of mbox_raw_sent() but under one lock: once the
+ * inbox refuses a msg, the rest goes to the send queue without trying
+ * the hardware for each of them.
+ *
+ * Returns: number of msgs sent or queued, less than cnt if the queue ran
+ *	full, negative on error
+ */
+int mbox_raw_sent_batch(u8 core_id, const u64 *msg, int cnt)
+{
+	unsigned long flag;
+	bool room;
+	u16 wt;
+	int i;
+
+	if (!g_mbox_inited) {
+		pr_err("mbox:ERR on line %d!\n", __LINE__);
+		return -EINVAL;
+	}
+
+	if (core_id >= mbox_ops->max_cnt) {
+		pr_err("mbox:ERR core_id = %d!\n", core_id);
+		return -EINVAL;
+	}
+
+	spin_lock_irqsave(&mbox_lock, flag);
+
+	room = mbox_flush_fifo(core_id);
+	for (i = 0; i < cnt; i++) {
+		if (room && mbox_ops->fops->phy_send(core_id, msg[i]) == 0)
+			continue;
+
+		room = false;
+		wt = g_inptr[core_id];
+		mbox_put1msg(core_id, msg[i]);
+		if (g_inptr[core_id] == wt)
+			break;
+	}
+
+	spin_unlock_irqrestore(&mbox_lock, flag);
+
+	return i;
+}
+EXPORT_SYMBOL_GPL(mbox_raw_sent_batch);
+
 void mbox_just_sent(u8 core_id, u64 msg)
 {
 	mbox_ops->fops->phy_just_sent(core_id, msg);
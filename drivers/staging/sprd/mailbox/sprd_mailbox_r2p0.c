@@ -112,6 +112,7 @@
 #define MBOX_MAX_CORE_CNT	16
 #define MBOX_MAX_CORE_MASK	0xF
 #define MAX_SMSG_BAK		64
+#define MBOX_RECV_POLL_ROUNDS	4
 
 /*
  * mbox configs define: now we had two hardware version V1 and
@@ -192,6 +193,7 @@ static int g_restore_cnt;
 static int g_inbox_block_cnt;
 static int g_outbox_full_cnt;
 static int g_skip_msg;
+static int g_recv_poll_cnt;
 static unsigned int g_recv_cnt[MBOX_MAX_CORE_CNT];
 static unsigned int g_send_cnt[MBOX_MAX_CORE_CNT];
 
@@ -201,6 +203,27 @@ static struct mbox_cfg_tag mbox_cfg;
 extern int sipc_get_wakeup_flag(void);
 extern void sipc_clear_wakeup_flag(void);
 
+/*
+ * During a burst the peer keeps writing while the mails are dispatched,
+ * so the outbox is read again up to recv_poll_rounds times before the
+ * irq returns, instead of taking one irq for each few mails. 1 turns it
+ * off.
+ */
+static uint recv_poll_rounds = MBOX_RECV_POLL_ROUNDS;
+module_param(recv_poll_rounds, uint, 0644);
+
+static bool mbox_outbox_pending(void)
+{
+	u32 fifo_sts;
+
+	fifo_sts = readl_relaxed(
+		(void __iomem *)(sprd_outbox_base + MBOX_FIFO_INBOX_STS_1));
+
+	return MBOX_GET_FIFO_WR_PTR(fifo_sts) !=
+		MBOX_GET_FIFO_RD_PTR(fifo_sts) ||
+		(fifo_sts & MBOX_FIFO_FULL_STS_MASK);
+}
+
 static irqreturn_t  mbox_src_irqhandle(int irq_num, void *dev)
 {
 	u32 fifo_sts_1, fifo_sts_2;
@@ -264,9 +287,11 @@ static irqreturn_t mbox_recv_irqhandle(int irq_num, void *dev)
 	u8 target_id;
 	u8 fifo_len;
 	unsigned long jiff, jiff_total;
+	uint round = 0;
 
 	jiff_total = jiffies;
 
+poll:
 	/* get fifo status */
 	fifo_sts_1 = readl_relaxed(
 		(void __iomem *)(sprd_outbox_base + MBOX_FIFO_OUTBOX_STS_1));
@@ -286,7 +311,7 @@ static irqreturn_t mbox_recv_irqhandle(int irq_num, void *dev)
 		     (void __iomem *)(sprd_outbox_base + MBOX_IRQ_STS));
 
 	/* print the id of the fist mail to know who wake up ap */
-	if (sipc_get_wakeup_flag())
+	if (!round && sipc_get_wakeup_flag())
 		pr_debug("mbox: wake up by id = %d\n",
 			mbox_fifo[0].core_id);
 
@@ -325,6 +350,12 @@ static irqreturn_t mbox_recv_irqhandle(int irq_num, void *dev)
 		}
 	}
 
+	/* mails which came in meanwhile, without waiting for their irq */
+	if (++round < READ_ONCE(recv_poll_rounds) && mbox_outbox_pending()) {
+		g_recv_poll_cnt++;
+		goto poll;
+	}
+
 	if (sipc_get_wakeup_flag())
 		sipc_clear_wakeup_flag();
 
@@ -1005,8 +1036,10 @@ static int mbox_debug_show(struct seq_file *m, void *private)
 		   g_outbox_full_cnt, g_skip_msg);
 	seq_printf(m, "    max_total_irq_time: %lu\n",
 		   max_total_irq_proc_time);
-	seq_printf(m, "    max_total_irq_cnt: %lu\n\n",
+	seq_printf(m, "    max_total_irq_cnt: %lu\n",
 		   max_total_irq_cnt);
+	seq_printf(m, "    recv_poll_cnt: %d\n\n",
+		   g_recv_poll_cnt);
 
 	for (i = 0; i < mbox_cfg.core_cnt; i++) {
 		if (mbox_chns[i].mbox_smsg_handler)
@@ -16,6 +16,7 @@
 /* Includes */
 #include <linux/kernel.h>
 #include <linux/timer.h>
+#include <linux/workqueue.h>
 #include <linux/ip.h>
 #include <net/tcp.h>
 #include <net/udp.h>
@@ -26,9 +27,12 @@
 #include <linux/jhash.h>
 #include <linux/atomic.h>
 #include <linux/netdevice.h>
+#include <linux/percpu.h>
+#include <linux/rhashtable.h>
 #include <net/sfp.h>
 #include <linux/sipa.h>
 #include "sfp_hash.h"
+#include "sfp_stats.h"
 
 #define SFP_OK		0x00  /* Operation succeeded */
 #define SFP_FAIL		0x01   /* Operation failed */
@@ -154,6 +158,14 @@ struct sfp_trans_tuple {
 	u8 out_ipaifindex;
 };
 
+/* fwd_flags: the original direction leaves translated by sfp_clat */
+#define SFP_FWD_FLAG_CLAT		BIT(7)
+
+struct sfp_clat_addr {
+	struct in6_addr v6_addr;
+	struct in6_addr plat_prefix;
+};
+
 struct sfp_mgr_fwd_tuple {
 	struct mac_info orig_mac_info;
 	struct mac_info trans_mac_info;
@@ -171,10 +183,21 @@ struct sfp_mgr_fwd_tuple {
 	u8 fwd_flags;
 };
 
+/*
+ * The software fast path keeps its entries in the resizable sfp_fwd_rht
+ * and counts hits per cpu, so a lookup never writes a shared cache line.
+ * The ipa scheme links the same entries into the fixed fwd_tbl buckets
+ * which mirror the hardware hash table, it uses entry_lst and no pcpu
+ * counters.
+ */
 struct sfp_fwd_entry {
 	struct hlist_node entry_lst;
+	struct rhash_head node;
 	struct nf_conntrack_tuple tuple;
 	struct sfp_trans_tuple ssfp_trans_tuple;
+	u32 __percpu *pcpu_count;
+	/* egress device, held until the entry is freed */
+	struct net_device *out_dev;
 	struct rcu_head	 rcu;
 	struct sfp_conn *sfp_ct;
 };
@@ -213,8 +236,10 @@ struct sfp_conn {
 	unsigned int insert_flag;
 	unsigned int fin_rst_flag;
 	unsigned int tcp_sure_flag;
-	/* Timer function; drops refcnt when it goes off. */
-	struct timer_list timeout;
+	/* Deadline in jiffies, expired by the manager aging work */
+	unsigned long expires;
+	/* On fwd_tbl.lru_list while offloaded to the ipa hash table */
+	struct list_head ipa_lru;
 	u32 ts;
 	int expire;
 };
@@ -247,6 +272,12 @@ struct sfpfwd_iter_state {
 	int count;
 };
 
+struct sfp_fwd_walk_state {
+	struct rhashtable_iter hti;
+	bool walking;
+	int count;
+};
+
 enum {
 	T0 = 0,
 	T1 = 1,
@@ -284,6 +315,10 @@ struct sfp_fwd_hash_tbl {
 	u32 hash_lst[IP_CT_DIR_MAX];
 	struct sfp_ipa_tbl_mgr ipa_tbl_mgr;
 	struct timer_list recycle_timer;
+	/* Offloaded connections, the least recently active first */
+	struct list_head lru_list;
+	u32 evict_cnt;
+	struct delayed_work sync_work;
 	struct hlist_head sfp_fwd_entries[SFP_ENTRIES_HASH_SIZE];
 };
 
@@ -340,7 +375,7 @@ extern unsigned int fp_dbg_lvl;
 #define NIP6_SEQFMT "%04x%04x%04x%04x%04x%04x%04x%04x"
 
 extern struct hlist_head mgr_fwd_entries[SFP_ENTRIES_HASH_SIZE];
-extern struct hlist_head sfp_fwd_entries[SFP_ENTRIES_HASH_SIZE];
+extern struct rhashtable sfp_fwd_rht;
 extern struct sfp_ipa_tbl_mgr ipa_tbl_mgr;
 extern struct net init_net;
 extern int sysctl_net_sfp_enable;
@@ -353,6 +388,8 @@ extern struct sfp_fwd_hash_tbl fwd_tbl;
 #ifdef CONFIG_SPRD_SFP_TEST
 int sfp_test_init(int count);
 extern int test_count;
+int sfp_bench_run(u32 flows, u32 pkts, u32 cpus, u32 miss_pct);
+void sfp_bench_show(struct seq_file *seq);
 #endif
 
 /* Copy 6 bytes. Warning - doesn't perform any checks on memory, just copies */
@@ -498,7 +535,9 @@ void sfp_fwd_entry_table_clear(void);
 int  sfp_fwd_entry_delete(u32 src_ip, u32 dst_ip,
 			  u16 src_port, u16 dst_port, u8 proto);
 int check_sfp_fwd_table(struct nf_conntrack_tuple *tuple,
-			struct sfp_trans_tuple *ret_info);
+			struct sfp_trans_tuple *ret_info,
+			struct net_device **out_dev);
+void sfp_fwd_table_flush_dev(struct net_device *dev);
 bool sfp_pkt_to_tuple(void *data,
 		      u32 offset,
 		      struct nf_conntrack_tuple *tuple,
@@ -517,10 +556,14 @@ int add_in_sfp_fwd_table(
 void sfp_fwd_hash_add(struct sfp_conn *sfp_ct);
 void sfp_ipa_init(void);
 int get_sfp_fwd_entry_count(struct sfp_mgr_fwd_tuple_hash *fwd_hash_entry);
+u32 sfp_fwd_entry_count(const struct sfp_fwd_entry *entry);
+int sfp_fwd_table_init(void);
 int delete_in_sfp_fwd_table(
 	const struct sfp_mgr_fwd_tuple_hash *fwd_hash_entry);
 void clear_sfp_fwd_table(void);
 int sfp_sync_with_nfl_ct(const struct nf_conntrack_tuple *tuple);
+int sfp_refresh_nfl_ct(const struct nf_conntrack_tuple *tuple,
+		       unsigned long extra_jiffies);
 int nf_sfp_conntrack_init(void);
 bool sfp_ipa_tbl_timeout(struct sfp_conn *sfp_ct);
 void sfp_ipa_swap_tbl_new(void);
@@ -528,6 +571,7 @@ void ipa_tbl_check(void);
 
 int sfp_ct_init(struct nf_conn *ct, struct sfp_conn *sfp_ct);
 void clear_sfp_mgr_table(void);
+int sfp_mgr_age(void);
 void print_hash_tbl(char *p, int len);
 
 int sfp_ipa_fwd_add(enum ip_conntrack_dir dir, struct sfp_conn *sfp_ct);
@@ -541,4 +585,24 @@ int sfp_tbl_id(void);
 bool is_banned_ipa_netdev(struct net_device *dev);
 
 u32 hash_conntrack(const struct nf_conntrack_tuple *tuple);
+
+int sfp_clat_v6_ifindex(const struct net_device *dev);
+bool sfp_clat_in_tuple(const struct sk_buff *skb,
+		       struct nf_conntrack_tuple *tuple);
+void sfp_clat_6to4(struct sk_buff *skb,
+		   const struct nf_conntrack_tuple *tuple);
+int sfp_clat_out_prepare(struct sk_buff *skb,
+			 const struct net_device *out_dev,
+			 struct sfp_clat_addr *addr);
+void sfp_clat_4to6(struct sk_buff *skb, const struct sfp_clat_addr *addr);
+int sfp_clat_init(void);
+void sfp_clat_exit(void);
+extern const struct file_operations sfp_clat_proc_fops;
+
+void sfp_stats_hit(int in_ifindex, int out_ifindex, unsigned int len);
+void sfp_stats_miss(void);
+void sfp_stats_fallback(enum sfp_stats_fallback reason);
+void sfp_stats_lookup(u64 ns);
+int sfp_stats_init(void);
+void sfp_stats_exit(void);
 #endif
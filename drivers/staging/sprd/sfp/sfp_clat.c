@@ -0,0 +1,454 @@
+/*
+ * Copyright (C) 2019 Spreadtrum Communications Inc.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Stateless 464xlat translation for tethered flows through clatd.
+ *
+ * clatd owns a tun device, v4-<iface>, and translates between the ipv4
+ * packets on it and ipv6 packets on the underlying interface. A flow
+ * routed to the tun device is forwarded by sfp to the underlying
+ * interface instead: the original direction leaves as ipv6, the reply
+ * arrives as ipv6 and is translated back before the fast path lookup.
+ * Conntrack and the sfp entries stay ipv4, only the headers change, as
+ * RFC 7915 describes for the subset sfp forwards: tcp and udp without
+ * ipv4 options, fragments or ipv6 extension headers.
+ *
+ * clatd knows the addresses, it writes them to /proc/net/sfp/clat:
+ *	<v4 iface> <v6 iface> <v4 addr> <v6 addr> <plat prefix>
+ * the prefix is a /96. "-<v4 iface>" drops the translation again.
+ */
+
+#include <linux/kernel.h>
+#include <linux/types.h>
+#include <linux/netdevice.h>
+#include <linux/skbuff.h>
+#include <linux/inet.h>
+#include <linux/mutex.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/uaccess.h>
+#include <net/ip.h>
+#include <net/ipv6.h>
+#include <net/dsfield.h>
+
+#include "sfp.h"
+
+#define SFP_CLAT_MAX		4
+/* RFC 7915 5.1, smaller translated packets may be fragmented again */
+#define SFP_CLAT_DF_MIN		1260
+#define SFP_CLAT_HDR_DELTA	\
+	(sizeof(struct ipv6hdr) - sizeof(struct iphdr))
+
+struct sfp_clat {
+	char v4_name[IFNAMSIZ];
+	int v4_ifindex;
+	int v6_ifindex;
+	__be32 v4_addr;
+	struct in6_addr v6_addr;
+	struct in6_addr plat_prefix;
+	struct rcu_head rcu;
+};
+
+static struct sfp_clat __rcu *sfp_clat_tbl[SFP_CLAT_MAX];
+static DEFINE_MUTEX(sfp_clat_mutex);
+
+static bool sfp_clat_prefix_match(const struct sfp_clat *clat,
+				  const struct in6_addr *addr)
+{
+	return addr->s6_addr32[0] == clat->plat_prefix.s6_addr32[0] &&
+	       addr->s6_addr32[1] == clat->plat_prefix.s6_addr32[1] &&
+	       addr->s6_addr32[2] == clat->plat_prefix.s6_addr32[2];
+}
+
+/**
+ * sfp_clat_v6_ifindex() - underlying interface of a clatd tun device
+ * @dev: device the flow is routed to
+ *
+ * Return: the ifindex the translated packets use, 0 if clatd did not
+ * configure a translation for @dev.
+ */
+int sfp_clat_v6_ifindex(const struct net_device *dev)
+{
+	struct sfp_clat *clat;
+	int i, ifindex = 0;
+
+	rcu_read_lock();
+	for (i = 0; i < SFP_CLAT_MAX; i++) {
+		clat = rcu_dereference(sfp_clat_tbl[i]);
+		if (clat && clat->v4_ifindex == dev->ifindex) {
+			ifindex = clat->v6_ifindex;
+			break;
+		}
+	}
+	rcu_read_unlock();
+
+	return ifindex;
+}
+
+/**
+ * sfp_clat_in_tuple() - ipv4 tuple of an ipv6 packet sent to clatd
+ * @skb: packet received on the underlying interface
+ * @tuple: returns the tuple the packet has after translation
+ *
+ * Only the tuple is built, the packet stays untouched until the lookup
+ * found an entry and sfp_clat_6to4() is called.
+ */
+bool sfp_clat_in_tuple(const struct sk_buff *skb,
+		       struct nf_conntrack_tuple *tuple)
+{
+	const struct ipv6hdr *ip6h = ipv6_hdr(skb);
+	const struct tcphdr *th;
+	const __be16 *ports;
+	struct sfp_clat *clat;
+	bool ret = false;
+	int i;
+
+	if (ip6h->nexthdr != IPPROTO_TCP && ip6h->nexthdr != IPPROTO_UDP)
+		return false;
+
+	if (skb->len < sizeof(*ip6h) + (ip6h->nexthdr == IPPROTO_TCP ?
+					sizeof(struct tcphdr) :
+					sizeof(struct udphdr)))
+		return false;
+
+	/* fin and rst must reach clatd's conntrack, leave them to the stack */
+	if (ip6h->nexthdr == IPPROTO_TCP) {
+		th = (const struct tcphdr *)(ip6h + 1);
+		if (th->fin || th->rst)
+			return false;
+	}
+
+	rcu_read_lock();
+	for (i = 0; i < SFP_CLAT_MAX; i++) {
+		clat = rcu_dereference(sfp_clat_tbl[i]);
+		if (!clat || clat->v6_ifindex != skb->dev->ifindex ||
+		    !ipv6_addr_equal(&ip6h->daddr, &clat->v6_addr) ||
+		    !sfp_clat_prefix_match(clat, &ip6h->saddr))
+			continue;
+
+		ports = (const __be16 *)(ip6h + 1);
+		tuple->src.l3num = NFPROTO_IPV4;
+		tuple->src.u3.ip = ip6h->saddr.s6_addr32[3];
+		tuple->dst.u3.ip = clat->v4_addr;
+		tuple->src.u.all = ports[0];
+		tuple->dst.u.all = ports[1];
+		tuple->dst.protonum = ip6h->nexthdr;
+		tuple->dst.dir = IP_CT_DIR_ORIGINAL;
+		ret = true;
+		break;
+	}
+	rcu_read_unlock();
+
+	return ret;
+}
+
+/**
+ * sfp_clat_6to4() - replace the ipv6 header by an ipv4 one
+ * @skb: packet sfp_clat_in_tuple() accepted, data at the network header
+ * @tuple: tuple sfp_clat_in_tuple() returned
+ *
+ * The checksums are left to the caller, sfp recomputes them anyway.
+ */
+void sfp_clat_6to4(struct sk_buff *skb, const struct nf_conntrack_tuple *tuple)
+{
+	struct ipv6hdr ip6h = *ipv6_hdr(skb);
+	struct iphdr *iph;
+	u16 tot_len;
+
+	tot_len = ntohs(ip6h.payload_len) + sizeof(*iph);
+	skb_pull(skb, SFP_CLAT_HDR_DELTA);
+	skb_reset_network_header(skb);
+	skb->protocol = htons(ETH_P_IP);
+
+	iph = ip_hdr(skb);
+	iph->version = 4;
+	iph->ihl = sizeof(*iph) >> 2;
+	iph->tos = ipv6_get_dsfield(&ip6h);
+	iph->tot_len = htons(tot_len);
+	iph->frag_off = tot_len > SFP_CLAT_DF_MIN ? htons(IP_DF) : 0;
+	iph->ttl = ip6h.hop_limit;
+	iph->protocol = ip6h.nexthdr;
+	iph->check = 0;
+	iph->saddr = tuple->src.u3.ip;
+	iph->daddr = tuple->dst.u3.ip;
+	ip_select_ident(dev_net(skb->dev), skb, NULL);
+}
+
+/**
+ * sfp_clat_out_prepare() - check an ipv4 packet can leave as ipv6
+ * @skb: packet which hit a clat entry, data at the network header
+ * @out_dev: underlying interface
+ * @addr: returns the addresses for sfp_clat_4to6()
+ *
+ * Called before the packet is modified, a failure passes it unchanged
+ * to the stack and clatd.
+ */
+int sfp_clat_out_prepare(struct sk_buff *skb,
+			 const struct net_device *out_dev,
+			 struct sfp_clat_addr *addr)
+{
+	const struct iphdr *iph = ip_hdr(skb);
+	struct sfp_clat *clat;
+	int i, ret = -ENOENT;
+
+	if (iph->ihl != sizeof(*iph) >> 2 || ip_is_fragment(iph) ||
+	    skb_is_gso(skb))
+		return -EINVAL;
+
+	if (skb->len + SFP_CLAT_HDR_DELTA > out_dev->mtu)
+		return -EMSGSIZE;
+
+	rcu_read_lock();
+	for (i = 0; i < SFP_CLAT_MAX; i++) {
+		clat = rcu_dereference(sfp_clat_tbl[i]);
+		if (clat && clat->v6_ifindex == out_dev->ifindex) {
+			addr->v6_addr = clat->v6_addr;
+			addr->plat_prefix = clat->plat_prefix;
+			ret = 0;
+			break;
+		}
+	}
+	rcu_read_unlock();
+	if (ret)
+		return ret;
+
+	return skb_cow_head(skb, ETH_HLEN + SFP_CLAT_HDR_DELTA);
+}
+
+/**
+ * sfp_clat_4to6() - replace the ipv4 header by an ipv6 one
+ * @skb: packet with the sfp headers applied, data at the network header
+ * @addr: addresses from sfp_clat_out_prepare()
+ *
+ * The mac header in front of the ipv4 header moves along.
+ */
+void sfp_clat_4to6(struct sk_buff *skb, const struct sfp_clat_addr *addr)
+{
+	struct iphdr iph = *ip_hdr(skb);
+	struct ipv6hdr *ip6h;
+	u8 mac[ETH_ALEN * 2];
+	u8 *mac_head;
+
+	memcpy(mac, skb_network_header(skb) - ETH_HLEN, sizeof(mac));
+	skb_push(skb, SFP_CLAT_HDR_DELTA);
+	skb_reset_network_header(skb);
+	skb->protocol = htons(ETH_P_IPV6);
+
+	ip6h = ipv6_hdr(skb);
+	ip6_flow_hdr(ip6h, iph.tos, 0);
+	ip6h->payload_len = htons(ntohs(iph.tot_len) - sizeof(iph));
+	ip6h->nexthdr = iph.protocol;
+	ip6h->hop_limit = iph.ttl;
+	ip6h->saddr = addr->v6_addr;
+	ip6h->daddr = addr->plat_prefix;
+	ip6h->daddr.s6_addr32[3] = iph.daddr;
+
+	mac_head = skb_network_header(skb) - ETH_HLEN;
+	memcpy(mac_head, mac, sizeof(mac));
+	*((__be16 *)(mac_head + 12)) = htons(ETH_P_IPV6);
+}
+
+static void sfp_clat_free(struct sfp_clat *clat)
+{
+	FP_PRT_DBG(FP_PRT_DEBUG, "clat %s removed\n", clat->v4_name);
+	kfree_rcu(clat, rcu);
+	/* the entries of the flows resolved the translation at add time */
+	clear_sfp_fwd_table();
+}
+
+static int sfp_clat_add(struct sfp_clat *new)
+{
+	struct sfp_clat *clat;
+	int i, slot = -1;
+
+	mutex_lock(&sfp_clat_mutex);
+	for (i = 0; i < SFP_CLAT_MAX; i++) {
+		clat = rcu_dereference_protected(
+			sfp_clat_tbl[i], lockdep_is_held(&sfp_clat_mutex));
+		if (!clat) {
+			if (slot < 0)
+				slot = i;
+		} else if (clat->v4_ifindex == new->v4_ifindex) {
+			slot = i;
+			break;
+		}
+	}
+
+	if (slot < 0) {
+		mutex_unlock(&sfp_clat_mutex);
+		return -ENOSPC;
+	}
+
+	clat = rcu_dereference_protected(sfp_clat_tbl[slot],
+					 lockdep_is_held(&sfp_clat_mutex));
+	rcu_assign_pointer(sfp_clat_tbl[slot], new);
+	if (clat)
+		sfp_clat_free(clat);
+	mutex_unlock(&sfp_clat_mutex);
+
+	FP_PRT_DBG(FP_PRT_DEBUG, "clat %s: %pI4 %pI6c via %d, prefix %pI6c\n",
+		   new->v4_name, &new->v4_addr, &new->v6_addr,
+		   new->v6_ifindex, &new->plat_prefix);
+	return 0;
+}
+
+/*
+ * Drop the translations whose tun or underlying device matches, all of
+ * them without a name and an ifindex.
+ */
+static void sfp_clat_del(const char *name, int ifindex)
+{
+	bool all = !name && !ifindex;
+	struct sfp_clat *clat;
+	int i;
+
+	mutex_lock(&sfp_clat_mutex);
+	for (i = 0; i < SFP_CLAT_MAX; i++) {
+		clat = rcu_dereference_protected(
+			sfp_clat_tbl[i], lockdep_is_held(&sfp_clat_mutex));
+		if (!clat)
+			continue;
+
+		if (all || (name && !strncmp(clat->v4_name, name, IFNAMSIZ)) ||
+		    (ifindex && (clat->v4_ifindex == ifindex ||
+				 clat->v6_ifindex == ifindex))) {
+			RCU_INIT_POINTER(sfp_clat_tbl[i], NULL);
+			sfp_clat_free(clat);
+		}
+	}
+	mutex_unlock(&sfp_clat_mutex);
+}
+
+static int sfp_clat_parse(char *buf, struct sfp_clat *clat)
+{
+	char v6_name[IFNAMSIZ], v4_addr[16], v6_addr[48], prefix[48];
+	struct net_device *dev;
+
+	if (sscanf(buf, "%15s %15s %15s %47s %47s", clat->v4_name, v6_name,
+		   v4_addr, v6_addr, prefix) != 5)
+		return -EINVAL;
+
+	if (!in4_pton(v4_addr, -1, (u8 *)&clat->v4_addr, -1, NULL) ||
+	    !in6_pton(v6_addr, -1, clat->v6_addr.s6_addr, -1, NULL) ||
+	    !in6_pton(prefix, -1, clat->plat_prefix.s6_addr, -1, NULL))
+		return -EINVAL;
+
+	dev = dev_get_by_name(&init_net, clat->v4_name);
+	if (!dev)
+		return -ENODEV;
+	clat->v4_ifindex = dev->ifindex;
+	dev_put(dev);
+
+	dev = dev_get_by_name(&init_net, v6_name);
+	if (!dev)
+		return -ENODEV;
+	clat->v6_ifindex = dev->ifindex;
+	dev_put(dev);
+
+	return 0;
+}
+
+static ssize_t sfp_clat_proc_write(struct file *file,
+				   const char __user *buffer,
+				   size_t count, loff_t *pos)
+{
+	struct sfp_clat *clat;
+	char buf[160];
+	int err;
+
+	if (!count || count >= sizeof(buf))
+		return -EINVAL;
+
+	if (copy_from_user(buf, buffer, count))
+		return -EFAULT;
+	buf[count] = '\0';
+	strim(buf);
+
+	if (buf[0] == '-') {
+		sfp_clat_del(buf + 1, 0);
+		return count;
+	}
+
+	clat = kzalloc(sizeof(*clat), GFP_KERNEL);
+	if (!clat)
+		return -ENOMEM;
+
+	err = sfp_clat_parse(buf, clat);
+	if (!err)
+		err = sfp_clat_add(clat);
+	if (err) {
+		kfree(clat);
+		return err;
+	}
+
+	return count;
+}
+
+static int sfp_clat_proc_show(struct seq_file *seq, void *v)
+{
+	struct sfp_clat *clat;
+	int i;
+
+	rcu_read_lock();
+	for (i = 0; i < SFP_CLAT_MAX; i++) {
+		clat = rcu_dereference(sfp_clat_tbl[i]);
+		if (!clat)
+			continue;
+		seq_printf(seq, "%s %d %pI4 %pI6c %pI6c/96\n", clat->v4_name,
+			   clat->v6_ifindex, &clat->v4_addr, &clat->v6_addr,
+			   &clat->plat_prefix);
+	}
+	rcu_read_unlock();
+
+	return 0;
+}
+
+static int sfp_clat_proc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sfp_clat_proc_show, NULL);
+}
+
+const struct file_operations sfp_clat_proc_fops = {
+	.open  = sfp_clat_proc_open,
+	.read  = seq_read,
+	.write  = sfp_clat_proc_write,
+	.llseek  = seq_lseek,
+	.release = single_release,
+};
+
+static int sfp_clat_netdev_event(struct notifier_block *nb,
+				 unsigned long event, void *ptr)
+{
+	struct net_device *dev = netdev_notifier_info_to_dev(ptr);
+
+	/* clatd writes the translation again when it restarts */
+	if (event == NETDEV_DOWN || event == NETDEV_UNREGISTER)
+		sfp_clat_del(NULL, dev->ifindex);
+
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block sfp_clat_netdev_notifier = {
+	.notifier_call = sfp_clat_netdev_event,
+};
+
+int sfp_clat_init(void)
+{
+	return register_netdevice_notifier(&sfp_clat_netdev_notifier);
+}
+
+void sfp_clat_exit(void)
+{
+	unregister_netdevice_notifier(&sfp_clat_netdev_notifier);
+	sfp_clat_del(NULL, 0);
+}
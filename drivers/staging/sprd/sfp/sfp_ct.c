@@ -15,6 +15,7 @@
 #include <net/sock.h>
 #include <net/netfilter/nf_conntrack.h>
 #include <net/netfilter/nf_conntrack_core.h>
+#include <net/netfilter/nf_conntrack_zones.h>
 
 #include <net/sfp.h>
 #include "sfp.h"
@@ -38,3 +39,26 @@ int sfp_sync_with_nfl_ct(const struct nf_conntrack_tuple *tuple)
 	return 0;
 }
 EXPORT_SYMBOL(sfp_sync_with_nfl_ct);
+
+/*
+ * Packets forwarded by the ipa never pass conntrack, push the timeout of
+ * the conntrack forward while the hardware reports activity.
+ */
+int sfp_refresh_nfl_ct(const struct nf_conntrack_tuple *tuple,
+		       unsigned long extra_jiffies)
+{
+	struct nf_conntrack_tuple_hash *h;
+	struct nf_conn *ct;
+
+	h = nf_conntrack_find_get(&init_net, &nf_ct_zone_dflt, tuple);
+	if (!h)
+		return -ENOENT;
+
+	ct = nf_ct_tuplehash_to_ctrack(h);
+	if (!test_bit(IPS_FIXED_TIMEOUT_BIT, &ct->status) &&
+	    nf_ct_expires(ct) < extra_jiffies)
+		WRITE_ONCE(ct->timeout, nfct_time_stamp + extra_jiffies);
+
+	nf_ct_put(ct);
+	return 0;
+}
@@ -25,50 +25,114 @@
 #include <linux/proc_fs.h>
 #include <linux/netfilter/x_tables.h>
 #include <linux/rculist.h>
+#include <linux/rhashtable.h>
 #include <net/netfilter/nf_nat.h>
-#include <linux/timer.h>
 
 #include "sfp.h"
 #include "sfp_hash.h"
 
-/* Forward entry in fast path */
-struct hlist_head sfp_fwd_entries[SFP_ENTRIES_HASH_SIZE];
+/*
+ * Forward entries of the software fast path. The table starts small and
+ * grows with the number of tracked connections, lookups only take the
+ * rcu read lock and the bucket locks are taken by insert/remove only.
+ */
+#define SFP_FWD_TABLE_MIN_SIZE	256
+#define SFP_FWD_TABLE_MAX_SIZE	(64 * 1024)
+
+struct rhashtable sfp_fwd_rht;
+
+static u32 sfp_fwd_rht_hashfn(const void *data, u32 len, u32 seed)
+{
+	return __sfp_hash_conntrack(data, seed);
+}
+
+static u32 sfp_fwd_rht_obj_hashfn(const void *data, u32 len, u32 seed)
+{
+	const struct sfp_fwd_entry *entry = data;
+
+	return __sfp_hash_conntrack(&entry->tuple, seed);
+}
+
+static int sfp_fwd_rht_obj_cmpfn(struct rhashtable_compare_arg *arg,
+				 const void *obj)
+{
+	const struct sfp_fwd_entry *entry = obj;
+
+	/* the direction is not part of the key, see sfp_hash_conntrack() */
+	return !sfp_ct_nf_tuple_equal(&entry->tuple, arg->key);
+}
+
+static const struct rhashtable_params sfp_fwd_rht_params = {
+	.head_offset = offsetof(struct sfp_fwd_entry, node),
+	.key_offset = offsetof(struct sfp_fwd_entry, tuple),
+	.key_len = sizeof(struct nf_conntrack_tuple),
+	.min_size = SFP_FWD_TABLE_MIN_SIZE,
+	.max_size = SFP_FWD_TABLE_MAX_SIZE,
+	.automatic_shrinking = true,
+	.hashfn = sfp_fwd_rht_hashfn,
+	.obj_hashfn = sfp_fwd_rht_obj_hashfn,
+	.obj_cmpfn = sfp_fwd_rht_obj_cmpfn,
+};
+
+int sfp_fwd_table_init(void)
+{
+	return rhashtable_init(&sfp_fwd_rht, &sfp_fwd_rht_params);
+}
+
+/* Sum of the per cpu hit counters, 0 for the ipa scheme entries */
+u32 sfp_fwd_entry_count(const struct sfp_fwd_entry *entry)
+{
+	u32 count = 0;
+	int cpu;
+
+	if (!entry->pcpu_count)
+		return entry->ssfp_trans_tuple.count;
+
+	for_each_possible_cpu(cpu)
+		count += *per_cpu_ptr(entry->pcpu_count, cpu);
+
+	return count;
+}
+
+static void sfp_fwd_entry_free(struct rcu_head *head)
+{
+	struct sfp_fwd_entry *sfp_fwd_entry;
+
+	sfp_fwd_entry = container_of(head, struct sfp_fwd_entry, rcu);
+	free_percpu(sfp_fwd_entry->pcpu_count);
+	if (sfp_fwd_entry->out_dev)
+		dev_put(sfp_fwd_entry->out_dev);
+	kfree(sfp_fwd_entry);
+}
 
 int add_in_sfp_fwd_table(const struct sfp_mgr_fwd_tuple_hash *fwd_hash_entry,
 			 struct sfp_conn *sfp_ct)
 {
-	u8 status = SFP_FAIL;
-	struct sfp_fwd_entry *cur_entry;
 	struct sfp_fwd_entry *new_entry;
-	u32 hash;
+	int err;
 
 	if (!fwd_hash_entry)
 		return -EPERM;
 
-	hash = sfp_hash_conntrack(&fwd_hash_entry->tuple);
+	new_entry = kzalloc(sizeof(*new_entry), GFP_ATOMIC);
+	if (!new_entry)
+		return -ENOMEM;
 
-	rcu_read_lock_bh();
-	hlist_for_each_entry_rcu(cur_entry,
-				 &sfp_fwd_entries[hash],
-				 entry_lst) {
-		if (nf_ct_tuple_equal(&cur_entry->tuple,
-				      &fwd_hash_entry->tuple)) {
-			status = SFP_OK;
-			break;
-		}
+	new_entry->pcpu_count = alloc_percpu_gfp(u32, GFP_ATOMIC);
+	if (!new_entry->pcpu_count) {
+		kfree(new_entry);
+		return -ENOMEM;
 	}
-	rcu_read_unlock_bh();
 
-	if (status == SFP_OK) {
-		FP_PRT_DBG(FP_PRT_DEBUG, "fwd exists,return.[%u]\n", hash);
-		return -EPERM;
+	/* resolved once here instead of for every forwarded packet */
+	new_entry->out_dev = dev_get_by_index(&init_net,
+			fwd_hash_entry->ssfp_fwd_tuple.out_ifindex);
+	if (!new_entry->out_dev) {
+		free_percpu(new_entry->pcpu_count);
+		kfree(new_entry);
+		return -ENODEV;
 	}
 
-	new_entry = kmalloc(sizeof(*new_entry), GFP_ATOMIC);
-	if (!new_entry)
-		return -ENOMEM;
-
-	memset(new_entry, 0, sizeof(struct sfp_fwd_entry));
 	new_entry->sfp_ct = sfp_ct;
 	new_entry->tuple = fwd_hash_entry->tuple;
 	new_entry->ssfp_trans_tuple.trans_mac_info =
@@ -84,12 +148,21 @@ int add_in_sfp_fwd_table(const struct sfp_mgr_fwd_tuple_hash *fwd_hash_entry,
 	new_entry->ssfp_trans_tuple.count = 0;
 	new_entry->ssfp_trans_tuple.fwd_flags =
 			fwd_hash_entry->ssfp_fwd_tuple.fwd_flags;
-	hlist_add_head_rcu(&new_entry->entry_lst, &sfp_fwd_entries[hash]);
-	status = SFP_OK;
+
+	err = rhashtable_lookup_insert_fast(&sfp_fwd_rht, &new_entry->node,
+					    sfp_fwd_rht_params);
+	if (err) {
+		FP_PRT_DBG(FP_PRT_DEBUG, "fwd add failed %d, return.\n", err);
+		dev_put(new_entry->out_dev);
+		free_percpu(new_entry->pcpu_count);
+		kfree(new_entry);
+		return err == -EEXIST ? -EPERM : err;
+	}
+
 	FP_PRT_DBG(FP_PRT_DEBUG, "add sfp_fwd_entries %s %d [%u]\n",
-		   __func__, __LINE__, hash);
+		   __func__, __LINE__, atomic_read(&sfp_fwd_rht.nelems));
 
-	return status;
+	return SFP_OK;
 }
 
 void sfp_fwd_hash_add(struct sfp_conn *sfp_ct)
@@ -100,34 +173,22 @@ void sfp_fwd_hash_add(struct sfp_conn *sfp_ct)
 		&sfp_ct->tuplehash[IP_CT_DIR_REPLY], sfp_ct);
 }
 
-static void sfp_fwd_entry_free(struct rcu_head *head)
-{
-	struct sfp_fwd_entry *sfp_fwd_entry;
-
-	sfp_fwd_entry = container_of(head, struct sfp_fwd_entry, rcu);
-	kfree(sfp_fwd_entry);
-}
-
 int delete_in_sfp_fwd_table(const struct sfp_mgr_fwd_tuple_hash *fwd_hash_entry)
 {
 	struct sfp_fwd_entry *cur_entry;
-	u32 hash;
 
 	if (!fwd_hash_entry)
 		return 0;
 
-	rcu_read_lock_bh();
-	hash = sfp_hash_conntrack(&fwd_hash_entry->tuple);
-	hlist_for_each_entry_rcu(cur_entry,
-				 &sfp_fwd_entries[hash],
-				 entry_lst) {
-		if (nf_ct_tuple_equal(&cur_entry->tuple,
-				      &fwd_hash_entry->tuple)) {
-			hlist_del_rcu(&cur_entry->entry_lst);
-			call_rcu_bh(&cur_entry->rcu, sfp_fwd_entry_free);
-		}
-	}
-	rcu_read_unlock_bh();
+	rcu_read_lock();
+	cur_entry = rhashtable_lookup(&sfp_fwd_rht, &fwd_hash_entry->tuple,
+				      sfp_fwd_rht_params);
+	/* only the one who unlinked the entry may free it */
+	if (cur_entry &&
+	    !rhashtable_remove_fast(&sfp_fwd_rht, &cur_entry->node,
+				    sfp_fwd_rht_params))
+		call_rcu_bh(&cur_entry->rcu, sfp_fwd_entry_free);
+	rcu_read_unlock();
 
 	return 0;
 }
@@ -136,103 +197,117 @@ EXPORT_SYMBOL(delete_in_sfp_fwd_table);
 int get_sfp_fwd_entry_count(struct sfp_mgr_fwd_tuple_hash *fwd_hash_entry)
 {
 	struct sfp_fwd_entry *cur_entry;
-	u32 hash;
 	int confirm = 0;
+	u32 count;
 
 	if (!fwd_hash_entry)
 		return 0;
 
-	rcu_read_lock_bh();
-	hash = sfp_hash_conntrack(&fwd_hash_entry->tuple);
-
-	hlist_for_each_entry_rcu(cur_entry,
-				 &sfp_fwd_entries[hash],
-				 entry_lst) {
-		if (nf_ct_tuple_equal(&cur_entry->tuple,
-				      &fwd_hash_entry->tuple)) {
-			FP_PRT_DBG(FP_PRT_DEBUG,
-				   "SFP_FWD: fwd = %u, cur= %u\n",
-				   fwd_hash_entry->ssfp_fwd_tuple.count,
-				   cur_entry->ssfp_trans_tuple.count);
-			if (cur_entry->ssfp_trans_tuple.count !=
-			    fwd_hash_entry->ssfp_fwd_tuple.count) {
-				fwd_hash_entry->ssfp_fwd_tuple.count =
-				cur_entry->ssfp_trans_tuple.count;
-				confirm = 1;
-			}
-			break;
+	rcu_read_lock();
+	cur_entry = rhashtable_lookup(&sfp_fwd_rht, &fwd_hash_entry->tuple,
+				      sfp_fwd_rht_params);
+	if (cur_entry) {
+		count = sfp_fwd_entry_count(cur_entry);
+		FP_PRT_DBG(FP_PRT_DEBUG,
+			   "SFP_FWD: fwd = %u, cur= %u\n",
+			   fwd_hash_entry->ssfp_fwd_tuple.count, count);
+		if (count != fwd_hash_entry->ssfp_fwd_tuple.count) {
+			fwd_hash_entry->ssfp_fwd_tuple.count = count;
+			confirm = 1;
 		}
 	}
-	rcu_read_unlock_bh();
+	rcu_read_unlock();
 	return confirm;
 }
 EXPORT_SYMBOL(get_sfp_fwd_entry_count);
 
-/*clear the whole forward table*/
-void clear_sfp_fwd_table(void)
+/* Remove the entries going out of @dev, all of them if @dev is NULL */
+static void sfp_fwd_table_flush(struct net_device *dev)
 {
 	struct sfp_fwd_entry *sfp_fwd_entry;
-	int i;
+	struct rhashtable_iter hti;
 
-	rcu_read_lock_bh();
-	for (i = 0; i < SFP_ENTRIES_HASH_SIZE; i++) {
-		hlist_for_each_entry_rcu(sfp_fwd_entry,
-					 &sfp_fwd_entries[i],
-					 entry_lst) {
-			hlist_del_rcu(&sfp_fwd_entry->entry_lst);
+	rhashtable_walk_enter(&sfp_fwd_rht, &hti);
+	rhashtable_walk_start(&hti);
+	while ((sfp_fwd_entry = rhashtable_walk_next(&hti))) {
+		/* a resize restarts the walk, entries may show up twice */
+		if (IS_ERR(sfp_fwd_entry))
+			continue;
+
+		if (dev && sfp_fwd_entry->out_dev != dev)
+			continue;
+
+		if (!rhashtable_remove_fast(&sfp_fwd_rht, &sfp_fwd_entry->node,
+					    sfp_fwd_rht_params))
 			call_rcu_bh(&sfp_fwd_entry->rcu, sfp_fwd_entry_free);
-		}
 	}
-	rcu_read_unlock_bh();
+	rhashtable_walk_stop(&hti);
+	rhashtable_walk_exit(&hti);
+}
+
+/* Drop the device references before @dev can be unregistered */
+void sfp_fwd_table_flush_dev(struct net_device *dev)
+{
+	sfp_fwd_table_flush(dev);
+}
+
+/*clear the whole forward table*/
+void clear_sfp_fwd_table(void)
+{
+	sfp_fwd_table_flush(NULL);
 }
 EXPORT_SYMBOL(clear_sfp_fwd_table);
 
-void sfp_mode_timer(struct sfp_conn *ul_sfp_ct)
+/*
+ * Push the deadline of an udp/icmp flow. The aging work only looks every
+ * second, so the shared sfp_conn line is written once a second at most.
+ */
+static inline void sfp_ct_refresh(struct sfp_conn *sfp_ct)
 {
-	struct sfp_conn *sfp_ct = ul_sfp_ct;
-	u8 l3_proto;
+	unsigned long newtime;
 
 	if (!sfp_ct || sfp_ct->fin_rst_flag > 0)
 		return;
 
-	l3_proto = sfp_ct->tuplehash[IP_CT_DIR_ORIGINAL].tuple.dst.protonum;
-
-	if (l3_proto != IP_L4_PROTO_TCP) {
-		unsigned long newtime = jiffies + sysctl_udp_aging_time;
+	if (sfp_ct->tuplehash[IP_CT_DIR_ORIGINAL].tuple.dst.protonum ==
+	    IP_L4_PROTO_TCP)
+		return;
 
-		if (newtime - sfp_ct->timeout.expires >= HZ) {
-			spin_lock_bh(&mgr_lock);
-			sfp_ct->timeout.expires = newtime;
-			mod_timer(&sfp_ct->timeout, sfp_ct->timeout.expires);
-			spin_unlock_bh(&mgr_lock);
-		}
-	}
+	newtime = jiffies + sysctl_udp_aging_time;
+	if (newtime - READ_ONCE(sfp_ct->expires) >= HZ)
+		WRITE_ONCE(sfp_ct->expires, newtime);
 }
 
+/*
+ * On a hit @out_dev is the cached egress device. It stays valid until the
+ * caller leaves its bh section, the entry drops it after an rcu bh grace
+ * period only.
+ */
 int check_sfp_fwd_table(struct nf_conntrack_tuple *tuple,
-			struct sfp_trans_tuple *ret_info)
+			struct sfp_trans_tuple *ret_info,
+			struct net_device **out_dev)
 {
 	struct sfp_fwd_entry *curr_entry;
-	u32 hash;
 	int ret = SFP_FAIL;
 
-	hash = sfp_hash_conntrack(tuple);
+	/*
+	 * The table buckets are freed after a normal rcu grace period, the
+	 * entries and their sfp_conn after a bh one, hold both.
+	 */
 	rcu_read_lock_bh();
-	hlist_for_each_entry_rcu(curr_entry,
-				 &sfp_fwd_entries[hash], entry_lst) {
-		if (sfp_ct_nf_tuple_equal(&curr_entry->tuple, tuple)) {
-			/* Find the hash fwd entry */
-			curr_entry->ssfp_trans_tuple.count++;
-			*ret_info = curr_entry->ssfp_trans_tuple;
-
-			sfp_mode_timer(curr_entry->sfp_ct);
-			break;
-		}
+	rcu_read_lock();
+	curr_entry = rhashtable_lookup(&sfp_fwd_rht, tuple,
+				       sfp_fwd_rht_params);
+	if (curr_entry) {
+		/* Find the hash fwd entry */
+		this_cpu_inc(*curr_entry->pcpu_count);
+		*ret_info = curr_entry->ssfp_trans_tuple;
+		*out_dev = curr_entry->out_dev;
+
+		sfp_ct_refresh(curr_entry->sfp_ct);
+		ret = SFP_OK;
 	}
-
-	if (curr_entry)
-		ret =  SFP_OK;
-
+	rcu_read_unlock();
 	rcu_read_unlock_bh();
 
 	return ret;
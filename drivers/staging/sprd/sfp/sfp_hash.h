@@ -78,19 +78,23 @@ static inline u32 sfp_jhash2(const u32 *k, u32 length, u32 initval)
 	return c;
 }
 
-static inline u32 sfp_hash_conntrack(const struct nf_conntrack_tuple *tuple)
+static inline u32 __sfp_hash_conntrack(const struct nf_conntrack_tuple *tuple,
+				       u32 seed)
 {
 	unsigned int n;
-	u32 sum;
+
 	/* The direction must be ignored, so we hash everything up to the
 	 * destination ports (which is a multiple of 4) and treat the last
 	 * three bytes manually.
 	 */
 	n = (sizeof(tuple->src) + sizeof(tuple->dst.u3)) / sizeof(u32);
-	sum =  sfp_jhash2((u32 *)tuple, n,
+	return sfp_jhash2((u32 *)tuple, n,
 			  (((__force __u16)tuple->dst.u.all << 16) |
-			  tuple->dst.protonum));
-	sum = sum & (SFP_ENTRIES_HASH_SIZE - 1);
-	return sum;
+			  tuple->dst.protonum) ^ seed);
+}
+
+static inline u32 sfp_hash_conntrack(const struct nf_conntrack_tuple *tuple)
+{
+	return __sfp_hash_conntrack(tuple, 0) & (SFP_ENTRIES_HASH_SIZE - 1);
 }
 #endif
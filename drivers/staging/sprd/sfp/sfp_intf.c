@@ -21,6 +21,7 @@
 #include <net/udp.h>
 #include <linux/icmp.h>
 #include <linux/ipv6.h>
+#include <linux/sched/clock.h>
 #include <net/ip6_checksum.h>
 
 #include "sfp.h"
@@ -433,17 +434,21 @@ int sfp_check_mod_pkts(u32 ifindex,
 	u8  proto;
 	u16 srcport, dstport;
 	struct sfp_trans_tuple ret_info;
+	struct net_device *out_dev;
 	int out_ifindex;
 	struct iphdr *iphdr2;
 	u32 dip, sip;
 	struct ipv6hdr *ip6hdr;
 	struct nf_conntrack_tuple tuple;
+	struct sfp_clat_addr clat_addr;
 	u32 l3offset;
 	u32 l4offset;
 	u8 *ip_header;
 	u32 totlen;
 	int ret = -SFP_FAIL;
 	bool sfp_ret = false;
+	bool clat_in = false;
+	u64 start;
 
 	if (l3proto == NFPROTO_IPV4) {
 		iphdr2 = (struct iphdr *)iph;
@@ -460,35 +465,67 @@ int sfp_check_mod_pkts(u32 ifindex,
 	if (proto == IP_L4_PROTO_NULL) {
 		/* NAT not supported for this protocol */
 		FP_PRT_DBG(FP_PRT_DEBUG, "proto [%d] no supported.\n", proto);
+		sfp_stats_fallback(SFP_STATS_FB_L4_PROTO);
 		return ret; /* No support protocol */
 	}
 
 	memset(&tuple, 0, sizeof(struct nf_conntrack_tuple));
 	skb = (struct sk_buff *)data;
-	sfp_ret = sfp_pkt_to_tuple(skb->data,
-				   skb_network_offset(skb),
-				   &tuple,
-				   &l4offset);
-	l3offset = skb_network_offset(skb);
-	ip_header = skb->data + skb_network_offset(skb);
-	totlen = skb->len;
+	/* replies sent to clatd are looked up with their ipv4 tuple */
+	if (l3proto == NFPROTO_IPV6 && sfp_clat_in_tuple(skb, &tuple)) {
+		clat_in = true;
+		sfp_ret = true;
+	} else {
+		sfp_ret = sfp_pkt_to_tuple(skb->data,
+					   skb_network_offset(skb),
+					   &tuple,
+					   &l4offset);
+	}
 
-	if (!sfp_ret)
+	if (!sfp_ret) {
+		sfp_stats_fallback(SFP_STATS_FB_L4_PROTO);
 		return ret;
+	}
 
 	/* Lookup fwd entries accordingly with 5 tuple key */
-	ret = check_sfp_fwd_table(&tuple, &ret_info);
+	start = local_clock();
+	ret = check_sfp_fwd_table(&tuple, &ret_info, &out_dev);
+	sfp_stats_lookup(local_clock() - start);
 	if (ret != SFP_OK) {
 		FP_PRT_DBG(FP_PRT_DEBUG, "SFP_MGR: no fwd entries.\n");
+		sfp_stats_miss();
 		return -ret;
 	}
 	out_ifindex = ret_info.out_ifindex;
 
+	if ((ret_info.fwd_flags & SFP_FWD_FLAG_CLAT) &&
+	    sfp_clat_out_prepare(skb, out_dev, &clat_addr)) {
+		sfp_stats_fallback(SFP_STATS_FB_CLAT);
+		return -SFP_FAIL;
+	}
+
+	if (clat_in) {
+		sfp_clat_6to4(skb, &tuple);
+		l3proto = NFPROTO_IPV4;
+		l4offset = sizeof(struct iphdr);
+	}
+	l3offset = skb_network_offset(skb);
+
 	sfp_ret = sfp_update_pkt_header(ifindex,
 					data, l3offset,
 					l4offset, ret_info);
-	if (!sfp_ret)
+	if (!sfp_ret) {
+		sfp_stats_fallback(SFP_STATS_FB_TCP_FLAGS);
 		return -SFP_FAIL;
+	}
+
+	if (ret_info.fwd_flags & SFP_FWD_FLAG_CLAT) {
+		sfp_clat_4to6(skb, &clat_addr);
+		l3proto = NFPROTO_IPV6;
+		l4offset = sizeof(struct ipv6hdr);
+	}
+	ip_header = skb->data + skb_network_offset(skb);
+	totlen = skb->len;
 
 	sfp_update_checksum((void *)ip_header,
 			    totlen,
@@ -497,7 +534,9 @@ int sfp_check_mod_pkts(u32 ifindex,
 			    proto,
 			    l4offset);
 
+	sfp_stats_hit(skb->dev->ifindex, out_dev->ifindex, totlen);
 	skb_push(skb, ETH_HLEN);
+	skb->dev = out_dev;
 	return out_ifindex;
 }
 
@@ -535,6 +574,8 @@ static void sfp_maybe_trim_skb(struct sk_buff *skb)
  *      mac header and head pointer.
  *    4.INOUT int *pDataLen: the pkt total length
  *    5.OUT int *out_if: the interface is which the pkt will be sent to.
+ *      On success skb->dev is set to that interface as well, it stays
+ *      valid while the caller runs in the same bh section.
  *    Return: 0. the pkt will  be forward and the ip header and udp or
  *                tcp header is ready.
  *            >0. the pkt should be sent to network subsystem.
@@ -561,8 +602,10 @@ int soft_fastpath_process(int in_if,
 	skb = (struct sk_buff *)data_header;
 
 	if (!get_sfp_tether_scheme()) {
-		if (is_banned_ipa_netdev(skb->dev))
+		if (is_banned_ipa_netdev(skb->dev)) {
+			sfp_stats_fallback(SFP_STATS_FB_BANNED_DEV);
 			return 1;
+		}
 	}
 
 	skb_reset_network_header(skb);
@@ -583,6 +626,7 @@ int soft_fastpath_process(int in_if,
 	if (skb_linearize(skb)) {
 		FP_PRT_DBG(FP_PRT_WARN,
 			   "nomem to linear, pass to IP stack\n");
+		sfp_stats_fallback(SFP_STATS_FB_NOMEM);
 		return -ENOMEM;
 	}
 
@@ -613,6 +657,7 @@ int soft_fastpath_process(int in_if,
 			return 0;
 	} else {
 		FP_PRT_DBG(FP_PRT_DEBUG, "recv neither v4 nor v6 pkt\n");
+		sfp_stats_fallback(SFP_STATS_FB_L3_PROTO);
 		return 1;
 	}
 }
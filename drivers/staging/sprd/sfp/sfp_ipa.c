@@ -27,6 +27,7 @@
 #include <linux/rculist.h>
 #include <net/netfilter/nf_nat.h>
 #include <linux/timer.h>
+#include <linux/workqueue.h>
 
 #include "sfp.h"
 #include "sfp_hash.h"
@@ -55,6 +56,11 @@ struct sfp_fwd_hash_tbl fwd_tbl;
 #define IPA_HASH_APPEND			1
 #define IPA_HASH_THRESHOLD		100
 
+/* Connections sent back to the stack when the hardware table is full */
+#define IPA_EVICT_BATCH			8
+/* Conntracks refreshed per hold of the rcu bh read lock */
+#define IPA_SYNC_BATCH			32
+
 int sfp_tbl_id(void)
 {
 	return NEW_TBL_ID == 0 ? T1 : T0;
@@ -211,6 +217,9 @@ int sfp_ipa_fwd_delete(const struct sfp_mgr_fwd_tuple_hash *fwd_hash_entry,
 	if (!fwd_hash_entry)
 		return 0;
 
+	/* either direction takes the connection off the lru */
+	list_del_init(&sfp_ct_tuplehash_to_ctrack(fwd_hash_entry)->ipa_lru);
+
 	hlist_for_each_entry_safe(cur_entry, n,
 				  &fwd_tbl.sfp_fwd_entries[hash],
 				  entry_lst) {
@@ -419,18 +428,53 @@ static int sfp_ipa_update_hash_slow(void)
 	return SFP_OK;
 }
 
+/*
+ * Take the least recently active connections out of the hardware table,
+ * their packets go through the stack again. The next add rebuilds the
+ * whole table, which drops their hardware entries. Called with sp_lock.
+ */
+static int sfp_ipa_evict_lru(int n)
+{
+	struct sfp_conn *sfp_ct, *tmp;
+	int cnt = 0;
+
+	list_for_each_entry_safe(sfp_ct, tmp, &fwd_tbl.lru_list, ipa_lru) {
+		if (cnt >= n)
+			break;
+
+		FP_PRT_DBG(FP_PRT_DEBUG, "evict ipa entry %p [%u]\n",
+			   sfp_ct, sfp_ct->hash[IP_CT_DIR_ORIGINAL]);
+		sfp_ipa_fwd_delete(&sfp_ct->tuplehash[IP_CT_DIR_ORIGINAL],
+				   sfp_ct->hash[IP_CT_DIR_ORIGINAL]);
+		sfp_ipa_fwd_delete(&sfp_ct->tuplehash[IP_CT_DIR_REPLY],
+				   sfp_ct->hash[IP_CT_DIR_REPLY]);
+		cnt++;
+	}
+
+	if (cnt) {
+		fwd_tbl.op_flag = IPA_HASH_COLLISION;
+		fwd_tbl.evict_cnt += cnt;
+	}
+
+	return cnt;
+}
+
 int sfp_ipa_hash_add(struct sfp_conn *sfp_ct)
 {
-	if (atomic_read(&fwd_tbl.entry_cnt) >= IPA_DEFAULT_NUM - 1) {
+	spin_lock_bh(&fwd_tbl.sp_lock);
+	if (atomic_read(&fwd_tbl.entry_cnt) >= IPA_DEFAULT_NUM - 1 &&
+	    !sfp_ipa_evict_lru(IPA_EVICT_BATCH)) {
+		spin_unlock_bh(&fwd_tbl.sp_lock);
 		FP_PRT_DBG(FP_PRT_ERR,
 			   "out of entry mem!\n");
 
 		return -1;
 	}
 
-	spin_lock_bh(&fwd_tbl.sp_lock);
 	if (sfp_ipa_fwd_add(IP_CT_DIR_ORIGINAL, sfp_ct) ==  SFP_OK &&
 	    sfp_ipa_fwd_add(IP_CT_DIR_REPLY, sfp_ct) == SFP_OK) {
+		list_add_tail(&sfp_ct->ipa_lru, &fwd_tbl.lru_list);
+
 		if (fwd_tbl.op_flag == IPA_HASH_COLLISION ||
 		    fwd_tbl.append_cnt > IPA_HASH_THRESHOLD) {
 			FP_PRT_DBG(FP_PRT_DEBUG, "slow path!\n");
@@ -484,6 +528,10 @@ bool sfp_ipa_tbl_timeout(struct sfp_conn *sfp_ct)
 	if (TCP_CT(sfp_ct))
 		return false;
 
+	/* not in the hardware, evicted or never fitted, the deadline rules */
+	if (list_empty(&sfp_ct->ipa_lru))
+		return true;
+
 	if (!sfp_get_ipa_ts(IP_CT_DIR_ORIGINAL, sfp_ct, &ts_orig_new) ||
 	    !sfp_get_ipa_ts(IP_CT_DIR_REPLY, sfp_ct, &ts_repl_new)) {
 		FP_PRT_DBG(FP_PRT_ERR,
@@ -496,11 +544,10 @@ bool sfp_ipa_tbl_timeout(struct sfp_conn *sfp_ct)
 
 	if (sfp_ct->ts != ts) {
 		sfp_ct->ts = ts;
-		sfp_ct->timeout.expires = jiffies + sysctl_udp_aging_time;
+		WRITE_ONCE(sfp_ct->expires, jiffies + sysctl_udp_aging_time);
 		FP_PRT_DBG(FP_PRT_INFO,
 			   "not timeout, hash [%u]!\n",
 			   sfp_ct->hash[IP_CT_DIR_ORIGINAL]);
-		mod_timer(&sfp_ct->timeout, sfp_ct->timeout.expires);
 		return false;
 	}
 
@@ -576,6 +623,8 @@ void sfp_ipa_fwd_clear(void)
 			atomic_dec(&fwd_tbl.entry_cnt);
 		}
 	}
+	while (!list_empty(&fwd_tbl.lru_list))
+		list_del_init(fwd_tbl.lru_list.next);
 	sfp_clear_all_ipa_tbl();
 	spin_unlock_bh(&fwd_tbl.sp_lock);
 	FP_PRT_DBG(FP_PRT_INFO, "%s %d\n", __func__, sfp_entry_cnt());
@@ -602,14 +651,91 @@ void sfp_init_ipa_tbl(void)
 	sfp_ipa_alloc_tbl(DEFAULT_IPA_TBL_SIZE);
 }
 
+static unsigned long sfp_ipa_aging_time(struct sfp_conn *sfp_ct)
+{
+	return TCP_CT(sfp_ct) ? sysctl_tcp_aging_time : sysctl_udp_aging_time;
+}
+
+/*
+ * The hardware stamps an entry each time it forwards a packet with it,
+ * there are no byte or packet counters in the entry layout. A changed
+ * stamp moves the connection to the lru tail, refreshes its deadline and
+ * keeps the bypassed conntrack alive.
+ */
+static void sfp_ipa_sync_work_fn(struct work_struct *work)
+{
+	struct sfp_conn *batch[IPA_SYNC_BATCH];
+	struct sfp_conn *sfp_ct, *tmp;
+	u32 ts, ts_orig, ts_repl;
+	LIST_HEAD(idle);
+	LIST_HEAD(active);
+	int i, cnt;
+
+	rcu_read_lock_bh();
+	do {
+		cnt = 0;
+		spin_lock_bh(&fwd_tbl.sp_lock);
+		list_for_each_entry_safe(sfp_ct, tmp, &fwd_tbl.lru_list,
+					 ipa_lru) {
+			if (!sfp_get_ipa_ts(IP_CT_DIR_ORIGINAL, sfp_ct,
+					    &ts_orig) ||
+			    !sfp_get_ipa_ts(IP_CT_DIR_REPLY, sfp_ct,
+					    &ts_repl)) {
+				list_move_tail(&sfp_ct->ipa_lru, &idle);
+				continue;
+			}
+
+			ts = sfp_get_ipa_latest_ts(ts_orig, ts_repl);
+			if (ts == sfp_ct->ts) {
+				list_move_tail(&sfp_ct->ipa_lru, &idle);
+				continue;
+			}
+
+			sfp_ct->ts = ts;
+			WRITE_ONCE(sfp_ct->expires,
+				   jiffies + sfp_ipa_aging_time(sfp_ct));
+			list_move_tail(&sfp_ct->ipa_lru, &active);
+			batch[cnt++] = sfp_ct;
+			if (cnt == IPA_SYNC_BATCH)
+				break;
+		}
+
+		/* whole list scanned, idle ones go first for eviction */
+		if (cnt < IPA_SYNC_BATCH) {
+			list_splice_init(&idle, &fwd_tbl.lru_list);
+			list_splice_tail_init(&active, &fwd_tbl.lru_list);
+		}
+		spin_unlock_bh(&fwd_tbl.sp_lock);
+
+		/* a conntrack put may end in our delete path, so no sp_lock */
+		for (i = 0; i < cnt; i++)
+			sfp_refresh_nfl_ct(
+				&batch[i]->tuplehash[IP_CT_DIR_ORIGINAL].tuple,
+				sfp_ipa_aging_time(batch[i]));
+	} while (cnt == IPA_SYNC_BATCH);
+	rcu_read_unlock_bh();
+
+	FP_PRT_DBG(FP_PRT_INFO, "ipa sync, %d entries, %u evicted\n",
+		   sfp_entry_cnt(), fwd_tbl.evict_cnt);
+
+	queue_delayed_work(system_power_efficient_wq, &fwd_tbl.sync_work,
+			   IPA_UPD_TBL_TIMER);
+}
+
 void sfp_ipa_init(void)
 {
 	spin_lock_init(&fwd_tbl.sp_lock);
 	atomic_set(&fwd_tbl.entry_cnt, 0);
 	fwd_tbl.op_flag = IPA_HASH_APPEND;
 	fwd_tbl.append_cnt = 0;
+	INIT_LIST_HEAD(&fwd_tbl.lru_list);
+	fwd_tbl.evict_cnt = 0;
 
 	sfp_init_ipa_tbl();
+
+	INIT_DELAYED_WORK(&fwd_tbl.sync_work, sfp_ipa_sync_work_fn);
+	queue_delayed_work(system_power_efficient_wq, &fwd_tbl.sync_work,
+			   IPA_UPD_TBL_TIMER);
 }
 
 bool sfp_ipa_ipv6_check(const struct sk_buff *skb,
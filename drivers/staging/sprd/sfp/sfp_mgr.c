@@ -38,8 +38,8 @@
 #include <net/netfilter/nf_conntrack_core.h>
 #include <linux/netfilter/nf_conntrack_common.h>
 #include <net/net_namespace.h>
-#include <linux/timer.h>
 #include <linux/skbuff.h>
+#include <linux/workqueue.h>
 #include <linux/spinlock.h>
 #include <linux/string.h>
 #include <linux/platform_device.h>
@@ -146,8 +146,6 @@ static void sfp_mgr_fwd_entry_free(struct rcu_head *head)
 	if (sfp_ct && atomic_dec_and_test(&sfp_ct->used)) {
 		FP_PRT_DBG(FP_PRT_WARN, "sfp_ct free %p\n", sfp_ct);
 		kfree(sfp_ct);
-	} else {
-		del_timer(&sfp_ct->timeout);
 	}
 }
 
@@ -167,6 +165,9 @@ int sfp_mgr_fwd_entry_delete(const struct nf_conntrack_tuple *tuple)
 
 		sfp_sync_with_nfl_ct(tuple);
 		sfp_ct = sfp_ct_tuplehash_to_ctrack(tuple_hash);
+		/* the aging work may be expiring it right now */
+		if (atomic_xchg(&sfp_ct->del, 1))
+			break;
 
 		if (!get_sfp_tether_scheme()) {
 			spin_lock_bh(&fwd_tbl.sp_lock);
@@ -200,57 +201,122 @@ int sfp_mgr_fwd_entry_delete(const struct nf_conntrack_tuple *tuple)
 	return 0;
 }
 
-static void sfp_mgr_fwd_death_by_timeout(unsigned long ul_fwd_entry_conn)
-{
-	struct sfp_conn *sfp_entry;
-
-	sfp_entry = (struct sfp_conn *)ul_fwd_entry_conn;
+/*
+ * Aging of the manager entries. The packet paths only move the deadline
+ * of a connection forward, a single work scans the table every
+ * SFP_AGING_INTERVAL and removes what expired, up to SFP_AGING_BATCH
+ * connections under one hold of the table locks.
+ */
+#define SFP_AGING_INTERVAL	HZ
+#define SFP_AGING_BATCH		32
 
-	if (!sfp_entry) {
-		FP_PRT_DBG(FP_PRT_ERR, "sfp_entry was free when time out.\n");
-		return;
-	}
+static struct delayed_work sfp_aging_work;
 
-	FP_PRT_DBG(FP_PRT_DEBUG, "SFP:<<check death by timeout(%p)>>.\n",
-		   sfp_entry);
+static void sfp_mgr_fwd_expire_batch(struct sfp_conn **batch, int cnt)
+{
+	struct sfp_conn *sfp_entry;
+	int i, n = 0;
 
 	if (!get_sfp_tether_scheme()) {
 		spin_lock_bh(&fwd_tbl.sp_lock);
-		if (!sfp_ipa_tbl_timeout(sfp_entry)) {
-			spin_unlock_bh(&fwd_tbl.sp_lock);
-			return;
-		}
+		for (i = 0; i < cnt; i++) {
+			sfp_entry = batch[i];
+			/* the hardware still forwards it, keep it */
+			if (!sfp_ipa_tbl_timeout(sfp_entry) ||
+			    atomic_xchg(&sfp_entry->del, 1))
+				continue;
 
-		FP_PRT_DBG(FP_PRT_DEBUG, "time out: delete ipa entry %p\n",
-			   sfp_entry);
-		sfp_ipa_fwd_delete(&sfp_entry->tuplehash[IP_CT_DIR_ORIGINAL],
-				   sfp_entry->hash[IP_CT_DIR_ORIGINAL]);
-		sfp_ipa_fwd_delete(&sfp_entry->tuplehash[IP_CT_DIR_REPLY],
-				   sfp_entry->hash[IP_CT_DIR_REPLY]);
+			FP_PRT_DBG(FP_PRT_DEBUG,
+				   "time out: delete ipa entry %p\n",
+				   sfp_entry);
+			sfp_ipa_fwd_delete(
+				&sfp_entry->tuplehash[IP_CT_DIR_ORIGINAL],
+				sfp_entry->hash[IP_CT_DIR_ORIGINAL]);
+			sfp_ipa_fwd_delete(
+				&sfp_entry->tuplehash[IP_CT_DIR_REPLY],
+				sfp_entry->hash[IP_CT_DIR_REPLY]);
+			batch[n++] = sfp_entry;
+		}
 		spin_unlock_bh(&fwd_tbl.sp_lock);
 		spin_lock_bh(&mgr_lock);
 	} else {
 		spin_lock_bh(&mgr_lock);
-		delete_in_sfp_fwd_table(
-			&sfp_entry->tuplehash[IP_CT_DIR_ORIGINAL]);
-		delete_in_sfp_fwd_table(
-			&sfp_entry->tuplehash[IP_CT_DIR_REPLY]);
+		for (i = 0; i < cnt; i++) {
+			sfp_entry = batch[i];
+			if (atomic_xchg(&sfp_entry->del, 1))
+				continue;
+
+			delete_in_sfp_fwd_table(
+				&sfp_entry->tuplehash[IP_CT_DIR_ORIGINAL]);
+			delete_in_sfp_fwd_table(
+				&sfp_entry->tuplehash[IP_CT_DIR_REPLY]);
+			batch[n++] = sfp_entry;
+		}
 	}
 
-	FP_PRT_TRUPLE_INFO(FP_PRT_DEBUG,
-			   &sfp_entry->tuplehash[IP_CT_DIR_ORIGINAL].tuple);
-	FP_PRT_TRUPLE_INFO(FP_PRT_DEBUG,
-			   &sfp_entry->tuplehash[IP_CT_DIR_REPLY].tuple);
-
-	hlist_del_rcu(&sfp_entry->tuplehash[IP_CT_DIR_ORIGINAL].entry_lst);
-	call_rcu_bh(&sfp_entry->tuplehash[IP_CT_DIR_ORIGINAL].rcu,
-		 sfp_mgr_fwd_entry_free);
-	hlist_del_rcu(&sfp_entry->tuplehash[IP_CT_DIR_REPLY].entry_lst);
-	call_rcu_bh(&sfp_entry->tuplehash[IP_CT_DIR_REPLY].rcu,
-		 sfp_mgr_fwd_entry_free);
+	for (i = 0; i < n; i++) {
+		sfp_entry = batch[i];
+		FP_PRT_DBG(FP_PRT_DEBUG,
+			   "SFP:<<check death by timeout(%p)>>.\n", sfp_entry);
+		FP_PRT_TRUPLE_INFO(FP_PRT_DEBUG,
+				   &sfp_entry->tuplehash[IP_CT_DIR_ORIGINAL].tuple);
+		FP_PRT_TRUPLE_INFO(FP_PRT_DEBUG,
+				   &sfp_entry->tuplehash[IP_CT_DIR_REPLY].tuple);
+
+		hlist_del_rcu(&sfp_entry->tuplehash[IP_CT_DIR_ORIGINAL].entry_lst);
+		call_rcu_bh(&sfp_entry->tuplehash[IP_CT_DIR_ORIGINAL].rcu,
+			    sfp_mgr_fwd_entry_free);
+		hlist_del_rcu(&sfp_entry->tuplehash[IP_CT_DIR_REPLY].entry_lst);
+		call_rcu_bh(&sfp_entry->tuplehash[IP_CT_DIR_REPLY].rcu,
+			    sfp_mgr_fwd_entry_free);
+	}
 	spin_unlock_bh(&mgr_lock);
 }
 
+/* One pass over the manager table, returns the connections found expired */
+int sfp_mgr_age(void)
+{
+	struct sfp_conn *batch[SFP_AGING_BATCH];
+	struct sfp_mgr_fwd_tuple_hash *tuple_hash;
+	struct sfp_conn *sfp_ct;
+	int i, cnt = 0, expired = 0;
+
+	rcu_read_lock_bh();
+	for (i = 0; i < SFP_ENTRIES_HASH_SIZE; i++) {
+		hlist_for_each_entry_rcu(tuple_hash,
+					 &mgr_fwd_entries[i],
+					 entry_lst) {
+			/* each connection is linked once per direction */
+			if (tuple_hash->tuple.dst.dir != IP_CT_DIR_ORIGINAL)
+				continue;
+
+			sfp_ct = sfp_ct_tuplehash_to_ctrack(tuple_hash);
+			if (time_before(jiffies, READ_ONCE(sfp_ct->expires)) ||
+			    atomic_read(&sfp_ct->del))
+				continue;
+
+			batch[cnt++] = sfp_ct;
+			if (cnt == SFP_AGING_BATCH) {
+				sfp_mgr_fwd_expire_batch(batch, cnt);
+				expired += cnt;
+				cnt = 0;
+			}
+		}
+	}
+	if (cnt)
+		sfp_mgr_fwd_expire_batch(batch, cnt);
+	rcu_read_unlock_bh();
+
+	return expired + cnt;
+}
+
+static void sfp_mgr_aging_work_fn(struct work_struct *work)
+{
+	sfp_mgr_age();
+	queue_delayed_work(system_power_efficient_wq, &sfp_aging_work,
+			   SFP_AGING_INTERVAL);
+}
+
 int sfp_tuple_to_fwd_entries(struct nf_conntrack_tuple *tuple,
 			     struct nf_conntrack_tuple *target_tuple,
 			     struct sfp_mgr_fwd_tuple *fwd_entry)
@@ -509,19 +575,16 @@ int sfp_ct_init(struct nf_conn *ct, struct sfp_conn *sfp_ct)
 	fwd_tuple2 = &sfp_ct->tuplehash[IP_CT_DIR_REPLY].ssfp_fwd_tuple;
 	sfp_tuple_to_fwd_entries(tuple2, tuple1, fwd_tuple2);
 
-	setup_timer(&sfp_ct->timeout,
-		    sfp_mgr_fwd_death_by_timeout,
-		    (unsigned long)sfp_ct);
-
 	if (tuple1->dst.protonum == IP_L4_PROTO_TCP)
-		sfp_ct->timeout.expires = jiffies + sysctl_tcp_aging_time;
+		sfp_ct->expires = jiffies + sysctl_tcp_aging_time;
 	else
-		sfp_ct->timeout.expires = jiffies + sysctl_udp_aging_time;
+		sfp_ct->expires = jiffies + sysctl_udp_aging_time;
 
 	atomic_set(&sfp_ct->used, 2);
+	atomic_set(&sfp_ct->del, 0);
+	INIT_LIST_HEAD(&sfp_ct->ipa_lru);
 	sfp_ct->sfp_status |= SFP_CT_FLAG_WHOLE;
 	sfp_ct->insert_flag = 1;
-	add_timer(&sfp_ct->timeout);
 
 	rcu_read_unlock_bh();
 
@@ -554,7 +617,8 @@ static int create_mgr_fwd_entries_in_forward(struct sk_buff *skb,
 					     int in_ifindex,
 					     int out_ifindex,
 					     int in_ipaifindex,
-					     int out_ipaifindex)
+					     int out_ipaifindex,
+					     u8 orig_flags)
 {
 	struct sfp_conn *new_sfp_ct;
 	struct sfp_mgr_fwd_tuple_hash *tuple_hash;
@@ -601,6 +665,7 @@ static int create_mgr_fwd_entries_in_forward(struct sk_buff *skb,
 	tuple_hash->ssfp_fwd_tuple.out_ifindex = out_ifindex;
 	tuple_hash->ssfp_fwd_tuple.in_ipaifindex = in_ipaifindex;
 	tuple_hash->ssfp_fwd_tuple.out_ipaifindex = out_ipaifindex;
+	tuple_hash->ssfp_fwd_tuple.fwd_flags |= orig_flags;
 
 	tuple_hash = &new_sfp_ct->tuplehash[IP_CT_DIR_REPLY];
 	tuple_hash->ssfp_fwd_tuple.in_ifindex = out_ifindex;
@@ -721,6 +786,9 @@ int sfp_filter_mgr_fwd_create_entries(u8 pf, struct sk_buff *skb)
 	int in_ifindex;
 	int out_ifindex;
 	int out_ipaifindex, in_ipaifindex;
+	struct net_device *in_dev, *out_dev;
+	int clat_ifindex = 0;
+	u8 orig_flags = 0;
 	u8  l4proto;
 	int dir;
 
@@ -769,7 +837,26 @@ int sfp_filter_mgr_fwd_create_entries(u8 pf, struct sk_buff *skb)
 		return 0;
 	}
 
-	if (sfp_clatd_dev_check(rt->dst.dev)) {
+	if (dir == IP_CT_DIR_REPLY) {
+		in_dev = rt->dst.dev;
+		out_dev = skb->dev;
+	} else {
+		in_dev = skb->dev;
+		out_dev = rt->dst.dev;
+	}
+
+	/*
+	 * Flows to clatd are translated by sfp itself if clatd told us its
+	 * addresses. The ipa cannot translate, and only tcp and udp map
+	 * one to one between the families.
+	 */
+	if (sfp_clatd_dev_check(out_dev) && get_sfp_tether_scheme() &&
+	    pf == PF_INET &&
+	    (l4proto == IPPROTO_TCP || l4proto == IPPROTO_UDP))
+		clat_ifindex = sfp_clat_v6_ifindex(out_dev);
+
+	if (sfp_clatd_dev_check(in_dev) ||
+	    (sfp_clatd_dev_check(out_dev) && !clat_ifindex)) {
 		FP_PRT_DBG(FP_PRT_DEBUG,
 			   "clatd check failed, wont create sfp\n");
 		return 0;
@@ -798,24 +885,24 @@ int sfp_filter_mgr_fwd_create_entries(u8 pf, struct sk_buff *skb)
 		return 0;
 	}
 
-	if (dir == IP_CT_DIR_REPLY) {
-		out_ifindex = skb->dev->ifindex;
-		in_ifindex = rt->dst.dev->ifindex;
-		out_ipaifindex = get_hw_iface_by_dev(skb->dev);
-		in_ipaifindex = get_hw_iface_by_dev(rt->dst.dev);
-	} else {
-		in_ifindex = skb->dev->ifindex;
-		out_ifindex = rt->dst.dev->ifindex;
-		in_ipaifindex = get_hw_iface_by_dev(skb->dev);
-		out_ipaifindex = get_hw_iface_by_dev(rt->dst.dev);
+	in_ifindex = in_dev->ifindex;
+	out_ifindex = out_dev->ifindex;
+	in_ipaifindex = get_hw_iface_by_dev(in_dev);
+	out_ipaifindex = get_hw_iface_by_dev(out_dev);
+
+	/* translated packets skip the tun device */
+	if (clat_ifindex) {
+		out_ifindex = clat_ifindex;
+		orig_flags |= SFP_FWD_FLAG_CLAT;
 	}
 
 	FP_PRT_DBG(FP_PRT_DEBUG, "iface info [%s %d, %s %d] [%d, %d], dir %d\n",
-		   rt->dst.dev->name, in_ifindex, skb->dev->name,
+		   in_dev->name, in_ifindex, out_dev->name,
 		   out_ifindex, in_ipaifindex, out_ipaifindex, dir);
 	create_mgr_fwd_entries_in_forward(skb, ct,
 					  in_ifindex, out_ifindex,
-					  in_ipaifindex, out_ipaifindex);
+					  in_ipaifindex, out_ipaifindex,
+					  orig_flags);
 
 	return 0;
 }
@@ -943,10 +1030,8 @@ int sfp_mgr_fwd_ct_tcp_sure(struct nf_conn *ct)
 				dir = curr_fwd_hash->tuple.dst.dir;
 				target_hash = &sfp_ct->tuplehash[!dir];
 
-				sfp_ct->timeout.expires =
-					jiffies + SFP_TCP_ESTABLISHED_TIME;
-				mod_timer(&sfp_ct->timeout,
-					  sfp_ct->timeout.expires);
+				WRITE_ONCE(sfp_ct->expires,
+					   jiffies + SFP_TCP_ESTABLISHED_TIME);
 				FP_PRT_DBG(FP_PRT_DEBUG,
 					   "insert new fwd entry [%u]\n", hash);
 				FP_PRT_TRUPLE_INFO(FP_PRT_DEBUG,
@@ -1073,6 +1158,10 @@ static int sfp_if_netdev_event_handler(
 			   ifindex);
 		sfp_clear_fwd_table(ifindex);
 		break;
+	case NETDEV_UNREGISTER:
+		/* the fast path entries hold the egress device */
+		sfp_fwd_table_flush_dev(dev);
+		break;
 	}
 	return NOTIFY_DONE;
 }
@@ -1098,16 +1187,18 @@ void sfp_mgr_proc_disable(void)
 
 	if (!get_sfp_tether_scheme())
 		sfp_ipa_fwd_clear();
-	else
-		/*Clear fwd table*/
-		clear_sfp_fwd_table();
+	/*
+	 * Clear fwd table, also after a scheme switch, its entries hold
+	 * device references and the notifier is gone now.
+	 */
+	clear_sfp_fwd_table();
 	/*Clear mgr table*/
 	clear_sfp_mgr_table();
 }
 EXPORT_SYMBOL(sfp_mgr_proc_disable);
 
 /* Initialize sfp entries hash table. */
-void sfp_entries_hash_init(void)
+int sfp_entries_hash_init(void)
 {
 	int i;
 
@@ -1116,9 +1207,10 @@ void sfp_entries_hash_init(void)
 		INIT_HLIST_HEAD(&mgr_fwd_entries[i]);
 		if (!get_sfp_tether_scheme())
 			INIT_HLIST_HEAD(&fwd_tbl.sfp_fwd_entries[i]);
-		else
-			INIT_HLIST_HEAD(&sfp_fwd_entries[i]);
 	}
+
+	/* the tether scheme can be switched later, always set it up */
+	return sfp_fwd_table_init();
 }
 
 static struct device sfp_ipa_dev;
@@ -1147,12 +1239,24 @@ void sfp_ipa_dev_init(void)
 /* Initialize sfp manager */
 int sfp_mgr_init(void)
 {
+	int err;
+
 	spin_lock_init(&mgr_lock);
-	sfp_entries_hash_init();
+	err = sfp_entries_hash_init();
+	if (err) {
+		FP_PRT_DBG(FP_PRT_ERR, "fwd table init failed %d\n", err);
+		return SFP_FAIL;
+	}
+	INIT_DELAYED_WORK(&sfp_aging_work, sfp_mgr_aging_work_fn);
+	queue_delayed_work(system_power_efficient_wq, &sfp_aging_work,
+			   SFP_AGING_INTERVAL);
 	if (!get_sfp_tether_scheme()) {
 		sfp_ipa_dev_init();
 		sfp_ipa_init();
 	}
+	sfp_clat_init();
+	if (sfp_stats_init())
+		FP_PRT_DBG(FP_PRT_ERR, "no fast path statistics\n");
 	sfp_proc_create();
 	if (sysctl_net_sfp_enable == 1)
 		sfp_mgr_proc_enable();
@@ -1173,6 +1277,11 @@ static int __init init_sfp_module(void)
 static void __exit exit_sfp_module(void)
 {
 	sfp_mgr_disable();
+	cancel_delayed_work_sync(&sfp_aging_work);
+	sfp_clat_exit();
+	sfp_stats_exit();
+	if (!get_sfp_tether_scheme())
+		cancel_delayed_work_sync(&fwd_tbl.sync_work);
 }
 
 late_initcall(init_sfp_module);
@@ -14,6 +14,7 @@
 #include <linux/module.h>
 #include <linux/proc_fs.h>
 #include <linux/seq_file.h>
+#include <linux/uaccess.h>
 #include <linux/ip.h>
 #include <linux/in.h>
 #include <net/route.h>
@@ -28,8 +29,10 @@ static struct proc_dir_entry *sfp_proc_debug;
 static struct proc_dir_entry *sfp_proc_fwd;
 static struct proc_dir_entry *sfp_proc_enable;
 static struct proc_dir_entry *sfp_proc_tether_scheme;
+static struct proc_dir_entry *sfp_proc_clat;
 #ifdef CONFIG_SPRD_SFP_TEST
 static struct proc_dir_entry *sfp_test;
+static struct proc_dir_entry *sfp_bench;
 #endif
 
 unsigned int fp_dbg_lvl = FP_PRT_ALL;
@@ -155,79 +158,75 @@ void procdebugprint_macaddr(struct seq_file *seq, const u8 *macaddr)
 
 void procdebugprint_fwd_info(struct seq_file *seq, struct sfp_fwd_entry *tuple)
 {
-	struct sfp_trans_tuple *sfp_tuple;
+	struct sfp_trans_tuple sfp_tuple;
 
-	sfp_tuple = &tuple->ssfp_trans_tuple;
-	procdebugprint_fwd_info_2(seq, sfp_tuple);
+	sfp_tuple = tuple->ssfp_trans_tuple;
+	sfp_tuple.count = sfp_fwd_entry_count(tuple);
+	procdebugprint_fwd_info_2(seq, &sfp_tuple);
 }
 
 /********sfp mgr fwd show********************************/
 static int sfp_fwd_proc_show(struct seq_file *seq, void *v)
 {
-	struct hlist_node *n;
-	struct sfp_fwd_entry *curr_entry;
-	struct sfpfwd_iter_state *st = seq->private;
+	struct sfp_fwd_entry *curr_entry = v;
+	struct sfp_fwd_walk_state *st = seq->private;
 
-	n = (struct hlist_node *)v;
 	seq_printf(seq, "SFP Forward Entry index[%d]-hash[%u]:\n",
-		   st->count++, st->bucket);
-	curr_entry = hlist_entry(n, struct sfp_fwd_entry, entry_lst);
+		   st->count++, sfp_hash_conntrack(&curr_entry->tuple));
 	procdebugprint_fwd_info(seq, curr_entry);
 
 	return 0;
 }
 
-static void *sfp_fwd_get_next(struct seq_file *s, void *v)
+static void *sfp_fwd_get_next(struct seq_file *s)
 {
-	struct sfp_mgr_fwd_iter_state *st = s->private;
-	struct hlist_node *n;
+	struct sfp_fwd_walk_state *st = s->private;
+	struct sfp_fwd_entry *entry;
 
-	n = (struct hlist_node *)v;
-	n = hlist_next_rcu(n);
-	if (!n) {
-		while (!n && (++st->bucket) < SFP_ENTRIES_HASH_SIZE) {
-			n = rcu_dereference(hlist_first_rcu(
-				    &sfp_fwd_entries[st->bucket]));
-			if (n)
-				return n;
-		}
-	}
-	return n;
+	do {
+		entry = rhashtable_walk_next(&st->hti);
+	} while (IS_ERR(entry) && PTR_ERR(entry) == -EAGAIN);
+
+	return entry;
 }
 
 static void *sfp_fwd_seq_next(struct seq_file *s, void *v, loff_t *pos)
 {
-	return sfp_fwd_get_next(s, v);
+	++*pos;
+	return sfp_fwd_get_next(s);
 }
 
-static void *sfp_fwd_get_first(struct seq_file *seq, loff_t *pos)
+static void *sfp_fwd_seq_start(struct seq_file *seq, loff_t *pos)
+	__acquires(RCU)
 {
-	struct sfp_mgr_fwd_iter_state *st = seq->private;
-	struct hlist_node *n;
+	struct sfp_fwd_walk_state *st = seq->private;
+	void *entry;
+	loff_t n;
 
-	if (st->bucket == SFP_ENTRIES_HASH_SIZE)
-		return NULL;
+	rhashtable_walk_enter(&sfp_fwd_rht, &st->hti);
+	st->walking = true;
+	rhashtable_walk_start(&st->hti);
 
-	for (; st->bucket < SFP_ENTRIES_HASH_SIZE; st->bucket++) {
-		n = rcu_dereference(
-			hlist_first_rcu(&sfp_fwd_entries[st->bucket]));
-		if (n)
-			return n;
-	}
-	return NULL;
-}
+	entry = sfp_fwd_get_next(seq);
+	for (n = *pos; n && entry && !IS_ERR(entry); n--)
+		entry = sfp_fwd_get_next(seq);
+	if (!*pos)
+		st->count = 0;
 
-static void *sfp_fwd_seq_start(struct seq_file *seq, loff_t *pos)
-	__acquires(RCU)
-{
-	rcu_read_lock();
-	return sfp_fwd_get_first(seq, pos);
+	return entry;
 }
 
 static void sfp_fwd_seq_stop(struct seq_file *s, void *v)
 	__releases(RCU)
 {
-	rcu_read_unlock();
+	struct sfp_fwd_walk_state *st = s->private;
+
+	if (!st->walking)
+		return;
+
+	rhashtable_walk_stop(&st->hti);
+	rhashtable_walk_exit(&st->hti);
+	st->walking = false;
 }
 
 static const struct seq_operations sfp_fwd_ops = {
@@ -241,7 +240,7 @@ static int sfp_fwd_opt_proc_open(struct inode *inode, struct file *file)
 {
 	return seq_open_private(file,
 				&sfp_fwd_ops,
-				sizeof(struct sfpfwd_iter_state));
+				sizeof(struct sfp_fwd_walk_state));
 }
 
 static const struct file_operations proc_sfp_file_fwd_ops = {
@@ -370,6 +369,48 @@ static const struct file_operations proc_sfp_file_test_ops = {
 	.llseek  = seq_lseek,
 	.release = single_release,
 };
+
+static int sfp_bench_proc_show(struct seq_file *seq, void *v)
+{
+	sfp_bench_show(seq);
+	return 0;
+}
+
+/* "flows pkts_per_cpu cpumask [miss_pct]", cpumask in hex */
+static ssize_t sfp_bench_proc_write(struct file *file,
+				    const char __user *buffer,
+				    size_t count,
+				    loff_t *pos)
+{
+	u32 flows, pkts, cpus, miss_pct = 0;
+	char buf[64];
+	int ret;
+
+	if (count >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, buffer, count))
+		return -EFAULT;
+	buf[count] = '\0';
+
+	if (sscanf(buf, "%u %u %x %u", &flows, &pkts, &cpus, &miss_pct) < 3)
+		return -EINVAL;
+
+	ret = sfp_bench_run(flows, pkts, cpus, miss_pct);
+	return ret ? ret : count;
+}
+
+static int sfp_bench_proc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sfp_bench_proc_show, NULL);
+}
+
+static const struct file_operations proc_sfp_file_bench_ops = {
+	.open  = sfp_bench_proc_open,
+	.read  = seq_read,
+	.write  = sfp_bench_proc_write,
+	.llseek  = seq_lseek,
+	.release = single_release,
+};
 #endif
 
 /********Mgr_fp fwd show********************************/
@@ -393,7 +434,7 @@ static int sfp_mgr_fwd_proc_show(struct seq_file *seq, void *v)
 	entry_info2 = &sfp_ct->tuplehash[IP_CT_DIR_REPLY];
 	procdebugprint_mgr_fwd_info(seq, &entry_info2->ssfp_fwd_tuple);
 	seq_printf(seq, "\ttime=%ld",
-		   (sfp_ct->timeout.expires - jiffies) / HZ);
+		   (long)(READ_ONCE(sfp_ct->expires) - jiffies) / HZ);
 	seq_puts(seq, "\n");
 	return 0;
 }
@@ -580,6 +621,16 @@ int sfp_proc_create(void)
 		goto no_tether_scheme_entry;
 	}
 
+	sfp_proc_clat = proc_create_data("clat", proc_nfp_perms,
+					 procdir,
+					 &sfp_clat_proc_fops,
+					 NULL);
+	if (!sfp_proc_clat) {
+		pr_err("nfp: failed to create sfp/clat file\n");
+		ret = -ENOMEM;
+		goto no_clat_entry;
+	}
+
 #ifdef CONFIG_SPRD_SFP_TEST
 	sfp_test = proc_create_data("test", proc_nfp_perms,
 				    procdir,
@@ -591,22 +642,36 @@ int sfp_proc_create(void)
 		ret = -ENOMEM;
 		goto no_test_entry;
 	}
+
+	sfp_bench = proc_create_data("bench", proc_nfp_perms,
+				     procdir,
+				     &proc_sfp_file_bench_ops,
+				     NULL);
+	if (!sfp_bench) {
+		pr_err("nfp: failed to create sfp/bench file\n");
+		ret = -ENOMEM;
+		goto no_bench_entry;
+	}
 #endif
 	return 0;
 #ifdef CONFIG_SPRD_SFP_TEST
+no_bench_entry:
+	remove_proc_entry("test", procdir);
 no_test_entry:
-	remove_proc_entry("debug", procdir);
+	remove_proc_entry("clat", procdir);
 #endif
-no_tether_scheme_entry:
+no_clat_entry:
 	remove_proc_entry("tether_scheme", procdir);
-no_enable_entry:
-	remove_proc_entry("enable", procdir);
+no_tether_scheme_entry:
+	remove_proc_entry("debug", procdir);
 no_debug_entry:
+	remove_proc_entry("enable", procdir);
+no_enable_entry:
 	remove_proc_entry("sfp_fwd_entries", procdir);
 no_fwd_entry:
 	remove_proc_entry("mgr_fwd_entries", procdir);
 no_mgr_fwd_entry:
-	remove_proc_entry("sfp", NULL);
+	remove_proc_entry("sfp", init_net.proc_net);
 no_dir:
 	return ret;
 #endif
@@ -615,7 +680,9 @@ EXPORT_SYMBOL(sfp_proc_create);
 
 int nfp_proc_exit(void)
 {
+	remove_proc_entry("bench", procdir);
 	remove_proc_entry("test", procdir);
+	remove_proc_entry("clat", procdir);
 	remove_proc_entry("debug", procdir);
 	remove_proc_entry("tether_scheme", procdir);
 	remove_proc_entry("enable", procdir);
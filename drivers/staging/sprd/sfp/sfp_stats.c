@@ -0,0 +1,326 @@
+/*
+ * Copyright (C) 2019 Spreadtrum Communications Inc.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Fast path counters. Every cpu counts into its own copy, a reader sums
+ * them up, so the per packet cost is a few local increments. Interface
+ * pairs get a slot on each cpu the first time they show up, pairs beyond
+ * SFP_STATS_PAIRS are summed into one overflow pair.
+ */
+
+#include <linux/kernel.h>
+#include <linux/types.h>
+#include <linux/percpu.h>
+#include <linux/slab.h>
+#include <linux/u64_stats_sync.h>
+#include <net/genetlink.h>
+
+#include "sfp.h"
+#include "sfp_stats.h"
+
+#define SFP_STATS_PAIRS		8
+
+struct sfp_stats_pair {
+	int in_ifindex;
+	int out_ifindex;
+	u64 packets;
+	u64 bytes;
+};
+
+struct sfp_pcpu_stats {
+	u64 hit;
+	u64 miss;
+	u64 fallback[NUM_SFP_STATS_FB];
+	u64 lookup_ns[SFP_STATS_LOOKUP_BUCKETS];
+	struct sfp_stats_pair pair[SFP_STATS_PAIRS];
+	struct sfp_stats_pair overflow;
+	struct u64_stats_sync syncp;
+};
+
+static struct sfp_pcpu_stats __percpu *sfp_stats;
+static struct genl_family sfp_stats_nl_family;
+
+/* The counters are optional, the fast path runs without them */
+static inline struct sfp_pcpu_stats *sfp_stats_this_cpu(void)
+{
+	return likely(sfp_stats) ? this_cpu_ptr(sfp_stats) : NULL;
+}
+
+void sfp_stats_miss(void)
+{
+	struct sfp_pcpu_stats *st = sfp_stats_this_cpu();
+
+	if (!st)
+		return;
+
+	u64_stats_update_begin(&st->syncp);
+	st->miss++;
+	u64_stats_update_end(&st->syncp);
+}
+
+void sfp_stats_fallback(enum sfp_stats_fallback reason)
+{
+	struct sfp_pcpu_stats *st = sfp_stats_this_cpu();
+
+	if (!st)
+		return;
+
+	u64_stats_update_begin(&st->syncp);
+	st->fallback[reason]++;
+	u64_stats_update_end(&st->syncp);
+}
+
+void sfp_stats_lookup(u64 ns)
+{
+	struct sfp_pcpu_stats *st = sfp_stats_this_cpu();
+	int bucket = min_t(int, fls64(ns >> 6), SFP_STATS_LOOKUP_BUCKETS - 1);
+
+	if (!st)
+		return;
+
+	u64_stats_update_begin(&st->syncp);
+	st->lookup_ns[bucket]++;
+	u64_stats_update_end(&st->syncp);
+}
+
+void sfp_stats_hit(int in_ifindex, int out_ifindex, unsigned int len)
+{
+	struct sfp_pcpu_stats *st = sfp_stats_this_cpu();
+	struct sfp_stats_pair *pair;
+	int i;
+
+	if (!st)
+		return;
+
+	pair = &st->overflow;
+	for (i = 0; i < SFP_STATS_PAIRS; i++) {
+		if (st->pair[i].in_ifindex == in_ifindex &&
+		    st->pair[i].out_ifindex == out_ifindex) {
+			pair = &st->pair[i];
+			break;
+		}
+		if (!st->pair[i].in_ifindex) {
+			pair = &st->pair[i];
+			break;
+		}
+	}
+
+	u64_stats_update_begin(&st->syncp);
+	st->hit++;
+	if (!pair->in_ifindex && pair != &st->overflow) {
+		pair->in_ifindex = in_ifindex;
+		pair->out_ifindex = out_ifindex;
+	}
+	pair->packets++;
+	pair->bytes += len;
+	u64_stats_update_end(&st->syncp);
+}
+
+static void sfp_stats_pair_sum(struct sfp_stats_pair *sum, int *cnt, int max,
+			       const struct sfp_stats_pair *pair)
+{
+	int i;
+
+	if (!pair->packets)
+		return;
+
+	for (i = 0; i < *cnt; i++)
+		if (sum[i].in_ifindex == pair->in_ifindex &&
+		    sum[i].out_ifindex == pair->out_ifindex)
+			break;
+
+	if (i == *cnt) {
+		/* the overflow pair is always the first one */
+		if (*cnt == max)
+			i = 0;
+		else
+			sum[(*cnt)++] = (struct sfp_stats_pair){
+				.in_ifindex = pair->in_ifindex,
+				.out_ifindex = pair->out_ifindex,
+			};
+	}
+
+	sum[i].packets += pair->packets;
+	sum[i].bytes += pair->bytes;
+}
+
+static int sfp_stats_nl_put_array(struct sk_buff *msg, int attr,
+				  const u64 *val, int n)
+{
+	struct nlattr *nest;
+	int i;
+
+	nest = nla_nest_start(msg, attr);
+	if (!nest)
+		return -EMSGSIZE;
+
+	for (i = 0; i < n; i++)
+		if (nla_put_u64_64bit(msg, i + 1, val[i], SFP_STATS_ATTR_PAD))
+			return -EMSGSIZE;
+
+	nla_nest_end(msg, nest);
+	return 0;
+}
+
+static int sfp_stats_nl_put_pairs(struct sk_buff *msg,
+				  const struct sfp_stats_pair *sum, int cnt)
+{
+	struct nlattr *nest, *pair;
+	int i;
+
+	nest = nla_nest_start(msg, SFP_STATS_ATTR_PAIRS);
+	if (!nest)
+		return -EMSGSIZE;
+
+	for (i = 0; i < cnt; i++) {
+		if (!sum[i].packets)
+			continue;
+
+		pair = nla_nest_start(msg, SFP_STATS_ATTR_PAIR);
+		if (!pair ||
+		    nla_put_u32(msg, SFP_STATS_ATTR_IN_IFINDEX,
+				sum[i].in_ifindex) ||
+		    nla_put_u32(msg, SFP_STATS_ATTR_OUT_IFINDEX,
+				sum[i].out_ifindex) ||
+		    nla_put_u64_64bit(msg, SFP_STATS_ATTR_PACKETS,
+				      sum[i].packets, SFP_STATS_ATTR_PAD) ||
+		    nla_put_u64_64bit(msg, SFP_STATS_ATTR_BYTES,
+				      sum[i].bytes, SFP_STATS_ATTR_PAD))
+			return -EMSGSIZE;
+		nla_nest_end(msg, pair);
+	}
+
+	nla_nest_end(msg, nest);
+	return 0;
+}
+
+static int sfp_stats_nl_get(struct sk_buff *skb, struct genl_info *info)
+{
+	u64 fallback[NUM_SFP_STATS_FB] = {};
+	u64 lookup_ns[SFP_STATS_LOOKUP_BUCKETS] = {};
+	struct sfp_stats_pair *sum;
+	u64 hit = 0, miss = 0;
+	struct sk_buff *msg;
+	int cpu, i, cnt = 1, max;
+	void *hdr;
+	int err = -EMSGSIZE;
+
+	if (!sfp_stats)
+		return -ENODEV;
+
+	max = SFP_STATS_PAIRS * 2 + 1;
+	sum = kcalloc(max, sizeof(*sum), GFP_KERNEL);
+	if (!sum)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		const struct sfp_pcpu_stats *st = per_cpu_ptr(sfp_stats, cpu);
+		struct sfp_pcpu_stats snap;
+		unsigned int start;
+
+		do {
+			start = u64_stats_fetch_begin_irq(&st->syncp);
+			memcpy(&snap, st, offsetof(struct sfp_pcpu_stats,
+						   syncp));
+		} while (u64_stats_fetch_retry_irq(&st->syncp, start));
+
+		hit += snap.hit;
+		miss += snap.miss;
+		for (i = 0; i < NUM_SFP_STATS_FB; i++)
+			fallback[i] += snap.fallback[i];
+		for (i = 0; i < SFP_STATS_LOOKUP_BUCKETS; i++)
+			lookup_ns[i] += snap.lookup_ns[i];
+
+		sum[0].packets += snap.overflow.packets;
+		sum[0].bytes += snap.overflow.bytes;
+		for (i = 0; i < SFP_STATS_PAIRS; i++)
+			sfp_stats_pair_sum(sum, &cnt, max, &snap.pair[i]);
+	}
+
+	msg = genlmsg_new(NLMSG_DEFAULT_SIZE, GFP_KERNEL);
+	if (!msg) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	hdr = genlmsg_put_reply(msg, info, &sfp_stats_nl_family, 0,
+				SFP_STATS_CMD_GET);
+	if (!hdr)
+		goto nla_fail;
+
+	if (nla_put_u64_64bit(msg, SFP_STATS_ATTR_HIT, hit,
+			      SFP_STATS_ATTR_PAD) ||
+	    nla_put_u64_64bit(msg, SFP_STATS_ATTR_MISS, miss,
+			      SFP_STATS_ATTR_PAD) ||
+	    sfp_stats_nl_put_array(msg, SFP_STATS_ATTR_FALLBACK,
+				   fallback, NUM_SFP_STATS_FB) ||
+	    sfp_stats_nl_put_array(msg, SFP_STATS_ATTR_LOOKUP_NS,
+				   lookup_ns, SFP_STATS_LOOKUP_BUCKETS) ||
+	    sfp_stats_nl_put_pairs(msg, sum, cnt))
+		goto nla_fail;
+
+	genlmsg_end(msg, hdr);
+	kfree(sum);
+	return genlmsg_reply(msg, info);
+
+nla_fail:
+	nlmsg_free(msg);
+out:
+	kfree(sum);
+	return err;
+}
+
+static const struct genl_ops sfp_stats_nl_ops[] = {
+	{
+		.cmd = SFP_STATS_CMD_GET,
+		.doit = sfp_stats_nl_get,
+	},
+};
+
+static struct genl_family sfp_stats_nl_family = {
+	.hdrsize = 0,
+	.name = SFP_STATS_GENL_NAME,
+	.version = SFP_STATS_GENL_VERSION,
+	.maxattr = SFP_STATS_ATTR_MAX,
+	.netnsok = false,
+	.ops = sfp_stats_nl_ops,
+	.n_ops = ARRAY_SIZE(sfp_stats_nl_ops),
+	.module = THIS_MODULE,
+};
+
+int sfp_stats_init(void)
+{
+	int cpu, err;
+
+	sfp_stats = alloc_percpu(struct sfp_pcpu_stats);
+	if (!sfp_stats)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu)
+		u64_stats_init(&per_cpu_ptr(sfp_stats, cpu)->syncp);
+
+	err = genl_register_family(&sfp_stats_nl_family);
+	if (err) {
+		free_percpu(sfp_stats);
+		sfp_stats = NULL;
+	}
+
+	return err;
+}
+
+void sfp_stats_exit(void)
+{
+	genl_unregister_family(&sfp_stats_nl_family);
+	free_percpu(sfp_stats);
+	sfp_stats = NULL;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2019 Spreadtrum Communications Inc.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#ifndef __SFP_STATS_H__
+#define __SFP_STATS_H__
+
+/*
+ * Generic netlink interface of the fast path counters. SFP_STATS_CMD_GET
+ * returns the counters summed over all cpus since boot, userspace works
+ * out the rates from two samples.
+ */
+#define SFP_STATS_GENL_NAME	"sfp_stats"
+#define SFP_STATS_GENL_VERSION	1
+
+enum sfp_stats_nl_command {
+	SFP_STATS_CMD_UNSPEC,
+	SFP_STATS_CMD_GET,
+
+	/* keep last */
+	NUM_SFP_STATS_CMD,
+	SFP_STATS_CMD_MAX = NUM_SFP_STATS_CMD - 1
+};
+
+enum sfp_stats_nl_attribute {
+	SFP_STATS_ATTR_UNSPEC,
+	SFP_STATS_ATTR_PAD,
+
+	/* u64, packets forwarded by the fast path */
+	SFP_STATS_ATTR_HIT,
+	/* u64, packets without a forward entry */
+	SFP_STATS_ATTR_MISS,
+	/* nested, u64 per enum sfp_stats_fallback, attr type = reason + 1 */
+	SFP_STATS_ATTR_FALLBACK,
+	/*
+	 * nested, u64 per lookup time bucket, attr type = bucket + 1.
+	 * Bucket n counts the lookups faster than 64 << n ns, the last
+	 * one all slower lookups.
+	 */
+	SFP_STATS_ATTR_LOOKUP_NS,
+	/* nested, one SFP_STATS_ATTR_PAIR per interface pair */
+	SFP_STATS_ATTR_PAIRS,
+	SFP_STATS_ATTR_PAIR,
+	/* SFP_STATS_ATTR_PAIR attributes */
+	SFP_STATS_ATTR_IN_IFINDEX,	/* u32, 0 for the overflow pair */
+	SFP_STATS_ATTR_OUT_IFINDEX,	/* u32 */
+	SFP_STATS_ATTR_PACKETS,		/* u64 */
+	SFP_STATS_ATTR_BYTES,		/* u64 */
+
+	/* keep last */
+	NUM_SFP_STATS_ATTR,
+	SFP_STATS_ATTR_MAX = NUM_SFP_STATS_ATTR - 1
+};
+
+/* Why a packet offered to the fast path went to the stack */
+enum sfp_stats_fallback {
+	SFP_STATS_FB_BANNED_DEV,	/* ingress device not offloaded */
+	SFP_STATS_FB_NOMEM,		/* could not be linearized */
+	SFP_STATS_FB_L3_PROTO,		/* neither ipv4 nor ipv6 */
+	SFP_STATS_FB_L4_PROTO,		/* no tcp, udp or icmp echo */
+	SFP_STATS_FB_TCP_FLAGS,		/* fin or rst */
+	SFP_STATS_FB_CLAT,		/* cannot be translated */
+
+	/* keep last */
+	NUM_SFP_STATS_FB
+};
+
+#define SFP_STATS_LOOKUP_BUCKETS	16
+
+#endif
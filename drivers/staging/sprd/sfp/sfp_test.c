@@ -20,6 +20,12 @@
 #include <linux/netfilter/nf_conntrack_common.h>
 #include <linux/timer.h>
 #include <linux/skbuff.h>
+#include <linux/udp.h>
+#include <linux/vmalloc.h>
+#include <linux/completion.h>
+#include <linux/mutex.h>
+#include <linux/seq_file.h>
+#include <linux/sched/clock.h>
 
 #include "sfp.h"
 #include "sfp_ipa.h"
@@ -359,8 +365,8 @@ static void sfp_ipa_tbl_add_delete(void)
 
 		sfp_mgr_hash_test_init(&ct, new_sfp_ct);
 
-		/*stop timer in this case*/
-		del_timer(&new_sfp_ct->timeout);
+		/*keep the aging work away in this case*/
+		new_sfp_ct->expires = jiffies + MAX_JIFFY_OFFSET;
 
 		sfp_ipa_hash_add(new_sfp_ct);
 
@@ -400,8 +406,8 @@ static void sfp_ipa_tbl_hash_collision(void)
 
 		sfp_mgr_hash_test_init(&ct, new_sfp_ct);
 
-		/*stop timer in this case*/
-		del_timer(&new_sfp_ct->timeout);
+		/*keep the aging work away in this case*/
+		new_sfp_ct->expires = jiffies + MAX_JIFFY_OFFSET;
 
 		sfp_ipa_hash_add(new_sfp_ct);
 
@@ -445,8 +451,8 @@ static void sfp_ipa_tbl_add_2048(int n)
 
 		sfp_mgr_hash_test_init(&ct, new_sfp_ct);
 
-		/*stop timer in this case*/
-		del_timer(&new_sfp_ct->timeout);
+		/*keep the aging work away in this case*/
+		new_sfp_ct->expires = jiffies + MAX_JIFFY_OFFSET;
 
 		sfp_ipa_hash_add(new_sfp_ct);
 		msleep(20);
@@ -605,3 +611,302 @@ int sfp_test_init(int count)
 	}
 	return 0;
 }
+
+/*
+ * Benchmark of the software fast path. sfp_bench_run() adds @flows
+ * synthetic udp connections between 10.11.x.x and 10.12.0.1 on the
+ * loopback device, replays @pkts packets per cpu of @cpus through
+ * soft_fastpath_process(), @miss_pct percent of them to flows which are
+ * not in the table, then times one aging pass with all the flows alive
+ * and one which expires them all. The last result is shown by
+ * sfp_bench_show().
+ */
+#define SFP_BENCH_MAX_FLOWS	(32 * 1024)
+#define SFP_BENCH_SADDR		0x0A0B0000
+#define SFP_BENCH_DADDR		0x0A0C0001
+#define SFP_BENCH_SPORT		1024
+#define SFP_BENCH_DPORT		12345
+#define SFP_BENCH_PORTS		60000
+#define SFP_BENCH_PKT_LEN	128
+#define SFP_BENCH_BATCH		64
+
+struct sfp_bench_worker {
+	struct completion done;
+	u32 pkts;
+	u32 miss_pct;
+	u32 flows;
+	u64 sent;
+	u64 hits;
+	u64 ns;
+};
+
+struct sfp_bench_result {
+	u32 flows;
+	u32 added;
+	u32 cpus;
+	u32 miss_pct;
+	u64 add_ns;
+	u64 pkts;
+	u64 hits;
+	u64 cpu_ns;	/* summed over the cpus */
+	u64 wall_ns;
+	u64 age_scan_ns;
+	u64 age_expire_ns;
+	u32 expired;
+};
+
+static DEFINE_MUTEX(sfp_bench_lock);
+static struct sfp_bench_result sfp_bench_res;
+
+static void sfp_bench_flow_tuple(u32 flow, struct tuple_info *ti)
+{
+	ti->ip1 = SFP_BENCH_SADDR + flow / SFP_BENCH_PORTS;
+	ti->ip2 = SFP_BENCH_SADDR + flow / SFP_BENCH_PORTS;
+	ti->ip3 = SFP_BENCH_DADDR;
+	ti->s_port = SFP_BENCH_SPORT + flow % SFP_BENCH_PORTS;
+	ti->d_port = SFP_BENCH_DPORT;
+	ti->protonum = IPPROTO_UDP;
+}
+
+static struct sfp_conn *sfp_bench_add_flow(struct nf_conn *ct, u32 flow,
+					   int ifindex)
+{
+	struct sfp_mgr_fwd_tuple_hash *tuple_hash;
+	struct sfp_conn *sfp_ct;
+	struct tuple_info ti;
+	int dir;
+
+	sfp_ct = kzalloc(sizeof(*sfp_ct), GFP_KERNEL);
+	if (!sfp_ct)
+		return NULL;
+
+	sfp_bench_flow_tuple(flow, &ti);
+	make_ct_tuple(&ti, ct);
+	sfp_ct_init(ct, sfp_ct);
+	sfp_test_init_mac(sfp_ct);
+	/* only sfp_bench_run() expires them */
+	sfp_ct->expires = jiffies + MAX_JIFFY_OFFSET;
+
+	spin_lock_bh(&mgr_lock);
+	for (dir = IP_CT_DIR_ORIGINAL; dir < IP_CT_DIR_MAX; dir++) {
+		tuple_hash = &sfp_ct->tuplehash[dir];
+		tuple_hash->ssfp_fwd_tuple.in_ifindex = ifindex;
+		tuple_hash->ssfp_fwd_tuple.out_ifindex = ifindex;
+		sfp_ct->hash[dir] = sfp_hash_conntrack(&tuple_hash->tuple);
+		hlist_add_head_rcu(&tuple_hash->entry_lst,
+				   &mgr_fwd_entries[sfp_ct->hash[dir]]);
+	}
+	sfp_fwd_hash_add(sfp_ct);
+	spin_unlock_bh(&mgr_lock);
+
+	return sfp_ct;
+}
+
+/* lay out the original direction packet of @flow at skb->data */
+static void sfp_bench_fill_pkt(struct sk_buff *skb, u8 *data, u32 flow)
+{
+	struct tuple_info ti;
+	struct iphdr *iph;
+	struct udphdr *udph;
+
+	skb->data = data;
+	skb->len = SFP_BENCH_PKT_LEN;
+	skb_set_tail_pointer(skb, SFP_BENCH_PKT_LEN);
+	skb->dev = init_net.loopback_dev;
+
+	sfp_bench_flow_tuple(flow, &ti);
+	iph = (struct iphdr *)data;
+	memset(iph, 0, sizeof(*iph) + sizeof(*udph));
+	iph->version = 4;
+	iph->ihl = 5;
+	iph->ttl = 64;
+	iph->protocol = IPPROTO_UDP;
+	iph->tot_len = htons(SFP_BENCH_PKT_LEN);
+	iph->saddr = htonl(ti.ip1);
+	iph->daddr = htonl(ti.ip3);
+	iph->check = ip_fast_csum((u8 *)iph, iph->ihl);
+
+	udph = (struct udphdr *)(iph + 1);
+	udph->source = htons(ti.s_port);
+	udph->dest = htons(ti.d_port);
+	udph->len = htons(SFP_BENCH_PKT_LEN - sizeof(*iph));
+}
+
+static int sfp_bench_worker_fn(void *arg)
+{
+	struct sfp_bench_worker *w = arg;
+	struct sk_buff *skb;
+	u32 rnd = sfp_rand(), flow, i, j;
+	u64 start;
+	u8 *data;
+	int len, out_if;
+
+	skb = alloc_skb(NET_SKB_PAD + ETH_HLEN + SFP_BENCH_PKT_LEN,
+			GFP_KERNEL);
+	if (!skb)
+		goto out;
+	skb_reserve(skb, NET_SKB_PAD + ETH_HLEN);
+	skb->protocol = htons(ETH_P_IP);
+	data = skb->data;
+
+	for (i = 0; i < w->pkts; i += SFP_BENCH_BATCH) {
+		local_bh_disable();
+		for (j = i; j < w->pkts && j < i + SFP_BENCH_BATCH; j++) {
+			/* a random flow each time, as the cache would see it */
+			rnd = rnd * 1664525 + 1013904223;
+			flow = (rnd >> 8) % w->flows;
+			if ((rnd & 0xff) * 100 < w->miss_pct * 256)
+				flow += SFP_BENCH_MAX_FLOWS;
+			sfp_bench_fill_pkt(skb, data, flow);
+			len = skb->len;
+
+			start = local_clock();
+			if (!soft_fastpath_process(SFP_INTERFACE_USB, skb,
+						   NULL, &len, &out_if))
+				w->hits++;
+			w->ns += local_clock() - start;
+			w->sent++;
+		}
+		local_bh_enable();
+		cond_resched();
+	}
+	kfree_skb(skb);
+out:
+	complete(&w->done);
+	return 0;
+}
+
+/* replay on every cpu of @cpus at once, returns the wall time */
+static u64 sfp_bench_replay(struct sfp_bench_result *res, u32 pkts, u32 cpus)
+{
+	struct sfp_bench_worker *w;
+	struct task_struct *tsk;
+	u64 start;
+	int cpu;
+
+	w = kcalloc(nr_cpu_ids, sizeof(*w), GFP_KERNEL);
+	if (!w)
+		return 0;
+
+	start = local_clock();
+	for_each_online_cpu(cpu) {
+		if (cpu >= 32 || !(cpus & BIT(cpu)))
+			continue;
+
+		init_completion(&w[cpu].done);
+		w[cpu].pkts = pkts;
+		w[cpu].flows = res->added;
+		w[cpu].miss_pct = res->miss_pct;
+		tsk = kthread_create(sfp_bench_worker_fn, &w[cpu],
+				     "sfp_bench/%d", cpu);
+		if (IS_ERR(tsk)) {
+			w[cpu].pkts = 0;
+			continue;
+		}
+		kthread_bind(tsk, cpu);
+		wake_up_process(tsk);
+		res->cpus |= BIT(cpu);
+	}
+
+	for (cpu = 0; cpu < nr_cpu_ids; cpu++) {
+		if (!w[cpu].pkts)
+			continue;
+		wait_for_completion(&w[cpu].done);
+		res->pkts += w[cpu].sent;
+		res->hits += w[cpu].hits;
+		res->cpu_ns += w[cpu].ns;
+	}
+	kfree(w);
+
+	return local_clock() - start;
+}
+
+int sfp_bench_run(u32 flows, u32 pkts, u32 cpus, u32 miss_pct)
+{
+	struct sfp_bench_result *res = &sfp_bench_res;
+	struct sfp_conn **conns;
+	struct net_device *dev = init_net.loopback_dev;
+	struct nf_conn *ct;
+	u64 start;
+	u32 i;
+
+	if (!flows || flows > SFP_BENCH_MAX_FLOWS || !pkts || !cpus ||
+	    miss_pct > 100)
+		return -EINVAL;
+
+	/* the ipa scheme forwards in hardware, nothing to measure here */
+	if (!get_sfp_tether_scheme() || !get_sfp_enable())
+		return -EOPNOTSUPP;
+
+	conns = vzalloc(flows * sizeof(*conns));
+	ct = kmalloc(sizeof(*ct), GFP_KERNEL);
+	if (!conns || !ct) {
+		vfree(conns);
+		kfree(ct);
+		return -ENOMEM;
+	}
+
+	mutex_lock(&sfp_bench_lock);
+	memset(res, 0, sizeof(*res));
+	res->flows = flows;
+	res->miss_pct = miss_pct;
+
+	start = local_clock();
+	for (i = 0; i < flows; i++) {
+		conns[i] = sfp_bench_add_flow(ct, i, dev->ifindex);
+		if (!conns[i])
+			break;
+	}
+	res->add_ns = local_clock() - start;
+	res->added = i;
+
+	if (res->added)
+		res->wall_ns = sfp_bench_replay(res, pkts, cpus);
+
+	/* nothing is expired yet, this is the plain scan */
+	start = local_clock();
+	sfp_mgr_age();
+	res->age_scan_ns = local_clock() - start;
+
+	for (i = 0; i < res->added; i++)
+		WRITE_ONCE(conns[i]->expires, jiffies - 1);
+	start = local_clock();
+	res->expired = sfp_mgr_age();
+	res->age_expire_ns = local_clock() - start;
+	mutex_unlock(&sfp_bench_lock);
+
+	kfree(ct);
+	vfree(conns);
+	return 0;
+}
+
+void sfp_bench_show(struct seq_file *seq)
+{
+	struct sfp_bench_result *res = &sfp_bench_res;
+
+	mutex_lock(&sfp_bench_lock);
+	if (!res->flows) {
+		seq_puts(seq, "no run\n");
+		goto out;
+	}
+
+	seq_printf(seq, "flows: %u added, %u asked, %llu ns per add\n",
+		   res->added, res->flows,
+		   res->added ? div_u64(res->add_ns, res->added) : 0);
+	seq_printf(seq, "replay: cpus 0x%x, %llu pkts, miss %u%%\n",
+		   res->cpus, res->pkts, res->miss_pct);
+	if (res->pkts && res->wall_ns)
+		seq_printf(seq, "replay: %llu hits (%llu.%llu%%), %llu ns per pkt, %llu kpps\n",
+			   res->hits,
+			   div64_u64(res->hits * 100, res->pkts),
+			   div64_u64(res->hits * 1000, res->pkts) % 10,
+			   div64_u64(res->cpu_ns, res->pkts),
+			   div64_u64(res->pkts * (NSEC_PER_SEC / 1000),
+				     res->wall_ns));
+	seq_printf(seq, "aging: %llu us per scan, %llu us to expire %u\n",
+		   div_u64(res->age_scan_ns, NSEC_PER_USEC),
+		   div_u64(res->age_expire_ns, NSEC_PER_USEC),
+		   res->expired);
+out:
+	mutex_unlock(&sfp_bench_lock);
+}
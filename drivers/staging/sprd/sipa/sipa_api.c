@@ -346,12 +346,45 @@ static const struct file_operations sipa_local_drv_fops = {
 
 struct sipa_control *s_sipa_ctrl;
 
-static void sipa_resume_for_pamu3(struct sipa_control *ctrl)
+/**
+ * sipa_resume_fifo_state() - Restore glb reg and common fifo after suspend
+ * @ctrl: s_sipa_ctrl
+ *
+ * In retention mode the IPA power domain normally keeps its registers and
+ * iram, then the fifos are used as they are, without restoring the backed
+ * up nodes or refilling the free fifos. Otherwise, or when the state was
+ * lost anyway, everything is rebuilt from the backup.
+ */
+static void sipa_resume_fifo_state(struct sipa_control *ctrl)
 {
 	int i;
 	sipa_hal_hdl hdl = ctrl->ctx->hdl;
 	struct sipa_plat_drv_cfg *cfg = &ctrl->params_cfg;
 	struct sipa_common_fifo_cfg *fifo = cfg->common_fifo_cfg;
+
+	if (cfg->retention) {
+		if (sipa_hal_fifo_state_retained(hdl)) {
+			cfg->retained_cnt++;
+			return;
+		}
+		dev_warn(ctrl->ctx->pdev,
+			 "ipa state lost in retention, reinit fifo\n");
+	}
+
+	for (i = 0; i < SIPA_FIFO_MAX; i++)
+		if (fifo[i].tx_fifo.in_iram &&
+		    fifo[i].rx_fifo.in_iram)
+			sipa_hal_resume_fifo_node(hdl, i);
+
+	sipa_resume_glb_reg_cfg(cfg);
+	if (cfg->tft_mode)
+		sipa_tft_mode_init(hdl);
+	sipa_resume_common_fifo(hdl, cfg);
+}
+
+static void sipa_resume_for_pamu3(struct sipa_control *ctrl)
+{
+	struct sipa_plat_drv_cfg *cfg = &ctrl->params_cfg;
 	struct sipa_skb_receiver **receiver = ctrl->receiver;
 
 	mutex_lock(&ctrl->resume_lock);
@@ -364,15 +397,7 @@ static void sipa_resume_for_pamu3(struct sipa_control *ctrl)
 		goto early_resume;
 
 	if (ctrl->suspend_stage & SIPA_BACKUP_SUSPEND) {
-		for (i = 0; i < SIPA_FIFO_MAX; i++)
-			if (fifo[i].tx_fifo.in_iram &&
-			    fifo[i].rx_fifo.in_iram)
-				sipa_hal_resume_fifo_node(hdl, i);
-
-		sipa_resume_glb_reg_cfg(cfg);
-		if (cfg->tft_mode)
-			sipa_tft_mode_init(hdl);
-		sipa_resume_common_fifo(hdl, &ctrl->params_cfg);
+		sipa_resume_fifo_state(ctrl);
 		ctrl->suspend_stage &= ~SIPA_BACKUP_SUSPEND;
 	}
 
@@ -401,11 +426,9 @@ early_resume:
  */
 static void sipa_prepare_resume(struct sipa_control *ctrl)
 {
-	int i;
 	struct sipa_endpoint *ep;
 	sipa_hal_hdl hdl = ctrl->ctx->hdl;
 	struct sipa_plat_drv_cfg *cfg = &ctrl->params_cfg;
-	struct sipa_common_fifo_cfg *fifo = cfg->common_fifo_cfg;
 	struct sipa_skb_receiver **receiver = ctrl->receiver;
 
 	mutex_lock(&ctrl->resume_lock);
@@ -423,15 +446,7 @@ static void sipa_prepare_resume(struct sipa_control *ctrl)
 		goto early_resume;
 
 	if (ctrl->suspend_stage & SIPA_BACKUP_SUSPEND) {
-		for (i = 0; i < SIPA_FIFO_MAX; i++)
-			if (fifo[i].tx_fifo.in_iram &&
-			    fifo[i].rx_fifo.in_iram)
-				sipa_hal_resume_fifo_node(hdl, i);
-
-		sipa_resume_glb_reg_cfg(cfg);
-		if (cfg->tft_mode)
-			sipa_tft_mode_init(hdl);
-		sipa_resume_common_fifo(hdl, &ctrl->params_cfg);
+		sipa_resume_fifo_state(ctrl);
 		ctrl->suspend_stage &= ~SIPA_BACKUP_SUSPEND;
 	}
 
@@ -814,6 +829,48 @@ set_recv:
 }
 EXPORT_SYMBOL(sipa_pam_connect);
 
+int sipa_pam_set_intr_threshold(enum sipa_ep_id id, u32 send_cnt,
+				u32 recv_cnt)
+{
+	struct sipa_control *ctrl = sipa_get_ctrl_pointer();
+	struct sipa_endpoint *ep = ctrl->eps[id];
+
+	if (!ep || !ep->inited)
+		return -ENODEV;
+
+	ep->send_fifo_param.tx_intr_threshold = send_cnt;
+	ep->recv_fifo_param.tx_intr_threshold = recv_cnt;
+	sipa_hal_set_cmn_fifo_intr_threshold(ep->sipa_ctx->hdl,
+					     ep->send_fifo.idx, send_cnt);
+	sipa_hal_set_cmn_fifo_intr_threshold(ep->sipa_ctx->hdl,
+					     ep->recv_fifo.idx, recv_cnt);
+
+	return 0;
+}
+EXPORT_SYMBOL(sipa_pam_set_intr_threshold);
+
+int sipa_pam_get_backlog(enum sipa_ep_id id, u32 *send, u32 *recv)
+{
+	struct sipa_control *ctrl = sipa_get_ctrl_pointer();
+	struct sipa_endpoint *ep = ctrl->eps[id];
+
+	if (!ep || !ep->connected)
+		return -ENODEV;
+
+	/* the fifo registers are gone while ipa is powered down */
+	if (!ctrl->params_cfg.enable_cnt || ctrl->suspend_stage ||
+	    ep->suspended)
+		return -EAGAIN;
+
+	sipa_hal_get_cmn_fifo_filled_depth(ep->sipa_ctx->hdl,
+					   ep->send_fifo.idx, NULL, send);
+	sipa_hal_get_cmn_fifo_filled_depth(ep->sipa_ctx->hdl,
+					   ep->recv_fifo.idx, recv, NULL);
+
+	return 0;
+}
+EXPORT_SYMBOL(sipa_pam_get_backlog);
+
 int sipa_ext_open_pcie(struct sipa_pcie_open_params *in)
 {
 	struct sipa_control *ctrl = sipa_get_ctrl_pointer();
@@ -1065,6 +1122,11 @@ static int sipa_parse_dts_configuration(struct platform_device *pdev,
 	cfg->pcie_dl_dma = of_property_read_bool(pdev->dev.of_node,
 						 "sprd,pcie-dl-dma");
 
+	/* ipa power domain keeps its state across suspend */
+	cfg->retention =
+		of_property_read_bool(pdev->dev.of_node,
+				      "sprd,ipa-retention");
+
 	/* get tft mode flag */
 	cfg->tft_mode =
 		of_property_read_bool(pdev->dev.of_node,
@@ -1515,7 +1577,7 @@ static void sipa_notify_sender_flow_ctrl(struct work_struct *work)
 	for (i = 0; i < SIPA_PKT_TYPE_MAX; i++)
 		if (sipa_ctrl->sender[i] &&
 		    sipa_ctrl->sender[i]->free_notify_net)
-			wake_up(&sipa_ctrl->sender[i]->free_waitq);
+			sipa_skb_sender_kick(sipa_ctrl->sender[i]);
 }
 
 static void sipa_prepare_suspend_work(struct sipa_control *ctrl)
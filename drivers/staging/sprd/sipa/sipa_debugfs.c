@@ -145,8 +145,8 @@ static int sipa_flow_ctrl_show(struct seq_file *s, void *unused)
 		return 0;
 	}
 
-	seq_printf(s, "[SEND_ETH] left_cnt = %d\n",
-		   atomic_read(&eth_sender->left_cnt));
+	seq_printf(s, "[SEND_ETH] left_cnt = %d unordered_cnt = %d\n",
+		   sipa_skb_sender_free_cnt(eth_sender), eth_sender->unordered_cnt);
 
 	seq_printf(s, "[SEND_ETH] no_mem_cnt = %d no_free_cnt = %d\n",
 		   eth_sender->no_mem_cnt, eth_sender->no_free_cnt);
@@ -157,8 +157,8 @@ static int sipa_flow_ctrl_show(struct seq_file *s, void *unused)
 	seq_printf(s, "[SEND_ETH] exit_flow_ctrl_cnt = %d\n",
 		   eth_sender->exit_flow_ctrl_cnt);
 
-	seq_printf(s, "[SEND_IP] left_cnt = %d\n",
-		   atomic_read(&ip_sender->left_cnt));
+	seq_printf(s, "[SEND_IP] left_cnt = %d unordered_cnt = %d\n",
+		   sipa_skb_sender_free_cnt(ip_sender), ip_sender->unordered_cnt);
 
 	seq_printf(s, "[SEND_IP] no_mem_cnt = %d no_free_cnt = %d\n",
 		   ip_sender->no_mem_cnt, ip_sender->no_free_cnt);
@@ -179,6 +179,11 @@ static int sipa_flow_ctrl_show(struct seq_file *s, void *unused)
 		   atomic_read(&eth_recv->need_sched),
 		   eth_recv->need_sched_cnt);
 
+	seq_printf(s, "[RECV_ETH] pool pages = %d alloc = %d recycle = %d retire = %d build_fail = %d\n",
+		   eth_recv->pool.page_cnt, eth_recv->pool.alloc_cnt,
+		   eth_recv->pool.recycle_cnt, eth_recv->pool.retire_cnt,
+		   eth_recv->pool.build_fail_cnt);
+
 	seq_printf(s, "[RECV_IP] tx_danger_cnt = %d rx_danger_cnt = %d\n",
 		   ip_recv->tx_danger_cnt, ip_recv->rx_danger_cnt);
 
@@ -188,6 +193,11 @@ static int sipa_flow_ctrl_show(struct seq_file *s, void *unused)
 	seq_printf(s, "[RECV_IP] need_sched = %d need_sched_cnt = %d\n",
 		   atomic_read(&ip_recv->need_sched), ip_recv->need_sched_cnt);
 
+	seq_printf(s, "[RECV_IP] pool pages = %d alloc = %d recycle = %d retire = %d build_fail = %d\n",
+		   ip_recv->pool.page_cnt, ip_recv->pool.alloc_cnt,
+		   ip_recv->pool.recycle_cnt, ip_recv->pool.retire_cnt,
+		   ip_recv->pool.build_fail_cnt);
+
 	return 0;
 }
 
@@ -203,33 +213,32 @@ static const struct file_operations sipa_flow_ctrl_fops = {
 	.release = single_release,
 };
 
-static int sipa_no_recycled_show(struct seq_file *s, void *unused)
+static void sipa_no_recycled_show_ring(struct seq_file *s, const char *tag,
+				       struct sipa_skb_sender *sender)
 {
-	struct sipa_control *ipa = s->private;
-	struct sipa_skb_sender *sender;
-	struct sipa_skb_dma_addr_node *iter, *_iter;
-
-	sender = ipa->sender[SIPA_PKT_ETH];
-	if (list_empty(&sender->sending_list)) {
-		seq_puts(s, "[ETH_SEND] sending list is empty\n");
-	} else {
-		list_for_each_entry_safe(iter, _iter,
-					 &sender->sending_list, list)
-			seq_printf(s,
-				   "[ETH_SEND] skb = 0x%p, phy addr = 0x%llx\n",
-				   iter->skb, (u64)iter->dma_addr);
+	struct sipa_skb_dma_addr_node *node;
+	u32 i, head, tail;
+
+	head = READ_ONCE(sender->ring_head);
+	tail = READ_ONCE(sender->ring_tail);
+	if (head == tail) {
+		seq_printf(s, "[%s] sending ring is empty\n", tag);
+		return;
 	}
 
-	sender = ipa->sender[SIPA_PKT_IP];
-	if (list_empty(&sender->sending_list)) {
-		seq_puts(s, "[IP_SEND] sending list is empty\n");
-	} else {
-		list_for_each_entry_safe(iter, _iter,
-					 &sender->sending_list, list)
-			seq_printf(s,
-				   "[IP_SEND] skb = 0x%p, phy addr = 0x%llx\n",
-				   iter->skb, (u64)iter->dma_addr);
+	for (i = tail; i != head; i++) {
+		node = &sender->pair_cache[i & (sender->ring_size - 1)];
+		seq_printf(s, "[%s] skb = 0x%p, phy addr = 0x%llx\n",
+			   tag, node->skb, (u64)node->dma_addr);
 	}
+}
+
+static int sipa_no_recycled_show(struct seq_file *s, void *unused)
+{
+	struct sipa_control *ipa = s->private;
+
+	sipa_no_recycled_show_ring(s, "ETH_SEND", ipa->sender[SIPA_PKT_ETH]);
+	sipa_no_recycled_show_ring(s, "IP_SEND", ipa->sender[SIPA_PKT_IP]);
 
 	return 0;
 }
@@ -248,7 +257,7 @@ static const struct file_operations sipa_no_recycled_fops = {
 
 static int sipa_nic_debug_show(struct seq_file *s, void *unused)
 {
-	int i;
+	int i, j;
 	struct sipa_control *ipa = (struct sipa_control *)s->private;
 
 	seq_printf(s, "suspend_stage = 0x%x recv_cnt = %d\n",
@@ -263,12 +272,13 @@ static int sipa_nic_debug_show(struct seq_file *s, void *unused)
 			   ipa->nic[i]->src_mask,
 			   ipa->nic[i]->netid,
 			   ipa->nic[i]->flow_ctrl_status);
-		seq_printf(s, " qlen = %d need_notify = %d rm_flow_ctrl = %d",
-			   ipa->nic[i]->rx_skb_q.qlen,
-			   ipa->nic[i]->need_notify,
-			   ipa->nic[i]->rm_res.rm_flow_ctrl);
-		seq_printf(s, " continue_notify = %d\n",
+		seq_printf(s, " rm_flow_ctrl = %d continue_notify = %d\n",
+			   ipa->nic[i]->rm_res.rm_flow_ctrl,
 			   ipa->nic[i]->continue_notify);
+		for (j = 0; j < ipa->nic[i]->rx_q_num; j++)
+			seq_printf(s, "  rx_q%d qlen = %d need_notify = %d\n", j,
+				   ipa->nic[i]->rx_q[j].skb_q.qlen,
+				   ipa->nic[i]->rx_q[j].need_notify);
 	}
 
 	return 0;
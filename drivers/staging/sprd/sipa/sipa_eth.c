@@ -32,6 +32,7 @@
 #include <linux/of_device.h>
 #include <linux/interrupt.h>
 #include <linux/spinlock.h>
+#include <linux/sprd_cp_dvfs.h>
 #include <net/tcp.h>
 #include <net/udp.h>
 #include <net/ip.h>
@@ -44,6 +45,8 @@
 #define DEV_OFF 0
 
 #define SIPA_ETH_NAPI_WEIGHT 64
+/* keep one super packet well below the uplink fifo depth */
+#define SIPA_ETH_GSO_MAX_SEGS 64
 #define SIPA_ETH_IFACE_PREF "sipa_eth"
 #define SIPA_ETH_VPCIE_PREF "vpcie"
 #define SIPA_ETH_VPCIE_IDX 8
@@ -52,7 +55,7 @@ static unsigned long queue_lock_flags;
 static spinlock_t queue_lock; /* spin-lock for queue status protection */
 static struct dentry *root;
 static int sipa_eth_debugfs_mknod(void *root, void *data);
-static void sipa_eth_rx_handler (void *priv);
+static void sipa_eth_rx_handler(struct sipa_eth_rxq *rxq);
 static u64 gro_enable;
 
 static inline void sipa_eth_dt_stats_init(struct sipa_eth_dtrans_stats *stats)
@@ -249,35 +252,35 @@ out:
 	skb->dev = dev;
 }
 
-static int sipa_eth_rx(struct SIPA_ETH *sipa_eth, int budget)
+static int sipa_eth_rx(struct sipa_eth_rxq *rxq, int budget)
 {
 	struct sk_buff *skb;
-	struct net_device *dev;
+	struct SIPA_ETH *sipa_eth = rxq->sipa_eth;
 	struct sipa_eth_dtrans_stats *dt_stats;
+	unsigned int rx_bytes = 0;
 	int skb_cnt = 0;
 	int ret;
 
-	dt_stats = &sipa_eth->dt_stats;
+	dt_stats = &rxq->dt_stats;
 
 	if (!sipa_eth) {
 		pr_err("no sipa_eth device\n");
 		return -EINVAL;
 	}
 
-	dev = sipa_eth->netdev;
-	atomic_set(&sipa_eth->rx_evt, 0);
+	atomic_set(&rxq->rx_evt, 0);
 	while (skb_cnt < budget) {
-		ret = sipa_nic_rx(sipa_eth->nic_id, &skb);
+		ret = sipa_nic_rx_queue(sipa_eth->nic_id, rxq->qid, &skb);
 
 		if (ret) {
 			switch (ret) {
 			case -ENODEV:
 				pr_err("fail to find dev");
-				sipa_eth->stats.rx_errors++;
+				rxq->rx_errors++;
 				dt_stats->rx_fail++;
 				break;
 			case -ENODATA:
-				atomic_set(&sipa_eth->rx_busy, 0);
+				atomic_set(&rxq->rx_busy, 0);
 				break;
 			}
 			break;
@@ -290,24 +293,28 @@ static int sipa_eth_rx(struct SIPA_ETH *sipa_eth, int budget)
 
 		sipa_eth_prepare_skb(sipa_eth, skb);
 
-		sipa_eth->stats.rx_packets++;
-		sipa_eth->stats.rx_bytes += skb->len;
+		rxq->rx_packets++;
+		rxq->rx_bytes += skb->len;
+		rx_bytes += skb->len;
 		sipa_eth_rx_stats_update(dt_stats, skb->len);
 
 		if (gro_enable)
-			napi_gro_receive(&sipa_eth->napi, skb);
+			napi_gro_receive(&rxq->napi, skb);
 		else
 			netif_receive_skb(skb);
 
 		skb_cnt++;
 	}
 
+	if (rx_bytes)
+		sprd_cp_dvfs_load_hint(rx_bytes);
+
 	return skb_cnt;
 }
 
 static int sipa_eth_rx_poll_handler(struct napi_struct *napi, int budget)
 {
-	struct SIPA_ETH *sipa_eth = container_of(napi, struct SIPA_ETH, napi);
+	struct sipa_eth_rxq *rxq = container_of(napi, struct sipa_eth_rxq, napi);
 	int tmp = 0, pkts;
 
 	/* If the number of pkt is more than weight(64),
@@ -325,7 +332,7 @@ READ_AGAIN:
 	 * then we goto out, return 64 to napi,
 	 * In that case, we force napi to do polling again.
 	 */
-	pkts = sipa_eth_rx(sipa_eth, budget);
+	pkts = sipa_eth_rx(rxq, budget);
 	tmp += pkts;
 	budget -= pkts;
 	/*
@@ -345,7 +352,7 @@ READ_AGAIN:
 	 * in sipa_nic. if we chose to ignore this event, we may lose
 	 * the chance to receive forever.
 	 */
-	if (atomic_read(&sipa_eth->rx_evt))
+	if (atomic_read(&rxq->rx_evt))
 		goto READ_AGAIN;
 
 	/* If the number of budget is more than 0, it means the pkts
@@ -361,10 +368,10 @@ READ_AGAIN:
 		 * So do rx_handler manually to prevent
 		 * sipa_eth from stopping receiving pkts.
 		 */
-		if (atomic_read(&sipa_eth->rx_evt) || atomic_read(&sipa_eth->rx_busy)) {
+		if (atomic_read(&rxq->rx_evt) || atomic_read(&rxq->rx_busy)) {
 			pr_debug("rx evt recv after napi complete");
-			atomic_set(&sipa_eth->rx_evt, 0);
-			napi_schedule(&sipa_eth->napi);
+			atomic_set(&rxq->rx_evt, 0);
+			napi_schedule(&rxq->napi);
 		}
 	}
 
@@ -372,22 +379,42 @@ out:
 	return tmp;
 }
 
-static void sipa_eth_rx_handler (void *priv)
+/* Runs in IPI context on the cpu owning the rx queue */
+static void sipa_eth_rxq_kick(void *info)
 {
-	struct SIPA_ETH *sipa_eth = (struct SIPA_ETH *)priv;
+	struct sipa_eth_rxq *rxq = (struct sipa_eth_rxq *)info;
 
-	if (!sipa_eth) {
+	napi_schedule(&rxq->napi);
+}
+
+static void sipa_eth_rx_handler(struct sipa_eth_rxq *rxq)
+{
+	int cpu;
+
+	if (!rxq->sipa_eth) {
 		pr_err("data is NULL\n");
 		return;
 	}
 
-	if (!atomic_cmpxchg(&sipa_eth->rx_busy, 0, 1)) {
-		atomic_set(&sipa_eth->rx_evt, 0);
-		napi_schedule(&sipa_eth->napi);
-		/* Trigger a NET_RX_SOFTIRQ softirq directly,
-		 * or there will be a delay
+	if (!atomic_cmpxchg(&rxq->rx_busy, 0, 1)) {
+		atomic_set(&rxq->rx_evt, 0);
+		cpu = get_cpu();
+		/*
+		 * Run the napi of this queue on its own cpu, so that the
+		 * flows hashed to different queues are processed in
+		 * parallel. The csd is free here, since rx_busy is only
+		 * cleared by the napi poll which runs after the kick.
 		 */
-		raise_softirq(NET_RX_SOFTIRQ);
+		if (rxq->cpu < 0 || rxq->cpu == cpu ||
+		    !cpu_online(rxq->cpu) ||
+		    smp_call_function_single_async(rxq->cpu, &rxq->csd)) {
+			napi_schedule(&rxq->napi);
+			/* Trigger a NET_RX_SOFTIRQ softirq directly,
+			 * or there will be a delay
+			 */
+			raise_softirq(NET_RX_SOFTIRQ);
+		}
+		put_cpu();
 	}
 }
 
@@ -410,12 +437,18 @@ static void sipa_eth_notify_cb(void *priv, enum sipa_evt_type evt,
 			       unsigned long data)
 {
 	struct SIPA_ETH *sipa_eth = (struct SIPA_ETH *)priv;
+	struct sipa_eth_rxq *rxq;
 
 	switch (evt) {
 	case SIPA_RECEIVE:
-		pr_debug("dev %s recv SIPA_RECEIVE\n", sipa_eth->netdev->name);
-		atomic_set(&sipa_eth->rx_evt, 1);
-		sipa_eth_rx_handler(priv);
+		/* data is the index of the nic rx queue */
+		pr_debug("dev %s recv SIPA_RECEIVE q%lu\n",
+			 sipa_eth->netdev->name, data);
+		if (data >= sipa_eth->rxq_num)
+			break;
+		rxq = &sipa_eth->rxq[data];
+		atomic_set(&rxq->rx_evt, 1);
+		sipa_eth_rx_handler(rxq);
 		break;
 	case SIPA_LEAVE_FLOWCTRL:
 		pr_info("dev %s SIPA LEAVE FLOWCTRL\n", sipa_eth->netdev->name);
@@ -430,25 +463,16 @@ static void sipa_eth_notify_cb(void *priv, enum sipa_evt_type evt,
 	}
 }
 
-static int sipa_eth_start_xmit(struct sk_buff *skb, struct net_device *dev)
+/* Strip the mac header of a rawip frame and do what the ipa can't */
+static int sipa_eth_tx_prepare(struct SIPA_ETH *sipa_eth, struct sk_buff *skb)
 {
-	struct SIPA_ETH *sipa_eth = netdev_priv(dev);
 	struct sipa_eth_init_data *pdata = sipa_eth->pdata;
-	struct sipa_eth_dtrans_stats *dt_stats;
-	int ret = 0;
-	int netid;
 	struct ethhdr *peth;
 
-	dt_stats = &sipa_eth->dt_stats;
-	if (sipa_eth->state != DEV_ON) {
-		pr_err("called when %s is down\n", dev->name);
-		dt_stats->tx_fail++;
-		netif_carrier_off(dev);
-		dev_kfree_skb_any(skb);
-		return NETDEV_TX_OK;
-	}
+	/* the ipa takes one linear buffer per packet */
+	if (skb_linearize(skb))
+		return -ENOMEM;
 
-	netid = pdata->netid;
 	peth = eth_hdr(skb);
 	/* eth is rawip, so pull 14 bytes */
 	if (!pdata->mac_h)
@@ -464,8 +488,129 @@ static int sipa_eth_start_xmit(struct sk_buff *skb, struct net_device *dev)
 		}
 	}
 
-	ret = sipa_nic_tx(sipa_eth->nic_id, pdata->term_type, netid, skb);
-	if (unlikely(ret != 0)) {
+	return 0;
+}
+
+static void sipa_eth_tx_flowctrl(struct SIPA_ETH *sipa_eth, int err)
+{
+	struct net_device *dev = sipa_eth->netdev;
+
+	spin_lock_irqsave(&queue_lock, queue_lock_flags);
+	if (sipa_nic_check_flow_ctrl(sipa_eth->nic_id)) {
+		netif_stop_queue(dev);
+		pr_info("stop queue on dev %s\n", dev->name);
+	}
+	spin_unlock_irqrestore(&queue_lock, queue_lock_flags);
+	sipa_nic_trigger_flow_ctrl_work(sipa_eth->nic_id, err);
+}
+
+/*
+ * Send the segments of a gso skb. They are linear and keep
+ * CHECKSUM_PARTIAL, so the ipa fills in the checksums, and all of them
+ * go to the fifo with one doorbell. The gso skb is consumed already, so
+ * the segments the fifo has no room for are dropped.
+ */
+static int sipa_eth_tx_gso(struct SIPA_ETH *sipa_eth, struct sk_buff *segs,
+			   bool more)
+{
+	struct sipa_eth_init_data *pdata = sipa_eth->pdata;
+	struct sipa_eth_dtrans_stats *dt_stats = &sipa_eth->dt_stats;
+	struct sk_buff_head list;
+	struct sk_buff *seg, *next;
+	u32 len = 0, cnt = 0;
+	int ret;
+
+	__skb_queue_head_init(&list);
+	for (seg = segs; seg; seg = next) {
+		next = seg->next;
+		seg->next = NULL;
+		if (sipa_eth_tx_prepare(sipa_eth, seg)) {
+			dt_stats->tx_fail++;
+			sipa_eth->netdev->stats.tx_dropped++;
+			dev_kfree_skb_any(seg);
+			continue;
+		}
+		len += seg->len;
+		cnt++;
+		__skb_queue_tail(&list, seg);
+	}
+
+	if (skb_queue_empty(&list))
+		return NETDEV_TX_OK;
+
+	ret = sipa_nic_tx_list(sipa_eth->nic_id, pdata->term_type,
+			       pdata->netid, &list, more);
+	if (unlikely(!skb_queue_empty(&list))) {
+		while ((seg = __skb_dequeue(&list)) != NULL) {
+			len -= seg->len;
+			cnt--;
+			dt_stats->tx_fail++;
+			sipa_eth->stats.tx_errors++;
+			sipa_eth->netdev->stats.tx_dropped++;
+			dev_kfree_skb_any(seg);
+		}
+		if (ret == -EAGAIN || ret == -EINPROGRESS || ret > 0)
+			sipa_eth_tx_flowctrl(sipa_eth, ret > 0 ? -EAGAIN : ret);
+	}
+
+	/* update netdev statistics */
+	sipa_eth->stats.tx_packets += cnt;
+	sipa_eth->stats.tx_bytes += len;
+	dt_stats->tx_sum += len;
+	dt_stats->tx_cnt += cnt;
+
+	return NETDEV_TX_OK;
+}
+
+static int sipa_eth_start_xmit(struct sk_buff *skb, struct net_device *dev)
+{
+	struct SIPA_ETH *sipa_eth = netdev_priv(dev);
+	struct sipa_eth_init_data *pdata = sipa_eth->pdata;
+	struct sipa_eth_dtrans_stats *dt_stats;
+	struct sk_buff_head list;
+	struct sk_buff *segs;
+	int ret = 0;
+	int netid;
+	u32 len;
+	bool more;
+
+	dt_stats = &sipa_eth->dt_stats;
+	if (sipa_eth->state != DEV_ON) {
+		pr_err("called when %s is down\n", dev->name);
+		dt_stats->tx_fail++;
+		netif_carrier_off(dev);
+		dev_kfree_skb_any(skb);
+		return NETDEV_TX_OK;
+	}
+
+	/*
+	 * Ring the fifo doorbell only for the last skb of a batch, a stopped
+	 * queue gets no further skb to do it.
+	 */
+	more = skb->xmit_more &&
+		!netif_xmit_stopped(netdev_get_tx_queue(dev, 0));
+
+	if (skb_is_gso(skb)) {
+		segs = skb_gso_segment(skb, dev->features &
+				       (NETIF_F_IP_CSUM | NETIF_F_IPV6_CSUM));
+		if (IS_ERR(segs))
+			goto err;
+		if (segs) {
+			dev_consume_skb_any(skb);
+			return sipa_eth_tx_gso(sipa_eth, segs, more);
+		}
+	}
+
+	netid = pdata->netid;
+	if (sipa_eth_tx_prepare(sipa_eth, skb))
+		goto err;
+
+	len = skb->len;
+	__skb_queue_head_init(&list);
+	__skb_queue_tail(&list, skb);
+	ret = sipa_nic_tx_list(sipa_eth->nic_id, pdata->term_type, netid,
+			       &list, more);
+	if (unlikely(ret <= 0)) {
 		if (ret == -EAGAIN || ret == -EINPROGRESS) {
 			/*
 			 * resume skb, otherwise
@@ -475,13 +620,7 @@ static int sipa_eth_start_xmit(struct sk_buff *skb, struct net_device *dev)
 				skb_push(skb, ETH_HLEN);
 			dt_stats->tx_fail++;
 			sipa_eth->stats.tx_errors++;
-			spin_lock_irqsave(&queue_lock, queue_lock_flags);
-			if (sipa_nic_check_flow_ctrl(sipa_eth->nic_id)) {
-				netif_stop_queue(dev);
-				pr_info("stop queue on dev %s\n", dev->name);
-			}
-			spin_unlock_irqrestore(&queue_lock, queue_lock_flags);
-			sipa_nic_trigger_flow_ctrl_work(sipa_eth->nic_id, ret);
+			sipa_eth_tx_flowctrl(sipa_eth, ret);
 			return NETDEV_TX_BUSY;
 		}
 		pr_err("fail to send skb, dev 0x%p eth 0x%p nic_id %d, ret %d\n",
@@ -491,8 +630,8 @@ static int sipa_eth_start_xmit(struct sk_buff *skb, struct net_device *dev)
 
 	/* update netdev statistics */
 	sipa_eth->stats.tx_packets++;
-	sipa_eth->stats.tx_bytes += skb->len;
-	sipa_eth_tx_stats_update(dt_stats, skb->len);
+	sipa_eth->stats.tx_bytes += len;
+	sipa_eth_tx_stats_update(dt_stats, len);
 
 	return NETDEV_TX_OK;
 
@@ -507,14 +646,38 @@ static int sipa_eth_open(struct net_device *dev)
 {
 	struct SIPA_ETH *sipa_eth = netdev_priv(dev);
 	struct sipa_eth_init_data *pdata = sipa_eth->pdata;
+	struct sipa_eth_rxq *rxq;
 	int ret = 0;
+	int cpu = -1;
+	u32 i;
 
-	pr_info("dev 0x%p eth 0x%p open %s netid %d term %d mac_h %d\n",
+	pr_info("dev 0x%p eth 0x%p open %s netid %d term %d mac_h %d rxq %u\n",
 		dev, sipa_eth, dev->name, pdata->netid, pdata->term_type,
-		pdata->mac_h);
-	ret = sipa_nic_open(
+		pdata->mac_h, sipa_eth->rxq_num);
+
+	/* spread the rx queues over the online cpus */
+	for (i = 0; i < sipa_eth->rxq_num; i++) {
+		rxq = &sipa_eth->rxq[i];
+		if (sipa_eth->rxq_num == 1) {
+			rxq->cpu = -1;
+		} else {
+			cpu = cpumask_next(cpu, cpu_online_mask);
+			if (cpu >= nr_cpu_ids)
+				cpu = cpumask_first(cpu_online_mask);
+			rxq->cpu = cpu;
+		}
+		atomic_set(&rxq->rx_busy, 0);
+		atomic_set(&rxq->rx_evt, 0);
+		sipa_eth_dt_stats_init(&rxq->dt_stats);
+		rxq->rx_packets = 0;
+		rxq->rx_bytes = 0;
+		rxq->rx_errors = 0;
+	}
+
+	ret = sipa_nic_open_mq(
 		pdata->term_type,
 		pdata->netid,
+		sipa_eth->rxq_num,
 		sipa_eth_notify_cb,
 		(void *)sipa_eth);
 
@@ -532,9 +695,9 @@ static int sipa_eth_open(struct net_device *dev)
 		netif_carrier_on(sipa_eth->netdev);
 	}
 
-	atomic_set(&sipa_eth->rx_busy, 0);
 	netif_start_queue(dev);
-	napi_enable(&sipa_eth->napi);
+	for (i = 0; i < sipa_eth->rxq_num; i++)
+		napi_enable(&sipa_eth->rxq[i].napi);
 
 	return 0;
 }
@@ -543,13 +706,15 @@ static int sipa_eth_open(struct net_device *dev)
 static int sipa_eth_close(struct net_device *dev)
 {
 	struct SIPA_ETH *sipa_eth = netdev_priv(dev);
+	u32 i;
 
 	pr_info("close %s!\n", dev->name);
 
 	sipa_nic_close(sipa_eth->nic_id);
 	sipa_eth->state = DEV_OFF;
 
-	napi_disable(&sipa_eth->napi);
+	for (i = 0; i < sipa_eth->rxq_num; i++)
+		napi_disable(&sipa_eth->rxq[i].napi);
 	netif_stop_queue(dev);
 
 	return 0;
@@ -558,8 +723,19 @@ static int sipa_eth_close(struct net_device *dev)
 static struct net_device_stats *sipa_eth_get_stats(struct net_device *dev)
 {
 	struct SIPA_ETH *sipa_eth = netdev_priv(dev);
+	struct net_device_stats *stats = &sipa_eth->stats;
+	u32 i;
+
+	stats->rx_packets = 0;
+	stats->rx_bytes = 0;
+	stats->rx_errors = 0;
+	for (i = 0; i < sipa_eth->rxq_num; i++) {
+		stats->rx_packets += sipa_eth->rxq[i].rx_packets;
+		stats->rx_bytes += sipa_eth->rxq[i].rx_bytes;
+		stats->rx_errors += sipa_eth->rxq[i].rx_errors;
+	}
 
-	return &sipa_eth->stats;
+	return stats;
 }
 
 static const struct net_device_ops sipa_eth_ops = {
@@ -619,9 +795,15 @@ static int sipa_eth_parse_dt(
 
 	pdata->mac_h = of_property_read_bool(np, "sprd,mac-header");
 
+	/* optional, number of per-cpu rx queues */
+	if (of_property_read_u32(np, "sprd,rx-queues", &udata))
+		udata = 1;
+	pdata->rx_queues = udata;
+
 	*init = pdata;
-	pr_debug("after dt parse, name %s netid %d term-type %d mac_h %d\n",
-		 pdata->name, pdata->netid, pdata->term_type, pdata->mac_h);
+	pr_debug("after dt parse, name %s netid %d term-type %d mac_h %d rxq %u\n",
+		 pdata->name, pdata->netid, pdata->term_type, pdata->mac_h,
+		 pdata->rx_queues);
 	return 0;
 }
 
@@ -646,7 +828,9 @@ static int sipa_eth_probe(struct platform_device *pdev)
 	struct net_device *netdev;
 	struct SIPA_ETH *sipa_eth;
 	char ifname[IFNAMSIZ];
+	struct sipa_eth_rxq *rxq;
 	int ret;
+	u32 i;
 
 	if (pdev->dev.of_node && !pdata) {
 		ret = sipa_eth_parse_dt(&pdata, &pdev->dev);
@@ -684,8 +868,9 @@ static int sipa_eth_probe(struct platform_device *pdev)
 	sipa_eth_dt_stats_init(&sipa_eth->dt_stats);
 	sipa_eth->netdev = netdev;
 	sipa_eth->pdata = pdata;
-	atomic_set(&sipa_eth->rx_busy, 0);
-	atomic_set(&sipa_eth->rx_evt, 0);
+	sipa_eth->rxq_num = clamp_t(u32, pdata->rx_queues, 1,
+				    min_t(u32, num_possible_cpus(),
+					  SIPA_NIC_RX_QUEUE_MAX));
 	netdev->netdev_ops = &sipa_eth_ops;
 	netdev->watchdog_timeo = 1 * HZ;
 	netdev->irq = 0;
@@ -693,19 +878,36 @@ static int sipa_eth_probe(struct platform_device *pdev)
 
 	random_ether_addr(netdev->dev_addr);
 
-	netif_napi_add(netdev,
-		       &sipa_eth->napi,
-		       sipa_eth_rx_poll_handler,
-		       SIPA_ETH_NAPI_WEIGHT);
+	for (i = 0; i < sipa_eth->rxq_num; i++) {
+		rxq = &sipa_eth->rxq[i];
+		rxq->sipa_eth = sipa_eth;
+		rxq->qid = i;
+		rxq->cpu = -1;
+		rxq->csd.func = sipa_eth_rxq_kick;
+		rxq->csd.info = rxq;
+		atomic_set(&rxq->rx_busy, 0);
+		atomic_set(&rxq->rx_evt, 0);
+		netif_napi_add(netdev,
+			       &rxq->napi,
+			       sipa_eth_rx_poll_handler,
+			       SIPA_ETH_NAPI_WEIGHT);
+	}
 	netdev->hw_features |= NETIF_F_RXCSUM | NETIF_F_IP_CSUM |
 		NETIF_F_IPV6_CSUM;
+	/*
+	 * The super packets are segmented in sipa_eth_start_xmit() and
+	 * handed to the fifo in one batch, see sipa_eth_tx_gso().
+	 */
+	netdev->hw_features |= NETIF_F_SG | NETIF_F_TSO | NETIF_F_TSO6;
 	netdev->features = netdev->hw_features;
+	netdev->gso_max_segs = SIPA_ETH_GSO_MAX_SEGS;
 
 	/* Register new Ethernet interface */
 	ret = register_netdev(netdev);
 	if (ret) {
 		pr_err("register_netdev() failed (%d)\n", ret);
-		netif_napi_del(&sipa_eth->napi);
+		for (i = 0; i < sipa_eth->rxq_num; i++)
+			netif_napi_del(&sipa_eth->rxq[i].napi);
 		free_netdev(netdev);
 		return ret;
 	}
@@ -722,8 +924,10 @@ static int sipa_eth_probe(struct platform_device *pdev)
 static int sipa_eth_remove(struct platform_device *pdev)
 {
 	struct SIPA_ETH *sipa_eth = platform_get_drvdata(pdev);
+	u32 i;
 
-	netif_napi_del(&sipa_eth->napi);
+	for (i = 0; i < sipa_eth->rxq_num; i++)
+		netif_napi_del(&sipa_eth->rxq[i].napi);
 	unregister_netdev(sipa_eth->netdev);
 	free_netdev(sipa_eth->netdev);
 	platform_set_drvdata(pdev, NULL);
@@ -751,6 +955,8 @@ static int sipa_eth_debug_show(struct seq_file *m, void *v)
 	struct SIPA_ETH *sipa_eth = (struct SIPA_ETH *)(m->private);
 	struct sipa_eth_dtrans_stats *stats;
 	struct sipa_eth_init_data *pdata;
+	struct sipa_eth_rxq *rxq;
+	u32 i;
 
 	if (!sipa_eth) {
 		pr_err("invalid data, sipa_eth is NULL\n");
@@ -763,15 +969,19 @@ static int sipa_eth_debug_show(struct seq_file *m, void *v)
 	seq_printf(m, "DEVICE: %s, term_type %d, netid %d, state %s mac_h %d\n",
 		   pdata->name, pdata->term_type, pdata->netid,
 		   sipa_eth->state == DEV_ON ? "UP" : "DOWN", pdata->mac_h);
-	seq_puts(m, "\nRX statistics:\n");
-	seq_printf(m, "rx_sum=%u, rx_cnt=%u\n",
-		   stats->rx_sum,
-		   stats->rx_cnt);
-	seq_printf(m, "rx_fail=%u\n",
-		   stats->rx_fail);
-
-	seq_printf(m, "rx_busy=%d\n", atomic_read(&sipa_eth->rx_busy));
-	seq_printf(m, "rx_evt=%d\n", atomic_read(&sipa_eth->rx_evt));
+	for (i = 0; i < sipa_eth->rxq_num; i++) {
+		rxq = &sipa_eth->rxq[i];
+		seq_printf(m, "\nRX queue %u statistics (cpu %d):\n",
+			   i, rxq->cpu);
+		seq_printf(m, "rx_sum=%u, rx_cnt=%u\n",
+			   rxq->dt_stats.rx_sum,
+			   rxq->dt_stats.rx_cnt);
+		seq_printf(m, "rx_fail=%u\n",
+			   rxq->dt_stats.rx_fail);
+
+		seq_printf(m, "rx_busy=%d\n", atomic_read(&rxq->rx_busy));
+		seq_printf(m, "rx_evt=%d\n", atomic_read(&rxq->rx_evt));
+	}
 
 	seq_puts(m, "\nTX statistics:\n");
 	seq_printf(m, "tx_sum=%u, tx_cnt=%u\n",
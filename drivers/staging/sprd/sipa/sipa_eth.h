@@ -3,6 +3,7 @@
 
 #include <linux/sipa.h>
 #include <linux/if.h>
+#include <linux/smp.h>
 
 /* Struct of data transfer statistics */
 struct sipa_eth_dtrans_stats {
@@ -15,14 +16,32 @@ struct sipa_eth_dtrans_stats {
 	u32 tx_fail;
 };
 
+struct SIPA_ETH;
+
+/* Per-cpu receive context, one for each sipa nic rx queue */
+struct sipa_eth_rxq {
+	struct SIPA_ETH *sipa_eth;
+	u32 qid;
+	/* cpu the napi is kicked on, -1 means the notifying cpu */
+	int cpu;
+	call_single_data_t csd;
+	atomic_t rx_busy;
+	atomic_t rx_evt;
+	struct napi_struct napi;/* Napi instance */
+	/* rx part of the data_transfer statistics */
+	struct sipa_eth_dtrans_stats dt_stats;
+	unsigned long rx_packets;
+	unsigned long rx_bytes;
+	unsigned long rx_errors;
+};
+
 /* Device instance data. */
 struct SIPA_ETH {
 	int state;
-	atomic_t rx_busy;
-	atomic_t rx_evt;
 	struct net_device *netdev;/* Linux net device */
 	enum sipa_nic_id nic_id;
-	struct napi_struct napi;/* Napi instance */
+	u32 rxq_num;
+	struct sipa_eth_rxq rxq[SIPA_NIC_RX_QUEUE_MAX];
 	/* Record data_transfer statistics */
 	struct sipa_eth_dtrans_stats dt_stats;
 	struct net_device_stats stats;/* Net statistics */
@@ -34,5 +53,6 @@ struct sipa_eth_init_data {
 	u32 term_type;
 	s32 netid;
 	bool mac_h;
+	u32 rx_queues;
 };
 #endif
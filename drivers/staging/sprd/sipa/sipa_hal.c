@@ -561,6 +561,28 @@ int sipa_resume_common_fifo(sipa_hal_hdl hdl, struct sipa_plat_drv_cfg *cfg)
 }
 EXPORT_SYMBOL(sipa_resume_common_fifo);
 
+/*
+ * The fifo depth registers read back zero once the IPA power domain has
+ * been cut, if every open fifo still has its depth the registers, the
+ * pointers and the free nodes all survived the suspend.
+ */
+bool sipa_hal_fifo_state_retained(sipa_hal_hdl hdl)
+{
+	int i;
+	struct sipa_hal_context *hal_cfg = (struct sipa_hal_context *)hdl;
+
+	for (i = 0; i < SIPA_FIFO_MAX; i++) {
+		if (!hal_cfg->fifo_param[i].open_flag)
+			continue;
+
+		if (!hal_cfg->fifo_ops.get_tx_depth(i, hal_cfg->cmn_fifo_cfg))
+			return false;
+	}
+
+	return true;
+}
+EXPORT_SYMBOL(sipa_hal_fifo_state_retained);
+
 bool sipa_hal_cmn_fifo_open_status(sipa_hal_hdl hdl,
 				   enum sipa_cmn_fifo_index fifo)
 {
@@ -817,6 +839,33 @@ int sipa_hal_get_cmn_fifo_filled_depth(sipa_hal_hdl hdl,
 }
 EXPORT_SYMBOL(sipa_hal_get_cmn_fifo_filled_depth);
 
+int sipa_hal_set_cmn_fifo_intr_threshold(sipa_hal_hdl hdl,
+					 enum sipa_cmn_fifo_index fifo_id,
+					 u32 cnt)
+{
+	struct sipa_hal_context *hal_cfg = (struct sipa_hal_context *)hdl;
+	struct sipa_common_fifo_cfg_tag *fifo_cfg = hal_cfg->cmn_fifo_cfg;
+	struct sipa_open_fifo_param *fifo_param = &hal_cfg->fifo_param[fifo_id];
+	struct sipa_control *ctrl = sipa_get_ctrl_pointer();
+
+	/* the fifo is reopened from the backup after a power down */
+	if (fifo_param->attr)
+		fifo_param->attr->tx_intr_threshold = cnt;
+
+	if (!ctrl->params_cfg.enable_cnt)
+		return 0;
+
+	if (fifo_cfg[fifo_id].is_pam)
+		hal_cfg->fifo_ops.set_hw_interrupt_threshold(fifo_id, fifo_cfg,
+							     1, cnt, NULL);
+	else if (cnt)
+		hal_cfg->fifo_ops.set_interrupt_threshold(fifo_id, fifo_cfg,
+							  1, cnt, NULL);
+
+	return 0;
+}
+EXPORT_SYMBOL(sipa_hal_set_cmn_fifo_intr_threshold);
+
 int sipa_hal_enable_wiap_dma(sipa_hal_hdl hdl, bool dma)
 {
 	struct sipa_hal_context *hal_cfg = (struct sipa_hal_context *)hdl;
@@ -206,6 +206,10 @@ int sipa_hal_get_cmn_fifo_filled_depth(sipa_hal_hdl hdl,
 				       enum sipa_cmn_fifo_index fifo_id,
 				       u32 *rx_filled, u32 *tx_filled);
 
+int sipa_hal_set_cmn_fifo_intr_threshold(sipa_hal_hdl hdl,
+					 enum sipa_cmn_fifo_index fifo_id,
+					 u32 cnt);
+
 int sipa_hal_enable_wiap_dma(sipa_hal_hdl hdl, bool dma);
 
 int sipa_hal_enable_pcie_dl_dma(sipa_hal_hdl hdl, bool eb);
@@ -219,6 +223,7 @@ int sipa_hal_reclaim_unuse_node(sipa_hal_hdl hdl,
 				enum sipa_cmn_fifo_index fifo_id);
 
 int sipa_resume_common_fifo(sipa_hal_hdl hdl, struct sipa_plat_drv_cfg *cfg);
+bool sipa_hal_fifo_state_retained(sipa_hal_hdl hdl);
 
 bool sipa_hal_check_rx_priv_fifo_is_empty(sipa_hal_hdl hdl,
 					  enum sipa_cmn_fifo_index fifo_id);
@@ -379,12 +379,23 @@ int sipa_nic_check_suspend_condition(void)
 }
 EXPORT_SYMBOL(sipa_nic_check_suspend_condition);
 
-int sipa_nic_open(enum sipa_term_type src, int netid,
-		  sipa_notify_cb cb, void *priv)
+static void sipa_nic_purge_rx_queues(struct sipa_nic *nic)
+{
+	int i;
+	struct sk_buff *skb;
+
+	for (i = 0; i < SIPA_NIC_RX_QUEUE_MAX; i++) {
+		while ((skb = skb_dequeue(&nic->rx_q[i].skb_q)) != NULL)
+			dev_kfree_skb_any(skb);
+		nic->rx_q[i].need_notify = 0;
+	}
+}
+
+int sipa_nic_open_mq(enum sipa_term_type src, int netid, u32 rx_queues,
+		     sipa_notify_cb cb, void *priv)
 {
 	int i, ret;
 	struct sipa_nic *nic = NULL;
-	struct sk_buff *skb;
 	enum sipa_nic_id nic_id = SIPA_NIC_MAX;
 	struct sipa_skb_receiver *receiver;
 	struct sipa_skb_sender *sender;
@@ -409,14 +420,14 @@ int sipa_nic_open(enum sipa_term_type src, int netid,
 		nic = ctrl->nic[nic_id];
 		if  (atomic_read(&nic->status) == NIC_OPEN)
 			return -EBUSY;
-		while ((skb = skb_dequeue(&nic->rx_skb_q)) != NULL)
-			dev_kfree_skb_any(skb);
+		sipa_nic_purge_rx_queues(nic);
 	} else {
 		nic = kzalloc(sizeof(*nic), GFP_KERNEL);
 		if (!nic)
 			return -ENOMEM;
 		ctrl->nic[nic_id] = nic;
-		skb_queue_head_init(&nic->rx_skb_q);
+		for (i = 0; i < SIPA_NIC_RX_QUEUE_MAX; i++)
+			skb_queue_head_init(&nic->rx_q[i].skb_q);
 	}
 
 	sender = ctrl->sender[s_spia_nic_statics[nic_id].pkt_type];
@@ -433,7 +444,7 @@ int sipa_nic_open(enum sipa_term_type src, int netid,
 	nic->continue_notify = true;
 	nic->nic_id = nic_id;
 	nic->send_ep = ctrl->eps[s_spia_nic_statics[nic_id].send_ep];
-	nic->need_notify = 0;
+	nic->rx_q_num = clamp_t(u32, rx_queues, 1, SIPA_NIC_RX_QUEUE_MAX);
 	nic->src_mask = s_spia_nic_statics[i].src_mask;
 	nic->netid = netid;
 	nic->cb = cb;
@@ -454,12 +465,18 @@ int sipa_nic_open(enum sipa_term_type src, int netid,
 
 	return nic_id;
 }
+EXPORT_SYMBOL(sipa_nic_open_mq);
+
+int sipa_nic_open(enum sipa_term_type src, int netid,
+		  sipa_notify_cb cb, void *priv)
+{
+	return sipa_nic_open_mq(src, netid, 1, cb, priv);
+}
 EXPORT_SYMBOL(sipa_nic_open);
 
 void sipa_nic_close(enum sipa_nic_id nic_id)
 {
 	struct sipa_nic *nic = NULL;
-	struct sk_buff *skb;
 	struct sipa_skb_sender *sender;
 	struct sipa_control *ctrl = sipa_get_ctrl_pointer();
 
@@ -476,8 +493,7 @@ void sipa_nic_close(enum sipa_nic_id nic_id)
 	sipa_nic_deregister_rm(nic, nic_id);
 	nic->continue_notify = false;
 	/* free all  pending skbs */
-	while ((skb = skb_dequeue(&nic->rx_skb_q)) != NULL)
-		dev_kfree_skb_any(skb);
+	sipa_nic_purge_rx_queues(nic);
 
 	sender = ctrl->sender[s_spia_nic_statics[nic_id].pkt_type];
 	sipa_skb_sender_remove_nic(sender, nic);
@@ -494,29 +510,34 @@ EXPORT_SYMBOL(sipa_nic_notify_evt);
 
 void sipa_nic_try_notify_recv(struct sipa_nic *nic)
 {
-	int need_notify = 0;
+	u32 i;
 
 	if (atomic_read(&nic->status) == NIC_CLOSE)
 		return;
 
-	if (nic->need_notify) {
-		nic->need_notify = 0;
-		need_notify = 1;
-	}
+	for (i = 0; i < nic->rx_q_num; i++) {
+		if (!nic->rx_q[i].need_notify)
+			continue;
 
-	if (need_notify && nic->cb)
-		nic->cb(nic->cb_priv, SIPA_RECEIVE, 0);
+		nic->rx_q[i].need_notify = 0;
+		if (nic->cb)
+			nic->cb(nic->cb_priv, SIPA_RECEIVE, i);
+	}
 }
 EXPORT_SYMBOL(sipa_nic_try_notify_recv);
 
-void sipa_nic_push_skb(struct sipa_nic *nic, struct sk_buff *skb)
+void sipa_nic_push_skb(struct sipa_nic *nic, struct sk_buff *skb, u32 hash)
 {
+	struct sipa_nic_rx_queue *q;
 	struct sipa_control *ctrl = sipa_get_ctrl_pointer();
 
+	/* the same flow always lands on the same queue, keep it in order */
+	q = &nic->rx_q[nic->rx_q_num > 1 ? hash % nic->rx_q_num : 0];
+
 	atomic_inc(&ctrl->recv_cnt);
-	skb_queue_tail(&nic->rx_skb_q, skb);
-	if (nic->rx_skb_q.qlen == 1 || nic->continue_notify)
-		nic->need_notify = 1;
+	skb_queue_tail(&q->skb_q, skb);
+	if (q->skb_q.qlen == 1 || nic->continue_notify)
+		q->need_notify = 1;
 }
 EXPORT_SYMBOL(sipa_nic_push_skb);
 
@@ -551,7 +572,55 @@ int sipa_nic_tx(enum sipa_nic_id nic_id, enum sipa_term_type dst,
 }
 EXPORT_SYMBOL(sipa_nic_tx);
 
-int sipa_nic_rx(enum sipa_nic_id nic_id, struct sk_buff **out_skb)
+int sipa_nic_tx_list(enum sipa_nic_id nic_id, enum sipa_term_type dst,
+		     int netid, struct sk_buff_head *list, bool more)
+{
+	int ret;
+	struct sipa_skb_sender *sender;
+	struct sipa_control *ctrl = sipa_get_ctrl_pointer();
+
+	if (!ctrl) {
+		pr_err("sipa driver may not register\n");
+		return -EINVAL;
+	}
+	sender = ctrl->sender[s_spia_nic_statics[nic_id].pkt_type];
+	if (!sender)
+		return -ENODEV;
+
+	ret = sipa_nic_rm_res_request(ctrl->nic[nic_id]);
+	if (ret) {
+		/* don't leave the items of an earlier call behind */
+		sipa_skb_sender_flush(sender);
+		sipa_nic_rm_res_release(ctrl->nic[nic_id]);
+		return ret;
+	}
+
+	ret = sipa_skb_sender_send_list(sender, list, dst, netid, more);
+	if (ret == -EAGAIN || (ret >= 0 && !skb_queue_empty(list)))
+		ctrl->nic[nic_id]->flow_ctrl_status = true;
+
+	sipa_nic_rm_res_release(ctrl->nic[nic_id]);
+
+	return ret;
+}
+EXPORT_SYMBOL(sipa_nic_tx_list);
+
+void sipa_nic_tx_flush(enum sipa_nic_id nic_id)
+{
+	struct sipa_skb_sender *sender;
+	struct sipa_control *ctrl = sipa_get_ctrl_pointer();
+
+	if (!ctrl)
+		return;
+
+	sender = ctrl->sender[s_spia_nic_statics[nic_id].pkt_type];
+	if (sender)
+		sipa_skb_sender_flush(sender);
+}
+EXPORT_SYMBOL(sipa_nic_tx_flush);
+
+int sipa_nic_rx_queue(enum sipa_nic_id nic_id, u32 qid,
+		      struct sk_buff **out_skb)
 {
 	struct sk_buff *skb;
 	struct sipa_nic *nic;
@@ -565,11 +634,14 @@ int sipa_nic_rx(enum sipa_nic_id nic_id, struct sk_buff **out_skb)
 	    atomic_read(&ctrl->nic[nic_id]->status) == NIC_CLOSE)
 		return -ENODEV;
 
+	nic = ctrl->nic[nic_id];
+	if (qid >= nic->rx_q_num)
+		return -EINVAL;
+
 	if (sipa_receiver_has_stop_recv())
 		sipa_receiver_clean_stop_recv();
 
-	nic = ctrl->nic[nic_id];
-	skb = skb_dequeue(&nic->rx_skb_q);
+	skb = skb_dequeue(&nic->rx_q[qid].skb_q);
 	if (nic->continue_notify)
 		nic->continue_notify = false;
 
@@ -579,10 +651,17 @@ int sipa_nic_rx(enum sipa_nic_id nic_id, struct sk_buff **out_skb)
 
 	return (skb) ? 0 : -ENODATA;
 }
+EXPORT_SYMBOL(sipa_nic_rx_queue);
+
+int sipa_nic_rx(enum sipa_nic_id nic_id, struct sk_buff **out_skb)
+{
+	return sipa_nic_rx_queue(nic_id, 0, out_skb);
+}
 EXPORT_SYMBOL(sipa_nic_rx);
 
 int sipa_nic_rx_has_data(enum sipa_nic_id nic_id)
 {
+	u32 i;
 	struct sipa_nic *nic;
 	struct sipa_control *ctrl = sipa_get_ctrl_pointer();
 
@@ -595,8 +674,11 @@ int sipa_nic_rx_has_data(enum sipa_nic_id nic_id)
 		return 0;
 
 	nic = ctrl->nic[nic_id];
+	for (i = 0; i < nic->rx_q_num; i++)
+		if (nic->rx_q[i].skb_q.qlen)
+			return 1;
 
-	return (!!nic->rx_skb_q.qlen);
+	return 0;
 }
 EXPORT_SYMBOL(sipa_nic_rx_has_data);
 
@@ -158,6 +158,7 @@ struct sipa_plat_drv_cfg {
 	bool wiap_ul_dma;
 	bool pcie_dl_dma;
 	bool need_through_pcie;
+	bool retention;
 
 	u32 fifo_iram_size;
 	u32 fifo_ddr_size;
@@ -170,6 +171,7 @@ struct sipa_plat_drv_cfg {
 	const struct sipa_hw_data *hw_data;
 	u32 suspend_cnt;
 	u32 resume_cnt;
+	u32 retained_cnt;
 #ifdef CONFIG_DEBUG_FS
 	struct dentry *debugfs_root;
 #endif
@@ -226,13 +228,20 @@ struct sipa_skb_sender {
 	struct sipa_context *ctx;
 	struct sipa_endpoint *ep;
 	enum sipa_xfer_pkt_type type;
-	atomic_t left_cnt;
 	spinlock_t nic_lock;
+	/* serializes the submitters, the completion side never takes it */
 	spinlock_t send_lock;
 	struct list_head nic_list;
-	struct list_head sending_list;
-	struct list_head pair_free_list;
+	/*
+	 * In flight skbs, one slot per rx fifo position. ring_head is only
+	 * moved by the submitters, ring_tail only by the completion side.
+	 */
 	struct sipa_skb_dma_addr_node *pair_cache;
+	u32 ring_size;
+	u32 ring_head;
+	u32 ring_tail;
+	/* items cached in the fifo but write pointer not updated yet */
+	u32 pending_cnt;
 
 	bool free_notify_net;
 	bool send_notify_net;
@@ -243,6 +252,11 @@ struct sipa_skb_sender {
 	struct task_struct *free_thread;
 	struct task_struct *send_thread;
 
+	/* free the sent skbs from napi instead of free_thread */
+	bool napi_mode;
+	struct net_device napi_dev;
+	struct napi_struct napi;
+
 	atomic_t check_suspend;
 	atomic_t check_flag;
 
@@ -251,6 +265,8 @@ struct sipa_skb_sender {
 	u32 no_free_cnt;
 	u32 enter_flow_ctrl_cnt;
 	u32 exit_flow_ctrl_cnt;
+	/* completions that did not come back in submit order */
+	u32 unordered_cnt;
 };
 
 struct sipa_receiver {
@@ -260,8 +276,33 @@ struct sipa_receiver {
 	struct task_struct *thread;
 };
 
+struct sipa_recv_page {
+	struct page *page;
+	dma_addr_t dma;
+	/* buffers of this page currently owned by the hardware */
+	atomic_t hw_cnt;
+};
+
+struct sipa_recv_pool {
+	struct device *dev;
+	u32 headroom;
+	u32 data_len;
+	u32 buf_size;
+
+	struct sipa_recv_page *pages;
+	u32 page_cnt;
+	u32 max_pages;
+	u32 cur;
+	u32 cur_offset;
+
+	u32 alloc_cnt;
+	u32 recycle_cnt;
+	u32 retire_cnt;
+	u32 build_fail_cnt;
+};
+
 struct sipa_skb_dma_addr_pair {
-	struct sk_buff *skb;
+	struct sipa_recv_page *rpage;
 	dma_addr_t dma_addr;
 	struct list_head list;
 };
@@ -292,11 +333,17 @@ struct sipa_nic_cons_res {
 	unsigned long jiffies;
 };
 
+struct sipa_nic_rx_queue {
+	struct sk_buff_head skb_q;
+	int need_notify;
+};
+
 struct sipa_nic {
 	enum sipa_nic_id nic_id;
 	struct sipa_endpoint *send_ep;
-	struct sk_buff_head	rx_skb_q;
-	int need_notify;
+	/* flows are spread over rx_q_num queues by the IPA flow hash */
+	struct sipa_nic_rx_queue rx_q[SIPA_NIC_RX_QUEUE_MAX];
+	u32 rx_q_num;
 	u32 src_mask;
 	int netid;
 	struct list_head list;
@@ -312,17 +359,25 @@ struct sipa_skb_receiver {
 	struct sipa_context *ctx;
 	struct sipa_endpoint *ep;
 	u32 rsvd;
+	struct sipa_recv_pool pool;
 	struct sipa_skb_array recv_array;
 	wait_queue_head_t recv_waitq;
 	wait_queue_head_t fill_recv_waitq;
 	spinlock_t lock;
 	u32 nic_cnt;
 	atomic_t need_fill_cnt;
+	/* SIPA_RECV_FILLING is set while someone refills the free fifo */
+	unsigned long fill_state;
 	struct sipa_nic *nic_array[SIPA_NIC_MAX];
 
 	struct task_struct *fill_thread;
 	struct task_struct *thread;
 
+	/* receive and refill from napi instead of recv_thread */
+	bool napi_mode;
+	struct net_device napi_dev;
+	struct napi_struct napi;
+
 	atomic_t need_sched;
 	atomic_t check_suspend;
 	atomic_t check_flag;
@@ -379,6 +434,17 @@ int sipa_skb_sender_send_data(struct sipa_skb_sender *sender,
 			      enum sipa_term_type dst,
 			      u8 netid);
 
+int sipa_skb_sender_send_list(struct sipa_skb_sender *sender,
+			      struct sk_buff_head *list,
+			      enum sipa_term_type dst,
+			      u8 netid, bool more);
+
+void sipa_skb_sender_flush(struct sipa_skb_sender *sender);
+
+u32 sipa_skb_sender_free_cnt(struct sipa_skb_sender *sender);
+
+void sipa_skb_sender_kick(struct sipa_skb_sender *sender);
+
 bool sipa_skb_sender_check_send_complete(struct sipa_skb_sender *sender);
 
 void sipa_skb_sender_add_nic(struct sipa_skb_sender *sender,
@@ -400,7 +466,7 @@ void sipa_nic_try_notify_recv(struct sipa_nic *nic);
 
 void sipa_nic_notify_evt(struct sipa_nic *nic, enum sipa_evt_type evt);
 
-void sipa_nic_push_skb(struct sipa_nic *nic, struct sk_buff *skb);
+void sipa_nic_push_skb(struct sipa_nic *nic, struct sk_buff *skb, u32 hash);
 
 int sipa_nic_rx_has_data(enum sipa_nic_id nic_id);
 
@@ -415,4 +481,20 @@ void sipa_fill_free_node(struct sipa_skb_receiver *receiver, u32 cnt);
 
 void sipa_reinit_recv_array(struct sipa_skb_receiver *receiver);
 
+int sipa_recv_pool_init(struct sipa_recv_pool *pool, struct device *dev,
+			u32 depth, u32 headroom, u32 data_len);
+
+void sipa_recv_pool_destroy(struct sipa_recv_pool *pool);
+
+int sipa_recv_pool_get_buf(struct sipa_recv_pool *pool,
+			   struct sipa_recv_page **rpage,
+			   dma_addr_t *dma, gfp_t gfp);
+
+void sipa_recv_pool_put_buf(struct sipa_recv_pool *pool,
+			    struct sipa_recv_page *rpage);
+
+struct sk_buff *sipa_recv_pool_build_skb(struct sipa_recv_pool *pool,
+					 struct sipa_recv_page *rpage,
+					 dma_addr_t dma, u32 len);
+
 #endif /* _SIPA_PRIV_H_ */
@@ -0,0 +1,272 @@
+/*
+ * Copyright (C) 2018 Spreadtrum Communications Inc.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Recycled receive buffer pool.
+ *
+ * The buffers handed to the ipa free fifo are carved out of pages which
+ * are dma mapped once when they enter the pool. Every buffer owned by
+ * the hardware or by an skb holds one page reference, the pool itself
+ * holds one more. When a packet is received only the used length is
+ * synced for the cpu and the skb is built around the buffer with
+ * build_skb(), so the page reference goes back when the stack frees it.
+ * A page whose reference count dropped back to one is reused without
+ * any new allocation or dma mapping.
+ */
+
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/skbuff.h>
+#include <linux/dma-mapping.h>
+#include "sipa_priv.h"
+
+/* pages looked at for a free one before a new page is mapped */
+#define SIPA_RECV_POOL_SCAN	8
+
+#define SIPA_RECV_POOL_DMA_ATTR	DMA_ATTR_SKIP_CPU_SYNC
+
+static int sipa_recv_pool_map_page(struct sipa_recv_pool *pool,
+				   struct sipa_recv_page *rpage, gfp_t gfp)
+{
+	struct page *page;
+	dma_addr_t dma;
+
+	page = alloc_page(gfp | __GFP_NOWARN);
+	if (!page)
+		return -ENOMEM;
+
+	dma = dma_map_page_attrs(pool->dev, page, 0, PAGE_SIZE,
+				 DMA_FROM_DEVICE, SIPA_RECV_POOL_DMA_ATTR);
+	if (dma_mapping_error(pool->dev, dma)) {
+		__free_page(page);
+		return -ENOMEM;
+	}
+
+	rpage->page = page;
+	rpage->dma = dma;
+	atomic_set(&rpage->hw_cnt, 0);
+	pool->alloc_cnt++;
+
+	return 0;
+}
+
+/*
+ * Drop the pool reference of a page, the skbs still using it will
+ * free it. The buffers of this page are all synced to the cpu already,
+ * so the unmap must not touch the cache anymore.
+ */
+static void sipa_recv_pool_unmap_page(struct sipa_recv_pool *pool,
+				      struct sipa_recv_page *rpage)
+{
+	if (!rpage->page)
+		return;
+
+	dma_unmap_page_attrs(pool->dev, rpage->dma, PAGE_SIZE,
+			     DMA_FROM_DEVICE, SIPA_RECV_POOL_DMA_ATTR);
+	put_page(rpage->page);
+	rpage->page = NULL;
+	rpage->dma = 0;
+}
+
+static bool sipa_recv_pool_page_idle(struct sipa_recv_page *rpage)
+{
+	return page_ref_count(rpage->page) == 1 &&
+		!page_is_pfmemalloc(rpage->page);
+}
+
+/* Move the cursor to a page which has no buffer in use */
+static int sipa_recv_pool_next_page(struct sipa_recv_pool *pool, gfp_t gfp)
+{
+	struct sipa_recv_page *rpage;
+	int retire = -1;
+	u32 i, idx;
+
+	for (i = 1; i <= min_t(u32, pool->page_cnt, SIPA_RECV_POOL_SCAN);
+	     i++) {
+		idx = (pool->cur + i) % pool->page_cnt;
+		if (idx == pool->cur)
+			break;
+		rpage = &pool->pages[idx];
+		/* a slot whose page could not be replaced last time */
+		if (!rpage->page) {
+			if (sipa_recv_pool_map_page(pool, rpage, gfp))
+				continue;
+			pool->cur = idx;
+			pool->cur_offset = 0;
+			return 0;
+		}
+
+		if (sipa_recv_pool_page_idle(rpage)) {
+			pool->cur = idx;
+			pool->cur_offset = 0;
+			pool->recycle_cnt++;
+			return 0;
+		}
+
+		if (retire < 0 && !atomic_read(&rpage->hw_cnt))
+			retire = idx;
+	}
+
+	if (pool->page_cnt < pool->max_pages) {
+		rpage = &pool->pages[pool->page_cnt];
+		if (sipa_recv_pool_map_page(pool, rpage, gfp))
+			return -ENOMEM;
+		pool->cur = pool->page_cnt++;
+		pool->cur_offset = 0;
+		return 0;
+	}
+
+	/*
+	 * The pool is full and the stack still holds the buffers of the
+	 * pages we looked at, replace one nobody will dma into anymore.
+	 */
+	if (retire < 0)
+		return -ENOMEM;
+
+	rpage = &pool->pages[retire];
+	sipa_recv_pool_unmap_page(pool, rpage);
+	pool->retire_cnt++;
+	if (sipa_recv_pool_map_page(pool, rpage, gfp))
+		return -ENOMEM;
+	pool->cur = retire;
+	pool->cur_offset = 0;
+
+	return 0;
+}
+
+/**
+ * sipa_recv_pool_get_buf() - take a buffer for the ipa free fifo
+ * @pool: receive pool
+ * @rpage: returns the pool page the buffer belongs to
+ * @dma: returns the dma address of the buffer start
+ * @gfp: allocation flags, used if a new page has to be mapped
+ *
+ * The hardware writes the packet at @dma + pool->headroom.
+ */
+int sipa_recv_pool_get_buf(struct sipa_recv_pool *pool,
+			   struct sipa_recv_page **rpage,
+			   dma_addr_t *dma, gfp_t gfp)
+{
+	struct sipa_recv_page *cur;
+
+	if (!pool->page_cnt ||
+	    pool->cur_offset + pool->buf_size > PAGE_SIZE ||
+	    !pool->pages[pool->cur].page) {
+		if (sipa_recv_pool_next_page(pool, gfp))
+			return -ENOMEM;
+	}
+
+	cur = &pool->pages[pool->cur];
+	page_ref_inc(cur->page);
+	atomic_inc(&cur->hw_cnt);
+
+	*rpage = cur;
+	*dma = cur->dma + pool->cur_offset;
+	pool->cur_offset += pool->buf_size;
+
+	/* the cpu may have dirtied this area while the stack used it */
+	dma_sync_single_range_for_device(pool->dev, cur->dma,
+					 *dma - cur->dma + pool->headroom,
+					 pool->data_len, DMA_FROM_DEVICE);
+
+	return 0;
+}
+
+/* Give back a buffer taken by sipa_recv_pool_get_buf() without using it */
+void sipa_recv_pool_put_buf(struct sipa_recv_pool *pool,
+			    struct sipa_recv_page *rpage)
+{
+	atomic_dec(&rpage->hw_cnt);
+	put_page(rpage->page);
+}
+
+/**
+ * sipa_recv_pool_build_skb() - wrap a received buffer into an skb
+ * @pool: receive pool
+ * @rpage: pool page of the buffer
+ * @dma: dma address of the buffer start
+ * @len: length the hardware reported for this packet
+ *
+ * The skb data starts at the headroom and has the fixed receive length,
+ * the same layout the consumers got when the buffers were skbs.
+ */
+struct sk_buff *sipa_recv_pool_build_skb(struct sipa_recv_pool *pool,
+					 struct sipa_recv_page *rpage,
+					 dma_addr_t dma, u32 len)
+{
+	struct sk_buff *skb;
+	u32 offset = dma - rpage->dma;
+
+	if (!len || len > pool->data_len)
+		len = pool->data_len;
+
+	dma_sync_single_range_for_cpu(pool->dev, rpage->dma,
+				      offset + pool->headroom, len,
+				      DMA_FROM_DEVICE);
+	atomic_dec(&rpage->hw_cnt);
+
+	/* the page reference of the buffer moves to the skb */
+	skb = build_skb(page_address(rpage->page) + offset, pool->buf_size);
+	if (unlikely(!skb)) {
+		put_page(rpage->page);
+		pool->build_fail_cnt++;
+		return NULL;
+	}
+
+	skb_reserve(skb, pool->headroom);
+	skb_put(skb, pool->data_len);
+
+	return skb;
+}
+
+int sipa_recv_pool_init(struct sipa_recv_pool *pool, struct device *dev,
+			u32 depth, u32 headroom, u32 data_len)
+{
+	memset(pool, 0, sizeof(*pool));
+
+	pool->dev = dev;
+	pool->headroom = headroom;
+	pool->data_len = data_len;
+	pool->buf_size = SKB_DATA_ALIGN(headroom + data_len) +
+		SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
+	if (pool->buf_size > PAGE_SIZE)
+		return -EINVAL;
+
+	/*
+	 * Twice the pages the fifo can hold, the stack usually returns a
+	 * page before the cursor wraps around to it.
+	 */
+	pool->max_pages = 2 * DIV_ROUND_UP(depth, PAGE_SIZE / pool->buf_size);
+	pool->pages = kcalloc(pool->max_pages, sizeof(*pool->pages),
+			      GFP_KERNEL);
+	if (!pool->pages)
+		return -ENOMEM;
+
+	return 0;
+}
+
+void sipa_recv_pool_destroy(struct sipa_recv_pool *pool)
+{
+	u32 i;
+
+	if (!pool->pages)
+		return;
+
+	for (i = 0; i < pool->page_cnt; i++)
+		sipa_recv_pool_unmap_page(pool, &pool->pages[i]);
+
+	kfree(pool->pages);
+	pool->pages = NULL;
+	pool->page_cnt = 0;
+}
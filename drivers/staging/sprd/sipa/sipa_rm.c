@@ -273,6 +273,18 @@ int sipa_rm_register(enum sipa_rm_res_id res_id,
 		pr_err("can be called on CONS only\n");
 		return -EINVAL;
 	}
+
+	/*
+	 * A granted consumer only needs a reference, take it without the
+	 * lock. Consumers are deleted on teardown only, after their users
+	 * are gone, so the table entry may be read unlocked.
+	 */
+	if (!sipa_rm_dep_graph_get_resource(sipa_rm_ctx->dep_graph,
+					    res_id, &resource) &&
+	    sipa_rm_resource_consumer_get_fast(
+			(struct sipa_rm_res_cons *)resource))
+		return 0;
+
 	spin_lock_irqsave(&sipa_rm_ctx->sipa_rm_lock, flags);
 	if (sipa_rm_dep_graph_get_resource(sipa_rm_ctx->dep_graph,
 					   res_id,
@@ -481,6 +493,24 @@ int sipa_rm_release_resource(enum sipa_rm_res_id resource_name)
 		pr_err("can be called on CONS only\n");
 		return -EINVAL;
 	}
+
+	/* a reference taken by the fast path of sipa_rm_request_resource() */
+	if (!sipa_rm_dep_graph_get_resource(sipa_rm_ctx->dep_graph,
+					    resource_name, &resource)) {
+		result = sipa_rm_resource_consumer_put_fast(
+				 (struct sipa_rm_res_cons *)resource);
+		if (result > 0)
+			return 0;
+		if (!result) {
+			spin_lock_irqsave(&sipa_rm_ctx->sipa_rm_lock, flags);
+			sipa_rm_resource_consumer_release_idle(
+				(struct sipa_rm_res_cons *)resource);
+			spin_unlock_irqrestore(&sipa_rm_ctx->sipa_rm_lock,
+					       flags);
+			return 0;
+		}
+	}
+
 	spin_lock_irqsave(&sipa_rm_ctx->sipa_rm_lock, flags);
 	if (sipa_rm_dep_graph_get_resource(sipa_rm_ctx->dep_graph,
 					   resource_name,
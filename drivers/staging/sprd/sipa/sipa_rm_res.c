@@ -161,6 +161,7 @@ void sipa_rm_resource_consumer_do_release(struct sipa_rm_res_cons *cons)
 	}
 
 	cons->resource.state = SIPA_RM_RELEASED;
+	atomic_set(&cons->fast_ref, 0);
 
 	pr_debug("%s state: %d\n",
 		 sipa_rm_res_str(cons->resource.name),
@@ -206,6 +207,8 @@ int sipa_rm_resource_consumer_do_request(struct sipa_rm_res_cons *cons)
 void sipa_rm_resource_consumer_enter_granted(struct sipa_rm_res_cons *consumer)
 {
 	consumer->resource.state = SIPA_RM_GRANTED;
+	/* keep the fast holders which survived a dependency being added */
+	atomic_cmpxchg(&consumer->fast_ref, 0, 1);
 
 	pr_debug("%s state: %d\n",
 		 sipa_rm_res_str(consumer->resource.name),
@@ -899,30 +902,37 @@ bail:
 	return result;
 }
 
-/**
- * sipa_rm_resource_consumer_release() - consumer resource release
- * consumer: [in] consumer resource
- *
- * Returns: 0 on success, negative on failure
+/*
+ * No reference is left, neither a locked one nor a fast one. Drops the
+ * grant bias of fast_ref, so no fast reference can be taken after true.
  */
-int sipa_rm_resource_consumer_release(struct sipa_rm_res_cons *cons)
+static bool consumer_idle(struct sipa_rm_res_cons *cons)
+{
+	if (cons->resource.ref_count)
+		return false;
+
+	return !atomic_read(&cons->fast_ref) ||
+		atomic_cmpxchg(&cons->fast_ref, 1, 0) == 1;
+}
+
+static int consumer_release(struct sipa_rm_res_cons *cons, bool put)
 {
 	int result = 0;
 	bool release_producer = false;
 	enum sipa_rm_res_state state;
 
 	state = cons->resource.state;
-	if (cons->resource.ref_count > 0)
+	if (put && cons->resource.ref_count > 0)
 		cons->resource.ref_count--;
 	switch (cons->resource.state) {
 	case SIPA_RM_RELEASED:
 		goto bail;
 	case SIPA_RM_GRANTED:
-		if (cons->resource.ref_count == 0)
+		if (consumer_idle(cons))
 			release_producer = true;
 		break;
 	case SIPA_RM_REQUEST_IN_PROGRESS:
-		if (cons->resource.ref_count == 0)
+		if (consumer_idle(cons))
 			cons->resource.state = SIPA_RM_RELEASE_IN_PROGRESS;
 		break;
 	case SIPA_RM_RELEASE_IN_PROGRESS:
@@ -946,6 +956,71 @@ bail:
 	return result;
 }
 
+/**
+ * sipa_rm_resource_consumer_release() - consumer resource release
+ * consumer: [in] consumer resource
+ *
+ * Returns: 0 on success, negative on failure
+ */
+int sipa_rm_resource_consumer_release(struct sipa_rm_res_cons *cons)
+{
+	return consumer_release(cons, true);
+}
+
+/**
+ * sipa_rm_resource_consumer_get_fast() - take a reference on a granted
+ *	consumer without the rm lock
+ * @cons: [in] consumer resource
+ *
+ * A consumer which is already granted needs nothing but a reference, so
+ * the data path does not have to queue up behind the rm lock for it.
+ *
+ * Returns: true if the consumer is granted and the reference is taken,
+ *	false if the request has to go through
+ *	sipa_rm_resource_consumer_request()
+ */
+bool sipa_rm_resource_consumer_get_fast(struct sipa_rm_res_cons *cons)
+{
+	return atomic_inc_not_zero(&cons->fast_ref);
+}
+
+/**
+ * sipa_rm_resource_consumer_put_fast() - drop a reference taken by
+ *	sipa_rm_resource_consumer_get_fast()
+ * @cons: [in] consumer resource
+ *
+ * Returns: 1 if other fast references are left, 0 if the last one is
+ *	dropped, then sipa_rm_resource_consumer_release_idle() has to be
+ *	called under the rm lock, -EAGAIN if there is no fast reference,
+ *	the reference has to be dropped by sipa_rm_resource_consumer_release()
+ */
+int sipa_rm_resource_consumer_put_fast(struct sipa_rm_res_cons *cons)
+{
+	int old, ref = atomic_read(&cons->fast_ref);
+
+	while (ref > 1) {
+		old = atomic_cmpxchg(&cons->fast_ref, ref, ref - 1);
+		if (old == ref)
+			return ref > 2 ? 1 : 0;
+		ref = old;
+	}
+
+	return -EAGAIN;
+}
+
+/**
+ * sipa_rm_resource_consumer_release_idle() - release a consumer which
+ *	has no reference left
+ * @cons: [in] consumer resource
+ *
+ * Called under the rm lock after the last fast reference is dropped, it
+ * does nothing if another reference was taken in the meantime.
+ */
+void sipa_rm_resource_consumer_release_idle(struct sipa_rm_res_cons *cons)
+{
+	consumer_release(cons, false);
+}
+
 static void sipa_rm_resource_consumer_handle_cb(struct sipa_rm_res_cons *cons,
 						enum sipa_rm_event event)
 {
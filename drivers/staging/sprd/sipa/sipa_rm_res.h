@@ -14,6 +14,7 @@
 #ifndef _SIPA_RM_RES_H_
 #define _SIPA_RM_RES_H_
 
+#include <linux/atomic.h>
 #include <linux/list.h>
 #include <linux/sipa.h>
 #include <linux/kfifo.h>
@@ -95,6 +96,11 @@ struct sipa_rm_res_cons {
 	struct list_head	event_listeners;
 	int	pending_request;
 	int	pending_release;
+	/*
+	 * 0 while not granted, 1 + the references taken without the rm
+	 * lock while granted, see sipa_rm_resource_consumer_get_fast()
+	 */
+	atomic_t	fast_ref;
 };
 
 int sipa_rm_resource_create(
@@ -130,6 +136,12 @@ int sipa_rm_resource_consumer_request(struct sipa_rm_res_cons *cons);
 
 int sipa_rm_resource_consumer_release(struct sipa_rm_res_cons *cons);
 
+bool sipa_rm_resource_consumer_get_fast(struct sipa_rm_res_cons *cons);
+
+int sipa_rm_resource_consumer_put_fast(struct sipa_rm_res_cons *cons);
+
+void sipa_rm_resource_consumer_release_idle(struct sipa_rm_res_cons *cons);
+
 void sipa_rm_resource_producer_handle_cb(struct sipa_rm_res_prod *prod,
 		enum sipa_rm_event event);
 
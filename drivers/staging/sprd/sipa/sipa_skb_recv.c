@@ -39,20 +39,26 @@
 #include <linux/seq_file.h>
 #include <linux/of_device.h>
 #include <linux/sipa.h>
+#include <linux/soc/sprd/sprd_wakepkt.h>
 #include "sipa_priv.h"
 #include "sipa_hal.h"
 
 #define SIPA_RECV_BUF_LEN     1600
 #define SIPA_RECV_RSVD_LEN     128
+#define SIPA_RECV_NAPI_WEIGHT  64
+#define SIPA_RECV_FILL_THRESHOLD 0x30
+
+#define SIPA_RECV_FILLING      0
 
 static int put_recv_array_node(struct sipa_skb_array *p,
-			       struct sk_buff *skb, dma_addr_t dma_addr)
+			       struct sipa_recv_page *rpage,
+			       dma_addr_t dma_addr)
 {
 	u32 pos;
 
 	if ((p->wp - p->rp) < p->depth) {
 		pos = p->wp & (p->depth -1);
-		p->array[pos].skb = skb;
+		p->array[pos].rpage = rpage;
 		p->array[pos].dma_addr = dma_addr;
 		/*
 		 * Ensure that we put the item to the fifo before
@@ -67,13 +73,14 @@ static int put_recv_array_node(struct sipa_skb_array *p,
 }
 
 static int get_recv_array_node(struct sipa_skb_array *p,
-			       struct sk_buff **skb, dma_addr_t *dma_addr)
+			       struct sipa_recv_page **rpage,
+			       dma_addr_t *dma_addr)
 {
 	u32 pos;
 
 	if (p->rp != p->wp) {
 		pos = p->rp & (p->depth -1);
-		*skb = p->array[pos].skb;
+		*rpage = p->array[pos].rpage;
 		*dma_addr = p->array[pos].dma_addr;
 		/*
 		* Ensure that we remove the item from the fifo before
@@ -87,80 +94,39 @@ static int get_recv_array_node(struct sipa_skb_array *p,
 	}
 }
 
-static struct sk_buff *alloc_recv_skb(u32 req_len, u8 rsvd)
-{
-	struct sk_buff *skb;
-	u32 hr;
-	struct sipa_control *ctrl = sipa_get_ctrl_pointer();
-
-	skb = __dev_alloc_skb(req_len + rsvd, GFP_KERNEL | GFP_NOWAIT);
-	if (!skb) {
-		dev_err(ctrl->ctx->pdev, "failed to alloc skb!\n");
-		return NULL;
-	}
-
-	/* save skb ptr to skb->data */
-	hr = skb_headroom(skb);
-	if (hr < rsvd)
-		skb_reserve(skb, rsvd - hr);
-
-	return skb;
-}
-
 static void sipa_prepare_free_node_init(struct sipa_skb_receiver *receiver,
 					u32 cnt)
 {
-	struct sk_buff *skb;
-	u32 tmp, fail_cnt = 0;
+	u32 fail_cnt = 0;
 	int i;
 	u32 success_cnt = 0;
 	struct sipa_hal_fifo_item item;
+	struct sipa_recv_page *rpage;
 	dma_addr_t dma_addr;
 
 	memset(&item, 0, sizeof(item));
 
 	for (i = 0; i < cnt; i++) {
-		skb = alloc_recv_skb(SIPA_RECV_BUF_LEN, receiver->rsvd);
-		if (skb) {
-			tmp = skb_headroom(skb);
-			if (unlikely(tmp > SIPA_RECV_RSVD_LEN)) {
-				tmp -= SIPA_RECV_RSVD_LEN;
-				skb_put(skb, SIPA_RECV_BUF_LEN - tmp);
-				skb_push(skb, tmp);
-			} else {
-				skb_put(skb, SIPA_RECV_BUF_LEN);
-			}
-
-			dma_addr = dma_map_single(receiver->ctx->pdev,
-						  skb->head,
-						  SIPA_RECV_BUF_LEN +
-						  skb_headroom(skb),
-						  DMA_FROM_DEVICE);
-			if (dma_mapping_error(receiver->ctx->pdev,
-					      dma_addr)) {
-				dev_err(receiver->ctx->pdev,
-					"prepare free node dma map err\n");
-				fail_cnt++;
-				break;
-			}
-
-			put_recv_array_node(&receiver->recv_array,
-					    skb, dma_addr);
-
-			item.addr = dma_addr;
-			item.len = skb->len;
-			item.offset = skb_headroom(skb);
-			item.dst = receiver->ep->recv_fifo.dst_id;
-			item.src = receiver->ep->recv_fifo.src_id;
-
-			sipa_hal_cache_rx_fifo_item(receiver->ctx->hdl,
-						    receiver->ep->recv_fifo.idx,
-						    &item, i);
-			success_cnt++;
-		} else {
+		if (sipa_recv_pool_get_buf(&receiver->pool, &rpage,
+					   &dma_addr, GFP_KERNEL)) {
+			dev_err(receiver->ctx->pdev,
+				"prepare free node no buffer\n");
 			fail_cnt++;
 			break;
 		}
+
+		put_recv_array_node(&receiver->recv_array, rpage, dma_addr);
+
+		item.addr = dma_addr;
+		item.len = receiver->pool.data_len;
+		item.offset = receiver->pool.headroom;
+		item.dst = receiver->ep->recv_fifo.dst_id;
+		item.src = receiver->ep->recv_fifo.src_id;
+
+		sipa_hal_cache_rx_fifo_item(receiver->ctx->hdl,
+					    receiver->ep->recv_fifo.idx,
+					    &item, i);
+		success_cnt++;
 	}
 
 	if (fail_cnt)
@@ -169,13 +135,14 @@ static void sipa_prepare_free_node_init(struct sipa_skb_receiver *receiver,
 			receiver->ep->id, fail_cnt, success_cnt);
 }
 
-static void fill_free_fifo(struct sipa_skb_receiver *receiver, u32 cnt)
+static void fill_free_fifo(struct sipa_skb_receiver *receiver, u32 cnt,
+			   gfp_t gfp)
 {
-	struct sk_buff *skb;
-	u32 tmp, fail_cnt = 0;
+	u32 fail_cnt = 0;
 	int i;
 	u32 success_cnt = 0, depth;
 	struct sipa_hal_fifo_item item;
+	struct sipa_recv_page *rpage;
 	dma_addr_t dma_addr;
 
 	memset(&item, 0, sizeof(item));
@@ -188,52 +155,26 @@ static void fill_free_fifo(struct sipa_skb_receiver *receiver, u32 cnt)
 	}
 
 	for (i = 0; i < cnt; i++) {
-		skb = alloc_recv_skb(SIPA_RECV_BUF_LEN, receiver->rsvd);
-		if (!skb) {
-			fail_cnt++;
-			break;
-		}
-
-		tmp = skb_headroom(skb);
-		if (unlikely(tmp > SIPA_RECV_RSVD_LEN)) {
-			tmp -= SIPA_RECV_RSVD_LEN;
-			skb_put(skb, SIPA_RECV_BUF_LEN - tmp);
-			skb_push(skb, tmp);
-		} else {
-			skb_put(skb, SIPA_RECV_BUF_LEN);
-		}
-
-		dma_addr = dma_map_single(receiver->ctx->pdev,
-					  skb->head,
-					  SIPA_RECV_BUF_LEN +
-					  skb_headroom(skb),
-					  DMA_FROM_DEVICE);
-		if (dma_mapping_error(receiver->ctx->pdev,
-				      dma_addr)) {
-			dev_err(receiver->ctx->pdev,
-				"prepare free node dma map err\n");
+		if (sipa_recv_pool_get_buf(&receiver->pool, &rpage,
+					   &dma_addr, gfp)) {
 			fail_cnt++;
 			break;
 		}
 
 		item.addr = dma_addr;
-		item.len = skb->len;
-		item.offset = skb_headroom(skb);
+		item.len = receiver->pool.data_len;
+		item.offset = receiver->pool.headroom;
 		item.dst = receiver->ep->recv_fifo.dst_id;
 		item.src = receiver->ep->recv_fifo.src_id;
 
 		if (sipa_hal_cache_rx_fifo_item(receiver->ctx->hdl,
 						receiver->ep->recv_fifo.idx,
 						&item, i)) {
-			dma_unmap_single(receiver->ctx->pdev,
-					 dma_addr,
-					 SIPA_RECV_BUF_LEN + skb_headroom(skb),
-					 DMA_FROM_DEVICE);
-			dev_kfree_skb_any(skb);
+			sipa_recv_pool_put_buf(&receiver->pool, rpage);
 			break;
 		}
 		put_recv_array_node(&receiver->recv_array,
-				    skb, dma_addr);
+				    rpage, dma_addr);
 		success_cnt++;
 	}
 
@@ -250,6 +191,28 @@ static void fill_free_fifo(struct sipa_skb_receiver *receiver, u32 cnt)
 			"fill free fifo fail_cnt = %d\n", fail_cnt);
 }
 
+/*
+ * The free fifo may be refilled from both the napi poll and the
+ * fill thread, only one of them is allowed to run fill_free_fifo.
+ */
+static bool sipa_receiver_fill_trylock(struct sipa_skb_receiver *receiver)
+{
+	return !test_and_set_bit_lock(SIPA_RECV_FILLING, &receiver->fill_state);
+}
+
+static void sipa_receiver_fill_unlock(struct sipa_skb_receiver *receiver)
+{
+	clear_bit_unlock(SIPA_RECV_FILLING, &receiver->fill_state);
+}
+
+static void sipa_receiver_kick(struct sipa_skb_receiver *receiver)
+{
+	if (receiver->napi_mode)
+		napi_schedule(&receiver->napi);
+	else
+		wake_up(&receiver->recv_waitq);
+}
+
 void sipa_fill_free_node(struct sipa_skb_receiver *receiver, u32 cnt)
 {
 	sipa_hal_update_rx_fifo_wptr(receiver->ctx->hdl,
@@ -269,13 +232,13 @@ static void sipa_receiver_notify_cb(void *priv, enum sipa_hal_evt_type evt,
 	struct sipa_skb_receiver *receiver = (struct sipa_skb_receiver *)priv;
 
 	if (evt & SIPA_RECV_EVT)
-		wake_up(&receiver->recv_waitq);
+		sipa_receiver_kick(receiver);
 
 	if (evt & SIPA_RECV_WARN_EVT) {
 		dev_err(receiver->ctx->pdev,
 			"sipa maybe poor resources evt = 0x%x\n", evt);
 		receiver->tx_danger_cnt++;
-		wake_up(&receiver->recv_waitq);
+		sipa_receiver_kick(receiver);
 	}
 }
 
@@ -314,7 +277,10 @@ static int dispath_to_nic(struct sipa_skb_receiver *receiver,
 	}
 
 	if (dst_nic) {
-		sipa_nic_push_skb(dst_nic, skb);
+		/* the ipa delivers every packet with an ethernet header */
+		sprd_wakepkt_rx("sipa", item->netid, skb, ETH_HLEN);
+		/* item->hash is the IPA hash of the packet 5-tuple */
+		sipa_nic_push_skb(dst_nic, skb, item->hash);
 	} else {
 		dev_err(receiver->ctx->pdev,
 			"dispath to nic src:0x%x, netid:%d no nic matched\n",
@@ -325,12 +291,13 @@ static int dispath_to_nic(struct sipa_skb_receiver *receiver,
 	return 0;
 }
 
-static int do_recv(struct sipa_skb_receiver *receiver)
+static int do_recv(struct sipa_skb_receiver *receiver, u32 limit)
 {
 	int i, ret;
 	u32 num = 0, real_num = 0,  depth = 0, budget = 64;
 	dma_addr_t addr;
 	struct sk_buff *recv_skb = NULL;
+	struct sipa_recv_page *rpage = NULL;
 	struct sipa_hal_fifo_item item;
 	enum sipa_cmn_fifo_index id = receiver->ep->recv_fifo.idx;
 	struct sipa_control *ipa = sipa_get_ctrl_pointer();
@@ -346,6 +313,9 @@ static int do_recv(struct sipa_skb_receiver *receiver)
 		receiver->tx_danger_cnt++;
 	}
 
+	if (num > limit)
+		num = limit;
+
 read_again:
 	if (num > budget) {
 		num -= budget;
@@ -359,7 +329,7 @@ read_again:
 						      &item, i);
 
 		ret = get_recv_array_node(&receiver->recv_array,
-					  &recv_skb, &addr);
+					  &rpage, &addr);
 		if (!item.addr) {
 			dev_err(receiver->ctx->pdev,
 				"phy addr is null = %llx\n", (u64)item.addr);
@@ -377,10 +347,14 @@ read_again:
 			continue;
 		}
 
-		dma_unmap_single(receiver->ctx->pdev,
-				 addr,
-				 SIPA_RECV_BUF_LEN + skb_headroom(recv_skb),
-				 DMA_FROM_DEVICE);
+		recv_skb = sipa_recv_pool_build_skb(&receiver->pool, rpage,
+						    addr, item.len);
+		if (unlikely(!recv_skb)) {
+			dev_err(receiver->ctx->pdev,
+				"recv addr:0x%llx, build skb fail\n",
+				(u64)item.addr);
+			continue;
+		}
 
 		if (!ipa->eps[SIPA_EP_USB]->connected)
 			recv_skb->csum = item.csum;
@@ -411,10 +385,16 @@ static int fill_recv_thread(void *data)
 
 	while (!kthread_should_stop()) {
 		ret = wait_event_interruptible(receiver->fill_recv_waitq,
-				(atomic_read(&receiver->need_fill_cnt) > 0));
-		if (!ret)
-			fill_free_fifo(receiver,
-				       atomic_read(&receiver->need_fill_cnt));
+				(atomic_read(&receiver->need_fill_cnt) > 0) &&
+				!test_bit(SIPA_RECV_FILLING,
+					  &receiver->fill_state));
+		if (ret || !sipa_receiver_fill_trylock(receiver))
+			continue;
+
+		fill_free_fifo(receiver,
+			       atomic_read(&receiver->need_fill_cnt),
+			       GFP_KERNEL | GFP_NOWAIT);
+		sipa_receiver_fill_unlock(receiver);
 	}
 
 	return 0;
@@ -454,9 +434,10 @@ static int recv_thread(void *data)
 					 !sipa_receiver_ck_unread(receiver) &&
 					 !atomic_read(&receiver->need_sched));
 
-		recv_cnt = do_recv(receiver);
+		recv_cnt = do_recv(receiver, U32_MAX);
 		atomic_add(recv_cnt, &receiver->need_fill_cnt);
-		if (atomic_read(&receiver->need_fill_cnt) > 0x30)
+		if (atomic_read(&receiver->need_fill_cnt) >
+		    SIPA_RECV_FILL_THRESHOLD)
 			wake_up(&receiver->fill_recv_waitq);
 
 		trigger_nics_recv(receiver);
@@ -465,6 +446,60 @@ static int recv_thread(void *data)
 	return 0;
 }
 
+static int sipa_receiver_napi_poll(struct napi_struct *napi, int budget)
+{
+	struct sipa_skb_receiver *receiver =
+		container_of(napi, struct sipa_skb_receiver, napi);
+	int recv_cnt;
+
+	atomic_set(&receiver->check_flag, 1);
+	if (atomic_read(&receiver->check_suspend)) {
+		atomic_set(&receiver->check_flag, 0);
+		napi_complete(napi);
+		return 0;
+	}
+
+	recv_cnt = do_recv(receiver, budget);
+	atomic_set(&receiver->check_flag, 0);
+
+	/*
+	 * Give the consumed buffers back to the hardware right away,
+	 * the fill thread only takes over if we failed to refill here.
+	 */
+	atomic_add(recv_cnt, &receiver->need_fill_cnt);
+	if (atomic_read(&receiver->need_fill_cnt) > 0 &&
+	    sipa_receiver_fill_trylock(receiver)) {
+		fill_free_fifo(receiver,
+			       atomic_read(&receiver->need_fill_cnt),
+			       GFP_ATOMIC);
+		sipa_receiver_fill_unlock(receiver);
+	}
+	if (atomic_read(&receiver->need_fill_cnt) > 0)
+		wake_up(&receiver->fill_recv_waitq);
+
+	trigger_nics_recv(receiver);
+
+	/*
+	 * The nics are congested, stop polling until
+	 * sipa_receiver_clean_stop_recv() kicks us again.
+	 */
+	if (atomic_read(&receiver->need_sched)) {
+		recv_cnt = min(recv_cnt, budget - 1);
+		napi_complete_done(napi, recv_cnt);
+		return recv_cnt;
+	}
+
+	if (recv_cnt < budget) {
+		napi_complete_done(napi, recv_cnt);
+		/* catch the items arrived before the irq was re-armed */
+		if (!sipa_hal_is_tx_fifo_empty(receiver->ctx->hdl,
+					       receiver->ep->recv_fifo.idx))
+			napi_schedule(napi);
+	}
+
+	return recv_cnt;
+}
+
 bool sipa_receiver_has_stop_recv(void)
 {
 	int i;
@@ -502,7 +537,7 @@ void sipa_receiver_clean_stop_recv(void)
 		if (atomic_read(&recv->need_sched) &&
 		    atomic_read(&ctrl->recv_cnt) < depth) {
 			atomic_set(&recv->need_sched, 0);
-			wake_up(&recv->recv_waitq);
+			sipa_receiver_kick(recv);
 		}
 	}
 }
@@ -516,7 +551,7 @@ int sipa_receiver_prepare_suspend(struct sipa_skb_receiver *receiver)
 		dev_err(receiver->ctx->pdev,
 			"task recv %d is running\n", receiver->ep->id);
 		atomic_set(&receiver->check_suspend, 0);
-		wake_up(&receiver->recv_waitq);
+		sipa_receiver_kick(receiver);
 		return -EAGAIN;
 	}
 
@@ -525,7 +560,7 @@ int sipa_receiver_prepare_suspend(struct sipa_skb_receiver *receiver)
 		pr_err("sipa recv fifo %d tx fifo is not empty\n",
 		       receiver->ep->recv_fifo.idx);
 		atomic_set(&receiver->check_suspend, 0);
-		wake_up(&receiver->recv_waitq);
+		sipa_receiver_kick(receiver);
 		return -EAGAIN;
 	}
 
@@ -551,7 +586,8 @@ int sipa_receiver_prepare_resume(struct sipa_skb_receiver *receiver)
 	if (unlikely(receiver->init_flag)) {
 		dev_info(receiver->ctx->pdev, "receiver %d wake up thread\n",
 			 receiver->ep->id);
-		wake_up_process(receiver->thread);
+		if (receiver->thread)
+			wake_up_process(receiver->thread);
 		wake_up_process(receiver->fill_thread);
 		receiver->init_flag = false;
 	}
@@ -560,7 +596,7 @@ int sipa_receiver_prepare_resume(struct sipa_skb_receiver *receiver)
 				       receiver->ep->recv_fifo.idx)) {
 		pr_err("sipa recv fifo %d tx fifo is not empty\n",
 		       receiver->ep->recv_fifo.idx);
-		wake_up(&receiver->recv_waitq);
+		sipa_receiver_kick(receiver);
 		return 0;
 	}
 
@@ -684,14 +720,26 @@ int create_sipa_skb_receiver(struct sipa_context *ipa,
 	receiver->ctx = ipa;
 	receiver->ep = ep;
 	receiver->rsvd = SIPA_RECV_RSVD_LEN;
+	receiver->napi_mode = IS_ENABLED(CONFIG_SPRD_SIPA_RECV_NAPI);
 
 	atomic_set(&receiver->need_fill_cnt, 0);
 
+	ret = sipa_recv_pool_init(&receiver->pool, ipa->pdev,
+				  receiver->ep->recv_fifo.rx_fifo.fifo_depth,
+				  SIPA_RECV_RSVD_LEN, SIPA_RECV_BUF_LEN);
+	if (ret) {
+		dev_err(ipa->pdev,
+			"create_sipa_sipa_receiver: recv pool init err.\n");
+		kfree(receiver);
+		return ret;
+	}
+
 	ret = create_recv_array(&receiver->recv_array,
 				receiver->ep->recv_fifo.rx_fifo.fifo_depth);
 	if (ret) {
 		dev_err(ipa->pdev,
 			"create_sipa_sipa_receiver: recv_array kzalloc err.\n");
+		sipa_recv_pool_destroy(&receiver->pool);
 		kfree(receiver);
 		return -ENOMEM;
 	}
@@ -700,24 +748,42 @@ int create_sipa_skb_receiver(struct sipa_context *ipa,
 	init_waitqueue_head(&receiver->recv_waitq);
 	init_waitqueue_head(&receiver->fill_recv_waitq);
 
+	/*
+	 * In napi mode the fifo interrupt schedules the napi directly, it
+	 * is polled on the cpu the sipa irq is affine to.
+	 */
+	if (receiver->napi_mode) {
+		init_dummy_netdev(&receiver->napi_dev);
+		netif_napi_add(&receiver->napi_dev, &receiver->napi,
+			       sipa_receiver_napi_poll, SIPA_RECV_NAPI_WEIGHT);
+		napi_enable(&receiver->napi);
+	}
+
 	sipa_receiver_init(receiver, SIPA_RECV_RSVD_LEN);
 	/* create sender thread */
-	receiver->thread = kthread_create(recv_thread, receiver,
-					  "sipa-recv-%d", ep->id);
-	if (IS_ERR(receiver->thread)) {
-		dev_err(ipa->pdev,
-			"Failed to create kthread: ipa-recv-%d\n",
-			ep->id);
-		ret = PTR_ERR(receiver->thread);
-		kfree(receiver->recv_array.array);
-		kfree(receiver);
-		return ret;
+	if (!receiver->napi_mode) {
+		receiver->thread = kthread_create(recv_thread, receiver,
+						  "sipa-recv-%d", ep->id);
+		if (IS_ERR(receiver->thread)) {
+			dev_err(ipa->pdev,
+				"Failed to create kthread: ipa-recv-%d\n",
+				ep->id);
+			ret = PTR_ERR(receiver->thread);
+			kfree(receiver->recv_array.array);
+			kfree(receiver);
+			return ret;
+		}
 	}
 
 	receiver->fill_thread = kthread_create(fill_recv_thread, receiver,
 					       "sipa-fill-%d", ep->id);
 	if (IS_ERR(receiver->fill_thread)) {
-		kthread_stop(receiver->thread);
+		if (receiver->thread)
+			kthread_stop(receiver->thread);
+		if (receiver->napi_mode) {
+			napi_disable(&receiver->napi);
+			netif_napi_del(&receiver->napi);
+		}
 		dev_err(ipa->pdev, "Failed to create kthread: ipa-fill-%d\n",
 			ep->id);
 		ret = PTR_ERR(receiver->fill_thread);
@@ -733,8 +799,22 @@ EXPORT_SYMBOL(create_sipa_skb_receiver);
 
 void destroy_sipa_skb_receiver(struct sipa_skb_receiver *receiver)
 {
-	if (receiver->recv_array.array)
+	struct sipa_recv_page *rpage;
+	dma_addr_t addr;
+
+	if (receiver->napi_mode) {
+		napi_disable(&receiver->napi);
+		netif_napi_del(&receiver->napi);
+	}
+
+	if (receiver->recv_array.array) {
+		/* the buffers still owned by the hardware go back first */
+		while (!get_recv_array_node(&receiver->recv_array,
+					    &rpage, &addr))
+			sipa_recv_pool_put_buf(&receiver->pool, rpage);
 		destroy_recv_array(&receiver->recv_array);
+	}
+	sipa_recv_pool_destroy(&receiver->pool);
 
 	kfree(receiver);
 }
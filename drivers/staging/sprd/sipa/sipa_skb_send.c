@@ -20,6 +20,7 @@
 #include <linux/atomic.h>
 #include <linux/sched.h>
 #include <linux/kthread.h>
+#include <linux/log2.h>
 #include <linux/debugfs.h>
 #include <linux/seq_file.h>
 #include <linux/of_device.h>
@@ -32,6 +33,7 @@
 #include "sipa_hal.h"
 
 #define SIPA_RECEIVER_BUF_LEN     1600
+#define SIPA_SEND_NAPI_WEIGHT     64
 
 static void sipa_inform_evt_to_nics(struct sipa_skb_sender *sender,
 				    enum sipa_evt_type evt)
@@ -55,14 +57,14 @@ static void sipa_sender_notify_cb(void *priv, enum sipa_hal_evt_type evt,
 	struct sipa_skb_sender *sender = (struct sipa_skb_sender *)priv;
 
 	if (evt & SIPA_RECV_EVT)
-		wake_up(&sender->free_waitq);
+		sipa_skb_sender_kick(sender);
 
 	if (evt & SIPA_RECV_WARN_EVT) {
 		dev_err(sender->ctx->pdev,
 			"sipa overflow on ep:%d evt = 0x%x\n",
 			sender->ep->id, evt);
 		sender->no_free_cnt++;
-		wake_up(&sender->free_waitq);
+		sipa_skb_sender_kick(sender);
 	}
 
 	if (evt & SIPA_HAL_ENTER_FLOW_CTRL)
@@ -72,17 +74,68 @@ static void sipa_sender_notify_cb(void *priv, enum sipa_hal_evt_type evt,
 		sender->exit_flow_ctrl_cnt++;
 }
 
-static void sipa_free_sent_items(struct sipa_skb_sender *sender)
+void sipa_skb_sender_kick(struct sipa_skb_sender *sender)
 {
-	bool status = false;
-	unsigned long flags;
-	u32 i, num, success_cnt = 0;
-	struct sipa_skb_dma_addr_node *iter, *_iter;
+	if (sender->napi_mode)
+		napi_schedule(&sender->napi);
+	else
+		wake_up(&sender->free_waitq);
+}
+EXPORT_SYMBOL(sipa_skb_sender_kick);
+
+u32 sipa_skb_sender_free_cnt(struct sipa_skb_sender *sender)
+{
+	return sender->ring_size -
+		(READ_ONCE(sender->ring_head) - READ_ONCE(sender->ring_tail));
+}
+EXPORT_SYMBOL(sipa_skb_sender_free_cnt);
+
+/*
+ * Find the ring slot of a completed item. The fifo gives the items back
+ * in submit order, so this is the tail slot unless the hardware
+ * reordered them; then the matching slot is swapped into the tail.
+ * Only the completion side touches the slots between tail and head.
+ */
+static struct sipa_skb_dma_addr_node *
+sipa_sender_ring_match(struct sipa_skb_sender *sender, u32 head,
+		       dma_addr_t addr)
+{
+	u32 mask = sender->ring_size - 1;
+	u32 tail = sender->ring_tail;
+	struct sipa_skb_dma_addr_node *node, *iter, tmp;
+	u32 i;
+
+	node = &sender->pair_cache[tail & mask];
+	if (likely(node->dma_addr == addr))
+		return node;
+
+	for (i = tail + 1; i != head; i++) {
+		iter = &sender->pair_cache[i & mask];
+		if (iter->dma_addr == addr) {
+			tmp = *node;
+			*node = *iter;
+			*iter = tmp;
+			sender->unordered_cnt++;
+			return node;
+		}
+	}
+
+	return NULL;
+}
+
+static u32 sipa_free_sent_items(struct sipa_skb_sender *sender, u32 budget,
+				int napi_budget)
+{
+	u32 i, num, head, success_cnt = 0;
+	struct sipa_skb_dma_addr_node *node;
 	struct sipa_hal_fifo_item item;
 
 	num = sipa_hal_get_tx_fifo_items(sender->ctx->hdl,
 					 sender->ep->send_fifo.idx);
+	num = min(num, budget);
 
+	/* pairs with the release in sipa_skb_sender_cache_item() */
+	head = smp_load_acquire(&sender->ring_head);
 	for (i = 0; i < num; i++) {
 		sipa_hal_recv_conversion_node_to_item(sender->ctx->hdl,
 						      sender->ep->send_fifo.idx,
@@ -91,42 +144,35 @@ static void sipa_free_sent_items(struct sipa_skb_sender *sender)
 			dev_err(sender->ctx->pdev,
 				"have node transfer err = %d\n", item.err_code);
 
-		spin_lock_irqsave(&sender->send_lock, flags);
-		if (list_empty(&sender->sending_list)) {
-			pr_err("fifo id %d: send list is empty i = %d num = %d\n",
+		if (sender->ring_tail == head) {
+			pr_err("fifo id %d: send ring is empty i = %d num = %d\n",
 			       sender->ep->send_fifo.idx, i, num);
-			spin_unlock_irqrestore(&sender->send_lock, flags);
 			continue;
 		}
 
-		list_for_each_entry_safe(iter, _iter,
-					 &sender->sending_list, list) {
-			if (iter->dma_addr == item.addr) {
-				list_del(&iter->list);
-				list_add_tail(&iter->list,
-					      &sender->pair_free_list);
-				status = true;
-				break;
-			}
-		}
-		spin_unlock_irqrestore(&sender->send_lock, flags);
-		if (status) {
-			dma_unmap_single(sender->ctx->pdev,
-					 iter->dma_addr,
-					 iter->skb->len +
-					 skb_headroom(iter->skb),
-					 DMA_TO_DEVICE);
-
-			dev_kfree_skb_any(iter->skb);
-			success_cnt++;
-			status = false;
-		}
+		node = sipa_sender_ring_match(sender, head, item.addr);
+		if (!node)
+			continue;
+
+		dma_unmap_single(sender->ctx->pdev,
+				 node->dma_addr,
+				 node->skb->len +
+				 skb_headroom(node->skb),
+				 DMA_TO_DEVICE);
+
+		if (napi_budget)
+			napi_consume_skb(node->skb, napi_budget);
+		else
+			dev_kfree_skb_any(node->skb);
+		node->skb = NULL;
+		/* the slot may be reused by the submitters from here on */
+		smp_store_release(&sender->ring_tail, sender->ring_tail + 1);
+		success_cnt++;
 	}
 	sipa_hal_set_tx_fifo_rptr(sender->ctx->hdl,
 				  sender->ep->send_fifo.idx, num);
-	atomic_add(success_cnt, &sender->left_cnt);
 	if (sender->free_notify_net &&
-	    atomic_read(&sender->left_cnt) >
+	    sipa_skb_sender_free_cnt(sender) >
 	    sender->ep->send_fifo.rx_fifo.fifo_depth / 4) {
 		sender->free_notify_net = false;
 		sipa_inform_evt_to_nics(sender, SIPA_LEAVE_FLOWCTRL);
@@ -135,6 +181,8 @@ static void sipa_free_sent_items(struct sipa_skb_sender *sender)
 		dev_err(sender->ctx->pdev,
 			"i = %d recv num = %d release num = %d\n",
 			i, num, success_cnt);
+
+	return num;
 }
 
 static bool sipa_sender_ck_unfree(struct sipa_skb_sender *sender)
@@ -168,12 +216,39 @@ static int sipa_free_thread(void *data)
 					 !sipa_sender_ck_unfree(sender) ||
 					 sender->free_notify_net);
 
-		sipa_free_sent_items(sender);
+		sipa_free_sent_items(sender, U32_MAX, 0);
 	}
 
 	return 0;
 }
 
+static int sipa_sender_napi_poll(struct napi_struct *napi, int budget)
+{
+	struct sipa_skb_sender *sender =
+		container_of(napi, struct sipa_skb_sender, napi);
+	u32 done;
+
+	atomic_set(&sender->check_flag, 1);
+	if (atomic_read(&sender->check_suspend)) {
+		atomic_set(&sender->check_flag, 0);
+		napi_complete(napi);
+		return 0;
+	}
+
+	done = sipa_free_sent_items(sender, budget, budget);
+	atomic_set(&sender->check_flag, 0);
+
+	if (done < budget) {
+		napi_complete_done(napi, done);
+		/* catch the items completed before the irq was re-armed */
+		if (!sipa_hal_is_tx_fifo_empty(sender->ctx->hdl,
+					       sender->ep->send_fifo.idx))
+			napi_schedule(napi);
+	}
+
+	return done;
+}
+
 static int sipa_skb_sender_init(struct sipa_skb_sender *sender)
 {
 	struct sipa_comm_fifo_params attr;
@@ -211,15 +286,15 @@ int sipa_sender_prepare_suspend(struct sipa_skb_sender *sender)
 		dev_err(sender->ctx->pdev,
 			"task send %d is running\n", sender->ep->id);
 		atomic_set(&sender->check_suspend, 0);
-		wake_up(&sender->free_waitq);
+		sipa_skb_sender_kick(sender);
 		return -EAGAIN;
 	}
 
-	if (!list_empty(&sender->sending_list)) {
-		pr_err("pkt_type = %d sending list have unsend node\n",
+	if (READ_ONCE(sender->ring_head) != READ_ONCE(sender->ring_tail)) {
+		pr_err("pkt_type = %d sending ring have unsend node\n",
 		       sender->type);
 		atomic_set(&sender->check_suspend, 0);
-		wake_up(&sender->free_waitq);
+		sipa_skb_sender_kick(sender);
 		return -EAGAIN;
 	}
 
@@ -228,7 +303,7 @@ int sipa_sender_prepare_suspend(struct sipa_skb_sender *sender)
 		pr_err("pkt_type = %d sender have something to handle\n",
 		       sender->type);
 		atomic_set(&sender->check_suspend, 0);
-		wake_up(&sender->free_waitq);
+		sipa_skb_sender_kick(sender);
 		return -EAGAIN;
 	}
 
@@ -240,7 +315,8 @@ int sipa_sender_prepare_resume(struct sipa_skb_sender *sender)
 {
 	atomic_set(&sender->check_suspend, 0);
 	if (unlikely(sender->init_flag)) {
-		wake_up_process(sender->free_thread);
+		if (sender->free_thread)
+			wake_up_process(sender->free_thread);
 		sender->init_flag = false;
 	}
 
@@ -248,7 +324,7 @@ int sipa_sender_prepare_resume(struct sipa_skb_sender *sender)
 				       sender->ep->send_fifo.idx)) {
 		dev_err(sender->ctx->pdev, "type = %d, tx fifo is not empty\n",
 			sender->type);
-		wake_up(&sender->free_waitq);
+		sipa_skb_sender_kick(sender);
 	}
 
 	return 0;
@@ -260,15 +336,22 @@ int create_sipa_skb_sender(struct sipa_context *ipa,
 			   enum sipa_xfer_pkt_type type,
 			   struct sipa_skb_sender **sender_pp)
 {
-	int i, ret;
+	int ret;
 	struct sipa_skb_sender *sender = NULL;
 
 	dev_info(ipa->pdev, "%s ep->id = %d start\n", __func__, ep->id);
+	if (!is_power_of_2(ep->send_fifo.rx_fifo.fifo_depth)) {
+		dev_err(ipa->pdev, "ep->id = %d bad fifo depth %d\n",
+			ep->id, ep->send_fifo.rx_fifo.fifo_depth);
+		return -EINVAL;
+	}
+
 	sender = kzalloc(sizeof(*sender), GFP_KERNEL);
 	if (!sender)
 		return -ENOMEM;
 
-	sender->pair_cache = kcalloc(ep->send_fifo.rx_fifo.fifo_depth,
+	sender->ring_size = ep->send_fifo.rx_fifo.fifo_depth;
+	sender->pair_cache = kcalloc(sender->ring_size,
 				     sizeof(struct sipa_skb_dma_addr_node),
 				     GFP_KERNEL);
 	if (!sender->pair_cache) {
@@ -277,36 +360,39 @@ int create_sipa_skb_sender(struct sipa_context *ipa,
 	}
 
 	INIT_LIST_HEAD(&sender->nic_list);
-	INIT_LIST_HEAD(&sender->sending_list);
-	INIT_LIST_HEAD(&sender->pair_free_list);
 	spin_lock_init(&sender->nic_lock);
 	spin_lock_init(&sender->send_lock);
 
-	for (i = 0; i < ep->send_fifo.rx_fifo.fifo_depth; i++)
-		list_add_tail(&((sender->pair_cache + i)->list),
-			      &sender->pair_free_list);
-
 	sender->ctx = ipa;
 	sender->ep = ep;
 	sender->type = type;
+	sender->napi_mode = IS_ENABLED(CONFIG_SPRD_SIPA_SEND_NAPI);
+
+	init_waitqueue_head(&sender->send_waitq);
+	init_waitqueue_head(&sender->free_waitq);
 
-	atomic_set(&sender->left_cnt, ep->send_fifo.rx_fifo.fifo_depth);
+	if (sender->napi_mode) {
+		init_dummy_netdev(&sender->napi_dev);
+		netif_napi_add(&sender->napi_dev, &sender->napi,
+			       sipa_sender_napi_poll, SIPA_SEND_NAPI_WEIGHT);
+		napi_enable(&sender->napi);
+	}
 
 	/* reigster sender ipa event callback */
 	sipa_skb_sender_init(sender);
 
-	init_waitqueue_head(&sender->send_waitq);
-	init_waitqueue_head(&sender->free_waitq);
-
-	sender->free_thread = kthread_create(sipa_free_thread, sender,
-					     "sipa-free-%d", ep->id);
-	if (IS_ERR(sender->free_thread)) {
-		dev_err(ipa->pdev, "Failed to create kthread: ipa-free-%d\n",
-			ep->id);
-		ret = PTR_ERR(sender->free_thread);
-		kfree(sender->pair_cache);
-		kfree(sender);
-		return ret;
+	if (!sender->napi_mode) {
+		sender->free_thread = kthread_create(sipa_free_thread, sender,
+						     "sipa-free-%d", ep->id);
+		if (IS_ERR(sender->free_thread)) {
+			dev_err(ipa->pdev,
+				"Failed to create kthread: ipa-free-%d\n",
+				ep->id);
+			ret = PTR_ERR(sender->free_thread);
+			kfree(sender->pair_cache);
+			kfree(sender);
+			return ret;
+		}
 	}
 
 	*sender_pp = sender;
@@ -316,6 +402,11 @@ EXPORT_SYMBOL(create_sipa_skb_sender);
 
 void destroy_sipa_skb_sender(struct sipa_skb_sender *sender)
 {
+	if (sender->napi_mode) {
+		napi_disable(&sender->napi);
+		netif_napi_del(&sender->napi);
+	}
+
 	kfree(sender->pair_cache);
 	kfree(sender);
 }
@@ -343,16 +434,13 @@ void sipa_skb_sender_remove_nic(struct sipa_skb_sender *sender,
 }
 EXPORT_SYMBOL(sipa_skb_sender_remove_nic);
 
-int sipa_skb_sender_send_data(struct sipa_skb_sender *sender,
-			      struct sk_buff *skb,
-			      enum sipa_term_type dst,
-			      u8 netid)
+static int sipa_skb_sender_map_item(struct sipa_skb_sender *sender,
+				    struct sk_buff *skb,
+				    enum sipa_term_type dst,
+				    u8 netid,
+				    struct sipa_hal_fifo_item *item)
 {
-	int ret;
-	unsigned long flags;
 	dma_addr_t dma_addr;
-	struct sipa_skb_dma_addr_node *node;
-	struct sipa_hal_fifo_item item;
 
 	dma_addr = dma_map_single(sender->ctx->pdev,
 				  skb->head,
@@ -362,13 +450,13 @@ int sipa_skb_sender_send_data(struct sipa_skb_sender *sender,
 	if (unlikely(dma_mapping_error(sender->ctx->pdev, dma_addr)))
 		return -ENOMEM;
 
-	memset(&item, 0, sizeof(item));
-	item.addr = dma_addr;
-	item.len = skb->len;
-	item.offset = skb_headroom(skb);
-	item.netid = netid;
-	item.dst = dst;
-	item.src = sender->ep->send_fifo.src_id;
+	memset(item, 0, sizeof(*item));
+	item->addr = dma_addr;
+	item->len = skb->len;
+	item->offset = skb_headroom(skb);
+	item->netid = netid;
+	item->dst = dst;
+	item->src = sender->ep->send_fifo.src_id;
 
 	if ((s8)netid != -1 && skb->ip_summed == CHECKSUM_PARTIAL) {
 		struct iphdr *iph;
@@ -376,25 +464,25 @@ int sipa_skb_sender_send_data(struct sipa_skb_sender *sender,
 
 		if (skb->protocol == htons(ETH_P_IP)) {
 			iph = ip_hdr(skb);
-			item.ul_csum_en = true;
+			item->ul_csum_en = true;
 
 			if (iph->protocol == IPPROTO_TCP)
-				item.ul_tcp_udp_flag = 0;
+				item->ul_tcp_udp_flag = 0;
 			else if (iph->protocol == IPPROTO_UDP)
-				item.ul_tcp_udp_flag = 1;
+				item->ul_tcp_udp_flag = 1;
 		} else if (skb->protocol == htons(ETH_P_IPV6)) {
 			ipv6h = ipv6_hdr(skb);
-			item.ul_csum_en = true;
+			item->ul_csum_en = true;
 
 			if (ipv6h->nexthdr == NEXTHDR_TCP)
-				item.ul_tcp_udp_flag = 0;
+				item->ul_tcp_udp_flag = 0;
 			else if (ipv6h->nexthdr == NEXTHDR_UDP)
-				item.ul_tcp_udp_flag = 1;
+				item->ul_tcp_udp_flag = 1;
 		}
 
-		if (item.ul_csum_en &&
+		if (item->ul_csum_en &&
 		    skb->transport_header > skb_headroom(skb))
-			item.ul_upper_layer_hdr_offset = skb->transport_header -
+			item->ul_upper_layer_hdr_offset = skb->transport_header -
 				skb_headroom(skb);
 		else
 			dev_err(sender->ctx->pdev,
@@ -404,45 +492,150 @@ int sipa_skb_sender_send_data(struct sipa_skb_sender *sender,
 				skb->protocol);
 	}
 
-	spin_lock_irqsave(&sender->send_lock, flags);
-	if (!atomic_read(&sender->left_cnt)) {
-		spin_unlock_irqrestore(&sender->send_lock, flags);
-		dma_unmap_single(sender->ctx->pdev,
-				 dma_addr,
-				 skb->len + skb_headroom(skb),
-				 DMA_TO_DEVICE);
+	return 0;
+}
+
+static void sipa_skb_sender_unmap_item(struct sipa_skb_sender *sender,
+				       struct sk_buff *skb,
+				       struct sipa_hal_fifo_item *item)
+{
+	dma_unmap_single(sender->ctx->pdev,
+			 item->addr,
+			 skb->len + skb_headroom(skb),
+			 DMA_TO_DEVICE);
+}
+
+/*
+ * Write one item behind the ones already cached but not yet made visible
+ * to the hardware. Must be called with send_lock held.
+ */
+static int sipa_skb_sender_cache_item(struct sipa_skb_sender *sender,
+				      struct sk_buff *skb,
+				      struct sipa_hal_fifo_item *item)
+{
+	int ret;
+	u32 head = sender->ring_head;
+	struct sipa_skb_dma_addr_node *node;
+
+	/* pairs with the release in sipa_free_sent_items() */
+	if (head - smp_load_acquire(&sender->ring_tail) >= sender->ring_size) {
 		sender->no_free_cnt++;
 		return -EAGAIN;
 	}
-	atomic_dec(&sender->left_cnt);
+
 	ret = sipa_hal_cache_rx_fifo_item(sender->ctx->hdl,
 					  sender->ep->send_fifo.idx,
-					  &item, 0);
-	if (ret) {
-		spin_unlock_irqrestore(&sender->send_lock, flags);
-		dma_unmap_single(sender->ctx->pdev,
-				 dma_addr,
-				 skb->len + skb_headroom(skb),
-				 DMA_TO_DEVICE);
-		atomic_add(1, &sender->left_cnt);
+					  item, sender->pending_cnt);
+	if (ret)
 		return ret;
-	}
 
-	node = list_first_entry(&sender->pair_free_list,
-				struct sipa_skb_dma_addr_node,
-				list);
+	node = &sender->pair_cache[head & (sender->ring_size - 1)];
 	node->skb = skb;
-	node->dma_addr = dma_addr;
-	list_del(&node->list);
-	list_add_tail(&node->list, &sender->sending_list);
+	node->dma_addr = item->addr;
+	/* publish the slot before the completion side may look at it */
+	smp_store_release(&sender->ring_head, head + 1);
+	sender->pending_cnt++;
+
+	return 0;
+}
+
+/* Must be called with send_lock held */
+static void sipa_skb_sender_ring(struct sipa_skb_sender *sender)
+{
+	if (!sender->pending_cnt)
+		return;
+
 	sipa_hal_update_rx_fifo_wptr(sender->ctx->hdl,
-				     sender->ep->send_fifo.idx, 1);
+				     sender->ep->send_fifo.idx,
+				     sender->pending_cnt);
+	sender->pending_cnt = 0;
+}
+
+int sipa_skb_sender_send_data(struct sipa_skb_sender *sender,
+			      struct sk_buff *skb,
+			      enum sipa_term_type dst,
+			      u8 netid)
+{
+	int ret;
+	unsigned long flags;
+	struct sipa_hal_fifo_item item;
+
+	ret = sipa_skb_sender_map_item(sender, skb, dst, netid, &item);
+	if (ret)
+		return ret;
+
+	spin_lock_irqsave(&sender->send_lock, flags);
+	ret = sipa_skb_sender_cache_item(sender, skb, &item);
+	sipa_skb_sender_ring(sender);
 	spin_unlock_irqrestore(&sender->send_lock, flags);
 
-	return 0;
+	if (ret)
+		sipa_skb_sender_unmap_item(sender, skb, &item);
+
+	return ret;
 }
 EXPORT_SYMBOL(sipa_skb_sender_send_data);
 
+/**
+ * sipa_skb_sender_send_list() - send several skbs with one doorbell
+ * @sender: skb sender
+ * @list: skbs to send, the ones that were sent are dequeued
+ * @dst: destination terminal
+ * @netid: network id of the skbs
+ * @more: more skbs follow, leave the write pointer to a later call
+ *
+ * All items are written under one send_lock acquisition. The write
+ * pointer is updated once at the end unless @more is set, it is always
+ * updated when the fifo runs full so nothing waits for a doorbell that
+ * the caller is not going to give.
+ *
+ * Return: number of skbs sent, -EAGAIN if the fifo had no room for any.
+ */
+int sipa_skb_sender_send_list(struct sipa_skb_sender *sender,
+			      struct sk_buff_head *list,
+			      enum sipa_term_type dst,
+			      u8 netid, bool more)
+{
+	int ret = 0, sent = 0;
+	unsigned long flags;
+	struct sk_buff *skb;
+	struct sipa_hal_fifo_item item;
+
+	spin_lock_irqsave(&sender->send_lock, flags);
+	while ((skb = skb_peek(list)) != NULL) {
+		ret = sipa_skb_sender_map_item(sender, skb, dst, netid, &item);
+		if (ret)
+			break;
+
+		ret = sipa_skb_sender_cache_item(sender, skb, &item);
+		if (ret) {
+			sipa_skb_sender_unmap_item(sender, skb, &item);
+			break;
+		}
+
+		__skb_unlink(skb, list);
+		sent++;
+	}
+
+	if (!more || ret)
+		sipa_skb_sender_ring(sender);
+	spin_unlock_irqrestore(&sender->send_lock, flags);
+
+	return sent ? sent : ret;
+}
+EXPORT_SYMBOL(sipa_skb_sender_send_list);
+
+/* Make the items cached by a send with @more set visible to the hardware */
+void sipa_skb_sender_flush(struct sipa_skb_sender *sender)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&sender->send_lock, flags);
+	sipa_skb_sender_ring(sender);
+	spin_unlock_irqrestore(&sender->send_lock, flags);
+}
+EXPORT_SYMBOL(sipa_skb_sender_flush);
+
 bool sipa_skb_sender_check_send_complete(struct sipa_skb_sender *sender)
 {
 	struct sipa_control *ctrl = sipa_get_ctrl_pointer();
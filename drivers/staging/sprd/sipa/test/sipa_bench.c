@@ -0,0 +1,588 @@
+/*
+ * Copyright (C) 2019 Spreadtrum Communications Inc.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Loopback benchmark. Like sipa_loop_test it sends from the vcp nic to
+ * vap0 and expects the packets back on the vcp nic, so the ipa has to be
+ * set up for the loopback first. Every packet carries its flow, a per flow
+ * sequence number and its send time, the receiver counts the lost and
+ * reordered packets and puts the round trip time into a 1us histogram.
+ *
+ * debugfs sipa_bench/:
+ *   pkt_len, rate_pps (0: as fast as possible), flows, batch, duration_ms,
+ *   tx_cpu and rx_cpu (>= nr_cpu_ids: not bound) set up the next run.
+ *   run: write 1 to start a run, 0 to stop it, reads 1 while it runs.
+ *   result: pps, Gbps, cpu ns per packet and latency percentiles.
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/skbuff.h>
+#include <linux/ktime.h>
+#include <linux/delay.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/kthread.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/sipa.h>
+
+#include "../sipa_priv.h"
+
+#define SIPA_BENCH_MAGIC	0x53424e48	/* "SBNH" */
+#define SIPA_BENCH_MAX_FLOWS	64
+#define SIPA_BENCH_MAX_BATCH	256
+#define SIPA_BENCH_MAX_LEN	1500
+#define SIPA_BENCH_LAT_US	4096	/* histogram range, the rest is overflow */
+#define SIPA_BENCH_DRAIN_MS	200	/* rx wait for late packets after tx */
+#define SIPA_BENCH_FC_MS	10	/* tx wait for flow control to end */
+
+struct sipa_bench_hdr {
+	u32 magic;
+	u32 flow;
+	u32 seq;
+	u32 reserved;
+	u64 ts;
+};
+
+struct sipa_bench_cfg {
+	u32 pkt_len;
+	u32 rate_pps;
+	u32 flows;
+	u32 batch;
+	u32 duration_ms;
+	u32 tx_cpu;
+	u32 rx_cpu;
+};
+
+struct sipa_bench_result {
+	u64 tx_pkts;
+	u64 tx_bytes;
+	u64 tx_fail;		/* alloc or send errors */
+	u64 tx_flowctrl;	/* times the sender ran into flow control */
+	u64 rx_pkts;
+	u64 rx_bytes;
+	u64 rx_bad;		/* not ours or too short */
+	u64 rx_reorder;		/* older seq than one seen before */
+	u64 rx_gap;		/* seqs skipped, lost unless reordered */
+	u64 tx_ns;		/* wall time of the tx loop */
+	u64 rx_ns;		/* first to last packet received */
+	u64 tx_cpu_ns;		/* cpu time of the threads */
+	u64 rx_cpu_ns;
+	u64 lat_max_ns;
+	u64 lat_sum_ns;
+	u32 lat_over;
+	u32 lat[SIPA_BENCH_LAT_US];
+};
+
+struct sipa_bench {
+	struct mutex lock;	/* start, stop and result against each other */
+	struct sipa_bench_cfg cfg;
+	struct sipa_bench_cfg run_cfg;
+	struct sipa_bench_result *res;
+
+	enum sipa_nic_id nic_id;
+	struct task_struct *tx_thread;
+	struct task_struct *rx_thread;
+	wait_queue_head_t rx_wq;
+	wait_queue_head_t fc_wq;
+	bool flow_ctrl;
+	bool tx_done;
+	bool rx_done;
+	bool running;
+
+	u32 tx_seq[SIPA_BENCH_MAX_FLOWS];
+	u32 rx_seq[SIPA_BENCH_MAX_FLOWS];
+	u64 rx_first;
+	u64 rx_last;
+};
+
+static struct sipa_bench s_bench = {
+	.lock = __MUTEX_INITIALIZER(s_bench.lock),
+	.cfg = {
+		.pkt_len = 1400,
+		.flows = 1,
+		.batch = 32,
+		.duration_ms = 10000,
+		.tx_cpu = U32_MAX,
+		.rx_cpu = U32_MAX,
+	},
+	.nic_id = SIPA_NIC_MAX,
+};
+
+static void sipa_bench_notify_cb(void *priv, enum sipa_evt_type evt,
+				 unsigned long data)
+{
+	struct sipa_bench *b = priv;
+
+	switch (evt) {
+	case SIPA_RECEIVE:
+		wake_up(&b->rx_wq);
+		break;
+	case SIPA_LEAVE_FLOWCTRL:
+		WRITE_ONCE(b->flow_ctrl, false);
+		wake_up(&b->fc_wq);
+		break;
+	case SIPA_ENTER_FLOWCTRL:
+		WRITE_ONCE(b->flow_ctrl, true);
+		break;
+	default:
+		break;
+	}
+}
+
+/* keep the results until sipa_bench_stop() collects the thread */
+static void sipa_bench_park(void)
+{
+	for (;;) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (kthread_should_stop())
+			break;
+		schedule();
+	}
+	__set_current_state(TASK_RUNNING);
+}
+
+static struct sk_buff *sipa_bench_alloc_pkt(struct sipa_bench *b, u32 flow)
+{
+	struct sipa_bench_hdr *hdr;
+	struct sk_buff *skb;
+	u32 len = b->run_cfg.pkt_len;
+
+	skb = __dev_alloc_skb(len, GFP_KERNEL);
+	if (!skb)
+		return NULL;
+
+	hdr = (struct sipa_bench_hdr *)skb_put(skb, len);
+	hdr->magic = SIPA_BENCH_MAGIC;
+	hdr->flow = flow;
+	hdr->seq = b->tx_seq[flow]++;
+	hdr->reserved = 0;
+	hdr->ts = ktime_get_ns();
+
+	return skb;
+}
+
+/* sleep until the packets sent so far are due under rate_pps */
+static void sipa_bench_pace(struct sipa_bench *b, u64 start, u64 sent)
+{
+	u64 due, now;
+
+	if (!b->run_cfg.rate_pps)
+		return;
+
+	due = start + div_u64(sent * NSEC_PER_SEC, b->run_cfg.rate_pps);
+	now = ktime_get_ns();
+	if (due > now + NSEC_PER_USEC)
+		usleep_range(div_u64(due - now, NSEC_PER_USEC),
+			     div_u64(due - now, NSEC_PER_USEC) + 50);
+}
+
+static int sipa_bench_tx_thread(void *data)
+{
+	struct sipa_bench *b = data;
+	struct sipa_bench_result *res = b->res;
+	struct sk_buff_head list;
+	struct sk_buff *skb;
+	u64 start, end, bytes;
+	u32 flow = 0, i;
+	int ret;
+
+	__skb_queue_head_init(&list);
+	start = ktime_get_ns();
+	end = start + (u64)b->run_cfg.duration_ms * NSEC_PER_MSEC;
+
+	while (!kthread_should_stop() && ktime_get_ns() < end) {
+		/* refill what the last call left behind */
+		for (i = skb_queue_len(&list); i < b->run_cfg.batch; i++) {
+			skb = sipa_bench_alloc_pkt(b, flow);
+			if (!skb) {
+				res->tx_fail++;
+				break;
+			}
+			__skb_queue_tail(&list, skb);
+			if (++flow == b->run_cfg.flows)
+				flow = 0;
+		}
+
+		ret = sipa_nic_tx_list(b->nic_id, SIPA_TERM_VAP0, 0, &list,
+				       false);
+		if (ret > 0) {
+			bytes = (u64)ret * b->run_cfg.pkt_len;
+			res->tx_pkts += ret;
+			res->tx_bytes += bytes;
+		} else if (ret != -EAGAIN) {
+			res->tx_fail += skb_queue_len(&list);
+			__skb_queue_purge(&list);
+			msleep(SIPA_BENCH_FC_MS);
+			continue;
+		}
+
+		if (!skb_queue_empty(&list)) {
+			res->tx_flowctrl++;
+			wait_event_interruptible_timeout(b->fc_wq,
+					!READ_ONCE(b->flow_ctrl) ||
+					kthread_should_stop(),
+					msecs_to_jiffies(SIPA_BENCH_FC_MS));
+			continue;
+		}
+
+		sipa_bench_pace(b, start, res->tx_pkts);
+	}
+
+	__skb_queue_purge(&list);
+	res->tx_ns = ktime_get_ns() - start;
+	res->tx_cpu_ns = current->se.sum_exec_runtime;
+	WRITE_ONCE(b->tx_done, true);
+	wake_up(&b->rx_wq);
+
+	sipa_bench_park();
+
+	return 0;
+}
+
+static void sipa_bench_rx_pkt(struct sipa_bench *b, struct sk_buff *skb)
+{
+	struct sipa_bench_result *res = b->res;
+	struct sipa_bench_hdr *hdr;
+	u64 now = ktime_get_ns(), lat, us;
+	u32 exp;
+
+	if (skb->data_len < sizeof(*hdr)) {
+		res->rx_bad++;
+		return;
+	}
+
+	hdr = (struct sipa_bench_hdr *)(skb->data + SIPA_DEF_OFFSET);
+	if (hdr->magic != SIPA_BENCH_MAGIC ||
+	    hdr->flow >= b->run_cfg.flows) {
+		res->rx_bad++;
+		return;
+	}
+
+	if (!res->rx_pkts)
+		b->rx_first = now;
+	b->rx_last = now;
+	res->rx_pkts++;
+	res->rx_bytes += skb->data_len;
+
+	exp = b->rx_seq[hdr->flow];
+	if ((s32)(hdr->seq - exp) < 0) {
+		res->rx_reorder++;
+	} else {
+		res->rx_gap += hdr->seq - exp;
+		b->rx_seq[hdr->flow] = hdr->seq + 1;
+	}
+
+	lat = now - hdr->ts;
+	res->lat_sum_ns += lat;
+	if (lat > res->lat_max_ns)
+		res->lat_max_ns = lat;
+	us = div_u64(lat, NSEC_PER_USEC);
+	if (us < SIPA_BENCH_LAT_US)
+		res->lat[us]++;
+	else
+		res->lat_over++;
+}
+
+static int sipa_bench_rx_thread(void *data)
+{
+	struct sipa_bench *b = data;
+	struct sk_buff *skb;
+	long left;
+
+	while (!kthread_should_stop()) {
+		left = wait_event_interruptible_timeout(b->rx_wq,
+				sipa_nic_rx_has_data(b->nic_id) ||
+				kthread_should_stop(),
+				msecs_to_jiffies(SIPA_BENCH_DRAIN_MS));
+
+		while (!sipa_nic_rx(b->nic_id, &skb)) {
+			sipa_bench_rx_pkt(b, skb);
+			dev_kfree_skb_any(skb);
+		}
+
+		/* tx is over and nothing came within the drain time */
+		if (!left && READ_ONCE(b->tx_done))
+			break;
+	}
+
+	b->res->rx_ns = b->rx_last - b->rx_first;
+	b->res->rx_cpu_ns = current->se.sum_exec_runtime;
+	WRITE_ONCE(b->rx_done, true);
+
+	sipa_bench_park();
+
+	return 0;
+}
+
+static struct task_struct *sipa_bench_thread(struct sipa_bench *b,
+					     int (*fn)(void *), u32 cpu,
+					     const char *name)
+{
+	struct task_struct *t;
+
+	t = kthread_create(fn, b, name);
+	if (IS_ERR(t)) {
+		pr_err("sipa_bench: failed to create %s\n", name);
+		return t;
+	}
+
+	if (cpu < nr_cpu_ids && cpu_online(cpu))
+		kthread_bind(t, cpu);
+	get_task_struct(t);
+
+	return t;
+}
+
+static void sipa_bench_stop(struct sipa_bench *b)
+{
+	if (!b->running)
+		return;
+
+	kthread_stop(b->tx_thread);
+	put_task_struct(b->tx_thread);
+	kthread_stop(b->rx_thread);
+	put_task_struct(b->rx_thread);
+	sipa_nic_close(b->nic_id);
+	b->nic_id = SIPA_NIC_MAX;
+	b->running = false;
+}
+
+static int sipa_bench_start(struct sipa_bench *b)
+{
+	struct sipa_bench_cfg *cfg = &b->cfg;
+	int ret;
+
+	if (cfg->pkt_len < sizeof(struct sipa_bench_hdr) ||
+	    cfg->pkt_len > SIPA_BENCH_MAX_LEN ||
+	    !cfg->flows || cfg->flows > SIPA_BENCH_MAX_FLOWS ||
+	    !cfg->batch || cfg->batch > SIPA_BENCH_MAX_BATCH ||
+	    !cfg->duration_ms)
+		return -EINVAL;
+
+	sipa_bench_stop(b);
+
+	if (!b->res) {
+		b->res = vmalloc(sizeof(*b->res));
+		if (!b->res)
+			return -ENOMEM;
+	}
+	memset(b->res, 0, sizeof(*b->res));
+	memset(b->tx_seq, 0, sizeof(b->tx_seq));
+	memset(b->rx_seq, 0, sizeof(b->rx_seq));
+	b->run_cfg = *cfg;
+	b->flow_ctrl = false;
+	b->tx_done = false;
+	b->rx_done = false;
+	b->rx_first = 0;
+	b->rx_last = 0;
+
+	ret = sipa_nic_open(SIPA_TERM_VCP, 0, sipa_bench_notify_cb, b);
+	if (ret < 0) {
+		pr_err("sipa_bench: sipa nic open failed %d\n", ret);
+		return ret;
+	}
+	b->nic_id = ret;
+
+	b->rx_thread = sipa_bench_thread(b, sipa_bench_rx_thread,
+					 cfg->rx_cpu, "sipa_bench_rx");
+	if (IS_ERR(b->rx_thread)) {
+		ret = PTR_ERR(b->rx_thread);
+		goto err_close;
+	}
+
+	b->tx_thread = sipa_bench_thread(b, sipa_bench_tx_thread,
+					 cfg->tx_cpu, "sipa_bench_tx");
+	if (IS_ERR(b->tx_thread)) {
+		ret = PTR_ERR(b->tx_thread);
+		goto err_rx;
+	}
+
+	b->running = true;
+	wake_up_process(b->rx_thread);
+	wake_up_process(b->tx_thread);
+
+	return 0;
+
+err_rx:
+	kthread_stop(b->rx_thread);
+	put_task_struct(b->rx_thread);
+err_close:
+	sipa_nic_close(b->nic_id);
+	b->nic_id = SIPA_NIC_MAX;
+	return ret;
+}
+
+static int sipa_bench_run_show(struct seq_file *s, void *unused)
+{
+	struct sipa_bench *b = s->private;
+
+	seq_printf(s, "%d\n", b->running && !READ_ONCE(b->rx_done));
+	return 0;
+}
+
+static int sipa_bench_run_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sipa_bench_run_show, inode->i_private);
+}
+
+static ssize_t sipa_bench_run_write(struct file *file,
+				    const char __user *buf,
+				    size_t len, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct sipa_bench *b = s->private;
+	bool run;
+	int ret;
+
+	ret = kstrtobool_from_user(buf, len, &run);
+	if (ret)
+		return ret;
+
+	mutex_lock(&b->lock);
+	if (run)
+		ret = sipa_bench_start(b);
+	else
+		sipa_bench_stop(b);
+	mutex_unlock(&b->lock);
+
+	return ret ? ret : len;
+}
+
+static const struct file_operations sipa_bench_run_fops = {
+	.open = sipa_bench_run_open,
+	.read = seq_read,
+	.write = sipa_bench_run_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+/* smallest latency in us that @permille of the packets did not exceed */
+static u32 sipa_bench_percentile(struct sipa_bench_result *res, u32 permille)
+{
+	u64 want, sum = 0;
+	u32 i;
+
+	want = div_u64(res->rx_pkts * permille + 999, 1000);
+	for (i = 0; i < SIPA_BENCH_LAT_US; i++) {
+		sum += res->lat[i];
+		if (sum >= want)
+			return i;
+	}
+
+	return SIPA_BENCH_LAT_US;
+}
+
+static void sipa_bench_show_rate(struct seq_file *s, const char *dir,
+				 u64 pkts, u64 bytes, u64 ns, u64 cpu_ns)
+{
+	u64 mbps;
+
+	if (!ns || !pkts) {
+		seq_printf(s, "%s: no packets\n", dir);
+		return;
+	}
+
+	mbps = div64_u64(bytes * 8 * 1000, ns);
+	seq_printf(s, "%s: %llu pkts %llu pps %llu.%03llu Gbps %llu cpu ns/pkt\n",
+		   dir, pkts, div64_u64(pkts * NSEC_PER_SEC, ns),
+		   div_u64(mbps, 1000), mbps % 1000,
+		   div64_u64(cpu_ns, pkts));
+}
+
+static int sipa_bench_result_show(struct seq_file *s, void *unused)
+{
+	struct sipa_bench *b = s->private;
+	struct sipa_bench_result *res;
+	struct sipa_bench_cfg *cfg = &b->run_cfg;
+
+	mutex_lock(&b->lock);
+	res = b->res;
+	if (!res) {
+		seq_puts(s, "no run\n");
+		goto out;
+	}
+	if (b->running && !READ_ONCE(b->rx_done)) {
+		seq_puts(s, "running\n");
+		goto out;
+	}
+
+	seq_printf(s, "pkt_len %u rate_pps %u flows %u batch %u duration_ms %u\n",
+		   cfg->pkt_len, cfg->rate_pps, cfg->flows, cfg->batch,
+		   cfg->duration_ms);
+	sipa_bench_show_rate(s, "tx", res->tx_pkts, res->tx_bytes,
+			     res->tx_ns, res->tx_cpu_ns);
+	sipa_bench_show_rate(s, "rx", res->rx_pkts, res->rx_bytes,
+			     res->rx_ns, res->rx_cpu_ns);
+	seq_printf(s, "tx_fail %llu tx_flowctrl %llu rx_bad %llu rx_reorder %llu rx_gap %llu rx_lost %llu\n",
+		   res->tx_fail, res->tx_flowctrl, res->rx_bad,
+		   res->rx_reorder, res->rx_gap,
+		   res->tx_pkts > res->rx_pkts ?
+		   res->tx_pkts - res->rx_pkts : 0);
+	if (res->rx_pkts)
+		seq_printf(s, "latency us: avg %llu p50 %u p90 %u p99 %u p99.9 %u max %llu over %u\n",
+			   div64_u64(res->lat_sum_ns,
+				     res->rx_pkts * NSEC_PER_USEC),
+			   sipa_bench_percentile(res, 500),
+			   sipa_bench_percentile(res, 900),
+			   sipa_bench_percentile(res, 990),
+			   sipa_bench_percentile(res, 999),
+			   div_u64(res->lat_max_ns, NSEC_PER_USEC),
+			   res->lat_over);
+out:
+	mutex_unlock(&b->lock);
+	return 0;
+}
+
+static int sipa_bench_result_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sipa_bench_result_show, inode->i_private);
+}
+
+static const struct file_operations sipa_bench_result_fops = {
+	.open = sipa_bench_result_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init sipa_bench_init(void)
+{
+	struct sipa_bench *b = &s_bench;
+	struct dentry *root;
+
+	init_waitqueue_head(&b->rx_wq);
+	init_waitqueue_head(&b->fc_wq);
+
+	root = debugfs_create_dir("sipa_bench", NULL);
+	if (!root)
+		return -ENOMEM;
+
+	debugfs_create_u32("pkt_len", 0644, root, &b->cfg.pkt_len);
+	debugfs_create_u32("rate_pps", 0644, root, &b->cfg.rate_pps);
+	debugfs_create_u32("flows", 0644, root, &b->cfg.flows);
+	debugfs_create_u32("batch", 0644, root, &b->cfg.batch);
+	debugfs_create_u32("duration_ms", 0644, root, &b->cfg.duration_ms);
+	debugfs_create_u32("tx_cpu", 0644, root, &b->cfg.tx_cpu);
+	debugfs_create_u32("rx_cpu", 0644, root, &b->cfg.rx_cpu);
+	debugfs_create_file("run", 0644, root, b, &sipa_bench_run_fops);
+	debugfs_create_file("result", 0444, root, b,
+			    &sipa_bench_result_fops);
+
+	return 0;
+}
+
+late_initcall(sipa_bench_init);
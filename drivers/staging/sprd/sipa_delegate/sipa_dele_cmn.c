@@ -28,6 +28,100 @@
 #include <linux/sipa.h>
 #include "sipa_dele_priv.h"
 
+/*
+ * A released prod keeps the peer's cons for linger_ms before the release
+ * msg is sent, a new request within that time needs no msg at all.
+ */
+static u32 linger_ms = 20;
+module_param_named(linger_ms, linger_ms, uint, 0644);
+
+static void sipa_dele_map_peer_state(struct sipa_delegator *delegator,
+				     u32 addr)
+{
+	struct sipa_dele_state_page *st, *old;
+	unsigned long flags;
+
+	st = shmem_ram_vmap_nocache(delegator->dst, addr, sizeof(*st));
+	if (st && st->magic != SIPA_DELE_STATE_MAGIC) {
+		pr_err("bad state page 0x%x from dst %d\n",
+		       addr, delegator->dst);
+		shmem_ram_unmap(delegator->dst, st);
+		st = NULL;
+	}
+
+	spin_lock_irqsave(&delegator->lock, flags);
+	old = delegator->peer_state;
+	delegator->peer_state = st;
+	spin_unlock_irqrestore(&delegator->lock, flags);
+
+	if (old)
+		shmem_ram_unmap(delegator->dst, old);
+}
+
+static void sipa_dele_unmap_peer_state(struct sipa_delegator *delegator)
+{
+	struct sipa_dele_state_page *old;
+	unsigned long flags;
+
+	spin_lock_irqsave(&delegator->lock, flags);
+	old = delegator->peer_state;
+	delegator->peer_state = NULL;
+	spin_unlock_irqrestore(&delegator->lock, flags);
+
+	if (old)
+		shmem_ram_unmap(delegator->dst, old);
+}
+
+/* allocate our state page once and tell the peer where it is */
+static void sipa_dele_send_state_page(struct sipa_delegator *delegator)
+{
+	struct sipa_dele_state_page *st;
+	struct smsg msg;
+	int ret;
+
+	if (!delegator->state_addr) {
+		delegator->state_addr = smem_alloc(delegator->dst,
+						   sizeof(*st));
+		if (!delegator->state_addr) {
+			pr_warn("no state page for dst %d\n", delegator->dst);
+			return;
+		}
+
+		st = shmem_ram_vmap_nocache(delegator->dst,
+					    delegator->state_addr,
+					    sizeof(*st));
+		if (!st) {
+			smem_free(delegator->dst, delegator->state_addr,
+				  sizeof(*st));
+			delegator->state_addr = 0;
+			return;
+		}
+
+		st->granted = 0;
+		st->gen = 0;
+		st->magic = SIPA_DELE_STATE_MAGIC;
+		delegator->state = st;
+	}
+
+	smsg_set(&msg, delegator->chan, SMSG_TYPE_EVENT,
+		 SMSG_FLG_DELE_STATE_PAGE, delegator->state_addr);
+	ret = smsg_send(delegator->dst, &msg, -1);
+	if (ret)
+		pr_err("state page smsg send fail %d\n", ret);
+}
+
+void sipa_dele_publish_grant(struct sipa_delegator *delegator, bool granted)
+{
+	struct sipa_dele_state_page *st = delegator->state;
+
+	if (!st || st->granted == granted)
+		return;
+
+	WRITE_ONCE(st->granted, granted);
+	wmb();
+	st->gen++;
+}
+
 static int conn_thread(void *data)
 {
 	struct smsg mrecv;
@@ -89,7 +183,12 @@ static int conn_thread(void *data)
 			break;
 		case SMSG_TYPE_EVENT:
 			/* handle events */
-			delegator->on_evt(delegator, mrecv.flag, mrecv.value);
+			if (mrecv.flag == SMSG_FLG_DELE_STATE_PAGE)
+				sipa_dele_map_peer_state(delegator,
+							 mrecv.value);
+			else
+				delegator->on_evt(delegator, mrecv.flag,
+						  mrecv.value);
 			break;
 		default:
 			ret = 1;
@@ -175,6 +274,21 @@ void sipa_dele_start_rls_work(struct sipa_delegator *delegator)
 		queue_work(delegator->smsg_wq, (struct work_struct *)work);
 }
 
+static void sipa_dele_linger_handler(struct work_struct *work)
+{
+	struct sipa_delegator *delegator =
+		container_of(to_delayed_work(work), struct sipa_delegator,
+			     linger_work);
+	unsigned long flags;
+
+	spin_lock_irqsave(&delegator->lock, flags);
+	if (delegator->stat == SIPA_DELE_LINGER) {
+		delegator->stat = SIPA_DELE_RELEASED;
+		sipa_dele_start_rls_work(delegator);
+	}
+	spin_unlock_irqrestore(&delegator->lock, flags);
+}
+
 void sipa_dele_start_done_work(struct sipa_delegator *delegator,
 			       u16 flag,
 			       u32 val)
@@ -202,6 +316,7 @@ void sipa_dele_r_user_req_cons(struct sipa_delegator *delegator)
 	switch (ret) {
 	case 0:
 		delegator->cons_ref_cnt++;
+		sipa_dele_publish_grant(delegator, true);
 		if (atomic_cmpxchg(&delegator->requesting_cons, 1, 0))
 			sipa_dele_start_done_work(delegator,
 						  SMSG_FLG_DELE_REQUEST,
@@ -225,6 +340,8 @@ void sipa_dele_r_user_rls_cons(struct sipa_delegator *delegator)
 		return;
 
 	delegator->cons_ref_cnt--;
+	if (!delegator->cons_ref_cnt)
+		sipa_dele_publish_grant(delegator, false);
 	sipa_rm_release_resource(delegator->cons_user);
 }
 
@@ -238,6 +355,8 @@ void sipa_dele_on_open(void *priv, u16 flag, u32 data)
 	if (delegator->stat == SIPA_DELE_REQUESTING)
 		sipa_dele_start_req_work(delegator);
 	spin_unlock_irqrestore(&delegator->lock, flags);
+
+	sipa_dele_send_state_page(delegator);
 }
 
 void sipa_dele_on_close(void *priv, u16 flag, u32 data)
@@ -249,6 +368,8 @@ void sipa_dele_on_close(void *priv, u16 flag, u32 data)
 	spin_lock_irqsave(&delegator->lock, flags);
 	delegator->stat = SIPA_DELE_RELEASED;
 	spin_unlock_irqrestore(&delegator->lock, flags);
+
+	sipa_dele_unmap_peer_state(delegator);
 }
 
 void sipa_dele_on_commad(void *priv, u16 flag, u32 data)
@@ -322,8 +443,18 @@ int sipa_dele_local_rls_r_prod(void *user_data)
 	spin_lock_irqsave(&delegator->lock, flags);
 	switch (delegator->stat) {
 	case SIPA_DELE_ACTIVE:
-		delegator->stat = SIPA_DELE_RELEASED;
-		sipa_dele_start_rls_work(delegator);
+		if (linger_ms) {
+			delegator->stat = SIPA_DELE_LINGER;
+			queue_delayed_work(delegator->smsg_wq,
+					   &delegator->linger_work,
+					   msecs_to_jiffies(linger_ms));
+		} else {
+			delegator->stat = SIPA_DELE_RELEASED;
+			sipa_dele_start_rls_work(delegator);
+		}
+		ret = 0;
+		break;
+	case SIPA_DELE_LINGER:
 		ret = 0;
 		break;
 	case SIPA_DELE_REQUESTING:
@@ -373,6 +504,22 @@ int sipa_dele_local_req_r_prod(void *user_data)
 			sipa_dele_start_req_work(delegator);
 		ret = -EINPROGRESS;
 		break;
+	case SIPA_DELE_LINGER:
+		/*
+		 * The peer still holds our cons unless its state page says
+		 * it dropped it, e.g. across a restart, then ask again.
+		 */
+		if (!delegator->peer_state ||
+		    READ_ONCE(delegator->peer_state->granted)) {
+			delegator->stat = SIPA_DELE_ACTIVE;
+			ret = 0;
+			break;
+		}
+		delegator->stat = SIPA_DELE_REQUESTING;
+		if (delegator->connected)
+			sipa_dele_start_req_work(delegator);
+		ret = -EINPROGRESS;
+		break;
 	case SIPA_DELE_POWER_OFF:
 		queue_work(delegator->smsg_wq, &delegator->notify_work);
 		ret = -EINPROGRESS;
@@ -395,6 +542,7 @@ void sipa_dele_cons_notify_cb(void *user_data,
 	pr_debug("prod_id:%d\n", delegator->prod_id);
 	if (event != SIPA_RM_EVT_GRANTED)
 		return;
+	sipa_dele_publish_grant(delegator, true);
 	if (atomic_cmpxchg(&delegator->requesting_cons, 1, 0))
 		sipa_dele_start_done_work(delegator,
 					  SMSG_FLG_DELE_REQUEST,
@@ -425,6 +573,7 @@ int sipa_delegator_init(struct sipa_delegator *delegator,
 	delegator->local_request_prod = sipa_dele_local_req_r_prod;
 	delegator->local_release_prod = sipa_dele_local_rls_r_prod;
 	INIT_WORK(&delegator->notify_work, sipa_dele_notify_handler);
+	INIT_DELAYED_WORK(&delegator->linger_work, sipa_dele_linger_handler);
 	spin_lock_init(&delegator->lock);
 
 	delegator->smsg_wq = create_singlethread_workqueue("dele_smsg_wq");
@@ -450,6 +599,7 @@ int sipa_delegator_init(struct sipa_delegator *delegator,
 void sipa_delegator_exit(struct sipa_delegator *delegator)
 {
 	if (delegator) {
+		cancel_delayed_work_sync(&delegator->linger_work);
 		destroy_workqueue(delegator->smsg_wq);
 		kthread_stop(delegator->thread);
 	}
@@ -125,6 +125,7 @@ static void miniap_dele_power_off(void)
 	dele->is_powered = false;
 	dele->cons_ref_cnt = 0;
 	dele->stat = SIPA_DELE_POWER_OFF;
+	sipa_dele_publish_grant(dele, false);
 
 	sipa_prepare_modem_power_off();
 	sipa_rm_release_resource(dele->cons_user);
@@ -25,6 +25,7 @@
 #define SMSG_FLG_DELE_ADDR_UL_RX	0x6
 #define SMSG_FLG_DELE_ENABLE		0x7
 #define SMSG_FLG_DELE_DISABLE		0x8
+#define SMSG_FLG_DELE_STATE_PAGE	0x9
 
 #define SMSG_VAL_DELE_REQ_SUCCESS	0x0
 #define SMSG_VAL_DELE_REQ_FAIL		0x1
@@ -43,7 +44,22 @@ enum sipa_dele_state {
 	SIPA_DELE_REQUESTING,
 	SIPA_DELE_RELEASING,
 	SIPA_DELE_RELEASED,
-	SIPA_DELE_POWER_OFF
+	SIPA_DELE_POWER_OFF,
+	/* released locally, the release msg waits for the linger time */
+	SIPA_DELE_LINGER
+};
+
+#define SIPA_DELE_STATE_MAGIC		0x53544150
+
+/*
+ * Shared with the peer, every side publishes whether it holds the cons
+ * resource the peer requested. Written by its owner only.
+ */
+struct sipa_dele_state_page {
+	u32 magic;
+	u32 granted;
+	/* bumped on every change of granted */
+	u32 gen;
 };
 
 struct sipa_delegator;
@@ -70,6 +86,10 @@ struct sipa_delegator {
 	bool is_powered;
 	atomic_t requesting_cons;
 	spinlock_t lock;
+	struct delayed_work linger_work;
+	u32 state_addr;
+	struct sipa_dele_state_page *state;
+	struct sipa_dele_state_page *peer_state;
 	struct task_struct *thread;
 	struct work_struct notify_work;
 	struct workqueue_struct *smsg_wq;
@@ -146,5 +166,6 @@ int sipa_dele_local_rls_r_prod(void *user_data);
 void sipa_dele_start_done_work(struct sipa_delegator *delegator,
 			       u16 flag, u32 val);
 void sipa_dele_start_req_work(struct sipa_delegator *delegator);
+void sipa_dele_publish_grant(struct sipa_delegator *delegator, bool granted);
 
 #endif /* !_SIPA_DELE_PRIV_H_ */
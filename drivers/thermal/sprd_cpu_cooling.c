@@ -994,6 +994,10 @@ static int cpufreq_set_cur_state(struct thermal_cooling_device *cdev,
 	cpufreq_device->cpufreq_state = state;
 	cpufreq_device->clipped_freq = clip_freq;
 
+	/* released, the next throttling starts from its own budget */
+	if (!state)
+		cpufreq_device->granted_power = 0;
+
 	cpufreq_update_policy(cpu);
 
 	pr_info("cpu%u update max_freq to %u\n", cpu, clip_freq);
@@ -1164,6 +1168,31 @@ static int cpufreq_state2power(struct thermal_cooling_device *cdev,
  * cpufreq have changed since the initialization of the cpu cooling
  * device.
  */
+/*
+ * A budget that drops is applied at once. One that grows only closes a
+ * quarter of the gap per poll while the zone is not heating up, so a
+ * short dip in temperature no longer releases the cap in one step, only
+ * to hit the trip again a few polls later.
+ */
+#define COOLING_POWER_RISE_SHIFT	2
+
+static u32 cpufreq_smooth_power(struct cpufreq_cooling_device *cpufreq_device,
+				struct thermal_zone_device *tz, u32 power)
+{
+	u32 granted = cpufreq_device->granted_power;
+
+	if (!granted || power <= granted ||
+	    tz->temperature > tz->last_temperature)
+		granted = power;
+	else
+		granted += DIV_ROUND_UP(power - granted,
+					1 << COOLING_POWER_RISE_SHIFT);
+
+	cpufreq_device->granted_power = granted;
+
+	return granted;
+}
+
 static int cpufreq_power2state(struct thermal_cooling_device *cdev,
 			       struct thermal_zone_device *tz, u32 power,
 			       unsigned long *state)
@@ -1178,6 +1207,8 @@ static int cpufreq_power2state(struct thermal_cooling_device *cdev,
 	static int count;
 	s32 dyn_power;
 
+	power = cpufreq_smooth_power(cpufreq_device, tz, power);
+
 	get_online_cpus();
 	cpu = cpumask_any(&cpufreq_device->allowed_cpus);
 	last_load = cpufreq_device->last_load ?: 100;
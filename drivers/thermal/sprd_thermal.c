@@ -3,6 +3,7 @@
 
 #include <linux/clk.h>
 #include <linux/delay.h>
+#include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/iopoll.h>
 #include <linux/module.h>
@@ -12,6 +13,8 @@
 #include <linux/thermal.h>
 #include <linux/slab.h>
 
+#include "sprd_thm_comm.h"
+
 #define SPRD_THM_CTL			0x0
 #define SPRD_THM_INT_EN			0x4
 #define SPRD_THM_INT_STS		0x8
@@ -106,6 +109,7 @@
 
 struct sprd_thermal_sensor {
 	struct thermal_zone_device *thmzone_dev;
+	struct sprd_thermal_data *thm;
 	struct device *dev;
 	struct list_head node;
 	void __iomem *base;
@@ -126,6 +130,7 @@ struct sprd_thermal_sensor {
 	int cal_offset;
 	int lasttemp;
 	int phy_sen;
+	int base_polling;
 	int id;
 };
 
@@ -133,6 +138,11 @@ struct sprd_thermal_data {
 	struct clk *clk;
 	struct list_head senlist;
 	void __iomem *regbase;
+	/* INT_EN and the hot thresholds, once set_trips owns them */
+	struct mutex lock;
+	int irq;
+	u32 slow_polling;
+	u32 slow_margin;
 	u32 ratio_off;
 	u32 ratio_sign;
 	const struct sprd_thm_variant_data *var_data;
@@ -267,6 +277,8 @@ static int sprd_thm_temp_read(void *devdata, int *temp)
 		*temp = sen->lasttemp;
 	}
 
+	sprd_thm_adapt_polling(sen->thmzone_dev, *temp, &sen->base_polling,
+			       sen->thm->slow_polling, sen->thm->slow_margin);
 	return 0;
 }
 
@@ -414,10 +426,82 @@ static int sprd_thm_set_ready(struct sprd_thermal_data *thm)
 	return 0;
 }
 
+/*
+ * Move the overheat alarm of the sensor to the next trip above the
+ * current temperature. The hardware only has an upper threshold, the
+ * way back down is still seen by polling.
+ */
+static int sprd_thm_set_trips(void *devdata, int low, int high)
+{
+	struct sprd_thermal_sensor *sen = devdata;
+	struct sprd_thermal_data *thm = sen->thm;
+	u32 hot;
+	int ret = 0;
+
+	mutex_lock(&thm->lock);
+	if (high == INT_MAX) {
+		sprd_thm_update_bits(thm->regbase + SPRD_THM_INT_EN,
+				     sen->overheat_alarm_en, 0);
+		goto out;
+	}
+
+	hot = sprd_temp_to_rawdata_v1(high, sen);
+	sprd_thm_update_bits(thm->regbase + sen->overheat_hot_thres,
+			     SPRD_OVERHEAT_HOT_THRES_MASK,
+			     ((sen->otp_rawdata << SPRD_THM_OTP_TRIP_SHIFT) |
+			      hot));
+	/* before probe finishes sprd_thm_set_ready() latches it */
+	if (sen->ready) {
+		ret = sprd_thm_poll_ready_status(thm);
+		if (ret)
+			goto out;
+	}
+	sprd_thm_update_bits(thm->regbase + SPRD_THM_INT_EN,
+			     sen->overheat_alarm_en, sen->overheat_alarm_en);
+out:
+	mutex_unlock(&thm->lock);
+	return ret;
+}
+
+static irqreturn_t sprd_thm_irq_thread(int irq, void *data)
+{
+	struct sprd_thermal_data *thm = data;
+	struct sprd_thermal_sensor *sen;
+	u32 sts;
+
+	sts = readl(thm->regbase + SPRD_THM_INT_STS);
+	if (!sts)
+		return IRQ_NONE;
+	writel(sts, thm->regbase + SPRD_THM_INT_CLR);
+
+	list_for_each_entry(sen, &thm->senlist, node) {
+		if (!(sts & sen->overheat_alarm_en))
+			continue;
+
+		/*
+		 * The alarm keeps firing while the sensor is above the
+		 * threshold, set_trips arms it again for the next trip.
+		 */
+		mutex_lock(&thm->lock);
+		sprd_thm_update_bits(thm->regbase + SPRD_THM_INT_EN,
+				     sen->overheat_alarm_en, 0);
+		mutex_unlock(&thm->lock);
+		thermal_zone_device_update(sen->thmzone_dev,
+					   THERMAL_TRIP_VIOLATED);
+	}
+
+	return IRQ_HANDLED;
+}
+
 static const struct thermal_zone_of_device_ops sprd_thm_ops = {
 	.get_temp = sprd_thm_temp_read,
 };
 
+static const struct thermal_zone_of_device_ops sprd_thm_irq_ops = {
+	.get_temp = sprd_thm_temp_read,
+	.set_trips = sprd_thm_set_trips,
+};
+
 static int sprd_thm_probe(struct platform_device *pdev)
 {
 	struct device_node *np = pdev->dev.of_node;
@@ -458,8 +542,18 @@ static int sprd_thm_probe(struct platform_device *pdev)
 	}
 
 	INIT_LIST_HEAD(&thm->senlist);
+	mutex_init(&thm->lock);
 	sprd_thm_para_config(thm);
 
+	/* without an interrupt the zones are simply polled */
+	thm->irq = platform_get_irq(pdev, 0);
+	if (thm->irq < 0)
+		thm->irq = 0;
+	of_property_read_u32(np, "sprd,slow-polling-delay",
+			     &thm->slow_polling);
+	of_property_read_u32(np, "sprd,slow-polling-margin",
+			     &thm->slow_margin);
+
 	ret = sprd_thm_cal_read(np, "thm_sign_cal", &thm->ratio_sign);
 	if (ret)
 		goto disable_clk;
@@ -486,6 +580,7 @@ static int sprd_thm_probe(struct platform_device *pdev)
 			goto disable_clk;
 
 		sen->ready = false;
+		sen->thm = thm;
 		sen->base = thm->regbase;
 		sen->dev = &pdev->dev;
 
@@ -499,8 +594,10 @@ static int sprd_thm_probe(struct platform_device *pdev)
 		sprd_thm_sen_init(thm, sen);
 
 		sen->thmzone_dev =
-		    devm_thermal_zone_of_sensor_register(sen->dev, sen->id,
-							 sen, &sprd_thm_ops);
+		    devm_thermal_zone_of_sensor_register(sen->dev, sen->id, sen,
+							 thm->irq ?
+							 &sprd_thm_irq_ops :
+							 &sprd_thm_ops);
 		if (IS_ERR_OR_NULL(sen->thmzone_dev)) {
 			dev_err(&pdev->dev, "register thermal zone failed %d\n",
 				sen->id);
@@ -519,6 +616,17 @@ static int sprd_thm_probe(struct platform_device *pdev)
 	list_for_each_entry_safe(pos, temp, &thm->senlist, node)
 		pos->ready = true;
 
+	if (thm->irq) {
+		ret = devm_request_threaded_irq(&pdev->dev, thm->irq, NULL,
+						sprd_thm_irq_thread,
+						IRQF_ONESHOT,
+						"sprd-thermal", thm);
+		if (ret) {
+			dev_warn(&pdev->dev, "request irq failed %d\n", ret);
+			thm->irq = 0;
+		}
+	}
+
 	platform_set_drvdata(pdev, thm);
 	return 0;
 
@@ -569,6 +677,9 @@ static int sprd_thm_suspend(struct platform_device *pdev, pm_message_t state)
 	struct sprd_thermal_sensor *sen, *temp;
 	int ret;
 
+	if (thm->irq)
+		disable_irq(thm->irq);
+
 	list_for_each_entry_safe(sen, temp, &thm->senlist, node)
 		sen->ready = false;
 
@@ -594,6 +705,9 @@ static int sprd_thm_resume(struct platform_device *pdev)
 
 	list_for_each_entry_safe(sen, temp, &thm->senlist, node)
 		sen->ready = true;
+
+	if (thm->irq)
+		enable_irq(thm->irq);
 	return 0;
 
 disable_clk:
@@ -606,6 +720,9 @@ static int sprd_thm_remove(struct platform_device *pdev)
 	struct sprd_thermal_data *thm = platform_get_drvdata(pdev);
 	struct sprd_thermal_sensor *sen, *temp;
 
+	if (thm->irq)
+		disable_irq(thm->irq);
+
 	list_for_each_entry_safe(sen, temp, &thm->senlist, node) {
 		devm_thermal_zone_of_sensor_unregister(&pdev->dev,
 						       sen->thmzone_dev);
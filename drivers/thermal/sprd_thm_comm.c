@@ -12,6 +12,7 @@
  */
 
 #include <linux/err.h>
+#include <linux/of.h>
 #include <linux/thermal.h>
 #include "sprd_thm_comm.h"
 
@@ -23,6 +24,11 @@ static int sprd_sys_temp_read(void *devdata, int *temp)
 	if (!pzone->ops->read_temp)
 		return -1;
 	ret = pzone->ops->read_temp(pzone, temp);
+	if (!ret)
+		sprd_thm_adapt_polling(pzone->therm_dev, *temp,
+				       &pzone->base_polling,
+				       pzone->slow_polling,
+				       pzone->slow_margin);
 	return ret;
 }
 
@@ -55,6 +61,10 @@ int sprd_thermal_init(struct sprd_thermal_zone *pzone)
 {
 	INIT_DELAYED_WORK(&pzone->resume_delay_work,
 			  sprd_thermal_resume_delay_work);
+	of_property_read_u32(pzone->dev->of_node, "sprd,slow-polling-delay",
+			     &pzone->slow_polling);
+	of_property_read_u32(pzone->dev->of_node, "sprd,slow-polling-margin",
+			     &pzone->slow_margin);
 	pzone->therm_dev =
 	    thermal_zone_of_sensor_register(pzone->dev, pzone->id, pzone,
 					    &sprd_of_thermal_ops);
@@ -28,6 +28,10 @@ struct sprd_thermal_zone {
 	struct thm_handle_ops *ops;
 	char name[THM_NAME_LENGTH];
 	int id;
+	/* see sprd_thm_adapt_polling() */
+	int base_polling;
+	u32 slow_polling;
+	u32 slow_margin;
 };
 
 struct thm_handle_ops {
@@ -37,6 +41,36 @@ struct thm_handle_ops {
 	int (*resume)(struct sprd_thermal_zone *);
 };
 
+/*
+ * Poll tz every slow_delay ms while temp stays more than margin below
+ * all of its trips, and at the device tree polling-delay again once it
+ * gets closer. *base keeps the device tree delay, it starts out as 0.
+ * Meant to be called from get_temp, where the zone lock is held.
+ */
+static inline void sprd_thm_adapt_polling(struct thermal_zone_device *tz,
+					  int temp, int *base,
+					  u32 slow_delay, u32 margin)
+{
+	int i, trip, low = INT_MAX;
+
+	if (!tz || !slow_delay)
+		return;
+	if (!*base)
+		*base = tz->polling_delay;
+	/* zones that are not polled stay that way */
+	if (!*base)
+		return;
+
+	for (i = 0; i < tz->trips; i++)
+		if (!tz->ops->get_trip_temp(tz, i, &trip))
+			low = min(low, trip);
+
+	if ((s64)temp < (s64)low - margin)
+		tz->polling_delay = max_t(int, slow_delay, *base);
+	else
+		tz->polling_delay = *base;
+}
+
 int sprd_thermal_init(struct sprd_thermal_zone *pzone);
 void sprd_thermal_remove(struct sprd_thermal_zone *pzone);
 
@@ -24,6 +24,7 @@
 #include <linux/sched.h>
 #include <linux/compat.h>
 #include <linux/uio.h>
+#include <linux/mm.h>
 #include <linux/version.h>
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 14, 0)
 #include <linux/sched/signal.h>
@@ -52,6 +53,8 @@
 
 #define TIPC_IOC_MAGIC			'r'
 #define TIPC_IOC_CONNECT		_IOW(TIPC_IOC_MAGIC, 0x80, char *)
+#define TIPC_IOC_SEND_MSGS		_IOW(TIPC_IOC_MAGIC, 0x81, \
+					     struct tipc_send_msgs)
 #if defined(CONFIG_COMPAT)
 #define TIPC_IOC_CONNECT_COMPAT		_IOW(TIPC_IOC_MAGIC, 0x80, \
 					     compat_uptr_t)
@@ -60,6 +63,35 @@
 /* This marks a data msg received as continuing via the next field. */
 #define TIPC_DATA_MSG_F_NEXT	1
 
+#define TIPC_MAX_SEND_MSGS		16
+
+/*
+ * TIPC_IOC_SEND_MSGS: cnt messages, each one the len bytes at base,
+ * queued to the channel with a single kick of the secure side. The
+ * layout is the same for 32 bit callers.
+ */
+struct tipc_msg_vec {
+	__u64 base;
+	__u64 len;
+};
+
+struct tipc_send_msgs {
+	__u64 msgs;
+	__u32 cnt;
+	__u32 reserved;
+};
+
+/*
+ * Writes of at least this many bytes keep the first tx buffer for the
+ * header and the head of the data and hand the rest of the user pages
+ * to the secure side in place, one vring descriptor per page. 0 copies
+ * everything, the secure side must take continuation descriptors that
+ * are shorter than msg_buf_max_size before this can be enabled.
+ */
+static unsigned int zero_copy_min;
+module_param(zero_copy_min, uint, 0644);
+MODULE_PARM_DESC(zero_copy_min, "send writes of at least this size from the user pages, 0 disables");
+
 
 struct tipc_virtio_dev;
 
@@ -130,6 +162,7 @@ struct tipc_virtio_dev {
 	uint msg_buf_max_cnt;
 	size_t msg_buf_max_sz;
 	uint free_msg_buf_cnt;
+	uint pinned_cnt;
 	struct list_head free_buf_list;
 	wait_queue_head_t sendq;
 	struct idr addr_idr;
@@ -263,9 +296,22 @@ static void vds_free_msg_buf(struct tipc_virtio_dev *vds,
 	_free_msg_buf(mb);
 }
 
+/* tx descriptors held by senders or queued, never more than the ring */
+static inline uint _txbuf_in_use(struct tipc_virtio_dev *vds)
+{
+	return vds->msg_buf_cnt - vds->free_msg_buf_cnt + vds->pinned_cnt;
+}
+
 static bool _put_txbuf_locked(struct tipc_virtio_dev *vds,
 			      struct tipc_msg_buf *mb)
 {
+	if (mb->page) {
+		put_page(mb->page);
+		kfree(mb);
+		vds->pinned_cnt--;
+		return true;
+	}
+
 	list_add_tail(&mb->node, &vds->free_buf_list);
 	return vds->free_msg_buf_cnt++ == 0;
 }
@@ -277,6 +323,9 @@ static struct tipc_msg_buf *_get_txbuf_locked(struct tipc_virtio_dev *vds)
 	if (vds->state != VDS_ONLINE)
 		return  ERR_PTR(-ENODEV);
 
+	if (_txbuf_in_use(vds) >= vds->msg_buf_max_cnt)
+		return ERR_PTR(-EAGAIN);
+
 	if (vds->free_msg_buf_cnt) {
 		/* take it out of free list */
 		mb = list_first_entry(&vds->free_buf_list,
@@ -366,20 +415,99 @@ static struct tipc_msg_buf *vds_get_txbuf(struct tipc_virtio_dev *vds,
 	return mb;
 }
 
-static int vds_queue_txbuf(struct tipc_virtio_dev *vds,
-			   struct list_head *msg_buf_list)
+/*
+ * Pin the user page at the start of iter and wrap up to len bytes of it
+ * as a tx buffer. It takes a tx descriptor like a copied buffer does and
+ * goes back through _put_txbuf_locked, which drops the page.
+ */
+static struct tipc_msg_buf *vds_pin_txbuf(struct tipc_virtio_dev *vds,
+					  struct iov_iter *iter, size_t len)
+{
+	int err = 0;
+	ssize_t n;
+	size_t off;
+	struct page *page;
+	struct tipc_msg_buf *mb;
+
+	mb = kzalloc(sizeof(*mb), GFP_KERNEL);
+	if (!mb)
+		return ERR_PTR(-ENOMEM);
+
+	mutex_lock(&vds->lock);
+	if (vds->state != VDS_ONLINE)
+		err = -ENODEV;
+	else if (_txbuf_in_use(vds) >= vds->msg_buf_max_cnt)
+		err = -EAGAIN;
+	else
+		vds->pinned_cnt++;
+	mutex_unlock(&vds->lock);
+	if (err)
+		goto err_free;
+
+	n = iov_iter_get_pages(iter, &page, len, 1, &off);
+	if (n <= 0) {
+		err = n ? n : -EFAULT;
+		mutex_lock(&vds->lock);
+		vds->pinned_cnt--;
+		mutex_unlock(&vds->lock);
+		goto err_free;
+	}
+	iov_iter_advance(iter, n);
+
+	mb->page = page;
+	mb->page_off = off;
+	mb->buf_sz = n;
+	mb->wpos = n;
+	return mb;
+
+err_free:
+	kfree(mb);
+	return ERR_PTR(err);
+}
+
+static int _add_txbuf_locked(struct tipc_virtio_dev *vds,
+			     struct list_head *msg_buf_list,
+			     struct scatterlist *sg)
 {
-	int err;
-	struct scatterlist *sg;
-	bool need_notify = false;
 	struct list_head *pos;
 	struct tipc_msg_buf *mb;
 	int num = 0;
 
-	if (!vds)
+	if (list_empty(msg_buf_list))
 		return -EINVAL;
 
-	if (list_empty(msg_buf_list))
+	sg_init_table(sg, vds->msg_buf_max_cnt);
+	list_for_each(pos, msg_buf_list) {
+		if (WARN_ON(num == vds->msg_buf_max_cnt))
+			return -EMSGSIZE;
+		mb = list_entry(pos, struct tipc_msg_buf, node);
+		if (mb->page)
+			sg_set_page(&sg[num++], mb->page, mb->wpos,
+				    mb->page_off);
+		else
+			sg_set_buf(&sg[num++], mb->buf_va, mb->wpos);
+	}
+	sg_mark_end(&sg[num - 1]);
+	dev_dbg(&vds->vdev->dev, "%s: add %d scatterlist to out vring,data=0x%lx\n",
+		__func__, num, (long)msg_buf_list);
+
+	return virtqueue_add_outbuf(vds->txvq, sg, num,
+				    msg_buf_list, GFP_KERNEL);
+}
+
+/*
+ * Add cnt messages to the tx ring and kick the secure side once for all
+ * of them. Returns how many were added, in order, or an error if none
+ * was; the lists past that are still the caller's.
+ */
+static int vds_queue_txbuf_batch(struct tipc_virtio_dev *vds,
+				 struct list_head **msg_buf_lists, int cnt)
+{
+	int i = 0, err;
+	struct scatterlist *sg;
+	bool need_notify = false;
+
+	if (!vds)
 		return -EINVAL;
 
 	mutex_lock(&vds->lock);
@@ -390,21 +518,13 @@ static int vds_queue_txbuf(struct tipc_virtio_dev *vds,
 			mutex_unlock(&vds->lock);
 			goto err_out;
 		}
-		sg_init_table(sg, vds->msg_buf_max_cnt);
-		list_for_each(pos, msg_buf_list) {
-			mb = list_entry(pos, struct tipc_msg_buf, node);
-			sg_set_buf(&(sg[num++]), mb->buf_va, mb->wpos);
-		}
-		sg_mark_end(&(sg[num-1]));
-		dev_dbg(&vds->vdev->dev, "%s: add %d scatterlist to out vring,data=0x%lx\n",
-			       __func__, num, (long)msg_buf_list);
-		list_for_each(pos, msg_buf_list) {
-		dev_dbg(&vds->vdev->dev, "%s: pos1,pos=0x%lx\n",
-			       __func__, (long)pos);
+		for (i = 0; i < cnt; i++) {
+			err = _add_txbuf_locked(vds, msg_buf_lists[i], sg);
+			if (err)
+				break;
 		}
-		err = virtqueue_add_outbuf(vds->txvq, sg, num,
-				msg_buf_list, GFP_KERNEL);
-		need_notify = virtqueue_kick_prepare(vds->txvq);
+		if (i)
+			need_notify = virtqueue_kick_prepare(vds->txvq);
 		kfree(sg);
 	} else {
 		err = -ENODEV;
@@ -413,11 +533,20 @@ static int vds_queue_txbuf(struct tipc_virtio_dev *vds,
 
 	if (need_notify)
 		virtqueue_notify(vds->txvq);
-	dev_dbg(&vds->vdev->dev, "%s: need_notify=%d\n",
-					   __func__, need_notify);
+	dev_dbg(&vds->vdev->dev, "%s: queued %d/%d need_notify=%d\n",
+		__func__, i, cnt, need_notify);
 
 err_out:
-	return err;
+	return i ? i : err;
+}
+
+static int vds_queue_txbuf(struct tipc_virtio_dev *vds,
+			   struct list_head *msg_buf_list)
+{
+	int ret;
+
+	ret = vds_queue_txbuf_batch(vds, &msg_buf_list, 1);
+	return ret < 0 ? ret : 0;
 }
 
 
@@ -659,6 +788,47 @@ int tipc_chan_queue_msg_list(struct tipc_chan *chan, struct list_head *msg_buf_l
 }
 EXPORT_SYMBOL(tipc_chan_queue_msg_list);
 
+/*
+ * Queue cnt messages, each a list as for tipc_chan_queue_msg_list, with
+ * one notification of the secure side. Returns the number of leading
+ * messages queued, the rest are left to the caller, or an error if none.
+ */
+int tipc_chan_queue_msg_batch(struct tipc_chan *chan,
+			      struct list_head **msg_buf_lists, int cnt)
+{
+	int err, i;
+	struct tipc_msg_buf *mb;
+
+	mutex_lock(&chan->lock);
+	switch (chan->state) {
+	case TIPC_CONNECTED:
+		for (i = 0; i < cnt; i++) {
+			mb = list_first_entry(msg_buf_lists[i],
+					      struct tipc_msg_buf, node);
+			fill_msg_hdr(mb, chan->local, chan->remote);
+		}
+		err = vds_queue_txbuf_batch(chan->vds, msg_buf_lists, cnt);
+		if (err < 0)
+			pr_err("%s: failed to queue tx buffers (%d)\n",
+			       __func__, err);
+		break;
+	case TIPC_DISCONNECTED:
+	case TIPC_CONNECTING:
+		err = -ENOTCONN;
+		break;
+	case TIPC_STALE:
+		err = -ESHUTDOWN;
+		break;
+	default:
+		err = -EBADFD;
+		pr_err("%s: unexpected channel state %d\n",
+		       __func__, chan->state);
+	}
+	mutex_unlock(&chan->lock);
+	return err;
+}
+EXPORT_SYMBOL(tipc_chan_queue_msg_batch);
+
 
 int tipc_chan_connect(struct tipc_chan *chan, const char *name)
 {
@@ -1046,6 +1216,148 @@ static int dn_connect_ioctl(struct tipc_dn_chan *dn, char __user *usr_name)
 	return dn_wait_for_reply(dn, REPLY_TIMEOUT);
 }
 
+static void dn_free_msg_list(struct tipc_dn_chan *dn,
+			     struct list_head *msg_buf_list)
+{
+	struct tipc_msg_buf *txbuf;
+	struct list_head *pos, *pos_next;
+
+	list_for_each_safe(pos, pos_next, msg_buf_list) {
+		txbuf = list_entry(pos, struct tipc_msg_buf, node);
+		list_del(&txbuf->node);
+		tipc_chan_put_txbuf(dn->chan, txbuf);
+	}
+	kfree(msg_buf_list);
+}
+
+/*
+ * Build one message out of iter into msg_buf_list. Only the first tx
+ * buffer waits and carries the header, the message is cut short when
+ * no more buffers are free. Returns the bytes taken from iter.
+ */
+static ssize_t dn_fill_msg(struct tipc_dn_chan *dn, struct iov_iter *iter,
+			   long timeout, struct list_head *msg_buf_list)
+{
+	size_t total_len = iov_iter_count(iter);
+	size_t copyed_len = 0, len_to_copy;
+	struct tipc_msg_buf *txbuf;
+	bool zero_copy;
+
+	zero_copy = zero_copy_min && total_len >= zero_copy_min &&
+		    iter_is_iovec(iter);
+
+	/* an empty message still takes the buffer with the header */
+	do {
+		if (copyed_len != 0)
+			timeout = 0;
+
+		if (copyed_len != 0 && zero_copy) {
+			txbuf = vds_pin_txbuf(dn->chan->vds, iter,
+					      total_len - copyed_len);
+			if (!IS_ERR(txbuf)) {
+				copyed_len += txbuf->wpos;
+				list_add_tail(&txbuf->node, msg_buf_list);
+				continue;
+			}
+			if (PTR_ERR(txbuf) == -EAGAIN)
+				break;
+			/* copy what could not be pinned */
+			zero_copy = false;
+		}
+
+		txbuf = tipc_chan_get_txbuf_timeout(dn->chan, timeout);
+		if (IS_ERR(txbuf)) {
+			if (copyed_len == 0)
+				return -ENOMEM;
+			break;
+		}
+		/*only the first one need msghdr*/
+		if (copyed_len != 0)
+			mb_reset(txbuf);
+
+		len_to_copy = min(total_len - copyed_len,
+				mb_avail_space(txbuf));
+		/* copy in message data */
+		if (copy_from_iter(mb_put_data(txbuf, len_to_copy),
+					len_to_copy, iter) != len_to_copy) {
+			tipc_chan_put_txbuf(dn->chan, txbuf);
+			return -EFAULT;
+		}
+		dev_dbg(&dn->chan->vds->vdev->dev,
+				"%s: txbuf->pa= 0x%lx\n",
+				__func__, (long)txbuf->buf_pa);
+
+		copyed_len += len_to_copy;
+		list_add_tail(&txbuf->node, msg_buf_list);
+	} while (copyed_len < total_len);
+
+	return copyed_len;
+}
+
+/*
+ * Every message must fit whole, the first one that does not ends the
+ * batch. Returns the number of messages queued.
+ */
+static int dn_send_msgs_ioctl(struct tipc_dn_chan *dn, struct file *filp,
+			      void __user *arg)
+{
+	int i, n, ret = 0;
+	ssize_t len;
+	long timeout = TXBUF_TIMEOUT;
+	struct tipc_send_msgs req;
+	struct tipc_msg_vec vec;
+	struct tipc_msg_vec __user *uvec;
+	struct list_head *msg_buf_lists[TIPC_MAX_SEND_MSGS];
+	struct iovec iov;
+	struct iov_iter iter;
+
+	if (copy_from_user(&req, arg, sizeof(req)))
+		return -EFAULT;
+
+	if (!req.cnt || req.cnt > TIPC_MAX_SEND_MSGS)
+		return -EINVAL;
+
+	if (filp->f_flags & O_NONBLOCK)
+		timeout = 0;
+
+	uvec = u64_to_user_ptr(req.msgs);
+	for (i = 0; i < req.cnt; i++) {
+		if (copy_from_user(&vec, &uvec[i], sizeof(vec))) {
+			ret = -EFAULT;
+			break;
+		}
+		ret = import_single_range(WRITE, u64_to_user_ptr(vec.base),
+					  vec.len, &iov, &iter);
+		if (ret)
+			break;
+
+		msg_buf_lists[i] = kzalloc(sizeof(struct list_head),
+					   GFP_KERNEL);
+		if (!msg_buf_lists[i]) {
+			ret = -ENOMEM;
+			break;
+		}
+		INIT_LIST_HEAD(msg_buf_lists[i]);
+
+		len = dn_fill_msg(dn, &iter, i ? 0 : timeout,
+				  msg_buf_lists[i]);
+		if (len < 0 || len != vec.len) {
+			ret = len < 0 ? len : -EAGAIN;
+			dn_free_msg_list(dn, msg_buf_lists[i]);
+			break;
+		}
+	}
+	n = i;
+	if (!n)
+		return ret;
+
+	ret = tipc_chan_queue_msg_batch(dn->chan, msg_buf_lists, n);
+	for (i = ret > 0 ? ret : 0; i < n; i++)
+		dn_free_msg_list(dn, msg_buf_lists[i]);
+
+	return ret;
+}
+
 static long tipc_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 {
 	int ret;
@@ -1058,6 +1370,9 @@ static long tipc_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 	case TIPC_IOC_CONNECT:
 		ret = dn_connect_ioctl(dn, (char __user *)arg);
 		break;
+	case TIPC_IOC_SEND_MSGS:
+		ret = dn_send_msgs_ioctl(dn, filp, (void __user *)arg);
+		break;
 	default:
 		pr_warn("%s: Unhandled ioctl cmd: 0x%x\n",
 			__func__, cmd);
@@ -1081,6 +1396,9 @@ static long tipc_compat_ioctl(struct file *filp,
 	case TIPC_IOC_CONNECT_COMPAT:
 		ret = dn_connect_ioctl(dn, user_req);
 		break;
+	case TIPC_IOC_SEND_MSGS:
+		ret = dn_send_msgs_ioctl(dn, filp, user_req);
+		break;
 	default:
 		pr_warn("%s: Unhandled ioctl cmd: 0x%x\n",
 			__func__, cmd);
@@ -1191,82 +1509,36 @@ out:
 
 static ssize_t tipc_write_iter(struct kiocb *iocb, struct iov_iter *iter)
 {
+	int err;
 	ssize_t ret;
-	size_t total_len;
 	long timeout = TXBUF_TIMEOUT;
-	struct tipc_msg_buf *txbuf = NULL;
 	struct file *filp = iocb->ki_filp;
 	struct tipc_dn_chan *dn = filp->private_data;
-	size_t copyed_len = 0, len_to_copy;
 	struct list_head *msg_buf_list;
-	struct list_head *pos, *pos_next;
 
 	msg_buf_list = kzalloc(sizeof(*msg_buf_list), GFP_KERNEL);
-	if (!msg_buf_list) {
-		ret = -ENOMEM;
-		goto err_out;
-	}
+	if (!msg_buf_list)
+		return -ENOMEM;
 	INIT_LIST_HEAD(msg_buf_list);
 
 	if (filp->f_flags & O_NONBLOCK)
 		timeout = 0;
 
-	/* message length */
-	total_len = iov_iter_count(iter);
-
-	while (copyed_len < total_len) {
-
-		if (copyed_len != 0)
-			timeout = 0;
-
-		txbuf = tipc_chan_get_txbuf_timeout(dn->chan, timeout);
-		if (IS_ERR(txbuf)) {
-			if (copyed_len == 0) {
-				ret = -ENOMEM;
-				goto err_out;
-			} else {
-				break;
-			}
-		}
-		/*only the first one need msghdr*/
-		if (copyed_len != 0)
-			mb_reset(txbuf);
-
-		len_to_copy = min(total_len - copyed_len,
-				mb_avail_space(txbuf));
-		/* copy in message data */
-		if (copy_from_iter(mb_put_data(txbuf, len_to_copy),
-					len_to_copy, iter) != len_to_copy) {
-			ret = -EFAULT;
-			goto err_out;
-		}
-		dev_dbg(&dn->chan->vds->vdev->dev,
-				"%s: txbuf->pa= 0x%lx\n",
-				__func__, (long)txbuf->buf_pa);
-
-		copyed_len += len_to_copy;
-		list_add_tail(&txbuf->node, msg_buf_list);
-	}
+	ret = dn_fill_msg(dn, iter, timeout, msg_buf_list);
+	if (ret < 0)
+		goto err_out;
 
 	/* queue message */
-	ret = tipc_chan_queue_msg_list(dn->chan, msg_buf_list);
-	if (ret)
+	err = tipc_chan_queue_msg_list(dn->chan, msg_buf_list);
+	if (err) {
+		ret = err;
 		goto err_out;
+	}
 
-	return copyed_len;
+	return ret;
 
 err_out:
-	if (msg_buf_list) {
-		list_for_each_safe(pos, pos_next, msg_buf_list) {
-			txbuf = list_entry(pos, struct tipc_msg_buf, node);
-			if (txbuf) {
-				list_del(&txbuf->node);
-				tipc_chan_put_txbuf(dn->chan, txbuf);
-			}
-		}
-		kfree(msg_buf_list);
-	}
-
+	dn_free_msg_list(dn, msg_buf_list);
 	return ret;
 }
 
@@ -21,6 +21,7 @@
 #include <linux/kernel.h>
 #include <linux/kobject.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/of.h>
 #include <linux/gpio/consumer.h>
 #include <linux/of_platform.h>
@@ -74,16 +75,30 @@ struct dwc3_sprd {
 	bool			is_audio_dev;
 	wait_queue_head_t	wait;
 	struct work_struct	work;
+
+	/* serialises the cable work against the delayed stop */
+	struct mutex		hp_lock;
+	/* gadget only soft disconnected, the core is still powered */
+	bool			fast_stopped;
+	struct delayed_work	stop_work;
 };
 
 #define DWC3_SUSPEND_COUNT	100
 #define DWC3_UDC_START_COUNT	1000
 #define DWC3_START_TIMEOUT	200
 #define DWC3_EXTCON_DELAY	1000
+#define DWC3_SUSPEND_POLL_MS	20
 
 static int boot_charging;
 static bool boot_calibration;
 
+/*
+ * How long the core stays powered after a device mode disconnect, so a
+ * quick replug only has to set run/stop again. 0 always powers it off.
+ */
+static unsigned int fast_reconnect_ms = 3000;
+module_param(fast_reconnect_ms, uint, 0644);
+
 static int dwc3_sprd_suspend_child(struct device *dev, void *data);
 static int dwc3_sprd_resume_child(struct device *dev, void *data);
 
@@ -454,6 +469,93 @@ static int dwc3_sprd_stop(struct dwc3_sprd *sdwc, enum usb_dr_mode mode)
 	return 0;
 }
 
+/*
+ * Device mode disconnect that keeps the core and PHY configured: run/stop
+ * is cleared, which halts the controller and lets it suspend the PHY, and
+ * the function drivers are told about the disconnect. The real stop is
+ * deferred by fast_reconnect_ms.
+ */
+static bool dwc3_sprd_fast_stop(struct dwc3_sprd *sdwc, enum usb_dr_mode mode)
+{
+	struct dwc3 *dwc = platform_get_drvdata(sdwc->dwc3);
+	struct usb_gadget_driver *driver;
+	bool charging_only;
+	unsigned long flags;
+
+	if (!fast_reconnect_ms || mode != USB_DR_MODE_PERIPHERAL)
+		return false;
+
+	spin_lock_irqsave(&sdwc->lock, flags);
+	charging_only = sdwc->charging_mode;
+	spin_unlock_irqrestore(&sdwc->lock, flags);
+
+	if (charging_only || pm_runtime_suspended(sdwc->dev))
+		return false;
+
+	usb_gadget_set_state(&dwc->gadget, USB_STATE_NOTATTACHED);
+	if (usb_gadget_disconnect(&dwc->gadget))
+		return false;
+
+	spin_lock_irqsave(&dwc->lock, flags);
+	driver = dwc->gadget_driver;
+	spin_unlock_irqrestore(&dwc->lock, flags);
+	if (driver && driver->disconnect)
+		driver->disconnect(&dwc->gadget);
+
+	sdwc->fast_stopped = true;
+	queue_delayed_work(system_unbound_wq, &sdwc->stop_work,
+			   msecs_to_jiffies(fast_reconnect_ms));
+
+	return true;
+}
+
+/*
+ * Replug within the fast reconnect window: a host on the other end only
+ * needs the pullups back. Anything else, a charger or the host role, goes
+ * through the full stop and start.
+ */
+static bool dwc3_sprd_fast_start(struct dwc3_sprd *sdwc, enum usb_dr_mode mode)
+{
+	struct dwc3 *dwc = platform_get_drvdata(sdwc->dwc3);
+	unsigned long flags;
+
+	if (!sdwc->fast_stopped)
+		return false;
+
+	sdwc->fast_stopped = false;
+	cancel_delayed_work(&sdwc->stop_work);
+
+	if (mode == USB_DR_MODE_PERIPHERAL && !boot_charging &&
+	    dwc3_sprd_is_udc_start(sdwc) && dwc3_sprd_is_connect_host(sdwc)) {
+		usb_gadget_set_state(&dwc->gadget, USB_STATE_ATTACHED);
+		if (!usb_gadget_connect(&dwc->gadget)) {
+			spin_lock_irqsave(&sdwc->lock, flags);
+			sdwc->charging_mode = false;
+			spin_unlock_irqrestore(&sdwc->lock, flags);
+			return true;
+		}
+	}
+
+	dwc3_sprd_stop(sdwc, USB_DR_MODE_PERIPHERAL);
+
+	return false;
+}
+
+static void dwc3_sprd_stop_work(struct work_struct *work)
+{
+	struct dwc3_sprd *sdwc = container_of(to_delayed_work(work),
+					      struct dwc3_sprd, stop_work);
+
+	mutex_lock(&sdwc->hp_lock);
+	if (sdwc->fast_stopped) {
+		sdwc->fast_stopped = false;
+		dwc3_sprd_stop(sdwc, USB_DR_MODE_PERIPHERAL);
+		__pm_relax(&sdwc->wake_lock);
+		dev_info(sdwc->dev, "is powered off\n");
+	}
+	mutex_unlock(&sdwc->hp_lock);
+}
+
 static void dwc3_sprd_hot_plug(struct dwc3_sprd *sdwc)
 {
 	enum usb_dr_mode current_mode;
@@ -478,7 +580,10 @@ static void dwc3_sprd_hot_plug(struct dwc3_sprd *sdwc)
 
 		sdwc->dr_mode = current_mode;
 		spin_unlock_irqrestore(&sdwc->lock, flags);
-		ret = dwc3_sprd_start(sdwc, current_mode);
+		if (dwc3_sprd_fast_start(sdwc, current_mode))
+			ret = 0;
+		else
+			ret = dwc3_sprd_start(sdwc, current_mode);
 
 		spin_lock_irqsave(&sdwc->lock, flags);
 		if (ret)
@@ -510,7 +615,8 @@ static void dwc3_sprd_hot_plug(struct dwc3_sprd *sdwc)
 
 		sdwc->dr_mode = USB_DR_MODE_UNKNOWN;
 		spin_unlock_irqrestore(&sdwc->lock, flags);
-		dwc3_sprd_stop(sdwc, current_mode);
+		if (!dwc3_sprd_fast_stop(sdwc, current_mode))
+			dwc3_sprd_stop(sdwc, current_mode);
 
 		/*
 		 * When OTG power off, then we can enable the VBUS irq to detect
@@ -523,7 +629,8 @@ static void dwc3_sprd_hot_plug(struct dwc3_sprd *sdwc)
 		sdwc->charging_mode = false;
 		spin_unlock_irqrestore(&sdwc->lock, flags);
 
-		if (!charging_only)
+		/* held until the delayed stop has powered the core off */
+		if (!charging_only && !sdwc->fast_stopped)
 			__pm_relax(&sdwc->wake_lock);
 
 		dev_info(sdwc->dev, "is shut down\n");
@@ -535,7 +642,9 @@ static void dwc3_sprd_notifier_work(struct work_struct *work)
 {
 	struct dwc3_sprd *sdwc = container_of(work, struct dwc3_sprd, work);
 
+	mutex_lock(&sdwc->hp_lock);
 	dwc3_sprd_hot_plug(sdwc);
+	mutex_unlock(&sdwc->hp_lock);
 }
 
 static int dwc3_sprd_vbus_notifier(struct notifier_block *nb,
@@ -856,6 +965,8 @@ static int dwc3_sprd_probe(struct platform_device *pdev)
 	}
 
 	INIT_WORK(&sdwc->work, dwc3_sprd_notifier_work);
+	INIT_DELAYED_WORK(&sdwc->stop_work, dwc3_sprd_stop_work);
+	mutex_init(&sdwc->hp_lock);
 	init_waitqueue_head(&sdwc->wait);
 	spin_lock_init(&sdwc->lock);
 	sdwc->suspend = false;
@@ -984,6 +1095,7 @@ static int dwc3_sprd_remove(struct platform_device *pdev)
 {
 	struct dwc3_sprd *sdwc = platform_get_drvdata(pdev);
 
+	cancel_delayed_work_sync(&sdwc->stop_work);
 	device_for_each_child(&pdev->dev, NULL, dwc3_sprd_remove_child);
 
 	clk_disable_unprepare(sdwc->core_clk);
@@ -1069,7 +1181,7 @@ static int dwc3_sprd_resume_child(struct device *dev, void *data)
 
 static int dwc3_sprd_suspend_child(struct device *dev, void *data)
 {
-	int ret, cnt = DWC3_SUSPEND_COUNT;
+	int ret, cnt = DWC3_SUSPEND_COUNT * 500 / DWC3_SUSPEND_POLL_MS;
 
 	ret = pm_runtime_put_sync(dev);
 	if (ret) {
@@ -1077,8 +1189,9 @@ static int dwc3_sprd_suspend_child(struct device *dev, void *data)
 		return ret;
 	}
 
+	/* the core autosuspends 500ms later, do not oversleep it */
 	while (!pm_runtime_suspended(dev) && --cnt > 0)
-		msleep(500);
+		msleep(DWC3_SUSPEND_POLL_MS);
 
 	if (cnt <= 0) {
 		dev_err(dev, "[%s]dwc3 child device enters suspend failed!!!\n", __func__);
@@ -29,6 +29,7 @@
 #include <linux/regmap.h>
 #include <linux/mfd/syscon.h>
 #include <linux/delay.h>
+#include <linux/workqueue.h>
 
 #include <linux/usb/phy.h>
 #include <linux/usb/pam.h>
@@ -87,6 +88,11 @@ struct sprd_pamu3 {
 	struct sipa_to_pam_info sipa_info;
 	u8		max_dl_pkts;
 	u8		max_ul_pkts;
+	/* what the fifos run with, max_*_pkts unless adaptive */
+	u8		dl_pkts;
+	u8		ul_pkts;
+	bool		adaptive;
+	struct delayed_work	adapt_work;
 	u8		netid;
 	atomic_t    inited;     /* Pam init flag */
 	atomic_t	ref;
@@ -200,9 +206,9 @@ void pamu3_memory_init(struct sprd_pamu3 *pamu3)
 	dma_addr_t bufaddr;
 
 	/* IPA common FIFOs IRAM addresses */
-	pamu3->sipa_params.send_param.tx_intr_threshold = pamu3->max_dl_pkts;
+	pamu3->sipa_params.send_param.tx_intr_threshold = pamu3->dl_pkts;
 	pamu3->sipa_params.send_param.tx_intr_delay_us = 5;
-	pamu3->sipa_params.recv_param.tx_intr_threshold = pamu3->max_ul_pkts;
+	pamu3->sipa_params.recv_param.tx_intr_threshold = pamu3->ul_pkts;
 	pamu3->sipa_params.recv_param.tx_intr_delay_us = 5;
 	sipa_get_ep_info(SIPA_EP_USB, &pamu3->sipa_info);
 
@@ -400,6 +406,8 @@ static int sprd_pamu3_open(struct sprd_pamu3 *pamu3)
 	/* Packets per transfer */
 	pamu3->max_dl_pkts = PAM_U3_MAX_DLPKTS_DEF;
 	pamu3->max_ul_pkts = PAM_U3_MAX_ULPKTS_DEF;
+	pamu3->dl_pkts = pamu3->max_dl_pkts;
+	pamu3->ul_pkts = pamu3->max_ul_pkts;
 
 	pamu3_memory_init(pamu3);
 	pamu3_load_code(pamu3, (void *)(pamu3->dwc3_dma + REG_DWC3_DEP_BASE(3)),
@@ -410,6 +418,53 @@ static int sprd_pamu3_open(struct sprd_pamu3 *pamu3)
 	return 0;
 }
 
+static void pamu3_set_pkts(struct sprd_pamu3 *pamu3, u8 dl_pkts, u8 ul_pkts)
+{
+	pamu3->dl_pkts = dl_pkts;
+	pamu3->ul_pkts = ul_pkts;
+	pamu3->sipa_params.send_param.tx_intr_threshold = dl_pkts;
+	pamu3->sipa_params.recv_param.tx_intr_threshold = ul_pkts;
+	sipa_pam_set_intr_threshold(SIPA_EP_USB, dl_pkts, ul_pkts);
+}
+
+/*
+ * A backlog above the threshold means the packets come in faster than
+ * the interrupts take them away, so more of them go into one. A fifo
+ * that drains means sparse traffic, which wants its packets right away.
+ */
+static u8 pamu3_adapt_pkts(u8 pkts, u32 backlog, u8 max)
+{
+	if (backlog > pkts && pkts < max)
+		return min_t(u32, pkts * 2, max);
+	if (backlog < pkts / 2 && pkts > PAM_U3_MIN_PKTS)
+		return pkts - 1;
+	return min(pkts, max);
+}
+
+static void pamu3_adapt_work(struct work_struct *work)
+{
+	struct sprd_pamu3 *pamu3 = container_of(to_delayed_work(work),
+						struct sprd_pamu3, adapt_work);
+	u8 dl_pkts, ul_pkts;
+	u32 dl, ul;
+
+	if (!pamu3->adaptive || !atomic_read(&pamu3->inited))
+		return;
+
+	/* nothing to measure while ipa is powered down, try again later */
+	if (!sipa_pam_get_backlog(SIPA_EP_USB, &dl, &ul)) {
+		dl_pkts = pamu3_adapt_pkts(pamu3->dl_pkts, dl,
+					   pamu3->max_dl_pkts);
+		ul_pkts = pamu3_adapt_pkts(pamu3->ul_pkts, ul,
+					   pamu3->max_ul_pkts);
+		if (dl_pkts != pamu3->dl_pkts || ul_pkts != pamu3->ul_pkts)
+			pamu3_set_pkts(pamu3, dl_pkts, ul_pkts);
+	}
+
+	schedule_delayed_work(&pamu3->adapt_work,
+			      msecs_to_jiffies(PAM_U3_ADAPT_PERIOD_MS));
+}
+
 static void pamu3_start(struct sprd_pamu3 *pamu3)
 {
 	u32 value, depth;
@@ -432,6 +487,8 @@ static void pamu3_start(struct sprd_pamu3 *pamu3)
 		pamu3->sipa_params.recv_param.flow_ctrl_cfg = 1;
 		pamu3->sipa_params.send_param.flow_ctrl_irq_mode = 2;
 		sipa_pam_connect(&pamu3->sipa_params);
+		if (pamu3->adaptive)
+			schedule_delayed_work(&pamu3->adapt_work, 0);
 		return;
 	}
 	value = (PAMU3_INTSTS_RXEPINT << PAMU3_SHIFT_INTSTS) |
@@ -486,6 +543,7 @@ static int sprd_pamu3_set_suspend(struct usb_phy *x, int a)
 		return 0;
 	}
 
+	cancel_delayed_work(&pamu3->adapt_work);
 	if (atomic_dec_return(&pamu3->ref)) {
 		sipa_disconnect(SIPA_EP_USB, SIPA_DISCONNECT_START);
 		value = readl_relaxed(pamu3->base + PAM_U3_CTL0);
@@ -542,14 +600,15 @@ static ssize_t max_dl_pkts_store(struct device *dev,
 	if (kstrtou8(buf, 10, &max_dl_pkts) < 0)
 		return -EINVAL;
 
-	if (max_dl_pkts > 10) {
+	if (max_dl_pkts > PAM_U3_MAX_PKTS) {
 		dev_err(dev, "Invalid max_dl_pkts value %d\n", max_dl_pkts);
 		return -EINVAL;
 	}
 	pamu3->max_dl_pkts = max_dl_pkts;
 
-	pamu3->sipa_params.send_param.tx_intr_threshold = pamu3->max_dl_pkts;
-	sipa_pam_connect(&pamu3->sipa_params);
+	/* the controller picks the new ceiling up on its next run */
+	if (!pamu3->adaptive)
+		pamu3_set_pkts(pamu3, pamu3->max_dl_pkts, pamu3->ul_pkts);
 	return size;
 }
 static DEVICE_ATTR_RW(max_dl_pkts);
@@ -584,19 +643,68 @@ static ssize_t max_ul_pkts_store(struct device *dev,
 	if (kstrtou8(buf, 10, &max_ul_pkts) < 0)
 		return -EINVAL;
 
-	if (max_ul_pkts > 10) {
+	if (max_ul_pkts > PAM_U3_MAX_PKTS) {
 		dev_err(dev, "Invalid max_ul_pkts value %d\n", max_ul_pkts);
 		return -EINVAL;
 	}
 	pamu3->max_ul_pkts = max_ul_pkts;
 
+	if (!pamu3->adaptive)
+		pamu3_set_pkts(pamu3, pamu3->dl_pkts, pamu3->max_ul_pkts);
 	return size;
 }
 static DEVICE_ATTR_RW(max_ul_pkts);
 
+static ssize_t adaptive_pkts_show(struct device *dev,
+				  struct device_attribute *attr,
+				  char *buf)
+{
+	struct usb_phy *x = dev_get_drvdata(dev);
+	struct sprd_pamu3 *pamu3;
+
+	if (!x)
+		return -EINVAL;
+
+	pamu3 = container_of(x, struct sprd_pamu3, pam);
+
+	return sprintf(buf, "%d\n", pamu3->adaptive);
+}
+
+static ssize_t adaptive_pkts_store(struct device *dev,
+				   struct device_attribute *attr,
+				   const char *buf, size_t size)
+{
+	struct usb_phy *x = dev_get_drvdata(dev);
+	struct sprd_pamu3 *pamu3;
+	bool adaptive;
+
+	if (!x)
+		return -EINVAL;
+
+	pamu3 = container_of(x, struct sprd_pamu3, pam);
+	if (kstrtobool(buf, &adaptive) < 0)
+		return -EINVAL;
+
+	if (adaptive == pamu3->adaptive)
+		return size;
+
+	pamu3->adaptive = adaptive;
+	if (adaptive) {
+		if (atomic_read(&pamu3->inited))
+			schedule_delayed_work(&pamu3->adapt_work, 0);
+	} else {
+		cancel_delayed_work_sync(&pamu3->adapt_work);
+		pamu3_set_pkts(pamu3, pamu3->max_dl_pkts, pamu3->max_ul_pkts);
+	}
+
+	return size;
+}
+static DEVICE_ATTR_RW(adaptive_pkts);
+
 static struct attribute *usb_pamu3_attrs[] = {
 	&dev_attr_max_dl_pkts.attr,
 	&dev_attr_max_ul_pkts.attr,
+	&dev_attr_adaptive_pkts.attr,
 	&dev_attr_pamu3_netid.attr,
 	NULL
 };
@@ -615,6 +723,7 @@ static int sprd_pamu3_probe(struct platform_device *pdev)
 		return -ENOMEM;
 	pamu3->dev = dev;
 	pamu3_tag = pamu3;
+	INIT_DELAYED_WORK(&pamu3->adapt_work, pamu3_adapt_work);
 
 	res = platform_get_resource_byname(pdev,
 			IORESOURCE_MEM, "pamu3_glb_regs");
@@ -752,6 +861,7 @@ static int sprd_pamu3_remove(struct platform_device *pdev)
 {
 	struct sprd_pamu3 *pamu3 = platform_get_drvdata(pdev);
 
+	cancel_delayed_work_sync(&pamu3->adapt_work);
 	dma_free_coherent(pamu3->dev,
 			sizeof(struct pamu3_dwc3_trb) * PAMU3_TX_TRB_NUM * 2,
 			pamu3->tx_trb_pool, pamu3->tx_trb_pool_dma);
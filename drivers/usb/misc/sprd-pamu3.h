@@ -234,6 +234,11 @@
 /* Packets per transfer default */
 #define PAM_U3_MAX_DLPKTS_DEF			10
 #define PAM_U3_MAX_ULPKTS_DEF			1
+#define PAM_U3_MAX_PKTS				10
+#define PAM_U3_MIN_PKTS				1
+
+/* Period of the packets per transfer controller */
+#define PAM_U3_ADAPT_PERIOD_MS			50
 
 struct pamu3_dwc3_trb {
 	u32		bpl;
@@ -399,6 +399,16 @@ static void musb_prepare_sg_lastnode(struct sprd_musb_dma_channel *musb_channel,
 	 */
 	wmb();
 }
+
+static void musb_reopen_lastnode(struct sprd_musb_dma_channel *musb_channel,
+			u32 index, u8 sp)
+{
+	u32 queue = musb_channel->used_queue;
+
+	musb_channel->dma_linklist[queue][index].ioc = 0;
+	musb_channel->dma_linklist[queue][index].list_end = 0;
+	musb_channel->dma_linklist[queue][index].sp = sp;
+}
 #else
 static struct dma_channel *sprd_dma_channel_allocate(struct dma_controller *c,
 				struct musb_hw_ep *hw_ep, u8 transmit)
@@ -558,6 +568,14 @@ static void musb_prepare_sg_lastnode(struct sprd_musb_dma_channel *musb_channel,
 	 */
 	wmb();
 }
+
+static void musb_reopen_lastnode(struct sprd_musb_dma_channel *musb_channel,
+			u32 index, u8 sp)
+{
+	musb_channel->dma_linklist[index].ioc = 0;
+	musb_channel->dma_linklist[index].list_end = 0;
+	musb_channel->dma_linklist[index].sp = sp;
+}
 #endif
 
 static void musb_prepare_nodes(struct sprd_musb_dma_channel *musb_channel,
@@ -612,10 +630,60 @@ static void musb_prepare_first_nodes(struct sprd_musb_dma_channel *musb_channel,
 	}
 }
 
+/*
+ * Chain the bulk IN requests queued behind prev into the same link list,
+ * so the controller goes on with them without waiting for the list end
+ * interrupt and a reprogram. They are given back together from that
+ * interrupt. OUT requests are not chained, the channel only reports the
+ * residue of the last one.
+ */
+static void musb_chain_listnodes(struct sprd_musb_dma_channel *musb_channel,
+			struct musb_ep *musb_ep, struct musb_request *prev)
+{
+	struct musb_request *musb_req, *n;
+	struct usb_request *request;
+	dma_addr_t dma, end, boundary;
+	u32 len, reqs = 1;
+
+	list_for_each_entry_safe(musb_req, n, &musb_ep->req_list, list) {
+		request = &musb_req->request;
+
+		/* a zero length packet has to end the list */
+		if (prev->request.zero &&
+		    !(prev->request.length % musb_ep->packet_sz))
+			break;
+		if (reqs++ >= LISTNODE_CHAIN_REQS ||
+		    request->num_mapped_sgs || !request->length ||
+		    musb_channel->node_num + request->length / 0xfffc + 2 >
+		    LISTNODE_NUM)
+			break;
+
+		/* a short packet ends prev, the next one starts a new one */
+		musb_reopen_lastnode(musb_channel, musb_channel->node_num - 1,
+			!!(prev->request.length % musb_ep->packet_sz));
+
+		dma = request->dma;
+		end = dma + request->length;
+		while (dma < end) {
+			boundary = (dma | ~ADDR_FLAG) + 1;
+			len = min_t(dma_addr_t, end - dma, 0xfffc);
+			len = min_t(dma_addr_t, len, boundary - dma);
+			musb_prepare_node(musb_channel, dma, len,
+				dma + len == end, 0, musb_channel->node_num);
+			musb_channel->node_num++;
+			dma += len;
+		}
+
+		list_del(&musb_req->list);
+		list_add_tail(&musb_req->list, &musb_channel->req_queued);
+		prev = musb_req;
+	}
+}
+
 static void musb_prepare_listnodes(struct sprd_musb_dma_channel *musb_channel,
 			struct musb_ep *musb_ep, bool starting)
 {
-	struct musb_request *musb_req, *n;
+	struct musb_request *musb_req, *n, *chain = NULL;
 	u8 last_one = 0;
 	dma_addr_t addr, addr_cpr, addr_last;
 	unsigned int length;
@@ -735,6 +803,7 @@ static void musb_prepare_listnodes(struct sprd_musb_dma_channel *musb_channel,
 			musb_channel->busy_slot = 0;
 			musb_channel->free_slot = 0;
 			musb_channel->node_num = 0;
+			chain = musb_req;
 
 			length = musb_req->request.length;
 			dma = musb_req->request.dma;
@@ -850,6 +919,10 @@ static void musb_prepare_listnodes(struct sprd_musb_dma_channel *musb_channel,
 			}
 		}
 	}
+
+	if (chain && musb_channel->transmit &&
+	    usb_endpoint_xfer_bulk(musb_ep->desc))
+		musb_chain_listnodes(musb_channel, musb_ep, chain);
 }
 
 static void musb_host_prepare_nodes(struct sprd_musb_dma_channel *musb_channel,
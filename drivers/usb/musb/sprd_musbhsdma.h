@@ -130,6 +130,8 @@
 
 #define LISTNODE_NUM	2048
 #define LISTNODE_MASK	(LISTNODE_NUM - 1)
+/* bulk IN requests chained into one link list */
+#define LISTNODE_CHAIN_REQS	8
 
 #define MUSB_DMA_CHANNELS	30
 
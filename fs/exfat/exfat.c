@@ -39,6 +39,7 @@
 #include "exfat_super.h"
 #include "exfat.h"
 
+#include <linux/bitops.h>
 #include <linux/blkdev.h>
 
 #define THERE_IS_MBR        0
@@ -1351,7 +1352,12 @@ INT32 ffsMapCluster(struct inode *inode, INT32 clu_offset, UINT32 *clu)
 		num_clusters += num_alloced;
 		*clu = new_clu.dir;
 
-		if (fid->dir.dir != DIR_DELETED) {
+		/*
+		 * Growing a file without changing its first cluster or chain
+		 * type leaves the entry set as it is, no need to read it and
+		 * write it back for every cluster.
+		 */
+		if ((fid->dir.dir != DIR_DELETED) && modified) {
 			if (p_fs->vol_type == EXFAT) {
 				es = get_entry_set_in_dir(sb, &(fid->dir), fid->entry, ES_ALL_ENTRIES, &ep);
 				if (es == NULL)
@@ -1359,22 +1365,20 @@ INT32 ffsMapCluster(struct inode *inode, INT32 clu_offset, UINT32 *clu)
 				ep++;
 			}
 
-			if (modified) {
-				if (p_fs->vol_type != EXFAT) {
-					ep = get_entry_in_dir(sb, &(fid->dir), fid->entry, &sector);
-					if (!ep)
-						return FFS_MEDIAERR;
-				}
+			if (p_fs->vol_type != EXFAT) {
+				ep = get_entry_in_dir(sb, &(fid->dir), fid->entry, &sector);
+				if (!ep)
+					return FFS_MEDIAERR;
+			}
 
-				if (p_fs->fs_func->get_entry_flag(ep) != fid->flags)
-					p_fs->fs_func->set_entry_flag(ep, fid->flags);
+			if (p_fs->fs_func->get_entry_flag(ep) != fid->flags)
+				p_fs->fs_func->set_entry_flag(ep, fid->flags);
 
-				if (p_fs->fs_func->get_entry_clu0(ep) != fid->start_clu)
-					p_fs->fs_func->set_entry_clu0(ep, fid->start_clu);
+			if (p_fs->fs_func->get_entry_clu0(ep) != fid->start_clu)
+				p_fs->fs_func->set_entry_clu0(ep, fid->start_clu);
 
-				if (p_fs->vol_type != EXFAT)
-					buf_modify(sb, sector);
-			}
+			if (p_fs->vol_type != EXFAT)
+				buf_modify(sb, sector);
 
 			if (p_fs->vol_type == EXFAT) {
 				update_dir_checksum_with_entry_set(sb, es);
@@ -2266,38 +2270,37 @@ INT32 clr_alloc_bitmap(struct super_block *sb, UINT32 clu)
 
 UINT32 test_alloc_bitmap(struct super_block *sb, UINT32 clu)
 {
-	INT32 i, map_i, map_b;
-	UINT32 clu_base, clu_free;
-	UINT8 k, clu_mask;
+	INT32 i, map_i;
+	UINT32 bits, base, end, bit, total;
 	FS_INFO_T *p_fs = &(EXFAT_SB(sb)->fs_info);
 	BD_INFO_T *p_bd = &(EXFAT_SB(sb)->bd_info);
 
-	clu_base = (clu & ~(0x7)) + 2;
-	clu_mask = (1 << (clu - clu_base + 2)) - 1;
+	total = p_fs->num_clusters - 2;
+	if (clu >= total)
+		clu = 0;
 
+	bits = p_bd->sector_size << 3;
 	map_i = clu >> (p_bd->sector_size_bits + 3);
-	map_b = (clu >> 3) & p_bd->sector_size_mask;
-
-	for (i = 2; i < p_fs->num_clusters; i += 8) {
-		k = *(((UINT8 *) p_fs->vol_amap[map_i]->b_data) + map_b);
-		if (clu_mask > 0) {
-			k |= clu_mask;
-			clu_mask = 0;
-		}
-		if (k < 0xFF) {
-			clu_free = clu_base + free_bit[k];
-			if (clu_free < p_fs->num_clusters)
-				return(clu_free);
+	bit = clu & (bits - 1);
+
+	/*
+	 * The bitmap has exFAT's little endian bit order, so it is searched
+	 * a word at a time, each sector once and the first one again for
+	 * the clusters before clu.
+	 */
+	for (i = 0; i <= p_fs->map_sectors; i++) {
+		base = (UINT32) map_i * bits;
+		if (base < total) {
+			end = min(bits, total - base);
+			bit = find_next_zero_bit_le(p_fs->vol_amap[map_i]->b_data,
+						    end, bit);
+			if (bit < end)
+				return(base + bit + 2);
 		}
-		clu_base += 8;
 
-		if (((++map_b) >= p_bd->sector_size) || (clu_base >= p_fs->num_clusters)) {
-			if ((++map_i) >= p_fs->map_sectors) {
-				clu_base = 2;
-				map_i = 0;
-			}
-			map_b = 0;
-		}
+		bit = 0;
+		if ((++map_i >= p_fs->map_sectors) || (base + bits >= total))
+			map_i = 0;
 	}
 
 	return(CLUSTER_32(~0));
@@ -32,6 +32,7 @@ extern FS_STRUCT_T      fs_struct[];
 static INT32 __FAT_read(struct super_block *sb, UINT32 loc, UINT32 *content);
 static INT32 __FAT_write(struct super_block *sb, UINT32 loc, UINT32 content);
 
+static void FAT_cache_readahead(struct super_block *sb, UINT32 sec);
 static BUF_CACHE_T *FAT_cache_find(struct super_block *sb, UINT32 sec);
 static BUF_CACHE_T *FAT_cache_get(struct super_block *sb, UINT32 sec);
 static void FAT_cache_insert_hash(struct super_block *sb, BUF_CACHE_T *bp);
@@ -371,6 +372,8 @@ UINT8 *FAT_getblk(struct super_block *sb, UINT32 sec)
 
 	FAT_cache_insert_hash(sb, bp);
 
+	FAT_cache_readahead(sb, sec);
+
 	if (sector_read(sb, sec, &(bp->buf_bh), 1) != FFS_SUCCESS) {
 		FAT_cache_remove_hash(bp);
 		bp->drv = -1;
@@ -439,6 +442,28 @@ void FAT_sync(struct super_block *sb)
 	sm_V(&f_sem);
 }
 
+/*
+ * A chain walk misses the FAT cache one sector after the other, so on a
+ * miss which is not in the page cache either the following FAT sectors
+ * are read in with it.
+ */
+static void FAT_cache_readahead(struct super_block *sb, UINT32 sec)
+{
+	FS_INFO_T *p_fs = &(EXFAT_SB(sb)->fs_info);
+	struct buffer_head *bh;
+	UINT32 ra_count = FCACHE_MAX_RA_SIZE >> sb->s_blocksize_bits;
+	UINT32 fat_end = p_fs->FAT1_start_sector + p_fs->num_FAT_sectors;
+
+	if ((sec < p_fs->FAT1_start_sector) || (sec >= fat_end))
+		return;
+
+	bh = sb_find_get_block(sb, sec);
+	if (!bh || !buffer_uptodate(bh))
+		bdev_reada(sb, sec, min(ra_count, fat_end - sec));
+
+	brelse(bh);
+}
+
 static BUF_CACHE_T *FAT_cache_find(struct super_block *sb, UINT32 sec)
 {
 	INT32 off;
@@ -30,6 +30,7 @@ extern "C" {
 #define DIRTYBIT                0x02
 
 #define DCACHE_MAX_RA_SIZE	(128*1024)
+#define FCACHE_MAX_RA_SIZE	(128*1024)
 
 	typedef struct __BUF_CACHE_T {
 		struct __BUF_CACHE_T *next;
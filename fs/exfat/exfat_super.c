@@ -1860,6 +1860,16 @@ static int exfat_bmap(struct inode *inode, sector_t sector, sector_t *phys,
 	} else if (cluster != CLUSTER_32(~0)) {
 		*phys = START_SECTOR(cluster) + sec_offset;
 		*mapped_blocks = p_fs->sectors_per_clu - sec_offset;
+
+		/*
+		 * A contiguous file has no FAT chain, the rest of what is
+		 * already written follows this cluster on disk, so reads and
+		 * overwrites get it in one mapping and one large bio.
+		 */
+		if ((*create == 0) &&
+		    (EXFAT_I(inode)->fid.flags == 0x03) &&
+		    (last_block - sector > *mapped_blocks))
+			*mapped_blocks = last_block - sector;
 	}
 
 	return 0;
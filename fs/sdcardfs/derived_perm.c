@@ -145,9 +145,37 @@ void get_derived_permission_new(struct dentry *parent, struct dentry *dentry,
 	}
 }
 
+/*
+ * The derived state only depends on the parent's state, the name and the
+ * package list. The name is fixed while the inode sits below the same
+ * parent data, every other change bumps sdcardfs_perm_gen, so a second
+ * derivation, e.g. on each lookup of an inode still in the icache, would
+ * give the same result and is skipped. The child keeps a reference on
+ * the parent data it was derived from, so the pointer is never reused.
+ */
 void get_derived_permission(struct dentry *parent, struct dentry *dentry)
 {
+	struct sdcardfs_inode_info *info = SDCARDFS_I(d_inode(dentry));
+	struct sdcardfs_inode_data *parent_data = SDCARDFS_I(d_inode(parent))->data;
+	struct sdcardfs_inode_data *data = info->data;
+	struct sdcardfs_inode_data *old = NULL;
+	unsigned int gen = atomic_read(&sdcardfs_perm_gen);
+
+	if (READ_ONCE(data->parent) == parent_data && READ_ONCE(data->gen) == gen)
+		return;
+
 	get_derived_permission_new(parent, dentry, &dentry->d_name);
+
+	spin_lock(&info->top_lock);
+	if (data->parent != parent_data) {
+		old = data->parent;
+		data->parent = data_get(parent_data);
+	}
+	WRITE_ONCE(data->gen, gen);
+	spin_unlock(&info->top_lock);
+
+	if (old)
+		data_put(old);
 }
 
 static appid_t get_type(const char *name)
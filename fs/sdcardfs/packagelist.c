@@ -34,6 +34,7 @@
 struct hashtable_entry {
 	struct hlist_node hlist;
 	struct hlist_node dlist; /* for deletion cleanup */
+	struct rcu_head rcu;
 	struct qstr key;
 	atomic_t value;
 };
@@ -45,6 +46,9 @@ static DEFINE_HASHTABLE(ext_to_groupid, 8);
 
 static struct kmem_cache *hashtable_entry_cachep;
 
+/* bumped whenever a change may alter the derived permissions */
+atomic_t sdcardfs_perm_gen = ATOMIC_INIT(0);
+
 static unsigned int full_name_case_hash(const void *salt, const unsigned char *name, unsigned int len)
 {
 	unsigned long hash = init_name_hash(salt);
@@ -295,8 +299,10 @@ static int insert_packagelist_entry(const struct qstr *key, appid_t value)
 
 	mutex_lock(&sdcardfs_super_list_lock);
 	err = insert_packagelist_appid_entry_locked(key, value);
-	if (!err)
+	if (!err) {
+		sdcardfs_perm_gen_bump();
 		fixup_all_perms_name(key);
+	}
 	mutex_unlock(&sdcardfs_super_list_lock);
 
 	return err;
@@ -319,19 +325,30 @@ static int insert_userid_exclude_entry(const struct qstr *key, userid_t value)
 
 	mutex_lock(&sdcardfs_super_list_lock);
 	err = insert_userid_exclude_entry_locked(key, value);
-	if (!err)
+	if (!err) {
+		sdcardfs_perm_gen_bump();
 		fixup_all_perms_name_userid(key, value);
+	}
 	mutex_unlock(&sdcardfs_super_list_lock);
 
 	return err;
 }
 
-static void free_hashtable_entry(struct hashtable_entry *entry)
+static void free_hashtable_entry_rcu(struct rcu_head *head)
 {
+	struct hashtable_entry *entry =
+		container_of(head, struct hashtable_entry, rcu);
+
 	kfree(entry->key.name);
 	kmem_cache_free(hashtable_entry_cachep, entry);
 }
 
+/* lookups walk the tables under rcu only, writers never wait for them */
+static void free_hashtable_entry(struct hashtable_entry *entry)
+{
+	call_rcu(&entry->rcu, free_hashtable_entry_rcu);
+}
+
 static void remove_packagelist_entry_locked(const struct qstr *key)
 {
 	struct hashtable_entry *hash_cur;
@@ -352,7 +369,6 @@ static void remove_packagelist_entry_locked(const struct qstr *key)
 			break;
 		}
 	}
-	synchronize_rcu();
 	hlist_for_each_entry_safe(hash_cur, h_t, &free_list, dlist)
 		free_hashtable_entry(hash_cur);
 }
@@ -361,6 +377,7 @@ static void remove_packagelist_entry(const struct qstr *key)
 {
 	mutex_lock(&sdcardfs_super_list_lock);
 	remove_packagelist_entry_locked(key);
+	sdcardfs_perm_gen_bump();
 	fixup_all_perms_name(key);
 	mutex_unlock(&sdcardfs_super_list_lock);
 }
@@ -373,7 +390,6 @@ static void remove_ext_gid_entry_locked(const struct qstr *key, gid_t group)
 	hash_for_each_possible_rcu(ext_to_groupid, hash_cur, hlist, hash) {
 		if (qstr_case_eq(key, &hash_cur->key) && atomic_read(&hash_cur->value) == group) {
 			hash_del_rcu(&hash_cur->hlist);
-			synchronize_rcu();
 			free_hashtable_entry(hash_cur);
 			break;
 		}
@@ -400,7 +416,6 @@ static void remove_userid_all_entry_locked(userid_t userid)
 			hlist_add_head(&hash_cur->dlist, &free_list);
 		}
 	}
-	synchronize_rcu();
 	hlist_for_each_entry_safe(hash_cur, h_t, &free_list, dlist) {
 		free_hashtable_entry(hash_cur);
 	}
@@ -410,6 +425,7 @@ static void remove_userid_all_entry(userid_t userid)
 {
 	mutex_lock(&sdcardfs_super_list_lock);
 	remove_userid_all_entry_locked(userid);
+	sdcardfs_perm_gen_bump();
 	fixup_all_perms_userid(userid);
 	mutex_unlock(&sdcardfs_super_list_lock);
 }
@@ -423,7 +439,6 @@ static void remove_userid_exclude_entry_locked(const struct qstr *key, userid_t
 		if (qstr_case_eq(key, &hash_cur->key) &&
 				atomic_read(&hash_cur->value) == userid) {
 			hash_del_rcu(&hash_cur->hlist);
-			synchronize_rcu();
 			free_hashtable_entry(hash_cur);
 			break;
 		}
@@ -434,6 +449,7 @@ static void remove_userid_exclude_entry(const struct qstr *key, userid_t userid)
 {
 	mutex_lock(&sdcardfs_super_list_lock);
 	remove_userid_exclude_entry_locked(key, userid);
+	sdcardfs_perm_gen_bump();
 	fixup_all_perms_name_userid(key, userid);
 	mutex_unlock(&sdcardfs_super_list_lock);
 }
@@ -454,7 +470,6 @@ static void packagelist_destroy(void)
 		hash_del_rcu(&hash_cur->hlist);
 		hlist_add_head(&hash_cur->dlist, &free_list);
 	}
-	synchronize_rcu();
 	hlist_for_each_entry_safe(hash_cur, h_t, &free_list, dlist)
 		free_hashtable_entry(hash_cur);
 	mutex_unlock(&sdcardfs_super_list_lock);
@@ -878,5 +893,6 @@ void packagelist_exit(void)
 {
 	configfs_sdcardfs_exit();
 	packagelist_destroy();
+	rcu_barrier();
 	kmem_cache_destroy(hashtable_entry_cachep);
 }
@@ -167,6 +167,10 @@ struct sdcardfs_inode_data {
 	bool under_android;
 	bool under_cache;
 	bool under_obb;
+
+	/* what the state above was derived from, see get_derived_permission() */
+	unsigned int gen;
+	struct sdcardfs_inode_data *parent;
 };
 
 /* sdcardfs inode data in memory */
@@ -493,6 +497,12 @@ extern appid_t is_excluded(const char *app_name, userid_t userid);
 extern int check_caller_access_to_name(struct inode *parent_node, const struct qstr *name);
 extern int packagelist_init(void);
 extern void packagelist_exit(void);
+extern atomic_t sdcardfs_perm_gen;
+
+static inline void sdcardfs_perm_gen_bump(void)
+{
+	atomic_inc(&sdcardfs_perm_gen);
+}
 
 /* for derived_perm.c */
 #define BY_NAME		(1 << 0)
@@ -40,6 +40,8 @@ void data_release(struct kref *ref)
 	struct sdcardfs_inode_data *data =
 		container_of(ref, struct sdcardfs_inode_data, refcount);
 
+	if (data->parent)
+		data_put(data->parent);
 	kmem_cache_free(sdcardfs_inode_data_cachep, data);
 }
 
@@ -0,0 +1,36 @@
+// SPDX-License-Identifier: GPL-2.0
+//
+// Spreadtrum clock scenes
+//
+// Copyright (C) 2017 Spreadtrum, Inc.
+
+#ifndef __LINUX_CLK_SPRD_H_
+#define __LINUX_CLK_SPRD_H_
+
+#include <linux/errno.h>
+
+struct clk;
+
+/**
+ * struct sprd_clk_scene_ent - one clock change of a scene
+ * @clk:	clock to change
+ * @parent:	new parent, NULL keeps the current one
+ * @rate:	new rate, 0 keeps the current one
+ */
+struct sprd_clk_scene_ent {
+	struct clk	*clk;
+	struct clk	*parent;
+	unsigned long	rate;
+};
+
+#if IS_ENABLED(CONFIG_SPRD_COMMON_CLK)
+int sprd_clk_scene_apply(const struct sprd_clk_scene_ent *ents, int num);
+#else
+static inline int sprd_clk_scene_apply(const struct sprd_clk_scene_ent *ents,
+				       int num)
+{
+	return -ENODEV;
+}
+#endif
+
+#endif /* __LINUX_CLK_SPRD_H_ */
@@ -1,6 +1,8 @@
 #ifndef __CPUIDLE_SPRD_H
 #define __CPUIDLE_SPRD_H
 
+#include <linux/ktime.h>
+
 struct sprd_cpuidle_operations {
 	char name[16];
 
@@ -11,5 +13,22 @@ struct sprd_cpuidle_operations {
 	void (*doze_dis)(void);
 };
 
+/* Sources of known periodic wakeups, see sprd_cpuidle_wakeup_hint() */
+enum sprd_idle_hint {
+	SPRD_IDLE_HINT_SIPC,
+	SPRD_IDLE_HINT_AUDIO,
+	SPRD_IDLE_HINT_DISPLAY,
+	NR_SPRD_IDLE_HINT,
+};
+
 int sprd_cpuidle_ops_init(struct sprd_cpuidle_operations *cpuidle_ops);
+
+#ifdef CONFIG_ARM_SPRD_CPUIDLE
+void sprd_cpuidle_wakeup_hint(enum sprd_idle_hint src, ktime_t next);
+#else
+static inline void sprd_cpuidle_wakeup_hint(enum sprd_idle_hint src,
+					    ktime_t next)
+{
+}
+#endif
 #endif
@@ -201,4 +201,28 @@ struct sprd_dma_linklist {
 	phys_addr_t wrap_ptr;
 };
 
+/* bytes of link-list memory one configuration (one sg entry) needs */
+#define SPRD_DMA_LINKLIST_NODE_SIZE	64
+
+struct dma_async_tx_descriptor;
+struct dma_chan;
+struct scatterlist;
+
+#if IS_ENABLED(CONFIG_SPRD_DMA)
+struct dma_async_tx_descriptor *
+sprd_dma_prep_memcpy_sg(struct dma_chan *chan,
+			struct scatterlist *dst_sg, unsigned int dst_nents,
+			struct scatterlist *src_sg, unsigned int src_nents,
+			unsigned long flags);
+#else
+static inline struct dma_async_tx_descriptor *
+sprd_dma_prep_memcpy_sg(struct dma_chan *chan,
+			struct scatterlist *dst_sg, unsigned int dst_nents,
+			struct scatterlist *src_sg, unsigned int src_nents,
+			unsigned long flags)
+{
+	return NULL;
+}
+#endif
+
 #endif
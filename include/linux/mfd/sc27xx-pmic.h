@@ -0,0 +1,30 @@
+/*
+ * Copyright (C) 2019 Spreadtrum Communications Inc.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef __LINUX_MFD_SC27XX_PMIC_H
+#define __LINUX_MFD_SC27XX_PMIC_H
+
+struct device;
+
+#if IS_ENABLED(CONFIG_MFD_SC27XX_PMIC)
+int sprd_pmic_cache_range(struct device *dev, unsigned int min,
+			  unsigned int max);
+#else
+static inline int sprd_pmic_cache_range(struct device *dev, unsigned int min,
+					unsigned int max)
+{
+	return 0;
+}
+#endif
+
+#endif
@@ -724,6 +724,10 @@ struct task_struct {
 	u32 init_load_pct;
 	u64 last_sleep_ts;
 #endif
+#ifdef CONFIG_SCHED_TUNE
+	/* boost group lent by a binder client, 0 if none */
+	int				stune_lent_idx;
+#endif
 
 #ifdef CONFIG_CGROUP_SCHED
 	struct task_group		*sched_task_group;
@@ -1861,6 +1865,26 @@ static inline void set_task_cpu(struct task_struct *p, unsigned int cpu)
 extern long sched_setaffinity(pid_t pid, const struct cpumask *new_mask);
 extern long sched_getaffinity(pid_t pid, struct cpumask *mask);
 
+#ifdef CONFIG_SCHED_TUNE
+extern int schedtune_task_group(struct task_struct *p);
+extern int schedtune_lend_group(struct task_struct *p, int idx);
+extern void schedtune_return_group(struct task_struct *p, int idx);
+#else
+static inline int schedtune_task_group(struct task_struct *p)
+{
+	return 0;
+}
+
+static inline int schedtune_lend_group(struct task_struct *p, int idx)
+{
+	return 0;
+}
+
+static inline void schedtune_return_group(struct task_struct *p, int idx)
+{
+}
+#endif
+
 #ifndef TASK_SIZE_OF
 #define TASK_SIZE_OF(tsk)	TASK_SIZE
 #endif
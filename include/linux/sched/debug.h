@@ -41,6 +41,11 @@ extern void proc_sched_show_task(struct task_struct *p,
 extern void proc_sched_set_task(struct task_struct *p);
 #endif
 
+#ifdef CONFIG_SCHED_WALT
+struct seq_file;
+extern int proc_walt_show_task(struct task_struct *p, struct seq_file *m);
+#endif
+
 /* Attach to any functions which should be ignored in wchan output. */
 #define __sched		__attribute__((__section__(".sched.text")))
 
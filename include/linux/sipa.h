@@ -208,6 +208,9 @@ enum sipa_nic_id
 	SIPA_NIC_MAX
 };
 
+/* max number of per-cpu receive queues one nic can spread flows over */
+#define SIPA_NIC_RX_QUEUE_MAX	4
+
 enum sipa_disconnect_id {
 	SIPA_DISCONNECT_START,
 	SIPA_DISCONNECT_END,
@@ -354,6 +357,19 @@ int sipa_get_ep_info(enum sipa_ep_id id,
 
 int sipa_pam_connect(const struct sipa_connect_params *in);
 
+/*
+ * Retune the interrupt thresholds of a connected PAM endpoint, the values
+ * are kept over an IPA power down.
+ */
+int sipa_pam_set_intr_threshold(enum sipa_ep_id id, u32 send_cnt,
+				u32 recv_cnt);
+
+/*
+ * Packets waiting in the send fifo for the PAM and in the recv fifo for
+ * the IPA. -EAGAIN while the IPA is powered down.
+ */
+int sipa_pam_get_backlog(enum sipa_ep_id id, u32 *send, u32 *recv);
+
 int sipa_sw_connect(const struct sipa_connect_params *in);
 
 int sipa_ext_open_pcie(struct sipa_pcie_open_params *in);
@@ -371,13 +387,35 @@ void sipa_reclaim_wiap_ul_cmn_fifo(void);
 int sipa_nic_open(enum sipa_term_type src, int netid,
         sipa_notify_cb cb, void* priv);
 
+/*
+ * Same as sipa_nic_open(), but the downlink flows of this nic are spread
+ * over rx_queues receive queues by the IPA flow hash. SIPA_RECEIVE is
+ * then notified per queue, with the queue index passed in @data.
+ */
+int sipa_nic_open_mq(enum sipa_term_type src, int netid, u32 rx_queues,
+		     sipa_notify_cb cb, void *priv);
+
 void sipa_nic_close(enum sipa_nic_id nic_id);
 
 int sipa_nic_tx(enum sipa_nic_id nic_id, enum sipa_term_type dst,
         int netid, struct sk_buff *skb);
 
+/*
+ * Send the skbs of @list with one fifo write pointer update, the sent
+ * skbs are dequeued from @list. With @more set the write pointer is left
+ * for a later call or sipa_nic_tx_flush(). Returns the number of skbs
+ * sent or a negative error if none was.
+ */
+int sipa_nic_tx_list(enum sipa_nic_id nic_id, enum sipa_term_type dst,
+		     int netid, struct sk_buff_head *list, bool more);
+
+void sipa_nic_tx_flush(enum sipa_nic_id nic_id);
+
 int sipa_nic_rx(enum sipa_nic_id nic_id, struct sk_buff **out_skb);
 
+int sipa_nic_rx_queue(enum sipa_nic_id nic_id, u32 qid,
+		      struct sk_buff **out_skb);
+
 int sipa_nic_trigger_flow_ctrl_work(enum sipa_nic_id, int err);
 
 int sipa_nic_rx_has_data(enum sipa_nic_id nic_id);
@@ -143,6 +143,9 @@ enum {
 
 	/* RESERVE group 1, channel 190 ~209 */
 	SMSG_CH_RESERVE1_BASE =  190,
+	SMSG_CH_BENCH_SMSG = SMSG_CH_RESERVE1_BASE, /* sipc_bench smsg echo */
+	SMSG_CH_BENCH_SBUF,	/* sipc_bench sbuf echo */
+	SMSG_CH_BENCH_SBLOCK,	/* sipc_bench sblock echo */
 
 	/* RESERVE group 2, channel 210 ~129 */
 	SMSG_CH_RESERVE2_BASE =  210,
@@ -166,21 +169,33 @@ enum {
 };
 #endif
 
+/*
+ * scheduling class of a channel, sipc_v2 serves the sblock and sbuf
+ * channels of one destination with one worker per class
+ */
+enum {
+	SIPC_PRIO_NORMAL = 0,	/* SCHED_RR */
+	SIPC_PRIO_RT,		/* SCHED_FIFO, above SIPC_PRIO_NORMAL */
+	SIPC_PRIO_BULK,		/* SCHED_NORMAL, logs and the like */
+	SIPC_PRIO_NR
+};
+
 /* only be configed in sipc_config is valid channel */
 struct sipc_config {
 	u8 channel;
 	char *name;
+	u8 prio;
 };
 
 static const struct sipc_config sipc_cfg[] = {
-	{SMSG_CH_CTRL, "com control"}, /* chanel 0 */
+	{SMSG_CH_CTRL, "com control", SIPC_PRIO_RT}, /* chanel 0 */
 	{SMSG_CH_COMM, "com communication"}, /* chanel 1 */
-	{SMSG_CH_PM_CTRL, "pm contrl"}, /* chanel 22 */
-	{SMSG_CH_PMSYS_DBG, "pm debug contrl"}, /* chanel 100 */
+	{SMSG_CH_PM_CTRL, "pm contrl", SIPC_PRIO_RT}, /* chanel 22 */
+	{SMSG_CH_PMSYS_DBG, "pm debug contrl", SIPC_PRIO_BULK}, /* chanel 100 */
 	{SMSG_CH_DUAL_SIM_PLUG, "dual sim plug"}, /* chanel 23 */
 	{SMSG_CH_PIPE, "pipe0"}, /* chanel 4 */
-	{SMSG_CH_PLOG, "plog"}, /* chanel 5 */
-	{SMSG_CH_DIAG, "diag"}, /* chanel 21 */
+	{SMSG_CH_PLOG, "plog", SIPC_PRIO_BULK}, /* chanel 5 */
+	{SMSG_CH_DIAG, "diag", SIPC_PRIO_BULK}, /* chanel 21 */
 	{SMSG_CH_TTY, "stty chanel"}, /* chanel 6 */
 	{SMSG_CH_DATA0, "seth0"}, /* chanel 7 */
 	{SMSG_CH_DATA1, "seth1"}, /* chanel 8 */
@@ -196,22 +211,27 @@ static const struct sipc_config sipc_cfg[] = {
 	{SMSG_CH_DATA11, "seth11"}, /* chanel 29 */
 	{SMSG_CH_DATA12, "seth12"}, /* chanel 30 */
 	{SMSG_CH_DATA13, "seth13"}, /* chanel 31 */
-	{SMSG_CH_VBC, "audio control"}, /* chanel 10 */
-	{SMSG_CH_PLAYBACK, "audio playback"}, /* chanel 11 */
-	{SMSG_CH_CAPTURE, "audio capture"}, /* chanel 12 */
-	{SMSG_CH_MONITOR_AUDIO, "audio monitor"}, /* chanel 13 */
-	{SMSG_CH_AGDSP_ACCESS, "agdsp access"}, /* chanel 13 */
-	{SMSG_CH_CTRL_VOIP, "VOIP conrol"}, /* chanel 14 */
-	{SMSG_CH_PLAYBACK_VOIP, "VOIP playback"}, /* chanel 15 */
-	{SMSG_CH_CAPTURE_VOIP, "VOIP capture"}, /* chanel 16 */
-	{SMSG_CH_MONITOR_VOIP, "VOIP monitor"}, /* chanel 17 */
-	{SMSG_CH_PLAYBACK_DEEP, "audio playback deep"},  /*channel 131*/
-	{SMSG_CH_IMSBR_DATA, "imsbr data"}, /* chanel 2 */
-	{SMSG_CH_IMSBR_CTRL, "imsbr control"},  /* channel 3 */
-	{SMSG_CH_VOIP_DEEP, "audio voip deep"},  /*channel 151*/
+	{SMSG_CH_VBC, "audio control", SIPC_PRIO_RT}, /* chanel 10 */
+	{SMSG_CH_PLAYBACK, "audio playback", SIPC_PRIO_RT}, /* chanel 11 */
+	{SMSG_CH_CAPTURE, "audio capture", SIPC_PRIO_RT}, /* chanel 12 */
+	{SMSG_CH_MONITOR_AUDIO, "audio monitor", SIPC_PRIO_RT}, /* chanel 13 */
+	{SMSG_CH_AGDSP_ACCESS, "agdsp access", SIPC_PRIO_RT}, /* chanel 13 */
+	{SMSG_CH_CTRL_VOIP, "VOIP conrol", SIPC_PRIO_RT}, /* chanel 14 */
+	{SMSG_CH_PLAYBACK_VOIP, "VOIP playback", SIPC_PRIO_RT}, /* chanel 15 */
+	{SMSG_CH_CAPTURE_VOIP, "VOIP capture", SIPC_PRIO_RT}, /* chanel 16 */
+	{SMSG_CH_MONITOR_VOIP, "VOIP monitor", SIPC_PRIO_RT}, /* chanel 17 */
+	{SMSG_CH_PLAYBACK_DEEP, "audio playback deep", SIPC_PRIO_RT},  /*channel 131*/
+	{SMSG_CH_IMSBR_DATA, "imsbr data", SIPC_PRIO_RT}, /* chanel 2 */
+	{SMSG_CH_IMSBR_CTRL, "imsbr control", SIPC_PRIO_RT},  /* channel 3 */
+	{SMSG_CH_VOIP_DEEP, "audio voip deep", SIPC_PRIO_RT},  /*channel 151*/
 	{SMSG_CH_DVFS, "dvfs"},  /* channel 41 */
 	{SMSG_CH_COMM_SIPA, "sipa"},  /* channel 120 */
-	{SMSG_CH_NV, "nvsync"}, /* channel 40 */
+	{SMSG_CH_NV, "nvsync", SIPC_PRIO_BULK}, /* channel 40 */
+#ifdef CONFIG_SPRD_SIPC_BENCH
+	{SMSG_CH_BENCH_SMSG, "bench smsg"}, /* channel 190 */
+	{SMSG_CH_BENCH_SBUF, "bench sbuf"}, /* channel 191 */
+	{SMSG_CH_BENCH_SBLOCK, "bench sblock"}, /* channel 192 */
+#endif
 };
 
 #define SMSG_VALID_CH_NR (sizeof(sipc_cfg)/sizeof(struct sipc_config))
@@ -521,6 +541,74 @@ void sbuf_set_no_need_wake_lock(u8 dst, u8 channel, u32 bufnum);
 
 int sbuf_create(u8 dst, u8 channel, u32 bufnum,
 		u32 txbufsize, u32 rxbufsize);
+
+/**
+ * sbuf_create_mmap -- create pipe ring buffers on a channel, each rx
+ * buffer on whole pages of its own so sbuf_rx_mmap can map it
+ *
+ * @dst: dest processor ID
+ * @channel: channel ID
+ * @txbufsize: tx buffer size, multiple of PAGE_SIZE
+ * @rxbufsize: rx buffer size, multiple of PAGE_SIZE
+ * @bufnum: how many buffers to be created
+ * @return: 0 on success, <0 on failure
+ */
+int sbuf_create_mmap(u8 dst, u8 channel, u32 bufnum,
+		     u32 txbufsize, u32 rxbufsize);
+
+struct vm_area_struct;
+
+/**
+ * sbuf_rx_mmap -- map the rx buffer of a ring read only into userspace,
+ * the data is consumed with sbuf_rx_peek and sbuf_rx_consume
+ *
+ * @dst: dest processor ID
+ * @channel: channel ID
+ * @bufid: which buffer to be mapped
+ * @vma: the vma to fill, from offset 0 and at most the rx buffer size
+ * @return: 0 on success, <0 on failure
+ */
+int sbuf_rx_mmap(u8 dst, u8 channel, u32 bufid, struct vm_area_struct *vma);
+
+/**
+ * sbuf_rx_peek -- get the unread data of a mapped rx buffer
+ *
+ * @dst: dest processor ID
+ * @channel: channel ID
+ * @bufid: which buffer to be checked
+ * @offset: return the offset of the unread data in the rx buffer
+ * @len: return the length of the unread data, it may wrap around
+ * @return: 0 on success, <0 on failure
+ */
+int sbuf_rx_peek(u8 dst, u8 channel, u32 bufid, u32 *offset, u32 *len);
+
+/**
+ * sbuf_rx_consume -- give len bytes of a mapped rx buffer back to the peer
+ *
+ * @dst: dest processor ID
+ * @channel: channel ID
+ * @bufid: which buffer the data has been read from
+ * @len: bytes read, at most what sbuf_rx_peek returned
+ * @return: 0 on success, <0 on failure
+ */
+int sbuf_rx_consume(u8 dst, u8 channel, u32 bufid, u32 len);
+
+struct eventfd_ctx;
+
+/**
+ * sbuf_rx_swap_eventfd -- replace the eventfd signalled when the peer
+ * reports new rx data, the one of a ring's fixed reader
+ *
+ * @dst: dest processor ID
+ * @channel: channel ID
+ * @bufid: which buffer to be watched
+ * @old: the eventfd the caller installed before, or NULL
+ * @ctx: the new eventfd, or NULL to install none
+ * @return: 0 on success, the reference to ctx moves to the ring and the
+ *	one to old is dropped; -EBUSY when old is not installed
+ */
+int sbuf_rx_swap_eventfd(u8 dst, u8 channel, u32 bufid,
+			 struct eventfd_ctx *old, struct eventfd_ctx *ctx);
 #else
 /**
  * sbuf_create_ex -- create pipe ring buffers on a channel
@@ -819,6 +907,44 @@ int sblock_receive(u8 dst, u8 channel,
  */
 int sblock_release(u8 dst, u8 channel, struct sblock *blk);
 
+/**
+ * sblock_receive_bulk  -- receive up to n sblocks under one ring lock,
+ * each of them must be released after it's handled. It never waits.
+ *
+ * @dst: dest processor ID
+ * @channel: channel ID
+ * @blks: array of at least n sblocks to fill
+ * @n: max count of sblocks to receive
+ * @return: >=0 the count of received sblocks, <0 on failure
+ */
+int sblock_receive_bulk(u8 dst, u8 channel, struct sblock *blks, int n);
+
+/**
+ * sblock_release_bulk  -- release n sblocks from receiver under one pool
+ * lock, the peer is notified at most once for the whole batch
+ *
+ * @dst: dest processor ID
+ * @channel: channel ID
+ * @blks: array of sblocks returned by sblock_receive(_bulk)
+ * @n: count of sblocks in blks
+ * @return: 0 on success, <0 on failure
+ */
+int sblock_release_bulk(u8 dst, u8 channel, struct sblock *blks, int n);
+
+/**
+ * sblock_rx_data  -- get a cpu friendly pointer to the data of a received
+ * sblock. With CONFIG_SPRD_SIPC_SBLOCK_RX_CACHED it points into a cached
+ * mapping of the rx blocks, invalidated for blk->length, so it can be
+ * read with a plain memcpy. It is blk->addr otherwise. It must only be
+ * read, and only until the sblock is released.
+ *
+ * @dst: dest processor ID
+ * @channel: channel ID
+ * @blk: a sblock returned by sblock_receive
+ * @return: pointer to the sblock data
+ */
+void *sblock_rx_data(u8 dst, u8 channel, struct sblock *blk);
+
 /**
  * sblock_get_arrived_count  -- get the count of sblock(s) arrived at
  * AP (sblock_send on CP) but not received (sblock_receive on AP).
@@ -996,6 +1122,32 @@ int sipx_get_free_count(u8 dst, u8 channel);
  */
 int sipx_put(u8 dst, u8 channel, struct sblock *blk);
 
+#ifdef CONFIG_SPRD_SIPC_V2
+/**
+ * sipx_receive_bulk  -- receive up to n sblocks, ack ones first, with one
+ * ring pointer update per ring. It never waits.
+ *
+ * @dst: dest processor ID
+ * @channel: channel ID
+ * @blks: array of at least n sblocks to fill
+ * @n: max count of sblocks to receive
+ * @return: >=0 the count of received sblocks, <0 on failure
+ */
+int sipx_receive_bulk(u8 dst, u8 channel, struct sblock *blks, int n);
+
+/**
+ * sipx_release_bulk  -- release n sblocks from receiver with one pool
+ * pointer update per pool
+ *
+ * @dst: dest processor ID
+ * @channel: channel ID
+ * @blks: array of sblocks returned by sipx_receive(_bulk)
+ * @n: count of sblocks in blks
+ * @return: 0 on success, <0 on failure
+ */
+int sipx_release_bulk(u8 dst, u8 channel, struct sblock *blks, int n);
+#endif
+
 /* ****************************************************************** */
 
 #ifdef CONFIG_SPRD_SIPC_ZERO_COPY_SIPX
@@ -1030,6 +1182,40 @@ sipx_chan_create(dst, channel)
 #define SBLOCK_RELEASE(dst, channel, blk) \
 	sipx_release(dst, channel, blk)
 
+#ifndef CONFIG_SPRD_SIPC_V2
+/* sipx of sipc v1 has no bulk interface, one block at a time */
+static inline int sipx_receive_bulk(u8 dst, u8 channel,
+				    struct sblock *blks, int n)
+{
+	int cnt = 0;
+
+	while (cnt < n && !sipx_receive(dst, channel, &blks[cnt]))
+		cnt++;
+
+	return cnt;
+}
+
+static inline int sipx_release_bulk(u8 dst, u8 channel,
+				    struct sblock *blks, int n)
+{
+	int i, ret, err = 0;
+
+	for (i = 0; i < n; i++) {
+		ret = sipx_release(dst, channel, &blks[i]);
+		if (ret)
+			err = ret;
+	}
+
+	return err;
+}
+#endif
+
+#define SBLOCK_RECEIVE_BULK(dst, channel, blks, n) \
+	sipx_receive_bulk(dst, channel, blks, n)
+
+#define SBLOCK_RELEASE_BULK(dst, channel, blks, n) \
+	sipx_release_bulk(dst, channel, blks, n)
+
 #define SBLOCK_GET_ARRIVED_COUNT(dst, channel) \
 	sipx_get_arrived_count(dst, channel)
 
@@ -1039,6 +1225,10 @@ sipx_chan_create(dst, channel)
 #define SBLOCK_PUT(dst, channel, blk) \
 	sipx_put(dst, channel, blk)
 
+/* sipx takes care of the cache itself, see CONFIG_SPRD_SIPC_MEM_CACHE_EN */
+#define SBLOCK_RX_DATA(dst, channel, blk) \
+	((blk)->addr)
+
 
 #else /* CONFIG_SPRD_SIPC_ZERO_COPY_SIPX */
 
@@ -1073,6 +1263,12 @@ sblock_create(dst, channel,\
 #define SBLOCK_RELEASE(dst, channel, blk) \
 	sblock_release(dst, channel, blk)
 
+#define SBLOCK_RECEIVE_BULK(dst, channel, blks, n) \
+	sblock_receive_bulk(dst, channel, blks, n)
+
+#define SBLOCK_RELEASE_BULK(dst, channel, blks, n) \
+	sblock_release_bulk(dst, channel, blks, n)
+
 #define SBLOCK_GET_ARRIVED_COUNT(dst, channel) \
 	sblock_get_arrived_count(dst, channel)
 
@@ -1082,9 +1278,43 @@ sblock_create(dst, channel,\
 #define SBLOCK_PUT(dst, channel, blk) \
 	sblock_put(dst, channel, blk)
 
+#define SBLOCK_RX_DATA(dst, channel, blk) \
+	sblock_rx_data(dst, channel, blk)
+
 #endif /* CONFIG_SPRD_SIPC_ZERO_COPY_SIPX */
 
 #ifdef CONFIG_ARM64
+static inline void unalign_memcpy(void *to, const void *from, size_t n)
+{
+	if (((unsigned long)to & 7) == ((unsigned long)from & 7)) {
+		while (((unsigned long)from & 7) && n) {
+			*(char *)(to++) = *(char *)(from++);
+			n--;
+		}
+		memcpy(to, from, n);
+	} else if (((unsigned long)to & 3) == ((unsigned long)from & 3)) {
+		while (((unsigned long)from & 3) && n) {
+			*(char *)(to++) = *(char *)(from++);
+			n--;
+		}
+		while (n >= 4) {
+			*(u32 *)(to) = *(u32 *)(from);
+			to += 4;
+			from += 4;
+			n -= 4;
+		}
+		while (n) {
+			*(char *)(to++) = *(char *)(from++);
+			n--;
+		}
+	} else {
+		while (n) {
+			*(char *)(to++) = *(char *)(from++);
+			n--;
+		}
+	}
+}
+
 /**
  * unalign_copy_from_user  -- unaligned data accesses to addresses
  * marked as device will always trigger an exception, this fuction
@@ -1143,45 +1373,28 @@ static inline unsigned long unalign_copy_from_user(void *to,
 	if (c3)
 		return copy_from_user(to, from, n);
 
+	/*
+	 * Bounce through a buffer at the offset of to, so both sides of
+	 * unalign_memcpy line up and it can take its memcpy path.
+	 */
 	while (n) {
-		if (copy_from_user(to++, from++, 1))
+		u64 bounce[16];
+		unsigned long off = (unsigned long)to & 7;
+		unsigned long len = min_t(unsigned long, n,
+					  sizeof(bounce) - off);
+		unsigned long left;
+
+		left = copy_from_user((char *)bounce + off, from, len);
+		unalign_memcpy(to, (char *)bounce + off, len - left);
+		n -= len - left;
+		if (left)
 			break;
-		n--;
+		to += len;
+		from += len;
 	}
 
 	return n;
 }
-
-static inline void unalign_memcpy(void *to, const void *from, size_t n)
-{
-	if (((unsigned long)to & 7) == ((unsigned long)from & 7)) {
-		while (((unsigned long)from & 7) && n) {
-			*(char *)(to++) = *(char *)(from++);
-			n--;
-		}
-		memcpy(to, from, n);
-	} else if (((unsigned long)to & 3) == ((unsigned long)from & 3)) {
-		while (((unsigned long)from & 3) && n) {
-			*(char *)(to++) = *(char *)(from++);
-			n--;
-		}
-		while (n >= 4) {
-			*(u32 *)(to) = *(u32 *)(from);
-			to += 4;
-			from += 4;
-			n -= 4;
-		}
-		while (n) {
-			*(char *)(to++) = *(char *)(from++);
-			n--;
-		}
-	} else {
-		while (n) {
-			*(char *)(to++) = *(char *)(from++);
-			n--;
-		}
-	}
-}
 #else
 static inline unsigned long unalign_copy_to_user(void __user *to,
 		const void *from,
@@ -1,11 +1,49 @@
 #ifndef __SPRD_SYSFRT_H__
 #define __SPRD_SYSFRT_H__
 
+#include <linux/types.h>
+
 enum {
 	SYSTEM_TIMER,
 	SYSTEM_FRT,
 };
 
+/*
+ * Read only pages of /dev/sprd_systimer, by mmap offset. The data page
+ * holds the latest conversion anchor, the other two are the counter
+ * register pages, when the counter exists.
+ */
+#define SPRD_SYSTIMER_MMAP_DATA		0
+#define SPRD_SYSTIMER_MMAP_SYSTIMER	1
+#define SPRD_SYSTIMER_MMAP_SYSFRT	2
+
+#define SPRD_SYSTIMER_DATA_VERSION	1
+
+/*
+ * seq is odd while the kernel updates the page, read seq, the fields,
+ * then seq again and retry if it is odd or changed. Then
+ *
+ *	boottime + ((((cnt - systimer) & U32_MAX) * systimer_mult)
+ *		    >> systimer_shift)
+ *
+ * converts a systimer count, and likewise without the mask for sysfrt.
+ * A reg offset of U32_MAX means the counter is absent, sysfrt has its
+ * high word 8 bytes above the low one.
+ */
+struct sprd_systimer_data {
+	__u32 seq;
+	__u32 version;
+	__u64 boottime;
+	__u64 systimer;
+	__u64 sysfrt;
+	__u32 systimer_mult;
+	__u32 systimer_shift;
+	__u32 sysfrt_mult;
+	__u32 sysfrt_shift;
+	__u32 systimer_reg;
+	__u32 sysfrt_reg;
+};
+
 #ifdef CONFIG_SPRD_SYSTIMER
 extern u64 sprd_systimer_read(void);
 extern u64 sprd_sysfrt_read(void);
@@ -0,0 +1,32 @@
+#ifndef __SPRD_WAKEPKT_H__
+#define __SPRD_WAKEPKT_H__
+
+#include <linux/atomic.h>
+
+struct sk_buff;
+
+#ifdef CONFIG_SPRD_WAKE_PKT
+extern atomic_t sprd_wakepkt_armed;
+
+void __sprd_wakepkt_rx(const char *tag, int netid,
+		       const struct sk_buff *skb, unsigned int nhoff);
+
+/*
+ * Call on every received packet, nhoff is the offset of the ip header
+ * from skb->data. Only the first packet after a suspend is recorded, all
+ * the others cost one atomic_read.
+ */
+static inline void sprd_wakepkt_rx(const char *tag, int netid,
+				   const struct sk_buff *skb,
+				   unsigned int nhoff)
+{
+	if (unlikely(atomic_read(&sprd_wakepkt_armed)))
+		__sprd_wakepkt_rx(tag, netid, skb, nhoff);
+}
+#else
+static inline void sprd_wakepkt_rx(const char *tag, int netid,
+				   const struct sk_buff *skb,
+				   unsigned int nhoff) { }
+#endif
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef __SPRD_YLOG_H__
+#define __SPRD_YLOG_H__
+
+#include <linux/errno.h>
+#include <linux/types.h>
+
+/*
+ * Binary records from kernel producers, one ring per cpu, readable by the
+ * ylog daemon through the ylog_buffer device at YLOG_KREC_MMAP_OFFSET.
+ * The mapping starts with struct ylog_krec_head, the data of ring n is at
+ * data_offset + n * ring_size.
+ */
+#define YLOG_KREC_MAGIC		0x594b5243	/* "YKRC" */
+#define YLOG_KREC_VERSION	1
+#define YLOG_KREC_MMAP_OFFSET	0x100000
+
+enum {
+	YLOG_SRC_PAD,	/* skip to the start of the ring */
+	YLOG_SRC_SIPC,
+	YLOG_SRC_WCN,
+	YLOG_SRC_AUDIO,
+	YLOG_SRC_MODEM,
+	YLOG_SRC_OTHER,
+};
+
+/*
+ * Records are 8 byte aligned and never wrap, a pad record fills the end
+ * of the ring when the next one does not fit and may be only 8 bytes,
+ * without ts_ns.
+ */
+struct ylog_krec {
+	__u16 len;	/* header and payload, the next one is at ALIGN(len, 8) */
+	__u16 src;	/* YLOG_SRC_* */
+	__u32 type;	/* defined by the producer */
+	__u64 ts_ns;	/* CLOCK_BOOTTIME */
+	__u8 data[0];
+};
+
+/*
+ * head counts the bytes ever written to the ring, it is published after
+ * the record. The writer overwrites the oldest records without waiting:
+ * read head, copy records, read head again and drop whatever starts
+ * below the new head + max_record - ring_size.
+ */
+struct ylog_krec_ring {
+	__u32 head;
+	__u32 dropped;	/* records refused for being too large */
+	__u32 reserved[14];
+};
+
+struct ylog_krec_head {
+	__u32 magic;
+	__u32 version;
+	__u32 nr_rings;
+	__u32 ring_size;
+	__u32 data_offset;
+	__u32 max_record;
+	__u32 reserved[10];
+	struct ylog_krec_ring ring[0];
+};
+
+#ifdef CONFIG_SPRD_YLOG_KREC
+/*
+ * Append a record to the ring of the local cpu, safe from any context
+ * but nmi. Never sleeps nor takes a lock shared with other cpus.
+ */
+int ylog_krec_write(u16 src, u32 type, const void *data, size_t len);
+#else
+static inline int ylog_krec_write(u16 src, u32 type, const void *data,
+				  size_t len)
+{
+	return -ENODEV;
+}
+#endif
+
+#endif
@@ -9,5 +9,15 @@ static unsigned int sprd_cpufreq_update_opp(int cpu, int temp_now)
 	return 0;
 }
 #endif
+
+#ifdef CONFIG_ARM_SPRD_HW_CPUFREQ
+int sprd_hardware_cpufreq_boost_cluster(unsigned int cluster, unsigned int ms);
+#else
+static inline int sprd_hardware_cpufreq_boost_cluster(unsigned int cluster,
+						      unsigned int ms)
+{
+	return 0;
+}
+#endif
 #endif
 
@@ -0,0 +1,30 @@
+/*
+ * Copyright (C) 2018 Spreadtrum Communications Inc.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef __SPRD_CP_DVFS_H
+#define __SPRD_CP_DVFS_H
+
+/*
+ * AP network drivers report the bytes they moved for the modem, from
+ * their rx poll. The CP dvfs driver turns the rate into a higher idle
+ * index of the CP while the traffic lasts. Cheap enough for every poll.
+ */
+#ifdef CONFIG_SPRD_HW_DEVICE_DVFS_CP
+void sprd_cp_dvfs_load_hint(unsigned int bytes);
+#else
+static inline void sprd_cp_dvfs_load_hint(unsigned int bytes)
+{
+}
+#endif
+
+#endif
@@ -83,6 +83,8 @@ struct online_data {
  * @dyn_power_table_entries: number of entries in the @dyn_power_table array
  * @cpu_dev: the first cpu_device from @allowed_cpus that has OPPs registered
  * @plat_get_static_power: callback to calculate the static power
+ * @granted_power: power budget last turned into a state, smoothed on
+ *  the way up
  *
  * This structure is required for keeping information of each registered
  * cpufreq_cooling_device.
@@ -116,6 +118,7 @@ struct cpufreq_cooling_device {
 	unsigned int qos_cur_cpu;
 	struct pm_qos_request max_cpu_request;
 	unsigned int curr_max_freq;
+	u32 granted_power;
 };
 
 #ifdef CONFIG_SPRD_CPU_COOLING
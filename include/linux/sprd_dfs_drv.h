@@ -1,6 +1,8 @@
 #ifndef __SPRD_DFS_DRV_H__
 #define __SPRD_DFS_DRV_H__
 
+#include <linux/ktime.h>
+
 struct scene_freq {
 	char *scene_name;
 	unsigned int scene_freq;
@@ -8,6 +10,22 @@ struct scene_freq {
 	int scene_count;
 };
 
+#define DFS_BW_CHN_MAX		11
+
+/*
+ * devfreq data of the "sprd_bw" governor. Frequencies are in MHz like
+ * the dfs tables, zero bytes_per_cycle or upthreshold take the defaults.
+ */
+struct dfs_bw_data {
+	unsigned int bytes_per_cycle;
+	unsigned int upthreshold;
+	/* frequency floor of a ptm channel while it has traffic */
+	unsigned int floor[DFS_BW_CHN_MAX];
+	unsigned int *freq_table;
+	unsigned int freq_num;
+	ktime_t last;
+};
+
 extern int dfs_enable(void);
 extern int dfs_disable(void);
 extern int dfs_auto_enable(void);
@@ -1,6 +1,8 @@
 #ifndef _SPRD_IOMMU_H
 #define _SPRD_IOMMU_H
 
+#include <linux/hashtable.h>
+#include <linux/rbtree.h>
 #include <linux/scatterlist.h>
 #include <asm/cacheflush.h>
 
@@ -15,6 +17,10 @@ struct sprd_iommu_init_data {
 
 	unsigned long iova_base;            /* io virtual address base */
 	size_t iova_size;            /* io virtual address size */
+	/*
+	 * flat table, one 32 bit entry per 4K iova page. The hal has no
+	 * larger entries, a contiguous buffer still takes size >> 12 of them.
+	 */
 	unsigned long pgt_base;             /* iommu page table base address */
 	size_t pgt_size;             /* iommu page table array size */
 	unsigned long ctrl_reg;             /* iommu control register */
@@ -31,11 +37,8 @@ struct sprd_iommu_init_data {
 };
 
 #define SPRD_MAX_SG_CACHED_CNT 1024
-
-enum sg_pool_status {
-	SG_SLOT_FREE = 0,
-	SG_SLOT_USED,
-};
+#define SPRD_IOMMU_SG_HASH_BITS 7
+#define SPRD_IOMMU_FLUSH_QUEUE_SIZE 32
 
 enum sprd_iommu_chtype {
 	SPRD_IOMMU_PF_CH_READ = 0x100,/*prefetch channel only support read*/
@@ -70,13 +73,45 @@ struct sprd_iommu_sg_rec {
 	void *buf_addr;
 	unsigned long iova_addr;
 	unsigned long iova_size;
-	enum sg_pool_status status;
 	int map_usrs;
+	struct hlist_node buf_node;
+	struct rb_node iova_node;
+	/* parked records, map_usrs dropped to 0 with iova cache on */
+	struct list_head park_node;
+	enum sprd_iommu_chtype ch_type;
+	u32 channel_id;
 };
 
+/*
+ * Mapped buffers, one record per iova. Records are allocated as buffers
+ * get mapped and found by buf through the hash or by iova through the
+ * tree, both under pgt_lock. With iova cache on, a record whose last user
+ * unmapped stays parked with its mapping until the ion buffer is freed or
+ * the iova space runs short, so a buffer mapped again every frame reuses
+ * its iova.
+ */
 struct sprd_iommu_sg_pool {
 	int pool_cnt;
-	struct sprd_iommu_sg_rec slot[SPRD_MAX_SG_CACHED_CNT];
+	DECLARE_HASHTABLE(buf_hash, SPRD_IOMMU_SG_HASH_BITS);
+	struct rb_root iova_root;
+	struct list_head parked;
+};
+
+struct sprd_iommu_flush_entry {
+	unsigned long iova_addr;
+	size_t iova_size;
+	enum sprd_iommu_chtype ch_type;
+	u32 channel_id;
+};
+
+/*
+ * Unmapped ranges waiting for their page table clear and tlb flush, used
+ * with lazy unmap. The iova stays allocated until the queue is drained so
+ * it cannot be handed out again while the iommu may still cache it.
+ */
+struct sprd_iommu_flush_queue {
+	int cnt;
+	struct sprd_iommu_flush_entry entry[SPRD_IOMMU_FLUSH_QUEUE_SIZE];
 };
 
 struct sprd_iommu_dev {
@@ -99,6 +134,9 @@ struct sprd_iommu_dev {
 	struct mutex status_mutex;
 
 	struct sprd_iommu_sg_pool sg_pool;
+	bool lazy_unmap;
+	bool iova_cache;
+	struct sprd_iommu_flush_queue flush_queue;
 	struct device *drv_dev;
 	unsigned long mmupf_iovaarray[SPRD_MAX_SG_CACHED_CNT];
 
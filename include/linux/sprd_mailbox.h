@@ -12,6 +12,7 @@ int mbox_register_irq_handle(u8 target_id,
 			     void *priv_data);
 int mbox_unregister_irq_handle(u8 target_id);
 int mbox_raw_sent(u8 target_id, u64 msg);
+int mbox_raw_sent_batch(u8 core_id, const u64 *msg, int cnt);
 void mbox_just_sent(u8 core_id, u64 msg);
 u32 mbox_core_fifo_full(int core_id);
 #else
@@ -20,6 +21,8 @@ static inline int mbox_register_irq_handle(u8 target_id,
 			     void *priv_data) {return 0; }
 static inline int mbox_unregister_irq_handle(u8 target_id) {return 0; }
 static inline int mbox_raw_sent(u8 target_id, u64 msg) {return 0; }
+static inline int mbox_raw_sent_batch(u8 core_id, const u64 *msg,
+				      int cnt) {return cnt; }
 static inline void mbox_just_sent(u8 core_id, u64 msg) {return; }
 static inline u32 mbox_core_fifo_full(int core_id) {return 0; }
 #endif
@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2018 Spreadtrum Communications Inc.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef __LINUX_SPRD_PTM_H__
+#define __LINUX_SPRD_PTM_H__
+
+#include <linux/errno.h>
+#include <linux/types.h>
+
+#ifdef CONFIG_SPRD_PTM
+int sprd_ptm_bw_sample(u32 *rd, u32 *wr, int nr);
+#else
+static inline int sprd_ptm_bw_sample(u32 *rd, u32 *wr, int nr)
+{
+	return -ENODEV;
+}
+#endif
+
+#endif
@@ -44,9 +44,13 @@ int swcnblk_send(u8 dst, u8 channel, struct swcnblk_blk *blk);
 int swcnblk_send_prepare(u8 dst, u8 channel, struct swcnblk_blk *blk);
 int swcnblk_receive(u8 dst, u8 channel,
 		    struct swcnblk_blk *blk, int timeout);
+int swcnblk_receive_batch(u8 dst, u8 channel,
+			  struct swcnblk_blk *blks, int num);
 int swcnblk_get_arrived_count(u8 dst, u8 channel);
 int swcnblk_get_free_count(u8 dst, u8 channel);
 int swcnblk_release(u8 dst, u8 channel, struct swcnblk_blk *blk);
+int swcnblk_release_batch(u8 dst, u8 channel,
+			  struct swcnblk_blk *blks, int num);
 int swcnblk_query(u8 dst, u8 channel);
 int swcnblk_get_cp_cache_range(u8 dst, u8 channel, u32 *addr, u32 *len);
 #endif
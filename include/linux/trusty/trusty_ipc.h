@@ -23,6 +23,9 @@ struct tipc_msg_buf {
 	size_t wpos;
 	size_t rpos;
 	struct list_head node;
+	/* set for user pages sent in place, buf_va is unused then */
+	struct page *page;
+	unsigned int page_off;
 };
 
 enum tipc_chan_event {
@@ -48,6 +51,9 @@ int tipc_chan_queue_msg(struct tipc_chan *chan, struct tipc_msg_buf *mb);
 
 int tipc_chan_queue_msg_list(struct tipc_chan *chan, struct list_head *msg_buf_list);
 
+int tipc_chan_queue_msg_batch(struct tipc_chan *chan,
+			      struct list_head **msg_buf_lists, int cnt);
+
 int tipc_chan_shutdown(struct tipc_chan *chan);
 
 void tipc_chan_destroy(struct tipc_chan *chan);
@@ -1,6 +1,9 @@
 #ifndef __WCN_BUS_H__
 #define __WCN_BUS_H__
 
+#include <linux/percpu.h>
+#include <linux/spinlock.h>
+
 #define CHN_MAX_NUM 32
 
 #ifdef CONFIG_SDIOHAL
@@ -44,6 +47,35 @@ struct mbuf_t {
 	unsigned int   seq;
 };
 
+/*
+ * mbuf pool shared by the bus back ends. Small lists are served from a
+ * per cpu cache without touching the shared lock, the cache is only
+ * used when the pool is large enough that the mbufs parked on other
+ * cpus cannot starve a channel.
+ */
+struct wcn_mbuf_cache {
+	struct mbuf_t *head;
+	int num;
+};
+
+struct wcn_mbuf_pool {
+	int size;
+	/* mbufs on the shared list */
+	int free;
+	int payload;
+	struct mbuf_t *head;
+	char *mem;
+	spinlock_t lock;
+	struct wcn_mbuf_cache __percpu *cache;
+};
+
+int wcn_mbuf_pool_init(struct wcn_mbuf_pool *pool, int size, int payload);
+void wcn_mbuf_pool_deinit(struct wcn_mbuf_pool *pool);
+int wcn_mbuf_pool_alloc(struct wcn_mbuf_pool *pool, struct mbuf_t **head,
+			struct mbuf_t **tail, int *num);
+int wcn_mbuf_pool_free(struct wcn_mbuf_pool *pool, struct mbuf_t *head,
+		       struct mbuf_t *tail, int num);
+
 struct mchn_ops_t {
 	int channel;
 	/* hardware interface type */
@@ -66,6 +98,8 @@ struct mchn_ops_t {
 	int cb_in_irq;
 	/* pending link num */
 	int max_pending;
+	/* tx side, latency sensitive: never held back for aggregation */
+	int low_latency;
 	/*
 	 * pop link list, (1)chn id, (2)mbuf link head
 	 * (3) mbuf link tail (4)number of node
@@ -129,6 +163,12 @@ struct sprdwcn_bus_ops {
 			 struct mbuf_t *tail, int num);
 	int (*push_list_direct)(int chn, struct mbuf_t *head,
 			 struct mbuf_t *tail, int num);
+	/*
+	 * for pcie: push_list, more != 0 tells another push follows right
+	 * away, the chains are then sent behind one doorbell
+	 */
+	int (*push_list_more)(int chn, struct mbuf_t *head,
+			      struct mbuf_t *tail, int num, int more);
 
 	/*
 	 * for pcie
@@ -274,6 +314,18 @@ int sprdwcn_bus_push_list(int chn, struct mbuf_t *head,
 	return bus_ops->push_list(chn, head, tail, num);
 }
 
+static inline
+int sprdwcn_bus_push_list_more(int chn, struct mbuf_t *head,
+			       struct mbuf_t *tail, int num, int more)
+{
+	struct sprdwcn_bus_ops *bus_ops = get_wcn_bus_ops();
+
+	if (bus_ops && bus_ops->push_list_more)
+		return bus_ops->push_list_more(chn, head, tail, num, more);
+
+	return sprdwcn_bus_push_list(chn, head, tail, num);
+}
+
 static inline
 int sprdwcn_bus_push_list_direct(int chn, struct mbuf_t *head,
 				 struct mbuf_t *tail, int num)
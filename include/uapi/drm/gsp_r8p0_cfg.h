@@ -230,6 +230,9 @@ struct gsp_r8p0_capability {
 
 	__u32 max_gspmmu_size;
 	__u32 max_gsp_bandwidth;
+
+	/* BIT(enum gsp_r8p0_des_layer_format) the des layer can compress */
+	__u32 fbc_des_fmts;
 };
 
 #endif
@@ -0,0 +1,39 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+/*
+ * Copyright (C) 2019 Spreadtrum Communications Inc.
+ */
+
+#ifndef _UAPI_SPRD_SPIPE_H
+#define _UAPI_SPRD_SPIPE_H
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+/*
+ * Zero copy reading of spipe devices created with "sprd,rx-mmap". The rx
+ * ring is mmap()ed read only from offset 0. poll() reports POLLIN when
+ * there is data, SPIPE_IOC_RX_PEEK tells where it is and
+ * SPIPE_IOC_RX_CONSUME hands the bytes read back to the modem. The data
+ * wraps around at the end of the ring.
+ *
+ * SPIPE_IOC_RX_ADVANCE does both in one call: it consumes len bytes, 0
+ * for none, and returns the window after them. A reader that keeps to
+ * its thread instead of poll() may attach an eventfd with
+ * SPIPE_IOC_RX_EVENTFD, -1 detaches it. It is signalled when the modem
+ * reports new data, which it only does for a ring it saw empty, so
+ * drain the window before waiting again. Only one eventfd per ring, the
+ * ioctl fails with EBUSY while another open file has one attached.
+ */
+struct spipe_rx_window {
+	__u32	offset;	/* of the unread data in the mapping */
+	__u32	len;	/* bytes of unread data */
+};
+
+#define SPIPE_IOCTL_MAGIC	's'
+
+#define SPIPE_IOC_RX_PEEK	_IOR(SPIPE_IOCTL_MAGIC, 1, struct spipe_rx_window)
+#define SPIPE_IOC_RX_CONSUME	_IOW(SPIPE_IOCTL_MAGIC, 2, __u32)
+#define SPIPE_IOC_RX_ADVANCE	_IOWR(SPIPE_IOCTL_MAGIC, 3, struct spipe_rx_window)
+#define SPIPE_IOC_RX_EVENTFD	_IOW(SPIPE_IOCTL_MAGIC, 4, int)
+
+#endif
@@ -32,6 +32,12 @@
 #define JPG_FREE_IOVA   _IOW(SPRD_JPG_IOCTL_MAGIC, 12, struct jpg_iommu_map_data)
 #define JPG_GET_IOMMU_STATUS _IO(SPRD_JPG_IOCTL_MAGIC, 13)
 #define JPG_VERSION _IO(SPRD_JPG_IOCTL_MAGIC, 14)
+/*
+ * Like JPG_START but returns at once with a sync_file fd, which signals
+ * when the encode is done. Its error is -ETIMEDOUT when the core did not
+ * finish in time and -ECANCELED when the core was released before.
+ */
+#define JPG_START_ASYNC _IOR(SPRD_JPG_IOCTL_MAGIC, 15, int)
 
 #ifdef CONFIG_COMPAT
 #define COMPAT_JPG_GET_IOVA    _IOWR(SPRD_JPG_IOCTL_MAGIC, 11, struct compat_jpg_iommu_map_data)
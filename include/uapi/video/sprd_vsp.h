@@ -14,6 +14,7 @@
 #define _SPRD_VSP_H
 
 #include <linux/ioctl.h>
+#include <linux/types.h>
 #include <linux/compat.h>
 
 #define SPRD_VSP_MAP_SIZE 0xA000
@@ -38,6 +39,7 @@
 #define VSP_SET_SCENE                _IO(SPRD_VSP_IOCTL_MAGIC, 16)
 #define VSP_GET_SCENE                _IO(SPRD_VSP_IOCTL_MAGIC, 17)
 #define VSP_SYNC_GSP                _IO(SPRD_VSP_IOCTL_MAGIC, 18)
+#define VSP_SET_WORKLOAD    _IOW(SPRD_VSP_IOCTL_MAGIC, 19, struct vsp_workload)
 
 #ifdef CONFIG_COMPAT
 #define COMPAT_VSP_GET_IOVA    _IOWR(SPRD_VSP_IOCTL_MAGIC, 11, struct compat_vsp_iommu_map_data)
@@ -93,6 +95,21 @@ typedef enum {
 	MAX_VERSIONS,
 } VSP_VERSION_E;
 
+enum vsp_frame_type {
+	VSP_FRAME_I = 0,
+	VSP_FRAME_P = 1,
+	VSP_FRAME_B = 2,
+};
+
+/* every field is 32 bit, the compat layout is the same */
+struct vsp_workload {
+	__u32 width;
+	__u32 height;
+	__u32 frame_type;	/* enum vsp_frame_type */
+	__u32 fps;		/* frames the stream needs per second */
+	__u32 bitrate_kbps;	/* 0: unknown */
+};
+
 struct vsp_iommu_map_data {
 	int fd;
 	size_t size;
@@ -110,6 +127,9 @@ its job after this command retruns.
 VSP_RESET:reset vsp hardware
 VSP_CONFIG_FREQ/VSP_GET_FREQ:set/get vsp frequency,the parameter is of
 type sprd_vsp_frequency_e, the larger the faster
+VSP_SET_WORKLOAD:describe the next frame, the driver picks the lowest
+frequency which still codes it in time at the given fps. Without apsys
+dvfs it takes effect at the next VSP_ENABLE, like VSP_CONFIG_FREQ.
 */
 
 #endif
@@ -2295,6 +2295,9 @@ static void __sched_fork(unsigned long clone_flags, struct task_struct *p)
 #ifdef CONFIG_SCHED_WALT
 	p->last_sleep_ts		= 0;
 #endif
+#ifdef CONFIG_SCHED_TUNE
+	p->stune_lent_idx		= 0;
+#endif
 
 	INIT_LIST_HEAD(&p->se.group_node);
 	walt_init_new_task_load(p);
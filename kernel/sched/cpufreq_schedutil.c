@@ -18,6 +18,7 @@
 #include <trace/events/power.h>
 
 #include "sched.h"
+#include "walt.h"
 
 #define MIN_CAP_CPUMASK_FREQ_MARGIN 0
 #define OTHER_CPUMASK_FREQ_MARGIN -10
@@ -31,6 +32,7 @@ struct sugov_tunables {
 	unsigned int down_rate_limit_us;
 	unsigned int timer_slack_val_us;
 	int freq_margin;
+	unsigned int walt_predict;
 };
 
 struct sugov_policy {
@@ -245,7 +247,27 @@ static unsigned int get_next_freq(struct sugov_policy *sg_policy,
 	return cpufreq_driver_resolve_freq(policy, freq);
 }
 
-static unsigned long sugov_get_util(unsigned long *max, int cpu)
+#ifdef CONFIG_SCHED_WALT
+/*
+ * Busy time of the window in progress, extrapolated to the whole window
+ * once a quarter of it has passed, so a ramp shows before the window
+ * rolls over into prev_runnable_sum.
+ */
+static unsigned long sugov_walt_predict(int cpu)
+{
+	struct rq *rq = cpu_rq(cpu);
+	u64 elapsed = walt_ktime_clock() - READ_ONCE(rq->window_start);
+	u64 util;
+
+	if (elapsed < walt_ravg_window / 4 || elapsed > walt_ravg_window)
+		return 0;
+
+	util = READ_ONCE(rq->curr_runnable_sum) << SCHED_CAPACITY_SHIFT;
+	return div64_u64(util, elapsed);
+}
+#endif
+
+static unsigned long sugov_get_util(unsigned long *max, int cpu, bool predict)
 {
 	struct rq *rq = cpu_rq(cpu);
 	unsigned long max_cap, irq, util;
@@ -255,6 +277,8 @@ static unsigned long sugov_get_util(unsigned long *max, int cpu)
 #ifdef CONFIG_SCHED_WALT
 	if (!walt_disabled && sysctl_sched_use_walt_cpu_util) {
 		util = cpu_util_freq(cpu);
+		if (predict)
+			util = max(util, sugov_walt_predict(cpu));
 		util = boosted_cpu_util(cpu, util);
 
 		return min(util, max_cap);
@@ -411,7 +435,8 @@ static void sugov_update_single(struct update_util_data *hook, u64 time,
 	if (flags & SCHED_CPUFREQ_DL) {
 		next_f = policy->cpuinfo.max_freq;
 	} else {
-		util = sugov_get_util(&max, sg_cpu->cpu);
+		util = sugov_get_util(&max, sg_cpu->cpu,
+				      sg_policy->tunables->walt_predict);
 		sugov_iowait_boost(sg_cpu, &util, &max);
 		next_f = get_next_freq(sg_policy, util, max);
 		/*
@@ -478,7 +503,8 @@ static void sugov_update_shared(struct update_util_data *hook, u64 time,
 	unsigned long util, max;
 	unsigned int next_f;
 
-	util = sugov_get_util(&max, sg_cpu->cpu);
+	util = sugov_get_util(&max, sg_cpu->cpu,
+			      sg_policy->tunables->walt_predict);
 
 	raw_spin_lock(&sg_policy->update_lock);
 
@@ -669,16 +695,39 @@ static ssize_t freq_margin_store(struct gov_attr_set *attr_set,
 	return count;
 }
 
+static ssize_t walt_predict_show(struct gov_attr_set *attr_set, char *buf)
+{
+	struct sugov_tunables *tunables = to_sugov_tunables(attr_set);
+
+	return sprintf(buf, "%u\n", tunables->walt_predict);
+}
+
+static ssize_t walt_predict_store(struct gov_attr_set *attr_set,
+				  const char *buf, size_t count)
+{
+	struct sugov_tunables *tunables = to_sugov_tunables(attr_set);
+	unsigned int walt_predict;
+
+	if (kstrtouint(buf, 10, &walt_predict))
+		return -EINVAL;
+
+	tunables->walt_predict = !!walt_predict;
+
+	return count;
+}
+
 static struct governor_attr up_rate_limit_us = __ATTR_RW(up_rate_limit_us);
 static struct governor_attr down_rate_limit_us = __ATTR_RW(down_rate_limit_us);
 static struct governor_attr timer_slack_val_us = __ATTR_RW(timer_slack_val_us);
 static struct governor_attr freq_margin = __ATTR_RW(freq_margin);
+static struct governor_attr walt_predict = __ATTR_RW(walt_predict);
 
 static struct attribute *sugov_attributes[] = {
 	&up_rate_limit_us.attr,
 	&down_rate_limit_us.attr,
 	&timer_slack_val_us.attr,
 	&freq_margin.attr,
+	&walt_predict.attr,
 	NULL
 };
 
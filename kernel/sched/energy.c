@@ -54,6 +54,33 @@ static void free_resources(void)
 static bool sge_ready;
 static bool freq_energy_model;
 
+/*
+ * Dynamic power of a cpu at @freq (kHz), from the voltage of the OPP the
+ * cpufreq driver registered for it: P = C * V^2 * f, the same model and
+ * units (mW from uW/MHz/V^2) as the cpufreq cooling device. The OPPs are
+ * the binned ones, so the result follows the silicon of this device
+ * rather than the nominal table in DT. Returns 0 without such an OPP.
+ */
+static unsigned long sched_energy_opp_power(struct device *cpu_dev,
+					    u32 coeff, unsigned long freq)
+{
+	unsigned long hz = freq * 1000;
+	struct dev_pm_opp *opp;
+	u64 mv, power;
+
+	opp = dev_pm_opp_find_freq_ceil(cpu_dev, &hz);
+	if (IS_ERR(opp))
+		return 0;
+
+	mv = dev_pm_opp_get_voltage(opp) / 1000;
+	dev_pm_opp_put(opp);
+
+	power = (u64)coeff * mv * mv * (freq / 1000);
+	do_div(power, 1000000000);
+
+	return max_t(unsigned long, power, 1);
+}
+
 void check_max_cap_vs_cpu_scale(int cpu, struct sched_group_energy *sge)
 {
 	unsigned long max_cap, cpu_scale;
@@ -257,8 +284,23 @@ static int sched_energy_probe(struct platform_device *pdev)
 	for_each_possible_cpu(cpu) {
 		unsigned long cpu_max_cap;
 		struct sched_group_energy *sge_l0, *sge;
+		struct device_node *cn;
+		u32 coeff = 0;
+
 		cpu_max_cap = topology_get_cpu_scale(NULL, cpu);
 
+		/*
+		 * With a dynamic-power-coefficient the cpu level busy costs
+		 * are worked out from the binned OPP voltages, the cluster
+		 * level ones stay as given in DT.
+		 */
+		cn = of_get_cpu_node(cpu, NULL);
+		if (cn) {
+			of_property_read_u32(cn, "dynamic-power-coefficient",
+					     &coeff);
+			of_node_put(cn);
+		}
+
 		/*
 		 * All the cap_states have same frequency table so use
 		 * SD_LEVEL0's.
@@ -289,6 +331,15 @@ static int sched_energy_probe(struct platform_device *pdev)
 						break;
 					sge->cap_states[i].cap = cap;
 				}
+
+				if (coeff) {
+					unsigned long power;
+
+					power = sched_energy_opp_power(
+						get_cpu_device(cpu), coeff, freq);
+					if (power)
+						sge_l0->cap_states[i].power = power;
+				}
 				dev_dbg(&pdev->dev,
 					"cpu=%d freq=%ld cap=%ld power_d0=%ld\n",
 					cpu, freq, sge_l0->cap_states[i].cap,
@@ -7420,14 +7420,18 @@ static inline int find_best_target(struct task_struct *p, int *backup_cpu,
 	struct root_domain *rd = cpu_rq(smp_processor_id())->rd;
 	unsigned long max_cap = rd->max_cpu_capacity.val;
 	int prev_cpu = task_cpu(p);
+	int placement = schedtune_task_placement(p);
 #ifdef CONFIG_SPRD_CORE_CTL
 	int isolated_candidate = -1;
 #endif
 
 	*backup_cpu = -1;
 
-	/* Find start CPU based on boost value */
-	cpu = start_cpu(p, false);
+	/* Find start CPU based on the boost group placement */
+	if (placement == SCHEDTUNE_PLACE_LITTLE && rd->min_cap_orig_cpu != -1)
+		cpu = rd->min_cap_orig_cpu;
+	else
+		cpu = start_cpu(p, placement == SCHEDTUNE_PLACE_BIG);
 	if (cpu < 0)
 		return -1;
 
@@ -7572,6 +7576,12 @@ static inline int find_best_target(struct task_struct *p, int *backup_cpu,
 			target_cpu = i;
 		}
 
+		/* A placed group stays on its cluster while it has a candidate */
+		if (placement != SCHEDTUNE_PLACE_ANY &&
+		    (target_cpu != -1 || best_idle_cpu != -1 ||
+		     backup_idle_cpu != -1 || best_active_cpu != -1))
+			break;
+
 	} while (sg = sg->next, sg != sd->groups);
 
 	/*
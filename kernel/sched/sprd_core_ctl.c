@@ -12,8 +12,10 @@
 #include <uapi/linux/sched/types.h>
 #include "sched.h"
 #include "walt.h"
+#include "tune.h"
 #include <linux/sched/rt.h>
 #include <linux/capability.h>
+#include <linux/timer.h>
 
 #ifndef pr_fmt
 #define pr_fmt(fmt)	"core_ctl: " fmt
@@ -34,6 +36,7 @@ enum plug_type {
 enum set_type {
 	SETMAX,
 	SETMIN,
+	SETAUTO,
 };
 
 struct cluster_data {
@@ -54,6 +57,12 @@ struct cluster_data {
 	cpumask_t cpu_mask;
 	unsigned int id;
 	enum set_type settype;
+	/* load policy, need_cpus follows the walt busy time when auto_ctl */
+	bool auto_ctl;
+	unsigned int busy_up_thres;
+	unsigned int busy_down_thres;
+	unsigned int offline_delay_ms;
+	unsigned long need_ts;
 	spinlock_t pending_lock;
 	struct task_struct *core_ctl_thread;
 	struct list_head lru;
@@ -63,6 +72,7 @@ struct cluster_data {
 
 struct cpu_data {
 	bool isolated_by_us;
+	bool is_busy;
 	int cpu;
 	u64 isolate_cnt;
 	struct cluster_data *cluster;
@@ -74,6 +84,7 @@ static DEFINE_PER_CPU(struct cpu_data, cpu_state);
 static DEFINE_SPINLOCK(state_lock);
 static LIST_HEAD(cluster_list);
 static bool initialized;
+static struct timer_list core_ctl_timer;
 
 static void wake_up_core_ctl_thread(struct cluster_data *state);
 static unsigned int get_active_cpu_count(const struct cluster_data *cluster);
@@ -323,6 +334,81 @@ static ssize_t show_enable(const struct cluster_data *state, char *buf)
 	return scnprintf(buf, PAGE_SIZE, "%u\n", state->enable);
 }
 
+static ssize_t store_auto_ctl(struct cluster_data *state,
+			      const char *buf, size_t count)
+{
+	unsigned int val;
+
+	if (sscanf(buf, "%u\n", &val) != 1)
+		return -EINVAL;
+
+	state->need_ts = jiffies;
+	state->auto_ctl = !!val;
+	if (state->auto_ctl && initialized)
+		mod_timer(&core_ctl_timer, jiffies + 1);
+
+	return count;
+}
+
+static ssize_t show_auto_ctl(const struct cluster_data *state, char *buf)
+{
+	return scnprintf(buf, PAGE_SIZE, "%u\n", state->auto_ctl);
+}
+
+static ssize_t store_busy_up_thres(struct cluster_data *state,
+				   const char *buf, size_t count)
+{
+	unsigned int val;
+
+	if (sscanf(buf, "%u\n", &val) != 1 || val > 100 ||
+	    val < state->busy_down_thres)
+		return -EINVAL;
+
+	state->busy_up_thres = val;
+	return count;
+}
+
+static ssize_t show_busy_up_thres(const struct cluster_data *state, char *buf)
+{
+	return scnprintf(buf, PAGE_SIZE, "%u\n", state->busy_up_thres);
+}
+
+static ssize_t store_busy_down_thres(struct cluster_data *state,
+				     const char *buf, size_t count)
+{
+	unsigned int val;
+
+	if (sscanf(buf, "%u\n", &val) != 1 || val > state->busy_up_thres)
+		return -EINVAL;
+
+	state->busy_down_thres = val;
+	return count;
+}
+
+static ssize_t show_busy_down_thres(const struct cluster_data *state,
+				    char *buf)
+{
+	return scnprintf(buf, PAGE_SIZE, "%u\n", state->busy_down_thres);
+}
+
+static ssize_t store_offline_delay_ms(struct cluster_data *state,
+				      const char *buf, size_t count)
+{
+	unsigned int val;
+
+	if (sscanf(buf, "%u\n", &val) != 1)
+		return -EINVAL;
+
+	state->offline_delay_ms = val;
+	return count;
+}
+
+static ssize_t show_offline_delay_ms(const struct cluster_data *state,
+				     char *buf)
+{
+	return scnprintf(buf, PAGE_SIZE, "%u\n", state->offline_delay_ms);
+}
+
 static ssize_t store_isolate_cpu_id(struct cluster_data *state,
 			     const char *buf, size_t count)
 {
@@ -428,6 +514,10 @@ core_ctl_attr_ro(global_state);
 core_ctl_attr_rw(enable);
 core_ctl_attr_rw(isolate_cpu_id);
 core_ctl_attr_rw(unisolate_cpu_id);
+core_ctl_attr_rw(auto_ctl);
+core_ctl_attr_rw(busy_up_thres);
+core_ctl_attr_rw(busy_down_thres);
+core_ctl_attr_rw(offline_delay_ms);
 
 static struct attribute *default_attrs[] = {
 	&min_cpus.attr,
@@ -438,6 +528,10 @@ static struct attribute *default_attrs[] = {
 	&enable.attr,
 	&isolate_cpu_id.attr,
 	&unisolate_cpu_id.attr,
+	&auto_ctl.attr,
+	&busy_up_thres.attr,
+	&busy_down_thres.attr,
+	&offline_delay_ms.attr,
 	NULL
 };
 
@@ -543,6 +637,9 @@ static void try_to_isolate(struct cluster_data *cluster, unsigned int need)
 			    &cluster->latest_cpumask))
 				continue;
 		}
+
+		if (cluster->settype == SETAUTO && c->is_busy)
+			continue;
 		spin_unlock_irqrestore(&state_lock, flags);
 
 		CORE_CTL_INFO("Trying to isolate CPU%u\n", c->cpu);
@@ -672,6 +769,121 @@ static int __ref try_core_ctl(void *data)
 	return 0;
 }
 
+/* ========================== load based policy ========================= */
+#ifdef CONFIG_SCHED_WALT
+/*
+ * A cpu is busy once its last window busy time reaches busy_up_thres
+ * percent of its capacity and stays so until it drops below
+ * busy_down_thres. Tasks queued behind the running one ask for a cpu
+ * each, so a burst unisolates within the window it shows up in.
+ *
+ * A cpu running tasks of a boost group placed on the big cluster is
+ * busy regardless of its load. The biggest cluster also asks for a cpu
+ * per such task runnable anywhere, so the group gets there even while
+ * the cluster is isolated.
+ */
+static unsigned int cluster_need_cpus(struct cluster_data *cluster)
+{
+	unsigned int need = 0, placed = 0;
+	struct cpu_data *c;
+	struct rq *rq;
+	u64 busy;
+	int cpu;
+
+	for_each_cpu(cpu, &cluster->cpu_mask) {
+		c = &per_cpu(cpu_state, cpu);
+		if (!is_active(c)) {
+			c->is_busy = false;
+			continue;
+		}
+
+		rq = cpu_rq(cpu);
+		busy = div64_u64(READ_ONCE(rq->prev_runnable_sum) * 100 *
+				 SCHED_CAPACITY_SCALE,
+				 (u64)walt_ravg_window * capacity_orig_of(cpu));
+		c->is_busy = busy >= cluster->busy_up_thres ||
+			     (c->is_busy && busy >= cluster->busy_down_thres) ||
+			     schedtune_cpu_placement_tasks(cpu,
+							   SCHEDTUNE_PLACE_BIG);
+		if (c->is_busy)
+			need++;
+		if (rq->nr_running > 1)
+			need += rq->nr_running - 1;
+	}
+
+	/* clusters are sorted by capacity, biggest first */
+	if (cluster == list_first_entry(&cluster_list, struct cluster_data,
+					cluster_node)) {
+		for_each_online_cpu(cpu)
+			placed += schedtune_cpu_placement_tasks(cpu,
+							SCHEDTUNE_PLACE_BIG);
+		need = max(need, placed);
+	}
+
+	return clamp(need, cluster->min_cpus, cluster->max_cpus);
+}
+
+static bool eval_need(struct cluster_data *cluster)
+{
+	unsigned int need;
+
+	if (!cluster->auto_ctl || !cluster->enable || walt_disabled)
+		return false;
+
+	/* leave a request in flight alone */
+	if (cluster->active_cpus != cluster->need_cpus)
+		return false;
+
+	need = cluster_need_cpus(cluster);
+	if (need >= cluster->active_cpus)
+		cluster->need_ts = jiffies;
+
+	if (need > cluster->active_cpus) {
+		cluster->need_cpus = need;
+	} else if (need < cluster->active_cpus &&
+		   time_after(jiffies, cluster->need_ts +
+			      msecs_to_jiffies(cluster->offline_delay_ms))) {
+		/* give cpus back one at a time */
+		cluster->need_cpus = cluster->active_cpus - 1;
+		cluster->need_ts = jiffies;
+	} else {
+		return false;
+	}
+
+	cluster->settype = SETAUTO;
+	return true;
+}
+
+static void core_ctl_timer_func(unsigned long data)
+{
+	struct cluster_data *cluster;
+	struct cluster_data *wake[NR_CPUS];
+	unsigned int nr_wake = 0, i;
+	unsigned long flags;
+	bool rearm = false;
+
+	spin_lock_irqsave(&state_lock, flags);
+	list_for_each_entry(cluster, &cluster_list, cluster_node) {
+		rearm |= cluster->auto_ctl;
+		if (eval_need(cluster))
+			wake[nr_wake++] = cluster;
+	}
+	spin_unlock_irqrestore(&state_lock, flags);
+
+	for (i = 0; i < nr_wake; i++)
+		wake_up_core_ctl_thread(wake[i]);
+
+	/* deferrable, an idle system does not get woken up for this */
+	if (rearm)
+		mod_timer(&core_ctl_timer, jiffies +
+			  max(nsecs_to_jiffies(walt_ravg_window), 1UL));
+}
+#else
+static void core_ctl_timer_func(unsigned long data)
+{
+}
+#endif
+
 static int __ref cpuhp_core_ctl_online(unsigned int cpu)
 {
 	struct cpu_data *state = &per_cpu(cpu_state, cpu);
@@ -801,6 +1013,11 @@ static int cluster_init(const struct cpumask *mask)
 	cluster->id = topology_physical_package_id(first_cpu);
 	cluster->min_cpus = (cluster->id == 0) ? 1 : 0;
 	cluster->settype = -1;
+	cluster->auto_ctl = false;
+	cluster->busy_up_thres = 60;
+	cluster->busy_down_thres = 30;
+	cluster->offline_delay_ms = 100;
+	cluster->need_ts = jiffies;
 	cluster->isolate_cpu_id = -1;
 	cluster->unisolate_cpu_id = -1;
 	cluster->capacity = capacity_orig_of(first_cpu);
@@ -846,6 +1063,8 @@ static int __init core_ctl_init(void)
 {
 	int cpu;
 
+	setup_deferrable_timer(&core_ctl_timer, core_ctl_timer_func, 0);
+
 	cpuhp_setup_state_nocalls(CPUHP_AP_ONLINE_DYN, "core_ctl:online",
 				  cpuhp_core_ctl_online, NULL);
 
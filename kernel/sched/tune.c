@@ -36,6 +36,9 @@ struct schedtune {
 	 * towards idle CPUs */
 	int prefer_idle;
 
+	/* Cluster the tasks of that SchedTune CGroup are placed on */
+	int placement;
+
 #ifdef CONFIG_SCHED_WALT
 	int account_wait_time;
 	int init_task_load_pct;
@@ -123,6 +126,31 @@ struct boost_groups {
 /* Boost groups affecting each CPU in the system */
 DEFINE_PER_CPU(struct boost_groups, cpu_boost_groups);
 
+/*
+ * Placement of each allocated boost group, by boost group index. Kept
+ * outside of struct schedtune so that the per CPU task counts can be
+ * matched against it without holding a reference on the group.
+ */
+static int boostgroup_placement[BOOSTGROUPS_COUNT];
+
+/*
+ * Same for boost and prefer_idle, which is what a task lent a boost group
+ * by schedtune_lend_group() runs with.
+ */
+static int boostgroup_boost[BOOSTGROUPS_COUNT];
+static int boostgroup_prefer_idle[BOOSTGROUPS_COUNT];
+
+/*
+ * Boost group @p is accounted to: the one it was lent or its own.
+ * Caller holds rcu_read_lock().
+ */
+static inline int task_schedtune_idx(struct task_struct *p)
+{
+	int idx = READ_ONCE(p->stune_lent_idx);
+
+	return idx ? idx : task_schedtune(p)->idx;
+}
+
 static inline bool schedtune_boost_timeout(u64 now, u64 ts)
 {
 	return ((now - ts) > SCHEDTUNE_BOOST_HOLD_NS);
@@ -261,7 +289,6 @@ void schedtune_enqueue_task(struct task_struct *p, int cpu)
 {
 	struct boost_groups *bg = &per_cpu(cpu_boost_groups, cpu);
 	unsigned long irq_flags;
-	struct schedtune *st;
 	int idx;
 
 	if (unlikely(!schedtune_initialized))
@@ -275,8 +302,7 @@ void schedtune_enqueue_task(struct task_struct *p, int cpu)
 	raw_spin_lock_irqsave(&bg->lock, irq_flags);
 	rcu_read_lock();
 
-	st = task_schedtune(p);
-	idx = st->idx;
+	idx = task_schedtune_idx(p);
 
 	schedtune_tasks_update(p, cpu, idx, ENQUEUE_TASK);
 
@@ -310,7 +336,11 @@ int schedtune_can_attach(struct cgroup_taskset *tset)
 		 */
 		rq = task_rq_lock(task, &rq_flags);
 
-		if (!task->on_rq) {
+		/*
+		 * A task on loan stays accounted to the lent group, the
+		 * new own group is picked up when the loan is returned.
+		 */
+		if (!task->on_rq || task->stune_lent_idx) {
 			task_rq_unlock(rq, task, &rq_flags);
 			continue;
 		}
@@ -376,7 +406,6 @@ void schedtune_dequeue_task(struct task_struct *p, int cpu)
 {
 	struct boost_groups *bg = &per_cpu(cpu_boost_groups, cpu);
 	unsigned long irq_flags;
-	struct schedtune *st;
 	int idx;
 
 	if (unlikely(!schedtune_initialized))
@@ -389,8 +418,7 @@ void schedtune_dequeue_task(struct task_struct *p, int cpu)
 	raw_spin_lock_irqsave(&bg->lock, irq_flags);
 	rcu_read_lock();
 
-	st = task_schedtune(p);
-	idx = st->idx;
+	idx = task_schedtune_idx(p);
 
 	schedtune_tasks_update(p, cpu, idx, DEQUEUE_TASK);
 
@@ -417,10 +445,15 @@ int schedtune_task_boost(struct task_struct *p)
 {
 	struct schedtune *st;
 	int task_boost;
+	int idx;
 
 	if (unlikely(!schedtune_initialized))
 		return 0;
 
+	idx = READ_ONCE(p->stune_lent_idx);
+	if (idx)
+		return READ_ONCE(boostgroup_boost[idx]);
+
 	/* Get task boost value */
 	rcu_read_lock();
 	st = task_schedtune(p);
@@ -434,10 +467,15 @@ int schedtune_prefer_idle(struct task_struct *p)
 {
 	struct schedtune *st;
 	int prefer_idle;
+	int idx;
 
 	if (unlikely(!schedtune_initialized))
 		return 0;
 
+	idx = READ_ONCE(p->stune_lent_idx);
+	if (idx)
+		return READ_ONCE(boostgroup_prefer_idle[idx]);
+
 	/* Get prefer_idle value */
 	rcu_read_lock();
 	st = task_schedtune(p);
@@ -447,6 +485,188 @@ int schedtune_prefer_idle(struct task_struct *p)
 	return prefer_idle;
 }
 
+int schedtune_task_placement(struct task_struct *p)
+{
+	struct schedtune *st;
+	int placement;
+	int idx;
+
+	if (unlikely(!schedtune_initialized))
+		return SCHEDTUNE_PLACE_ANY;
+
+	idx = READ_ONCE(p->stune_lent_idx);
+	if (idx)
+		return READ_ONCE(boostgroup_placement[idx]);
+
+	/* Get placement value */
+	rcu_read_lock();
+	st = task_schedtune(p);
+	placement = st->placement;
+	rcu_read_unlock();
+
+	return placement;
+}
+
+static int schedtune_placement_rank(int placement)
+{
+	switch (placement) {
+	case SCHEDTUNE_PLACE_BIG:
+		return 2;
+	case SCHEDTUNE_PLACE_LITTLE:
+		return 0;
+	default:
+		return 1;
+	}
+}
+
+/*
+ * Boost group @idx boosts at least as much as @boost, @prefer_idle and
+ * @placement on every knob, and more on one of them.
+ */
+static bool schedtune_group_dominates(int idx, int boost, int prefer_idle,
+				      int placement)
+{
+	int g_boost = READ_ONCE(boostgroup_boost[idx]);
+	int g_prefer_idle = READ_ONCE(boostgroup_prefer_idle[idx]);
+	int g_rank = schedtune_placement_rank(
+			READ_ONCE(boostgroup_placement[idx]));
+	int rank = schedtune_placement_rank(placement);
+
+	if (g_boost < boost || g_prefer_idle < prefer_idle || g_rank < rank)
+		return false;
+
+	return g_boost > boost || g_prefer_idle > prefer_idle || g_rank > rank;
+}
+
+/* Move the accounting of @p along with its lent group, like attach does */
+static void schedtune_set_lent_group(struct task_struct *p, int idx)
+{
+	struct boost_groups *bg;
+	struct rq_flags rq_flags;
+	struct rq *rq;
+	int src_bg, dst_bg;
+	int tasks;
+	u64 now;
+
+	rq = task_rq_lock(p, &rq_flags);
+	rcu_read_lock();
+	src_bg = task_schedtune_idx(p);
+	WRITE_ONCE(p->stune_lent_idx, idx);
+	dst_bg = task_schedtune_idx(p);
+	rcu_read_unlock();
+
+	/* only fair tasks are accounted, see enqueue_task_fair() */
+	if (src_bg != dst_bg && task_on_rq_queued(p) &&
+	    p->sched_class == &fair_sched_class) {
+		bg = &per_cpu(cpu_boost_groups, cpu_of(rq));
+		raw_spin_lock(&bg->lock);
+
+		tasks = bg->group[src_bg].tasks - 1;
+		bg->group[src_bg].tasks = max(0, tasks);
+		bg->group[dst_bg].tasks += 1;
+
+		now = sched_clock_cpu(cpu_of(rq));
+		bg->group[dst_bg].ts = now;
+
+		/* Force boost group re-evaluation at next boost check */
+		bg->boost_ts = now - SCHEDTUNE_BOOST_HOLD_NS;
+
+		raw_spin_unlock(&bg->lock);
+	}
+	task_rq_unlock(rq, p, &rq_flags);
+}
+
+/*
+ * Boost group @p runs in, including a lent one. This is what a binder
+ * client hands to the thread serving its call.
+ */
+int schedtune_task_group(struct task_struct *p)
+{
+	int idx;
+
+	if (unlikely(!schedtune_initialized))
+		return 0;
+
+	rcu_read_lock();
+	idx = task_schedtune_idx(p);
+	rcu_read_unlock();
+
+	return idx;
+}
+
+/*
+ * Lend boost group @idx to @p as long as it helps @p: @p then gets the
+ * boost, prefer_idle and placement of @idx and is accounted to it, so
+ * CPU boost and core_ctl isolation follow as well. Return the group @p
+ * was lent before, to be given back to schedtune_return_group() when
+ * the loan ends. Loans nest, a weaker group never replaces a stronger.
+ */
+int schedtune_lend_group(struct task_struct *p, int idx)
+{
+	struct schedtune *st;
+	int prev;
+	bool lend;
+
+	if (unlikely(!schedtune_initialized))
+		return 0;
+
+	prev = READ_ONCE(p->stune_lent_idx);
+	if (idx <= 0 || idx >= BOOSTGROUPS_COUNT || idx == prev)
+		return prev;
+
+	if (prev) {
+		lend = schedtune_group_dominates(idx,
+				READ_ONCE(boostgroup_boost[prev]),
+				READ_ONCE(boostgroup_prefer_idle[prev]),
+				READ_ONCE(boostgroup_placement[prev]));
+	} else {
+		rcu_read_lock();
+		st = task_schedtune(p);
+		lend = st->idx != idx &&
+		       schedtune_group_dominates(idx, st->boost,
+						 st->prefer_idle,
+						 st->placement);
+		rcu_read_unlock();
+	}
+
+	if (lend)
+		schedtune_set_lent_group(p, idx);
+
+	return prev;
+}
+
+/* end a loan of schedtune_lend_group(), @idx is what it returned */
+void schedtune_return_group(struct task_struct *p, int idx)
+{
+	if (unlikely(!schedtune_initialized))
+		return;
+
+	if (idx < 0 || idx >= BOOSTGROUPS_COUNT)
+		idx = 0;
+	if (READ_ONCE(p->stune_lent_idx) != idx)
+		schedtune_set_lent_group(p, idx);
+}
+
+/*
+ * RUNNABLE tasks on @cpu belonging to boost groups with @placement. No
+ * lock is taken, callers sample it and cope with a stale count.
+ */
+unsigned int schedtune_cpu_placement_tasks(int cpu, int placement)
+{
+	struct boost_groups *bg = &per_cpu(cpu_boost_groups, cpu);
+	unsigned int tasks = 0;
+	int idx;
+
+	if (unlikely(!schedtune_initialized))
+		return 0;
+
+	for (idx = 0; idx < BOOSTGROUPS_COUNT; ++idx)
+		if (READ_ONCE(boostgroup_placement[idx]) == placement)
+			tasks += READ_ONCE(bg->group[idx].tasks);
+
+	return tasks;
+}
+
 #ifdef CONFIG_SCHED_WALT
 int schedtune_account_wait_time(struct task_struct *p)
 {
@@ -497,6 +717,30 @@ prefer_idle_write(struct cgroup_subsys_state *css, struct cftype *cft,
 {
 	struct schedtune *st = css_st(css);
 	st->prefer_idle = !!prefer_idle;
+	WRITE_ONCE(boostgroup_prefer_idle[st->idx], st->prefer_idle);
+
+	return 0;
+}
+
+static u64
+placement_read(struct cgroup_subsys_state *css, struct cftype *cft)
+{
+	struct schedtune *st = css_st(css);
+
+	return st->placement;
+}
+
+static int
+placement_write(struct cgroup_subsys_state *css, struct cftype *cft,
+		u64 placement)
+{
+	struct schedtune *st = css_st(css);
+
+	if (placement >= NUM_SCHEDTUNE_PLACE)
+		return -EINVAL;
+
+	st->placement = placement;
+	WRITE_ONCE(boostgroup_placement[st->idx], placement);
 
 	return 0;
 }
@@ -519,6 +763,7 @@ boost_write(struct cgroup_subsys_state *css, struct cftype *cft,
 		return -EINVAL;
 
 	st->boost = boost;
+	WRITE_ONCE(boostgroup_boost[st->idx], boost);
 
 	/* Update CPU boost */
 	schedtune_boostgroup_update(st->idx, st->boost);
@@ -577,6 +822,11 @@ static struct cftype files[] = {
 		.read_u64 = prefer_idle_read,
 		.write_u64 = prefer_idle_write,
 	},
+	{
+		.name = "placement",
+		.read_u64 = placement_read,
+		.write_u64 = placement_write,
+	},
 #ifdef CONFIG_SCHED_WALT
 	{
 		.name = "account_wait_time",
@@ -600,6 +850,9 @@ schedtune_boostgroup_init(struct schedtune *st)
 
 	/* Keep track of allocated boost groups */
 	allocated_group[st->idx] = st;
+	WRITE_ONCE(boostgroup_placement[st->idx], st->placement);
+	WRITE_ONCE(boostgroup_boost[st->idx], st->boost);
+	WRITE_ONCE(boostgroup_prefer_idle[st->idx], st->prefer_idle);
 
 	/* Initialize the per CPU boost groups */
 	for_each_possible_cpu(cpu) {
@@ -662,6 +915,9 @@ schedtune_boostgroup_release(struct schedtune *st)
 
 	/* Keep track of allocated boost groups */
 	allocated_group[st->idx] = NULL;
+	WRITE_ONCE(boostgroup_placement[st->idx], SCHEDTUNE_PLACE_ANY);
+	WRITE_ONCE(boostgroup_boost[st->idx], 0);
+	WRITE_ONCE(boostgroup_prefer_idle[st->idx], 0);
 }
 
 static void
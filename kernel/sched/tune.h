@@ -1,4 +1,16 @@
 
+/*
+ * Cluster a boost group is placed on: top-app style groups ask for the
+ * biggest cpus and keep them from being isolated, background groups are
+ * packed on the littlest ones.
+ */
+enum schedtune_placement {
+	SCHEDTUNE_PLACE_ANY,
+	SCHEDTUNE_PLACE_BIG,
+	SCHEDTUNE_PLACE_LITTLE,
+	NUM_SCHEDTUNE_PLACE
+};
+
 #ifdef CONFIG_SCHED_TUNE
 
 #include <linux/reciprocal_div.h>
@@ -17,6 +29,9 @@ int schedtune_task_boost(struct task_struct *tsk);
 
 int schedtune_prefer_idle(struct task_struct *tsk);
 
+int schedtune_task_placement(struct task_struct *tsk);
+unsigned int schedtune_cpu_placement_tasks(int cpu, int placement);
+
 #ifdef CONFIG_SCHED_WALT
 int schedtune_account_wait_time(struct task_struct *tsk);
 int schedtune_init_task_load_pct(struct task_struct *tsk);
@@ -32,6 +47,9 @@ void schedtune_dequeue_task(struct task_struct *p, int cpu);
 
 #define schedtune_prefer_idle(tsk) 0
 
+#define schedtune_task_placement(tsk) SCHEDTUNE_PLACE_ANY
+#define schedtune_cpu_placement_tasks(cpu, placement) 0
+
 #ifdef CONFIG_SCHED_WALT
 #define schedtune_account_wait_time(tsk) 0
 #define schedtune_init_task_load_pct(tsk) 0
@@ -20,6 +20,8 @@
  */
 
 #include <linux/acpi.h>
+#include <linux/sched/debug.h>
+#include <linux/seq_file.h>
 #include <linux/syscore_ops.h>
 #include <trace/events/sched.h>
 #include "sched.h"
@@ -970,3 +972,34 @@ void walt_init_new_task_load(struct task_struct *p)
 	for (i = 0; i < RAVG_HIST_SIZE_MAX; ++i)
 		p->ravg.sum_history[i] = init_load_windows;
 }
+
+/*
+ * /proc/<pid>/task/<tid>/walt, the window statistics of one task for the
+ * userspace placement policies. The fields are read without the rq lock,
+ * so they may come from two sides of a window rollover.
+ */
+int proc_walt_show_task(struct task_struct *p, struct seq_file *m)
+{
+	u32 demand = READ_ONCE(p->ravg.demand);
+	int i;
+
+	if (walt_disabled)
+		return -ENODEV;
+
+	seq_printf(m, "demand: %u\n", demand);
+	seq_printf(m, "demand_util: %llu\n",
+		   div64_u64((u64)demand << SCHED_CAPACITY_SHIFT,
+			     walt_ravg_window));
+	seq_printf(m, "sum: %u\n", READ_ONCE(p->ravg.sum));
+	seq_printf(m, "curr_window: %u\n", READ_ONCE(p->ravg.curr_window));
+	seq_printf(m, "prev_window: %u\n", READ_ONCE(p->ravg.prev_window));
+	seq_printf(m, "active_windows: %u\n",
+		   READ_ONCE(p->ravg.active_windows));
+	seq_printf(m, "window_size: %u\n", walt_ravg_window);
+	seq_puts(m, "history:");
+	for (i = 0; i < walt_ravg_hist_size; i++)
+		seq_printf(m, " %u", READ_ONCE(p->ravg.sum_history[i]));
+	seq_putc(m, '\n');
+
+	return 0;
+}
@@ -4981,6 +4981,9 @@ static int sprd_codec_ana_probe(struct platform_device *pdev)
 	}
 	arch_audio_codec_set_regmap(adi_rgmp);
 	arch_audio_codec_set_reg_offset((unsigned long)val);
+	ret = arch_audio_codec_cache_init(pdev->dev.parent);
+	if (ret)
+		pr_warn("%s: codec registers not cached, %d\n", __func__, ret);
 	/* Set global register accessing vars for headset. */
 	glb_vars.regmap = adi_rgmp;
 	glb_vars.codec_reg_offset = val;
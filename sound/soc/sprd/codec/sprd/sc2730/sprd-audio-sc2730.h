@@ -14,6 +14,7 @@
 #ifndef __SPRD_AUDIO_SC2730_H
 #define __SPRD_AUDIO_SC2730_H
 
+#include <linux/mfd/sc27xx-pmic.h>
 #include <linux/mfd/syscon.h>
 #include <linux/regmap.h>
 #include "sprd-audio.h"
@@ -115,6 +116,31 @@ static inline void arch_audio_codec_set_reg_offset(unsigned long offset)
 	codec_reg_offset = offset;
 }
 
+/*
+ * ANA_PMU0 to ANA_CDC21 are only ever set by the AP, the PMIC regmap caches
+ * them. A reset or a disable of the analog block drops them.
+ */
+#define CODEC_CACHE_FIRST	(CODEC_AP_BASE + 0x0000)
+#define CODEC_CACHE_LAST	(CODEC_AP_BASE + 0x00C8)
+
+static inline int arch_audio_codec_cache_init(struct device *pmic)
+{
+	if (codec_regmap == NULL || codec_reg_offset == -1)
+		return -EINVAL;
+
+	return sprd_pmic_cache_range(pmic, CODEC_REG(CODEC_CACHE_FIRST),
+				     CODEC_REG(CODEC_CACHE_LAST));
+}
+
+static inline void arch_audio_codec_cache_drop(void)
+{
+	if (codec_regmap == NULL || codec_reg_offset == -1)
+		return;
+
+	regcache_drop_region(codec_regmap, CODEC_REG(CODEC_CACHE_FIRST),
+			     CODEC_REG(CODEC_CACHE_LAST));
+}
+
 /* codec parts in pmic setting */
 static inline int arch_audio_codec_write_mask(int reg, int val, int mask)
 {
@@ -170,6 +196,7 @@ static inline int arch_audio_codec_analog_reg_disable(void)
 
 	REGMAP_INIT_CHECK();
 	ret = sci_adi_write(ANA_REG_GLB_ARM_MODULE_EN, 0, BIT_ANA_AUD_EN);
+	arch_audio_codec_cache_drop();
 
 	return ret;
 }
@@ -220,6 +247,7 @@ static inline int arch_audio_codec_analog_reset(void)
 	udelay(10);
 	if (ret >= 0)
 		ret = sci_adi_write(ANA_REG_GLB_SOFT_RST0, 0, mask);
+	arch_audio_codec_cache_drop();
 
 	return ret;
 }
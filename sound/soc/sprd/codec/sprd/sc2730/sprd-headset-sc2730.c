@@ -64,6 +64,9 @@
 #define ADC_READ_BTN_COUNT 20
 #define ADC_READ_TYPEC_COUNT 20
 #define TYPEC_INVALID_TRY_COUNT 10
+#define TYPEC_RETRY_MIN_MS 10
+#define TYPEC_RETRY_MAX_MS 100
+#define EIC_DEBOUNCE_STEP_MS 4
 #define TYPEC_4POLE_MIC_MAX_VOLT 2685
 #define TYPEC_4POLE_MIC_MIN_VOLT 200
 #define TYPEC_3POLE_MIC_MAX_VOLT 100
@@ -680,6 +683,34 @@ static inline bool sprd_headset_eic_get_data(enum hdst_eic_type eic_type)
 	return (BIT(eic_type) & sprd_read_reg_value(ANA_INT0)) > 0;
 }
 
+/* hardware debounce of EIC10 (insert all) to EIC15 (bdet), ANA_INT26 on */
+static const unsigned int sprd_eic_hw_dbnc_ms[] = { 2, 50, 2, 2, 2, 6 };
+
+/*
+ * The data of an eic has to hold for @ms after its edge. The edge already
+ * waited out the hardware debounce, the rest is sampled every few ms, so
+ * a bouncing contact fails at its first change instead of after the whole
+ * wait.
+ */
+static bool sprd_headset_eic_stable(enum hdst_eic_type eic_type,
+				    unsigned int ms)
+{
+	bool data = sprd_headset_eic_get_data(eic_type);
+	unsigned int hw = sprd_eic_hw_dbnc_ms[eic_type - HDST_INSERT_ALL_EIC];
+	unsigned int step;
+
+	ms = ms > hw ? ms - hw : 0;
+	while (ms) {
+		step = min_t(unsigned int, ms, EIC_DEBOUNCE_STEP_MS);
+		sprd_msleep(step);
+		ms -= step;
+		if (sprd_headset_eic_get_data(eic_type) != data)
+			return false;
+	}
+
+	return true;
+}
+
 static void sprd_headset_prepare_ldetl(void)
 {
 	sprd_set_eic_trig_level(HDST_LDETL_EIC, true);
@@ -794,6 +825,8 @@ static void sprd_eic_hardware_debounce_set(unsigned int reg, unsigned int ms)
 
 static void sprd_headset_eic_init(void)
 {
+	int i;
+
 	/* detect ref enable */
 	headset_reg_set_bits(ANA_HDT0, HEDET_VREF_EN);
 	headset_reg_set_bits(ANA_HDT2, HEDET_LDETL_EN);
@@ -814,12 +847,9 @@ static void sprd_headset_eic_init(void)
 	sprd_headset_clear_all_eic();
 
 	/* set hardware debouce for internal EIC */
-	sprd_eic_hardware_debounce_set(ANA_INT26, 2);
-	sprd_eic_hardware_debounce_set(ANA_INT27, 50);
-	sprd_eic_hardware_debounce_set(ANA_INT28, 2);
-	sprd_eic_hardware_debounce_set(ANA_INT29, 2);
-	sprd_eic_hardware_debounce_set(ANA_INT30, 2);
-	sprd_eic_hardware_debounce_set(ANA_INT31, 6);
+	for (i = 0; i < ARRAY_SIZE(sprd_eic_hw_dbnc_ms); i++)
+		sprd_eic_hardware_debounce_set(ANA_INT26 + i * 4,
+					       sprd_eic_hw_dbnc_ms[i]);
 
 	/* init internal EIC */
 	sprd_set_all_eic_trig_level(true);
@@ -1363,8 +1393,9 @@ static enum sprd_headset_type sprd_headset_get_type(void)
 	do {
 		mic_vol_0 = sprd_headset_get_mic_voltage(hdst);
 		if (mic_vol_0 > TYPEC_4POLE_MIC_MAX_VOLT)
-			/* debounce */
-			sprd_msleep(100);
+			/* debounce, most plugs settle on the first retries */
+			sprd_msleep(min(TYPEC_RETRY_MIN_MS << try_count,
+					TYPEC_RETRY_MAX_MS));
 		else
 			break;
 	} while (++try_count < TYPEC_INVALID_TRY_COUNT);
@@ -1386,8 +1417,9 @@ static enum sprd_headset_type sprd_headset_get_type(void)
 	do {
 		mic_vol_1 = sprd_headset_get_mic_voltage(hdst);
 		if (mic_vol_1 > TYPEC_4POLE_MIC_MAX_VOLT)
-			/* debounce */
-			sprd_msleep(100);
+			/* debounce, most plugs settle on the first retries */
+			sprd_msleep(min(TYPEC_RETRY_MIN_MS << try_count,
+					TYPEC_RETRY_MAX_MS));
 		else
 			break;
 	} while (++try_count < TYPEC_INVALID_TRY_COUNT);
@@ -1551,6 +1583,28 @@ static void sprd_headset_reinit_mdet_eic(void)
 	sprd_intc_force_clear(false, ANA_INT_CLR);
 }
 
+/*
+ * The eic irq keeps the system awake for the detection, let it go as soon
+ * as the last detection work is done instead of waiting for the timeout.
+ * A work still queued, e.g. a re-detect, keeps it.
+ */
+static void sprd_headset_detect_relax(struct sprd_headset *hdst,
+				      struct delayed_work *self)
+{
+	struct delayed_work *works[] = {
+		&hdst->det_all_work, &hdst->det_mic_work,
+		&hdst->ldetl_work, &hdst->btn_work,
+	};
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(works); i++)
+		if (works[i] != self ? work_busy(&works[i]->work) :
+		    delayed_work_pending(self))
+			return;
+
+	__pm_relax(&hdst->hdst_detect_wakelock);
+}
+
 static void sprd_mdet_eic_work(struct work_struct *work)
 {
 	struct sprd_headset *hdst = sprd_hdst;
@@ -1710,8 +1764,8 @@ static void headset_button_work_func(struct work_struct *work)
 		sprd_headset_button_release(hdst);
 
 	sprd_headset_button_eic_reenable();
-	/* wake_unlock(&hdst->btn_wakelock); */
 	up(&hdst->sem);
+	sprd_headset_detect_relax(hdst, &hdst->btn_work);
 }
 
 static void sprd_process_4pole_type(struct sprd_headset *hdst,
@@ -1752,7 +1806,7 @@ static enum headset_retrun_val
 sprd_headset_valid_insert_all(struct sprd_headset *hdst,
 	int deboun_time_ms)
 {
-	int val, data_last, data_current;
+	int val;
 
 	val = sprd_get_eic_mis_status(HDST_INSERT_ALL_EIC);
 	if (val == 0) {
@@ -1760,11 +1814,8 @@ sprd_headset_valid_insert_all(struct sprd_headset *hdst,
 			val);
 		return RET_MIS_ERR;
 	}
-	data_last = sprd_headset_eic_get_data(HDST_INSERT_ALL_EIC);
 	/* need to wait some time to check debounce */
-	sprd_msleep(deboun_time_ms);
-	data_current = sprd_headset_eic_get_data(HDST_INSERT_ALL_EIC);
-	if (data_last != data_current) {
+	if (!sprd_headset_eic_stable(HDST_INSERT_ALL_EIC, deboun_time_ms)) {
 		pr_err("insert all eic check debounce failed\n");
 		return RET_DEBOUN_ERR;
 	}
@@ -2188,13 +2239,14 @@ out:
 
 	pr_info("%s type_detecting %d out\n", __func__, hdst->type_detecting);
 	up(&hdst->sem);
+	sprd_headset_detect_relax(hdst, &hdst->det_all_work);
 }
 
 static void headset_ldetl_work_func(struct work_struct *work)
 {
 	struct sprd_headset *hdst = sprd_hdst;
 	struct sprd_headset_platform_data *pdata = &hdst->pdata;
-	unsigned int val, ldetl_data_last, ldetl_data_current, rc;
+	unsigned int val, rc;
 	bool insert_status;
 
 	if (!hdst) {
@@ -2214,6 +2266,7 @@ static void headset_ldetl_work_func(struct work_struct *work)
 		sprd_codec_intc_irq(hdst->codec, codec_intc);
 		sprd_intc_force_clear(0, codec_intc);
 		up(&hdst->sem);
+		sprd_headset_detect_relax(hdst, &hdst->ldetl_work);
 		return;
 	}
 
@@ -2222,10 +2275,7 @@ static void headset_ldetl_work_func(struct work_struct *work)
 		sprd_headset_reset(hdst);
 		goto out;
 	}
-	ldetl_data_last = sprd_headset_eic_get_data(12);
-	sprd_msleep(20);
-	ldetl_data_current = sprd_headset_eic_get_data(12);
-	if (ldetl_data_last != ldetl_data_current) {
+	if (!sprd_headset_eic_stable(HDST_LDETL_EIC, 20)) {
 		pr_err("%s check debounce failed\n", __func__);
 		sprd_headset_eic_clear(12);
 		sprd_intc_force_clear(true, ANA_INT_CLR);
@@ -2295,6 +2345,7 @@ static void headset_ldetl_work_func(struct work_struct *work)
 out:
 	pr_info("%s out\n", __func__);
 	up(&hdst->sem);
+	sprd_headset_detect_relax(hdst, &hdst->ldetl_work);
 }
 
 static void sprd_dump_reg_work(struct work_struct *work)
@@ -42,6 +42,7 @@
 #include "mcdt_hw.h"
 #include "sprd-asoc-card-utils.h"
 #include "sprd-asoc-common.h"
+#include "sprd-audcp-dvfs.h"
 #include "sprd-dmaengine-pcm.h"
 #include "sprd-platform-pcm-routing.h"
 #include "sprd-string.h"
@@ -578,6 +579,8 @@ static int vbc_normal_suspend(void)
 	pm_shutdown();
 	normal_vbc_protect_mutex_unlock(stream);
 	disable_access_force();
+	/* agcp may power off, the dsp side selectors with it */
+	dsp_vbc_kctl_cache_invalidate();
 	pr_info("%s suspeded\n", __func__);
 
 	return 0;
@@ -954,6 +957,52 @@ static void fill_dsp_startup_data(struct vbc_codec_priv *vbc_codec,
 	para->voice_record_type = vbc_codec->voice_capture_type + 1;
 }
 
+/*
+ * Rough dsp load of each scene at up to 48k in MHz, voted to the audio
+ * cp dvfs governor while the scene runs. Higher rates scale it up.
+ */
+static const u16 scene_dvfs_mhz[VBC_DAI_ID_MAX] = {
+	[VBC_DAI_ID_NORMAL_AP01] = 40,
+	[VBC_DAI_ID_NORMAL_AP23] = 40,
+	[VBC_DAI_ID_CAPTURE_DSP] = 40,
+	[VBC_DAI_ID_FAST_P] = 40,
+	[VBC_DAI_ID_OFFLOAD] = 80,
+	[VBC_DAI_ID_VOICE] = 200,
+	[VBC_DAI_ID_VOIP] = 160,
+	[VBC_DAI_ID_FM] = 40,
+	[VBC_DAI_ID_LOOP] = 80,
+	[VBC_DAI_ID_PCM_A2DP] = 80,
+	[VBC_DAI_ID_OFFLOAD_A2DP] = 120,
+	[VBC_DAI_ID_BT_CAPTURE_AP] = 20,
+	[VBC_DAI_ID_FM_CAPTURE_AP] = 20,
+	[VBC_DAI_ID_VOICE_CAPTURE] = 20,
+	[VBC_DAI_ID_FM_CAPTURE_DSP] = 40,
+	[VBC_DAI_ID_BT_SCO_CAPTURE_DSP] = 40,
+	[VBC_DAI_ID_FM_DSP] = 40,
+	[VBC_DAI_ID_VOICE_PCM_P] = 40,
+	[VBC_DAI_ID_HFP] = 160,
+	[VBC_DAI_ID_RECOGNISE_CAPTURE] = 120,
+};
+
+/* rate 0 drops the vote of the scene */
+static void scene_dvfs_vote(int scene_id, int stream, u32 rate)
+{
+	u32 mhz = 0;
+	int ret;
+
+	if (scene_id >= VBC_DAI_ID_MAX || stream >= STREAM_CNT)
+		return;
+	if (rate)
+		mhz = DIV_ROUND_UP(scene_dvfs_mhz[scene_id] *
+				   max_t(u32, rate, DEFAULT_RATE),
+				   DEFAULT_RATE);
+	ret = audcp_dvfs_usecase_set(scene_id * STREAM_CNT + stream, mhz);
+	if (ret && ret != -ENODEV)
+		pr_warn("%s %s %s %u MHz failed %d\n", __func__,
+			scene_id_to_str(scene_id), stream_to_str(stream),
+			mhz, ret);
+}
+
 static int dsp_startup(struct vbc_codec_priv *vbc_codec,
 		       int scene_id, int stream)
 {
@@ -1077,6 +1126,7 @@ static void dsp_hw_params(struct vbc_codec_priv *vbc_codec,
 
 	if (!vbc_codec)
 		return;
+	scene_dvfs_vote(scene_id, stream, rate);
 	memset(&hw_data, 0, sizeof(struct sprd_vbc_stream_hw_paras));
 	fill_dsp_hw_data(vbc_codec, scene_id, stream, chan_cnt, rate, data_fmt,
 		&hw_data);
@@ -1271,6 +1321,7 @@ static int ap_hw_params(struct vbc_codec_priv *vbc_codec,
 	if (!vbc_codec)
 		return 0;
 
+	scene_dvfs_vote(scene_id, stream, rate);
 	ret = agdsp_access_enable();
 	if (ret) {
 		pr_err("%s:agdsp_access_enable:error:%d", __func__, ret);
@@ -1651,6 +1702,9 @@ static void set_scene_flag(int scene_id, int stream)
 	mutex_unlock(&pm_vbc->lock_scene_flag);
 	pr_debug("%s %s %s flag = %d\n", __func__,
 		scene_id_to_str(scene_id), stream_to_str(stream), flag);
+	/* hw_params refines it once the rate is known */
+	if (flag == 1)
+		scene_dvfs_vote(scene_id, stream, DEFAULT_RATE);
 }
 
 static void clr_scene_flag(int scene_id, int stream)
@@ -1665,6 +1719,8 @@ static void clr_scene_flag(int scene_id, int stream)
 	mutex_unlock(&pm_vbc->lock_scene_flag);
 	pr_debug("%s %s %s flag = %d\n", __func__,
 		scene_id_to_str(scene_id), stream_to_str(stream), flag);
+	if (flag == 0)
+		scene_dvfs_vote(scene_id, stream, 0);
 }
 
 static int normal_suspend(struct snd_soc_dai *dai)
@@ -24,6 +24,7 @@
 #include <linux/init.h>
 #include <linux/io.h>
 #include <linux/kernel.h>
+#include <linux/mutex.h>
 #include <linux/of.h>
 #include <linux/of_address.h>
 #include <linux/pinctrl/consumer.h>
@@ -619,12 +620,64 @@ void vbc_phy_audply_set_src_mode(int en, int mode)
  * cmd for SND_VBC_DSP_IO_KCTL_SET
  *********************************************************/
 
+/*
+ * The selectors below are written again with unchanged values on every
+ * path change from userspace, and each write is a blocking round trip
+ * to the dsp. Remember what the dsp was last told per type and id and
+ * drop the repeats. Anything that may have reset the dsp side must call
+ * dsp_vbc_kctl_cache_invalidate().
+ */
+#define DSP_KCTL_CACHE_IDS	16
+
+static DEFINE_MUTEX(dsp_kctl_cache_lock);
+static int dsp_kctl_cache_val[SND_KCTL_TYPE_END][DSP_KCTL_CACHE_IDS];
+static u16 dsp_kctl_cache_valid[SND_KCTL_TYPE_END];
+
+static int dsp_vbc_kctl_set_cached(int type, int id, int val,
+	void *para, size_t size)
+{
+	bool cacheable = id >= 0 && id < DSP_KCTL_CACHE_IDS;
+	int ret;
+
+	mutex_lock(&dsp_kctl_cache_lock);
+	if (cacheable && (dsp_kctl_cache_valid[type] & BIT(id)) &&
+	    dsp_kctl_cache_val[type][id] == val) {
+		mutex_unlock(&dsp_kctl_cache_lock);
+		sp_asoc_pr_dbg("%s type %d id %d val %d cached\n", __func__,
+			type, id, val);
+		return 0;
+	}
+	ret = aud_send_cmd(AMSG_CH_VBC_CTL, type, -1,
+		SND_VBC_DSP_IO_KCTL_SET, para, size,
+		AUDIO_SIPC_WAIT_FOREVER);
+	if (cacheable) {
+		if (ret < 0) {
+			dsp_kctl_cache_valid[type] &= ~BIT(id);
+		} else {
+			dsp_kctl_cache_val[type][id] = val;
+			dsp_kctl_cache_valid[type] |= BIT(id);
+		}
+	}
+	mutex_unlock(&dsp_kctl_cache_lock);
+
+	return ret;
+}
+
+void dsp_vbc_kctl_cache_invalidate(void)
+{
+	mutex_lock(&dsp_kctl_cache_lock);
+	memset(dsp_kctl_cache_valid, 0, sizeof(dsp_kctl_cache_valid));
+	mutex_unlock(&dsp_kctl_cache_lock);
+}
+
 /* SND_KCTL_TYPE_REG */
 int dsp_vbc_reg_write(u32 reg, int val, u32 mask)
 {
 	int ret;
 	struct sprd_vbc_kcontrol vbc_reg = { };
 
+	/* a raw write may change any selector behind the cache */
+	dsp_vbc_kctl_cache_invalidate();
 	vbc_reg.reg = reg;
 	vbc_reg.value = val;
 	vbc_reg.mask = mask;
@@ -836,10 +889,8 @@ int dsp_vbc_mux_adc_source_set(int id, int val)
 
 	mux_para.id = id;
 	mux_para.val = val;
-	ret = aud_send_cmd(AMSG_CH_VBC_CTL, SND_KCTL_TYPE_MUX_ADC_SOURCE,
-		-1, SND_VBC_DSP_IO_KCTL_SET,
-		&mux_para, sizeof(struct vbc_mux_adc_source),
-		AUDIO_SIPC_WAIT_FOREVER);
+	ret = dsp_vbc_kctl_set_cached(SND_KCTL_TYPE_MUX_ADC_SOURCE, id, val,
+		&mux_para, sizeof(struct vbc_mux_adc_source));
 	if (ret < 0)
 		pr_err("%s, Failed to set, ret: %d\n", __func__, ret);
 
@@ -854,10 +905,8 @@ int dsp_vbc_mux_dac_out_set(int id, int val)
 
 	mux_para.id = id;
 	mux_para.val = val;
-	ret = aud_send_cmd(AMSG_CH_VBC_CTL, SND_KCTL_TYPE_MUX_DAC_OUT,
-		-1, SND_VBC_DSP_IO_KCTL_SET,
-		&mux_para, sizeof(struct vbc_mux_dac_out),
-		AUDIO_SIPC_WAIT_FOREVER);
+	ret = dsp_vbc_kctl_set_cached(SND_KCTL_TYPE_MUX_DAC_OUT, id, val,
+		&mux_para, sizeof(struct vbc_mux_dac_out));
 	if (ret < 0)
 		pr_err("%s, Failed to set, ret: %d\n", __func__, ret);
 
@@ -872,10 +921,8 @@ int dsp_vbc_mux_adc_set(int id, int val)
 
 	mux_para.id = id;
 	mux_para.val = val;
-	ret = aud_send_cmd(AMSG_CH_VBC_CTL, SND_KCTL_TYPE_MUX_ADC,
-		-1, SND_VBC_DSP_IO_KCTL_SET,
-		&mux_para, sizeof(struct vbc_mux_adc_in),
-		AUDIO_SIPC_WAIT_FOREVER);
+	ret = dsp_vbc_kctl_set_cached(SND_KCTL_TYPE_MUX_ADC, id, val,
+		&mux_para, sizeof(struct vbc_mux_adc_in));
 	if (ret < 0)
 		pr_err("%s, Failed to set, ret: %d\n", __func__, ret);
 
@@ -890,10 +937,8 @@ int dsp_vbc_mux_fm_set(int id, int val)
 
 	mux_para.id = id;
 	mux_para.val = val;
-	ret = aud_send_cmd(AMSG_CH_VBC_CTL, SND_KCTL_TYPE_MUX_FM,
-		-1, SND_VBC_DSP_IO_KCTL_SET,
-		&mux_para, sizeof(struct vbc_mux_fm),
-		AUDIO_SIPC_WAIT_FOREVER);
+	ret = dsp_vbc_kctl_set_cached(SND_KCTL_TYPE_MUX_FM, id, val,
+		&mux_para, sizeof(struct vbc_mux_fm));
 	if (ret < 0)
 		pr_err("%s, Failed to set, ret: %d\n", __func__, ret);
 
@@ -908,10 +953,8 @@ int dsp_vbc_mux_st_set(int id, int val)
 
 	mux_para.id = id;
 	mux_para.val = val;
-	ret = aud_send_cmd(AMSG_CH_VBC_CTL, SND_KCTL_TYPE_MUX_ST,
-		-1, SND_VBC_DSP_IO_KCTL_SET,
-		&mux_para, sizeof(struct vbc_mux_st),
-		AUDIO_SIPC_WAIT_FOREVER);
+	ret = dsp_vbc_kctl_set_cached(SND_KCTL_TYPE_MUX_ST, id, val,
+		&mux_para, sizeof(struct vbc_mux_st));
 	if (ret < 0)
 		pr_err("%s, Failed to set, ret: %d\n", __func__, ret);
 
@@ -926,10 +969,8 @@ int dsp_vbc_mux_loop_da0_set(int id, int val)
 
 	mux_para.id = id;
 	mux_para.val = val;
-	ret = aud_send_cmd(AMSG_CH_VBC_CTL, SND_KCTL_TYPE_MUX_LOOP_DA0,
-		-1, SND_VBC_DSP_IO_KCTL_SET,
-		&mux_para, sizeof(struct vbc_mux_loop_dac0),
-		AUDIO_SIPC_WAIT_FOREVER);
+	ret = dsp_vbc_kctl_set_cached(SND_KCTL_TYPE_MUX_LOOP_DA0, id, val,
+		&mux_para, sizeof(struct vbc_mux_loop_dac0));
 	if (ret < 0)
 		pr_err("%s, Failed to set, ret: %d\n", __func__, ret);
 
@@ -944,10 +985,8 @@ int dsp_vbc_mux_loop_da1_set(int id, int val)
 
 	mux_para.id = id;
 	mux_para.val = val;
-	ret = aud_send_cmd(AMSG_CH_VBC_CTL, SND_KCTL_TYPE_MUX_LOOP_DA1,
-		-1, SND_VBC_DSP_IO_KCTL_SET,
-		&mux_para, sizeof(struct vbc_mux_loop_dac1),
-		AUDIO_SIPC_WAIT_FOREVER);
+	ret = dsp_vbc_kctl_set_cached(SND_KCTL_TYPE_MUX_LOOP_DA1, id, val,
+		&mux_para, sizeof(struct vbc_mux_loop_dac1));
 	if (ret < 0)
 		pr_err("%s, Failed to set, ret: %d\n", __func__, ret);
 
@@ -962,10 +1001,8 @@ int dsp_vbc_mux_loop_da0_da1_set(int id, int val)
 
 	mux_para.id = id;
 	mux_para.val = val;
-	ret = aud_send_cmd(AMSG_CH_VBC_CTL, SND_KCTL_TYPE_MUX_LOOP_DA0_DA1,
-		-1, SND_VBC_DSP_IO_KCTL_SET,
-		&mux_para, sizeof(struct vbc_mux_loop_dac0_dac1),
-		AUDIO_SIPC_WAIT_FOREVER);
+	ret = dsp_vbc_kctl_set_cached(SND_KCTL_TYPE_MUX_LOOP_DA0_DA1, id, val,
+		&mux_para, sizeof(struct vbc_mux_loop_dac0_dac1));
 	if (ret < 0)
 		pr_err("%s, Failed to set, ret: %d\n", __func__, ret);
 
@@ -980,10 +1017,8 @@ int dsp_vbc_mux_audrcd_set(int id, int val)
 
 	mux_para.id = id;
 	mux_para.val = val;
-	ret = aud_send_cmd(AMSG_CH_VBC_CTL, SND_KCTL_TYPE_MUX_AUDRCD,
-		-1, SND_VBC_DSP_IO_KCTL_SET,
-		&mux_para, sizeof(struct vbc_mux_audrcd_in),
-		AUDIO_SIPC_WAIT_FOREVER);
+	ret = dsp_vbc_kctl_set_cached(SND_KCTL_TYPE_MUX_AUDRCD, id, val,
+		&mux_para, sizeof(struct vbc_mux_audrcd_in));
 	if (ret < 0)
 		pr_err("%s, Failed to set, ret: %d\n", __func__, ret);
 
@@ -998,10 +1033,8 @@ int dsp_vbc_mux_tdm_audrcd23_set(int id, int val)
 
 	mux_para.id = id;
 	mux_para.val = val;
-	ret = aud_send_cmd(AMSG_CH_VBC_CTL, SND_KCTL_TYPE_MUX_TDM_AUDRCD23,
-		-1, SND_VBC_DSP_IO_KCTL_SET,
-		&mux_para, sizeof(struct vbc_mux_tdm_audrcd23),
-		AUDIO_SIPC_WAIT_FOREVER);
+	ret = dsp_vbc_kctl_set_cached(SND_KCTL_TYPE_MUX_TDM_AUDRCD23, id, val,
+		&mux_para, sizeof(struct vbc_mux_tdm_audrcd23));
 	if (ret < 0)
 		pr_err("%s, Failed to set, ret: %d\n", __func__, ret);
 
@@ -1016,10 +1049,8 @@ int dsp_vbc_mux_ap01_dsp_set(int id, int val)
 
 	mux_para.id = id;
 	mux_para.val = val;
-	ret = aud_send_cmd(AMSG_CH_VBC_CTL, SND_KCTL_TYPE_MUX_AP01_DSP,
-		-1, SND_VBC_DSP_IO_KCTL_SET,
-		&mux_para, sizeof(struct vbc_mux_ap01_dsp),
-		AUDIO_SIPC_WAIT_FOREVER);
+	ret = dsp_vbc_kctl_set_cached(SND_KCTL_TYPE_MUX_AP01_DSP, id, val,
+		&mux_para, sizeof(struct vbc_mux_ap01_dsp));
 	if (ret < 0)
 		pr_err("%s, Failed to set, ret: %d\n", __func__, ret);
 
@@ -1034,10 +1065,8 @@ int dsp_vbc_mux_iis_tx_set(int id, int val)
 
 	mux_para.id = id;
 	mux_para.val = val;
-	ret = aud_send_cmd(AMSG_CH_VBC_CTL, SND_KCTL_TYPE_MUX_IIS_TX,
-		-1, SND_VBC_DSP_IO_KCTL_SET,
-		&mux_para, sizeof(struct vbc_mux_iis_tx),
-		AUDIO_SIPC_WAIT_FOREVER);
+	ret = dsp_vbc_kctl_set_cached(SND_KCTL_TYPE_MUX_IIS_TX, id, val,
+		&mux_para, sizeof(struct vbc_mux_iis_tx));
 	if (ret < 0)
 		pr_err("%s, Failed to set, ret: %d\n", __func__, ret);
 
@@ -1052,10 +1081,8 @@ int dsp_vbc_mux_iis_rx_set(int id, int val)
 
 	mux_para.id = id;
 	mux_para.val = val;
-	ret = aud_send_cmd(AMSG_CH_VBC_CTL, SND_KCTL_TYPE_MUX_IIS_RX,
-		-1, SND_VBC_DSP_IO_KCTL_SET,
-		&mux_para, sizeof(struct vbc_mux_iis_rx),
-		AUDIO_SIPC_WAIT_FOREVER);
+	ret = dsp_vbc_kctl_set_cached(SND_KCTL_TYPE_MUX_IIS_RX, id, val,
+		&mux_para, sizeof(struct vbc_mux_iis_rx));
 	if (ret < 0)
 		pr_err("%s, Failed to set, ret: %d\n", __func__, ret);
 
@@ -1070,10 +1097,8 @@ int dsp_vbc_mux_iis_port_do_set(int id, int val)
 
 	mux_para.id = id;
 	mux_para.val = val;
-	ret = aud_send_cmd(AMSG_CH_VBC_CTL, SND_KCTL_TYPE_IIS_PORT_DO,
-		-1, SND_VBC_DSP_IO_KCTL_SET,
-		&mux_para, sizeof(struct vbc_mux_iis_port_do),
-		AUDIO_SIPC_WAIT_FOREVER);
+	ret = dsp_vbc_kctl_set_cached(SND_KCTL_TYPE_IIS_PORT_DO, id, val,
+		&mux_para, sizeof(struct vbc_mux_iis_port_do));
 	if (ret < 0)
 		pr_err("%s, Failed to set, ret: %d\n", __func__, ret);
 
@@ -1145,10 +1170,8 @@ int dsp_vbc_dp_en_set(int id, u16 enable)
 
 	dp_en.id = id;
 	dp_en.enable = enable;
-	ret = aud_send_cmd(AMSG_CH_VBC_CTL, SND_KCTL_TYPE_DATAPATH,
-		-1, SND_VBC_DSP_IO_KCTL_SET,
-		&dp_en, sizeof(struct vbc_dp_en_para),
-		AUDIO_SIPC_WAIT_FOREVER);
+	ret = dsp_vbc_kctl_set_cached(SND_KCTL_TYPE_DATAPATH, id, enable,
+		&dp_en, sizeof(struct vbc_dp_en_para));
 	if (ret < 0)
 		pr_err("%s, Failed to set, ret: %d\n", __func__, ret);
 
@@ -1181,10 +1204,8 @@ int dsp_vbc_iis_tx_width_set(int id, u32 width)
 
 	iis_tx_width.id = id;
 	iis_tx_width.value = width;
-	ret = aud_send_cmd(AMSG_CH_VBC_CTL, SND_KCTL_TYPE_IIS_TX_WIDTH_SEL,
-		-1, SND_VBC_DSP_IO_KCTL_SET,
-		&iis_tx_width, sizeof(struct vbc_iis_tx_wd_para),
-		AUDIO_SIPC_WAIT_FOREVER);
+	ret = dsp_vbc_kctl_set_cached(SND_KCTL_TYPE_IIS_TX_WIDTH_SEL, id, width,
+		&iis_tx_width, sizeof(struct vbc_iis_tx_wd_para));
 	if (ret < 0)
 		pr_err("%s, Failed to set, ret: %d\n", __func__, ret);
 
@@ -1199,10 +1220,8 @@ int dsp_vbc_iis_tx_lr_mod_set(int id, u32 lr_mod)
 
 	iis_tx_lr_mod.id = id;
 	iis_tx_lr_mod.value = lr_mod;
-	ret = aud_send_cmd(AMSG_CH_VBC_CTL, SND_KCTL_TYPE_IIS_TX_LRMOD_SEL,
-		-1, SND_VBC_DSP_IO_KCTL_SET,
-		&iis_tx_lr_mod, sizeof(struct vbc_iis_tx_lr_mod_para),
-		AUDIO_SIPC_WAIT_FOREVER);
+	ret = dsp_vbc_kctl_set_cached(SND_KCTL_TYPE_IIS_TX_LRMOD_SEL, id, lr_mod,
+		&iis_tx_lr_mod, sizeof(struct vbc_iis_tx_lr_mod_para));
 	if (ret < 0)
 		pr_err("%s, Failed to set, ret: %d\n", __func__, ret);
 
@@ -1217,10 +1236,8 @@ int dsp_vbc_iis_rx_width_set(int id, u32 width)
 
 	iis_rx_width.id = id;
 	iis_rx_width.value = width;
-	ret = aud_send_cmd(AMSG_CH_VBC_CTL, SND_KCTL_TYPE_IIS_RX_WIDTH_SEL,
-		-1, SND_VBC_DSP_IO_KCTL_SET,
-		&iis_rx_width, sizeof(struct vbc_iis_rx_wd_para),
-		AUDIO_SIPC_WAIT_FOREVER);
+	ret = dsp_vbc_kctl_set_cached(SND_KCTL_TYPE_IIS_RX_WIDTH_SEL, id, width,
+		&iis_rx_width, sizeof(struct vbc_iis_rx_wd_para));
 	if (ret < 0)
 		pr_err("%s, Failed to set, ret: %d\n", __func__, ret);
 
@@ -1235,10 +1252,8 @@ int dsp_vbc_iis_rx_lr_mod_set(int id, u32 lr_mod)
 
 	iis_rx_lr_mod.id = id;
 	iis_rx_lr_mod.value = lr_mod;
-	ret = aud_send_cmd(AMSG_CH_VBC_CTL, SND_KCTL_TYPE_IIS_RX_LRMOD_SEL,
-		-1, SND_VBC_DSP_IO_KCTL_SET,
-		&iis_rx_lr_mod, sizeof(struct vbc_iis_rx_lr_mod_para),
-		AUDIO_SIPC_WAIT_FOREVER);
+	ret = dsp_vbc_kctl_set_cached(SND_KCTL_TYPE_IIS_RX_LRMOD_SEL, id, lr_mod,
+		&iis_rx_lr_mod, sizeof(struct vbc_iis_rx_lr_mod_para));
 	if (ret < 0)
 		pr_err("%s, Failed to set, ret: %d\n", __func__, ret);
 
@@ -1253,9 +1268,9 @@ int dsp_vbc_mst_sel_type_set(int id, u32 type)
 
 	iis_mst_sel_type.id = id;
 	iis_mst_sel_type.mst_type = type;
-	ret = aud_send_cmd(AMSG_CH_VBC_CTL, SND_KCTL_TYPE_EXT_INNER_IIS_MST_SEL,
-			   -1, SND_VBC_DSP_IO_KCTL_SET, &iis_mst_sel_type,
-			   sizeof(iis_mst_sel_type), AUDIO_SIPC_WAIT_FOREVER);
+	ret = dsp_vbc_kctl_set_cached(SND_KCTL_TYPE_EXT_INNER_IIS_MST_SEL,
+			   id, type, &iis_mst_sel_type,
+			   sizeof(iis_mst_sel_type));
 	if (ret < 0)
 		pr_err("mst_sel_type_set failed %d\n", ret);
 
@@ -1482,6 +1482,7 @@ void scene_dump_set(enum vbc_dump_position_e pos);
  * dsp phy define interface
  *******************************************************************/
 int dsp_vbc_reg_write(u32 reg, int val, u32 mask);
+void dsp_vbc_kctl_cache_invalidate(void);
 u32 dsp_vbc_reg_read(u32 reg);
 int dsp_vbc_mdg_set(int id, int enable, int mdg_step);
 int dsp_vbc_src_set(int id, int32_t fs);
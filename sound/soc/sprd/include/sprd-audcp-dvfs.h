@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2019 Spreadtrum Communications Inc.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef __SPRD_AUDCP_DVFS_H
+#define __SPRD_AUDCP_DVFS_H
+
+#include <linux/types.h>
+
+#define AUDCP_DVFS_USECASE_MAX	64
+
+/*
+ * Use-case votes for the audio cp dvfs governor: each active use case
+ * reports the dsp load it needs in MHz, mhz 0 drops the vote. The
+ * governor runs the lowest dvfs level whose clock covers the sum plus
+ * its headroom. Raising happens before the call returns, lowering is
+ * deferred a little so short gaps between streams do not bounce.
+ */
+#if IS_REACHABLE(CONFIG_SPRD_HW_DEVICE_DVFS_AGCP)
+int audcp_dvfs_usecase_set(u32 id, u32 mhz);
+#else
+static inline int audcp_dvfs_usecase_set(u32 id, u32 mhz)
+{
+	return 0;
+}
+#endif
+
+#endif /* __SPRD_AUDCP_DVFS_H */
@@ -152,6 +152,9 @@ struct sprd_runtime_data {
 	u32 pointer2_step_max;
 	u32 node_size_level1;
 	u32 node_cfg_count_2;
+	/* mmap stream running on the level-1 iram only */
+	bool mmap_iram;
+	struct snd_dma_buffer iram_buf;
 };
 
 static struct audio_pm_dma *pm_dma;
@@ -837,9 +840,68 @@ static bool is_use_2stage_dma(struct snd_soc_pcm_runtime *srtd, int stream)
 	else
 		ret = false;
 
+	if (ret && substream->runtime && substream->runtime->private_data) {
+		struct sprd_runtime_data *rtd = substream->runtime->private_data;
+
+		if (rtd->mmap_iram)
+			ret = false;
+	}
+
 	return ret;
 }
 
+/*
+ * An mmap stream that does not want period wakeups (aaudio exclusive
+ * mode) gets the level-1 iram as its ring buffer: the ddr stage and its
+ * dsp handshake are skipped and the pointer follows the dma address
+ * instead of the level-1 interrupt count. Only done when the whole ring
+ * and its linklist fit into the iram block of the dai.
+ */
+static bool sprd_pcm_use_mmap_iram(struct snd_pcm_substream *substream,
+				   struct snd_pcm_hw_params *params)
+{
+	struct snd_soc_pcm_runtime *srtd = substream->private_data;
+	struct sprd_runtime_data *rtd = substream->runtime->private_data;
+	struct snd_dma_buffer *buf = &rtd->iram_buf;
+	struct platform_pcm_priv *priv_data;
+	snd_pcm_access_t access = params_access(params);
+	u32 node_size;
+
+	if (!is_use_2stage_dma(srtd, substream->stream))
+		return false;
+	if (access != SNDRV_PCM_ACCESS_MMAP_INTERLEAVED &&
+	    access != SNDRV_PCM_ACCESS_MMAP_NONINTERLEAVED)
+		return false;
+	if (!(params->flags & SNDRV_PCM_HW_PARAMS_NO_PERIOD_WAKEUP))
+		return false;
+
+	priv_data = snd_soc_platform_get_drvdata(srtd->platform);
+	if (srtd->cpu_dai->id == VBC_DAI_NORMAL) {
+		buf->addr = priv_data->iram_normal_phy_addr;
+		buf->area = priv_data->iram_normal_virt_addr;
+		buf->bytes = priv_data->iram_normal_size;
+	} else {
+		buf->addr = priv_data->iram_deepbuf_phy_addr;
+		buf->area = priv_data->iram_deepbuf_virt_addr;
+		buf->bytes = priv_data->iram_deepbuf_size;
+	}
+	if (buf->bytes <= 2 * SPRD_AUDIO_DMA_NODE_SIZE)
+		return false;
+	buf->bytes -= 2 * SPRD_AUDIO_DMA_NODE_SIZE;
+
+	node_size = sizeof(struct sprd_dma_cfg) +
+		params_periods(params) * sizeof(struct scatterlist);
+	if (params_buffer_bytes(params) > buf->bytes ||
+	    node_size > SPRD_AUDIO_DMA_NODE_SIZE)
+		return false;
+
+	buf->dev.type = SNDRV_DMA_TYPE_DEV_IRAM;
+	buf->dev.dev = substream->pcm->card->dev;
+	buf->private_data = NULL;
+
+	return true;
+}
+
 static s32 dmabuffer_reserved_ddr_alloc(struct snd_pcm_substream *substream)
 {
 	struct snd_dma_buffer *dma_buffer = &substream->dma_buffer;
@@ -2405,7 +2467,7 @@ static int sprd_pcm_hw_params1(struct snd_pcm_substream *substream,
 	}
 
 	/* alloc dma linklist config buffer */
-	dma_buffer = &substream->dma_buffer;
+	dma_buffer = rtd->mmap_iram ? &rtd->iram_buf : &substream->dma_buffer;
 	pr_info("%s dma_buffer->dev.type %d\n", __func__, dma_buffer->dev.type);
 	if (dma_buffer->dev.type == SNDRV_DMA_TYPE_DEV_IRAM) {
 		linklist_node_size = SPRD_AUDIO_DMA_NODE_SIZE;
@@ -2439,7 +2501,7 @@ static int sprd_pcm_hw_params1(struct snd_pcm_substream *substream,
 	pr_info("linklist_node_size = %#x\n", linklist_node_size);
 	ret = 0;
 
-	snd_pcm_set_runtime_buffer(substream, &substream->dma_buffer);
+	snd_pcm_set_runtime_buffer(substream, dma_buffer);
 
 	runtime->dma_bytes = totsize;
 
@@ -2587,6 +2649,13 @@ static int sprd_pcm_hw_params(struct snd_pcm_substream *substream,
 			      struct snd_pcm_hw_params *params)
 {
 	struct snd_soc_pcm_runtime *srtd = substream->private_data;
+	struct sprd_runtime_data *rtd = substream->runtime->private_data;
+
+	/* the stage layout is fixed once the dma channels are requested */
+	if (!rtd->params)
+		rtd->mmap_iram = sprd_pcm_use_mmap_iram(substream, params);
+	if (rtd->mmap_iram)
+		pr_info("%s mmap stream on level-1 iram\n", __func__);
 
 	if (is_use_2stage_dma(srtd, substream->stream)) {
 		pr_info("%s use 2 stage dma\n", __func__);
@@ -2623,7 +2692,8 @@ static int sprd_pcm_hw_free(struct snd_pcm_substream *substream)
 			pcm_free_dma_linklist_cfg_ddr_s2_2(substream);
 		sprd_pcm_free_dma_cfg(substream, DMA_STAGE_TWO);
 	} else {
-		if (substream->dma_buffer.dev.type != SNDRV_DMA_TYPE_DEV_IRAM)
+		if (substream->dma_buffer.dev.type != SNDRV_DMA_TYPE_DEV_IRAM &&
+		    !rtd->mmap_iram)
 			pcm_free_dma_linklist_cfg_ddr(substream);
 		sprd_pcm_free_dma_cfg(substream, DMA_STAGE_ONE);
 	}
@@ -2697,6 +2767,7 @@ static int sprd_pcm_hw_free(struct snd_pcm_substream *substream)
 
 	if (is_use_2stage_dma(srtd, substream->stream))
 		sprd_pcm_proc_done(substream);
+	rtd->mmap_iram = false;
 
 	return 0;
 }
@@ -67,6 +67,12 @@
 #define COMPR_PLAYBACK_MIN_NUM_FRAGMENTS	(4)
 #define COMPR_PLAYBACK_MAX_NUM_FRAGMENTS	(16 * 4)
 
+/*
+ * Deep buffer (no_wake_mode) streams only wake userspace once less than
+ * 1/4 of the ring, and at least a fragment, is left for the dsp.
+ */
+#define COMPR_DEEP_LOWMARK_SHIFT	2
+
 #define CMD_TIMEOUT			msecs_to_jiffies(5000)
 #define DATA_TIMEOUT			msecs_to_jiffies(50)
 #define CMD_MODEM_RESET_TIMEOUT	msecs_to_jiffies(10000)
@@ -184,6 +190,7 @@ struct sprd_compr_rtd {
 	u32 next_track;
 
 	bool dma_paused;
+	bool deep_buffer;
 
 	atomic_t start;
 	atomic_t eos;
@@ -561,6 +568,37 @@ static void sprd_compr_dma_buf_done0(void *data)
 }
 #endif
 
+static u32 sprd_compr_lowmark(struct sprd_compr_rtd *srtd)
+{
+	return max_t(u32, srtd->buffer_size >> COMPR_DEEP_LOWMARK_SHIFT,
+		     srtd->params.frag_len);
+}
+
+static bool sprd_compr_below_lowmark(struct sprd_compr_rtd *srtd,
+				     struct snd_compr_runtime *runtime)
+{
+	s64 queued = runtime->total_bytes_available - srtd->copied_total;
+
+	return queued <= (s64)sprd_compr_lowmark(srtd);
+}
+
+/* ms between two wakeups of the writer, 0 if the bitrate is unknown */
+static u32 sprd_compr_wakeup_interval(struct sprd_compr_rtd *srtd)
+{
+	u32 bit_rate = srtd->codec_param.codec.bit_rate;
+	u64 bytes;
+
+	if (!bit_rate)
+		return 0;
+
+	if (srtd->deep_buffer)
+		bytes = srtd->buffer_size - sprd_compr_lowmark(srtd);
+	else
+		bytes = srtd->params.frag_len;
+
+	return div_u64(bytes * 8 * MSEC_PER_SEC, bit_rate);
+}
+
 int s_buf_done_count;
 static void sprd_compr_dma_buf_done(void *data)
 {
@@ -577,11 +615,6 @@ static void sprd_compr_dma_buf_done(void *data)
 		return;
 	}
 
-	if (!srtd->wake_locked) {
-		__pm_stay_awake(&srtd->wake_lock);
-		sp_asoc_pr_info("buff done wake_lock\n");
-		srtd->wake_locked = 1;
-	}
 #if COMPR_DUMP_DEBUG
 	mm_segment_t *old_fs = 0;
 
@@ -597,6 +630,20 @@ static void sprd_compr_dma_buf_done(void *data)
 	pr_info("%s, DMA copied totol=%d, avail_total=%d, buf_done_count=%d\n",
 		__func__, srtd->copied_total, srtd->avail_total,
 		s_buf_done_count);
+
+	/*
+	 * The dsp decodes on its own while enough data is queued, so a
+	 * deep buffer stream neither holds the wakeup source nor wakes the
+	 * writer until the ring runs low.
+	 */
+	if (srtd->deep_buffer && !sprd_compr_below_lowmark(srtd, runtime))
+		return;
+
+	if (!srtd->wake_locked) {
+		__pm_stay_awake(&srtd->wake_lock);
+		sp_asoc_pr_info("buff done wake_lock\n");
+		srtd->wake_locked = 1;
+	}
 	snd_compr_fragment_elapsed(dma_cb_data->substream);
 
 }
@@ -1380,6 +1427,7 @@ static int sprd_platform_compr_set_params(struct snd_compr_stream *cstream,
 	/*prtd->cstream = cstream;*/
 
 	memcpy(&srtd->codec_param, params, sizeof(struct snd_compr_params));
+	srtd->deep_buffer = params->no_wake_mode;
 
 	/* ToDo: remove duplicates */
 	srtd->num_channels = srtd->codec_param.codec.ch_in;
@@ -1463,6 +1511,10 @@ static int sprd_platform_compr_set_params(struct snd_compr_stream *cstream,
 	mutex_unlock(&dev_ctrl->mutex);
 
 	srtd->stream_state = COMPR_PARAMSED;
+	if (srtd->deep_buffer)
+		sp_asoc_pr_info("%s: deep buffer, lowmark=%u, wakeup=%ums\n",
+				__func__, sprd_compr_lowmark(srtd),
+				sprd_compr_wakeup_interval(srtd));
 
 	ADEBUG();
 
@@ -1990,6 +2042,20 @@ static int sprd_platform_compr_set_metadata(struct snd_compr_stream *cstream,
 	return 0;
 }
 
+static int sprd_platform_compr_get_metadata(struct snd_compr_stream *cstream,
+					    struct snd_compr_metadata *metadata)
+{
+	struct snd_compr_runtime *runtime = cstream->runtime;
+	struct sprd_compr_rtd *srtd = runtime->private_data;
+
+	if (metadata->key != SNDRV_COMPRESS_WAKEUP_INTERVAL)
+		return -EINVAL;
+
+	metadata->value[0] = sprd_compr_wakeup_interval(srtd);
+
+	return 0;
+}
+
 #ifdef CONFIG_PROC_FS
 static void sprd_compress_proc_read(struct snd_info_entry *entry,
 				 struct snd_info_buffer *buffer)
@@ -2118,6 +2184,7 @@ static struct snd_compr_ops sprd_platform_compr_ops = {
 	.free = sprd_platform_compr_free,
 	.set_params = sprd_platform_compr_set_params,
 	.set_metadata = sprd_platform_compr_set_metadata,
+	.get_metadata = sprd_platform_compr_get_metadata,
 	.trigger = sprd_platform_compr_trigger,
 	.pointer = sprd_platform_compr_pointer,
 	.copy = sprd_platform_compr_copy,
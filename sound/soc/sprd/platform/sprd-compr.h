@@ -56,6 +56,8 @@ enum {
 #define SNDRV_COMPRESS_SAMPLERATE	100
 #define SNDRV_COMPRESS_BITRATE		101
 #define SNDRV_COMPRESS_CHANNEL		102
+/* get only, ms the writer may sleep between two refills */
+#define SNDRV_COMPRESS_WAKEUP_INTERVAL	103
 
 struct cmd_common {
 	u32 command;